@@ -54,6 +54,10 @@
 # define SO_TIMESTAMPNS 35
 #endif
 
+#ifndef SCM_TIMESTAMPING_STAGES
+# define SCM_TIMESTAMPING_STAGES 64
+#endif
+
 #ifndef SIOCGSTAMPNS
 # define SIOCGSTAMPNS 0x8907
 #endif
@@ -77,6 +81,7 @@ static void usage(const char *error)
 	       "  SOF_TIMESTAMPING_RX_SOFTWARE - software fallback for incoming packets\n"
 	       "  SOF_TIMESTAMPING_SOFTWARE - request reporting of software time stamps\n"
 	       "  SOF_TIMESTAMPING_RAW_HARDWARE - request reporting of raw HW time stamps\n"
+	       "  SOF_TIMESTAMPING_RX_STAGES - request reporting of receive path stages\n"
 	       "  SIOCGSTAMP - check last socket time stamp\n"
 	       "  SIOCGSTAMPNS - more accurate socket time stamp\n");
 	exit(1);
@@ -208,6 +213,22 @@ static void printpacket(struct msghdr *msg, int res,
 				       (long)stamp->tv_nsec);
 				break;
 			}
+			case SCM_TIMESTAMPING_STAGES: {
+				struct scm_timestamping_stages *stages =
+					(struct scm_timestamping_stages *)
+					CMSG_DATA(cmsg);
+				static const char *names[] = {
+					"driver", "stack", "enqueue", "dequeue"
+				};
+				int i;
+
+				printf("SCM_TIMESTAMPING_STAGES");
+				for (i = 0; i < SCM_TSTAMP_STAGE_MAX; i++)
+					printf(" %s %ld.%09ld", names[i],
+					       (long)stages->ts[i].tv_sec,
+					       (long)stages->ts[i].tv_nsec);
+				break;
+			}
 			default:
 				printf("type %d", cmsg->cmsg_type);
 				break;
@@ -360,6 +381,8 @@ int main(int argc, char **argv)
 			so_timestamping_flags |= SOF_TIMESTAMPING_SOFTWARE;
 		else if (!strcasecmp(argv[i], "SOF_TIMESTAMPING_RAW_HARDWARE"))
 			so_timestamping_flags |= SOF_TIMESTAMPING_RAW_HARDWARE;
+		else if (!strcasecmp(argv[i], "SOF_TIMESTAMPING_RX_STAGES"))
+			so_timestamping_flags |= SOF_TIMESTAMPING_RX_STAGES;
 		else
 			usage(argv[i]);
 	}
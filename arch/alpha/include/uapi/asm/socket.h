@@ -87,4 +87,8 @@
 
 #define SO_BPF_EXTENSIONS	48
 
+#define SO_ZEROCOPY		60
+
+#define SCM_TIMESTAMPING_STAGES	64
+
 #endif /* _UAPI_ASM_SOCKET_H */
@@ -0,0 +1,145 @@
+/*
+ * CRC32C folding using NEON intrinsics
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ * The data is folded 128 bits at a time as described in Intel's "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction": a 128
+ * bit remainder r = rh * x^64 + rl that is followed by n more bits is
+ * congruent to rh * (x^(n+64) mod P) + rl * (x^n mod P) modulo P, which
+ * only takes 64x32 bit carry-less multiplications. ARMv7 NEON does not
+ * have those, they are put together out of four vmull.p8 each, one per
+ * byte of the constant. What is left in the end is reduced by the caller,
+ * with the table based __crc32c_le().
+ *
+ * Four remainders are kept in flight so that the multiplications of one
+ * overlap with the permutes of the others.
+ */
+
+#include <arm_neon.h>
+
+#ifndef __ARM_NEON__
+#error You should compile this file with '-mfloat-abi=softfp -mfpu=neon'
+#endif
+
+void crc32c_neon_fold(uint8_t out[16], uint32_t crc, const uint8_t *src,
+		      unsigned int blocks);
+
+/*
+ * The bit reflected x^(e - 1) mod P for the distances the remainders are
+ * moved by, the missing x^1 is made up for by the bit reflection of the
+ * product.
+ */
+#define K_64_HI		0x1c19243b	/* e = 576, four remainders on */
+#define K_64_LO		0x75bba45b	/* e = 512 */
+#define K_16_HI		0x3743f7bd	/* e = 192, one remainder on */
+#define K_16_LO		0x3171d430	/* e = 128 */
+
+struct crc32c_neon_key {
+	uint8x8_t hi[4];
+	uint8x8_t lo[4];
+};
+
+static inline void crc32c_neon_key_init(struct crc32c_neon_key *k,
+					uint32_t hi, uint32_t lo)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		k->hi[i] = vdup_n_u8(hi >> (8 * i));
+		k->lo[i] = vdup_n_u8(lo >> (8 * i));
+	}
+}
+
+/*
+ * Product of the eight bytes of a and the constant byte kb, optionally
+ * shifted left by j bytes. Each 16-bit lane of vmull.p8 belongs at the
+ * bit offset of its a byte, so the low and high product bytes are
+ * separated with vuzp and realigned on byte boundaries.
+ */
+#define PMULL_BYTE(t, a, kb) do {					\
+	uint8x16_t __p = vreinterpretq_u8_p16(				\
+		vmull_p8(vreinterpret_p8_u8(a), vreinterpret_p8_u8(kb)));\
+	uint8x8x2_t __u = vuzp_u8(vget_low_u8(__p), vget_high_u8(__p));\
+	t = veorq_u8(vcombine_u8(__u.val[0], z),			\
+		     vextq_u8(zq, vcombine_u8(__u.val[1], z), 15));	\
+} while (0)
+
+#define PMULL_BYTE_SHIFTED(r, a, kb, j) do {				\
+	uint8x16_t __s;							\
+	PMULL_BYTE(__s, a, kb);						\
+	r = veorq_u8(r, vextq_u8(zq, __s, 16 - (j)));			\
+} while (0)
+
+/* Returns x moved on by the distance of k, to be xored into the data */
+static inline uint8x16_t crc32c_neon_fold128(uint8x16_t x,
+					     const struct crc32c_neon_key *k)
+{
+	const uint8x8_t z = vdup_n_u8(0);
+	const uint8x16_t zq = vdupq_n_u8(0);
+	uint8x8_t xl = vget_low_u8(x), xh = vget_high_u8(x);
+	uint8x16_t r, t;
+
+	/* The low half holds the high order coefficients */
+	PMULL_BYTE(r, xl, k->hi[0]);
+	PMULL_BYTE(t, xh, k->lo[0]);
+	r = veorq_u8(r, t);
+	PMULL_BYTE_SHIFTED(r, xl, k->hi[1], 1);
+	PMULL_BYTE_SHIFTED(r, xh, k->lo[1], 1);
+	PMULL_BYTE_SHIFTED(r, xl, k->hi[2], 2);
+	PMULL_BYTE_SHIFTED(r, xh, k->lo[2], 2);
+	PMULL_BYTE_SHIFTED(r, xl, k->hi[3], 3);
+	PMULL_BYTE_SHIFTED(r, xh, k->lo[3], 3);
+
+	/* The constants sit in the upper half of a reflected 64-bit operand */
+	return vextq_u8(zq, r, 12);
+}
+
+/*
+ * Folds blocks of 16 bytes, at least four, at src onto the crc and stores
+ * the 16 byte remainder to out.
+ */
+void crc32c_neon_fold(uint8_t out[16], uint32_t crc, const uint8_t *src,
+		      unsigned int blocks)
+{
+	struct crc32c_neon_key k64, k16;
+	uint8x16_t x0, x1, x2, x3;
+	const uint8_t c[16] = { crc, crc >> 8, crc >> 16, crc >> 24 };
+
+	crc32c_neon_key_init(&k64, K_64_HI, K_64_LO);
+	crc32c_neon_key_init(&k16, K_16_HI, K_16_LO);
+
+	x0 = veorq_u8(vld1q_u8(src), vld1q_u8(c));
+	x1 = vld1q_u8(src + 16);
+	x2 = vld1q_u8(src + 32);
+	x3 = vld1q_u8(src + 48);
+	src += 64;
+	blocks -= 4;
+
+	while (blocks >= 4) {
+		x0 = veorq_u8(crc32c_neon_fold128(x0, &k64), vld1q_u8(src));
+		x1 = veorq_u8(crc32c_neon_fold128(x1, &k64),
+			      vld1q_u8(src + 16));
+		x2 = veorq_u8(crc32c_neon_fold128(x2, &k64),
+			      vld1q_u8(src + 32));
+		x3 = veorq_u8(crc32c_neon_fold128(x3, &k64),
+			      vld1q_u8(src + 48));
+		src += 64;
+		blocks -= 4;
+	}
+
+	x1 = veorq_u8(crc32c_neon_fold128(x0, &k16), x1);
+	x2 = veorq_u8(crc32c_neon_fold128(x1, &k16), x2);
+	x3 = veorq_u8(crc32c_neon_fold128(x2, &k16), x3);
+
+	while (blocks--) {
+		x3 = veorq_u8(crc32c_neon_fold128(x3, &k16), vld1q_u8(src));
+		src += 16;
+	}
+
+	vst1q_u8(out, x3);
+}
@@ -0,0 +1,221 @@
+/*
+ * CRC32C using ARMv7 NEON instructions
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ * ext4, btrfs and libcrc32c get their crc32c through the crypto API, so
+ * registering with a higher priority than crc32c-generic is all it takes
+ * to speed them up. Large buffers are folded with NEON, see
+ * crc32c-neon-core.c, everything else and the final reduction goes to the
+ * slice-by-8 __crc32c_le(). Whether folding pays off depends on the core
+ * and the memory system, so the two are compared when the module loads and
+ * nothing is registered if NEON is not the faster one, just as the xor and
+ * RAID-6 code pick their implementation.
+ */
+
+#include <crypto/internal/hash.h>
+#include <linux/crc32.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+#define CHKSUM_BLOCK_SIZE	1
+#define CHKSUM_DIGEST_SIZE	4
+
+/* Four blocks of 16 bytes are folded in parallel */
+#define CRC32C_NEON_MIN		256
+#define CRC32C_NEON_ALIGN	16
+
+#define CRC32C_CALIB_SIZE	4096
+#define CRC32C_CALIB_LOOPS	256
+
+void crc32c_neon_fold(u8 out[16], u32 crc, const u8 *src,
+		      unsigned int blocks);
+
+static u32 crc32c_neon(u32 crc, const u8 *data, unsigned int len)
+{
+	unsigned int blocks;
+	u8 rem[16];
+
+	if (len < CRC32C_NEON_MIN || !may_use_simd())
+		return __crc32c_le(crc, data, len);
+
+	blocks = len / CRC32C_NEON_ALIGN;
+
+	kernel_neon_begin();
+	crc32c_neon_fold(rem, crc, data, blocks);
+	kernel_neon_end();
+
+	/* The remainder stands in for everything folded so far */
+	crc = __crc32c_le(0, rem, sizeof(rem));
+
+	return __crc32c_le(crc, data + blocks * CRC32C_NEON_ALIGN,
+			   len % CRC32C_NEON_ALIGN);
+}
+
+/*
+ * Setting the seed allows arbitrary accumulators and flexible XOR policy
+ * If your algorithm starts with ~0, then XOR with ~0 before you set
+ * the seed.
+ */
+static int crc32c_neon_setkey(struct crypto_shash *hash, const u8 *key,
+			      unsigned int keylen)
+{
+	u32 *mctx = crypto_shash_ctx(hash);
+
+	if (keylen != sizeof(u32)) {
+		crypto_shash_set_flags(hash, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	*mctx = le32_to_cpup((__le32 *)key);
+	return 0;
+}
+
+static int crc32c_neon_init(struct shash_desc *desc)
+{
+	u32 *mctx = crypto_shash_ctx(desc->tfm);
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*crcp = *mctx;
+
+	return 0;
+}
+
+static int crc32c_neon_update(struct shash_desc *desc, const u8 *data,
+			      unsigned int len)
+{
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*crcp = crc32c_neon(*crcp, data, len);
+	return 0;
+}
+
+static int __crc32c_neon_finup(u32 *crcp, const u8 *data, unsigned int len,
+			       u8 *out)
+{
+	*(__le32 *)out = ~cpu_to_le32(crc32c_neon(*crcp, data, len));
+	return 0;
+}
+
+static int crc32c_neon_finup(struct shash_desc *desc, const u8 *data,
+			     unsigned int len, u8 *out)
+{
+	return __crc32c_neon_finup(shash_desc_ctx(desc), data, len, out);
+}
+
+static int crc32c_neon_final(struct shash_desc *desc, u8 *out)
+{
+	u32 *crcp = shash_desc_ctx(desc);
+
+	*(__le32 *)out = ~cpu_to_le32p(crcp);
+	return 0;
+}
+
+static int crc32c_neon_digest(struct shash_desc *desc, const u8 *data,
+			      unsigned int len, u8 *out)
+{
+	return __crc32c_neon_finup(crypto_shash_ctx(desc->tfm), data, len,
+				   out);
+}
+
+static int crc32c_neon_cra_init(struct crypto_tfm *tfm)
+{
+	u32 *key = crypto_tfm_ctx(tfm);
+
+	*key = ~0;
+
+	return 0;
+}
+
+static struct shash_alg alg = {
+	.setkey			=	crc32c_neon_setkey,
+	.init			=	crc32c_neon_init,
+	.update			=	crc32c_neon_update,
+	.final			=	crc32c_neon_final,
+	.finup			=	crc32c_neon_finup,
+	.digest			=	crc32c_neon_digest,
+	.descsize		=	sizeof(u32),
+	.digestsize		=	CHKSUM_DIGEST_SIZE,
+	.base			=	{
+		.cra_name		=	"crc32c",
+		.cra_driver_name	=	"crc32c-neon",
+		.cra_priority		=	200,
+		.cra_blocksize		=	CHKSUM_BLOCK_SIZE,
+		.cra_ctxsize		=	sizeof(u32),
+		.cra_module		=	THIS_MODULE,
+		.cra_init		=	crc32c_neon_cra_init,
+	}
+};
+
+/* Returns the time in ns crc takes for CRC32C_CALIB_LOOPS passes over buf */
+static s64 __init crc32c_neon_time(u32 (*crc)(u32, const u8 *, unsigned int),
+				   const u8 *buf, u32 *res)
+{
+	ktime_t start;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < CRC32C_CALIB_LOOPS; i++)
+		*res = crc(*res, buf, CRC32C_CALIB_SIZE);
+
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static u32 __init crc32c_table(u32 crc, const u8 *data, unsigned int len)
+{
+	return __crc32c_le(crc, data, len);
+}
+
+static int __init crc32c_neon_mod_init(void)
+{
+	u32 crc_table = ~0, crc_neon = ~0;
+	s64 ns_table, ns_neon;
+	u8 *buf;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	buf = kmalloc(CRC32C_CALIB_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	memset(buf, 0x5a, CRC32C_CALIB_SIZE);
+	/* Warm up the tables and the cache */
+	crc32c_table(0, buf, CRC32C_CALIB_SIZE);
+	ns_table = crc32c_neon_time(crc32c_table, buf, &crc_table);
+	ns_neon = crc32c_neon_time(crc32c_neon, buf, &crc_neon);
+	kfree(buf);
+
+	if (crc_neon != crc_table) {
+		pr_err("crc32c-neon: self test failed\n");
+		return -EINVAL;
+	}
+
+	pr_info("crc32c-neon: %lld ns versus %lld ns for the tables\n",
+		ns_neon, ns_table);
+	if (ns_neon >= ns_table)
+		return -ENODEV;
+
+	return crypto_register_shash(&alg);
+}
+
+static void __exit crc32c_neon_mod_fini(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+module_init(crc32c_neon_mod_init);
+module_exit(crc32c_neon_mod_fini);
+
+MODULE_DESCRIPTION("CRC32c (Castagnoli) calculation using ARMv7 NEON");
+MODULE_LICENSE("GPL v2");
+MODULE_ALIAS("crc32c");
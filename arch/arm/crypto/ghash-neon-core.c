@@ -0,0 +1,120 @@
+/*
+ * GHASH block function using NEON intrinsics
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ * ARMv7 NEON has no 64x64 bit carry-less multiply, only the eight way
+ * 8x8 bit vmull.p8. A 64x64 bit product is put together out of fifteen of
+ * those: one multiplying the bytes of both operands pairwise, then one per
+ * distance k between byte positions in either direction, each shifted
+ * into place by k bytes. Three such products make up the 128x128 bit one
+ * (Karatsuba), which is then reduced with the shift and xor sequence from
+ * Intel's carry-less multiplication white paper, so that neither the GHASH
+ * key nor the data need to carry more than a byte swap.
+ */
+
+#include <arm_neon.h>
+
+#ifndef __ARM_NEON__
+#error You should compile this file with '-mfloat-abi=softfp -mfpu=neon'
+#endif
+
+void ghash_update_neon(unsigned int blocks, uint64_t dg[2],
+		       const uint8_t *src, const uint64_t key[2]);
+
+#define PMULL8(a, b)	vreinterpretq_u8_p16(vmull_p8(vreinterpret_p8_u8(a), \
+						      vreinterpret_p8_u8(b)))
+
+#define PMULL_DIST(k) do {						\
+	t = veorq_u8(PMULL8(a, vext_u8(b, z, k)),			\
+		     PMULL8(vext_u8(a, z, k), b));			\
+	r = veorq_u8(r, vextq_u8(zq, t, 16 - (k)));			\
+} while (0)
+
+/* 64x64 -> 128 bit carry-less multiplication */
+static inline uint64x2_t ghash_pmull64(uint8x8_t a, uint8x8_t b)
+{
+	const uint8x8_t z = vdup_n_u8(0);
+	const uint8x16_t zq = vdupq_n_u8(0);
+	uint8x16_t r, t;
+
+	r = PMULL8(a, b);
+	PMULL_DIST(1);
+	PMULL_DIST(2);
+	PMULL_DIST(3);
+	PMULL_DIST(4);
+	PMULL_DIST(5);
+	PMULL_DIST(6);
+	PMULL_DIST(7);
+
+	return vreinterpretq_u64_u8(r);
+}
+
+#define SHL128(hi, lo, n) \
+	vorr_u64(vshl_n_u64(hi, n), vshr_n_u64(lo, 64 - (n)))
+#define SHR128(hi, lo, n) \
+	vorr_u64(vshr_n_u64(lo, n), vshl_n_u64(hi, 64 - (n)))
+
+/* Returns x * h in GF(2^128), both in byte swapped GHASH representation */
+static inline uint64x2_t ghash_gfmul(uint64x2_t x, uint64x2_t h,
+				     uint8x8_t hm)
+{
+	uint8x8_t x0 = vreinterpret_u8_u64(vget_low_u64(x));
+	uint8x8_t x1 = vreinterpret_u8_u64(vget_high_u64(x));
+	uint64x2_t lo, hi, mid;
+	uint64x1_t p0, p1, p2, p3, d, r0, r1;
+
+	lo = ghash_pmull64(x0, vreinterpret_u8_u64(vget_low_u64(h)));
+	hi = ghash_pmull64(x1, vreinterpret_u8_u64(vget_high_u64(h)));
+	mid = ghash_pmull64(veor_u8(x0, x1), hm);
+	mid = veorq_u64(mid, veorq_u64(lo, hi));
+
+	p0 = vget_low_u64(lo);
+	p1 = veor_u64(vget_high_u64(lo), vget_low_u64(mid));
+	p2 = veor_u64(vget_low_u64(hi), vget_high_u64(mid));
+	p3 = vget_high_u64(hi);
+
+	/* The operands are bit reflected, so is the 255 bit product */
+	p3 = SHL128(p3, p2, 1);
+	p2 = SHL128(p2, p1, 1);
+	p1 = SHL128(p1, p0, 1);
+	p0 = vshl_n_u64(p0, 1);
+
+	/* Reduce p3:p2:p1:p0 modulo x^128 + x^7 + x^2 + x + 1 */
+	d = veor_u64(p1, veor_u64(vshl_n_u64(p0, 63),
+				  veor_u64(vshl_n_u64(p0, 62),
+					   vshl_n_u64(p0, 57))));
+	r0 = veor_u64(p0, veor_u64(SHR128(d, p0, 1),
+				   veor_u64(SHR128(d, p0, 2),
+					    SHR128(d, p0, 7))));
+	r1 = veor_u64(d, veor_u64(vshr_n_u64(d, 1),
+				  veor_u64(vshr_n_u64(d, 2),
+					   vshr_n_u64(d, 7))));
+
+	return vcombine_u64(veor_u64(p2, r0), veor_u64(p3, r1));
+}
+
+/*
+ * dg[] and key[] hold the big endian values of the second and the first
+ * eight bytes of the digest and the key respectively.
+ */
+void ghash_update_neon(unsigned int blocks, uint64_t dg[2],
+		       const uint8_t *src, const uint64_t key[2])
+{
+	uint64x2_t x = vld1q_u64(dg), h = vld1q_u64(key), in;
+	uint8x8_t hm = veor_u8(vreinterpret_u8_u64(vget_low_u64(h)),
+			       vreinterpret_u8_u64(vget_high_u64(h)));
+
+	while (blocks--) {
+		in = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(src)));
+		in = vcombine_u64(vget_high_u64(in), vget_low_u64(in));
+		x = ghash_gfmul(veorq_u64(x, in), h, hm);
+		src += 16;
+	}
+
+	vst1q_u64(dg, x);
+}
@@ -0,0 +1,200 @@
+/*
+ * GHASH secure hash using ARMv7 NEON instructions
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * Based on the ARMv8 PMULL glue code:
+ *   Copyright (C) 2014 Linaro Ltd. <ard.biesheuvel@linaro.org>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ * Registering as "ghash" with a higher priority than ghash-generic makes
+ * the gcm template pick this implementation up by itself, so together with
+ * the bit sliced ctr(aes) from aesbs-glue.c both halves of gcm(aes) and
+ * rfc4106(gcm(aes)) run on NEON.
+ */
+
+#include <asm/neon.h>
+#include <asm/simd.h>
+#include <asm/unaligned.h>
+#include <crypto/gf128mul.h>
+#include <crypto/internal/hash.h>
+#include <linux/crypto.h>
+#include <linux/module.h>
+
+MODULE_DESCRIPTION("GHASH secure hash using ARMv7 NEON instructions");
+MODULE_LICENSE("GPL v2");
+
+#define GHASH_BLOCK_SIZE	16
+#define GHASH_DIGEST_SIZE	16
+
+struct ghash_key {
+	u64 h[2];
+	/* for the contexts kernel mode NEON cannot be used in */
+	struct gf128mul_4k *table;
+};
+
+struct ghash_desc_ctx {
+	u64 digest[GHASH_DIGEST_SIZE/sizeof(u64)];
+	u8 buf[GHASH_BLOCK_SIZE];
+	u32 count;
+};
+
+void ghash_update_neon(unsigned int blocks, u64 dg[], const u8 *src,
+		       const u64 key[]);
+
+static void ghash_update_generic(unsigned int blocks, u64 dg[],
+				 const u8 *src, struct ghash_key *key)
+{
+	be128 x = { cpu_to_be64(dg[1]), cpu_to_be64(dg[0]) };
+
+	while (blocks--) {
+		be128_xor(&x, &x, (const be128 *)src);
+		gf128mul_4k_lle(&x, key->table);
+		src += GHASH_BLOCK_SIZE;
+	}
+
+	dg[1] = be64_to_cpu(x.a);
+	dg[0] = be64_to_cpu(x.b);
+}
+
+static void ghash_do_update(unsigned int blocks, u64 dg[], const u8 *src,
+			    struct ghash_key *key)
+{
+	if (!may_use_simd()) {
+		ghash_update_generic(blocks, dg, src, key);
+	} else {
+		kernel_neon_begin();
+		ghash_update_neon(blocks, dg, src, key->h);
+		kernel_neon_end();
+	}
+}
+
+static int ghash_init(struct shash_desc *desc)
+{
+	struct ghash_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*ctx = (struct ghash_desc_ctx){};
+	return 0;
+}
+
+static int ghash_update(struct shash_desc *desc, const u8 *src,
+			unsigned int len)
+{
+	struct ghash_desc_ctx *ctx = shash_desc_ctx(desc);
+	unsigned int partial = ctx->count % GHASH_BLOCK_SIZE;
+
+	ctx->count += len;
+
+	if ((partial + len) >= GHASH_BLOCK_SIZE) {
+		struct ghash_key *key = crypto_shash_ctx(desc->tfm);
+		unsigned int blocks;
+
+		if (partial) {
+			int p = GHASH_BLOCK_SIZE - partial;
+
+			memcpy(ctx->buf + partial, src, p);
+			src += p;
+			len -= p;
+			ghash_do_update(1, ctx->digest, ctx->buf, key);
+		}
+
+		blocks = len / GHASH_BLOCK_SIZE;
+		len %= GHASH_BLOCK_SIZE;
+
+		if (blocks)
+			ghash_do_update(blocks, ctx->digest, src, key);
+		src += blocks * GHASH_BLOCK_SIZE;
+		partial = 0;
+	}
+	if (len)
+		memcpy(ctx->buf + partial, src, len);
+	return 0;
+}
+
+static int ghash_final(struct shash_desc *desc, u8 *dst)
+{
+	struct ghash_desc_ctx *ctx = shash_desc_ctx(desc);
+	unsigned int partial = ctx->count % GHASH_BLOCK_SIZE;
+
+	if (partial) {
+		struct ghash_key *key = crypto_shash_ctx(desc->tfm);
+
+		memset(ctx->buf + partial, 0, GHASH_BLOCK_SIZE - partial);
+		ghash_do_update(1, ctx->digest, ctx->buf, key);
+	}
+	put_unaligned_be64(ctx->digest[1], dst);
+	put_unaligned_be64(ctx->digest[0], dst + 8);
+
+	*ctx = (struct ghash_desc_ctx){};
+	return 0;
+}
+
+static int ghash_setkey(struct crypto_shash *tfm,
+			const u8 *inkey, unsigned int keylen)
+{
+	struct ghash_key *key = crypto_shash_ctx(tfm);
+
+	if (keylen != GHASH_BLOCK_SIZE) {
+		crypto_shash_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+
+	if (key->table)
+		gf128mul_free_4k(key->table);
+	key->table = gf128mul_init_4k_lle((const be128 *)inkey);
+	if (!key->table)
+		return -ENOMEM;
+
+	key->h[1] = get_unaligned_be64(inkey);
+	key->h[0] = get_unaligned_be64(inkey + 8);
+
+	return 0;
+}
+
+static void ghash_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct ghash_key *key = crypto_tfm_ctx(tfm);
+
+	if (key->table)
+		gf128mul_free_4k(key->table);
+}
+
+static struct shash_alg ghash_alg = {
+	.digestsize	= GHASH_DIGEST_SIZE,
+	.init		= ghash_init,
+	.update		= ghash_update,
+	.final		= ghash_final,
+	.setkey		= ghash_setkey,
+	.descsize	= sizeof(struct ghash_desc_ctx),
+	.base		= {
+		.cra_name		= "ghash",
+		.cra_driver_name	= "ghash-neon",
+		.cra_priority		= 150,
+		.cra_flags		= CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize		= GHASH_BLOCK_SIZE,
+		.cra_ctxsize		= sizeof(struct ghash_key),
+		.cra_module		= THIS_MODULE,
+		.cra_exit		= ghash_exit_tfm,
+	},
+};
+
+static int __init ghash_neon_mod_init(void)
+{
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	return crypto_register_shash(&ghash_alg);
+}
+
+static void __exit ghash_neon_mod_exit(void)
+{
+	crypto_unregister_shash(&ghash_alg);
+}
+
+module_init(ghash_neon_mod_init);
+module_exit(ghash_neon_mod_exit);
+
+MODULE_ALIAS("ghash");
@@ -0,0 +1,144 @@
+/*
+ * SHA-256 block transform using NEON intrinsics
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ * The SHA-256 rounds are a serial chain of 32-bit operations that the
+ * integer pipeline handles best, but the message schedule is not: four
+ * schedule words depend on older words only, so they are computed together
+ * in NEON registers, with the round constants added in, while the integer
+ * pipeline works through the rounds of the previous words.
+ */
+
+#include <arm_neon.h>
+
+#ifndef __ARM_NEON__
+#error You should compile this file with '-mfloat-abi=softfp -mfpu=neon'
+#endif
+
+void sha256_transform_neon(uint32_t *digest, const uint8_t *data,
+			   unsigned int num_blks);
+
+static const uint32_t sha256_k[64] __attribute__((aligned(16))) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+#define Ch(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define Maj(x, y, z)	(((x) & (y)) | ((z) & ((x) | (y))))
+#define e0(x)		(ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define e1(x)		(ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+
+#define VROR(x, n)	vsliq_n_u32(vshrq_n_u32(x, n), x, 32 - (n))
+#define VS0(x)		veorq_u32(veorq_u32(VROR(x, 7), VROR(x, 18)), \
+				  vshrq_n_u32(x, 3))
+#define DROR(x, n)	vsli_n_u32(vshr_n_u32(x, n), x, 32 - (n))
+#define DS1(x)		veor_u32(veor_u32(DROR(x, 17), DROR(x, 19)), \
+				 vshr_n_u32(x, 10))
+
+/* Returns W[t..t+3] given W[t-16..t-1] in x0..x3 */
+static inline uint32x4_t sha256_schedule(uint32x4_t x0, uint32x4_t x1,
+					 uint32x4_t x2, uint32x4_t x3)
+{
+	uint32x4_t t;
+	uint32x2_t lo, hi;
+
+	/* W[t-16] + s0(W[t-15]) + W[t-7] for all four words */
+	t = vaddq_u32(x0, VS0(vextq_u32(x0, x1, 1)));
+	t = vaddq_u32(t, vextq_u32(x2, x3, 1));
+
+	/* s1(W[t-2]) of the upper two words depends on the lower two */
+	lo = vadd_u32(vget_low_u32(t), DS1(vget_high_u32(x3)));
+	hi = vadd_u32(vget_high_u32(t), DS1(lo));
+
+	return vcombine_u32(lo, hi);
+}
+
+#define ROUND(i) do {							\
+	t1 = h + e1(e) + Ch(e, f, g) + wk[i];				\
+	t2 = e0(a) + Maj(a, b, c);					\
+	h = g; g = f; f = e; e = d + t1;				\
+	d = c; c = b; b = a; a = t1 + t2;				\
+} while (0)
+
+void sha256_transform_neon(uint32_t *digest, const uint8_t *data,
+			   unsigned int num_blks)
+{
+	uint32_t wk[64] __attribute__((aligned(16)));
+	uint32_t a, b, c, d, e, f, g, h, t1, t2;
+	uint32x4_t w0, w1, w2, w3, n;
+	int i;
+
+	while (num_blks--) {
+		w0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+		w1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+		w2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+		w3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+		vst1q_u32(wk, vaddq_u32(w0, vld1q_u32(sha256_k)));
+		vst1q_u32(wk + 4, vaddq_u32(w1, vld1q_u32(sha256_k + 4)));
+		vst1q_u32(wk + 8, vaddq_u32(w2, vld1q_u32(sha256_k + 8)));
+		vst1q_u32(wk + 12, vaddq_u32(w3, vld1q_u32(sha256_k + 12)));
+
+		a = digest[0];
+		b = digest[1];
+		c = digest[2];
+		d = digest[3];
+		e = digest[4];
+		f = digest[5];
+		g = digest[6];
+		h = digest[7];
+
+		for (i = 0; i < 64; i += 4) {
+			/* Schedule four rounds ahead of the ones below */
+			if (i < 48) {
+				n = sha256_schedule(w0, w1, w2, w3);
+				w0 = w1;
+				w1 = w2;
+				w2 = w3;
+				w3 = n;
+				vst1q_u32(wk + i + 16,
+					  vaddq_u32(n, vld1q_u32(sha256_k +
+								 i + 16)));
+			}
+
+			ROUND(i);
+			ROUND(i + 1);
+			ROUND(i + 2);
+			ROUND(i + 3);
+		}
+
+		digest[0] += a;
+		digest[1] += b;
+		digest[2] += c;
+		digest[3] += d;
+		digest[4] += e;
+		digest[5] += f;
+		digest[6] += g;
+		digest[7] += h;
+
+		data += 64;
+	}
+
+	/* Do not leave the message schedule on the stack */
+	__builtin_memset(wk, 0, sizeof(wk));
+	__asm__ __volatile__("" : : "r" (wk) : "memory");
+}
@@ -157,6 +157,14 @@ static inline int l2x0_of_init(u32 aux_val, u32 aux_mask)
 }
 #endif
 
+#ifdef CONFIG_CACHE_L2X0_PMU
+extern void l2x0_pmu_register(void __iomem *base, u32 cache_id);
+#else
+static inline void l2x0_pmu_register(void __iomem *base, u32 cache_id)
+{
+}
+#endif
+
 struct l2x0_regs {
 	unsigned long phy_base;
 	unsigned long aux_ctrl;
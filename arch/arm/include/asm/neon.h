@@ -8,6 +8,7 @@
  * published by the Free Software Foundation.
  */
 
+#include <linux/types.h>
 #include <asm/hwcap.h>
 
 #define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
@@ -34,3 +35,30 @@
 void kernel_neon_begin(void);
 #endif
 void kernel_neon_end(void);
+bool kernel_neon_usable(void);
+
+#ifdef CONFIG_KERNEL_MODE_NEON
+/*
+ * memcpy() and copy_page() switch to the NEON versions from
+ * arm_neon_copy_threshold bytes on, see arch/arm/lib/copy-neon.c.
+ */
+extern unsigned long arm_neon_copy_threshold;
+
+void *__memcpy_arm(void *dest, const void *src, size_t n);
+void *__memcpy_neon(void *dest, const void *src, size_t n);
+void __copy_page_arm(void *to, const void *from);
+void __copy_page_neon(void *to, const void *from);
+
+/*
+ * Likewise csum_partial() and csum_partial_copy_nocheck() from
+ * arm_neon_csum_threshold bytes on, see arch/arm/lib/csum-neon.c.
+ */
+extern unsigned long arm_neon_csum_threshold;
+
+__wsum __csum_partial_arm(const void *buff, int len, __wsum sum);
+__wsum __csum_partial_neon(const void *buff, int len, __wsum sum);
+__wsum __csum_partial_copy_arm(const void *src, void *dst, int len,
+			       __wsum sum);
+__wsum __csum_partial_copy_neon(const void *src, void *dst, int len,
+				__wsum sum);
+#endif
@@ -0,0 +1,6 @@
+#ifndef __ASM_QRWLOCK_H
+#define __ASM_QRWLOCK_H
+
+#include <asm-generic/qrwlock.h>
+
+#endif /* __ASM_QRWLOCK_H */
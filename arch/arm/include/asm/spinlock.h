@@ -130,6 +130,13 @@ static inline int arch_spin_is_contended(arch_spinlock_t *lock)
 }
 #define arch_spin_is_contended	arch_spin_is_contended
 
+#ifdef CONFIG_QUEUE_RWLOCK
+/*
+ * The queued rwlock keeps readers from starving writers: once a writer
+ * waits, new readers queue behind it on the ticket lock.
+ */
+#include <asm/qrwlock.h>
+#else
 /*
  * RWLOCKS
  *
@@ -276,6 +283,7 @@ static inline int arch_read_trylock(arch_rwlock_t *rw)
 
 /* read_can_lock - would read_trylock() succeed? */
 #define arch_read_can_lock(x)		(ACCESS_ONCE((x)->lock) < 0x80000000)
+#endif /* CONFIG_QUEUE_RWLOCK */
 
 #define arch_read_lock_flags(lock, flags) arch_read_lock(lock)
 #define arch_write_lock_flags(lock, flags) arch_write_lock(lock)
@@ -209,6 +209,14 @@ static struct xor_block_template xor_block_neon = {
 
 #define NEON_TEMPLATES	\
 	do { if (cpu_has_neon()) xor_speed(&xor_block_neon); } while (0)
+
+/*
+ * Use NEON whenever the cpu has it. The calibration xors buffers that are
+ * hot in the cache, where the integer versions come close, while raid5
+ * mostly works on data that is not.
+ */
+#define XOR_SELECT_TEMPLATE(FASTEST) \
+	(cpu_has_neon() ? &xor_block_neon : FASTEST)
 #else
 #define NEON_TEMPLATES
 #endif
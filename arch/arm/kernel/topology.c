@@ -275,6 +275,97 @@ void store_cpu_topology(unsigned int cpuid)
 		cpu_topology[cpuid].socket_id, mpidr);
 }
 
+#ifdef CONFIG_OF
+static struct sched_energy **cpu_energy;
+
+/*
+ * The energy model of a cpu is given by the node its sched-energy-costs
+ * property points at, cpus of the same type share the node:
+ *
+ *	cpu@0 {
+ *		...
+ *		sched-energy-costs = <&cpu_cost_a7>;
+ *	};
+ *
+ *	cpu_cost_a7: core-cost-a7 {
+ *		busy-cost-data = <
+ *			358 187
+ *			...
+ *			606 368
+ *		>;
+ *	};
+ *
+ * Each pair is the capacity and the busy power of one operating point.
+ * Capacities must increase, and are rescaled by the scheduler so that the
+ * last one matches the capacity of the cpu.
+ */
+static struct sched_energy * __init parse_cpu_energy(struct device_node *cn)
+{
+	struct device_node *np;
+	struct sched_energy *se = NULL;
+	const __be32 *val;
+	int len, i;
+
+	np = of_parse_phandle(cn, "sched-energy-costs", 0);
+	if (!np)
+		return NULL;
+
+	val = of_get_property(np, "busy-cost-data", &len);
+	len /= 2 * sizeof(u32);
+	if (!val || !len) {
+		pr_err("%s: invalid busy-cost-data\n", np->full_name);
+		goto out;
+	}
+
+	se = kzalloc(sizeof(*se) + len * sizeof(*se->cap_states), GFP_NOWAIT);
+	if (!se)
+		goto out;
+
+	se->nr_cap_states = len;
+	se->cap_states = (struct sched_capacity_state *)(se + 1);
+	for (i = 0; i < len; i++) {
+		se->cap_states[i].cap = be32_to_cpup(val++);
+		se->cap_states[i].power = be32_to_cpup(val++);
+
+		if (!se->cap_states[i].cap ||
+		    (i && se->cap_states[i].cap <= se->cap_states[i - 1].cap)) {
+			pr_err("%s: capacities must increase\n", np->full_name);
+			kfree(se);
+			se = NULL;
+			break;
+		}
+	}
+out:
+	of_node_put(np);
+	return se;
+}
+
+static void __init parse_dt_energy(void)
+{
+	struct device_node *cn;
+	int cpu;
+
+	cpu_energy = kcalloc(nr_cpu_ids, sizeof(*cpu_energy), GFP_NOWAIT);
+	if (!cpu_energy)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		cn = of_get_cpu_node(cpu, NULL);
+		if (!cn)
+			continue;
+		cpu_energy[cpu] = parse_cpu_energy(cn);
+		of_node_put(cn);
+	}
+}
+
+const struct sched_energy *arch_sched_energy(int cpu)
+{
+	return cpu_energy ? cpu_energy[cpu] : NULL;
+}
+#else
+static inline void parse_dt_energy(void) {}
+#endif
+
 static inline int cpu_corepower_flags(void)
 {
 	return SD_SHARE_PKG_RESOURCES  | SD_SHARE_POWERDOMAIN;
@@ -312,6 +403,7 @@ void __init init_cpu_topology(void)
 	smp_wmb();
 
 	parse_dt_topology();
+	parse_dt_energy();
 
 	/* Set scheduler topology descriptor */
 	set_sched_topology(arm_topology);
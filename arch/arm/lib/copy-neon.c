@@ -0,0 +1,97 @@
+/*
+ *  linux/arch/arm/lib/copy-neon.c
+ *
+ *  Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NEON versions of memcpy() and copy_page(). The integer LDM/STM loops
+ * stay well below the memory bandwidth of a Cortex-A9 for large copies,
+ * while 64 byte NEON loads and stores nearly reach it. Saving the VFP
+ * state in kernel_neon_begin() has a fixed cost though, so the NEON
+ * versions are only used from arm_neon_copy_threshold bytes on, which
+ * "neon_copy_threshold=" sets and 0 disables. Copies that cannot use
+ * NEON, interrupt context and NEON users calling memcpy(), fall back
+ * to the integer versions.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/sizes.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#define NEON_COPY_BLOCK		64
+#define NEON_COPY_ALIGN		16
+#define NEON_COPY_MIN		(2 * NEON_COPY_BLOCK)
+
+void __neon_copy_blocks(void *dest, const void *src, size_t n);
+
+/* Until NEON is known to be there, nothing is large enough */
+unsigned long arm_neon_copy_threshold = ULONG_MAX;
+
+static unsigned long neon_copy_threshold = SZ_1K;
+
+static int __init neon_copy_threshold_setup(char *str)
+{
+	return kstrtoul(str, 0, &neon_copy_threshold);
+}
+early_param("neon_copy_threshold", neon_copy_threshold_setup);
+
+void *__memcpy_neon(void *dest, const void *src, size_t n)
+{
+	size_t head, blocks;
+
+	if (n < NEON_COPY_MIN || !kernel_neon_usable())
+		return __memcpy_arm(dest, src, n);
+
+	head = -(unsigned long)dest & (NEON_COPY_ALIGN - 1);
+	if (head)
+		__memcpy_arm(dest, src, head);
+
+	blocks = (n - head) & ~(NEON_COPY_BLOCK - 1);
+	kernel_neon_begin();
+	__neon_copy_blocks(dest + head, src + head, blocks);
+	kernel_neon_end();
+
+	if (n - head - blocks)
+		__memcpy_arm(dest + head + blocks, src + head + blocks,
+			     n - head - blocks);
+
+	return dest;
+}
+EXPORT_SYMBOL_GPL(__memcpy_neon);
+
+void __copy_page_neon(void *to, const void *from)
+{
+	if (!kernel_neon_usable()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__neon_copy_blocks(to, from, PAGE_SIZE);
+	kernel_neon_end();
+}
+EXPORT_SYMBOL_GPL(__copy_page_neon);
+
+/* For the comparison in test_neon_copy */
+EXPORT_SYMBOL_GPL(__memcpy_arm);
+EXPORT_SYMBOL_GPL(__copy_page_arm);
+
+/* vfp_init() has set HWCAP_NEON by now */
+static int __init neon_copy_init(void)
+{
+	if (!cpu_has_neon() || !neon_copy_threshold)
+		return 0;
+
+	arm_neon_copy_threshold = max_t(unsigned long, neon_copy_threshold,
+					NEON_COPY_MIN);
+	pr_info("NEON memcpy from %lu bytes\n", arm_neon_copy_threshold);
+
+	return 0;
+}
+late_initcall(neon_copy_init);
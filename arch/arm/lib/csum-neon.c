@@ -0,0 +1,135 @@
+/*
+ *  linux/arch/arm/lib/csum-neon.c
+ *
+ *  Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NEON versions of csum_partial() and csum_partial_copy_nocheck(). The
+ * ADCS loops add one word per cycle at best, VPADAL adds four into 64-bit
+ * accumulators, which leaves the checksum of a large buffer bound by the
+ * memory bandwidth. As with memcpy(), see copy-neon.c, they are only used
+ * from arm_neon_csum_threshold bytes on, which "neon_csum_threshold=" sets
+ * and 0 disables, and fall back to the integer versions when NEON cannot
+ * be used.
+ *
+ * csum_partial_copy_from_user() keeps using the integer version, it may
+ * fault. The receive path checksums user bound data with csum_partial()
+ * before copying it, see csum_and_copy_to_user(), so that is covered.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/sizes.h>
+#include <net/checksum.h>
+#include <asm/neon.h>
+
+#define NEON_CSUM_BLOCK		64
+#define NEON_CSUM_ALIGN		16
+#define NEON_CSUM_MIN		(2 * NEON_CSUM_BLOCK)
+
+u64 __neon_csum_blocks(const void *src, size_t n);
+u64 __neon_csum_copy_blocks(const void *src, void *dst, size_t n);
+
+/* Until NEON is known to be there, nothing is large enough */
+unsigned long arm_neon_csum_threshold = ULONG_MAX;
+
+static unsigned long neon_csum_threshold = SZ_1K;
+
+static int __init neon_csum_threshold_setup(char *str)
+{
+	return kstrtoul(str, 0, &neon_csum_threshold);
+}
+early_param("neon_csum_threshold", neon_csum_threshold_setup);
+
+/* Folds the 64-bit sum of words into a 32-bit partial checksum */
+static inline __wsum neon_csum_fold64(u64 sum)
+{
+	u32 lo = sum, hi = sum >> 32;
+
+	lo += hi;
+	return (__force __wsum)(lo + (lo < hi));
+}
+
+__wsum __csum_partial_neon(const void *buff, int len, __wsum sum)
+{
+	int head, blocks;
+	u64 body;
+
+	if (len < NEON_CSUM_MIN || !kernel_neon_usable())
+		return __csum_partial_arm(buff, len, sum);
+
+	head = -(unsigned long)buff & (NEON_CSUM_ALIGN - 1);
+	if (head)
+		sum = __csum_partial_arm(buff, head, sum);
+
+	blocks = (len - head) & ~(NEON_CSUM_BLOCK - 1);
+	kernel_neon_begin();
+	body = __neon_csum_blocks(buff + head, blocks);
+	kernel_neon_end();
+
+	/* An odd head shifts the body to the other byte lane */
+	sum = csum_block_add(sum, neon_csum_fold64(body), head);
+
+	if (len - head - blocks)
+		sum = csum_block_add(sum,
+				     __csum_partial_arm(buff + head + blocks,
+							len - head - blocks, 0),
+				     head + blocks);
+
+	return sum;
+}
+EXPORT_SYMBOL_GPL(__csum_partial_neon);
+
+__wsum __csum_partial_copy_neon(const void *src, void *dst, int len,
+				__wsum sum)
+{
+	int head, blocks;
+	u64 body;
+
+	if (len < NEON_CSUM_MIN || !kernel_neon_usable())
+		return __csum_partial_copy_arm(src, dst, len, sum);
+
+	head = -(unsigned long)dst & (NEON_CSUM_ALIGN - 1);
+	if (head)
+		sum = __csum_partial_copy_arm(src, dst, head, sum);
+
+	blocks = (len - head) & ~(NEON_CSUM_BLOCK - 1);
+	kernel_neon_begin();
+	body = __neon_csum_copy_blocks(src + head, dst + head, blocks);
+	kernel_neon_end();
+
+	sum = csum_block_add(sum, neon_csum_fold64(body), head);
+
+	src += head + blocks;
+	dst += head + blocks;
+	if (len - head - blocks)
+		sum = csum_block_add(sum,
+				     __csum_partial_copy_arm(src, dst,
+						len - head - blocks, 0),
+				     head + blocks);
+
+	return sum;
+}
+EXPORT_SYMBOL_GPL(__csum_partial_copy_neon);
+
+/* For the comparison in test_neon_copy */
+EXPORT_SYMBOL_GPL(__csum_partial_arm);
+EXPORT_SYMBOL_GPL(__csum_partial_copy_arm);
+
+/* vfp_init() has set HWCAP_NEON by now */
+static int __init neon_csum_init(void)
+{
+	if (!cpu_has_neon() || !neon_csum_threshold)
+		return 0;
+
+	arm_neon_csum_threshold = max_t(unsigned long, neon_csum_threshold,
+					NEON_CSUM_MIN);
+	pr_info("NEON checksum from %lu bytes\n", arm_neon_csum_threshold);
+
+	return 0;
+}
+late_initcall(neon_csum_init);
@@ -0,0 +1,228 @@
+/*
+ * Kernel module comparing the integer and NEON memcpy(), copy_page(),
+ * csum_partial() and csum_partial_copy_nocheck().
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Loading the module prints the throughput of both versions for a range
+ * of sizes, which is what neon_copy_threshold= and neon_csum_threshold=
+ * should be chosen from. Every copy and checksum is checked as well, the
+ * module fails to load on a mismatch.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/gfp.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/random.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+#include <net/checksum.h>
+#include <asm/neon.h>
+
+#define TEST_BUF_ORDER	8	/* 1 MB with 4 kB pages */
+
+static unsigned int total_mb = 64;
+module_param(total_mb, uint, 0444);
+MODULE_PARM_DESC(total_mb, "Megabytes copied per size and version");
+
+static const size_t test_sizes[] = {
+	128, 256, 512, SZ_1K, SZ_2K, SZ_4K, SZ_16K, SZ_64K, SZ_256K, SZ_1M,
+};
+
+/* Returns the throughput in MB/s */
+static unsigned long test_rate(void *(*copy)(void *, const void *, size_t),
+			       void *dst, const void *src, size_t size)
+{
+	unsigned long loops = max_t(unsigned long,
+				    ((u64)total_mb << 20) / size, 1);
+	unsigned long i;
+	ktime_t start;
+	s64 ns;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		copy(dst, src, size);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return ns ? div64_u64((u64)loops * size * NSEC_PER_SEC, ns) >> 20 : 0;
+}
+
+static unsigned long test_page_rate(void (*copy)(void *, const void *),
+				    void *dst, const void *src)
+{
+	unsigned long loops = ((u64)total_mb << 20) / PAGE_SIZE;
+	unsigned long i;
+	ktime_t start;
+	s64 ns;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		copy(dst, src);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return ns ? div64_u64((u64)loops * PAGE_SIZE * NSEC_PER_SEC, ns) >> 20
+		  : 0;
+}
+
+static unsigned long test_csum_rate(__wsum (*csum)(const void *, int, __wsum),
+				    const void *src, size_t size)
+{
+	unsigned long loops = max_t(unsigned long,
+				    ((u64)total_mb << 20) / size, 1);
+	unsigned long i;
+	ktime_t start;
+	s64 ns;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		csum(src, size, 0);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return ns ? div64_u64((u64)loops * size * NSEC_PER_SEC, ns) >> 20 : 0;
+}
+
+static unsigned long test_csum_copy_rate(
+		__wsum (*csum_copy)(const void *, void *, int, __wsum),
+		void *dst, const void *src, size_t size)
+{
+	unsigned long loops = max_t(unsigned long,
+				    ((u64)total_mb << 20) / size, 1);
+	unsigned long i;
+	ktime_t start;
+	s64 ns;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		csum_copy(src, dst, size, 0);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return ns ? div64_u64((u64)loops * size * NSEC_PER_SEC, ns) >> 20 : 0;
+}
+
+/* The partial sums may differ, the folded ones must not */
+static int test_csum(void *dst, const void *src, size_t len)
+{
+	unsigned int i;
+
+	for (i = 0; i < 512; i++) {
+		size_t off = i % 61, size = 1 + i * 997 % (len - 64);
+		__wsum sum = (__force __wsum)(i * 0x01010101);
+		__sum16 ref;
+
+		ref = csum_fold(__csum_partial_arm(src + off, size, sum));
+		if (csum_fold(__csum_partial_neon(src + off, size,
+						  sum)) != ref) {
+			pr_err("csum_partial of %zu bytes at %zu failed\n",
+			       size, off);
+			return -EINVAL;
+		}
+
+		memset(dst, 0, len);
+		if (csum_fold(__csum_partial_copy_neon(src + off, dst + i % 7,
+						       size, sum)) != ref ||
+		    memcmp(dst + i % 7, src + off, size)) {
+			pr_err("csum_partial_copy of %zu bytes at %zu failed\n",
+			       size, off);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int __init test_neon_copy_init(void)
+{
+	size_t len = PAGE_SIZE << TEST_BUF_ORDER;
+	void *src, *dst;
+	unsigned int i;
+	int ret = 0;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	src = (void *)__get_free_pages(GFP_KERNEL, TEST_BUF_ORDER);
+	dst = (void *)__get_free_pages(GFP_KERNEL, TEST_BUF_ORDER);
+	if (!src || !dst) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	get_random_bytes(src, len);
+
+	/* Odd offsets and lengths exercise the head and tail handling */
+	for (i = 0; i < 512; i++) {
+		size_t off = i % 61, size = 1 + i * 997 % (len - 64);
+
+		memset(dst, 0, len);
+		__memcpy_neon(dst + off, src + i % 7, size);
+		if (memcmp(dst + off, src + i % 7, size) ||
+		    (off && memchr_inv(dst, 0, off)) ||
+		    memchr_inv(dst + off + size, 0, len - off - size)) {
+			pr_err("memcpy of %zu bytes at %zu failed\n",
+			       size, off);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+	__copy_page_neon(dst, src);
+	if (memcmp(dst, src, PAGE_SIZE)) {
+		pr_err("copy_page failed\n");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	pr_info("    size   integer      NEON (MB/s)\n");
+	for (i = 0; i < ARRAY_SIZE(test_sizes); i++) {
+		size_t size = test_sizes[i];
+
+		pr_info("%8zu %9lu %9lu\n", size,
+			test_rate(__memcpy_arm, dst, src, size),
+			test_rate(__memcpy_neon, dst, src, size));
+	}
+
+	pr_info("copy_page %7lu %9lu\n",
+		test_page_rate(__copy_page_arm, dst, src),
+		test_page_rate(__copy_page_neon, dst, src));
+	pr_info("memcpy() uses NEON from %lu bytes\n", arm_neon_copy_threshold);
+
+	ret = test_csum(dst, src, len);
+	if (ret)
+		goto out;
+
+	pr_info("    size  csum integer/NEON  csum+copy integer/NEON (MB/s)\n");
+	for (i = 0; i < ARRAY_SIZE(test_sizes); i++) {
+		size_t size = test_sizes[i];
+
+		pr_info("%8zu %9lu %9lu %9lu %9lu\n", size,
+			test_csum_rate(__csum_partial_arm, src, size),
+			test_csum_rate(__csum_partial_neon, src, size),
+			test_csum_copy_rate(__csum_partial_copy_arm, dst, src,
+					    size),
+			test_csum_copy_rate(__csum_partial_copy_neon, dst, src,
+					    size));
+	}
+	pr_info("checksums use NEON from %lu bytes\n", arm_neon_csum_threshold);
+
+out:
+	free_pages((unsigned long)dst, TEST_BUF_ORDER);
+	free_pages((unsigned long)src, TEST_BUF_ORDER);
+	return ret;
+}
+
+static void __exit test_neon_copy_exit(void)
+{
+}
+
+module_init(test_neon_copy_init);
+module_exit(test_neon_copy_exit);
+
+MODULE_DESCRIPTION("NEON memcpy and checksum benchmark");
+MODULE_LICENSE("GPL v2");
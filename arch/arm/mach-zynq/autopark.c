@@ -0,0 +1,168 @@
+/*
+ * Zynq CPU autopark governor
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Takes secondary CPUs offline when the system is mostly idle and brings
+ * them back as soon as the online CPUs get busy. Offline CPUs are parked
+ * in WFI by the platform SMP code, so bringing one back only costs the
+ * CPU hotplug notifiers instead of a full reset and cold cache start.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/device.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/moduleparam.h>
+#include <linux/of.h>
+#include <linux/percpu.h>
+#include <linux/tick.h>
+#include <linux/workqueue.h>
+#include "common.h"
+
+static bool enable = true;
+module_param(enable, bool, 0644);
+MODULE_PARM_DESC(enable, "Park and unpark secondary CPUs automatically");
+
+static unsigned int sample_ms = 20;
+module_param(sample_ms, uint, 0644);
+MODULE_PARM_DESC(sample_ms, "Load sampling period in milliseconds");
+
+static unsigned int up_threshold = 80;
+module_param(up_threshold, uint, 0644);
+MODULE_PARM_DESC(up_threshold,
+		 "Load in percent of any online CPU that unparks a CPU");
+
+static unsigned int down_threshold = 20;
+module_param(down_threshold, uint, 0644);
+MODULE_PARM_DESC(down_threshold,
+		 "Total load in percent below which a CPU is parked");
+
+static unsigned int down_samples = 25;
+module_param(down_samples, uint, 0644);
+MODULE_PARM_DESC(down_samples,
+		 "Samples below down_threshold before parking a CPU");
+
+struct zynq_autopark_sample {
+	u64 idle;
+	u64 wall;
+};
+
+static DEFINE_PER_CPU(struct zynq_autopark_sample, zynq_autopark_samples);
+static struct delayed_work zynq_autopark_work;
+static unsigned int zynq_autopark_idle_count;
+
+/*
+ * Returns the load of @cpu in percent since the previous sample, or -1 if
+ * it is not known.
+ */
+static int zynq_autopark_load(int cpu)
+{
+	struct zynq_autopark_sample *sample =
+		&per_cpu(zynq_autopark_samples, cpu);
+	u64 idle, wall, idle_delta, wall_delta;
+
+	idle = get_cpu_idle_time_us(cpu, &wall);
+	if (idle == -1ULL)
+		return -1;
+
+	idle_delta = idle - sample->idle;
+	wall_delta = wall - sample->wall;
+	sample->idle = idle;
+	sample->wall = wall;
+
+	if (!wall_delta || idle_delta > wall_delta)
+		return 0;
+
+	return div64_u64(100 * (wall_delta - idle_delta), wall_delta);
+}
+
+static void zynq_autopark_set(int cpu, bool online)
+{
+	struct device *dev = get_cpu_device(cpu);
+	int ret;
+
+	if (!dev)
+		return;
+
+	lock_device_hotplug();
+	ret = online ? device_online(dev) : device_offline(dev);
+	unlock_device_hotplug();
+
+	if (ret < 0)
+		pr_debug("autopark: CPU%d %s failed: %d\n", cpu,
+			 online ? "unpark" : "park", ret);
+}
+
+static void zynq_autopark_update(void)
+{
+	int cpu, load, total = 0, peak = 0, park = -1, unpark = -1;
+
+	for_each_online_cpu(cpu) {
+		load = zynq_autopark_load(cpu);
+		if (load < 0)
+			return;
+		total += load;
+		peak = max(peak, load);
+		if (cpu)
+			park = cpu;
+	}
+
+	/*
+	 * Only CPUs the platform code has parked are brought back, a CPU
+	 * given away with zynq_cpun_start() is left alone.
+	 */
+	for_each_present_cpu(cpu) {
+		if (!cpu_online(cpu) && zynq_cpun_parked(cpu)) {
+			unpark = cpu;
+			break;
+		}
+	}
+
+	if (peak >= up_threshold && unpark >= 0) {
+		zynq_autopark_idle_count = 0;
+		zynq_autopark_set(unpark, true);
+		/* Start sampling the new CPU from now on */
+		zynq_autopark_load(unpark);
+		return;
+	}
+
+	if (total >= down_threshold || park < 0) {
+		zynq_autopark_idle_count = 0;
+		return;
+	}
+
+	if (++zynq_autopark_idle_count < down_samples)
+		return;
+
+	zynq_autopark_idle_count = 0;
+	zynq_autopark_set(park, false);
+}
+
+static void zynq_autopark_work_func(struct work_struct *work)
+{
+	if (enable)
+		zynq_autopark_update();
+
+	queue_delayed_work_on(0, system_freezable_wq, &zynq_autopark_work,
+			      msecs_to_jiffies(max(sample_ms, 1U)));
+}
+
+static int __init zynq_autopark_init(void)
+{
+	if (!of_machine_is_compatible("xlnx,zynq-7000") ||
+	    num_possible_cpus() < 2)
+		return 0;
+
+	INIT_DEFERRABLE_WORK(&zynq_autopark_work, zynq_autopark_work_func);
+	queue_delayed_work_on(0, system_freezable_wq, &zynq_autopark_work,
+			      msecs_to_jiffies(max(sample_ms, 1U)));
+
+	return 0;
+}
+late_initcall(zynq_autopark_init);
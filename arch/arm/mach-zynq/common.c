@@ -22,10 +22,12 @@
 #include <linux/clk-provider.h>
 #include <linux/clk/zynq.h>
 #include <linux/clocksource.h>
+#include <linux/dma-mapping.h>
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
 #include <linux/of_platform.h>
 #include <linux/of.h>
+#include <linux/platform_data/cpuidle-zynq.h>
 #include <linux/memblock.h>
 #include <linux/irqchip.h>
 #include <linux/irqchip/arm-gic.h>
@@ -62,8 +64,15 @@ static void __init zynq_memory_init(void)
 		memblock_reserve(__pa(PAGE_OFFSET), __pa(swapper_pg_dir));
 }
 
+static struct zynq_cpuidle_platform_data zynq_cpuidle_pdata = {
+	.self_refresh = zynq_pm_self_refresh,
+};
+
 static struct platform_device zynq_cpuidle_device = {
 	.name = "cpuidle-zynq",
+	.dev = {
+		.platform_data = &zynq_cpuidle_pdata,
+	},
 };
 
 /**
@@ -98,6 +107,31 @@ static int __init zynq_get_revision(void)
 	return revision;
 }
 
+/*
+ * Devices marked "dma-coherent" have their AXI master routed through the
+ * ACP. Its accesses are only snooped by the SCU, which just the SMP code
+ * enables, so uniprocessor kernels keep such devices on the cache
+ * maintaining DMA ops.
+ */
+static int zynq_acp_notifier_call(struct notifier_block *nb,
+				  unsigned long event, void *data)
+{
+	struct device *dev = data;
+
+	if (event != BUS_NOTIFY_ADD_DEVICE || !dev->of_node ||
+	    !of_dma_is_coherent(dev->of_node))
+		return NOTIFY_DONE;
+
+	dev_warn(dev, "ACP needs an SMP kernel, ignoring dma-coherent\n");
+	set_dma_ops(dev, NULL);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block zynq_acp_notifier = {
+	.notifier_call = zynq_acp_notifier_call,
+};
+
 static void __init zynq_init_late(void)
 {
 	zynq_core_pm_init();
@@ -139,6 +173,9 @@ static void __init zynq_init_machine(void)
 	parent = soc_device_to_device(soc_dev);
 
 out:
+	if (!IS_ENABLED(CONFIG_SMP))
+		bus_register_notifier(&platform_bus_type, &zynq_acp_notifier);
+
 	/*
 	 * Finished with the static registrations now; fill in the missing
 	 * devices
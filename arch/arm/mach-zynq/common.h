@@ -36,6 +36,7 @@ extern char zynq_secondary_trampoline;
 extern char zynq_secondary_trampoline_jump;
 extern char zynq_secondary_trampoline_end;
 extern int zynq_cpun_start(u32 address, int cpu);
+extern bool zynq_cpun_parked(int cpu);
 extern struct smp_operations zynq_smp_ops __initdata;
 #endif
 
@@ -46,8 +47,11 @@ extern void __iomem *zynq_slcr_base;
 extern void __iomem *zynq_scu_base;
 
 void zynq_pm_late_init(void);
+int zynq_pm_self_refresh(void);
 extern unsigned int zynq_sys_suspend_sz;
 int zynq_sys_suspend(void __iomem *ddrc_base, void __iomem *slcr_base);
+extern unsigned int zynq_sys_self_refresh_sz;
+void zynq_sys_self_refresh(void __iomem *ddrc_base);
 
 static inline void zynq_prefetch_init(void)
 {
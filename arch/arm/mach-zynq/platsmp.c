@@ -18,11 +18,14 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/cpumask.h>
 #include <linux/export.h>
 #include <linux/jiffies.h>
 #include <linux/init.h>
 #include <linux/io.h>
+#include <linux/sched.h>
 #include <asm/cacheflush.h>
+#include <asm/smp.h>
 #include <asm/smp_scu.h>
 #include <linux/irqchip/arm-gic.h>
 #include "common.h"
@@ -34,6 +37,21 @@
  */
 static int ncores;
 
+/* CPUs parked in WFI by zynq_cpu_die(), with their caches on */
+static struct cpumask zynq_parked_cpus;
+
+/**
+ * zynq_cpun_parked - Check whether a CPU is parked
+ * @cpu:	CPU to check
+ *
+ * Return: true if @cpu went offline and is waiting in WFI to be brought
+ * back by a cheap release instead of a reset.
+ */
+bool zynq_cpun_parked(int cpu)
+{
+	return cpumask_test_cpu(cpu, &zynq_parked_cpus);
+}
+
 int zynq_cpun_start(u32 address, int cpu)
 {
 	u32 trampoline_code_size = &zynq_secondary_trampoline_end -
@@ -47,6 +65,8 @@ int zynq_cpun_start(u32 address, int cpu)
 		u32 trampoline_size = &zynq_secondary_trampoline_jump -
 						&zynq_secondary_trampoline;
 
+		/* A parked CPU is reset here, it is no longer waiting */
+		cpumask_clear_cpu(cpu, &zynq_parked_cpus);
 		zynq_slcr_cpu_stop(cpu);
 		if (address) {
 			if (__pa(PAGE_OFFSET)) {
@@ -90,6 +110,17 @@ EXPORT_SYMBOL(zynq_cpun_start);
 static int zynq_boot_secondary(unsigned int cpu,
 						struct task_struct *idle)
 {
+	/*
+	 * A parked CPU only needs to be woken up, it resumes with warm
+	 * caches in microseconds instead of going through reset and the
+	 * trampoline.
+	 */
+	if (cpumask_test_and_clear_cpu(cpu, &zynq_parked_cpus)) {
+		zynq_slcr_cpu_state_write(cpu, false);
+		arch_send_wakeup_ipi_mask(cpumask_of(cpu));
+		return 0;
+	}
+
 	return zynq_cpun_start(virt_to_phys(zynq_secondary_startup), cpu);
 }
 
@@ -134,7 +165,7 @@ static int zynq_cpu_kill(unsigned cpu)
 		if (time_after(jiffies, timeout))
 			return 0;
 
-	zynq_slcr_cpu_stop(cpu);
+	/* The CPU is left parked, zynq_cpun_start() resets it if needed */
 	return 1;
 }
 
@@ -147,15 +178,30 @@ static int zynq_cpu_kill(unsigned cpu)
  */
 static void zynq_cpu_die(unsigned int cpu)
 {
+	cpumask_set_cpu(cpu, &zynq_parked_cpus);
 	zynq_slcr_cpu_state_write(cpu, true);
 
 	/*
 	 * there is no power-control hardware on this platform, so all
 	 * we can do is put the core into WFI; this is safe as the calling
-	 * code will have already disabled interrupts
+	 * code will have already disabled interrupts. The core stays
+	 * coherent with its caches on until zynq_boot_secondary() releases
+	 * it with a wakeup IPI.
 	 */
-	for (;;)
+	while (zynq_cpun_parked(cpu))
 		cpu_do_idle();
+
+	/*
+	 * Restart like a secondary CPU coming up, as cpu_die() does when
+	 * this returns, without its warning for what is the normal path
+	 * here.
+	 */
+	asm volatile("mov	sp, %0\n"
+		     "	mov	fp, #0\n"
+		     "	b	secondary_start_kernel"
+		     :
+		     : "r" (task_stack_page(current) + THREAD_SIZE - 8));
+	unreachable();
 }
 #endif
 
@@ -25,10 +25,12 @@
 #include <asm/cacheflush.h>
 #include <asm/hardware/cache-l2x0.h>
 #include <asm/mach/map.h>
+#include <asm/outercache.h>
 #include <asm/suspend.h>
 #include <linux/io.h>
 #include <linux/of_address.h>
 #include <linux/of_device.h>
+#include <trace/events/power.h>
 #include "common.h"
 
 /* register offsets */
@@ -43,15 +45,24 @@ static void __iomem *ddrc_base;
 
 #ifdef CONFIG_SUSPEND
 static void __iomem *ocm_base;
+static void __iomem *ocm_sr_base;
 
 static int zynq_pm_prepare_late(void)
 {
-	return zynq_clk_suspend_early();
+	int ret;
+
+	trace_suspend_resume(TPS("zynq_clk_suspend"), 0, true);
+	ret = zynq_clk_suspend_early();
+	trace_suspend_resume(TPS("zynq_clk_suspend"), 0, false);
+
+	return ret;
 }
 
 static void zynq_pm_wake(void)
 {
+	trace_suspend_resume(TPS("zynq_clk_resume"), 0, true);
 	zynq_clk_resume_late();
+	trace_suspend_resume(TPS("zynq_clk_resume"), 0, false);
 }
 
 static int zynq_pm_suspend(unsigned long arg)
@@ -80,10 +91,14 @@ static int zynq_pm_suspend(unsigned long arg)
 		 * PLL. I.e. We might brake sub systems relying on any of this
 		 * clocks. And even worse: If there are any other masters in the
 		 * system (e.g. in the PL) accessing DDR they are screwed.
+		 * The trace events bracket the OCM resident part, the start
+		 * one has to be logged before the caches are flushed.
 		 */
+		trace_suspend_resume(TPS("zynq_ddr_self_refresh"), 0, true);
 		flush_cache_all();
 		if (zynq_suspend_ptr(ddrc_base, zynq_slcr_base))
 			pr_warn("DDR self refresh failed.\n");
+		trace_suspend_resume(TPS("zynq_ddr_self_refresh"), 0, false);
 	} else {
 		WARN_ONCE(1, "DRAM self-refresh not available\n");
 		cpu_do_idle();
@@ -123,13 +138,39 @@ static const struct platform_suspend_ops zynq_pm_ops = {
 	.valid		= suspend_valid_only_mem,
 };
 
+/**
+ * zynq_pm_self_refresh() - Wait for interrupt with DDR in self-refresh
+ *
+ * Called by cpuidle with interrupts disabled, on the last CPU going idle
+ * while the other ones are in WFI.
+ *
+ * Return: 0 on success, -ENODEV if DDR self-refresh is not available.
+ */
+int zynq_pm_self_refresh(void)
+{
+	void (*zynq_self_refresh_ptr)(void __iomem *) =
+		(__force void *)ocm_sr_base;
+
+	if (!ocm_sr_base || !ddrc_base)
+		return -ENODEV;
+
+	/* Nothing may be left on its way to DDR */
+	dsb();
+	outer_sync();
+
+	zynq_self_refresh_ptr(ddrc_base);
+
+	return 0;
+}
+
 /**
  * zynq_pm_remap_ocm() - Remap OCM
+ * @size:	Size of the OCM area to allocate
  * Returns a pointer to the mapped memory or NULL.
  *
  * Remap the OCM.
  */
-static void __iomem *zynq_pm_remap_ocm(void)
+static void __iomem *zynq_pm_remap_ocm(size_t size)
 {
 	struct device_node *np;
 	const char *comp = "xlnx,zynq-ocmc-1.0";
@@ -153,7 +194,7 @@ static void __iomem *zynq_pm_remap_ocm(void)
 			return NULL;
 		}
 
-		pool_addr_virt = gen_pool_alloc(pool, zynq_sys_suspend_sz);
+		pool_addr_virt = gen_pool_alloc(pool, size);
 		if (!pool_addr_virt) {
 			pr_warn("%s: Can't get OCM poll\n", __func__);
 			return NULL;
@@ -164,8 +205,7 @@ static void __iomem *zynq_pm_remap_ocm(void)
 				__func__);
 			return NULL;
 		}
-		base = __arm_ioremap(pool_addr, zynq_sys_suspend_sz,
-				     MT_MEMORY_RWX);
+		base = __arm_ioremap(pool_addr, size, MT_MEMORY_RWX);
 		if (!base) {
 			pr_warn("%s: IOremap OCM pool failed\n", __func__);
 			return NULL;
@@ -182,7 +222,7 @@ static void __iomem *zynq_pm_remap_ocm(void)
 
 static void zynq_pm_suspend_init(void)
 {
-	ocm_base = zynq_pm_remap_ocm();
+	ocm_base = zynq_pm_remap_ocm(zynq_sys_suspend_sz);
 	if (!ocm_base) {
 		pr_warn("%s: Unable to map OCM.\n", __func__);
 	} else {
@@ -197,10 +237,21 @@ static void zynq_pm_suspend_init(void)
 			(unsigned long)(ocm_base) + zynq_sys_suspend_sz);
 	}
 
+	/* The cpuidle self-refresh code has the same constraint */
+	ocm_sr_base = zynq_pm_remap_ocm(zynq_sys_self_refresh_sz);
+	if (ocm_sr_base) {
+		memcpy((__force void *)ocm_sr_base, &zynq_sys_self_refresh,
+			zynq_sys_self_refresh_sz);
+		flush_icache_range((unsigned long)ocm_sr_base,
+			(unsigned long)(ocm_sr_base) +
+			zynq_sys_self_refresh_sz);
+	}
+
 	suspend_set_ops(&zynq_pm_ops);
 }
 #else	/* CONFIG_SUSPEND */
 static void zynq_pm_suspend_init(void) { };
+int zynq_pm_self_refresh(void) { return -ENODEV; }
 #endif	/* CONFIG_SUSPEND */
 
 /**
@@ -14,11 +14,14 @@
  * 02139, USA.
  */
 
+#include <linux/delay.h>
 #include <linux/io.h>
 #include <linux/module.h>
 #include <linux/mfd/syscon.h>
 #include <linux/of_address.h>
 #include <linux/regmap.h>
+#include <linux/reset-controller.h>
+#include <linux/spinlock.h>
 #include <linux/clk/zynq.h>
 #include "common.h"
 
@@ -39,9 +42,30 @@
 #define SLCR_PSS_IDCODE_DEVICE_SHIFT	12
 #define SLCR_PSS_IDCODE_DEVICE_MASK	0x1F
 
+#define SLCR_FPGA_OUT_RST_MASK		0xF	/* FCLK_RESET0..3 */
+/*
+ * FCLK_RESET0..3, the four PL DMA peripheral request interfaces, the GP
+ * master and slave ports, the four HP ports and the ACP port.
+ */
+#define SLCR_FPGA_RST_MASK		0x01F33F0F
+#define SLCR_FPGA_RST_NR		25
+
+#define SLCR_LVL_SHFTR_OUT		0xA	/* PS to PL only */
+#define SLCR_LVL_SHFTR_ALL		0xF
+
 void __iomem *zynq_slcr_base;
 static struct regmap *zynq_slcr_regmap;
 
+/*
+ * FPGA_RST_CTRL is shared between xilinx_devcfg, which asserts every PL
+ * reset around a full reprogram, and reset controller consumers holding
+ * single resets. Resets held by consumers survive the reprogram, and no
+ * consumer can release a reset while the fabric is being loaded.
+ */
+static DEFINE_SPINLOCK(zynq_slcr_fpga_lock);
+static u32 zynq_slcr_fpga_held;
+static bool zynq_slcr_fpga_loading;
+
 /**
  * zynq_slcr_write - Write to a register in SLCR block
  *
@@ -148,14 +172,21 @@ u32 zynq_slcr_get_ocm_config(void)
  */
 void zynq_slcr_init_preload_fpga(void)
 {
+	unsigned long flags;
+
+	spin_lock_irqsave(&zynq_slcr_fpga_lock, flags);
+	zynq_slcr_fpga_loading = true;
+
 	/* Assert FPGA top level output resets */
-	zynq_slcr_write(0xF, SLCR_FPGA_RST_CTRL_OFFSET);
+	zynq_slcr_write(SLCR_FPGA_OUT_RST_MASK | zynq_slcr_fpga_held,
+			SLCR_FPGA_RST_CTRL_OFFSET);
 
 	/* Disable level shifters */
 	zynq_slcr_write(0, SLCR_LVL_SHFTR_EN_OFFSET);
 
 	/* Enable output level shifters */
-	zynq_slcr_write(0xA, SLCR_LVL_SHFTR_EN_OFFSET);
+	zynq_slcr_write(SLCR_LVL_SHFTR_OUT, SLCR_LVL_SHFTR_EN_OFFSET);
+	spin_unlock_irqrestore(&zynq_slcr_fpga_lock, flags);
 }
 EXPORT_SYMBOL(zynq_slcr_init_preload_fpga);
 
@@ -164,14 +195,108 @@ EXPORT_SYMBOL(zynq_slcr_init_preload_fpga);
  */
 void zynq_slcr_init_postload_fpga(void)
 {
+	unsigned long flags;
+
+	spin_lock_irqsave(&zynq_slcr_fpga_lock, flags);
+
 	/* Enable level shifters */
-	zynq_slcr_write(0xf, SLCR_LVL_SHFTR_EN_OFFSET);
+	zynq_slcr_write(SLCR_LVL_SHFTR_ALL, SLCR_LVL_SHFTR_EN_OFFSET);
+
+	/* Deassert AXI interface resets not held through the reset controller */
+	zynq_slcr_write(zynq_slcr_fpga_held, SLCR_FPGA_RST_CTRL_OFFSET);
 
-	/* Deassert AXI interface resets */
-	zynq_slcr_write(0, SLCR_FPGA_RST_CTRL_OFFSET);
+	zynq_slcr_fpga_loading = false;
+	spin_unlock_irqrestore(&zynq_slcr_fpga_lock, flags);
 }
 EXPORT_SYMBOL(zynq_slcr_init_postload_fpga);
 
+#ifdef CONFIG_RESET_CONTROLLER
+/*
+ * Reset lines are the bit numbers of FPGA_RST_CTRL, so a PL accelerator
+ * can be quiesced and restarted with "resets = <&slcr 0>, <&slcr 20>;"
+ * (FCLK_RESET0 and the HP0 port) without reprogramming the fabric.
+ */
+static int zynq_slcr_fpga_reset_update(unsigned long id, bool assert)
+{
+	unsigned long flags;
+	int ret = 0;
+	u32 reg;
+
+	if (!(SLCR_FPGA_RST_MASK & BIT(id)))
+		return -EINVAL;
+
+	spin_lock_irqsave(&zynq_slcr_fpga_lock, flags);
+	if (assert) {
+		zynq_slcr_fpga_held |= BIT(id);
+	} else if (zynq_slcr_fpga_loading) {
+		/* The fabric is being reprogrammed, keep the PL in reset */
+		ret = -EBUSY;
+		goto out;
+	} else {
+		zynq_slcr_fpga_held &= ~BIT(id);
+	}
+
+	zynq_slcr_read(&reg, SLCR_FPGA_RST_CTRL_OFFSET);
+	if (assert)
+		reg |= BIT(id);
+	else
+		reg &= ~BIT(id);
+	zynq_slcr_write(reg, SLCR_FPGA_RST_CTRL_OFFSET);
+out:
+	spin_unlock_irqrestore(&zynq_slcr_fpga_lock, flags);
+
+	return ret;
+}
+
+static int zynq_slcr_fpga_reset_assert(struct reset_controller_dev *rcdev,
+				       unsigned long id)
+{
+	return zynq_slcr_fpga_reset_update(id, true);
+}
+
+static int zynq_slcr_fpga_reset_deassert(struct reset_controller_dev *rcdev,
+					 unsigned long id)
+{
+	return zynq_slcr_fpga_reset_update(id, false);
+}
+
+static int zynq_slcr_fpga_reset_reset(struct reset_controller_dev *rcdev,
+				      unsigned long id)
+{
+	int ret;
+
+	ret = zynq_slcr_fpga_reset_update(id, true);
+	if (ret)
+		return ret;
+
+	/* The PL samples FCLK_RESETn on its own clock, a few cycles suffice */
+	udelay(1);
+
+	return zynq_slcr_fpga_reset_update(id, false);
+}
+
+static struct reset_control_ops zynq_slcr_fpga_reset_ops = {
+	.assert		= zynq_slcr_fpga_reset_assert,
+	.deassert	= zynq_slcr_fpga_reset_deassert,
+	.reset		= zynq_slcr_fpga_reset_reset,
+};
+
+static struct reset_controller_dev zynq_slcr_fpga_rcdev = {
+	.ops		= &zynq_slcr_fpga_reset_ops,
+	.owner		= THIS_MODULE,
+	.nr_resets	= SLCR_FPGA_RST_NR,
+};
+
+static void __init zynq_slcr_fpga_reset_init(struct device_node *np)
+{
+	zynq_slcr_fpga_rcdev.of_node = np;
+	if (reset_controller_register(&zynq_slcr_fpga_rcdev))
+		pr_warn("%s: failed to register FPGA resets\n", __func__);
+}
+#else
+static inline void zynq_slcr_fpga_reset_init(struct device_node *np) { }
+#endif
+
 /**
  * zynq_slcr_cpu_start - Start cpu
  * @cpu:	cpu number
@@ -250,12 +375,19 @@ void zynq_slcr_cpu_state_write(int cpu, bool die)
  */
 int __init zynq_slcr_init(void)
 {
+	struct device_node *np;
+
 	zynq_slcr_regmap = syscon_regmap_lookup_by_compatible("xlnx,zynq-slcr");
 	if (IS_ERR(zynq_slcr_regmap)) {
 		pr_err("%s: failed to find zynq-slcr\n", __func__);
 		return -ENODEV;
 	}
 
+	/* The reset controller keeps the node reference */
+	np = of_find_compatible_node(NULL, NULL, "xlnx,zynq-slcr");
+	if (np)
+		zynq_slcr_fpga_reset_init(np);
+
 	return 0;
 }
 
@@ -17,11 +17,17 @@
 
 #include <linux/kernel.h>
 #include <linux/err.h>
+#include <linux/fs.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/module.h>
 #include <linux/of_irq.h>
 #include <linux/platform_device.h>
 #include <linux/genalloc.h>
+#include <linux/slab.h>
+#include <soc/zynq/ocm.h>
 
 #include "common.h"
 
@@ -44,6 +50,147 @@ struct zynq_ocm_dev {
 	int irq;
 	struct gen_pool *pool;
 	struct resource res[ZYNQ_OCM_BLOCKS];
+	struct miscdevice miscdev;
+};
+
+/**
+ * struct zynq_ocm_map - OCM chunk mapped into user space
+ * @pool:	Pool the chunk was allocated from
+ * @vaddr:	Kernel address returned by the pool
+ * @size:	Size of the allocation
+ * @phys:	Page aligned physical address of the mapping
+ * @refs:	Number of VMAs using the chunk
+ */
+struct zynq_ocm_map {
+	struct gen_pool *pool;
+	unsigned long vaddr;
+	size_t size;
+	phys_addr_t phys;
+	atomic_t refs;
+};
+
+/* The OCM instance behind zynq_ocm_alloc() */
+static struct zynq_ocm_dev *zynq_ocm_instance;
+
+/**
+ * zynq_ocm_alloc - Allocate memory from the on-chip memory
+ * @size:	Number of bytes to allocate
+ * @dma:	DMA address of the allocation
+ *
+ * OCM is accessed without going through the DDR controller, which makes it
+ * a good place for descriptor rings and other small, latency critical
+ * buffers shared between the CPU and DMA masters.
+ *
+ * Return:	Kernel address of the allocation or NULL
+ */
+void *zynq_ocm_alloc(size_t size, dma_addr_t *dma)
+{
+	struct zynq_ocm_dev *zynq_ocm = ACCESS_ONCE(zynq_ocm_instance);
+
+	if (!zynq_ocm)
+		return NULL;
+
+	return gen_pool_dma_alloc(zynq_ocm->pool, size, dma);
+}
+EXPORT_SYMBOL_GPL(zynq_ocm_alloc);
+
+/**
+ * zynq_ocm_free - Free memory allocated by zynq_ocm_alloc()
+ * @vaddr:	Kernel address of the allocation
+ * @size:	Size passed to zynq_ocm_alloc()
+ */
+void zynq_ocm_free(void *vaddr, size_t size)
+{
+	if (vaddr)
+		gen_pool_free(zynq_ocm_instance->pool, (unsigned long)vaddr,
+			      size);
+}
+EXPORT_SYMBOL_GPL(zynq_ocm_free);
+
+static void zynq_ocm_vm_open(struct vm_area_struct *vma)
+{
+	struct zynq_ocm_map *map = vma->vm_private_data;
+
+	atomic_inc(&map->refs);
+}
+
+static void zynq_ocm_vm_close(struct vm_area_struct *vma)
+{
+	struct zynq_ocm_map *map = vma->vm_private_data;
+
+	if (!atomic_dec_and_test(&map->refs))
+		return;
+
+	gen_pool_free(map->pool, map->vaddr, map->size);
+	kfree(map);
+}
+
+static const struct vm_operations_struct zynq_ocm_vm_ops = {
+	.open = zynq_ocm_vm_open,
+	.close = zynq_ocm_vm_close,
+};
+
+/**
+ * zynq_ocm_mmap - Map a new OCM chunk into user space
+ * @file:	File of the OCM device
+ * @vma:	VMA to map the chunk into
+ *
+ * Every mapping gets its own chunk of the size of the VMA, which is
+ * returned to the pool once the last user unmaps it. The memory is mapped
+ * uncached.
+ *
+ * Return:	0 on success and error value on failure
+ */
+static int zynq_ocm_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct miscdevice *miscdev = file->private_data;
+	struct zynq_ocm_dev *zynq_ocm = container_of(miscdev,
+						     struct zynq_ocm_dev,
+						     miscdev);
+	size_t len = vma->vm_end - vma->vm_start;
+	struct zynq_ocm_map *map;
+	phys_addr_t phys;
+	int ret;
+
+	if (vma->vm_pgoff)
+		return -EINVAL;
+
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+
+	/* The pool is only 32 byte aligned, allocate room to align */
+	map->pool = zynq_ocm->pool;
+	map->size = len + PAGE_SIZE - ZYNQ_OCM_GRANULARITY;
+	map->vaddr = gen_pool_alloc(map->pool, map->size);
+	if (!map->vaddr) {
+		kfree(map);
+		return -ENOMEM;
+	}
+	phys = gen_pool_virt_to_phys(map->pool, map->vaddr);
+	map->phys = PAGE_ALIGN(phys);
+	atomic_set(&map->refs, 1);
+
+	vma->vm_flags |= VM_IO | VM_DONTCOPY | VM_DONTEXPAND | VM_DONTDUMP;
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	ret = remap_pfn_range(vma, vma->vm_start, map->phys >> PAGE_SHIFT,
+			      len, vma->vm_page_prot);
+	if (ret) {
+		gen_pool_free(map->pool, map->vaddr, map->size);
+		kfree(map);
+		return ret;
+	}
+
+	vma->vm_private_data = map;
+	vma->vm_ops = &zynq_ocm_vm_ops;
+
+	return 0;
+}
+
+static const struct file_operations zynq_ocm_fops = {
+	.owner = THIS_MODULE,
+	.mmap = zynq_ocm_mmap,
+	.llseek = noop_llseek,
 };
 
 /**
@@ -199,6 +346,19 @@ static int zynq_ocm_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, zynq_ocm);
 
+	/* User space allocations, the pool stays usable without them */
+	zynq_ocm->miscdev.minor = MISC_DYNAMIC_MINOR;
+	zynq_ocm->miscdev.name = "ocm";
+	zynq_ocm->miscdev.fops = &zynq_ocm_fops;
+	zynq_ocm->miscdev.parent = &pdev->dev;
+	ret = misc_register(&zynq_ocm->miscdev);
+	if (ret) {
+		dev_warn(&pdev->dev, "misc_register failed: %d\n", ret);
+		zynq_ocm->miscdev.fops = NULL;
+	}
+
+	zynq_ocm_instance = zynq_ocm;
+
 	return 0;
 }
 
@@ -216,6 +376,10 @@ static int zynq_ocm_remove(struct platform_device *pdev)
 {
 	struct zynq_ocm_dev *zynq_ocm = platform_get_drvdata(pdev);
 
+	if (zynq_ocm->miscdev.fops)
+		misc_deregister(&zynq_ocm->miscdev);
+	zynq_ocm_instance = NULL;
+
 	if (gen_pool_avail(zynq_ocm->pool) < gen_pool_size(zynq_ocm->pool))
 		dev_dbg(&pdev->dev, "removed while SRAM allocated\n");
 
@@ -19,6 +19,7 @@
 #include <linux/cpu.h>
 #include <linux/err.h>
 #include <linux/init.h>
+#include <linux/kernel.h>
 #include <linux/smp.h>
 #include <linux/spinlock.h>
 #include <linux/log2.h>
@@ -586,6 +587,136 @@ static void l2c310_flush_all_erratum(void)
 	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
 }
 
+/*
+ * With erratum 727915 worked around and on revisions without 588369, the
+ * L2C-310 range operations above l2c310_way_threshold bytes clean the
+ * whole cache by way instead of walking a huge buffer line by line. Way
+ * operations run in the background and no other maintenance operation may
+ * be issued meanwhile, so all operations are serialised by l2x0_lock like
+ * on the L2C-220. "l2c310_way_threshold=0" keeps the lockless line
+ * operations, the default is the cache size.
+ */
+static unsigned long l2c310_way_threshold = ULONG_MAX;
+static bool l2c310_way_erratum;
+
+static int __init l2c310_way_threshold_setup(char *str)
+{
+	l2c310_way_threshold = memparse(str, &str);
+	return 0;
+}
+early_param("l2c310_way_threshold", l2c310_way_threshold_setup);
+
+static void __l2c310_op_way(void __iomem *base, unsigned reg)
+{
+	if (l2c310_way_erratum)
+		l2c_set_debug(base, 0x03);
+	__l2c_op_way(base + reg);
+	if (l2c310_way_erratum)
+		l2c_set_debug(base, 0x00);
+	__l2c210_cache_sync(base);
+}
+
+static void l2c310_op_way(void __iomem *base, unsigned reg)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	__l2c310_op_way(base, reg);
+	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+}
+
+static unsigned long l2c310_op_pa_range(void __iomem *reg, unsigned long start,
+	unsigned long end, unsigned long flags)
+{
+	raw_spinlock_t *lock = &l2x0_lock;
+
+	while (start < end) {
+		unsigned long blk_end = start + min(end - start, 4096UL);
+
+		__l2c210_op_pa_range(reg, start, blk_end);
+		start = blk_end;
+
+		if (blk_end < end) {
+			raw_spin_unlock_irqrestore(lock, flags);
+			raw_spin_lock_irqsave(lock, flags);
+		}
+	}
+
+	return flags;
+}
+
+static void l2c310_inv_range(unsigned long start, unsigned long end)
+{
+	void __iomem *base = l2x0_base;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	if (start & (CACHE_LINE_SIZE - 1)) {
+		start &= ~(CACHE_LINE_SIZE - 1);
+		writel_relaxed(start, base + L2X0_CLEAN_INV_LINE_PA);
+		start += CACHE_LINE_SIZE;
+	}
+
+	if (end & (CACHE_LINE_SIZE - 1)) {
+		end &= ~(CACHE_LINE_SIZE - 1);
+		writel_relaxed(end, base + L2X0_CLEAN_INV_LINE_PA);
+	}
+
+	flags = l2c310_op_pa_range(base + L2X0_INV_LINE_PA, start, end, flags);
+	__l2c210_cache_sync(base);
+	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+}
+
+static void l2c310_clean_range(unsigned long start, unsigned long end)
+{
+	void __iomem *base = l2x0_base;
+	unsigned long flags;
+
+	start &= ~(CACHE_LINE_SIZE - 1);
+	if ((end - start) >= l2c310_way_threshold) {
+		l2c310_op_way(base, L2X0_CLEAN_WAY);
+		return;
+	}
+
+	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	flags = l2c310_op_pa_range(base + L2X0_CLEAN_LINE_PA, start, end,
+				   flags);
+	__l2c210_cache_sync(base);
+	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+}
+
+static void l2c310_flush_range(unsigned long start, unsigned long end)
+{
+	void __iomem *base = l2x0_base;
+	unsigned long flags;
+
+	start &= ~(CACHE_LINE_SIZE - 1);
+	if ((end - start) >= l2c310_way_threshold) {
+		l2c310_op_way(base, L2X0_CLEAN_INV_WAY);
+		return;
+	}
+
+	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	flags = l2c310_op_pa_range(base + L2X0_CLEAN_INV_LINE_PA, start, end,
+				   flags);
+	__l2c210_cache_sync(base);
+	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+}
+
+static void l2c310_flush_all(void)
+{
+	l2c310_op_way(l2x0_base, L2X0_CLEAN_INV_WAY);
+}
+
+static void l2c310_sync(void)
+{
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	__l2c210_cache_sync(l2x0_base);
+	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+}
+
 static void __init l2c310_save(void __iomem *base)
 {
 	unsigned revision;
@@ -755,6 +886,7 @@ static void __init l2c310_fixup(void __iomem *base, u32 cache_id,
 	    revision >= L310_CACHE_ID_RTL_R2P0 &&
 	    revision < L310_CACHE_ID_RTL_R3P1) {
 		fns->flush_all = l2c310_flush_all_erratum;
+		l2c310_way_erratum = true;
 		errata[n++] = "727915";
 	}
 
@@ -778,6 +910,22 @@ static void __init l2c310_fixup(void __iomem *base, u32 cache_id,
 	if (IS_ENABLED(CONFIG_PL310_ERRATA_769419))
 		errata[n++] = "769419";
 
+	/* Not with the 588369 or bcm range operations */
+	if (l2c310_way_threshold && fns->inv_range == l2c210_inv_range) {
+		if (l2c310_way_threshold == ULONG_MAX)
+			l2c310_way_threshold = l2x0_size;
+
+		fns->inv_range = l2c310_inv_range;
+		fns->clean_range = l2c310_clean_range;
+		fns->flush_range = l2c310_flush_range;
+		fns->flush_all = l2c310_flush_all;
+		if (fns->sync)
+			fns->sync = l2c310_sync;
+
+		pr_info("L2C-310 maintaining whole cache from %lu kB ranges\n",
+			l2c310_way_threshold >> 10);
+	}
+
 	if (n) {
 		unsigned i;
 
@@ -910,6 +1058,8 @@ static void __init __l2c_init(const struct l2c_init_data *data,
 		data->type, ways, l2x0_size >> 10);
 	pr_info("%s: CACHE_ID 0x%08x, AUX_CTRL 0x%08x\n",
 		data->type, cache_id, aux);
+
+	l2x0_pmu_register(l2x0_base, cache_id);
 }
 
 void __init l2x0_init(void __iomem *base, u32 aux_val, u32 aux_mask)
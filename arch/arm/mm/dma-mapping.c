@@ -867,6 +867,65 @@ static void __dma_page_dev_to_cpu(struct page *page, unsigned long off,
 	}
 }
 
+static void __dma_outer_cpu_to_dev(phys_addr_t start, phys_addr_t end,
+	enum dma_data_direction dir)
+{
+	if (dir == DMA_FROM_DEVICE)
+		outer_inv_range(start, end);
+	else
+		outer_clean_range(start, end);
+}
+
+/*
+ * The scatterlist version of __dma_page_cpu_to_dev() for arm_dma_ops.
+ * Each outer cache operation ends with a sync, so physically contiguous
+ * entries are merged into one operation. A clean never loses data, so a
+ * densely packed list is even cleaned with a single operation over its
+ * whole span, which also lets the outer cache switch to whole cache
+ * maintenance for a large buffer.
+ */
+static void __dma_sg_cpu_to_dev(struct scatterlist *sg, int nents,
+	enum dma_data_direction dir)
+{
+	phys_addr_t start = 0, end = 0, lo = ~(phys_addr_t)0, hi = 0;
+	struct scatterlist *s;
+	size_t total = 0;
+	int i;
+
+	for_each_sg(sg, s, nents, i) {
+		phys_addr_t paddr = page_to_phys(sg_page(s)) + s->offset;
+
+		dma_cache_maint_page(sg_page(s), s->offset, s->length, dir,
+				     dmac_map_area);
+		lo = min(lo, paddr);
+		hi = max(hi, paddr + s->length);
+		total += s->length;
+	}
+
+	if (!total)
+		return;
+
+	if (dir != DMA_FROM_DEVICE && hi - lo <= 2 * (phys_addr_t)total) {
+		outer_clean_range(lo, hi);
+		return;
+	}
+
+	for_each_sg(sg, s, nents, i) {
+		phys_addr_t paddr = page_to_phys(sg_page(s)) + s->offset;
+
+		if (i && paddr == end) {
+			end += s->length;
+			continue;
+		}
+
+		if (i)
+			__dma_outer_cpu_to_dev(start, end, dir);
+		start = paddr;
+		end = paddr + s->length;
+	}
+	__dma_outer_cpu_to_dev(start, end, dir);
+}
+
 /**
  * arm_dma_map_sg - map a set of SG buffers for streaming mode DMA
  * @dev: valid struct device pointer, or NULL for ISA and EISA-like devices
@@ -890,6 +949,19 @@ int arm_dma_map_sg(struct device *dev, struct scatterlist *sg, int nents,
 	struct scatterlist *s;
 	int i, j;
 
+	if (ops == &arm_dma_ops) {
+		for_each_sg(sg, s, nents, i) {
+#ifdef CONFIG_NEED_SG_DMA_LENGTH
+			s->dma_length = s->length;
+#endif
+			s->dma_address = pfn_to_dma(dev,
+					page_to_pfn(sg_page(s))) + s->offset;
+		}
+		if (!dma_get_attr(DMA_ATTR_SKIP_CPU_SYNC, attrs))
+			__dma_sg_cpu_to_dev(sg, nents, dir);
+		return nents;
+	}
+
 	for_each_sg(sg, s, nents, i) {
 #ifdef CONFIG_NEED_SG_DMA_LENGTH
 		s->dma_length = s->length;
@@ -962,6 +1034,11 @@ void arm_dma_sync_sg_for_device(struct device *dev, struct scatterlist *sg,
 	struct scatterlist *s;
 	int i;
 
+	if (ops == &arm_dma_ops) {
+		__dma_sg_cpu_to_dev(sg, nents, dir);
+		return;
+	}
+
 	for_each_sg(sg, s, nents, i)
 		ops->sync_single_for_device(dev, sg_dma_address(s), s->length,
 					    dir);
@@ -285,6 +285,20 @@ do_page_fault(unsigned long addr, unsigned int fsr, struct pt_regs *regs)
 	if (fsr & FSR_WRITE)
 		flags |= FAULT_FLAG_WRITE;
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	/* prefetch aborts go the slow way, only it checks for VM_EXEC */
+	if ((flags & FAULT_FLAG_USER) && !(fsr & FSR_LNX_PF)) {
+		fault = handle_speculative_fault(mm, addr & PAGE_MASK, flags);
+		if (!(fault & VM_FAULT_RETRY)) {
+			perf_sw_event(PERF_COUNT_SW_PAGE_FAULTS, 1, regs, addr);
+			tsk->min_flt++;
+			perf_sw_event(PERF_COUNT_SW_PAGE_FAULTS_MIN, 1,
+				      regs, addr);
+			return 0;
+		}
+	}
+#endif
+
 	/*
 	 * As per x86, we may deadlock here.  However, since the kernel only
 	 * validly references user space from well defined areas of the code,
@@ -1,5 +1,6 @@
 /*
- * Just-In-Time compiler for BPF filters on 32bit ARM
+ * Just-In-Time compiler for BPF filters on 32bit ARM, and for eBPF
+ * programs on little-endian ARMv7
  *
  * Copyright (c) 2011 Mircea Gherzan <mgherzan@gmail.com>
  *
@@ -18,8 +19,10 @@
 #include <linux/if_vlan.h>
 
 #include <asm/cacheflush.h>
+#include <asm/div64.h>
 #include <asm/hwcap.h>
 #include <asm/opcodes.h>
+#include <asm/unaligned.h>
 
 #include "bpf_jit_32.h"
 
@@ -939,6 +942,820 @@ out:
 	return;
 }
 
+#if __LINUX_ARM_ARCH__ >= 7 && defined(__LITTLE_ENDIAN)
+
+/*
+ * eBPF JIT
+ *
+ * The eBPF registers are 64 bit wide and there are more of them than ARM
+ * has callee saved registers, so all of them live in a stack frame and are
+ * loaded into register pairs around every instruction:
+ *
+ * r4:r5	destination register
+ * r6:r7	source register or immediate
+ * r8:r9	temporaries
+ * ip		address and immediate scratch
+ *
+ * Stack frame, from sp upwards:
+ *
+ * [0, 24)	R3-R5 passed on the stack to helper calls
+ * [24, 112)	R0-R10, low word first
+ * [112, 624)	eBPF program stack, R10 points to its top
+ */
+
+#define rd_lo		ARM_R4
+#define rd_hi		ARM_R5
+#define rs_lo		ARM_R6
+#define rs_hi		ARM_R7
+#define rt_lo		ARM_R8
+#define rt_hi		ARM_R9
+
+#define EBPF_REG_OFF(r)		(24 + 8 * (r))
+#define EBPF_FRAME_SIZE		(EBPF_REG_OFF(MAX_BPF_REG) + MAX_BPF_STACK)
+
+#ifdef CONFIG_FRAME_POINTER
+#define EBPF_SAVED_REGS	((0x7f8) | (1 << ARM_FP) | (1 << ARM_IP) | \
+			 (1 << ARM_LR) | (1 << ARM_PC))
+#else
+#define EBPF_SAVED_REGS	((0x7f0) | (1 << ARM_LR))
+#endif
+
+static u64 jit_div64(u64 dividend, u32 divisor)
+{
+	do_div(dividend, divisor);
+	return dividend;
+}
+
+static u64 jit_mod64(u64 dividend, u32 divisor)
+{
+	return do_div(dividend, divisor);
+}
+
+static u32 jit_umod(u32 dividend, u32 divisor)
+{
+	return dividend % divisor;
+}
+
+/* Returns the loaded value, or a non-zero high word if @k is out of range. */
+static u64 jit_skb_load(const struct sk_buff *skb, int k, unsigned int size)
+{
+	u8 buf[4];
+	void *ptr;
+
+	ptr = bpf_load_pointer(skb, k, size, buf);
+	if (ptr == NULL)
+		return 1ULL << 32;
+
+	switch (size) {
+	case 1:
+		return *(u8 *)ptr;
+	case 2:
+		return get_unaligned_be16(ptr);
+	default:
+		return get_unaligned_be32(ptr);
+	}
+}
+
+/* Branch offset from the current instruction to eBPF instruction @tgt. */
+static inline u32 ebpf_b_imm(unsigned tgt, struct jit_ctx *ctx)
+{
+	if (ctx->target == NULL)
+		return 0;
+
+	return (ctx->offsets[tgt] - (ctx->idx * 4 + 8)) >> 2;
+}
+
+/* Branch back to the already emitted ARM instruction at index @tgt. */
+static inline void ebpf_emit_b_back(u8 cond, unsigned tgt,
+				    struct jit_ctx *ctx)
+{
+	_emit(cond, ARM_B(tgt - (ctx->idx + 2)), ctx);
+}
+
+/*
+ * Forward branches within an eBPF instruction are emitted as a placeholder
+ * that is patched once the current position is their target.
+ */
+static inline unsigned ebpf_emit_b_fwd(struct jit_ctx *ctx)
+{
+	return ctx->idx++;
+}
+
+static inline void ebpf_patch_b_fwd(u8 cond, unsigned from,
+				    struct jit_ctx *ctx)
+{
+	u32 inst = cond << 28 | ARM_B(ctx->idx - (from + 2));
+
+	if (ctx->target != NULL)
+		ctx->target[from] = __opcode_to_mem_arm(inst);
+}
+
+static void ebpf_mov_i(u8 rd, u32 val, struct jit_ctx *ctx)
+{
+	int imm12 = imm8m(~val);
+
+	if (imm8m(val) < 0 && imm12 >= 0)
+		emit(ARM_MVN_I(rd, imm12), ctx);
+	else
+		emit_mov_i(rd, val, ctx);
+}
+
+/* Load a sign extended 32 bit immediate into a register pair. */
+static void ebpf_mov_imm64(u8 lo, s32 imm, struct jit_ctx *ctx)
+{
+	ebpf_mov_i(lo, imm, ctx);
+	ebpf_mov_i(lo + 1, imm < 0 ? ~0U : 0, ctx);
+}
+
+static inline void ebpf_get(u8 lo, u8 reg, struct jit_ctx *ctx)
+{
+	emit(ARM_LDRD_I(lo, ARM_SP, EBPF_REG_OFF(reg)), ctx);
+}
+
+static inline void ebpf_get_lo(u8 rd, u8 reg, struct jit_ctx *ctx)
+{
+	emit(ARM_LDR_I(rd, ARM_SP, EBPF_REG_OFF(reg)), ctx);
+}
+
+static inline void ebpf_put(u8 lo, u8 reg, struct jit_ctx *ctx)
+{
+	emit(ARM_STRD_I(lo, ARM_SP, EBPF_REG_OFF(reg)), ctx);
+}
+
+/* Store a 32 bit result, zero extended to 64 bit. */
+static inline void ebpf_put32(u8 lo, u8 reg, struct jit_ctx *ctx)
+{
+	emit(ARM_MOV_I(lo + 1, 0), ctx);
+	ebpf_put(lo, reg, ctx);
+}
+
+/* rd = rn + imm, rd may be the same register as rn */
+static void ebpf_add_i(u8 rd, u8 rn, s32 imm, struct jit_ctx *ctx)
+{
+	int imm12;
+
+	if (imm == 0) {
+		if (rd != rn)
+			emit(ARM_MOV_R(rd, rn), ctx);
+		return;
+	}
+
+	imm12 = imm8m(imm);
+	if (imm12 >= 0) {
+		emit(ARM_ADD_I(rd, rn, imm12), ctx);
+		return;
+	}
+
+	imm12 = imm8m(-imm);
+	if (imm12 >= 0) {
+		emit(ARM_SUB_I(rd, rn, imm12), ctx);
+		return;
+	}
+
+	emit_mov_i_no8m(ARM_IP, imm, ctx);
+	emit(ARM_ADD_R(rd, rn, ARM_IP), ctx);
+}
+
+/* Returns the register holding base + off, which is ip if off is not 0. */
+static u8 ebpf_addr(u8 base, s16 off, struct jit_ctx *ctx)
+{
+	if (off == 0)
+		return base;
+
+	ebpf_add_i(ARM_IP, base, off, ctx);
+	return ARM_IP;
+}
+
+static inline void ebpf_call(void *func, struct jit_ctx *ctx)
+{
+	emit_mov_i(ARM_IP, (u32)func, ctx);
+	emit_blx_r(ARM_IP, ctx);
+}
+
+static void ebpf_build_prologue(struct jit_ctx *ctx)
+{
+	int i;
+
+#ifdef CONFIG_FRAME_POINTER
+	emit(ARM_MOV_R(ARM_IP, ARM_SP), ctx);
+	emit(ARM_PUSH(EBPF_SAVED_REGS), ctx);
+	emit(ARM_SUB_I(ARM_FP, ARM_IP, 4), ctx);
+#else
+	emit(ARM_PUSH(EBPF_SAVED_REGS), ctx);
+#endif
+	ebpf_add_i(ARM_SP, ARM_SP, -EBPF_FRAME_SIZE, ctx);
+
+	emit(ARM_MOV_I(rd_lo, 0), ctx);
+	emit(ARM_MOV_I(rd_hi, 0), ctx);
+	for (i = BPF_REG_0; i < BPF_REG_FP; i++)
+		ebpf_put(rd_lo, i, ctx);
+
+	/* R1 = ctx, R10 = top of the program stack */
+	emit(ARM_STR_I(ARM_R0, ARM_SP, EBPF_REG_OFF(BPF_REG_1)), ctx);
+	ebpf_add_i(rd_lo, ARM_SP, EBPF_FRAME_SIZE, ctx);
+	ebpf_put(rd_lo, BPF_REG_FP, ctx);
+}
+
+static void ebpf_build_epilogue(struct jit_ctx *ctx)
+{
+	/* error exit, offsets[len] points here */
+	emit(ARM_MOV_I(ARM_R0, 0), ctx);
+
+	ebpf_add_i(ARM_SP, ARM_SP, EBPF_FRAME_SIZE, ctx);
+#ifdef CONFIG_FRAME_POINTER
+	/* the first instruction of the prologue was: mov ip, sp */
+	emit(ARM_LDM(ARM_SP, (EBPF_SAVED_REGS & ~((1 << ARM_IP) |
+						 (1 << ARM_LR))) |
+		     (1 << ARM_SP)), ctx);
+#else
+	emit(ARM_POP((EBPF_SAVED_REGS & ~(1 << ARM_LR)) | (1 << ARM_PC)), ctx);
+#endif
+}
+
+static int ebpf_build_alu(const struct bpf_insn *insn, struct jit_ctx *ctx)
+{
+	const bool is64 = BPF_CLASS(insn->code) == BPF_ALU64;
+	const u8 op = BPF_OP(insn->code);
+	u32 k = insn->imm;
+
+	if (op != BPF_MOV)
+		ebpf_get(rd_lo, insn->dst_reg, ctx);
+
+	if (op == BPF_NEG) {
+		if (is64) {
+			emit(ARM_RSBS_I(rd_lo, rd_lo, 0), ctx);
+			emit(ARM_RSC_I(rd_hi, rd_hi, 0), ctx);
+		} else {
+			emit(ARM_RSB_I(rd_lo, rd_lo, 0), ctx);
+		}
+		goto out;
+	}
+
+	if (BPF_SRC(insn->code) == BPF_X) {
+		ebpf_get(rs_lo, insn->src_reg, ctx);
+	} else if (op == BPF_LSH || op == BPF_RSH || op == BPF_ARSH) {
+		k &= is64 ? 63 : 31;
+		goto shift_k;
+	} else if (op == BPF_DIV || op == BPF_MOD) {
+		/* the interpreter would divide by zero */
+		if (k == 0)
+			return -EINVAL;
+		ebpf_mov_i(rs_lo, k, ctx);
+	} else {
+		ebpf_mov_imm64(rs_lo, insn->imm, ctx);
+	}
+
+	switch (op) {
+	case BPF_MOV:
+		emit(ARM_MOV_R(rd_lo, rs_lo), ctx);
+		emit(ARM_MOV_R(rd_hi, rs_hi), ctx);
+		break;
+	case BPF_ADD:
+		if (is64) {
+			emit(ARM_ADDS_R(rd_lo, rd_lo, rs_lo), ctx);
+			emit(ARM_ADC_R(rd_hi, rd_hi, rs_hi), ctx);
+		} else {
+			emit(ARM_ADD_R(rd_lo, rd_lo, rs_lo), ctx);
+		}
+		break;
+	case BPF_SUB:
+		if (is64) {
+			emit(ARM_SUBS_R(rd_lo, rd_lo, rs_lo), ctx);
+			emit(ARM_SBC_R(rd_hi, rd_hi, rs_hi), ctx);
+		} else {
+			emit(ARM_SUB_R(rd_lo, rd_lo, rs_lo), ctx);
+		}
+		break;
+	case BPF_AND:
+		emit(ARM_AND_R(rd_lo, rd_lo, rs_lo), ctx);
+		emit(ARM_AND_R(rd_hi, rd_hi, rs_hi), ctx);
+		break;
+	case BPF_OR:
+		emit(ARM_ORR_R(rd_lo, rd_lo, rs_lo), ctx);
+		emit(ARM_ORR_R(rd_hi, rd_hi, rs_hi), ctx);
+		break;
+	case BPF_XOR:
+		emit(ARM_EOR_R(rd_lo, rd_lo, rs_lo), ctx);
+		emit(ARM_EOR_R(rd_hi, rd_hi, rs_hi), ctx);
+		break;
+	case BPF_MUL:
+		if (!is64) {
+			emit(ARM_MUL(rd_lo, rd_lo, rs_lo), ctx);
+			break;
+		}
+		/* the cross products only contribute to the high word */
+		emit(ARM_MUL(ARM_IP, rd_lo, rs_hi), ctx);
+		emit(ARM_MLA(ARM_IP, rd_hi, rs_lo, ARM_IP), ctx);
+		emit(ARM_UMULL(rd_lo, rd_hi, rd_lo, rs_lo), ctx);
+		emit(ARM_ADD_R(rd_hi, rd_hi, ARM_IP), ctx);
+		break;
+	case BPF_DIV:
+	case BPF_MOD:
+		if (BPF_SRC(insn->code) == BPF_X) {
+			/* division by zero makes the program return 0 */
+			if (is64)
+				emit(ARM_ORRS_R(ARM_IP, rs_lo, rs_hi), ctx);
+			else
+				emit(ARM_CMP_I(rs_lo, 0), ctx);
+			_emit(ARM_COND_EQ, ARM_B(ebpf_b_imm(ctx->skf->len,
+							      ctx)), ctx);
+		}
+		if (is64) {
+			emit(ARM_MOV_R(ARM_R0, rd_lo), ctx);
+			emit(ARM_MOV_R(ARM_R1, rd_hi), ctx);
+			emit(ARM_MOV_R(ARM_R2, rs_lo), ctx);
+			ebpf_call(op == BPF_DIV ? jit_div64 : jit_mod64, ctx);
+			emit(ARM_MOV_R(rd_lo, ARM_R0), ctx);
+			emit(ARM_MOV_R(rd_hi, ARM_R1), ctx);
+		} else if (op == BPF_DIV) {
+			emit_udiv(rd_lo, rd_lo, rs_lo, ctx);
+		} else if (elf_hwcap & HWCAP_IDIVA) {
+			emit(ARM_UDIV(ARM_IP, rd_lo, rs_lo), ctx);
+			emit(ARM_MLS(rd_lo, ARM_IP, rs_lo, rd_lo), ctx);
+		} else {
+			emit(ARM_MOV_R(ARM_R0, rd_lo), ctx);
+			emit(ARM_MOV_R(ARM_R1, rs_lo), ctx);
+			ebpf_call(jit_umod, ctx);
+			emit(ARM_MOV_R(rd_lo, ARM_R0), ctx);
+		}
+		break;
+	case BPF_LSH:
+		if (!is64) {
+			emit(ARM_LSL_R(rd_lo, rd_lo, rs_lo), ctx);
+			break;
+		}
+		/* register shifts by 32 or more yield 0 */
+		emit(ARM_SUB_I(ARM_IP, rs_lo, 32), ctx);
+		emit(ARM_RSB_I(rt_lo, rs_lo, 32), ctx);
+		emit(ARM_LSL_R(rd_hi, rd_hi, rs_lo), ctx);
+		emit(ARM_ORR_SR(rd_hi, rd_hi, rd_lo, SRTYPE_LSL, ARM_IP), ctx);
+		emit(ARM_ORR_SR(rd_hi, rd_hi, rd_lo, SRTYPE_LSR, rt_lo), ctx);
+		emit(ARM_LSL_R(rd_lo, rd_lo, rs_lo), ctx);
+		break;
+	case BPF_RSH:
+		if (!is64) {
+			emit(ARM_LSR_R(rd_lo, rd_lo, rs_lo), ctx);
+			break;
+		}
+		emit(ARM_SUB_I(ARM_IP, rs_lo, 32), ctx);
+		emit(ARM_RSB_I(rt_lo, rs_lo, 32), ctx);
+		emit(ARM_LSR_R(rd_lo, rd_lo, rs_lo), ctx);
+		emit(ARM_ORR_SR(rd_lo, rd_lo, rd_hi, SRTYPE_LSL, rt_lo), ctx);
+		emit(ARM_ORR_SR(rd_lo, rd_lo, rd_hi, SRTYPE_LSR, ARM_IP), ctx);
+		emit(ARM_LSR_R(rd_hi, rd_hi, rs_lo), ctx);
+		break;
+	case BPF_ARSH:
+		if (!is64)
+			return -EINVAL;
+		/* arithmetic shifts don't yield 0, skip them below 32 */
+		emit(ARM_SUBS_I(ARM_IP, rs_lo, 32), ctx);
+		emit(ARM_RSB_I(rt_lo, rs_lo, 32), ctx);
+		emit(ARM_LSR_R(rd_lo, rd_lo, rs_lo), ctx);
+		emit(ARM_ORR_SR(rd_lo, rd_lo, rd_hi, SRTYPE_LSL, rt_lo), ctx);
+		_emit(ARM_COND_PL, ARM_ORR_SR(rd_lo, rd_lo, rd_hi, SRTYPE_ASR,
+					      ARM_IP), ctx);
+		emit(ARM_ASR_R(rd_hi, rd_hi, rs_lo), ctx);
+		break;
+	default:
+		return -EINVAL;
+	}
+	goto out;
+
+shift_k:
+	/* immediate shifts by 0 must be skipped, "lsr #0" means 32 */
+	if (k == 0)
+		goto out;
+
+	switch (op) {
+	case BPF_LSH:
+		if (!is64) {
+			emit(ARM_LSL_I(rd_lo, rd_lo, k), ctx);
+		} else if (k < 32) {
+			emit(ARM_LSL_I(rd_hi, rd_hi, k), ctx);
+			emit(ARM_ORR_S(rd_hi, rd_hi, rd_lo, SRTYPE_LSR, 32 - k),
+			     ctx);
+			emit(ARM_LSL_I(rd_lo, rd_lo, k), ctx);
+		} else {
+			emit(ARM_LSL_I(rd_hi, rd_lo, k - 32), ctx);
+			emit(ARM_MOV_I(rd_lo, 0), ctx);
+		}
+		break;
+	case BPF_RSH:
+		if (!is64) {
+			emit(ARM_LSR_I(rd_lo, rd_lo, k), ctx);
+		} else if (k < 32) {
+			emit(ARM_LSR_I(rd_lo, rd_lo, k), ctx);
+			emit(ARM_ORR_S(rd_lo, rd_lo, rd_hi, SRTYPE_LSL, 32 - k),
+			     ctx);
+			emit(ARM_LSR_I(rd_hi, rd_hi, k), ctx);
+		} else {
+			if (k == 32)
+				emit(ARM_MOV_R(rd_lo, rd_hi), ctx);
+			else
+				emit(ARM_LSR_I(rd_lo, rd_hi, k - 32), ctx);
+			emit(ARM_MOV_I(rd_hi, 0), ctx);
+		}
+		break;
+	case BPF_ARSH:
+		if (!is64)
+			return -EINVAL;
+		if (k < 32) {
+			emit(ARM_LSR_I(rd_lo, rd_lo, k), ctx);
+			emit(ARM_ORR_S(rd_lo, rd_lo, rd_hi, SRTYPE_LSL, 32 - k),
+			     ctx);
+			emit(ARM_ASR_I(rd_hi, rd_hi, k), ctx);
+		} else {
+			if (k == 32)
+				emit(ARM_MOV_R(rd_lo, rd_hi), ctx);
+			else
+				emit(ARM_ASR_I(rd_lo, rd_hi, k - 32), ctx);
+			emit(ARM_ASR_I(rd_hi, rd_hi, 31), ctx);
+		}
+		break;
+	}
+
+out:
+	if (is64)
+		ebpf_put(rd_lo, insn->dst_reg, ctx);
+	else
+		ebpf_put32(rd_lo, insn->dst_reg, ctx);
+
+	return 0;
+}
+
+static int ebpf_build_end(const struct bpf_insn *insn, struct jit_ctx *ctx)
+{
+	ebpf_get(rd_lo, insn->dst_reg, ctx);
+
+	switch (insn->imm) {
+	case 16:
+		if (BPF_SRC(insn->code) == BPF_TO_BE)
+			emit(ARM_REV16(rd_lo, rd_lo), ctx);
+		emit(ARM_UXTH(rd_lo, rd_lo), ctx);
+		break;
+	case 32:
+		if (BPF_SRC(insn->code) == BPF_TO_BE)
+			emit(ARM_REV(rd_lo, rd_lo), ctx);
+		break;
+	case 64:
+		if (BPF_SRC(insn->code) == BPF_TO_BE) {
+			emit(ARM_REV(ARM_IP, rd_lo), ctx);
+			emit(ARM_REV(rd_lo, rd_hi), ctx);
+			emit(ARM_MOV_R(rd_hi, ARM_IP), ctx);
+		}
+		ebpf_put(rd_lo, insn->dst_reg, ctx);
+		return 0;
+	default:
+		return -EINVAL;
+	}
+
+	ebpf_put32(rd_lo, insn->dst_reg, ctx);
+	return 0;
+}
+
+static int ebpf_build_jmp(const struct bpf_insn *insn, int i,
+			  struct jit_ctx *ctx)
+{
+	unsigned tgt = i + 1 + insn->off;
+	u8 cond;
+
+	if (BPF_OP(insn->code) == BPF_JA) {
+		emit(ARM_B(ebpf_b_imm(tgt, ctx)), ctx);
+		return 0;
+	}
+
+	ebpf_get(rd_lo, insn->dst_reg, ctx);
+	if (BPF_SRC(insn->code) == BPF_X)
+		ebpf_get(rs_lo, insn->src_reg, ctx);
+	else
+		ebpf_mov_imm64(rs_lo, insn->imm, ctx);
+
+	switch (BPF_OP(insn->code)) {
+	case BPF_JEQ:
+	case BPF_JNE:
+	case BPF_JGT:
+	case BPF_JGE:
+		/* the low words only matter if the high words are equal */
+		emit(ARM_CMP_R(rd_hi, rs_hi), ctx);
+		_emit(ARM_COND_EQ, ARM_CMP_R(rd_lo, rs_lo), ctx);
+		switch (BPF_OP(insn->code)) {
+		case BPF_JEQ:
+			cond = ARM_COND_EQ;
+			break;
+		case BPF_JNE:
+			cond = ARM_COND_NE;
+			break;
+		case BPF_JGT:
+			cond = ARM_COND_HI;
+			break;
+		default:
+			cond = ARM_COND_HS;
+			break;
+		}
+		break;
+	case BPF_JSGT:
+		/* dst > src <=> src - dst < 0 */
+		emit(ARM_CMP_R(rs_lo, rd_lo), ctx);
+		emit(ARM_SBCS_R(ARM_IP, rs_hi, rd_hi), ctx);
+		cond = ARM_COND_LT;
+		break;
+	case BPF_JSGE:
+		emit(ARM_CMP_R(rd_lo, rs_lo), ctx);
+		emit(ARM_SBCS_R(ARM_IP, rd_hi, rs_hi), ctx);
+		cond = ARM_COND_GE;
+		break;
+	case BPF_JSET:
+		emit(ARM_AND_R(ARM_IP, rd_lo, rs_lo), ctx);
+		emit(ARM_AND_R(rt_lo, rd_hi, rs_hi), ctx);
+		emit(ARM_ORRS_R(ARM_IP, ARM_IP, rt_lo), ctx);
+		cond = ARM_COND_NE;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	_emit(cond, ARM_B(ebpf_b_imm(tgt, ctx)), ctx);
+	return 0;
+}
+
+static void ebpf_build_call(const struct bpf_insn *insn, struct jit_ctx *ctx)
+{
+	int i;
+
+	/* R1 and R2 go in r0-r3, R3-R5 on the stack */
+	for (i = 0; i < 3; i++) {
+		ebpf_get(rt_lo, BPF_REG_3 + i, ctx);
+		emit(ARM_STRD_I(rt_lo, ARM_SP, 8 * i), ctx);
+	}
+	ebpf_get(ARM_R0, BPF_REG_1, ctx);
+	ebpf_get(ARM_R2, BPF_REG_2, ctx);
+
+	ebpf_call((u8 *)__bpf_call_base + insn->imm, ctx);
+	ebpf_put(ARM_R0, BPF_REG_0, ctx);
+}
+
+static int ebpf_build_mem(const struct bpf_insn *insn, struct jit_ctx *ctx)
+{
+	const u8 size = BPF_SIZE(insn->code);
+	u8 addr;
+
+	if (BPF_CLASS(insn->code) == BPF_LDX) {
+		ebpf_get_lo(rs_lo, insn->src_reg, ctx);
+		addr = ebpf_addr(rs_lo, insn->off, ctx);
+
+		switch (size) {
+		case BPF_B:
+			emit(ARM_LDRB_I(rd_lo, addr, 0), ctx);
+			break;
+		case BPF_H:
+			emit(ARM_LDRH_I(rd_lo, addr, 0), ctx);
+			break;
+		case BPF_W:
+			emit(ARM_LDR_I(rd_lo, addr, 0), ctx);
+			break;
+		case BPF_DW:
+			emit(ARM_LDR_I(rd_lo, addr, 0), ctx);
+			emit(ARM_LDR_I(rd_hi, addr, 4), ctx);
+			ebpf_put(rd_lo, insn->dst_reg, ctx);
+			return 0;
+		}
+		ebpf_put32(rd_lo, insn->dst_reg, ctx);
+		return 0;
+	}
+
+	if (BPF_CLASS(insn->code) == BPF_STX)
+		ebpf_get(rs_lo, insn->src_reg, ctx);
+	else
+		ebpf_mov_imm64(rs_lo, insn->imm, ctx);
+	ebpf_get_lo(rd_lo, insn->dst_reg, ctx);
+	addr = ebpf_addr(rd_lo, insn->off, ctx);
+
+	if (BPF_MODE(insn->code) == BPF_XADD) {
+		/* rd_hi holds the exclusive store status */
+		if (size == BPF_W) {
+			emit(ARM_LDREX(rt_lo, addr), ctx);
+			emit(ARM_ADD_R(rt_lo, rt_lo, rs_lo), ctx);
+			emit(ARM_STREX(rd_hi, rt_lo, addr), ctx);
+			emit(ARM_TEQ_I(rd_hi, 0), ctx);
+			ebpf_emit_b_back(ARM_COND_NE, ctx->idx - 4, ctx);
+		} else if (size == BPF_DW) {
+			emit(ARM_LDREXD(rt_lo, addr), ctx);
+			emit(ARM_ADDS_R(rt_lo, rt_lo, rs_lo), ctx);
+			emit(ARM_ADC_R(rt_hi, rt_hi, rs_hi), ctx);
+			emit(ARM_STREXD(rd_hi, rt_lo, addr), ctx);
+			emit(ARM_TEQ_I(rd_hi, 0), ctx);
+			ebpf_emit_b_back(ARM_COND_NE, ctx->idx - 5, ctx);
+		} else {
+			return -EINVAL;
+		}
+		return 0;
+	}
+
+	switch (size) {
+	case BPF_B:
+		emit(ARM_STRB_I(rs_lo, addr, 0), ctx);
+		break;
+	case BPF_H:
+		emit(ARM_STRH_I(rs_lo, addr, 0), ctx);
+		break;
+	case BPF_W:
+		emit(ARM_STR_I(rs_lo, addr, 0), ctx);
+		break;
+	case BPF_DW:
+		emit(ARM_STR_I(rs_lo, addr, 0), ctx);
+		emit(ARM_STR_I(rs_hi, addr, 4), ctx);
+		break;
+	}
+	return 0;
+}
+
+/* R0 = the 1, 2 or 4 bytes at imm (+ src) in the skb held by R6 */
+static void ebpf_build_ld_skb(const struct bpf_insn *insn,
+			      struct jit_ctx *ctx)
+{
+	const unsigned int size = BPF_SIZE(insn->code) == BPF_B ? 1 :
+				  BPF_SIZE(insn->code) == BPF_H ? 2 : 4;
+	unsigned neg, big, done;
+
+	ebpf_get_lo(ARM_R0, BPF_REG_6, ctx);
+	if (BPF_MODE(insn->code) == BPF_IND) {
+		ebpf_get_lo(ARM_R1, insn->src_reg, ctx);
+		ebpf_add_i(ARM_R1, ARM_R1, insn->imm, ctx);
+	} else {
+		ebpf_mov_i(ARM_R1, insn->imm, ctx);
+	}
+
+	/* fast path: 0 <= off <= skb_headlen(skb) - size */
+	emit(ARM_LDR_I(ARM_R2, ARM_R0, offsetof(struct sk_buff, len)), ctx);
+	emit(ARM_LDR_I(ARM_R3, ARM_R0, offsetof(struct sk_buff, data_len)),
+	     ctx);
+	emit(ARM_SUB_R(ARM_R2, ARM_R2, ARM_R3), ctx);
+	emit(ARM_SUB_I(ARM_R2, ARM_R2, size), ctx);
+	emit(ARM_CMP_I(ARM_R1, 0), ctx);
+	neg = ebpf_emit_b_fwd(ctx);
+	emit(ARM_CMP_R(ARM_R1, ARM_R2), ctx);
+	big = ebpf_emit_b_fwd(ctx);
+
+	emit(ARM_LDR_I(ARM_R3, ARM_R0, offsetof(struct sk_buff, data)), ctx);
+	emit(ARM_ADD_R(ARM_R3, ARM_R3, ARM_R1), ctx);
+	switch (size) {
+	case 1:
+		emit(ARM_LDRB_I(rd_lo, ARM_R3, 0), ctx);
+		break;
+	case 2:
+		emit_load_be16(ARM_COND_AL, rd_lo, ARM_R3, ctx);
+		break;
+	default:
+		emit_load_be32(ARM_COND_AL, rd_lo, ARM_R3, ctx);
+		break;
+	}
+	done = ebpf_emit_b_fwd(ctx);
+
+	/* slow path, a failed load makes the program return 0 */
+	ebpf_patch_b_fwd(ARM_COND_LT, neg, ctx);
+	ebpf_patch_b_fwd(ARM_COND_GT, big, ctx);
+	emit(ARM_MOV_I(ARM_R2, size), ctx);
+	ebpf_call(jit_skb_load, ctx);
+	emit(ARM_CMP_I(ARM_R1, 0), ctx);
+	_emit(ARM_COND_NE, ARM_B(ebpf_b_imm(ctx->skf->len, ctx)), ctx);
+	emit(ARM_MOV_R(rd_lo, ARM_R0), ctx);
+
+	ebpf_patch_b_fwd(ARM_COND_AL, done, ctx);
+	ebpf_put32(rd_lo, BPF_REG_0, ctx);
+}
+
+static int ebpf_build_body(struct jit_ctx *ctx)
+{
+	const struct bpf_prog *prog = ctx->skf;
+	const struct bpf_insn *insn;
+	int i, ret;
+
+	for (i = 0; i < prog->len; i++) {
+		insn = &prog->insnsi[i];
+
+		/* compute offsets only during the first pass */
+		if (ctx->target == NULL)
+			ctx->offsets[i] = ctx->idx * 4;
+
+		switch (BPF_CLASS(insn->code)) {
+		case BPF_ALU:
+			if (BPF_OP(insn->code) == BPF_END) {
+				ret = ebpf_build_end(insn, ctx);
+				break;
+			}
+			/* fall through */
+		case BPF_ALU64:
+			ret = ebpf_build_alu(insn, ctx);
+			break;
+		case BPF_JMP:
+			ret = 0;
+			if (insn->code == (BPF_JMP | BPF_CALL)) {
+				ebpf_build_call(insn, ctx);
+			} else if (insn->code == (BPF_JMP | BPF_EXIT)) {
+				ebpf_get_lo(ARM_R0, BPF_REG_0, ctx);
+				/* skip the mov r0, #0 of the error exit */
+				emit(ARM_B(ebpf_b_imm(prog->len, ctx) + 1),
+				     ctx);
+			} else {
+				ret = ebpf_build_jmp(insn, i, ctx);
+			}
+			break;
+		case BPF_LD:
+			ret = 0;
+			if (insn->code == (BPF_LD | BPF_IMM | BPF_DW)) {
+				if (i + 1 == prog->len)
+					return -EINVAL;
+				ebpf_mov_i(rd_lo, insn[0].imm, ctx);
+				ebpf_mov_i(rd_hi, insn[1].imm, ctx);
+				ebpf_put(rd_lo, insn->dst_reg, ctx);
+				/* the second half is not a jump target */
+				i++;
+				if (ctx->target == NULL)
+					ctx->offsets[i] = ctx->idx * 4;
+			} else if (BPF_MODE(insn->code) == BPF_ABS ||
+				   BPF_MODE(insn->code) == BPF_IND) {
+				if (BPF_SIZE(insn->code) == BPF_DW)
+					return -EINVAL;
+				ebpf_build_ld_skb(insn, ctx);
+			} else {
+				ret = -EINVAL;
+			}
+			break;
+		case BPF_LDX:
+		case BPF_ST:
+		case BPF_STX:
+			if (BPF_MODE(insn->code) != BPF_MEM &&
+			    insn->code != (BPF_STX | BPF_XADD | BPF_W) &&
+			    insn->code != (BPF_STX | BPF_XADD | BPF_DW))
+				return -EINVAL;
+			ret = ebpf_build_mem(insn, ctx);
+			break;
+		default:
+			ret = -EINVAL;
+			break;
+		}
+
+		if (ret)
+			return ret;
+	}
+
+	if (ctx->target == NULL)
+		ctx->offsets[i] = ctx->idx * 4;
+
+	return 0;
+}
+
+void bpf_int_jit_compile(struct bpf_prog *prog)
+{
+	struct bpf_binary_header *header;
+	struct jit_ctx ctx;
+	unsigned alloc_size;
+	u8 *target_ptr;
+
+	if (!bpf_jit_enable)
+		return;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.skf = prog;
+
+	ctx.offsets = kcalloc(prog->len + 1, sizeof(u32), GFP_KERNEL);
+	if (ctx.offsets == NULL)
+		return;
+
+	/* the first pass only computes the offsets, including the prologue */
+	ebpf_build_prologue(&ctx);
+	if (ebpf_build_body(&ctx))
+		goto out;
+	ebpf_build_epilogue(&ctx);
+
+	alloc_size = 4 * ctx.idx;
+	header = bpf_jit_binary_alloc(alloc_size, &target_ptr,
+				      4, jit_fill_hole);
+	if (header == NULL)
+		goto out;
+
+	ctx.target = (u32 *) target_ptr;
+	ctx.idx = 0;
+
+	ebpf_build_prologue(&ctx);
+	ebpf_build_body(&ctx);
+	ebpf_build_epilogue(&ctx);
+
+	flush_icache_range((u32)ctx.target, (u32)(ctx.target + ctx.idx));
+
+	if (bpf_jit_enable > 1)
+		/* there are 2 passes here */
+		bpf_jit_dump(prog->len, alloc_size, 2, ctx.target);
+
+	set_memory_ro((unsigned long)header, header->pages);
+	prog->bpf_func = (void *)ctx.target;
+	prog->jited = true;
+out:
+	kfree(ctx.offsets);
+}
+
+#endif /* __LINUX_ARM_ARCH__ >= 7 && __LITTLE_ENDIAN */
+
 void bpf_jit_free(struct bpf_prog *fp)
 {
 	unsigned long addr = (unsigned long)fp->bpf_func & PAGE_MASK;
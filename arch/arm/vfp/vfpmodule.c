@@ -713,6 +713,28 @@ void kernel_neon_end(void)
 }
 EXPORT_SYMBOL(kernel_neon_end);
 
+/*
+ * For code with a non-NEON fallback: kernel mode NEON is not available in
+ * interrupt context, and kernel_neon_begin() must not nest either, as the
+ * inner kernel_neon_end() would turn the unit off under the outer user.
+ * The latter is the only case of the unit being on without an owner.
+ */
+bool kernel_neon_usable(void)
+{
+	unsigned int cpu;
+	bool usable;
+
+	if (in_interrupt())
+		return false;
+
+	cpu = get_cpu();
+	usable = vfp_current_hw_state[cpu] || !(fmrx(FPEXC) & FPEXC_EN);
+	put_cpu();
+
+	return usable;
+}
+EXPORT_SYMBOL(kernel_neon_usable);
+
 #endif /* CONFIG_KERNEL_MODE_NEON */
 
 /*
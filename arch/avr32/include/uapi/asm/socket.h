@@ -80,4 +80,8 @@
 
 #define SO_BPF_EXTENSIONS	48
 
+#define SO_ZEROCOPY		60
+
+#define SCM_TIMESTAMPING_STAGES	64
+
 #endif /* _UAPI__ASM_AVR32_SOCKET_H */
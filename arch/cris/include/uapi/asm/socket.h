@@ -82,6 +82,10 @@
 
 #define SO_BPF_EXTENSIONS	48
 
+#define SO_ZEROCOPY		60
+
+#define SCM_TIMESTAMPING_STAGES	64
+
 #endif /* _ASM_SOCKET_H */
 
 
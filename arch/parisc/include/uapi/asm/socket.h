@@ -79,4 +79,8 @@
 
 #define SO_BPF_EXTENSIONS	0x4029
 
+#define SO_ZEROCOPY		0x4035
+
+#define SCM_TIMESTAMPING_STAGES	0x4040
+
 #endif /* _UAPI_ASM_SOCKET_H */
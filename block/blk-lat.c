@@ -0,0 +1,170 @@
+/*
+ * Request latency histograms
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Once enabled in queue/lat_hist_enable, the time from issue to the
+ * driver until completion of every file system request of the queue is
+ * counted in power of two microsecond buckets, split by read, write,
+ * discard and flush and by request size. queue/lat_hist shows the upper
+ * bounds of the buckets on the first line and one line per request type
+ * and size that saw completions after that:
+ *
+ *	usec 1 2 4 8 16 32 64 128 256 ... 8388608 inf
+ *	read 4k 0 0 0 0 0 0 0 112 5013 ... 0 0
+ *
+ * Writing to queue/lat_hist clears the counts.
+ */
+
+#include <linux/kernel.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <linux/blkdev.h>
+
+#include "blk-lat.h"
+
+static const char *const blk_lat_type_names[BLK_LAT_TYPES] = {
+	[BLK_LAT_READ]		= "read",
+	[BLK_LAT_WRITE]		= "write",
+	[BLK_LAT_DISCARD]	= "discard",
+	[BLK_LAT_FLUSH]		= "flush",
+};
+
+static const char *const blk_lat_size_names[BLK_LAT_SIZES] = {
+	"4k", "16k", "64k", "256k", "max",
+};
+
+void __blk_lat_issue(struct request *rq)
+{
+	if (rq->cmd_type != REQ_TYPE_FS)
+		return;
+
+	rq->lat_bytes = blk_rq_bytes(rq);
+	rq->lat_issue_ns = ktime_get_ns();
+}
+
+static unsigned int blk_lat_type(struct request *rq)
+{
+	if (rq->cmd_flags & REQ_DISCARD)
+		return BLK_LAT_DISCARD;
+	if ((rq->cmd_flags & REQ_FLUSH) && !rq->lat_bytes)
+		return BLK_LAT_FLUSH;
+	return rq_data_dir(rq) == WRITE ? BLK_LAT_WRITE : BLK_LAT_READ;
+}
+
+/* 4k and less, then a class for every factor of four up to 256k */
+static unsigned int blk_lat_size(unsigned int bytes)
+{
+	if (bytes <= 4096)
+		return 0;
+	return min_t(unsigned int, (fls(bytes - 1) - 11) / 2,
+		     BLK_LAT_SIZES - 1);
+}
+
+void __blk_lat_done(struct request *rq)
+{
+	struct blk_lat_hist __percpu *hist = rq->q->lat_hist;
+	u64 usec = div_u64(ktime_get_ns() - rq->lat_issue_ns, NSEC_PER_USEC);
+	unsigned int bucket;
+
+	rq->lat_issue_ns = 0;
+	if (!hist)
+		return;
+
+	bucket = min_t(unsigned int, usec ? fls64(usec) : 0,
+		       BLK_LAT_BUCKETS - 1);
+	this_cpu_inc(hist->cnt[blk_lat_type(rq)][blk_lat_size(rq->lat_bytes)]
+			      [bucket]);
+}
+
+/* called with q->sysfs_lock held */
+int blk_lat_enable(struct request_queue *q, bool enable)
+{
+	if (enable && !q->lat_hist) {
+		q->lat_hist = alloc_percpu(struct blk_lat_hist);
+		if (!q->lat_hist)
+			return -ENOMEM;
+	}
+
+	spin_lock_irq(q->queue_lock);
+	if (enable)
+		queue_flag_set(QUEUE_FLAG_LAT_HIST, q);
+	else
+		queue_flag_clear(QUEUE_FLAG_LAT_HIST, q);
+	spin_unlock_irq(q->queue_lock);
+
+	return 0;
+}
+
+/* called with q->sysfs_lock held */
+ssize_t blk_lat_show(struct request_queue *q, char *page)
+{
+	struct blk_lat_hist *sum;
+	unsigned int t, s, b;
+	ssize_t len;
+	int cpu;
+
+	len = scnprintf(page, PAGE_SIZE, "usec");
+	for (b = 0; b < BLK_LAT_BUCKETS - 1; b++)
+		len += scnprintf(page + len, PAGE_SIZE - len, " %lu", 1UL << b);
+	len += scnprintf(page + len, PAGE_SIZE - len, " inf\n");
+
+	if (!q->lat_hist)
+		return len;
+
+	sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct blk_lat_hist *hist = per_cpu_ptr(q->lat_hist, cpu);
+
+		for (t = 0; t < BLK_LAT_TYPES; t++)
+			for (s = 0; s < BLK_LAT_SIZES; s++)
+				for (b = 0; b < BLK_LAT_BUCKETS; b++)
+					sum->cnt[t][s][b] += hist->cnt[t][s][b];
+	}
+
+	for (t = 0; t < BLK_LAT_TYPES; t++) {
+		for (s = 0; s < BLK_LAT_SIZES; s++) {
+			unsigned long *cnt = sum->cnt[t][s];
+
+			if (!memchr_inv(cnt, 0, sizeof(sum->cnt[t][s])))
+				continue;
+
+			len += scnprintf(page + len, PAGE_SIZE - len, "%s %s",
+					 blk_lat_type_names[t],
+					 blk_lat_size_names[s]);
+			for (b = 0; b < BLK_LAT_BUCKETS; b++)
+				len += scnprintf(page + len, PAGE_SIZE - len,
+						 " %lu", cnt[b]);
+			len += scnprintf(page + len, PAGE_SIZE - len, "\n");
+		}
+	}
+
+	kfree(sum);
+	return len;
+}
+
+/* called with q->sysfs_lock held, races with completions are harmless */
+void blk_lat_reset(struct request_queue *q)
+{
+	int cpu;
+
+	if (!q->lat_hist)
+		return;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(q->lat_hist, cpu), 0,
+		       sizeof(struct blk_lat_hist));
+}
+
+void blk_lat_exit(struct request_queue *q)
+{
+	free_percpu(q->lat_hist);
+	q->lat_hist = NULL;
+}
@@ -0,0 +1,69 @@
+#ifndef BLK_LAT_H
+#define BLK_LAT_H
+
+#include <linux/blkdev.h>
+
+/* request types, request sizes and log2 microsecond latency buckets */
+enum {
+	BLK_LAT_READ,
+	BLK_LAT_WRITE,
+	BLK_LAT_DISCARD,
+	BLK_LAT_FLUSH,
+	BLK_LAT_TYPES,
+};
+
+#define BLK_LAT_SIZES		5	/* <= 4k, 16k, 64k, 256k, larger */
+#define BLK_LAT_BUCKETS		25	/* < 1us, < 2us, ... < 2^23us, more */
+
+/*
+ * Per-cpu completion counts of a queue, from issue to the driver until
+ * completion, split by request type and size.
+ */
+struct blk_lat_hist {
+	unsigned long cnt[BLK_LAT_TYPES][BLK_LAT_SIZES][BLK_LAT_BUCKETS];
+};
+
+#ifdef CONFIG_BLK_LAT_HIST
+
+void __blk_lat_issue(struct request *rq);
+void __blk_lat_done(struct request *rq);
+int blk_lat_enable(struct request_queue *q, bool enable);
+ssize_t blk_lat_show(struct request_queue *q, char *page);
+void blk_lat_reset(struct request_queue *q);
+void blk_lat_exit(struct request_queue *q);
+
+static inline void blk_lat_init(struct request *rq)
+{
+	rq->lat_issue_ns = 0;
+}
+
+static inline void blk_lat_issue(struct request *rq)
+{
+	if (unlikely(blk_queue_lat_hist(rq->q)))
+		__blk_lat_issue(rq);
+}
+
+static inline void blk_lat_done(struct request *rq)
+{
+	if (unlikely(rq->lat_issue_ns))
+		__blk_lat_done(rq);
+}
+
+#else
+
+static inline void blk_lat_init(struct request *rq)
+{
+}
+static inline void blk_lat_issue(struct request *rq)
+{
+}
+static inline void blk_lat_done(struct request *rq)
+{
+}
+static inline void blk_lat_exit(struct request_queue *q)
+{
+}
+
+#endif /* CONFIG_BLK_LAT_HIST */
+
+#endif
@@ -260,6 +260,27 @@ static struct attribute *default_ctx_attrs[] = {
 	NULL,
 };
 
+static ssize_t blk_mq_hw_sysfs_poll_show(struct blk_mq_hw_ctx *hctx,
+					 char *page)
+{
+	struct blk_mq_poll_stat *stat = &hctx->poll_stat;
+
+	return sprintf(page, "considered=%lu, invoked=%lu, success=%lu, "
+		       "samples=%lu, mean_ns=%lu, min_ns=%lu, max_ns=%lu\n",
+		       hctx->poll_considered, hctx->poll_invoked,
+		       hctx->poll_success, stat->samples, stat->mean_ns,
+		       stat->min_ns, stat->max_ns);
+}
+
+static ssize_t blk_mq_hw_sysfs_poll_store(struct blk_mq_hw_ctx *hctx,
+					  const char *page, size_t size)
+{
+	hctx->poll_considered = hctx->poll_invoked = hctx->poll_success = 0;
+	memset(&hctx->poll_stat, 0, sizeof(hctx->poll_stat));
+
+	return size;
+}
+
 static struct blk_mq_hw_ctx_sysfs_entry blk_mq_hw_sysfs_queued = {
 	.attr = {.name = "queued", .mode = S_IRUGO },
 	.show = blk_mq_hw_sysfs_queued_show,
@@ -288,6 +309,11 @@ static struct blk_mq_hw_ctx_sysfs_entry blk_mq_hw_sysfs_cpus = {
 	.attr = {.name = "cpu_list", .mode = S_IRUGO },
 	.show = blk_mq_hw_sysfs_cpus_show,
 };
+static struct blk_mq_hw_ctx_sysfs_entry blk_mq_hw_sysfs_poll = {
+	.attr = {.name = "io_poll", .mode = S_IRUGO | S_IWUSR },
+	.show = blk_mq_hw_sysfs_poll_show,
+	.store = blk_mq_hw_sysfs_poll_store,
+};
 
 static struct attribute *default_hw_ctx_attrs[] = {
 	&blk_mq_hw_sysfs_queued.attr,
@@ -297,6 +323,7 @@ static struct attribute *default_hw_ctx_attrs[] = {
 	&blk_mq_hw_sysfs_tags.attr,
 	&blk_mq_hw_sysfs_cpus.attr,
 	&blk_mq_hw_sysfs_active.attr,
+	&blk_mq_hw_sysfs_poll.attr,
 	NULL,
 };
 
@@ -28,6 +28,8 @@
 #include "blk.h"
 #include "blk-mq.h"
 #include "blk-mq-tag.h"
+#include "blk-wbt.h"
+#include "blk-lat.h"
 
 static DEFINE_MUTEX(all_q_mutex);
 static LIST_HEAD(all_q_list);
@@ -35,17 +37,19 @@ static LIST_HEAD(all_q_list);
 static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx);
 
 /*
- * Check if any of the ctx's have pending work in this hardware queue
+ * Check if any of the ctx's or the I/O scheduler have pending work in this
+ * hardware queue
  */
 static bool blk_mq_hctx_has_pending(struct blk_mq_hw_ctx *hctx)
 {
+	struct elevator_queue *e = hctx->queue->elevator;
 	unsigned int i;
 
 	for (i = 0; i < hctx->ctx_map.map_size; i++)
 		if (hctx->ctx_map.map[i].word)
 			return true;
 
-	return false;
+	return e && e->type->mq_ops.has_work(hctx);
 }
 
 static inline struct blk_align_bitmap *get_bm(struct blk_mq_hw_ctx *hctx,
@@ -136,7 +140,7 @@ void blk_mq_freeze_queue(struct request_queue *q)
 	blk_mq_freeze_queue_wait(q);
 }
 
-static void blk_mq_unfreeze_queue(struct request_queue *q)
+void blk_mq_unfreeze_queue(struct request_queue *q)
 {
 	bool wake;
 
@@ -200,6 +204,8 @@ static void blk_mq_rq_ctx_init(struct request_queue *q, struct blk_mq_ctx *ctx,
 	rq->end_io = NULL;
 	rq->end_io_data = NULL;
 	rq->next_rq = NULL;
+	wbt_track(rq, 0);
+	blk_lat_init(rq);
 
 	ctx->rq_dispatched[rw_is_sync(rw_flags)]++;
 }
@@ -270,6 +276,8 @@ static void __blk_mq_free_request(struct blk_mq_hw_ctx *hctx,
 	const int tag = rq->tag;
 	struct request_queue *q = rq->q;
 
+	wbt_done(q->rq_wb, rq);
+
 	if (rq->cmd_flags & REQ_MQ_INFLIGHT)
 		atomic_dec(&hctx->nr_active);
 	rq->cmd_flags = 0;
@@ -294,6 +302,7 @@ void blk_mq_free_request(struct request *rq)
 inline void __blk_mq_end_request(struct request *rq, int error)
 {
 	blk_account_io_done(rq);
+	blk_lat_done(rq);
 
 	if (rq->end_io) {
 		rq->end_io(rq, error);
@@ -375,6 +384,124 @@ void blk_mq_complete_request(struct request *rq)
 }
 EXPORT_SYMBOL(blk_mq_complete_request);
 
+static void blk_mq_poll_stat_add(struct blk_mq_hw_ctx *hctx,
+				 struct blk_poll_wait *wait)
+{
+	struct blk_mq_poll_stat *stat = &hctx->poll_stat;
+	unsigned long lat = ktime_get_ns() - wait->start_ns;
+
+	/* Racy updates from several CPUs only blur the statistics */
+	if (!stat->samples++) {
+		stat->mean_ns = stat->min_ns = stat->max_ns = lat;
+		return;
+	}
+
+	stat->mean_ns = (stat->mean_ns * 7 + lat) / 8;
+	stat->min_ns = min(stat->min_ns, lat);
+	stat->max_ns = max(stat->max_ns, lat);
+}
+
+/*
+ * Sleep once per wait before spinning, so that a device taking tens of
+ * microseconds does not keep the CPU busy for all of them. Returns true if
+ * the caller has to check for completion again.
+ */
+static bool blk_mq_poll_hybrid_sleep(struct request_queue *q,
+				     struct blk_mq_hw_ctx *hctx,
+				     struct blk_poll_wait *wait)
+{
+	struct hrtimer_sleeper hs;
+	unsigned long nsecs;
+
+	if (wait->slept || q->poll_nsec < 0)
+		return false;
+	wait->slept = true;
+
+	if (q->poll_nsec)
+		nsecs = q->poll_nsec;
+	else
+		nsecs = hctx->poll_stat.mean_ns / 2;
+	if (!nsecs)
+		return false;
+
+	/*
+	 * The caller is set up to be woken by the completion, which ends
+	 * the sleep early.
+	 */
+	hrtimer_init_on_stack(&hs.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	hrtimer_set_expires(&hs.timer, ktime_set(0, nsecs));
+	hrtimer_init_sleeper(&hs, current);
+	hrtimer_start_expires(&hs.timer, HRTIMER_MODE_REL);
+	if (hs.task)
+		io_schedule();
+	hrtimer_cancel(&hs.timer);
+	destroy_hrtimer_on_stack(&hs.timer);
+
+	__set_current_state(TASK_RUNNING);
+	return true;
+}
+
+/**
+ * blk_poll - poll for the completion of I/O instead of sleeping
+ * @q:    queue the I/O was submitted to
+ * @wait: polling state of this wait
+ *
+ * Called by a task that has submitted I/O, set its state and arranged to
+ * be woken by the completion, in place of io_schedule(). Spins on the
+ * hardware queue of the current CPU if polling is enabled on @q.
+ *
+ * Returns true if the caller has to check for completion again, false if
+ * it has to sleep as usual.
+ */
+bool blk_poll(struct request_queue *q, struct blk_poll_wait *wait)
+{
+	struct blk_mq_hw_ctx *hctx;
+	long state;
+
+	if (!q->mq_ops || !q->mq_ops->poll || !blk_queue_poll(q))
+		return false;
+
+	if (!wait->hctx) {
+		wait->hctx = q->mq_ops->map_queue(q, raw_smp_processor_id());
+		wait->start_ns = ktime_get_ns();
+	}
+	hctx = wait->hctx;
+
+	if (blk_mq_poll_hybrid_sleep(q, hctx, wait))
+		return true;
+
+	hctx->poll_considered++;
+
+	state = current->state;
+	while (!need_resched()) {
+		int ret;
+
+		hctx->poll_invoked++;
+
+		ret = q->mq_ops->poll(hctx);
+		if (ret > 0)
+			hctx->poll_success++;
+
+		/* The completion woke us up */
+		if (current->state == TASK_RUNNING) {
+			blk_mq_poll_stat_add(hctx, wait);
+			return true;
+		}
+
+		if (signal_pending_state(state, current)) {
+			set_current_state(TASK_RUNNING);
+			return true;
+		}
+
+		if (ret < 0)
+			break;
+		cpu_relax();
+	}
+
+	return false;
+}
+EXPORT_SYMBOL_GPL(blk_poll);
+
 void blk_mq_start_request(struct request *rq)
 {
 	struct request_queue *q = rq->q;
@@ -386,6 +513,8 @@ void blk_mq_start_request(struct request *rq)
 		rq->next_rq->resid_len = blk_rq_bytes(rq->next_rq);
 
 	blk_add_timer(rq);
+	wbt_issue(q->rq_wb, rq);
+	blk_lat_issue(rq);
 
 	/*
 	 * Ensure that ->deadline is visible before set the started
@@ -679,6 +808,51 @@ static void flush_busy_ctxs(struct blk_mq_hw_ctx *hctx, struct list_head *list)
 	}
 }
 
+/*
+ * Hand the requests pulled from the software queues to the I/O scheduler.
+ * Flush sequences and passthrough requests are not scheduled, they are
+ * left on @list and go to the driver first.
+ */
+static void blk_mq_sched_insert_requests(struct blk_mq_hw_ctx *hctx,
+					 struct list_head *list)
+{
+	struct elevator_queue *e = hctx->queue->elevator;
+	struct request *rq, *next;
+	LIST_HEAD(sched_list);
+
+	list_for_each_entry_safe(rq, next, list, queuelist) {
+		if (rq->cmd_type != REQ_TYPE_FS ||
+		    (rq->cmd_flags & REQ_FLUSH_SEQ))
+			continue;
+		list_move_tail(&rq->queuelist, &sched_list);
+	}
+
+	if (!list_empty(&sched_list))
+		e->type->mq_ops.insert_requests(hctx, &sched_list);
+}
+
+/*
+ * Next request to send to the driver, the I/O scheduler is only asked
+ * once everything pulled in directly has been issued.
+ */
+static struct request *blk_mq_next_request(struct blk_mq_hw_ctx *hctx,
+					   struct list_head *list)
+{
+	struct elevator_queue *e = hctx->queue->elevator;
+	struct request *rq;
+
+	if (!list_empty(list)) {
+		rq = list_first_entry(list, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		return rq;
+	}
+
+	if (e)
+		return e->type->mq_ops.dispatch_request(hctx);
+
+	return NULL;
+}
+
 /*
  * Run this hardware queue, pulling any software queues mapped to it in.
  * Note that this function currently has various problems around ordering
@@ -703,6 +877,8 @@ static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx)
 	 * Touch any software queue that has pending entries.
 	 */
 	flush_busy_ctxs(hctx, &rq_list);
+	if (q->elevator)
+		blk_mq_sched_insert_requests(hctx, &rq_list);
 
 	/*
 	 * If we have previous entries on our dispatch list, grab them
@@ -719,13 +895,14 @@ static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx)
 	 * Now process all the entries, sending them to the driver.
 	 */
 	queued = 0;
-	while (!list_empty(&rq_list)) {
+	while ((rq = blk_mq_next_request(hctx, &rq_list)) != NULL) {
+		bool last = list_empty(&rq_list);
 		int ret;
 
-		rq = list_first_entry(&rq_list, struct request, queuelist);
-		list_del_init(&rq->queuelist);
+		if (last && q->elevator)
+			last = !q->elevator->type->mq_ops.has_work(hctx);
 
-		ret = q->mq_ops->queue_rq(hctx, rq, list_empty(&rq_list));
+		ret = q->mq_ops->queue_rq(hctx, rq, last);
 		switch (ret) {
 		case BLK_MQ_RQ_QUEUE_OK:
 			queued++;
@@ -1097,8 +1274,12 @@ static struct request *blk_mq_map_request(struct request_queue *q,
 	struct request *rq;
 	int rw = bio_data_dir(bio);
 	struct blk_mq_alloc_data alloc_data;
+	unsigned int wb_acct;
+
+	wb_acct = wbt_wait(q->rq_wb, bio->bi_rw, NULL);
 
 	if (unlikely(blk_mq_queue_enter(q))) {
+		__wbt_done(q->rq_wb, wb_acct);
 		bio_endio(bio, -EIO);
 		return NULL;
 	}
@@ -1127,6 +1308,7 @@ static struct request *blk_mq_map_request(struct request_queue *q,
 		hctx = alloc_data.hctx;
 	}
 
+	wbt_track(rq, wb_acct);
 	hctx->queued++;
 	data->hctx = hctx;
 	data->ctx = ctx;
@@ -1162,7 +1344,11 @@ static void blk_mq_make_request(struct request_queue *q, struct bio *bio)
 		goto run_queue;
 	}
 
-	if (is_sync) {
+	/*
+	 * With an I/O scheduler attached, it decides when the request is
+	 * sent to the driver.
+	 */
+	if (is_sync && !q->elevator) {
 		int ret;
 
 		blk_mq_bio_to_request(rq, bio);
@@ -1850,6 +2036,7 @@ struct request_queue *blk_mq_init_queue(struct blk_mq_tag_set *set)
 		q->queue_flags |= 1 << QUEUE_FLAG_NO_SG_MERGE;
 
 	q->sg_reserved_size = INT_MAX;
+	q->poll_nsec = -1;
 
 	INIT_WORK(&q->requeue_work, blk_mq_requeue_work);
 	INIT_LIST_HEAD(&q->requeue_list);
@@ -0,0 +1,319 @@
+/*
+ * Writeback throttling based on read completion latency
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Buffered writeback can fill the request queue of a slow device, and
+ * reads then wait behind all of it. The number of buffered writes in
+ * flight is limited per queue, and the limit is adjusted every window
+ * from the fastest read completion seen in it: while reads miss the
+ * latency target the write depth is halved, when they meet it the depth
+ * grows back towards the queue depth. Writes that someone waits for
+ * (REQ_SYNC, flushes, FUA) are never throttled.
+ */
+#include <linux/kernel.h>
+#include <linux/blkdev.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/swap.h>
+
+#include "blk-wbt.h"
+
+/* default write depth before any scaling, bounded by the queue depth */
+#define RWB_DEF_DEPTH		16
+
+/* monitoring window */
+#define RWB_WINDOW_NSEC		(100 * NSEC_PER_MSEC)
+
+/* default read latency targets */
+#define RWB_NONROT_LAT_NSEC	(2 * NSEC_PER_MSEC)
+#define RWB_ROT_LAT_NSEC	(75 * NSEC_PER_MSEC)
+
+/* a read within this long makes writers back off to wb_background */
+#define RWB_CLOSE_IO_JIFFIES	(HZ / 10)
+
+static bool wbt_should_throttle(unsigned long rw)
+{
+	return (rw & REQ_WRITE) &&
+		!(rw & (REQ_SYNC | REQ_DISCARD | REQ_FLUSH | REQ_FUA));
+}
+
+/*
+ * Returns the write depth for the given scale step, or 0 if it can not
+ * be scaled that far.
+ */
+static unsigned int rwb_depth(struct rq_wb *rwb, int step)
+{
+	unsigned int depth = min_t(unsigned int, RWB_DEF_DEPTH,
+				   rwb->queue_depth);
+
+	if (step > 0) {
+		if (step >= 31 || (depth >> (step - 1)) <= 1)
+			return 0;
+		return max(depth >> step, 1U);
+	}
+
+	if (step < 0) {
+		if (-step >= 31 || (depth << (-step - 1)) >= rwb->queue_depth)
+			return 0;
+		return min(depth << -step, rwb->queue_depth);
+	}
+
+	return depth;
+}
+
+static void rwb_calc_limits(struct rq_wb *rwb)
+{
+	unsigned int depth = rwb_depth(rwb, rwb->scale_step);
+
+	rwb->wb_max = depth;
+	rwb->wb_normal = max((depth + 1) / 2, 1U);
+	rwb->wb_background = max((depth + 3) / 4, 1U);
+}
+
+static void rwb_scale(struct rq_wb *rwb, int step)
+{
+	if (!rwb_depth(rwb, step))
+		return;
+
+	rwb->scale_step = step;
+	rwb_calc_limits(rwb);
+
+	/* more writes may go now, or waiters must see the new limits */
+	wake_up_all(&rwb->wait);
+}
+
+static void rwb_arm_timer(struct rq_wb *rwb)
+{
+	if (!timer_pending(&rwb->window_timer))
+		mod_timer(&rwb->window_timer,
+			  jiffies + nsecs_to_jiffies(rwb->win_nsec));
+}
+
+static void wbt_timer_fn(unsigned long data)
+{
+	struct rq_wb *rwb = (struct rq_wb *)data;
+	unsigned int nr_reads;
+	unsigned long flags;
+	u64 min_read;
+
+	spin_lock_irqsave(&rwb->lock, flags);
+	nr_reads = rwb->nr_reads;
+	min_read = rwb->min_read_nsec;
+	rwb->nr_reads = 0;
+	spin_unlock_irqrestore(&rwb->lock, flags);
+
+	if (!rwb->min_lat_nsec)
+		return;
+
+	if (nr_reads) {
+		/* slow reads only count against writes that were around */
+		if (min_read > rwb->min_lat_nsec) {
+			if (atomic_read(&rwb->inflight) ||
+			    time_before(jiffies, rwb->last_issue +
+					nsecs_to_jiffies(rwb->win_nsec)))
+				rwb_scale(rwb, rwb->scale_step + 1);
+		} else if (atomic_read(&rwb->inflight) >= rwb->wb_normal)
+			rwb_scale(rwb, rwb->scale_step - 1);
+	} else if (rwb->scale_step > 0) {
+		/* no reads to protect, head back to the default depth */
+		rwb_scale(rwb, rwb->scale_step - 1);
+	} else if (rwb->scale_step < 0) {
+		rwb_scale(rwb, rwb->scale_step + 1);
+	}
+
+	if (nr_reads || rwb->scale_step || atomic_read(&rwb->inflight))
+		rwb_arm_timer(rwb);
+}
+
+static unsigned int rwb_limit(struct rq_wb *rwb)
+{
+	/* don't stall reclaim behind the flusher threads */
+	if (current_is_kswapd())
+		return rwb->wb_max;
+
+	if (time_before(jiffies, rwb->last_comp + RWB_CLOSE_IO_JIFFIES))
+		return rwb->wb_background;
+
+	return rwb->wb_normal;
+}
+
+static bool rwb_inflight_inc_below(struct rq_wb *rwb)
+{
+	int cur = atomic_read(&rwb->inflight);
+
+	for (;;) {
+		int old;
+
+		if (cur >= rwb_limit(rwb))
+			return false;
+
+		old = atomic_cmpxchg(&rwb->inflight, cur, cur + 1);
+		if (old == cur)
+			return true;
+		cur = old;
+	}
+}
+
+/**
+ * wbt_wait - throttle a buffered write
+ * @rwb: writeback throttling state of the queue, may be %NULL
+ * @rw: flags of the bio about to be turned into a request
+ * @lock: lock held by the caller, dropped while sleeping, may be %NULL
+ *
+ * Returns the flags the new request has to be tracked with, and that
+ * have to be passed to __wbt_done() if no request is allocated after all.
+ */
+unsigned int wbt_wait(struct rq_wb *rwb, unsigned long rw, spinlock_t *lock)
+{
+	DEFINE_WAIT(wait);
+
+	if (!rwb || !rwb->min_lat_nsec || !wbt_should_throttle(rw))
+		return 0;
+
+	if (!waitqueue_active(&rwb->wait) && rwb_inflight_inc_below(rwb))
+		goto out;
+
+	for (;;) {
+		prepare_to_wait_exclusive(&rwb->wait, &wait,
+					  TASK_UNINTERRUPTIBLE);
+
+		if (!rwb->min_lat_nsec) {
+			atomic_inc(&rwb->inflight);
+			break;
+		}
+		if (rwb_inflight_inc_below(rwb))
+			break;
+
+		if (lock)
+			spin_unlock_irq(lock);
+		io_schedule();
+		if (lock)
+			spin_lock_irq(lock);
+	}
+	finish_wait(&rwb->wait, &wait);
+out:
+	rwb->last_issue = jiffies;
+	rwb_arm_timer(rwb);
+	return WBT_TRACKED;
+}
+
+void __wbt_done(struct rq_wb *rwb, unsigned int flags)
+{
+	int inflight;
+
+	if (!rwb || !(flags & WBT_TRACKED))
+		return;
+
+	inflight = atomic_dec_return(&rwb->inflight);
+	if (waitqueue_active(&rwb->wait) &&
+	    (!inflight || inflight < rwb->wb_normal))
+		wake_up(&rwb->wait);
+}
+
+/*
+ * Called when a request is freed, samples the latency of reads and
+ * releases the slot of a throttled write.
+ */
+void wbt_done(struct rq_wb *rwb, struct request *rq)
+{
+	if (!rwb)
+		return;
+
+	if (rq->wbt_flags & WBT_READ) {
+		u64 lat = ktime_get_ns() - rq->wbt_issue_ns;
+		unsigned long flags;
+
+		spin_lock_irqsave(&rwb->lock, flags);
+		if (!rwb->nr_reads || lat < rwb->min_read_nsec)
+			rwb->min_read_nsec = lat;
+		rwb->nr_reads++;
+		rwb->last_comp = jiffies;
+		spin_unlock_irqrestore(&rwb->lock, flags);
+
+		rwb_arm_timer(rwb);
+	}
+
+	__wbt_done(rwb, rq->wbt_flags);
+	rq->wbt_flags = 0;
+}
+
+/*
+ * Called when a request is handed to the driver, reads remember the time
+ * so their completion latency can be sampled.
+ */
+void wbt_issue(struct rq_wb *rwb, struct request *rq)
+{
+	if (!rwb || !rwb->min_lat_nsec)
+		return;
+
+	if (rq->cmd_type == REQ_TYPE_FS && rq_data_dir(rq) == READ) {
+		rq->wbt_flags |= WBT_READ;
+		rq->wbt_issue_ns = ktime_get_ns();
+	}
+}
+
+void wbt_set_queue_depth(struct rq_wb *rwb, unsigned int depth)
+{
+	if (!rwb)
+		return;
+
+	rwb->queue_depth = max(depth, 1U);
+	rwb->scale_step = 0;
+	rwb_calc_limits(rwb);
+	wake_up_all(&rwb->wait);
+}
+
+void wbt_set_min_lat(struct rq_wb *rwb, u64 min_lat_nsec)
+{
+	rwb->min_lat_nsec = min_lat_nsec;
+	rwb->scale_step = 0;
+	rwb_calc_limits(rwb);
+	wake_up_all(&rwb->wait);
+}
+
+int wbt_init(struct request_queue *q)
+{
+	struct rq_wb *rwb;
+
+	if (q->rq_wb)
+		return 0;
+
+	rwb = kzalloc_node(sizeof(*rwb), GFP_KERNEL, q->node);
+	if (!rwb)
+		return -ENOMEM;
+
+	spin_lock_init(&rwb->lock);
+	atomic_set(&rwb->inflight, 0);
+	init_waitqueue_head(&rwb->wait);
+	setup_timer(&rwb->window_timer, wbt_timer_fn, (unsigned long)rwb);
+	rwb->q = q;
+	rwb->win_nsec = RWB_WINDOW_NSEC;
+
+	if (blk_queue_nonrot(q))
+		rwb->min_lat_nsec = RWB_NONROT_LAT_NSEC;
+	else
+		rwb->min_lat_nsec = RWB_ROT_LAT_NSEC;
+
+	wbt_set_queue_depth(rwb, q->nr_requests);
+
+	q->rq_wb = rwb;
+	return 0;
+}
+
+void wbt_exit(struct request_queue *q)
+{
+	struct rq_wb *rwb = q->rq_wb;
+
+	if (!rwb)
+		return;
+
+	del_timer_sync(&rwb->window_timer);
+	q->rq_wb = NULL;
+	kfree(rwb);
+}
@@ -0,0 +1,97 @@
+#ifndef BLK_WBT_H
+#define BLK_WBT_H
+
+#include <linux/atomic.h>
+#include <linux/blkdev.h>
+#include <linux/spinlock.h>
+#include <linux/timer.h>
+#include <linux/wait.h>
+
+/* rq->wbt_flags */
+enum {
+	WBT_TRACKED	= 1,	/* write counted against the throttle */
+	WBT_READ	= 2,	/* read whose completion latency is sampled */
+};
+
+/*
+ * Writeback throttling state of a request queue. Buffered writes are
+ * limited to a depth that is scaled down for as long as reads complete
+ * slower than min_lat_nsec, and scaled back up once they meet it.
+ */
+struct rq_wb {
+	/*
+	 * Write depths for the current scale step: wb_max for kswapd,
+	 * wb_background while reads are completing, wb_normal otherwise.
+	 */
+	unsigned int wb_max;
+	unsigned int wb_normal;
+	unsigned int wb_background;
+
+	unsigned int queue_depth;
+	int scale_step;
+
+	u64 min_lat_nsec;		/* read latency target, 0 disables */
+	u64 win_nsec;			/* length of a monitoring window */
+	struct timer_list window_timer;
+
+	spinlock_t lock;		/* protects the window statistics */
+	unsigned int nr_reads;
+	u64 min_read_nsec;
+	unsigned long last_comp;	/* last read completion, jiffies */
+	unsigned long last_issue;	/* last throttled write, jiffies */
+
+	atomic_t inflight;
+	wait_queue_head_t wait;
+
+	struct request_queue *q;
+};
+
+#ifdef CONFIG_BLK_WBT
+
+int wbt_init(struct request_queue *q);
+void wbt_exit(struct request_queue *q);
+unsigned int wbt_wait(struct rq_wb *rwb, unsigned long rw, spinlock_t *lock);
+void __wbt_done(struct rq_wb *rwb, unsigned int flags);
+void wbt_done(struct rq_wb *rwb, struct request *rq);
+void wbt_issue(struct rq_wb *rwb, struct request *rq);
+void wbt_set_queue_depth(struct rq_wb *rwb, unsigned int depth);
+void wbt_set_min_lat(struct rq_wb *rwb, u64 min_lat_nsec);
+
+static inline void wbt_track(struct request *rq, unsigned int flags)
+{
+	rq->wbt_flags = flags;
+}
+
+#else
+
+static inline int wbt_init(struct request_queue *q)
+{
+	return 0;
+}
+static inline void wbt_exit(struct request_queue *q)
+{
+}
+static inline unsigned int wbt_wait(struct rq_wb *rwb, unsigned long rw,
+				    spinlock_t *lock)
+{
+	return 0;
+}
+static inline void __wbt_done(struct rq_wb *rwb, unsigned int flags)
+{
+}
+static inline void wbt_done(struct rq_wb *rwb, struct request *rq)
+{
+}
+static inline void wbt_issue(struct rq_wb *rwb, struct request *rq)
+{
+}
+static inline void wbt_set_queue_depth(struct rq_wb *rwb, unsigned int depth)
+{
+}
+static inline void wbt_track(struct request *rq, unsigned int flags)
+{
+}
+
+#endif /* CONFIG_BLK_WBT */
+
+#endif
@@ -39,6 +39,7 @@
 #include <trace/events/block.h>
 
 #include "blk.h"
+#include "blk-mq.h"
 #include "blk-cgroup.h"
 
 static DEFINE_SPINLOCK(elv_list_lock);
@@ -96,7 +97,8 @@ static void elevator_put(struct elevator_type *e)
 	module_put(e->elevator_owner);
 }
 
-static struct elevator_type *elevator_get(const char *name, bool try_loading)
+static struct elevator_type *elevator_get(const char *name, bool mq,
+					  bool try_loading)
 {
 	struct elevator_type *e;
 
@@ -110,7 +112,8 @@ static struct elevator_type *elevator_get(const char *name, bool try_loading)
 		e = elevator_find(name);
 	}
 
-	if (e && !try_module_get(e->elevator_owner))
+	/* legacy and blk-mq schedulers only work on their own kind of queue */
+	if (e && (e->uses_mq != mq || !try_module_get(e->elevator_owner)))
 		e = NULL;
 
 	spin_unlock(&elv_list_lock);
@@ -201,7 +204,7 @@ int elevator_init(struct request_queue *q, char *name)
 	q->boundary_rq = NULL;
 
 	if (name) {
-		e = elevator_get(name, true);
+		e = elevator_get(name, false, true);
 		if (!e)
 			return -EINVAL;
 	}
@@ -212,19 +215,19 @@ int elevator_init(struct request_queue *q, char *name)
 	 * off async and request_module() isn't allowed from async.
 	 */
 	if (!e && *chosen_elevator) {
-		e = elevator_get(chosen_elevator, false);
+		e = elevator_get(chosen_elevator, false, false);
 		if (!e)
 			printk(KERN_ERR "I/O scheduler %s not found\n",
 							chosen_elevator);
 	}
 
 	if (!e) {
-		e = elevator_get(CONFIG_DEFAULT_IOSCHED, false);
+		e = elevator_get(CONFIG_DEFAULT_IOSCHED, false, false);
 		if (!e) {
 			printk(KERN_ERR
 				"Default I/O scheduler not found. " \
 				"Using noop.\n");
-			e = elevator_get("noop", false);
+			e = elevator_get("noop", false, false);
 		}
 	}
 
@@ -238,7 +241,9 @@ EXPORT_SYMBOL(elevator_init);
 void elevator_exit(struct elevator_queue *e)
 {
 	mutex_lock(&e->sysfs_lock);
-	if (e->type->ops.elevator_exit_fn)
+	if (e->type->uses_mq)
+		e->type->mq_ops.exit_sched(e);
+	else if (e->type->ops.elevator_exit_fn)
 		e->type->ops.elevator_exit_fn(e);
 	mutex_unlock(&e->sysfs_lock);
 
@@ -946,6 +951,58 @@ fail_init:
 	return err;
 }
 
+/*
+ * blk-mq queues have no bypass mode, they are frozen instead so that no
+ * request is left in the old scheduler.  Both schedulers would hang their
+ * data off the same hardware queues, so the old one goes first and a
+ * failed switch leaves the queue without a scheduler.  @new_e is NULL to
+ * go back to issuing requests directly.
+ */
+static int elevator_switch_mq(struct request_queue *q,
+			      struct elevator_type *new_e)
+{
+	struct elevator_queue *old = q->elevator;
+	bool registered = q->kobj.state_in_sysfs;
+	int err = 0;
+
+	blk_mq_freeze_queue(q);
+	blk_sync_queue(q);
+
+	if (old) {
+		if (old->registered)
+			elv_unregister_queue(q);
+
+		spin_lock_irq(q->queue_lock);
+		q->elevator = NULL;
+		spin_unlock_irq(q->queue_lock);
+		elevator_exit(old);
+	}
+
+	if (!new_e)
+		goto out;
+
+	err = new_e->mq_ops.init_sched(q, new_e);
+	if (err)
+		goto out;
+
+	if (registered) {
+		err = elv_register_queue(q);
+		if (err) {
+			old = q->elevator;
+			spin_lock_irq(q->queue_lock);
+			q->elevator = NULL;
+			spin_unlock_irq(q->queue_lock);
+			elevator_exit(old);
+			goto out;
+		}
+	}
+
+	blk_add_trace_msg(q, "elv switch: %s", new_e->elevator_name);
+out:
+	blk_mq_unfreeze_queue(q);
+	return err;
+}
+
 /*
  * Switch this queue to the given IO scheduler.
  */
@@ -954,21 +1011,33 @@ static int __elevator_change(struct request_queue *q, const char *name)
 	char elevator_name[ELV_NAME_MAX];
 	struct elevator_type *e;
 
-	if (!q->elevator)
+	if (!q->elevator && !q->mq_ops)
 		return -ENXIO;
 
 	strlcpy(elevator_name, name, sizeof(elevator_name));
-	e = elevator_get(strstrip(elevator_name), true);
+	name = strstrip(elevator_name);
+
+	if (q->mq_ops && !strcmp(name, "none")) {
+		if (!q->elevator)
+			return 0;
+		return elevator_switch_mq(q, NULL);
+	}
+
+	e = elevator_get(name, !!q->mq_ops, true);
 	if (!e) {
 		printk(KERN_ERR "elevator: type %s not found\n", elevator_name);
 		return -EINVAL;
 	}
 
-	if (!strcmp(elevator_name, q->elevator->type->elevator_name)) {
+	if (q->elevator &&
+	    !strcmp(name, q->elevator->type->elevator_name)) {
 		elevator_put(e);
 		return 0;
 	}
 
+	if (q->mq_ops)
+		return elevator_switch_mq(q, e);
+
 	return elevator_switch(q, e);
 }
 
@@ -990,7 +1059,7 @@ ssize_t elv_iosched_store(struct request_queue *q, const char *name,
 {
 	int ret;
 
-	if (!q->elevator)
+	if (!q->elevator && !q->mq_ops)
 		return count;
 
 	ret = __elevator_change(q, name);
@@ -1008,20 +1077,25 @@ ssize_t elv_iosched_show(struct request_queue *q, char *name)
 	struct elevator_type *__e;
 	int len = 0;
 
-	if (!q->elevator || !blk_queue_stackable(q))
+	if (!q->mq_ops && (!q->elevator || !blk_queue_stackable(q)))
 		return sprintf(name, "none\n");
 
-	elv = e->type;
+	elv = e ? e->type : NULL;
 
 	spin_lock(&elv_list_lock);
 	list_for_each_entry(__e, &elv_list, list) {
-		if (!strcmp(elv->elevator_name, __e->elevator_name))
+		if (__e->uses_mq != !!q->mq_ops)
+			continue;
+		if (elv && !strcmp(elv->elevator_name, __e->elevator_name))
 			len += sprintf(name+len, "[%s] ", elv->elevator_name);
 		else
 			len += sprintf(name+len, "%s ", __e->elevator_name);
 	}
 	spin_unlock(&elv_list_lock);
 
+	if (q->mq_ops)
+		len += sprintf(name+len, elv ? "none " : "[none] ");
+
 	len += sprintf(len+name, "\n");
 	return len;
 }
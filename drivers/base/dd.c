@@ -23,6 +23,7 @@
 #include <linux/kthread.h>
 #include <linux/wait.h>
 #include <linux/async.h>
+#include <linux/ktime.h>
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
 
@@ -347,6 +348,25 @@ done:
 	return ret;
 }
 
+/*
+ * With initcall_debug, report how long every probe blocked the caller,
+ * which is the initcall or, for asynchronous probing, an async thread.
+ */
+static int really_probe_debug(struct device *dev, struct device_driver *drv)
+{
+	ktime_t calltime, delta, rettime;
+	int ret;
+
+	calltime = ktime_get();
+	ret = really_probe(dev, drv);
+	rettime = ktime_get();
+	delta = ktime_sub(rettime, calltime);
+	printk(KERN_DEBUG "probe of %s returned %d after %lld usecs%s\n",
+	       dev_name(dev), ret, (long long)ktime_to_us(delta),
+	       current_is_async() ? " (async)" : "");
+	return ret;
+}
+
 /**
  * driver_probe_done
  * Determine if the probe sequence is finished or not.
@@ -396,12 +416,42 @@ int driver_probe_device(struct device_driver *drv, struct device *dev)
 		 drv->bus->name, __func__, dev_name(dev), drv->name);
 
 	pm_runtime_barrier(dev);
-	ret = really_probe(dev, drv);
+	if (initcall_debug)
+		ret = really_probe_debug(dev, drv);
+	else
+		ret = really_probe(dev, drv);
 	pm_request_idle(dev);
 
 	return ret;
 }
 
+static char async_probe_drv_names[64];
+
+/*
+ * driver_async_probe=<name>[,<name>...] probes the listed drivers of
+ * the default type asynchronously, without changing the drivers.
+ */
+static int __init save_async_options(char *buf)
+{
+	strlcpy(async_probe_drv_names, buf, sizeof(async_probe_drv_names));
+	return 1;
+}
+__setup("driver_async_probe=", save_async_options);
+
+bool driver_allows_async_probing(struct device_driver *drv)
+{
+	switch (drv->probe_type) {
+	case PROBE_PREFER_ASYNCHRONOUS:
+		return true;
+
+	case PROBE_FORCE_SYNCHRONOUS:
+		return false;
+
+	default:
+		return parse_option_str(async_probe_drv_names, drv->name);
+	}
+}
+
 static int __device_attach(struct device_driver *drv, void *data)
 {
 	struct device *dev = data;
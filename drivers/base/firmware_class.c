@@ -19,6 +19,8 @@
 #include <linux/workqueue.h>
 #include <linux/highmem.h>
 #include <linux/firmware.h>
+#include <linux/pagemap.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/sched.h>
 #include <linux/file.h>
@@ -322,8 +324,11 @@ static int fw_get_filesystem_firmware(struct device *device,
 {
 	int i;
 	int rc = -ENOENT;
-	char *path = __getname();
+	char *path;
 
+	wait_for_initramfs();
+
+	path = __getname();
 	for (i = 0; i < ARRAY_SIZE(fw_path); i++) {
 		struct file *file;
 
@@ -358,12 +363,85 @@ static int fw_get_filesystem_firmware(struct device *device,
 	return rc;
 }
 
+/*
+ * Reference the page cache pages of @file instead of copying them, for
+ * request_firmware_pages(). The pages stay cached and unlocked, so the
+ * loader holds one reference on each of them.
+ */
+static int fw_get_page_cache(struct file *file, struct firmware *fw)
+{
+	struct page **pages;
+	struct sg_table *sgt;
+	unsigned int i, nr_pages;
+	loff_t size;
+	int rc;
+
+	if (!S_ISREG(file_inode(file)->i_mode))
+		return -EINVAL;
+	size = i_size_read(file_inode(file));
+	if (size <= 0 || size > INT_MAX)
+		return -EINVAL;
+	rc = security_kernel_fw_from_file(file, NULL, size);
+	if (rc)
+		return rc;
+
+	nr_pages = DIV_ROUND_UP(size, PAGE_SIZE);
+	pages = vzalloc(nr_pages * sizeof(*pages));
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!pages || !sgt) {
+		rc = -ENOMEM;
+		goto fail;
+	}
+
+	for (i = 0; i < nr_pages; i++) {
+		struct page *page = read_mapping_page(file->f_mapping, i, file);
+
+		if (IS_ERR(page)) {
+			rc = PTR_ERR(page);
+			goto fail_pages;
+		}
+		pages[i] = page;
+	}
+
+	rc = sg_alloc_table_from_pages(sgt, pages, nr_pages, 0, size,
+				       GFP_KERNEL);
+	if (rc)
+		goto fail_pages;
+
+	fw->pages = pages;
+	fw->sgt = sgt;
+	fw->size = size;
+	return 0;
+
+fail_pages:
+	while (i--)
+		page_cache_release(pages[i]);
+fail:
+	kfree(sgt);
+	vfree(pages);
+	return rc;
+}
+
+static void fw_put_page_cache(const struct firmware *fw)
+{
+	unsigned int i;
+
+	for (i = 0; i < DIV_ROUND_UP(fw->size, PAGE_SIZE); i++)
+		page_cache_release(fw->pages[i]);
+	sg_free_table(fw->sgt);
+	kfree(fw->sgt);
+	vfree(fw->pages);
+}
+
 /* firmware holds the ownership of pages */
 static void firmware_free_data(const struct firmware *fw)
 {
 	/* Loaded directly? */
 	if (!fw->priv) {
-		vfree(fw->data);
+		if (fw->sgt)
+			fw_put_page_cache(fw);
+		else
+			vfree(fw->data);
 		return;
 	}
 	fw_free_buf(fw->priv);
@@ -1217,6 +1295,79 @@ int request_firmware_direct(const struct firmware **firmware_p,
 }
 EXPORT_SYMBOL_GPL(request_firmware_direct);
 
+/**
+ * request_firmware_pages: - reference a firmware file in the page cache
+ * @firmware_p: pointer to firmware image
+ * @name: name of firmware file
+ * @device: device for which firmware is being loaded
+ *
+ * Like request_firmware_direct(), but the image is not copied into a
+ * vmalloc buffer. (*@firmware_p)->data is NULL and the page cache pages
+ * of the file are described by ->pages and by the scatterlist ->sgt,
+ * which the caller may dma_map_sg() as is. This suits large images
+ * that are only streamed to a device, like FPGA bitstreams.
+ *
+ * Only the filesystem is searched: built-in firmware, the firmware
+ * cache and the usermode helper are not used, so callers that need
+ * those fall back to request_firmware(). The file must not be written
+ * while the image is held.
+ **/
+int request_firmware_pages(const struct firmware **firmware_p,
+			   const char *name, struct device *device)
+{
+	struct firmware *fw;
+	struct file *file;
+	char *path;
+	int i, rc = -ENOENT;
+
+	if (!firmware_p)
+		return -EINVAL;
+	*firmware_p = NULL;
+
+	if (!name || name[0] == '\0')
+		return -EINVAL;
+
+	fw = kzalloc(sizeof(*fw), GFP_KERNEL);
+	path = __getname();
+	if (!fw || !path) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	wait_for_initramfs();
+
+	for (i = 0; i < ARRAY_SIZE(fw_path); i++) {
+		/* skip the unset customized path */
+		if (!fw_path[i][0])
+			continue;
+
+		snprintf(path, PATH_MAX, "%s/%s", fw_path[i], name);
+
+		file = filp_open(path, O_RDONLY, 0);
+		if (IS_ERR(file))
+			continue;
+		rc = fw_get_page_cache(file, fw);
+		fput(file);
+		if (rc)
+			dev_warn(device, "firmware, attempted to map %s, but failed with error %d\n",
+				 path, rc);
+		else
+			break;
+	}
+
+	if (!rc) {
+		dev_dbg(device, "firmware: mapping firmware %s\n", name);
+		*firmware_p = fw;
+		fw = NULL;
+	}
+out:
+	if (path)
+		__putname(path);
+	kfree(fw);
+	return rc;
+}
+EXPORT_SYMBOL_GPL(request_firmware_pages);
+
 /**
  * release_firmware: - release the resource associated with a firmware image
  * @fw: firmware resource to release
@@ -75,6 +75,9 @@
 #include <linux/sysfs.h>
 #include <linux/miscdevice.h>
 #include <linux/falloc.h>
+#include <linux/aio.h>
+#include <linux/uio.h>
+#include <linux/workqueue.h>
 #include "loop.h"
 
 #include <asm/uaccess.h>
@@ -82,6 +85,9 @@
 static DEFINE_IDR(loop_index_idr);
 static DEFINE_MUTEX(loop_index_mutex);
 
+/* runs the direct I/O of all loop devices, several bios at a time */
+static struct workqueue_struct *loop_wq;
+
 static int max_part;
 static int part_shift;
 
@@ -411,6 +417,57 @@ lo_receive(struct loop_device *lo, struct bio *bio, int bsize, loff_t pos)
 	return 0;
 }
 
+/*
+ * Hands the pages of the bio straight to the backing file, which is open
+ * with O_DIRECT, so that no copy of the data ends up in its page cache.
+ */
+static int lo_rw_direct(struct loop_device *lo, struct bio *bio, loff_t pos)
+{
+	struct file *file = lo->lo_backing_file;
+	int rw = bio_rw(bio) == WRITE ? WRITE : READ;
+	struct iov_iter iter;
+	struct kiocb kiocb;
+	ssize_t ret;
+
+	iter.type = ITER_BVEC | rw;
+	iter.bvec = __bvec_iter_bvec(bio->bi_io_vec, bio->bi_iter);
+	iter.nr_segs = bio_segments(bio);
+	iter.iov_offset = bio->bi_iter.bi_bvec_done;
+	iter.count = bio->bi_iter.bi_size;
+
+	init_sync_kiocb(&kiocb, file);
+	kiocb.ki_pos = pos;
+	kiocb.ki_nbytes = iter.count;
+
+	if (rw == WRITE) {
+		file_start_write(file);
+		ret = file->f_op->write_iter(&kiocb, &iter);
+		file_end_write(file);
+	} else {
+		ret = file->f_op->read_iter(&kiocb, &iter);
+	}
+	if (ret == -EIOCBQUEUED)
+		ret = wait_on_sync_kiocb(&kiocb);
+
+	if (ret < 0)
+		return ret;
+
+	if (ret != bio->bi_iter.bi_size) {
+		struct bvec_iter start = bio->bi_iter;
+		struct bio_vec bvec;
+		struct bvec_iter i;
+
+		if (rw == WRITE)
+			return -EIO;
+
+		/* a read beyond the end of the file */
+		bio_advance_iter(bio, &start, ret);
+		__bio_for_each_segment(bvec, bio, i, start)
+			zero_user(bvec.bv_page, bvec.bv_offset, bvec.bv_len);
+	}
+	return 0;
+}
+
 static int do_bio_filebacked(struct loop_device *lo, struct bio *bio)
 {
 	loff_t pos;
@@ -452,14 +509,19 @@ static int do_bio_filebacked(struct loop_device *lo, struct bio *bio)
 			goto out;
 		}
 
-		ret = lo_send(lo, bio, pos);
+		if (lo->lo_flags & LO_FLAGS_DIRECT_IO)
+			ret = lo_rw_direct(lo, bio, pos);
+		else
+			ret = lo_send(lo, bio, pos);
 
 		if ((bio->bi_rw & REQ_FUA) && !ret) {
 			ret = vfs_fsync(file, 0);
 			if (unlikely(ret && ret != -EINVAL))
 				ret = -EIO;
 		}
-	} else
+	} else if (lo->lo_flags & LO_FLAGS_DIRECT_IO)
+		ret = lo_rw_direct(lo, bio, pos);
+	else
 		ret = lo_receive(lo, bio, lo->lo_blocksize, pos);
 
 out:
@@ -518,14 +580,52 @@ struct switch_request {
 	struct completion wait;
 };
 
+struct loop_dio_work {
+	struct work_struct	work;
+	struct loop_device	*lo;
+	struct bio		*bio;
+};
+
+static void loop_dio_workfn(struct work_struct *work)
+{
+	struct loop_dio_work *w = container_of(work, struct loop_dio_work,
+					       work);
+
+	bio_endio(w->bio, do_bio_filebacked(w->lo, w->bio));
+	kfree(w);
+}
+
+/*
+ * Direct I/O blocks until the backing device is done with it, so bios are
+ * passed on to loop_wq to keep several of them in flight. Returns false if
+ * the bio has to be handled by the loop thread.
+ */
+static bool loop_queue_dio(struct loop_device *lo, struct bio *bio)
+{
+	struct loop_dio_work *w;
+
+	w = kmalloc(sizeof(*w), GFP_NOIO | __GFP_NOWARN);
+	if (!w)
+		return false;
+
+	INIT_WORK(&w->work, loop_dio_workfn);
+	w->lo = lo;
+	w->bio = bio;
+	queue_work(loop_wq, &w->work);
+	return true;
+}
+
 static void do_loop_switch(struct loop_device *, struct switch_request *);
 
 static inline void loop_handle_bio(struct loop_device *lo, struct bio *bio)
 {
 	if (unlikely(!bio->bi_bdev)) {
+		/* the bios queued before this one have to be done */
+		flush_workqueue(loop_wq);
 		do_loop_switch(lo, bio->bi_private);
 		bio_put(bio);
-	} else {
+	} else if (!(lo->lo_flags & LO_FLAGS_DIRECT_IO) ||
+		   !loop_queue_dio(lo, bio)) {
 		int ret = do_bio_filebacked(lo, bio);
 		bio_endio(bio, ret);
 	}
@@ -571,6 +671,16 @@ static int loop_thread(void *data)
 	return 0;
 }
 
+static void loop_file_set_direct(struct file *file, bool direct)
+{
+	spin_lock(&file->f_lock);
+	if (direct)
+		file->f_flags |= O_DIRECT;
+	else
+		file->f_flags &= ~O_DIRECT;
+	spin_unlock(&file->f_lock);
+}
+
 /*
  * loop_switch performs the hard work of switching a backing store.
  * First it needs to flush existing IO, it does this by sending a magic
@@ -616,6 +726,12 @@ static void do_loop_switch(struct loop_device *lo, struct switch_request *p)
 	if (!file)
 		goto out;
 
+	/* whether the new file can do direct I/O is not known */
+	if (lo->lo_flags & LO_FLAGS_DIRECT_IO) {
+		lo->lo_flags &= ~LO_FLAGS_DIRECT_IO;
+		loop_file_set_direct(old_file, false);
+	}
+
 	mapping = file->f_mapping;
 	mapping_set_gfp_mask(old_file->f_mapping, lo->old_gfp_mask);
 	lo->lo_backing_file = file;
@@ -759,11 +875,19 @@ static ssize_t loop_attr_partscan_show(struct loop_device *lo, char *buf)
 	return sprintf(buf, "%s\n", partscan ? "1" : "0");
 }
 
+static ssize_t loop_attr_dio_show(struct loop_device *lo, char *buf)
+{
+	int dio = (lo->lo_flags & LO_FLAGS_DIRECT_IO);
+
+	return sprintf(buf, "%s\n", dio ? "1" : "0");
+}
+
 LOOP_ATTR_RO(backing_file);
 LOOP_ATTR_RO(offset);
 LOOP_ATTR_RO(sizelimit);
 LOOP_ATTR_RO(autoclear);
 LOOP_ATTR_RO(partscan);
+LOOP_ATTR_RO(dio);
 
 static struct attribute *loop_attrs[] = {
 	&loop_attr_backing_file.attr,
@@ -771,6 +895,7 @@ static struct attribute *loop_attrs[] = {
 	&loop_attr_sizelimit.attr,
 	&loop_attr_autoclear.attr,
 	&loop_attr_partscan.attr,
+	&loop_attr_dio.attr,
 	NULL,
 };
 
@@ -1015,11 +1140,15 @@ static int loop_clr_fd(struct loop_device *lo)
 	spin_unlock_irq(&lo->lo_lock);
 
 	kthread_stop(lo->lo_thread);
+	flush_workqueue(loop_wq);
 
 	spin_lock_irq(&lo->lo_lock);
 	lo->lo_backing_file = NULL;
 	spin_unlock_irq(&lo->lo_lock);
 
+	if (lo->lo_flags & LO_FLAGS_DIRECT_IO)
+		loop_file_set_direct(filp, false);
+
 	loop_release_xfer(lo);
 	lo->transfer = NULL;
 	lo->ioctl = NULL;
@@ -1285,6 +1414,56 @@ static int loop_set_capacity(struct loop_device *lo, struct block_device *bdev)
 	return figure_loop_size(lo, lo->lo_offset, lo->lo_sizelimit);
 }
 
+/*
+ * The backing file has to support direct I/O, and it has to be able to do
+ * it for every block of the loop device: the offset and the loop device
+ * blocks must be aligned to the blocks of the device under the file.
+ */
+static bool loop_dio_supported(struct loop_device *lo)
+{
+	struct file *file = lo->lo_backing_file;
+	struct inode *inode = file->f_mapping->host;
+	unsigned short bsize = 512;
+
+	if (S_ISBLK(inode->i_mode))
+		bsize = bdev_logical_block_size(inode->i_bdev);
+	else if (inode->i_sb->s_bdev)
+		bsize = bdev_logical_block_size(inode->i_sb->s_bdev);
+
+	return lo->transfer == transfer_none &&
+		file->f_mapping->a_ops->direct_IO &&
+		file->f_op->read_iter && file->f_op->write_iter &&
+		!(lo->lo_offset & (bsize - 1)) &&
+		queue_logical_block_size(lo->lo_queue) >= bsize;
+}
+
+static int loop_set_dio(struct loop_device *lo, unsigned long arg)
+{
+	bool dio = !!arg;
+
+	if (lo->lo_state != Lo_bound)
+		return -ENXIO;
+
+	if (dio == !!(lo->lo_flags & LO_FLAGS_DIRECT_IO))
+		return 0;
+
+	if (dio && !loop_dio_supported(lo))
+		return -EINVAL;
+
+	/*
+	 * Bios are not stopped while switching. That is fine, until the
+	 * flags agree a bio just takes the buffered path in the backing
+	 * file, which keeps its page cache coherent with direct I/O.
+	 */
+	loop_file_set_direct(lo->lo_backing_file, dio);
+	if (dio)
+		lo->lo_flags |= LO_FLAGS_DIRECT_IO;
+	else
+		lo->lo_flags &= ~LO_FLAGS_DIRECT_IO;
+
+	return loop_flush(lo);
+}
+
 static int lo_ioctl(struct block_device *bdev, fmode_t mode,
 	unsigned int cmd, unsigned long arg)
 {
@@ -1328,6 +1507,11 @@ static int lo_ioctl(struct block_device *bdev, fmode_t mode,
 		if ((mode & FMODE_WRITE) || capable(CAP_SYS_ADMIN))
 			err = loop_set_capacity(lo, bdev);
 		break;
+	case LOOP_SET_DIRECT_IO:
+		err = -EPERM;
+		if ((mode & FMODE_WRITE) || capable(CAP_SYS_ADMIN))
+			err = loop_set_dio(lo, arg);
+		break;
 	default:
 		err = lo->ioctl ? lo->ioctl(lo, cmd, arg) : -EINVAL;
 	}
@@ -1482,6 +1666,7 @@ static int lo_compat_ioctl(struct block_device *bdev, fmode_t mode,
 		arg = (unsigned long) compat_ptr(arg);
 	case LOOP_SET_FD:
 	case LOOP_CHANGE_FD:
+	case LOOP_SET_DIRECT_IO:
 		err = lo_ioctl(bdev, mode, cmd, arg);
 		break;
 	default:
@@ -1870,9 +2055,15 @@ static int __init loop_init(void)
 		range = 1UL << MINORBITS;
 	}
 
+	loop_wq = alloc_workqueue("kloopd", WQ_MEM_RECLAIM | WQ_UNBOUND, 0);
+	if (!loop_wq) {
+		err = -ENOMEM;
+		goto misc_out;
+	}
+
 	if (register_blkdev(LOOP_MAJOR, "loop")) {
 		err = -EIO;
-		goto misc_out;
+		goto wq_out;
 	}
 
 	blk_register_region(MKDEV(LOOP_MAJOR, 0), range,
@@ -1887,6 +2078,8 @@ static int __init loop_init(void)
 	printk(KERN_INFO "loop: module loaded\n");
 	return 0;
 
+wq_out:
+	destroy_workqueue(loop_wq);
 misc_out:
 	misc_deregister(&loop_misc);
 	return err;
@@ -1912,6 +2105,7 @@ static void __exit loop_exit(void)
 	blk_unregister_region(MKDEV(LOOP_MAJOR, 0), range);
 	unregister_blkdev(LOOP_MAJOR, "loop");
 
+	destroy_workqueue(loop_wq);
 	misc_deregister(&loop_misc);
 }
 
@@ -225,6 +225,36 @@ static void null_cmd_end_timer(struct nullb_cmd *cmd)
 	put_cpu();
 }
 
+/*
+ * Reap the emulated completions of this CPU that are due without waiting
+ * for the timer interrupt.
+ */
+static int null_poll(struct blk_mq_hw_ctx *hctx)
+{
+	struct completion_queue *cq;
+	struct llist_node *entry;
+	struct nullb_cmd *cmd;
+	int found = 0;
+
+	if (irqmode != NULL_IRQ_TIMER)
+		return 0;
+
+	cq = &get_cpu_var(completion_queues);
+	if (ktime_to_ns(hrtimer_get_remaining(&cq->timer)) <= 0 &&
+	    hrtimer_try_to_cancel(&cq->timer) == 1) {
+		entry = llist_reverse_order(llist_del_all(&cq->list));
+		while (entry) {
+			cmd = container_of(entry, struct nullb_cmd, ll_list);
+			entry = entry->next;
+			end_cmd(cmd);
+			found++;
+		}
+	}
+	put_cpu_var(completion_queues);
+
+	return found;
+}
+
 static void null_softirq_done_fn(struct request *rq)
 {
 	if (queue_mode == NULL_Q_MQ)
@@ -354,6 +384,7 @@ static struct blk_mq_ops null_mq_ops = {
 	.map_queue      = blk_mq_map_queue,
 	.init_hctx	= null_init_hctx,
 	.complete	= null_softirq_done_fn,
+	.poll		= null_poll,
 };
 
 static void null_del_dev(struct nullb *nullb)
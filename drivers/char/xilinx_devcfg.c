@@ -12,21 +12,29 @@
 #include <linux/cdev.h>
 #include <linux/clk.h>
 #include <linux/dma-mapping.h>
+#include <linux/firmware.h>
 #include <linux/fs.h>
+#include <linux/highmem.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/ioport.h>
 #include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/of.h>
+#include <linux/of_reserved_mem.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/sysctl.h>
 #include <linux/types.h>
 #include <linux/uaccess.h>
+#include <linux/xilinx_devcfg.h>
 
 extern void zynq_slcr_init_preload_fpga(void);
 extern void zynq_slcr_init_postload_fpga(void);
@@ -91,6 +99,20 @@ static DEFINE_MUTEX(xdevcfg_mutex);
 #define XDCFG_IXR_ALL_MASK		0xF8F7F87F
 /* Miscellaneous constant values */
 #define XDCFG_DMA_INVALID_ADDRESS	0xFFFFFFFF  /* Invalid DMA address */
+#define XDCFG_DMA_LAST_TRANSFER		0x00000001  /* Wait for PCAP done */
+
+/*
+ * Writes of at least XDCFG_ZC_MIN_LEN bytes from a word aligned buffer are
+ * fed to the PCAP DMA straight from the pinned user pages, at most
+ * XDCFG_ZC_MAX_LEN bytes at a time. The sync word has to show up in the
+ * first XDCFG_SYNC_SCAN_LEN bytes of the first write for that.
+ */
+#define XDCFG_ZC_MIN_LEN		PAGE_SIZE
+#define XDCFG_ZC_MAX_LEN		SZ_16M
+#define XDCFG_SYNC_SCAN_LEN		PAGE_SIZE
+
+/* Maximum length of the name of a cached partial bitstream */
+#define XDCFG_CACHE_NAME_LEN		64
 
 static const char * const fclk_name[] = {
 	"fclk0",
@@ -119,6 +141,9 @@ static const char * const fclk_name[] = {
  * @lock: Instance of spinlock
  * @base_address: The virtual device base address of the device registers
  * @is_partial_bitstream: Status bit to indicate partial/full bitstream
+ * @has_rmem: A reserved memory region is assigned to the device
+ * @cache: List of cached partial bitstreams
+ * @cache_lock: Protects @cache, taken outside of @sem
  */
 struct xdevcfg_drvdata {
 	struct device *dev;
@@ -141,8 +166,49 @@ struct xdevcfg_drvdata {
 	bool endian_swap;
 	char residue_buf[3];
 	int residue_len;
+	bool has_rmem;
+	struct list_head cache;
+	struct mutex cache_lock;
 };
 
+/**
+ * struct xdevcfg_cached - A partial bitstream held in DMA memory
+ * @node: Entry in the cache list of the device
+ * @name: Name the bitstream was loaded under
+ * @cpu_addr: Kernel address of the bitstream body
+ * @dma_addr: Bus address of the bitstream body
+ * @len: Length of the bitstream body in bytes
+ */
+struct xdevcfg_cached {
+	struct list_head node;
+	char name[XDCFG_CACHE_NAME_LEN];
+	void *cpu_addr;
+	dma_addr_t dma_addr;
+	size_t len;
+};
+
+/**
+ * struct xdevcfg_image - A preloaded bitstream
+ * @drvdata: The devcfg instance the image is mapped for
+ * @pages: Pages holding the bitstream body
+ * @nr_pages: Number of entries in @pages
+ * @sgt: Scatter table over @pages
+ * @nents: Number of DMA mapped entries in @sgt
+ * @flags: XDEVCFG_IMAGE_* flags
+ */
+struct xdevcfg_image {
+	struct xdevcfg_drvdata *drvdata;
+	const struct firmware *fw;
+	struct page **pages;
+	unsigned int nr_pages;
+	struct sg_table sgt;
+	int nents;
+	unsigned int flags;
+};
+
+/* The devcfg instance of the in-kernel interface, protected by xdevcfg_mutex */
+static struct xdevcfg_drvdata *xdevcfg_kernel_drvdata;
+
 /**
  * struct fclk_data - FPGA clock data
  * @clk: Pointer to clock
@@ -227,6 +293,251 @@ static irqreturn_t xdevcfg_irq(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+/**
+ * xdevcfg_find_sync() - Look for the sync word of a bitstream.
+ * @buf:	Pointer to the start of the bitstream.
+ * @count:	The number of bytes to search.
+ * @swap:	Set to true if the sync word was found byte swapped.
+ * returns:	The offset of the sync word or -ENOENT.
+ */
+static int xdevcfg_find_sync(const char *buf, size_t count, bool *swap)
+{
+	int i;
+
+	if (count <= 4)
+		return -ENOENT;
+
+	for (i = 0; i < count - 4; i++) {
+		if (memcmp(buf + i, "\x66\x55\x99\xAA", 4) == 0) {
+			pr_debug("Found normal sync word\n");
+			*swap = 0;
+			return i;
+		}
+		if (memcmp(buf + i, "\xAA\x99\x55\x66", 4) == 0) {
+			pr_debug("Found swapped sync word\n");
+			*swap = 1;
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/**
+ * xdevcfg_dma_write() - Run one PCAP DMA command towards the PL.
+ * @drvdata:	Pointer to the driver data structure.
+ * @dma_addr:	Bus address of the data.
+ * @len:	The number of bytes to transfer, a multiple of 4.
+ * @last:	True for the last transfer of a bitstream.
+ * returns:	Success or error status.
+ *
+ * Must be called with the PCAP clock enabled and drvdata->sem held.
+ */
+static int xdevcfg_dma_write(struct xdevcfg_drvdata *drvdata,
+			     dma_addr_t dma_addr, u32 len, bool last)
+{
+	unsigned long timeout;
+	u32 intr_reg;
+	int status = 0;
+
+	/* Enable DMA and error interrupts */
+	xdevcfg_writereg(drvdata->base_address + XDCFG_INT_STS_OFFSET,
+				XDCFG_IXR_ALL_MASK);
+
+	xdevcfg_writereg(drvdata->base_address + XDCFG_INT_MASK_OFFSET,
+				(u32) (~(XDCFG_IXR_D_P_DONE_MASK |
+				XDCFG_IXR_ERROR_FLAGS_MASK)));
+
+	drvdata->dma_done = 0;
+	drvdata->error_status = 0;
+
+	/* Initiate DMA write command */
+	if (last)
+		dma_addr |= XDCFG_DMA_LAST_TRANSFER;
+	xdevcfg_writereg(drvdata->base_address + XDCFG_DMA_SRC_ADDR_OFFSET,
+				(u32)dma_addr);
+	xdevcfg_writereg(drvdata->base_address + XDCFG_DMA_DEST_ADDR_OFFSET,
+				(u32)XDCFG_DMA_INVALID_ADDRESS);
+	/* Convert number of bytes to number of words.  */
+	xdevcfg_writereg(drvdata->base_address + XDCFG_DMA_SRC_LEN_OFFSET,
+				DIV_ROUND_UP(len, 4));
+	xdevcfg_writereg(drvdata->base_address + XDCFG_DMA_DEST_LEN_OFFSET, 0);
+
+	timeout = jiffies + msecs_to_jiffies(1000);
+
+	while (!drvdata->dma_done) {
+		if (time_after(jiffies, timeout)) {
+			status = -ETIMEDOUT;
+			break;
+		}
+	}
+
+	if (!status && drvdata->error_status)
+		status = -EFAULT;
+
+	/* Disable the DMA and error interrupts */
+	intr_reg = xdevcfg_readreg(drvdata->base_address +
+					XDCFG_INT_MASK_OFFSET);
+	xdevcfg_writereg(drvdata->base_address + XDCFG_INT_MASK_OFFSET,
+				intr_reg | (XDCFG_IXR_D_P_DONE_MASK |
+				XDCFG_IXR_ERROR_FLAGS_MASK));
+
+	return status;
+}
+
+/**
+ * xdevcfg_dma_write_sg() - Feed a DMA mapped scatterlist to the PCAP.
+ * @drvdata:	Pointer to the driver data structure.
+ * @sgl:	The mapped scatterlist, each segment word aligned.
+ * @nents:	The number of mapped segments.
+ * @last:	True if the scatterlist ends the bitstream.
+ * returns:	Success or error status.
+ *
+ * Each segment is sent as one DMA command, the same way consecutive
+ * write() calls are.
+ */
+static int xdevcfg_dma_write_sg(struct xdevcfg_drvdata *drvdata,
+				struct scatterlist *sgl, int nents, bool last)
+{
+	struct scatterlist *sg;
+	int i, status = 0;
+
+	for_each_sg(sgl, sg, nents, i) {
+		status = xdevcfg_dma_write(drvdata, sg_dma_address(sg),
+					   sg_dma_len(sg),
+					   last && i == nents - 1);
+		if (status)
+			break;
+	}
+
+	return status;
+}
+
+/**
+ * xdevcfg_write_user_pages() - Program the PL straight from user memory.
+ * @drvdata:	Pointer to the driver data structure.
+ * @buf:	Word aligned pointer into the bitstream.
+ * @len:	The number of bytes to program, a multiple of 4.
+ * returns:	Success or error status.
+ *
+ * The pages are pinned and mapped for the PCAP DMA without a copy. A
+ * bitstream file mapped with mmap() is thus sent from the page cache.
+ */
+static int xdevcfg_write_user_pages(struct xdevcfg_drvdata *drvdata,
+				    const char __user *buf, size_t len)
+{
+	unsigned long uaddr = (unsigned long)buf;
+	unsigned int offset = offset_in_page(uaddr);
+	int nr_pages = DIV_ROUND_UP(offset + len, PAGE_SIZE);
+	struct page **pages;
+	struct sg_table sgt;
+	int pinned, nents, i, status;
+
+	pages = kmalloc_array(nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	pinned = get_user_pages_fast(uaddr & PAGE_MASK, nr_pages, 0, pages);
+	if (pinned != nr_pages) {
+		status = pinned < 0 ? pinned : -EFAULT;
+		goto err_put;
+	}
+
+	status = sg_alloc_table_from_pages(&sgt, pages, nr_pages, offset, len,
+					   GFP_KERNEL);
+	if (status)
+		goto err_put;
+
+	nents = dma_map_sg(drvdata->dev, sgt.sgl, sgt.orig_nents,
+			   DMA_TO_DEVICE);
+	if (!nents) {
+		status = -ENOMEM;
+		goto err_free;
+	}
+
+	status = xdevcfg_dma_write_sg(drvdata, sgt.sgl, nents, false);
+
+	dma_unmap_sg(drvdata->dev, sgt.sgl, sgt.orig_nents, DMA_TO_DEVICE);
+err_free:
+	sg_free_table(&sgt);
+err_put:
+	for (i = 0; i < pinned; i++)
+		put_page(pages[i]);
+	kfree(pages);
+	return status;
+}
+
+/**
+ * xdevcfg_write_zerocopy() - Try to handle a write without a bounce buffer.
+ * @drvdata:	Pointer to the driver data structure.
+ * @buf:	Pointer to the bitstream location.
+ * @count:	The number of bytes to be written.
+ * @ppos:	Pointer to the offset value
+ * returns:	The number of bytes consumed, -EAGAIN if the write has to go
+ *		through the bounce buffer or another error status.
+ *
+ * Writes that need byte swapping, do not start on a word boundary or have
+ * stragglers of a previous write pending are left to the bounce buffer.
+ */
+static ssize_t xdevcfg_write_zerocopy(struct xdevcfg_drvdata *drvdata,
+				      const char __user *buf, size_t count,
+				      loff_t *ppos)
+{
+	size_t skip = 0, len, tail;
+	bool swap = 0;
+	int status;
+
+	if (count < XDCFG_ZC_MIN_LEN || drvdata->residue_len ||
+	    !IS_ALIGNED((unsigned long)buf, 4))
+		return -EAGAIN;
+
+	if (*ppos == 0) {
+		size_t scan = min_t(size_t, count, XDCFG_SYNC_SCAN_LEN);
+		char *head;
+		int i;
+
+		head = kmalloc(scan, GFP_KERNEL);
+		if (!head)
+			return -ENOMEM;
+		if (copy_from_user(head, buf, scan)) {
+			kfree(head);
+			return -EFAULT;
+		}
+		i = xdevcfg_find_sync(head, scan, &swap);
+		kfree(head);
+
+		if (i < 0 || swap || !IS_ALIGNED(i, 4))
+			return -EAGAIN;
+
+		/* Remove the header */
+		skip = i;
+		drvdata->endian_swap = 0;
+	} else if (drvdata->endian_swap) {
+		return -EAGAIN;
+	}
+
+	len = (count - skip) & ~3;
+	tail = count - skip - len;
+	if (len > XDCFG_ZC_MAX_LEN) {
+		/* Short write, the rest comes with the next call */
+		len = XDCFG_ZC_MAX_LEN;
+		tail = 0;
+	}
+
+	status = xdevcfg_write_user_pages(drvdata, buf + skip, len);
+	if (status)
+		return status;
+
+	/* Save stragglers for next time */
+	if (copy_from_user(drvdata->residue_buf, buf + skip + len, tail))
+		return -EFAULT;
+	drvdata->residue_len = tail;
+
+	count = skip + len + tail;
+	*ppos += count;
+	return count;
+}
+
 /**
  * xdevcfg_write() - The is the driver write function.
  *
@@ -242,12 +553,11 @@ xdevcfg_write(struct file *file, const char __user *buf, size_t count,
 {
 	char *kbuf;
 	int status;
-	unsigned long timeout;
-	u32 intr_reg, dma_len;
+	u32 dma_len;
 	dma_addr_t dma_addr;
-	u32 transfer_length = 0;
 	struct xdevcfg_drvdata *drvdata = file->private_data;
 	size_t user_count = count;
+	bool swap;
 	int i;
 
 	status = clk_enable(drvdata->clk);
@@ -259,6 +569,10 @@ xdevcfg_write(struct file *file, const char __user *buf, size_t count,
 	if (status)
 		goto err_clk;
 
+	status = xdevcfg_write_zerocopy(drvdata, buf, count, ppos);
+	if (status != -EAGAIN)
+		goto err_unlock;
+
 	dma_len = count + drvdata->residue_len;
 	kbuf = dma_alloc_coherent(drvdata->dev, dma_len, &dma_addr, GFP_KERNEL);
 	if (!kbuf) {
@@ -279,22 +593,12 @@ xdevcfg_write(struct file *file, const char __user *buf, size_t count,
 	count += drvdata->residue_len;
 
 	/* First block contains a header */
-	if (*ppos == 0 && count > 4) {
+	if (*ppos == 0) {
 		/* Look for sync word */
-		for (i = 0; i < count - 4; i++) {
-			if (memcmp(kbuf + i, "\x66\x55\x99\xAA", 4) == 0) {
-				pr_debug("Found normal sync word\n");
-				drvdata->endian_swap = 0;
-				break;
-			}
-			if (memcmp(kbuf + i, "\xAA\x99\x55\x66", 4) == 0) {
-				pr_debug("Found swapped sync word\n");
-				drvdata->endian_swap = 1;
-				break;
-			}
-		}
+		i = xdevcfg_find_sync(kbuf, count, &swap);
 		/* Remove the header, aligning the data on word boundary */
-		if (i != count - 4) {
+		if (i >= 0) {
+			drvdata->endian_swap = swap;
 			count -= i;
 			memmove(kbuf, kbuf + i, count);
 		}
@@ -313,61 +617,10 @@ xdevcfg_write(struct file *file, const char __user *buf, size_t count,
 		}
 	}
 
-	/* Enable DMA and error interrupts */
-	xdevcfg_writereg(drvdata->base_address + XDCFG_INT_STS_OFFSET,
-				XDCFG_IXR_ALL_MASK);
-
-
-	xdevcfg_writereg(drvdata->base_address + XDCFG_INT_MASK_OFFSET,
-				(u32) (~(XDCFG_IXR_D_P_DONE_MASK |
-				XDCFG_IXR_ERROR_FLAGS_MASK)));
-
-	drvdata->dma_done = 0;
-	drvdata->error_status = 0;
-
-	/* Initiate DMA write command */
-	if (count < 0x1000)
-		xdevcfg_writereg(drvdata->base_address +
-			XDCFG_DMA_SRC_ADDR_OFFSET, (u32)(dma_addr + 1));
-	else
-		xdevcfg_writereg(drvdata->base_address +
-			XDCFG_DMA_SRC_ADDR_OFFSET, (u32) dma_addr);
-
-	xdevcfg_writereg(drvdata->base_address + XDCFG_DMA_DEST_ADDR_OFFSET,
-				(u32)XDCFG_DMA_INVALID_ADDRESS);
-	/* Convert number of bytes to number of words.  */
-	if (count % 4)
-		transfer_length	= (count / 4 + 1);
-	else
-		transfer_length	= count / 4;
-	xdevcfg_writereg(drvdata->base_address + XDCFG_DMA_SRC_LEN_OFFSET,
-				transfer_length);
-	xdevcfg_writereg(drvdata->base_address + XDCFG_DMA_DEST_LEN_OFFSET, 0);
-
-	timeout = jiffies + msecs_to_jiffies(1000);
-
-	while (!drvdata->dma_done) {
-		if (time_after(jiffies, timeout)) {
-				status = -ETIMEDOUT;
-				goto error;
-		}
-	}
-
-	if (drvdata->error_status)
-		status = drvdata->error_status;
-
-	/* Disable the DMA and error interrupts */
-	intr_reg = xdevcfg_readreg(drvdata->base_address +
-					XDCFG_INT_MASK_OFFSET);
-	xdevcfg_writereg(drvdata->base_address + XDCFG_INT_MASK_OFFSET,
-				intr_reg | (XDCFG_IXR_D_P_DONE_MASK |
-				XDCFG_IXR_ERROR_FLAGS_MASK));
-
+	status = xdevcfg_dma_write(drvdata, dma_addr, count, count < 0x1000);
 	/* If we didn't write correctly, then bail out. */
-	if (status) {
-		status = -EFAULT;
+	if (status)
 		goto error;
-	}
 
 	*ppos += user_count;
 	status = user_count;
@@ -566,6 +819,261 @@ static const struct file_operations xdevcfg_fops = {
 	.release = xdevcfg_release,
 };
 
+static void xdevcfg_image_free_pages(struct xdevcfg_image *image)
+{
+	unsigned int i;
+
+	for (i = 0; i < image->nr_pages; i++)
+		if (image->pages[i])
+			__free_page(image->pages[i]);
+	kfree(image->pages);
+}
+
+/*
+ * Run the DMA straight from the page cache pages of the bitstream when it
+ * needs no byte swapping and its body starts word aligned, which is the
+ * case for the .bin files written by bootgen. Returns -EAGAIN when the
+ * image has to be copied instead.
+ */
+static struct xdevcfg_image *xdevcfg_image_map(struct xdevcfg_drvdata *drvdata,
+					       const char *name,
+					       unsigned int flags)
+{
+	struct xdevcfg_image *image;
+	const struct firmware *fw;
+	size_t len, scan;
+	unsigned int nr_pages;
+	bool swap = 0;
+	void *head;
+	int offset, status;
+
+	if (request_firmware_pages(&fw, name, drvdata->dev))
+		return ERR_PTR(-EAGAIN);
+
+	/* The header in front of the sync word is short */
+	scan = min_t(size_t, fw->size, PAGE_SIZE);
+	head = kmap(fw->pages[0]);
+	offset = xdevcfg_find_sync(head, scan, &swap);
+	kunmap(fw->pages[0]);
+	if (offset < 0 || swap || !IS_ALIGNED(offset, 4)) {
+		status = -EAGAIN;
+		goto err_fw;
+	}
+	len = (fw->size - offset) & ~3;
+	if (len != fw->size - offset)
+		dev_warn(drvdata->dev, "%s: ignoring last %zu bytes\n", name,
+			 fw->size - offset - len);
+
+	image = kzalloc(sizeof(*image), GFP_KERNEL);
+	if (!image) {
+		status = -ENOMEM;
+		goto err_fw;
+	}
+	image->drvdata = drvdata;
+	image->flags = flags;
+	image->fw = fw;
+
+	nr_pages = DIV_ROUND_UP(offset + len, PAGE_SIZE);
+	status = sg_alloc_table_from_pages(&image->sgt, fw->pages, nr_pages,
+					   offset, len, GFP_KERNEL);
+	if (status)
+		goto err_image;
+
+	image->nents = dma_map_sg(drvdata->dev, image->sgt.sgl,
+				  image->sgt.orig_nents, DMA_TO_DEVICE);
+	if (!image->nents) {
+		status = -ENOMEM;
+		goto err_sgt;
+	}
+
+	return image;
+
+err_sgt:
+	sg_free_table(&image->sgt);
+err_image:
+	kfree(image);
+err_fw:
+	release_firmware(fw);
+	return ERR_PTR(status);
+}
+
+/**
+ * xdevcfg_image_load() - Preload a bitstream for later programming.
+ * @name:	Name of the bitstream for the firmware loader.
+ * @flags:	XDEVCFG_IMAGE_* flags.
+ * returns:	The image or an ERR_PTR() on failure.
+ *
+ * The header in front of the sync word is removed and the body byte
+ * swapped as needed, so xdevcfg_image_program() just runs the DMA. Images
+ * without either are used from the page cache without a copy.
+ */
+struct xdevcfg_image *xdevcfg_image_load(const char *name,
+					 unsigned int flags)
+{
+	struct xdevcfg_drvdata *drvdata;
+	struct xdevcfg_image *image;
+	const struct firmware *fw;
+	size_t len, chunk, pos;
+	bool swap = 0;
+	unsigned int i;
+	int offset, status;
+
+	mutex_lock(&xdevcfg_mutex);
+	drvdata = xdevcfg_kernel_drvdata;
+	mutex_unlock(&xdevcfg_mutex);
+	if (!drvdata)
+		return ERR_PTR(-ENODEV);
+
+	image = xdevcfg_image_map(drvdata, name, flags);
+	if (!IS_ERR(image) || PTR_ERR(image) != -EAGAIN)
+		return image;
+
+	status = request_firmware(&fw, name, drvdata->dev);
+	if (status)
+		return ERR_PTR(status);
+
+	offset = xdevcfg_find_sync(fw->data, fw->size, &swap);
+	if (offset < 0) {
+		dev_err(drvdata->dev, "%s: no sync word found\n", name);
+		status = -EINVAL;
+		goto err_fw;
+	}
+	len = (fw->size - offset) & ~3;
+	if (len != fw->size - offset)
+		dev_warn(drvdata->dev, "%s: ignoring last %zu bytes\n", name,
+			 fw->size - offset - len);
+
+	image = kzalloc(sizeof(*image), GFP_KERNEL);
+	if (!image) {
+		status = -ENOMEM;
+		goto err_fw;
+	}
+	image->drvdata = drvdata;
+	image->flags = flags;
+	image->nr_pages = DIV_ROUND_UP(len, PAGE_SIZE);
+
+	image->pages = kcalloc(image->nr_pages, sizeof(*image->pages),
+			       GFP_KERNEL);
+	if (!image->pages) {
+		status = -ENOMEM;
+		goto err_image;
+	}
+
+	for (i = 0, pos = 0; i < image->nr_pages; i++, pos += chunk) {
+		const char *src = fw->data + offset + pos;
+		u32 *dst;
+		size_t j;
+
+		image->pages[i] = alloc_page(GFP_KERNEL);
+		if (!image->pages[i]) {
+			status = -ENOMEM;
+			goto err_pages;
+		}
+
+		chunk = min_t(size_t, len - pos, PAGE_SIZE);
+		dst = page_address(image->pages[i]);
+		memcpy(dst, src, chunk);
+		if (swap)
+			for (j = 0; j < chunk / 4; j++)
+				dst[j] = swab32(dst[j]);
+	}
+
+	status = sg_alloc_table_from_pages(&image->sgt, image->pages,
+					   image->nr_pages, 0, len, GFP_KERNEL);
+	if (status)
+		goto err_pages;
+
+	image->nents = dma_map_sg(drvdata->dev, image->sgt.sgl,
+				  image->sgt.orig_nents, DMA_TO_DEVICE);
+	if (!image->nents) {
+		status = -ENOMEM;
+		goto err_sgt;
+	}
+
+	release_firmware(fw);
+
+	return image;
+
+err_sgt:
+	sg_free_table(&image->sgt);
+err_pages:
+	xdevcfg_image_free_pages(image);
+err_image:
+	kfree(image);
+err_fw:
+	release_firmware(fw);
+	return ERR_PTR(status);
+}
+EXPORT_SYMBOL(xdevcfg_image_load);
+
+/**
+ * xdevcfg_image_program() - Program a preloaded bitstream into the PL.
+ * @image:	The image returned by xdevcfg_image_load().
+ * returns:	Success or error status, -EBUSY while the device is open.
+ *
+ * May sleep.
+ */
+int xdevcfg_image_program(struct xdevcfg_image *image)
+{
+	struct xdevcfg_drvdata *drvdata = image->drvdata;
+	bool partial = image->flags & XDEVCFG_IMAGE_PARTIAL;
+	int status;
+
+	status = clk_enable(drvdata->clk);
+	if (status)
+		return status;
+
+	status = mutex_lock_interruptible(&drvdata->sem);
+	if (status)
+		goto err_clk;
+
+	/* A bitstream may be half way written through the device */
+	if (drvdata->is_open) {
+		status = -EBUSY;
+		goto err_unlock;
+	}
+
+	if (!partial) {
+		zynq_slcr_init_preload_fpga();
+		if (!drvdata->ep107)
+			xdevcfg_reset_pl(drvdata->base_address);
+	}
+
+	xdevcfg_writereg(drvdata->base_address + XDCFG_INT_STS_OFFSET,
+			XDCFG_IXR_PCFG_DONE_MASK);
+
+	status = xdevcfg_dma_write_sg(drvdata, image->sgt.sgl, image->nents,
+				      true);
+
+	if (!partial)
+		zynq_slcr_init_postload_fpga();
+
+err_unlock:
+	mutex_unlock(&drvdata->sem);
+err_clk:
+	clk_disable(drvdata->clk);
+	return status;
+}
+EXPORT_SYMBOL(xdevcfg_image_program);
+
+/**
+ * xdevcfg_image_free() - Release a preloaded bitstream.
+ * @image:	The image returned by xdevcfg_image_load(), may be NULL.
+ */
+void xdevcfg_image_free(struct xdevcfg_image *image)
+{
+	if (IS_ERR_OR_NULL(image))
+		return;
+
+	dma_unmap_sg(image->drvdata->dev, image->sgt.sgl,
+		     image->sgt.orig_nents, DMA_TO_DEVICE);
+	sg_free_table(&image->sgt);
+	xdevcfg_image_free_pages(image);
+	release_firmware(image->fw);
+	kfree(image);
+}
+EXPORT_SYMBOL(xdevcfg_image_free);
+
 /*
  * The following functions are the routines provided to the user to
  * set/get the status bit value in the control/lock registers.
@@ -1568,6 +2076,261 @@ static DEVICE_ATTR(is_partial_bitstream, 0644,
 				xdevcfg_show_is_partial_bitstream_status,
 				xdevcfg_set_is_partial_bitstream);
 
+/**
+ * xdevcfg_cache_name() - Extract a bitstream name from a sysfs write.
+ * @buf:	The data written to the attribute.
+ * @size:	The number of bytes written.
+ * @name:	Buffer of XDCFG_CACHE_NAME_LEN bytes for the name.
+ * returns:	Pointer to the name within @name or an ERR_PTR().
+ */
+static char *xdevcfg_cache_name(const char *buf, size_t size, char *name)
+{
+	char *p;
+
+	if (size >= XDCFG_CACHE_NAME_LEN)
+		return ERR_PTR(-ENAMETOOLONG);
+
+	memcpy(name, buf, size);
+	name[size] = '\0';
+	p = strim(name);
+	if (!*p)
+		return ERR_PTR(-EINVAL);
+
+	return p;
+}
+
+static struct xdevcfg_cached *xdevcfg_cache_find(
+		struct xdevcfg_drvdata *drvdata, const char *name)
+{
+	struct xdevcfg_cached *entry;
+
+	list_for_each_entry(entry, &drvdata->cache, node)
+		if (!strcmp(entry->name, name))
+			return entry;
+
+	return NULL;
+}
+
+static void xdevcfg_cache_free(struct xdevcfg_drvdata *drvdata,
+			       struct xdevcfg_cached *entry)
+{
+	list_del(&entry->node);
+	dma_free_coherent(drvdata->dev, entry->len, entry->cpu_addr,
+			  entry->dma_addr);
+	kfree(entry);
+}
+
+/**
+ * xdevcfg_set_cache_load() - Load a partial bitstream into the cache.
+ * @dev:	Pointer to the device structure.
+ * @attr:	Pointer to the device attribute structure.
+ * @buf:	The firmware name of the bitstream.
+ * @size:	The number of bytes used from the buffer
+ * returns:	-EEXIST if the name is cached already, an error status or size
+ *
+ * The body after the sync word is copied, byte swapped if needed, into
+ * coherent DMA memory. That memory comes from the reserved memory region
+ * given by the memory-region property of the device node, if any.
+ */
+static ssize_t xdevcfg_set_cache_load(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct xdevcfg_drvdata *drvdata = dev_get_drvdata(dev);
+	char namebuf[XDCFG_CACHE_NAME_LEN];
+	struct xdevcfg_cached *entry;
+	const struct firmware *fw;
+	bool swap = 0;
+	char *name;
+	int offset;
+	ssize_t status;
+
+	name = xdevcfg_cache_name(buf, size, namebuf);
+	if (IS_ERR(name))
+		return PTR_ERR(name);
+
+	status = request_firmware(&fw, name, dev);
+	if (status)
+		return status;
+
+	offset = xdevcfg_find_sync(fw->data, fw->size, &swap);
+	if (offset < 0 || fw->size - offset < 4) {
+		dev_err(dev, "%s: no sync word found\n", name);
+		status = -EINVAL;
+		goto err_fw;
+	}
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry) {
+		status = -ENOMEM;
+		goto err_fw;
+	}
+	strlcpy(entry->name, name, sizeof(entry->name));
+	entry->len = (fw->size - offset) & ~3;
+	entry->cpu_addr = dma_alloc_coherent(dev, entry->len,
+					     &entry->dma_addr, GFP_KERNEL);
+	if (!entry->cpu_addr) {
+		status = -ENOMEM;
+		goto err_entry;
+	}
+
+	memcpy(entry->cpu_addr, fw->data + offset, entry->len);
+	if (swap) {
+		u32 *p = entry->cpu_addr;
+		size_t i;
+
+		for (i = 0; i < entry->len / 4; i++)
+			p[i] = swab32(p[i]);
+	}
+	release_firmware(fw);
+
+	mutex_lock(&drvdata->cache_lock);
+	if (xdevcfg_cache_find(drvdata, entry->name)) {
+		mutex_unlock(&drvdata->cache_lock);
+		dma_free_coherent(dev, entry->len, entry->cpu_addr,
+				  entry->dma_addr);
+		kfree(entry);
+		return -EEXIST;
+	}
+	list_add_tail(&entry->node, &drvdata->cache);
+	mutex_unlock(&drvdata->cache_lock);
+
+	return size;
+
+err_entry:
+	kfree(entry);
+err_fw:
+	release_firmware(fw);
+	return status;
+}
+
+static DEVICE_ATTR(cache_load, 0200, NULL, xdevcfg_set_cache_load);
+
+/**
+ * xdevcfg_set_cache_activate() - Program a cached partial bitstream.
+ * @dev:	Pointer to the device structure.
+ * @attr:	Pointer to the device attribute structure.
+ * @buf:	The name the bitstream was loaded under.
+ * @size:	The number of bytes used from the buffer
+ * returns:	-ENOENT if the name is not cached, an error status or size
+ *
+ * The write returns once the PCAP DMA of the whole bitstream is done. The
+ * PL is not reset, the bitstream has to be a partial one.
+ */
+static ssize_t xdevcfg_set_cache_activate(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct xdevcfg_drvdata *drvdata = dev_get_drvdata(dev);
+	char namebuf[XDCFG_CACHE_NAME_LEN];
+	struct xdevcfg_cached *entry;
+	char *name;
+	ssize_t status;
+
+	name = xdevcfg_cache_name(buf, size, namebuf);
+	if (IS_ERR(name))
+		return PTR_ERR(name);
+
+	status = mutex_lock_interruptible(&drvdata->cache_lock);
+	if (status)
+		return status;
+
+	entry = xdevcfg_cache_find(drvdata, name);
+	if (!entry) {
+		status = -ENOENT;
+		goto err_cache;
+	}
+
+	status = clk_enable(drvdata->clk);
+	if (status)
+		goto err_cache;
+
+	status = mutex_lock_interruptible(&drvdata->sem);
+	if (status)
+		goto err_clk;
+
+	/* A bitstream may be half way written through the device */
+	if (drvdata->is_open) {
+		status = -EBUSY;
+		goto err_unlock;
+	}
+
+	xdevcfg_writereg(drvdata->base_address + XDCFG_INT_STS_OFFSET,
+			XDCFG_IXR_PCFG_DONE_MASK);
+
+	status = xdevcfg_dma_write(drvdata, entry->dma_addr, entry->len, true);
+
+err_unlock:
+	mutex_unlock(&drvdata->sem);
+err_clk:
+	clk_disable(drvdata->clk);
+err_cache:
+	mutex_unlock(&drvdata->cache_lock);
+
+	return status ? status : size;
+}
+
+static DEVICE_ATTR(cache_activate, 0200, NULL, xdevcfg_set_cache_activate);
+
+/**
+ * xdevcfg_set_cache_drop() - Drop a partial bitstream from the cache.
+ * @dev:	Pointer to the device structure.
+ * @attr:	Pointer to the device attribute structure.
+ * @buf:	The name the bitstream was loaded under.
+ * @size:	The number of bytes used from the buffer
+ * returns:	-ENOENT if the name is not cached or size
+ */
+static ssize_t xdevcfg_set_cache_drop(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct xdevcfg_drvdata *drvdata = dev_get_drvdata(dev);
+	char namebuf[XDCFG_CACHE_NAME_LEN];
+	struct xdevcfg_cached *entry;
+	char *name;
+	ssize_t status = size;
+
+	name = xdevcfg_cache_name(buf, size, namebuf);
+	if (IS_ERR(name))
+		return PTR_ERR(name);
+
+	mutex_lock(&drvdata->cache_lock);
+	entry = xdevcfg_cache_find(drvdata, name);
+	if (entry)
+		xdevcfg_cache_free(drvdata, entry);
+	else
+		status = -ENOENT;
+	mutex_unlock(&drvdata->cache_lock);
+
+	return status;
+}
+
+static DEVICE_ATTR(cache_drop, 0200, NULL, xdevcfg_set_cache_drop);
+
+/**
+ * xdevcfg_show_cache() - List the cached partial bitstreams.
+ * @dev:	Pointer to the device structure.
+ * @attr:	Pointer to the device attribute structure.
+ * @buf:	Pointer to the buffer location for the list.
+ * returns:	size of the buffer.
+ *
+ * One line per bitstream with its name and the length of its body.
+ */
+static ssize_t xdevcfg_show_cache(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct xdevcfg_drvdata *drvdata = dev_get_drvdata(dev);
+	struct xdevcfg_cached *entry;
+	ssize_t len = 0;
+
+	mutex_lock(&drvdata->cache_lock);
+	list_for_each_entry(entry, &drvdata->cache, node)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s %zu\n",
+				 entry->name, entry->len);
+	mutex_unlock(&drvdata->cache_lock);
+
+	return len;
+}
+
+static DEVICE_ATTR(cache, 0444, xdevcfg_show_cache, NULL);
+
 static const struct attribute *xdevcfg_attrs[] = {
 	&dev_attr_prog_done.attr, /* PCFG_DONE bit in Intr Status register */
 	&dev_attr_dbg_lock.attr, /* Debug lock bit in Lock register */
@@ -1581,6 +2344,10 @@ static const struct attribute *xdevcfg_attrs[] = {
 	&dev_attr_enable_dbg_in.attr, /* DBGEN bit in Control register */
 	&dev_attr_enable_dap.attr, /* DAP_EN bits in Control register */
 	&dev_attr_is_partial_bitstream.attr, /* Flag for partial bitstream */
+	&dev_attr_cache_load.attr, /* Load a partial bitstream into the cache */
+	&dev_attr_cache_activate.attr, /* Program a cached partial bitstream */
+	&dev_attr_cache_drop.attr, /* Drop a cached partial bitstream */
+	&dev_attr_cache.attr, /* List of cached partial bitstreams */
 	NULL,
 };
 
@@ -1916,6 +2683,8 @@ static int xdevcfg_drv_probe(struct platform_device *pdev)
 	platform_set_drvdata(pdev, drvdata);
 	spin_lock_init(&drvdata->lock);
 	mutex_init(&drvdata->sem);
+	INIT_LIST_HEAD(&drvdata->cache);
+	mutex_init(&drvdata->cache_lock);
 	drvdata->is_open = 0;
 	drvdata->is_partial_bitstream = 0;
 	drvdata->dma_done = 0;
@@ -1977,6 +2746,9 @@ static int xdevcfg_drv_probe(struct platform_device *pdev)
 				ctrlreg));
 
 
+	/* Optional memory-region for the bitstream cache */
+	drvdata->has_rmem = !of_reserved_mem_device_init(&pdev->dev);
+
 	retval = alloc_chrdev_region(&devt, 0, XDEVCFG_DEVICES, DRIVER_NAME);
 	if (retval < 0)
 		goto failed5;
@@ -2016,6 +2788,10 @@ static int xdevcfg_drv_probe(struct platform_device *pdev)
 
 	clk_disable(drvdata->clk);
 
+	mutex_lock(&xdevcfg_mutex);
+	xdevcfg_kernel_drvdata = drvdata;
+	mutex_unlock(&xdevcfg_mutex);
+
 	return 0;		/* Success */
 
 failed8:
@@ -2026,6 +2802,8 @@ failed6:
 	/* Unregister char driver */
 	unregister_chrdev_region(devt, XDEVCFG_DEVICES);
 failed5:
+	if (drvdata->has_rmem)
+		of_reserved_mem_device_release(&pdev->dev);
 	clk_disable_unprepare(drvdata->clk);
 
 	return retval;
@@ -2048,6 +2826,11 @@ static int xdevcfg_drv_remove(struct platform_device *pdev)
 	if (!drvdata)
 		return -ENODEV;
 
+	mutex_lock(&xdevcfg_mutex);
+	if (xdevcfg_kernel_drvdata == drvdata)
+		xdevcfg_kernel_drvdata = NULL;
+	mutex_unlock(&xdevcfg_mutex);
+
 	unregister_chrdev_region(drvdata->devt, XDEVCFG_DEVICES);
 
 	sysfs_remove_group(&pdev->dev.kobj, &xdevcfg_attr_group);
@@ -2056,6 +2839,13 @@ static int xdevcfg_drv_remove(struct platform_device *pdev)
 	device_destroy(drvdata->class, drvdata->devt);
 	class_destroy(drvdata->class);
 	cdev_del(&drvdata->cdev);
+
+	while (!list_empty(&drvdata->cache))
+		xdevcfg_cache_free(drvdata, list_first_entry(&drvdata->cache,
+					struct xdevcfg_cached, node));
+	if (drvdata->has_rmem)
+		of_reserved_mem_device_release(&pdev->dev);
+
 	clk_unprepare(drvdata->clk);
 
 	return 0;		/* Success */
@@ -30,6 +30,9 @@
  *
  *****************************************************************************/
 
+#include <linux/completion.h>
+#include <linux/dma-mapping.h>
+
 #include "fifo_icap.h"
 
 /* Register offsets for the XHwIcap device. */
@@ -82,6 +85,11 @@
    at once, in bytes. */
 #define XHI_MAX_READ_TRANSACTION_WORDS 0xFFF
 
+/* Fewer words than this are moved faster by register accesses than by
+   setting up a DMA transfer. */
+#define XHI_DMA_MIN_WORDS 64
+#define XHI_DMA_TIMEOUT_MS 1000
+
 
 /**
  * fifo_icap_fifo_write - Write data to the write FIFO.
@@ -198,6 +206,84 @@ static inline u32 fifo_icap_read_fifo_occupancy(
 	return in_be32(drvdata->base_address + XHI_RFO_OFFSET);
 }
 
+static void fifo_icap_dma_done(void *completion)
+{
+	complete(completion);
+}
+
+/**
+ * fifo_icap_dma_transfer - Move words between memory and a FIFO by DMA.
+ * @drvdata: a pointer to the drvdata.
+ * @frame_buffer: the words to write, or the buffer to read into.
+ * @num_words: the number of words, no more than the FIFO can take or holds.
+ * @dir: DMA_MEM_TO_DEV for the write FIFO, DMA_DEV_TO_MEM for the read FIFO.
+ *
+ * The FIFO registers are big endian like the rest of the core, so the
+ * words are byte swapped in place on little endian CPUs: the buffer holds
+ * the same values as with register accesses once the transfer is done,
+ * except for written words, which are left swapped.
+ **/
+static int fifo_icap_dma_transfer(struct hwicap_drvdata *drvdata,
+		u32 *frame_buffer, u32 num_words,
+		enum dma_transfer_direction dir)
+{
+	bool write = dir == DMA_MEM_TO_DEV;
+	struct dma_chan *chan = write ? drvdata->tx_chan : drvdata->rx_chan;
+	enum dma_data_direction map_dir = write ? DMA_TO_DEVICE :
+						  DMA_FROM_DEVICE;
+	struct dma_slave_config cfg = {
+		.direction = dir,
+		.src_addr = drvdata->mem_start + XHI_RF_OFFSET,
+		.dst_addr = drvdata->mem_start + XHI_WF_OFFSET,
+		.src_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES,
+		.dst_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES,
+	};
+	struct device *dma_dev = chan->device->dev;
+	struct dma_async_tx_descriptor *desc;
+	DECLARE_COMPLETION_ONSTACK(done);
+	size_t len = num_words << 2;
+	dma_addr_t addr;
+	int status = 0;
+	u32 i;
+
+	if (dmaengine_slave_config(chan, &cfg))
+		return -EIO;
+
+	if (write)
+		for (i = 0; i < num_words; i++)
+			cpu_to_be32s(&frame_buffer[i]);
+
+	addr = dma_map_single(dma_dev, frame_buffer, len, map_dir);
+	if (dma_mapping_error(dma_dev, addr))
+		return -ENOMEM;
+
+	desc = dmaengine_prep_slave_single(chan, addr, len, dir,
+					   DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!desc) {
+		status = -EIO;
+		goto unmap;
+	}
+	desc->callback = fifo_icap_dma_done;
+	desc->callback_param = &done;
+	dmaengine_submit(desc);
+	dma_async_issue_pending(chan);
+
+	if (!wait_for_completion_timeout(&done,
+				msecs_to_jiffies(XHI_DMA_TIMEOUT_MS))) {
+		dmaengine_terminate_all(chan);
+		status = -EIO;
+	}
+
+ unmap:
+	dma_unmap_single(dma_dev, addr, len, map_dir);
+
+	if (!write)
+		for (i = 0; i < num_words; i++)
+			be32_to_cpus(&frame_buffer[i]);
+
+	return status;
+}
+
 /**
  * fifo_icap_set_configuration - Send configuration data to the ICAP.
  * @drvdata: a pointer to the drvdata.
@@ -208,7 +294,9 @@ static inline u32 fifo_icap_read_fifo_occupancy(
 
  * This function writes the given user data to the Write FIFO in
  * polled mode and starts the transfer of the data to
- * the ICAP device.
+ * the ICAP device.  Whenever the FIFO has room for enough words, they
+ * are written by the tx DMA channel, if there is one, which leaves them
+ * byte swapped in @frame_buffer on little endian CPUs.
  **/
 int fifo_icap_set_configuration(struct hwicap_drvdata *drvdata,
 		u32 *frame_buffer, u32 num_words)
@@ -233,8 +321,9 @@ int fifo_icap_set_configuration(struct hwicap_drvdata *drvdata,
 
 	while (remaining_words > 0) {
 		/*
-		 * Wait until we have some data in the fifo.
+		 * Wait until we have some space in the fifo.
 		 */
+		retries = 0;
 		while (write_fifo_vacancy == 0) {
 			write_fifo_vacancy =
 				fifo_icap_write_fifo_vacancy(drvdata);
@@ -243,6 +332,22 @@ int fifo_icap_set_configuration(struct hwicap_drvdata *drvdata,
 				return -EIO;
 		}
 
+		if (drvdata->tx_chan &&
+		    min(write_fifo_vacancy, remaining_words) >=
+		    XHI_DMA_MIN_WORDS) {
+			u32 words = min(write_fifo_vacancy, remaining_words);
+			int status;
+
+			status = fifo_icap_dma_transfer(drvdata, frame_buffer,
+					words, DMA_MEM_TO_DEV);
+			if (status)
+				return status;
+
+			remaining_words -= words;
+			write_fifo_vacancy -= words;
+			frame_buffer += words;
+		}
+
 		/*
 		 * Write data into the Write FIFO.
 		 */
@@ -259,6 +364,7 @@ int fifo_icap_set_configuration(struct hwicap_drvdata *drvdata,
 	}
 
 	/* Wait until the write has finished. */
+	retries = 0;
 	while (fifo_icap_busy(drvdata)) {
 		retries++;
 		if (retries > XHI_MAX_RETRIES)
@@ -284,7 +390,8 @@ int fifo_icap_set_configuration(struct hwicap_drvdata *drvdata,
  * @size: the size of the partial bitstream in 32 bit words.
  *
  * This function reads the specified number of words from the ICAP device in
- * the polled mode.
+ * the polled mode.  Whenever enough words wait in the FIFO, they are read
+ * by the rx DMA channel, if there is one.
  */
 int fifo_icap_get_configuration(struct hwicap_drvdata *drvdata,
 		u32 *frame_buffer, u32 num_words)
@@ -320,6 +427,7 @@ int fifo_icap_get_configuration(struct hwicap_drvdata *drvdata,
 
 		while (words_to_read > 0) {
 			/* Wait until we have some data in the fifo. */
+			retries = 0;
 			while (read_fifo_occupancy == 0) {
 				read_fifo_occupancy =
 					fifo_icap_read_fifo_occupancy(drvdata);
@@ -333,6 +441,20 @@ int fifo_icap_get_configuration(struct hwicap_drvdata *drvdata,
 
 			words_to_read -= read_fifo_occupancy;
 
+			if (drvdata->rx_chan &&
+			    read_fifo_occupancy >= XHI_DMA_MIN_WORDS) {
+				int status;
+
+				status = fifo_icap_dma_transfer(drvdata, data,
+						read_fifo_occupancy,
+						DMA_DEV_TO_MEM);
+				if (status)
+					return status;
+
+				data += read_fifo_occupancy;
+				read_fifo_occupancy = 0;
+			}
+
 			/* Read the data from the Read FIFO. */
 			while (read_fifo_occupancy != 0) {
 				*data++ = fifo_icap_fifo_read(drvdata);
@@ -595,6 +595,14 @@ static const struct file_operations hwicap_fops = {
 	.llseek = noop_llseek,
 };
 
+static void hwicap_release_dma(struct hwicap_drvdata *drvdata)
+{
+	if (drvdata->tx_chan)
+		dma_release_channel(drvdata->tx_chan);
+	if (drvdata->rx_chan)
+		dma_release_channel(drvdata->rx_chan);
+}
+
 static int hwicap_setup(struct device *dev, int id,
 		const struct resource *regs_res,
 		const struct hwicap_driver_config *config,
@@ -668,6 +676,10 @@ static int hwicap_setup(struct device *dev, int id,
 	drvdata->config = config;
 	drvdata->config_regs = config_regs;
 
+	/* FIFO cores may have DMA channels for bulk configuration data. */
+	drvdata->tx_chan = dma_request_slave_channel(dev, "tx");
+	drvdata->rx_chan = dma_request_slave_channel(dev, "rx");
+
 	mutex_init(&drvdata->sem);
 	drvdata->is_open = 0;
 
@@ -688,6 +700,7 @@ static int hwicap_setup(struct device *dev, int id,
 	return 0;		/* success */
 
  failed3:
+	hwicap_release_dma(drvdata);
 	iounmap(drvdata->base_address);
 
  failed2:
@@ -729,6 +742,7 @@ static int hwicap_remove(struct device *dev)
 
 	device_destroy(icap_class, drvdata->devt);
 	cdev_del(&drvdata->cdev);
+	hwicap_release_dma(drvdata);
 	iounmap(drvdata->base_address);
 	release_mem_region(drvdata->mem_start, drvdata->mem_size);
 	kfree(drvdata);
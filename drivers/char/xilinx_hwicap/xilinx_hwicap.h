@@ -35,6 +35,7 @@
 
 #include <linux/types.h>
 #include <linux/cdev.h>
+#include <linux/dmaengine.h>
 #include <linux/platform_device.h>
 
 #include <linux/io.h>
@@ -55,6 +56,8 @@ struct hwicap_drvdata {
 
 	const struct hwicap_driver_config *config;
 	const struct config_registers *config_regs;
+	struct dma_chan *tx_chan;	/* Optional, feeds the write fifo */
+	struct dma_chan *rx_chan;	/* Optional, drains the read fifo */
 	void *private_data;
 	bool is_open;
 	struct mutex sem;
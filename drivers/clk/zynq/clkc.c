@@ -152,8 +152,7 @@ static void __init zynq_clk_register_fclk(enum zynq_clk fclk,
 	struct clk *clk;
 	u32 enable_reg;
 	char *mux_name;
-	char *div0_name;
-	char *div1_name;
+	char *div_name;
 	spinlock_t *fclk_lock;
 	spinlock_t *fclk_gate_lock;
 	void __iomem *fclk_gate_reg = fclk_ctrl_reg + 8;
@@ -170,28 +169,20 @@ static void __init zynq_clk_register_fclk(enum zynq_clk fclk,
 	mux_name = kasprintf(GFP_KERNEL, "%s_mux", clk_name);
 	if (!mux_name)
 		goto err_mux_name;
-	div0_name = kasprintf(GFP_KERNEL, "%s_div0", clk_name);
-	if (!div0_name)
-		goto err_div0_name;
-	div1_name = kasprintf(GFP_KERNEL, "%s_div1", clk_name);
-	if (!div1_name)
-		goto err_div1_name;
+	div_name = kasprintf(GFP_KERNEL, "%s_div", clk_name);
+	if (!div_name)
+		goto err_div_name;
 
 	clk = clk_register_mux(NULL, mux_name, parents, 4,
 			CLK_SET_RATE_NO_REPARENT, fclk_ctrl_reg, 4, 2, 0,
 			fclk_lock);
 
-	clk = clk_register_divider(NULL, div0_name, mux_name,
-			0, fclk_ctrl_reg, 8, 6, CLK_DIVIDER_ONE_BASED |
-			CLK_DIVIDER_ALLOW_ZERO, fclk_lock);
-
-	clk = clk_register_divider(NULL, div1_name, div0_name,
-			CLK_SET_RATE_PARENT, fclk_ctrl_reg, 20, 6,
-			CLK_DIVIDER_ONE_BASED | CLK_DIVIDER_ALLOW_ZERO,
+	/* both dividers at once, so that the PL never sees a glitch */
+	clk = clk_register_zynq_fclk_div(div_name, mux_name, fclk_ctrl_reg,
 			fclk_lock);
 
 	clks[fclk] = clk_register_gate(NULL, clk_name,
-			div1_name, CLK_SET_RATE_PARENT, fclk_gate_reg,
+			div_name, CLK_SET_RATE_PARENT, fclk_gate_reg,
 			0, CLK_GATE_SET_TO_DISABLE, fclk_gate_lock);
 	enable_reg = clk_readl(fclk_gate_reg) & 1;
 	if (enable && !enable_reg) {
@@ -200,14 +191,11 @@ static void __init zynq_clk_register_fclk(enum zynq_clk fclk,
 					fclk - fclk0);
 	}
 	kfree(mux_name);
-	kfree(div0_name);
-	kfree(div1_name);
+	kfree(div_name);
 
 	return;
 
-err_div1_name:
-	kfree(div0_name);
-err_div0_name:
+err_div_name:
 	kfree(mux_name);
 err_mux_name:
 	kfree(fclk_gate_lock);
@@ -307,7 +295,8 @@ static void __init zynq_clk_setup(struct device_node *np)
 	clk = clk_register_zynq_pll("armpll_int", "ps_clk", SLCR_ARMPLL_CTRL,
 			SLCR_PLL_STATUS, 0, &armpll_lock);
 	clks[armpll] = clk_register_mux(NULL, clk_output_name[armpll],
-			armpll_parents, 2, CLK_SET_RATE_NO_REPARENT,
+			armpll_parents, 2, CLK_SET_RATE_PARENT |
+			CLK_SET_RATE_NO_REPARENT,
 			SLCR_ARMPLL_CTRL, 4, 1, 0, &armpll_lock);
 
 	clk = clk_register_zynq_pll("ddrpll_int", "ps_clk", SLCR_DDRPLL_CTRL,
@@ -324,10 +313,15 @@ static void __init zynq_clk_setup(struct device_node *np)
 
 	/* CPU clocks */
 	tmp = clk_readl(SLCR_621_TRUE) & 1;
+	/*
+	 * cpufreq picks a frequency from the ARM PLL and the divider, for
+	 * finer steps than the divider alone can make.
+	 */
 	clk = clk_register_mux(NULL, "cpu_mux", cpu_parents, 4,
-			CLK_SET_RATE_NO_REPARENT, SLCR_ARM_CLK_CTRL, 4, 2, 0,
-			&armclk_lock);
-	clk = clk_register_divider(NULL, "cpu_div", "cpu_mux", 0,
+			CLK_SET_RATE_PARENT | CLK_SET_RATE_NO_REPARENT,
+			SLCR_ARM_CLK_CTRL, 4, 2, 0, &armclk_lock);
+	clk = clk_register_divider(NULL, "cpu_div", "cpu_mux",
+			CLK_SET_RATE_PARENT,
 			SLCR_ARM_CLK_CTRL, 8, 6, CLK_DIVIDER_ONE_BASED |
 			CLK_DIVIDER_ALLOW_ZERO, &armclk_lock);
 
@@ -0,0 +1,241 @@
+/*
+ * Zynq PL clock (FCLK) divider
+ *
+ *  Copyright (C) 2015 Xilinx
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License v2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * The FCLKs are divided by two cascaded 6 bit dividers in the same
+ * control register. Modelling them as two clk dividers makes a rate
+ * change write the register twice, and the PL runs at an unintended
+ * frequency in between. This driver treats both as one divider whose
+ * value is the product of the two and switches them with a single
+ * register write. The products the hardware can generate are computed
+ * once, so that rounding a rate is a binary search.
+ */
+#include <linux/bsearch.h>
+#include <linux/clk/zynq.h>
+#include <linux/clk-provider.h>
+#include <linux/slab.h>
+#include <linux/io.h>
+
+/**
+ * struct zynq_fclk_div
+ * @hw:		Handle between common and hardware-specific interfaces
+ * @clk_ctrl:	FCLK control register
+ * @lock:	Register lock
+ */
+struct zynq_fclk_div {
+	struct clk_hw	hw;
+	void __iomem	*clk_ctrl;
+	spinlock_t	*lock;
+};
+#define to_zynq_fclk_div(_hw)	container_of(_hw, struct zynq_fclk_div, hw)
+
+/* Register bitfield defines */
+#define FCLKCTRL_DIV0_SHIFT	8
+#define FCLKCTRL_DIV1_SHIFT	20
+#define FCLKCTRL_DIV_MASK	0x3f
+#define FCLK_DIV_MAX		FCLKCTRL_DIV_MASK
+
+/**
+ * struct zynq_fclk_div_entry - Divider the hardware can generate
+ * @div:	Product of @div0 and @div1
+ * @div0:	First stage divisor
+ * @div1:	Second stage divisor
+ */
+struct zynq_fclk_div_entry {
+	u16	div;
+	u8	div0;
+	u8	div1;
+};
+
+/* sorted by div, shared by all FCLKs */
+static struct zynq_fclk_div_entry *fclk_div_table;
+static unsigned int fclk_div_table_len;
+
+static int __init zynq_fclk_div_table_init(void)
+{
+	unsigned int div, div0, n = 0;
+
+	if (fclk_div_table)
+		return 0;
+
+	fclk_div_table = kcalloc(FCLK_DIV_MAX * FCLK_DIV_MAX,
+			sizeof(*fclk_div_table), GFP_KERNEL);
+	if (!fclk_div_table)
+		return -ENOMEM;
+
+	for (div = 1; div <= FCLK_DIV_MAX * FCLK_DIV_MAX; div++) {
+		/* the smallest first stage divisor for which div1 fits */
+		for (div0 = DIV_ROUND_UP(div, FCLK_DIV_MAX);
+		     div0 <= FCLK_DIV_MAX; div0++) {
+			if (div % div0)
+				continue;
+			fclk_div_table[n].div = div;
+			fclk_div_table[n].div0 = div0;
+			fclk_div_table[n].div1 = div / div0;
+			n++;
+			break;
+		}
+	}
+	fclk_div_table_len = n;
+
+	/* about a quarter of the products can be generated */
+	fclk_div_table = krealloc(fclk_div_table, n * sizeof(*fclk_div_table),
+			GFP_KERNEL) ?: fclk_div_table;
+
+	return 0;
+}
+
+static int zynq_fclk_div_cmp(const void *key, const void *elt)
+{
+	unsigned long div = *(const unsigned long *)key;
+	const struct zynq_fclk_div_entry *e = elt;
+
+	/* match the first entry that divides enough */
+	if (div > e->div)
+		return 1;
+	if (e == fclk_div_table || div > (e - 1)->div)
+		return 0;
+	return -1;
+}
+
+/**
+ * zynq_fclk_div_find() - Find the divider for a clock frequency
+ * @rate:	Desired clock frequency
+ * @prate:	Clock frequency of parent clock
+ * Returns the smallest divider that does not exceed @rate, or the
+ * largest one if none does.
+ */
+static const struct zynq_fclk_div_entry *zynq_fclk_div_find(
+		unsigned long rate, unsigned long prate)
+{
+	const struct zynq_fclk_div_entry *e;
+	unsigned long div;
+
+	div = rate ? DIV_ROUND_UP(prate, rate) : ULONG_MAX;
+	if (div > fclk_div_table[fclk_div_table_len - 1].div)
+		return &fclk_div_table[fclk_div_table_len - 1];
+
+	e = bsearch(&div, fclk_div_table, fclk_div_table_len,
+			sizeof(*fclk_div_table), zynq_fclk_div_cmp);
+	return e ? e : fclk_div_table;
+}
+
+/**
+ * zynq_fclk_div_round_rate() - Round a clock frequency
+ * @hw:		Handle between common and hardware-specific interfaces
+ * @rate:	Desired clock frequency
+ * @prate:	Clock frequency of parent clock
+ * Returns the highest frequency not above @rate the dividers can generate.
+ */
+static long zynq_fclk_div_round_rate(struct clk_hw *hw, unsigned long rate,
+		unsigned long *prate)
+{
+	return DIV_ROUND_UP(*prate, zynq_fclk_div_find(rate, *prate)->div);
+}
+
+/**
+ * zynq_fclk_div_recalc_rate() - Recalculate clock frequency
+ * @hw:			Handle between common and hardware-specific interfaces
+ * @parent_rate:	Clock frequency of parent clock
+ * Returns current clock frequency.
+ */
+static unsigned long zynq_fclk_div_recalc_rate(struct clk_hw *hw,
+		unsigned long parent_rate)
+{
+	struct zynq_fclk_div *clk = to_zynq_fclk_div(hw);
+	u32 reg, div0, div1;
+
+	reg = clk_readl(clk->clk_ctrl);
+	div0 = (reg >> FCLKCTRL_DIV0_SHIFT) & FCLKCTRL_DIV_MASK;
+	div1 = (reg >> FCLKCTRL_DIV1_SHIFT) & FCLKCTRL_DIV_MASK;
+
+	/* a zero divisor divides by one */
+	return DIV_ROUND_UP(parent_rate, max(div0, 1U) * max(div1, 1U));
+}
+
+/**
+ * zynq_fclk_div_set_rate() - Change the clock frequency
+ * @hw:			Handle between common and hardware-specific interfaces
+ * @rate:		Desired clock frequency
+ * @parent_rate:	Clock frequency of parent clock
+ * Returns 0 on success
+ */
+static int zynq_fclk_div_set_rate(struct clk_hw *hw, unsigned long rate,
+		unsigned long parent_rate)
+{
+	struct zynq_fclk_div *clk = to_zynq_fclk_div(hw);
+	const struct zynq_fclk_div_entry *e;
+	unsigned long flags = 0;
+	u32 reg;
+
+	e = zynq_fclk_div_find(rate, parent_rate);
+
+	spin_lock_irqsave(clk->lock, flags);
+
+	reg = clk_readl(clk->clk_ctrl);
+	reg &= ~((FCLKCTRL_DIV_MASK << FCLKCTRL_DIV0_SHIFT) |
+		 (FCLKCTRL_DIV_MASK << FCLKCTRL_DIV1_SHIFT));
+	reg |= (e->div0 << FCLKCTRL_DIV0_SHIFT) |
+	       (e->div1 << FCLKCTRL_DIV1_SHIFT);
+	clk_writel(reg, clk->clk_ctrl);
+
+	spin_unlock_irqrestore(clk->lock, flags);
+
+	return 0;
+}
+
+static const struct clk_ops zynq_fclk_div_ops = {
+	.round_rate = zynq_fclk_div_round_rate,
+	.recalc_rate = zynq_fclk_div_recalc_rate,
+	.set_rate = zynq_fclk_div_set_rate
+};
+
+/**
+ * clk_register_zynq_fclk_div() - Register FCLK divider with the clock framework
+ * @name	Divider name
+ * @parent	Parent clock name
+ * @clk_ctrl	Pointer to FCLK control register
+ * @lock	Register lock
+ * Returns handle to the registered clock.
+ */
+struct clk *__init clk_register_zynq_fclk_div(const char *name,
+		const char *parent, void __iomem *clk_ctrl, spinlock_t *lock)
+{
+	struct zynq_fclk_div *div;
+	struct clk *clk;
+	const char *parent_arr[1] = {parent};
+	struct clk_init_data initd = {
+		.name = name,
+		.parent_names = parent_arr,
+		.ops = &zynq_fclk_div_ops,
+		.num_parents = 1,
+		.flags = 0
+	};
+
+	if (zynq_fclk_div_table_init())
+		return ERR_PTR(-ENOMEM);
+
+	div = kmalloc(sizeof(*div), GFP_KERNEL);
+	if (!div)
+		return ERR_PTR(-ENOMEM);
+
+	div->hw.init = &initd;
+	div->clk_ctrl = clk_ctrl;
+	div->lock = lock;
+
+	clk = clk_register(NULL, &div->hw);
+	if (WARN_ON(IS_ERR(clk)))
+		kfree(div);
+
+	return clk;
+}
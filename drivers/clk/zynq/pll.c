@@ -20,6 +20,7 @@
  */
 #include <linux/clk/zynq.h>
 #include <linux/clk-provider.h>
+#include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/io.h>
 
@@ -44,15 +45,62 @@ struct zynq_pll {
 /* Register bitfield defines */
 #define PLLCTRL_FBDIV_MASK	0x7f000
 #define PLLCTRL_FBDIV_SHIFT	12
+#define PLLCTRL_BPFORCE_MASK	(1 << 4)
 #define PLLCTRL_BPQUAL_MASK	(1 << 3)
 #define PLLCTRL_PWRDWN_MASK	2
 #define PLLCTRL_PWRDWN_SHIFT	1
 #define PLLCTRL_RESET_MASK	1
 #define PLLCTRL_RESET_SHIFT	0
 
+#define PLLCFG_OFFSET		0x10
+#define PLLCFG_LOCK_CNT_SHIFT	12
+#define PLLCFG_CP_SHIFT		8
+#define PLLCFG_RES_SHIFT	4
+
 #define PLL_FBDIV_MIN	13
 #define PLL_FBDIV_MAX	66
 
+/* the lock takes at most 750 reference clock cycles */
+#define PLL_LOCK_TIMEOUT_US	100
+
+/**
+ * struct zynq_pll_cfg - Loop filter settings for a range of dividers
+ * @fbdiv:	Largest feedback divider the settings are for
+ * @cp:		Charge pump control
+ * @res:	Loop filter resistor control
+ * @lock_cnt:	Lock circuit counter
+ */
+struct zynq_pll_cfg {
+	u8	fbdiv;
+	u8	cp;
+	u8	res;
+	u16	lock_cnt;
+};
+
+/* from the PLL frequency control settings table of the TRM */
+static const struct zynq_pll_cfg zynq_pll_cfgs[] = {
+	{ 13, 2,  6, 750 },
+	{ 14, 2,  6, 700 },
+	{ 15, 2,  6, 650 },
+	{ 16, 2, 10, 625 },
+	{ 17, 2, 10, 575 },
+	{ 18, 2, 10, 550 },
+	{ 19, 2, 10, 525 },
+	{ 20, 2, 12, 500 },
+	{ 21, 2, 12, 475 },
+	{ 22, 2, 12, 450 },
+	{ 23, 2, 12, 425 },
+	{ 25, 2, 12, 400 },
+	{ 26, 2, 12, 375 },
+	{ 28, 2, 12, 350 },
+	{ 30, 2, 12, 325 },
+	{ 33, 2,  2, 300 },
+	{ 36, 2,  2, 275 },
+	{ 40, 2,  2, 250 },
+	{ 47, 3, 12, 250 },
+	{ 66, 2,  4, 250 },
+};
+
 /**
  * zynq_pll_round_rate() - Round a clock frequency
  * @hw:		Handle between common and hardware-specific interfaces
@@ -175,12 +223,78 @@ static void zynq_pll_disable(struct clk_hw *hw)
 	spin_unlock_irqrestore(clk->lock, flags);
 }
 
+/**
+ * zynq_pll_set_rate - Change the PLL frequency
+ * @hw:			Handle between common and hardware-specific interfaces
+ * @rate:		Desired clock frequency
+ * @parent_rate:	Clock frequency of parent clock
+ * Returns 0 on success
+ *
+ * The PLL is bypassed while it relocks, its consumers run from the
+ * reference clock in the meantime instead of from an unstable output.
+ */
+static int zynq_pll_set_rate(struct clk_hw *hw, unsigned long rate,
+		unsigned long parent_rate)
+{
+	struct zynq_pll *clk = to_zynq_pll(hw);
+	const struct zynq_pll_cfg *cfg = zynq_pll_cfgs;
+	void __iomem *pll_cfg = clk->pll_ctrl + PLLCFG_OFFSET;
+	unsigned long flags = 0;
+	unsigned int timeout;
+	u32 fbdiv, reg, ctrl;
+	int ret = 0;
+
+	fbdiv = clamp_t(u32, DIV_ROUND_CLOSEST(rate, parent_rate),
+			PLL_FBDIV_MIN, PLL_FBDIV_MAX);
+	while (cfg->fbdiv < fbdiv)
+		cfg++;
+
+	spin_lock_irqsave(clk->lock, flags);
+
+	ctrl = clk_readl(clk->pll_ctrl);
+	if (((ctrl & PLLCTRL_FBDIV_MASK) >> PLLCTRL_FBDIV_SHIFT) == fbdiv)
+		goto out;
+
+	reg = ctrl | PLLCTRL_BPFORCE_MASK;
+	clk_writel(reg, clk->pll_ctrl);
+
+	clk_writel((cfg->lock_cnt << PLLCFG_LOCK_CNT_SHIFT) |
+			(cfg->cp << PLLCFG_CP_SHIFT) |
+			(cfg->res << PLLCFG_RES_SHIFT), pll_cfg);
+
+	reg &= ~PLLCTRL_FBDIV_MASK;
+	reg |= fbdiv << PLLCTRL_FBDIV_SHIFT;
+	clk_writel(reg | PLLCTRL_RESET_MASK, clk->pll_ctrl);
+	clk_writel(reg, clk->pll_ctrl);
+
+	for (timeout = PLL_LOCK_TIMEOUT_US; timeout; timeout--) {
+		if (clk_readl(clk->pll_status) & (1 << clk->lockbit))
+			break;
+		udelay(1);
+	}
+	if (!timeout) {
+		/* stay on the reference clock rather than an unlocked PLL */
+		pr_err("PLL: no lock at divider %u\n", fbdiv);
+		ret = -ETIMEDOUT;
+		goto out;
+	}
+
+	/* back to the PLL unless the mux had selected the bypass anyway */
+	if (!(ctrl & PLLCTRL_BPFORCE_MASK))
+		clk_writel(reg & ~PLLCTRL_BPFORCE_MASK, clk->pll_ctrl);
+out:
+	spin_unlock_irqrestore(clk->lock, flags);
+
+	return ret;
+}
+
 static const struct clk_ops zynq_pll_ops = {
 	.enable = zynq_pll_enable,
 	.disable = zynq_pll_disable,
 	.is_enabled = zynq_pll_is_enabled,
 	.round_rate = zynq_pll_round_rate,
-	.recalc_rate = zynq_pll_recalc_rate
+	.recalc_rate = zynq_pll_recalc_rate,
+	.set_rate = zynq_pll_set_rate
 };
 
 /**
@@ -0,0 +1,304 @@
+/*
+ *  linux/drivers/cpufreq/cpufreq_schedutil.c
+ *
+ *  Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Frequency selection from the utilization the scheduler reports at
+ * enqueue, dequeue and tick time, instead of from load sampled by a
+ * timer. The frequency is chosen so that the utilization of the busiest
+ * cpu of the policy ends up at 80% of the capacity at that frequency;
+ * while rt tasks run the highest frequency is used.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/cpufreq.h>
+#include <linux/init.h>
+#include <linux/irq_work.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/sched/rt.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+/* minimum time between two frequency changes */
+#define SUGOV_MIN_RATE_LIMIT_NS	NSEC_PER_MSEC
+
+/* reports older than this are from a cpu that went idle */
+#define SUGOV_STALE_NS		(2 * TICK_NSEC)
+
+struct sugov_policy {
+	struct cpufreq_policy *policy;
+
+	raw_spinlock_t update_lock;	/* protects the fields below */
+	u64 last_freq_update_time;
+	s64 freq_update_delay_ns;
+	unsigned int next_freq;
+	bool work_in_progress;
+
+	struct irq_work irq_work;
+	struct kthread_work work;
+	struct kthread_worker worker;
+	struct task_struct *thread;
+	struct mutex work_lock;		/* serializes with limits changes */
+};
+
+struct sugov_cpu {
+	struct update_util_data update_util;
+	struct sugov_policy *sg_policy;
+
+	unsigned long util;
+	unsigned long max;
+	u64 last_update;
+};
+
+static DEFINE_PER_CPU(struct sugov_cpu, sugov_cpu);
+
+static unsigned int get_next_freq(struct cpufreq_policy *policy,
+				  unsigned long util, unsigned long max)
+{
+	unsigned int freq = policy->cpuinfo.max_freq;
+
+	if (util >= max)
+		return freq;
+
+	/* leave ~20% of headroom */
+	return div_u64((u64)(freq + (freq >> 2)) * util, max);
+}
+
+/* called with update_lock held */
+static unsigned int sugov_aggregate(struct sugov_policy *sg_policy, u64 time)
+{
+	struct cpufreq_policy *policy = sg_policy->policy;
+	unsigned long util = 0, max = 1;
+	unsigned int cpu;
+
+	for_each_cpu(cpu, policy->cpus) {
+		struct sugov_cpu *sg_cpu = &per_cpu(sugov_cpu, cpu);
+
+		if ((s64)(time - sg_cpu->last_update) > SUGOV_STALE_NS)
+			continue;
+
+		if (sg_cpu->util >= sg_cpu->max)
+			return policy->cpuinfo.max_freq;
+
+		/* util / max > cur_util / cur_max */
+		if (sg_cpu->util * max > util * sg_cpu->max) {
+			util = sg_cpu->util;
+			max = sg_cpu->max;
+		}
+	}
+
+	return get_next_freq(policy, util, max);
+}
+
+static void sugov_update(struct update_util_data *data, u64 time,
+			 unsigned long util, unsigned long max)
+{
+	struct sugov_cpu *sg_cpu = container_of(data, struct sugov_cpu,
+						update_util);
+	struct sugov_policy *sg_policy = sg_cpu->sg_policy;
+	unsigned int next_f;
+
+	raw_spin_lock(&sg_policy->update_lock);
+
+	sg_cpu->util = util;
+	sg_cpu->max = max;
+	sg_cpu->last_update = time;
+
+	if (sg_policy->work_in_progress ||
+	    (s64)(time - sg_policy->last_freq_update_time) <
+	    sg_policy->freq_update_delay_ns)
+		goto out;
+
+	next_f = sugov_aggregate(sg_policy, time);
+	if (next_f == sg_policy->next_freq)
+		goto out;
+
+	sg_policy->next_freq = next_f;
+	sg_policy->last_freq_update_time = time;
+	sg_policy->work_in_progress = true;
+
+	/* the rq lock is held, the change has to happen from a thread */
+	irq_work_queue(&sg_policy->irq_work);
+out:
+	raw_spin_unlock(&sg_policy->update_lock);
+}
+
+static void sugov_work(struct kthread_work *work)
+{
+	struct sugov_policy *sg_policy = container_of(work,
+					struct sugov_policy, work);
+
+	mutex_lock(&sg_policy->work_lock);
+	__cpufreq_driver_target(sg_policy->policy, sg_policy->next_freq,
+				CPUFREQ_RELATION_L);
+	mutex_unlock(&sg_policy->work_lock);
+
+	sg_policy->work_in_progress = false;
+}
+
+static void sugov_irq_work(struct irq_work *irq_work)
+{
+	struct sugov_policy *sg_policy = container_of(irq_work,
+					struct sugov_policy, irq_work);
+
+	queue_kthread_work(&sg_policy->worker, &sg_policy->work);
+}
+
+static int sugov_init(struct cpufreq_policy *policy)
+{
+	struct sched_param param = { .sched_priority = MAX_USER_RT_PRIO / 2 };
+	struct sugov_policy *sg_policy;
+	struct task_struct *thread;
+
+	sg_policy = kzalloc(sizeof(*sg_policy), GFP_KERNEL);
+	if (!sg_policy)
+		return -ENOMEM;
+
+	sg_policy->policy = policy;
+	raw_spin_lock_init(&sg_policy->update_lock);
+	mutex_init(&sg_policy->work_lock);
+	init_irq_work(&sg_policy->irq_work, sugov_irq_work);
+	init_kthread_work(&sg_policy->work, sugov_work);
+	init_kthread_worker(&sg_policy->worker);
+
+	thread = kthread_create(kthread_worker_fn, &sg_policy->worker,
+				"sugov:%d", cpumask_first(policy->related_cpus));
+	if (IS_ERR(thread)) {
+		pr_err("failed to create thread: %ld\n", PTR_ERR(thread));
+		kfree(sg_policy);
+		return PTR_ERR(thread);
+	}
+
+	/* frequency increases are wanted before the work they are for */
+	sched_setscheduler(thread, SCHED_FIFO, &param);
+	set_cpus_allowed_ptr(thread, policy->related_cpus);
+	sg_policy->thread = thread;
+	wake_up_process(thread);
+
+	policy->governor_data = sg_policy;
+	return 0;
+}
+
+static void sugov_exit(struct cpufreq_policy *policy)
+{
+	struct sugov_policy *sg_policy = policy->governor_data;
+
+	policy->governor_data = NULL;
+	flush_kthread_worker(&sg_policy->worker);
+	kthread_stop(sg_policy->thread);
+	kfree(sg_policy);
+}
+
+static void sugov_start(struct cpufreq_policy *policy)
+{
+	struct sugov_policy *sg_policy = policy->governor_data;
+	s64 delay = SUGOV_MIN_RATE_LIMIT_NS;
+	unsigned int cpu;
+
+	if (policy->cpuinfo.transition_latency != CPUFREQ_ETERNAL)
+		delay = max_t(s64, delay,
+			      10LL * policy->cpuinfo.transition_latency);
+
+	sg_policy->freq_update_delay_ns = delay;
+	sg_policy->last_freq_update_time = 0;
+	sg_policy->next_freq = 0;
+	sg_policy->work_in_progress = false;
+
+	for_each_cpu(cpu, policy->cpus) {
+		struct sugov_cpu *sg_cpu = &per_cpu(sugov_cpu, cpu);
+
+		memset(sg_cpu, 0, sizeof(*sg_cpu));
+		sg_cpu->sg_policy = sg_policy;
+		cpufreq_add_update_util_hook(cpu, &sg_cpu->update_util,
+					     sugov_update);
+	}
+}
+
+static void sugov_stop(struct cpufreq_policy *policy)
+{
+	struct sugov_policy *sg_policy = policy->governor_data;
+	unsigned int cpu;
+
+	for_each_cpu(cpu, policy->cpus)
+		cpufreq_remove_update_util_hook(cpu);
+
+	synchronize_sched();
+
+	irq_work_sync(&sg_policy->irq_work);
+	flush_kthread_work(&sg_policy->work);
+}
+
+static void sugov_limits(struct cpufreq_policy *policy)
+{
+	struct sugov_policy *sg_policy = policy->governor_data;
+
+	mutex_lock(&sg_policy->work_lock);
+	if (policy->max < policy->cur)
+		__cpufreq_driver_target(policy, policy->max,
+					CPUFREQ_RELATION_H);
+	else if (policy->min > policy->cur)
+		__cpufreq_driver_target(policy, policy->min,
+					CPUFREQ_RELATION_L);
+	mutex_unlock(&sg_policy->work_lock);
+}
+
+static int cpufreq_governor_schedutil(struct cpufreq_policy *policy,
+				      unsigned int event)
+{
+	switch (event) {
+	case CPUFREQ_GOV_POLICY_INIT:
+		return sugov_init(policy);
+	case CPUFREQ_GOV_POLICY_EXIT:
+		sugov_exit(policy);
+		break;
+	case CPUFREQ_GOV_START:
+		sugov_start(policy);
+		break;
+	case CPUFREQ_GOV_STOP:
+		sugov_stop(policy);
+		break;
+	case CPUFREQ_GOV_LIMITS:
+		sugov_limits(policy);
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+#ifdef CONFIG_CPU_FREQ_GOV_SCHEDUTIL_MODULE
+static
+#endif
+struct cpufreq_governor cpufreq_gov_schedutil = {
+	.name		= "schedutil",
+	.governor	= cpufreq_governor_schedutil,
+	.owner		= THIS_MODULE,
+};
+
+static int __init cpufreq_gov_schedutil_init(void)
+{
+	return cpufreq_register_governor(&cpufreq_gov_schedutil);
+}
+
+static void __exit cpufreq_gov_schedutil_exit(void)
+{
+	cpufreq_unregister_governor(&cpufreq_gov_schedutil);
+}
+
+MODULE_DESCRIPTION("CPUfreq policy governor 'schedutil'");
+MODULE_LICENSE("GPL");
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHEDUTIL
+fs_initcall(cpufreq_gov_schedutil_init);
+#else
+module_init(cpufreq_gov_schedutil_init);
+#endif
+module_exit(cpufreq_gov_schedutil_exit);
@@ -22,23 +22,99 @@
  * #1 wait-for-interrupt
  * #2 wait-for-interrupt and RAM self refresh
  *
+ * DDR can only be put in self refresh once all the CPUs are idle, the last
+ * one to enter state #2 does it from OCM while the other ones wait in WFI.
+ * The L2 cache enters standby on its own when all the CPUs are in WFI.
+ *
+ * The PLLs keep running in state #2, so the per-CPU global timer comparators
+ * keep working and no broadcast timer is needed. The last CPU instead makes
+ * sure it wakes up, and takes DDR out of self refresh, before the local timer
+ * of any other CPU expires.
+ *
+ * Other bus masters, e.g. DMA engines in the PL or the GEMs, are stalled
+ * while DDR is in self refresh, so state #2 has to be enabled with the
+ * cpuidle_zynq.self_refresh parameter on systems where that is acceptable.
+ *
  * Maintainer: Michal Simek <michal.simek@xilinx.com>
  */
 
+#include <linux/atomic.h>
+#include <linux/clockchips.h>
 #include <linux/init.h>
 #include <linux/cpuidle.h>
+#include <linux/cpumask.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/platform_data/cpuidle-zynq.h>
 #include <linux/platform_device.h>
+#include <linux/tick.h>
 #include <asm/proc-fns.h>
 #include <asm/cpuidle.h>
 
 #define ZYNQ_MAX_STATES		2
 
+static bool self_refresh;
+module_param(self_refresh, bool, 0444);
+MODULE_PARM_DESC(self_refresh, "Put DDR in self refresh when all CPUs idle");
+
+static int (*zynq_self_refresh)(void);
+static atomic_t zynq_idle_cpus = ATOMIC_INIT(0);
+
+/*
+ * Called by the last CPU with interrupts disabled, while all the other CPUs
+ * are in WFI and their timers cannot be reprogrammed. Makes the local timer
+ * of @cpu expire no later than the earliest one of the other CPUs, so that
+ * these do not stall on DDR while it is in self refresh. Returns false if
+ * that is too close for the state to pay off.
+ */
+static bool zynq_idle_cover_timers(int cpu, s64 residency_ns)
+{
+	struct clock_event_device *own = tick_get_device(cpu)->evtdev;
+	ktime_t next = { .tv64 = KTIME_MAX };
+	int i;
+
+	for_each_online_cpu(i) {
+		struct clock_event_device *evt = tick_get_device(i)->evtdev;
+
+		if (i != cpu && evt && evt->next_event.tv64 < next.tv64)
+			next = evt->next_event;
+	}
+
+	if (next.tv64 == KTIME_MAX)
+		return true;
+
+	if (ktime_to_ns(ktime_sub(next, ktime_get())) < residency_ns)
+		return false;
+
+	/* hrtimer_interrupt() reprograms the real next event afterwards */
+	if (own && next.tv64 < own->next_event.tv64)
+		return !clockevents_program_event(own, next, false);
+
+	return true;
+}
+
 /* Actual code that puts the SoC in different idle states */
 static int zynq_enter_idle(struct cpuidle_device *dev,
 			   struct cpuidle_driver *drv, int index)
 {
-	/* Add code for DDR self refresh start */
-	cpu_do_idle();
+	int idle_cpus = atomic_inc_return(&zynq_idle_cpus);
+	s64 residency_ns = drv->states[index].target_residency * NSEC_PER_USEC;
+
+	/*
+	 * Only CPU0 may put DDR in self refresh: the interrupts are routed
+	 * to it, and the local timers of the other CPUs are covered by its
+	 * own. Any other CPU waking up first would stall on its first DDR
+	 * access until CPU0 wakes up as well.
+	 */
+	if (idle_cpus != num_online_cpus() || dev->cpu != 0 ||
+	    !zynq_idle_cover_timers(dev->cpu, residency_ns) ||
+	    zynq_self_refresh()) {
+		/* Report the time spent to the state actually entered */
+		cpu_do_idle();
+		index = 0;
+	}
+
+	atomic_dec(&zynq_idle_cpus);
 
 	return index;
 }
@@ -51,7 +127,7 @@ static struct cpuidle_driver zynq_idle_driver = {
 		{
 			.enter			= zynq_enter_idle,
 			.exit_latency		= 10,
-			.target_residency	= 10000,
+			.target_residency	= 1000,
 			.flags			= CPUIDLE_FLAG_TIME_VALID,
 			.name			= "RAM_SR",
 			.desc			= "WFI and RAM Self Refresh",
@@ -64,8 +140,16 @@ static struct cpuidle_driver zynq_idle_driver = {
 /* Initialize CPU idle by registering the idle states */
 static int zynq_cpuidle_probe(struct platform_device *pdev)
 {
+	struct zynq_cpuidle_platform_data *pdata = dev_get_platdata(&pdev->dev);
+
 	pr_info("Xilinx Zynq CpuIdle Driver started\n");
 
+	/* Without DDR self refresh state #2 would only be WFI again */
+	if (self_refresh && pdata && pdata->self_refresh)
+		zynq_self_refresh = pdata->self_refresh;
+	else
+		zynq_idle_driver.state_count = 1;
+
 	return cpuidle_register(&zynq_idle_driver, NULL);
 }
 
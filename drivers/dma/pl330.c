@@ -261,6 +261,17 @@ static unsigned cmd_line;
 #define PL330_DBGMC_START(addr)		do {} while (0)
 #endif
 
+/*
+ * A DMAC with peripherals is registered as private, so memcpy clients that
+ * look for any capable channel, like async_tx, never see it. This many of
+ * the channels the peripherals do not need go to a second, public DMA
+ * engine device providing memcpy only.
+ */
+static unsigned int memcpy_channels;
+module_param(memcpy_channels, uint, 0444);
+MODULE_PARM_DESC(memcpy_channels,
+		 "Number of spare channels to offer for public memcpy use");
+
 /* The number of default descriptors */
 
 #define NR_DEFAULT_DESC	16
@@ -446,6 +457,8 @@ struct dma_pl330_chan {
 struct pl330_dmac {
 	/* DMA-Engine Device */
 	struct dma_device ddma;
+	/* Public DMA-Engine Device for the memcpy_channels */
+	struct dma_device ddma_memcpy;
 
 	/* Holds info about sg limitations */
 	struct device_dma_parameters dma_parms;
@@ -483,6 +496,8 @@ struct pl330_dmac {
 
 	/* Peripheral channels connected to this DMAC */
 	unsigned int num_peripherals;
+	/* The last num_memcpy of those belong to ddma_memcpy */
+	unsigned int num_memcpy;
 	struct dma_pl330_chan *peripherals; /* keep at end */
 };
 
@@ -2032,7 +2047,7 @@ static struct dma_chan *of_dma_pl330_xlate(struct of_phandle_args *dma_spec,
 		return NULL;
 
 	chan_id = dma_spec->args[0];
-	if (chan_id >= pl330->num_peripherals)
+	if (chan_id >= pl330->num_peripherals - pl330->num_memcpy)
 		return NULL;
 
 	return dma_get_slave_channel(&pl330->peripherals[chan_id].chan);
@@ -2594,13 +2609,52 @@ static int pl330_dma_device_slave_caps(struct dma_chan *dchan,
 	return 0;
 }
 
+static void pl330_idle_channels(struct dma_device *pd)
+{
+	struct dma_pl330_chan *pch, *_p;
+
+	list_for_each_entry_safe(pch, _p, &pd->channels, chan.device_node) {
+
+		/* Remove the channel */
+		list_del(&pch->chan.device_node);
+
+		/* Flush the channel */
+		if (pch->thread) {
+			pl330_control(&pch->chan, DMA_TERMINATE_ALL, 0);
+			pl330_free_chan_resources(&pch->chan);
+		}
+	}
+}
+
+/*
+ * Only copies aligned to the bus width are accepted, smaller bursts would
+ * make the DMAC slower than the CPU.
+ */
+static int pl330_register_memcpy(struct pl330_dmac *pl330)
+{
+	struct dma_device *pd = &pl330->ddma_memcpy;
+
+	dma_cap_set(DMA_MEMCPY, pd->cap_mask);
+	pd->dev = pl330->ddma.dev;
+	pd->copy_align = ilog2(pl330->pcfg.data_bus_width / 8);
+
+	pd->device_alloc_chan_resources = pl330_alloc_chan_resources;
+	pd->device_free_chan_resources = pl330_free_chan_resources;
+	pd->device_prep_dma_memcpy = pl330_prep_dma_memcpy;
+	pd->device_tx_status = pl330_tx_status;
+	pd->device_control = pl330_control;
+	pd->device_issue_pending = pl330_issue_pending;
+
+	return dma_async_device_register(pd);
+}
+
 static int
 pl330_probe(struct amba_device *adev, const struct amba_id *id)
 {
 	struct dma_pl330_platdata *pdat;
 	struct pl330_config *pcfg;
 	struct pl330_dmac *pl330;
-	struct dma_pl330_chan *pch, *_p;
+	struct dma_pl330_chan *pch;
 	struct dma_device *pd;
 	struct resource *res;
 	int i, ret, irq;
@@ -2665,6 +2719,10 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 		num_chan = max_t(int, pcfg->num_peri, pcfg->num_chan);
 
 	pl330->num_peripherals = num_chan;
+	if (!pdat && pcfg->num_peri)
+		pl330->num_memcpy = min_t(unsigned int, memcpy_channels,
+					  num_chan - pcfg->num_peri);
+	INIT_LIST_HEAD(&pl330->ddma_memcpy.channels);
 
 	pl330->peripherals = kzalloc(num_chan * sizeof(*pch), GFP_KERNEL);
 	if (!pl330->peripherals) {
@@ -2685,11 +2743,17 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 		INIT_LIST_HEAD(&pch->completed_list);
 		spin_lock_init(&pch->lock);
 		pch->thread = NULL;
-		pch->chan.device = pd;
 		pch->dmac = pl330;
 
 		/* Add the channel to the DMAC list */
-		list_add_tail(&pch->chan.device_node, &pd->channels);
+		if (i >= num_chan - pl330->num_memcpy) {
+			pch->chan.device = &pl330->ddma_memcpy;
+			list_add_tail(&pch->chan.device_node,
+				      &pl330->ddma_memcpy.channels);
+		} else {
+			pch->chan.device = pd;
+			list_add_tail(&pch->chan.device_node, &pd->channels);
+		}
 	}
 
 	pd->dev = &adev->dev;
@@ -2714,10 +2778,18 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 	pd->device_issue_pending = pl330_issue_pending;
 	pd->device_slave_caps = pl330_dma_device_slave_caps;
 
+	if (pl330->num_memcpy) {
+		ret = pl330_register_memcpy(pl330);
+		if (ret) {
+			dev_err(&adev->dev, "unable to register memcpy DMAC\n");
+			goto probe_err3;
+		}
+	}
+
 	ret = dma_async_device_register(pd);
 	if (ret) {
 		dev_err(&adev->dev, "unable to register DMAC\n");
-		goto probe_err3;
+		goto probe_err4;
 	}
 
 	if (adev->dev.of_node) {
@@ -2746,22 +2818,18 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 		"\tDBUFF-%ux%ubytes Num_Chans-%u Num_Peri-%u Num_Events-%u\n",
 		pcfg->data_buf_dep, pcfg->data_bus_width / 8, pcfg->num_chan,
 		pcfg->num_peri, pcfg->num_events);
+	if (pl330->num_memcpy)
+		dev_info(&adev->dev, "\t%u channels for public memcpy\n",
+			 pl330->num_memcpy);
 
 	return 0;
+probe_err4:
+	if (pl330->num_memcpy)
+		dma_async_device_unregister(&pl330->ddma_memcpy);
 probe_err3:
 	/* Idle the DMAC */
-	list_for_each_entry_safe(pch, _p, &pl330->ddma.channels,
-			chan.device_node) {
-
-		/* Remove the channel */
-		list_del(&pch->chan.device_node);
-
-		/* Flush the channel */
-		if (pch->thread) {
-			pl330_control(&pch->chan, DMA_TERMINATE_ALL, 0);
-			pl330_free_chan_resources(&pch->chan);
-		}
-	}
+	pl330_idle_channels(&pl330->ddma);
+	pl330_idle_channels(&pl330->ddma_memcpy);
 probe_err2:
 	pl330_del(pl330);
 
@@ -2771,26 +2839,17 @@ probe_err2:
 static int pl330_remove(struct amba_device *adev)
 {
 	struct pl330_dmac *pl330 = amba_get_drvdata(adev);
-	struct dma_pl330_chan *pch, *_p;
 
 	if (adev->dev.of_node)
 		of_dma_controller_free(adev->dev.of_node);
 
 	dma_async_device_unregister(&pl330->ddma);
+	if (pl330->num_memcpy)
+		dma_async_device_unregister(&pl330->ddma_memcpy);
 
 	/* Idle the DMAC */
-	list_for_each_entry_safe(pch, _p, &pl330->ddma.channels,
-			chan.device_node) {
-
-		/* Remove the channel */
-		list_del(&pch->chan.device_node);
-
-		/* Flush the channel */
-		if (pch->thread) {
-			pl330_control(&pch->chan, DMA_TERMINATE_ALL, 0);
-			pl330_free_chan_resources(&pch->chan);
-		}
-	}
+	pl330_idle_channels(&pl330->ddma);
+	pl330_idle_channels(&pl330->ddma_memcpy);
 
 	pl330_del(pl330);
 
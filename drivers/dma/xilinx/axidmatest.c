@@ -12,7 +12,9 @@
 #include <linux/delay.h>
 #include <linux/dmaengine.h>
 #include <linux/init.h>
+#include <linux/kernel_stat.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/random.h>
 #include <linux/slab.h>
@@ -28,6 +30,14 @@ module_param(iterations, uint, S_IRUGO);
 MODULE_PARM_DESC(iterations,
 		"Iterations before stopping test (default: infinite)");
 
+static unsigned int coalesce = 1;
+module_param(coalesce, uint, S_IRUGO);
+MODULE_PARM_DESC(coalesce, "Interrupt coalescing threshold (default: 1)");
+
+static unsigned int delay;
+module_param(delay, uint, S_IRUGO);
+MODULE_PARM_DESC(delay, "Interrupt delay timeout, 0 disables (default: 0)");
+
 /*
  * Initialization patterns. All bytes in the source buffer has bit 7
  * set, all bytes in the destination buffer has bit 7 cleared.
@@ -188,6 +198,23 @@ static unsigned int dmatest_verify(u8 **bufs, unsigned int start,
 	return error_count;
 }
 
+/* Busy and total time of all online CPUs, in cputime units */
+static void dmatest_cpu_time(u64 *busy, u64 *total)
+{
+	int cpu, i;
+	u64 idle = 0;
+
+	*total = 0;
+	for_each_online_cpu(cpu) {
+		u64 *stat = kcpustat_cpu(cpu).cpustat;
+
+		for (i = 0; i < NR_STATS; i++)
+			*total += stat[i];
+		idle += stat[CPUTIME_IDLE] + stat[CPUTIME_IOWAIT];
+	}
+	*busy = *total - idle;
+}
+
 static void dmatest_slave_tx_callback(void *completion)
 {
 	complete(completion);
@@ -221,6 +248,10 @@ static int dmatest_slave_func(void *data)
 	int bd_cnt = 11;
 	int i;
 	struct xilinx_dma_config config;
+	u64 nr_descs = 0, run_ns = 0;
+	u64 cpu_busy = 0, cpu_total = 0;
+	u64 busy_start, total_start, busy_end, total_end;
+	ktime_t start;
 	thread_name = current->comm;
 
 	ret = -ENOMEM;
@@ -335,14 +366,13 @@ static int dmatest_slave_func(void *data)
 
 		}
 
-		/* Only one interrupt */
-		config.coalesc = 1;
-		config.delay = 0;
+		config.coalesc = coalesce;
+		config.delay = delay;
 		rx_dev->device_control(rx_chan, DMA_SLAVE_CONFIG,
 				(unsigned long)&config);
 
-		config.coalesc = 1;
-		config.delay = 0;
+		config.coalesc = coalesce;
+		config.delay = delay;
 		tx_dev->device_control(tx_chan, DMA_SLAVE_CONFIG,
 				(unsigned long)&config);
 
@@ -392,6 +422,10 @@ static int dmatest_slave_func(void *data)
 			failed_tests++;
 			continue;
 		}
+		/* Only the transfer itself counts for the throughput */
+		dmatest_cpu_time(&busy_start, &total_start);
+		start = ktime_get();
+
 		dma_async_issue_pending(tx_chan);
 		dma_async_issue_pending(rx_chan);
 
@@ -436,6 +470,12 @@ static int dmatest_slave_func(void *data)
 			continue;
 		}
 
+		run_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+		dmatest_cpu_time(&busy_end, &total_end);
+		cpu_busy += busy_end - busy_start;
+		cpu_total += total_end - total_start;
+		nr_descs += src_cnt + dst_cnt;
+
 		/* Unmap by myself */
 		for (i = 0; i < dst_cnt; i++)
 			dma_unmap_single(rx_dev->dev, dma_dsts[i],
@@ -478,6 +518,12 @@ static int dmatest_slave_func(void *data)
 		}
 	}
 
+	if (run_ns)
+		pr_notice("%s: %llu descriptors, %llu descs/sec, %llu%% CPU\n",
+			  thread_name, nr_descs,
+			  div64_u64(nr_descs * NSEC_PER_SEC, run_ns),
+			  cpu_total ? div64_u64(cpu_busy * 100, cpu_total) : 0);
+
 	ret = 0;
 	for (i = 0; thread->dsts[i]; i++)
 		kfree(thread->dsts[i]);
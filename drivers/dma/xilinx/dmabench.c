@@ -0,0 +1,881 @@
+/*
+ * Xilinx DMA engines benchmark client
+ *
+ * Measures the throughput, the per transfer latency and the interrupt load
+ * of the Xilinx DMA engines over a sweep of transfer sizes, segments per
+ * transfer and concurrently used channels:
+ *
+ *  - memcpy: memory to memory engines, Axi CDMA and ZynqMP zdma
+ *  - axidma: Axi DMA MM2S/S2MM channel pairs, with a stream loopback
+ *  - vdma:   Axi VDMA MM2S/S2MM channel pairs, with a video loopback
+ *
+ * With ZynqMP zdma channels, memcpy striped over all of them is then compared
+ * with CPU memcpy over a sweep of copy sizes.
+ *
+ * The data is not verified, the *test.c clients take care of that.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/amba/xilinx_dma.h>
+#include <linux/dmaengine.h>
+#include <linux/init.h>
+#include <linux/irq.h>
+#include <linux/kernel_stat.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+static char engine[16] = "all";
+module_param_string(engine, engine, sizeof(engine), S_IRUGO);
+MODULE_PARM_DESC(engine,
+		"Engines to benchmark: memcpy, axidma, vdma or all (default: all)");
+
+static unsigned int min_size = 64;
+module_param(min_size, uint, S_IRUGO);
+MODULE_PARM_DESC(min_size, "Smallest segment size in bytes (default: 64)");
+
+static unsigned int max_size = 65536;
+module_param(max_size, uint, S_IRUGO);
+MODULE_PARM_DESC(max_size, "Largest segment size in bytes (default: 65536)");
+
+static unsigned int max_sg_len = 16;
+module_param(max_sg_len, uint, S_IRUGO);
+MODULE_PARM_DESC(max_sg_len,
+		"Largest number of segments per transfer (default: 16)");
+
+static unsigned int max_channels = 1;
+module_param(max_channels, uint, S_IRUGO);
+MODULE_PARM_DESC(max_channels,
+		"Largest number of channels used at once (default: 1)");
+
+static unsigned int iterations = 100;
+module_param(iterations, uint, S_IRUGO);
+MODULE_PARM_DESC(iterations,
+		"Transfers per channel and test point (default: 100)");
+
+static unsigned int stripe_min_size = 4096;
+module_param(stripe_min_size, uint, S_IRUGO);
+MODULE_PARM_DESC(stripe_min_size,
+		"Smallest striped zdma memcpy in bytes (default: 4096)");
+
+static unsigned int stripe_max_size = 16 * 1024 * 1024;
+module_param(stripe_max_size, uint, S_IRUGO);
+MODULE_PARM_DESC(stripe_max_size,
+		"Largest striped zdma memcpy in bytes (default: 16 MiB)");
+
+static int bench_irqs[8];
+static int nr_bench_irqs;
+module_param_array_named(irqs, bench_irqs, int, &nr_bench_irqs, S_IRUGO);
+MODULE_PARM_DESC(irqs,
+		"Interrupts of the engines for the interrupt load (default: all)");
+
+/*
+ * Sizes, segment counts and channel counts are swept in powers of two,
+ * starting at min_size, one segment and one channel.
+ */
+#define DMABENCH_MAX_SIZE	(4 * 1024 * 1024)
+#define DMABENCH_STRIPE_MAX_SIZE	(64 * 1024 * 1024)
+#define DMABENCH_MAX_SG		64
+#define DMABENCH_MAX_CHANS	16
+#define DMABENCH_HIST		16	/* log2 latency buckets, in us */
+#define DMABENCH_TIMEOUT	msecs_to_jiffies(3000)
+#define DMABENCH_VDMA_HSIZE	1024	/* Line length of VDMA frames */
+
+enum dmabench_type {
+	DMABENCH_MEMCPY,
+	DMABENCH_AXIDMA,
+	DMABENCH_VDMA,
+	DMABENCH_TYPES,
+};
+
+static const char * const dmabench_names[DMABENCH_TYPES] = {
+	[DMABENCH_MEMCPY] = "memcpy",
+	[DMABENCH_AXIDMA] = "axidma",
+	[DMABENCH_VDMA] = "vdma",
+};
+
+struct dmabench_chan {
+	struct dma_chan *tx;		/* memcpy or MM2S channel */
+	struct dma_chan *rx;		/* S2MM channel, NULL for memcpy */
+};
+
+struct dmabench_thread {
+	struct dmabench_chan *bc;
+	enum dmabench_type type;
+	struct task_struct *task;
+	struct completion exited;
+	struct completion tx_cmp;
+	struct completion rx_cmp;
+	unsigned int size;
+	unsigned int sg_len;
+	unsigned int nr_bufs;
+	u8 *srcs[DMABENCH_MAX_SG];
+	u8 *dsts[DMABENCH_MAX_SG];
+	dma_addr_t dma_srcs[DMABENCH_MAX_SG];
+	dma_addr_t dma_dsts[DMABENCH_MAX_SG];
+	struct scatterlist tx_sg[DMABENCH_MAX_SG];
+	struct scatterlist rx_sg[DMABENCH_MAX_SG];
+	/* Results */
+	u64 bytes;
+	u64 lat_min;
+	u64 lat_max;
+	u64 lat_sum;
+	unsigned int xfers;
+	unsigned int failures;
+	unsigned int hist[DMABENCH_HIST];
+};
+
+static struct dmabench_chan dmabench_chans[DMABENCH_TYPES][DMABENCH_MAX_CHANS];
+static unsigned int dmabench_nr_chans[DMABENCH_TYPES];
+static struct task_struct *dmabench_task;
+static struct completion dmabench_stripe_cmp;
+static bool dmabench_abort;
+
+static unsigned long dmabench_irq_count(void)
+{
+	unsigned long sum = 0;
+	int cpu, i;
+
+	if (!nr_bench_irqs) {
+		for_each_online_cpu(cpu)
+			sum += kstat_cpu_irqs_sum(cpu);
+		return sum;
+	}
+
+	for (i = 0; i < nr_bench_irqs; i++) {
+		struct irq_desc *desc = irq_to_desc(bench_irqs[i]);
+
+		if (!desc || !desc->kstat_irqs)
+			continue;
+
+		for_each_possible_cpu(cpu)
+			sum += *per_cpu_ptr(desc->kstat_irqs, cpu);
+	}
+
+	return sum;
+}
+
+static struct device *dmabench_rx_dev(struct dmabench_thread *t)
+{
+	struct dma_chan *chan = t->bc->rx ? t->bc->rx : t->bc->tx;
+
+	return chan->device->dev;
+}
+
+static void dmabench_free_buffers(struct dmabench_thread *t)
+{
+	struct device *tx_dev = t->bc->tx->device->dev;
+	struct device *rx_dev = dmabench_rx_dev(t);
+	unsigned int i;
+
+	for (i = 0; i < t->nr_bufs; i++) {
+		dma_unmap_single(tx_dev, t->dma_srcs[i], t->size,
+				 DMA_TO_DEVICE);
+		dma_unmap_single(rx_dev, t->dma_dsts[i], t->size,
+				 DMA_FROM_DEVICE);
+		kfree(t->srcs[i]);
+		kfree(t->dsts[i]);
+	}
+	t->nr_bufs = 0;
+}
+
+/* Buffers are mapped once per test point, outside of the measurement */
+static int dmabench_alloc_buffers(struct dmabench_thread *t)
+{
+	struct device *tx_dev = t->bc->tx->device->dev;
+	struct device *rx_dev = dmabench_rx_dev(t);
+	u8 *src, *dst;
+	unsigned int i;
+
+	for (i = 0; i < t->sg_len; i++) {
+		src = kmalloc(t->size, GFP_KERNEL);
+		dst = kmalloc(t->size, GFP_KERNEL);
+		if (!src || !dst)
+			goto err_free;
+
+		t->dma_srcs[i] = dma_map_single(tx_dev, src, t->size,
+						DMA_TO_DEVICE);
+		if (dma_mapping_error(tx_dev, t->dma_srcs[i]))
+			goto err_free;
+
+		t->dma_dsts[i] = dma_map_single(rx_dev, dst, t->size,
+						DMA_FROM_DEVICE);
+		if (dma_mapping_error(rx_dev, t->dma_dsts[i])) {
+			dma_unmap_single(tx_dev, t->dma_srcs[i], t->size,
+					 DMA_TO_DEVICE);
+			goto err_free;
+		}
+
+		t->srcs[i] = src;
+		t->dsts[i] = dst;
+		t->nr_bufs++;
+	}
+
+	return 0;
+
+err_free:
+	kfree(src);
+	kfree(dst);
+	dmabench_free_buffers(t);
+	return -ENOMEM;
+}
+
+static void dmabench_callback(void *completion)
+{
+	complete(completion);
+}
+
+static int dmabench_submit(struct dma_async_tx_descriptor *txd,
+			   struct completion *cmp, dma_cookie_t *cookie)
+{
+	if (!txd)
+		return -ENOMEM;
+
+	if (cmp) {
+		txd->callback = dmabench_callback;
+		txd->callback_param = cmp;
+	}
+
+	*cookie = dmaengine_submit(txd);
+
+	return dma_submit_error(*cookie) ? -EIO : 0;
+}
+
+/* One memcpy per segment, only the last one interrupts */
+static int dmabench_prep_memcpy(struct dmabench_thread *t,
+				dma_cookie_t *tx_cookie)
+{
+	struct dma_chan *chan = t->bc->tx;
+	struct dma_async_tx_descriptor *txd;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < t->sg_len; i++) {
+		bool last = i == t->sg_len - 1;
+
+		txd = chan->device->device_prep_dma_memcpy(chan,
+				t->dma_dsts[i], t->dma_srcs[i], t->size,
+				DMA_CTRL_ACK | (last ? DMA_PREP_INTERRUPT : 0));
+		err = dmabench_submit(txd, last ? &t->tx_cmp : NULL,
+				      tx_cookie);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/* One scatter gather transfer per direction */
+static int dmabench_prep_axidma(struct dmabench_thread *t,
+				dma_cookie_t *tx_cookie,
+				dma_cookie_t *rx_cookie)
+{
+	struct dma_async_tx_descriptor *txd, *rxd;
+	unsigned long flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
+	unsigned int i;
+	int err;
+
+	sg_init_table(t->tx_sg, t->sg_len);
+	sg_init_table(t->rx_sg, t->sg_len);
+
+	for (i = 0; i < t->sg_len; i++) {
+		sg_dma_address(&t->tx_sg[i]) = t->dma_srcs[i];
+		sg_dma_len(&t->tx_sg[i]) = t->size;
+		sg_dma_address(&t->rx_sg[i]) = t->dma_dsts[i];
+		sg_dma_len(&t->rx_sg[i]) = t->size;
+	}
+
+	rxd = dmaengine_prep_slave_sg(t->bc->rx, t->rx_sg, t->sg_len,
+				      DMA_DEV_TO_MEM, flags);
+	err = dmabench_submit(rxd, &t->rx_cmp, rx_cookie);
+	if (err)
+		return err;
+
+	txd = dmaengine_prep_slave_sg(t->bc->tx, t->tx_sg, t->sg_len,
+				      DMA_MEM_TO_DEV, flags);
+
+	return dmabench_submit(txd, &t->tx_cmp, tx_cookie);
+}
+
+/* One frame per segment and direction, made of DMABENCH_VDMA_HSIZE lines */
+static int dmabench_prep_vdma(struct dmabench_thread *t,
+			      dma_cookie_t *tx_cookie,
+			      dma_cookie_t *rx_cookie)
+{
+	struct dma_interleaved_template *xt;
+	struct dma_async_tx_descriptor *txd;
+	unsigned long flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
+	unsigned int i;
+	int err = 0;
+
+	xt = kzalloc(sizeof(*xt) + sizeof(xt->sgl[0]), GFP_KERNEL);
+	if (!xt)
+		return -ENOMEM;
+
+	xt->frame_size = 1;
+	xt->sgl[0].size = min_t(unsigned int, t->size, DMABENCH_VDMA_HSIZE);
+	xt->numf = t->size / xt->sgl[0].size;
+
+	for (i = 0; i < t->sg_len && !err; i++) {
+		xt->dir = DMA_DEV_TO_MEM;
+		xt->dst_start = t->dma_dsts[i];
+		txd = dmaengine_prep_interleaved_dma(t->bc->rx, xt, flags);
+		err = dmabench_submit(txd, i == t->sg_len - 1 ?
+				      &t->rx_cmp : NULL, rx_cookie);
+	}
+
+	for (i = 0; i < t->sg_len && !err; i++) {
+		xt->dir = DMA_MEM_TO_DEV;
+		xt->src_start = t->dma_srcs[i];
+		txd = dmaengine_prep_interleaved_dma(t->bc->tx, xt, flags);
+		err = dmabench_submit(txd, i == t->sg_len - 1 ?
+				      &t->tx_cmp : NULL, tx_cookie);
+	}
+
+	kfree(xt);
+	return err;
+}
+
+/* Bytes moved by one segment, VDMA frames are made of whole lines */
+static unsigned int dmabench_seg_bytes(struct dmabench_thread *t)
+{
+	unsigned int hsize;
+
+	if (t->type != DMABENCH_VDMA)
+		return t->size;
+
+	hsize = min_t(unsigned int, t->size, DMABENCH_VDMA_HSIZE);
+	return t->size / hsize * hsize;
+}
+
+/* Run one transfer and return its latency in ns */
+static int dmabench_xfer(struct dmabench_thread *t, u64 *lat)
+{
+	dma_cookie_t tx_cookie, rx_cookie;
+	struct dma_chan *tx = t->bc->tx;
+	struct dma_chan *rx = t->bc->rx;
+	ktime_t start;
+	int err;
+
+	reinit_completion(&t->tx_cmp);
+	reinit_completion(&t->rx_cmp);
+
+	switch (t->type) {
+	case DMABENCH_MEMCPY:
+		err = dmabench_prep_memcpy(t, &tx_cookie);
+		break;
+	case DMABENCH_AXIDMA:
+		err = dmabench_prep_axidma(t, &tx_cookie, &rx_cookie);
+		break;
+	default:
+		err = dmabench_prep_vdma(t, &tx_cookie, &rx_cookie);
+		break;
+	}
+	if (err)
+		return err;
+
+	start = ktime_get();
+
+	/* Get the receive side going first, it must not miss the stream */
+	if (rx)
+		dma_async_issue_pending(rx);
+	dma_async_issue_pending(tx);
+
+	if (!wait_for_completion_timeout(&t->tx_cmp, DMABENCH_TIMEOUT))
+		return -ETIMEDOUT;
+
+	if (rx && !wait_for_completion_timeout(&t->rx_cmp, DMABENCH_TIMEOUT))
+		return -ETIMEDOUT;
+
+	*lat = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (dma_async_is_tx_complete(tx, tx_cookie, NULL, NULL) !=
+	    DMA_COMPLETE)
+		return -EIO;
+
+	if (rx && dma_async_is_tx_complete(rx, rx_cookie, NULL, NULL) !=
+	    DMA_COMPLETE)
+		return -EIO;
+
+	return 0;
+}
+
+static int dmabench_thread_func(void *data)
+{
+	struct dmabench_thread *t = data;
+	unsigned int i, bucket;
+	u64 lat;
+	int err;
+
+	t->lat_min = U64_MAX;
+
+	for (i = 0; i < iterations && !ACCESS_ONCE(dmabench_abort); i++) {
+		err = dmabench_xfer(t, &lat);
+		if (err) {
+			pr_warn("%s: transfer failed with %d\n",
+				current->comm, err);
+			dmaengine_terminate_all(t->bc->tx);
+			if (t->bc->rx)
+				dmaengine_terminate_all(t->bc->rx);
+			t->failures++;
+			break;
+		}
+
+		t->bytes += (u64)dmabench_seg_bytes(t) * t->sg_len;
+		t->xfers++;
+		t->lat_sum += lat;
+		t->lat_min = min(t->lat_min, lat);
+		t->lat_max = max(t->lat_max, lat);
+
+		bucket = fls64(div_u64(lat, NSEC_PER_USEC));
+		t->hist[min_t(unsigned int, bucket, DMABENCH_HIST - 1)]++;
+	}
+
+	complete(&t->exited);
+
+	return 0;
+}
+
+static u64 dmabench_kbps(u64 bytes, u64 ns)
+{
+	return ns ? div64_u64(bytes * (NSEC_PER_SEC >> 10), ns) : 0;
+}
+
+static void dmabench_report(enum dmabench_type type, unsigned int nr_chans,
+			    unsigned int sg_len, unsigned int size,
+			    struct dmabench_thread *sum, u64 ns,
+			    unsigned long irqs)
+{
+	char hist[DMABENCH_HIST * 16];
+	unsigned int i, len = 0;
+	u64 kbps = dmabench_kbps(sum->bytes, ns), irqs_mb = 0;
+
+	if (sum->bytes)
+		irqs_mb = div64_u64((u64)irqs << 20, sum->bytes);
+	if (!sum->xfers)
+		sum->lat_min = 0;
+
+	pr_info("dmabench: %s chans %u sg %u size %u: %llu.%02llu MB/s, latency min/avg/max %llu/%llu/%llu us, %llu irqs/MB, %u failures\n",
+		dmabench_names[type], nr_chans, sg_len, size,
+		kbps >> 10, ((kbps & 1023) * 100) >> 10,
+		div_u64(sum->lat_min, NSEC_PER_USEC),
+		sum->xfers ? div_u64(div_u64(sum->lat_sum, sum->xfers),
+				     NSEC_PER_USEC) : 0,
+		div_u64(sum->lat_max, NSEC_PER_USEC),
+		irqs_mb, sum->failures);
+
+	for (i = 0; i < DMABENCH_HIST; i++) {
+		if (!sum->hist[i])
+			continue;
+
+		if (i == DMABENCH_HIST - 1)
+			len += scnprintf(hist + len, sizeof(hist) - len,
+					 " >=%u:%u", 1 << (i - 1),
+					 sum->hist[i]);
+		else
+			len += scnprintf(hist + len, sizeof(hist) - len,
+					 " <%u:%u", 1 << i, sum->hist[i]);
+	}
+
+	pr_info("dmabench: latency histogram (us)%s\n", hist);
+}
+
+/* Run iterations transfers on each of nr_chans channels at the same time */
+static void dmabench_run_point(enum dmabench_type type, unsigned int nr_chans,
+			       unsigned int sg_len, unsigned int size)
+{
+	struct dmabench_thread *threads[DMABENCH_MAX_CHANS] = { NULL };
+	struct dmabench_thread *sum, *t;
+	unsigned long irqs;
+	unsigned int i, j;
+	ktime_t start;
+	u64 ns;
+
+	sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return;
+
+	for (i = 0; i < nr_chans; i++) {
+		t = kzalloc(sizeof(*t), GFP_KERNEL);
+		if (!t)
+			goto out_free;
+
+		t->bc = &dmabench_chans[type][i];
+		t->type = type;
+		t->size = size;
+		t->sg_len = sg_len;
+		init_completion(&t->exited);
+		init_completion(&t->tx_cmp);
+		init_completion(&t->rx_cmp);
+		threads[i] = t;
+
+		if (dmabench_alloc_buffers(t)) {
+			pr_err("dmabench: no memory for %u x %u bytes\n",
+			       sg_len, size);
+			goto out_free;
+		}
+	}
+
+	irqs = dmabench_irq_count();
+	start = ktime_get();
+
+	for (i = 0; i < nr_chans; i++) {
+		t = threads[i];
+		t->task = kthread_run(dmabench_thread_func, t, "dmabench-%s",
+				      dma_chan_name(t->bc->tx));
+		if (IS_ERR(t->task)) {
+			t->failures++;
+			complete(&t->exited);
+		}
+	}
+
+	for (i = 0; i < nr_chans; i++)
+		wait_for_completion(&threads[i]->exited);
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	irqs = dmabench_irq_count() - irqs;
+
+	sum->lat_min = U64_MAX;
+	for (i = 0; i < nr_chans; i++) {
+		t = threads[i];
+		sum->bytes += t->bytes;
+		sum->xfers += t->xfers;
+		sum->failures += t->failures;
+		sum->lat_sum += t->lat_sum;
+		sum->lat_min = min(sum->lat_min, t->lat_min);
+		sum->lat_max = max(sum->lat_max, t->lat_max);
+		for (j = 0; j < DMABENCH_HIST; j++)
+			sum->hist[j] += t->hist[j];
+	}
+
+	dmabench_report(type, nr_chans, sg_len, size, sum, ns, irqs);
+
+out_free:
+	for (i = 0; i < nr_chans && threads[i]; i++) {
+		dmabench_free_buffers(threads[i]);
+		kfree(threads[i]);
+	}
+	kfree(sum);
+}
+
+/*
+ * Striped zdma memcpy against CPU memcpy, for one copy size. The DMA side
+ * copies between coherent buffers, the CPU side between cached ones.
+ */
+static void dmabench_run_stripe_point(struct dma_chan *chan, unsigned int size)
+{
+	struct device *dev = chan->device->dev;
+	void *src, *dst, *cpu_src, *cpu_dst;
+	dma_addr_t dma_src, dma_dst;
+	u64 dma_bytes = 0, dma_kbps, cpu_kbps;
+	unsigned int i, failures = 0;
+	ssize_t queued;
+	ktime_t start;
+
+	src = dma_alloc_coherent(dev, size, &dma_src, GFP_KERNEL);
+	dst = dma_alloc_coherent(dev, size, &dma_dst, GFP_KERNEL);
+	cpu_src = vmalloc(size);
+	cpu_dst = vmalloc(size);
+	if (!src || !dst || !cpu_src || !cpu_dst) {
+		pr_err("dmabench: no memory for 2 x %u bytes\n", size);
+		goto out_free;
+	}
+
+	start = ktime_get();
+	for (i = 0; i < iterations && !ACCESS_ONCE(dmabench_abort); i++) {
+		reinit_completion(&dmabench_stripe_cmp);
+		queued = zdma_memcpy_striped(chan, dma_dst, dma_src, size,
+					     dmabench_callback,
+					     &dmabench_stripe_cmp);
+		if (queued < 0 ||
+		    !wait_for_completion_timeout(&dmabench_stripe_cmp,
+						 DMABENCH_TIMEOUT)) {
+			pr_warn("dmabench: striped memcpy failed with %zd\n",
+				queued < 0 ? queued : -ETIMEDOUT);
+			failures++;
+			break;
+		}
+		dma_bytes += queued;
+	}
+	dma_kbps = dmabench_kbps(dma_bytes,
+				 ktime_to_ns(ktime_sub(ktime_get(), start)));
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++)
+		memcpy(cpu_dst, cpu_src, size);
+	cpu_kbps = dmabench_kbps((u64)size * iterations,
+				 ktime_to_ns(ktime_sub(ktime_get(), start)));
+
+	pr_info("dmabench: stripe size %u: zdma %llu.%02llu MB/s, cpu memcpy %llu.%02llu MB/s, %u failures\n",
+		size, dma_kbps >> 10, ((dma_kbps & 1023) * 100) >> 10,
+		cpu_kbps >> 10, ((cpu_kbps & 1023) * 100) >> 10, failures);
+
+out_free:
+	vfree(cpu_dst);
+	vfree(cpu_src);
+	if (dst)
+		dma_free_coherent(dev, size, dst, dma_dst);
+	if (src)
+		dma_free_coherent(dev, size, src, dma_src);
+}
+
+static bool dmabench_is_driver(struct dma_chan *chan, const char *name);
+static void dmabench_release_type(enum dmabench_type type);
+
+/*
+ * The stripes only go to public channels. The memcpy channels are handed
+ * back and all of them are then taken through dmaengine, as async_tx does.
+ */
+static void dmabench_run_stripe(void)
+{
+	struct dma_chan *chan = NULL;
+	unsigned int size, i;
+
+	for (i = 0; i < dmabench_nr_chans[DMABENCH_MEMCPY] && !chan; i++)
+		if (dmabench_is_driver(dmabench_chans[DMABENCH_MEMCPY][i].tx,
+				       "xilinx-zdma"))
+			chan = dmabench_chans[DMABENCH_MEMCPY][i].tx;
+
+	if (!chan)
+		return;
+
+	dmabench_release_type(DMABENCH_MEMCPY);
+	dmaengine_get();
+
+	for (size = stripe_min_size; size <= stripe_max_size; size <<= 1) {
+		if (kthread_should_stop())
+			break;
+
+		dmabench_run_stripe_point(chan, size);
+	}
+
+	dmaengine_put();
+}
+
+static int dmabench_main(void *data)
+{
+	unsigned int type, nr_chans, sg_len, size;
+
+	for (type = 0; type < DMABENCH_TYPES; type++) {
+		unsigned int chans = min(max_channels,
+					 dmabench_nr_chans[type]);
+
+		for (nr_chans = 1; nr_chans <= chans; nr_chans <<= 1)
+			for (sg_len = 1; sg_len <= max_sg_len; sg_len <<= 1)
+				for (size = min_size; size <= max_size;
+				     size <<= 1) {
+					if (kthread_should_stop())
+						return 0;
+
+					dmabench_run_point(type, nr_chans,
+							   sg_len, size);
+				}
+	}
+
+	dmabench_run_stripe();
+
+	pr_info("dmabench: done\n");
+
+	/* Wait for the module to be removed */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+static bool dmabench_is_driver(struct dma_chan *chan, const char *name)
+{
+	return !strcmp(dev_driver_string(chan->device->dev), name);
+}
+
+static bool dmabench_memcpy_filter(struct dma_chan *chan, void *param)
+{
+	return !strncmp(dev_driver_string(chan->device->dev), "xilinx-", 7);
+}
+
+static bool dmabench_axidma_filter(struct dma_chan *chan, void *param)
+{
+	return dmabench_is_driver(chan, "xilinx-dma") && chan->private &&
+	       *(u32 *)chan->private == *(u32 *)param;
+}
+
+struct dmabench_vdma_match {
+	enum dma_transfer_direction dir;
+	struct dma_device *device;
+};
+
+static bool dmabench_vdma_filter(struct dma_chan *chan, void *param)
+{
+	struct dmabench_vdma_match *match = param;
+	struct dma_slave_caps caps;
+
+	if (!dmabench_is_driver(chan, "xilinx-vdma"))
+		return false;
+
+	if (match->device && chan->device != match->device)
+		return false;
+
+	return !dma_get_slave_caps(chan, &caps) &&
+	       (caps.directions & BIT(match->dir));
+}
+
+static bool dmabench_wanted(enum dmabench_type type)
+{
+	return !strcmp(engine, "all") || !strcmp(engine, dmabench_names[type]);
+}
+
+static void dmabench_request_channels(void)
+{
+	struct dmabench_vdma_match vmatch;
+	struct dmabench_chan *bc;
+	dma_cap_mask_t mask;
+	unsigned int *nr;
+	u32 match, device_id;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_MEMCPY, mask);
+	nr = &dmabench_nr_chans[DMABENCH_MEMCPY];
+	while (dmabench_wanted(DMABENCH_MEMCPY) && *nr < DMABENCH_MAX_CHANS) {
+		bc = &dmabench_chans[DMABENCH_MEMCPY][*nr];
+		bc->tx = dma_request_channel(mask, dmabench_memcpy_filter,
+					     NULL);
+		if (!bc->tx)
+			break;
+		(*nr)++;
+	}
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_SLAVE, mask);
+	dma_cap_set(DMA_PRIVATE, mask);
+
+	nr = &dmabench_nr_chans[DMABENCH_AXIDMA];
+	for (device_id = 0; dmabench_wanted(DMABENCH_AXIDMA) &&
+	     *nr < DMABENCH_MAX_CHANS; device_id++) {
+		bc = &dmabench_chans[DMABENCH_AXIDMA][*nr];
+
+		match = (DMA_MEM_TO_DEV & 0xFF) | XILINX_DMA_IP_DMA |
+			(device_id << XILINX_DMA_DEVICE_ID_SHIFT);
+		bc->tx = dma_request_channel(mask, dmabench_axidma_filter,
+					     &match);
+
+		match = (DMA_DEV_TO_MEM & 0xFF) | XILINX_DMA_IP_DMA |
+			(device_id << XILINX_DMA_DEVICE_ID_SHIFT);
+		bc->rx = dma_request_channel(mask, dmabench_axidma_filter,
+					     &match);
+
+		if (!bc->tx || !bc->rx) {
+			if (bc->tx)
+				dma_release_channel(bc->tx);
+			if (bc->rx)
+				dma_release_channel(bc->rx);
+			break;
+		}
+		(*nr)++;
+	}
+
+	nr = &dmabench_nr_chans[DMABENCH_VDMA];
+	while (dmabench_wanted(DMABENCH_VDMA) && *nr < DMABENCH_MAX_CHANS) {
+		bc = &dmabench_chans[DMABENCH_VDMA][*nr];
+
+		vmatch.dir = DMA_MEM_TO_DEV;
+		vmatch.device = NULL;
+		bc->tx = dma_request_channel(mask, dmabench_vdma_filter,
+					     &vmatch);
+		if (!bc->tx)
+			break;
+
+		/* The loopback is within one VDMA instance */
+		vmatch.dir = DMA_DEV_TO_MEM;
+		vmatch.device = bc->tx->device;
+		bc->rx = dma_request_channel(mask, dmabench_vdma_filter,
+					     &vmatch);
+		if (!bc->rx) {
+			dma_release_channel(bc->tx);
+			break;
+		}
+		(*nr)++;
+	}
+}
+
+static void dmabench_release_type(enum dmabench_type type)
+{
+	struct dmabench_chan *bc;
+	unsigned int i;
+
+	for (i = 0; i < dmabench_nr_chans[type]; i++) {
+		bc = &dmabench_chans[type][i];
+		dma_release_channel(bc->tx);
+		if (bc->rx)
+			dma_release_channel(bc->rx);
+	}
+	dmabench_nr_chans[type] = 0;
+}
+
+static void dmabench_release_channels(void)
+{
+	unsigned int type;
+
+	for (type = 0; type < DMABENCH_TYPES; type++)
+		dmabench_release_type(type);
+}
+
+static int __init dmabench_init(void)
+{
+	unsigned int type, total = 0;
+
+	min_size = clamp_t(unsigned int, min_size, 1, DMABENCH_MAX_SIZE);
+	max_size = clamp_t(unsigned int, max_size, min_size,
+			   DMABENCH_MAX_SIZE);
+	max_sg_len = clamp_t(unsigned int, max_sg_len, 1, DMABENCH_MAX_SG);
+	max_channels = clamp_t(unsigned int, max_channels, 1,
+			       DMABENCH_MAX_CHANS);
+	stripe_min_size = clamp_t(unsigned int, stripe_min_size, 1,
+				  DMABENCH_STRIPE_MAX_SIZE);
+	stripe_max_size = clamp_t(unsigned int, stripe_max_size,
+				  stripe_min_size, DMABENCH_STRIPE_MAX_SIZE);
+	init_completion(&dmabench_stripe_cmp);
+
+	dmabench_request_channels();
+
+	for (type = 0; type < DMABENCH_TYPES; type++) {
+		if (dmabench_nr_chans[type])
+			pr_info("dmabench: %s: %u channels\n",
+				dmabench_names[type], dmabench_nr_chans[type]);
+		total += dmabench_nr_chans[type];
+	}
+
+	if (!total) {
+		pr_err("dmabench: no channels found\n");
+		return -ENODEV;
+	}
+
+	dmabench_task = kthread_run(dmabench_main, NULL, "dmabench");
+	if (IS_ERR(dmabench_task)) {
+		dmabench_release_channels();
+		return PTR_ERR(dmabench_task);
+	}
+
+	return 0;
+}
+/* when compiled-in wait for drivers to load first */
+late_initcall(dmabench_init);
+
+static void __exit dmabench_exit(void)
+{
+	dmabench_abort = true;
+	kthread_stop(dmabench_task);
+	dmabench_release_channels();
+}
+module_exit(dmabench_exit);
+
+MODULE_DESCRIPTION("Xilinx DMA Engines Benchmark Client");
+MODULE_LICENSE("GPL v2");
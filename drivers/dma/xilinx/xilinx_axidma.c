@@ -10,6 +10,8 @@
  *    configured to have one channel or two channels. If configured as two
  *    channels, one is to transmit to a device and another is to receive from
  *    a device.
+ *  . In scatter gather mode a cyclic transfer loops over its BD ring in
+ *    hardware (cyclic BD mode) until the channel is terminated.
  *
  * This is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
@@ -47,6 +49,7 @@
 /* General register bits definitions */
 #define XILINX_DMA_CR_RESET_MASK	0x00000004 /* Reset DMA engine */
 #define XILINX_DMA_CR_RUNSTOP_MASK	0x00000001 /* Start/stop DMA engine */
+#define XILINX_DMA_CR_CYCLIC_BD_EN_MASK	0x00000010 /* Cyclic BD mode */
 
 #define XILINX_DMA_SR_HALTED_MASK	0x00000001 /* DMA channel halted */
 #define XILINX_DMA_SR_IDLE_MASK		0x00000002 /* DMA channel idle */
@@ -76,6 +79,9 @@
 #define XILINX_DMA_RESET_LOOP		1000000
 #define XILINX_DMA_HALT_LOOP		1000000
 
+/* Descriptors preallocated per channel, the pool grows beyond on demand */
+#define XILINX_DMA_NUM_DESCS		128
+
 #if defined(CONFIG_XILINX_DMATEST) || defined(CONFIG_XILINX_DMATEST_MODULE)
 # define TEST_DMA_WITH_LOOPBACK
 #endif
@@ -103,6 +109,8 @@ struct xilinx_dma_desc_sw {
 	struct list_head node;
 	struct list_head tx_list;
 	struct dma_async_tx_descriptor async_tx;
+	bool cyclic;			/* First BD of a cyclic transfer */
+	bool period_end;		/* Last BD of a cyclic period */
 } __aligned(64);
 
 /* Per DMA specific operations should be embedded in the channel structure */
@@ -116,6 +124,8 @@ struct xilinx_dma_chan {
 	struct list_head pending_list;	/* Descriptors waiting */
 	struct dma_chan common;		/* DMA common channel */
 	struct dma_pool *desc_pool;	/* Descriptors pool */
+	struct list_head free_list;	/* Descriptors ready for reuse */
+	spinlock_t desc_lock;		/* Free list lock */
 	struct device *dev;		/* The dma device */
 	int irq;			/* Channel IRQ */
 	int id;				/* Channel ID */
@@ -129,6 +139,13 @@ struct xilinx_dma_chan {
 	u32 private;			/* Match info for channel request */
 	struct xilinx_dma_config config;
 					/* Device configuration info */
+	bool cyclic;			/* Running a cyclic transfer */
+	struct xilinx_dma_desc_sw *cyclic_cur;
+					/* Next BD to complete in cyclic mode */
+	unsigned int cyclic_periods;	/* Periods completed, not reported */
+	struct xilinx_dma_desc_sw *cyclic_tail;
+					/* Tail BD outside the cyclic ring */
+	dma_addr_t cyclic_tail_phys;	/* Bus address of cyclic_tail */
 };
 
 /* DMA Device Structure */
@@ -156,6 +173,9 @@ static inline u32 dma_read(struct xilinx_dma_chan *chan, u32 reg)
 static int xilinx_dma_alloc_chan_resources(struct dma_chan *dchan)
 {
 	struct xilinx_dma_chan *chan = to_xilinx_chan(dchan);
+	struct xilinx_dma_desc_sw *desc;
+	dma_addr_t pdesc;
+	int i;
 
 	/* Has this channel already been allocated? */
 	if (chan->desc_pool)
@@ -176,38 +196,54 @@ static int xilinx_dma_alloc_chan_resources(struct dma_chan *dchan)
 		return -ENOMEM;
 	}
 
+	/*
+	 * In cyclic BD mode the tail descriptor register has to point to a
+	 * BD that is not part of the ring, so that the hardware never stops.
+	 */
+	chan->cyclic_tail = dma_pool_alloc(chan->desc_pool, GFP_KERNEL,
+					   &chan->cyclic_tail_phys);
+	if (!chan->cyclic_tail) {
+		dma_pool_destroy(chan->desc_pool);
+		chan->desc_pool = NULL;
+		return -ENOMEM;
+	}
+	memset(chan->cyclic_tail, 0, sizeof(*chan->cyclic_tail));
+
+	/*
+	 * Fill the free list up front, so that preparing a transfer does not
+	 * have to go to the pool allocator for every BD.
+	 */
+	for (i = 0; i < XILINX_DMA_NUM_DESCS; i++) {
+		desc = dma_pool_alloc(chan->desc_pool, GFP_KERNEL, &pdesc);
+		if (!desc)
+			break;
+
+		desc->async_tx.phys = pdesc;
+		list_add_tail(&desc->node, &chan->free_list);
+	}
+
 	chan->completed_cookie = 1;
 	chan->cookie = 1;
 
 	/* There is at least one descriptor free to be allocated */
-	return 1;
+	return i ? i : 1;
 }
 
+/* Give the descriptors on the list back to the channel free list */
 static void xilinx_dma_free_desc_list(struct xilinx_dma_chan *chan,
 				      struct list_head *list)
 {
-	struct xilinx_dma_desc_sw *desc, *_desc;
-
-	list_for_each_entry_safe(desc, _desc, list, node) {
-		list_del(&desc->node);
-		dma_pool_free(chan->desc_pool, desc, desc->async_tx.phys);
-	}
-}
-
-static void xilinx_dma_free_desc_list_reverse(struct xilinx_dma_chan *chan,
-					      struct list_head *list)
-{
-	struct xilinx_dma_desc_sw *desc, *_desc;
+	unsigned long flags;
 
-	list_for_each_entry_safe_reverse(desc, _desc, list, node) {
-		list_del(&desc->node);
-		dma_pool_free(chan->desc_pool, desc, desc->async_tx.phys);
-	}
+	spin_lock_irqsave(&chan->desc_lock, flags);
+	list_splice_tail_init(list, &chan->free_list);
+	spin_unlock_irqrestore(&chan->desc_lock, flags);
 }
 
 static void xilinx_dma_free_chan_resources(struct dma_chan *dchan)
 {
 	struct xilinx_dma_chan *chan = to_xilinx_chan(dchan);
+	struct xilinx_dma_desc_sw *desc, *_desc;
 	unsigned long flags;
 
 	dev_dbg(chan->dev, "Free all channel resources.\n");
@@ -216,6 +252,13 @@ static void xilinx_dma_free_chan_resources(struct dma_chan *dchan)
 	xilinx_dma_free_desc_list(chan, &chan->pending_list);
 	spin_unlock_irqrestore(&chan->lock, flags);
 
+	list_for_each_entry_safe(desc, _desc, &chan->free_list, node) {
+		list_del(&desc->node);
+		dma_pool_free(chan->desc_pool, desc, desc->async_tx.phys);
+	}
+
+	dma_pool_free(chan->desc_pool, chan->cyclic_tail,
+		      chan->cyclic_tail_phys);
 	dma_pool_destroy(chan->desc_pool);
 	chan->desc_pool = NULL;
 }
@@ -230,39 +273,61 @@ static enum dma_status xilinx_dma_desc_status(struct xilinx_dma_chan *chan,
 
 static void xilinx_chan_desc_cleanup(struct xilinx_dma_chan *chan)
 {
-	struct xilinx_dma_desc_sw *desc;
+	struct xilinx_dma_desc_sw *desc, *_desc;
 	unsigned long flags;
+	LIST_HEAD(done);
 
 	spin_lock_irqsave(&chan->lock, flags);
 
-	while (!list_empty(&chan->active_list)) {
+	/*
+	 * A cyclic transfer is never completed, just report the periods
+	 * finished since the last run. Its descriptors stay on the active
+	 * list until the channel is terminated.
+	 */
+	if (chan->cyclic) {
 		dma_async_tx_callback callback;
 		void *callback_param;
+		unsigned int periods = chan->cyclic_periods;
 
 		desc = list_first_entry(&chan->active_list,
 			struct xilinx_dma_desc_sw, node);
+		callback = desc->async_tx.callback;
+		callback_param = desc->async_tx.callback_param;
+		chan->cyclic_periods = 0;
 
+		spin_unlock_irqrestore(&chan->lock, flags);
+		while (callback && periods--)
+			callback(callback_param);
+		return;
+	}
+
+	/*
+	 * Take everything that completed off the list of running
+	 * transactions in one go, instead of dropping and retaking the lock
+	 * around every callback. With interrupt coalescing one run usually
+	 * retires a whole batch of BDs.
+	 */
+	list_for_each_entry_safe(desc, _desc, &chan->active_list, node) {
 		if (xilinx_dma_desc_status(chan, desc) == DMA_IN_PROGRESS)
 			break;
 
-		/* Remove from the list of running transactions */
-		list_del(&desc->node);
+		list_move_tail(&desc->node, &done);
+	}
+
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	list_for_each_entry(desc, &done, node) {
+		dma_async_tx_callback callback = desc->async_tx.callback;
 
 		/* Run the link descriptor callback function */
-		callback = desc->async_tx.callback;
-		callback_param = desc->async_tx.callback_param;
-		if (callback) {
-			spin_unlock_irqrestore(&chan->lock, flags);
-			callback(callback_param);
-			spin_lock_irqsave(&chan->lock, flags);
-		}
+		if (callback)
+			callback(desc->async_tx.callback_param);
 
-		/* Run any dependencies, then free the descriptor */
 		dma_run_dependencies(&desc->async_tx);
-		dma_pool_free(chan->desc_pool, desc, desc->async_tx.phys);
 	}
 
-	spin_unlock_irqrestore(&chan->lock, flags);
+	/* Recycle the whole batch */
+	xilinx_dma_free_desc_list(chan, &done);
 }
 
 static enum dma_status xilinx_tx_status(struct dma_chan *dchan,
@@ -379,12 +444,28 @@ static void xilinx_dma_start_transfer(struct xilinx_dma_chan *chan)
 
 		dma_write(chan, XILINX_DMA_CDESC_OFFSET, desch->async_tx.phys);
 
+		if (desch->cyclic)
+			dma_write(chan, XILINX_DMA_CONTROL_OFFSET,
+				  dma_read(chan, XILINX_DMA_CONTROL_OFFSET) |
+				  XILINX_DMA_CR_CYCLIC_BD_EN_MASK);
+
 		dma_start(chan);
 
 		if (chan->err)
 			return;
 		list_splice_tail_init(&chan->pending_list, &chan->active_list);
 
+		if (desch->cyclic) {
+			chan->cyclic = true;
+			chan->cyclic_cur = desch;
+			chan->cyclic_periods = 0;
+
+			/* Start the transfer, which never reaches the tail */
+			dma_write(chan, XILINX_DMA_TDESC_OFFSET,
+				  chan->cyclic_tail_phys);
+			return;
+		}
+
 		/* Update tail ptr register and start the transfer */
 		dma_write(chan, XILINX_DMA_TDESC_OFFSET, desct->async_tx.phys);
 	} else {
@@ -451,6 +532,36 @@ static void xilinx_dma_update_completed_cookie(struct xilinx_dma_chan *chan)
 		}
 	}
 }
+
+/**
+ * xilinx_dma_update_cyclic - Count the periods completed in cyclic mode.
+ * @chan : xilinx DMA channel
+ *
+ * The hardware ignores the completed bit in cyclic BD mode, so the status
+ * of every completed BD is cleared here to detect its next completion.
+ *
+ * CONTEXT: hardirq
+ */
+static void xilinx_dma_update_cyclic(struct xilinx_dma_chan *chan)
+{
+	struct xilinx_dma_desc_sw *desc = chan->cyclic_cur;
+
+	while (desc->hw.status & XILINX_DMA_BD_STS_ALL_MASK) {
+		desc->hw.status = 0;
+		if (desc->period_end)
+			chan->cyclic_periods++;
+
+		if (list_is_last(&desc->node, &chan->active_list))
+			desc = list_first_entry(&chan->active_list,
+						struct xilinx_dma_desc_sw,
+						node);
+		else
+			desc = list_next_entry(desc, node);
+	}
+
+	chan->cyclic_cur = desc;
+}
+
 /**
  * xilinx_dma_chan_config - Configure DMA Channel IRQThreshold, IRQDelay
  * and enable interrupts
@@ -537,8 +648,12 @@ static irqreturn_t dma_intr_handler(int irq, void *data)
 		dev_dbg(chan->dev, "Inter-packet latency too long\n");
 
 	if (stat & XILINX_DMA_XR_IRQ_IOC_MASK) {
-		xilinx_dma_update_completed_cookie(chan);
-		xilinx_dma_start_transfer(chan);
+		if (chan->cyclic) {
+			xilinx_dma_update_cyclic(chan);
+		} else {
+			xilinx_dma_update_completed_cookie(chan);
+			xilinx_dma_start_transfer(chan);
+		}
 	}
 
 out_unlock:
@@ -591,7 +706,7 @@ static dma_cookie_t xilinx_dma_tx_submit(struct dma_async_tx_descriptor *tx)
 {
 	struct xilinx_dma_chan *chan = to_xilinx_chan(tx->chan);
 	struct xilinx_dma_desc_sw *desc;
-	struct xilinx_dma_desc_sw *child;
+	struct xilinx_dma_desc_sw *child, *last;
 	unsigned long flags;
 	dma_cookie_t cookie = -EBUSY;
 
@@ -604,10 +719,13 @@ static dma_cookie_t xilinx_dma_tx_submit(struct dma_async_tx_descriptor *tx)
 		 * If reset fails, need to hard reset the system.
 		 * Channel is no longer functional
 		 */
-		if (!dma_reset(chan))
+		if (!dma_reset(chan)) {
 			chan->err = false;
-		else
+			/* The reset cleared the coalescing settings too */
+			xilinx_dma_chan_config(chan);
+		} else {
 			goto out_unlock;
+		}
 	}
 
 	/*
@@ -625,6 +743,20 @@ static dma_cookie_t xilinx_dma_tx_submit(struct dma_async_tx_descriptor *tx)
 
 	chan->cookie = cookie;
 
+	/*
+	 * The client sets the callback on the first descriptor, but the
+	 * transaction is only done once its last BD has completed. Move the
+	 * callback there, so that there is exactly one callback per
+	 * transaction. Cyclic transfers report from the first BD.
+	 */
+	last = list_last_entry(&desc->tx_list, struct xilinx_dma_desc_sw, node);
+	if (!desc->cyclic && last != desc) {
+		last->async_tx.callback = desc->async_tx.callback;
+		last->async_tx.callback_param = desc->async_tx.callback_param;
+		desc->async_tx.callback = NULL;
+		desc->async_tx.callback_param = NULL;
+	}
+
 	/* Put this transaction onto the tail of the pending queue */
 	append_desc_queue(chan, desc);
 
@@ -637,12 +769,26 @@ out_unlock:
 static struct
 xilinx_dma_desc_sw *xilinx_dma_alloc_descriptor(struct xilinx_dma_chan *chan)
 {
-	struct xilinx_dma_desc_sw *desc;
+	struct xilinx_dma_desc_sw *desc = NULL;
+	unsigned long flags;
 	dma_addr_t pdesc;
 
-	desc = dma_pool_alloc(chan->desc_pool, GFP_ATOMIC, &pdesc);
-	if (!desc)
-		return NULL;
+	spin_lock_irqsave(&chan->desc_lock, flags);
+	if (!list_empty(&chan->free_list)) {
+		desc = list_first_entry(&chan->free_list,
+					struct xilinx_dma_desc_sw, node);
+		list_del(&desc->node);
+	}
+	spin_unlock_irqrestore(&chan->desc_lock, flags);
+
+	if (desc) {
+		pdesc = desc->async_tx.phys;
+	} else {
+		/* Free list exhausted, grow it from the pool */
+		desc = dma_pool_alloc(chan->desc_pool, GFP_ATOMIC, &pdesc);
+		if (!desc)
+			return NULL;
+	}
 
 	memset(desc, 0, sizeof(*desc));
 	INIT_LIST_HEAD(&desc->tx_list);
@@ -786,7 +932,211 @@ fail:
 	 * to first->tx_list, INCLUDING "first" itself. Therefore we
 	 * must traverse the list backwards freeing each descriptor in turn
 	 */
-	xilinx_dma_free_desc_list_reverse(chan, &first->tx_list);
+	xilinx_dma_free_desc_list(chan, &first->tx_list);
+
+	return NULL;
+}
+
+/**
+ * xilinx_dma_prep_chunk - Append the BDs for one contiguous buffer
+ * @chan: DMA channel
+ * @first: first descriptor of the transaction, set if it is still NULL
+ * @prev: last descriptor of the transaction, updated
+ * @addr: bus address of the buffer
+ * @len: length of the buffer
+ * @sop: whether the buffer starts a packet
+ *
+ * The buffer is split in BDs of at most chan->max_len bytes. For a
+ * DMA_MEM_TO_DEV channel SOP is set on the first BD if @sop is true, the
+ * caller sets EOP on *@prev.
+ *
+ * Return: 0 on success, -ENOMEM if no descriptor could be allocated
+ */
+static int xilinx_dma_prep_chunk(struct xilinx_dma_chan *chan,
+				 struct xilinx_dma_desc_sw **first,
+				 struct xilinx_dma_desc_sw **prev,
+				 dma_addr_t addr, size_t len, bool sop)
+{
+	struct xilinx_dma_desc_sw *new;
+	size_t used = 0;
+	size_t copy;
+
+	while (used < len) {
+		new = xilinx_dma_alloc_descriptor(chan);
+		if (!new) {
+			dev_err(chan->dev,
+				"No free memory for link descriptor\n");
+			return -ENOMEM;
+		}
+
+		copy = min(len - used, (size_t)chan->max_len);
+		new->hw.buf_addr = addr + used;
+		new->hw.control = copy;
+
+		if (sop && !used && chan->direction == DMA_MEM_TO_DEV)
+			new->hw.control |= XILINX_DMA_BD_SOP;
+
+		if (!*first)
+			*first = new;
+		else
+			(*prev)->hw.next_desc = new->async_tx.phys;
+
+		new->async_tx.cookie = 0;
+		async_tx_ack(&new->async_tx);
+
+		list_add_tail(&new->node, &(*first)->tx_list);
+		*prev = new;
+		used += copy;
+	}
+
+	return 0;
+}
+
+/**
+ * xilinx_dma_prep_dma_cyclic - prepare descriptors for a cyclic transaction
+ * @dchan: DMA channel
+ * @buf_addr: bus address of the buffer
+ * @buf_len: length of the buffer, a multiple of @period_len
+ * @period_len: number of bytes after which the callback is called
+ * @direction: DMA direction
+ * @flags: transfer ack flags
+ *
+ * The BDs of all periods form a ring that the hardware keeps looping over
+ * in cyclic BD mode, so no descriptor has to be resubmitted. On a
+ * DMA_MEM_TO_DEV channel every period is sent as one packet. The cyclic
+ * transfer must be the only transaction on the channel and runs until
+ * DMA_TERMINATE_ALL. Requires scatter gather mode.
+ */
+static struct dma_async_tx_descriptor *xilinx_dma_prep_dma_cyclic(
+	struct dma_chan *dchan, dma_addr_t buf_addr, size_t buf_len,
+	size_t period_len, enum dma_transfer_direction direction,
+	unsigned long flags)
+{
+	struct xilinx_dma_chan *chan;
+	struct xilinx_dma_desc_sw *first = NULL, *prev = NULL;
+	unsigned long lock_flags;
+	size_t offset;
+	bool busy;
+
+	if (!dchan)
+		return NULL;
+
+	chan = to_xilinx_chan(dchan);
+
+	if (!chan->has_sg || chan->direction != direction)
+		return NULL;
+
+	if (!period_len || !buf_len || buf_len % period_len)
+		return NULL;
+
+	spin_lock_irqsave(&chan->lock, lock_flags);
+	busy = chan->cyclic || !list_empty(&chan->active_list) ||
+	       !list_empty(&chan->pending_list);
+	spin_unlock_irqrestore(&chan->lock, lock_flags);
+	if (busy)
+		return NULL;
+
+	for (offset = 0; offset < buf_len; offset += period_len) {
+		if (xilinx_dma_prep_chunk(chan, &first, &prev,
+					  buf_addr + offset, period_len, true))
+			goto fail;
+
+		prev->period_end = true;
+		if (direction == DMA_MEM_TO_DEV)
+			prev->hw.control |= XILINX_DMA_BD_EOP;
+	}
+
+	/* Close the ring, the hardware loops over it until terminated */
+	prev->hw.next_desc = first->async_tx.phys;
+	first->cyclic = true;
+
+	prev->async_tx.flags = flags;
+	prev->async_tx.cookie = -EBUSY;
+
+	return &first->async_tx;
+
+fail:
+	if (first)
+		xilinx_dma_free_desc_list(chan, &first->tx_list);
+
+	return NULL;
+}
+
+/**
+ * xilinx_dma_prep_interleaved - prepare descriptors for an interleaved
+ * transaction
+ * @dchan: DMA channel
+ * @xt: interleaved template
+ * @flags: transfer ack flags
+ *
+ * Only the memory side of the template is used, the device side is the
+ * stream of the channel. Every chunk becomes one or more BDs; on a
+ * DMA_MEM_TO_DEV channel every frame is sent as one packet.
+ */
+static struct dma_async_tx_descriptor *xilinx_dma_prep_interleaved(
+	struct dma_chan *dchan, struct dma_interleaved_template *xt,
+	unsigned long flags)
+{
+	struct xilinx_dma_chan *chan;
+	struct xilinx_dma_desc_sw *first = NULL, *prev = NULL;
+	struct data_chunk *chunk;
+	dma_addr_t addr;
+	bool inc, use_icg;
+	size_t f, c;
+
+	if (!dchan || !xt)
+		return NULL;
+
+	chan = to_xilinx_chan(dchan);
+
+	if (chan->direction != xt->dir || !xt->numf || !xt->frame_size)
+		return NULL;
+
+	if (xt->dir == DMA_MEM_TO_DEV) {
+		addr = xt->src_start;
+		inc = xt->src_inc;
+		use_icg = xt->src_sgl;
+	} else {
+		addr = xt->dst_start;
+		inc = xt->dst_inc;
+		use_icg = xt->dst_sgl;
+	}
+
+	/* The hardware can only step through memory */
+	if (!inc)
+		return NULL;
+
+	for (f = 0; f < xt->numf; f++) {
+		for (c = 0; c < xt->frame_size; c++) {
+			chunk = &xt->sgl[c];
+			if (xilinx_dma_prep_chunk(chan, &first, &prev, addr,
+						  chunk->size, c == 0))
+				goto fail;
+
+			addr += chunk->size;
+			if (use_icg)
+				addr += chunk->icg;
+		}
+
+		if (prev && xt->dir == DMA_MEM_TO_DEV)
+			prev->hw.control |= XILINX_DMA_BD_EOP;
+	}
+
+	/* All chunks have length == 0 */
+	if (!first)
+		return NULL;
+
+	/* Link the last BD with the first BD */
+	prev->hw.next_desc = first->async_tx.phys;
+
+	prev->async_tx.flags = flags;
+	prev->async_tx.cookie = -EBUSY;
+
+	return &first->async_tx;
+
+fail:
+	if (first)
+		xilinx_dma_free_desc_list(chan, &first->tx_list);
 
 	return NULL;
 }
@@ -809,6 +1159,13 @@ static int xilinx_dma_device_control(struct dma_chan *dchan,
 
 		spin_lock_irqsave(&chan->lock, flags);
 
+		if (chan->cyclic) {
+			dma_write(chan, XILINX_DMA_CONTROL_OFFSET,
+				  dma_read(chan, XILINX_DMA_CONTROL_OFFSET) &
+				  ~XILINX_DMA_CR_CYCLIC_BD_EN_MASK);
+			chan->cyclic = false;
+		}
+
 		/* Remove and free all of the descriptors in the lists */
 		xilinx_dma_free_desc_list(chan, &chan->pending_list);
 		xilinx_dma_free_desc_list(chan, &chan->active_list);
@@ -818,14 +1175,14 @@ static int xilinx_dma_device_control(struct dma_chan *dchan,
 	} else if (cmd == DMA_SLAVE_CONFIG) {
 		/*
 		 * Configure interrupt coalescing and delay counter
-		 * Use value XILINX_DMA_NO_CHANGE to signal no change
+		 * Out of range values leave the setting unchanged
 		 */
 		struct xilinx_dma_config *cfg = (struct xilinx_dma_config *)arg;
 
-		if (cfg->coalesc <= XILINX_DMA_COALESCE_MAX)
+		if (cfg->coalesc > 0 && cfg->coalesc <= XILINX_DMA_COALESCE_MAX)
 			chan->config.coalesc = cfg->coalesc;
 
-		if (cfg->delay <= XILINX_DMA_DELAY_MAX)
+		if (cfg->delay >= 0 && cfg->delay <= XILINX_DMA_DELAY_MAX)
 			chan->config.delay = cfg->delay;
 
 		xilinx_dma_chan_config(chan);
@@ -925,6 +1282,8 @@ static int xilinx_dma_chan_probe(struct xilinx_dma_device *xdev,
 	}
 
 	spin_lock_init(&chan->lock);
+	spin_lock_init(&chan->desc_lock);
+	INIT_LIST_HEAD(&chan->free_list);
 	INIT_LIST_HEAD(&chan->pending_list);
 	INIT_LIST_HEAD(&chan->active_list);
 
@@ -983,7 +1342,11 @@ static int xilinx_dma_probe(struct platform_device *pdev)
 	/* Axi DMA only do slave transfers */
 	dma_cap_set(DMA_SLAVE, xdev->common.cap_mask);
 	dma_cap_set(DMA_PRIVATE, xdev->common.cap_mask);
+	dma_cap_set(DMA_CYCLIC, xdev->common.cap_mask);
+	dma_cap_set(DMA_INTERLEAVE, xdev->common.cap_mask);
 	xdev->common.device_prep_slave_sg = xilinx_dma_prep_slave_sg;
+	xdev->common.device_prep_dma_cyclic = xilinx_dma_prep_dma_cyclic;
+	xdev->common.device_prep_interleaved_dma = xilinx_dma_prep_interleaved;
 	xdev->common.device_control = xilinx_dma_device_control;
 	xdev->common.device_issue_pending = xilinx_dma_issue_pending;
 	xdev->common.device_alloc_chan_resources =
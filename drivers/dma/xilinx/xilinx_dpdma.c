@@ -136,6 +136,9 @@
 #define XILINX_DPDMA_ALIGN_BYTES			256
 
 #define XILINX_DPDMA_NUM_CHAN				6
+
+/* single descriptor transactions kept for reuse per channel */
+#define XILINX_DPDMA_NUM_FREE_DESC			4
 #define XILINX_DPDMA_PAGE_MASK				((1 << 12) - 1)
 #define XILINX_DPDMA_PAGE_SHIFT				12
 
@@ -258,6 +261,10 @@ enum xilinx_dpdma_chan_status {
  * pending_list -> pending_desc: request to issue pending a descriptor
  * pending_desc -> active_desc: VSYNC intr when a desc is scheduled to DPDMA
  * active_desc -> done_list: VSYNC intr when DPDMA switches to a new desc
+ *
+ * Once completed, transactions of a single descriptor go to the free_list,
+ * where they are picked up again by the next interleaved preparation. A
+ * page flip then only rewrites the addresses of an existing descriptor.
  */
 
 /**
@@ -276,6 +283,8 @@ enum xilinx_dpdma_chan_status {
  * @pending_desc: pending descriptor to be scheduled in next period
  * @active_desc: descriptor that the DPDMA channel is active on
  * @done_list: done descriptor list
+ * @free_list: completed single descriptor transactions to reuse
+ * @free_cnt: number of transactions in @free_list
  * @xdev: DPDMA device
  */
 struct xilinx_dpdma_chan {
@@ -296,6 +305,8 @@ struct xilinx_dpdma_chan {
 	struct xilinx_dpdma_tx_desc *pending_desc;
 	struct xilinx_dpdma_tx_desc *active_desc;
 	struct list_head done_list;
+	struct list_head free_list;
+	unsigned int free_cnt;
 
 	struct xilinx_dpdma_device *xdev;
 };
@@ -586,6 +597,66 @@ xilinx_dpdma_chan_free_tx_desc(struct xilinx_dpdma_chan *chan,
 	kfree(tx_desc);
 }
 
+/**
+ * xilinx_dpdma_chan_put_tx_desc - Release a completed transaction descriptor
+ * @chan: DPDMA channel
+ * @tx_desc: tx descriptor
+ *
+ * Keep the tx descriptor @tx_desc for reuse if it has a single software
+ * descriptor and there is room in the free list, or free it otherwise.
+ * The channel lock should be held.
+ */
+static void xilinx_dpdma_chan_put_tx_desc(struct xilinx_dpdma_chan *chan,
+					  struct xilinx_dpdma_tx_desc *tx_desc)
+{
+	if (chan->free_cnt < XILINX_DPDMA_NUM_FREE_DESC &&
+	    list_is_singular(&tx_desc->descriptors)) {
+		list_add(&tx_desc->node, &chan->free_list);
+		chan->free_cnt++;
+		return;
+	}
+
+	xilinx_dpdma_chan_free_tx_desc(chan, tx_desc);
+}
+
+/**
+ * xilinx_dpdma_chan_get_tx_desc - Get a reused transaction descriptor
+ * @chan: DPDMA channel
+ *
+ * Take a tx descriptor with a single software descriptor from the free list,
+ * and reset it as a freshly allocated one.
+ *
+ * Return: a tx descriptor or NULL if the free list is empty.
+ */
+static struct xilinx_dpdma_tx_desc *
+xilinx_dpdma_chan_get_tx_desc(struct xilinx_dpdma_chan *chan)
+{
+	struct xilinx_dpdma_tx_desc *tx_desc = NULL;
+	struct xilinx_dpdma_sw_desc *sw_desc;
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->lock, flags);
+	if (!list_empty(&chan->free_list)) {
+		tx_desc = list_first_entry(&chan->free_list,
+					   struct xilinx_dpdma_tx_desc, node);
+		list_del(&tx_desc->node);
+		chan->free_cnt--;
+	}
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	if (!tx_desc)
+		return NULL;
+
+	sw_desc = list_first_entry(&tx_desc->descriptors,
+				   struct xilinx_dpdma_sw_desc, node);
+	memset(&sw_desc->hw, 0, sizeof(sw_desc->hw));
+	memset(&tx_desc->async_tx, 0, sizeof(tx_desc->async_tx));
+	tx_desc->status = PREPARED;
+	tx_desc->done_cnt = 0;
+
+	return tx_desc;
+}
+
 /**
  * xilinx_dpdma_chan_submit_tx_desc - Submit a transaction descriptor
  * @chan: DPDMA channel
@@ -659,6 +730,8 @@ static void xilinx_dpdma_chan_free_all_desc(struct xilinx_dpdma_chan *chan)
 	xilinx_dpdma_chan_free_tx_desc(chan, chan->active_desc);
 	chan->active_desc = NULL;
 	xilinx_dpdma_chan_free_desc_list(chan, &chan->done_list);
+	xilinx_dpdma_chan_free_desc_list(chan, &chan->free_list);
+	chan->free_cnt = 0;
 
 	spin_unlock_irqrestore(&chan->lock, flags);
 }
@@ -696,7 +769,7 @@ static void xilinx_dpdma_chan_cleanup_desc(struct xilinx_dpdma_chan *chan)
 			spin_lock_irqsave(&chan->lock, flags);
 		}
 
-		xilinx_dpdma_chan_free_tx_desc(chan, desc);
+		xilinx_dpdma_chan_put_tx_desc(chan, desc);
 	}
 
 	if (chan->active_desc) {
@@ -721,9 +794,12 @@ static void xilinx_dpdma_chan_cleanup_desc(struct xilinx_dpdma_chan *chan)
  *
  * Make the pending descriptor @chan->pending_desc as active. This function
  * should be called when the channel starts operating on the pending descriptor.
+ * The previous active descriptor has been fetched at least once by then, and
+ * is completed here if it didn't ask for a completion interrupt.
  */
 static void xilinx_dpdma_chan_desc_active(struct xilinx_dpdma_chan *chan)
 {
+	struct xilinx_dpdma_tx_desc *done;
 	unsigned long flags;
 
 	spin_lock_irqsave(&chan->lock, flags);
@@ -731,12 +807,23 @@ static void xilinx_dpdma_chan_desc_active(struct xilinx_dpdma_chan *chan)
 	if (!chan->pending_desc)
 		goto out_unlock;
 
-	if (chan->active_desc)
-		list_add_tail(&chan->active_desc->node, &chan->done_list);
-
+	done = chan->active_desc;
 	chan->active_desc = chan->pending_desc;
 	chan->pending_desc = NULL;
 
+	if (!done)
+		goto out_unlock;
+
+	if (done->status == PREPARED) {
+		dma_cookie_complete(&done->async_tx);
+		done->status = ACTIVE;
+	}
+	list_add_tail(&done->node, &chan->done_list);
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	tasklet_schedule(&chan->done_task);
+	return;
+
 out_unlock:
 	spin_unlock_irqrestore(&chan->lock, flags);
 }
@@ -929,15 +1016,20 @@ error:
  * xilinx_dpdma_chan_prep_interleaved - Prepare a interleaved dma descriptor
  * @chan: DPDMA channel
  * @xt: dma interleaved template
+ * @flags: dma control flags
  *
  * Prepare a tx descriptor incudling internal software/hardware descriptors
- * based on @xt.
+ * based on @xt. The descriptor of a completed interleaved transaction is
+ * reused if there is one. The descriptor is fetched again for every frame,
+ * and only generates a completion interrupt with DMA_PREP_INTERRUPT in
+ * @flags, so a static framebuffer doesn't interrupt per frame.
  *
  * Return: A dma async tx descriptor on success, or NULL.
  */
 static struct dma_async_tx_descriptor *
 xilinx_dpdma_chan_prep_interleaved(struct xilinx_dpdma_chan *chan,
-				   struct dma_interleaved_template *xt)
+				   struct dma_interleaved_template *xt,
+				   unsigned long flags)
 {
 	struct xilinx_dpdma_tx_desc *tx_desc;
 	struct xilinx_dpdma_sw_desc *sw_desc;
@@ -951,6 +1043,13 @@ xilinx_dpdma_chan_prep_interleaved(struct xilinx_dpdma_chan *chan,
 		return NULL;
 	}
 
+	tx_desc = xilinx_dpdma_chan_get_tx_desc(chan);
+	if (tx_desc) {
+		sw_desc = list_first_entry(&tx_desc->descriptors,
+					   struct xilinx_dpdma_sw_desc, node);
+		goto reuse;
+	}
+
 	tx_desc = xilinx_dpdma_chan_alloc_tx_desc(chan);
 	if (!tx_desc)
 		return NULL;
@@ -958,6 +1057,9 @@ xilinx_dpdma_chan_prep_interleaved(struct xilinx_dpdma_chan *chan,
 	sw_desc = xilinx_dpdma_chan_alloc_sw_desc(chan);
 	if (!sw_desc)
 		goto error;
+	list_add_tail(&sw_desc->node, &tx_desc->descriptors);
+
+reuse:
 
 	chan->xdev->desc_addr(sw_desc, sw_desc, &xt->src_start, 1);
 	hw_desc = &sw_desc->hw;
@@ -967,12 +1069,11 @@ xilinx_dpdma_chan_prep_interleaved(struct xilinx_dpdma_chan *chan,
 	hw_desc->hsize_stride |= (stride / 16) <<
 				 XILINX_DPDMA_DESC_HSIZE_STRIDE_STRIDE_SHIFT;
 	hw_desc->control |= XILINX_DPDMA_DESC_CONTROL_PREEMBLE;
-	hw_desc->control |= XILINX_DPDMA_DESC_CONTROL_COMPLETE_INTR;
+	if (flags & DMA_PREP_INTERRUPT)
+		hw_desc->control |= XILINX_DPDMA_DESC_CONTROL_COMPLETE_INTR;
 	hw_desc->control |= XILINX_DPDMA_DESC_CONTROL_IGNORE_DONE;
 	hw_desc->control |= XILINX_DPDMA_DESC_CONTROL_LAST_OF_FRAME;
 
-	list_add_tail(&sw_desc->node, &tx_desc->descriptors);
-
 	return &tx_desc->async_tx;
 
 error:
@@ -1464,7 +1565,7 @@ xilinx_dpdma_prep_interleaved_dma(struct dma_chan *dchan,
 	if (!xt->numf || !xt->sgl[0].size)
 		return NULL;
 
-	async_tx = xilinx_dpdma_chan_prep_interleaved(chan, xt);
+	async_tx = xilinx_dpdma_chan_prep_interleaved(chan, xt, flags);
 	if (!async_tx)
 		return NULL;
 
@@ -1755,6 +1856,7 @@ xilinx_dpdma_chan_probe(struct device_node *node,
 	spin_lock_init(&chan->lock);
 	INIT_LIST_HEAD(&chan->pending_list);
 	INIT_LIST_HEAD(&chan->done_list);
+	INIT_LIST_HEAD(&chan->free_list);
 	init_waitqueue_head(&chan->wait_to_stop);
 
 	tasklet_init(&chan->done_task, xilinx_dpdma_chan_done_task,
@@ -60,6 +60,7 @@
 #define XILINX_VDMA_DMACR_CIRC_EN		BIT(1)
 #define XILINX_VDMA_DMACR_RUNSTOP		BIT(0)
 #define XILINX_VDMA_DMACR_FSYNCSRC_MASK		GENMASK(6, 5)
+#define XILINX_VDMA_DMACR_MASTER_MASK		GENMASK(11, 8)
 
 #define XILINX_VDMA_REG_DMASR			0x0004
 #define XILINX_VDMA_DMASR_EOL_LATE_ERR		BIT(15)
@@ -87,7 +88,13 @@
 #define XILINX_VDMA_REG_FRMPTR_STS		0x0024
 #define XILINX_VDMA_REG_PARK_PTR		0x0028
 #define XILINX_VDMA_PARK_PTR_WR_REF_SHIFT	8
+#define XILINX_VDMA_PARK_PTR_WR_REF_MASK	GENMASK(12, 8)
 #define XILINX_VDMA_PARK_PTR_RD_REF_SHIFT	0
+#define XILINX_VDMA_PARK_PTR_RD_REF_MASK	GENMASK(4, 0)
+#define XILINX_VDMA_PARK_PTR_WR_FRMSTORE_SHIFT	24
+#define XILINX_VDMA_PARK_PTR_WR_FRMSTORE_MASK	GENMASK(28, 24)
+#define XILINX_VDMA_PARK_PTR_RD_FRMSTORE_SHIFT	16
+#define XILINX_VDMA_PARK_PTR_RD_FRMSTORE_MASK	GENMASK(20, 16)
 #define XILINX_VDMA_REG_VDMA_VERSION		0x002c
 
 /* Register Direct Mode Registers */
@@ -96,12 +103,14 @@
 
 #define XILINX_VDMA_REG_FRMDLY_STRIDE		0x0008
 #define XILINX_VDMA_FRMDLY_STRIDE_FRMDLY_SHIFT	24
+#define XILINX_VDMA_FRMDLY_STRIDE_FRMDLY_MASK	GENMASK(28, 24)
 #define XILINX_VDMA_FRMDLY_STRIDE_STRIDE_SHIFT	0
 
 #define XILINX_VDMA_REG_START_ADDRESS(n)	(0x000c + 4 * (n))
 
 /* HW specific definitions */
 #define XILINX_VDMA_MAX_CHANS_PER_DEVICE	0x2
+#define XILINX_VDMA_MAX_FRMSTORES		32
 
 #define XILINX_VDMA_DMAXR_ALL_IRQ_MASK	\
 		(XILINX_VDMA_DMASR_FRM_CNT_IRQ | \
@@ -176,11 +185,13 @@ struct xilinx_vdma_tx_segment {
  * @async_tx: Async transaction descriptor
  * @segments: TX segments list
  * @node: Node in the channel descriptors list
+ * @frame: Frame information recorded at completion
  */
 struct xilinx_vdma_tx_descriptor {
 	struct dma_async_tx_descriptor async_tx;
 	struct list_head segments;
 	struct list_head node;
+	struct xilinx_vdma_frame_info frame;
 };
 
 /**
@@ -206,6 +217,14 @@ struct xilinx_vdma_tx_descriptor {
  * @tasklet: Cleanup work after irq
  * @config: Device configuration info
  * @flush_on_fsync: Flush on Frame sync
+ * @frm_store: Next frame store to load in park flip mode
+ * @frames: Number of frame count interrupts
+ * @dropped: Number of frame count interrupts without an active descriptor
+ * @frm_addr: Buffer address loaded into each frame store
+ * @frm_loaded: Bitmask of the frame stores loaded with a buffer
+ * @frm_hw: Geometry of the frames last loaded into the frame stores
+ * @genlock_master: Channel followed by this channel as a genlock slave
+ * @genlock_slave: Channel following this channel as a genlock slave
  */
 struct xilinx_vdma_chan {
 	struct xilinx_vdma_device *xdev;
@@ -229,6 +248,14 @@ struct xilinx_vdma_chan {
 	struct tasklet_struct tasklet;
 	struct xilinx_vdma_config config;
 	bool flush_on_fsync;
+	int frm_store;
+	u32 frames;
+	u32 dropped;
+	u32 frm_addr[XILINX_VDMA_MAX_FRMSTORES];
+	u32 frm_loaded;
+	struct xilinx_vdma_desc_hw frm_hw;
+	struct xilinx_vdma_chan *genlock_master;
+	struct xilinx_vdma_chan *genlock_slave;
 };
 
 /**
@@ -607,6 +634,115 @@ static void xilinx_vdma_start(struct xilinx_vdma_chan *chan)
 	return;
 }
 
+/**
+ * xilinx_vdma_set_park - Program the park pointer of the channel
+ * @chan: Driver specific VDMA channel
+ * @frm: Frame store to park on
+ *
+ * The park pointer register is shared by both channels, only the frame
+ * reference of this channel is updated.
+ */
+static void xilinx_vdma_set_park(struct xilinx_vdma_chan *chan, int frm)
+{
+	u32 reg = vdma_read(chan, XILINX_VDMA_REG_PARK_PTR);
+
+	if (chan->direction == DMA_MEM_TO_DEV) {
+		reg &= ~XILINX_VDMA_PARK_PTR_RD_REF_MASK;
+		reg |= frm << XILINX_VDMA_PARK_PTR_RD_REF_SHIFT;
+	} else {
+		reg &= ~XILINX_VDMA_PARK_PTR_WR_REF_MASK;
+		reg |= frm << XILINX_VDMA_PARK_PTR_WR_REF_SHIFT;
+	}
+
+	vdma_write(chan, XILINX_VDMA_REG_PARK_PTR, reg);
+}
+
+/**
+ * xilinx_vdma_load_frame_store - Write a buffer address to a frame store
+ * @chan: Driver specific VDMA channel
+ * @frm: Frame store
+ * @segment: Segment holding the buffer address and the frame geometry
+ *
+ * The address is recorded for genlock pairing and written to the genlock
+ * slave as well, so that the slave keeps reading the frames of this channel.
+ * The frame geometry is only picked up by the next write to VSIZE.
+ *
+ * CONTEXT: the channel lock must be held
+ */
+static void xilinx_vdma_load_frame_store(struct xilinx_vdma_chan *chan,
+					 int frm,
+					 struct xilinx_vdma_tx_segment *segment)
+{
+	vdma_desc_write(chan, XILINX_VDMA_REG_START_ADDRESS(frm),
+			segment->hw.buf_addr);
+
+	chan->frm_addr[frm] = segment->hw.buf_addr;
+	chan->frm_loaded |= BIT(frm);
+	chan->frm_hw = segment->hw;
+
+	if (chan->genlock_slave)
+		vdma_desc_write(chan->genlock_slave,
+				XILINX_VDMA_REG_START_ADDRESS(frm),
+				segment->hw.buf_addr);
+}
+
+/**
+ * xilinx_vdma_load_frame_stores - Load pending frames in park flip mode
+ * @chan: Driver specific VDMA channel
+ *
+ * Every pending descriptor is written to the next frame store and completed
+ * right away, the frames stay in the frame stores until they are replaced.
+ * Which one the hardware uses is selected by xilinx_vdma_channel_flip().
+ *
+ * CONTEXT: the channel lock must be held
+ */
+static void xilinx_vdma_load_frame_stores(struct xilinx_vdma_chan *chan)
+{
+	struct xilinx_vdma_config *config = &chan->config;
+	struct xilinx_vdma_tx_descriptor *desc, *next;
+	struct xilinx_vdma_tx_segment *segment = NULL;
+	u32 reg;
+
+	if (list_empty(&chan->pending_list))
+		return;
+
+	if (!xilinx_vdma_is_running(chan)) {
+		reg = vdma_ctrl_read(chan, XILINX_VDMA_REG_DMACR);
+
+		if (config->frm_cnt_en)
+			reg |= XILINX_VDMA_DMACR_FRAMECNT_EN;
+		else
+			reg &= ~XILINX_VDMA_DMACR_FRAMECNT_EN;
+
+		reg &= ~XILINX_VDMA_DMACR_CIRC_EN;
+		vdma_ctrl_write(chan, XILINX_VDMA_REG_DMACR, reg);
+
+		xilinx_vdma_set_park(chan, config->park_frm);
+
+		xilinx_vdma_start(chan);
+		if (chan->err)
+			return;
+	}
+
+	list_for_each_entry_safe(desc, next, &chan->pending_list, node) {
+		segment = list_first_entry(&desc->segments,
+					   struct xilinx_vdma_tx_segment, node);
+		xilinx_vdma_load_frame_store(chan, chan->frm_store, segment);
+		chan->frm_store = (chan->frm_store + 1) % chan->num_frms;
+
+		list_del(&desc->node);
+		dma_cookie_complete(&desc->async_tx);
+		list_add_tail(&desc->node, &chan->done_list);
+	}
+
+	/* Writing VSIZE makes the hardware pick up the new addresses */
+	vdma_desc_write(chan, XILINX_VDMA_REG_HSIZE, segment->hw.hsize);
+	vdma_desc_write(chan, XILINX_VDMA_REG_FRMDLY_STRIDE, segment->hw.stride);
+	vdma_desc_write(chan, XILINX_VDMA_REG_VSIZE, segment->hw.vsize);
+
+	tasklet_schedule(&chan->tasklet);
+}
+
 /**
  * xilinx_vdma_start_transfer - Starts VDMA transfer
  * @chan: Driver specific channel struct pointer
@@ -624,6 +760,15 @@ static void xilinx_vdma_start_transfer(struct xilinx_vdma_chan *chan)
 
 	spin_lock_irqsave(&chan->lock, flags);
 
+	/* A genlock slave reads the frame stores of its master */
+	if (chan->genlock_master)
+		goto out_unlock;
+
+	if (config->park_flip) {
+		xilinx_vdma_load_frame_stores(chan);
+		goto out_unlock;
+	}
+
 	/* There's already an active descriptor, bail out. */
 	if (chan->active_desc)
 		goto out_unlock;
@@ -675,16 +820,8 @@ static void xilinx_vdma_start_transfer(struct xilinx_vdma_chan *chan)
 	vdma_ctrl_write(chan, XILINX_VDMA_REG_DMACR, reg);
 
 	if (config->park && (config->park_frm >= 0) &&
-			(config->park_frm < chan->num_frms)) {
-		if (chan->direction == DMA_MEM_TO_DEV)
-			vdma_write(chan, XILINX_VDMA_REG_PARK_PTR,
-				config->park_frm <<
-					XILINX_VDMA_PARK_PTR_RD_REF_SHIFT);
-		else
-			vdma_write(chan, XILINX_VDMA_REG_PARK_PTR,
-				config->park_frm <<
-					XILINX_VDMA_PARK_PTR_WR_REF_SHIFT);
-	}
+			(config->park_frm < chan->num_frms))
+		xilinx_vdma_set_park(chan, config->park_frm);
 
 	/* Start the hardware */
 	xilinx_vdma_start(chan);
@@ -700,9 +837,7 @@ static void xilinx_vdma_start_transfer(struct xilinx_vdma_chan *chan)
 		int i = 0;
 
 		list_for_each_entry(segment, &desc->segments, node) {
-			vdma_desc_write(chan,
-					XILINX_VDMA_REG_START_ADDRESS(i++),
-					segment->hw.buf_addr);
+			xilinx_vdma_load_frame_store(chan, i++, segment);
 			last = segment;
 		}
 
@@ -737,22 +872,31 @@ static void xilinx_vdma_issue_pending(struct dma_chan *dchan)
 /**
  * xilinx_vdma_complete_descriptor - Mark the active descriptor as complete
  * @chan : xilinx DMA channel
+ * @timestamp: Time of the frame count interrupt
  *
  * CONTEXT: hardirq
  */
-static void xilinx_vdma_complete_descriptor(struct xilinx_vdma_chan *chan)
+static void xilinx_vdma_complete_descriptor(struct xilinx_vdma_chan *chan,
+					    ktime_t timestamp)
 {
 	struct xilinx_vdma_tx_descriptor *desc;
 	unsigned long flags;
 
 	spin_lock_irqsave(&chan->lock, flags);
 
+	chan->frames++;
+
 	desc = chan->active_desc;
 	if (!desc) {
 		dev_dbg(chan->dev, "no running descriptors\n");
+		chan->dropped++;
 		goto out_unlock;
 	}
 
+	desc->frame.timestamp = timestamp;
+	desc->frame.sequence = chan->frames;
+	desc->frame.dropped = chan->dropped;
+
 	dma_cookie_complete(&desc->async_tx);
 	list_add_tail(&desc->node, &chan->done_list);
 
@@ -828,6 +972,7 @@ static int xilinx_vdma_chan_reset(struct xilinx_vdma_chan *chan)
 static irqreturn_t xilinx_vdma_irq_handler(int irq, void *data)
 {
 	struct xilinx_vdma_chan *chan = data;
+	ktime_t now = ktime_get();
 	u32 status;
 
 	/* Read the status and ack the interrupts. */
@@ -870,7 +1015,7 @@ static irqreturn_t xilinx_vdma_irq_handler(int irq, void *data)
 	}
 
 	if (status & XILINX_VDMA_DMASR_FRM_CNT_IRQ) {
-		xilinx_vdma_complete_descriptor(chan);
+		xilinx_vdma_complete_descriptor(chan, now);
 		xilinx_vdma_start_transfer(chan);
 	}
 
@@ -997,17 +1142,61 @@ error:
 	return NULL;
 }
 
+/**
+ * xilinx_vdma_genlock_unpair - Stop a genlock slave from following its master
+ * @master: Driver specific VDMA channel of the genlock master
+ *
+ * The slave is halted and goes back to its own transfers, the master parks
+ * again.
+ */
+static void xilinx_vdma_genlock_unpair(struct xilinx_vdma_chan *master)
+{
+	struct xilinx_vdma_chan *slave = master->genlock_slave;
+	unsigned long flags;
+
+	if (!slave)
+		return;
+
+	spin_lock_irqsave(&master->lock, flags);
+
+	xilinx_vdma_halt(slave);
+	vdma_ctrl_clr(slave, XILINX_VDMA_REG_DMACR,
+		      XILINX_VDMA_DMACR_GENLOCK_EN |
+		      XILINX_VDMA_DMACR_MASTER_MASK |
+		      XILINX_VDMA_DMACR_CIRC_EN);
+
+	vdma_ctrl_clr(master, XILINX_VDMA_REG_DMACR, XILINX_VDMA_DMACR_CIRC_EN);
+
+	master->genlock_slave = NULL;
+	slave->genlock_master = NULL;
+
+	spin_unlock_irqrestore(&master->lock, flags);
+
+	xilinx_vdma_start_transfer(slave);
+}
+
 /**
  * xilinx_vdma_terminate_all - Halt the channel and free descriptors
  * @chan: Driver specific VDMA Channel pointer
  */
 static void xilinx_vdma_terminate_all(struct xilinx_vdma_chan *chan)
 {
+	/* Break a genlock pairing, whichever side this channel is on */
+	if (chan->genlock_master)
+		xilinx_vdma_genlock_unpair(chan->genlock_master);
+	else
+		xilinx_vdma_genlock_unpair(chan);
+
 	/* Halt the DMA engine */
 	xilinx_vdma_halt(chan);
 
 	/* Remove and free all of the descriptors in the lists */
 	xilinx_vdma_free_descriptors(chan);
+
+	chan->frm_loaded = 0;
+	chan->frm_store = 0;
+	chan->frames = 0;
+	chan->dropped = 0;
 }
 
 /**
@@ -1017,6 +1206,7 @@ static void xilinx_vdma_terminate_all(struct xilinx_vdma_chan *chan)
  * . configure interrupt coalescing and inter-packet delay threshold
  * . start/stop parking
  * . enable genlock
+ * . park flip mode, see xilinx_vdma_channel_flip()
  *
  * @dchan: DMA channel
  * @cfg: VDMA device configuration pointer
@@ -1032,6 +1222,10 @@ int xilinx_vdma_channel_set_config(struct dma_chan *dchan,
 	if (cfg->reset)
 		return xilinx_vdma_chan_reset(chan);
 
+	/* The frame stores are only addressable in direct register mode */
+	if (cfg->park_flip && chan->has_sg)
+		return -EINVAL;
+
 	dmacr = vdma_ctrl_read(chan, XILINX_VDMA_REG_DMACR);
 
 	chan->config.frm_dly = cfg->frm_dly;
@@ -1052,6 +1246,18 @@ int xilinx_vdma_channel_set_config(struct dma_chan *dchan,
 	else
 		chan->config.park_frm = -1;
 
+	if (cfg->park_flip) {
+		if (!chan->config.park_flip)
+			chan->frm_store = 0;
+
+		chan->config.park = 1;
+		if (cfg->park_frm < 0 || cfg->park_frm >= chan->num_frms)
+			chan->config.park_frm = 0;
+		else
+			chan->config.park_frm = cfg->park_frm;
+	}
+	chan->config.park_flip = cfg->park_flip;
+
 	chan->config.coalesc = cfg->coalesc;
 	chan->config.delay = cfg->delay;
 
@@ -1075,6 +1281,172 @@ int xilinx_vdma_channel_set_config(struct dma_chan *dchan,
 }
 EXPORT_SYMBOL(xilinx_vdma_channel_set_config);
 
+/**
+ * xilinx_vdma_channel_flip - Switch the channel to another frame store
+ * @dchan: DMA channel
+ * @frm: Frame store to park on
+ *
+ * In park flip mode the frames submitted to the channel stay loaded in the
+ * frame stores, in submission order. Flipping to one of them only rewrites
+ * the park pointer, the hardware switches at the next frame boundary.
+ *
+ * Return: '0' on success and -EINVAL if the channel is not in park flip
+ * mode or the frame store does not exist
+ */
+int xilinx_vdma_channel_flip(struct dma_chan *dchan, int frm)
+{
+	struct xilinx_vdma_chan *chan = to_xilinx_chan(dchan);
+	unsigned long flags;
+
+	if (!chan->config.park_flip || frm < 0 || frm >= chan->num_frms)
+		return -EINVAL;
+
+	spin_lock_irqsave(&chan->lock, flags);
+	xilinx_vdma_set_park(chan, frm);
+	chan->config.park_frm = frm;
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(xilinx_vdma_channel_flip);
+
+/**
+ * xilinx_vdma_channel_genlock_pair - Make a channel read the frames of another
+ * @dmaster: DMA channel writing the frames (S2MM)
+ * @dslave: DMA channel reading the frames (MM2S) of the same VDMA core
+ *
+ * The master must run in park flip mode with all of its frame stores loaded.
+ * It then cycles through them, and the slave reads the same frame stores
+ * through internal genlock one frame behind it, without any CPU involvement.
+ * Frames loaded into the master later on are loaded into the slave as well.
+ * The slave takes the frame geometry of the master at pairing time, and its
+ * own transfers are held back until the channels are unpaired.
+ *
+ * With internal genlock the slave follows the other channel of the core, the
+ * master number is left at 0.
+ *
+ * Return: '0' on success, -EINVAL if the channels can't be paired, -EBUSY if
+ * either of them is paired already and -EIO if the slave fails to start
+ */
+int xilinx_vdma_channel_genlock_pair(struct dma_chan *dmaster,
+				     struct dma_chan *dslave)
+{
+	struct xilinx_vdma_chan *master = to_xilinx_chan(dmaster);
+	struct xilinx_vdma_chan *slave = to_xilinx_chan(dslave);
+	unsigned long flags;
+	u32 frms, reg;
+	int err = 0;
+	int i;
+
+	if (master->xdev != slave->xdev ||
+	    master->direction != DMA_DEV_TO_MEM ||
+	    slave->direction != DMA_MEM_TO_DEV ||
+	    !master->genlock || !slave->genlock || slave->has_sg ||
+	    master->num_frms < 2)
+		return -EINVAL;
+
+	if (master->genlock_master || master->genlock_slave ||
+	    slave->genlock_master || slave->genlock_slave)
+		return -EBUSY;
+
+	frms = GENMASK(master->num_frms - 1, 0);
+
+	spin_lock_irqsave(&master->lock, flags);
+
+	if (!master->config.park_flip || (master->frm_loaded & frms) != frms ||
+	    !xilinx_vdma_is_running(master)) {
+		err = -EINVAL;
+		goto out_unlock;
+	}
+
+	xilinx_vdma_halt(slave);
+
+	for (i = 0; i < master->num_frms; i++)
+		vdma_desc_write(slave, XILINX_VDMA_REG_START_ADDRESS(i),
+				master->frm_addr[i]);
+
+	reg = vdma_ctrl_read(slave, XILINX_VDMA_REG_DMACR);
+	reg &= ~XILINX_VDMA_DMACR_MASTER_MASK;
+	reg |= XILINX_VDMA_DMACR_GENLOCK_EN | XILINX_VDMA_DMACR_CIRC_EN;
+	vdma_ctrl_write(slave, XILINX_VDMA_REG_DMACR, reg);
+
+	xilinx_vdma_start(slave);
+	if (slave->err) {
+		err = -EIO;
+		goto out_unlock;
+	}
+
+	/* Trail the master by one frame, VSIZE write starts the transfers */
+	reg = master->frm_hw.stride & ~XILINX_VDMA_FRMDLY_STRIDE_FRMDLY_MASK;
+	reg |= 1 << XILINX_VDMA_FRMDLY_STRIDE_FRMDLY_SHIFT;
+	vdma_desc_write(slave, XILINX_VDMA_REG_HSIZE, master->frm_hw.hsize);
+	vdma_desc_write(slave, XILINX_VDMA_REG_FRMDLY_STRIDE, reg);
+	vdma_desc_write(slave, XILINX_VDMA_REG_VSIZE, master->frm_hw.vsize);
+
+	/* Leave the park frame and cycle through the frame stores */
+	vdma_ctrl_set(master, XILINX_VDMA_REG_DMACR, XILINX_VDMA_DMACR_CIRC_EN);
+
+	master->genlock_slave = slave;
+	slave->genlock_master = master;
+
+out_unlock:
+	spin_unlock_irqrestore(&master->lock, flags);
+	return err;
+}
+EXPORT_SYMBOL(xilinx_vdma_channel_genlock_pair);
+
+/**
+ * xilinx_vdma_channel_genlock_unpair - Undo xilinx_vdma_channel_genlock_pair()
+ * @dmaster: DMA channel of the genlock master
+ *
+ * The slave is halted and restarts with its own pending transfers, if any.
+ * The master parks again on its park frame. Terminating either channel
+ * unpairs them as well.
+ */
+void xilinx_vdma_channel_genlock_unpair(struct dma_chan *dmaster)
+{
+	xilinx_vdma_genlock_unpair(to_xilinx_chan(dmaster));
+}
+EXPORT_SYMBOL(xilinx_vdma_channel_genlock_unpair);
+
+/**
+ * xilinx_vdma_channel_frame_ptr - Get the frame store in use by the hardware
+ * @dchan: DMA channel
+ *
+ * This tracks the frame stores of a genlock pair or a circular channel, e.g.
+ * to find the most recently completed frame of a capture channel.
+ *
+ * Return: Frame store the channel is currently transferring
+ */
+int xilinx_vdma_channel_frame_ptr(struct dma_chan *dchan)
+{
+	struct xilinx_vdma_chan *chan = to_xilinx_chan(dchan);
+	u32 reg = vdma_read(chan, XILINX_VDMA_REG_PARK_PTR);
+
+	if (chan->direction == DMA_MEM_TO_DEV)
+		return (reg & XILINX_VDMA_PARK_PTR_RD_FRMSTORE_MASK) >>
+			XILINX_VDMA_PARK_PTR_RD_FRMSTORE_SHIFT;
+
+	return (reg & XILINX_VDMA_PARK_PTR_WR_FRMSTORE_MASK) >>
+		XILINX_VDMA_PARK_PTR_WR_FRMSTORE_SHIFT;
+}
+EXPORT_SYMBOL(xilinx_vdma_channel_frame_ptr);
+
+/**
+ * xilinx_vdma_tx_frame_info - Get the frame information of a transaction
+ * @tx: Async transaction descriptor of a VDMA channel
+ * @info: Frame information
+ *
+ * The descriptor is freed right after its callback returns, this must thus
+ * only be called from the completion callback of @tx.
+ */
+void xilinx_vdma_tx_frame_info(struct dma_async_tx_descriptor *tx,
+			       struct xilinx_vdma_frame_info *info)
+{
+	*info = to_vdma_tx_descriptor(tx)->frame;
+}
+EXPORT_SYMBOL(xilinx_vdma_tx_frame_info);
+
 /**
  * xilinx_vdma_device_control - Configure DMA channel of the device
  * @dchan: DMA Channel pointer
@@ -1096,6 +1468,26 @@ static int xilinx_vdma_device_control(struct dma_chan *dchan,
 	return 0;
 }
 
+/**
+ * xilinx_vdma_device_slave_caps - Slave channel capabilities
+ * @dchan: DMA Channel pointer
+ * @caps: Slave capabilities to fill in
+ *
+ * Return: '0' always
+ */
+static int xilinx_vdma_device_slave_caps(struct dma_chan *dchan,
+					 struct dma_slave_caps *caps)
+{
+	struct xilinx_vdma_chan *chan = to_xilinx_chan(dchan);
+
+	caps->directions = BIT(chan->direction);
+	caps->cmd_pause = false;
+	caps->cmd_terminate = true;
+	caps->residue_granularity = DMA_RESIDUE_GRANULARITY_DESCRIPTOR;
+
+	return 0;
+}
+
 /* -----------------------------------------------------------------------------
  * Probe and remove
  */
@@ -1301,6 +1693,7 @@ static int xilinx_vdma_probe(struct platform_device *pdev)
 	xdev->common.device_prep_interleaved_dma =
 				xilinx_vdma_dma_prep_interleaved;
 	xdev->common.device_control = xilinx_vdma_device_control;
+	xdev->common.device_slave_caps = xilinx_vdma_device_slave_caps;
 	xdev->common.device_tx_status = xilinx_vdma_tx_status;
 	xdev->common.device_issue_pending = xilinx_vdma_issue_pending;
 
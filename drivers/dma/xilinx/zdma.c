@@ -9,6 +9,7 @@
  * (at your option) any later version.
  */
 
+#include <linux/amba/xilinx_dma.h>
 #include <linux/bitops.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmaengine.h>
@@ -116,6 +117,10 @@
 /* Max transfer size per descriptor */
 #define ZDMA_MAX_TRANS_LEN	0x40000000
 
+/* Striped memcpy: channels used at most and bytes per channel at least */
+#define ZDMA_MAX_STRIPES	8
+#define ZDMA_STRIPE_MIN_LEN	0x10000
+
 /* Reset values for data attributes */
 #define ARCACHE_RST_VAL		0x2
 #define ARLEN_RST_VAL		0xF
@@ -178,6 +183,7 @@ struct zdma_desc_sw {
  * @pending_list: Descriptors waiting
  * @active_desc: Active descriptor
  * @done_list: Complete descriptors
+ * @unacked_list: Completed descriptors the client has not acked yet
  * @common: DMA common channel
  * @desc_pool_v: Statically allocated descriptor base
  * @desc_pool_p: Physical allocated descriptor base
@@ -208,6 +214,7 @@ struct zdma_desc_sw {
  * @dst_axi_qos: Dest data axi qos attribute
  * @src_burst_len: Source burst length
  * @dst_burst_len: Dest burst length
+ * @stripe_node: Node in the list of all channels, for striped copies
  */
 struct zdma_chan {
 	struct zdma_device *xdev;
@@ -216,6 +223,7 @@ struct zdma_chan {
 	struct list_head pending_list;
 	struct zdma_desc_sw *active_desc;
 	struct list_head done_list;
+	struct list_head unacked_list;
 	struct dma_chan common;
 	void *desc_pool_v;
 	dma_addr_t desc_pool_p;
@@ -246,6 +254,19 @@ struct zdma_chan {
 	u32 dst_axi_qos;
 	u32 src_burst_len;
 	u32 dst_burst_len;
+	struct list_head stripe_node;
+};
+
+/**
+ * struct zdma_stripe - Striped memcpy completion tracking
+ * @pending: Stripes not completed yet, plus one while they are submitted
+ * @callback: Client callback, run when all stripes are done
+ * @callback_param: Parameter of the client callback
+ */
+struct zdma_stripe {
+	atomic_t pending;
+	dma_async_tx_callback callback;
+	void *callback_param;
 };
 
 /**
@@ -260,6 +281,10 @@ struct zdma_device {
 	struct zdma_chan *chan;
 };
 
+/* All channels, each of them is a device of its own */
+static LIST_HEAD(zdma_chan_list);
+static DEFINE_SPINLOCK(zdma_chan_list_lock);
+
 /**
  * zdma_update_desc_to_ctrlr - Updates descriptor to the controller
  * @chan: ZDMA channel pointer
@@ -444,7 +469,8 @@ static struct zdma_desc_sw *zdma_alloc_tx_descriptor(struct zdma_chan *chan)
 {
 	struct zdma_desc_sw *desc;
 
-	desc = kzalloc(sizeof(*desc), GFP_KERNEL);
+	/* prep callbacks can be called from atomic context, e.g. by async_tx */
+	desc = kzalloc(sizeof(*desc), GFP_NOWAIT);
 	if (!desc)
 		return NULL;
 
@@ -502,6 +528,7 @@ static void zdma_free_descriptor(struct zdma_chan *chan,
 		return;
 
 	chan->desc_free_cnt += sdesc->cnt;
+	sdesc->cnt = 0;
 }
 
 /**
@@ -513,8 +540,11 @@ static void zdma_free_desc_list(struct zdma_chan *chan, struct list_head *list)
 {
 	struct zdma_desc_sw *desc, *next;
 
-	list_for_each_entry_safe(desc, next, list, node)
+	list_for_each_entry_safe(desc, next, list, node) {
+		list_del(&desc->node);
 		zdma_free_descriptor(chan, desc);
+		kfree(desc);
+	}
 }
 
 /**
@@ -624,25 +654,42 @@ void zdma_start_transfer(struct zdma_chan *chan)
 /**
  * zdma_chan_desc_cleanup - Cleanup the completed descriptors
  * @chan: ZDMA channel
+ *
+ * Called with the channel lock held. The lock is dropped around the
+ * callbacks, as they and the dependent transactions that are run here may
+ * submit new descriptors to the channel. Descriptors are only freed once
+ * the client has acked them, async_tx still looks at the ones it has not.
  */
 static void zdma_chan_desc_cleanup(struct zdma_chan *chan)
 {
 	struct zdma_desc_sw *desc, *next;
+	LIST_HEAD(done);
+
+	list_splice_tail_init(&chan->done_list, &done);
+	list_for_each_entry(desc, &done, node)
+		zdma_free_descriptor(chan, desc);
 
-	list_for_each_entry_safe(desc, next, &chan->done_list, node) {
+	spin_unlock(&chan->lock);
+	list_for_each_entry(desc, &done, node) {
 		dma_async_tx_callback callback;
 		void *callback_param;
 
-		list_del(&desc->node);
+		dma_descriptor_unmap(&desc->async_tx);
 
 		callback = desc->async_tx.callback;
 		callback_param = desc->async_tx.callback_param;
 		if (callback)
 			callback(callback_param);
 
-		/* Run any dependencies, then free the descriptor */
 		dma_run_dependencies(&desc->async_tx);
-		zdma_free_descriptor(chan, desc);
+	}
+	spin_lock(&chan->lock);
+
+	list_splice_tail_init(&done, &chan->unacked_list);
+	list_for_each_entry_safe(desc, next, &chan->unacked_list, node) {
+		if (!async_tx_test_ack(&desc->async_tx))
+			continue;
+		list_del(&desc->node);
 		kfree(desc);
 	}
 }
@@ -691,6 +738,7 @@ static void zdma_free_chan_resources(struct dma_chan *dchan)
 
 	zdma_free_desc_list(chan, &chan->pending_list);
 	zdma_free_desc_list(chan, &chan->done_list);
+	zdma_free_desc_list(chan, &chan->unacked_list);
 	kfree(chan->active_desc);
 	chan->active_desc = NULL;
 
@@ -734,6 +782,7 @@ static void zdma_reset(struct zdma_chan *chan)
 
 	zdma_free_desc_list(chan, &chan->pending_list);
 	zdma_free_desc_list(chan, &chan->done_list);
+	zdma_free_desc_list(chan, &chan->unacked_list);
 	kfree(chan->active_desc);
 	chan->active_desc = NULL;
 	zdma_init(chan);
@@ -876,8 +925,12 @@ static struct dma_async_tx_descriptor *zdma_prep_memcpy(struct dma_chan *dchan,
 	spin_unlock_irqrestore(&chan->lock, irqflags);
 
 	new = zdma_alloc_tx_descriptor(chan);
-	if (!new)
+	if (!new) {
+		spin_lock_irqsave(&chan->lock, irqflags);
+		chan->desc_free_cnt += desc_cnt;
+		spin_unlock_irqrestore(&chan->lock, irqflags);
 		return NULL;
+	}
 
 	do {
 		/* Allocate and populate the descriptor */
@@ -907,6 +960,142 @@ static struct dma_async_tx_descriptor *zdma_prep_memcpy(struct dma_chan *dchan,
 	return &new->async_tx;
 }
 
+/**
+ * zdma_stripe_callback - Completion of one stripe of a striped memcpy
+ * @data: Striped memcpy tracking structure
+ */
+static void zdma_stripe_callback(void *data)
+{
+	struct zdma_stripe *stripe = data;
+
+	if (!atomic_dec_and_test(&stripe->pending))
+		return;
+
+	if (stripe->callback)
+		stripe->callback(stripe->callback_param);
+
+	kfree(stripe);
+}
+
+/**
+ * zdma_stripe_usable - Check whether a channel can take stripes
+ * @anchor: ZDMA channel of the client
+ * @chan: ZDMA channel to check
+ *
+ * Other than the client's own channel, only public channels that have their
+ * resources allocated, i.e. that are in use by dmaengine clients such as
+ * async_tx, are used. Channels owned privately by a client are left alone.
+ * GDMA and ADMA channels are never mixed.
+ *
+ * Return: true if the channel can be used
+ */
+static bool zdma_stripe_usable(struct zdma_chan *anchor, struct zdma_chan *chan)
+{
+	return chan->bus_width == anchor->bus_width && !chan->err &&
+	       chan->common.client_count &&
+	       !dma_has_cap(DMA_PRIVATE, chan->xdev->common.cap_mask);
+}
+
+/**
+ * zdma_memcpy_striped - Split a memcpy over several channels
+ * @dchan: DMA channel of the client
+ * @dma_dst: Destination buffer address
+ * @dma_src: Source buffer address
+ * @len: Transfer length
+ * @callback: Called once all the stripes are done, may be NULL
+ * @callback_param: Parameter of @callback
+ *
+ * Every channel moves at least ZDMA_STRIPE_MIN_LEN bytes, smaller copies
+ * stay on @dchan. The other channels are taken in order after @dchan, so
+ * that clients on different CPUs, which dmaengine gives different channels,
+ * start their stripes on different channels too. The buffers must be
+ * mapped for @dchan, the ZDMA channels share their DMA address space.
+ *
+ * A channel that can't take its stripe, e.g. because it has no free
+ * descriptors, is skipped and the following channels take more. The
+ * transfers are issued right away.
+ *
+ * Return: The number of bytes queued, which is less than @len if the last
+ * channel failed too, @callback then runs once those are done. -EBUSY if
+ * nothing could be queued and -ENOMEM on allocation failure.
+ */
+ssize_t zdma_memcpy_striped(struct dma_chan *dchan, dma_addr_t dma_dst,
+			    dma_addr_t dma_src, size_t len,
+			    dma_async_tx_callback callback,
+			    void *callback_param)
+{
+	struct zdma_chan *chans[ZDMA_MAX_STRIPES];
+	struct zdma_chan *anchor = to_chan(dchan);
+	struct zdma_chan *chan = anchor;
+	struct dma_async_tx_descriptor *tx;
+	struct zdma_stripe *stripe;
+	unsigned int nr_chans = 1, max_chans, i;
+	unsigned long flags;
+	size_t copy, done = 0;
+
+	max_chans = clamp_t(size_t, len / ZDMA_STRIPE_MIN_LEN, 1,
+			    ZDMA_MAX_STRIPES);
+	chans[0] = anchor;
+
+	spin_lock_irqsave(&zdma_chan_list_lock, flags);
+	list_for_each_entry_continue(chan, &zdma_chan_list, stripe_node) {
+		if (nr_chans == max_chans)
+			break;
+		if (zdma_stripe_usable(anchor, chan))
+			chans[nr_chans++] = chan;
+	}
+	list_for_each_entry(chan, &zdma_chan_list, stripe_node) {
+		if (chan == anchor || nr_chans == max_chans)
+			break;
+		if (zdma_stripe_usable(anchor, chan))
+			chans[nr_chans++] = chan;
+	}
+	spin_unlock_irqrestore(&zdma_chan_list_lock, flags);
+
+	stripe = kmalloc(sizeof(*stripe), GFP_NOWAIT);
+	if (!stripe)
+		return -ENOMEM;
+
+	atomic_set(&stripe->pending, 1);
+	stripe->callback = callback;
+	stripe->callback_param = callback_param;
+
+	for (i = 0; i < nr_chans && done < len; i++) {
+		/* Spread what is left, skipped channels leave more */
+		copy = len - done;
+		if (i < nr_chans - 1)
+			copy = min_t(size_t, copy,
+				     ALIGN(DIV_ROUND_UP(copy, nr_chans - i),
+					   L1_CACHE_BYTES));
+
+		tx = zdma_prep_memcpy(&chans[i]->common, dma_dst + done,
+				      dma_src + done, copy,
+				      DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
+		if (!tx)
+			continue;
+
+		tx->callback = zdma_stripe_callback;
+		tx->callback_param = stripe;
+		atomic_inc(&stripe->pending);
+		dmaengine_submit(tx);
+		done += copy;
+	}
+
+	if (!done) {
+		kfree(stripe);
+		return -EBUSY;
+	}
+
+	for (i = 0; i < nr_chans; i++)
+		zdma_issue_pending(&chans[i]->common);
+
+	/* Drop the submission reference, the stripes may be done already */
+	zdma_stripe_callback(stripe);
+
+	return done;
+}
+EXPORT_SYMBOL(zdma_memcpy_striped);
+
 /**
  * zdma_prep_slave_sg - prepare descriptors for a memory sg transaction
  * @dchan: DMA channel
@@ -948,8 +1137,12 @@ static struct dma_async_tx_descriptor *zdma_prep_sg(struct dma_chan *dchan,
 	spin_unlock_irqrestore(&chan->lock, irqflags);
 
 	new = zdma_alloc_tx_descriptor(chan);
-	if (!new)
+	if (!new) {
+		spin_lock_irqsave(&chan->lock, irqflags);
+		chan->desc_free_cnt += desc_cnt;
+		spin_unlock_irqrestore(&chan->lock, irqflags);
 		return NULL;
+	}
 
 	dst_avail = sg_dma_len(dst_sg);
 	src_avail = sg_dma_len(src_sg);
@@ -1101,6 +1294,7 @@ static int zdma_chan_probe(struct zdma_device *xdev,
 	spin_lock_init(&chan->lock);
 	INIT_LIST_HEAD(&chan->pending_list);
 	INIT_LIST_HEAD(&chan->done_list);
+	INIT_LIST_HEAD(&chan->unacked_list);
 
 	dma_cookie_init(&chan->common);
 	chan->common.device = &xdev->common;
@@ -1183,6 +1377,10 @@ static int zdma_probe(struct platform_device *pdev)
 		goto free_chan_resources;
 	}
 
+	spin_lock_irq(&zdma_chan_list_lock);
+	list_add_tail(&xdev->chan->stripe_node, &zdma_chan_list);
+	spin_unlock_irq(&zdma_chan_list_lock);
+
 	dev_info(&pdev->dev, "ZDMA driver Probe success\n");
 
 	return 0;
@@ -1203,6 +1401,10 @@ static int zdma_remove(struct platform_device *pdev)
 {
 	struct zdma_device *xdev = platform_get_drvdata(pdev);
 
+	spin_lock_irq(&zdma_chan_list_lock);
+	list_del(&xdev->chan->stripe_node);
+	spin_unlock_irq(&zdma_chan_list_lock);
+
 	of_dma_controller_free(pdev->dev.of_node);
 	dma_async_device_unregister(&xdev->common);
 
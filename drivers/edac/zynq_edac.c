@@ -16,6 +16,9 @@
  */
 
 #include <linux/edac.h>
+#include <linux/interrupt.h>
+#include <linux/jiffies.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 
@@ -32,8 +35,14 @@
 
 #define ZYNQ_EDAC_MESSAGE_SIZE	256
 
+/* Number of pages the correctable error rate is tracked for */
+#define ZYNQ_EDAC_NR_CE_PAGES	16
+
 /* Zynq DDR memory controller registers that are relevant to ECC */
 #define ZYNQ_DDRC_CONTROL_REG_OFFSET	0x0 /* Control regsieter */
+#define ZYNQ_DDRC_ADDRMAP_BANK_REG_OFFSET	0x3C /* Bank address map */
+#define ZYNQ_DDRC_ADDRMAP_COL_REG_OFFSET	0x40 /* Column address map */
+#define ZYNQ_DDRC_ADDRMAP_ROW_REG_OFFSET	0x44 /* Row address map */
 #define ZYNQ_DDRC_T_ZQ_REG_OFFSET	0xA4 /* ZQ register */
 
 /* ECC control register */
@@ -60,6 +69,16 @@
 #define ZYNQ_DDRCTL_WDTH_16	1
 #define ZYNQ_DDRCTL_WDTH_32	0
 
+/*
+ * Address map register definitions. Each 4-bit field selects the HIF
+ * address bit of one DRAM address bit as an offset from its own base.
+ */
+#define ZYNQ_DDRC_ADDRMAP_FIELD(reg, n)	(((reg) >> ((n) * 4)) & 0xF)
+#define ZYNQ_DDRC_ADDRMAP_UNUSED	0xF
+#define ZYNQ_DDRC_ADDRMAP_COL_AP	10	/* Auto precharge column bit */
+#define ZYNQ_DDRC_ADDRMAP_ROW_B2_11	2	/* Field shared by row 2 - 11 */
+#define ZYNQ_DDRC_HIF_SHIFT		2	/* HIF addresses 32-bit words */
+
 /* ZQ register bitfield definitions */
 #define ZYNQ_DDRC_T_ZQ_REG_DDRMODE_MASK		0x2
 
@@ -118,18 +137,46 @@ struct zynq_ecc_status {
 	struct ecc_error_info ueinfo;
 };
 
+/**
+ * struct zynq_edac_ce_page - Correctable error rate of a page
+ * @pfn:	Page frame number
+ * @count:	Correctable errors seen since @start
+ * @start:	Time in jiffies of the first error in the current window
+ * @offlined:	Whether the page has been handed out for soft offlining
+ */
+struct zynq_edac_ce_page {
+	unsigned long pfn;
+	unsigned int count;
+	unsigned long start;
+	bool offlined;
+};
+
 /**
  * struct zynq_edac_priv - Zynq DDR memory controller private instance data
  * @baseaddr:		Base address of the DDR controller
  * @ce_count:		Correctable Error count
  * @ue_count:		Uncorrectable Error count
+ * @irq:		ECC error interrupt, negative when polling
+ * @ce_pages:		Correctable error rate of the recently failing pages
  */
 struct zynq_edac_priv {
 	void __iomem *baseaddr;
 	u32 ce_count;
 	u32 ue_count;
+	int irq;
+	struct zynq_edac_ce_page ce_pages[ZYNQ_EDAC_NR_CE_PAGES];
 };
 
+static unsigned int ce_offline_threshold = 8;
+module_param(ce_offline_threshold, uint, 0644);
+MODULE_PARM_DESC(ce_offline_threshold,
+		 "CEs of a page before soft offlining it (0 = off)");
+
+static unsigned int ce_window_sec = 24 * 60 * 60;
+module_param(ce_window_sec, uint, 0644);
+MODULE_PARM_DESC(ce_window_sec,
+		 "Window in seconds the errors of a page are counted in");
+
 /**
  * zynq_edac_geterror_info - Get the current ecc error info
  * @base:	Pointer to the base address of the ddr memory controller
@@ -208,6 +255,139 @@ static int zynq_edac_geterror_info(void __iomem *base,
 	return 1;
 }
 
+/**
+ * zynq_edac_get_phys - Translate a DRAM error location to an address
+ * @base:	Pointer to the base address of the ddr memory controller
+ * @pinfo:	Pointer to the ecc error log information
+ *
+ * This routine rebuilds the HIF address of the error from the row, bank
+ * and column using the controller address map. In half bus width mode
+ * every HIF word spans two columns, which moves the column bits up by one.
+ *
+ * Return: the physical address of the error.
+ */
+static phys_addr_t zynq_edac_get_phys(void __iomem *base,
+			struct ecc_error_info *pinfo)
+{
+	u32 bankmap, colmap, rowmap, field, hif = 0;
+	unsigned int half, colbit;
+	int i;
+
+	bankmap = readl(base + ZYNQ_DDRC_ADDRMAP_BANK_REG_OFFSET);
+	colmap = readl(base + ZYNQ_DDRC_ADDRMAP_COL_REG_OFFSET);
+	rowmap = readl(base + ZYNQ_DDRC_ADDRMAP_ROW_REG_OFFSET);
+	half = ((readl(base + ZYNQ_DDRC_CONTROL_REG_OFFSET) &
+		 ZYNQ_DDRC_CTRLREG_BUSWIDTH_MASK) >>
+		ZYNQ_DDRC_CTRLREG_BUSWIDTH_SHIFT) == ZYNQ_DDRCTL_WDTH_16;
+
+	/* Bank bits 0 - 2 have an internal base of 5 - 7 */
+	for (i = 0; i < 3; i++) {
+		field = ZYNQ_DDRC_ADDRMAP_FIELD(bankmap, i);
+		if (field != ZYNQ_DDRC_ADDRMAP_UNUSED && (pinfo->bank & BIT(i)))
+			hif |= BIT(field + 5 + i);
+	}
+
+	/* Row bits 0 - 15 have an internal base of 9 - 24 */
+	for (i = 0; i < 16; i++) {
+		if (i < 2)
+			field = ZYNQ_DDRC_ADDRMAP_FIELD(rowmap, i);
+		else if (i < 12)
+			field = ZYNQ_DDRC_ADDRMAP_FIELD(rowmap,
+						ZYNQ_DDRC_ADDRMAP_ROW_B2_11);
+		else
+			field = ZYNQ_DDRC_ADDRMAP_FIELD(rowmap, i - 9);
+		if (i >= 12 && field == ZYNQ_DDRC_ADDRMAP_UNUSED)
+			continue;
+		if (pinfo->row & BIT(i))
+			hif |= BIT(field + 9 + i);
+	}
+
+	/*
+	 * The first two column bits are fixed to HIF bits 0 and 1. Fields
+	 * 2 - 11 have an internal base of their own number, with fields 5
+	 * and 6 living in the bank map, and skip the auto precharge bit.
+	 */
+	for (i = 0; i < 12; i++) {
+		if (i < 2)
+			field = 0;
+		else if (i < 5)
+			field = ZYNQ_DDRC_ADDRMAP_FIELD(colmap, i - 2);
+		else if (i < 7)
+			field = ZYNQ_DDRC_ADDRMAP_FIELD(bankmap, i - 2);
+		else
+			field = ZYNQ_DDRC_ADDRMAP_FIELD(colmap, i - 4);
+		if (i >= 7 && field == ZYNQ_DDRC_ADDRMAP_UNUSED)
+			continue;
+
+		colbit = i + half;
+		if (colbit >= ZYNQ_DDRC_ADDRMAP_COL_AP)
+			colbit++;
+		if (pinfo->col & BIT(colbit))
+			hif |= BIT(field + i);
+	}
+
+	return (phys_addr_t)hif << ZYNQ_DDRC_HIF_SHIFT;
+}
+
+/**
+ * zynq_edac_track_ce - Track the correctable error rate of a page
+ * @mci:	Pointer to the edac memory controller instance
+ * @pfn:	Page frame number of the error
+ *
+ * This routine counts the correctable errors of the most recently failing
+ * pages and soft offlines a page once it has seen ce_offline_threshold
+ * errors within ce_window_sec, before the weak cells turn into an
+ * uncorrectable error.
+ */
+static void zynq_edac_track_ce(struct mem_ctl_info *mci, unsigned long pfn)
+{
+	struct zynq_edac_priv *priv = mci->pvt_info;
+	struct zynq_edac_ce_page *page = NULL, *entry;
+	unsigned long window = ce_window_sec * HZ;
+	int i;
+
+	if (!ce_offline_threshold || !pfn_valid(pfn))
+		return;
+
+	/* Use the entry of the page, or else replace the oldest one */
+	for (i = 0; i < ZYNQ_EDAC_NR_CE_PAGES; i++) {
+		entry = &priv->ce_pages[i];
+		if (entry->count && entry->pfn == pfn) {
+			page = entry;
+			break;
+		}
+		if (!page || !entry->count ||
+		    (page->count && time_before(entry->start, page->start)))
+			page = entry;
+	}
+
+	if (!page->count || page->pfn != pfn) {
+		page->pfn = pfn;
+		page->count = 0;
+		page->offlined = false;
+	}
+
+	if (!page->count || time_after(jiffies, page->start + window)) {
+		page->start = jiffies;
+		page->count = 0;
+	}
+
+	if (++page->count < ce_offline_threshold || page->offlined)
+		return;
+
+	page->offlined = true;
+	if (IS_ENABLED(CONFIG_MEMORY_FAILURE)) {
+		edac_mc_printk(mci, KERN_WARNING,
+			       "soft offlining page 0x%lx after %u CEs\n",
+			       pfn, page->count);
+		memory_failure_queue(pfn, 0, MF_SOFT_OFFLINE);
+	} else {
+		edac_mc_printk(mci, KERN_WARNING,
+			       "page 0x%lx had %u CEs and should be retired\n",
+			       pfn, page->count);
+	}
+}
+
 /**
  * zynq_edac_generate_message - Generate interpreted ECC status message
  * @mci:	Pointer to the edac memory controller instance
@@ -247,29 +427,38 @@ static void zynq_edac_generate_message(const struct mem_ctl_info *mci,
 static void zynq_edac_handle_error(struct mem_ctl_info *mci,
 			struct zynq_ecc_status *perrstatus)
 {
+	struct zynq_edac_priv *priv = mci->pvt_info;
 	char message[ZYNQ_EDAC_MESSAGE_SIZE];
+	unsigned long pfn, offset;
+	phys_addr_t addr;
 
 	zynq_edac_generate_message(mci, perrstatus, &message[0],
 				   ZYNQ_EDAC_MESSAGE_SIZE);
 
-	if (perrstatus->ce_count)
+	addr = zynq_edac_get_phys(priv->baseaddr, perrstatus->ce_count ?
+				  &perrstatus->ceinfo : &perrstatus->ueinfo);
+	pfn = addr >> PAGE_SHIFT;
+	offset = addr & ~PAGE_MASK;
+
+	if (perrstatus->ce_count) {
 		edac_mc_handle_error(HW_EVENT_ERR_CORRECTED, mci,
-				     perrstatus->ce_count, 0, 0, 0, 0, 0, -1,
-				     &message[0], "");
-	else
+				     perrstatus->ce_count, pfn, offset, 0,
+				     0, 0, -1, &message[0], "");
+		zynq_edac_track_ce(mci, pfn);
+	} else {
 		edac_mc_handle_error(HW_EVENT_ERR_UNCORRECTED, mci,
-				     perrstatus->ue_count, 0, 0, 0, 0, 0, -1,
-				     &message[0], "");
+				     perrstatus->ue_count, pfn, offset, 0,
+				     0, 0, -1, &message[0], "");
+	}
 }
 
 /**
- * zynq_edac_check - Check controller for ECC errors
+ * zynq_edac_process_errors - Check controller for ECC errors and post them
  * @mci:	Pointer to the edac memory controller instance
  *
- * This routine is used to check and post ECC errors and is called by
- * the EDAC polling thread
+ * Return: zero if there was no error otherwise returns 1
  */
-static void zynq_edac_check(struct mem_ctl_info *mci)
+static int zynq_edac_process_errors(struct mem_ctl_info *mci)
 {
 	struct zynq_edac_priv *priv = mci->pvt_info;
 	struct zynq_ecc_status errstatus;
@@ -291,6 +480,36 @@ static void zynq_edac_check(struct mem_ctl_info *mci)
 		edac_dbg(3, "total error count ce %d ue %d\n",
 			 priv->ce_count, priv->ue_count);
 	}
+
+	return status;
+}
+
+/**
+ * zynq_edac_check - Check controller for ECC errors
+ * @mci:	Pointer to the edac memory controller instance
+ *
+ * This routine is used to check and post ECC errors and is called by
+ * the EDAC polling thread when there is no error interrupt
+ */
+static void zynq_edac_check(struct mem_ctl_info *mci)
+{
+	zynq_edac_process_errors(mci);
+}
+
+/**
+ * zynq_edac_intr_handler - ECC error interrupt handler
+ * @irq:	IRQ number
+ * @dev_id:	Pointer to the edac memory controller instance
+ *
+ * Runs threaded, as soft offlining a page has to be able to sleep.
+ *
+ * Return: IRQ_HANDLED if an error was posted, IRQ_NONE otherwise
+ */
+static irqreturn_t zynq_edac_intr_handler(int irq, void *dev_id)
+{
+	struct mem_ctl_info *mci = dev_id;
+
+	return zynq_edac_process_errors(mci) ? IRQ_HANDLED : IRQ_NONE;
 }
 
 /**
@@ -470,9 +689,16 @@ static int zynq_edac_mc_init(struct mem_ctl_info *mci,
 	mci->mod_name = "zynq_edac";
 	mci->mod_ver = "1";
 
-	/* Initialize callbacks */
-	edac_op_state = EDAC_OPSTATE_POLL;
-	mci->edac_check = zynq_edac_check;
+	/*
+	 * Initialize callbacks, the controller is only polled when there is
+	 * no error interrupt
+	 */
+	if (priv->irq >= 0) {
+		edac_op_state = EDAC_OPSTATE_INT;
+	} else {
+		edac_op_state = EDAC_OPSTATE_POLL;
+		mci->edac_check = zynq_edac_check;
+	}
 	mci->ctl_page_to_phys = NULL;
 
 	/*
@@ -538,6 +764,7 @@ static int zynq_edac_mc_probe(struct platform_device *pdev)
 
 	priv = mci->pvt_info;
 	priv->baseaddr = baseaddr;
+	priv->irq = platform_get_irq(pdev, 0);
 	rc = zynq_edac_mc_init(mci, pdev);
 	if (rc) {
 		pr_err("Failed to initialize instance!\n");
@@ -554,6 +781,17 @@ static int zynq_edac_mc_probe(struct platform_device *pdev)
 		goto del_edac_mc;
 	}
 
+	if (priv->irq >= 0) {
+		rc = request_threaded_irq(priv->irq, NULL,
+					  zynq_edac_intr_handler, IRQF_ONESHOT,
+					  dev_name(&pdev->dev), mci);
+		if (rc) {
+			dev_err(&pdev->dev, "failed to request irq %d\n",
+				priv->irq);
+			goto del_edac_mc;
+		}
+	}
+
 	return rc;
 
 del_edac_mc:
@@ -577,7 +815,10 @@ free_edac_mc:
 static int zynq_edac_mc_remove(struct platform_device *pdev)
 {
 	struct mem_ctl_info *mci = platform_get_drvdata(pdev);
+	struct zynq_edac_priv *priv = mci->pvt_info;
 
+	if (priv->irq >= 0)
+		free_irq(priv->irq, mci);
 	edac_mc_del_mc(&pdev->dev);
 	edac_mc_free(mci);
 
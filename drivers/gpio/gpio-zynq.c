@@ -206,6 +206,84 @@ static void zynq_gpio_set_value(struct gpio_chip *chip, unsigned int pin,
 	writel_relaxed(state, gpio->base_addr + reg_offset);
 }
 
+/**
+ * zynq_gpio_get_multiple - Get the state of several pins of the GPIO device
+ * @chip:	gpio_chip instance to be worked on
+ * @mask:	bitmap of the pins to read
+ * @bits:	bitmap the states of the pins are returned in
+ *
+ * This function reads the data register of each bank once instead of once
+ * per pin.
+ *
+ * Return: 0 always
+ */
+static int zynq_gpio_get_multiple(struct gpio_chip *chip, unsigned long *mask,
+				  unsigned long *bits)
+{
+	u32 data[ZYNQ_GPIO_MAX_BANK];
+	unsigned int pin, bank_num, bank_pin_num;
+	unsigned long read = 0;
+	struct zynq_gpio *gpio = container_of(chip, struct zynq_gpio, chip);
+
+	for_each_set_bit(pin, mask, chip->ngpio) {
+		zynq_gpio_get_bank_pin(pin, &bank_num, &bank_pin_num);
+
+		if (!test_and_set_bit(bank_num, &read))
+			data[bank_num] = readl_relaxed(gpio->base_addr +
+					ZYNQ_GPIO_DATA_RO_OFFSET(bank_num));
+
+		if (data[bank_num] & BIT(bank_pin_num))
+			__set_bit(pin, bits);
+		else
+			__clear_bit(pin, bits);
+	}
+
+	return 0;
+}
+
+/**
+ * zynq_gpio_set_multiple - Modify the state of several pins of GPIO device
+ * @chip:	gpio_chip instance to be worked on
+ * @mask:	bitmap of the pins to modify
+ * @bits:	bitmap of the states to set the pins to
+ *
+ * This function gathers the pins per bank and sets up to 16 of them with a
+ * single write to the lower or upper mask/data register of the bank.
+ */
+static void zynq_gpio_set_multiple(struct gpio_chip *chip, unsigned long *mask,
+				   unsigned long *bits)
+{
+	u32 pins[ZYNQ_GPIO_MAX_BANK] = { 0 }, state[ZYNQ_GPIO_MAX_BANK] = { 0 };
+	unsigned int pin, bank_num, bank_pin_num;
+	struct zynq_gpio *gpio = container_of(chip, struct zynq_gpio, chip);
+
+	for_each_set_bit(pin, mask, chip->ngpio) {
+		zynq_gpio_get_bank_pin(pin, &bank_num, &bank_pin_num);
+
+		pins[bank_num] |= BIT(bank_pin_num);
+		if (test_bit(pin, bits))
+			state[bank_num] |= BIT(bank_pin_num);
+	}
+
+	for (bank_num = 0; bank_num < ZYNQ_GPIO_MAX_BANK; bank_num++) {
+		u32 lsw = pins[bank_num] & ~ZYNQ_GPIO_UPPER_MASK;
+		u32 msw = pins[bank_num] >> ZYNQ_GPIO_MID_PIN_NUM;
+
+		/* a set mask bit leaves the pin alone */
+		if (lsw)
+			writel_relaxed((~lsw << ZYNQ_GPIO_MID_PIN_NUM) |
+				       (state[bank_num] & lsw),
+				       gpio->base_addr +
+				       ZYNQ_GPIO_DATA_LSW_OFFSET(bank_num));
+		if (msw)
+			writel_relaxed((~msw << ZYNQ_GPIO_MID_PIN_NUM) |
+				       ((state[bank_num] >>
+					 ZYNQ_GPIO_MID_PIN_NUM) & msw),
+				       gpio->base_addr +
+				       ZYNQ_GPIO_DATA_MSW_OFFSET(bank_num));
+	}
+}
+
 /**
  * zynq_gpio_dir_in - Set the direction of the specified GPIO pin as input
  * @chip:	gpio_chip instance to be worked on
@@ -624,6 +702,8 @@ static int zynq_gpio_probe(struct platform_device *pdev)
 	chip->dev = &pdev->dev;
 	chip->get = zynq_gpio_get_value;
 	chip->set = zynq_gpio_set_value;
+	chip->get_multiple = zynq_gpio_get_multiple;
+	chip->set_multiple = zynq_gpio_set_multiple;
 	chip->request = zynq_gpio_request;
 	chip->free = zynq_gpio_free;
 	chip->direction_input = zynq_gpio_dir_in;
@@ -25,6 +25,9 @@
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/i2c.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
 
 #include <video/videomode.h>
 
@@ -37,6 +40,29 @@
 #include "xilinx_rgb2yuv.h"
 #include "xilinx_vtc.h"
 
+/* flip-to-scanout latency histogram buckets: < 1ms, then powers of 2 in ms */
+#define XILINX_DRM_CRTC_LATENCY_BUCKETS	8
+
+/**
+ * struct xilinx_drm_crtc_stats - Xilinx DRM crtc flip statistics
+ * @vblanks: number of vblanks
+ * @idle: number of vblanks without a flip queued
+ * @flips: number of flips scanned out
+ * @dropped: number of flips replaced before they were scanned out
+ * @missed: number of flips scanned out later than the next vblank
+ * @max_latency_us: worst flip-to-scanout latency in usec
+ * @latency: flip-to-scanout latency histogram
+ */
+struct xilinx_drm_crtc_stats {
+	u64 vblanks;
+	u64 idle;
+	u64 flips;
+	u64 dropped;
+	u64 missed;
+	u32 max_latency_us;
+	u32 latency[XILINX_DRM_CRTC_LATENCY_BUCKETS];
+};
+
 struct xilinx_drm_crtc {
 	struct drm_crtc base;
 	struct xilinx_cresample *cresample;
@@ -48,6 +74,15 @@ struct xilinx_drm_crtc {
 	unsigned int alpha;
 	struct drm_pending_vblank_event *event;
 	struct xilinx_drm_dp_sub *dp_sub;
+
+	/* vblank timestamp and flip statistics, protected by stats_lock */
+	spinlock_t stats_lock;
+	bool vtc_timestamps;
+	ktime_t vblank_time;
+	bool flip_pending;
+	ktime_t flip_time;
+	u32 flip_vblank;
+	struct xilinx_drm_crtc_stats stats;
 };
 
 #define to_xilinx_crtc(x)	container_of(x, struct xilinx_drm_crtc, base)
@@ -328,6 +363,14 @@ static int xilinx_drm_crtc_page_flip(struct drm_crtc *base_crtc,
 
 	base_crtc->primary->fb = fb;
 
+	spin_lock_irqsave(&crtc->stats_lock, flags);
+	if (crtc->flip_pending)
+		crtc->stats.dropped++;
+	crtc->flip_pending = true;
+	crtc->flip_time = ktime_get();
+	crtc->flip_vblank = drm_vblank_count(drm, 0);
+	spin_unlock_irqrestore(&crtc->stats_lock, flags);
+
 	if (event) {
 		event->pipe = 0;
 		drm_vblank_get(drm, 0);
@@ -339,21 +382,166 @@ static int xilinx_drm_crtc_page_flip(struct drm_crtc *base_crtc,
 	return 0;
 }
 
+/* account the vblank and the flip scanned out from it */
+static void xilinx_drm_crtc_account_vblank(struct xilinx_drm_crtc *crtc,
+					   ktime_t now)
+{
+	struct xilinx_drm_crtc_stats *stats = &crtc->stats;
+	unsigned int bucket;
+	u32 latency_us;
+
+	stats->vblanks++;
+
+	if (!crtc->flip_pending) {
+		stats->idle++;
+		return;
+	}
+
+	crtc->flip_pending = false;
+	stats->flips++;
+
+	/* the flip should have been latched by the first vblank after it */
+	if (drm_vblank_count(crtc->base.dev, 0) - crtc->flip_vblank > 1)
+		stats->missed++;
+
+	latency_us = ktime_us_delta(now, crtc->flip_time);
+	stats->max_latency_us = max(stats->max_latency_us, latency_us);
+
+	bucket = fls(latency_us / USEC_PER_MSEC);
+	if (bucket >= XILINX_DRM_CRTC_LATENCY_BUCKETS)
+		bucket = XILINX_DRM_CRTC_LATENCY_BUCKETS - 1;
+	stats->latency[bucket]++;
+}
+
 /* vblank interrupt handler */
 static void xilinx_drm_crtc_vblank_handler(void *data)
 {
 	struct drm_crtc *base_crtc = data;
+	struct xilinx_drm_crtc *crtc;
 	struct drm_device *drm;
+	unsigned long flags;
+	ktime_t now;
 
 	if (!base_crtc)
 		return;
 
+	now = ktime_get();
+
+	crtc = to_xilinx_crtc(base_crtc);
 	drm = base_crtc->dev;
 
+	spin_lock_irqsave(&crtc->stats_lock, flags);
+	crtc->vblank_time = now;
+	spin_unlock_irqrestore(&crtc->stats_lock, flags);
+
 	drm_handle_vblank(drm, 0);
+	/* latch all plane updates of the last frame together */
+	xilinx_drm_plane_manager_vblank(crtc->plane_manager);
+
+	spin_lock_irqsave(&crtc->stats_lock, flags);
+	xilinx_drm_crtc_account_vblank(crtc, now);
+	spin_unlock_irqrestore(&crtc->stats_lock, flags);
+
 	xilinx_drm_crtc_finish_page_flip(base_crtc);
 }
 
+/**
+ * xilinx_drm_crtc_get_scanout_position - Get the current scanout position
+ * @base_crtc: base crtc object
+ * @vpos: returned vertical position, negative in the vblank
+ * @hpos: returned horizontal position
+ * @stime: returned timestamp before the query, or NULL
+ * @etime: returned timestamp after the query, or NULL
+ *
+ * The VTC raises the vblank interrupt when the generator enters the vertical
+ * blanking, after the last active line. The position is derived from the
+ * time elapsed since the last interrupt and the line and pixel durations of
+ * the mode programmed into the VTC.
+ *
+ * Return: DRM_SCANOUTPOS_* flags, or 0 if the position is unknown.
+ */
+int xilinx_drm_crtc_get_scanout_position(struct drm_crtc *base_crtc,
+					 int *vpos, int *hpos,
+					 ktime_t *stime, ktime_t *etime)
+{
+	struct xilinx_drm_crtc *crtc = to_xilinx_crtc(base_crtc);
+	const struct drm_display_mode *mode = &base_crtc->hwmode;
+	unsigned long flags;
+	ktime_t last, now;
+	s64 elapsed;
+	u32 rem;
+	int line;
+	int ret;
+
+	if (!crtc->vtc_timestamps || crtc->dpms != DRM_MODE_DPMS_ON ||
+	    !base_crtc->linedur_ns || !base_crtc->pixeldur_ns)
+		return 0;
+
+	spin_lock_irqsave(&crtc->stats_lock, flags);
+	now = ktime_get();
+	last = crtc->vblank_time;
+	spin_unlock_irqrestore(&crtc->stats_lock, flags);
+
+	if (stime)
+		*stime = now;
+	if (etime)
+		*etime = now;
+
+	/* extrapolating over a stopped vblank interrupt would drift away */
+	elapsed = ktime_to_ns(ktime_sub(now, last));
+	if (!ktime_to_ns(last) || elapsed < 0 ||
+	    elapsed > 4 * (s64)base_crtc->framedur_ns)
+		return 0;
+
+	line = div_u64_rem(elapsed, base_crtc->linedur_ns, &rem);
+	line = (mode->crtc_vdisplay + line) % mode->crtc_vtotal;
+	*hpos = rem / base_crtc->pixeldur_ns;
+
+	ret = DRM_SCANOUTPOS_VALID | DRM_SCANOUTPOS_ACCURATE;
+	if (line >= mode->crtc_vdisplay) {
+		*vpos = line - mode->crtc_vtotal;
+		ret |= DRM_SCANOUTPOS_IN_VBLANK;
+	} else {
+		*vpos = line;
+	}
+
+	return ret;
+}
+
+#ifdef CONFIG_DEBUG_FS
+/**
+ * xilinx_drm_crtc_stats_show - Show the crtc flip statistics
+ * @base_crtc: base crtc object
+ * @m: seq_file to print into
+ *
+ * Flips that stay queued over several vblanks point to the driver or the
+ * DMA, while idle vblanks and dropped flips point to user space.
+ */
+void xilinx_drm_crtc_stats_show(struct drm_crtc *base_crtc, struct seq_file *m)
+{
+	struct xilinx_drm_crtc *crtc = to_xilinx_crtc(base_crtc);
+	struct xilinx_drm_crtc_stats stats;
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&crtc->stats_lock, flags);
+	stats = crtc->stats;
+	spin_unlock_irqrestore(&crtc->stats_lock, flags);
+
+	seq_printf(m, "vblanks:\t%llu\n", stats.vblanks);
+	seq_printf(m, "idle:\t\t%llu\n", stats.idle);
+	seq_printf(m, "flips:\t\t%llu\n", stats.flips);
+	seq_printf(m, "dropped:\t%llu\n", stats.dropped);
+	seq_printf(m, "missed:\t\t%llu\n", stats.missed);
+	seq_printf(m, "max latency:\t%u us\n", stats.max_latency_us);
+	seq_puts(m, "latency:\n");
+	seq_printf(m, "\t< 1 ms:\t%u\n", stats.latency[0]);
+	for (i = 1; i < XILINX_DRM_CRTC_LATENCY_BUCKETS - 1; i++)
+		seq_printf(m, "\t< %u ms:\t%u\n", 1 << i, stats.latency[i]);
+	seq_printf(m, "\t>= %u ms:\t%u\n", 1 << (i - 1), stats.latency[i]);
+}
+#endif
+
 /* enable vblank interrupt */
 void xilinx_drm_crtc_enable_vblank(struct drm_crtc *base_crtc)
 {
@@ -520,6 +708,17 @@ struct drm_crtc *xilinx_drm_crtc_create(struct drm_device *drm)
 		goto err_plane;
 	}
 
+	/* plane updates wait for the vblank if there's a vblank interrupt */
+	if ((crtc->vtc && xilinx_vtc_has_vblank_intr(crtc->vtc)) ||
+	    crtc->dp_sub)
+		xilinx_drm_plane_manager_enable_vblank_sync(
+				crtc->plane_manager);
+
+	/* scanout positions are derived from the vtc vblank interrupt */
+	if (crtc->vtc && xilinx_vtc_has_vblank_intr(crtc->vtc))
+		crtc->vtc_timestamps = true;
+
+	spin_lock_init(&crtc->stats_lock);
 	crtc->dpms = DRM_MODE_DPMS_OFF;
 
 	/* initialize drm crtc */
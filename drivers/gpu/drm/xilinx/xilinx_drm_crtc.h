@@ -18,13 +18,21 @@
 #ifndef _XILINX_DRM_CRTC_H_
 #define _XILINX_DRM_CRTC_H_
 
+#include <linux/ktime.h>
+
 struct drm_device;
 struct drm_crtc;
+struct seq_file;
 
 void xilinx_drm_crtc_enable_vblank(struct drm_crtc *base_crtc);
 void xilinx_drm_crtc_disable_vblank(struct drm_crtc *base_crtc);
 void xilinx_drm_crtc_cancel_page_flip(struct drm_crtc *base_crtc,
 				      struct drm_file *file);
+int xilinx_drm_crtc_get_scanout_position(struct drm_crtc *base_crtc,
+					 int *vpos, int *hpos,
+					 ktime_t *stime, ktime_t *etime);
+void xilinx_drm_crtc_stats_show(struct drm_crtc *base_crtc,
+				struct seq_file *m);
 
 void xilinx_drm_crtc_restore(struct drm_crtc *base_crtc);
 
@@ -18,6 +18,7 @@
 #include <drm/drmP.h>
 #include <drm/drm_crtc_helper.h>
 #include <drm/drm_gem_cma_helper.h>
+#include <drm/xilinx_drm.h>
 
 #include <linux/device.h>
 #include <linux/module.h>
@@ -157,6 +158,32 @@ static void xilinx_drm_disable_vblank(struct drm_device *drm, int crtc)
 	xilinx_drm_crtc_disable_vblank(private->crtc);
 }
 
+/* get the scanout position */
+static int xilinx_drm_get_scanout_position(struct drm_device *drm, int crtc,
+					   unsigned int flags, int *vpos,
+					   int *hpos, ktime_t *stime,
+					   ktime_t *etime)
+{
+	struct xilinx_drm_private *private = drm->dev_private;
+
+	return xilinx_drm_crtc_get_scanout_position(private->crtc, vpos, hpos,
+						    stime, etime);
+}
+
+/* get the vblank timestamp */
+static int xilinx_drm_get_vblank_timestamp(struct drm_device *drm, int crtc,
+					   int *max_error,
+					   struct timeval *vblank_time,
+					   unsigned flags)
+{
+	struct xilinx_drm_private *private = drm->dev_private;
+
+	return drm_calc_vbltimestamp_from_scanoutpos(drm, crtc, max_error,
+						     vblank_time, flags,
+						     private->crtc,
+						     &private->crtc->hwmode);
+}
+
 /* initialize mode config */
 static void xilinx_drm_mode_config_init(struct drm_device *drm)
 {
@@ -240,6 +267,64 @@ unsigned int xilinx_drm_format_depth(uint32_t drm_format)
 	return 0;
 }
 
+/**
+ * xilinx_drm_shadow_init - Initialize a register shadow
+ * @dev: device the memory is allocated for
+ * @shadow: shadow to initialize
+ * @base: base address of the register window
+ * @size: size of the register window in bytes
+ *
+ * Initialize @shadow with the current register values of the window.
+ *
+ * Return: 0 on success, or -ENOMEM.
+ */
+int xilinx_drm_shadow_init(struct device *dev,
+			   struct xilinx_drm_shadow *shadow,
+			   void __iomem *base, unsigned int size)
+{
+	unsigned int i;
+
+	shadow->num_regs = size / 4;
+	shadow->base = base;
+	shadow->regs = devm_kcalloc(dev, shadow->num_regs,
+				    sizeof(*shadow->regs), GFP_KERNEL);
+	shadow->dirty = devm_kcalloc(dev, BITS_TO_LONGS(shadow->num_regs),
+				     sizeof(*shadow->dirty), GFP_KERNEL);
+	if (!shadow->regs || !shadow->dirty)
+		return -ENOMEM;
+
+	for (i = 0; i < shadow->num_regs; i++)
+		shadow->regs[i] = xilinx_drm_readl(base, i * 4);
+
+	return 0;
+}
+
+/**
+ * xilinx_drm_shadow_commit - Write changed registers to the hardware
+ * @shadow: register shadow
+ */
+void xilinx_drm_shadow_commit(struct xilinx_drm_shadow *shadow)
+{
+	unsigned int i;
+
+	for_each_set_bit(i, shadow->dirty, shadow->num_regs)
+		xilinx_drm_writel(shadow->base, i * 4, shadow->regs[i]);
+
+	bitmap_zero(shadow->dirty, shadow->num_regs);
+}
+
+/**
+ * xilinx_drm_shadow_invalidate - Mark all registers as changed
+ * @shadow: register shadow
+ *
+ * Make the next xilinx_drm_shadow_commit() write the whole window, after the
+ * hardware lost its register values, for instance in a reset.
+ */
+void xilinx_drm_shadow_invalidate(struct xilinx_drm_shadow *shadow)
+{
+	bitmap_fill(shadow->dirty, shadow->num_regs);
+}
+
 /* load xilinx drm */
 static int xilinx_drm_load(struct drm_device *drm, unsigned long flags)
 {
@@ -359,12 +444,50 @@ static void xilinx_drm_lastclose(struct drm_device *drm)
 	xilinx_drm_fb_restore_mode(private->fb);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int xilinx_drm_crtc_stats_debugfs_show(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = m->private;
+	struct xilinx_drm_private *private = node->minor->dev->dev_private;
+
+	xilinx_drm_crtc_stats_show(private->crtc, m);
+
+	return 0;
+}
+
+static struct drm_info_list xilinx_drm_debugfs_list[] = {
+	{ "crtc_stats", xilinx_drm_crtc_stats_debugfs_show, 0 },
+};
+
+static int xilinx_drm_debugfs_init(struct drm_minor *minor)
+{
+	return drm_debugfs_create_files(xilinx_drm_debugfs_list,
+					ARRAY_SIZE(xilinx_drm_debugfs_list),
+					minor->debugfs_root, minor);
+}
+
+static void xilinx_drm_debugfs_cleanup(struct drm_minor *minor)
+{
+	drm_debugfs_remove_files(xilinx_drm_debugfs_list,
+				 ARRAY_SIZE(xilinx_drm_debugfs_list), minor);
+}
+#endif
+
+static const struct drm_ioctl_desc xilinx_drm_ioctls[] = {
+	DRM_IOCTL_DEF_DRV(XILINX_GEM_CREATE, xilinx_drm_gem_create_ioctl,
+			  DRM_UNLOCKED | DRM_AUTH),
+	DRM_IOCTL_DEF_DRV(XILINX_GEM_CPU_PREP, xilinx_drm_gem_cpu_prep_ioctl,
+			  DRM_UNLOCKED | DRM_AUTH),
+	DRM_IOCTL_DEF_DRV(XILINX_GEM_CPU_FINI, xilinx_drm_gem_cpu_fini_ioctl,
+			  DRM_UNLOCKED | DRM_AUTH),
+};
+
 static const struct file_operations xilinx_drm_fops = {
 	.owner		= THIS_MODULE,
 	.open		= drm_open,
 	.release	= drm_release,
 	.unlocked_ioctl	= drm_ioctl,
-	.mmap		= drm_gem_cma_mmap,
+	.mmap		= xilinx_drm_gem_mmap,
 	.poll		= drm_poll,
 	.read		= drm_read,
 #ifdef CONFIG_COMPAT
@@ -384,6 +507,8 @@ static struct drm_driver xilinx_drm_driver = {
 	.get_vblank_counter		= drm_vblank_count,
 	.enable_vblank			= xilinx_drm_enable_vblank,
 	.disable_vblank			= xilinx_drm_disable_vblank,
+	.get_scanout_position		= xilinx_drm_get_scanout_position,
+	.get_vblank_timestamp		= xilinx_drm_get_vblank_timestamp,
 
 	.prime_handle_to_fd		= drm_gem_prime_handle_to_fd,
 	.prime_fd_to_handle		= drm_gem_prime_fd_to_handle,
@@ -393,13 +518,20 @@ static struct drm_driver xilinx_drm_driver = {
 	.gem_prime_import_sg_table	= drm_gem_cma_prime_import_sg_table,
 	.gem_prime_vmap			= drm_gem_cma_prime_vmap,
 	.gem_prime_vunmap		= drm_gem_cma_prime_vunmap,
-	.gem_prime_mmap			= drm_gem_cma_prime_mmap,
-	.gem_free_object		= drm_gem_cma_free_object,
+	.gem_prime_mmap			= xilinx_drm_gem_prime_mmap,
+	.gem_free_object		= xilinx_drm_gem_free_object,
 	.gem_vm_ops			= &drm_gem_cma_vm_ops,
 	.dumb_create			= xilinx_drm_gem_cma_dumb_create,
 	.dumb_map_offset		= drm_gem_cma_dumb_map_offset,
 	.dumb_destroy			= drm_gem_dumb_destroy,
 
+#ifdef CONFIG_DEBUG_FS
+	.debugfs_init			= xilinx_drm_debugfs_init,
+	.debugfs_cleanup		= xilinx_drm_debugfs_cleanup,
+#endif
+
+	.ioctls				= xilinx_drm_ioctls,
+	.num_ioctls			= ARRAY_SIZE(xilinx_drm_ioctls),
 	.fops				= &xilinx_drm_fops,
 
 	.name				= DRIVER_NAME,
@@ -441,6 +573,9 @@ static const struct dev_pm_ops xilinx_drm_pm_ops = {
 /* init xilinx drm platform */
 static int xilinx_drm_platform_probe(struct platform_device *pdev)
 {
+	/* bringing the pipeline back up is slow, let it overlap the others */
+	device_enable_async_suspend(&pdev->dev);
+
 	return drm_platform_init(&xilinx_drm_driver, pdev);
 }
 
@@ -56,6 +56,49 @@ static inline void xilinx_drm_set(void __iomem *base, int offset, u32 set)
 	xilinx_drm_writel(base, offset, xilinx_drm_readl(base, offset) | set);
 }
 
+/**
+ * struct xilinx_drm_shadow - Shadow copy of a register window
+ *
+ * @base: base address of the window
+ * @regs: register values as they should be in the hardware
+ * @dirty: registers that differ from the hardware
+ * @num_regs: number of 32 bit registers in the window
+ *
+ * Writes only update @regs, and xilinx_drm_shadow_commit() writes the
+ * changed registers out in one go, typically while the register update of
+ * the IP is disabled. Reads come from @regs and never touch the bus.
+ */
+struct xilinx_drm_shadow {
+	void __iomem *base;
+	u32 *regs;
+	unsigned long *dirty;
+	unsigned int num_regs;
+};
+
+struct device;
+
+int xilinx_drm_shadow_init(struct device *dev,
+			   struct xilinx_drm_shadow *shadow,
+			   void __iomem *base, unsigned int size);
+void xilinx_drm_shadow_commit(struct xilinx_drm_shadow *shadow);
+void xilinx_drm_shadow_invalidate(struct xilinx_drm_shadow *shadow);
+
+static inline u32 xilinx_drm_shadow_readl(struct xilinx_drm_shadow *shadow,
+					  int offset)
+{
+	return shadow->regs[offset / 4];
+}
+
+static inline void xilinx_drm_shadow_writel(struct xilinx_drm_shadow *shadow,
+					    int offset, u32 val)
+{
+	if (shadow->regs[offset / 4] == val)
+		return;
+
+	shadow->regs[offset / 4] = val;
+	__set_bit(offset / 4, shadow->dirty);
+}
+
 struct drm_device;
 
 bool xilinx_drm_check_format(struct drm_device *drm, uint32_t fourcc);
@@ -27,6 +27,7 @@
 
 #include "xilinx_drm_drv.h"
 #include "xilinx_drm_fb.h"
+#include "xilinx_drm_gem.h"
 
 struct xilinx_drm_fb {
 	struct drm_framebuffer		base;
@@ -71,9 +72,81 @@ static int xilinx_drm_fb_create_handle(struct drm_framebuffer *base_fb,
 	return drm_gem_handle_create(file_priv, &fb->obj[0]->base, handle);
 }
 
+/*
+ * Clean the lines of @clip in the plane @i of @base_fb. The lines are
+ * cleaned one by one when the clip is narrow, otherwise the whole span
+ * from the first to the last line is cleaned at once.
+ */
+static void xilinx_drm_fb_flush_clip(struct drm_framebuffer *base_fb,
+				     unsigned int i, struct drm_clip_rect *clip)
+{
+	struct xilinx_drm_fb *fb = to_fb(base_fb);
+	u32 format = base_fb->pixel_format;
+	unsigned int hsub = 1, vsub = 1;
+	unsigned int pitch = base_fb->pitches[i];
+	unsigned int cpp, x1, x2, y1, y2, y;
+	unsigned long offset;
+	size_t width;
+
+	if (i) {
+		hsub = drm_format_horz_chroma_subsampling(format);
+		vsub = drm_format_vert_chroma_subsampling(format);
+	}
+
+	cpp = drm_format_plane_cpp(format, i);
+	x1 = min_t(unsigned int, clip->x1, base_fb->width) / hsub;
+	x2 = DIV_ROUND_UP(min_t(unsigned int, clip->x2, base_fb->width), hsub);
+	y1 = min_t(unsigned int, clip->y1, base_fb->height) / vsub;
+	y2 = DIV_ROUND_UP(min_t(unsigned int, clip->y2, base_fb->height), vsub);
+	if (x1 >= x2 || y1 >= y2)
+		return;
+
+	offset = base_fb->offsets[i] + y1 * pitch + x1 * cpp;
+	width = (x2 - x1) * cpp;
+
+	if (width * 2 >= pitch) {
+		xilinx_drm_gem_sync_for_device(fb->obj[i], offset,
+					       (y2 - y1 - 1) * pitch + width);
+		return;
+	}
+
+	for (y = y1; y < y2; y++, offset += pitch)
+		xilinx_drm_gem_sync_for_device(fb->obj[i], offset, width);
+}
+
+static int xilinx_drm_fb_dirty(struct drm_framebuffer *base_fb,
+			       struct drm_file *file_priv, unsigned flags,
+			       unsigned color, struct drm_clip_rect *clips,
+			       unsigned num_clips)
+{
+	struct xilinx_drm_fb *fb = to_fb(base_fb);
+	struct drm_clip_rect full = {
+		.x2 = base_fb->width,
+		.y2 = base_fb->height,
+	};
+	unsigned int i, j;
+
+	if (!num_clips) {
+		clips = &full;
+		num_clips = 1;
+	}
+
+	/* Only the cached buffers have anything to flush, the rest is WC */
+	for (i = 0; i < 4; i++) {
+		if (!fb->obj[i] || !xilinx_drm_gem_is_cached(fb->obj[i]))
+			continue;
+
+		for (j = 0; j < num_clips; j++)
+			xilinx_drm_fb_flush_clip(base_fb, i, &clips[j]);
+	}
+
+	return 0;
+}
+
 static struct drm_framebuffer_funcs xilinx_drm_fb_funcs = {
 	.destroy	= xilinx_drm_fb_destroy,
 	.create_handle	= xilinx_drm_fb_create_handle,
+	.dirty		= xilinx_drm_fb_dirty,
 };
 
 /**
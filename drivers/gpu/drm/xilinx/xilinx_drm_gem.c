@@ -17,6 +17,14 @@
 
 #include <drm/drmP.h>
 #include <drm/drm_gem_cma_helper.h>
+#include <drm/xilinx_drm.h>
+
+#include <linux/dma-contiguous.h>
+#include <linux/dma-mapping.h>
+#include <linux/highmem.h>
+#include <linux/mm.h>
+#include <linux/scatterlist.h>
+#include <linux/vmalloc.h>
 
 #include "xilinx_drm_drv.h"
 #include "xilinx_drm_gem.h"
@@ -43,3 +51,401 @@ int xilinx_drm_gem_cma_dumb_create(struct drm_file *file_priv,
 
 	return drm_gem_cma_dumb_create(file_priv, drm, args);
 }
+
+/*
+ * Cached objects are kept in CMA pages that stay in the cacheable kernel
+ * mapping. They are the only non-imported objects that carry an sg table,
+ * which holds the streaming DMA mapping of the pages.
+ */
+struct xilinx_drm_gem_obj {
+	struct drm_gem_cma_object base;
+	struct page *pages;
+	unsigned int nr_pages;
+};
+
+static inline struct xilinx_drm_gem_obj *
+to_xilinx_obj(struct drm_gem_cma_object *obj)
+{
+	return container_of(obj, struct xilinx_drm_gem_obj, base);
+}
+
+/**
+ * xilinx_drm_gem_is_cached - Check if the object is mapped cacheable
+ * @obj: CMA GEM object
+ *
+ * Return: true if the CPU accesses to @obj go through the cache.
+ */
+bool xilinx_drm_gem_is_cached(struct drm_gem_cma_object *obj)
+{
+	return obj->sgt && !obj->base.import_attach;
+}
+
+static void xilinx_drm_gem_free_pages(struct drm_device *drm,
+				      struct xilinx_drm_gem_obj *obj)
+{
+	size_t size = obj->nr_pages << PAGE_SHIFT;
+
+	if (is_vmalloc_addr(obj->base.vaddr))
+		vunmap(obj->base.vaddr);
+
+	if (!dma_release_from_contiguous(drm->dev, obj->pages, obj->nr_pages))
+		free_pages_exact(page_address(obj->pages), size);
+}
+
+static int xilinx_drm_gem_alloc_pages(struct drm_device *drm,
+				      struct xilinx_drm_gem_obj *obj,
+				      size_t size)
+{
+	struct page **pages;
+	unsigned int i;
+	void *vaddr;
+
+	obj->nr_pages = size >> PAGE_SHIFT;
+	obj->pages = dma_alloc_from_contiguous(drm->dev, obj->nr_pages,
+					       get_order(size));
+	if (!obj->pages) {
+		vaddr = alloc_pages_exact(size, GFP_KERNEL | __GFP_NOWARN);
+		if (!vaddr)
+			return -ENOMEM;
+		obj->pages = virt_to_page(vaddr);
+	}
+
+	if (!PageHighMem(obj->pages)) {
+		obj->base.vaddr = page_address(obj->pages);
+		return 0;
+	}
+
+	pages = kmalloc_array(obj->nr_pages, sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		goto err_free_pages;
+
+	for (i = 0; i < obj->nr_pages; i++)
+		pages[i] = nth_page(obj->pages, i);
+
+	obj->base.vaddr = vmap(pages, obj->nr_pages, VM_MAP, PAGE_KERNEL);
+	kfree(pages);
+	if (!obj->base.vaddr)
+		goto err_free_pages;
+
+	return 0;
+
+err_free_pages:
+	xilinx_drm_gem_free_pages(drm, obj);
+	return -ENOMEM;
+}
+
+/**
+ * xilinx_drm_gem_create_cached - Allocate a cacheable CMA GEM object
+ * @drm: DRM object
+ * @size: size of the object
+ *
+ * The object is a regular CMA GEM object for the rest of the driver, but
+ * its backing pages are mapped cacheable into the kernel and into user
+ * space. The CPU writes have to be cleaned to memory with
+ * xilinx_drm_gem_sync_for_device() before the device reads them.
+ *
+ * Return: a CMA GEM object, or ERR_PTR.
+ */
+struct drm_gem_cma_object *xilinx_drm_gem_create_cached(struct drm_device *drm,
+							size_t size)
+{
+	struct xilinx_drm_gem_obj *obj;
+	struct sg_table *sgt;
+	int ret;
+
+	size = round_up(size, PAGE_SIZE);
+
+	obj = kzalloc(sizeof(*obj), GFP_KERNEL);
+	if (!obj)
+		return ERR_PTR(-ENOMEM);
+
+	ret = drm_gem_object_init(drm, &obj->base.base, size);
+	if (ret)
+		goto err_free_obj;
+
+	ret = drm_gem_create_mmap_offset(&obj->base.base);
+	if (ret)
+		goto err_release_obj;
+
+	ret = xilinx_drm_gem_alloc_pages(drm, obj, size);
+	if (ret) {
+		dev_err(drm->dev, "failed to allocate cached buffer (%zu)\n",
+			size);
+		goto err_free_mmap_offset;
+	}
+
+	memset(obj->base.vaddr, 0, size);
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt) {
+		ret = -ENOMEM;
+		goto err_free_pages;
+	}
+
+	ret = sg_alloc_table(sgt, 1, GFP_KERNEL);
+	if (ret)
+		goto err_free_sgt;
+
+	sg_set_page(sgt->sgl, obj->pages, size, 0);
+	if (!dma_map_sg(drm->dev, sgt->sgl, 1, DMA_BIDIRECTIONAL)) {
+		ret = -ENOMEM;
+		goto err_free_table;
+	}
+
+	obj->base.sgt = sgt;
+	obj->base.paddr = sg_dma_address(sgt->sgl);
+
+	return &obj->base;
+
+err_free_table:
+	sg_free_table(sgt);
+err_free_sgt:
+	kfree(sgt);
+err_free_pages:
+	xilinx_drm_gem_free_pages(drm, obj);
+err_free_mmap_offset:
+	drm_gem_free_mmap_offset(&obj->base.base);
+err_release_obj:
+	drm_gem_object_release(&obj->base.base);
+err_free_obj:
+	kfree(obj);
+	return ERR_PTR(ret);
+}
+
+/**
+ * xilinx_drm_gem_free_object - (struct drm_driver)->gem_free_object callback
+ * @gem_obj: GEM object
+ *
+ * Free the cached object, or hand other objects to drm_gem_cma_free_object().
+ */
+void xilinx_drm_gem_free_object(struct drm_gem_object *gem_obj)
+{
+	struct drm_gem_cma_object *cma_obj = to_drm_gem_cma_obj(gem_obj);
+	struct xilinx_drm_gem_obj *obj;
+
+	if (!xilinx_drm_gem_is_cached(cma_obj)) {
+		drm_gem_cma_free_object(gem_obj);
+		return;
+	}
+
+	obj = to_xilinx_obj(cma_obj);
+
+	drm_gem_free_mmap_offset(gem_obj);
+
+	dma_unmap_sg(gem_obj->dev->dev, cma_obj->sgt->sgl, 1,
+		     DMA_BIDIRECTIONAL);
+	sg_free_table(cma_obj->sgt);
+	kfree(cma_obj->sgt);
+
+	xilinx_drm_gem_free_pages(gem_obj->dev, obj);
+
+	drm_gem_object_release(gem_obj);
+	kfree(obj);
+}
+
+/**
+ * xilinx_drm_gem_sync_for_cpu - Invalidate a range of a cached object
+ * @obj: CMA GEM object
+ * @offset: offset of the range in bytes
+ * @size: size of the range in bytes
+ *
+ * Make the device writes to the range visible to the CPU. This is a no-op
+ * for the write-combined objects.
+ */
+void xilinx_drm_gem_sync_for_cpu(struct drm_gem_cma_object *obj,
+				 unsigned long offset, size_t size)
+{
+	if (xilinx_drm_gem_is_cached(obj))
+		dma_sync_single_range_for_cpu(obj->base.dev->dev, obj->paddr,
+					      offset, size, DMA_FROM_DEVICE);
+}
+
+/**
+ * xilinx_drm_gem_sync_for_device - Clean a range of a cached object
+ * @obj: CMA GEM object
+ * @offset: offset of the range in bytes
+ * @size: size of the range in bytes
+ *
+ * Write the CPU writes to the range back to memory. This is a no-op for the
+ * write-combined objects.
+ */
+void xilinx_drm_gem_sync_for_device(struct drm_gem_cma_object *obj,
+				    unsigned long offset, size_t size)
+{
+	if (xilinx_drm_gem_is_cached(obj))
+		dma_sync_single_range_for_device(obj->base.dev->dev, obj->paddr,
+						 offset, size, DMA_TO_DEVICE);
+}
+
+static int xilinx_drm_gem_mmap_obj(struct drm_gem_cma_object *obj,
+				   struct vm_area_struct *vma)
+{
+	struct drm_device *drm = obj->base.dev;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	int ret;
+
+	/* Map the whole buffer, and drop the write-combined drm_gem_mmap() */
+	vma->vm_pgoff = 0;
+
+	if (xilinx_drm_gem_is_cached(obj)) {
+		vma->vm_page_prot = vm_get_page_prot(vma->vm_flags);
+		ret = remap_pfn_range(vma, vma->vm_start,
+				      page_to_pfn(to_xilinx_obj(obj)->pages),
+				      size, vma->vm_page_prot);
+	} else {
+		vma->vm_flags &= ~VM_PFNMAP;
+		ret = dma_mmap_writecombine(drm->dev, vma, obj->vaddr,
+					    obj->paddr, size);
+	}
+
+	if (ret)
+		drm_gem_vm_close(vma);
+
+	return ret;
+}
+
+/**
+ * xilinx_drm_gem_mmap - (struct file_operations)->mmap callback
+ * @filp: file pointer
+ * @vma: virtual memory area
+ *
+ * Same as drm_gem_cma_mmap(), but maps the cached objects cacheable.
+ *
+ * Return: 0 if successful, or the error code.
+ */
+int xilinx_drm_gem_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	int ret;
+
+	ret = drm_gem_mmap(filp, vma);
+	if (ret)
+		return ret;
+
+	return xilinx_drm_gem_mmap_obj(to_drm_gem_cma_obj(vma->vm_private_data),
+				       vma);
+}
+
+/**
+ * xilinx_drm_gem_prime_mmap - (struct drm_driver)->gem_prime_mmap callback
+ * @gem_obj: GEM object
+ * @vma: virtual memory area
+ *
+ * Same as drm_gem_cma_prime_mmap(), but maps the cached objects cacheable.
+ *
+ * Return: 0 if successful, or the error code.
+ */
+int xilinx_drm_gem_prime_mmap(struct drm_gem_object *gem_obj,
+			      struct vm_area_struct *vma)
+{
+	struct drm_device *drm = gem_obj->dev;
+	int ret;
+
+	mutex_lock(&drm->struct_mutex);
+	ret = drm_gem_mmap_obj(gem_obj, gem_obj->size, vma);
+	mutex_unlock(&drm->struct_mutex);
+	if (ret < 0)
+		return ret;
+
+	return xilinx_drm_gem_mmap_obj(to_drm_gem_cma_obj(gem_obj), vma);
+}
+
+/**
+ * xilinx_drm_gem_create_ioctl - Create a GEM object
+ * @drm: DRM object
+ * @data: struct drm_xilinx_gem_create
+ * @file_priv: drm_file object
+ *
+ * Return: 0 if successful, or the error code.
+ */
+int xilinx_drm_gem_create_ioctl(struct drm_device *drm, void *data,
+				struct drm_file *file_priv)
+{
+	struct drm_xilinx_gem_create *args = data;
+	struct drm_gem_cma_object *obj;
+	int ret;
+
+	if (args->flags & ~XILINX_DRM_GEM_CACHED || !args->size)
+		return -EINVAL;
+
+	if (args->flags & XILINX_DRM_GEM_CACHED)
+		obj = xilinx_drm_gem_create_cached(drm, args->size);
+	else
+		obj = drm_gem_cma_create(drm, args->size);
+	if (IS_ERR(obj))
+		return PTR_ERR(obj);
+
+	ret = drm_gem_handle_create(file_priv, &obj->base, &args->handle);
+
+	/* drop reference from allocate - handle holds it now. */
+	drm_gem_object_unreference_unlocked(&obj->base);
+
+	return ret;
+}
+
+static int xilinx_drm_gem_cpu_access(struct drm_device *drm,
+				     struct drm_file *file_priv,
+				     struct drm_xilinx_gem_cpu_access *args,
+				     bool prep)
+{
+	struct drm_gem_object *gem_obj;
+	size_t size;
+	int ret = 0;
+
+	if (args->flags & ~(XILINX_DRM_GEM_CPU_READ | XILINX_DRM_GEM_CPU_WRITE))
+		return -EINVAL;
+
+	gem_obj = drm_gem_object_lookup(drm, file_priv, args->handle);
+	if (!gem_obj)
+		return -ENOENT;
+
+	if (args->offset >= gem_obj->size ||
+	    args->size > gem_obj->size - args->offset) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	size = args->size ? args->size : gem_obj->size - args->offset;
+
+	/*
+	 * Only the device writes need an invalidate before the CPU reads them,
+	 * and only the CPU writes need a clean before the device reads them.
+	 */
+	if (prep && args->flags & XILINX_DRM_GEM_CPU_READ)
+		xilinx_drm_gem_sync_for_cpu(to_drm_gem_cma_obj(gem_obj),
+					    args->offset, size);
+	else if (!prep && args->flags & XILINX_DRM_GEM_CPU_WRITE)
+		xilinx_drm_gem_sync_for_device(to_drm_gem_cma_obj(gem_obj),
+					       args->offset, size);
+
+out:
+	drm_gem_object_unreference_unlocked(gem_obj);
+	return ret;
+}
+
+/**
+ * xilinx_drm_gem_cpu_prep_ioctl - Begin the CPU access to a GEM object
+ * @drm: DRM object
+ * @data: struct drm_xilinx_gem_cpu_access
+ * @file_priv: drm_file object
+ *
+ * Return: 0 if successful, or the error code.
+ */
+int xilinx_drm_gem_cpu_prep_ioctl(struct drm_device *drm, void *data,
+				  struct drm_file *file_priv)
+{
+	return xilinx_drm_gem_cpu_access(drm, file_priv, data, true);
+}
+
+/**
+ * xilinx_drm_gem_cpu_fini_ioctl - End the CPU access to a GEM object
+ * @drm: DRM object
+ * @data: struct drm_xilinx_gem_cpu_access
+ * @file_priv: drm_file object
+ *
+ * Return: 0 if successful, or the error code.
+ */
+int xilinx_drm_gem_cpu_fini_ioctl(struct drm_device *drm, void *data,
+				  struct drm_file *file_priv)
+{
+	return xilinx_drm_gem_cpu_access(drm, file_priv, data, false);
+}
@@ -22,4 +22,23 @@ int xilinx_drm_gem_cma_dumb_create(struct drm_file *file_priv,
 				   struct drm_device *drm,
 				   struct drm_mode_create_dumb *args);
 
+struct drm_gem_cma_object *xilinx_drm_gem_create_cached(struct drm_device *drm,
+							size_t size);
+bool xilinx_drm_gem_is_cached(struct drm_gem_cma_object *obj);
+void xilinx_drm_gem_sync_for_cpu(struct drm_gem_cma_object *obj,
+				 unsigned long offset, size_t size);
+void xilinx_drm_gem_sync_for_device(struct drm_gem_cma_object *obj,
+				    unsigned long offset, size_t size);
+void xilinx_drm_gem_free_object(struct drm_gem_object *gem_obj);
+int xilinx_drm_gem_mmap(struct file *filp, struct vm_area_struct *vma);
+int xilinx_drm_gem_prime_mmap(struct drm_gem_object *gem_obj,
+			      struct vm_area_struct *vma);
+
+int xilinx_drm_gem_create_ioctl(struct drm_device *drm, void *data,
+				struct drm_file *file_priv);
+int xilinx_drm_gem_cpu_prep_ioctl(struct drm_device *drm, void *data,
+				  struct drm_file *file_priv);
+int xilinx_drm_gem_cpu_fini_ioctl(struct drm_device *drm, void *data,
+				  struct drm_file *file_priv);
+
 #endif /* _XILINX_DRM_GEM_H_ */
@@ -47,6 +47,33 @@ struct xilinx_drm_plane_dma {
 	struct data_chunk sgl[1];
 };
 
+/* plane updates waiting for the next vblank */
+#define XILINX_DRM_PLANE_PENDING_FB	BIT(0)	/* new dma descriptor */
+#define XILINX_DRM_PLANE_PENDING_SIZE	BIT(1)	/* osd layer dimension */
+#define XILINX_DRM_PLANE_PENDING_ALPHA	BIT(2)	/* alpha value */
+
+/* time to wait for a pending update before applying it right away */
+#define XILINX_DRM_PLANE_PENDING_TIMEOUT	50	/* ms */
+
+/**
+ * struct xilinx_drm_plane_pending - Xilinx drm plane update in flight
+ *
+ * @flags: XILINX_DRM_PLANE_PENDING_* flags
+ * @desc: prepared, not yet submitted dma descriptor
+ * @x: osd layer horizontal start
+ * @y: osd layer vertical start
+ * @w: osd layer width
+ * @h: osd layer height
+ */
+struct xilinx_drm_plane_pending {
+	unsigned int flags;
+	struct dma_async_tx_descriptor *desc;
+	u16 x;
+	u16 y;
+	u16 w;
+	u16 h;
+};
+
 /**
  * struct xilinx_drm_plane - Xilinx drm plane object
  *
@@ -64,6 +91,7 @@ struct xilinx_drm_plane_dma {
  * @osd_layer: osd layer
  * @dp_layer: DisplayPort subsystem layer
  * @manager: plane manager
+ * @pending: update waiting for the next vblank, protected by manager lock
  */
 struct xilinx_drm_plane {
 	struct drm_plane base;
@@ -80,6 +108,7 @@ struct xilinx_drm_plane {
 	struct xilinx_osd_layer *osd_layer;
 	struct xilinx_drm_dp_sub_layer *dp_layer;
 	struct xilinx_drm_plane_manager *manager;
+	struct xilinx_drm_plane_pending pending;
 };
 
 #define MAX_PLANES 8
@@ -98,6 +127,12 @@ struct xilinx_drm_plane {
  * @alpha_prop: alpha value property
  * @default_alpha: default alpha value
  * @planes: xilinx drm planes
+ * @lock: protects the pending updates and the osd update sequences
+ * @wait: wait queue for pending updates to be applied
+ * @vblank_sync: plane updates can be deferred to the vblank
+ * @dpms: current dpms level of the plane manager
+ * @pending: pending updates hold a vblank reference
+ * @prio_pending: layer priorities wait for the next vblank
  */
 struct xilinx_drm_plane_manager {
 	struct drm_device *drm;
@@ -111,15 +146,175 @@ struct xilinx_drm_plane_manager {
 	struct drm_property *alpha_prop;
 	unsigned int default_alpha;
 	struct xilinx_drm_plane *planes[MAX_PLANES];
+	spinlock_t lock;
+	wait_queue_head_t wait;
+	bool vblank_sync;
+	int dpms;
+	bool pending;
+	bool prio_pending;
 };
 
 #define to_xilinx_plane(x)	container_of(x, struct xilinx_drm_plane, base)
 
+/*
+ * Plane updates of a running pipeline are not written to the hardware right
+ * away. The new dma descriptor, the osd layer dimension, alpha and priority
+ * values are queued and written all together in the next vblank interrupt,
+ * so the osd latches all layer registers and the dma engines switch to the
+ * new buffers at the same frame start. Updates issued within one frame thus
+ * cost one vblank instead of one each.
+ */
+
+/* write the alpha value of a plane */
+static void xilinx_drm_plane_write_alpha(struct xilinx_drm_plane *plane)
+{
+	struct xilinx_drm_plane_manager *manager = plane->manager;
+
+	/* FIXME: use global alpha for now */
+	if (plane->osd_layer)
+		xilinx_osd_layer_set_alpha(plane->osd_layer, 1, plane->alpha);
+	else if (manager->dp_sub)
+		xilinx_drm_dp_sub_set_alpha(manager->dp_sub, plane->alpha);
+}
+
+/* write priorities of all planes. called with osd register update disabled */
+static void
+xilinx_drm_plane_write_prio(struct xilinx_drm_plane_manager *manager)
+{
+	unsigned int i;
+
+	for (i = 0; i < manager->num_planes; i++)
+		if (manager->planes[i])
+			xilinx_osd_layer_set_priority(
+					manager->planes[i]->osd_layer,
+					manager->planes[i]->prio);
+}
+
+/* apply the pending update of a plane. called with the manager lock held */
+static void xilinx_drm_plane_apply(struct xilinx_drm_plane *plane)
+{
+	struct xilinx_drm_plane_pending *pending = &plane->pending;
+
+	if (pending->flags & XILINX_DRM_PLANE_PENDING_SIZE)
+		xilinx_osd_layer_set_dimension(plane->osd_layer, pending->x,
+					       pending->y, pending->w,
+					       pending->h);
+
+	if (pending->flags & XILINX_DRM_PLANE_PENDING_ALPHA)
+		xilinx_drm_plane_write_alpha(plane);
+
+	if (pending->flags & XILINX_DRM_PLANE_PENDING_FB) {
+		dmaengine_submit(pending->desc);
+		dma_async_issue_pending(plane->dma.chan);
+		pending->desc = NULL;
+	}
+
+	pending->flags = 0;
+}
+
+/* apply all pending updates. called with the manager lock held */
+static void
+xilinx_drm_plane_manager_apply(struct xilinx_drm_plane_manager *manager)
+{
+	unsigned int i;
+
+	if (!manager->pending)
+		return;
+
+	if (manager->osd)
+		xilinx_osd_disable_rue(manager->osd);
+
+	for (i = 0; i < manager->num_planes; i++)
+		if (manager->planes[i] && manager->planes[i]->pending.flags)
+			xilinx_drm_plane_apply(manager->planes[i]);
+
+	if (manager->prio_pending) {
+		xilinx_drm_plane_write_prio(manager);
+		manager->prio_pending = false;
+	}
+
+	if (manager->osd)
+		xilinx_osd_enable_rue(manager->osd);
+
+	manager->pending = false;
+	drm_vblank_put(manager->drm, 0);
+	wake_up_all(&manager->wait);
+}
+
+/*
+ * Check if an update can wait for the next vblank, and make sure the vblank
+ * interrupt is on. Called with the manager lock held.
+ */
+static bool
+xilinx_drm_plane_manager_defer(struct xilinx_drm_plane_manager *manager)
+{
+	if (!manager->vblank_sync || manager->dpms != DRM_MODE_DPMS_ON)
+		return false;
+
+	if (!manager->pending) {
+		if (drm_vblank_get(manager->drm, 0))
+			return false;
+		manager->pending = true;
+	}
+
+	return true;
+}
+
+/* wait until the previous update of a plane is applied */
+static void xilinx_drm_plane_wait_pending(struct xilinx_drm_plane *plane)
+{
+	struct xilinx_drm_plane_manager *manager = plane->manager;
+	unsigned long timeout;
+	unsigned long flags;
+
+	timeout = msecs_to_jiffies(XILINX_DRM_PLANE_PENDING_TIMEOUT);
+	if (wait_event_timeout(manager->wait,
+			       !ACCESS_ONCE(plane->pending.flags), timeout))
+		return;
+
+	/* no vblank in time, apply it now */
+	spin_lock_irqsave(&manager->lock, flags);
+	xilinx_drm_plane_manager_apply(manager);
+	spin_unlock_irqrestore(&manager->lock, flags);
+}
+
+/**
+ * xilinx_drm_plane_manager_vblank - Apply pending plane updates
+ * @manager: Xilinx plane manager object
+ *
+ * Write all queued plane updates to the hardware. This function is called
+ * from the vblank interrupt handler of the CRTC.
+ */
+void xilinx_drm_plane_manager_vblank(struct xilinx_drm_plane_manager *manager)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&manager->lock, flags);
+	xilinx_drm_plane_manager_apply(manager);
+	spin_unlock_irqrestore(&manager->lock, flags);
+}
+
+/**
+ * xilinx_drm_plane_manager_enable_vblank_sync - Defer updates to the vblank
+ * @manager: Xilinx plane manager object
+ *
+ * Let plane updates wait for the next vblank. The CRTC driver calls this
+ * function when it has a vblank interrupt that calls
+ * xilinx_drm_plane_manager_vblank().
+ */
+void
+xilinx_drm_plane_manager_enable_vblank_sync(struct xilinx_drm_plane_manager
+					    *manager)
+{
+	manager->vblank_sync = true;
+}
+
 /* set plane dpms */
 void xilinx_drm_plane_dpms(struct drm_plane *base_plane, int dpms)
 {
 	struct xilinx_drm_plane *plane = to_xilinx_plane(base_plane);
 	struct xilinx_drm_plane_manager *manager = plane->manager;
+	unsigned long flags;
 
 	DRM_DEBUG_KMS("plane->id: %d\n", plane->id);
 	DRM_DEBUG_KMS("dpms: %d -> %d\n", plane->dpms, dpms);
@@ -149,6 +344,7 @@ void xilinx_drm_plane_dpms(struct drm_plane *base_plane, int dpms)
 
 		/* enable osd */
 		if (manager->osd) {
+			spin_lock_irqsave(&manager->lock, flags);
 			xilinx_osd_disable_rue(manager->osd);
 
 			xilinx_osd_layer_set_priority(plane->osd_layer,
@@ -158,10 +354,15 @@ void xilinx_drm_plane_dpms(struct drm_plane *base_plane, int dpms)
 			xilinx_osd_layer_enable(plane->osd_layer);
 
 			xilinx_osd_enable_rue(manager->osd);
+			spin_unlock_irqrestore(&manager->lock, flags);
 		}
 
 		break;
 	default:
+		/* flush a pending update so its descriptor gets released */
+		spin_lock_irqsave(&manager->lock, flags);
+		xilinx_drm_plane_manager_apply(manager);
+
 		/* disable/reset osd */
 		if (manager->osd) {
 			xilinx_osd_disable_rue(manager->osd);
@@ -172,6 +373,7 @@ void xilinx_drm_plane_dpms(struct drm_plane *base_plane, int dpms)
 
 			xilinx_osd_enable_rue(manager->osd);
 		}
+		spin_unlock_irqrestore(&manager->lock, flags);
 
 		if (plane->cresample) {
 			xilinx_cresample_disable(plane->cresample);
@@ -198,12 +400,15 @@ void xilinx_drm_plane_dpms(struct drm_plane *base_plane, int dpms)
 void xilinx_drm_plane_commit(struct drm_plane *base_plane)
 {
 	struct xilinx_drm_plane *plane = to_xilinx_plane(base_plane);
+	struct xilinx_drm_plane_manager *manager = plane->manager;
 	struct dma_async_tx_descriptor *desc;
 	enum dma_ctrl_flags flags;
+	unsigned long irq_flags;
 
 	DRM_DEBUG_KMS("plane->id: %d\n", plane->id);
 
-	flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
+	/* no completion callback, so no interrupt for every frame either */
+	flags = DMA_CTRL_ACK;
 	desc = dmaengine_prep_interleaved_dma(plane->dma.chan, &plane->dma.xt,
 					      flags);
 	if (!desc) {
@@ -211,6 +416,19 @@ void xilinx_drm_plane_commit(struct drm_plane *base_plane)
 		return;
 	}
 
+	/* switch to the new buffer in the next vblank */
+	spin_lock_irqsave(&manager->lock, irq_flags);
+	if (plane->dpms == DRM_MODE_DPMS_ON &&
+	    xilinx_drm_plane_manager_defer(manager)) {
+		if (plane->pending.desc)
+			dmaengine_submit(plane->pending.desc);
+		plane->pending.desc = desc;
+		plane->pending.flags |= XILINX_DRM_PLANE_PENDING_FB;
+		spin_unlock_irqrestore(&manager->lock, irq_flags);
+		return;
+	}
+	spin_unlock_irqrestore(&manager->lock, irq_flags);
+
 	/* submit dma desc */
 	dmaengine_submit(desc);
 
@@ -227,7 +445,9 @@ int xilinx_drm_plane_mode_set(struct drm_plane *base_plane,
 			      uint32_t src_w, uint32_t src_h)
 {
 	struct xilinx_drm_plane *plane = to_xilinx_plane(base_plane);
+	struct xilinx_drm_plane_manager *manager = plane->manager;
 	struct drm_gem_cma_object *obj;
+	unsigned long flags;
 	size_t offset;
 
 	DRM_DEBUG_KMS("plane->id: %d\n", plane->id);
@@ -237,6 +457,9 @@ int xilinx_drm_plane_mode_set(struct drm_plane *base_plane,
 		return -EINVAL;
 	}
 
+	/* one update per plane and frame */
+	xilinx_drm_plane_wait_pending(plane);
+
 	/* configure cresample */
 	if (plane->cresample)
 		xilinx_cresample_configure(plane->cresample, crtc_w, crtc_h);
@@ -267,13 +490,25 @@ int xilinx_drm_plane_mode_set(struct drm_plane *base_plane,
 	plane->dma.xt.dst_sgl = false;
 
 	/* set OSD dimensions */
-	if (plane->manager->osd) {
-		xilinx_osd_disable_rue(plane->manager->osd);
+	if (manager->osd) {
+		spin_lock_irqsave(&manager->lock, flags);
+		if (plane->dpms == DRM_MODE_DPMS_ON &&
+		    xilinx_drm_plane_manager_defer(manager)) {
+			plane->pending.x = crtc_x;
+			plane->pending.y = crtc_y;
+			plane->pending.w = src_w;
+			plane->pending.h = src_h;
+			plane->pending.flags |= XILINX_DRM_PLANE_PENDING_SIZE;
+		} else {
+			xilinx_osd_disable_rue(manager->osd);
 
-		xilinx_osd_layer_set_dimension(plane->osd_layer, crtc_x, crtc_y,
-					       src_w, src_h);
+			xilinx_osd_layer_set_dimension(plane->osd_layer,
+						       crtc_x, crtc_y,
+						       src_w, src_h);
 
-		xilinx_osd_enable_rue(plane->manager->osd);
+			xilinx_osd_enable_rue(manager->osd);
+		}
+		spin_unlock_irqrestore(&manager->lock, flags);
 	}
 
 	if (plane->manager->dp_sub) {
@@ -339,7 +574,9 @@ static void xilinx_drm_plane_destroy(struct drm_plane *base_plane)
 	dma_release_channel(plane->dma.chan);
 
 	if (plane->manager->osd) {
+		xilinx_osd_disable_rue(plane->manager->osd);
 		xilinx_osd_layer_disable(plane->osd_layer);
+		xilinx_osd_enable_rue(plane->manager->osd);
 		xilinx_osd_layer_put(plane->osd_layer);
 	}
 
@@ -382,16 +619,9 @@ xilinx_drm_plane_update_prio(struct xilinx_drm_plane_manager *manager)
 		planes[j] = plane;
 	}
 
-	xilinx_osd_disable_rue(manager->osd);
-
 	/* remove duplicates by reassigning priority */
-	for (i = 0; i < manager->num_planes; i++) {
+	for (i = 0; i < manager->num_planes; i++)
 		planes[i]->prio = i;
-		xilinx_osd_layer_set_priority(planes[i]->osd_layer,
-					      planes[i]->prio);
-	}
-
-	xilinx_osd_enable_rue(manager->osd);
 }
 
 static void xilinx_drm_plane_set_zpos(struct drm_plane *base_plane,
@@ -399,6 +629,7 @@ static void xilinx_drm_plane_set_zpos(struct drm_plane *base_plane,
 {
 	struct xilinx_drm_plane *plane = to_xilinx_plane(base_plane);
 	struct xilinx_drm_plane_manager *manager = plane->manager;
+	unsigned long flags;
 	bool update = false;
 	int i;
 
@@ -413,14 +644,28 @@ static void xilinx_drm_plane_set_zpos(struct drm_plane *base_plane,
 		}
 	}
 
+	spin_lock_irqsave(&manager->lock, flags);
+
 	plane->zpos = zpos;
 
-	if (update) {
+	if (update)
 		xilinx_drm_plane_update_prio(manager);
-	} else {
+	else
 		plane->prio = zpos;
+
+	if (xilinx_drm_plane_manager_defer(manager)) {
+		manager->prio_pending = true;
+	} else if (update) {
+		xilinx_osd_disable_rue(manager->osd);
+		xilinx_drm_plane_write_prio(manager);
+		xilinx_osd_enable_rue(manager->osd);
+	} else {
+		xilinx_osd_disable_rue(manager->osd);
 		xilinx_osd_layer_set_priority(plane->osd_layer, plane->prio);
+		xilinx_osd_enable_rue(manager->osd);
 	}
+
+	spin_unlock_irqrestore(&manager->lock, flags);
 }
 
 static void xilinx_drm_plane_set_alpha(struct drm_plane *base_plane,
@@ -428,17 +673,26 @@ static void xilinx_drm_plane_set_alpha(struct drm_plane *base_plane,
 {
 	struct xilinx_drm_plane *plane = to_xilinx_plane(base_plane);
 	struct xilinx_drm_plane_manager *manager = plane->manager;
+	unsigned long flags;
 
 	if (plane->alpha == alpha)
 		return;
 
+	spin_lock_irqsave(&manager->lock, flags);
+
 	plane->alpha = alpha;
 
-	/* FIXME: use global alpha for now */
-	if (plane->osd_layer)
-		xilinx_osd_layer_set_alpha(plane->osd_layer, 1, plane->alpha);
-	else if (manager->dp_sub)
-		xilinx_drm_dp_sub_set_alpha(manager->dp_sub, plane->alpha);
+	if (xilinx_drm_plane_manager_defer(manager)) {
+		plane->pending.flags |= XILINX_DRM_PLANE_PENDING_ALPHA;
+	} else if (manager->osd) {
+		xilinx_osd_disable_rue(manager->osd);
+		xilinx_drm_plane_write_alpha(plane);
+		xilinx_osd_enable_rue(manager->osd);
+	} else {
+		xilinx_drm_plane_write_alpha(plane);
+	}
+
+	spin_unlock_irqrestore(&manager->lock, flags);
 }
 
 /* set property of a plane */
@@ -599,6 +853,14 @@ static void xilinx_drm_plane_attach_property(struct drm_plane *base_plane)
 void xilinx_drm_plane_manager_dpms(struct xilinx_drm_plane_manager *manager,
 				   int dpms)
 {
+	unsigned long flags;
+
+	/* updates are only deferred while the pipeline is running */
+	spin_lock_irqsave(&manager->lock, flags);
+	xilinx_drm_plane_manager_apply(manager);
+	manager->dpms = dpms;
+	spin_unlock_irqrestore(&manager->lock, flags);
+
 	switch (dpms) {
 	case DRM_MODE_DPMS_ON:
 		if (manager->dp_sub) {
@@ -825,7 +1087,9 @@ err_init:
 					    plane->dp_layer);
 	}
 	if (manager->osd) {
+		xilinx_osd_disable_rue(manager->osd);
 		xilinx_osd_layer_disable(plane->osd_layer);
+		xilinx_osd_enable_rue(manager->osd);
 		xilinx_osd_layer_put(plane->osd_layer);
 	}
 err_dma:
@@ -938,6 +1202,9 @@ xilinx_drm_plane_probe_manager(struct drm_device *drm)
 	}
 
 	manager->drm = drm;
+	manager->dpms = DRM_MODE_DPMS_OFF;
+	spin_lock_init(&manager->lock);
+	init_waitqueue_head(&manager->wait);
 
 	/* probe an OSD. proceed even if there's no OSD */
 	sub_node = of_parse_phandle(dev->of_node, "xlnx,osd", 0);
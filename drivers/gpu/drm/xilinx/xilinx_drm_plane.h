@@ -42,6 +42,10 @@ xilinx_drm_plane_manager_mode_set(struct xilinx_drm_plane_manager *manager,
 				  unsigned int crtc_w, unsigned int crtc_h);
 void xilinx_drm_plane_manager_dpms(struct xilinx_drm_plane_manager *manager,
 				   int dpms);
+void xilinx_drm_plane_manager_vblank(struct xilinx_drm_plane_manager *manager);
+void
+xilinx_drm_plane_manager_enable_vblank_sync(struct xilinx_drm_plane_manager
+					    *manager);
 struct drm_plane *
 xilinx_drm_plane_create_primary(struct xilinx_drm_plane_manager *manager,
 				unsigned int possible_crtcs);
@@ -93,13 +93,13 @@
 /**
  * struct xilinx_osd_layer - Xilinx OSD layer object
  *
- * @base: base address
+ * @offset: offset of the layer registers in the layer shadow
  * @id: id
  * @avail: available flag
  * @osd: osd
  */
 struct xilinx_osd_layer {
-	void __iomem *base;
+	int offset;
 	int id;
 	bool avail;
 	struct xilinx_osd *osd;
@@ -109,6 +109,8 @@ struct xilinx_osd_layer {
  * struct xilinx_osd - Xilinx OSD object
  *
  * @base: base address
+ * @shadow: shadow of the layer registers, written out by
+ *	    xilinx_osd_enable_rue()
  * @layers: layers
  * @num_layers: number of layers
  * @max_width: maximum width
@@ -116,6 +118,7 @@ struct xilinx_osd_layer {
  */
 struct xilinx_osd {
 	void __iomem *base;
+	struct xilinx_drm_shadow shadow;
 	struct xilinx_osd_layer *layers[OSD_MAX_NUM_OF_LAYERS];
 	unsigned int num_layers;
 	unsigned int max_width;
@@ -123,6 +126,20 @@ struct xilinx_osd {
 };
 
 /* osd layer operation */
+static inline u32 xilinx_osd_layer_readl(struct xilinx_osd_layer *layer,
+					 int offset)
+{
+	return xilinx_drm_shadow_readl(&layer->osd->shadow,
+				       layer->offset + offset);
+}
+
+static inline void xilinx_osd_layer_writel(struct xilinx_osd_layer *layer,
+					   int offset, u32 val)
+{
+	xilinx_drm_shadow_writel(&layer->osd->shadow, layer->offset + offset,
+				 val);
+}
+
 /* set layer alpha */
 void xilinx_osd_layer_set_alpha(struct xilinx_osd_layer *layer, u32 enable,
 				u32 alpha)
@@ -132,12 +149,12 @@ void xilinx_osd_layer_set_alpha(struct xilinx_osd_layer *layer, u32 enable,
 	DRM_DEBUG_DRIVER("layer->id: %d\n", layer->id);
 	DRM_DEBUG_DRIVER("alpha: 0x%08x\n", alpha);
 
-	value = xilinx_drm_readl(layer->base, OSD_LXC);
+	value = xilinx_osd_layer_readl(layer, OSD_LXC);
 	value = enable ? (value | OSD_LXC_GALPHAEN) :
 		(value & ~OSD_LXC_GALPHAEN);
 	value &= ~OSD_LXC_ALPHA_MASK;
 	value |= (alpha << OSD_LXC_ALPHA_SHIFT) & OSD_LXC_ALPHA_MASK;
-	xilinx_drm_writel(layer->base, OSD_LXC, value);
+	xilinx_osd_layer_writel(layer, OSD_LXC, value);
 }
 
 /* set layer priority */
@@ -148,10 +165,10 @@ void xilinx_osd_layer_set_priority(struct xilinx_osd_layer *layer, u32 prio)
 	DRM_DEBUG_DRIVER("layer->id: %d\n", layer->id);
 	DRM_DEBUG_DRIVER("prio: %d\n", prio);
 
-	value = xilinx_drm_readl(layer->base, OSD_LXC);
+	value = xilinx_osd_layer_readl(layer, OSD_LXC);
 	value &= ~OSD_LXC_PRIORITY_MASK;
 	value |= (prio << OSD_LXC_PRIORITY_SHIFT) & OSD_LXC_PRIORITY_MASK;
-	xilinx_drm_writel(layer->base, OSD_LXC, value);
+	xilinx_osd_layer_writel(layer, OSD_LXC, value);
 }
 
 /* set layer dimension */
@@ -168,12 +185,12 @@ void xilinx_osd_layer_set_dimension(struct xilinx_osd_layer *layer,
 	value = xstart & OSD_LXP_XSTART_MASK;
 	value |= (ystart << OSD_LXP_YSTART_SHIFT) & OSD_LXP_YSTART_MASK;
 
-	xilinx_drm_writel(layer->base, OSD_LXP, value);
+	xilinx_osd_layer_writel(layer, OSD_LXP, value);
 
 	value = xsize & OSD_LXS_XSIZE_MASK;
 	value |= (ysize << OSD_LXS_YSIZE_SHIFT) & OSD_LXS_YSIZE_MASK;
 
-	xilinx_drm_writel(layer->base, OSD_LXS, value);
+	xilinx_osd_layer_writel(layer, OSD_LXS, value);
 }
 
 /* enable layer */
@@ -183,9 +200,9 @@ void xilinx_osd_layer_enable(struct xilinx_osd_layer *layer)
 
 	DRM_DEBUG_DRIVER("layer->id: %d\n", layer->id);
 
-	value = xilinx_drm_readl(layer->base, OSD_LXC);
+	value = xilinx_osd_layer_readl(layer, OSD_LXC);
 	value |= OSD_LXC_EN;
-	xilinx_drm_writel(layer->base, OSD_LXC, value);
+	xilinx_osd_layer_writel(layer, OSD_LXC, value);
 }
 
 /* disable layer */
@@ -195,9 +212,9 @@ void xilinx_osd_layer_disable(struct xilinx_osd_layer *layer)
 
 	DRM_DEBUG_DRIVER("layer->id: %d\n", layer->id);
 
-	value = xilinx_drm_readl(layer->base, OSD_LXC);
+	value = xilinx_osd_layer_readl(layer, OSD_LXC);
 	value &= ~OSD_LXC_EN;
-	xilinx_drm_writel(layer->base, OSD_LXC, value);
+	xilinx_osd_layer_writel(layer, OSD_LXC, value);
 }
 
 /* get an available layer */
@@ -275,6 +292,7 @@ unsigned int xilinx_osd_get_format(struct xilinx_osd *osd)
 void xilinx_osd_reset(struct xilinx_osd *osd)
 {
 	xilinx_drm_writel(osd->base, OSD_CTL, OSD_RST_RESET);
+	xilinx_drm_shadow_invalidate(&osd->shadow);
 }
 
 /* enable osd */
@@ -291,9 +309,10 @@ void xilinx_osd_disable(struct xilinx_osd *osd)
 			  xilinx_drm_readl(osd->base, OSD_CTL) & ~OSD_CTL_EN);
 }
 
-/* register-update-enable osd */
+/* write the pending layer changes, and register-update-enable osd */
 void xilinx_osd_enable_rue(struct xilinx_osd *osd)
 {
+	xilinx_drm_shadow_commit(&osd->shadow);
 	xilinx_drm_writel(osd->base, OSD_CTL,
 			  xilinx_drm_readl(osd->base, OSD_CTL) | OSD_CTL_RUE);
 }
@@ -352,6 +371,16 @@ struct xilinx_osd *xilinx_osd_probe(struct device *dev,
 		return ERR_PTR(ret);
 	}
 
+	if (osd->num_layers > OSD_MAX_NUM_OF_LAYERS) {
+		dev_warn(dev, "invalid num of layers prop\n");
+		return ERR_PTR(-EINVAL);
+	}
+
+	ret = xilinx_drm_shadow_init(dev, &osd->shadow, osd->base + OSD_L0C,
+				     OSD_LAYER_SIZE * osd->num_layers);
+	if (ret)
+		return ERR_PTR(ret);
+
 	/* read the video format set by a user */
 	osd->format = xilinx_drm_readl(osd->base, OSD_ENC) &
 		      OSD_VIDEO_FORMAT_MASK;
@@ -361,7 +390,7 @@ struct xilinx_osd *xilinx_osd_probe(struct device *dev,
 		if (!layer)
 			return ERR_PTR(-ENOMEM);
 
-		layer->base = osd->base + OSD_L0C + OSD_LAYER_SIZE * i;
+		layer->offset = OSD_LAYER_SIZE * i;
 		layer->id = i;
 		layer->osd = osd;
 		layer->avail = true;
@@ -24,6 +24,11 @@
 struct xilinx_osd;
 struct xilinx_osd_layer;
 
+/*
+ * Layer changes are kept in a shadow and reach the hardware in the next
+ * xilinx_osd_enable_rue().
+ */
+
 /* osd layer configuration */
 void xilinx_osd_layer_set_alpha(struct xilinx_osd_layer *layer, u32 enable,
 				u32 alpha);
@@ -538,6 +538,12 @@ void xilinx_vtc_disable_vblank_intr(struct xilinx_vtc *vtc)
 	vtc->vblank_fn = NULL;
 }
 
+/* check if the vblank interrupt is available */
+bool xilinx_vtc_has_vblank_intr(struct xilinx_vtc *vtc)
+{
+	return vtc->irq > 0;
+}
+
 static const struct of_device_id xilinx_vtc_of_match[] = {
 	{ .compatible = "xlnx,v-tc-5.01.a" },
 	{ /* end of table */ },
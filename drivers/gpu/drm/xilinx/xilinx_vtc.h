@@ -27,6 +27,7 @@ void xilinx_vtc_config_sig(struct xilinx_vtc *vtc,
 void xilinx_vtc_enable_vblank_intr(struct xilinx_vtc *vtc,
 				   void (*fn)(void *), void *data);
 void xilinx_vtc_disable_vblank_intr(struct xilinx_vtc *vtc);
+bool xilinx_vtc_has_vblank_intr(struct xilinx_vtc *vtc);
 void xilinx_vtc_reset(struct xilinx_vtc *vtc);
 void xilinx_vtc_enable(struct xilinx_vtc *vtc);
 void xilinx_vtc_disable(struct xilinx_vtc *vtc);
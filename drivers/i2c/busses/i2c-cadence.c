@@ -123,6 +123,7 @@
  * @membase:		Base address of the I2C device
  * @adap:		I2C adapter instance
  * @p_msg:		Message pointer
+ * @msgs_left:		Number of messages after the current one
  * @err_status:		Error status in Interrupt Status Register
  * @xfer_done:		Transfer complete status
  * @p_send_buf:		Pointer to transmit buffer
@@ -142,6 +143,7 @@ struct cdns_i2c {
 	void __iomem *membase;
 	struct i2c_adapter adap;
 	struct i2c_msg *p_msg;
+	int msgs_left;
 	int err_status;
 	struct completion xfer_done;
 	unsigned char *p_send_buf;
@@ -184,6 +186,8 @@ static void cdns_i2c_clear_bus_hold(struct cdns_i2c *id)
  *
  * Return: IRQ_HANDLED always
  */
+static void cdns_i2c_start_msg(struct cdns_i2c *id);
+
 static irqreturn_t cdns_i2c_isr(int irq, void *ptr)
 {
 	unsigned int isr_status, avail_bytes, updatetx;
@@ -278,11 +282,17 @@ static irqreturn_t cdns_i2c_isr(int irq, void *ptr)
 		status = IRQ_HANDLED;
 	}
 
-	/* When sending, handle transfer complete interrupt */
-	if ((isr_status & CDNS_I2C_IXR_COMP) && !id->p_recv_buf) {
+	/*
+	 * When sending, handle the data interrupt, raised with two bytes left
+	 * in the FIFO, and the transfer complete interrupt.
+	 */
+	if ((isr_status & (CDNS_I2C_IXR_COMP | CDNS_I2C_IXR_DATA)) &&
+	    !id->p_recv_buf) {
 		/*
 		 * If there is more data to be sent, calculate the
 		 * space available in FIFO and fill with that many bytes.
+		 * Refilling on the data interrupt keeps the FIFO from
+		 * running empty in the middle of a large message.
 		 */
 		if (id->send_count) {
 			avail_bytes = CDNS_I2C_FIFO_DEPTH -
@@ -298,7 +308,7 @@ static irqreturn_t cdns_i2c_isr(int irq, void *ptr)
 					 CDNS_I2C_DATA_OFFSET);
 				id->send_count--;
 			}
-		} else {
+		} else if (isr_status & CDNS_I2C_IXR_COMP) {
 			/*
 			 * Signal the completion of transaction and
 			 * clear the hold bus bit if there are no
@@ -334,6 +344,17 @@ static irqreturn_t cdns_i2c_isr(int irq, void *ptr)
 	if (id->err_status)
 		status = IRQ_HANDLED;
 
+	/*
+	 * The bus is still held for a repeated start, start the next message
+	 * from here instead of waking up the caller to do it.
+	 */
+	if (done_flag && !id->err_status && id->msgs_left) {
+		id->msgs_left--;
+		id->p_msg++;
+		cdns_i2c_start_msg(id);
+		done_flag = 0;
+	}
+
 	if (done_flag)
 		complete(&id->xfer_done);
 
@@ -525,15 +546,21 @@ static void cdns_i2c_master_reset(struct i2c_adapter *adap)
 	cdns_i2c_writereg(regval, CDNS_I2C_SR_OFFSET);
 }
 
-static int cdns_i2c_process_msg(struct cdns_i2c *id, struct i2c_msg *msg,
-		struct i2c_adapter *adap)
+/**
+ * cdns_i2c_start_msg - Start the transfer of the current message
+ * @id:		pointer to the i2c device
+ *
+ * Called for the first message of a transfer and from the interrupt handler
+ * once a message completes and more are left.
+ */
+static void cdns_i2c_start_msg(struct cdns_i2c *id)
 {
-	int ret;
+	struct i2c_msg *msg = id->p_msg;
 	u32 reg;
 
-	id->p_msg = msg;
-	id->err_status = 0;
-	reinit_completion(&id->xfer_done);
+	/* The last message releases the bus */
+	if (!id->msgs_left)
+		id->bus_hold_flag = 0;
 
 	/* Check for the TEN Bit mode on each msg */
 	reg = cdns_i2c_readreg(CDNS_I2C_CR_OFFSET);
@@ -554,6 +581,29 @@ static int cdns_i2c_process_msg(struct cdns_i2c *id, struct i2c_msg *msg,
 		cdns_i2c_mrecv(id);
 	else
 		cdns_i2c_msend(id);
+}
+
+/**
+ * cdns_i2c_process_msgs - Transfer messages and wait for the completion
+ * @id:		pointer to the i2c device
+ * @msgs:	messages to transfer
+ * @num:	number of messages
+ * @adap:	pointer to the i2c adapter driver instance
+ *
+ * Return: 0 once the messages went out or one of them failed with an error
+ * in id->err_status, negative error on timeout and arbitration loss
+ */
+static int cdns_i2c_process_msgs(struct cdns_i2c *id, struct i2c_msg *msgs,
+		int num, struct i2c_adapter *adap)
+{
+	int ret;
+
+	id->p_msg = msgs;
+	id->msgs_left = num - 1;
+	id->err_status = 0;
+	reinit_completion(&id->xfer_done);
+
+	cdns_i2c_start_msg(id);
 
 	/* Wait for the signal of completion */
 	ret = wait_for_completion_timeout(&id->xfer_done, adap->timeout);
@@ -622,24 +672,19 @@ static int cdns_i2c_master_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
 		id->bus_hold_flag = 0;
 	}
 
-	/* Process the msg one by one */
-	for (count = 0; count < num; count++, msgs++) {
-		if (count == (num - 1))
-			id->bus_hold_flag = 0;
-
-		ret = cdns_i2c_process_msg(id, msgs, adap);
-		if (ret)
-			return ret;
+	/* The interrupt handler starts each message after the first one */
+	ret = cdns_i2c_process_msgs(id, msgs, num, adap);
+	if (ret)
+		return ret;
 
-		/* Report the other error interrupts to application */
-		if (id->err_status) {
-			cdns_i2c_master_reset(adap);
+	/* Report the other error interrupts to application */
+	if (id->err_status) {
+		cdns_i2c_master_reset(adap);
 
-			if (id->err_status & CDNS_I2C_IXR_NACK)
-				return -ENXIO;
+		if (id->err_status & CDNS_I2C_IXR_NACK)
+			return -ENXIO;
 
-			return -EIO;
-		}
+		return -EIO;
 	}
 
 	return num;
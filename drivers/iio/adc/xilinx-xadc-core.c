@@ -23,6 +23,7 @@
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/sysfs.h>
+#include <linux/thermal.h>
 
 #include <linux/iio/buffer.h>
 #include <linux/iio/events.h>
@@ -84,6 +85,8 @@ static const unsigned int XADC_ZYNQ_UNMASK_TIMEOUT = 500;
 
 #define XADC_ZYNQ_CMD(cmd, addr, data) (((cmd) << 26) | ((addr) << 16) | (data))
 
+#define XADC_ZYNQ_FIFO_DEPTH		16
+
 /* AXI register definitions */
 #define XADC_AXI_REG_RESET		0x00
 #define XADC_AXI_REG_STATUS		0x04
@@ -102,6 +105,7 @@ static const unsigned int XADC_ZYNQ_UNMASK_TIMEOUT = 500;
 #define XADC_AXI_INT_ALARM_MASK		0x3c0f
 
 #define XADC_FLAGS_BUFFERED BIT(0)
+#define XADC_FLAGS_TRIGGERS BIT(1)
 
 static void xadc_write_reg(struct xadc *xadc, unsigned int reg,
 	uint32_t val)
@@ -122,7 +126,9 @@ static void xadc_read_reg(struct xadc *xadc, unsigned int reg,
  * result can be read from the data FIFO (DFIFO). The method currently used in
  * this driver is to submit the request for a read/write operation, then go to
  * sleep and wait for an interrupt that signals that a response is available in
- * the data FIFO.
+ * the data FIFO. Reads are pipelined, the response to a command is shifted out
+ * while the next command is processed, so batching several reads into a single
+ * request only costs one interrupt for the whole batch.
  */
 
 static void xadc_zynq_write_fifo(struct xadc *xadc, uint32_t *cmd,
@@ -190,44 +196,63 @@ static int xadc_zynq_write_adc_reg(struct xadc *xadc, unsigned int reg,
 	return ret;
 }
 
-static int xadc_zynq_read_adc_reg(struct xadc *xadc, unsigned int reg,
-	uint16_t *val)
+static int xadc_zynq_read_adc_regs(struct xadc *xadc, const unsigned int *regs,
+	unsigned int n, uint16_t *vals)
 {
-	uint32_t cmd[2];
+	uint32_t cmd[XADC_ZYNQ_FIFO_DEPTH];
+	unsigned int count, i;
 	uint32_t resp, tmp;
 	int ret;
 
-	cmd[0] = XADC_ZYNQ_CMD(XADC_ZYNQ_CMD_READ, reg, 0);
-	cmd[1] = XADC_ZYNQ_CMD(XADC_ZYNQ_CMD_NOP, 0, 0);
-
-	spin_lock_irq(&xadc->lock);
-	xadc_zynq_update_intmsk(xadc, XADC_ZYNQ_INT_DFIFO_GTH,
-			XADC_ZYNQ_INT_DFIFO_GTH);
-	xadc_zynq_drain_fifo(xadc);
-	reinit_completion(&xadc->completion);
-
-	xadc_zynq_write_fifo(xadc, cmd, ARRAY_SIZE(cmd));
-	xadc_read_reg(xadc, XADC_ZYNQ_REG_CFG, &tmp);
-	tmp &= ~XADC_ZYNQ_CFG_DFIFOTH_MASK;
-	tmp |= 1 << XADC_ZYNQ_CFG_DFIFOTH_OFFSET;
-	xadc_write_reg(xadc, XADC_ZYNQ_REG_CFG, tmp);
+	while (n) {
+		/* The trailing NOP shifts out the response to the last read. */
+		count = min_t(unsigned int, n, XADC_ZYNQ_FIFO_DEPTH - 1);
+		for (i = 0; i < count; i++)
+			cmd[i] = XADC_ZYNQ_CMD(XADC_ZYNQ_CMD_READ, regs[i], 0);
+		cmd[count] = XADC_ZYNQ_CMD(XADC_ZYNQ_CMD_NOP, 0, 0);
 
-	xadc_zynq_update_intmsk(xadc, XADC_ZYNQ_INT_DFIFO_GTH, 0);
-	spin_unlock_irq(&xadc->lock);
-	ret = wait_for_completion_interruptible_timeout(&xadc->completion, HZ);
-	if (ret == 0)
-		ret = -EIO;
-	if (ret < 0)
-		return ret;
+		spin_lock_irq(&xadc->lock);
+		xadc_zynq_update_intmsk(xadc, XADC_ZYNQ_INT_DFIFO_GTH,
+				XADC_ZYNQ_INT_DFIFO_GTH);
+		xadc_zynq_drain_fifo(xadc);
+		reinit_completion(&xadc->completion);
+
+		xadc_zynq_write_fifo(xadc, cmd, count + 1);
+		xadc_read_reg(xadc, XADC_ZYNQ_REG_CFG, &tmp);
+		tmp &= ~XADC_ZYNQ_CFG_DFIFOTH_MASK;
+		tmp |= count << XADC_ZYNQ_CFG_DFIFOTH_OFFSET;
+		xadc_write_reg(xadc, XADC_ZYNQ_REG_CFG, tmp);
+
+		xadc_zynq_update_intmsk(xadc, XADC_ZYNQ_INT_DFIFO_GTH, 0);
+		spin_unlock_irq(&xadc->lock);
+		ret = wait_for_completion_interruptible_timeout(
+				&xadc->completion, HZ);
+		if (ret == 0)
+			ret = -EIO;
+		if (ret < 0)
+			return ret;
 
-	xadc_read_reg(xadc, XADC_ZYNQ_REG_DFIFO, &resp);
-	xadc_read_reg(xadc, XADC_ZYNQ_REG_DFIFO, &resp);
+		/* Discard the response to the command before the first read */
+		xadc_read_reg(xadc, XADC_ZYNQ_REG_DFIFO, &resp);
+		for (i = 0; i < count; i++) {
+			xadc_read_reg(xadc, XADC_ZYNQ_REG_DFIFO, &resp);
+			vals[i] = resp & 0xffff;
+		}
 
-	*val = resp & 0xffff;
+		regs += count;
+		vals += count;
+		n -= count;
+	}
 
 	return 0;
 }
 
+static int xadc_zynq_read_adc_reg(struct xadc *xadc, unsigned int reg,
+	uint16_t *val)
+{
+	return xadc_zynq_read_adc_regs(xadc, &reg, 1, val);
+}
+
 static unsigned int xadc_zynq_transform_alarm(unsigned int alarm)
 {
 	return ((alarm & 0x80) >> 4) |
@@ -433,12 +458,14 @@ static void xadc_zynq_update_alarm(struct xadc *xadc, unsigned int alarm)
 
 static const struct xadc_ops xadc_zynq_ops = {
 	.read = xadc_zynq_read_adc_reg,
+	.read_multi = xadc_zynq_read_adc_regs,
 	.write = xadc_zynq_write_adc_reg,
 	.setup = xadc_zynq_setup,
 	.get_dclk_rate = xadc_zynq_get_dclk_rate,
 	.interrupt_handler = xadc_zynq_interrupt_handler,
 	.threaded_interrupt_handler = xadc_zynq_threaded_interrupt_handler,
 	.update_alarm = xadc_zynq_update_alarm,
+	.flags = XADC_FLAGS_BUFFERED,
 };
 
 static int xadc_axi_read_adc_reg(struct xadc *xadc, unsigned int reg,
@@ -540,7 +567,7 @@ static const struct xadc_ops xadc_axi_ops = {
 	.get_dclk_rate = xadc_axi_get_dclk,
 	.update_alarm = xadc_axi_update_alarm,
 	.interrupt_handler = xadc_axi_interrupt_handler,
-	.flags = XADC_FLAGS_BUFFERED,
+	.flags = XADC_FLAGS_BUFFERED | XADC_FLAGS_TRIGGERS,
 };
 
 static int _xadc_update_adc_reg(struct xadc *xadc, unsigned int reg,
@@ -573,22 +600,6 @@ static unsigned long xadc_get_dclk_rate(struct xadc *xadc)
 	return xadc->ops->get_dclk_rate(xadc);
 }
 
-static int xadc_update_scan_mode(struct iio_dev *indio_dev,
-	const unsigned long *mask)
-{
-	struct xadc *xadc = iio_priv(indio_dev);
-	unsigned int n;
-
-	n = bitmap_weight(mask, indio_dev->masklength);
-
-	kfree(xadc->data);
-	xadc->data = kcalloc(n, sizeof(*xadc->data), GFP_KERNEL);
-	if (!xadc->data)
-		return -ENOMEM;
-
-	return 0;
-}
-
 static unsigned int xadc_scan_index_to_channel(unsigned int scan_index)
 {
 	switch (scan_index) {
@@ -617,26 +628,54 @@ static unsigned int xadc_scan_index_to_channel(unsigned int scan_index)
 	}
 }
 
+static int xadc_update_scan_mode(struct iio_dev *indio_dev,
+	const unsigned long *mask)
+{
+	struct xadc *xadc = iio_priv(indio_dev);
+	unsigned int n;
+	int i, j;
+
+	n = bitmap_weight(mask, indio_dev->masklength);
+
+	kfree(xadc->data);
+	xadc->data = kcalloc(n, sizeof(*xadc->data), GFP_KERNEL);
+	if (!xadc->data)
+		return -ENOMEM;
+
+	kfree(xadc->scan_regs);
+	xadc->scan_regs = kcalloc(n, sizeof(*xadc->scan_regs), GFP_KERNEL);
+	if (!xadc->scan_regs) {
+		kfree(xadc->data);
+		xadc->data = NULL;
+		return -ENOMEM;
+	}
+
+	j = 0;
+	for_each_set_bit(i, mask, indio_dev->masklength)
+		xadc->scan_regs[j++] = xadc_scan_index_to_channel(i);
+
+	return 0;
+}
+
 static irqreturn_t xadc_trigger_handler(int irq, void *p)
 {
 	struct iio_poll_func *pf = p;
 	struct iio_dev *indio_dev = pf->indio_dev;
 	struct xadc *xadc = iio_priv(indio_dev);
-	unsigned int chan;
-	int i, j;
+	unsigned int n;
+	int ret;
 
 	if (!xadc->data)
 		goto out;
 
-	j = 0;
-	for_each_set_bit(i, indio_dev->active_scan_mask,
-		indio_dev->masklength) {
-		chan = xadc_scan_index_to_channel(i);
-		xadc_read_adc_reg(xadc, chan, &xadc->data[j]);
-		j++;
-	}
+	n = bitmap_weight(indio_dev->active_scan_mask, indio_dev->masklength);
+
+	mutex_lock(&xadc->mutex);
+	ret = _xadc_read_adc_regs(xadc, xadc->scan_regs, n, xadc->data);
+	mutex_unlock(&xadc->mutex);
 
-	iio_push_to_buffers(indio_dev, xadc->data);
+	if (!ret)
+		iio_push_to_buffers(indio_dev, xadc->data);
 
 out:
 	iio_trigger_notify_done(indio_dev->trig);
@@ -897,6 +936,26 @@ static int xadc_read_raw(struct iio_dev *indio_dev,
 	}
 }
 
+static int xadc_get_temp(void *data, long *temp)
+{
+	struct xadc *xadc = data;
+	uint16_t val16;
+	int ret;
+
+	/*
+	 * Unlike xadc_read_raw() this doesn't back off in buffered mode,
+	 * the register keeps the result of the last temperature conversion.
+	 */
+	ret = xadc_read_adc_reg(xadc, XADC_REG_TEMP, &val16);
+	if (ret < 0)
+		return ret;
+
+	/* Temp in mC = (val * 503975) / 4096 - 273150 */
+	*temp = ((val16 >> 4) * 503975) / 4096 - 273150;
+
+	return 0;
+}
+
 static int xadc_write_raw(struct iio_dev *indio_dev,
 	struct iio_chan_spec const *chan, int val, int val2, long info)
 {
@@ -1199,7 +1258,13 @@ static int xadc_probe(struct platform_device *pdev)
 			&xadc_buffer_ops);
 		if (ret)
 			goto err_device_free;
+	}
 
+	/*
+	 * Only the AXI interface signals the end of a sequence, buffered
+	 * capture through the ZYNQ interface relies on external triggers.
+	 */
+	if (xadc->ops->flags & XADC_FLAGS_TRIGGERS) {
 		xadc->convst_trigger = xadc_alloc_trigger(indio_dev, "convst");
 		if (IS_ERR(xadc->convst_trigger)) {
 			ret = PTR_ERR(xadc->convst_trigger);
@@ -1279,15 +1344,21 @@ static int xadc_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, indio_dev);
 
+	/* Only there if the device tree has a thermal zone for the XADC */
+	xadc->tzd = thermal_zone_of_sensor_register(&pdev->dev, 0, xadc,
+						    xadc_get_temp, NULL);
+	if (IS_ERR(xadc->tzd))
+		xadc->tzd = NULL;
+
 	return 0;
 
 err_free_irq:
 	free_irq(irq, indio_dev);
 err_free_samplerate_trigger:
-	if (xadc->ops->flags & XADC_FLAGS_BUFFERED)
+	if (xadc->ops->flags & XADC_FLAGS_TRIGGERS)
 		iio_trigger_free(xadc->samplerate_trigger);
 err_free_convst_trigger:
-	if (xadc->ops->flags & XADC_FLAGS_BUFFERED)
+	if (xadc->ops->flags & XADC_FLAGS_TRIGGERS)
 		iio_trigger_free(xadc->convst_trigger);
 err_triggered_buffer_cleanup:
 	if (xadc->ops->flags & XADC_FLAGS_BUFFERED)
@@ -1306,16 +1377,19 @@ static int xadc_remove(struct platform_device *pdev)
 	struct xadc *xadc = iio_priv(indio_dev);
 	int irq = platform_get_irq(pdev, 0);
 
+	thermal_zone_of_sensor_unregister(&pdev->dev, xadc->tzd);
 	iio_device_unregister(indio_dev);
-	if (xadc->ops->flags & XADC_FLAGS_BUFFERED) {
+	if (xadc->ops->flags & XADC_FLAGS_TRIGGERS) {
 		iio_trigger_free(xadc->samplerate_trigger);
 		iio_trigger_free(xadc->convst_trigger);
-		iio_triggered_buffer_cleanup(indio_dev);
 	}
+	if (xadc->ops->flags & XADC_FLAGS_BUFFERED)
+		iio_triggered_buffer_cleanup(indio_dev);
 	free_irq(irq, indio_dev);
 	clk_disable_unprepare(xadc->clk);
 	cancel_delayed_work(&xadc->zynq_unmask_work);
 	kfree(xadc->data);
+	kfree(xadc->scan_regs);
 	kfree(indio_dev->channels);
 
 	return 0;
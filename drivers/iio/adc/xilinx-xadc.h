@@ -18,6 +18,7 @@ struct iio_dev;
 struct clk;
 struct xadc_ops;
 struct platform_device;
+struct thermal_zone_device;
 
 void xadc_handle_events(struct iio_dev *indio_dev, unsigned long events);
 
@@ -53,6 +54,7 @@ struct xadc {
 	unsigned int alarm_mask;
 
 	uint16_t *data;
+	unsigned int *scan_regs;
 
 	struct iio_trigger *trigger;
 	struct iio_trigger *convst_trigger;
@@ -69,10 +71,14 @@ struct xadc {
 	spinlock_t lock;
 
 	struct completion completion;
+
+	struct thermal_zone_device *tzd;
 };
 
 struct xadc_ops {
 	int (*read)(struct xadc *, unsigned int, uint16_t *);
+	int (*read_multi)(struct xadc *, const unsigned int *, unsigned int,
+			uint16_t *);
 	int (*write)(struct xadc *, unsigned int, uint16_t);
 	int (*setup)(struct platform_device *pdev, struct iio_dev *indio_dev,
 			int irq);
@@ -91,6 +97,30 @@ static inline int _xadc_read_adc_reg(struct xadc *xadc, unsigned int reg,
 	return xadc->ops->read(xadc, reg, val);
 }
 
+/*
+ * Read several registers in one go. Interfaces with a high per access overhead
+ * implement read_multi to batch the accesses.
+ */
+static inline int _xadc_read_adc_regs(struct xadc *xadc,
+	const unsigned int *regs, unsigned int n, uint16_t *vals)
+{
+	unsigned int i;
+	int ret;
+
+	lockdep_assert_held(&xadc->mutex);
+
+	if (xadc->ops->read_multi)
+		return xadc->ops->read_multi(xadc, regs, n, vals);
+
+	for (i = 0; i < n; i++) {
+		ret = xadc->ops->read(xadc, regs[i], &vals[i]);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 static inline int _xadc_write_adc_reg(struct xadc *xadc, unsigned int reg,
 	uint16_t val)
 {
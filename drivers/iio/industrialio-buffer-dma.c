@@ -0,0 +1,814 @@
+/* The industrial I/O - DMA based buffer support
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * The buffer is made of blocks of DMA coherent memory that are handed over to
+ * the DMA controller one at a time and filled without any CPU intervention.
+ *
+ * Userspace either reads the samples with read(), in which case the queue
+ * allocates two blocks and copies their data, or allocates its own blocks,
+ * mmaps them and cycles them through the enqueue and dequeue ioctls. In the
+ * second case the sample data is never touched by the CPU.
+ *
+ * Block states:
+ *
+ *   DEQUEUED --enqueue--> QUEUED --enable--> ACTIVE --done--> DONE
+ *      ^                                                       |
+ *      +------------------------dequeue------------------------+
+ *
+ * Blocks enqueued while the buffer is enabled go straight to ACTIVE.
+ */
+
+#include <linux/dma-mapping.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/buffer-dma.h>
+
+#define IIO_DMA_BUFFER_MAX_BLOCKS	32
+#define IIO_DMA_BUFFER_MAX_BLOCK_SIZE	SZ_64M
+
+static struct iio_dma_buffer_queue *iio_buffer_to_queue(struct iio_buffer *buf)
+{
+	return container_of(buf, struct iio_dma_buffer_queue, buffer);
+}
+
+static void iio_dma_buffer_block_release(struct kref *kref)
+{
+	struct iio_dma_buffer_block *block = container_of(kref,
+		struct iio_dma_buffer_block, kref);
+
+	dma_free_coherent(block->queue->dev, PAGE_ALIGN(block->size),
+		block->vaddr, block->phys_addr);
+	kfree(block);
+}
+
+static void iio_dma_buffer_block_get(struct iio_dma_buffer_block *block)
+{
+	kref_get(&block->kref);
+}
+
+static void iio_dma_buffer_block_put(struct iio_dma_buffer_block *block)
+{
+	kref_put(&block->kref, iio_dma_buffer_block_release);
+}
+
+static struct iio_dma_buffer_block *iio_dma_buffer_alloc_block(
+	struct iio_dma_buffer_queue *queue, size_t size)
+{
+	struct iio_dma_buffer_block *block;
+
+	block = kzalloc(sizeof(*block), GFP_KERNEL);
+	if (!block)
+		return NULL;
+
+	block->vaddr = dma_alloc_coherent(queue->dev, PAGE_ALIGN(size),
+		&block->phys_addr, GFP_KERNEL);
+	if (!block->vaddr) {
+		kfree(block);
+		return NULL;
+	}
+
+	block->size = size;
+	block->state = IIO_BLOCK_STATE_DEQUEUED;
+	block->queue = queue;
+	INIT_LIST_HEAD(&block->head);
+	kref_init(&block->kref);
+
+	return block;
+}
+
+/* Must be called with the queue lock held while the buffer is disabled. */
+static void __iio_dma_buffer_free_blocks(struct iio_dma_buffer_queue *queue)
+{
+	unsigned int i;
+
+	spin_lock_irq(&queue->list_lock);
+	INIT_LIST_HEAD(&queue->incoming);
+	INIT_LIST_HEAD(&queue->outgoing);
+	spin_unlock_irq(&queue->list_lock);
+
+	for (i = 0; i < queue->num_blocks; i++)
+		iio_dma_buffer_block_put(queue->blocks[i]);
+
+	kfree(queue->blocks);
+	queue->blocks = NULL;
+	queue->num_blocks = 0;
+	queue->fileio = false;
+	queue->fileio_pos = 0;
+}
+
+/*
+ * Must be called with the queue lock held while the buffer is disabled.
+ * Returns the number of blocks that could be allocated.
+ */
+static int __iio_dma_buffer_alloc_blocks(struct iio_dma_buffer_queue *queue,
+	size_t size, unsigned int count)
+{
+	struct iio_dma_buffer_block *block;
+	unsigned int i;
+
+	__iio_dma_buffer_free_blocks(queue);
+
+	queue->blocks = kcalloc(count, sizeof(*queue->blocks), GFP_KERNEL);
+	if (!queue->blocks)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		block = iio_dma_buffer_alloc_block(queue, size);
+		if (!block)
+			break;
+
+		block->id = i;
+		block->offset = i * PAGE_ALIGN(size);
+		queue->blocks[i] = block;
+	}
+
+	queue->num_blocks = i;
+	if (!i) {
+		__iio_dma_buffer_free_blocks(queue);
+		return -ENOMEM;
+	}
+
+	return i;
+}
+
+/* Must be called with the queue list_lock held, 0 marks the data as invalid */
+static void _iio_dma_buffer_block_done(struct iio_dma_buffer_block *block,
+	s64 timestamp)
+{
+	struct iio_dma_buffer_queue *queue = block->queue;
+
+	if (!timestamp)
+		block->bytes_used = 0;
+	block->timestamp = timestamp;
+	block->state = IIO_BLOCK_STATE_DONE;
+	list_add_tail(&block->head, &queue->outgoing);
+}
+
+/**
+ * iio_dma_buffer_block_done() - Indicate that a block has been completed
+ * @block: The completed block
+ *
+ * Should be called by the DMA controller driver from its completion callback,
+ * after it has removed the block from its own lists.
+ */
+void iio_dma_buffer_block_done(struct iio_dma_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = block->queue;
+	unsigned long flags;
+
+	spin_lock_irqsave(&queue->list_lock, flags);
+	_iio_dma_buffer_block_done(block, iio_get_time_ns());
+	spin_unlock_irqrestore(&queue->list_lock, flags);
+
+	wake_up_interruptible_poll(&queue->buffer.pollq, POLLIN | POLLRDNORM);
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_block_done);
+
+/**
+ * iio_dma_buffer_block_list_abort() - Indicate that a list of blocks has been
+ *   aborted
+ * @queue: Queue for which to complete blocks.
+ * @list: List of aborted blocks. All blocks in this list must be from @queue.
+ *
+ * Typically called from the abort() callback after the DMA controller has been
+ * stopped. The blocks are handed back to userspace without any data.
+ */
+void iio_dma_buffer_block_list_abort(struct iio_dma_buffer_queue *queue,
+	struct list_head *list)
+{
+	struct iio_dma_buffer_block *block, *_block;
+	unsigned long flags;
+
+	spin_lock_irqsave(&queue->list_lock, flags);
+	list_for_each_entry_safe(block, _block, list, head) {
+		list_del(&block->head);
+		_iio_dma_buffer_block_done(block, 0);
+	}
+	spin_unlock_irqrestore(&queue->list_lock, flags);
+
+	wake_up_interruptible_poll(&queue->buffer.pollq, POLLIN | POLLRDNORM);
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_block_list_abort);
+
+/* Must be called with the queue lock held. */
+static void iio_dma_buffer_submit_block(struct iio_dma_buffer_queue *queue,
+	struct iio_dma_buffer_block *block)
+{
+	int ret;
+
+	spin_lock_irq(&queue->list_lock);
+	block->state = IIO_BLOCK_STATE_ACTIVE;
+	spin_unlock_irq(&queue->list_lock);
+
+	ret = queue->ops->submit(queue, block);
+	if (ret) {
+		/*
+		 * There is no way to report the error for a single block, hand
+		 * it back without data so that userspace notices.
+		 */
+		spin_lock_irq(&queue->list_lock);
+		_iio_dma_buffer_block_done(block, 0);
+		spin_unlock_irq(&queue->list_lock);
+
+		wake_up_interruptible_poll(&queue->buffer.pollq,
+			POLLIN | POLLRDNORM);
+	}
+}
+
+/* Must be called with the queue lock held. */
+static void iio_dma_buffer_enqueue(struct iio_dma_buffer_queue *queue,
+	struct iio_dma_buffer_block *block)
+{
+	if (queue->active) {
+		iio_dma_buffer_submit_block(queue, block);
+		return;
+	}
+
+	spin_lock_irq(&queue->list_lock);
+	block->state = IIO_BLOCK_STATE_QUEUED;
+	list_add_tail(&block->head, &queue->incoming);
+	spin_unlock_irq(&queue->list_lock);
+}
+
+static struct iio_dma_buffer_block *iio_dma_buffer_dequeue(
+	struct iio_dma_buffer_queue *queue)
+{
+	struct iio_dma_buffer_block *block;
+
+	spin_lock_irq(&queue->list_lock);
+	block = list_first_entry_or_null(&queue->outgoing,
+		struct iio_dma_buffer_block, head);
+	if (block) {
+		list_del(&block->head);
+		block->state = IIO_BLOCK_STATE_DEQUEUED;
+	}
+	spin_unlock_irq(&queue->list_lock);
+
+	return block;
+}
+
+/**
+ * iio_dma_buffer_request_update() - DMA buffer request_update callback
+ * @buffer: The buffer which to request an update
+ *
+ * Should be used as the request_update callback of the iio_buffer_access_funcs
+ * of DMA buffers. Without blocks allocated by userspace, allocates two blocks
+ * covering the buffer length for read().
+ */
+int iio_dma_buffer_request_update(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	size_t size;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->num_blocks && !queue->fileio)
+		goto out_unlock;
+
+	size = DIV_ROUND_UP(queue->buffer.length, 2) *
+		queue->buffer.bytes_per_datum;
+	if (!size || size > IIO_DMA_BUFFER_MAX_BLOCK_SIZE) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	ret = __iio_dma_buffer_alloc_blocks(queue, size, 2);
+	if (ret < 0)
+		goto out_unlock;
+
+	queue->fileio = true;
+	ret = 0;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_request_update);
+
+/**
+ * iio_dma_buffer_enable() - Enable DMA buffer
+ * @buffer: IIO buffer to enable
+ * @indio_dev: IIO device the buffer is attached to
+ *
+ * Needs to be called when the device that the buffer is attached to starts
+ * sampling. Typically should be the iio_buffer_access_funcs enable callback.
+ */
+int iio_dma_buffer_enable(struct iio_buffer *buffer,
+	struct iio_dev *indio_dev)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block, *_block;
+	LIST_HEAD(incoming);
+	unsigned int i;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->fileio) {
+		for (i = 0; i < queue->num_blocks; i++) {
+			block = queue->blocks[i];
+			if (block->state == IIO_BLOCK_STATE_DEQUEUED)
+				iio_dma_buffer_enqueue(queue, block);
+		}
+	}
+
+	queue->active = true;
+
+	spin_lock_irq(&queue->list_lock);
+	list_splice_tail_init(&queue->incoming, &incoming);
+	spin_unlock_irq(&queue->list_lock);
+
+	list_for_each_entry_safe(block, _block, &incoming, head) {
+		list_del(&block->head);
+		iio_dma_buffer_submit_block(queue, block);
+	}
+
+	mutex_unlock(&queue->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_enable);
+
+/**
+ * iio_dma_buffer_disable() - Disable DMA buffer
+ * @buffer: IIO DMA buffer to disable
+ * @indio_dev: IIO device the buffer is attached to
+ *
+ * Needs to be called when the device that the buffer is attached to stops
+ * sampling. Typically should be the iio_buffer_access_funcs disable callback.
+ */
+int iio_dma_buffer_disable(struct iio_buffer *buffer,
+	struct iio_dev *indio_dev)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+
+	mutex_lock(&queue->lock);
+	queue->active = false;
+
+	if (queue->ops && queue->ops->abort)
+		queue->ops->abort(queue);
+	mutex_unlock(&queue->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_disable);
+
+/**
+ * iio_dma_buffer_read() - DMA buffer read callback
+ * @buffer: Buffer to read from
+ * @n: Number of bytes to read
+ * @user_buffer: Userspace buffer to copy the data to
+ *
+ * Should be used as the read_first_n callback for iio_buffer_access_funcs
+ * struct for DMA buffers.
+ */
+int iio_dma_buffer_read(struct iio_buffer *buffer, size_t n,
+	char __user *user_buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block;
+	int ret;
+
+	if (n < buffer->bytes_per_datum)
+		return -EINVAL;
+
+	mutex_lock(&queue->lock);
+
+	/* read() is not available while userspace owns the blocks. */
+	if (!queue->fileio) {
+		ret = queue->num_blocks ? -EBUSY : 0;
+		goto out_unlock;
+	}
+
+	spin_lock_irq(&queue->list_lock);
+	block = list_first_entry_or_null(&queue->outgoing,
+		struct iio_dma_buffer_block, head);
+	spin_unlock_irq(&queue->list_lock);
+
+	if (!block) {
+		ret = 0;
+		goto out_unlock;
+	}
+
+	n = rounddown(n, buffer->bytes_per_datum);
+	if (n > block->bytes_used - queue->fileio_pos)
+		n = block->bytes_used - queue->fileio_pos;
+
+	if (copy_to_user(user_buffer, block->vaddr + queue->fileio_pos, n)) {
+		ret = -EFAULT;
+		goto out_unlock;
+	}
+
+	queue->fileio_pos += n;
+	if (queue->fileio_pos == block->bytes_used) {
+		iio_dma_buffer_dequeue(queue);
+		queue->fileio_pos = 0;
+		iio_dma_buffer_enqueue(queue, block);
+	}
+
+	ret = n;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_read);
+
+/**
+ * iio_dma_buffer_data_available() - DMA buffer data_available callback
+ * @buffer: Buffer to check for data availability
+ *
+ * Should be used as the data_available callback for iio_buffer_access_funcs
+ * struct for DMA buffers. Reports whether a completed block is available.
+ */
+bool iio_dma_buffer_data_available(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	bool available;
+
+	spin_lock_irq(&queue->list_lock);
+	available = !list_empty(&queue->outgoing);
+	spin_unlock_irq(&queue->list_lock);
+
+	return available;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_data_available);
+
+/**
+ * iio_dma_buffer_get_bytes_per_datum() - DMA buffer get_bytes_per_datum
+ * @buffer: Buffer to query
+ */
+int iio_dma_buffer_get_bytes_per_datum(struct iio_buffer *buffer)
+{
+	return buffer->bytes_per_datum;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_get_bytes_per_datum);
+
+/**
+ * iio_dma_buffer_set_bytes_per_datum() - DMA buffer set_bytes_per_datum
+ * @buffer: Buffer to set the bytes-per-datum for
+ * @bpd: The new bytes-per-datum value
+ */
+int iio_dma_buffer_set_bytes_per_datum(struct iio_buffer *buffer, size_t bpd)
+{
+	buffer->bytes_per_datum = bpd;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_set_bytes_per_datum);
+
+/**
+ * iio_dma_buffer_get_length() - DMA buffer get_length callback
+ * @buffer: Buffer to query
+ */
+int iio_dma_buffer_get_length(struct iio_buffer *buffer)
+{
+	return buffer->length;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_get_length);
+
+/**
+ * iio_dma_buffer_set_length() - DMA buffer set_length callback
+ * @buffer: Buffer to set the length for
+ * @length: The new buffer length
+ *
+ * The length only sizes the blocks used for read().
+ */
+int iio_dma_buffer_set_length(struct iio_buffer *buffer, int length)
+{
+	/* Avoid an invalid state */
+	if (length < 2)
+		length = 2;
+	buffer->length = length;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_set_length);
+
+/**
+ * iio_dma_buffer_alloc_blocks() - DMA buffer alloc_blocks callback
+ * @buffer: Buffer to allocate the blocks for
+ * @req: Allocation request, updated with the allocated blocks
+ *
+ * Replaces the current blocks, a request for zero blocks frees them.
+ */
+int iio_dma_buffer_alloc_blocks(struct iio_buffer *buffer,
+	struct iio_buffer_block_alloc_req *req)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	unsigned int count;
+	int ret;
+
+	if (req->type)
+		return -EINVAL;
+
+	if (req->count && (!req->size ||
+			   req->size > IIO_DMA_BUFFER_MAX_BLOCK_SIZE))
+		return -EINVAL;
+
+	count = min_t(unsigned int, req->count, IIO_DMA_BUFFER_MAX_BLOCKS);
+
+	mutex_lock(&queue->lock);
+
+	if (!count) {
+		__iio_dma_buffer_free_blocks(queue);
+		ret = 0;
+		goto out_unlock;
+	}
+
+	ret = __iio_dma_buffer_alloc_blocks(queue, req->size, count);
+	if (ret < 0)
+		goto out_unlock;
+
+	req->count = ret;
+	req->id = 0;
+	ret = 0;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_alloc_blocks);
+
+/**
+ * iio_dma_buffer_free_blocks() - DMA buffer free_blocks callback
+ * @buffer: Buffer to free the blocks of
+ *
+ * Mapped blocks stay valid until they are unmapped.
+ */
+int iio_dma_buffer_free_blocks(struct iio_buffer *buffer)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+
+	mutex_lock(&queue->lock);
+	__iio_dma_buffer_free_blocks(queue);
+	mutex_unlock(&queue->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_free_blocks);
+
+static void iio_dma_buffer_fill_block(struct iio_buffer_block *block,
+	struct iio_dma_buffer_block *dma_block)
+{
+	block->id = dma_block->id;
+	block->size = dma_block->size;
+	block->bytes_used = dma_block->bytes_used;
+	block->type = 0;
+	block->flags = dma_block->timestamp ?
+		IIO_BUFFER_BLOCK_FLAG_TIMESTAMP_VALID : 0;
+	block->data.offset = dma_block->offset;
+	block->timestamp = dma_block->timestamp;
+}
+
+/* Must be called with the queue lock held. */
+static struct iio_dma_buffer_block *iio_dma_buffer_lookup(
+	struct iio_dma_buffer_queue *queue, unsigned int id)
+{
+	/* The blocks used for read() are not exposed to userspace. */
+	if (queue->fileio || id >= queue->num_blocks)
+		return NULL;
+
+	return queue->blocks[id];
+}
+
+/**
+ * iio_dma_buffer_query_block() - DMA buffer query_block callback
+ * @buffer: Buffer the block belongs to
+ * @block: Block to describe, identified by its id
+ */
+int iio_dma_buffer_query_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *dma_block;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	dma_block = iio_dma_buffer_lookup(queue, block->id);
+	if (dma_block)
+		iio_dma_buffer_fill_block(block, dma_block);
+	else
+		ret = -EINVAL;
+
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_query_block);
+
+/**
+ * iio_dma_buffer_enqueue_block() - DMA buffer enqueue_block callback
+ * @buffer: Buffer the block belongs to
+ * @block: Block to hand over to the buffer, identified by its id
+ */
+int iio_dma_buffer_enqueue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *dma_block;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	dma_block = iio_dma_buffer_lookup(queue, block->id);
+	if (!dma_block || dma_block->state != IIO_BLOCK_STATE_DEQUEUED) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	iio_dma_buffer_enqueue(queue, dma_block);
+	iio_dma_buffer_fill_block(block, dma_block);
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_enqueue_block);
+
+/**
+ * iio_dma_buffer_dequeue_block() - DMA buffer dequeue_block callback
+ * @buffer: Buffer to take the oldest completed block from
+ * @block: Filled with the description of the block
+ *
+ * Returns -EAGAIN when no block has been completed.
+ */
+int iio_dma_buffer_dequeue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *dma_block;
+	int ret = 0;
+
+	mutex_lock(&queue->lock);
+
+	if (queue->fileio) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	dma_block = iio_dma_buffer_dequeue(queue);
+	if (dma_block)
+		iio_dma_buffer_fill_block(block, dma_block);
+	else
+		ret = -EAGAIN;
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_dequeue_block);
+
+static void iio_dma_buffer_vm_open(struct vm_area_struct *vma)
+{
+	struct iio_dma_buffer_block *block = vma->vm_private_data;
+
+	iio_buffer_get(&block->queue->buffer);
+	iio_dma_buffer_block_get(block);
+}
+
+static void iio_dma_buffer_vm_close(struct vm_area_struct *vma)
+{
+	struct iio_dma_buffer_block *block = vma->vm_private_data;
+	struct iio_buffer *buffer = &block->queue->buffer;
+
+	/* The block memory is freed through the queue device. */
+	iio_dma_buffer_block_put(block);
+	iio_buffer_put(buffer);
+}
+
+static const struct vm_operations_struct iio_dma_buffer_vm_ops = {
+	.open = iio_dma_buffer_vm_open,
+	.close = iio_dma_buffer_vm_close,
+};
+
+/**
+ * iio_dma_buffer_mmap() - DMA buffer mmap callback
+ * @buffer: Buffer the block to map belongs to
+ * @vma: Mapping, its offset selects the block
+ */
+int iio_dma_buffer_mmap(struct iio_buffer *buffer,
+	struct vm_area_struct *vma)
+{
+	struct iio_dma_buffer_queue *queue = iio_buffer_to_queue(buffer);
+	struct iio_dma_buffer_block *block = NULL;
+	unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned int i;
+	int ret;
+
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	mutex_lock(&queue->lock);
+
+	for (i = 0; i < queue->num_blocks && !queue->fileio; i++) {
+		if (queue->blocks[i]->offset == offset) {
+			block = queue->blocks[i];
+			break;
+		}
+	}
+
+	if (!block || size > PAGE_ALIGN(block->size)) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	/* The offset only selects the block, map it from its start. */
+	vma->vm_pgoff = 0;
+	ret = dma_mmap_coherent(queue->dev, vma, block->vaddr,
+		block->phys_addr, size);
+	if (ret)
+		goto out_unlock;
+
+	vma->vm_ops = &iio_dma_buffer_vm_ops;
+	vma->vm_private_data = block;
+	iio_dma_buffer_vm_open(vma);
+
+out_unlock:
+	mutex_unlock(&queue->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_mmap);
+
+/**
+ * iio_dma_buffer_init() - Initialize DMA buffer queue
+ * @queue: Buffer to initialize
+ * @dev: DMA device
+ * @ops: DMA buffer queue callback operations
+ *
+ * The DMA device will be used by the queue to do DMA memory allocations. So it
+ * should refer to the device that will perform the DMA to ensure that
+ * allocations are done from a memory region that can be accessed by the device.
+ */
+int iio_dma_buffer_init(struct iio_dma_buffer_queue *queue,
+	struct device *dev, const struct iio_dma_buffer_ops *ops)
+{
+	iio_buffer_init(&queue->buffer);
+	queue->buffer.length = 2;
+
+	queue->dev = get_device(dev);
+	queue->ops = ops;
+
+	INIT_LIST_HEAD(&queue->incoming);
+	INIT_LIST_HEAD(&queue->outgoing);
+
+	mutex_init(&queue->lock);
+	spin_lock_init(&queue->list_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_init);
+
+/**
+ * iio_dma_buffer_exit() - Cleanup DMA buffer queue
+ * @queue: Buffer to cleanup
+ *
+ * After this function has completed it is safe to free any resources that are
+ * associated with the buffer and are accessed inside the callback operations.
+ */
+void iio_dma_buffer_exit(struct iio_dma_buffer_queue *queue)
+{
+	mutex_lock(&queue->lock);
+	__iio_dma_buffer_free_blocks(queue);
+	queue->ops = NULL;
+	mutex_unlock(&queue->lock);
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_exit);
+
+/**
+ * iio_dma_buffer_release() - Release final buffer resources
+ * @queue: Buffer to release
+ *
+ * Frees resources that can't yet be freed in iio_dma_buffer_exit(). Should be
+ * called in the buffers release callback implementation right before freeing
+ * the memory associated with the buffer.
+ */
+void iio_dma_buffer_release(struct iio_dma_buffer_queue *queue)
+{
+	mutex_destroy(&queue->lock);
+	put_device(queue->dev);
+}
+EXPORT_SYMBOL_GPL(iio_dma_buffer_release);
+
+MODULE_DESCRIPTION("DMA buffer for the IIO framework");
+MODULE_LICENSE("GPL v2");
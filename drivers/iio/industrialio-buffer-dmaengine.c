@@ -0,0 +1,256 @@
+/* The industrial I/O - DMA engine based buffer support
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * Every block is transferred by a single DEV_TO_MEM slave transfer, split in
+ * segments the DMA controller can handle. Blocks are used instead of a cyclic
+ * transfer so that completed blocks can be handed to userspace and refilled
+ * independently, without copying the sample data.
+ */
+
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+#include <linux/err.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/buffer-dma.h>
+#include <linux/iio/buffer-dmaengine.h>
+
+/**
+ * struct dmaengine_buffer - DMA engine buffer
+ * @queue: DMA buffer queue base structure
+ * @chan: DMA engine channel the blocks are transferred by
+ * @active: Blocks submitted to the channel, protected by the queue list_lock
+ * @align: Required alignment of the transfer size
+ * @max_seg_size: Maximum size of a transfer segment
+ */
+struct dmaengine_buffer {
+	struct iio_dma_buffer_queue queue;
+
+	struct dma_chan *chan;
+	struct list_head active;
+
+	size_t align;
+	size_t max_seg_size;
+};
+
+static struct dmaengine_buffer *iio_buffer_to_dmaengine_buffer(
+		struct iio_buffer *buffer)
+{
+	return container_of(buffer, struct dmaengine_buffer, queue.buffer);
+}
+
+static void iio_dmaengine_buffer_block_done(void *data)
+{
+	struct iio_dma_buffer_block *block = data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&block->queue->list_lock, flags);
+	list_del(&block->head);
+	spin_unlock_irqrestore(&block->queue->list_lock, flags);
+
+	iio_dma_buffer_block_done(block);
+}
+
+static int iio_dmaengine_buffer_submit_block(
+	struct iio_dma_buffer_queue *queue, struct iio_dma_buffer_block *block)
+{
+	struct dmaengine_buffer *dmaengine_buffer =
+		iio_buffer_to_dmaengine_buffer(&queue->buffer);
+	struct dma_async_tx_descriptor *desc;
+	struct scatterlist *sgl, *sg;
+	unsigned int nents, i;
+	dma_cookie_t cookie;
+	size_t len, offset;
+
+	len = rounddown(block->size, dmaengine_buffer->align);
+	if (!len)
+		return -EINVAL;
+
+	/* The block memory is already mapped, only describe its segments. */
+	nents = DIV_ROUND_UP(len, dmaengine_buffer->max_seg_size);
+	sgl = kcalloc(nents, sizeof(*sgl), GFP_KERNEL);
+	if (!sgl)
+		return -ENOMEM;
+
+	sg_init_table(sgl, nents);
+	offset = 0;
+	for_each_sg(sgl, sg, nents, i) {
+		size_t seg = min(len - offset, dmaengine_buffer->max_seg_size);
+
+		sg_dma_address(sg) = block->phys_addr + offset;
+		sg_dma_len(sg) = seg;
+		offset += seg;
+	}
+
+	desc = dmaengine_prep_slave_sg(dmaengine_buffer->chan, sgl, nents,
+		DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+	kfree(sgl);
+	if (!desc)
+		return -ENOMEM;
+
+	block->bytes_used = len;
+	desc->callback = iio_dmaengine_buffer_block_done;
+	desc->callback_param = block;
+
+	spin_lock_irq(&queue->list_lock);
+	list_add_tail(&block->head, &dmaengine_buffer->active);
+	spin_unlock_irq(&queue->list_lock);
+
+	cookie = dmaengine_submit(desc);
+	if (dma_submit_error(cookie)) {
+		spin_lock_irq(&queue->list_lock);
+		list_del(&block->head);
+		spin_unlock_irq(&queue->list_lock);
+		return dma_submit_error(cookie);
+	}
+
+	dma_async_issue_pending(dmaengine_buffer->chan);
+
+	return 0;
+}
+
+static void iio_dmaengine_buffer_abort(struct iio_dma_buffer_queue *queue)
+{
+	struct dmaengine_buffer *dmaengine_buffer =
+		iio_buffer_to_dmaengine_buffer(&queue->buffer);
+
+	dmaengine_terminate_all(dmaengine_buffer->chan);
+	iio_dma_buffer_block_list_abort(queue, &dmaengine_buffer->active);
+}
+
+static void iio_dmaengine_buffer_release(struct iio_buffer *buf)
+{
+	struct dmaengine_buffer *dmaengine_buffer =
+		iio_buffer_to_dmaengine_buffer(buf);
+
+	iio_dma_buffer_release(&dmaengine_buffer->queue);
+	kfree(dmaengine_buffer);
+}
+
+static IIO_BUFFER_ENABLE_ATTR;
+static IIO_BUFFER_LENGTH_ATTR;
+
+static struct attribute *iio_dmaengine_buffer_attributes[] = {
+	&dev_attr_length.attr,
+	&dev_attr_enable.attr,
+	NULL,
+};
+
+static struct attribute_group iio_dmaengine_buffer_attribute_group = {
+	.attrs = iio_dmaengine_buffer_attributes,
+	.name = "buffer",
+};
+
+static const struct iio_buffer_access_funcs iio_dmaengine_buffer_ops = {
+	.read_first_n = iio_dma_buffer_read,
+	.data_available = iio_dma_buffer_data_available,
+	.request_update = iio_dma_buffer_request_update,
+	.get_bytes_per_datum = iio_dma_buffer_get_bytes_per_datum,
+	.set_bytes_per_datum = iio_dma_buffer_set_bytes_per_datum,
+	.get_length = iio_dma_buffer_get_length,
+	.set_length = iio_dma_buffer_set_length,
+	.release = iio_dmaengine_buffer_release,
+
+	.enable = iio_dma_buffer_enable,
+	.disable = iio_dma_buffer_disable,
+
+	.alloc_blocks = iio_dma_buffer_alloc_blocks,
+	.free_blocks = iio_dma_buffer_free_blocks,
+	.query_block = iio_dma_buffer_query_block,
+	.enqueue_block = iio_dma_buffer_enqueue_block,
+	.dequeue_block = iio_dma_buffer_dequeue_block,
+	.mmap = iio_dma_buffer_mmap,
+};
+
+static const struct iio_dma_buffer_ops iio_dmaengine_default_ops = {
+	.submit = iio_dmaengine_buffer_submit_block,
+	.abort = iio_dmaengine_buffer_abort,
+};
+
+/**
+ * iio_dmaengine_buffer_alloc() - Allocate new buffer which uses DMAengine
+ * @dev: Parent device for the buffer
+ * @channel: DMA channel name, typically "rx".
+ *
+ * This allocates a new IIO buffer which internally uses the DMAengine framework
+ * to perform its transfers. The parent device will be used to request the DMA
+ * channel.
+ *
+ * Once done using the buffer iio_dmaengine_buffer_free() should be used to
+ * release it.
+ */
+struct iio_buffer *iio_dmaengine_buffer_alloc(struct device *dev,
+	const char *channel)
+{
+	struct dmaengine_buffer *dmaengine_buffer;
+	struct dma_slave_caps caps;
+	struct dma_chan *chan;
+	int ret;
+
+	dmaengine_buffer = kzalloc(sizeof(*dmaengine_buffer), GFP_KERNEL);
+	if (!dmaengine_buffer)
+		return ERR_PTR(-ENOMEM);
+
+	chan = dma_request_slave_channel_reason(dev, channel);
+	if (IS_ERR(chan)) {
+		ret = PTR_ERR(chan);
+		goto err_free;
+	}
+
+	/* Transfer whole words of the narrowest width the channel supports. */
+	ret = dma_get_slave_caps(chan, &caps);
+	if (ret == 0 && caps.src_addr_widths)
+		dmaengine_buffer->align = 1 << __ffs(caps.src_addr_widths);
+	else
+		dmaengine_buffer->align = sizeof(u32);
+
+	INIT_LIST_HEAD(&dmaengine_buffer->active);
+	dmaengine_buffer->chan = chan;
+	dmaengine_buffer->max_seg_size = rounddown(
+		dma_get_max_seg_size(chan->device->dev),
+		dmaengine_buffer->align);
+
+	iio_dma_buffer_init(&dmaengine_buffer->queue, chan->device->dev,
+		&iio_dmaengine_default_ops);
+
+	dmaengine_buffer->queue.buffer.attrs =
+		&iio_dmaengine_buffer_attribute_group;
+	dmaengine_buffer->queue.buffer.access = &iio_dmaengine_buffer_ops;
+
+	return &dmaengine_buffer->queue.buffer;
+
+err_free:
+	kfree(dmaengine_buffer);
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL_GPL(iio_dmaengine_buffer_alloc);
+
+/**
+ * iio_dmaengine_buffer_free() - Free dmaengine buffer
+ * @buffer: Buffer to free
+ *
+ * Frees a buffer previously allocated with iio_dmaengine_buffer_alloc().
+ */
+void iio_dmaengine_buffer_free(struct iio_buffer *buffer)
+{
+	struct dmaengine_buffer *dmaengine_buffer =
+		iio_buffer_to_dmaengine_buffer(buffer);
+
+	iio_dma_buffer_exit(&dmaengine_buffer->queue);
+	dma_release_channel(dmaengine_buffer->chan);
+
+	iio_buffer_put(buffer);
+}
+EXPORT_SYMBOL_GPL(iio_dmaengine_buffer_free);
+
+MODULE_DESCRIPTION("DMA engine buffer for the IIO framework");
+MODULE_LICENSE("GPL v2");
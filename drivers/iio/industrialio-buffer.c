@@ -21,6 +21,7 @@
 #include <linux/slab.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
+#include <linux/uaccess.h>
 
 #include <linux/iio/iio.h>
 #include "iio_core.h"
@@ -117,6 +118,136 @@ void iio_buffer_wakeup_poll(struct iio_dev *indio_dev)
 	wake_up(&indio_dev->buffer->pollq);
 }
 
+static int iio_buffer_dequeue_block(struct iio_dev *indio_dev,
+	struct file *filp, struct iio_buffer *rb,
+	struct iio_buffer_block __user *user_block)
+{
+	struct iio_buffer_block block;
+	int ret;
+
+	do {
+		if (!iio_buffer_data_available(rb)) {
+			if (filp->f_flags & O_NONBLOCK)
+				return -EAGAIN;
+
+			ret = wait_event_interruptible(rb->pollq,
+					iio_buffer_data_available(rb) ||
+					indio_dev->info == NULL);
+			if (ret)
+				return ret;
+			if (indio_dev->info == NULL)
+				return -ENODEV;
+		}
+
+		ret = rb->access->dequeue_block(rb, &block);
+	} while (ret == -EAGAIN && !(filp->f_flags & O_NONBLOCK));
+
+	if (ret)
+		return ret;
+
+	if (copy_to_user(user_block, &block, sizeof(block)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/*
+ * Blocks can only be allocated and freed while the buffer is disabled, the
+ * device mlock serializes this against enabling the buffer.
+ */
+static long iio_buffer_block_alloc_free(struct iio_dev *indio_dev,
+	struct iio_buffer *rb, unsigned int cmd, void __user *arg)
+{
+	struct iio_buffer_block_alloc_req req;
+	long ret;
+
+	if (cmd == IIO_BUFFER_BLOCK_ALLOC_IOCTL &&
+	    copy_from_user(&req, arg, sizeof(req)))
+		return -EFAULT;
+
+	mutex_lock(&indio_dev->mlock);
+	if (iio_buffer_is_active(rb)) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	if (cmd == IIO_BUFFER_BLOCK_FREE_IOCTL) {
+		ret = rb->access->free_blocks(rb);
+		goto out_unlock;
+	}
+
+	ret = rb->access->alloc_blocks(rb, &req);
+	if (ret == 0 && copy_to_user(arg, &req, sizeof(req)))
+		ret = -EFAULT;
+
+out_unlock:
+	mutex_unlock(&indio_dev->mlock);
+	return ret;
+}
+
+/**
+ * iio_buffer_ioctl() - chrdev ioctls for the buffer block interface
+ * @indio_dev:	the device the chrdev belongs to
+ * @filp:	the chrdev file
+ * @cmd:	the ioctl command
+ * @arg:	the ioctl argument
+ *
+ * Only buffers that implement the block access functions support these.
+ **/
+long iio_buffer_ioctl(struct iio_dev *indio_dev, struct file *filp,
+		      unsigned int cmd, unsigned long arg)
+{
+	struct iio_buffer *rb = indio_dev->buffer;
+	void __user *argp = (void __user *)arg;
+	struct iio_buffer_block block;
+	long ret;
+
+	if (!rb || !rb->access->alloc_blocks)
+		return -EINVAL;
+
+	switch (cmd) {
+	case IIO_BUFFER_BLOCK_ALLOC_IOCTL:
+	case IIO_BUFFER_BLOCK_FREE_IOCTL:
+		return iio_buffer_block_alloc_free(indio_dev, rb, cmd, argp);
+	case IIO_BUFFER_BLOCK_QUERY_IOCTL:
+	case IIO_BUFFER_BLOCK_ENQUEUE_IOCTL:
+		if (copy_from_user(&block, argp, sizeof(block)))
+			return -EFAULT;
+
+		if (cmd == IIO_BUFFER_BLOCK_QUERY_IOCTL)
+			ret = rb->access->query_block(rb, &block);
+		else
+			ret = rb->access->enqueue_block(rb, &block);
+		if (ret)
+			return ret;
+
+		if (copy_to_user(argp, &block, sizeof(block)))
+			return -EFAULT;
+		return 0;
+	case IIO_BUFFER_BLOCK_DEQUEUE_IOCTL:
+		return iio_buffer_dequeue_block(indio_dev, filp, rb, argp);
+	default:
+		return -EINVAL;
+	}
+}
+
+/**
+ * iio_buffer_mmap() - chrdev mmap for the buffer block interface
+ **/
+int iio_buffer_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct iio_dev *indio_dev = filp->private_data;
+	struct iio_buffer *rb = indio_dev->buffer;
+
+	if (!indio_dev->info)
+		return -ENODEV;
+
+	if (!rb || !rb->access->mmap)
+		return -ENODEV;
+
+	return rb->access->mmap(rb, vma);
+}
+
 void iio_buffer_init(struct iio_buffer *buffer)
 {
 	INIT_LIST_HEAD(&buffer->demux_list);
@@ -516,6 +647,49 @@ static void iio_buffer_deactivate(struct iio_buffer *buffer)
 	iio_buffer_put(buffer);
 }
 
+static int iio_buffer_enable(struct iio_buffer *buffer,
+	struct iio_dev *indio_dev)
+{
+	if (!buffer->access->enable)
+		return 0;
+	return buffer->access->enable(buffer, indio_dev);
+}
+
+static void iio_buffer_disable(struct iio_buffer *buffer,
+	struct iio_dev *indio_dev)
+{
+	if (buffer->access->disable)
+		buffer->access->disable(buffer, indio_dev);
+}
+
+static void iio_buffer_disable_all(struct iio_dev *indio_dev)
+{
+	struct iio_buffer *buffer;
+
+	list_for_each_entry(buffer, &indio_dev->buffer_list, buffer_list)
+		iio_buffer_disable(buffer, indio_dev);
+}
+
+static int iio_buffer_enable_all(struct iio_dev *indio_dev)
+{
+	struct iio_buffer *buffer;
+	int ret;
+
+	list_for_each_entry(buffer, &indio_dev->buffer_list, buffer_list) {
+		ret = iio_buffer_enable(buffer, indio_dev);
+		if (ret)
+			goto err_disable;
+	}
+
+	return 0;
+
+err_disable:
+	list_for_each_entry_continue_reverse(buffer, &indio_dev->buffer_list,
+					     buffer_list)
+		iio_buffer_disable(buffer, indio_dev);
+	return ret;
+}
+
 void iio_disable_all_buffers(struct iio_dev *indio_dev)
 {
 	struct iio_buffer *buffer, *_buffer;
@@ -526,6 +700,8 @@ void iio_disable_all_buffers(struct iio_dev *indio_dev)
 	if (indio_dev->setup_ops->predisable)
 		indio_dev->setup_ops->predisable(indio_dev);
 
+	iio_buffer_disable_all(indio_dev);
+
 	list_for_each_entry_safe(buffer, _buffer,
 			&indio_dev->buffer_list, buffer_list)
 		iio_buffer_deactivate(buffer);
@@ -569,6 +745,7 @@ static int __iio_update_buffers(struct iio_dev *indio_dev,
 			if (ret)
 				return ret;
 		}
+		iio_buffer_disable_all(indio_dev);
 		indio_dev->currentmode = INDIO_DIRECT_MODE;
 		if (indio_dev->setup_ops->postdisable) {
 			ret = indio_dev->setup_ops->postdisable(indio_dev);
@@ -685,11 +862,19 @@ static int __iio_update_buffers(struct iio_dev *indio_dev,
 		goto error_run_postdisable;
 	}
 
+	ret = iio_buffer_enable_all(indio_dev);
+	if (ret) {
+		printk(KERN_INFO
+		       "Buffer not started: buffer enable failed (%d)\n", ret);
+		goto error_disable_all_buffers;
+	}
+
 	if (indio_dev->setup_ops->postenable) {
 		ret = indio_dev->setup_ops->postenable(indio_dev);
 		if (ret) {
 			printk(KERN_INFO
 			       "Buffer not started: postenable failed (%d)\n", ret);
+			iio_buffer_disable_all(indio_dev);
 			indio_dev->currentmode = INDIO_DIRECT_MODE;
 			if (indio_dev->setup_ops->postdisable)
 				indio_dev->setup_ops->postdisable(indio_dev);
@@ -382,6 +382,19 @@ struct cached_dev {
 	unsigned		writeback_rate_update_seconds;
 	unsigned		writeback_rate_d_term;
 	unsigned		writeback_rate_p_term_inverse;
+
+	/*
+	 * If foreground reads that go to the backing device take longer than
+	 * this on average, writeback backs off. 0 disables it.
+	 */
+	unsigned		writeback_rate_latency_target_us;
+
+	/*
+	 * An ewma of the latency of those reads and when the last one
+	 * completed, updated without locking from bio completion.
+	 */
+	unsigned		backing_read_latency_us;
+	unsigned long		backing_read_last;
 };
 
 enum alloc_reserve {
@@ -368,6 +368,7 @@ static bool check_should_bypass(struct cached_dev *dc, struct bio *bio)
 	unsigned mode = cache_mode(dc, bio);
 	unsigned sectors, congested = bch_get_congested(c);
 	struct task_struct *task = current;
+	bool sequential = false;
 	struct io *i;
 
 	if (test_bit(BCACHE_DEV_DETACHING, &dc->disk.flags) ||
@@ -433,6 +434,7 @@ found:
 	if (dc->sequential_cutoff &&
 	    sectors >= dc->sequential_cutoff >> 9) {
 		trace_bcache_bypass_sequential(bio);
+		sequential = true;
 		goto skip;
 	}
 
@@ -445,7 +447,7 @@ rescale:
 	bch_rescale_priorities(c, bio_sectors(bio));
 	return false;
 skip:
-	bch_mark_sectors_bypassed(c, dc, bio_sectors(bio));
+	bch_mark_sectors_bypassed(c, dc, bio_sectors(bio), sequential);
 	return true;
 }
 
@@ -466,6 +468,7 @@ struct search {
 	unsigned		read_dirty_data:1;
 
 	unsigned long		start_time;
+	unsigned		start_time_us;
 
 	struct btree_op		op;
 	struct data_insert_op	iop;
@@ -656,6 +659,7 @@ static inline struct search *search_alloc(struct bio *bio,
 	s->write		= (bio->bi_rw & REQ_WRITE) != 0;
 	s->read_dirty_data	= 0;
 	s->start_time		= jiffies;
+	s->start_time_us	= local_clock_us();
 
 	s->iop.c		= d->c;
 	s->iop.bio		= NULL;
@@ -770,6 +774,9 @@ static void cached_dev_read_done_bh(struct closure *cl)
 				  !s->cache_miss, s->iop.bypass);
 	trace_bcache_read(s->orig_bio, !s->cache_miss, s->iop.bypass);
 
+	if (s->cache_miss || s->iop.bypass)
+		bch_backing_read_done(dc, local_clock_us() - s->start_time_us);
+
 	if (s->iop.error)
 		continue_at_nobarrier(cl, cached_dev_read_error, bcache_wq);
 	else if (s->iop.bio || verify(dc, &s->bio.bio))
@@ -834,6 +841,7 @@ static int cached_dev_cache_miss(struct btree *b, struct search *s,
 
 	if (reada)
 		bch_mark_cache_readahead(s->iop.c, s->d);
+	bch_mark_cache_promotion(s->iop.c, s->d);
 
 	s->cache_miss	= miss;
 	s->iop.bio	= cache_bio;
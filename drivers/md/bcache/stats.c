@@ -48,6 +48,8 @@ read_attribute(cache_hit_ratio);
 read_attribute(cache_readaheads);
 read_attribute(cache_miss_collisions);
 read_attribute(bypassed);
+read_attribute(bypassed_sequential);
+read_attribute(cache_promotions);
 
 SHOW(bch_stats)
 {
@@ -66,6 +68,9 @@ SHOW(bch_stats)
 	var_print(cache_readaheads);
 	var_print(cache_miss_collisions);
 	sysfs_hprint(bypassed,	var(sectors_bypassed) << 9);
+	sysfs_hprint(bypassed_sequential,
+		     var(sectors_bypassed_sequential) << 9);
+	var_print(cache_promotions);
 #undef var
 	return 0;
 }
@@ -88,6 +93,8 @@ static struct attribute *bch_stats_files[] = {
 	&sysfs_cache_readaheads,
 	&sysfs_cache_miss_collisions,
 	&sysfs_bypassed,
+	&sysfs_bypassed_sequential,
+	&sysfs_cache_promotions,
 	NULL
 };
 static KTYPE(bch_stats);
@@ -110,7 +117,7 @@ void bch_cache_accounting_clear(struct cache_accounting *acc)
 {
 	memset(&acc->total.cache_hits,
 	       0,
-	       sizeof(unsigned long) * 7);
+	       sizeof(unsigned long) * 9);
 }
 
 void bch_cache_accounting_destroy(struct cache_accounting *acc)
@@ -143,6 +150,8 @@ static void scale_stats(struct cache_stats *stats, unsigned long rescale_at)
 		scale_stat(&stats->cache_readaheads);
 		scale_stat(&stats->cache_miss_collisions);
 		scale_stat(&stats->sectors_bypassed);
+		scale_stat(&stats->sectors_bypassed_sequential);
+		scale_stat(&stats->cache_promotions);
 	}
 }
 
@@ -166,6 +175,8 @@ static void scale_accounting(unsigned long data)
 	move_stat(cache_readaheads);
 	move_stat(cache_miss_collisions);
 	move_stat(sectors_bypassed);
+	move_stat(sectors_bypassed_sequential);
+	move_stat(cache_promotions);
 
 	scale_stats(&acc->total, 0);
 	scale_stats(&acc->day, DAY_RESCALE);
@@ -217,11 +228,26 @@ void bch_mark_cache_miss_collision(struct cache_set *c, struct bcache_device *d)
 	atomic_inc(&c->accounting.collector.cache_miss_collisions);
 }
 
+void bch_mark_cache_promotion(struct cache_set *c, struct bcache_device *d)
+{
+	struct cached_dev *dc = container_of(d, struct cached_dev, disk);
+	atomic_inc(&dc->accounting.collector.cache_promotions);
+	atomic_inc(&c->accounting.collector.cache_promotions);
+}
+
 void bch_mark_sectors_bypassed(struct cache_set *c, struct cached_dev *dc,
-			       int sectors)
+			       int sectors, bool sequential)
 {
-	atomic_add(sectors, &dc->accounting.collector.sectors_bypassed);
-	atomic_add(sectors, &c->accounting.collector.sectors_bypassed);
+	struct cache_stat_collector *dstats = &dc->accounting.collector;
+	struct cache_stat_collector *cstats = &c->accounting.collector;
+
+	atomic_add(sectors, &dstats->sectors_bypassed);
+	atomic_add(sectors, &cstats->sectors_bypassed);
+
+	if (sequential) {
+		atomic_add(sectors, &dstats->sectors_bypassed_sequential);
+		atomic_add(sectors, &cstats->sectors_bypassed_sequential);
+	}
 }
 
 void bch_cache_accounting_init(struct cache_accounting *acc,
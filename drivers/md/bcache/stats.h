@@ -9,6 +9,8 @@ struct cache_stat_collector {
 	atomic_t cache_readaheads;
 	atomic_t cache_miss_collisions;
 	atomic_t sectors_bypassed;
+	atomic_t sectors_bypassed_sequential;
+	atomic_t cache_promotions;
 };
 
 struct cache_stats {
@@ -21,6 +23,8 @@ struct cache_stats {
 	unsigned long cache_readaheads;
 	unsigned long cache_miss_collisions;
 	unsigned long sectors_bypassed;
+	unsigned long sectors_bypassed_sequential;
+	unsigned long cache_promotions;
 
 	unsigned		rescale;
 };
@@ -56,6 +60,8 @@ void bch_mark_cache_accounting(struct cache_set *, struct bcache_device *,
 			       bool, bool);
 void bch_mark_cache_readahead(struct cache_set *, struct bcache_device *);
 void bch_mark_cache_miss_collision(struct cache_set *, struct bcache_device *);
-void bch_mark_sectors_bypassed(struct cache_set *, struct cached_dev *, int);
+void bch_mark_cache_promotion(struct cache_set *, struct bcache_device *);
+void bch_mark_sectors_bypassed(struct cache_set *, struct cached_dev *, int,
+			       bool);
 
 #endif /* _BCACHE_STATS_H_ */
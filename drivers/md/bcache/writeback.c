@@ -18,6 +18,20 @@
 
 /* Rate limiting */
 
+/*
+ * True if foreground reads from the backing device were slower than the
+ * target since the last rate update: writeback is competing with them.
+ */
+static bool backing_reads_slow(struct cached_dev *dc)
+{
+	unsigned long interval = dc->writeback_rate_update_seconds * HZ;
+
+	return dc->writeback_rate_latency_target_us &&
+		time_before(jiffies, dc->backing_read_last + interval) &&
+		ACCESS_ONCE(dc->backing_read_latency_us) >
+		dc->writeback_rate_latency_target_us;
+}
+
 static void __update_writeback_rate(struct cached_dev *dc)
 {
 	struct cache_set *c = dc->disk.c;
@@ -59,6 +73,11 @@ static void __update_writeback_rate(struct cached_dev *dc)
 			 dc->writeback_rate.next + NSEC_PER_MSEC))
 		change = 0;
 
+	/* Halve the rate while it is slowing down reads */
+	if (backing_reads_slow(dc))
+		change = min_t(int64_t, change,
+			       -(int64_t) (dc->writeback_rate.rate / 2));
+
 	dc->writeback_rate.rate =
 		clamp_t(int64_t, (int64_t) dc->writeback_rate.rate + change,
 			1, NSEC_PER_MSEC);
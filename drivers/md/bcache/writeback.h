@@ -82,6 +82,19 @@ static inline void bch_writeback_add(struct cached_dev *dc)
 	}
 }
 
+/*
+ * Racy, but the worst that can happen is that an update is lost, which is
+ * fine for feeding the writeback rate controller.
+ */
+static inline void bch_backing_read_done(struct cached_dev *dc, unsigned us)
+{
+	unsigned avg = ACCESS_ONCE(dc->backing_read_latency_us);
+
+	ewma_add(avg, us, 8, 0);
+	ACCESS_ONCE(dc->backing_read_latency_us) = avg;
+	dc->backing_read_last = jiffies;
+}
+
 void bcache_dev_sectors_dirty_add(struct cache_set *, unsigned, uint64_t, int);
 
 void bch_sectors_dirty_init(struct cached_dev *dc);
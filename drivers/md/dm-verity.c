@@ -26,6 +26,14 @@
 #define DM_VERITY_MEMPOOL_SIZE		4
 #define DM_VERITY_DEFAULT_PREFETCH_SIZE	262144
 
+/*
+ * Bios longer than this many blocks are verified by several work items in
+ * parallel. Upper tree levels up to DM_VERITY_UPPER_PREFETCH_SIZE bytes are
+ * read in when the target is created.
+ */
+#define DM_VERITY_WORK_BLOCKS		16
+#define DM_VERITY_UPPER_PREFETCH_SIZE	1048576
+
 #define DM_VERITY_MAX_LEVELS		63
 
 static unsigned dm_verity_prefetch_cluster = DM_VERITY_DEFAULT_PREFETCH_SIZE;
@@ -56,6 +64,7 @@ struct dm_verity {
 	int hash_failed;	/* set to 1 if hash of any block failed */
 
 	mempool_t *vec_mempool;	/* mempool of bio vector */
+	mempool_t *io_mempool;	/* mempool of split verification work */
 
 	struct workqueue_struct *verify_wq;
 
@@ -77,6 +86,15 @@ struct dm_verity_io {
 
 	struct work_struct work;
 
+	/*
+	 * The io that is embedded in the bio. A long bio is verified by
+	 * parts allocated from io_mempool, "pending" counts the parts that
+	 * are not verified yet and "error" is the first error seen.
+	 */
+	struct dm_verity_io *parent;
+	atomic_t pending;
+	int error;
+
 	/*
 	 * Three variably-size fields follow this struct:
 	 *
@@ -279,7 +297,7 @@ release_ret_r:
 static int verity_verify_io(struct dm_verity_io *io)
 {
 	struct dm_verity *v = io->v;
-	struct bio *bio = dm_bio_from_per_bio_data(io,
+	struct bio *bio = dm_bio_from_per_bio_data(io->parent,
 						   v->ti->per_bio_data_size);
 	unsigned b;
 	int i;
@@ -394,8 +412,50 @@ static void verity_finish_io(struct dm_verity_io *io, int error)
 static void verity_work(struct work_struct *w)
 {
 	struct dm_verity_io *io = container_of(w, struct dm_verity_io, work);
+	struct dm_verity_io *parent = io->parent;
+	int r = verity_verify_io(io);
+
+	if (unlikely(r))
+		cmpxchg(&parent->error, 0, r);
+
+	if (io != parent)
+		mempool_free(io, io->v->io_mempool);
 
-	verity_finish_io(io, verity_verify_io(io));
+	if (atomic_dec_and_test(&parent->pending))
+		verity_finish_io(parent, parent->error);
+}
+
+/*
+ * Split off the first DM_VERITY_WORK_BLOCKS blocks of a long io into work
+ * items of their own, so that the verify workqueue hashes them on several
+ * cpus. If no memory is available, the rest is verified by the io itself.
+ */
+static void verity_split_io(struct dm_verity_io *io)
+{
+	struct dm_verity *v = io->v;
+	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_bio_data_size);
+	unsigned part_size = DM_VERITY_WORK_BLOCKS << v->data_dev_block_bits;
+	struct dm_verity_io *part;
+
+	while (io->n_blocks > DM_VERITY_WORK_BLOCKS) {
+		part = mempool_alloc(v->io_mempool, GFP_NOWAIT);
+		if (!part)
+			break;
+
+		part->v = v;
+		part->parent = io;
+		part->block = io->block;
+		part->n_blocks = DM_VERITY_WORK_BLOCKS;
+		part->iter = io->iter;
+
+		io->block += DM_VERITY_WORK_BLOCKS;
+		io->n_blocks -= DM_VERITY_WORK_BLOCKS;
+		bio_advance_iter(bio, &io->iter, part_size);
+
+		atomic_inc(&io->pending);
+		INIT_WORK(&part->work, verity_work);
+		queue_work(v->verify_wq, &part->work);
+	}
 }
 
 static void verity_end_io(struct bio *bio, int error)
@@ -407,6 +467,11 @@ static void verity_end_io(struct bio *bio, int error)
 		return;
 	}
 
+	io->parent = io;
+	io->error = 0;
+	atomic_set(&io->pending, 1);
+	verity_split_io(io);
+
 	INIT_WORK(&io->work, verity_work);
 	queue_work(io->v->verify_wq, &io->work);
 }
@@ -451,6 +516,25 @@ no_prefetch_cluster:
 	kfree(pw);
 }
 
+/*
+ * The upper levels of the tree are needed by every io until their buffers
+ * are verified. They are stored first on the hash device, so reading the
+ * start of it up front gets the topmost levels, that are also the smallest.
+ */
+static void verity_prefetch_upper_levels(struct dm_verity *v)
+{
+	sector_t n_blocks;
+
+	if (v->levels < 2)
+		return;
+
+	n_blocks = v->hash_level_block[0] - v->hash_start;
+	n_blocks = min_t(sector_t, n_blocks, DM_VERITY_UPPER_PREFETCH_SIZE >>
+					     v->hash_dev_block_bits);
+	if (n_blocks)
+		dm_bufio_prefetch(v->bufio, v->hash_start, n_blocks);
+}
+
 static void verity_submit_prefetch(struct dm_verity *v, struct dm_verity_io *io)
 {
 	struct dm_verity_prefetch_work *pw;
@@ -607,6 +691,9 @@ static void verity_dtr(struct dm_target *ti)
 	if (v->verify_wq)
 		destroy_workqueue(v->verify_wq);
 
+	if (v->io_mempool)
+		mempool_destroy(v->io_mempool);
+
 	if (v->vec_mempool)
 		mempool_destroy(v->vec_mempool);
 
@@ -847,6 +934,14 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		goto bad;
 	}
 
+	v->io_mempool = mempool_create_kmalloc_pool(DM_VERITY_MEMPOOL_SIZE,
+						    ti->per_bio_data_size);
+	if (!v->io_mempool) {
+		ti->error = "Cannot allocate io mempool";
+		r = -ENOMEM;
+		goto bad;
+	}
+
 	/* WQ_UNBOUND greatly improves performance when running on ramdisk */
 	v->verify_wq = alloc_workqueue("kverityd", WQ_CPU_INTENSIVE | WQ_MEM_RECLAIM | WQ_UNBOUND, num_online_cpus());
 	if (!v->verify_wq) {
@@ -855,6 +950,8 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		goto bad;
 	}
 
+	verity_prefetch_upper_levels(v);
+
 	return 0;
 
 bad:
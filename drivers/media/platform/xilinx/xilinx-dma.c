@@ -13,10 +13,13 @@
  */
 
 #include <linux/amba/xilinx_dma.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
 #include <linux/lcm.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/of.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 
 #include <media/v4l2-dev.h>
@@ -236,6 +239,7 @@ static int xvip_pipeline_validate(struct xvip_pipeline *pipe,
 			pipe->output = dma;
 			num_outputs++;
 		} else {
+			pipe->input = dma;
 			num_inputs++;
 		}
 	}
@@ -255,6 +259,7 @@ static void __xvip_pipeline_cleanup(struct xvip_pipeline *pipe)
 {
 	pipe->num_dmas = 0;
 	pipe->output = NULL;
+	pipe->input = NULL;
 }
 
 /**
@@ -317,28 +322,118 @@ done:
  * @buf: vb2 buffer base object
  * @queue: buffer list entry in the DMA engine queued buffers list
  * @dma: DMA channel that uses the buffer
+ * @pending: number of plane transfers not completed yet
+ * @error: the transfer of a plane couldn't be queued
+ * @copy_timestamp: the buffer carries the timestamp of @timestamp
+ * @timestamp: timestamp of the source buffer in memory-to-memory pipelines
+ * @desc: DMA engine descriptor of the first plane
+ * @submit_time: time at which the buffer was submitted to the DMA engine
+ * @frame: frame information reported by the DMA engine at completion
  */
 struct xvip_dma_buffer {
 	struct vb2_buffer buf;
 	struct list_head queue;
 	struct xvip_dma *dma;
+	unsigned int pending;
+	bool error;
+	bool copy_timestamp;
+	struct timeval timestamp;
+	struct dma_async_tx_descriptor *desc;
+	ktime_t submit_time;
+	struct xilinx_vdma_frame_info frame;
 };
 
 #define to_xvip_dma_buffer(vb)	container_of(vb, struct xvip_dma_buffer, buf)
 
+/* Number of vb2 planes of the buffers, only > 1 with the multi-planar API */
+static unsigned int xvip_dma_num_planes(struct xvip_dma *dma)
+{
+	return V4L2_TYPE_IS_MULTIPLANAR(dma->queue.type)
+	     ? dma->fmtinfo->num_planes : 1;
+}
+
+static unsigned int xvip_dma_plane_lines(struct xvip_dma *dma,
+					 unsigned int plane)
+{
+	return plane ? DIV_ROUND_UP(dma->format.height, dma->fmtinfo->vsub)
+		     : dma->format.height;
+}
+
+static unsigned int xvip_dma_plane_size(struct xvip_dma *dma,
+					unsigned int plane)
+{
+	if (!V4L2_TYPE_IS_MULTIPLANAR(dma->queue.type))
+		return dma->format.sizeimage;
+
+	return dma->format.bytesperline * xvip_dma_plane_lines(dma, plane);
+}
+
+/* Must be called with the queued_lock held. */
+static void xvip_dma_update_stats(struct xvip_dma *dma,
+				  struct xvip_dma_buffer *buf, ktime_t now)
+{
+	struct xvip_dma_stats *stats = &dma->stats;
+	u32 latency = ktime_us_delta(now, buf->frame.timestamp);
+	u32 transfer = ktime_us_delta(buf->frame.timestamp, buf->submit_time);
+
+	/*
+	 * Frames the DMA engine transferred without a buffer leave a gap in the
+	 * buffers sequence numbers.
+	 */
+	dma->sequence += buf->frame.dropped - stats->dropped;
+	stats->dropped = buf->frame.dropped;
+
+	stats->frames++;
+	if (buf->error)
+		stats->errors++;
+
+	stats->latency_last = latency;
+	stats->latency_max = max(stats->latency_max, latency);
+	stats->latency_total += latency;
+	stats->transfer_max = max(stats->transfer_max, transfer);
+}
+
 static void xvip_dma_complete(void *param)
 {
 	struct xvip_dma_buffer *buf = param;
 	struct xvip_dma *dma = buf->dma;
+	ktime_t now = ktime_get();
+	unsigned int i;
 
+	/* The buffer is complete when the transfers of all planes are. */
 	spin_lock(&dma->queued_lock);
+	if (--buf->pending) {
+		spin_unlock(&dma->queued_lock);
+		return;
+	}
 	list_del(&buf->queue);
+	xvip_dma_update_stats(dma, buf, now);
+	buf->buf.v4l2_buf.sequence = dma->sequence++;
 	spin_unlock(&dma->queued_lock);
 
-	buf->buf.v4l2_buf.sequence = dma->sequence++;
-	v4l2_get_timestamp(&buf->buf.v4l2_buf.timestamp);
-	vb2_set_plane_payload(&buf->buf, 0, dma->format.sizeimage);
-	vb2_buffer_done(&buf->buf, VB2_BUF_STATE_DONE);
+	/*
+	 * Output buffers carry the timestamps queued by userspace, capture
+	 * buffers are stamped with the frame sync that completed them.
+	 */
+	if (buf->copy_timestamp)
+		buf->buf.v4l2_buf.timestamp = buf->timestamp;
+	else if (!V4L2_TYPE_IS_OUTPUT(dma->queue.type))
+		buf->buf.v4l2_buf.timestamp =
+			ktime_to_timeval(buf->frame.timestamp);
+	for (i = 0; i < buf->buf.num_planes; i++)
+		vb2_set_plane_payload(&buf->buf, i,
+				      xvip_dma_plane_size(dma, i));
+	vb2_buffer_done(&buf->buf, buf->error ? VB2_BUF_STATE_ERROR
+					      : VB2_BUF_STATE_DONE);
+}
+
+/* The first plane transfer carries the frame information of the buffer. */
+static void xvip_dma_complete_frame(void *param)
+{
+	struct xvip_dma_buffer *buf = param;
+
+	xilinx_vdma_tx_frame_info(buf->desc, &buf->frame);
+	xvip_dma_complete(param);
 }
 
 static int
@@ -347,15 +442,29 @@ xvip_dma_queue_setup(struct vb2_queue *vq, const struct v4l2_format *fmt,
 		     unsigned int sizes[], void *alloc_ctxs[])
 {
 	struct xvip_dma *dma = vb2_get_drv_priv(vq);
+	unsigned int i;
 
-	/* Make sure the image size is large enough. */
-	if (fmt && fmt->fmt.pix.sizeimage < dma->format.sizeimage)
-		return -EINVAL;
+	*nplanes = xvip_dma_num_planes(dma);
+
+	for (i = 0; i < *nplanes; i++) {
+		sizes[i] = xvip_dma_plane_size(dma, i);
+		alloc_ctxs[i] = dma->alloc_ctx;
 
-	*nplanes = 1;
+		if (!fmt)
+			continue;
 
-	sizes[0] = fmt ? fmt->fmt.pix.sizeimage : dma->format.sizeimage;
-	alloc_ctxs[0] = dma->alloc_ctx;
+		/* Make sure the image size is large enough. */
+		if (V4L2_TYPE_IS_MULTIPLANAR(vq->type)) {
+			if (fmt->fmt.pix_mp.num_planes != *nplanes ||
+			    fmt->fmt.pix_mp.plane_fmt[i].sizeimage < sizes[i])
+				return -EINVAL;
+			sizes[i] = fmt->fmt.pix_mp.plane_fmt[i].sizeimage;
+		} else {
+			if (fmt->fmt.pix.sizeimage < sizes[i])
+				return -EINVAL;
+			sizes[i] = fmt->fmt.pix.sizeimage;
+		}
+	}
 
 	return 0;
 }
@@ -366,19 +475,21 @@ static int xvip_dma_buffer_prepare(struct vb2_buffer *vb)
 	struct xvip_dma_buffer *buf = to_xvip_dma_buffer(vb);
 
 	buf->dma = dma;
+	buf->copy_timestamp = false;
 
 	return 0;
 }
 
-static void xvip_dma_buffer_queue(struct vb2_buffer *vb)
+/* Prepare the interleaved transfer of one plane of a buffer */
+static struct dma_async_tx_descriptor *
+xvip_dma_prep_plane(struct xvip_dma *dma, struct dma_chan *chan,
+		    struct xvip_dma_buffer *buf, unsigned int plane)
 {
-	struct xvip_dma *dma = vb2_get_drv_priv(vb->vb2_queue);
-	struct xvip_dma_buffer *buf = to_xvip_dma_buffer(vb);
 	struct dma_async_tx_descriptor *desc;
-	dma_addr_t addr = vb2_dma_contig_plane_dma_addr(vb, 0);
+	dma_addr_t addr = vb2_dma_contig_plane_dma_addr(&buf->buf, plane);
 	u32 flags;
 
-	if (dma->queue.type == V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+	if (!V4L2_TYPE_IS_OUTPUT(dma->queue.type)) {
 		flags = DMA_PREP_INTERRUPT | DMA_CTRL_ACK;
 		dma->xt.dir = DMA_DEV_TO_MEM;
 		dma->xt.src_sgl = false;
@@ -395,25 +506,170 @@ static void xvip_dma_buffer_queue(struct vb2_buffer *vb)
 	dma->xt.frame_size = 1;
 	dma->sgl[0].size = dma->format.width * dma->fmtinfo->bpp;
 	dma->sgl[0].icg = dma->format.bytesperline - dma->sgl[0].size;
-	dma->xt.numf = dma->format.height;
+	dma->xt.numf = xvip_dma_plane_lines(dma, plane);
 
-	desc = dmaengine_prep_interleaved_dma(dma->dma, &dma->xt, flags);
+	desc = dmaengine_prep_interleaved_dma(chan, &dma->xt, flags);
+	if (!desc)
+		return NULL;
+
+	desc->callback = plane ? xvip_dma_complete : xvip_dma_complete_frame;
+	desc->callback_param = buf;
+
+	return desc;
+}
+
+static void xvip_dma_submit_buffer(struct xvip_dma *dma,
+				   struct xvip_dma_buffer *buf)
+{
+	struct vb2_buffer *vb = &buf->buf;
+	struct dma_async_tx_descriptor *chroma = NULL;
+	struct dma_async_tx_descriptor *desc;
+
+	buf->pending = 1;
+	buf->error = false;
+
+	desc = xvip_dma_prep_plane(dma, dma->dma, buf, 0);
 	if (!desc) {
 		dev_err(dma->xdev->dev, "Failed to prepare DMA transfer\n");
 		vb2_buffer_done(&buf->buf, VB2_BUF_STATE_ERROR);
 		return;
 	}
-	desc->callback = xvip_dma_complete;
-	desc->callback_param = buf;
+
+	buf->desc = desc;
+
+	/*
+	 * The chroma plane is transferred by its own channel. If it can't be
+	 * queued, the luma transfer is still queued to keep the channels in
+	 * sync, and the buffer is returned with an error.
+	 */
+	if (vb->num_planes > 1) {
+		chroma = xvip_dma_prep_plane(dma, dma->chroma, buf, 1);
+		if (chroma) {
+			buf->pending++;
+		} else {
+			dev_err(dma->xdev->dev,
+				"Failed to prepare chroma DMA transfer\n");
+			buf->error = true;
+		}
+	}
 
 	spin_lock_irq(&dma->queued_lock);
 	list_add_tail(&buf->queue, &dma->queued_bufs);
 	spin_unlock_irq(&dma->queued_lock);
 
+	buf->submit_time = ktime_get();
 	dmaengine_submit(desc);
+	if (chroma)
+		dmaengine_submit(chroma);
 
-	if (vb2_is_streaming(&dma->queue))
+	if (vb2_is_streaming(&dma->queue)) {
 		dma_async_issue_pending(dma->dma);
+		if (chroma)
+			dma_async_issue_pending(dma->chroma);
+	}
+}
+
+/**
+ * xvip_pipeline_run - Submit the buffers of a memory-to-memory pipeline
+ * @pipe: the pipeline
+ *
+ * The input DMA engine of a memory-to-memory pipeline feeds the processing
+ * blocks from memory, and every frame read from memory produces one frame at
+ * the output DMA engine. Buffers are thus only submitted in pairs of one
+ * input and one output buffer, and the output buffer inherits the timestamp
+ * of the input buffer. The output buffer is submitted first, so that the
+ * output DMA engine is ready by the time the frame comes out of the pipeline.
+ */
+static void xvip_pipeline_run(struct xvip_pipeline *pipe)
+{
+	struct xvip_dma *input = pipe->input;
+	struct xvip_dma *output = pipe->output;
+	struct xvip_dma_buffer *src;
+	struct xvip_dma_buffer *dst;
+
+	mutex_lock(&pipe->lock);
+
+	while (1) {
+		spin_lock_irq(&input->queued_lock);
+		src = list_first_entry_or_null(&input->ready_bufs,
+					       struct xvip_dma_buffer, queue);
+		spin_unlock_irq(&input->queued_lock);
+
+		spin_lock_irq(&output->queued_lock);
+		dst = list_first_entry_or_null(&output->ready_bufs,
+					       struct xvip_dma_buffer, queue);
+		if (src && dst)
+			list_del(&dst->queue);
+		spin_unlock_irq(&output->queued_lock);
+
+		if (!src || !dst)
+			break;
+
+		spin_lock_irq(&input->queued_lock);
+		list_del(&src->queue);
+		spin_unlock_irq(&input->queued_lock);
+
+		dst->copy_timestamp = true;
+		dst->timestamp = src->buf.v4l2_buf.timestamp;
+
+		xvip_dma_submit_buffer(output, dst);
+		xvip_dma_submit_buffer(input, src);
+	}
+
+	mutex_unlock(&pipe->lock);
+}
+
+/* Submit the buffers queued before the pipeline was started */
+static void xvip_dma_submit_ready(struct xvip_dma *dma,
+				  struct xvip_pipeline *pipe)
+{
+	struct xvip_dma_buffer *buf;
+
+	if (pipe->input) {
+		xvip_pipeline_run(pipe);
+		return;
+	}
+
+	while (1) {
+		spin_lock_irq(&dma->queued_lock);
+		buf = list_first_entry_or_null(&dma->ready_bufs,
+					       struct xvip_dma_buffer, queue);
+		if (buf)
+			list_del(&buf->queue);
+		spin_unlock_irq(&dma->queued_lock);
+
+		if (!buf)
+			break;
+
+		xvip_dma_submit_buffer(dma, buf);
+	}
+}
+
+static void xvip_dma_buffer_queue(struct vb2_buffer *vb)
+{
+	struct xvip_dma *dma = vb2_get_drv_priv(vb->vb2_queue);
+	struct xvip_dma_buffer *buf = to_xvip_dma_buffer(vb);
+	struct xvip_pipeline *pipe = NULL;
+
+	if (dma->video.entity.pipe && vb2_is_streaming(&dma->queue))
+		pipe = to_xvip_pipeline(&dma->video.entity);
+
+	/* Live pipelines submit the buffers right away. */
+	if (pipe && !pipe->input) {
+		xvip_dma_submit_buffer(dma, buf);
+		return;
+	}
+
+	/*
+	 * Buffers are held back until the pipeline is validated at stream
+	 * start, and until they can be paired in memory-to-memory pipelines.
+	 */
+	spin_lock_irq(&dma->queued_lock);
+	list_add_tail(&buf->queue, &dma->ready_bufs);
+	spin_unlock_irq(&dma->queued_lock);
+
+	if (pipe)
+		xvip_pipeline_run(pipe);
 }
 
 static int xvip_dma_start_streaming(struct vb2_queue *vq, unsigned int count)
@@ -423,7 +679,10 @@ static int xvip_dma_start_streaming(struct vb2_queue *vq, unsigned int count)
 	struct xvip_pipeline *pipe;
 	int ret;
 
+	spin_lock_irq(&dma->queued_lock);
 	dma->sequence = 0;
+	memset(&dma->stats, 0, sizeof(dma->stats));
+	spin_unlock_irq(&dma->queued_lock);
 
 	/*
 	 * Start streaming on the pipeline. No link touching an entity in the
@@ -450,10 +709,14 @@ static int xvip_dma_start_streaming(struct vb2_queue *vq, unsigned int count)
 	if (ret < 0)
 		goto error_stop;
 
+	xvip_dma_submit_ready(dma, pipe);
+
 	/* Start the DMA engine. This must be done before starting the blocks
 	 * in the pipeline to avoid DMA synchronization issues.
 	 */
 	dma_async_issue_pending(dma->dma);
+	if (dma->chroma)
+		dma_async_issue_pending(dma->chroma);
 
 	/* Start the pipeline. */
 	xvip_pipeline_set_stream(pipe, true);
@@ -466,6 +729,7 @@ error_stop:
 error:
 	/* Give back all queued buffers to videobuf2. */
 	spin_lock_irq(&dma->queued_lock);
+	list_splice_tail_init(&dma->ready_bufs, &dma->queued_bufs);
 	list_for_each_entry_safe(buf, nbuf, &dma->queued_bufs, queue) {
 		vb2_buffer_done(&buf->buf, VB2_BUF_STATE_QUEUED);
 		list_del(&buf->queue);
@@ -486,6 +750,8 @@ static void xvip_dma_stop_streaming(struct vb2_queue *vq)
 
 	/* Stop and reset the DMA engine. */
 	dmaengine_terminate_all(dma->dma);
+	if (dma->chroma)
+		dmaengine_terminate_all(dma->chroma);
 
 	/* Cleanup the pipeline and mark it as being stopped. */
 	xvip_pipeline_cleanup(pipe);
@@ -493,6 +759,7 @@ static void xvip_dma_stop_streaming(struct vb2_queue *vq)
 
 	/* Give back all queued buffers to videobuf2. */
 	spin_lock_irq(&dma->queued_lock);
+	list_splice_tail_init(&dma->ready_bufs, &dma->queued_bufs);
 	list_for_each_entry_safe(buf, nbuf, &dma->queued_bufs, queue) {
 		vb2_buffer_done(&buf->buf, VB2_BUF_STATE_ERROR);
 		list_del(&buf->queue);
@@ -523,10 +790,22 @@ xvip_dma_querycap(struct file *file, void *fh, struct v4l2_capability *cap)
 	cap->capabilities = V4L2_CAP_DEVICE_CAPS | V4L2_CAP_STREAMING
 			  | dma->xdev->v4l2_caps;
 
-	if (dma->queue.type == V4L2_BUF_TYPE_VIDEO_CAPTURE)
-		cap->device_caps = V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING;
-	else
-		cap->device_caps = V4L2_CAP_VIDEO_OUTPUT | V4L2_CAP_STREAMING;
+	switch (dma->queue.type) {
+	case V4L2_BUF_TYPE_VIDEO_CAPTURE:
+		cap->device_caps = V4L2_CAP_VIDEO_CAPTURE;
+		break;
+	case V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE:
+		cap->device_caps = V4L2_CAP_VIDEO_CAPTURE_MPLANE;
+		break;
+	case V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE:
+		cap->device_caps = V4L2_CAP_VIDEO_OUTPUT_MPLANE;
+		break;
+	default:
+		cap->device_caps = V4L2_CAP_VIDEO_OUTPUT;
+		break;
+	}
+
+	cap->device_caps |= V4L2_CAP_STREAMING;
 
 	strlcpy(cap->driver, "xilinx-vipp", sizeof(cap->driver));
 	strlcpy(cap->card, dma->video.name, sizeof(cap->card));
@@ -557,13 +836,47 @@ xvip_dma_enum_format(struct file *file, void *fh, struct v4l2_fmtdesc *f)
 	return 0;
 }
 
+/* Fill the multi-planar format from the single-planar one and the format */
+static void xvip_dma_fill_format_mplane(struct v4l2_pix_format_mplane *pix_mp,
+					const struct v4l2_pix_format *pix,
+					const struct xvip_video_format *info)
+{
+	unsigned int i;
+
+	pix_mp->width = pix->width;
+	pix_mp->height = pix->height;
+	pix_mp->pixelformat = pix->pixelformat;
+	pix_mp->field = pix->field;
+	pix_mp->colorspace = pix->colorspace;
+	pix_mp->num_planes = info->num_planes;
+	pix_mp->flags = 0;
+	memset(pix_mp->reserved, 0, sizeof(pix_mp->reserved));
+
+	for (i = 0; i < info->num_planes; i++) {
+		struct v4l2_plane_pix_format *plane = &pix_mp->plane_fmt[i];
+		unsigned int height = i ? DIV_ROUND_UP(pix->height, info->vsub)
+					: pix->height;
+
+		plane->bytesperline = pix->bytesperline;
+		plane->sizeimage = pix->bytesperline * height;
+		memset(plane->reserved, 0, sizeof(plane->reserved));
+	}
+}
+
 static int
 xvip_dma_get_format(struct file *file, void *fh, struct v4l2_format *format)
 {
 	struct v4l2_fh *vfh = file->private_data;
 	struct xvip_dma *dma = to_xvip_dma(vfh->vdev);
 
-	format->fmt.pix = dma->format;
+	if (format->type != dma->queue.type)
+		return -EINVAL;
+
+	if (V4L2_TYPE_IS_MULTIPLANAR(format->type))
+		xvip_dma_fill_format_mplane(&format->fmt.pix_mp, &dma->format,
+					    dma->fmtinfo);
+	else
+		format->fmt.pix = dma->format;
 
 	return 0;
 }
@@ -582,10 +895,12 @@ __xvip_dma_try_format(struct xvip_dma *dma, struct v4l2_pix_format *pix,
 	unsigned int bpl;
 
 	/* Retrieve format information and select the default format if the
-	 * requested format isn't supported.
+	 * requested format isn't supported. Multi-planar formats are only
+	 * supported by the multi-planar API.
 	 */
 	info = xvip_get_format_by_fourcc(pix->pixelformat);
-	if (IS_ERR(info))
+	if (IS_ERR(info) || (info->num_planes > 1 &&
+			     !V4L2_TYPE_IS_MULTIPLANAR(dma->queue.type)))
 		info = xvip_get_format_by_fourcc(XVIP_DMA_DEF_FORMAT);
 
 	pix->pixelformat = info->fourcc;
@@ -619,14 +934,53 @@ __xvip_dma_try_format(struct xvip_dma *dma, struct v4l2_pix_format *pix,
 		*fmtinfo = info;
 }
 
+/*
+ * Try the format for the type of the queue. Multi-planar formats are handled
+ * through their single-planar equivalent, as all planes share the same line
+ * length.
+ */
+static int
+__xvip_dma_try_format_type(struct xvip_dma *dma, struct v4l2_format *format,
+			   struct v4l2_pix_format *pix,
+			   const struct xvip_video_format **fmtinfo)
+{
+	struct v4l2_pix_format_mplane *pix_mp = &format->fmt.pix_mp;
+	const struct xvip_video_format *info;
+
+	if (format->type != dma->queue.type)
+		return -EINVAL;
+
+	if (!V4L2_TYPE_IS_MULTIPLANAR(format->type)) {
+		*pix = format->fmt.pix;
+		__xvip_dma_try_format(dma, pix, fmtinfo);
+		format->fmt.pix = *pix;
+		return 0;
+	}
+
+	memset(pix, 0, sizeof(*pix));
+	pix->width = pix_mp->width;
+	pix->height = pix_mp->height;
+	pix->pixelformat = pix_mp->pixelformat;
+	pix->colorspace = pix_mp->colorspace;
+	pix->bytesperline = pix_mp->plane_fmt[0].bytesperline;
+
+	__xvip_dma_try_format(dma, pix, &info);
+	xvip_dma_fill_format_mplane(pix_mp, pix, info);
+
+	if (fmtinfo)
+		*fmtinfo = info;
+
+	return 0;
+}
+
 static int
 xvip_dma_try_format(struct file *file, void *fh, struct v4l2_format *format)
 {
 	struct v4l2_fh *vfh = file->private_data;
 	struct xvip_dma *dma = to_xvip_dma(vfh->vdev);
+	struct v4l2_pix_format pix;
 
-	__xvip_dma_try_format(dma, &format->fmt.pix, NULL);
-	return 0;
+	return __xvip_dma_try_format_type(dma, format, &pix, NULL);
 }
 
 static int
@@ -635,13 +989,17 @@ xvip_dma_set_format(struct file *file, void *fh, struct v4l2_format *format)
 	struct v4l2_fh *vfh = file->private_data;
 	struct xvip_dma *dma = to_xvip_dma(vfh->vdev);
 	const struct xvip_video_format *info;
+	struct v4l2_pix_format pix;
+	int ret;
 
-	__xvip_dma_try_format(dma, &format->fmt.pix, &info);
+	ret = __xvip_dma_try_format_type(dma, format, &pix, &info);
+	if (ret < 0)
+		return ret;
 
 	if (vb2_is_busy(&dma->queue))
 		return -EBUSY;
 
-	dma->format = format->fmt.pix;
+	dma->format = pix;
 	dma->fmtinfo = info;
 
 	return 0;
@@ -656,6 +1014,13 @@ static const struct v4l2_ioctl_ops xvip_dma_ioctl_ops = {
 	.vidioc_s_fmt_vid_out		= xvip_dma_set_format,
 	.vidioc_try_fmt_vid_cap		= xvip_dma_try_format,
 	.vidioc_try_fmt_vid_out		= xvip_dma_try_format,
+	.vidioc_enum_fmt_vid_cap_mplane	= xvip_dma_enum_format,
+	.vidioc_g_fmt_vid_cap_mplane	= xvip_dma_get_format,
+	.vidioc_g_fmt_vid_out_mplane	= xvip_dma_get_format,
+	.vidioc_s_fmt_vid_cap_mplane	= xvip_dma_set_format,
+	.vidioc_s_fmt_vid_out_mplane	= xvip_dma_set_format,
+	.vidioc_try_fmt_vid_cap_mplane	= xvip_dma_try_format,
+	.vidioc_try_fmt_vid_out_mplane	= xvip_dma_try_format,
 	.vidioc_reqbufs			= vb2_ioctl_reqbufs,
 	.vidioc_querybuf		= vb2_ioctl_querybuf,
 	.vidioc_qbuf			= vb2_ioctl_qbuf,
@@ -679,6 +1044,44 @@ static const struct v4l2_file_operations xvip_dma_fops = {
 	.mmap		= vb2_fop_mmap,
 };
 
+/* -----------------------------------------------------------------------------
+ * debugfs
+ */
+
+static int xvip_dma_stats_show(struct seq_file *s, void *data)
+{
+	struct xvip_dma *dma = s->private;
+	struct xvip_dma_stats stats;
+
+	spin_lock_irq(&dma->queued_lock);
+	stats = dma->stats;
+	spin_unlock_irq(&dma->queued_lock);
+
+	seq_printf(s, "frames:\t\t%u\n", stats.frames);
+	seq_printf(s, "errors:\t\t%u\n", stats.errors);
+	seq_printf(s, "dropped:\t%u\n", stats.dropped);
+	seq_printf(s, "latency:\tlast %u us, max %u us, avg %llu us\n",
+		   stats.latency_last, stats.latency_max,
+		   stats.frames ? div_u64(stats.latency_total, stats.frames)
+				: 0);
+	seq_printf(s, "transfer:\tmax %u us\n", stats.transfer_max);
+
+	return 0;
+}
+
+static int xvip_dma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, xvip_dma_stats_show, inode->i_private);
+}
+
+static const struct file_operations xvip_dma_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= xvip_dma_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /* -----------------------------------------------------------------------------
  * Xilinx Video DMA Core
  */
@@ -686,7 +1089,7 @@ static const struct v4l2_file_operations xvip_dma_fops = {
 int xvip_dma_init(struct xvip_composite_device *xdev, struct xvip_dma *dma,
 		  enum v4l2_buf_type type, unsigned int port)
 {
-	char name[14];
+	char name[21];
 	int ret;
 
 	dma->xdev = xdev;
@@ -694,6 +1097,7 @@ int xvip_dma_init(struct xvip_composite_device *xdev, struct xvip_dma *dma,
 	mutex_init(&dma->lock);
 	mutex_init(&dma->pipe.lock);
 	INIT_LIST_HEAD(&dma->queued_bufs);
+	INIT_LIST_HEAD(&dma->ready_bufs);
 	spin_lock_init(&dma->queued_lock);
 
 	dma->fmtinfo = xvip_get_format_by_fourcc(XVIP_DMA_DEF_FORMAT);
@@ -705,8 +1109,18 @@ int xvip_dma_init(struct xvip_composite_device *xdev, struct xvip_dma *dma,
 	dma->format.bytesperline = dma->format.width * dma->fmtinfo->bpp;
 	dma->format.sizeimage = dma->format.bytesperline * dma->format.height;
 
+	/* The chroma plane of multi-planar formats needs a channel of its own,
+	 * the video node uses the multi-planar API when that channel exists.
+	 */
+	snprintf(name, sizeof(name), "port%u-chroma", port);
+	dma->chroma = dma_request_slave_channel(xdev->dev, name);
+	if (dma->chroma)
+		type = type == V4L2_BUF_TYPE_VIDEO_CAPTURE
+		     ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE
+		     : V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+
 	/* Initialize the media entity... */
-	dma->pad.flags = type == V4L2_BUF_TYPE_VIDEO_CAPTURE
+	dma->pad.flags = !V4L2_TYPE_IS_OUTPUT(type)
 		       ? MEDIA_PAD_FL_SINK : MEDIA_PAD_FL_SOURCE;
 
 	ret = media_entity_init(&dma->video.entity, 1, &dma->pad, 0);
@@ -719,10 +1133,10 @@ int xvip_dma_init(struct xvip_composite_device *xdev, struct xvip_dma *dma,
 	dma->video.queue = &dma->queue;
 	snprintf(dma->video.name, sizeof(dma->video.name), "%s %s %u",
 		 xdev->dev->of_node->name,
-		 type == V4L2_BUF_TYPE_VIDEO_CAPTURE ? "output" : "input",
+		 !V4L2_TYPE_IS_OUTPUT(type) ? "output" : "input",
 		 port);
 	dma->video.vfl_type = VFL_TYPE_GRABBER;
-	dma->video.vfl_dir = type == V4L2_BUF_TYPE_VIDEO_CAPTURE
+	dma->video.vfl_dir = !V4L2_TYPE_IS_OUTPUT(type)
 			   ? VFL_DIR_RX : VFL_DIR_TX;
 	dma->video.release = video_device_release_empty;
 	dma->video.ioctl_ops = &xvip_dma_ioctl_ops;
@@ -749,8 +1163,11 @@ int xvip_dma_init(struct xvip_composite_device *xdev, struct xvip_dma *dma,
 	dma->queue.buf_struct_size = sizeof(struct xvip_dma_buffer);
 	dma->queue.ops = &xvip_dma_queue_qops;
 	dma->queue.mem_ops = &vb2_dma_contig_memops;
-	dma->queue.timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
-				   | V4L2_BUF_FLAG_TSTAMP_SRC_EOF;
+	if (V4L2_TYPE_IS_OUTPUT(type))
+		dma->queue.timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	else
+		dma->queue.timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
+					   | V4L2_BUF_FLAG_TSTAMP_SRC_EOF;
 	ret = vb2_queue_init(&dma->queue);
 	if (ret < 0) {
 		dev_err(dma->xdev->dev, "failed to initialize VB2 queue\n");
@@ -767,6 +1184,9 @@ int xvip_dma_init(struct xvip_composite_device *xdev, struct xvip_dma *dma,
 	}
 
 	dma->align = 1 << dma->dma->device->copy_align;
+	if (dma->chroma)
+		dma->align = lcm(dma->align,
+				 1 << dma->chroma->device->copy_align);
 
 	ret = video_register_device(&dma->video, VFL_TYPE_GRABBER, -1);
 	if (ret < 0) {
@@ -774,6 +1194,11 @@ int xvip_dma_init(struct xvip_composite_device *xdev, struct xvip_dma *dma,
 		goto error;
 	}
 
+	/* The statistics are optional, debugfs failures are ignored. */
+	sprintf(name, "port%u", port);
+	dma->debugfs = debugfs_create_file(name, S_IRUGO, xdev->debugfs, dma,
+					   &xvip_dma_stats_fops);
+
 	return 0;
 
 error:
@@ -783,12 +1208,17 @@ error:
 
 void xvip_dma_cleanup(struct xvip_dma *dma)
 {
+	debugfs_remove(dma->debugfs);
+
 	if (video_is_registered(&dma->video))
 		video_unregister_device(&dma->video);
 
 	if (dma->dma)
 		dma_release_channel(dma->dma);
 
+	if (dma->chroma)
+		dma_release_channel(dma->chroma);
+
 	if (!IS_ERR_OR_NULL(dma->alloc_ctx))
 		vb2_dma_contig_cleanup_ctx(dma->alloc_ctx);
 
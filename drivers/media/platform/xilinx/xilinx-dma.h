@@ -24,6 +24,7 @@
 #include <media/v4l2-dev.h>
 #include <media/videobuf2-core.h>
 
+struct dentry;
 struct dma_chan;
 struct xvip_composite_device;
 struct xvip_video_format;
@@ -31,11 +32,13 @@ struct xvip_video_format;
 /**
  * struct xvip_pipeline - Xilinx Video IP pipeline structure
  * @pipe: media pipeline
- * @lock: protects the pipeline @stream_count
+ * @lock: protects the pipeline @stream_count, and serializes the submission
+ *	of the buffer pairs in memory-to-memory pipelines
  * @use_count: number of DMA engines using the pipeline
  * @stream_count: number of DMA engines currently streaming
  * @num_dmas: number of DMA engines in the pipeline
  * @output: DMA engine at the output of the pipeline
+ * @input: DMA engine at the input of memory-to-memory pipelines, or NULL
  */
 struct xvip_pipeline {
 	struct media_pipeline pipe;
@@ -46,6 +49,7 @@ struct xvip_pipeline {
 
 	unsigned int num_dmas;
 	struct xvip_dma *output;
+	struct xvip_dma *input;
 };
 
 static inline struct xvip_pipeline *to_xvip_pipeline(struct media_entity *e)
@@ -53,6 +57,29 @@ static inline struct xvip_pipeline *to_xvip_pipeline(struct media_entity *e)
 	return container_of(e->pipe, struct xvip_pipeline, pipe);
 }
 
+/**
+ * struct xvip_dma_stats - Video DMA frame statistics
+ * @frames: number of completed buffers
+ * @errors: number of buffers completed with an error
+ * @dropped: number of frames transferred by the DMA engine without a buffer
+ * @latency_last: frame sync to buffer completion latency of the last buffer
+ * @latency_max: maximum frame sync to buffer completion latency
+ * @latency_total: sum of the frame sync to buffer completion latencies
+ * @transfer_max: maximum time between buffer submission and frame sync
+ *
+ * Latencies and times are expressed in microseconds. The statistics are reset
+ * when streaming starts.
+ */
+struct xvip_dma_stats {
+	unsigned int frames;
+	unsigned int errors;
+	unsigned int dropped;
+	u32 latency_last;
+	u32 latency_max;
+	u64 latency_total;
+	u32 transfer_max;
+};
+
 /**
  * struct xvip_dma - Video DMA channel
  * @list: list entry in a composite device dmas list
@@ -68,9 +95,13 @@ static inline struct xvip_pipeline *to_xvip_pipeline(struct media_entity *e)
  * @alloc_ctx: allocation context for the vb2 @queue
  * @sequence: V4L2 buffers sequence number
  * @queued_bufs: list of queued buffers
- * @queued_lock: protects the buf_queued list
+ * @ready_bufs: list of buffers waiting to be submitted to the DMA engine
+ * @queued_lock: protects the buf_queued and ready_bufs lists, and @stats
+ * @stats: frame statistics
+ * @debugfs: debugfs statistics file
  * @dma: DMA engine channel
- * @align: transfer alignment required by the DMA channel (in bytes)
+ * @chroma: DMA engine channel for the chroma plane of multi-planar formats
+ * @align: transfer alignment required by the DMA channels (in bytes)
  * @xt: dma interleaved template for dma configuration
  * @sgl: data chunk structure for dma_interleaved_template
  */
@@ -92,9 +123,13 @@ struct xvip_dma {
 	unsigned int sequence;
 
 	struct list_head queued_bufs;
+	struct list_head ready_bufs;
 	spinlock_t queued_lock;
+	struct xvip_dma_stats stats;
+	struct dentry *debugfs;
 
 	struct dma_chan *dma;
+	struct dma_chan *chroma;
 	unsigned int align;
 	struct dma_interleaved_template xt;
 	struct data_chunk sgl[1];
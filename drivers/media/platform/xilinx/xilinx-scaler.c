@@ -139,29 +139,34 @@ static fixp_t lanczos(fixp_t x, fixp_t a)
 }
 
 /**
- * xscaler_set_coefs - generate and program the coefficient table
+ * xscaler_gen_coefs - generate a coefficient table
  * @xscaler: scaler device
  * @taps: maximum coefficient tap index
  *
- * Generate the coefficient table using Lanczos resampling, and program
- * generated coefficients to the scaler. The generated coefficients are
- * supposed to work regardless of resolutions.
+ * Generate the coefficient table using Lanczos resampling, packed the way
+ * it's written to the scaler. The generated coefficients are supposed to
+ * work regardless of resolutions, so a table is generated once per number
+ * of taps and reused for every coefficient bank with that number of taps.
  *
- * Return: 0 if the coefficient table is programmed, and -ENOMEM if memory
- * allocation for the table fails.
+ * Return: the table on success, or NULL if memory allocation fails.
  */
-static int xscaler_set_coefs(struct xscaler_device *xscaler, s16 taps)
+static u32 *xscaler_gen_coefs(struct xscaler_device *xscaler, s16 taps)
 {
 	fixp_t *coef;
 	fixp_t dy;
-	u32 coef_val;
+	u32 *table;
 	u16 phases = xscaler->max_num_phases;
+	u16 words = DIV_ROUND_UP(taps, 2);
 	u16 i;
 	u16 j;
 
-	coef = kcalloc(phases, sizeof(*coef), GFP_KERNEL);
-	if (!coef)
-		return -ENOMEM;
+	table = devm_kcalloc(xscaler->xvip.dev, phases * words, sizeof(*table),
+			     GFP_KERNEL);
+	coef = kcalloc(taps, sizeof(*coef), GFP_KERNEL);
+	if (!table || !coef) {
+		kfree(coef);
+		return NULL;
+	}
 
 	for (i = 0; i < phases; i++) {
 		fixp_t sum = 0;
@@ -175,8 +180,10 @@ static int xscaler_set_coefs(struct xscaler_device *xscaler, s16 taps)
 			sum += coef[j];
 		}
 
-		/* Program coefficients */
+		/* Pack coefficients */
 		for (j = 0; j < taps; j += 2) {
+			u32 coef_val;
+
 			/* Normalize and multiply coefficients */
 			coef_val = (((coef[j] << FRAC_N) << (FRAC_N - 2)) /
 				    sum) & 0xffff;
@@ -185,13 +192,70 @@ static int xscaler_set_coefs(struct xscaler_device *xscaler, s16 taps)
 					      (FRAC_N - 2)) / sum) & 0xffff) <<
 					    16;
 
-			xvip_write(&xscaler->xvip, XSCALER_COEF_DATA_IN,
-				   coef_val);
+			table[i * words + j / 2] = coef_val;
 		}
 	}
 
 	kfree(coef);
 
+	return table;
+}
+
+/**
+ * xscaler_load_coefs - program a coefficient bank
+ * @xscaler: scaler device
+ * @table: coefficient table from xscaler_gen_coefs()
+ * @taps: maximum coefficient tap index of @table
+ */
+static void xscaler_load_coefs(struct xscaler_device *xscaler,
+			       const u32 *table, s16 taps)
+{
+	unsigned int n = xscaler->max_num_phases * DIV_ROUND_UP(taps, 2);
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		xvip_write(&xscaler->xvip, XSCALER_COEF_DATA_IN, table[i]);
+}
+
+/**
+ * xscaler_set_coefs - generate and program all coefficient banks
+ * @xscaler: scaler device
+ *
+ * Program the horizontal coefficients, followed by the vertical ones if
+ * they are separate, for luma and then for chroma if that is separate.
+ * The vertical table is only generated if its number of taps differs.
+ *
+ * Return: 0 if the coefficients are programmed, and -ENOMEM if memory
+ * allocation for the tables fails.
+ */
+static int xscaler_set_coefs(struct xscaler_device *xscaler)
+{
+	s16 htaps = xscaler->num_hori_taps;
+	s16 vtaps = xscaler->num_vert_taps;
+	u32 *hcoefs;
+	u32 *vcoefs;
+
+	hcoefs = xscaler_gen_coefs(xscaler, htaps);
+	if (!hcoefs)
+		return -ENOMEM;
+
+	vcoefs = hcoefs;
+	if (xscaler->separate_hv_coef && vtaps != htaps) {
+		vcoefs = xscaler_gen_coefs(xscaler, vtaps);
+		if (!vcoefs)
+			return -ENOMEM;
+	}
+
+	xscaler_load_coefs(xscaler, hcoefs, htaps);
+	if (xscaler->separate_hv_coef)
+		xscaler_load_coefs(xscaler, vcoefs, vtaps);
+
+	if (xscaler->separate_yc_coef) {
+		xscaler_load_coefs(xscaler, hcoefs, htaps);
+		if (xscaler->separate_hv_coef)
+			xscaler_load_coefs(xscaler, vcoefs, vtaps);
+	}
+
 	return 0;
 }
 
@@ -620,29 +684,10 @@ static int xscaler_probe(struct platform_device *pdev)
 
 	xvip_print_version(&xscaler->xvip);
 
-	ret = xscaler_set_coefs(xscaler, (s16)xscaler->num_hori_taps);
+	ret = xscaler_set_coefs(xscaler);
 	if (ret < 0)
 		goto error;
 
-	if (xscaler->separate_hv_coef) {
-		ret = xscaler_set_coefs(xscaler, (s16)xscaler->num_vert_taps);
-		if (ret < 0)
-			goto error;
-	}
-
-	if (xscaler->separate_yc_coef) {
-		ret = xscaler_set_coefs(xscaler, (s16)xscaler->num_hori_taps);
-		if (ret < 0)
-			goto error;
-
-		if (xscaler->separate_hv_coef) {
-			ret = xscaler_set_coefs(xscaler,
-						(s16)xscaler->num_vert_taps);
-			if (ret < 0)
-				goto error;
-		}
-	}
-
 	ret = v4l2_async_register_subdev(subdev);
 	if (ret < 0) {
 		dev_err(&pdev->dev, "failed to register subdev\n");
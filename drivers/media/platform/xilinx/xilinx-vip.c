@@ -28,21 +28,25 @@
 
 static const struct xvip_video_format xvip_video_formats[] = {
 	{ XVIP_VF_YUV_422, 8, NULL, V4L2_MBUS_FMT_UYVY8_1X16,
-	  2, V4L2_PIX_FMT_YUYV, "4:2:2, packed, YUYV" },
+	  2, V4L2_PIX_FMT_YUYV, "4:2:2, packed, YUYV", 1, 1 },
 	{ XVIP_VF_YUV_444, 8, NULL, V4L2_MBUS_FMT_VUY8_1X24,
-	  3, V4L2_PIX_FMT_YUV444, "4:4:4, packed, YUYV" },
+	  3, V4L2_PIX_FMT_YUV444, "4:4:4, packed, YUYV", 1, 1 },
 	{ XVIP_VF_RBG, 8, NULL, V4L2_MBUS_FMT_RBG888_1X24,
-	  3, 0, NULL },
+	  3, 0, NULL, 1, 1 },
 	{ XVIP_VF_MONO_SENSOR, 8, "mono", V4L2_MBUS_FMT_Y8_1X8,
-	  1, V4L2_PIX_FMT_GREY, "Greyscale 8-bit" },
+	  1, V4L2_PIX_FMT_GREY, "Greyscale 8-bit", 1, 1 },
 	{ XVIP_VF_MONO_SENSOR, 8, "rggb", V4L2_MBUS_FMT_SRGGB8_1X8,
-	  1, V4L2_PIX_FMT_SGRBG8, "Bayer 8-bit RGGB" },
+	  1, V4L2_PIX_FMT_SGRBG8, "Bayer 8-bit RGGB", 1, 1 },
 	{ XVIP_VF_MONO_SENSOR, 8, "grbg", V4L2_MBUS_FMT_SGRBG8_1X8,
-	  1, V4L2_PIX_FMT_SGRBG8, "Bayer 8-bit GRBG" },
+	  1, V4L2_PIX_FMT_SGRBG8, "Bayer 8-bit GRBG", 1, 1 },
 	{ XVIP_VF_MONO_SENSOR, 8, "gbrg", V4L2_MBUS_FMT_SGBRG8_1X8,
-	  1, V4L2_PIX_FMT_SGBRG8, "Bayer 8-bit GBRG" },
+	  1, V4L2_PIX_FMT_SGBRG8, "Bayer 8-bit GBRG", 1, 1 },
 	{ XVIP_VF_MONO_SENSOR, 8, "bggr", V4L2_MBUS_FMT_SBGGR8_1X8,
-	  1, V4L2_PIX_FMT_SBGGR8, "Bayer 8-bit BGGR" },
+	  1, V4L2_PIX_FMT_SBGGR8, "Bayer 8-bit BGGR", 1, 1 },
+	{ XVIP_VF_YUV_422, 8, NULL, V4L2_MBUS_FMT_UYVY8_1X16,
+	  1, V4L2_PIX_FMT_NV16M, "Y/CbCr 4:2:2, 2 planes", 2, 1 },
+	{ XVIP_VF_YUV_420, 8, NULL, V4L2_MBUS_FMT_UYVY8_1_5X8,
+	  1, V4L2_PIX_FMT_NV12M, "Y/CbCr 4:2:0, 2 planes", 2, 2 },
 };
 
 /**
@@ -112,6 +112,11 @@ struct xvip_device {
  * @bpp: bytes per pixel (when stored in memory)
  * @fourcc: V4L2 pixel format FCC identifier
  * @description: format description, suitable for userspace
+ * @num_planes: number of memory planes, the chroma is in the second plane
+ * @vsub: vertical chroma subsampling factor of the chroma plane
+ *
+ * The lines of the chroma plane of a multi-planar format are as long as the
+ * lines of the luma plane, @bpp applies to the luma plane.
  */
 struct xvip_video_format {
 	unsigned int vf_code;
@@ -121,6 +126,8 @@ struct xvip_video_format {
 	unsigned int bpp;
 	u32 fourcc;
 	const char *description;
+	unsigned int num_planes;
+	unsigned int vsub;
 };
 
 const struct xvip_video_format *xvip_get_format_by_code(unsigned int code);
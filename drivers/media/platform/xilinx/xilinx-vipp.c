@@ -12,6 +12,7 @@
  * published by the Free Software Foundation.
  */
 
+#include <linux/debugfs.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/of.h>
@@ -456,8 +457,13 @@ static int xvip_graph_dma_init_one(struct xvip_composite_device *xdev,
 
 	list_add_tail(&dma->list, &xdev->dmas);
 
-	xdev->v4l2_caps |= type == V4L2_BUF_TYPE_VIDEO_CAPTURE
-			 ? V4L2_CAP_VIDEO_CAPTURE : V4L2_CAP_VIDEO_OUTPUT;
+	if (!V4L2_TYPE_IS_MULTIPLANAR(dma->queue.type))
+		xdev->v4l2_caps |= type == V4L2_BUF_TYPE_VIDEO_CAPTURE
+				 ? V4L2_CAP_VIDEO_CAPTURE : V4L2_CAP_VIDEO_OUTPUT;
+	else if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE)
+		xdev->v4l2_caps |= V4L2_CAP_VIDEO_CAPTURE_MPLANE;
+	else
+		xdev->v4l2_caps |= V4L2_CAP_VIDEO_OUTPUT_MPLANE;
 
 	return 0;
 }
@@ -622,6 +628,8 @@ static int xvip_composite_probe(struct platform_device *pdev)
 	if (ret < 0)
 		return ret;
 
+	xdev->debugfs = debugfs_create_dir(dev_name(xdev->dev), NULL);
+
 	ret = xvip_graph_init(xdev);
 	if (ret < 0)
 		goto error;
@@ -633,6 +641,7 @@ static int xvip_composite_probe(struct platform_device *pdev)
 	return 0;
 
 error:
+	debugfs_remove_recursive(xdev->debugfs);
 	xvip_composite_v4l2_cleanup(xdev);
 	return ret;
 }
@@ -642,6 +651,7 @@ static int xvip_composite_remove(struct platform_device *pdev)
 	struct xvip_composite_device *xdev = platform_get_drvdata(pdev);
 
 	xvip_graph_cleanup(xdev);
+	debugfs_remove_recursive(xdev->debugfs);
 	xvip_composite_v4l2_cleanup(xdev);
 
 	return 0;
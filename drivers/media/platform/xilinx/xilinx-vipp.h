@@ -32,6 +32,7 @@
  * @num_subdevs: number of subdevs in the pipeline
  * @dmas: list of DMA channels at the pipeline output and input
  * @v4l2_caps: V4L2 capabilities of the whole device (see VIDIOC_QUERYCAP)
+ * @debugfs: debugfs directory holding the statistics of the DMA channels
  */
 struct xvip_composite_device {
 	struct v4l2_device v4l2_dev;
@@ -44,6 +45,7 @@ struct xvip_composite_device {
 
 	struct list_head dmas;
 	u32 v4l2_caps;
+	struct dentry *debugfs;
 };
 
 #endif /* __XILINX_VIPP_H__ */
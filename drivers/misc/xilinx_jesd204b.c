@@ -17,7 +17,9 @@
 #include <linux/errno.h>
 #include <linux/init.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
@@ -35,8 +37,19 @@ struct jesd204b_state {
 	u32		addr;
 	u32		transmit;
 	unsigned long	rate;
+
+	struct mutex	resync_lock;	/* serializes resyncs and their times */
+	unsigned int	resync_count;
+	s64		resync_reset_ns;	/* until the reset completed */
+	s64		resync_sync_ns;		/* until the link synced */
 };
 
+/* a link syncs within a few multiframes, give it plenty of time */
+#define JESD204B_RESET_TIMEOUT_US	1000
+#define JESD204B_SYNC_TIMEOUT_US	100000
+/* spin this long before sleeping between polls */
+#define JESD204B_POLL_SPIN_US		100
+
 struct child_clk {
 	struct clk_hw		hw;
 	struct jesd204b_state	*st;
@@ -216,6 +229,102 @@ static ssize_t jesd204b_syncreg_read(struct device *dev,
 
 static DEVICE_ATTR(sync_status, S_IRUSR, jesd204b_syncreg_read, NULL);
 
+/*
+ * Wait until the bits @mask of register @reg read @val. Polls busily at
+ * first, links normally settle within microseconds.
+ */
+static int jesd204b_poll(struct jesd204b_state *st, unsigned reg,
+			 unsigned mask, unsigned val, ktime_t start,
+			 unsigned timeout_us)
+{
+	s64 us;
+
+	while ((jesd204b_read(st, reg) & mask) != val) {
+		us = ktime_us_delta(ktime_get(), start);
+		if (us > timeout_us)
+			return -ETIMEDOUT;
+		if (us < JESD204B_POLL_SPIN_US)
+			cpu_relax();
+		else
+			usleep_range(50, 100);
+	}
+
+	return 0;
+}
+
+/*
+ * Re-synchronize the link by resetting the core only. The transceivers and
+ * the configuration are kept, the core goes through code group sync and,
+ * if enabled, the initial lane alignment sequence again, which is much
+ * faster than a full bring-up.
+ */
+static int jesd204b_resync(struct jesd204b_state *st)
+{
+	ktime_t start, t;
+	int ret;
+
+	mutex_lock(&st->resync_lock);
+
+	start = ktime_get();
+	jesd204b_write(st, XLNX_JESD204_REG_RESET, XLNX_JESD204_RESET);
+
+	ret = jesd204b_poll(st, XLNX_JESD204_REG_RESET, XLNX_JESD204_RESET, 0,
+			    start, JESD204B_RESET_TIMEOUT_US);
+	if (ret) {
+		dev_err(st->dev, "core reset timed out\n");
+		goto out;
+	}
+	t = ktime_get();
+	st->resync_reset_ns = ktime_to_ns(ktime_sub(t, start));
+
+	ret = jesd204b_poll(st, XLNX_JESD204_REG_SYNC_STATUS,
+			    XLNX_JESD204_SYNC_STAT_SYNC,
+			    XLNX_JESD204_SYNC_STAT_SYNC, start,
+			    JESD204B_SYNC_TIMEOUT_US);
+	if (ret) {
+		dev_err(st->dev, "link sync timed out\n");
+		goto out;
+	}
+	t = ktime_get();
+	st->resync_sync_ns = ktime_to_ns(ktime_sub(t, start));
+	st->resync_count++;
+out:
+	mutex_unlock(&st->resync_lock);
+	return ret;
+}
+
+static ssize_t jesd204b_resync_write(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct jesd204b_state *st = dev_get_drvdata(dev);
+	int ret;
+
+	ret = jesd204b_resync(st);
+
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR(resync, S_IWUSR, NULL, jesd204b_resync_write);
+
+static ssize_t jesd204b_resync_time_read(struct device *dev,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	struct jesd204b_state *st = dev_get_drvdata(dev);
+	ssize_t ret;
+
+	mutex_lock(&st->resync_lock);
+	ret = sprintf(buf, "COUNT: %u, RESET: %lld ns, SYNC: %lld ns\n",
+		      st->resync_count, st->resync_reset_ns,
+		      st->resync_sync_ns);
+	mutex_unlock(&st->resync_lock);
+
+	return ret;
+}
+
+static DEVICE_ATTR(resync_time, S_IRUSR, jesd204b_resync_time_read, NULL);
+
 static unsigned long jesd204b_clk_recalc_rate(struct clk_hw *hw,
 					      unsigned long parent_rate)
 {
@@ -284,6 +393,7 @@ static int jesd204b_probe(struct platform_device *pdev)
 		return PTR_ERR(st->regs);
 
 	st->dev = &pdev->dev;
+	mutex_init(&st->resync_lock);
 
 	platform_set_drvdata(pdev, st);
 
@@ -352,6 +462,10 @@ static int jesd204b_probe(struct platform_device *pdev)
 
 	device_create_file(&pdev->dev, &dev_attr_sync_status);
 
+	device_create_file(&pdev->dev, &dev_attr_resync);
+
+	device_create_file(&pdev->dev, &dev_attr_resync_time);
+
 	switch (st->lanes) {
 	case 8:
 		device_create_file(&pdev->dev, &dev_attr_lane4_info);
@@ -52,6 +52,8 @@
 						   */
 
 #define XLNX_JESD204_REG_SYNC_STATUS		0x038 /* Link SYNC status */
+#define XLNX_JESD204_SYNC_STAT_SYNC		(1 << 0)
+#define XLNX_JESD204_SYNC_STAT_SYSREF		(1 << 16)
 #define XLNX_JESD204_REG_SYNC_ERR_STAT		0x01C /* RX only */
 #define XLNX_JESD204_SYNC_ERR_NOT_IN_TAB(lane)		(1 << (0 + (lane) * 3))
 #define XLNX_JESD204_SYNC_ERR_DISPARITY(lane)		(1 << (1 + (lane) * 3))
@@ -29,12 +29,17 @@
 #include <linux/init.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of_platform.h>
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
 #include <linux/platform_device.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/string.h>
 
 /* Hw specific definitions */
 
@@ -190,6 +195,12 @@
  */
 #define XTG_INIT_VERSION	0x47	/* Trafgen initial version(v1.0) */
 
+/* Benchmark Definitions */
+#define XTG_BENCH_MAX_DURATION_MS	60000	/* Longest benchmark run */
+#define XTG_BENCH_RUN_TIMEOUT_MS	1000	/* Timeout of one program run */
+#define XTG_BENCH_BOUNDARY		0x1000	/* AXI 4KB burst boundary */
+#define XTG_BENCH_BURST_INCR		0x1	/* INCR burst type */
+
 /* Macro */
 #define to_xtg_dev_info(n)	((struct xtg_dev_info *)dev_get_drvdata(n))
 
@@ -273,6 +284,54 @@ struct xtg_pram {
 	u32 is_valid_req;
 };
 
+/**
+ * struct xtg_bench_profile - Benchmark traffic profile
+ * @read: Generate read traffic
+ * @write: Generate write traffic
+ * @fixed: Issue every burst to @addr instead of walking @range
+ * @addr: Base address of the traffic
+ * @range: Size of the address window walked by the bursts
+ * @len: Beats per burst
+ * @size: Bytes per beat
+ * @outstanding: Maximum outstanding bursts per direction, 0 for no limit
+ * @cmds: Number of bursts per direction in the command RAM program
+ * @cache: Driven to a*_cache line
+ * @duration_ms: Time the program is rerun for
+ */
+struct xtg_bench_profile {
+	bool read;
+	bool write;
+	bool fixed;
+	u32 addr;
+	u32 range;
+	u32 len;
+	u32 size;
+	u32 outstanding;
+	u32 cmds;
+	u32 cache;
+	u32 duration_ms;
+};
+
+/**
+ * struct xtg_bench_result - Benchmark results
+ * @runs: Number of completed program runs
+ * @bytes: Bytes transferred
+ * @xfers: Bursts completed
+ * @busy_ns: Time the master logic was running
+ * @min_ns: Shortest time per burst of a single run
+ * @max_ns: Longest time per burst of a single run
+ * @errors: Error status the benchmark stopped on, 0 if none
+ */
+struct xtg_bench_result {
+	u32 runs;
+	u64 bytes;
+	u64 xfers;
+	u64 busy_ns;
+	u64 min_ns;
+	u64 max_ns;
+	u32 errors;
+};
+
 /**
  * struct xtg_dev_info - Global Driver structure
  * @regs: Iomapped base address
@@ -282,6 +341,8 @@ struct xtg_pram {
  * @last_wr_valid_idx: Last Write Valid Command Index
  * @id: Device instance id
  * @xtg_mram_offset: MasterRam offset
+ * @bench_lock: Serializes benchmark runs and protects @bench
+ * @bench: Results of the last benchmark run
  */
 struct xtg_dev_info {
 	void __iomem *regs;
@@ -291,6 +352,8 @@ struct xtg_dev_info {
 	s16 last_wr_valid_idx;
 	u32 id;
 	u32 xtg_mram_offset;
+	struct mutex bench_lock;
+	struct xtg_bench_result bench;
 };
 
 /**
@@ -914,6 +977,298 @@ static ssize_t stream_transfercnt_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(stream_transfercnt);
 
+/**
+ * xtg_bench_parse - Parses a benchmark profile
+ * @buf: Space separated list of key=value pairs
+ * @p: Pointer to xtg_bench_profile structure to fill
+ *
+ * Return: 0 on success and failure value on error
+ */
+static int xtg_bench_parse(const char *buf, struct xtg_bench_profile *p)
+{
+	char *opts, *next, *key, *val;
+	u32 burst;
+	int err = 0;
+
+	p->read = true;
+	p->write = false;
+	p->fixed = false;
+	p->addr = 0;
+	p->range = SZ_1M;
+	p->len = 16;
+	p->size = 8;
+	p->outstanding = 0;
+	p->cmds = MAX_NUM_ENTRIES;
+	p->cache = 0;
+	p->duration_ms = 1000;
+
+	opts = kstrdup(buf, GFP_KERNEL);
+	if (!opts)
+		return -ENOMEM;
+
+	next = strim(opts);
+	while (!err && (key = strsep(&next, " \t")) != NULL) {
+		if (!*key)
+			continue;
+
+		val = strchr(key, '=');
+		if (!val) {
+			err = -EINVAL;
+			break;
+		}
+		*val++ = '\0';
+
+		if (!strcmp(key, "dir")) {
+			p->read = !strcmp(val, "read") || !strcmp(val, "both");
+			p->write = !strcmp(val, "write") ||
+				   !strcmp(val, "both");
+			if (!p->read && !p->write)
+				err = -EINVAL;
+		} else if (!strcmp(key, "pattern")) {
+			p->fixed = !strcmp(val, "fixed");
+			if (!p->fixed && strcmp(val, "linear"))
+				err = -EINVAL;
+		} else if (!strcmp(key, "addr")) {
+			err = kstrtou32(val, 0, &p->addr);
+		} else if (!strcmp(key, "range")) {
+			err = kstrtou32(val, 0, &p->range);
+		} else if (!strcmp(key, "len")) {
+			err = kstrtou32(val, 0, &p->len);
+		} else if (!strcmp(key, "size")) {
+			err = kstrtou32(val, 0, &p->size);
+		} else if (!strcmp(key, "outstanding")) {
+			err = kstrtou32(val, 0, &p->outstanding);
+		} else if (!strcmp(key, "cmds")) {
+			err = kstrtou32(val, 0, &p->cmds);
+		} else if (!strcmp(key, "cache")) {
+			err = kstrtou32(val, 0, &p->cache);
+		} else if (!strcmp(key, "duration_ms")) {
+			err = kstrtou32(val, 0, &p->duration_ms);
+		} else {
+			err = -EINVAL;
+		}
+	}
+
+	kfree(opts);
+	if (err)
+		return err;
+
+	burst = p->len * p->size;
+	if (!p->len || p->len > XTG_LEN_MASK + 1 ||
+	    !is_power_of_2(p->size) || ilog2(p->size) > XTG_SIZE_MASK ||
+	    burst > XTG_BENCH_BOUNDARY || p->range < burst ||
+	    !p->cmds || p->cmds > MAX_NUM_ENTRIES ||
+	    p->outstanding > p->cmds || p->cache > XTG_CACHE_MASK ||
+	    !p->duration_ms || p->duration_ms > XTG_BENCH_MAX_DURATION_MS)
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * xtg_bench_program - Loads a benchmark profile into the command RAM
+ * @tg: Pointer to xtg_dev_info structure
+ * @p: Pointer to xtg_bench_profile structure
+ *
+ * The outstanding limit is implemented with command dependencies: burst i
+ * is only issued once burst i - @outstanding of the same direction has
+ * completed. The parameter RAM is cleared so every command runs once.
+ *
+ * Return: 0 on success and failure value on error
+ */
+static int xtg_bench_program(struct xtg_dev_info *tg,
+				const struct xtg_bench_profile *p)
+{
+	u32 burst = p->len * p->size;
+	struct xtg_cram cmd;
+	u32 cmd_words[4];
+	int block, i, off;
+
+	/* Reject bursts crossing a 4KB boundary before touching the RAMs */
+	for (i = 0; i < p->cmds; i++) {
+		u32 addr = p->fixed ? p->addr :
+				p->addr + (i * burst) % p->range;
+
+		if ((addr & (p->size - 1)) ||
+		    (addr & (XTG_BENCH_BOUNDARY - 1)) + burst >
+				XTG_BENCH_BOUNDARY)
+			return -EINVAL;
+	}
+
+	xtg_access_rams(tg, XTG_COMMAND_RAM_OFFSET, XTG_COMMAND_RAM_SIZE,
+			XTG_WRITE_RAM | XTG_WRITE_RAM_ZERO, NULL);
+	xtg_access_rams(tg, XTG_PARAM_RAM_OFFSET, XTG_PARAM_RAM_SIZE,
+			XTG_WRITE_RAM | XTG_WRITE_RAM_ZERO, NULL);
+	tg->last_rd_valid_idx = -1;
+	tg->last_wr_valid_idx = -1;
+
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.valid_cmd = 1;
+	cmd.burst = XTG_BENCH_BURST_INCR;
+	cmd.length = p->len - 1;
+	cmd.size = ilog2(p->size);
+	cmd.cache = p->cache;
+
+	for (block = 0; block < 2; block++) {
+		if (!(block ? p->write : p->read))
+			continue;
+
+		for (i = 0; i < p->cmds; i++) {
+			cmd.addr = p->fixed ? p->addr :
+					p->addr + (i * burst) % p->range;
+			/* Dependencies are 1 based, 0 means none */
+			cmd.my_dpnd = (p->outstanding && i >= p->outstanding) ?
+					i - p->outstanding + 1 : 0;
+
+			xtg_prepare_cmd_words(tg, &cmd, cmd_words);
+			off = XTG_COMMAND_RAM_OFFSET +
+				block * XTG_CMD_RAM_BLOCK_SIZE +
+				i * XTG_CRAM_BYTES_PER_ENTRY;
+			xtg_access_rams(tg, off, XTG_CRAM_BYTES_PER_ENTRY,
+					XTG_WRITE_RAM, cmd_words);
+		}
+
+		if (block)
+			tg->last_wr_valid_idx = p->cmds - 1;
+		else
+			tg->last_rd_valid_idx = p->cmds - 1;
+	}
+
+	return 0;
+}
+
+/**
+ * xtg_bench_run - Reruns the command RAM program for the profile duration
+ * @tg: Pointer to xtg_dev_info structure
+ * @p: Pointer to xtg_bench_profile structure
+ * @res: Pointer to xtg_bench_result structure to fill
+ *
+ * The master logic is polled rather than waited for with the completion
+ * interrupt so that the interrupt latency does not end up in the results.
+ *
+ * Return: 0 on success and failure value on error
+ */
+static int xtg_bench_run(struct xtg_dev_info *tg,
+			const struct xtg_bench_profile *p,
+			struct xtg_bench_result *res)
+{
+	u32 xfers = p->cmds * (p->read + p->write);
+	ktime_t deadline, timeout, start, end;
+	u64 run_ns, per_xfer_ns;
+
+	memset(res, 0, sizeof(*res));
+	res->min_ns = U64_MAX;
+
+	deadline = ktime_add_ms(ktime_get(), p->duration_ms);
+	do {
+		writel(XTG_ERR_STS_MSTDONE_MASK | XTG_ERR_ALL_ERRS_MASK,
+			tg->regs + XTG_ERR_STS_OFFSET);
+
+		start = ktime_get();
+		timeout = ktime_add_ms(start, XTG_BENCH_RUN_TIMEOUT_MS);
+		writel(readl(tg->regs + XTG_MCNTL_OFFSET) |
+				XTG_MCNTL_MSTEN_MASK,
+			tg->regs + XTG_MCNTL_OFFSET);
+
+		while (readl(tg->regs + XTG_MCNTL_OFFSET) &
+				XTG_MCNTL_MSTEN_MASK) {
+			if (ktime_after(ktime_get(), timeout)) {
+				dev_err(tg->dev, "benchmark run timed out\n");
+				return -ETIMEDOUT;
+			}
+			cpu_relax();
+		}
+		end = ktime_get();
+
+		res->errors = readl(tg->regs + XTG_ERR_STS_OFFSET) &
+				XTG_ERR_ALL_ERRS_MASK;
+		if (res->errors)
+			break;
+
+		run_ns = ktime_to_ns(ktime_sub(end, start));
+		per_xfer_ns = div_u64(run_ns, xfers);
+		res->runs++;
+		res->xfers += xfers;
+		res->bytes += (u64)xfers * p->len * p->size;
+		res->busy_ns += run_ns;
+		res->min_ns = min(res->min_ns, per_xfer_ns);
+		res->max_ns = max(res->max_ns, per_xfer_ns);
+
+		cond_resched();
+	} while (ktime_before(end, deadline));
+
+	if (!res->runs)
+		res->min_ns = 0;
+
+	return 0;
+}
+
+static ssize_t benchmark_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct xtg_dev_info *tg = to_xtg_dev_info(dev);
+	struct xtg_bench_result res;
+	u64 kbps = 0, avg_ns = 0;
+
+	mutex_lock(&tg->bench_lock);
+	res = tg->bench;
+	mutex_unlock(&tg->bench_lock);
+
+	if (res.busy_ns)
+		kbps = div64_u64(res.bytes * (NSEC_PER_SEC / 1024),
+				 res.busy_ns);
+	if (res.xfers)
+		avg_ns = div64_u64(res.busy_ns, res.xfers);
+
+	return snprintf(buf, PAGE_SIZE,
+			"runs=%u bytes=%llu time_ns=%llu bandwidth_kbps=%llu "
+			"avg_ns=%llu min_ns=%llu max_ns=%llu errors=0x%08x\n",
+			res.runs, res.bytes, res.busy_ns, kbps, avg_ns,
+			res.min_ns, res.max_ns, res.errors);
+}
+
+/*
+ * Writing a profile, for example
+ *
+ *	dir=both addr=0x10000000 range=0x100000 len=16 size=8 outstanding=4
+ *
+ * reprograms the command and parameter RAM and reruns the program for
+ * duration_ms before the write returns. The results are then read back
+ * from the same file. The avg/min/max times are per burst, so with
+ * outstanding=1 they are the burst latency.
+ */
+static ssize_t benchmark_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t size)
+{
+	struct xtg_dev_info *tg = to_xtg_dev_info(dev);
+	struct xtg_bench_profile p;
+	struct xtg_bench_result res;
+	int err;
+
+	err = xtg_bench_parse(buf, &p);
+	if (err)
+		return err;
+
+	mutex_lock(&tg->bench_lock);
+	if (readl(tg->regs + XTG_MCNTL_OFFSET) & XTG_MCNTL_MSTEN_MASK) {
+		err = -EBUSY;
+		goto out;
+	}
+
+	err = xtg_bench_program(tg, &p);
+	if (err)
+		goto out;
+
+	err = xtg_bench_run(tg, &p, &res);
+	if (!err)
+		tg->bench = res;
+out:
+	mutex_unlock(&tg->bench_lock);
+
+	return err ? err : size;
+}
+static DEVICE_ATTR_RW(benchmark);
+
 static ssize_t xtg_pram_read(struct file *filp, struct kobject *kobj,
 				struct bin_attribute *bin_attr,
 				char *buf, loff_t off, size_t count)
@@ -1185,6 +1540,7 @@ static const struct attribute *xtg_attrs[] = {
 	&dev_attr_stream_transferlen.attr,
 	&dev_attr_stream_enable.attr,
 	&dev_attr_reset_static_transferdone.attr,
+	&dev_attr_benchmark.attr,
 	NULL,
 };
 
@@ -1302,6 +1658,8 @@ static int xtg_probe(struct platform_device *pdev)
 		}
 	}
 
+	mutex_init(&tg->bench_lock);
+
 	/*
 	 * Create sysfs file entries for the device
 	 */
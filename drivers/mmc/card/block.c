@@ -118,7 +118,18 @@ struct mmc_blk_data {
 	unsigned int	part_curr;
 	struct device_attribute force_ro;
 	struct device_attribute power_ro_lock;
+	struct device_attribute packed_stats;
 	int	area_type;
+
+	/*
+	 * Write statistics, only updated by the queue thread. Writes
+	 * sent as part of a packed command are not counted as single.
+	 */
+	unsigned long	packed_cmds;
+	unsigned long	packed_reqs;
+	unsigned long	single_writes;
+	unsigned long	write_reqs;
+	unsigned long long write_sectors;
 };
 
 static DEFINE_MUTEX(open_lock);
@@ -286,6 +297,42 @@ out:
 	return ret;
 }
 
+static ssize_t packed_stats_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	int ret;
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	unsigned long reqs = md->write_reqs;
+
+	ret = snprintf(buf, PAGE_SIZE,
+		       "packed_cmds %lu\npacked_reqs %lu\nsingle_writes %lu\n"
+		       "mean_write_sectors %llu\n",
+		       md->packed_cmds, md->packed_reqs, md->single_writes,
+		       reqs ? div_u64(md->write_sectors, reqs) : 0);
+	mmc_blk_put(md);
+	return ret;
+}
+
+static ssize_t packed_stats_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct mmc_blk_data *md;
+	unsigned long set;
+
+	if (kstrtoul(buf, 0, &set) || set)
+		return -EINVAL;
+
+	md = mmc_blk_get(dev_to_disk(dev));
+	md->packed_cmds = 0;
+	md->packed_reqs = 0;
+	md->single_writes = 0;
+	md->write_reqs = 0;
+	md->write_sectors = 0;
+	mmc_blk_put(md);
+
+	return count;
+}
+
 static int mmc_blk_open(struct block_device *bdev, fmode_t mode)
 {
 	struct mmc_blk_data *md = mmc_blk_get(bdev->bd_disk);
@@ -1633,6 +1680,30 @@ no_packed:
 	return 0;
 }
 
+static void mmc_blk_account_write(struct mmc_blk_data *md,
+				  struct mmc_queue_req *mqrq,
+				  struct request *req, bool packed)
+{
+	struct request *prq;
+
+	if (rq_data_dir(req) != WRITE)
+		return;
+
+	if (!packed) {
+		md->single_writes++;
+		md->write_reqs++;
+		md->write_sectors += blk_rq_sectors(req);
+		return;
+	}
+
+	md->packed_cmds++;
+	list_for_each_entry(prq, &mqrq->packed->list, queuelist) {
+		md->packed_reqs++;
+		md->write_reqs++;
+		md->write_sectors += blk_rq_sectors(prq);
+	}
+}
+
 static void mmc_blk_packed_hdr_wrq_prep(struct mmc_queue_req *mqrq,
 					struct mmc_card *card,
 					struct mmc_queue *mq)
@@ -1834,8 +1905,11 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 	if (!rqc && !mq->mqrq_prev->req)
 		return 0;
 
-	if (rqc)
+	if (rqc) {
 		reqs = mmc_blk_prep_packed_list(mq, rqc);
+		mmc_blk_account_write(md, mq->mqrq_cur, rqc,
+				      reqs >= packed_nr);
+	}
 
 	do {
 		if (rqc) {
@@ -2290,6 +2364,8 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 			mmc_packed_clean(&md->queue);
 		if (md->disk->flags & GENHD_FL_UP) {
 			device_remove_file(disk_to_dev(md->disk), &md->force_ro);
+			device_remove_file(disk_to_dev(md->disk),
+					   &md->packed_stats);
 			if ((md->area_type & MMC_BLK_DATA_AREA_BOOT) &&
 					card->ext_csd.boot_ro_lockable)
 				device_remove_file(disk_to_dev(md->disk),
@@ -2330,6 +2406,15 @@ static int mmc_add_disk(struct mmc_blk_data *md)
 	if (ret)
 		goto force_ro_fail;
 
+	md->packed_stats.show = packed_stats_show;
+	md->packed_stats.store = packed_stats_store;
+	sysfs_attr_init(&md->packed_stats.attr);
+	md->packed_stats.attr.name = "packed_stats";
+	md->packed_stats.attr.mode = S_IRUGO | S_IWUSR;
+	ret = device_create_file(disk_to_dev(md->disk), &md->packed_stats);
+	if (ret)
+		goto packed_stats_fail;
+
 	if ((md->area_type & MMC_BLK_DATA_AREA_BOOT) &&
 	     card->ext_csd.boot_ro_lockable) {
 		umode_t mode;
@@ -2353,6 +2438,8 @@ static int mmc_add_disk(struct mmc_blk_data *md)
 	return ret;
 
 power_ro_lock_fail:
+	device_remove_file(disk_to_dev(md->disk), &md->packed_stats);
+packed_stats_fail:
 	device_remove_file(disk_to_dev(md->disk), &md->force_ro);
 force_ro_fail:
 	del_gendisk(md->disk);
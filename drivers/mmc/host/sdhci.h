@@ -227,9 +227,23 @@
 /* 55-57 reserved */
 
 #define SDHCI_ADMA_ADDRESS	0x58
+#define SDHCI_ADMA_ADDRESS_HI	0x5C
 
 /* 60-FB reserved */
 
+/*
+ * ADMA2 32-bit descriptors are 8 bytes, 64-bit descriptors add the upper
+ * half of the address after the 32-bit descriptor layout.
+ */
+#define SDHCI_ADMA2_32_DESC_SZ	8
+#define SDHCI_ADMA2_64_DESC_SZ	12
+
+/*
+ * A descriptor for every sg entry and potentially one alignment transfer
+ * for each of those, plus the terminating entry.
+ */
+#define SDHCI_ADMA2_DESC_CNT	(128 * 2 + 1)
+
 #define SDHCI_PRESET_FOR_SDR12 0x66
 #define SDHCI_PRESET_FOR_SDR25 0x68
 #define SDHCI_PRESET_FOR_SDR50 0x6A
@@ -1,3 +1,4 @@
+#include <linux/bitops.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/interrupt.h>
@@ -142,6 +143,7 @@ static const struct anfc_ecc_matrix ecc_matrix[] = {
  * @bch:		Bch / Hamming mode enable/disable.
  * @err:		Error identifier.
  * @iswriteoob:		Identifies if oob write operation is required.
+ * @cached:		Program the page with PAGE CACHE PROGRAM.
  * @buf:		Buffer used for read/write byte operations.
  * @raddr_cycles:	Row address cycle information.
  * @caddr_cycles:	Column address cycle information.
@@ -167,6 +169,7 @@ struct anfc {
 	bool bch;
 	bool err;
 	bool iswriteoob;
+	bool cached;
 
 	u8 buf[TEMP_BUF_SIZE];
 
@@ -359,7 +362,8 @@ static void anfc_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
 		buf_rd_cnt++;
 
 		if (buf_rd_cnt == pktcount)
-			anfc_enable_intrs(nfc, XFER_COMPLETE);
+			anfc_enable_intrs(nfc, XFER_COMPLETE |
+					  (nfc->rdintrmask & MBIT_ERROR));
 
 		for (i = 0; i < pktsize / 4; i++)
 			bufptr[i] = readl(nfc->base + DATA_PORT_OFST);
@@ -428,12 +432,54 @@ static void anfc_write_buf(struct mtd_info *mtd, const uint8_t *buf, int len)
 	anfc_wait_for_event(nfc, XFER_COMPLETE);
 }
 
+static int anfc_zero_bits(const u8 *buf, int len)
+{
+	int i, bits = 0;
+
+	for (i = 0; i < len; i++)
+		bits += 8 - hweight8(buf[i]);
+
+	return bits;
+}
+
+/*
+ * The BCH engine flags every erased page as uncorrectable, as the 0xff
+ * ECC bytes do not match the 0xff data. Treat the page as erased when no
+ * ECC step holds more zero bits than the ECC strength could correct.
+ */
+static int anfc_check_erased_page(struct mtd_info *mtd,
+				  struct nand_chip *chip, uint8_t *buf)
+{
+	u8 *ecc = chip->oob_poi + chip->ecc.layout->eccpos[0];
+	int i, flips, max_bitflips = 0, corrected = 0;
+
+	for (i = 0; i < chip->ecc.steps; i++) {
+		flips = anfc_zero_bits(buf + i * chip->ecc.size,
+				       chip->ecc.size) +
+			anfc_zero_bits(ecc + i * chip->ecc.bytes,
+				       chip->ecc.bytes);
+		if (flips > chip->ecc.strength) {
+			mtd->ecc_stats.failed++;
+			return 0;
+		}
+		corrected += flips;
+		max_bitflips = max(max_bitflips, flips);
+	}
+
+	mtd->ecc_stats.corrected += corrected;
+	memset(buf, 0xff, mtd->writesize);
+	memset(chip->oob_poi, 0xff, mtd->oobsize);
+
+	return max_bitflips;
+}
+
 static int anfc_read_page_hwecc(struct mtd_info *mtd,
 				struct nand_chip *chip, uint8_t *buf,
 				int oob_required, int page)
 {
 	u32 val;
 	struct anfc *nfc = container_of(mtd, struct anfc, mtd);
+	unsigned int max_bitflips = 0;
 
 	anfc_set_eccsparecmd(nfc, NAND_CMD_RNDOUT, NAND_CMD_RNDOUTSTART);
 
@@ -446,29 +492,42 @@ static int anfc_read_page_hwecc(struct mtd_info *mtd,
 	else
 		nfc->rdintrmask = READ_READY;
 
-	if (!nfc->bch)
-		nfc->rdintrmask = MBIT_ERROR;
+	nfc->rdintrmask |= MBIT_ERROR;
+	nfc->err = false;
 
 	chip->read_buf(mtd, buf, mtd->writesize);
 
-	val = readl(nfc->base + ECC_ERR_CNT_OFST);
 	if (nfc->bch) {
-		mtd->ecc_stats.corrected += val & PAGE_ERR_CNT_MASK;
+		val = readl(nfc->base + ECC_ERR_CNT_OFST);
+		val = (val & PAGE_ERR_CNT_MASK) >> 8;
+		mtd->ecc_stats.corrected += val;
+		/*
+		 * Only the total of the page is known, no step can hold more
+		 * bitflips than the engine corrects though.
+		 */
+		max_bitflips = min_t(u32, val, chip->ecc.strength);
 	} else {
 		val = readl(nfc->base + ECC_ERR_CNT_1BIT_OFST);
 		mtd->ecc_stats.corrected += val;
+		if (val)
+			max_bitflips = 1;
 		val = readl(nfc->base + ECC_ERR_CNT_2BIT_OFST);
 		mtd->ecc_stats.failed += val;
 		/* clear ecc error count register 1Bit, 2Bit */
 		writel(0x0, nfc->base + ECC_ERR_CNT_1BIT_OFST);
 		writel(0x0, nfc->base + ECC_ERR_CNT_2BIT_OFST);
 	}
-	nfc->err = false;
 
-	if (oob_required)
+	if (oob_required || (nfc->err && nfc->bch))
 		chip->ecc.read_oob(mtd, chip, page);
 
-	return 0;
+	if (nfc->err && nfc->bch) {
+		nfc->err = false;
+		return anfc_check_erased_page(mtd, chip, buf);
+	}
+	nfc->err = false;
+
+	return max_bitflips;
 }
 
 static int anfc_write_page_hwecc(struct mtd_info *mtd,
@@ -504,6 +563,44 @@ static int anfc_write_page_hwecc(struct mtd_info *mtd,
 	return 0;
 }
 
+/*
+ * A page of a multi-page write that is followed by another page of the
+ * same block is programmed with PAGE CACHE PROGRAM: the device is ready
+ * for the next page's data once this page moved to its data register,
+ * instead of after programming the array.
+ */
+static int anfc_write_page(struct mtd_info *mtd, struct nand_chip *chip,
+			   uint32_t offset, int data_len, const uint8_t *buf,
+			   int oob_required, int page, int cached, int raw)
+{
+	struct anfc *nfc = container_of(mtd, struct anfc, mtd);
+	int status;
+
+	/* writing the OOB reads the ECC bytes back in between */
+	nfc->cached = cached && NAND_HAS_CACHEPROG(chip) && !oob_required;
+	chip->cmdfunc(mtd, NAND_CMD_SEQIN, 0x00, page);
+	cached = nfc->cached;
+	nfc->cached = false;
+
+	if (unlikely(raw))
+		status = chip->ecc.write_page_raw(mtd, chip, buf, oob_required);
+	else
+		status = chip->ecc.write_page(mtd, chip, buf, oob_required);
+
+	if (status < 0)
+		return status;
+
+	status = chip->waitfunc(mtd, chip);
+	if (status < 0)
+		return status;
+
+	/* a failed cache program shows up with the last page of the run */
+	if (!cached && (status & NAND_STATUS_FAIL))
+		return -EIO;
+
+	return 0;
+}
+
 static u8 anfc_read_byte(struct mtd_info *mtd)
 {
 	struct anfc *nfc = container_of(mtd, struct anfc, mtd);
@@ -639,8 +736,9 @@ static void anfc_cmd_function(struct mtd_info *mtd,
 	case NAND_CMD_SEQIN:
 		addrcycles = nfc->raddr_cycles + nfc->caddr_cycles;
 		nfc->page = page_addr;
-		anfc_prepare_cmd(nfc, cmd, NAND_CMD_PAGEPROG, 1,
-				 mtd->writesize, addrcycles);
+		anfc_prepare_cmd(nfc, cmd, nfc->cached ? NAND_CMD_CACHEDPROG :
+				 NAND_CMD_PAGEPROG, 1, mtd->writesize,
+				 addrcycles);
 		anfc_setpagecoladdr(nfc, page_addr, column);
 		break;
 	case NAND_CMD_READOOB:
@@ -738,10 +836,12 @@ static irqreturn_t anfc_irq_handler(int irq, void *ptr)
 		regval |= WRITE_READY;
 	}
 
+	/* the transfer goes on, the error is picked up once it is done */
 	if (status & MBIT_ERROR) {
 		nfc->err = true;
-		complete(&nfc->bufrdy);
-		regval |= MBIT_ERROR;
+		writel(MBIT_ERROR, nfc->base + INTR_STS_OFST);
+		if (!regval)
+			return IRQ_HANDLED;
 	}
 
 	if (regval) {
@@ -787,12 +887,21 @@ static int anfc_probe(struct platform_device *pdev)
 	nand_chip->read_buf = anfc_read_buf;
 	nand_chip->write_buf = anfc_write_buf;
 	nand_chip->read_byte = anfc_read_byte;
+	nand_chip->write_page = anfc_write_page;
 	nand_chip->options = NAND_BUSWIDTH_AUTO;
 	nand_chip->bbt_options = NAND_BBT_USE_FLASH;
 	nand_chip->select_chip = anfc_select_chip;
 	mtd->size = nand_chip->chipsize;
 	nfc->dma = of_property_read_bool(pdev->dev.of_node,
 					 "arasan,has-mdma");
+	if (nfc->dma) {
+		/* the DMA address registers take all 64 bits */
+		err = dma_set_mask_and_coherent(&pdev->dev, DMA_BIT_MASK(64));
+		if (err)
+			return err;
+		/* vmalloc()ed buffers of UBI cannot be mapped for DMA */
+		nand_chip->options |= NAND_USE_BOUNCE_BUFFER;
+	}
 	platform_set_drvdata(pdev, nfc);
 	init_completion(&nfc->bufrdy);
 	init_completion(&nfc->xfercomp);
@@ -808,6 +917,9 @@ static int anfc_probe(struct platform_device *pdev)
 	}
 	nfc->raddr_cycles = nand_chip->onfi_params.addr_cycles & 0xF;
 	nfc->caddr_cycles = (nand_chip->onfi_params.addr_cycles >> 4) & 0xF;
+	if (le16_to_cpu(nand_chip->onfi_params.opt_cmd) &
+	    ONFI_OPT_CMD_PROG_CACHE)
+		nand_chip->options |= NAND_CACHEPRG;
 
 	if (anfc_ecc_init(mtd, &nand_chip->ecc))
 		return -ENXIO;
@@ -1524,6 +1524,40 @@ static int nand_setup_read_retry(struct mtd_info *mtd, int retry_mode)
  *
  * Internal function. Called with chip held.
  */
+/**
+ * nand_cache_read_pages - [INTERN] pages to read with the page cache
+ * @mtd: MTD device structure
+ * @realpage: page about to be read with NAND_CMD_READ0
+ * @col: column the read starts at
+ * @readlen: number of bytes left to read
+ *
+ * Returns how many whole pages following @realpage can be fetched with
+ * READ CACHE SEQUENTIAL: the device then loads each page into its data
+ * register while the previous one is transferred from the cache
+ * register, hiding the array read time of all pages but the first.
+ * Sequences stay within one block, as the command does not cross block
+ * boundaries, and stop before a page served from chip->pagebuf, which
+ * would not be read from the device.
+ */
+static int nand_cache_read_pages(struct mtd_info *mtd, int realpage, int col,
+				 uint32_t readlen)
+{
+	struct nand_chip *chip = mtd->priv;
+	int ppb = 1 << (chip->phys_erase_shift - chip->page_shift);
+	int pages;
+
+	/* an ECC failure would have to re-read a page we moved past */
+	if (!NAND_HAS_CACHE_READ(chip) || col || chip->read_retries > 1)
+		return 0;
+
+	pages = (readlen >> chip->page_shift) - 1;
+	pages = min(pages, ppb - 1 - (realpage & (ppb - 1)));
+	if (chip->pagebuf > realpage && chip->pagebuf <= realpage + pages)
+		pages = chip->pagebuf - realpage - 1;
+
+	return max(pages, 0);
+}
+
 static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 			    struct mtd_oob_ops *ops)
 {
@@ -1540,6 +1574,7 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	unsigned int max_bitflips = 0;
 	int retry_mode = 0;
 	bool ecc_fail = false;
+	int cache_pages = 0;
 
 	chipnr = (int)(from >> chip->chip_shift);
 	chip->select_chip(mtd, chipnr);
@@ -1575,7 +1610,21 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 						 __func__, buf);
 
 read_retry:
-			chip->cmdfunc(mtd, NAND_CMD_READ0, 0x00, page);
+			if (cache_pages) {
+				/* the page is in the data register already */
+				cache_pages--;
+				chip->cmdfunc(mtd, cache_pages ?
+					      NAND_CMD_READCACHESEQ :
+					      NAND_CMD_READCACHEEND, -1, -1);
+			} else {
+				chip->cmdfunc(mtd, NAND_CMD_READ0, 0x00, page);
+				cache_pages = nand_cache_read_pages(mtd,
+						realpage, col, readlen);
+				if (cache_pages)
+					chip->cmdfunc(mtd,
+						      NAND_CMD_READCACHESEQ,
+						      -1, -1);
+			}
 
 			/*
 			 * Now read the page into the buffer.  Absent an error,
@@ -1685,6 +1734,11 @@ read_retry:
 			chip->select_chip(mtd, chipnr);
 		}
 	}
+
+	/* leave the cache read mode left behind by an aborted sequence */
+	if (cache_pages)
+		chip->cmdfunc(mtd, NAND_CMD_RESET, -1, -1);
+
 	chip->select_chip(mtd, -1);
 
 	ops->retlen = ops->len - (size_t) readlen;
@@ -4123,6 +4177,11 @@ int nand_scan_tail(struct mtd_info *mtd)
 	/* Invalidate the pagebuffer reference */
 	chip->pagebuf = -1;
 
+	/* Only large page ONFI devices may advertise the read cache commands */
+	if (!chip->onfi_version || chip->page_shift <= 9 ||
+	    !(le16_to_cpu(chip->onfi_params.opt_cmd) & ONFI_OPT_CMD_READ_CACHE))
+		chip->options &= ~NAND_CACHE_READ;
+
 	/* Large page NAND with SOFT_ECC should support subpage reads */
 	switch (ecc->mode) {
 	case NAND_ECC_SOFT:
@@ -108,6 +108,8 @@ struct pl353_nand_info {
 static const struct pl353_nand_command_format pl353_nand_commands[] = {
 	{NAND_CMD_READ0, NAND_CMD_READSTART, 5, PL353_NAND_CMD_PHASE},
 	{NAND_CMD_RNDOUT, NAND_CMD_RNDOUTSTART, 2, PL353_NAND_CMD_PHASE},
+	{NAND_CMD_READCACHESEQ, NAND_CMD_NONE, 0, NAND_CMD_NONE},
+	{NAND_CMD_READCACHEEND, NAND_CMD_NONE, 0, NAND_CMD_NONE},
 	{NAND_CMD_READID, NAND_CMD_NONE, 1, NAND_CMD_NONE},
 	{NAND_CMD_STATUS, NAND_CMD_NONE, 0, NAND_CMD_NONE},
 	{NAND_CMD_SEQIN, NAND_CMD_PAGEPROG, 5, PL353_NAND_DATA_PHASE},
@@ -799,6 +801,8 @@ static void pl353_nand_cmd_function(struct mtd_info *mtd, unsigned int command,
 	ndelay(100);
 
 	if ((command == NAND_CMD_READ0) ||
+	    (command == NAND_CMD_READCACHESEQ) ||
+	    (command == NAND_CMD_READCACHEEND) ||
 	    (command == NAND_CMD_RESET) ||
 	    (command == NAND_CMD_PARAM) ||
 	    (command == NAND_CMD_GET_FEATURES)) {
@@ -822,16 +826,16 @@ static void pl353_nand_cmd_function(struct mtd_info *mtd, unsigned int command,
  * @mtd:	Pointer to the mtd info structure
  * @buf:	Pointer to the buffer to store read data
  * @len:	Number of bytes to read
+ *
+ * The data phase address encodes the command state, so the data can only
+ * be moved through one fixed address: use back to back word accesses
+ * without a barrier after every word.
  */
 static void pl353_nand_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
 {
-	int i;
 	struct nand_chip *chip = mtd->priv;
-	unsigned long *ptr = (unsigned long *)buf;
 
-	len >>= 2;
-	for (i = 0; i < len; i++)
-		ptr[i] = readl(chip->IO_ADDR_R);
+	ioread32_rep(chip->IO_ADDR_R, buf, len >> 2);
 }
 
 /**
@@ -843,14 +847,11 @@ static void pl353_nand_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
 static void pl353_nand_write_buf(struct mtd_info *mtd, const uint8_t *buf,
 				int len)
 {
-	int i;
 	struct nand_chip *chip = mtd->priv;
-	unsigned long *ptr = (unsigned long *)buf;
-
-	len >>= 2;
 
-	for (i = 0; i < len; i++)
-		writel(ptr[i], chip->IO_ADDR_W);
+	/* order the buffer contents before the first device write */
+	wmb();
+	iowrite32_rep(chip->IO_ADDR_W, buf, len >> 2);
 }
 
 /**
@@ -965,6 +966,8 @@ static void pl353_nand_ecc_init(struct mtd_info *mtd, int ondie_ecc_state)
 		 */
 		nand_chip->bbt_td = &bbt_main_descr;
 		nand_chip->bbt_md = &bbt_mirror_descr;
+		/* Micron devices do not cache read with on-die ECC on */
+		nand_chip->options &= ~NAND_CACHE_READ;
 	} else {
 		/* Hardware ECC generates 3 bytes ECC code for each 512 bytes */
 		nand_chip->ecc.bytes = 3;
@@ -1055,7 +1058,7 @@ static int pl353_nand_probe(struct platform_device *pdev)
 	nand_chip->write_buf = pl353_nand_write_buf;
 
 	/* Set the device option and flash width */
-	nand_chip->options = NAND_BUSWIDTH_AUTO;
+	nand_chip->options = NAND_BUSWIDTH_AUTO | NAND_CACHE_READ;
 	nand_chip->bbt_options = NAND_BBT_USE_FLASH;
 
 	platform_set_drvdata(pdev, xnand);
@@ -108,6 +108,45 @@ static inline int spi_nor_read_dummy_cycles(struct spi_nor *nor)
 	return 0;
 }
 
+/*
+ * Switch the read, program and erase opcodes to their dedicated 4-byte
+ * address variants, which unlike the 4-byte mode need no state in the flash.
+ */
+static void spi_nor_set_4byte_opcodes(struct spi_nor *nor)
+{
+	switch (nor->read_opcode) {
+	case SPINOR_OP_READ_1_4_4:
+		nor->read_opcode = SPINOR_OP_READ4_1_4_4;
+		break;
+	case SPINOR_OP_READ_1_1_4:
+		nor->read_opcode = SPINOR_OP_READ4_1_1_4;
+		break;
+	case SPINOR_OP_READ_1_1_2:
+		nor->read_opcode = SPINOR_OP_READ4_1_1_2;
+		break;
+	case SPINOR_OP_READ_FAST:
+		nor->read_opcode = SPINOR_OP_READ4_FAST;
+		break;
+	case SPINOR_OP_READ:
+		nor->read_opcode = SPINOR_OP_READ4;
+		break;
+	}
+
+	nor->program_opcode = SPINOR_OP_PP_4B;
+
+	switch (nor->erase_opcode) {
+	case SPINOR_OP_BE_4K:
+		nor->erase_opcode = SPINOR_OP_BE_4K_4B;
+		break;
+	case SPINOR_OP_BE_32K:
+		nor->erase_opcode = SPINOR_OP_BE_32K_4B;
+		break;
+	default:
+		nor->erase_opcode = SPINOR_OP_SE_4B;
+		break;
+	}
+}
+
 /*
  * Write status register 1 byte
  * Returns negative if error occurred.
@@ -399,14 +438,25 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 			goto erase_err;
 		}
 
-	/* REVISIT in some cases we could speed up erasing large regions
-	 * by using SPINOR_OP_SE instead of SPINOR_OP_BE_4K.  We may have set up
-	 * to use "small sector erase", but that's not always optimal.
-	 */
-
 	/* "sector"-at-a-time erase */
 	} else {
 		while (len) {
+			u8 erase_opcode = nor->erase_opcode;
+			u32 erasesize = mtd->erasesize;
+
+			/*
+			 * We may have set up to use "small sector erase", but
+			 * whole sectors the request covers are erased with a
+			 * single command, which is much faster than erasing
+			 * their small blocks one by one.
+			 */
+			if (nor->sector_erase_opcode &&
+			    !(addr % nor->sector_size) &&
+			    len >= nor->sector_size) {
+				erase_opcode = nor->sector_erase_opcode;
+				erasesize = nor->sector_size;
+			}
+
 			offset = addr;
 			if (nor->isparallel == 1)
 				offset /= 2;
@@ -430,13 +480,16 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 				if (ret)
 					goto erase_err;
 			}
-			if (nor->erase(nor, offset)) {
+			swap(nor->erase_opcode, erase_opcode);
+			ret = nor->erase(nor, offset);
+			swap(nor->erase_opcode, erase_opcode);
+			if (ret) {
 				ret = -EIO;
 				goto erase_err;
 			}
 
-			addr += mtd->erasesize;
-			len -= mtd->erasesize;
+			addr += erasesize;
+			len -= erasesize;
 		}
 	}
 
@@ -680,6 +733,7 @@ struct flash_info {
 #define	USE_FSR			0x80	/* use flag status register */
 #define	SPI_NOR_FLASH_LOCK	0x100	/* Flash protection support */
 #define	SPI_NOR_QUAD_IO_READ    0x200   /* Flash supports Quad IO read */
+#define	SPI_NOR_4B_OPCODES	0x400	/* Use dedicated 4-byte opcodes */
 };
 
 #define INFO(_jedec_id, _ext_id, _sector_size, _n_sectors, _flags)	\
@@ -758,7 +812,7 @@ static const struct spi_device_id spi_nor_ids[] = {
 	{ "mx25l12855e", INFO(0xc22618, 0, 64 * 1024, 256, 0) },
 	{ "mx25l25635e", INFO(0xc22019, 0, 64 * 1024, 512, 0) },
 	{ "mx25l25655e", INFO(0xc22619, 0, 64 * 1024, 512, 0) },
-	{ "mx66l51235l", INFO(0xc2201a, 0, 64 * 1024, 1024, SPI_NOR_QUAD_READ) },
+	{ "mx66l51235l", INFO(0xc2201a, 0, 64 * 1024, 1024, SPI_NOR_QUAD_READ | SPI_NOR_4B_OPCODES) },
 	{ "mx66l1g55g",  INFO(0xc2261b, 0, 64 * 1024, 2048, SPI_NOR_QUAD_READ) },
 
 	/* Micron */
@@ -1504,29 +1558,18 @@ int spi_nor_scan(struct spi_nor *nor, const char *name, enum read_mode mode)
 #endif
 		/* enable 4-byte addressing if the device exceeds 16MiB */
 		nor->addr_width = 4;
-		if (JEDEC_MFR(info->jedec_id) == CFI_MFR_AMD) {
-			/* Dedicated 4-byte command set */
-			switch (nor->flash_read) {
-			case SPI_NOR_QUAD_IO:
-				nor->read_opcode = SPINOR_OP_READ4_1_4_4;
-				break;
-			case SPI_NOR_QUAD:
-				nor->read_opcode = SPINOR_OP_READ4_1_1_4;
-				break;
-			case SPI_NOR_DUAL:
-				nor->read_opcode = SPINOR_OP_READ4_1_1_2;
-				break;
-			case SPI_NOR_FAST:
-				nor->read_opcode = SPINOR_OP_READ4_FAST;
-				break;
-			case SPI_NOR_NORMAL:
-				nor->read_opcode = SPINOR_OP_READ4;
-				break;
-			}
-			nor->program_opcode = SPINOR_OP_PP_4B;
-			/* No small sector erase for 4-byte command set */
-			nor->erase_opcode = SPINOR_OP_SE_4B;
-			mtd->erasesize = info->sector_size;
+		if (JEDEC_MFR(info->jedec_id) == CFI_MFR_AMD ||
+		    info->flags & SPI_NOR_4B_OPCODES) {
+			/*
+			 * Dedicated 4-byte command set, the flash stays in
+			 * 3-byte mode for a boot ROM after a warm reset.
+			 */
+			spi_nor_set_4byte_opcodes(nor);
+			/* No small sector erase for the Spansion ones */
+			if (JEDEC_MFR(info->jedec_id) == CFI_MFR_AMD)
+				nor->erase_opcode = SPINOR_OP_SE_4B;
+			if (nor->erase_opcode == SPINOR_OP_SE_4B)
+				mtd->erasesize = info->sector_size;
 		} else
 			set_4byte(nor, info->jedec_id, 1);
 #ifdef CONFIG_OF
@@ -1538,6 +1581,14 @@ int spi_nor_scan(struct spi_nor *nor, const char *name, enum read_mode mode)
 
 	nor->read_dummy = spi_nor_read_dummy_cycles(nor);
 
+	/* Let large erases use whole sectors when small sectors are set up */
+	if (mtd->erasesize == nor->sector_size)
+		nor->sector_erase_opcode = 0;
+	else if (nor->erase_opcode == SPINOR_OP_BE_4K_4B)
+		nor->sector_erase_opcode = SPINOR_OP_SE_4B;
+	else
+		nor->sector_erase_opcode = SPINOR_OP_SE;
+
 	dev_info(dev, "%s (%lld Kbytes)\n", id->name,
 			(long long)mtd->size >> 10);
 
@@ -87,6 +87,8 @@
 #include <linux/crc32.h>
 #include <linux/math64.h>
 #include <linux/random.h>
+#include <linux/cpumask.h>
+#include <linux/workqueue.h>
 #include "ubi.h"
 
 static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
@@ -95,6 +97,52 @@ static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
 static struct ubi_ec_hdr *ech;
 static struct ubi_vid_hdr *vidh;
 
+/* Number of PEBs whose headers are read ahead at once when scanning */
+#define SCAN_WINDOW 16
+/* Maximum number of work items reading PEB headers in parallel */
+#define SCAN_MAX_READERS 4
+
+/**
+ * struct scan_peb_hdrs - UBI headers of a PEB read for 'scan_peb()'.
+ * @ech: EC header buffer
+ * @vidh: VID header buffer
+ * @pnum: the physical eraseblock the headers were read from
+ * @bad: what 'ubi_io_is_bad()' returned
+ * @ec_err: what 'ubi_io_read_ec_hdr()' returned
+ * @vid_err: what 'ubi_io_read_vid_hdr()' returned
+ *
+ * The VID header is not read if the PEB is bad, if reading the EC header
+ * failed or if the PEB is empty, @vid_err is zero in that case.
+ */
+struct scan_peb_hdrs {
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_hdr *vidh;
+	int pnum;
+	int bad;
+	int ec_err;
+	int vid_err;
+};
+
+/**
+ * struct scan_reader - work item reading PEB headers ahead of 'scan_peb()'.
+ * @work: the work item
+ * @ubi: UBI device description object
+ * @hdrs: headers of the window of PEBs being read
+ * @pnum: the first physical eraseblock of the window
+ * @first: index of the first PEB of the window this reader reads
+ * @count: number of PEBs in the window
+ * @stride: number of readers sharing the window
+ */
+struct scan_reader {
+	struct work_struct work;
+	struct ubi_device *ubi;
+	struct scan_peb_hdrs *hdrs;
+	int pnum;
+	int first;
+	int count;
+	int stride;
+};
+
 /**
  * add_to_list - add physical eraseblock to a list.
  * @ai: attaching information
@@ -800,29 +848,61 @@ out_unlock:
 	return err;
 }
 
+/**
+ * read_peb_hdrs - read UBI headers of a PEB.
+ * @ubi: UBI device description object
+ * @h: where to store the headers and the read results
+ * @pnum: the physical eraseblock number
+ *
+ * This function only reads the headers of PEB @pnum, they are checked by
+ * 'scan_peb()'. It does not touch the attaching information, so headers of
+ * several PEBs may be read concurrently.
+ */
+static void read_peb_hdrs(struct ubi_device *ubi, struct scan_peb_hdrs *h,
+			  int pnum)
+{
+	h->pnum = pnum;
+	h->ec_err = 0;
+	h->vid_err = 0;
+
+	h->bad = ubi_io_is_bad(ubi, pnum);
+	if (h->bad)
+		return;
+
+	h->ec_err = ubi_io_read_ec_hdr(ubi, pnum, h->ech, 0);
+	if (h->ec_err < 0 || h->ec_err == UBI_IO_FF ||
+	    h->ec_err == UBI_IO_FF_BITFLIPS)
+		return;
+
+	h->vid_err = ubi_io_read_vid_hdr(ubi, pnum, h->vidh, 0);
+}
+
 /**
  * scan_peb - scan and process UBI headers of a PEB.
  * @ubi: UBI device description object
  * @ai: attaching information
- * @pnum: the physical eraseblock number
+ * @h: headers of the PEB read by 'read_peb_hdrs()'
  * @vid: The volume ID of the found volume will be stored in this pointer
  * @sqnum: The sqnum of the found volume will be stored in this pointer
  *
- * This function reads UBI headers of PEB @pnum, checks them, and adds
- * information about this PEB to the corresponding list or RB-tree in the
- * "attaching info" structure. Returns zero if the physical eraseblock was
- * successfully handled and a negative error code in case of failure.
+ * This function checks UBI headers of PEB @h->pnum, and adds information
+ * about this PEB to the corresponding list or RB-tree in the "attaching info"
+ * structure. Returns zero if the physical eraseblock was successfully handled
+ * and a negative error code in case of failure.
  */
 static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
-		    int pnum, int *vid, unsigned long long *sqnum)
+		    struct scan_peb_hdrs *h, int *vid,
+		    unsigned long long *sqnum)
 {
+	struct ubi_ec_hdr *ech = h->ech;
+	struct ubi_vid_hdr *vidh = h->vidh;
 	long long uninitialized_var(ec);
-	int err, bitflips = 0, vol_id = -1, ec_err = 0;
+	int err, bitflips = 0, vol_id = -1, ec_err = 0, pnum = h->pnum;
 
 	dbg_bld("scan PEB %d", pnum);
 
 	/* Skip bad physical eraseblocks */
-	err = ubi_io_is_bad(ubi, pnum);
+	err = h->bad;
 	if (err < 0)
 		return err;
 	else if (err) {
@@ -830,7 +910,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	err = h->ec_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -912,7 +992,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidh, 0);
+	err = h->vid_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1211,6 +1291,131 @@ static void destroy_ai(struct ubi_attach_info *ai)
 	kfree(ai);
 }
 
+static void scan_reader_work(struct work_struct *work)
+{
+	struct scan_reader *r = container_of(work, struct scan_reader, work);
+	int i;
+
+	for (i = r->first; i < r->count; i += r->stride)
+		read_peb_hdrs(r->ubi, &r->hdrs[i], r->pnum + i);
+}
+
+static void queue_readers(struct ubi_device *ubi, struct scan_reader *readers,
+			  int nr_readers, int pnum)
+{
+	int i;
+
+	for (i = 0; i < nr_readers; i++) {
+		readers[i].pnum = pnum;
+		readers[i].count = min_t(int, ubi->peb_count - pnum,
+					 SCAN_WINDOW);
+		queue_work(system_unbound_wq, &readers[i].work);
+	}
+}
+
+/**
+ * scan_pebs - scan PEBs with read-ahead of their headers.
+ * @ubi: UBI device description object
+ * @ai: attach info object
+ * @start: start scanning at this PEB
+ *
+ * On a full scan most of the time is spent reading the headers, so they are
+ * read for windows of %SCAN_WINDOW PEBs by several work items in parallel
+ * while the previous window is processed. This overlaps the NAND accesses
+ * with the ECC and CRC checks and allows controllers with several chips to
+ * serve the reads concurrently. The PEBs are still processed in order by
+ * 'scan_peb()', so the result is the same as for a serial scan. With a single
+ * online CPU the headers are simply read serially before being processed.
+ *
+ * Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+static int scan_pebs(struct ubi_device *ubi, struct ubi_attach_info *ai,
+		     int start)
+{
+	int err = -ENOMEM, i, j, pnum, half = 0, nr_readers, count = 0;
+	struct scan_peb_hdrs *hdrs;
+	struct scan_reader *readers = NULL;
+
+	nr_readers = min_t(int, num_online_cpus(), SCAN_MAX_READERS);
+	if (nr_readers < 2)
+		nr_readers = 0;
+
+	hdrs = kcalloc(2 * SCAN_WINDOW, sizeof(*hdrs), GFP_KERNEL);
+	if (!hdrs)
+		return err;
+
+	for (i = 0; i < 2 * SCAN_WINDOW; i++) {
+		hdrs[i].ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+		hdrs[i].vidh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+		if (!hdrs[i].ech || !hdrs[i].vidh)
+			goto out_free;
+	}
+
+	if (nr_readers) {
+		readers = kcalloc(2 * nr_readers, sizeof(*readers),
+				  GFP_KERNEL);
+		if (!readers)
+			goto out_free;
+
+		for (i = 0; i < 2 * nr_readers; i++) {
+			INIT_WORK(&readers[i].work, scan_reader_work);
+			readers[i].ubi = ubi;
+			readers[i].hdrs = &hdrs[(i / nr_readers) * SCAN_WINDOW];
+			readers[i].first = i % nr_readers;
+			readers[i].stride = nr_readers;
+		}
+
+		queue_readers(ubi, readers, nr_readers, start);
+	}
+
+	for (pnum = start; pnum < ubi->peb_count; pnum += count) {
+		struct scan_peb_hdrs *window = &hdrs[half * SCAN_WINDOW];
+
+		count = min_t(int, ubi->peb_count - pnum, SCAN_WINDOW);
+
+		if (nr_readers) {
+			struct scan_reader *cur = &readers[half * nr_readers];
+
+			/* Wait for this window, then start reading the next */
+			for (i = 0; i < nr_readers; i++)
+				flush_work(&cur[i].work);
+
+			if (pnum + count < ubi->peb_count)
+				queue_readers(ubi, &readers[!half * nr_readers],
+					      nr_readers, pnum + count);
+		} else {
+			for (j = 0; j < count; j++)
+				read_peb_hdrs(ubi, &window[j], pnum + j);
+		}
+
+		for (j = 0; j < count; j++) {
+			cond_resched();
+
+			dbg_gen("process PEB %d", pnum + j);
+			err = scan_peb(ubi, ai, &window[j], NULL, NULL);
+			if (err < 0)
+				goto out_flush;
+		}
+
+		half = !half;
+	}
+
+	err = 0;
+
+out_flush:
+	for (i = 0; i < 2 * nr_readers; i++)
+		flush_work(&readers[i].work);
+	kfree(readers);
+out_free:
+	for (i = 0; i < 2 * SCAN_WINDOW; i++) {
+		ubi_free_vid_hdr(ubi, hdrs[i].vidh);
+		kfree(hdrs[i].ech);
+	}
+	kfree(hdrs);
+	return err;
+}
+
 /**
  * scan_all - scan entire MTD device.
  * @ubi: UBI device description object
@@ -1224,7 +1429,7 @@ static void destroy_ai(struct ubi_attach_info *ai)
 static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		    int start)
 {
-	int err, pnum;
+	int err;
 	struct rb_node *rb1, *rb2;
 	struct ubi_ainf_volume *av;
 	struct ubi_ainf_peb *aeb;
@@ -1239,14 +1444,9 @@ static int scan_all(struct ubi_device *ubi, struct ubi_attach_info *ai,
 	if (!vidh)
 		goto out_ech;
 
-	for (pnum = start; pnum < ubi->peb_count; pnum++) {
-		cond_resched();
-
-		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, ai, pnum, NULL, NULL);
-		if (err < 0)
-			goto out_vidh;
-	}
+	err = scan_pebs(ubi, ai, start);
+	if (err < 0)
+		goto out_vidh;
 
 	ubi_msg("scanning is finished");
 
@@ -1313,6 +1513,7 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info *ai)
 {
 	int err, pnum, fm_anchor = -1;
 	unsigned long long max_sqnum = 0;
+	struct scan_peb_hdrs hdrs;
 
 	err = -ENOMEM;
 
@@ -1324,13 +1525,17 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info *ai)
 	if (!vidh)
 		goto out_ech;
 
+	hdrs.ech = ech;
+	hdrs.vidh = vidh;
+
 	for (pnum = 0; pnum < UBI_FM_MAX_START; pnum++) {
 		int vol_id = -1;
 		unsigned long long sqnum = -1;
 		cond_resched();
 
 		dbg_gen("process PEB %d", pnum);
-		err = scan_peb(ubi, ai, pnum, &vol_id, &sqnum);
+		read_peb_hdrs(ubi, &hdrs, pnum);
+		err = scan_peb(ubi, ai, &hdrs, &vol_id, &sqnum);
 		if (err < 0)
 			goto out_vidh;
 
@@ -22,11 +22,13 @@
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/netdevice.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/skbuff.h>
+#include <linux/spinlock.h>
 #include <linux/string.h>
 #include <linux/types.h>
 #include <linux/can/dev.h>
@@ -96,6 +98,7 @@ enum xcan_reg {
 #define XCAN_IDR_ID2_MASK		0x0007FFFE /* Extended message ident */
 #define XCAN_IDR_RTR_MASK		0x00000001 /* Remote TX request */
 #define XCAN_DLCR_DLC_MASK		0xF0000000 /* Data length code */
+#define XCAN_DLCR_RXT_MASK		0x0000FFFF /* Rx timestamp (Zynq) */
 
 #define XCAN_INTR_ALL		(XCAN_IXR_TXOK_MASK | XCAN_IXR_BSOFF_MASK |\
 				 XCAN_IXR_WKUP_MASK | XCAN_IXR_SLP_MASK | \
@@ -120,7 +123,13 @@ enum xcan_reg {
  * @tx_head:			Tx CAN packets ready to send on the queue
  * @tx_tail:			Tx CAN packets successfully sended on the queue
  * @tx_max:			Maximum number packets the driver can send
+ * @tx_lock:			Protects tx_head, tx_tail and the TX FIFO writes
  * @napi:			NAPI structure
+ * @rx_tstamp:			RX frames carry a hardware timestamp
+ * @rx_tick_ns:			Duration of a hardware timestamp tick
+ * @rx_time:			Reception time of the last received frame
+ * @rx_time_sync:		rx_time holds the RX interrupt time
+ * @rx_last_rxt:		Hardware timestamp of the last received frame
  * @read_reg:			For reading data from CAN registers
  * @write_reg:			For writing data to CAN registers
  * @dev:			Network device data structure
@@ -134,7 +143,13 @@ struct xcan_priv {
 	unsigned int tx_head;
 	unsigned int tx_tail;
 	unsigned int tx_max;
+	spinlock_t tx_lock;
 	struct napi_struct napi;
+	bool rx_tstamp;
+	u32 rx_tick_ns;
+	ktime_t rx_time;
+	bool rx_time_sync;
+	u16 rx_last_rxt;
 	u32 (*read_reg)(const struct xcan_priv *priv, enum xcan_reg reg);
 	void (*write_reg)(const struct xcan_priv *priv, enum xcan_reg reg,
 			u32 val);
@@ -313,6 +328,14 @@ static int xcan_chip_start(struct net_device *ndev)
 	if (err < 0)
 		return err;
 
+	/* The echo skbs have been flushed, the TX FIFO is empty after reset */
+	priv->tx_head = 0;
+	priv->tx_tail = 0;
+
+	/* The RX timestamp counter is incremented every bit time */
+	priv->rx_tick_ns = DIV_ROUND_CLOSEST(NSEC_PER_SEC,
+					     priv->can.bittiming.bitrate);
+
 	/* Enable interrupts */
 	priv->write_reg(priv, XCAN_IER_OFFSET, XCAN_INTR_ALL);
 
@@ -391,6 +414,7 @@ static int xcan_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	struct net_device_stats *stats = &ndev->stats;
 	struct can_frame *cf = (struct can_frame *)skb->data;
 	u32 id, dlc, data[2] = {0, 0};
+	unsigned long flags;
 
 	if (can_dropped_invalid_skb(ndev, skb))
 		return NETDEV_TX_OK;
@@ -437,6 +461,8 @@ static int xcan_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	if (cf->can_dlc > 4)
 		data[1] = be32_to_cpup((__be32 *)(cf->data + 4));
 
+	spin_lock_irqsave(&priv->tx_lock, flags);
+
 	can_put_echo_skb(skb, ndev, priv->tx_head % priv->tx_max);
 	priv->tx_head++;
 
@@ -453,13 +479,49 @@ static int xcan_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 		stats->tx_bytes += cf->can_dlc;
 	}
 
+	/* The TX interrupt relies on TXFEMP to tell whether all the frames in
+	 * the FIFO have been sent, clear it now that the FIFO holds this one.
+	 */
+	if (priv->tx_max > 1)
+		priv->write_reg(priv, XCAN_ICR_OFFSET, XCAN_IXR_TXFEMP_MASK);
+
 	/* Check if the TX buffer is full */
 	if ((priv->tx_head - priv->tx_tail) == priv->tx_max)
 		netif_stop_queue(ndev);
 
+	spin_unlock_irqrestore(&priv->tx_lock, flags);
+
 	return NETDEV_TX_OK;
 }
 
+/**
+ * xcan_rx_time - Compute the reception time of a frame
+ * @priv:	Driver private data structure
+ * @dlc:	RX FIFO DLC register value of the frame
+ *
+ * The first frame after the RX interrupt gets the interrupt time, the
+ * following ones add the bit times elapsed on the hardware timestamp counter.
+ * A whole FIFO drained in one poll thus keeps the spacing the frames had on
+ * the bus instead of getting the time at which they were read.
+ *
+ * Return: reception time of the frame
+ */
+static ktime_t xcan_rx_time(struct xcan_priv *priv, u32 dlc)
+{
+	u16 rxt = dlc & XCAN_DLCR_RXT_MASK;
+	u16 ticks = rxt - priv->rx_last_rxt;
+
+	if (priv->rx_time_sync)
+		priv->rx_time_sync = false;
+	else
+		priv->rx_time = ktime_add_ns(priv->rx_time,
+					     (u64)ticks * priv->rx_tick_ns);
+
+	priv->rx_last_rxt = rxt;
+
+	return priv->rx_time;
+}
+
 /**
  * xcan_rx -  Is called from CAN isr to complete the received
  *		frame  processing
@@ -467,8 +529,8 @@ static int xcan_start_xmit(struct sk_buff *skb, struct net_device *ndev)
  *
  * This function is invoked from the CAN isr(poll) to process the Rx frames. It
  * does minimal processing and invokes "netif_receive_skb" to complete further
- * processing.
- * Return: 1 on success and 0 on failure.
+ * processing. The frame is read out of the FIFO even if it has to be dropped.
+ * Return: 1 always, the number of frames taken from the FIFO.
  */
 static int xcan_rx(struct net_device *ndev)
 {
@@ -477,20 +539,39 @@ static int xcan_rx(struct net_device *ndev)
 	struct can_frame *cf;
 	struct sk_buff *skb;
 	u32 id_xcan, dlc, data[2] = {0, 0};
+	bool rtr;
+	ktime_t time;
+
+	/* Read a frame from Xilinx zynq CANPS */
+	id_xcan = priv->read_reg(priv, XCAN_RXFIFO_ID_OFFSET);
+	dlc = priv->read_reg(priv, XCAN_RXFIFO_DLC_OFFSET);
+
+	if (id_xcan & XCAN_IDR_IDE_MASK)
+		rtr = id_xcan & XCAN_IDR_RTR_MASK;
+	else
+		rtr = id_xcan & XCAN_IDR_SRR_MASK;
+
+	if (!rtr) {
+		data[0] = priv->read_reg(priv, XCAN_RXFIFO_DW1_OFFSET);
+		data[1] = priv->read_reg(priv, XCAN_RXFIFO_DW2_OFFSET);
+	}
+
+	if (priv->rx_tstamp)
+		time = xcan_rx_time(priv, dlc);
 
 	skb = alloc_can_skb(ndev, &cf);
 	if (unlikely(!skb)) {
 		stats->rx_dropped++;
-		return 0;
+		return 1;
 	}
 
-	/* Read a frame from Xilinx zynq CANPS */
-	id_xcan = priv->read_reg(priv, XCAN_RXFIFO_ID_OFFSET);
-	dlc = priv->read_reg(priv, XCAN_RXFIFO_DLC_OFFSET) >>
-				XCAN_DLCR_DLC_SHIFT;
+	if (priv->rx_tstamp) {
+		skb->tstamp = time;
+		skb_hwtstamps(skb)->hwtstamp = time;
+	}
 
 	/* Change Xilinx CAN data length format to socketCAN data format */
-	cf->can_dlc = get_can_dlc(dlc);
+	cf->can_dlc = get_can_dlc(dlc >> XCAN_DLCR_DLC_SHIFT);
 
 	/* Change Xilinx CAN ID format to socketCAN ID format */
 	if (id_xcan & XCAN_IDR_IDE_MASK) {
@@ -499,20 +580,15 @@ static int xcan_rx(struct net_device *ndev)
 		cf->can_id |= (id_xcan & XCAN_IDR_ID2_MASK) >>
 				XCAN_IDR_ID2_SHIFT;
 		cf->can_id |= CAN_EFF_FLAG;
-		if (id_xcan & XCAN_IDR_RTR_MASK)
-			cf->can_id |= CAN_RTR_FLAG;
 	} else {
 		/* The received frame is a standard format frame */
 		cf->can_id = (id_xcan & XCAN_IDR_ID1_MASK) >>
 				XCAN_IDR_ID1_SHIFT;
-		if (id_xcan & XCAN_IDR_SRR_MASK)
-			cf->can_id |= CAN_RTR_FLAG;
 	}
 
-	if (!(id_xcan & XCAN_IDR_SRR_MASK)) {
-		data[0] = priv->read_reg(priv, XCAN_RXFIFO_DW1_OFFSET);
-		data[1] = priv->read_reg(priv, XCAN_RXFIFO_DW2_OFFSET);
-
+	if (rtr) {
+		cf->can_id |= CAN_RTR_FLAG;
+	} else {
 		/* Change Xilinx CAN data format to socketCAN data format */
 		if (cf->can_dlc > 0)
 			*(__be32 *)(cf->data) = cpu_to_be32(data[0]);
@@ -731,23 +807,59 @@ static int xcan_rx_poll(struct napi_struct *napi, int quota)
  * xcan_tx_interrupt - Tx Done Isr
  * @ndev:	net_device pointer
  * @isr:	Interrupt status register value
+ *
+ * TXOK only tells that at least one frame has been sent since it was last
+ * cleared, several completions can be merged in one interrupt. One frame is
+ * completed per TXOK, and all the frames in the FIFO once TXFEMP reports it
+ * empty, so the echo skbs may lag behind the bus but never get ahead of it.
  */
 static void xcan_tx_interrupt(struct net_device *ndev, u32 isr)
 {
 	struct xcan_priv *priv = netdev_priv(ndev);
 	struct net_device_stats *stats = &ndev->stats;
+	unsigned int frames_in_fifo, frames_sent = 1;
+	unsigned long flags;
+	int retries = 0;
+
+	/* Synchronize with xmit, which clears TXFEMP for every new frame */
+	spin_lock_irqsave(&priv->tx_lock, flags);
+
+	frames_in_fifo = priv->tx_head - priv->tx_tail;
+	if (WARN_ON_ONCE(frames_in_fifo == 0)) {
+		priv->write_reg(priv, XCAN_ICR_OFFSET, XCAN_IXR_TXOK_MASK);
+		spin_unlock_irqrestore(&priv->tx_lock, flags);
+		return;
+	}
+
+	if (frames_in_fifo > 1) {
+		/* Clear TXOK before sampling TXFEMP, so that a frame completed
+		 * meanwhile is either seen in TXFEMP or leaves TXOK set for
+		 * the next interrupt.
+		 */
+		while ((isr & XCAN_IXR_TXOK_MASK) &&
+		       !WARN_ON(++retries == 100)) {
+			priv->write_reg(priv, XCAN_ICR_OFFSET,
+					XCAN_IXR_TXOK_MASK);
+			isr = priv->read_reg(priv, XCAN_ISR_OFFSET);
+		}
 
-	while ((priv->tx_head - priv->tx_tail > 0) &&
-			(isr & XCAN_IXR_TXOK_MASK)) {
+		if (isr & XCAN_IXR_TXFEMP_MASK)
+			frames_sent = frames_in_fifo;
+	} else {
 		priv->write_reg(priv, XCAN_ICR_OFFSET, XCAN_IXR_TXOK_MASK);
-		can_get_echo_skb(ndev, priv->tx_tail %
-					priv->tx_max);
+	}
+
+	while (frames_sent--) {
+		can_get_echo_skb(ndev, priv->tx_tail % priv->tx_max);
 		priv->tx_tail++;
 		stats->tx_packets++;
-		isr = priv->read_reg(priv, XCAN_ISR_OFFSET);
 	}
-	can_led_event(ndev, CAN_LED_EVENT_TX);
+
 	netif_wake_queue(ndev);
+
+	spin_unlock_irqrestore(&priv->tx_lock, flags);
+
+	can_led_event(ndev, CAN_LED_EVENT_TX);
 }
 
 /**
@@ -797,6 +909,11 @@ static irqreturn_t xcan_interrupt(int irq, void *dev_id)
 		ier = priv->read_reg(priv, XCAN_IER_OFFSET);
 		ier &= ~XCAN_IXR_RXNEMP_MASK;
 		priv->write_reg(priv, XCAN_IER_OFFSET, ier);
+
+		if (priv->rx_tstamp) {
+			priv->rx_time = ktime_get_real();
+			priv->rx_time_sync = true;
+		}
 		napi_schedule(&priv->napi);
 	}
 	return IRQ_HANDLED;
@@ -1071,6 +1188,7 @@ static int xcan_probe(struct platform_device *pdev)
 					CAN_CTRLMODE_BERR_REPORTING;
 	priv->reg_base = addr;
 	priv->tx_max = tx_max;
+	spin_lock_init(&priv->tx_lock);
 
 	/* Get IRQ for the device */
 	ndev->irq = platform_get_irq(pdev, 0);
@@ -1090,6 +1208,7 @@ static int xcan_probe(struct platform_device *pdev)
 	/* Check for type of CAN device */
 	if (of_device_is_compatible(pdev->dev.of_node,
 				    "xlnx,zynq-can-1.0")) {
+		priv->rx_tstamp = true;
 		priv->bus_clk = devm_clk_get(&pdev->dev, "pclk");
 		if (IS_ERR(priv->bus_clk)) {
 			dev_err(&pdev->dev, "bus clock not found\n");
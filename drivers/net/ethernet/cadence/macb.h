@@ -90,10 +90,13 @@
 #define GEM_DCFG5				0x0290
 #define GEM_DCFG6				0x0294
 #define GEM_DCFG7				0x0298
+#define GEM_DCFG8				0x029C
 
 #define GEM_ISR(hw_q)				(0x0400 + ((hw_q) << 2))
 #define GEM_TBQP(hw_q)				(0x0440 + ((hw_q) << 2))
 #define GEM_RBQP(hw_q)				(0x0480 + ((hw_q) << 2))
+#define GEM_RBQS(hw_q)				(0x04A0 + ((hw_q) << 2))
+#define GEM_SCRT2(num)				(0x0540 + ((num) << 2))
 #define GEM_IER(hw_q)				(0x0600 + ((hw_q) << 2))
 #define GEM_IDR(hw_q)				(0x0620 + ((hw_q) << 2))
 #define GEM_IMR(hw_q)				(0x0640 + ((hw_q) << 2))
@@ -322,6 +325,20 @@
 #define GEM_TX_PKT_BUFF_OFFSET			21
 #define GEM_TX_PKT_BUFF_SIZE			1
 
+/* Bitfields in DCFG8. */
+#define GEM_T2SCR_OFFSET			16
+#define GEM_T2SCR_SIZE				8
+#define GEM_T1SCR_OFFSET			24
+#define GEM_T1SCR_SIZE				8
+
+/* Bitfields in SCRT2 (screening type 2). */
+#define GEM_QUEUE_OFFSET			0
+#define GEM_QUEUE_SIZE				4
+#define GEM_VLANPR_OFFSET			4
+#define GEM_VLANPR_SIZE				3
+#define GEM_VLANEN_OFFSET			8
+#define GEM_VLANEN_SIZE				1
+
 /* Constants for CLK */
 #define MACB_CLK_DIV8				0
 #define MACB_CLK_DIV16				1
@@ -600,12 +617,13 @@ struct gem_stats {
 };
 
 struct macb;
+struct macb_queue;
 
 struct macb_or_gem_ops {
 	int	(*mog_alloc_rx_buffers)(struct macb *bp);
 	void	(*mog_free_rx_buffers)(struct macb *bp);
 	void	(*mog_init_rings)(struct macb *bp);
-	int	(*mog_rx)(struct macb *bp, int budget);
+	int	(*mog_rx)(struct macb_queue *queue, int budget);
 };
 
 struct macb_config {
@@ -616,27 +634,38 @@ struct macb_config {
 struct macb_queue {
 	struct macb		*bp;
 	int			irq;
+	unsigned int		hw_q;
 
 	unsigned int		ISR;
 	unsigned int		IER;
 	unsigned int		IDR;
 	unsigned int		IMR;
 	unsigned int		TBQP;
+	unsigned int		RBQP;
+	unsigned int		RBQS;
 
 	unsigned int		tx_head, tx_tail;
 	struct macb_dma_desc	*tx_ring;
 	struct macb_tx_skb	*tx_skb;
 	dma_addr_t		tx_ring_dma;
 	struct work_struct	tx_error_task;
-};
-
-struct macb {
-	void __iomem		*regs;
 
 	unsigned int		rx_tail;
 	unsigned int		rx_prepared_head;
 	struct macb_dma_desc	*rx_ring;
 	struct sk_buff		**rx_skbuff;
+	dma_addr_t		rx_ring_dma;
+	struct napi_struct	napi;
+
+	/* the queues are polled in parallel, summed up by macb_get_stats() */
+	unsigned long		rx_packets;
+	unsigned long		rx_bytes;
+	unsigned long		rx_dropped;
+};
+
+struct macb {
+	void __iomem		*regs;
+
 	void			*rx_buffers;
 	size_t			rx_buffer_size;
 
@@ -649,14 +678,12 @@ struct macb {
 	struct clk		*hclk;
 	struct clk		*tx_clk;
 	struct net_device	*dev;
-	struct napi_struct	napi;
 	struct net_device_stats	stats;
 	union {
 		struct macb_stats	macb;
 		struct gem_stats	gem;
 	}			hw_stats;
 
-	dma_addr_t		rx_ring_dma;
 	dma_addr_t		rx_buffers_dma;
 
 	struct macb_or_gem_ops	macbgem_ops;
@@ -79,6 +79,9 @@ This option defaults to enabled (set) */
  30       1           IrqDlyEn
  31       0           IrqCoalEn
 */
+#define CHNL_CTRL_IRQ_TIMEOUT_SHIFT	24
+#define CHNL_CTRL_IRQ_COUNT_SHIFT	16
+#define CHNL_CTRL_IRQ_COUNT_MAX		0xff
 #define CHNL_CTRL_IRQ_IOE       (1 << 9)
 #define CHNL_CTRL_IRQ_EN        (1 << 7)
 #define CHNL_CTRL_IRQ_ERR_EN    (1 << 2)
@@ -353,9 +356,11 @@ struct temac_local {
 	int emac_num;
 
 	struct sk_buff **rx_skb;
-	spinlock_t rx_lock;
+	struct napi_struct napi;
 	struct mutex indirect_mutex;
 	u32 options;			/* Current options word */
+	u32 coalesce_count_rx;
+	u32 coalesce_count_tx;
 	int last_link;
 	unsigned int temac_features;
 
@@ -56,6 +56,14 @@
 #define TX_BD_NUM   64
 #define RX_BD_NUM   128
 
+#define TEMAC_NAPI_WEIGHT	64
+
+/* Interrupt delay timeouts, the counts are set with ethtool */
+#define TEMAC_TX_IRQ_TIMEOUT	0x10
+#define TEMAC_RX_IRQ_TIMEOUT	0xff
+#define TEMAC_TX_IRQ_COUNT	0x22
+#define TEMAC_RX_IRQ_COUNT	0x07
+
 /* ---------------------------------------------------------------------
  * Low level register access functions
  */
@@ -278,18 +286,20 @@ static int temac_dma_bd_init(struct net_device *ndev)
 		lp->rx_bd_v[i].app0 = STS_CTRL_APP0_IRQONEND;
 	}
 
-	lp->dma_out(lp, TX_CHNL_CTRL, 0x10220400 |
-					  CHNL_CTRL_IRQ_EN |
-					  CHNL_CTRL_IRQ_DLY_EN |
-					  CHNL_CTRL_IRQ_COAL_EN);
-	/* 0x10220483 */
-	/* 0x00100483 */
-	lp->dma_out(lp, RX_CHNL_CTRL, 0xff070000 |
-					  CHNL_CTRL_IRQ_EN |
-					  CHNL_CTRL_IRQ_DLY_EN |
-					  CHNL_CTRL_IRQ_COAL_EN |
-					  CHNL_CTRL_IRQ_IOE);
-	/* 0xff010283 */
+	lp->dma_out(lp, TX_CHNL_CTRL,
+		    TEMAC_TX_IRQ_TIMEOUT << CHNL_CTRL_IRQ_TIMEOUT_SHIFT |
+		    lp->coalesce_count_tx << CHNL_CTRL_IRQ_COUNT_SHIFT |
+		    0x400 |
+		    CHNL_CTRL_IRQ_EN |
+		    CHNL_CTRL_IRQ_DLY_EN |
+		    CHNL_CTRL_IRQ_COAL_EN);
+	lp->dma_out(lp, RX_CHNL_CTRL,
+		    TEMAC_RX_IRQ_TIMEOUT << CHNL_CTRL_IRQ_TIMEOUT_SHIFT |
+		    lp->coalesce_count_rx << CHNL_CTRL_IRQ_COUNT_SHIFT |
+		    CHNL_CTRL_IRQ_EN |
+		    CHNL_CTRL_IRQ_DLY_EN |
+		    CHNL_CTRL_IRQ_COAL_EN |
+		    CHNL_CTRL_IRQ_IOE);
 
 	lp->dma_out(lp, RX_CURDESC_PTR,  lp->rx_bd_p);
 	lp->dma_out(lp, RX_TAILDESC_PTR,
@@ -629,7 +639,7 @@ static void temac_start_xmit_done(struct net_device *ndev)
 		dma_unmap_single(ndev->dev.parent, cur_p->phys, cur_p->len,
 				 DMA_TO_DEVICE);
 		if (cur_p->app4)
-			dev_kfree_skb_irq((struct sk_buff *)cur_p->app4);
+			dev_kfree_skb_any((struct sk_buff *)cur_p->app4);
 		cur_p->app0 = 0;
 		cur_p->app1 = 0;
 		cur_p->app2 = 0;
@@ -737,26 +747,34 @@ static int temac_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 }
 
 
-static void ll_temac_recv(struct net_device *ndev)
+static int ll_temac_recv(struct net_device *ndev, int budget)
 {
 	struct temac_local *lp = netdev_priv(ndev);
 	struct sk_buff *skb, *new_skb;
 	unsigned int bdstat;
 	struct cdmac_bd *cur_p;
-	dma_addr_t tail_p;
+	dma_addr_t tail_p = 0;
 	int length;
-	unsigned long flags;
+	int work_done = 0;
 
-	spin_lock_irqsave(&lp->rx_lock, flags);
-
-	tail_p = lp->rx_bd_p + sizeof(*lp->rx_bd_v) * lp->rx_bd_ci;
 	cur_p = &lp->rx_bd_v[lp->rx_bd_ci];
 
 	bdstat = cur_p->app0;
-	while ((bdstat & STS_CTRL_APP0_CMPLT)) {
+	while ((bdstat & STS_CTRL_APP0_CMPLT) && work_done < budget) {
 
+		tail_p = lp->rx_bd_p + sizeof(*lp->rx_bd_v) * lp->rx_bd_ci;
 		skb = lp->rx_skb[lp->rx_bd_ci];
 		length = cur_p->app4 & 0x3FFF;
+		work_done++;
+
+		/* Drop the frame and reuse its buffer if there's no new one */
+		new_skb = netdev_alloc_skb_ip_align(ndev,
+						XTE_MAX_JUMBO_FRAME_SIZE);
+		if (!new_skb) {
+			ndev->stats.rx_dropped++;
+			cur_p->app0 = STS_CTRL_APP0_IRQONEND;
+			goto next;
+		}
 
 		dma_unmap_single(ndev->dev.parent, cur_p->phys, length,
 				 DMA_FROM_DEVICE);
@@ -775,25 +793,18 @@ static void ll_temac_recv(struct net_device *ndev)
 		}
 
 		if (!skb_defer_rx_timestamp(skb))
-			netif_rx(skb);
+			netif_receive_skb(skb);
 
 		ndev->stats.rx_packets++;
 		ndev->stats.rx_bytes += length;
 
-		new_skb = netdev_alloc_skb_ip_align(ndev,
-						XTE_MAX_JUMBO_FRAME_SIZE);
-		if (!new_skb) {
-			spin_unlock_irqrestore(&lp->rx_lock, flags);
-			return;
-		}
-
 		cur_p->app0 = STS_CTRL_APP0_IRQONEND;
 		cur_p->phys = dma_map_single(ndev->dev.parent, new_skb->data,
 					     XTE_MAX_JUMBO_FRAME_SIZE,
 					     DMA_FROM_DEVICE);
 		cur_p->len = XTE_MAX_JUMBO_FRAME_SIZE;
 		lp->rx_skb[lp->rx_bd_ci] = new_skb;
-
+next:
 		lp->rx_bd_ci++;
 		if (lp->rx_bd_ci >= RX_BD_NUM)
 			lp->rx_bd_ci = 0;
@@ -801,9 +812,52 @@ static void ll_temac_recv(struct net_device *ndev)
 		cur_p = &lp->rx_bd_v[lp->rx_bd_ci];
 		bdstat = cur_p->app0;
 	}
-	lp->dma_out(lp, RX_TAILDESC_PTR, tail_p);
+	if (work_done)
+		lp->dma_out(lp, RX_TAILDESC_PTR, tail_p);
+
+	return work_done;
+}
+
+static void temac_irq_enable(struct temac_local *lp, bool enable)
+{
+	u32 tx_ctrl = lp->dma_in(lp, TX_CHNL_CTRL);
+	u32 rx_ctrl = lp->dma_in(lp, RX_CHNL_CTRL);
+
+	if (enable) {
+		tx_ctrl |= CHNL_CTRL_IRQ_EN;
+		rx_ctrl |= CHNL_CTRL_IRQ_EN;
+	} else {
+		tx_ctrl &= ~CHNL_CTRL_IRQ_EN;
+		rx_ctrl &= ~CHNL_CTRL_IRQ_EN;
+	}
+
+	lp->dma_out(lp, TX_CHNL_CTRL, tx_ctrl);
+	lp->dma_out(lp, RX_CHNL_CTRL, rx_ctrl);
+}
 
-	spin_unlock_irqrestore(&lp->rx_lock, flags);
+/* Both channels are serviced from one NAPI context */
+static void temac_schedule_poll(struct temac_local *lp)
+{
+	if (napi_schedule_prep(&lp->napi)) {
+		temac_irq_enable(lp, false);
+		__napi_schedule(&lp->napi);
+	}
+}
+
+static int temac_poll(struct napi_struct *napi, int budget)
+{
+	struct temac_local *lp = container_of(napi, struct temac_local, napi);
+	int work_done;
+
+	temac_start_xmit_done(lp->ndev);
+	work_done = ll_temac_recv(lp->ndev, budget);
+
+	if (work_done < budget) {
+		napi_complete(napi);
+		temac_irq_enable(lp, true);
+	}
+
+	return work_done;
 }
 
 static irqreturn_t ll_temac_tx_irq(int irq, void *_ndev)
@@ -816,7 +870,7 @@ static irqreturn_t ll_temac_tx_irq(int irq, void *_ndev)
 	lp->dma_out(lp, TX_IRQ_REG, status);
 
 	if (status & (IRQ_COAL | IRQ_DLY))
-		temac_start_xmit_done(lp->ndev);
+		temac_schedule_poll(lp);
 	if (status & 0x080)
 		dev_err(&ndev->dev, "DMA error 0x%x\n", status);
 
@@ -834,7 +888,7 @@ static irqreturn_t ll_temac_rx_irq(int irq, void *_ndev)
 	lp->dma_out(lp, RX_IRQ_REG, status);
 
 	if (status & (IRQ_COAL | IRQ_DLY))
-		ll_temac_recv(lp->ndev);
+		temac_schedule_poll(lp);
 
 	return IRQ_HANDLED;
 }
@@ -858,6 +912,7 @@ static int temac_open(struct net_device *ndev)
 	}
 
 	temac_device_reset(ndev);
+	napi_enable(&lp->napi);
 
 	rc = request_irq(lp->tx_irq, ll_temac_tx_irq, 0, ndev->name, ndev);
 	if (rc)
@@ -871,6 +926,7 @@ static int temac_open(struct net_device *ndev)
  err_rx_irq:
 	free_irq(lp->tx_irq, ndev);
  err_tx_irq:
+	napi_disable(&lp->napi);
 	if (lp->phy_dev)
 		phy_disconnect(lp->phy_dev);
 	lp->phy_dev = NULL;
@@ -886,6 +942,7 @@ static int temac_stop(struct net_device *ndev)
 
 	free_irq(lp->tx_irq, ndev);
 	free_irq(lp->rx_irq, ndev);
+	napi_disable(&lp->napi);
 
 	if (lp->phy_dev)
 		phy_disconnect(lp->phy_dev);
@@ -986,12 +1043,60 @@ static int temac_nway_reset(struct net_device *ndev)
 	return phy_start_aneg(lp->phy_dev);
 }
 
+static int temac_get_coalesce(struct net_device *ndev,
+			      struct ethtool_coalesce *ec)
+{
+	struct temac_local *lp = netdev_priv(ndev);
+
+	ec->rx_max_coalesced_frames = lp->coalesce_count_rx;
+	ec->tx_max_coalesced_frames = lp->coalesce_count_tx;
+	return 0;
+}
+
+static int temac_set_coalesce(struct net_device *ndev,
+			      struct ethtool_coalesce *ec)
+{
+	struct temac_local *lp = netdev_priv(ndev);
+
+	if (netif_running(ndev)) {
+		netdev_err(ndev,
+			   "Please stop netif before applying configuration\n");
+		return -EBUSY;
+	}
+
+	if (ec->rx_coalesce_usecs || ec->rx_coalesce_usecs_irq ||
+	    ec->rx_max_coalesced_frames_irq || ec->tx_coalesce_usecs ||
+	    ec->tx_coalesce_usecs_irq || ec->tx_max_coalesced_frames_irq ||
+	    ec->stats_block_coalesce_usecs || ec->use_adaptive_rx_coalesce ||
+	    ec->use_adaptive_tx_coalesce || ec->pkt_rate_low ||
+	    ec->rx_coalesce_usecs_low || ec->rx_max_coalesced_frames_low ||
+	    ec->tx_coalesce_usecs_low || ec->tx_max_coalesced_frames_low ||
+	    ec->pkt_rate_high || ec->rx_coalesce_usecs_high ||
+	    ec->rx_max_coalesced_frames_high || ec->tx_coalesce_usecs_high ||
+	    ec->tx_max_coalesced_frames_high || ec->rate_sample_interval)
+		return -EOPNOTSUPP;
+
+	if (ec->rx_max_coalesced_frames > CHNL_CTRL_IRQ_COUNT_MAX ||
+	    ec->tx_max_coalesced_frames > CHNL_CTRL_IRQ_COUNT_MAX)
+		return -EINVAL;
+
+	/* Applied by temac_dma_bd_init() on the next open */
+	if (ec->rx_max_coalesced_frames)
+		lp->coalesce_count_rx = ec->rx_max_coalesced_frames;
+	if (ec->tx_max_coalesced_frames)
+		lp->coalesce_count_tx = ec->tx_max_coalesced_frames;
+
+	return 0;
+}
+
 static const struct ethtool_ops temac_ethtool_ops = {
 	.get_settings = temac_get_settings,
 	.set_settings = temac_set_settings,
 	.nway_reset = temac_nway_reset,
 	.get_link = ethtool_op_get_link,
 	.get_ts_info = ethtool_op_get_ts_info,
+	.get_coalesce = temac_get_coalesce,
+	.set_coalesce = temac_set_coalesce,
 };
 
 static int temac_of_probe(struct platform_device *op)
@@ -1033,8 +1138,10 @@ static int temac_of_probe(struct platform_device *op)
 	lp->ndev = ndev;
 	lp->dev = &op->dev;
 	lp->options = XTE_OPTION_DEFAULTS;
-	spin_lock_init(&lp->rx_lock);
+	lp->coalesce_count_rx = TEMAC_RX_IRQ_COUNT;
+	lp->coalesce_count_tx = TEMAC_TX_IRQ_COUNT;
 	mutex_init(&lp->indirect_mutex);
+	netif_napi_add(ndev, &lp->napi, temac_poll, TEMAC_NAPI_WEIGHT);
 
 	/* map device registers */
 	lp->regs = of_iomap(op->dev.of_node, 0);
@@ -134,6 +134,42 @@
 
 #define XAXIDMA_BD_MINIMUM_ALIGNMENT	0x40
 
+/* Axi MCDMA Register definitions. The S2MM registers are at the same
+ * offsets as the MM2S ones, XMCDMA_RX_OFFSET further into the register
+ * space. Per channel registers are indexed by the zero based channel.
+ */
+#define XMCDMA_CCR_OFFSET		0x00000000 /* Common control */
+#define XMCDMA_CSR_OFFSET		0x00000004 /* Common status */
+#define XMCDMA_CHEN_OFFSET		0x00000008 /* Channel enable */
+#define XMCDMA_RX_OFFSET		0x00000500 /* Start of S2MM registers */
+
+#define XMCDMA_CHAN_CR_OFFSET(ch)	(0x40 + (ch) * 0x40) /* Control */
+#define XMCDMA_CHAN_SR_OFFSET(ch)	(0x44 + (ch) * 0x40) /* Status */
+#define XMCDMA_CHAN_CDESC_OFFSET(ch)	(0x48 + (ch) * 0x40) /* Current BD */
+#define XMCDMA_CHAN_TDESC_OFFSET(ch)	(0x50 + (ch) * 0x40) /* Tail BD */
+
+#define XMCDMA_CR_RUNSTOP_MASK		0x00000001 /* Start/stop DMA/channel */
+#define XMCDMA_CR_RESET_MASK		0x00000004 /* Reset DMA engine */
+
+#define XMCDMA_IRQ_IOC_MASK		0x00000020 /* Completion intr */
+#define XMCDMA_IRQ_DELAY_MASK		0x00000040 /* Delay interrupt */
+#define XMCDMA_IRQ_ERROR_MASK		0x00000080 /* Error interrupt */
+#define XMCDMA_IRQ_ALL_MASK		0x000000E0 /* All interrupts */
+
+#define XMCDMA_BD_CTRL_LENGTH_MASK	0x03FFFFFF /* Requested len */
+#define XMCDMA_BD_CTRL_TXSOF_MASK	0x80000000 /* First tx packet */
+#define XMCDMA_BD_CTRL_TXEOF_MASK	0x40000000 /* Last tx packet */
+
+#define XMCDMA_BD_STS_ACTUAL_LEN_MASK	0x03FFFFFF /* Actual len */
+#define XMCDMA_BD_STS_COMPLETE_MASK	0x80000000 /* Completed */
+
+/* Maximum number of MCDMA channel pairs, i.e. netdev queues */
+#define XAE_MAX_QUEUES			16
+
+/* Descriptors defines for Tx and Rx DMA - 2^n for the best performance */
+#define TX_BD_NUM		64
+#define RX_BD_NUM		128
+
 /* Axi Ethernet registers definition */
 #define XAE_RAF_OFFSET		0x00000000 /* Reset and Address filter */
 #define XAE_TPF_OFFSET		0x00000004 /* Tx Pause Frame */
@@ -383,6 +419,131 @@ struct axidma_bd {
 	u32 reserved6;
 };
 
+/**
+ * struct aximcdma_tx_bd - Axi MCDMA MM2S buffer descriptor layout
+ * @next:         MM2S Next Descriptor Pointer
+ * @reserved1:    Reserved and not used
+ * @phys:         MM2S Buffer Address
+ * @reserved2:    Reserved and not used
+ * @reserved3:    Reserved and not used
+ * @cntrl:        MM2S Control and buffer length
+ * @sband_ctrl:   MM2S Sideband (TID/TDEST/TUSER) control
+ * @status:       MM2S Status
+ * @app0:         MM2S User Application Field 0.
+ * @app1:         MM2S User Application Field 1.
+ * @app2:         MM2S User Application Field 2.
+ * @app3:         MM2S User Application Field 3.
+ * @app4:         MM2S User Application Field 4.
+ * @sw_id_offset: MM2S Sw ID, the skb of the last BD of a frame
+ * @reserved4:    Reserved and not used
+ * @reserved5:    Reserved and not used
+ */
+struct aximcdma_tx_bd {
+	u32 next;
+	u32 reserved1;
+	u32 phys;
+	u32 reserved2;
+	u32 reserved3;
+	u32 cntrl;
+	u32 sband_ctrl;
+	u32 status;
+	u32 app0;
+	u32 app1;
+	u32 app2;
+	u32 app3;
+	u32 app4;
+	u32 sw_id_offset;
+	u32 reserved4;
+	u32 reserved5;
+};
+
+/**
+ * struct aximcdma_rx_bd - Axi MCDMA S2MM buffer descriptor layout
+ * @next:         S2MM Next Descriptor Pointer
+ * @reserved1:    Reserved and not used
+ * @phys:         S2MM Buffer Address
+ * @reserved2:    Reserved and not used
+ * @reserved3:    Reserved and not used
+ * @cntrl:        S2MM Buffer length
+ * @status:       S2MM Status and received length
+ * @sband_status: S2MM Sideband (TID/TDEST/TUSER) status
+ * @app0:         S2MM User Application Field 0.
+ * @app1:         S2MM User Application Field 1.
+ * @app2:         S2MM User Application Field 2.
+ * @app3:         S2MM User Application Field 3.
+ * @app4:         S2MM User Application Field 4.
+ * @sw_id_offset: S2MM Sw ID, the skb of the buffer
+ * @reserved4:    Reserved and not used
+ * @reserved5:    Reserved and not used
+ */
+struct aximcdma_rx_bd {
+	u32 next;
+	u32 reserved1;
+	u32 phys;
+	u32 reserved2;
+	u32 reserved3;
+	u32 cntrl;
+	u32 status;
+	u32 sband_status;
+	u32 app0;
+	u32 app1;
+	u32 app2;
+	u32 app3;
+	u32 app4;
+	u32 sw_id_offset;
+	u32 reserved4;
+	u32 reserved5;
+};
+
+struct axienet_local;
+
+/**
+ * struct axienet_dma_q - Axi MCDMA channel pair backing one netdev queue
+ * @lp:		Pointer to the axienet_local structure
+ * @napi:	NAPI structure processing both rings of the queue
+ * @chan_id:	Zero based MCDMA channel of the queue
+ * @tx_irq:	MM2S channel IRQ number
+ * @rx_irq:	S2MM channel IRQ number
+ * @tx_irq_name: Name the MM2S channel IRQ is requested with
+ * @rx_irq_name: Name the S2MM channel IRQ is requested with
+ * @tx_bd_v:	Virtual address of the TX buffer descriptor ring
+ * @tx_bd_p:	Physical address(start address) of the TX buffer descr. ring
+ * @rx_bd_v:	Virtual address of the RX buffer descriptor ring
+ * @rx_bd_p:	Physical address(start address) of the RX buffer descr. ring
+ * @tx_bd_ci:	Index of the oldest Tx BD not yet reclaimed
+ * @tx_bd_tail:	Index of the next free Tx BD
+ * @rx_bd_ci:	Index of the next Rx BD to be processed
+ * @tx_packets:	Frames transmitted on this queue
+ * @tx_bytes:	Bytes transmitted on this queue
+ * @rx_packets:	Frames received on this queue
+ * @rx_bytes:	Bytes received on this queue
+ * @rx_dropped:	Frames dropped on this queue for lack of Rx buffers
+ */
+struct axienet_dma_q {
+	struct axienet_local *lp;
+	struct napi_struct napi;
+	u16 chan_id;
+
+	int tx_irq;
+	int rx_irq;
+	char tx_irq_name[IFNAMSIZ + 8];
+	char rx_irq_name[IFNAMSIZ + 8];
+
+	struct aximcdma_tx_bd *tx_bd_v;
+	dma_addr_t tx_bd_p;
+	struct aximcdma_rx_bd *rx_bd_v;
+	dma_addr_t rx_bd_p;
+	u32 tx_bd_ci;
+	u32 tx_bd_tail;
+	u32 rx_bd_ci;
+
+	unsigned long tx_packets;
+	unsigned long tx_bytes;
+	unsigned long rx_packets;
+	unsigned long rx_bytes;
+	unsigned long rx_dropped;
+};
+
 /**
  * struct axienet_local - axienet private per device data
  * @ndev:	Pointer for net_device to which it will be attached.
@@ -394,6 +555,8 @@ struct axidma_bd {
  * @regs:	Base address for the axienet_local device address space
  * @dma_regs:	Base address for the axidma device address space
  * @dma_err_tasklet: Tasklet structure to process Axi DMA errors
+ * @napi:	NAPI structure used to process the Tx and Rx BD rings
+ * @bp_state:	Owner of the Rx BD ring, the NAPI poll or a busy polling socket
  * @tx_irq:	Axidma TX IRQ number
  * @rx_irq:	Axidma RX IRQ number
  * @phy_type:	Phy type to identify between MII/GMII/RGMII/SGMII/1000 Base-X
@@ -411,12 +574,17 @@ struct axidma_bd {
  *		completed.
  * @rx_bd_ci:	Stores the index of the Rx buffer descriptor in the ring being
  *		accessed currently.
+ * @tx_kick_pending: Set when Tx BDs were queued with xmit_more and the tail
+ *		descriptor has not been written to the DMA channel yet.
  * @max_frm_size: Stores the maximum size of the frame that can be that
  *		  Txed/Rxed in the existing hardware. If jumbo option is
  *		  supported, the maximum frame size would be 9k. Else it is
  *		  1522 bytes (assuming support for basic VLAN)
  * @jumbo_support: Stores hardware configuration for jumbo support. If hardware
  *		   can handle jumbo packets, this entry will be 1, else 0.
+ * @mcdma:	Set when the DMA engine is an Axi MCDMA instead of an Axi DMA
+ * @num_queues:	Number of netdev queues, one MCDMA channel pair each
+ * @dq:		Per queue MCDMA state, @num_queues entries
  */
 struct axienet_local {
 	struct net_device *ndev;
@@ -435,6 +603,10 @@ struct axienet_local {
 	void __iomem *dma_regs;
 
 	struct tasklet_struct dma_err_tasklet;
+	struct napi_struct napi;
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	atomic_t bp_state;
+#endif
 
 	int tx_irq;
 	int rx_irq;
@@ -452,6 +624,7 @@ struct axienet_local {
 	u32 tx_bd_ci;
 	u32 tx_bd_tail;
 	u32 rx_bd_ci;
+	bool tx_kick_pending;
 
 	u32 max_frm_size;
 	u32 rxmem;
@@ -461,6 +634,10 @@ struct axienet_local {
 
 	u32 coalesce_count_rx;
 	u32 coalesce_count_tx;
+
+	bool mcdma;
+	u16 num_queues;
+	struct axienet_dma_q *dq;
 };
 
 /**
@@ -504,9 +681,50 @@ static inline void axienet_iow(struct axienet_local *lp, off_t offset,
 	out_be32((lp->regs + offset), value);
 }
 
+/**
+ * axienet_dma_in32 - Memory mapped Axi DMA register read
+ * @lp:		Pointer to axienet local structure
+ * @reg:	Address offset from the base address of the Axi DMA core
+ *
+ * Return: The contents of the Axi DMA register
+ *
+ * This function returns the contents of the corresponding Axi DMA register.
+ */
+static inline u32 axienet_dma_in32(struct axienet_local *lp, off_t reg)
+{
+	return in_be32(lp->dma_regs + reg);
+}
+
+/**
+ * axienet_dma_out32 - Memory mapped Axi DMA register write.
+ * @lp:		Pointer to axienet local structure
+ * @reg:	Address offset from the base address of the Axi DMA core
+ * @value:	Value to be written into the Axi DMA register
+ *
+ * This function writes the desired value into the corresponding Axi DMA
+ * register.
+ */
+static inline void axienet_dma_out32(struct axienet_local *lp,
+				     off_t reg, u32 value)
+{
+	out_be32((lp->dma_regs + reg), value);
+}
+
 /* Function prototypes visible in xilinx_axienet_mdio.c for other files */
 int axienet_mdio_setup(struct axienet_local *lp, struct device_node *np);
 int axienet_mdio_wait_until_ready(struct axienet_local *lp);
 void axienet_mdio_teardown(struct axienet_local *lp);
 
+/* Function prototypes visible in xilinx_axienet_mcdma.c for other files */
+int axienet_mcdma_probe(struct net_device *ndev, struct device_node *np);
+int axienet_mcdma_bd_init(struct net_device *ndev);
+void axienet_mcdma_bd_release(struct net_device *ndev);
+void axienet_mcdma_err_handler(struct net_device *ndev);
+int axienet_mcdma_request_irqs(struct net_device *ndev);
+void axienet_mcdma_free_irqs(struct net_device *ndev);
+void axienet_mcdma_stop(struct net_device *ndev);
+int axienet_mcdma_start_xmit(struct sk_buff *skb, struct net_device *ndev);
+void axienet_mcdma_get_stats(struct net_device *ndev);
+void axienet_mcdma_poll_controller(struct net_device *ndev);
+
 #endif /* XILINX_AXI_ENET_H */
@@ -33,13 +33,10 @@
 #include <linux/phy.h>
 #include <linux/mii.h>
 #include <linux/ethtool.h>
+#include <net/busy_poll.h>
 
 #include "xilinx_axienet.h"
 
-/* Descriptors defines for Tx and Rx DMA - 2^n for the best performance */
-#define TX_BD_NUM		64
-#define RX_BD_NUM		128
-
 /* Must be shorter than length of ethtool_drvinfo.driver field to fit */
 #define DRIVER_NAME		"xaxienet"
 #define DRIVER_DESCRIPTION	"Xilinx Axi Ethernet driver"
@@ -47,6 +44,9 @@
 
 #define AXIENET_REGS_N		32
 
+/* Rx BDs processed per call of the busy poll routine */
+#define AXIENET_BUSY_POLL_BUDGET	4
+
 /* Match table for of_platform binding */
 static struct of_device_id axienet_of_match[] = {
 	{ .compatible = "xlnx,axi-ethernet-1.00.a", },
@@ -112,35 +112,6 @@ static struct axienet_option axienet_options[] = {
 	{}
 };
 
-/**
- * axienet_dma_in32 - Memory mapped Axi DMA register read
- * @lp:		Pointer to axienet local structure
- * @reg:	Address offset from the base address of the Axi DMA core
- *
- * Return: The contents of the Axi DMA register
- *
- * This function returns the contents of the corresponding Axi DMA register.
- */
-static inline u32 axienet_dma_in32(struct axienet_local *lp, off_t reg)
-{
-	return in_be32(lp->dma_regs + reg);
-}
-
-/**
- * axienet_dma_out32 - Memory mapped Axi DMA register write.
- * @lp:		Pointer to axienet local structure
- * @reg:	Address offset from the base address of the Axi DMA core
- * @value:	Value to be written into the Axi DMA register
- *
- * This function writes the desired value into the corresponding Axi DMA
- * register.
- */
-static inline void axienet_dma_out32(struct axienet_local *lp,
-				     off_t reg, u32 value)
-{
-	out_be32((lp->dma_regs + reg), value);
-}
-
 /**
  * axienet_dma_bd_release - Release buffer descriptor rings
  * @ndev:	Pointer to the net_device structure
@@ -196,6 +167,8 @@ static int axienet_dma_bd_init(struct net_device *ndev)
 	lp->tx_bd_ci = 0;
 	lp->tx_bd_tail = 0;
 	lp->rx_bd_ci = 0;
+	lp->tx_kick_pending = false;
+	netdev_reset_queue(ndev);
 
 	/* Allocate the Tx and Rx buffer descriptors. */
 	lp->tx_bd_v = dma_zalloc_coherent(ndev->dev.parent,
@@ -452,6 +425,23 @@ static void __axienet_device_reset(struct axienet_local *lp,
 	}
 }
 
+/**
+ * axienet_dma_reset - Reset both directions of the Axi DMA or Axi MCDMA.
+ * @lp:		Pointer to the axienet_local structure
+ * @dev:	Device used for error reporting
+ */
+static void axienet_dma_reset(struct axienet_local *lp, struct device *dev)
+{
+	if (lp->mcdma) {
+		__axienet_device_reset(lp, dev, XMCDMA_CCR_OFFSET);
+		__axienet_device_reset(lp, dev,
+				       XMCDMA_RX_OFFSET + XMCDMA_CCR_OFFSET);
+	} else {
+		__axienet_device_reset(lp, dev, XAXIDMA_TX_CR_OFFSET);
+		__axienet_device_reset(lp, dev, XAXIDMA_RX_CR_OFFSET);
+	}
+}
+
 /**
  * axienet_device_reset - Reset and initialize the Axi Ethernet hardware.
  * @ndev:	Pointer to the net_device structure
@@ -465,11 +455,11 @@ static void __axienet_device_reset(struct axienet_local *lp,
  */
 static void axienet_device_reset(struct net_device *ndev)
 {
+	int ret;
 	u32 axienet_status;
 	struct axienet_local *lp = netdev_priv(ndev);
 
-	__axienet_device_reset(lp, &ndev->dev, XAXIDMA_TX_CR_OFFSET);
-	__axienet_device_reset(lp, &ndev->dev, XAXIDMA_RX_CR_OFFSET);
+	axienet_dma_reset(lp, &ndev->dev);
 
 	lp->max_frm_size = XAE_MAX_VLAN_FRAME_SIZE;
 	lp->options |= XAE_OPTION_VLAN;
@@ -484,7 +474,11 @@ static void axienet_device_reset(struct net_device *ndev)
 			lp->options |= XAE_OPTION_JUMBO;
 	}
 
-	if (axienet_dma_bd_init(ndev)) {
+	if (lp->mcdma)
+		ret = axienet_mcdma_bd_init(ndev);
+	else
+		ret = axienet_dma_bd_init(ndev);
+	if (ret) {
 		dev_err(&ndev->dev,
 			"axienet_device_reset descriptor "
 			"allocation failed\n");
@@ -575,16 +569,17 @@ static void axienet_adjust_link(struct net_device *ndev)
  * Axi DMA Tx channel.
  * @ndev:	Pointer to the net_device structure
  *
- * This function is invoked from the Axi DMA Tx isr to notify the completion
- * of transmit operation. It clears fields in the corresponding Tx BDs and
+ * This function is invoked from the NAPI poll routine to process the Tx BDs
+ * completed by the hardware. It clears fields in the corresponding Tx BDs and
  * unmaps the corresponding buffer so that CPU can regain ownership of the
- * buffer. It finally invokes "netif_wake_queue" to restart transmission if
- * required.
+ * buffer. It reports the completed frames to BQL and finally invokes
+ * "netif_wake_queue" to restart transmission if required.
  */
 static void axienet_start_xmit_done(struct net_device *ndev)
 {
 	u32 size = 0;
 	u32 packets = 0;
+	unsigned int pkts_compl = 0, bytes_compl = 0;
 	struct axienet_local *lp = netdev_priv(ndev);
 	struct axidma_bd *cur_p;
 	unsigned int status = 0;
@@ -595,8 +590,13 @@ static void axienet_start_xmit_done(struct net_device *ndev)
 		dma_unmap_single(ndev->dev.parent, cur_p->phys,
 				(cur_p->cntrl & XAXIDMA_BD_CTRL_LENGTH_MASK),
 				DMA_TO_DEVICE);
-		if (cur_p->app4)
-			dev_kfree_skb_irq((struct sk_buff *)cur_p->app4);
+		if (cur_p->app4) {
+			struct sk_buff *skb = (struct sk_buff *)cur_p->app4;
+
+			bytes_compl += skb->len;
+			pkts_compl++;
+			dev_kfree_skb(skb);
+		}
 		/*cur_p->phys = 0;*/
 		cur_p->app0 = 0;
 		cur_p->app1 = 0;
@@ -613,6 +613,10 @@ static void axienet_start_xmit_done(struct net_device *ndev)
 		status = cur_p->status;
 	}
 
+	if (!packets)
+		return;
+
+	netdev_completed_queue(ndev, pkts_compl, bytes_compl);
 	ndev->stats.tx_packets += packets;
 	ndev->stats.tx_bytes += size;
 	netif_wake_queue(ndev);
@@ -641,6 +645,24 @@ static inline int axienet_check_tx_bd_space(struct axienet_local *lp,
 	return 0;
 }
 
+/**
+ * axienet_tx_kick - Hand the queued Tx BDs over to the DMA channel.
+ * @lp:		Pointer to the axienet_local structure
+ *
+ * Writes the last queued BD to the tail descriptor register, which makes the
+ * channel process every BD up to and including it.
+ */
+static void axienet_tx_kick(struct axienet_local *lp)
+{
+	u32 last = (lp->tx_bd_tail + TX_BD_NUM - 1) % TX_BD_NUM;
+	dma_addr_t tail_p = lp->tx_bd_p + sizeof(*lp->tx_bd_v) * last;
+
+	/* Ensure BD write before starting transfer */
+	wmb();
+	axienet_dma_out32(lp, XAXIDMA_TX_TDESC_OFFSET, tail_p);
+	lp->tx_kick_pending = false;
+}
+
 /**
  * axienet_start_xmit - Starts the transmission.
  * @skb:	sk_buff pointer that contains data to be Txed.
@@ -652,7 +674,9 @@ static inline int axienet_check_tx_bd_space(struct axienet_local *lp,
  * This function is invoked from upper layers to initiate transmission. The
  * function uses the next available free BDs and populates their fields to
  * start the transmission. Additionally if checksum offloading is supported,
- * it populates AXI Stream Control fields with appropriate values.
+ * it populates AXI Stream Control fields with appropriate values. The tail
+ * descriptor is only written for the last frame of an xmit_more batch, or
+ * when the queue has been stopped and no further frame will follow.
  */
 static int axienet_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 {
@@ -661,16 +685,21 @@ static int axienet_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	u32 csum_start_off;
 	u32 csum_index_off;
 	skb_frag_t *frag;
-	dma_addr_t tail_p;
 	struct axienet_local *lp = netdev_priv(ndev);
 	struct axidma_bd *cur_p;
 
+	if (lp->mcdma)
+		return axienet_mcdma_start_xmit(skb, ndev);
+
 	num_frag = skb_shinfo(skb)->nr_frags;
 	cur_p = &lp->tx_bd_v[lp->tx_bd_tail];
 
 	if (axienet_check_tx_bd_space(lp, num_frag)) {
 		if (!netif_queue_stopped(ndev))
 			netif_stop_queue(ndev);
+		/* Flush the frames held back by xmit_more */
+		if (lp->tx_kick_pending)
+			axienet_tx_kick(lp);
 		return NETDEV_TX_BUSY;
 	}
 
@@ -708,43 +737,136 @@ static int axienet_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	cur_p->cntrl |= XAXIDMA_BD_CTRL_TXEOF_MASK;
 	cur_p->app4 = (unsigned long)skb;
 
-	tail_p = lp->tx_bd_p + sizeof(*lp->tx_bd_v) * lp->tx_bd_tail;
-	/* Ensure BD write before starting transfer */
-	wmb();
-
-	/* Start the transfer */
-	axienet_dma_out32(lp, XAXIDMA_TX_TDESC_OFFSET, tail_p);
 	++lp->tx_bd_tail;
 	lp->tx_bd_tail %= TX_BD_NUM;
+	lp->tx_kick_pending = true;
+	netdev_sent_queue(ndev, skb->len);
+
+	/* Start the transfer */
+	if (!skb->xmit_more ||
+	    netif_xmit_stopped(netdev_get_tx_queue(ndev, 0)))
+		axienet_tx_kick(lp);
 
 	return NETDEV_TX_OK;
 }
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+enum axienet_bp_state {
+	AXIENET_BP_STATE_IDLE = 0,
+	AXIENET_BP_STATE_NAPI,
+	AXIENET_BP_STATE_POLL,
+	AXIENET_BP_STATE_DISABLE
+};
+
+static inline void axienet_bp_init_lock(struct axienet_local *lp)
+{
+	atomic_set(&lp->bp_state, AXIENET_BP_STATE_IDLE);
+}
+
+/* called from the NAPI poll routine to get ownership of the Rx BD ring */
+static inline bool axienet_bp_lock_napi(struct axienet_local *lp)
+{
+	return atomic_cmpxchg(&lp->bp_state, AXIENET_BP_STATE_IDLE,
+			      AXIENET_BP_STATE_NAPI) == AXIENET_BP_STATE_IDLE;
+}
+
+static inline void axienet_bp_unlock_napi(struct axienet_local *lp)
+{
+	WARN_ON(atomic_read(&lp->bp_state) != AXIENET_BP_STATE_NAPI);
+
+	/* flush any outstanding Rx frames */
+	if (lp->napi.gro_list)
+		napi_gro_flush(&lp->napi, false);
+
+	atomic_set(&lp->bp_state, AXIENET_BP_STATE_IDLE);
+}
+
+/* called from axienet_busy_poll() */
+static inline bool axienet_bp_lock_poll(struct axienet_local *lp)
+{
+	return atomic_cmpxchg(&lp->bp_state, AXIENET_BP_STATE_IDLE,
+			      AXIENET_BP_STATE_POLL) == AXIENET_BP_STATE_IDLE;
+}
+
+static inline void axienet_bp_unlock_poll(struct axienet_local *lp)
+{
+	WARN_ON(atomic_read(&lp->bp_state) != AXIENET_BP_STATE_POLL);
+
+	atomic_set(&lp->bp_state, AXIENET_BP_STATE_IDLE);
+}
+
+/* true if a socket is polling the Rx BD ring */
+static inline bool axienet_bp_busy_polling(struct axienet_local *lp)
+{
+	return atomic_read(&lp->bp_state) == AXIENET_BP_STATE_POLL;
+}
+
+/* false if the Rx BD ring is currently owned */
+static inline bool axienet_bp_disable(struct axienet_local *lp)
+{
+	int rc = atomic_cmpxchg(&lp->bp_state, AXIENET_BP_STATE_IDLE,
+				AXIENET_BP_STATE_DISABLE);
+
+	return rc == AXIENET_BP_STATE_IDLE;
+}
+#else
+static inline void axienet_bp_init_lock(struct axienet_local *lp)
+{
+}
+
+static inline bool axienet_bp_lock_napi(struct axienet_local *lp)
+{
+	return true;
+}
+
+static inline void axienet_bp_unlock_napi(struct axienet_local *lp)
+{
+}
+
+static inline bool axienet_bp_busy_polling(struct axienet_local *lp)
+{
+	return false;
+}
+
+static inline bool axienet_bp_disable(struct axienet_local *lp)
+{
+	return true;
+}
+#endif /* CONFIG_NET_RX_BUSY_POLL */
+
 /**
- * axienet_recv - Is called from Axi DMA Rx Isr to complete the received
- *		  BD processing.
+ * axienet_recv - Process the Rx BDs completed by the Axi DMA Rx channel.
  * @ndev:	Pointer to net_device structure.
+ * @budget:	Maximum number of frames that may be passed to the stack
  *
- * This function is invoked from the Axi DMA Rx isr to process the Rx BDs. It
- * does minimal processing and invokes "netif_rx" to complete further
- * processing.
+ * Return: the number of frames processed
+ *
+ * This function is invoked from the NAPI poll routine to process at most
+ * @budget Rx BDs. A replacement buffer is allocated before a frame is handed
+ * to the stack with "napi_gro_receive"; if that allocation fails the frame
+ * is dropped and its buffer is given back to the hardware, so the ring never
+ * loses a descriptor. Frames rejected by the early RX filter are dropped the
+ * same way, before any allocation. When called for a busy polling socket
+ * the frames bypass GRO, which belongs to the NAPI context.
  */
-static void axienet_recv(struct net_device *ndev)
+static int axienet_recv(struct net_device *ndev, int budget)
 {
 	u32 length;
 	u32 csumstatus;
 	u32 size = 0;
-	u32 packets = 0;
+	u32 dropped = 0;
+	int packets = 0;
 	dma_addr_t tail_p = 0;
 	struct axienet_local *lp = netdev_priv(ndev);
 	struct sk_buff *skb, *new_skb;
 	struct axidma_bd *cur_p;
 
-	/* Get relevat BD status value */
-	rmb();
 	cur_p = &lp->rx_bd_v[lp->rx_bd_ci];
 
-	while ((cur_p->status & XAXIDMA_BD_STS_COMPLETE_MASK)) {
+	while (packets < budget &&
+	       (cur_p->status & XAXIDMA_BD_STS_COMPLETE_MASK)) {
+		/* Read the rest of the BD only after its status */
+		rmb();
 		tail_p = lp->rx_bd_p + sizeof(*lp->rx_bd_v) * lp->rx_bd_ci;
 		skb = (struct sk_buff *) (cur_p->sw_id_offset);
 		length = cur_p->app4 & 0x0000FFFF;
@@ -753,6 +875,21 @@ static void axienet_recv(struct net_device *ndev)
 				 lp->max_frm_size,
 				 DMA_FROM_DEVICE);
 
+		if (netif_rx_early_drop(ndev, skb->data, length)) {
+			/* Filtered out, reuse the buffer as is */
+			dropped++;
+			new_skb = skb;
+			goto refill;
+		}
+
+		new_skb = netdev_alloc_skb_ip_align(ndev, lp->max_frm_size);
+		if (!new_skb) {
+			/* Drop the frame and reuse its buffer */
+			dropped++;
+			new_skb = skb;
+			goto refill;
+		}
+
 		skb_put(skb, length);
 		skb->protocol = eth_type_trans(skb, ndev);
 		/*skb_checksum_none_assert(skb);*/
@@ -773,14 +910,16 @@ static void axienet_recv(struct net_device *ndev)
 			skb->ip_summed = CHECKSUM_COMPLETE;
 		}
 
-		netif_rx(skb);
+		skb_mark_napi_id(skb, &lp->napi);
+		if (axienet_bp_busy_polling(lp))
+			netif_receive_skb(skb);
+		else
+			napi_gro_receive(&lp->napi, skb);
 
 		size += length;
-		packets++;
 
-		new_skb = netdev_alloc_skb_ip_align(ndev, lp->max_frm_size);
-		if (!new_skb)
-			return;
+refill:
+		packets++;
 
 		cur_p->phys = dma_map_single(ndev->dev.parent, new_skb->data,
 					     lp->max_frm_size,
@@ -794,11 +933,134 @@ static void axienet_recv(struct net_device *ndev)
 		cur_p = &lp->rx_bd_v[lp->rx_bd_ci];
 	}
 
-	ndev->stats.rx_packets += packets;
+	ndev->stats.rx_packets += packets - dropped;
+	ndev->stats.rx_dropped += dropped;
 	ndev->stats.rx_bytes += size;
 
-	if (tail_p)
+	if (tail_p) {
+		/* Ensure BD writes before handing them back to the DMA */
+		wmb();
 		axienet_dma_out32(lp, XAXIDMA_RX_TDESC_OFFSET, tail_p);
+	}
+
+	return packets;
+}
+
+/**
+ * axienet_irq_enable - Unmask or mask the Axi DMA completion interrupts.
+ * @lp:		Pointer to axienet local structure
+ * @offset:	Control register offset of the Tx or Rx channel
+ * @enable:	true to unmask the interrupts, false to mask them
+ *
+ * The completion (IOC) and delay timer interrupts are masked while the NAPI
+ * poll routine owns the rings. The error interrupt is left alone; when it is
+ * cleared, error recovery is pending and the completion interrupts stay
+ * masked until axienet_dma_err_handler reprograms the channel.
+ */
+static void axienet_irq_enable(struct axienet_local *lp, off_t offset,
+			       bool enable)
+{
+	u32 cr;
+
+	cr = axienet_dma_in32(lp, offset);
+	if (!enable)
+		cr &= ~(XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_DELAY_MASK);
+	else if (cr & XAXIDMA_IRQ_ERROR_MASK)
+		cr |= XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_DELAY_MASK;
+	axienet_dma_out32(lp, offset, cr);
+}
+
+/**
+ * axienet_poll - NAPI poll routine.
+ * @napi:	Pointer to the NAPI structure of the device
+ * @budget:	Maximum number of Rx frames to process
+ *
+ * Return: the number of Rx frames processed
+ *
+ * Reclaims the completed Tx BDs and processes up to @budget Rx BDs. Once
+ * both rings are drained the completion interrupts of both channels, which
+ * were masked by the Isr that scheduled this poll, are unmasked again.
+ */
+static int axienet_poll(struct napi_struct *napi, int budget)
+{
+	int work_done;
+	struct axienet_local *lp = container_of(napi, struct axienet_local,
+						napi);
+	struct net_device *ndev = lp->ndev;
+
+	axienet_start_xmit_done(ndev);
+
+	/* A busy polling socket owns the Rx BD ring, poll again later */
+	if (!axienet_bp_lock_napi(lp))
+		return budget;
+
+	work_done = axienet_recv(ndev, budget);
+	axienet_bp_unlock_napi(lp);
+
+	if (work_done < budget) {
+		napi_complete(napi);
+		axienet_irq_enable(lp, XAXIDMA_TX_CR_OFFSET, true);
+		axienet_irq_enable(lp, XAXIDMA_RX_CR_OFFSET, true);
+	}
+
+	return work_done;
+}
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+/**
+ * axienet_busy_poll - Busy poll routine.
+ * @napi:	Pointer to the NAPI structure of the device
+ *
+ * Return: the number of Rx frames processed, LL_FLUSH_FAILED if the device
+ * is down or LL_FLUSH_BUSY if the NAPI poll routine owns the Rx BD ring
+ *
+ * Called by sockets busy waiting for data instead of sleeping until the Rx
+ * interrupt. Tx BDs are still reclaimed by the NAPI poll routine.
+ */
+static int axienet_busy_poll(struct napi_struct *napi)
+{
+	int found;
+	struct axienet_local *lp = container_of(napi, struct axienet_local,
+						napi);
+
+	if (!netif_running(lp->ndev))
+		return LL_FLUSH_FAILED;
+
+	if (!axienet_bp_lock_poll(lp))
+		return LL_FLUSH_BUSY;
+
+	found = axienet_recv(lp->ndev, AXIENET_BUSY_POLL_BUDGET);
+	axienet_bp_unlock_poll(lp);
+
+	return found;
+}
+#endif
+
+/**
+ * axienet_napi_disable - Stop the NAPI poll routine and busy polling sockets.
+ * @lp:		Pointer to axienet local structure
+ */
+static void axienet_napi_disable(struct axienet_local *lp)
+{
+	napi_disable(&lp->napi);
+	while (!axienet_bp_disable(lp))
+		usleep_range(1000, 20000);
+}
+
+/**
+ * axienet_schedule_poll - Mask the completion interrupts and schedule NAPI.
+ * @lp:		Pointer to axienet local structure
+ *
+ * Both channels share a single NAPI context, so the completion interrupts of
+ * both are masked before the poll routine is scheduled.
+ */
+static void axienet_schedule_poll(struct axienet_local *lp)
+{
+	if (napi_schedule_prep(&lp->napi)) {
+		axienet_irq_enable(lp, XAXIDMA_TX_CR_OFFSET, false);
+		axienet_irq_enable(lp, XAXIDMA_RX_CR_OFFSET, false);
+		__napi_schedule(&lp->napi);
+	}
 }
 
 /**
@@ -808,8 +1070,8 @@ static void axienet_recv(struct net_device *ndev)
  *
  * Return: IRQ_HANDLED for all cases.
  *
- * This is the Axi DMA Tx done Isr. It invokes "axienet_start_xmit_done"
- * to complete the BD processing.
+ * This is the Axi DMA Tx done Isr. It masks the completion interrupts and
+ * schedules the NAPI poll routine, which completes the BD processing.
  */
 static irqreturn_t axienet_tx_irq(int irq, void *_ndev)
 {
@@ -821,7 +1083,7 @@ static irqreturn_t axienet_tx_irq(int irq, void *_ndev)
 	status = axienet_dma_in32(lp, XAXIDMA_TX_SR_OFFSET);
 	if (status & (XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_DELAY_MASK)) {
 		axienet_dma_out32(lp, XAXIDMA_TX_SR_OFFSET, status);
-		axienet_start_xmit_done(lp->ndev);
+		axienet_schedule_poll(lp);
 		goto out;
 	}
 	if (!(status & XAXIDMA_IRQ_ALL_MASK))
@@ -857,8 +1119,8 @@ out:
  *
  * Return: IRQ_HANDLED for all cases.
  *
- * This is the Axi DMA Rx Isr. It invokes "axienet_recv" to complete the BD
- * processing.
+ * This is the Axi DMA Rx Isr. It masks the completion interrupts and
+ * schedules the NAPI poll routine, which completes the BD processing.
  */
 static irqreturn_t axienet_rx_irq(int irq, void *_ndev)
 {
@@ -870,7 +1132,7 @@ static irqreturn_t axienet_rx_irq(int irq, void *_ndev)
 	status = axienet_dma_in32(lp, XAXIDMA_RX_SR_OFFSET);
 	if (status & (XAXIDMA_IRQ_IOC_MASK | XAXIDMA_IRQ_DELAY_MASK)) {
 		axienet_dma_out32(lp, XAXIDMA_RX_SR_OFFSET, status);
-		axienet_recv(lp->ndev);
+		axienet_schedule_poll(lp);
 		goto out;
 	}
 	if (!(status & XAXIDMA_IRQ_ALL_MASK))
@@ -961,6 +1223,16 @@ static int axienet_open(struct net_device *ndev)
 	tasklet_init(&lp->dma_err_tasklet, axienet_dma_err_handler,
 		     (unsigned long) lp);
 
+	if (lp->mcdma) {
+		ret = axienet_mcdma_request_irqs(ndev);
+		if (ret)
+			goto err_phy;
+		return 0;
+	}
+
+	axienet_bp_init_lock(lp);
+	napi_enable(&lp->napi);
+
 	/* Enable interrupts for Axi DMA Tx */
 	ret = request_irq(lp->tx_irq, axienet_tx_irq, 0, ndev->name, ndev);
 	if (ret)
@@ -975,11 +1247,13 @@ static int axienet_open(struct net_device *ndev)
 err_rx_irq:
 	free_irq(lp->tx_irq, ndev);
 err_tx_irq:
+	axienet_napi_disable(lp);
+	dev_err(lp->dev, "request_irq() failed\n");
+err_phy:
 	if (lp->phy_dev)
 		phy_disconnect(lp->phy_dev);
 	lp->phy_dev = NULL;
 	tasklet_kill(&lp->dma_err_tasklet);
-	dev_err(lp->dev, "request_irq() failed\n");
 	return ret;
 }
 
@@ -1000,25 +1274,37 @@ static int axienet_stop(struct net_device *ndev)
 
 	dev_dbg(&ndev->dev, "axienet_close()\n");
 
-	cr = axienet_dma_in32(lp, XAXIDMA_RX_CR_OFFSET);
-	axienet_dma_out32(lp, XAXIDMA_RX_CR_OFFSET,
-			  cr & (~XAXIDMA_CR_RUNSTOP_MASK));
-	cr = axienet_dma_in32(lp, XAXIDMA_TX_CR_OFFSET);
-	axienet_dma_out32(lp, XAXIDMA_TX_CR_OFFSET,
-			  cr & (~XAXIDMA_CR_RUNSTOP_MASK));
+	if (lp->mcdma) {
+		axienet_mcdma_stop(ndev);
+	} else {
+		cr = axienet_dma_in32(lp, XAXIDMA_RX_CR_OFFSET);
+		axienet_dma_out32(lp, XAXIDMA_RX_CR_OFFSET,
+				  cr & (~XAXIDMA_CR_RUNSTOP_MASK));
+		cr = axienet_dma_in32(lp, XAXIDMA_TX_CR_OFFSET);
+		axienet_dma_out32(lp, XAXIDMA_TX_CR_OFFSET,
+				  cr & (~XAXIDMA_CR_RUNSTOP_MASK));
+	}
 	axienet_setoptions(ndev, lp->options &
 			   ~(XAE_OPTION_TXEN | XAE_OPTION_RXEN));
 
-	tasklet_kill(&lp->dma_err_tasklet);
+	if (lp->mcdma) {
+		axienet_mcdma_free_irqs(ndev);
+	} else {
+		axienet_napi_disable(lp);
+		free_irq(lp->tx_irq, ndev);
+		free_irq(lp->rx_irq, ndev);
+	}
 
-	free_irq(lp->tx_irq, ndev);
-	free_irq(lp->rx_irq, ndev);
+	tasklet_kill(&lp->dma_err_tasklet);
 
 	if (lp->phy_dev)
 		phy_disconnect(lp->phy_dev);
 	lp->phy_dev = NULL;
 
-	axienet_dma_bd_release(ndev);
+	if (lp->mcdma)
+		axienet_mcdma_bd_release(ndev);
+	else
+		axienet_dma_bd_release(ndev);
 	return 0;
 }
 
@@ -1063,6 +1349,12 @@ static int axienet_change_mtu(struct net_device *ndev, int new_mtu)
 static void axienet_poll_controller(struct net_device *ndev)
 {
 	struct axienet_local *lp = netdev_priv(ndev);
+
+	if (lp->mcdma) {
+		axienet_mcdma_poll_controller(ndev);
+		return;
+	}
+
 	disable_irq(lp->tx_irq);
 	disable_irq(lp->rx_irq);
 	axienet_rx_irq(lp->tx_irq, ndev);
@@ -1072,6 +1364,26 @@ static void axienet_poll_controller(struct net_device *ndev)
 }
 #endif
 
+/**
+ * axienet_get_stats - Get the statistics of the device.
+ * @ndev:	Pointer to net_device structure
+ *
+ * Return: Pointer to the net_device_stats of the device
+ *
+ * With the Axi MCDMA every queue keeps its own counters, so that the NAPI
+ * contexts of different queues never update shared counters; they are
+ * summed up here.
+ */
+static struct net_device_stats *axienet_get_stats(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	if (lp->mcdma)
+		axienet_mcdma_get_stats(ndev);
+
+	return &ndev->stats;
+}
+
 /* Ioctl MII Interface */
 static int axienet_ioctl(struct net_device *dev, struct ifreq *rq, int cmd)
 {
@@ -1095,9 +1407,13 @@ static const struct net_device_ops axienet_netdev_ops = {
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = axienet_set_multicast_list,
 	.ndo_do_ioctl = axienet_ioctl,
+	.ndo_get_stats = axienet_get_stats,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller = axienet_poll_controller,
 #endif
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	.ndo_busy_poll = axienet_busy_poll,
+#endif
 };
 
 /**
@@ -1308,6 +1624,13 @@ static int axienet_ethtools_get_coalesce(struct net_device *ndev,
 {
 	u32 regval = 0;
 	struct axienet_local *lp = netdev_priv(ndev);
+
+	if (lp->mcdma) {
+		ecoalesce->rx_max_coalesced_frames = lp->coalesce_count_rx;
+		ecoalesce->tx_max_coalesced_frames = lp->coalesce_count_tx;
+		return 0;
+	}
+
 	regval = axienet_dma_in32(lp, XAXIDMA_RX_CR_OFFSET);
 	ecoalesce->rx_max_coalesced_frames = (regval & XAXIDMA_COALESCE_MASK)
 					     >> XAXIDMA_COALESCE_SHIFT;
@@ -1410,12 +1733,16 @@ static void axienet_dma_err_handler(unsigned long data)
 	axienet_iow(lp, XAE_MDIO_MC_OFFSET, (mdio_mcreg &
 		    ~XAE_MDIO_MC_MDIOEN_MASK));
 
-	__axienet_device_reset(lp, &ndev->dev, XAXIDMA_TX_CR_OFFSET);
-	__axienet_device_reset(lp, &ndev->dev, XAXIDMA_RX_CR_OFFSET);
+	axienet_dma_reset(lp, &ndev->dev);
 
 	axienet_iow(lp, XAE_MDIO_MC_OFFSET, mdio_mcreg);
 	axienet_mdio_wait_until_ready(lp);
 
+	if (lp->mcdma) {
+		axienet_mcdma_err_handler(ndev);
+		goto mac_init;
+	}
+
 	for (i = 0; i < TX_BD_NUM; i++) {
 		cur_p = &lp->tx_bd_v[i];
 		if (cur_p->phys)
@@ -1449,6 +1776,8 @@ static void axienet_dma_err_handler(unsigned long data)
 	lp->tx_bd_ci = 0;
 	lp->tx_bd_tail = 0;
 	lp->rx_bd_ci = 0;
+	lp->tx_kick_pending = false;
+	netdev_reset_queue(ndev);
 
 	/* Start updating the Rx channel control register */
 	cr = axienet_dma_in32(lp, XAXIDMA_RX_CR_OFFSET);
@@ -1495,6 +1824,7 @@ static void axienet_dma_err_handler(unsigned long data)
 	axienet_dma_out32(lp, XAXIDMA_TX_CR_OFFSET,
 			  cr | XAXIDMA_CR_RUNSTOP_MASK);
 
+mac_init:
 	axienet_status = axienet_ior(lp, XAE_RCW1_OFFSET);
 	axienet_status &= ~XAE_RCW1_RX_MASK;
 	axienet_iow(lp, XAE_RCW1_OFFSET, axienet_status);
@@ -1535,8 +1865,14 @@ static int axienet_probe(struct platform_device *pdev)
 	u8 mac_addr[6];
 	struct resource *ethres, dmares;
 	u32 value;
+	u32 num_queues = 1;
 
-	ndev = alloc_etherdev(sizeof(*lp));
+	/* Only used when the DMA node turns out to be an Axi MCDMA */
+	of_property_read_u32(pdev->dev.of_node, "xlnx,num-queues",
+			     &num_queues);
+	num_queues = clamp_t(u32, num_queues, 1, XAE_MAX_QUEUES);
+
+	ndev = alloc_etherdev_mq(sizeof(*lp), num_queues);
 	if (!ndev)
 		return -ENOMEM;
 
@@ -1545,6 +1881,7 @@ static int axienet_probe(struct platform_device *pdev)
 	SET_NETDEV_DEV(ndev, &pdev->dev);
 	ndev->flags &= ~IFF_MULTICAST;  /* clear multicast */
 	ndev->features = NETIF_F_SG;
+	ndev->priv_flags |= IFF_RX_EARLY_FILTER;
 	ndev->netdev_ops = &axienet_netdev_ops;
 	ndev->ethtool_ops = &axienet_ethtool_ops;
 
@@ -1552,6 +1889,8 @@ static int axienet_probe(struct platform_device *pdev)
 	lp->ndev = ndev;
 	lp->dev = &pdev->dev;
 	lp->options = XAE_OPTION_DEFAULTS;
+	netif_napi_add(ndev, &lp->napi, axienet_poll, NAPI_POLL_WEIGHT);
+	napi_hash_add(&lp->napi);
 	/* Map device registers */
 	ethres = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	lp->regs = devm_ioremap_resource(&pdev->dev, ethres);
@@ -1631,14 +1970,23 @@ static int axienet_probe(struct platform_device *pdev)
 		ret = PTR_ERR(lp->dma_regs);
 		goto free_netdev;
 	}
-	lp->rx_irq = irq_of_parse_and_map(np, 1);
-	lp->tx_irq = irq_of_parse_and_map(np, 0);
+	lp->mcdma = of_device_is_compatible(np, "xlnx,axi-mcdma-1.00.a");
+	lp->num_queues = lp->mcdma ? num_queues : 1;
+	netif_set_real_num_tx_queues(ndev, lp->num_queues);
+	netif_set_real_num_rx_queues(ndev, lp->num_queues);
+	if (lp->mcdma) {
+		ret = axienet_mcdma_probe(ndev, np);
+	} else {
+		lp->rx_irq = irq_of_parse_and_map(np, 1);
+		lp->tx_irq = irq_of_parse_and_map(np, 0);
+		if ((lp->rx_irq <= 0) || (lp->tx_irq <= 0)) {
+			dev_err(&pdev->dev, "could not determine irqs\n");
+			ret = -ENOMEM;
+		}
+	}
 	of_node_put(np);
-	if ((lp->rx_irq <= 0) || (lp->tx_irq <= 0)) {
-		dev_err(&pdev->dev, "could not determine irqs\n");
-		ret = -ENOMEM;
+	if (ret)
 		goto free_netdev;
-	}
 
 	/* Retrieve the MAC address */
 	ret = of_property_read_u8_array(pdev->dev.of_node,
@@ -1669,6 +2017,7 @@ static int axienet_probe(struct platform_device *pdev)
 	return 0;
 
 free_netdev:
+	napi_hash_del(&lp->napi);
 	free_netdev(ndev);
 
 	return ret;
@@ -1681,6 +2030,7 @@ static int axienet_remove(struct platform_device *pdev)
 
 	axienet_mdio_teardown(lp);
 	unregister_netdev(ndev);
+	napi_hash_del(&lp->napi);
 
 	of_node_put(lp->phy_node);
 	lp->phy_node = NULL;
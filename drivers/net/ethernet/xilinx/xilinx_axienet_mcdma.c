@@ -0,0 +1,811 @@
+/*
+ * Xilinx Axi Ethernet driver, Axi MCDMA support
+ *
+ * The Axi MCDMA core provides up to 16 MM2S and 16 S2MM channels behind a
+ * single register space. Each channel pair gets its own BD rings, IRQs and
+ * NAPI context and backs one netdev Tx/Rx queue. On transmit the queue is
+ * picked by the stack from the flow hash (and XPS), the MCDMA then
+ * arbitrates between the channels. On receive the channel is selected by
+ * the TDEST of the incoming stream, so frames of one flow stay on one
+ * queue and the per channel IRQs spread the receive load over the CPUs.
+ *
+ * The MCDMA has no status/control stream, so checksum offload is not
+ * available in this mode and the frame length is taken from the BD status.
+ */
+
+#include <linux/etherdevice.h>
+#include <linux/netdevice.h>
+#include <linux/of_irq.h>
+#include <linux/skbuff.h>
+
+#include "xilinx_axienet.h"
+
+/* A frame needs one BD for the linear part and one per fragment */
+#define AXIENET_MCDMA_TX_THRESH		(MAX_SKB_FRAGS + 1)
+
+/**
+ * axienet_mcdma_tx_free - Number of free BDs in the Tx ring of a queue
+ * @q:		Pointer to the queue
+ *
+ * Return: the number of BDs that can be handed to the hardware
+ */
+static inline u32 axienet_mcdma_tx_free(struct axienet_dma_q *q)
+{
+	return TX_BD_NUM - 1 -
+	       (q->tx_bd_tail + TX_BD_NUM - q->tx_bd_ci) % TX_BD_NUM;
+}
+
+/**
+ * axienet_mcdma_irq_enable - Unmask or mask the completion interrupts of a
+ *			      MCDMA channel.
+ * @lp:		Pointer to axienet local structure
+ * @offset:	Control register offset of the channel
+ * @enable:	true to unmask the interrupts, false to mask them
+ *
+ * Like for the Axi DMA, a cleared error interrupt enable means that error
+ * recovery is pending and the completion interrupts are left masked.
+ */
+static void axienet_mcdma_irq_enable(struct axienet_local *lp, off_t offset,
+				     bool enable)
+{
+	u32 cr;
+
+	cr = axienet_dma_in32(lp, offset);
+	if (!enable)
+		cr &= ~(XMCDMA_IRQ_IOC_MASK | XMCDMA_IRQ_DELAY_MASK);
+	else if (cr & XMCDMA_IRQ_ERROR_MASK)
+		cr |= XMCDMA_IRQ_IOC_MASK | XMCDMA_IRQ_DELAY_MASK;
+	axienet_dma_out32(lp, offset, cr);
+}
+
+/**
+ * axienet_mcdma_irq_disable_all - Mask all interrupts of all channels.
+ * @lp:		Pointer to axienet local structure
+ *
+ * Used when a DMA error is reported, the error tasklet reprograms the
+ * channels once the DMA has been reset.
+ */
+static void axienet_mcdma_irq_disable_all(struct axienet_local *lp)
+{
+	u32 cr;
+	int i;
+
+	for (i = 0; i < lp->num_queues; i++) {
+		cr = axienet_dma_in32(lp, XMCDMA_CHAN_CR_OFFSET(i));
+		axienet_dma_out32(lp, XMCDMA_CHAN_CR_OFFSET(i),
+				  cr & ~XMCDMA_IRQ_ALL_MASK);
+		cr = axienet_dma_in32(lp, XMCDMA_RX_OFFSET +
+				      XMCDMA_CHAN_CR_OFFSET(i));
+		axienet_dma_out32(lp, XMCDMA_RX_OFFSET +
+				  XMCDMA_CHAN_CR_OFFSET(i),
+				  cr & ~XMCDMA_IRQ_ALL_MASK);
+	}
+}
+
+/**
+ * axienet_mcdma_start - Start all MCDMA channels.
+ * @lp:		Pointer to axienet local structure
+ *
+ * Programs the current descriptor, interrupt coalescing and delay timer of
+ * every channel, enables the channels and starts both directions of the
+ * engine. Finally the Rx tail pointers are written, which makes the Rx
+ * side ready for reception.
+ */
+static void axienet_mcdma_start(struct axienet_local *lp)
+{
+	struct axienet_dma_q *q;
+	u32 cr, chen = 0;
+	int i;
+
+	for (i = 0; i < lp->num_queues; i++) {
+		q = &lp->dq[i];
+
+		axienet_dma_out32(lp, XMCDMA_CHAN_CDESC_OFFSET(i), q->tx_bd_p);
+		cr = (lp->coalesce_count_tx << XAXIDMA_COALESCE_SHIFT) |
+		     (XAXIDMA_DFT_TX_WAITBOUND << XAXIDMA_DELAY_SHIFT) |
+		     XMCDMA_IRQ_ALL_MASK | XMCDMA_CR_RUNSTOP_MASK;
+		axienet_dma_out32(lp, XMCDMA_CHAN_CR_OFFSET(i), cr);
+
+		axienet_dma_out32(lp, XMCDMA_RX_OFFSET +
+				  XMCDMA_CHAN_CDESC_OFFSET(i), q->rx_bd_p);
+		cr = (lp->coalesce_count_rx << XAXIDMA_COALESCE_SHIFT) |
+		     (XAXIDMA_DFT_RX_WAITBOUND << XAXIDMA_DELAY_SHIFT) |
+		     XMCDMA_IRQ_ALL_MASK | XMCDMA_CR_RUNSTOP_MASK;
+		axienet_dma_out32(lp, XMCDMA_RX_OFFSET +
+				  XMCDMA_CHAN_CR_OFFSET(i), cr);
+
+		chen |= BIT(i);
+	}
+
+	axienet_dma_out32(lp, XMCDMA_CHEN_OFFSET, chen);
+	axienet_dma_out32(lp, XMCDMA_RX_OFFSET + XMCDMA_CHEN_OFFSET, chen);
+
+	axienet_dma_out32(lp, XMCDMA_CCR_OFFSET, XMCDMA_CR_RUNSTOP_MASK);
+	axienet_dma_out32(lp, XMCDMA_RX_OFFSET + XMCDMA_CCR_OFFSET,
+			  XMCDMA_CR_RUNSTOP_MASK);
+
+	for (i = 0; i < lp->num_queues; i++) {
+		q = &lp->dq[i];
+		axienet_dma_out32(lp, XMCDMA_RX_OFFSET +
+				  XMCDMA_CHAN_TDESC_OFFSET(i),
+				  q->rx_bd_p +
+				  sizeof(*q->rx_bd_v) * (RX_BD_NUM - 1));
+	}
+}
+
+/**
+ * axienet_mcdma_stop - Stop both directions of the MCDMA engine.
+ * @ndev:	Pointer to the net_device structure
+ */
+void axienet_mcdma_stop(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	u32 cr;
+
+	cr = axienet_dma_in32(lp, XMCDMA_RX_OFFSET + XMCDMA_CCR_OFFSET);
+	axienet_dma_out32(lp, XMCDMA_RX_OFFSET + XMCDMA_CCR_OFFSET,
+			  cr & ~XMCDMA_CR_RUNSTOP_MASK);
+	cr = axienet_dma_in32(lp, XMCDMA_CCR_OFFSET);
+	axienet_dma_out32(lp, XMCDMA_CCR_OFFSET,
+			  cr & ~XMCDMA_CR_RUNSTOP_MASK);
+}
+
+/**
+ * axienet_mcdma_release_tx - Unmap and free the skbs still in a Tx ring.
+ * @ndev:	Pointer to the net_device structure
+ * @q:		Pointer to the queue
+ *
+ * Leaves all BDs of the ring cleared and the ring empty.
+ */
+static void axienet_mcdma_release_tx(struct net_device *ndev,
+				     struct axienet_dma_q *q)
+{
+	struct aximcdma_tx_bd *cur_p;
+	int i;
+
+	for (i = 0; i < TX_BD_NUM; i++) {
+		cur_p = &q->tx_bd_v[i];
+		if (cur_p->phys)
+			dma_unmap_single(ndev->dev.parent, cur_p->phys,
+					 cur_p->cntrl &
+					 XMCDMA_BD_CTRL_LENGTH_MASK,
+					 DMA_TO_DEVICE);
+		if (cur_p->sw_id_offset)
+			dev_kfree_skb_any((struct sk_buff *)
+					  cur_p->sw_id_offset);
+		cur_p->phys = 0;
+		cur_p->cntrl = 0;
+		cur_p->status = 0;
+		cur_p->sw_id_offset = 0;
+	}
+
+	q->tx_bd_ci = 0;
+	q->tx_bd_tail = 0;
+}
+
+/**
+ * axienet_mcdma_bd_release - Release the buffer descriptor rings of all
+ *			      queues.
+ * @ndev:	Pointer to the net_device structure
+ *
+ * Counterpart of axienet_mcdma_bd_init, also used to clean up after it
+ * failed half way.
+ */
+void axienet_mcdma_bd_release(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct axienet_dma_q *q;
+	int i, j;
+
+	for (i = 0; i < lp->num_queues; i++) {
+		q = &lp->dq[i];
+
+		if (q->rx_bd_v) {
+			for (j = 0; j < RX_BD_NUM; j++) {
+				if (!q->rx_bd_v[j].sw_id_offset)
+					continue;
+				dma_unmap_single(ndev->dev.parent,
+						 q->rx_bd_v[j].phys,
+						 lp->max_frm_size,
+						 DMA_FROM_DEVICE);
+				dev_kfree_skb((struct sk_buff *)
+					      q->rx_bd_v[j].sw_id_offset);
+			}
+			dma_free_coherent(ndev->dev.parent,
+					  sizeof(*q->rx_bd_v) * RX_BD_NUM,
+					  q->rx_bd_v, q->rx_bd_p);
+			q->rx_bd_v = NULL;
+		}
+
+		if (q->tx_bd_v) {
+			axienet_mcdma_release_tx(ndev, q);
+			dma_free_coherent(ndev->dev.parent,
+					  sizeof(*q->tx_bd_v) * TX_BD_NUM,
+					  q->tx_bd_v, q->tx_bd_p);
+			q->tx_bd_v = NULL;
+		}
+	}
+}
+
+/**
+ * axienet_mcdma_bd_init - Setup buffer descriptor rings for the Axi MCDMA
+ * @ndev:	Pointer to the net_device structure
+ *
+ * Return: 0, on success -ENOMEM, on failure
+ *
+ * Allocates and links the Tx and Rx BD rings of every queue, attaches a
+ * receive buffer to each Rx BD and starts the channels. This is the MCDMA
+ * counterpart of axienet_dma_bd_init.
+ */
+int axienet_mcdma_bd_init(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct axienet_dma_q *q;
+	struct sk_buff *skb;
+	int i, j;
+
+	for (i = 0; i < lp->num_queues; i++) {
+		q = &lp->dq[i];
+
+		q->tx_bd_ci = 0;
+		q->tx_bd_tail = 0;
+		q->rx_bd_ci = 0;
+
+		q->tx_bd_v = dma_zalloc_coherent(ndev->dev.parent,
+						 sizeof(*q->tx_bd_v) *
+						 TX_BD_NUM,
+						 &q->tx_bd_p, GFP_KERNEL);
+		if (!q->tx_bd_v)
+			goto out;
+
+		q->rx_bd_v = dma_zalloc_coherent(ndev->dev.parent,
+						 sizeof(*q->rx_bd_v) *
+						 RX_BD_NUM,
+						 &q->rx_bd_p, GFP_KERNEL);
+		if (!q->rx_bd_v)
+			goto out;
+
+		for (j = 0; j < TX_BD_NUM; j++)
+			q->tx_bd_v[j].next = q->tx_bd_p +
+					     sizeof(*q->tx_bd_v) *
+					     ((j + 1) % TX_BD_NUM);
+
+		for (j = 0; j < RX_BD_NUM; j++) {
+			q->rx_bd_v[j].next = q->rx_bd_p +
+					     sizeof(*q->rx_bd_v) *
+					     ((j + 1) % RX_BD_NUM);
+
+			skb = netdev_alloc_skb_ip_align(ndev,
+							lp->max_frm_size);
+			if (!skb)
+				goto out;
+
+			q->rx_bd_v[j].sw_id_offset = (u32) skb;
+			q->rx_bd_v[j].phys = dma_map_single(ndev->dev.parent,
+							    skb->data,
+							    lp->max_frm_size,
+							    DMA_FROM_DEVICE);
+			q->rx_bd_v[j].cntrl = lp->max_frm_size;
+		}
+	}
+
+	axienet_mcdma_start(lp);
+
+	return 0;
+out:
+	axienet_mcdma_bd_release(ndev);
+	return -ENOMEM;
+}
+
+/**
+ * axienet_mcdma_err_handler - Reinitialize the queues after a DMA error.
+ * @ndev:	Pointer to the net_device structure
+ *
+ * Called from axienet_dma_err_handler once the MCDMA has been reset. The
+ * frames still queued for transmission are dropped, the Rx BDs are handed
+ * back to the hardware with their buffers and the channels are restarted.
+ */
+void axienet_mcdma_err_handler(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct axienet_dma_q *q;
+	int i, j;
+
+	for (i = 0; i < lp->num_queues; i++) {
+		q = &lp->dq[i];
+
+		axienet_mcdma_release_tx(ndev, q);
+
+		for (j = 0; j < RX_BD_NUM; j++) {
+			q->rx_bd_v[j].cntrl = lp->max_frm_size;
+			q->rx_bd_v[j].status = 0;
+		}
+		q->rx_bd_ci = 0;
+	}
+
+	axienet_mcdma_start(lp);
+	netif_tx_wake_all_queues(ndev);
+}
+
+/**
+ * axienet_mcdma_start_xmit - Starts the transmission on a MCDMA channel.
+ * @skb:	sk_buff pointer that contains data to be Txed.
+ * @ndev:	Pointer to net_device structure.
+ *
+ * Return: NETDEV_TX_OK, on success
+ *	    NETDEV_TX_BUSY, if there are not enough free descriptors
+ *
+ * The frame is queued on the channel backing the netdev queue the stack
+ * picked for it. The queue is stopped while it cannot take a maximally
+ * fragmented frame, and woken again from the Tx completion.
+ */
+int axienet_mcdma_start_xmit(struct sk_buff *skb, struct net_device *ndev)
+{
+	u32 ii;
+	u32 num_frag;
+	skb_frag_t *frag;
+	dma_addr_t tail_p;
+	u16 map = skb_get_queue_mapping(skb);
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct netdev_queue *txq = netdev_get_tx_queue(ndev, map);
+	struct axienet_dma_q *q = &lp->dq[map];
+	struct aximcdma_tx_bd *cur_p;
+
+	num_frag = skb_shinfo(skb)->nr_frags;
+
+	if (axienet_mcdma_tx_free(q) < num_frag + 1) {
+		netif_tx_stop_queue(txq);
+		return NETDEV_TX_BUSY;
+	}
+
+	cur_p = &q->tx_bd_v[q->tx_bd_tail];
+	cur_p->cntrl = skb_headlen(skb) | XMCDMA_BD_CTRL_TXSOF_MASK;
+	cur_p->phys = dma_map_single(ndev->dev.parent, skb->data,
+				     skb_headlen(skb), DMA_TO_DEVICE);
+
+	for (ii = 0; ii < num_frag; ii++) {
+		++q->tx_bd_tail;
+		q->tx_bd_tail %= TX_BD_NUM;
+		cur_p = &q->tx_bd_v[q->tx_bd_tail];
+		frag = &skb_shinfo(skb)->frags[ii];
+		cur_p->phys = dma_map_single(ndev->dev.parent,
+					     skb_frag_address(frag),
+					     skb_frag_size(frag),
+					     DMA_TO_DEVICE);
+		cur_p->cntrl = skb_frag_size(frag);
+	}
+
+	cur_p->cntrl |= XMCDMA_BD_CTRL_TXEOF_MASK;
+	cur_p->sw_id_offset = (u32) skb;
+
+	tail_p = q->tx_bd_p + sizeof(*q->tx_bd_v) * q->tx_bd_tail;
+	/* Ensure BD write before starting transfer */
+	wmb();
+
+	/* Start the transfer */
+	axienet_dma_out32(lp, XMCDMA_CHAN_TDESC_OFFSET(q->chan_id), tail_p);
+	++q->tx_bd_tail;
+	q->tx_bd_tail %= TX_BD_NUM;
+
+	if (axienet_mcdma_tx_free(q) < AXIENET_MCDMA_TX_THRESH) {
+		netif_tx_stop_queue(txq);
+		/* Pairs with the barrier in axienet_mcdma_tx_done */
+		smp_mb();
+		if (axienet_mcdma_tx_free(q) >= AXIENET_MCDMA_TX_THRESH)
+			netif_tx_wake_queue(txq);
+	}
+
+	return NETDEV_TX_OK;
+}
+
+/**
+ * axienet_mcdma_tx_done - Reclaim the Tx BDs completed on a channel.
+ * @q:		Pointer to the queue
+ *
+ * Unmaps the buffers of the completed BDs, frees the transmitted skbs and
+ * wakes the netdev queue if it was stopped for lack of descriptors.
+ */
+static void axienet_mcdma_tx_done(struct axienet_dma_q *q)
+{
+	struct axienet_local *lp = q->lp;
+	struct net_device *ndev = lp->ndev;
+	struct netdev_queue *txq = netdev_get_tx_queue(ndev, q->chan_id);
+	struct aximcdma_tx_bd *cur_p;
+	u32 size = 0;
+	u32 packets = 0;
+
+	cur_p = &q->tx_bd_v[q->tx_bd_ci];
+	while (q->tx_bd_ci != q->tx_bd_tail &&
+	       (cur_p->status & XMCDMA_BD_STS_COMPLETE_MASK)) {
+		dma_unmap_single(ndev->dev.parent, cur_p->phys,
+				 cur_p->cntrl & XMCDMA_BD_CTRL_LENGTH_MASK,
+				 DMA_TO_DEVICE);
+		if (cur_p->sw_id_offset) {
+			dev_kfree_skb((struct sk_buff *)cur_p->sw_id_offset);
+			packets++;
+		}
+		size += cur_p->status & XMCDMA_BD_STS_ACTUAL_LEN_MASK;
+
+		cur_p->phys = 0;
+		cur_p->cntrl = 0;
+		cur_p->status = 0;
+		cur_p->sw_id_offset = 0;
+
+		++q->tx_bd_ci;
+		q->tx_bd_ci %= TX_BD_NUM;
+		cur_p = &q->tx_bd_v[q->tx_bd_ci];
+	}
+
+	if (!packets)
+		return;
+
+	q->tx_packets += packets;
+	q->tx_bytes += size;
+
+	/* Make the freed BDs visible before checking the queue state */
+	smp_mb();
+	if (netif_tx_queue_stopped(txq) &&
+	    axienet_mcdma_tx_free(q) >= AXIENET_MCDMA_TX_THRESH)
+		netif_tx_wake_queue(txq);
+}
+
+/**
+ * axienet_mcdma_recv - Process the Rx BDs completed on a channel.
+ * @q:		Pointer to the queue
+ * @budget:	Maximum number of frames that may be passed to the stack
+ *
+ * Return: the number of frames processed
+ *
+ * Same as axienet_recv, except that the frame length is taken from the BD
+ * status and the frame is tagged with the Rx queue it arrived on.
+ */
+static int axienet_mcdma_recv(struct axienet_dma_q *q, int budget)
+{
+	u32 length;
+	u32 size = 0;
+	u32 dropped = 0;
+	int packets = 0;
+	dma_addr_t tail_p = 0;
+	struct axienet_local *lp = q->lp;
+	struct net_device *ndev = lp->ndev;
+	struct sk_buff *skb, *new_skb;
+	struct aximcdma_rx_bd *cur_p;
+
+	cur_p = &q->rx_bd_v[q->rx_bd_ci];
+
+	while (packets < budget &&
+	       (cur_p->status & XMCDMA_BD_STS_COMPLETE_MASK)) {
+		/* Read the rest of the BD only after its status */
+		rmb();
+		tail_p = q->rx_bd_p + sizeof(*q->rx_bd_v) * q->rx_bd_ci;
+		skb = (struct sk_buff *) (cur_p->sw_id_offset);
+		length = cur_p->status & XMCDMA_BD_STS_ACTUAL_LEN_MASK;
+
+		dma_unmap_single(ndev->dev.parent, cur_p->phys,
+				 lp->max_frm_size,
+				 DMA_FROM_DEVICE);
+
+		new_skb = netdev_alloc_skb_ip_align(ndev, lp->max_frm_size);
+		if (!new_skb) {
+			/* Drop the frame and reuse its buffer */
+			dropped++;
+			new_skb = skb;
+			goto refill;
+		}
+
+		skb_put(skb, length);
+		skb->protocol = eth_type_trans(skb, ndev);
+		skb_record_rx_queue(skb, q->chan_id);
+
+		napi_gro_receive(&q->napi, skb);
+
+		size += length;
+
+refill:
+		packets++;
+
+		cur_p->phys = dma_map_single(ndev->dev.parent, new_skb->data,
+					     lp->max_frm_size,
+					     DMA_FROM_DEVICE);
+		cur_p->cntrl = lp->max_frm_size;
+		cur_p->status = 0;
+		cur_p->sw_id_offset = (u32) new_skb;
+
+		++q->rx_bd_ci;
+		q->rx_bd_ci %= RX_BD_NUM;
+		cur_p = &q->rx_bd_v[q->rx_bd_ci];
+	}
+
+	q->rx_packets += packets - dropped;
+	q->rx_dropped += dropped;
+	q->rx_bytes += size;
+
+	if (tail_p) {
+		/* Ensure BD writes before handing them back to the DMA */
+		wmb();
+		axienet_dma_out32(lp, XMCDMA_RX_OFFSET +
+				  XMCDMA_CHAN_TDESC_OFFSET(q->chan_id), tail_p);
+	}
+
+	return packets;
+}
+
+/**
+ * axienet_mcdma_poll - NAPI poll routine of a queue.
+ * @napi:	Pointer to the NAPI structure of the queue
+ * @budget:	Maximum number of Rx frames to process
+ *
+ * Return: the number of Rx frames processed
+ *
+ * Reclaims the completed Tx BDs and processes up to @budget Rx BDs of the
+ * channel pair, then unmasks its completion interrupts once both rings are
+ * drained.
+ */
+static int axienet_mcdma_poll(struct napi_struct *napi, int budget)
+{
+	struct axienet_dma_q *q = container_of(napi, struct axienet_dma_q,
+					       napi);
+	struct axienet_local *lp = q->lp;
+	int work_done;
+
+	axienet_mcdma_tx_done(q);
+	work_done = axienet_mcdma_recv(q, budget);
+
+	if (work_done < budget) {
+		napi_complete(napi);
+		axienet_mcdma_irq_enable(lp, XMCDMA_CHAN_CR_OFFSET(q->chan_id),
+					 true);
+		axienet_mcdma_irq_enable(lp, XMCDMA_RX_OFFSET +
+					 XMCDMA_CHAN_CR_OFFSET(q->chan_id),
+					 true);
+	}
+
+	return work_done;
+}
+
+/**
+ * axienet_mcdma_irq - Common part of the MM2S and S2MM channel Isrs.
+ * @q:		Pointer to the queue
+ * @offset:	Offset of the direction (0 or XMCDMA_RX_OFFSET)
+ *
+ * Return: IRQ_HANDLED if the channel raised an interrupt, IRQ_NONE
+ *	   otherwise.
+ *
+ * Completion interrupts mask the completion interrupts of both channels of
+ * the queue and schedule its NAPI context. Errors mask all interrupts and
+ * leave the recovery to the error tasklet.
+ */
+static irqreturn_t axienet_mcdma_irq(struct axienet_dma_q *q, off_t offset)
+{
+	struct axienet_local *lp = q->lp;
+	struct net_device *ndev = lp->ndev;
+	u32 status;
+
+	status = axienet_dma_in32(lp, offset +
+				  XMCDMA_CHAN_SR_OFFSET(q->chan_id));
+	if (!(status & XMCDMA_IRQ_ALL_MASK))
+		return IRQ_NONE;
+
+	axienet_dma_out32(lp, offset + XMCDMA_CHAN_SR_OFFSET(q->chan_id),
+			  status);
+
+	if (status & XMCDMA_IRQ_ERROR_MASK) {
+		dev_err(&ndev->dev, "MCDMA %s channel %d error 0x%x\n",
+			offset ? "Rx" : "Tx", q->chan_id, status);
+		axienet_mcdma_irq_disable_all(lp);
+		tasklet_schedule(&lp->dma_err_tasklet);
+		return IRQ_HANDLED;
+	}
+
+	if (napi_schedule_prep(&q->napi)) {
+		axienet_mcdma_irq_enable(lp, XMCDMA_CHAN_CR_OFFSET(q->chan_id),
+					 false);
+		axienet_mcdma_irq_enable(lp, XMCDMA_RX_OFFSET +
+					 XMCDMA_CHAN_CR_OFFSET(q->chan_id),
+					 false);
+		__napi_schedule(&q->napi);
+	}
+
+	return IRQ_HANDLED;
+}
+
+static irqreturn_t axienet_mcdma_tx_irq(int irq, void *_q)
+{
+	return axienet_mcdma_irq(_q, 0);
+}
+
+static irqreturn_t axienet_mcdma_rx_irq(int irq, void *_q)
+{
+	return axienet_mcdma_irq(_q, XMCDMA_RX_OFFSET);
+}
+
+/**
+ * __axienet_mcdma_free_irqs - Free the IRQs and disable NAPI of queues.
+ * @lp:		Pointer to axienet local structure
+ * @count:	Number of queues, starting at queue 0, to tear down
+ */
+static void __axienet_mcdma_free_irqs(struct axienet_local *lp, int count)
+{
+	struct axienet_dma_q *q;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		q = &lp->dq[i];
+
+		irq_set_affinity_hint(q->tx_irq, NULL);
+		irq_set_affinity_hint(q->rx_irq, NULL);
+		free_irq(q->tx_irq, q);
+		free_irq(q->rx_irq, q);
+		napi_disable(&q->napi);
+	}
+}
+
+/**
+ * axienet_mcdma_request_irqs - Enable NAPI and request the channel IRQs.
+ * @ndev:	Pointer to the net_device structure
+ *
+ * Return: 0, on success. Non-zero error value on failure.
+ *
+ * The queues are spread round robin over the online CPUs: both IRQs of a
+ * queue get an affinity hint for its CPU and the CPU transmits on the
+ * queue through XPS, so Tx completion and Rx of a queue stay on one CPU.
+ */
+int axienet_mcdma_request_irqs(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct axienet_dma_q *q;
+	int cpu = -1;
+	int i, ret;
+
+	for (i = 0; i < lp->num_queues; i++) {
+		q = &lp->dq[i];
+
+		snprintf(q->tx_irq_name, sizeof(q->tx_irq_name), "%s-tx%d",
+			 ndev->name, i);
+		snprintf(q->rx_irq_name, sizeof(q->rx_irq_name), "%s-rx%d",
+			 ndev->name, i);
+
+		napi_enable(&q->napi);
+
+		ret = request_irq(q->tx_irq, axienet_mcdma_tx_irq, 0,
+				  q->tx_irq_name, q);
+		if (ret)
+			goto err_tx_irq;
+		ret = request_irq(q->rx_irq, axienet_mcdma_rx_irq, 0,
+				  q->rx_irq_name, q);
+		if (ret)
+			goto err_rx_irq;
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+		irq_set_affinity_hint(q->tx_irq, cpumask_of(cpu));
+		irq_set_affinity_hint(q->rx_irq, cpumask_of(cpu));
+		netif_set_xps_queue(ndev, cpumask_of(cpu), i);
+	}
+
+	return 0;
+
+err_rx_irq:
+	free_irq(q->tx_irq, q);
+err_tx_irq:
+	napi_disable(&q->napi);
+	__axienet_mcdma_free_irqs(lp, i);
+	dev_err(lp->dev, "request_irq() failed\n");
+	return ret;
+}
+
+/**
+ * axienet_mcdma_free_irqs - Free the channel IRQs and disable NAPI.
+ * @ndev:	Pointer to the net_device structure
+ */
+void axienet_mcdma_free_irqs(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+
+	__axienet_mcdma_free_irqs(lp, lp->num_queues);
+}
+
+/**
+ * axienet_mcdma_get_stats - Fold the per queue counters into ndev->stats.
+ * @ndev:	Pointer to the net_device structure
+ */
+void axienet_mcdma_get_stats(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	unsigned long tx_packets = 0, tx_bytes = 0;
+	unsigned long rx_packets = 0, rx_bytes = 0, rx_dropped = 0;
+	struct axienet_dma_q *q;
+	int i;
+
+	for (i = 0; i < lp->num_queues; i++) {
+		q = &lp->dq[i];
+		tx_packets += q->tx_packets;
+		tx_bytes += q->tx_bytes;
+		rx_packets += q->rx_packets;
+		rx_bytes += q->rx_bytes;
+		rx_dropped += q->rx_dropped;
+	}
+
+	ndev->stats.tx_packets = tx_packets;
+	ndev->stats.tx_bytes = tx_bytes;
+	ndev->stats.rx_packets = rx_packets;
+	ndev->stats.rx_bytes = rx_bytes;
+	ndev->stats.rx_dropped = rx_dropped;
+}
+
+#ifdef CONFIG_NET_POLL_CONTROLLER
+/**
+ * axienet_mcdma_poll_controller - Run the channel Isrs with IRQs disabled.
+ * @ndev:	Pointer to net_device structure
+ */
+void axienet_mcdma_poll_controller(struct net_device *ndev)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct axienet_dma_q *q;
+	int i;
+
+	for (i = 0; i < lp->num_queues; i++) {
+		q = &lp->dq[i];
+		disable_irq(q->tx_irq);
+		disable_irq(q->rx_irq);
+		axienet_mcdma_tx_irq(q->tx_irq, q);
+		axienet_mcdma_rx_irq(q->rx_irq, q);
+		enable_irq(q->tx_irq);
+		enable_irq(q->rx_irq);
+	}
+}
+#endif
+
+/**
+ * axienet_mcdma_probe - Set up the queues of a MCDMA connected device.
+ * @ndev:	Pointer to the net_device structure
+ * @np:		Device node of the MCDMA core
+ *
+ * Return: 0, on success. Non-zero error value on failure.
+ *
+ * lp->num_queues channel pairs are used. The interrupts of the MCDMA node
+ * are the MM2S channel interrupts followed by the S2MM channel interrupts.
+ */
+int axienet_mcdma_probe(struct net_device *ndev, struct device_node *np)
+{
+	struct axienet_local *lp = netdev_priv(ndev);
+	struct axienet_dma_q *q;
+	int i;
+
+	lp->dq = devm_kcalloc(lp->dev, lp->num_queues, sizeof(*lp->dq),
+			      GFP_KERNEL);
+	if (!lp->dq)
+		return -ENOMEM;
+
+	for (i = 0; i < lp->num_queues; i++) {
+		q = &lp->dq[i];
+		q->lp = lp;
+		q->chan_id = i;
+		q->tx_irq = irq_of_parse_and_map(np, i);
+		q->rx_irq = irq_of_parse_and_map(np, lp->num_queues + i);
+		if ((q->tx_irq <= 0) || (q->rx_irq <= 0)) {
+			dev_err(lp->dev, "could not determine irqs of queue %d\n",
+				i);
+			return -ENOMEM;
+		}
+		netif_napi_add(ndev, &q->napi, axienet_mcdma_poll,
+			       NAPI_POLL_WEIGHT);
+	}
+
+	/* Without the status/control stream there is no checksum offload */
+	if (lp->features & (XAE_FEATURE_PARTIAL_TX_CSUM |
+			    XAE_FEATURE_FULL_TX_CSUM |
+			    XAE_FEATURE_PARTIAL_RX_CSUM |
+			    XAE_FEATURE_FULL_RX_CSUM))
+		dev_warn(lp->dev, "checksum offload not supported with MCDMA\n");
+	lp->features &= ~(XAE_FEATURE_PARTIAL_TX_CSUM |
+			  XAE_FEATURE_FULL_TX_CSUM |
+			  XAE_FEATURE_PARTIAL_RX_CSUM |
+			  XAE_FEATURE_FULL_RX_CSUM);
+	lp->csum_offload_on_tx_path = XAE_NO_CSUM_OFFLOAD;
+	lp->csum_offload_on_rx_path = XAE_NO_CSUM_OFFLOAD;
+	ndev->features &= ~NETIF_F_IP_CSUM;
+
+	return 0;
+}
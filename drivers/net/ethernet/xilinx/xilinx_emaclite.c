@@ -26,6 +26,7 @@
 #include <linux/of_net.h>
 #include <linux/phy.h>
 #include <linux/interrupt.h>
+#include <asm/unaligned.h>
 
 #define DRIVER_NAME "xilinx_emaclite"
 
@@ -103,12 +104,13 @@
 /**
  * struct net_local - Our private per device data
  * @ndev:		instance of the network device
+ * @napi:		NAPI context draining the Rx buffers
  * @tx_ping_pong:	indicates whether Tx Pong buffer is configured in HW
  * @rx_ping_pong:	indicates whether Rx Pong buffer is configured in HW
  * @next_tx_buf_to_use:	next Tx buffer to write to
  * @next_rx_buf_to_use:	next Rx buffer to read from
  * @base_addr:		base address of the Emaclite device
- * @reset_lock:		lock used for synchronization
+ * @reset_lock:		lock used for synchronization of the Tx path
  * @deferred_skb:	holds an skb (for transmission at a later time) when the
  *			Tx buffer is not free
  * @phy_dev:		pointer to the PHY device
@@ -121,6 +123,7 @@
 struct net_local {
 
 	struct net_device *ndev;
+	struct napi_struct napi;
 
 	bool tx_ping_pong;
 	bool rx_ping_pong;
@@ -195,103 +198,125 @@ static void xemaclite_disable_interrupts(struct net_local *drvdata)
 }
 
 /**
- * xemaclite_aligned_write - Write from 16-bit aligned to 32-bit aligned address
- * @src_ptr:	Void pointer to the 16-bit aligned source address
+ * xemaclite_enable_rx_interrupt - Enable the Rx interrupt of the device
+ * @drvdata:	Pointer to the Emaclite device private data
+ * @enable:	Whether to enable or disable the interrupt
+ *
+ * The Rx interrupt enable bit of the first buffer covers both Rx buffers. It
+ * is masked while the NAPI poll routine drains them.
+ */
+static void xemaclite_enable_rx_interrupt(struct net_local *drvdata,
+					  bool enable)
+{
+	u32 reg_data;
+
+	reg_data = __raw_readl(drvdata->base_addr + XEL_RSR_OFFSET);
+	if (enable)
+		reg_data |= XEL_RSR_RECV_IE_MASK;
+	else
+		reg_data &= ~XEL_RSR_RECV_IE_MASK;
+	__raw_writel(reg_data, drvdata->base_addr + XEL_RSR_OFFSET);
+}
+
+/**
+ * xemaclite_aligned_write - Write from any address to 32-bit aligned address
+ * @src_ptr:	Void pointer to the source address
  * @dest_ptr:	Pointer to the 32-bit aligned destination address
  * @length:	Number bytes to write from source to destination
  *
- * This function writes data from a 16-bit aligned buffer to a 32-bit aligned
- * address in the EmacLite device.
+ * This function writes data from a buffer of any alignment to a 32-bit
+ * aligned address in the EmacLite device. The device memory is only ever
+ * written a whole word at a time.
  */
 static void xemaclite_aligned_write(void *src_ptr, u32 *dest_ptr,
 				    unsigned length)
 {
+	u8 *from_u8_ptr = src_ptr;
+	u32 *to_u32_ptr = dest_ptr;
 	u32 align_buffer;
-	u32 *to_u32_ptr;
-	u16 *from_u16_ptr, *to_u16_ptr;
-
-	to_u32_ptr = dest_ptr;
-	from_u16_ptr = src_ptr;
-	align_buffer = 0;
-
-	for (; length > 3; length -= 4) {
-		to_u16_ptr = (u16 *)&align_buffer;
-		*to_u16_ptr++ = *from_u16_ptr++;
-		*to_u16_ptr++ = *from_u16_ptr++;
-
-		/* This barrier resolves occasional issues seen around
-		 * cases where the data is not properly flushed out
-		 * from the processor store buffers to the destination
-		 * memory locations.
-		 */
-		wmb();
 
-		/* Output a word */
-		*to_u32_ptr++ = align_buffer;
-	}
-	if (length) {
-		u8 *from_u8_ptr, *to_u8_ptr;
-
-		/* Set up to output the remaining data */
-		align_buffer = 0;
-		to_u8_ptr = (u8 *) &align_buffer;
-		from_u8_ptr = (u8 *) from_u16_ptr;
+	for (; length > 3; length -= 4, from_u8_ptr += 4)
+		*to_u32_ptr++ = get_unaligned((u32 *)from_u8_ptr);
 
+	if (length) {
 		/* Output the remaining data */
-		for (; length > 0; length--)
-			*to_u8_ptr++ = *from_u8_ptr++;
-
-		/* This barrier resolves occasional issues seen around
-		 * cases where the data is not properly flushed out
-		 * from the processor store buffers to the destination
-		 * memory locations.
-		 */
-		wmb();
+		align_buffer = 0;
+		memcpy(&align_buffer, from_u8_ptr, length);
 		*to_u32_ptr = align_buffer;
 	}
+
+	/* This barrier resolves occasional issues seen around
+	 * cases where the data is not properly flushed out
+	 * from the processor store buffers to the destination
+	 * memory locations before the buffer is handed to the
+	 * device.
+	 */
+	wmb();
 }
 
 /**
- * xemaclite_aligned_read - Read from 32-bit aligned to 16-bit aligned buffer
+ * xemaclite_aligned_read - Read from 32-bit aligned address to any buffer
  * @src_ptr:	Pointer to the 32-bit aligned source address
- * @dest_ptr:	Pointer to the 16-bit aligned destination address
+ * @dest_ptr:	Pointer to the destination address
  * @length:	Number bytes to read from source to destination
  *
  * This function reads data from a 32-bit aligned address in the EmacLite device
- * to a 16-bit aligned buffer.
+ * to a buffer of any alignment, a whole word at a time.
  */
 static void xemaclite_aligned_read(u32 *src_ptr, u8 *dest_ptr,
 				   unsigned length)
 {
-	u16 *to_u16_ptr, *from_u16_ptr;
-	u32 *from_u32_ptr;
+	u32 *from_u32_ptr = src_ptr;
 	u32 align_buffer;
 
-	from_u32_ptr = src_ptr;
-	to_u16_ptr = (u16 *) dest_ptr;
-
-	for (; length > 3; length -= 4) {
-		/* Copy each word into the temporary buffer */
-		align_buffer = *from_u32_ptr++;
-		from_u16_ptr = (u16 *)&align_buffer;
+	for (; length > 3; length -= 4, dest_ptr += 4)
+		put_unaligned(*from_u32_ptr++, (u32 *)dest_ptr);
 
-		/* Read data from source */
-		*to_u16_ptr++ = *from_u16_ptr++;
-		*to_u16_ptr++ = *from_u16_ptr++;
+	if (length) {
+		/* Read the remaining data */
+		align_buffer = *from_u32_ptr;
+		memcpy(dest_ptr, &align_buffer, length);
 	}
+}
 
-	if (length) {
-		u8 *to_u8_ptr, *from_u8_ptr;
+/**
+ * xemaclite_tx_buf_free - Check whether a Tx buffer is free
+ * @drvdata:	Pointer to the Emaclite device private data
+ *
+ * Return:	true if xemaclite_send_data() would find a free Tx buffer
+ */
+static bool xemaclite_tx_buf_free(struct net_local *drvdata)
+{
+	void __iomem *addr = drvdata->base_addr + drvdata->next_tx_buf_to_use;
+	u32 mask = XEL_TSR_XMIT_BUSY_MASK | XEL_TSR_XMIT_ACTIVE_MASK;
 
-		/* Set up to read the remaining data */
-		to_u8_ptr = (u8 *) to_u16_ptr;
-		align_buffer = *from_u32_ptr++;
-		from_u8_ptr = (u8 *) &align_buffer;
+	if (!(__raw_readl(addr + XEL_TSR_OFFSET) & mask))
+		return true;
 
-		/* Read the remaining data */
-		for (; length > 0; length--)
-			*to_u8_ptr = *from_u8_ptr;
-	}
+	if (!drvdata->tx_ping_pong)
+		return false;
+
+	addr = (void __iomem __force *)((u32 __force)addr ^ XEL_BUFFER_OFFSET);
+
+	return !(__raw_readl(addr + XEL_TSR_OFFSET) & mask);
+}
+
+/**
+ * xemaclite_rx_pending - Check whether a received frame is waiting
+ * @drvdata:	Pointer to the Emaclite device private data
+ *
+ * Return:	true if one of the Rx buffers holds a frame
+ */
+static bool xemaclite_rx_pending(struct net_local *drvdata)
+{
+	void __iomem *base_addr = drvdata->base_addr;
+
+	if (__raw_readl(base_addr + XEL_RSR_OFFSET) & XEL_RSR_RECV_DONE_MASK)
+		return true;
+
+	return drvdata->rx_ping_pong &&
+	       (__raw_readl(base_addr + XEL_BUFFER_OFFSET + XEL_RSR_OFFSET) &
+		XEL_RSR_RECV_DONE_MASK);
 }
 
 /**
@@ -547,38 +572,46 @@ static void xemaclite_tx_timeout(struct net_device *dev)
 /**
  * xemaclite_tx_handler - Interrupt handler for frames sent
  * @dev:	Pointer to the network device
+ * @completed:	Number of Tx buffers that completed
  *
  * This function updates the number of packets transmitted and handles the
- * deferred skb, if there is one.
+ * deferred skb, if there is one. Otherwise it restarts the queue stopped by
+ * xemaclite_send() once both buffers were in use.
  */
-static void xemaclite_tx_handler(struct net_device *dev)
+static void xemaclite_tx_handler(struct net_device *dev, int completed)
 {
 	struct net_local *lp = netdev_priv(dev);
 
-	dev->stats.tx_packets++;
+	dev->stats.tx_packets += completed;
+
+	spin_lock(&lp->reset_lock);
 	if (lp->deferred_skb) {
 		if (xemaclite_send_data(lp,
 					(u8 *) lp->deferred_skb->data,
-					lp->deferred_skb->len) != 0)
-			return;
-		else {
+					lp->deferred_skb->len) == 0) {
 			dev->stats.tx_bytes += lp->deferred_skb->len;
 			dev_kfree_skb_irq(lp->deferred_skb);
 			lp->deferred_skb = NULL;
 			dev->trans_start = jiffies; /* prevent tx timeout */
 			netif_wake_queue(dev);
 		}
+	} else if (netif_queue_stopped(dev)) {
+		netif_wake_queue(dev);
 	}
+	spin_unlock(&lp->reset_lock);
 }
 
 /**
- * xemaclite_rx_handler- Interrupt handler for frames received
+ * xemaclite_rx_handler- Handler for frames received
  * @dev:	Pointer to the network device
  *
  * This function allocates memory for a socket buffer, fills it with data
- * received and hands it over to the TCP/IP stack.
+ * received and hands it over to the TCP/IP stack. It is called from the NAPI
+ * poll routine.
+ *
+ * Return:	0 if a buffer was processed or -ENOMEM if no skb was available
  */
-static void xemaclite_rx_handler(struct net_device *dev)
+static int xemaclite_rx_handler(struct net_device *dev)
 {
 	struct net_local *lp = netdev_priv(dev);
 	struct sk_buff *skb;
@@ -591,7 +624,7 @@ static void xemaclite_rx_handler(struct net_device *dev)
 		/* Couldn't get memory. */
 		dev->stats.rx_dropped++;
 		dev_err(&lp->ndev->dev, "Could not allocate receive buffer\n");
-		return;
+		return -ENOMEM;
 	}
 
 	/*
@@ -609,8 +642,8 @@ static void xemaclite_rx_handler(struct net_device *dev)
 
 	if (!len) {
 		dev->stats.rx_errors++;
-		dev_kfree_skb_irq(skb);
-		return;
+		dev_kfree_skb(skb);
+		return 0;
 	}
 
 	skb_put(skb, len);	/* Tell the skb how much data we got */
@@ -622,7 +655,44 @@ static void xemaclite_rx_handler(struct net_device *dev)
 	dev->stats.rx_bytes += len;
 
 	if (!skb_defer_rx_timestamp(skb))
-		netif_rx(skb);	/* Send the packet upstream */
+		napi_gro_receive(&lp->napi, skb); /* Send the packet upstream */
+
+	return 0;
+}
+
+/**
+ * xemaclite_poll - NAPI poll routine
+ * @napi:	Pointer to the NAPI structure of the device
+ * @budget:	Maximum number of Rx frames to process
+ *
+ * Return:	the number of Rx frames processed
+ *
+ * Drains both Rx buffers, so that the second one is emptied without another
+ * interrupt, and unmasks the Rx interrupt once no frame is left.
+ */
+static int xemaclite_poll(struct napi_struct *napi, int budget)
+{
+	struct net_local *lp = container_of(napi, struct net_local, napi);
+	int work_done = 0;
+
+	while (work_done < budget && xemaclite_rx_pending(lp)) {
+		if (xemaclite_rx_handler(lp->ndev))
+			break;
+		work_done++;
+	}
+
+	if (work_done < budget) {
+		napi_complete(napi);
+		xemaclite_enable_rx_interrupt(lp, true);
+
+		/* A frame that arrived after the last check did not raise
+		 * an interrupt while it was masked.
+		 */
+		if (xemaclite_rx_pending(lp) && napi_reschedule(napi))
+			xemaclite_enable_rx_interrupt(lp, false);
+	}
+
+	return work_done;
 }
 
 /**
@@ -635,19 +705,17 @@ static void xemaclite_rx_handler(struct net_device *dev)
  */
 static irqreturn_t xemaclite_interrupt(int irq, void *dev_id)
 {
-	bool tx_complete = false;
+	int tx_complete = 0;
 	struct net_device *dev = dev_id;
 	struct net_local *lp = netdev_priv(dev);
 	void __iomem *base_addr = lp->base_addr;
 	u32 tx_status;
 
-	/* Check if there is Rx Data available */
-	if ((__raw_readl(base_addr + XEL_RSR_OFFSET) &
-			 XEL_RSR_RECV_DONE_MASK) ||
-	    (__raw_readl(base_addr + XEL_BUFFER_OFFSET + XEL_RSR_OFFSET)
-			 & XEL_RSR_RECV_DONE_MASK))
-
-		xemaclite_rx_handler(dev);
+	/* Check if there is Rx Data available, the poll routine drains it */
+	if (xemaclite_rx_pending(lp) && napi_schedule_prep(&lp->napi)) {
+		xemaclite_enable_rx_interrupt(lp, false);
+		__napi_schedule(&lp->napi);
+	}
 
 	/* Check if the Transmission for the first buffer is completed */
 	tx_status = __raw_readl(base_addr + XEL_TSR_OFFSET);
@@ -657,7 +725,7 @@ static irqreturn_t xemaclite_interrupt(int irq, void *dev_id)
 		tx_status &= ~XEL_TSR_XMIT_ACTIVE_MASK;
 		__raw_writel(tx_status, base_addr + XEL_TSR_OFFSET);
 
-		tx_complete = true;
+		tx_complete++;
 	}
 
 	/* Check if the Transmission for the second buffer is completed */
@@ -669,12 +737,12 @@ static irqreturn_t xemaclite_interrupt(int irq, void *dev_id)
 		__raw_writel(tx_status, base_addr + XEL_BUFFER_OFFSET +
 			     XEL_TSR_OFFSET);
 
-		tx_complete = true;
+		tx_complete++;
 	}
 
 	/* If there was a Tx interrupt, call the Tx Handler */
 	if (tx_complete != 0)
-		xemaclite_tx_handler(dev);
+		xemaclite_tx_handler(dev, tx_complete);
 
 	return IRQ_HANDLED;
 }
@@ -950,6 +1018,8 @@ static int xemaclite_open(struct net_device *dev)
 		return retval;
 	}
 
+	napi_enable(&lp->napi);
+
 	/* Enable Interrupts */
 	xemaclite_enable_interrupts(lp);
 
@@ -974,6 +1044,7 @@ static int xemaclite_close(struct net_device *dev)
 	netif_stop_queue(dev);
 	xemaclite_disable_interrupts(lp);
 	free_irq(dev->irq, dev);
+	napi_disable(&lp->napi);
 
 	if (lp->phy_dev)
 		phy_disconnect(lp->phy_dev);
@@ -1019,6 +1090,12 @@ static int xemaclite_send(struct sk_buff *orig_skb, struct net_device *dev)
 		spin_unlock_irqrestore(&lp->reset_lock, flags);
 		return 0;
 	}
+
+	/* Stop the queue while both buffers are in use rather than deferring
+	 * the next skb, the Tx completion restarts it.
+	 */
+	if (!xemaclite_tx_buf_free(lp))
+		netif_stop_queue(dev);
 	spin_unlock_irqrestore(&lp->reset_lock, flags);
 
 	skb_tx_timestamp(new_skb);
@@ -1155,6 +1232,8 @@ static int xemaclite_of_probe(struct platform_device *ofdev)
 	ndev->flags &= ~IFF_MULTICAST;
 	ndev->watchdog_timeo = TX_TIMEOUT;
 
+	netif_napi_add(ndev, &lp->napi, xemaclite_poll, NAPI_POLL_WEIGHT);
+
 	/* Finally, register the device */
 	rc = register_netdev(ndev);
 	if (rc) {
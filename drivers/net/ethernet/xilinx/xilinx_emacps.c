@@ -45,6 +45,21 @@
 #include <linux/of_mdio.h>
 #include <linux/timer.h>
 #include <linux/ptp_clock_kernel.h>
+#include <linux/ptp_classify.h>
+#include <linux/gpio/consumer.h>
+#include <linux/hrtimer.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/udp.h>
+#include <linux/if_vlan.h>
+#include <linux/tcp.h>
+#include <net/busy_poll.h>
+#include <net/tso.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/rtnetlink.h>
+#include <uapi/linux/xilinx-emacps.h>
+#include <soc/zynq/ocm.h>
 
 /************************** Constant Definitions *****************************/
 
@@ -77,6 +92,17 @@ MDC_DIV_64, MDC_DIV_96, MDC_DIV_128, MDC_DIV_224 };
 /* Number of receive buffer bytes as a unit, this is HW setup */
 #define XEMACPS_RX_BUF_UNIT		64
 
+/* RX buffers are carved out of pages, two per page. Each half holds the
+ * headroom needed by build_skb(), the buffer handed to the GEM and the
+ * skb_shared_info of the skb later built around it.
+ */
+#define XEMACPS_RX_PAGE_HALF		(PAGE_SIZE / 2)
+#define XEMACPS_RX_HEADROOM		NET_SKB_PAD
+#define XEMACPS_RX_TRUESIZE		XEMACPS_RX_PAGE_HALF
+
+/* Size of one frame slot of the zero-copy capture buffer */
+#define XEMACPS_CAP_SLOT_SIZE		2048
+
 /* Default SEND and RECV buffer descriptors (BD) numbers.
  * BD Space needed is (XEMACPS_SEND_BD_CNT+XEMACPS_RECV_BD_CNT)*8
  */
@@ -86,7 +112,18 @@ MDC_DIV_64, MDC_DIV_96, MDC_DIV_128, MDC_DIV_224 };
 #define XEMACPS_SEND_BD_CNT		256
 #define XEMACPS_RECV_BD_CNT		256
 
+/* Ring size limits accepted through ethtool -G */
+#define XEMACPS_MIN_BD_CNT		64
+#define XEMACPS_MAX_BD_CNT		4096
+
 #define XEMACPS_NAPI_WEIGHT		64
+#define XEMACPS_BUSY_POLL_BUDGET	4
+
+/* A TSO skb needs a header and at least one data BD per segment plus one
+ * BD per page fragment; keep the worst case within the TX ring.
+ */
+#define XEMACPS_TSO_HEADER_SIZE		128
+#define XEMACPS_TSO_MAX_SEGS(bdcnt)	(((bdcnt) - MAX_SKB_FRAGS - 1) / 2)
 
 /* Register offset definitions. Unless otherwise noted, register access is
  * 32 bit. Names are self explained here.
@@ -215,6 +252,8 @@ MDC_DIV_64, MDC_DIV_96, MDC_DIV_128, MDC_DIV_224 };
 #define XEMACPS_RXUDPCCNT_OFFSET	0x000001B0 /* UDP Checksum Error
 						Counter */
 
+#define XEMACPS_INTMOD_OFFSET		0x0000005C /* Interrupt moderation */
+
 #define XEMACPS_1588S_OFFSET		0x000001D0 /* 1588 Timer Seconds */
 #define XEMACPS_1588NS_OFFSET		0x000001D4 /* 1588 Timer Nanoseconds */
 #define XEMACPS_1588ADJ_OFFSET		0x000001D8 /* 1588 Timer Adjust */
@@ -275,6 +314,7 @@ MDC_DIV_64, MDC_DIV_96, MDC_DIV_128, MDC_DIV_224 };
 #define XEMACPS_NWCFG_LENGTHERRDSCRD_MASK 0x00010000
 /* RX length error discard */
 #define XEMACPS_NWCFG_RXOFFS_MASK	0x0000C000 /* RX buffer offset */
+#define XEMACPS_NWCFG_RXOFFS_SHIFT	14 /* Shift bits for RX offset */
 #define XEMACPS_NWCFG_PAUSEEN_MASK	0x00002000 /* Enable pause TX */
 #define XEMACPS_NWCFG_RETRYTESTEN_MASK	0x00001000 /* Retry test */
 #define XEMACPS_NWCFG_1000_MASK		0x00000400 /* Gigbit mode */
@@ -297,6 +337,22 @@ MDC_DIV_64, MDC_DIV_96, MDC_DIV_128, MDC_DIV_224 };
 #define XEMACPS_NWSR_MDIOIDLE_MASK	0x00000004 /* PHY management idle */
 #define XEMACPS_NWSR_MDIO_MASK		0x00000002 /* Status of mdio_in */
 
+/* interrupt moderation register bit definitions, in 800 ns units */
+#define XEMACPS_INTMOD_RX_MASK		0x000000FF /* RX moderation */
+#define XEMACPS_INTMOD_TX_MASK		0x00FF0000 /* TX moderation */
+#define XEMACPS_INTMOD_TX_SHIFT		16 /* Shift bits for TX */
+#define XEMACPS_INTMOD_UNIT_NS		800
+#define XEMACPS_INTMOD_MAX_USECS	((XEMACPS_INTMOD_RX_MASK * \
+					  XEMACPS_INTMOD_UNIT_NS) / 1000)
+
+/* Adaptive RX moderation: below the low rate interrupts are not delayed,
+ * above the high rate they are delayed by the maximum; in between the
+ * delay grows linearly with the packet rate.
+ */
+#define XEMACPS_ADAPT_RX_LOW_PPS	10000
+#define XEMACPS_ADAPT_RX_HIGH_PPS	100000
+#define XEMACPS_ADAPT_RX_MAX_USECS	100
+
 /* MAC address register word 1 mask */
 #define XEMACPS_LADDR_MACH_MASK		0x0000FFFF /* Address bits[47:32]
 						bit[31:0] are in BOTTOM */
@@ -447,6 +503,12 @@ MDC_DIV_64, MDC_DIV_96, MDC_DIV_128, MDC_DIV_224 };
 						matched */
 #define XEMACPS_RXBUF_IDFOUND_MASK	0x01000000 /* Type ID matched */
 #define XEMACPS_RXBUF_IDMATCH_MASK	0x00C00000 /* ID matched mask */
+#define XEMACPS_RXBUF_CSUM_MASK		0x00C00000 /* Checksum status, when
+							RX checksum offload is
+							enabled */
+#define XEMACPS_RXBUF_CSUM_SHIFT	22
+#define XEMACPS_RXBUF_CSUM_IP_TCP	0x2 /* IP and TCP checksums ok */
+#define XEMACPS_RXBUF_CSUM_IP_UDP	0x3 /* IP and UDP checksums ok */
 #define XEMACPS_RXBUF_VLAN_MASK		0x00200000 /* VLAN tagged */
 #define XEMACPS_RXBUF_PRI_MASK		0x00100000 /* Priority tagged */
 #define XEMACPS_RXBUF_VPRI_MASK		0x000E0000 /* Vlan priority */
@@ -470,13 +532,11 @@ MDC_DIV_64, MDC_DIV_96, MDC_DIV_128, MDC_DIV_224 };
 #ifdef CONFIG_XILINX_PS_EMAC_HWTSTAMP
 #define NS_PER_SEC			1000000000ULL /* Nanoseconds per
 							second */
-/* Sum of Ethernet, IP and UDP header length */
-#define XEMACPS_TX_PTPHDR_OFFSET	42
-#define XEMACPS_RX_PTPHDR_OFFSET	28 /* Sum of IP and UDP header length */
-#define XEMACPS_IP_PROTO_OFFSET		9  /* Protocol field offset */
-#define XEMACPS_UDP_PORT_OFFSET		22 /* UDP dst port offset */
-#define XEMACPS_PTP_EVENT_PORT_NUM	0x13F /* Transport port for ptp */
 #define XEMACPS_PTP_CC_MULT		(1 << 31)
+#define XEMACPS_PTP_MSG_PDELAY_REQ	2 /* first peer event message */
+#define XEMACPS_PTP_MSG_EVENT_MAX	3 /* last event message type */
+/* shorter periods would mostly show the latency of the edge timer */
+#define XEMACPS_PEROUT_MIN_PERIOD	200000
 #endif
 
 #define xemacps_read(base, reg)						\
@@ -488,6 +548,12 @@ struct ring_info {
 	struct sk_buff *skb;
 	dma_addr_t mapping;
 	size_t len;
+	/* RX only: page backing the slot and the half currently owned by
+	 * the GEM. For RX, len is the length of the last frame received
+	 * in the other half, i.e. what the stack may have dirtied there.
+	 */
+	struct page *page;
+	unsigned int page_offset;
 };
 
 /* DMA buffer descriptor structure. Each BD is two words */
@@ -514,12 +580,28 @@ struct net_local {
 	dma_addr_t rx_bd_dma; /* physical address */
 	dma_addr_t tx_bd_dma; /* physical address */
 
+	bool bd_rings_in_ocm; /* try to place the BD rings in OCM */
+	bool rx_bd_ocm; /* rx_bd was allocated from OCM */
+	bool tx_bd_ocm; /* tx_bd was allocated from OCM */
+
+	char *tso_hdrs; /* one TSO header slot per TX BD */
+	dma_addr_t tso_hdrs_dma; /* physical address */
+
 	u32 tx_bd_ci;
 	u32 tx_bd_tail;
 	u32 rx_bd_ci;
 
 	u32 tx_bd_freecnt;
 
+	u32 tx_ring_size; /* number of TX BDs */
+	u32 rx_ring_size; /* number of RX BDs */
+
+	u32 tx_coalesce_usecs;
+	u32 rx_coalesce_usecs;
+	bool rx_adaptive; /* rx_coalesce_usecs follows the RX rate */
+	unsigned long adapt_rx_packets; /* rx_packets at last adaptation */
+	unsigned long adapt_jiffies; /* time of last adaptation */
+
 	spinlock_t tx_lock;
 	spinlock_t rx_lock;
 	spinlock_t nwctrlreg_lock;
@@ -532,6 +614,9 @@ struct net_local {
 	struct work_struct txtimeout_reinit;
 
 	struct napi_struct napi; /* napi information for device */
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	atomic_t bp_state; /* RX ring owner, NAPI or a busy polling socket */
+#endif
 	struct net_device_stats stats; /* Statistics for this device */
 
 	struct timer_list gen_purpose_timer; /* Used for stats update */
@@ -543,12 +628,21 @@ struct net_local {
 	unsigned int link;
 	unsigned int speed;
 	unsigned int duplex;
-	/* RX ip/tcp/udp checksum */
-	unsigned ip_summed;
 	unsigned int enetnum;
 	unsigned int lastrxfrmscntr;
 	unsigned int has_mdio;
 	bool timerready;
+#ifdef CONFIG_XILINX_PS_EMAC_CAPTURE
+	struct miscdevice cap_misc;
+	char cap_name[16];
+	unsigned long cap_busy; /* capture device opened */
+	struct xemacps_cap_ring *cap_ring; /* non-NULL in capture mode */
+	dma_addr_t cap_dma; /* physical address */
+	size_t cap_size;
+	u32 cap_head; /* frames published to user space */
+	u32 cap_rearm; /* slots given back to the GEM */
+	wait_queue_head_t cap_wait;
+#endif
 #ifdef CONFIG_XILINX_PS_EMAC_HWTSTAMP
 	struct hwtstamp_config hwtstamp_config;
 	struct ptp_clock *ptp_clock;
@@ -559,6 +653,13 @@ struct net_local {
 	struct cyclecounter cc;
 	struct timecounter tc;
 	struct timer_list time_keep;
+	struct gpio_desc *extts_gpio; /* external timestamp input */
+	int extts_irq; /* requested while the channel is enabled */
+	struct gpio_desc *perout_gpio; /* periodic output */
+	struct hrtimer perout_timer;
+	u64 perout_next; /* PHC time of the next edge */
+	u64 perout_half; /* half period in ns, 0 when disabled */
+	int perout_level; /* level at the next edge */
 #endif
 };
 #define to_net_local(_nb)	container_of(_nb, struct net_local,\
@@ -566,6 +667,107 @@ struct net_local {
 
 static struct net_device_ops netdev_ops;
 
+#ifdef CONFIG_XILINX_PS_EMAC_CAPTURE
+static inline bool xemacps_cap_active(struct net_local *lp)
+{
+	return lp->cap_ring != NULL;
+}
+#else
+static inline bool xemacps_cap_active(struct net_local *lp)
+{
+	return false;
+}
+#endif
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+enum xemacps_bp_state {
+	XEMACPS_BP_STATE_IDLE = 0,
+	XEMACPS_BP_STATE_NAPI,
+	XEMACPS_BP_STATE_POLL,
+	XEMACPS_BP_STATE_DISABLE
+};
+
+static inline void xemacps_bp_init_lock(struct net_local *lp)
+{
+	atomic_set(&lp->bp_state, XEMACPS_BP_STATE_IDLE);
+}
+
+/* called from the NAPI poll routine to get ownership of the RX ring */
+static inline bool xemacps_bp_lock_napi(struct net_local *lp)
+{
+	return atomic_cmpxchg(&lp->bp_state, XEMACPS_BP_STATE_IDLE,
+			      XEMACPS_BP_STATE_NAPI) == XEMACPS_BP_STATE_IDLE;
+}
+
+static inline void xemacps_bp_unlock_napi(struct net_local *lp)
+{
+	WARN_ON(atomic_read(&lp->bp_state) != XEMACPS_BP_STATE_NAPI);
+
+	/* flush any outstanding Rx frames */
+	if (lp->napi.gro_list)
+		napi_gro_flush(&lp->napi, false);
+
+	atomic_set(&lp->bp_state, XEMACPS_BP_STATE_IDLE);
+}
+
+/* called from xemacps_busy_poll() */
+static inline bool xemacps_bp_lock_poll(struct net_local *lp)
+{
+	return atomic_cmpxchg(&lp->bp_state, XEMACPS_BP_STATE_IDLE,
+			      XEMACPS_BP_STATE_POLL) == XEMACPS_BP_STATE_IDLE;
+}
+
+static inline void xemacps_bp_unlock_poll(struct net_local *lp)
+{
+	WARN_ON(atomic_read(&lp->bp_state) != XEMACPS_BP_STATE_POLL);
+
+	atomic_set(&lp->bp_state, XEMACPS_BP_STATE_IDLE);
+}
+
+/* true if a socket is polling the RX ring */
+static inline bool xemacps_bp_busy_polling(struct net_local *lp)
+{
+	return atomic_read(&lp->bp_state) == XEMACPS_BP_STATE_POLL;
+}
+
+/* false if the RX ring is currently owned */
+static inline bool xemacps_bp_disable(struct net_local *lp)
+{
+	int rc = atomic_cmpxchg(&lp->bp_state, XEMACPS_BP_STATE_IDLE,
+				XEMACPS_BP_STATE_DISABLE);
+
+	return rc == XEMACPS_BP_STATE_IDLE;
+}
+#else
+static inline void xemacps_bp_init_lock(struct net_local *lp)
+{
+}
+
+static inline bool xemacps_bp_lock_napi(struct net_local *lp)
+{
+	return true;
+}
+
+static inline void xemacps_bp_unlock_napi(struct net_local *lp)
+{
+}
+
+static inline bool xemacps_bp_busy_polling(struct net_local *lp)
+{
+	return false;
+}
+
+static inline bool xemacps_bp_disable(struct net_local *lp)
+{
+	return true;
+}
+#endif /* CONFIG_NET_RX_BUSY_POLL */
+
+#define XEMACPS_IS_TSO_HEADER(lp, addr) \
+	((addr) >= (lp)->tso_hdrs_dma && \
+	 (addr) < (lp)->tso_hdrs_dma + \
+		  (lp)->tx_ring_size * XEMACPS_TSO_HEADER_SIZE)
+
 /**
  * xemacps_mdio_wait - Wait for the MDIO to be ready to use
  * @lp:		Pointer to the Emacps device private data
@@ -849,6 +1051,9 @@ static int xemacps_mii_probe(struct net_device *ndev)
 		"GEM: phydev %p, phydev->phy_id 0x%x, phydev->addr 0x%x\n",
 		phydev, phydev->phy_id, phydev->addr);
 
+	/* Autonegotiation must not hold up the rest of the resume list */
+	device_enable_async_suspend(&phydev->dev);
+
 	phydev->supported &= (PHY_GBIT_FEATURES | SUPPORTED_Pause |
 							SUPPORTED_Asym_Pause);
 	phydev->advertising = phydev->supported;
@@ -914,6 +1119,7 @@ static int xemacps_mii_init(struct net_local *lp)
 	if (lp->phy_node) {
 		if (of_mdiobus_register(lp->mii_bus, np))
 			goto err_out_free_mdio_irq;
+		device_enable_async_suspend(&lp->mii_bus->dev);
 	}
 
 	return 0;
@@ -1102,6 +1308,54 @@ static void xemacps_systim_to_hwtstamp(struct net_local *lp,
 	shhwtstamps->hwtstamp = ns_to_ktime(ns);
 }
 
+/**
+ * xemacps_ptp_msg_type - Classify a frame the GEM may have time stamped
+ * @skb: Pointer to the socket buffer, data starting at the MAC header
+ * Return: PTP message type of an event frame, negative for other frames
+ *
+ * The GEM time stamps PTP event frames over Ethernet, UDP/IPv4 and
+ * UDP/IPv6, but does not say so in the buffer descriptors.
+ */
+static int xemacps_ptp_msg_type(struct sk_buff *skb)
+{
+	unsigned int type = ptp_classify_raw(skb);
+	unsigned int offset = ETH_HLEN;
+	struct iphdr _iph;
+	const struct iphdr *iph;
+	u8 _msg;
+	const u8 *msg;
+
+	if (type == PTP_CLASS_NONE)
+		return -1;
+	if (type & PTP_CLASS_VLAN)
+		offset += VLAN_HLEN;
+
+	switch (type & PTP_CLASS_PMASK) {
+	case PTP_CLASS_IPV4:
+		iph = skb_header_pointer(skb, offset, sizeof(_iph), &_iph);
+		if (!iph)
+			return -1;
+		offset += iph->ihl * 4 + sizeof(struct udphdr);
+		break;
+	case PTP_CLASS_IPV6:
+		offset += sizeof(struct ipv6hdr) + sizeof(struct udphdr);
+		break;
+	case PTP_CLASS_L2:
+		break;
+	default:
+		return -1;
+	}
+
+	/* version 1 has no peer delay messages */
+	if ((type & PTP_CLASS_VMASK) == PTP_CLASS_V1)
+		return 0;
+
+	msg = skb_header_pointer(skb, offset, sizeof(_msg), &_msg);
+	if (!msg || (*msg & 0x0f) > XEMACPS_PTP_MSG_EVENT_MAX)
+		return -1;
+	return *msg & 0x0f;
+}
+
 /**
  * xemacps_rx_hwtstamp - Read rx timestamp from hw and update it to the skbuff
  * @lp: Local device instance pointer
@@ -1155,17 +1409,183 @@ static void xemacps_tx_hwtstamp(struct net_local *lp,
 	skb_tstamp_tx(skb, skb_hwtstamps(skb));
 }
 
+/**
+ * xemacps_ptp_now - Read the current PTP clock time
+ * @lp: Local device instance pointer
+ * Return: PTP clock time in nano seconds
+ */
+static u64 xemacps_ptp_now(struct net_local *lp)
+{
+	unsigned long flags;
+	u64 ns;
+
+	spin_lock_irqsave(&lp->tmreg_lock, flags);
+	ns = timecounter_read(&lp->tc);
+	spin_unlock_irqrestore(&lp->tmreg_lock, flags);
+
+	return ns;
+}
+
+/**
+ * xemacps_extts_irq - Time stamp an edge on the external timestamp input
+ * @irq: Interrupt number of the GPIO
+ * @dev_id: Local device instance pointer
+ * Return: IRQ_HANDLED
+ */
+static irqreturn_t xemacps_extts_irq(int irq, void *dev_id)
+{
+	struct net_local *lp = dev_id;
+	struct ptp_clock_event event;
+
+	event.type = PTP_CLOCK_EXTTS;
+	event.index = 0;
+	event.timestamp = xemacps_ptp_now(lp);
+	ptp_clock_event(lp->ptp_clock, &event);
+
+	return IRQ_HANDLED;
+}
+
+/**
+ * xemacps_perout_timer - Drive the next edge of the periodic output
+ * @timer: Periodic output timer
+ * Return: HRTIMER_RESTART while the output is enabled
+ *
+ * The GEM has no compare unit, so the edges are placed by a high
+ * resolution timer re-armed against the PTP clock on every edge; they
+ * follow the PTP clock with interrupt latency jitter.
+ */
+static enum hrtimer_restart xemacps_perout_timer(struct hrtimer *timer)
+{
+	struct net_local *lp = container_of(timer, struct net_local,
+					    perout_timer);
+	u64 now;
+
+	if (!lp->perout_half)
+		return HRTIMER_NORESTART;
+
+	now = xemacps_ptp_now(lp);
+	if ((s64)(lp->perout_next - now) <= 0) {
+		u64 period = 2 * lp->perout_half;
+
+		gpiod_set_value(lp->perout_gpio, lp->perout_level);
+		lp->perout_level = !lp->perout_level;
+		lp->perout_next += lp->perout_half;
+		/* skip the edges missed after a clock step */
+		if ((s64)(lp->perout_next - now) <= 0)
+			lp->perout_next += (div64_u64(now - lp->perout_next,
+						      period) + 1) * period;
+	}
+
+	hrtimer_forward_now(timer, ns_to_ktime(lp->perout_next - now));
+	return HRTIMER_RESTART;
+}
+
+/**
+ * xemacps_ptp_extts - Enable or disable the external timestamp input
+ * @lp: Local device instance pointer
+ * @rq: External timestamp request
+ * @on: Whether to enable or disable the input
+ * Return: 0 on success, negative value if error
+ */
+static int xemacps_ptp_extts(struct net_local *lp,
+			     struct ptp_extts_request *rq, int on)
+{
+	unsigned long trigger = 0;
+	int irq, rc;
+
+	if (rq->index != 0)
+		return -EINVAL;
+
+	if (lp->extts_irq) {
+		free_irq(lp->extts_irq, lp);
+		lp->extts_irq = 0;
+	}
+	if (!on)
+		return 0;
+
+	irq = gpiod_to_irq(lp->extts_gpio);
+	if (irq < 0)
+		return irq;
+
+	if (rq->flags & PTP_RISING_EDGE)
+		trigger |= IRQF_TRIGGER_RISING;
+	if (rq->flags & PTP_FALLING_EDGE)
+		trigger |= IRQF_TRIGGER_FALLING;
+	if (!trigger)
+		trigger = IRQF_TRIGGER_RISING;
+
+	rc = request_irq(irq, xemacps_extts_irq, trigger, "xemacps extts", lp);
+	if (rc)
+		return rc;
+
+	lp->extts_irq = irq;
+	return 0;
+}
+
+/**
+ * xemacps_ptp_perout - Enable or disable the periodic output
+ * @lp: Local device instance pointer
+ * @rq: Periodic output request
+ * @on: Whether to enable or disable the output
+ * Return: 0 on success, negative value if error
+ */
+static int xemacps_ptp_perout(struct net_local *lp,
+			      struct ptp_perout_request *rq, int on)
+{
+	u64 start, period, now;
+
+	if (rq->index != 0)
+		return -EINVAL;
+
+	hrtimer_cancel(&lp->perout_timer);
+	lp->perout_half = 0;
+	gpiod_set_value(lp->perout_gpio, 0);
+	if (!on)
+		return 0;
+
+	period = rq->period.sec * NS_PER_SEC + rq->period.nsec;
+	start = rq->start.sec * NS_PER_SEC + rq->start.nsec;
+	if (period < XEMACPS_PEROUT_MIN_PERIOD)
+		return -EINVAL;
+
+	now = xemacps_ptp_now(lp);
+	/* a start in the past begins at the next period boundary */
+	if ((s64)(start - now) <= 0)
+		start += (div64_u64(now - start, period) + 1) * period;
+
+	lp->perout_half = div_u64(period, 2);
+	lp->perout_next = start;
+	lp->perout_level = 1;
+	hrtimer_start(&lp->perout_timer, ns_to_ktime(start - now),
+		      HRTIMER_MODE_REL);
+
+	return 0;
+}
+
 /**
  * xemacps_ptp_enable - Select the mode of operation
  * @ptp: PTP clock structure
  * @rq: Requested feature to change
  * @on: Whether to enable or disable the feature
- * Return: Always returns EOPNOTSUPP
+ * Return: 0 on success, negative value if error
  */
 static int xemacps_ptp_enable(struct ptp_clock_info *ptp,
 			      struct ptp_clock_request *rq, int on)
 {
-	return -EOPNOTSUPP;
+	struct net_local *lp = container_of(ptp, struct net_local, ptp_caps);
+
+	switch (rq->type) {
+	case PTP_CLK_REQ_EXTTS:
+		if (!lp->extts_gpio)
+			return -EOPNOTSUPP;
+		return xemacps_ptp_extts(lp, &rq->extts, on);
+	case PTP_CLK_REQ_PEROUT:
+		if (!lp->perout_gpio)
+			return -EOPNOTSUPP;
+		return xemacps_ptp_perout(lp, &rq->perout, on);
+	default:
+		return -EOPNOTSUPP;
+	}
 }
 
 /**
@@ -1267,6 +1687,40 @@ static int xemacps_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
 	return 0;
 }
 
+/**
+ * xemacps_ptp_get_gpios - Look up the PTP clock pins of the device tree
+ * @lp: Local device instance pointer
+ * Return: 0 on success, negative value if error
+ *
+ * "ptp-extts-gpios" and "ptp-perout-gpios" name an optional external
+ * timestamp input and periodic output that are both served from
+ * interrupt context, so they must not sleep.
+ */
+static int xemacps_ptp_get_gpios(struct net_local *lp)
+{
+	struct device *dev = &lp->pdev->dev;
+
+	lp->extts_gpio = devm_gpiod_get_optional(dev, "ptp-extts", GPIOD_IN);
+	if (IS_ERR(lp->extts_gpio))
+		return PTR_ERR(lp->extts_gpio);
+
+	lp->perout_gpio = devm_gpiod_get_optional(dev, "ptp-perout",
+						  GPIOD_OUT_LOW);
+	if (IS_ERR(lp->perout_gpio))
+		return PTR_ERR(lp->perout_gpio);
+
+	if ((lp->extts_gpio && gpiod_cansleep(lp->extts_gpio)) ||
+	    (lp->perout_gpio && gpiod_cansleep(lp->perout_gpio))) {
+		dev_err(dev, "PTP pins must not sleep\n");
+		return -EINVAL;
+	}
+
+	hrtimer_init(&lp->perout_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	lp->perout_timer.function = xemacps_perout_timer;
+
+	return 0;
+}
+
 /**
  * xemacps_ptp_init - Initialize the clock and register with ptp sub system
  * @lp: Local device instance pointer
@@ -1280,8 +1734,8 @@ static void xemacps_ptp_init(struct net_local *lp)
 	lp->ptp_caps.owner = THIS_MODULE;
 	snprintf(lp->ptp_caps.name, 16, "zynq ptp");
 	lp->ptp_caps.n_alarm = 0;
-	lp->ptp_caps.n_ext_ts = 0;
-	lp->ptp_caps.n_per_out = 0;
+	lp->ptp_caps.n_ext_ts = lp->extts_gpio ? 1 : 0;
+	lp->ptp_caps.n_per_out = lp->perout_gpio ? 1 : 0;
 	lp->ptp_caps.pps = 0;
 	lp->ptp_caps.adjfreq = xemacps_ptp_adjfreq;
 	lp->ptp_caps.adjtime = xemacps_ptp_adjtime;
@@ -1332,6 +1786,12 @@ static void xemacps_ptp_close(struct net_local *lp)
 	xemacps_write(lp->baseaddr, XEMACPS_1588INC_OFFSET, 0x0);
 
 	del_timer(&lp->time_keep);
+	hrtimer_cancel(&lp->perout_timer);
+	lp->perout_half = 0;
+	if (lp->extts_irq) {
+		free_irq(lp->extts_irq, lp);
+		lp->extts_irq = 0;
+	}
 	ptp_clock_unregister(lp->ptp_clock);
 
 	/* Initialize hwstamp config */
@@ -1340,6 +1800,174 @@ static void xemacps_ptp_close(struct net_local *lp)
 }
 #endif /* CONFIG_XILINX_PS_EMAC_HWTSTAMP */
 
+/**
+ * xemacps_rx_buf_dma - DMA address of the RX buffer owned by the GEM
+ * @rp: RX ring slot
+ * Return: bus address to program into the RX BD
+ */
+static inline u32 xemacps_rx_buf_dma(struct ring_info *rp)
+{
+	return rp->mapping + rp->page_offset + XEMACPS_RX_HEADROOM;
+}
+
+/**
+ * xemacps_alloc_rx_page - Allocate and map a new page for a RX ring slot
+ * @lp: local device instance pointer
+ * @rp: RX ring slot to populate
+ * @gfp: allocation flags
+ * Return: 0 on success, -ENOMEM if no page or mapping is available
+ *
+ * The whole page is mapped once and stays mapped for as long as the
+ * driver keeps recycling it; only the received bytes are synced later.
+ */
+static int xemacps_alloc_rx_page(struct net_local *lp, struct ring_info *rp,
+				 gfp_t gfp)
+{
+	struct page *page;
+	dma_addr_t mapping;
+
+	page = __skb_alloc_page(gfp, NULL);
+	if (!page)
+		return -ENOMEM;
+
+	mapping = dma_map_single(lp->ndev->dev.parent, page_address(page),
+				 PAGE_SIZE, DMA_FROM_DEVICE);
+	if (dma_mapping_error(lp->ndev->dev.parent, mapping)) {
+		__free_page(page);
+		return -ENOMEM;
+	}
+
+	rp->page = page;
+	rp->page_offset = 0;
+	rp->mapping = mapping;
+	rp->len = 0;
+
+	return 0;
+}
+
+/**
+ * xemacps_unmap_rx_page - Release the driver's mapping of a RX page
+ * @lp: local device instance pointer
+ * @rp: RX ring slot
+ *
+ * The other half of the page may still be in use by the stack, so the
+ * unmap must not touch the CPU caches; the half just received has already
+ * been synced for the CPU.
+ */
+static void xemacps_unmap_rx_page(struct net_local *lp, struct ring_info *rp)
+{
+	DEFINE_DMA_ATTRS(attrs);
+
+	dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+	dma_unmap_single_attrs(lp->ndev->dev.parent, rp->mapping, PAGE_SIZE,
+			       DMA_FROM_DEVICE, &attrs);
+	rp->page = NULL;
+	rp->mapping = 0;
+}
+
+/**
+ * xemacps_rx_page_reusable - Check whether a RX page can be flipped
+ * @page: page backing a RX ring slot
+ * Return: true if the driver holds the only reference to a local page
+ */
+static inline bool xemacps_rx_page_reusable(struct page *page)
+{
+	if (unlikely(page->pfmemalloc))
+		return false;
+
+	if (unlikely(page_to_nid(page) != numa_node_id()))
+		return false;
+
+	return page_count(page) == 1;
+}
+
+/**
+ * xemacps_rx_build_skb - Wrap a received buffer into an skb
+ * @lp: local device instance pointer
+ * @rp: RX ring slot the frame was received into
+ * @len: frame length reported by the GEM
+ * Return: the skb, or NULL if the frame has to be dropped
+ *
+ * In the steady state the page is flipped: the stack gets the half that
+ * was just received while the GEM is given the other half of the same,
+ * still mapped page. A new page is only allocated while the stack still
+ * holds the other half. On failure the slot is left untouched so the
+ * buffer can be handed straight back to the hardware. The caller has
+ * already made the frame visible to the CPU.
+ */
+static struct sk_buff *xemacps_rx_build_skb(struct net_local *lp,
+					    struct ring_info *rp, u32 len)
+{
+	struct device *dev = lp->ndev->dev.parent;
+	struct ring_info old = *rp;
+	bool reuse;
+	struct sk_buff *skb;
+
+	reuse = xemacps_rx_page_reusable(old.page);
+	if (!reuse && xemacps_alloc_rx_page(lp, rp, GFP_ATOMIC))
+		return NULL;
+
+	skb = napi_build_skb(page_address(old.page) + old.page_offset,
+			     XEMACPS_RX_TRUESIZE);
+	if (unlikely(!skb)) {
+		if (!reuse) {
+			struct page *page = rp->page;
+
+			xemacps_unmap_rx_page(lp, rp);
+			__free_page(page);
+			*rp = old;
+		}
+		return NULL;
+	}
+
+	skb_reserve(skb, XEMACPS_RX_HEADROOM + RX_IP_ALIGN_OFFSET);
+	skb_put(skb, len);
+
+	if (!reuse) {
+		/* The driver's page reference now belongs to the skb */
+		xemacps_unmap_rx_page(lp, &old);
+		return skb;
+	}
+
+	get_page(old.page);
+	rp->page_offset ^= XEMACPS_RX_PAGE_HALF;
+	/* Cache lines the stack wrote in the other half must not be
+	 * evicted on top of the next frame.
+	 */
+	if (rp->len)
+		dma_sync_single_range_for_device(dev, rp->mapping,
+				rp->page_offset + XEMACPS_RX_HEADROOM,
+				rp->len + RX_IP_ALIGN_OFFSET,
+				DMA_FROM_DEVICE);
+	rp->len = len;
+
+	return skb;
+}
+
+/**
+ * xemacps_rx_csum - Translate the GEM checksum status of a received frame
+ * @lp: local device instance pointer
+ * @ctrl: word 1 of the RX BD
+ * Return: CHECKSUM_UNNECESSARY if the GEM verified the TCP/UDP checksum,
+ * CHECKSUM_NONE otherwise
+ *
+ * Frames failing any checksum are discarded by the GEM, so only the
+ * verified case needs to be told apart.
+ */
+static inline u8 xemacps_rx_csum(struct net_local *lp, u32 ctrl)
+{
+	u32 csum = (ctrl & XEMACPS_RXBUF_CSUM_MASK) >> XEMACPS_RXBUF_CSUM_SHIFT;
+
+	if (!(lp->ndev->features & NETIF_F_RXCSUM))
+		return CHECKSUM_NONE;
+
+	if (csum == XEMACPS_RXBUF_CSUM_IP_TCP ||
+	    csum == XEMACPS_RXBUF_CSUM_IP_UDP)
+		return CHECKSUM_UNNECESSARY;
+
+	return CHECKSUM_NONE;
+}
+
 /**
  * xemacps_rx - process received packets when napi called
  * @lp: local device instance pointer
@@ -1349,14 +1977,14 @@ static void xemacps_ptp_close(struct net_local *lp)
 static int xemacps_rx(struct net_local *lp, int budget)
 {
 	struct xemacps_bd *cur_p;
+	struct ring_info *rp;
 	u32 len;
 	struct sk_buff *skb;
-	struct sk_buff *new_skb;
-	u32 new_skb_baddr;
 	unsigned int numbdfree = 0;
 	u32 size = 0;
 	u32 packets = 0;
 	u32 regval;
+	u32 ctrl;
 
 	cur_p = &lp->rx_bd[lp->rx_bd_ci];
 	regval = cur_p->addr;
@@ -1373,81 +2001,70 @@ static int xemacps_rx(struct net_local *lp, int budget)
 			break;
 		}
 
-		new_skb = netdev_alloc_skb(lp->ndev, XEMACPS_RX_BUF_SIZE);
-		if (new_skb == NULL) {
-			dev_err(&lp->ndev->dev, "no memory for new sk_buff\n");
-			break;
-		}
-		/* Get dma handle of skb->data */
-		new_skb_baddr = (u32) dma_map_single(lp->ndev->dev.parent,
-					new_skb->data,
-					XEMACPS_RX_BUF_SIZE,
-					DMA_FROM_DEVICE);
-		if (dma_mapping_error(lp->ndev->dev.parent, new_skb_baddr)) {
-			dev_kfree_skb(new_skb);
-			break;
-		}
-
 		/* the packet length */
-		len = cur_p->ctrl & XEMACPS_RXBUF_LEN_MASK;
+		ctrl = cur_p->ctrl;
+		len = ctrl & XEMACPS_RXBUF_LEN_MASK;
 		rmb();
-		skb = lp->rx_skb[lp->rx_bd_ci].skb;
-		dma_unmap_single(lp->ndev->dev.parent,
-				lp->rx_skb[lp->rx_bd_ci].mapping,
-				lp->rx_skb[lp->rx_bd_ci].len,
-				DMA_FROM_DEVICE);
-
-		/* setup received skb and send it upstream */
-		skb_put(skb, len);  /* Tell the skb how much data we got. */
-		skb->protocol = eth_type_trans(skb, lp->ndev);
+		rp = &lp->rx_skb[lp->rx_bd_ci];
+
+		/* Only the bytes the GEM wrote need to be made visible */
+		dma_sync_single_range_for_cpu(lp->ndev->dev.parent,
+				rp->mapping,
+				rp->page_offset + XEMACPS_RX_HEADROOM,
+				len + RX_IP_ALIGN_OFFSET, DMA_FROM_DEVICE);
+
+		if (netif_rx_early_drop(lp->ndev, page_address(rp->page) +
+					rp->page_offset + XEMACPS_RX_HEADROOM +
+					RX_IP_ALIGN_OFFSET, len)) {
+			lp->stats.rx_dropped++;
+			goto next_bd;
+		}
 
-		skb->ip_summed = lp->ip_summed;
+		skb = xemacps_rx_build_skb(lp, rp, len);
+		if (unlikely(!skb)) {
+			/* Drop the frame and give the buffer back as is */
+			lp->stats.rx_dropped++;
+			goto next_bd;
+		}
 
 #ifdef CONFIG_XILINX_PS_EMAC_HWTSTAMP
-		if ((lp->hwtstamp_config.rx_filter == HWTSTAMP_FILTER_ALL) &&
-		    (ntohs(skb->protocol) == ETH_P_IP)) {
-			u8 transport_poto, msg_type;
-			u16 dst_port;
+		if (lp->hwtstamp_config.rx_filter != HWTSTAMP_FILTER_NONE) {
 			/* While the GEM can timestamp PTP packets, it does
-			 * not mark the RX descriptor to identify them.  This
-			 * is entirely the wrong place to be parsing UDP
-			 * headers, but some minimal effort must be made.
-			 * NOTE: the below parsing of ip_proto and dest_port
-			 * depend on the use of Ethernet_II encapsulation,
-			 * IPv4 without any options.
+			 * not mark the RX descriptor to identify them, so
+			 * classify the frame before the MAC header is pulled.
 			 */
-			skb_copy_from_linear_data_offset(skb,
-				XEMACPS_IP_PROTO_OFFSET, &transport_poto, 1);
-			if (transport_poto == IPPROTO_UDP) {
-				skb_copy_from_linear_data_offset(skb,
-					XEMACPS_UDP_PORT_OFFSET, &dst_port, 2);
-				if (ntohs(dst_port) ==
-						XEMACPS_PTP_EVENT_PORT_NUM) {
-					skb_copy_from_linear_data_offset(skb,
-						XEMACPS_RX_PTPHDR_OFFSET,
-							&msg_type, 1);
-					xemacps_rx_hwtstamp(lp, skb,
-							msg_type & 0x2);
-				}
-			}
+			int msg_type = xemacps_ptp_msg_type(skb);
+
+			if (msg_type >= 0)
+				xemacps_rx_hwtstamp(lp, skb, msg_type >=
+						    XEMACPS_PTP_MSG_PDELAY_REQ);
 		}
 #endif /* CONFIG_XILINX_PS_EMAC_HWTSTAMP */
+
+		/* setup received skb and send it upstream */
+		skb->protocol = eth_type_trans(skb, lp->ndev);
+
+		skb->ip_summed = xemacps_rx_csum(lp, ctrl);
 		size += len;
 		packets++;
-		netif_receive_skb(skb);
+		skb_mark_napi_id(skb, &lp->napi);
+		/* GRO belongs to the NAPI context, a busy polling socket
+		 * hands the frames to the stack directly.
+		 */
+		if (xemacps_bp_busy_polling(lp))
+			netif_receive_skb(skb);
+		else
+			napi_gro_receive(&lp->napi, skb);
 
+next_bd:
 		cur_p->addr = (cur_p->addr & ~XEMACPS_RXBUF_ADD_MASK)
-					| (new_skb_baddr);
-		lp->rx_skb[lp->rx_bd_ci].skb = new_skb;
-		lp->rx_skb[lp->rx_bd_ci].mapping = new_skb_baddr;
-		lp->rx_skb[lp->rx_bd_ci].len = XEMACPS_RX_BUF_SIZE;
-
+					| xemacps_rx_buf_dma(rp);
 		cur_p->ctrl = 0;
 		cur_p->addr &= (~XEMACPS_RXBUF_NEW_MASK);
 		wmb();
 
 		lp->rx_bd_ci++;
-		lp->rx_bd_ci = lp->rx_bd_ci % XEMACPS_RECV_BD_CNT;
+		lp->rx_bd_ci = lp->rx_bd_ci % lp->rx_ring_size;
 		cur_p = &lp->rx_bd[lp->rx_bd_ci];
 		regval = cur_p->addr;
 		rmb();
@@ -1459,6 +2076,95 @@ static int xemacps_rx(struct net_local *lp, int budget)
 	return numbdfree;
 }
 
+#ifdef CONFIG_XILINX_PS_EMAC_CAPTURE
+/**
+ * xemacps_cap_slot_dma - Bus address of a capture slot
+ * @lp: local device instance pointer
+ * @i: slot index, identical to the RX BD index
+ * Return: address to program into the RX BD
+ */
+static inline u32 xemacps_cap_slot_dma(struct net_local *lp, u32 i)
+{
+	return lp->cap_dma + lp->cap_ring->data_offset +
+	       i * XEMACPS_CAP_SLOT_SIZE;
+}
+
+/**
+ * xemacps_cap_rx - publish received frames in capture mode
+ * @lp: local device instance pointer
+ * @budget: NAPI budget
+ * Return: number of BDs processed
+ *
+ * No skbs are involved: slots consumed by user space are given back to the
+ * GEM, and completed BDs are only described in the shared ring before the
+ * head index is advanced.
+ */
+static int xemacps_cap_rx(struct net_local *lp, int budget)
+{
+	struct xemacps_cap_ring *ring = lp->cap_ring;
+	struct xemacps_cap_desc *desc;
+	struct xemacps_bd *cur_p;
+	struct timespec ts;
+	unsigned int numbdfree = 0;
+	u32 tail, i, len, regval;
+
+	/* A bogus tail from user space must not re-arm unfilled slots */
+	tail = ACCESS_ONCE(ring->tail);
+	if (tail - lp->cap_rearm > lp->cap_head - lp->cap_rearm)
+		tail = lp->cap_head;
+	rmb();
+	while (lp->cap_rearm != tail) {
+		i = lp->cap_rearm % lp->rx_ring_size;
+		cur_p = &lp->rx_bd[i];
+		cur_p->ctrl = 0;
+		wmb();
+		cur_p->addr &= ~XEMACPS_RXBUF_NEW_MASK;
+		lp->cap_rearm++;
+	}
+	wmb();
+
+	getnstimeofday(&ts);
+	while (numbdfree < budget) {
+		cur_p = &lp->rx_bd[lp->rx_bd_ci];
+		if (!(cur_p->addr & XEMACPS_RXBUF_NEW_MASK))
+			break;
+		rmb();
+
+		regval = xemacps_read(lp->baseaddr, XEMACPS_RXSR_OFFSET);
+		xemacps_write(lp->baseaddr, XEMACPS_RXSR_OFFSET, regval);
+		if (regval & XEMACPS_RXSR_HRESPNOK_MASK) {
+			dev_err(&lp->pdev->dev, "RX error 0x%x\n", regval);
+			return 0xFFFFFFFF;
+		}
+
+		len = cur_p->ctrl & XEMACPS_RXBUF_LEN_MASK;
+		desc = &ring->desc[lp->rx_bd_ci];
+		desc->len = len;
+		desc->status = cur_p->ctrl;
+		desc->ts_sec = ts.tv_sec;
+		desc->ts_nsec = ts.tv_nsec;
+		wmb();
+		ring->head = ++lp->cap_head;
+
+		lp->stats.rx_packets++;
+		lp->stats.rx_bytes += len;
+		lp->rx_bd_ci++;
+		lp->rx_bd_ci = lp->rx_bd_ci % lp->rx_ring_size;
+		numbdfree++;
+	}
+
+	if (numbdfree)
+		wake_up_interruptible(&lp->cap_wait);
+
+	return numbdfree;
+}
+#else
+static inline int xemacps_cap_rx(struct net_local *lp, int budget)
+{
+	return 0;
+}
+#endif /* CONFIG_XILINX_PS_EMAC_CAPTURE */
+
 /**
  * xemacps_rx_poll - NAPI poll routine
  * @napi: pointer to napi struct
@@ -1471,13 +2177,21 @@ static int xemacps_rx_poll(struct napi_struct *napi, int budget)
 	int work_done = 0;
 	u32 count;
 
+	/* A busy polling socket owns the RX ring, poll again later */
+	if (!xemacps_bp_lock_napi(lp))
+		return budget;
+
 	spin_lock(&lp->rx_lock);
 	while (1) {
 
-		count = xemacps_rx(lp, budget - work_done);
+		if (xemacps_cap_active(lp))
+			count = xemacps_cap_rx(lp, budget - work_done);
+		else
+			count = xemacps_rx(lp, budget - work_done);
 		if (count == 0xFFFFFFFF) {
 			napi_complete(napi);
 			spin_unlock(&lp->rx_lock);
+			xemacps_bp_unlock_napi(lp);
 			goto reset_hw;
 		}
 		work_done += count;
@@ -1504,12 +2218,63 @@ static int xemacps_rx_poll(struct napi_struct *napi, int budget)
 		break;
 	}
 	spin_unlock(&lp->rx_lock);
+	xemacps_bp_unlock_napi(lp);
 	return work_done;
 reset_hw:
 	queue_work(lp->txtimeout_handler_wq, &lp->txtimeout_reinit);
 	return 0;
 }
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+/**
+ * xemacps_busy_poll - receive frames for a busy polling socket
+ * @napi: pointer to napi struct
+ * Return: number of BDs processed, LL_FLUSH_FAILED or LL_FLUSH_BUSY
+ */
+static int xemacps_busy_poll(struct napi_struct *napi)
+{
+	struct net_local *lp = container_of(napi, struct net_local, napi);
+	u32 count;
+
+	if (!netif_running(lp->ndev) || xemacps_cap_active(lp))
+		return LL_FLUSH_FAILED;
+
+	if (!xemacps_bp_lock_poll(lp))
+		return LL_FLUSH_BUSY;
+
+	count = xemacps_rx(lp, XEMACPS_BUSY_POLL_BUDGET);
+	xemacps_bp_unlock_poll(lp);
+
+	if (count == 0xFFFFFFFF) {
+		queue_work(lp->txtimeout_handler_wq, &lp->txtimeout_reinit);
+		return LL_FLUSH_FAILED;
+	}
+
+	return count;
+}
+#endif /* CONFIG_NET_RX_BUSY_POLL */
+
+/**
+ * xemacps_napi_enable - Give the RX ring to NAPI and busy polling sockets
+ * @lp: local device instance pointer
+ */
+static void xemacps_napi_enable(struct net_local *lp)
+{
+	xemacps_bp_init_lock(lp);
+	napi_enable(&lp->napi);
+}
+
+/**
+ * xemacps_napi_disable - Wait for all users of the RX ring to stop
+ * @lp: local device instance pointer
+ */
+static void xemacps_napi_disable(struct net_local *lp)
+{
+	napi_disable(&lp->napi);
+	while (!xemacps_bp_disable(lp))
+		usleep_range(1000, 20000);
+}
+
 /**
  * xemacps_tx_poll - tx bd reclaim tasklet handler
  * @data: pointer to network interface device structure
@@ -1525,9 +2290,10 @@ static void xemacps_tx_poll(unsigned long data)
 	struct sk_buff *skb;
 	unsigned long flags;
 	u32 txbdcount = 0;
+	unsigned int pkts_compl = 0, bytes_compl = 0;
 	bool isfrag = false;
 
-	numbdsinhw = XEMACPS_SEND_BD_CNT - lp->tx_bd_freecnt;
+	numbdsinhw = lp->tx_ring_size - lp->tx_bd_freecnt;
 	if (!numbdsinhw)
 		return;
 
@@ -1549,25 +2315,31 @@ static void xemacps_tx_poll(unsigned long data)
 		rp = &lp->tx_skb[lp->tx_bd_ci];
 		skb = rp->skb;
 		lp->stats.tx_bytes += cur_p->ctrl & XEMACPS_TXBUF_LEN_MASK;
+		bytes_compl += rp->len;
 
 #ifdef CONFIG_XILINX_PS_EMAC_HWTSTAMP
 		if (skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP) {
-			u8 msg_type;
-			skb_copy_from_linear_data_offset(skb,
-				XEMACPS_TX_PTPHDR_OFFSET, &msg_type, 1);
-			xemacps_tx_hwtstamp(lp, skb, msg_type & 0x2);
+			/* only event frames latch the time stamp registers */
+			int msg_type = xemacps_ptp_msg_type(skb);
+
+			if (msg_type >= 0)
+				xemacps_tx_hwtstamp(lp, skb, msg_type >=
+						    XEMACPS_PTP_MSG_PDELAY_REQ);
 		}
 #endif /* CONFIG_XILINX_PS_EMAC_HWTSTAMP */
 
-		dma_unmap_single(&lp->pdev->dev, rp->mapping, rp->len,
-			DMA_TO_DEVICE);
+		if (!XEMACPS_IS_TSO_HEADER(lp, rp->mapping))
+			dma_unmap_single(&lp->pdev->dev, rp->mapping, rp->len,
+				DMA_TO_DEVICE);
 		rp->skb = NULL;
-		dev_kfree_skb(skb);
+		/* Tasklets run in softirq context, like NAPI */
+		napi_consume_skb(skb, 1);
 		/* log tx completed packets, errors logs
 		 * are in other error counters.
 		 */
 		if (cur_p->ctrl & XEMACPS_TXBUF_LAST_MASK) {
 			lp->stats.tx_packets++;
+			pkts_compl++;
 			isfrag = false;
 		} else {
 			isfrag = true;
@@ -1578,7 +2350,7 @@ static void xemacps_tx_poll(unsigned long data)
 		cur_p->ctrl &= (XEMACPS_TXBUF_USED_MASK |
 					XEMACPS_TXBUF_WRAP_MASK);
 		lp->tx_bd_ci++;
-		lp->tx_bd_ci = lp->tx_bd_ci % XEMACPS_SEND_BD_CNT;
+		lp->tx_bd_ci = lp->tx_bd_ci % lp->tx_ring_size;
 		cur_p = &lp->tx_bd[lp->tx_bd_ci];
 		numbdsinhw--;
 		txbdcount++;
@@ -1588,6 +2360,8 @@ static void xemacps_tx_poll(unsigned long data)
 	lp->tx_bd_freecnt += txbdcount;
 	spin_unlock(&lp->tx_lock);
 
+	netdev_completed_queue(ndev, pkts_compl, bytes_compl);
+
 	if (numbdsinhw) {
 		spin_lock_irqsave(&lp->nwctrlreg_lock, flags);
 		regval = xemacps_read(lp->baseaddr, XEMACPS_NWCTRL_OFFSET);
@@ -1656,20 +2430,17 @@ static void xemacps_clean_rings(struct net_local *lp)
 {
 	int i;
 
-	for (i = 0; i < XEMACPS_RECV_BD_CNT; i++) {
-		if (lp->rx_skb && lp->rx_skb[i].skb) {
-			dma_unmap_single(lp->ndev->dev.parent,
-					 lp->rx_skb[i].mapping,
-					 lp->rx_skb[i].len,
-					 DMA_FROM_DEVICE);
+	for (i = 0; i < lp->rx_ring_size; i++) {
+		if (lp->rx_skb && lp->rx_skb[i].page) {
+			struct page *page = lp->rx_skb[i].page;
 
-			dev_kfree_skb(lp->rx_skb[i].skb);
-			lp->rx_skb[i].skb = NULL;
-			lp->rx_skb[i].mapping = 0;
+			xemacps_unmap_rx_page(lp, &lp->rx_skb[i]);
+			/* the stack may still hold the other half */
+			put_page(page);
 		}
 	}
 
-	for (i = 0; i < XEMACPS_SEND_BD_CNT; i++) {
+	for (i = 0; i < lp->tx_ring_size; i++) {
 		if (lp->tx_skb && lp->tx_skb[i].skb) {
 			dma_unmap_single(lp->ndev->dev.parent,
 					 lp->tx_skb[i].mapping,
@@ -1683,6 +2454,41 @@ static void xemacps_clean_rings(struct net_local *lp)
 	}
 }
 
+/**
+ * xemacps_bd_ring_alloc - Allocate memory for a BD ring
+ * @lp: local device instance pointer
+ * @size: size of the ring in bytes
+ * @dma: returns the DMA address of the ring
+ * @ocm: returns whether the ring was allocated from OCM
+ * Return: pointer to the ring or NULL
+ *
+ * The GEM fetches BDs from OCM without going through the DDR controller,
+ * so rings are placed there if requested and OCM is not exhausted.
+ */
+static void *xemacps_bd_ring_alloc(struct net_local *lp, size_t size,
+				   dma_addr_t *dma, bool *ocm)
+{
+	void *ring = NULL;
+
+	if (lp->bd_rings_in_ocm)
+		ring = zynq_ocm_alloc(size, dma);
+	*ocm = ring != NULL;
+	if (!ring)
+		ring = dma_alloc_coherent(&lp->pdev->dev, size, dma,
+					  GFP_KERNEL);
+
+	return ring;
+}
+
+static void xemacps_bd_ring_free(struct net_local *lp, size_t size,
+				 void *ring, dma_addr_t dma, bool ocm)
+{
+	if (ocm)
+		zynq_ocm_free(ring, size);
+	else
+		dma_free_coherent(&lp->pdev->dev, size, ring, dma);
+}
+
 /**
  * xemacps_descriptor_free - Free allocated TX and RX BDs
  * @lp: local device instance pointer
@@ -1699,19 +2505,26 @@ static void xemacps_descriptor_free(struct net_local *lp)
 	kfree(lp->rx_skb);
 	lp->rx_skb = NULL;
 
-	size = XEMACPS_RECV_BD_CNT * sizeof(struct xemacps_bd);
+	size = lp->rx_ring_size * sizeof(struct xemacps_bd);
 	if (lp->rx_bd) {
-		dma_free_coherent(&lp->pdev->dev, size,
-			lp->rx_bd, lp->rx_bd_dma);
+		xemacps_bd_ring_free(lp, size, lp->rx_bd, lp->rx_bd_dma,
+				     lp->rx_bd_ocm);
 		lp->rx_bd = NULL;
 	}
 
-	size = XEMACPS_SEND_BD_CNT * sizeof(struct xemacps_bd);
+	size = lp->tx_ring_size * sizeof(struct xemacps_bd);
 	if (lp->tx_bd) {
-		dma_free_coherent(&lp->pdev->dev, size,
-			lp->tx_bd, lp->tx_bd_dma);
+		xemacps_bd_ring_free(lp, size, lp->tx_bd, lp->tx_bd_dma,
+				     lp->tx_bd_ocm);
 		lp->tx_bd = NULL;
 	}
+
+	size = lp->tx_ring_size * XEMACPS_TSO_HEADER_SIZE;
+	if (lp->tso_hdrs) {
+		dma_free_coherent(&lp->pdev->dev, size,
+			lp->tso_hdrs, lp->tso_hdrs_dma);
+		lp->tso_hdrs = NULL;
+	}
 }
 
 /**
@@ -1722,27 +2535,31 @@ static void xemacps_descriptor_free(struct net_local *lp)
 static int xemacps_descriptor_init(struct net_local *lp)
 {
 	int size;
-	struct sk_buff *new_skb;
-	u32 new_skb_baddr;
 	u32 i;
 	struct xemacps_bd *cur_p;
 	u32 regval;
 
+	BUILD_BUG_ON(XEMACPS_RX_HEADROOM + XEMACPS_RX_BUF_SIZE +
+		     SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) >
+		     XEMACPS_RX_PAGE_HALF);
+
 	lp->tx_skb = NULL;
 	lp->rx_skb = NULL;
 	lp->rx_bd = NULL;
 	lp->tx_bd = NULL;
+	lp->tso_hdrs = NULL;
 
 	/* Reset the indexes which are used for accessing the BDs */
 	lp->tx_bd_ci = 0;
 	lp->tx_bd_tail = 0;
 	lp->rx_bd_ci = 0;
+	netdev_reset_queue(lp->ndev);
 
-	size = XEMACPS_SEND_BD_CNT * sizeof(struct ring_info);
+	size = lp->tx_ring_size * sizeof(struct ring_info);
 	lp->tx_skb = kzalloc(size, GFP_KERNEL);
 	if (!lp->tx_skb)
 		goto err_out;
-	size = XEMACPS_RECV_BD_CNT * sizeof(struct ring_info);
+	size = lp->rx_ring_size * sizeof(struct ring_info);
 	lp->rx_skb = kzalloc(size, GFP_KERNEL);
 	if (!lp->rx_skb)
 		goto err_out;
@@ -1750,69 +2567,90 @@ static int xemacps_descriptor_init(struct net_local *lp)
 	/*
 	 * Set up RX buffer descriptors.
 	 */
+#ifdef CONFIG_XILINX_PS_EMAC_CAPTURE
+	/* A restarted ring starts over with all slots owned by the GEM */
+	if (xemacps_cap_active(lp)) {
+		lp->cap_head = 0;
+		lp->cap_rearm = 0;
+		lp->cap_ring->head = 0;
+		lp->cap_ring->tail = 0;
+	}
+#endif
 
-	size = XEMACPS_RECV_BD_CNT * sizeof(struct xemacps_bd);
-	lp->rx_bd = dma_alloc_coherent(&lp->pdev->dev, size,
-			&lp->rx_bd_dma, GFP_KERNEL);
+	size = lp->rx_ring_size * sizeof(struct xemacps_bd);
+	lp->rx_bd = xemacps_bd_ring_alloc(lp, size, &lp->rx_bd_dma,
+					  &lp->rx_bd_ocm);
 	if (!lp->rx_bd)
 		goto err_out;
-	dev_dbg(&lp->pdev->dev, "RX ring %d bytes at 0x%x mapped %p\n",
-			size, lp->rx_bd_dma, lp->rx_bd);
+	dev_dbg(&lp->pdev->dev, "RX ring %d bytes at 0x%x mapped %p%s\n",
+			size, lp->rx_bd_dma, lp->rx_bd,
+			lp->rx_bd_ocm ? " (OCM)" : "");
 
-	for (i = 0; i < XEMACPS_RECV_BD_CNT; i++) {
+	for (i = 0; i < lp->rx_ring_size; i++) {
 		cur_p = &lp->rx_bd[i];
 
-		new_skb = netdev_alloc_skb(lp->ndev, XEMACPS_RX_BUF_SIZE);
-		if (new_skb == NULL) {
-			dev_err(&lp->ndev->dev, "alloc_skb error %d\n", i);
-			goto err_out;
+#ifdef CONFIG_XILINX_PS_EMAC_CAPTURE
+		/* In capture mode BD i always points at slot i */
+		if (xemacps_cap_active(lp)) {
+			/* set wrap bit for last BD */
+			regval = (xemacps_cap_slot_dma(lp, i) &
+				  XEMACPS_RXBUF_ADD_MASK);
+			if (i == lp->rx_ring_size - 1)
+				regval |= XEMACPS_RXBUF_WRAP_MASK;
+			cur_p->addr = regval;
+			cur_p->ctrl = 0;
+			continue;
 		}
-
-		/* Get dma handle of skb->data */
-		new_skb_baddr = (u32) dma_map_single(lp->ndev->dev.parent,
-							new_skb->data,
-							XEMACPS_RX_BUF_SIZE,
-							DMA_FROM_DEVICE);
-		if (dma_mapping_error(lp->ndev->dev.parent, new_skb_baddr))
+#endif
+		if (xemacps_alloc_rx_page(lp, &lp->rx_skb[i], GFP_KERNEL)) {
+			dev_err(&lp->ndev->dev, "alloc_page error %d\n", i);
 			goto err_out;
+		}
 
 		/* set wrap bit for last BD */
-		regval = (new_skb_baddr & XEMACPS_RXBUF_ADD_MASK);
-		if (i == XEMACPS_RECV_BD_CNT - 1)
+		regval = (xemacps_rx_buf_dma(&lp->rx_skb[i]) &
+			  XEMACPS_RXBUF_ADD_MASK);
+		if (i == lp->rx_ring_size - 1)
 			regval |= XEMACPS_RXBUF_WRAP_MASK;
 		cur_p->addr = regval;
 		cur_p->ctrl = 0;
-		wmb();
-
-		lp->rx_skb[i].skb = new_skb;
-		lp->rx_skb[i].mapping = new_skb_baddr;
-		lp->rx_skb[i].len = XEMACPS_RX_BUF_SIZE;
 	}
+	wmb();
 
 	/*
 	 * Set up TX buffer descriptors.
 	 */
 
-	size = XEMACPS_SEND_BD_CNT * sizeof(struct xemacps_bd);
-	lp->tx_bd = dma_alloc_coherent(&lp->pdev->dev, size,
-			&lp->tx_bd_dma, GFP_KERNEL);
+	size = lp->tx_ring_size * sizeof(struct xemacps_bd);
+	lp->tx_bd = xemacps_bd_ring_alloc(lp, size, &lp->tx_bd_dma,
+					  &lp->tx_bd_ocm);
 	if (!lp->tx_bd)
 		goto err_out;
-	dev_dbg(&lp->pdev->dev, "TX ring %d bytes at 0x%x mapped %p\n",
-			size, lp->tx_bd_dma, lp->tx_bd);
+	dev_dbg(&lp->pdev->dev, "TX ring %d bytes at 0x%x mapped %p%s\n",
+			size, lp->tx_bd_dma, lp->tx_bd,
+			lp->tx_bd_ocm ? " (OCM)" : "");
 
-	for (i = 0; i < XEMACPS_SEND_BD_CNT; i++) {
+	for (i = 0; i < lp->tx_ring_size; i++) {
 		cur_p = &lp->tx_bd[i];
 		/* set wrap bit for last BD */
 		cur_p->addr = 0;
 		regval = XEMACPS_TXBUF_USED_MASK;
-		if (i == XEMACPS_SEND_BD_CNT - 1)
+		if (i == lp->tx_ring_size - 1)
 			regval |= XEMACPS_TXBUF_WRAP_MASK;
 		cur_p->ctrl = regval;
 	}
 	wmb();
 
-	lp->tx_bd_freecnt = XEMACPS_SEND_BD_CNT;
+	lp->tx_bd_freecnt = lp->tx_ring_size;
+
+	/* Headers built for TSO segments live in a coherent area so that
+	 * only the payload needs to be mapped.
+	 */
+	size = lp->tx_ring_size * XEMACPS_TSO_HEADER_SIZE;
+	lp->tso_hdrs = dma_alloc_coherent(&lp->pdev->dev, size,
+			&lp->tso_hdrs_dma, GFP_KERNEL);
+	if (!lp->tso_hdrs)
+		goto err_out;
 
 	dev_dbg(&lp->pdev->dev,
 		"lp->tx_bd %p lp->tx_bd_dma %p lp->tx_skb %p\n",
@@ -1828,6 +2666,68 @@ err_out:
 	return -ENOMEM;
 }
 
+/**
+ * xemacps_usecs_to_intmod - Convert a delay to interrupt moderation units
+ * @usecs: delay in microseconds
+ * Return: register field value, saturated to the field width
+ */
+static u32 xemacps_usecs_to_intmod(u32 usecs)
+{
+	return min_t(u32, DIV_ROUND_UP(usecs * 1000, XEMACPS_INTMOD_UNIT_NS),
+		     XEMACPS_INTMOD_RX_MASK);
+}
+
+/**
+ * xemacps_set_intmod - Program the interrupt moderation register
+ * @lp: local device instance pointer
+ */
+static void xemacps_set_intmod(struct net_local *lp)
+{
+	u32 regval;
+
+	regval = xemacps_usecs_to_intmod(lp->rx_coalesce_usecs);
+	regval |= xemacps_usecs_to_intmod(lp->tx_coalesce_usecs) <<
+		  XEMACPS_INTMOD_TX_SHIFT;
+	xemacps_write(lp->baseaddr, XEMACPS_INTMOD_OFFSET, regval);
+}
+
+/**
+ * xemacps_adapt_rx_coalesce - Follow the RX packet rate with the RX delay
+ * @lp: local device instance pointer
+ *
+ * Called from the statistics timer. Light traffic gets undelayed
+ * interrupts for the best latency; as the rate climbs, interrupts are
+ * delayed more so that each NAPI run handles a larger batch.
+ */
+static void xemacps_adapt_rx_coalesce(struct net_local *lp)
+{
+	unsigned long packets = lp->stats.rx_packets - lp->adapt_rx_packets;
+	unsigned long elapsed = jiffies - lp->adapt_jiffies;
+	unsigned long pps;
+	u32 usecs;
+
+	lp->adapt_rx_packets = lp->stats.rx_packets;
+	lp->adapt_jiffies = jiffies;
+
+	if (!lp->rx_adaptive || !elapsed)
+		return;
+
+	pps = packets * HZ / elapsed;
+	if (pps <= XEMACPS_ADAPT_RX_LOW_PPS)
+		usecs = 0;
+	else if (pps >= XEMACPS_ADAPT_RX_HIGH_PPS)
+		usecs = XEMACPS_ADAPT_RX_MAX_USECS;
+	else
+		usecs = XEMACPS_ADAPT_RX_MAX_USECS *
+			(pps - XEMACPS_ADAPT_RX_LOW_PPS) /
+			(XEMACPS_ADAPT_RX_HIGH_PPS - XEMACPS_ADAPT_RX_LOW_PPS);
+
+	if (usecs != lp->rx_coalesce_usecs) {
+		lp->rx_coalesce_usecs = usecs;
+		xemacps_set_intmod(lp);
+	}
+}
+
 /**
  * xemacps_init_hw - Initialize hardware to known good state
  * @lp: local device instance pointer
@@ -1842,12 +2742,15 @@ static void xemacps_init_hw(struct net_local *lp)
 	/* network configuration */
 	regval  = 0;
 	regval |= XEMACPS_NWCFG_FDEN_MASK;
-	regval |= XEMACPS_NWCFG_RXCHKSUMEN_MASK;
+	if (lp->ndev->features & NETIF_F_RXCSUM)
+		regval |= XEMACPS_NWCFG_RXCHKSUMEN_MASK;
 	regval |= XEMACPS_NWCFG_PAUSECOPYDI_MASK;
 	regval |= XEMACPS_NWCFG_FCSREM_MASK;
 	regval |= XEMACPS_NWCFG_PAUSEEN_MASK;
 	regval |= XEMACPS_NWCFG_100_MASK;
 	regval |= XEMACPS_NWCFG_HDRXEN_MASK;
+	/* Let the GEM place the frame so that the IP header is aligned */
+	regval |= (RX_IP_ALIGN_OFFSET << XEMACPS_NWCFG_RXOFFS_SHIFT);
 
 	regval |= (MDC_DIV_224 << XEMACPS_NWCFG_MDC_SHIFT_MASK);
 	if (lp->ndev->flags & IFF_PROMISC)	/* copy all */
@@ -1876,6 +2779,8 @@ static void xemacps_init_hw(struct net_local *lp)
 	regval |= XEMACPS_DMACR_BLENGTH_INCR16;
 	xemacps_write(lp->baseaddr, XEMACPS_DMACR_OFFSET, regval);
 
+	xemacps_set_intmod(lp);
+
 	/* Enable TX, RX and MDIO port */
 	regval  = 0;
 	regval |= XEMACPS_NWCTRL_MDEN_MASK;
@@ -2005,6 +2910,7 @@ static void xemacps_gen_purpose_timerhandler(unsigned long data)
 
 	xemacps_update_stats(data);
 	xemacps_resetrx_for_no_rxdata(data);
+	xemacps_adapt_rx_coalesce(lp);
 	mod_timer(&(lp->gen_purpose_timer),
 		jiffies + msecs_to_jiffies(XEAMCPS_GEN_PURPOSE_TIMER_LOAD));
 }
@@ -2046,7 +2952,7 @@ static int xemacps_open(struct net_device *ndev)
 		goto err_free_rings;
 	}
 
-	napi_enable(&lp->napi);
+	xemacps_napi_enable(lp);
 	xemacps_init_hw(lp);
 
 	setup_timer(&(lp->gen_purpose_timer), xemacps_gen_purpose_timerhandler,
@@ -2075,7 +2981,7 @@ static int xemacps_open(struct net_device *ndev)
 	return 0;
 
 err_pm_put:
-	napi_disable(&lp->napi);
+	xemacps_napi_disable(lp);
 	xemacps_reset_hw(lp);
 	if (lp->timerready) {
 		del_timer_sync(&(lp->gen_purpose_timer));
@@ -2105,7 +3011,7 @@ static int xemacps_close(struct net_device *ndev)
 	if (lp->timerready)
 		del_timer_sync(&(lp->gen_purpose_timer));
 	netif_stop_queue(ndev);
-	napi_disable(&lp->napi);
+	xemacps_napi_disable(lp);
 	tasklet_disable(&lp->tx_bdreclaim_tasklet);
 	netif_carrier_off(ndev);
 	if (lp->phy_dev)
@@ -2136,7 +3042,7 @@ static void xemacps_reinit_for_txtimeout(struct work_struct *data)
 	int rc;
 
 	netif_stop_queue(lp->ndev);
-	napi_disable(&lp->napi);
+	xemacps_napi_disable(lp);
 	tasklet_disable(&lp->tx_bdreclaim_tasklet);
 	spin_lock_bh(&lp->tx_lock);
 	xemacps_reset_hw(lp);
@@ -2162,12 +3068,222 @@ static void xemacps_reinit_for_txtimeout(struct work_struct *data)
 	if (lp->phy_dev)
 		phy_start(lp->phy_dev);
 
-	napi_enable(&lp->napi);
+	xemacps_napi_enable(lp);
 	tasklet_enable(&lp->tx_bdreclaim_tasklet);
 	lp->ndev->trans_start = jiffies;
 	netif_wake_queue(lp->ndev);
 }
 
+/**
+ * xemacps_stop_dma - Stop a running interface and free its rings
+ * @lp: local device instance pointer
+ *
+ * Used when the rings have to be rebuilt with a different layout; the
+ * interface is restarted with xemacps_start_dma().
+ */
+static void xemacps_stop_dma(struct net_local *lp)
+{
+	netif_stop_queue(lp->ndev);
+	xemacps_napi_disable(lp);
+	tasklet_disable(&lp->tx_bdreclaim_tasklet);
+	spin_lock_bh(&lp->tx_lock);
+	xemacps_reset_hw(lp);
+	spin_unlock_bh(&lp->tx_lock);
+
+	xemacps_descriptor_free(lp);
+}
+
+/**
+ * xemacps_start_dma - Restart an interface stopped by xemacps_stop_dma()
+ * @lp: local device instance pointer
+ *
+ * The rings must have been allocated again by the caller.
+ */
+static void xemacps_start_dma(struct net_local *lp)
+{
+	xemacps_init_hw(lp);
+
+	xemacps_napi_enable(lp);
+	tasklet_enable(&lp->tx_bdreclaim_tasklet);
+	lp->ndev->trans_start = jiffies;
+	netif_wake_queue(lp->ndev);
+}
+
+#ifdef CONFIG_XILINX_PS_EMAC_CAPTURE
+/**
+ * xemacps_cap_switch - Move the RX ring into or out of capture mode
+ * @lp: local device instance pointer
+ * @ring: capture ring to use, NULL to return to normal operation
+ * Return: 0 on success, negative value if error
+ *
+ * Must be called with the RTNL held.
+ */
+static int xemacps_cap_switch(struct net_local *lp,
+			      struct xemacps_cap_ring *ring)
+{
+	struct xemacps_cap_ring *old = lp->cap_ring;
+	int rc;
+
+	if (!netif_running(lp->ndev)) {
+		lp->cap_ring = ring;
+		return 0;
+	}
+
+	xemacps_stop_dma(lp);
+	lp->cap_ring = ring;
+	rc = xemacps_descriptor_init(lp);
+	if (rc) {
+		lp->cap_ring = old;
+		if (xemacps_descriptor_init(lp))
+			return rc;
+	}
+	xemacps_start_dma(lp);
+
+	return rc;
+}
+
+static int xemacps_cap_open(struct inode *inode, struct file *file)
+{
+	struct net_local *lp = container_of(file->private_data,
+					    struct net_local, cap_misc);
+	struct xemacps_cap_ring *ring;
+	size_t hdr_size;
+	dma_addr_t dma;
+	int rc;
+
+	if (test_and_set_bit(0, &lp->cap_busy))
+		return -EBUSY;
+
+	rtnl_lock();
+	hdr_size = PAGE_ALIGN(sizeof(*ring) +
+			      lp->rx_ring_size * sizeof(ring->desc[0]));
+	lp->cap_size = hdr_size + lp->rx_ring_size * XEMACPS_CAP_SLOT_SIZE;
+	ring = dma_alloc_coherent(&lp->pdev->dev, lp->cap_size, &dma,
+				  GFP_KERNEL);
+	if (!ring) {
+		rc = -ENOMEM;
+		goto err_unlock;
+	}
+	memset(ring, 0, hdr_size);
+
+	ring->version = XEMACPS_CAP_VERSION;
+	ring->nr_slots = lp->rx_ring_size;
+	ring->slot_size = XEMACPS_CAP_SLOT_SIZE;
+	ring->data_offset = hdr_size;
+	ring->frame_offset = RX_IP_ALIGN_OFFSET;
+	lp->cap_dma = dma;
+
+	rc = xemacps_cap_switch(lp, ring);
+	if (rc) {
+		dma_free_coherent(&lp->pdev->dev, lp->cap_size, ring, dma);
+		goto err_unlock;
+	}
+	rtnl_unlock();
+
+	file->private_data = lp;
+	return 0;
+
+err_unlock:
+	rtnl_unlock();
+	clear_bit(0, &lp->cap_busy);
+	return rc;
+}
+
+static int xemacps_cap_release(struct inode *inode, struct file *file)
+{
+	struct net_local *lp = file->private_data;
+	struct xemacps_cap_ring *ring = lp->cap_ring;
+
+	rtnl_lock();
+	if (xemacps_cap_switch(lp, NULL))
+		dev_err(&lp->pdev->dev, "unable to leave capture mode\n");
+	rtnl_unlock();
+
+	dma_free_coherent(&lp->pdev->dev, lp->cap_size, ring, lp->cap_dma);
+	clear_bit(0, &lp->cap_busy);
+
+	return 0;
+}
+
+static int xemacps_cap_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct net_local *lp = file->private_data;
+
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start > PAGE_ALIGN(lp->cap_size))
+		return -EINVAL;
+
+	return dma_mmap_coherent(&lp->pdev->dev, vma, lp->cap_ring,
+				 lp->cap_dma, lp->cap_size);
+}
+
+/* Let NAPI hand slots released by user space back to the GEM */
+static void xemacps_cap_kick(struct net_local *lp)
+{
+	if (ACCESS_ONCE(lp->cap_ring->tail) != lp->cap_rearm)
+		napi_schedule(&lp->napi);
+}
+
+static unsigned int xemacps_cap_poll(struct file *file, poll_table *wait)
+{
+	struct net_local *lp = file->private_data;
+	struct xemacps_cap_ring *ring = lp->cap_ring;
+
+	xemacps_cap_kick(lp);
+	poll_wait(file, &lp->cap_wait, wait);
+	if (ACCESS_ONCE(ring->head) != ACCESS_ONCE(ring->tail))
+		return POLLIN | POLLRDNORM;
+
+	return 0;
+}
+
+static long xemacps_cap_ioctl(struct file *file, unsigned int cmd,
+			      unsigned long arg)
+{
+	struct net_local *lp = file->private_data;
+
+	switch (cmd) {
+	case XEMACPS_CAP_RELEASE:
+		xemacps_cap_kick(lp);
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations xemacps_cap_fops = {
+	.owner		= THIS_MODULE,
+	.open		= xemacps_cap_open,
+	.release	= xemacps_cap_release,
+	.mmap		= xemacps_cap_mmap,
+	.poll		= xemacps_cap_poll,
+	.unlocked_ioctl	= xemacps_cap_ioctl,
+};
+
+/**
+ * xemacps_cap_register - Create the capture device of an interface
+ * @lp: local device instance pointer
+ * Return: 0 on success, negative value if error
+ */
+static int xemacps_cap_register(struct net_local *lp)
+{
+	init_waitqueue_head(&lp->cap_wait);
+	snprintf(lp->cap_name, sizeof(lp->cap_name), "xemacps_cap%u",
+		 lp->enetnum);
+	lp->cap_misc.minor = MISC_DYNAMIC_MINOR;
+	lp->cap_misc.name = lp->cap_name;
+	lp->cap_misc.fops = &xemacps_cap_fops;
+	lp->cap_misc.parent = &lp->pdev->dev;
+
+	if (misc_register(&lp->cap_misc)) {
+		lp->cap_misc.fops = NULL;
+		return -ENODEV;
+	}
+
+	return 0;
+}
+#endif /* CONFIG_XILINX_PS_EMAC_CAPTURE */
+
 /**
  * xemacps_tx_timeout - callback used when the transmitter has not made
  * any progress for dev->watchdog ticks.
@@ -2220,10 +3336,157 @@ static void unwind_tx_frag_mapping(struct net_local *lp, int fragcnt)
 		if (lp->tx_bd_freecnt)
 			lp->tx_bd_freecnt--;
 		else
-			lp->tx_bd_freecnt = XEMACPS_SEND_BD_CNT - 1;
+			lp->tx_bd_freecnt = lp->tx_ring_size - 1;
 	}
 }
 
+/**
+ * xemacps_tx_fill_bd - Hand one buffer of a frame to the next free TX BD
+ * @lp: driver control structure
+ * @skb: socket buffer the buffer belongs to
+ * @mapping: bus address of the buffer
+ * @len: buffer length
+ * @first: the BD starts a frame; it is committed by the caller
+ * @last: the BD ends a frame
+ */
+static void xemacps_tx_fill_bd(struct net_local *lp, struct sk_buff *skb,
+			       dma_addr_t mapping, u32 len, bool first,
+			       bool last)
+{
+	struct xemacps_bd *cur_p = &lp->tx_bd[lp->tx_bd_tail];
+	u32 regval;
+
+	lp->tx_skb[lp->tx_bd_tail].skb = skb;
+	lp->tx_skb[lp->tx_bd_tail].mapping = mapping;
+	lp->tx_skb[lp->tx_bd_tail].len = len;
+	cur_p->addr = mapping;
+
+	/* preserve critical status bits */
+	regval = cur_p->ctrl;
+	regval &= (XEMACPS_TXBUF_USED_MASK | XEMACPS_TXBUF_WRAP_MASK);
+	regval |= len;
+	if (!first)
+		regval &= ~XEMACPS_TXBUF_USED_MASK;
+	if (last)
+		regval |= XEMACPS_TXBUF_LAST_MASK;
+	cur_p->ctrl = regval;
+
+	lp->tx_bd_tail++;
+	lp->tx_bd_tail = lp->tx_bd_tail % lp->tx_ring_size;
+}
+
+/**
+ * xemacps_tso_unwind - Release the BDs of a partially queued TSO skb
+ * @lp: driver control structure
+ * @bd_tail: index of the first BD used by the skb
+ */
+static void xemacps_tso_unwind(struct net_local *lp, u32 bd_tail)
+{
+	struct ring_info *rp;
+	struct xemacps_bd *cur_p;
+
+	while (lp->tx_bd_tail != bd_tail) {
+		lp->tx_bd_tail = lp->tx_bd_tail ? lp->tx_bd_tail - 1 :
+				 lp->tx_ring_size - 1;
+		rp = &lp->tx_skb[lp->tx_bd_tail];
+		cur_p = &lp->tx_bd[lp->tx_bd_tail];
+
+		if (!XEMACPS_IS_TSO_HEADER(lp, rp->mapping))
+			dma_unmap_single(&lp->pdev->dev, rp->mapping, rp->len,
+					 DMA_TO_DEVICE);
+		/* every BD but the first holds its own skb reference */
+		if (lp->tx_bd_tail != bd_tail)
+			dev_kfree_skb_any(rp->skb);
+		rp->skb = NULL;
+
+		cur_p->ctrl |= XEMACPS_TXBUF_USED_MASK;
+		cur_p->ctrl &= (XEMACPS_TXBUF_USED_MASK |
+				XEMACPS_TXBUF_WRAP_MASK);
+	}
+}
+
+/**
+ * xemacps_tso_xmit - Queue a GSO skb as a train of ready-made segments
+ * @lp: driver control structure
+ * @skb: socket buffer
+ * Return: number of BDs used, 0 if the skb could not be mapped
+ *
+ * The GEM has no segmentation engine, so the segments are built in
+ * software: each gets a copy of the headers, rewritten by the TSO
+ * helpers, followed by BDs pointing straight at the payload. The GEM
+ * checksum offload fills in the IP and TCP checksums of every segment.
+ */
+static int xemacps_tso_xmit(struct net_local *lp, struct sk_buff *skb)
+{
+	int hdr_len = skb_transport_offset(skb) + tcp_hdrlen(skb);
+	int total_len, data_left, size;
+	u32 bd_tail = lp->tx_bd_tail;
+	dma_addr_t mapping;
+	struct tso_t tso;
+	bool first = true;
+	char *hdr;
+	int count = 0;
+
+	tso_start(skb, &tso);
+
+	total_len = skb->len - hdr_len;
+	while (total_len > 0) {
+		data_left = min_t(int, skb_shinfo(skb)->gso_size, total_len);
+		total_len -= data_left;
+
+		/* prepare packet headers: MAC + IP + TCP */
+		hdr = lp->tso_hdrs + lp->tx_bd_tail * XEMACPS_TSO_HEADER_SIZE;
+		tso_build_hdr(skb, hdr, &tso, data_left, total_len == 0);
+		/* the GEM computes both checksums of every segment */
+		((struct iphdr *)(hdr + skb_network_offset(skb)))->check = 0;
+		((struct tcphdr *)(hdr +
+			skb_transport_offset(skb)))->check = 0;
+
+		mapping = lp->tso_hdrs_dma + lp->tx_bd_tail * XEMACPS_TSO_HEADER_SIZE;
+		if (!first)
+			skb_get(skb);
+		xemacps_tx_fill_bd(lp, skb, mapping, hdr_len, first, false);
+		first = false;
+		count++;
+
+		while (data_left > 0) {
+			size = min_t(int, tso.size, data_left);
+			mapping = dma_map_single(&lp->pdev->dev, tso.data,
+						 size, DMA_TO_DEVICE);
+			if (dma_mapping_error(&lp->pdev->dev, mapping)) {
+				xemacps_tso_unwind(lp, bd_tail);
+				return 0;
+			}
+
+			data_left -= size;
+			skb_get(skb);
+			xemacps_tx_fill_bd(lp, skb, mapping, size, false,
+					   data_left == 0);
+			count++;
+
+			tso_build_data(skb, &tso, size);
+		}
+	}
+
+	return count;
+}
+
+/**
+ * xemacps_tx_kick - Make the GEM fetch the BDs committed so far
+ * @lp: driver control structure
+ */
+static void xemacps_tx_kick(struct net_local *lp)
+{
+	unsigned long flags;
+	u32 regval;
+
+	spin_lock_irqsave(&lp->nwctrlreg_lock, flags);
+	regval = xemacps_read(lp->baseaddr, XEMACPS_NWCTRL_OFFSET);
+	xemacps_write(lp->baseaddr, XEMACPS_NWCTRL_OFFSET,
+			(regval | XEMACPS_NWCTRL_STARTTX_MASK));
+	spin_unlock_irqrestore(&lp->nwctrlreg_lock, flags);
+}
+
 /**
  * xemacps_start_xmit - transmit a packet (called by kernel)
  * @skb: socket buffer
@@ -2240,21 +3503,32 @@ static int xemacps_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	void       *virt_addr;
 	skb_frag_t *frag;
 	struct xemacps_bd *cur_p;
-	unsigned long flags;
+	bool more = skb->xmit_more;
+	unsigned int bytes = 0;
 	u32 bd_tail;
 
-	nr_frags = skb_shinfo(skb)->nr_frags + 1;
+	if (skb_is_gso(skb))
+		nr_frags = tso_count_descs(skb);
+	else
+		nr_frags = skb_shinfo(skb)->nr_frags + 1;
 	if (nr_frags > lp->tx_bd_freecnt) {
 		netif_stop_queue(ndev); /* stop send queue */
+		/* earlier frames may have been queued with xmit_more */
+		xemacps_tx_kick(lp);
 		return NETDEV_TX_BUSY;
 	}
 
-	if (xemacps_clear_csum(skb, ndev)) {
-		kfree(skb);
-		return NETDEV_TX_OK;
+	bd_tail = lp->tx_bd_tail;
+	if (skb_is_gso(skb)) {
+		nr_frags = xemacps_tso_xmit(lp, skb);
+		if (!nr_frags)
+			goto dma_err;
+		goto commit;
 	}
 
-	bd_tail = lp->tx_bd_tail;
+	if (xemacps_clear_csum(skb, ndev))
+		goto dma_err;
+
 	cur_p = &lp->tx_bd[bd_tail];
 	frag = &skb_shinfo(skb)->frags[0];
 
@@ -2297,12 +3571,14 @@ static int xemacps_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 		cur_p->ctrl = regval;
 
 		lp->tx_bd_tail++;
-		lp->tx_bd_tail = lp->tx_bd_tail % XEMACPS_SEND_BD_CNT;
+		lp->tx_bd_tail = lp->tx_bd_tail % lp->tx_ring_size;
 		cur_p = &(lp->tx_bd[lp->tx_bd_tail]);
 	}
 
+commit:
 	/* commit first buffer to hardware -- do this after
 	 * committing the other buffers to avoid an underrun */
+	wmb();
 	cur_p = &lp->tx_bd[bd_tail];
 	regval = cur_p->ctrl;
 	regval &= ~XEMACPS_TXBUF_USED_MASK;
@@ -2312,17 +3588,22 @@ static int xemacps_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	lp->tx_bd_freecnt -= nr_frags;
 	spin_unlock_bh(&lp->tx_lock);
 
-	spin_lock_irqsave(&lp->nwctrlreg_lock, flags);
-	regval = xemacps_read(lp->baseaddr, XEMACPS_NWCTRL_OFFSET);
-	xemacps_write(lp->baseaddr, XEMACPS_NWCTRL_OFFSET,
-			(regval | XEMACPS_NWCTRL_STARTTX_MASK));
-	spin_unlock_irqrestore(&lp->nwctrlreg_lock, flags);
+	/* BQL counts what xemacps_tx_poll() will see, TSO headers included */
+	for (i = bd_tail; i != lp->tx_bd_tail; i = (i + 1) % lp->tx_ring_size)
+		bytes += lp->tx_skb[i].len;
+	netdev_sent_queue(ndev, bytes);
+
+	/* a single doorbell for a batch of frames from the qdisc */
+	if (!more || netif_xmit_stopped(netdev_get_tx_queue(ndev, 0)))
+		xemacps_tx_kick(lp);
 
 	ndev->trans_start = jiffies;
 	return 0;
 
 dma_err:
 	kfree_skb(skb);
+	if (!more)
+		xemacps_tx_kick(lp);
 	return NETDEV_TX_OK;
 }
 
@@ -2544,12 +3825,131 @@ xemacps_get_drvinfo(struct net_device *ndev, struct ethtool_drvinfo *ed)
 static void
 xemacps_get_ringparam(struct net_device *ndev, struct ethtool_ringparam *erp)
 {
+	struct net_local *lp = netdev_priv(ndev);
+
 	memset(erp, 0, sizeof(struct ethtool_ringparam));
 
-	erp->rx_max_pending = XEMACPS_RECV_BD_CNT;
-	erp->tx_max_pending = XEMACPS_SEND_BD_CNT;
-	erp->rx_pending = 0;
-	erp->tx_pending = 0;
+	erp->rx_max_pending = XEMACPS_MAX_BD_CNT;
+	erp->tx_max_pending = XEMACPS_MAX_BD_CNT;
+	erp->rx_pending = lp->rx_ring_size;
+	erp->tx_pending = lp->tx_ring_size;
+}
+
+/**
+ * xemacps_set_ringparam - resize the dma rings.
+ * Usage: Issue "ethtool -G ethX rx N tx M" under linux prompt
+ * @ndev: network device
+ * @erp: ethtool ring parameter structure
+ * Return: 0 on success, negative value if error
+ *
+ * On a running interface the DMA is stopped and the descriptors are
+ * reallocated with the new sizes, the same way a TX timeout is recovered.
+ * If the new rings cannot be allocated the previous sizes are restored.
+ */
+static int
+xemacps_set_ringparam(struct net_device *ndev, struct ethtool_ringparam *erp)
+{
+	struct net_local *lp = netdev_priv(ndev);
+	u32 old_rx = lp->rx_ring_size;
+	u32 old_tx = lp->tx_ring_size;
+	int rc = 0;
+
+	if (erp->rx_mini_pending || erp->rx_jumbo_pending)
+		return -EINVAL;
+
+	if (erp->rx_pending < XEMACPS_MIN_BD_CNT ||
+	    erp->rx_pending > XEMACPS_MAX_BD_CNT ||
+	    erp->tx_pending < XEMACPS_MIN_BD_CNT ||
+	    erp->tx_pending > XEMACPS_MAX_BD_CNT)
+		return -EINVAL;
+
+	if (erp->rx_pending == old_rx && erp->tx_pending == old_tx)
+		return 0;
+
+	/* the capture buffer is sized for the current RX ring */
+	if (xemacps_cap_active(lp))
+		return -EBUSY;
+
+	if (!netif_running(ndev)) {
+		lp->rx_ring_size = erp->rx_pending;
+		lp->tx_ring_size = erp->tx_pending;
+		ndev->gso_max_segs = XEMACPS_TSO_MAX_SEGS(lp->tx_ring_size);
+		return 0;
+	}
+
+	xemacps_stop_dma(lp);
+	lp->rx_ring_size = erp->rx_pending;
+	lp->tx_ring_size = erp->tx_pending;
+	if (xemacps_descriptor_init(lp)) {
+		dev_err(&lp->pdev->dev,
+			"Unable to allocate rings, keeping %u/%u BDs\n",
+			old_rx, old_tx);
+		lp->rx_ring_size = old_rx;
+		lp->tx_ring_size = old_tx;
+		rc = xemacps_descriptor_init(lp);
+		if (rc)
+			return rc;
+		rc = -ENOMEM;
+	}
+	ndev->gso_max_segs = XEMACPS_TSO_MAX_SEGS(lp->tx_ring_size);
+
+	xemacps_start_dma(lp);
+
+	return rc;
+}
+
+/**
+ * xemacps_get_coalesce - get interrupt moderation settings.
+ * Usage: Issue "ethtool -c ethX" under linux prompt
+ * @ndev: network device
+ * @ec: ethtool coalesce structure
+ * Return: Always 0
+ */
+static int
+xemacps_get_coalesce(struct net_device *ndev, struct ethtool_coalesce *ec)
+{
+	struct net_local *lp = netdev_priv(ndev);
+
+	memset(ec, 0, sizeof(struct ethtool_coalesce));
+
+	ec->rx_coalesce_usecs = lp->rx_coalesce_usecs;
+	ec->tx_coalesce_usecs = lp->tx_coalesce_usecs;
+	ec->use_adaptive_rx_coalesce = lp->rx_adaptive;
+
+	return 0;
+}
+
+/**
+ * xemacps_set_coalesce - set interrupt moderation settings.
+ * Usage: Issue "ethtool -C ethX rx-usecs N tx-usecs M adaptive-rx on|off"
+ * under linux prompt
+ * @ndev: network device
+ * @ec: ethtool coalesce structure
+ * Return: 0 on success, negative value if not supported
+ *
+ * The GEM has a single queue, so the settings apply to the whole device.
+ */
+static int
+xemacps_set_coalesce(struct net_device *ndev, struct ethtool_coalesce *ec)
+{
+	struct net_local *lp = netdev_priv(ndev);
+
+	if (ec->rx_coalesce_usecs > XEMACPS_INTMOD_MAX_USECS ||
+	    ec->tx_coalesce_usecs > XEMACPS_INTMOD_MAX_USECS)
+		return -EINVAL;
+
+	if (ec->rx_max_coalesced_frames || ec->tx_max_coalesced_frames ||
+	    ec->use_adaptive_tx_coalesce)
+		return -EOPNOTSUPP;
+
+	lp->rx_coalesce_usecs = ec->rx_coalesce_usecs;
+	lp->tx_coalesce_usecs = ec->tx_coalesce_usecs;
+	lp->rx_adaptive = !!ec->use_adaptive_rx_coalesce;
+
+	if (netif_running(ndev))
+		xemacps_set_intmod(lp);
+
+	return 0;
 }
 
 /**
@@ -2704,7 +4104,18 @@ static int xemacps_get_ts_info(struct net_device *dev,
 	info->tx_types = (1 << HWTSTAMP_TX_OFF) |
 			(1 << HWTSTAMP_TX_ON);
 	info->rx_filters = (1 << HWTSTAMP_FILTER_NONE) |
-			(1 << HWTSTAMP_FILTER_ALL);
+			(1 << HWTSTAMP_FILTER_PTP_V1_L4_EVENT) |
+			(1 << HWTSTAMP_FILTER_PTP_V1_L4_SYNC) |
+			(1 << HWTSTAMP_FILTER_PTP_V1_L4_DELAY_REQ) |
+			(1 << HWTSTAMP_FILTER_PTP_V2_EVENT) |
+			(1 << HWTSTAMP_FILTER_PTP_V2_SYNC) |
+			(1 << HWTSTAMP_FILTER_PTP_V2_DELAY_REQ) |
+			(1 << HWTSTAMP_FILTER_PTP_V2_L4_EVENT) |
+			(1 << HWTSTAMP_FILTER_PTP_V2_L4_SYNC) |
+			(1 << HWTSTAMP_FILTER_PTP_V2_L4_DELAY_REQ) |
+			(1 << HWTSTAMP_FILTER_PTP_V2_L2_EVENT) |
+			(1 << HWTSTAMP_FILTER_PTP_V2_L2_SYNC) |
+			(1 << HWTSTAMP_FILTER_PTP_V2_L2_DELAY_REQ);
 	return 0;
 }
 #endif
@@ -2715,6 +4126,9 @@ static struct ethtool_ops xemacps_ethtool_ops = {
 	.get_drvinfo    = xemacps_get_drvinfo,
 	.get_link       = ethtool_op_get_link, /* ethtool default */
 	.get_ringparam  = xemacps_get_ringparam,
+	.set_ringparam  = xemacps_set_ringparam,
+	.get_coalesce   = xemacps_get_coalesce,
+	.set_coalesce   = xemacps_set_coalesce,
 	.get_wol        = xemacps_get_wol,
 	.set_wol        = xemacps_set_wol,
 	.get_pauseparam = xemacps_get_pauseparam,
@@ -2745,15 +4159,21 @@ static int xemacps_hwtstamp_ioctl(struct net_device *netdev,
 		(config.tx_type != HWTSTAMP_TX_ON))
 		return -ERANGE;
 
+	/*
+	 * The GEM stamps every PTP event frame, over Ethernet and UDP
+	 * alike, but nothing else: report the superset actually stamped
+	 * and refuse to stamp all frames.
+	 */
 	switch (config.rx_filter) {
 	case HWTSTAMP_FILTER_NONE:
 		break;
 	case HWTSTAMP_FILTER_PTP_V1_L4_EVENT:
-	case HWTSTAMP_FILTER_PTP_V2_L4_EVENT:
-	case HWTSTAMP_FILTER_PTP_V2_L2_EVENT:
-	case HWTSTAMP_FILTER_ALL:
 	case HWTSTAMP_FILTER_PTP_V1_L4_SYNC:
 	case HWTSTAMP_FILTER_PTP_V1_L4_DELAY_REQ:
+		config.rx_filter = HWTSTAMP_FILTER_PTP_V1_L4_EVENT;
+		break;
+	case HWTSTAMP_FILTER_PTP_V2_L4_EVENT:
+	case HWTSTAMP_FILTER_PTP_V2_L2_EVENT:
 	case HWTSTAMP_FILTER_PTP_V2_L2_SYNC:
 	case HWTSTAMP_FILTER_PTP_V2_L4_SYNC:
 	case HWTSTAMP_FILTER_PTP_V2_L2_DELAY_REQ:
@@ -2761,15 +4181,18 @@ static int xemacps_hwtstamp_ioctl(struct net_device *netdev,
 	case HWTSTAMP_FILTER_PTP_V2_EVENT:
 	case HWTSTAMP_FILTER_PTP_V2_SYNC:
 	case HWTSTAMP_FILTER_PTP_V2_DELAY_REQ:
-		config.rx_filter = HWTSTAMP_FILTER_ALL;
-		regval = xemacps_read(lp->baseaddr, XEMACPS_NWCTRL_OFFSET);
-		xemacps_write(lp->baseaddr, XEMACPS_NWCTRL_OFFSET,
-			(regval | XEMACPS_NWCTRL_RXTSTAMP_MASK));
+		config.rx_filter = HWTSTAMP_FILTER_PTP_V2_EVENT;
 		break;
 	default:
 		return -ERANGE;
 	}
 
+	if (config.rx_filter != HWTSTAMP_FILTER_NONE) {
+		regval = xemacps_read(lp->baseaddr, XEMACPS_NWCTRL_OFFSET);
+		xemacps_write(lp->baseaddr, XEMACPS_NWCTRL_OFFSET,
+			(regval | XEMACPS_NWCTRL_RXTSTAMP_MASK));
+	}
+
 	config.tx_type = HWTSTAMP_TX_ON;
 	lp->hwtstamp_config = config;
 
@@ -2778,6 +4201,35 @@ static int xemacps_hwtstamp_ioctl(struct net_device *netdev,
 }
 #endif /* CONFIG_XILINX_PS_EMAC_HWTSTAMP */
 
+/**
+ * xemacps_set_features - Apply changed offload features
+ * @ndev: network device
+ * @features: new feature set
+ * Return: Always 0
+ *
+ * Only RX checksum offload needs the hardware to be reconfigured; the TX
+ * offloads are handled entirely in the transmit path.
+ */
+static int xemacps_set_features(struct net_device *ndev,
+				netdev_features_t features)
+{
+	struct net_local *lp = netdev_priv(ndev);
+	netdev_features_t changed = features ^ ndev->features;
+	u32 regval;
+
+	if (!(changed & NETIF_F_RXCSUM))
+		return 0;
+
+	regval = xemacps_read(lp->baseaddr, XEMACPS_NWCFG_OFFSET);
+	if (features & NETIF_F_RXCSUM)
+		regval |= XEMACPS_NWCFG_RXCHKSUMEN_MASK;
+	else
+		regval &= ~XEMACPS_NWCFG_RXCHKSUMEN_MASK;
+	xemacps_write(lp->baseaddr, XEMACPS_NWCFG_OFFSET, regval);
+
+	return 0;
+}
+
 /**
  * xemacps_ioctl - ioctl entry point
  * @ndev: network device
@@ -2870,10 +4322,16 @@ static int xemacps_probe(struct platform_device *pdev)
 	ndev->watchdog_timeo = TX_TIMEOUT;
 	ndev->ethtool_ops = &xemacps_ethtool_ops;
 	ndev->base_addr = r_mem->start;
-	ndev->features = NETIF_F_IP_CSUM | NETIF_F_SG;
+	/* TSO is done in software on top of the GEM checksum offload */
+	ndev->hw_features = NETIF_F_IP_CSUM | NETIF_F_SG | NETIF_F_TSO |
+			    NETIF_F_RXCSUM;
+	ndev->features = ndev->hw_features;
+	ndev->priv_flags |= IFF_RX_EARLY_FILTER;
+	lp->tx_ring_size = XEMACPS_SEND_BD_CNT;
+	lp->rx_ring_size = XEMACPS_RECV_BD_CNT;
+	ndev->gso_max_segs = XEMACPS_TSO_MAX_SEGS(lp->tx_ring_size);
 	netif_napi_add(ndev, &lp->napi, xemacps_rx_poll, XEMACPS_NAPI_WEIGHT);
-
-	lp->ip_summed = CHECKSUM_UNNECESSARY;
+	napi_hash_add(&lp->napi);
 
 	rc = register_netdev(ndev);
 	if (rc) {
@@ -2912,6 +4370,8 @@ static int xemacps_probe(struct platform_device *pdev)
 
 	rc = of_property_read_u32(lp->pdev->dev.of_node, "xlnx,has-mdio",
 							&lp->has_mdio);
+	lp->bd_rings_in_ocm = of_property_read_bool(lp->pdev->dev.of_node,
+						    "xlnx,bd-rings-in-ocm");
 	lp->phy_node = of_parse_phandle(lp->pdev->dev.of_node,
 						"phy-handle", 0);
 	lp->gmii2rgmii_phy_node = of_parse_phandle(lp->pdev->dev.of_node,
@@ -2946,6 +4406,15 @@ static int xemacps_probe(struct platform_device *pdev)
 		xemacps_update_hwaddr(lp);
 	}
 
+#ifdef CONFIG_XILINX_PS_EMAC_HWTSTAMP
+	rc = xemacps_ptp_get_gpios(lp);
+	if (rc) {
+		if (rc != -EPROBE_DEFER)
+			dev_err(&lp->pdev->dev, "error in getting PTP pins\n");
+		goto err_out_clk_dis_all;
+	}
+#endif
+
 	tasklet_init(&lp->tx_bdreclaim_tasklet, xemacps_tx_poll,
 		     (unsigned long) ndev);
 	tasklet_disable(&lp->tx_bdreclaim_tasklet);
@@ -2954,6 +4423,8 @@ static int xemacps_probe(struct platform_device *pdev)
 	INIT_WORK(&lp->txtimeout_reinit, xemacps_reinit_for_txtimeout);
 
 	platform_set_drvdata(pdev, ndev);
+
+	device_enable_async_suspend(&pdev->dev);
 	pm_runtime_set_active(&pdev->dev);
 	pm_runtime_enable(&pdev->dev);
 
@@ -2968,6 +4439,11 @@ static int xemacps_probe(struct platform_device *pdev)
 		goto err_out_clk_dis_all;
 	}
 
+#ifdef CONFIG_XILINX_PS_EMAC_CAPTURE
+	if (xemacps_cap_register(lp))
+		dev_warn(&lp->pdev->dev, "capture device not available\n");
+#endif
+
 	return 0;
 
 err_out_clk_dis_all:
@@ -2977,6 +4453,7 @@ err_out_clk_dis_aper:
 err_out_unregister_netdev:
 	unregister_netdev(ndev);
 err_out_free_netdev:
+	napi_hash_del(&lp->napi);
 	free_netdev(ndev);
 
 	return rc;
@@ -2996,12 +4473,17 @@ static int xemacps_remove(struct platform_device *pdev)
 	if (ndev) {
 		lp = netdev_priv(ndev);
 
+#ifdef CONFIG_XILINX_PS_EMAC_CAPTURE
+		if (lp->cap_misc.fops)
+			misc_deregister(&lp->cap_misc);
+#endif
 		if (lp->has_mdio) {
 			mdiobus_unregister(lp->mii_bus);
 			kfree(lp->mii_bus->irq);
 			mdiobus_free(lp->mii_bus);
 		}
 		unregister_netdev(ndev);
+		napi_hash_del(&lp->napi);
 
 		if (!pm_runtime_suspended(&pdev->dev)) {
 			clk_disable_unprepare(lp->devclk);
@@ -3131,6 +4613,10 @@ static struct net_device_ops netdev_ops = {
 	.ndo_change_mtu		= eth_change_mtu,
 	.ndo_tx_timeout		= xemacps_tx_timeout,
 	.ndo_get_stats		= xemacps_get_stats,
+	.ndo_set_features	= xemacps_set_features,
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	.ndo_busy_poll		= xemacps_busy_poll,
+#endif
 };
 
 static struct of_device_id xemacps_of_match[] = {
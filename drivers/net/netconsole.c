@@ -47,6 +47,10 @@
 #include <linux/netpoll.h>
 #include <linux/inet.h>
 #include <linux/configfs.h>
+#include <linux/etherdevice.h>
+#include <linux/irq_work.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
 
 MODULE_AUTHOR("Maintainer: Matt Mackall <mpm@selenic.com>");
 MODULE_DESCRIPTION("Console driver for network interfaces");
@@ -54,6 +58,7 @@ MODULE_LICENSE("GPL");
 
 #define MAX_PARAM_LENGTH	256
 #define MAX_PRINT_CHUNK		1000
+#define ASYNC_BUF_SIZE		8192
 
 static char config[MAX_PARAM_LENGTH];
 module_param_string(netconsole, config, MAX_PARAM_LENGTH, 0);
@@ -63,6 +68,10 @@ static bool oops_only = false;
 module_param(oops_only, bool, 0600);
 MODULE_PARM_DESC(oops_only, "Only log oops messages");
 
+static bool async;
+module_param(async, bool, 0444);
+MODULE_PARM_DESC(async, "Send messages in batches from a work item");
+
 #ifndef	MODULE
 static int __init option_setup(char *opt)
 {
@@ -728,6 +737,163 @@ static struct notifier_block netconsole_netdev_notifier = {
 	.notifier_call  = netconsole_netdev_event,
 };
 
+/*
+ * Asynchronous mode: write_msg() only appends to a buffer of the local
+ * CPU, and a work item packs the buffered lines into frames of up to
+ * MAX_PRINT_CHUNK bytes and queues them to the devices like any other
+ * traffic, without netpoll's polling of the device. Lines of different
+ * CPUs may thus be reordered, and lines not yet sent are lost in a
+ * crash; oopses are therefore still sent synchronously.
+ */
+struct netconsole_async_buf {
+	spinlock_t		lock;
+	unsigned int		len;
+	unsigned long		dropped;
+	char			data[ASYNC_BUF_SIZE];
+};
+
+static struct netconsole_async_buf __percpu *async_bufs;
+static char async_flush_buf[ASYNC_BUF_SIZE];
+
+static void send_async_chunk(const char *msg, unsigned int len)
+{
+	struct sk_buff_head frames;
+	struct netconsole_target *nt;
+	struct sk_buff *skb;
+	unsigned long flags;
+
+	__skb_queue_head_init(&frames);
+
+	spin_lock_irqsave(&target_list_lock, flags);
+	list_for_each_entry(nt, &target_list, list) {
+		if (!nt->enabled || !netif_running(nt->np.dev))
+			continue;
+		skb = netpoll_alloc_udp(&nt->np, msg, len, GFP_ATOMIC);
+		if (!skb)
+			continue;
+		/* the device must outlive the frame until it is queued */
+		dev_hold(skb->dev);
+		__skb_queue_tail(&frames, skb);
+	}
+	spin_unlock_irqrestore(&target_list_lock, flags);
+
+	while ((skb = __skb_dequeue(&frames))) {
+		struct net_device *dev = skb->dev;
+
+		dev_queue_xmit(skb);
+		dev_put(dev);
+	}
+}
+
+static void flush_async_buf(struct netconsole_async_buf *ab)
+{
+	unsigned long flags, dropped;
+	unsigned int len, frag;
+	const char *tmp;
+
+	spin_lock_irqsave(&ab->lock, flags);
+	len = ab->len;
+	memcpy(async_flush_buf, ab->data, len);
+	dropped = ab->dropped;
+	ab->len = 0;
+	ab->dropped = 0;
+	spin_unlock_irqrestore(&ab->lock, flags);
+
+	for (tmp = async_flush_buf; len; tmp += frag, len -= frag) {
+		frag = min_t(unsigned int, len, MAX_PRINT_CHUNK);
+		/* prefer to end frames at line boundaries */
+		if (frag < len) {
+			unsigned int nl = frag;
+
+			while (nl && tmp[nl - 1] != '\n')
+				nl--;
+			if (nl)
+				frag = nl;
+		}
+		send_async_chunk(tmp, frag);
+	}
+
+	if (dropped) {
+		char note[64];
+
+		len = scnprintf(note, sizeof(note),
+				"netconsole: %lu messages dropped\n", dropped);
+		send_async_chunk(note, len);
+	}
+}
+
+static void flush_async_work_func(struct work_struct *work)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		flush_async_buf(per_cpu_ptr(async_bufs, cpu));
+}
+
+static DECLARE_WORK(flush_async_work, flush_async_work_func);
+
+/* write_msg() may be called with scheduler locks held */
+static void flush_async_irq_work_func(struct irq_work *irq_work)
+{
+	schedule_work(&flush_async_work);
+}
+
+static DEFINE_PER_CPU(struct irq_work, flush_async_irq_work) = {
+	.func = flush_async_irq_work_func,
+};
+
+static void write_msg_async(const char *msg, unsigned int len)
+{
+	struct netconsole_async_buf *ab;
+	unsigned long flags;
+	bool kick = false;
+
+	local_irq_save(flags);
+	ab = this_cpu_ptr(async_bufs);
+	spin_lock(&ab->lock);
+	if (ab->len + len <= ASYNC_BUF_SIZE) {
+		kick = !ab->len;
+		memcpy(ab->data + ab->len, msg, len);
+		ab->len += len;
+	} else {
+		ab->dropped++;
+	}
+	spin_unlock(&ab->lock);
+	if (kick)
+		irq_work_queue(this_cpu_ptr(&flush_async_irq_work));
+	local_irq_restore(flags);
+}
+
+static int __init init_async(void)
+{
+	int cpu;
+
+	async_bufs = alloc_percpu(struct netconsole_async_buf);
+	if (!async_bufs)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct netconsole_async_buf *ab = per_cpu_ptr(async_bufs, cpu);
+
+		spin_lock_init(&ab->lock);
+		ab->len = 0;
+		ab->dropped = 0;
+	}
+
+	return 0;
+}
+
+static void cleanup_async(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		irq_work_sync(per_cpu_ptr(&flush_async_irq_work, cpu));
+	cancel_work_sync(&flush_async_work);
+	free_percpu(async_bufs);
+	async_bufs = NULL;
+}
+
 static void write_msg(struct console *con, const char *msg, unsigned int len)
 {
 	int frag, left;
@@ -741,6 +907,11 @@ static void write_msg(struct console *con, const char *msg, unsigned int len)
 	if (list_empty(&target_list))
 		return;
 
+	if (async_bufs && !oops_in_progress) {
+		write_msg_async(msg, len);
+		return;
+	}
+
 	spin_lock_irqsave(&target_list_lock, flags);
 	list_for_each_entry(nt, &target_list, list) {
 		netconsole_target_get(nt);
@@ -778,6 +949,12 @@ static int __init init_netconsole(void)
 	char *target_config;
 	char *input = config;
 
+	if (async) {
+		err = init_async();
+		if (err)
+			return err;
+	}
+
 	if (strnlen(input, MAX_PARAM_LENGTH)) {
 		while ((target_config = strsep(&input, ";"))) {
 			nt = alloc_param_target(target_config);
@@ -823,6 +1000,9 @@ fail:
 		free_param_target(nt);
 	}
 
+	if (async_bufs)
+		cleanup_async();
+
 	return err;
 }
 
@@ -831,6 +1011,8 @@ static void __exit cleanup_netconsole(void)
 	struct netconsole_target *nt, *tmp;
 
 	unregister_console(&netconsole);
+	if (async_bufs)
+		cleanup_async();
 	dynamic_netconsole_exit();
 	unregister_netdevice_notifier(&netconsole_netdev_notifier);
 
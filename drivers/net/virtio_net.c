@@ -795,19 +795,17 @@ static int virtnet_busy_poll(struct napi_struct *napi)
 	virtqueue_disable_cb(rq->vq);
 
 again:
-	received += virtnet_receive(rq, budget);
+	received += virtnet_receive(rq, budget - received);
 
 	r = virtqueue_enable_cb_prepare(rq->vq);
 	clear_bit(NAPI_STATE_SCHED, &napi->state);
 	if (unlikely(virtqueue_poll(rq->vq, r)) &&
 	    napi_schedule_prep(napi)) {
 		virtqueue_disable_cb(rq->vq);
-		if (received < budget) {
-			budget -= received;
+		if (received < budget)
 			goto again;
-		} else {
+		else
 			__napi_schedule(napi);
-		}
 	}
 
 	return received;
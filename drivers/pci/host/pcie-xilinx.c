@@ -104,7 +104,8 @@
  * @msi_pages: MSI pages
  * @root_busno: Root Bus number
  * @dev: Device pointer
- * @irq_domain: IRQ domain pointer
+ * @irq_domain: INTx IRQ domain pointer
+ * @msi_domain: MSI IRQ domain pointer
  * @bus_range: Bus range
  * @resources: Bus Resources
  */
@@ -115,6 +116,7 @@ struct xilinx_pcie_port {
 	u8 root_busno;
 	struct device *dev;
 	struct irq_domain *irq_domain;
+	struct irq_domain *msi_domain;
 	struct resource bus_range;
 	struct list_head resources;
 };
@@ -300,15 +302,17 @@ static void xilinx_pcie_destroy_msi(unsigned int irq)
 	struct irq_desc *desc;
 	struct msi_desc *msi;
 	struct xilinx_pcie_port *port;
+	irq_hw_number_t hwirq;
 
 	desc = irq_to_desc(irq);
 	msi = irq_desc_get_msi_desc(desc);
 	port = sys_to_pcie(msi->dev->bus->sysdata);
+	hwirq = irqd_to_hwirq(irq_desc_get_irq_data(desc));
 
-	if (!test_bit(irq, msi_irq_in_use))
-		dev_err(port->dev, "Trying to free unused MSI#%d\n", irq);
+	if (!test_bit(hwirq, msi_irq_in_use))
+		dev_err(port->dev, "Trying to free unused MSI#%lu\n", hwirq);
 	else
-		clear_bit(irq, msi_irq_in_use);
+		clear_bit(hwirq, msi_irq_in_use);
 }
 
 /**
@@ -338,6 +342,7 @@ static int xilinx_pcie_assign_msi(struct xilinx_pcie_port *port)
 static void xilinx_msi_teardown_irq(struct msi_chip *chip, unsigned int irq)
 {
 	xilinx_pcie_destroy_msi(irq);
+	irq_dispose_mapping(irq);
 }
 
 /**
@@ -362,9 +367,11 @@ static int xilinx_pcie_msi_setup_irq(struct msi_chip *chip,
 	if (hwirq < 0)
 		return hwirq;
 
-	irq = irq_create_mapping(port->irq_domain, hwirq);
-	if (!irq)
+	irq = irq_create_mapping(port->msi_domain, hwirq);
+	if (!irq) {
+		clear_bit(hwirq, msi_irq_in_use);
 		return -EINVAL;
+	}
 
 	irq_set_msi_desc(irq, desc);
 
@@ -372,7 +379,8 @@ static int xilinx_pcie_msi_setup_irq(struct msi_chip *chip,
 
 	msg.address_hi = 0;
 	msg.address_lo = msg_addr;
-	msg.data = irq;
+	/* The Root Port queues the data, it identifies the vector */
+	msg.data = hwirq;
 
 	write_msi_msg(irq, &msg);
 
@@ -472,6 +480,48 @@ static const struct irq_domain_ops intx_domain_ops = {
 
 /* PCIe HW Functions */
 
+/**
+ * xilinx_pcie_handle_intr_fifo - Dispatch queued INTx and MSI interrupts
+ * @port: PCIe port information
+ *
+ * Drains the whole Root Port Interrupt FIFO, so a burst of messages from
+ * the queues of several endpoints costs a single bridge interrupt rather
+ * than one per message.
+ */
+static void xilinx_pcie_handle_intr_fifo(struct xilinx_pcie_port *port)
+{
+	u32 val, msi_data = 0;
+
+	for (;;) {
+		val = pcie_read(port, XILINX_PCIE_REG_RPIFR1);
+
+		/* Check whether the FIFO is empty */
+		if (!(val & XILINX_PCIE_RPIFR1_INTR_VALID))
+			break;
+
+		if (val & XILINX_PCIE_RPIFR1_MSI_INTR)
+			msi_data = pcie_read(port, XILINX_PCIE_REG_RPIFR2) &
+				   XILINX_PCIE_RPIFR2_MSG_DATA;
+
+		/* Clear interrupt FIFO register 1 to pop the entry */
+		pcie_write(port, XILINX_PCIE_RPIFR1_ALL_MASK,
+			   XILINX_PCIE_REG_RPIFR1);
+
+		if (val & XILINX_PCIE_RPIFR1_MSI_INTR) {
+			/* Handle MSI Interrupt */
+			if (IS_ENABLED(CONFIG_PCI_MSI))
+				generic_handle_irq(irq_find_mapping(
+						port->msi_domain, msi_data));
+		} else {
+			/* Handle INTx Interrupt */
+			val = ((val & XILINX_PCIE_RPIFR1_INTR_MASK) >>
+				XILINX_PCIE_RPIFR1_INTR_SHIFT) + 1;
+			generic_handle_irq(irq_find_mapping(port->irq_domain,
+							    val));
+		}
+	}
+}
+
 /**
  * xilinx_pcie_intr_handler - Interrupt Service Handler
  * @irq: IRQ number
@@ -482,7 +532,7 @@ static const struct irq_domain_ops intx_domain_ops = {
 static irqreturn_t xilinx_pcie_intr_handler(int irq, void *data)
 {
 	struct xilinx_pcie_port *port = (struct xilinx_pcie_port *)data;
-	u32 val, mask, status, msi_data;
+	u32 val, mask, status, fifo;
 
 	/* Read interrupt decode and mask registers */
 	val = pcie_read(port, XILINX_PCIE_REG_IDR);
@@ -522,48 +572,14 @@ static irqreturn_t xilinx_pcie_intr_handler(int irq, void *data)
 		xilinx_pcie_clear_err_interrupts(port);
 	}
 
-	if (status & XILINX_PCIE_INTR_INTX) {
-		/* INTx interrupt received */
-		val = pcie_read(port, XILINX_PCIE_REG_RPIFR1);
-
-		/* Check whether interrupt valid */
-		if (!(val & XILINX_PCIE_RPIFR1_INTR_VALID)) {
-			dev_warn(port->dev, "RP Intr FIFO1 read error\n");
-			return IRQ_HANDLED;
-		}
-
-		/* Clear interrupt FIFO register 1 */
-		pcie_write(port, XILINX_PCIE_RPIFR1_ALL_MASK,
-			   XILINX_PCIE_REG_RPIFR1);
-
-		/* Handle INTx Interrupt */
-		val = ((val & XILINX_PCIE_RPIFR1_INTR_MASK) >>
-			XILINX_PCIE_RPIFR1_INTR_SHIFT) + 1;
-		generic_handle_irq(irq_find_mapping(port->irq_domain, val));
-	}
-
-	if (status & XILINX_PCIE_INTR_MSI) {
-		/* MSI Interrupt */
-		val = pcie_read(port, XILINX_PCIE_REG_RPIFR1);
-
-		if (!(val & XILINX_PCIE_RPIFR1_INTR_VALID)) {
-			dev_warn(port->dev, "RP Intr FIFO1 read error\n");
-			return IRQ_HANDLED;
-		}
-
-		if (val & XILINX_PCIE_RPIFR1_MSI_INTR) {
-			msi_data = pcie_read(port, XILINX_PCIE_REG_RPIFR2) &
-				   XILINX_PCIE_RPIFR2_MSG_DATA;
-
-			/* Clear interrupt FIFO register 1 */
-			pcie_write(port, XILINX_PCIE_RPIFR1_ALL_MASK,
-				   XILINX_PCIE_REG_RPIFR1);
-
-			if (IS_ENABLED(CONFIG_PCI_MSI)) {
-				/* Handle MSI Interrupt */
-				generic_handle_irq(msi_data);
-			}
-		}
+	fifo = status & (XILINX_PCIE_INTR_INTX | XILINX_PCIE_INTR_MSI);
+	if (fifo) {
+		/*
+		 * Clear the decode bits before draining the FIFO, a message
+		 * queued behind the last entry read sets them again.
+		 */
+		pcie_write(port, fifo, XILINX_PCIE_REG_IDR);
+		xilinx_pcie_handle_intr_fifo(port);
 	}
 
 	if (status & XILINX_PCIE_INTR_SLV_UNSUPP)
@@ -594,7 +610,7 @@ static irqreturn_t xilinx_pcie_intr_handler(int irq, void *data)
 		dev_warn(port->dev, "Master error poison\n");
 
 	/* Clear the Interrupt Decode register */
-	pcie_write(port, status, XILINX_PCIE_REG_IDR);
+	pcie_write(port, status & ~fifo, XILINX_PCIE_REG_IDR);
 
 	return IRQ_HANDLED;
 }
@@ -606,20 +622,24 @@ static irqreturn_t xilinx_pcie_intr_handler(int irq, void *data)
 static void xilinx_pcie_free_irq_domain(struct xilinx_pcie_port *port)
 {
 	int i;
-	u32 irq, num_irqs;
+	u32 irq;
 
 	/* Free IRQ Domain */
 	if (IS_ENABLED(CONFIG_PCI_MSI)) {
 
 		free_pages(port->msi_pages, 0);
 
-		num_irqs = XILINX_NUM_MSI_IRQS;
-	} else {
-		/* INTx */
-		num_irqs = 4;
+		for (i = 0; i < XILINX_NUM_MSI_IRQS; i++) {
+			irq = irq_find_mapping(port->msi_domain, i);
+			if (irq > 0)
+				irq_dispose_mapping(irq);
+		}
+
+		irq_domain_remove(port->msi_domain);
 	}
 
-	for (i = 0; i < num_irqs; i++) {
+	/* INTx, INTA to INTD are hardware IRQs 1 to 4 */
+	for (i = 1; i <= 4; i++) {
 		irq = irq_find_mapping(port->irq_domain, i);
 		if (irq > 0)
 			irq_dispose_mapping(irq);
@@ -657,13 +677,14 @@ static int xilinx_pcie_init_irq_domain(struct xilinx_pcie_port *port)
 
 	/* Setup MSI */
 	if (IS_ENABLED(CONFIG_PCI_MSI)) {
-		port->irq_domain = irq_domain_add_linear(node,
+		port->msi_domain = irq_domain_add_linear(node,
 							 XILINX_NUM_MSI_IRQS,
 							 &msi_domain_ops,
 							 &xilinx_pcie_msi_chip);
-		if (!port->irq_domain) {
+		if (!port->msi_domain) {
 			dev_err(dev, "Failed to get a MSI IRQ domain\n");
-			return PTR_ERR(port->irq_domain);
+			irq_domain_remove(port->irq_domain);
+			return -ENOMEM;
 		}
 
 		xilinx_pcie_enable_msi(port);
@@ -62,15 +62,21 @@ struct zynq_rproc_pdata {
 static struct platform_device *remoteprocdev;
 static struct work_struct workqueue;
 
+/*
+ * The vrings and the rpmsg buffers are allocated from the coherent memory
+ * declared in probe, which is mapped uncached, so no cache maintenance is
+ * needed here. Kicks raised while the work is pending are coalesced into a
+ * single run, which drains both vrings.
+ */
 static void handle_event(struct work_struct *work)
 {
 	struct zynq_rproc_pdata *local = platform_get_drvdata(remoteprocdev);
 
-	flush_cache_all();
-	outer_flush_range(local->mem_start, local->mem_end);
-
 	if (rproc_vq_interrupt(local->rproc, 0) == IRQ_NONE)
 		dev_dbg(&remoteprocdev->dev, "no message found in vqid 0\n");
+
+	/* Wakes up senders waiting for a TX buffer, if any */
+	rproc_vq_interrupt(local->rproc, 1);
 }
 
 static void ipi_kick(void)
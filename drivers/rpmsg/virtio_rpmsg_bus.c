@@ -784,6 +784,72 @@ out:
 }
 EXPORT_SYMBOL(rpmsg_send_offchannel_raw);
 
+/**
+ * rpmsg_alloc_shm() - allocate a buffer shared with the remote processor
+ * @rpdev: the rpmsg channel
+ * @size: size of the buffer, in bytes
+ * @da: returns the address of the buffer as seen by the remote processor
+ *
+ * Payloads larger than an rpmsg buffer can be passed by reference instead
+ * of being copied through many messages: the buffer is filled in place and
+ * only its address and length are sent, e.g. as a struct rpmsg_shm_desc.
+ *
+ * The buffer is allocated from the same memory as the rpmsg buffers, so
+ * the remote processor can access it at @da.
+ *
+ * Returns the kernel address of the buffer, or NULL on failure.
+ */
+void *rpmsg_alloc_shm(struct rpmsg_channel *rpdev, size_t size,
+		      dma_addr_t *da)
+{
+	struct virtio_device *vdev = rpdev->vrp->vdev;
+
+	return dma_alloc_coherent(vdev->dev.parent->parent, size, da,
+				  GFP_KERNEL);
+}
+EXPORT_SYMBOL(rpmsg_alloc_shm);
+
+/**
+ * rpmsg_free_shm() - free a buffer allocated with rpmsg_alloc_shm()
+ * @rpdev: the rpmsg channel
+ * @size: size of the buffer, in bytes
+ * @va: kernel address of the buffer
+ * @da: address of the buffer as seen by the remote processor
+ *
+ * The remote processor must not access the buffer anymore.
+ */
+void rpmsg_free_shm(struct rpmsg_channel *rpdev, size_t size, void *va,
+		    dma_addr_t da)
+{
+	struct virtio_device *vdev = rpdev->vrp->vdev;
+
+	dma_free_coherent(vdev->dev.parent->parent, size, va, da);
+}
+EXPORT_SYMBOL(rpmsg_free_shm);
+
+/**
+ * rpmsg_shm_da_to_va() - look up a buffer passed by the remote processor
+ * @rpdev: the rpmsg channel
+ * @da: address of the buffer as seen by the remote processor
+ * @len: length of the buffer, in bytes
+ *
+ * This is the receiving side of buffers passed by reference by the remote
+ * processor, when they live in one of its carveouts.
+ *
+ * Returns the kernel address of the buffer, or NULL if [@da, @da + @len)
+ * isn't entirely within a carveout.
+ */
+void *rpmsg_shm_da_to_va(struct rpmsg_channel *rpdev, u32 da, u32 len)
+{
+	struct rproc *rproc = vdev_to_rproc(rpdev->vrp->vdev);
+
+	if (len > INT_MAX)
+		return NULL;
+
+	return rproc_da_to_va(rproc, da, len);
+}
+EXPORT_SYMBOL(rpmsg_shm_da_to_va);
+
 static int rpmsg_recv_single(struct virtproc_info *vrp, struct device *dev,
 			     struct rpmsg_hdr *msg, unsigned int len)
 {
@@ -860,7 +926,7 @@ static void rpmsg_recv_done(struct virtqueue *rvq)
 	struct device *dev = &rvq->vdev->dev;
 	struct rpmsg_hdr *msg;
 	unsigned int len, msgs_received = 0;
-	int err;
+	int err = 0;
 
 	msg = virtqueue_get_buf(rvq, &len);
 	if (!msg) {
@@ -868,15 +934,30 @@ static void rpmsg_recv_done(struct virtqueue *rvq)
 		return;
 	}
 
-	while (msg) {
-		err = rpmsg_recv_single(vrp, dev, msg, len);
-		if (err)
-			break;
+	/*
+	 * Ask the remote processor not to signal us while we drain the
+	 * ring, the messages it posts meanwhile are handled by this loop.
+	 */
+	virtqueue_disable_cb(rvq);
+
+	for (;;) {
+		while (msg) {
+			err = rpmsg_recv_single(vrp, dev, msg, len);
+			if (err)
+				break;
 
-		msgs_received++;
+			msgs_received++;
 
+			msg = virtqueue_get_buf(rvq, &len);
+		}
+
+		/* re-enable signals, unless a message raced with us */
+		if (virtqueue_enable_cb(rvq) || err)
+			break;
+
+		virtqueue_disable_cb(rvq);
 		msg = virtqueue_get_buf(rvq, &len);
-	};
+	}
 
 	dev_dbg(dev, "Received %u messages\n", msgs_received);
 
@@ -11,13 +11,18 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/dma-mapping.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/of_irq.h>
 #include <linux/of_address.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 #include <linux/spi/spi.h>
 #include <linux/spinlock.h>
 #include <linux/workqueue.h>
@@ -40,9 +45,14 @@
 #define GQSPI_SEL_OFST			0x00000144
 #define GQSPI_GF_THRESHOLD_OFST		0X00000150
 #define GQSPI_FIFO_CTRL_OFST		0X0000014C
+#define GQSPI_QSPIDMA_DST_ADDR_OFST	0X00000800
+#define GQSPI_QSPIDMA_DST_SIZE_OFST	0X00000804
 #define GQSPI_QSPIDMA_DST_STS_OFST	0X00000808
+#define GQSPI_QSPIDMA_DST_CTRL_OFST	0X0000080C
 #define GQSPI_QSPIDMA_DST_I_STS_OFST	0X00000814
+#define GQSPI_QSPIDMA_DST_I_EN_OFST	0X00000818
 #define GQSPI_QSPIDMA_DST_I_DIS_OFST	0X0000081C
+#define GQSPI_QSPIDMA_DST_ADDR_MSB_OFST	0X00000828
 
 /* GQSPI Register Bit masks */
 #define GQSPI_SEL_MASK				0X00000001
@@ -51,6 +61,7 @@
 #define GQSPI_ISR_WR_TO_CLR_MASK		0X00000002
 #define GQSPI_IDR_ALL_MASK			0X00000FBE
 #define GQSPI_CFG_MODE_EN_MASK			0XC0000000
+#define GQSPI_CFG_MODE_EN_DMA_MASK		0X80000000
 #define GQSPI_CFG_GEN_FIFO_START_MODE_MASK	0X20000000
 #define GQSPI_CFG_ENDIAN_MASK			0X04000000
 #define GQSPI_CFG_EN_POLL_TO_MASK		0X00100000
@@ -98,6 +109,9 @@
 #define GQSPI_IER_TXEMPTY_MASK			0X00000100
 #define GQSPI_QSPIDMA_DST_INTR_ALL_MASK		0X000000FE
 #define GQSPI_QSPIDMA_DST_STS_WTC		0x0000E000
+#define GQSPI_QSPIDMA_DST_I_STS_DONE_MASK	0X00000002
+#define GQSPI_QSPIDMA_DST_I_EN_DONE_MASK	0X00000002
+#define GQSPI_QSPIDMA_DST_CTRL_RESET_VAL	0X803FFA00
 #define GQSPI_ISR_IDR_MASK			0x00000990
 
 #define GQSPI_CFG_BAUD_RATE_DIV_SHIFT		3
@@ -118,6 +132,34 @@
 #define GQSPI_SELECT_MODE_SPI		0x1
 #define GQSPI_SELECT_MODE_DUALSPI	0x2
 #define GQSPI_SELECT_MODE_QUADSPI	0x4
+#define GQSPI_DMA_UNALIGN		0x3
+#define GQSPI_DMA_ADDR_MSB_MASK		0xFFF
+#define GQSPI_DMA_THRESHOLD		64 /* Default RX DMA threshold */
+
+enum zynqmp_qspi_mode {
+	GQSPI_MODE_IO,
+	GQSPI_MODE_DMA,
+};
+
+/* Transfer statistics classes */
+enum zynqmp_qspi_stat {
+	GQSPI_STAT_TX,
+	GQSPI_STAT_RX_IO,
+	GQSPI_STAT_RX_DMA,
+	GQSPI_STAT_NUM,
+};
+
+/**
+ * struct zynqmp_qspi_stats - Accumulated transfer statistics
+ * @transfers:	Number of transfers
+ * @bytes:	Number of bytes moved
+ * @time_ns:	Time from starting the transfers until their completion
+ */
+struct zynqmp_qspi_stats {
+	u64 transfers;
+	u64 bytes;
+	u64 time_ns;
+};
 
 /* Default number of chip selects */
 #define GQSPI_DEFAULT_NUM_CS	1
@@ -135,6 +177,17 @@
  * @bytes_to_receive:	Number of bytes left to receive
  * @genfifocs:		Used for chip select
  * @genfifobus:		USed to select the upper or lower bus
+ * @mode:		Mode the RX path of the current transfer runs in
+ * @dma_addr:		DMA address of the RX buffer
+ * @dma_rx_bytes:	Number of bytes received by the DMA
+ * @genfifoentry:	GENFIFO entry of the current transfer, without length
+ * @dma_threshold:	RX transfers of at least this many bytes use the DMA
+ * @xfer_start:		Start time of the current transfer
+ * @xfer_len:		Length of the current transfer
+ * @xfer_stat:		Statistics class of the current transfer
+ * @stats_lock:		Protects @stats
+ * @stats:		Transfer statistics
+ * @debugfs:		debugfs directory of the controller
  */
 struct zynqmp_qspi {
 	void __iomem *regs;
@@ -148,6 +201,17 @@ struct zynqmp_qspi {
 	int bytes_to_receive;
 	u32 genfifocs;
 	u32 genfifobus;
+	enum zynqmp_qspi_mode mode;
+	dma_addr_t dma_addr;
+	u32 dma_rx_bytes;
+	u32 genfifoentry;
+	u32 dma_threshold;
+	ktime_t xfer_start;
+	u32 xfer_len;
+	enum zynqmp_qspi_stat xfer_stat;
+	spinlock_t stats_lock;
+	struct zynqmp_qspi_stats stats[GQSPI_STAT_NUM];
+	struct dentry *debugfs;
 };
 
 /* functions for the GQSPI controller read/write */
@@ -237,10 +301,14 @@ static void zynqmp_qspi_init_hw(struct zynqmp_qspi *xqspi)
 	zynqmp_gqspi_write(xqspi,
 			   GQSPI_QSPIDMA_DST_I_DIS_OFST,
 			   GQSPI_QSPIDMA_DST_INTR_ALL_MASK);
+	zynqmp_gqspi_write(xqspi, GQSPI_QSPIDMA_DST_CTRL_OFST,
+			   GQSPI_QSPIDMA_DST_CTRL_RESET_VAL);
 	/* Disable the GQSPI */
 	zynqmp_gqspi_write(xqspi, GQSPI_EN_OFST, 0x00);
 	config_reg = zynqmp_gqspi_read(xqspi, GQSPI_CONFIG_OFST);
+	/* IO mode, RX transfers switch to DMA as needed */
 	config_reg &= ~GQSPI_CFG_MODE_EN_MASK;
+	xqspi->mode = GQSPI_MODE_IO;
 	/* Manual start */
 	config_reg |= GQSPI_CFG_GEN_FIFO_START_MODE_MASK;
 	/* Little endain by default */
@@ -481,6 +549,126 @@ static void zynqmp_qspi_readrxfifo(struct zynqmp_qspi *xqspi, u32 size)
 	}
 }
 
+/**
+ * zynqmp_qspi_setmode - Route the RX data through the RX FIFO or the DMA
+ * @xqspi:	Pointer to the zynqmp_qspi structure
+ * @mode:	GQSPI_MODE_IO or GQSPI_MODE_DMA
+ */
+static void zynqmp_qspi_setmode(struct zynqmp_qspi *xqspi,
+				enum zynqmp_qspi_mode mode)
+{
+	u32 config_reg;
+
+	config_reg = zynqmp_gqspi_read(xqspi, GQSPI_CONFIG_OFST);
+	config_reg &= ~GQSPI_CFG_MODE_EN_MASK;
+	if (mode == GQSPI_MODE_DMA)
+		config_reg |= GQSPI_CFG_MODE_EN_DMA_MASK;
+	zynqmp_gqspi_write(xqspi, GQSPI_CONFIG_OFST, config_reg);
+
+	xqspi->mode = mode;
+}
+
+/**
+ * zynqmp_qspi_setuprxdma - Set up the DMA for an RX transfer if it pays off
+ * @xqspi:	Pointer to the zynqmp_qspi structure
+ *
+ * The DMA moves whole words into a word aligned, physically contiguous
+ * buffer. Short transfers and other buffers stay in IO mode; if the length
+ * is not a multiple of four, the tail is read from the RX FIFO once the DMA
+ * is done.
+ */
+static void zynqmp_qspi_setuprxdma(struct zynqmp_qspi *xqspi)
+{
+	u32 rx_bytes;
+	dma_addr_t addr;
+
+	xqspi->dma_rx_bytes = 0;
+	rx_bytes = xqspi->bytes_to_receive & ~GQSPI_DMA_UNALIGN;
+
+	if (!xqspi->dma_threshold ||
+	    xqspi->bytes_to_receive < xqspi->dma_threshold ||
+	    !rx_bytes ||
+	    ((unsigned long)xqspi->rxbuf & GQSPI_DMA_UNALIGN) ||
+	    !virt_addr_valid(xqspi->rxbuf) ||
+	    !virt_addr_valid(xqspi->rxbuf + rx_bytes - 1)) {
+		zynqmp_qspi_setmode(xqspi, GQSPI_MODE_IO);
+		return;
+	}
+
+	addr = dma_map_single(xqspi->dev, xqspi->rxbuf, rx_bytes,
+			      DMA_FROM_DEVICE);
+	if (dma_mapping_error(xqspi->dev, addr)) {
+		zynqmp_qspi_setmode(xqspi, GQSPI_MODE_IO);
+		return;
+	}
+
+	xqspi->dma_rx_bytes = rx_bytes;
+	xqspi->dma_addr = addr;
+	zynqmp_gqspi_write(xqspi, GQSPI_QSPIDMA_DST_ADDR_OFST,
+			   lower_32_bits(addr));
+	zynqmp_gqspi_write(xqspi, GQSPI_QSPIDMA_DST_ADDR_MSB_OFST,
+			   upper_32_bits(addr) & GQSPI_DMA_ADDR_MSB_MASK);
+
+	zynqmp_qspi_setmode(xqspi, GQSPI_MODE_DMA);
+
+	zynqmp_gqspi_write(xqspi, GQSPI_QSPIDMA_DST_SIZE_OFST, rx_bytes);
+}
+
+/**
+ * zynqmp_qspi_dma_done - Handle the completion of the RX DMA
+ * @xqspi:	Pointer to the zynqmp_qspi structure
+ *
+ * Unmaps the buffer and, if the transfer did not end on a word boundary,
+ * starts reading the remaining bytes in IO mode.
+ */
+static void zynqmp_qspi_dma_done(struct zynqmp_qspi *xqspi)
+{
+	u32 genfifoentry;
+
+	dma_unmap_single(xqspi->dev, xqspi->dma_addr, xqspi->dma_rx_bytes,
+			 DMA_FROM_DEVICE);
+	xqspi->rxbuf += xqspi->dma_rx_bytes;
+	xqspi->bytes_to_receive -= xqspi->dma_rx_bytes;
+	xqspi->dma_rx_bytes = 0;
+
+	zynqmp_gqspi_write(xqspi, GQSPI_QSPIDMA_DST_I_DIS_OFST,
+			   GQSPI_QSPIDMA_DST_I_EN_DONE_MASK);
+
+	if (xqspi->bytes_to_receive > 0) {
+		zynqmp_qspi_setmode(xqspi, GQSPI_MODE_IO);
+
+		genfifoentry = xqspi->genfifoentry;
+		genfifoentry |= xqspi->bytes_to_receive;
+		zynqmp_gqspi_write(xqspi, GQSPI_GEN_FIFO_OFST, genfifoentry);
+
+		/* Since we are using maual mode */
+		zynqmp_gqspi_write(xqspi, GQSPI_CONFIG_OFST,
+				   zynqmp_gqspi_read(xqspi, GQSPI_CONFIG_OFST) |
+				   GQSPI_CFG_START_GEN_FIFO_MASK);
+
+		zynqmp_gqspi_write(xqspi, GQSPI_IER_OFST,
+				   GQSPI_IER_GENFIFOEMPTY_MASK |
+				   GQSPI_IER_RXNEMPTY_MASK |
+				   GQSPI_IER_RXEMPTY_MASK);
+	}
+}
+
+/**
+ * zynqmp_qspi_account - Add the finished transfer to the statistics
+ * @xqspi:	Pointer to the zynqmp_qspi structure
+ */
+static void zynqmp_qspi_account(struct zynqmp_qspi *xqspi)
+{
+	struct zynqmp_qspi_stats *stats = &xqspi->stats[xqspi->xfer_stat];
+	s64 delta = ktime_to_ns(ktime_sub(ktime_get(), xqspi->xfer_start));
+
+	spin_lock(&xqspi->stats_lock);
+	stats->transfers++;
+	stats->bytes += xqspi->xfer_len;
+	stats->time_ns += delta;
+	spin_unlock(&xqspi->stats_lock);
+}
+
 /**
  * zynqmp_qspi_irq - Interrupt service routine of the QSPI controller
  * @irq:	IRQ number
@@ -497,15 +685,27 @@ static irqreturn_t zynqmp_qspi_irq(int irq, void *dev_id)
 	struct spi_master *master = dev_id;
 	struct zynqmp_qspi *xqspi = spi_master_get_devdata(master);
 	int ret = IRQ_NONE;
-	u32 status;
+	u32 status, dma_status = 0;
 
 	status = readl(xqspi->regs + GQSPI_ISR_OFST);
 
+	if (xqspi->mode == GQSPI_MODE_DMA) {
+		dma_status = zynqmp_gqspi_read(xqspi,
+					       GQSPI_QSPIDMA_DST_I_STS_OFST);
+		zynqmp_gqspi_write(xqspi, GQSPI_QSPIDMA_DST_I_STS_OFST,
+				   dma_status);
+	}
+
 	if (status & GQSPI_ISR_TXEMPTY_MASK) {
 		zynqmp_qspi_filltxfifo(xqspi, GQSPI_TXD_DEPTH);
 		ret = IRQ_HANDLED;
 	}
-	if (status & GQSPI_IER_RXNEMPTY_MASK) {
+	if (dma_status & GQSPI_QSPIDMA_DST_I_STS_DONE_MASK) {
+		zynqmp_qspi_dma_done(xqspi);
+		ret = IRQ_HANDLED;
+	} else if (xqspi->mode == GQSPI_MODE_DMA) {
+		/* the RX data goes to memory, not to the RX FIFO */
+	} else if (status & GQSPI_IER_RXNEMPTY_MASK) {
 		zynqmp_qspi_readrxfifo(xqspi, GQSPI_RX_FIFO_FILL);
 		ret = IRQ_HANDLED;
 	} else if (!(status & GQSPI_IER_RXEMPTY_MASK)) {
@@ -522,6 +722,7 @@ static irqreturn_t zynqmp_qspi_irq(int irq, void *dev_id)
 			GQSPI_IER_GENFIFOEMPTY_MASK |
 			GQSPI_IER_RXNEMPTY_MASK | GQSPI_IER_RXEMPTY_MASK),
 		       xqspi->regs + GQSPI_IDR_OFST);
+		zynqmp_qspi_account(xqspi);
 		spi_finalize_current_transfer(master);
 		ret = IRQ_HANDLED;
 	}
@@ -578,6 +779,9 @@ static void zynqmp_qspi_txrxsetup(struct zynqmp_qspi *xqspi,
 		zynqmp_qspi_filltxfifo(xqspi, GQSPI_TXD_DEPTH);
 		/* Discard RX data */
 		xqspi->bytes_to_receive = 0;
+		if (xqspi->mode != GQSPI_MODE_IO)
+			zynqmp_qspi_setmode(xqspi, GQSPI_MODE_IO);
+		xqspi->xfer_stat = GQSPI_STAT_TX;
 	} else if ((xqspi->txbuf == NULL) && (xqspi->rxbuf != NULL)) {
 		/* Receive */
 
@@ -589,6 +793,9 @@ static void zynqmp_qspi_txrxsetup(struct zynqmp_qspi *xqspi,
 		*genfifoentry |= zynqmp_qspi_selectspimode(transfer->rx_nbits);
 		xqspi->bytes_to_transfer = 0;
 		xqspi->bytes_to_receive = transfer->len;
+		zynqmp_qspi_setuprxdma(xqspi);
+		xqspi->xfer_stat = xqspi->mode == GQSPI_MODE_DMA ?
+				   GQSPI_STAT_RX_DMA : GQSPI_STAT_RX_IO;
 	}
 }
 
@@ -610,21 +817,30 @@ static int zynqmp_qspi_start_transfer(struct spi_master *master,
 				      struct spi_transfer *transfer)
 {
 	struct zynqmp_qspi *xqspi = spi_master_get_devdata(master);
-	u32 genfifoentry = 0x00;
+	u32 genfifoentry = 0x00, transfer_len;
 
 	xqspi->txbuf = transfer->tx_buf;
 	xqspi->rxbuf = transfer->rx_buf;
+	xqspi->xfer_start = ktime_get();
+	xqspi->xfer_len = transfer->len;
 
 	genfifoentry |= xqspi->genfifocs;
 	genfifoentry |= xqspi->genfifobus;
 	zynqmp_qspi_txrxsetup(xqspi, transfer, &genfifoentry);
 
-	if ((transfer->len) < GQSPI_GENFIFO_IMM_DATA_MASK) {
+	/* The DMA takes the whole words, a tail follows in IO mode */
+	if (xqspi->mode == GQSPI_MODE_DMA)
+		transfer_len = xqspi->dma_rx_bytes;
+	else
+		transfer_len = transfer->len;
+
+	xqspi->genfifoentry = genfifoentry;
+	if (transfer_len < GQSPI_GENFIFO_IMM_DATA_MASK) {
 		genfifoentry &= ~GQSPI_GENFIFO_IMM_DATA_MASK;
-		genfifoentry |= transfer->len;
+		genfifoentry |= transfer_len;
 		zynqmp_gqspi_write(xqspi, GQSPI_GEN_FIFO_OFST, genfifoentry);
 	} else {
-		int tempcount = transfer->len;
+		int tempcount = transfer_len;
 		u32 exponent = 8;	/* 2^8 = 256 */
 		u8 imm_data = tempcount & 0xFF;
 
@@ -666,7 +882,11 @@ static int zynqmp_qspi_start_transfer(struct spi_master *master,
 				   GQSPI_IER_TXEMPTY_MASK |
 				   GQSPI_IER_GENFIFOEMPTY_MASK);
 
-	if (xqspi->rxbuf != NULL)
+	if (xqspi->rxbuf != NULL && xqspi->mode == GQSPI_MODE_DMA)
+		/* Enable the DMA done interrupt */
+		zynqmp_gqspi_write(xqspi, GQSPI_QSPIDMA_DST_I_EN_OFST,
+				   GQSPI_QSPIDMA_DST_I_EN_DONE_MASK);
+	else if (xqspi->rxbuf != NULL)
 		/* Enable interrupts for Rx */
 		zynqmp_gqspi_write(xqspi, GQSPI_IER_OFST,
 				   GQSPI_IER_GENFIFOEMPTY_MASK |
@@ -736,6 +956,107 @@ static int __maybe_unused zynqmp_qspi_resume(struct device *dev)
 static SIMPLE_DEV_PM_OPS(zynqmp_qspi_dev_pm_ops, zynqmp_qspi_suspend,
 			 zynqmp_qspi_resume);
 
+#ifdef CONFIG_DEBUG_FS
+static const char * const zynqmp_qspi_stat_names[GQSPI_STAT_NUM] = {
+	[GQSPI_STAT_TX]		= "tx",
+	[GQSPI_STAT_RX_IO]	= "rx-io",
+	[GQSPI_STAT_RX_DMA]	= "rx-dma",
+};
+
+static int zynqmp_qspi_stats_show(struct seq_file *s, void *data)
+{
+	struct zynqmp_qspi *xqspi = s->private;
+	struct zynqmp_qspi_stats stats[GQSPI_STAT_NUM];
+	unsigned long flags;
+	u64 kbps;
+	int i;
+
+	spin_lock_irqsave(&xqspi->stats_lock, flags);
+	memcpy(stats, xqspi->stats, sizeof(stats));
+	spin_unlock_irqrestore(&xqspi->stats_lock, flags);
+
+	seq_printf(s, "bus: %s, cs: %s\n",
+		   xqspi->genfifobus == GQSPI_GENFIFO_BUS_BOTH ? "both" :
+		   xqspi->genfifobus == GQSPI_GENFIFO_BUS_UPPER ? "upper" :
+		   "lower",
+		   xqspi->genfifocs == (GQSPI_GENFIFO_CS_LOWER |
+					GQSPI_GENFIFO_CS_UPPER) ? "both" :
+		   xqspi->genfifocs == GQSPI_GENFIFO_CS_UPPER ? "upper" :
+		   "lower");
+	seq_printf(s, "dma threshold: %u\n", xqspi->dma_threshold);
+	seq_printf(s, "%-8s %12s %16s %16s %10s\n",
+		   "class", "transfers", "bytes", "time_ns", "KiB/s");
+	for (i = 0; i < GQSPI_STAT_NUM; i++) {
+		kbps = 0;
+		if (stats[i].time_ns)
+			kbps = div64_u64(stats[i].bytes * (NSEC_PER_SEC / 1024),
+					 stats[i].time_ns);
+		seq_printf(s, "%-8s %12llu %16llu %16llu %10llu\n",
+			   zynqmp_qspi_stat_names[i], stats[i].transfers,
+			   stats[i].bytes, stats[i].time_ns, kbps);
+	}
+
+	return 0;
+}
+
+static int zynqmp_qspi_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, zynqmp_qspi_stats_show, inode->i_private);
+}
+
+static ssize_t zynqmp_qspi_stats_write(struct file *file,
+				       const char __user *buf,
+				       size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct zynqmp_qspi *xqspi = s->private;
+	unsigned long flags;
+
+	/* Any write resets the counters */
+	spin_lock_irqsave(&xqspi->stats_lock, flags);
+	memset(xqspi->stats, 0, sizeof(xqspi->stats));
+	spin_unlock_irqrestore(&xqspi->stats_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations zynqmp_qspi_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= zynqmp_qspi_stats_open,
+	.read		= seq_read,
+	.write		= zynqmp_qspi_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void zynqmp_qspi_debugfs_init(struct zynqmp_qspi *xqspi)
+{
+	xqspi->debugfs = debugfs_create_dir(dev_name(xqspi->dev), NULL);
+	if (IS_ERR_OR_NULL(xqspi->debugfs)) {
+		xqspi->debugfs = NULL;
+		return;
+	}
+
+	debugfs_create_file("stats", S_IRUGO | S_IWUSR, xqspi->debugfs,
+			    xqspi, &zynqmp_qspi_stats_fops);
+	debugfs_create_u32("dma_threshold", S_IRUGO | S_IWUSR,
+			   xqspi->debugfs, &xqspi->dma_threshold);
+}
+
+static void zynqmp_qspi_debugfs_remove(struct zynqmp_qspi *xqspi)
+{
+	debugfs_remove_recursive(xqspi->debugfs);
+}
+#else
+static inline void zynqmp_qspi_debugfs_init(struct zynqmp_qspi *xqspi)
+{
+}
+
+static inline void zynqmp_qspi_debugfs_remove(struct zynqmp_qspi *xqspi)
+{
+}
+#endif /* CONFIG_DEBUG_FS */
+
 /**
  * zynqmp_qspi_probe - Probe method for the QSPI driver
  * @pdev:	Pointer to the platform_device structure
@@ -767,6 +1088,15 @@ static int zynqmp_qspi_probe(struct platform_device *pdev)
 		goto remove_master;
 	}
 	xqspi->dev = dev;
+	spin_lock_init(&xqspi->stats_lock);
+
+	/* The RX DMA takes 44 bit addresses */
+	xqspi->dma_threshold = GQSPI_DMA_THRESHOLD;
+	if (dma_set_mask(dev, DMA_BIT_MASK(44))) {
+		dev_warn(dev, "no usable DMA mask, RX DMA disabled\n");
+		xqspi->dma_threshold = 0;
+	}
+
 	xqspi->pclk = devm_clk_get(&pdev->dev, "pclk");
 	if (IS_ERR(xqspi->pclk)) {
 		dev_err(dev, "pclk clock not found.\n");
@@ -832,6 +1162,8 @@ static int zynqmp_qspi_probe(struct platform_device *pdev)
 	if (ret)
 		goto clk_dis_all;
 
+	zynqmp_qspi_debugfs_init(xqspi);
+
 	return ret;
 
 clk_dis_all:
@@ -858,6 +1190,7 @@ static int zynqmp_qspi_remove(struct platform_device *pdev)
 	struct spi_master *master = platform_get_drvdata(pdev);
 	struct zynqmp_qspi *xqspi = spi_master_get_devdata(master);
 
+	zynqmp_qspi_debugfs_remove(xqspi);
 	zynqmp_gqspi_write(xqspi, GQSPI_EN_OFST, 0x00);
 	clk_disable_unprepare(xqspi->refclk);
 	clk_disable_unprepare(xqspi->pclk);
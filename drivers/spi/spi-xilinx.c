@@ -75,6 +75,8 @@
 #define XIPIF_V123B_RESETR_OFFSET	0x40	/* IPIF reset register */
 #define XIPIF_V123B_RESET_MASK		0x0a	/* the value to write */
 
+#define XSPI_POLL_TIMEOUT		HZ	/* for a word to be received */
+
 struct xilinx_spi {
 	/* bitbang has to be first */
 	struct spi_bitbang bitbang;
@@ -85,7 +87,7 @@ struct xilinx_spi {
 
 	u8 *rx_ptr;		/* pointer in the Tx buffer */
 	const u8 *tx_ptr;	/* pointer in the Rx buffer */
-	int remaining_bytes;	/* the number of bytes left to transfer */
+	int buffer_size;	/* FIFO depth in words */
 	u8 bits_per_word;
 	unsigned int (*read_fn)(void __iomem *);
 	void (*write_fn)(u32, void __iomem *);
@@ -216,82 +218,125 @@ static int xilinx_spi_setup_transfer(struct spi_device *spi,
 	return 0;
 }
 
-static void xilinx_spi_fill_tx_fifo(struct xilinx_spi *xspi)
+static int xilinx_spi_wait_rx(struct xilinx_spi *xspi)
 {
-	u8 sr;
+	unsigned long timeout = jiffies + XSPI_POLL_TIMEOUT;
 
-	/* Fill the Tx FIFO with as many bytes as possible */
-	sr = xspi->read_fn(xspi->regs + XSPI_SR_OFFSET);
-	while ((sr & XSPI_SR_TX_FULL_MASK) == 0 && xspi->remaining_bytes > 0) {
-		if (xspi->tx_ptr)
-			xspi->tx_fn(xspi);
-		else
-			xspi->write_fn(0, xspi->regs + XSPI_TXD_OFFSET);
-		xspi->remaining_bytes -= xspi->bits_per_word / 8;
-		sr = xspi->read_fn(xspi->regs + XSPI_SR_OFFSET);
+	while (xspi->read_fn(xspi->regs + XSPI_SR_OFFSET) &
+	       XSPI_SR_RX_EMPTY_MASK) {
+		if (time_after(jiffies, timeout))
+			return -ETIMEDOUT;
+		cpu_relax();
 	}
+
+	return 0;
 }
 
 static int xilinx_spi_txrx_bufs(struct spi_device *spi, struct spi_transfer *t)
 {
 	struct xilinx_spi *xspi = spi_master_get_devdata(spi->master);
-	u32 ipif_ier;
+	int remaining_words = t->len / (xspi->bits_per_word / 8);
+	bool use_irq = false;
+	u32 ipif_ier = 0;
+	u16 cr;
 
 	/* We get here with transmitter inhibited */
 
 	xspi->tx_ptr = t->tx_buf;
 	xspi->rx_ptr = t->rx_buf;
-	xspi->remaining_bytes = t->len;
-	reinit_completion(&xspi->done);
 
-
-	/* Enable the transmit empty interrupt, which we use to determine
-	 * progress on the transmission.
+	/* A transfer that fits into the FIFO is over within a few word
+	 * times, which is less than an interrupt round trip, so it is
+	 * polled for. Longer ones wait for the FIFO to drain in between.
 	 */
-	ipif_ier = xspi->read_fn(xspi->regs + XIPIF_V123B_IIER_OFFSET);
-	xspi->write_fn(ipif_ier | XSPI_INTR_TX_EMPTY,
-		xspi->regs + XIPIF_V123B_IIER_OFFSET);
+	if (xspi->irq >= 0 && remaining_words > xspi->buffer_size) {
+		use_irq = true;
+		reinit_completion(&xspi->done);
+
+		/* Drop the Tx empty state left by polled transfers */
+		xspi->write_fn(xspi->read_fn(xspi->regs +
+					     XIPIF_V123B_IISR_OFFSET),
+			       xspi->regs + XIPIF_V123B_IISR_OFFSET);
 
-	for (;;) {
-		u16 cr;
-		u8 sr;
+		/* Enable the transmit empty interrupt, which we use to
+		 * determine progress on the transmission.
+		 */
+		ipif_ier = xspi->read_fn(xspi->regs + XIPIF_V123B_IIER_OFFSET);
+		xspi->write_fn(ipif_ier | XSPI_INTR_TX_EMPTY,
+			xspi->regs + XIPIF_V123B_IIER_OFFSET);
+	}
 
-		xilinx_spi_fill_tx_fifo(xspi);
+	cr = xspi->read_fn(xspi->regs + XSPI_CR_OFFSET) &
+						~XSPI_CR_TRANS_INHIBIT;
+
+	while (remaining_words > 0) {
+		int n_words = min(remaining_words, xspi->buffer_size);
+		int i, ret;
+
+		/* Fill the Tx FIFO, which is known to be empty */
+		for (i = 0; i < n_words; i++) {
+			if (xspi->tx_ptr)
+				xspi->tx_fn(xspi);
+			else
+				xspi->write_fn(0, xspi->regs + XSPI_TXD_OFFSET);
+		}
 
 		/* Start the transfer by not inhibiting the transmitter any
 		 * longer
 		 */
-		cr = xspi->read_fn(xspi->regs + XSPI_CR_OFFSET) &
-							~XSPI_CR_TRANS_INHIBIT;
 		xspi->write_fn(cr, xspi->regs + XSPI_CR_OFFSET);
 
-		wait_for_completion(&xspi->done);
+		if (use_irq)
+			wait_for_completion(&xspi->done);
 
-		/* A transmit has just completed. Process received data and
-		 * check for more data to transmit. Always inhibit the
-		 * transmitter while the Isr refills the transmit register/FIFO,
-		 * or make sure it is stopped if we're done.
+		/* Read out a word for every word sent, the last one is
+		 * still being shifted in when the Tx FIFO runs empty.
 		 */
-		cr = xspi->read_fn(xspi->regs + XSPI_CR_OFFSET);
-		xspi->write_fn(cr | XSPI_CR_TRANS_INHIBIT,
-			       xspi->regs + XSPI_CR_OFFSET);
-
-		/* Read out all the data from the Rx FIFO */
-		sr = xspi->read_fn(xspi->regs + XSPI_SR_OFFSET);
-		while ((sr & XSPI_SR_RX_EMPTY_MASK) == 0) {
+		for (i = 0; i < n_words; i++) {
+			ret = xilinx_spi_wait_rx(xspi);
+			if (ret) {
+				dev_err(&spi->dev, "receive timed out\n");
+				xspi_init_hw(xspi);
+				return ret;
+			}
 			xspi->rx_fn(xspi);
-			sr = xspi->read_fn(xspi->regs + XSPI_SR_OFFSET);
 		}
 
-		/* See if there is more data to send */
-		if (xspi->remaining_bytes <= 0)
-			break;
+		/* Always inhibit the transmitter while the Tx FIFO is
+		 * refilled, or make sure it is stopped if we're done.
+		 */
+		xspi->write_fn(cr | XSPI_CR_TRANS_INHIBIT,
+			       xspi->regs + XSPI_CR_OFFSET);
+
+		remaining_words -= n_words;
 	}
 
 	/* Disable the transmit empty interrupt */
-	xspi->write_fn(ipif_ier, xspi->regs + XIPIF_V123B_IIER_OFFSET);
+	if (use_irq)
+		xspi->write_fn(ipif_ier, xspi->regs + XIPIF_V123B_IIER_OFFSET);
 
-	return t->len - xspi->remaining_bytes;
+	return t->len;
+}
+
+/* Every word written to the Tx data register with the transmitter
+ * inhibited stays in the Tx FIFO, until the FIFO is full.
+ */
+static int xilinx_spi_find_buffer_size(struct xilinx_spi *xspi)
+{
+	int n_words = 0;
+	u8 sr;
+
+	/* Reset the core first to start with an empty FIFO */
+	xspi->write_fn(XIPIF_V123B_RESET_MASK,
+		xspi->regs + XIPIF_V123B_RESETR_OFFSET);
+
+	do {
+		xspi->write_fn(0, xspi->regs + XSPI_TXD_OFFSET);
+		sr = xspi->read_fn(xspi->regs + XSPI_SR_OFFSET);
+		n_words++;
+	} while (!(sr & XSPI_SR_TX_FULL_MASK));
+
+	return n_words;
 }
 
 
@@ -319,6 +364,7 @@ static irqreturn_t xilinx_spi_irq(int irq, void *dev_id)
 static const struct of_device_id xilinx_spi_of_match[] = {
 	{ .compatible = "xlnx,xps-spi-2.00.a", },
 	{ .compatible = "xlnx,xps-spi-2.00.b", },
+	{ .compatible = "xlnx,axi-quad-spi-1.00.a", },
 	{}
 };
 MODULE_DEVICE_TABLE(of, xilinx_spi_of_match);
@@ -407,29 +453,30 @@ static int xilinx_spi_probe(struct platform_device *pdev)
 		goto put_master;
 	}
 
+	xspi->buffer_size = xilinx_spi_find_buffer_size(xspi);
+
 	/* SPI controller initializations */
 	xspi_init_hw(xspi);
 
+	/* Without an interrupt all transfers are polled */
 	xspi->irq = platform_get_irq(pdev, 0);
-	if (xspi->irq < 0) {
-		ret = xspi->irq;
-		goto put_master;
+	if (xspi->irq >= 0) {
+		/* Register for SPI Interrupt */
+		ret = devm_request_irq(&pdev->dev, xspi->irq, xilinx_spi_irq,
+				       0, dev_name(&pdev->dev), xspi);
+		if (ret)
+			goto put_master;
 	}
 
-	/* Register for SPI Interrupt */
-	ret = devm_request_irq(&pdev->dev, xspi->irq, xilinx_spi_irq, 0,
-			       dev_name(&pdev->dev), xspi);
-	if (ret)
-		goto put_master;
-
 	ret = spi_bitbang_start(&xspi->bitbang);
 	if (ret) {
 		dev_err(&pdev->dev, "spi_bitbang_start FAILED\n");
 		goto put_master;
 	}
 
-	dev_info(&pdev->dev, "at 0x%08llX mapped to 0x%p, irq=%d\n",
-		(unsigned long long)res->start, xspi->regs, xspi->irq);
+	dev_info(&pdev->dev, "at 0x%08llX mapped to 0x%p, irq=%d, fifo=%d\n",
+		(unsigned long long)res->start, xspi->regs, xspi->irq,
+		xspi->buffer_size);
 
 	if (pdata) {
 		for (i = 0; i < pdata->num_devices; i++)
@@ -11,12 +11,16 @@
 
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/of_irq.h>
 #include <linux/of_address.h>
 #include <linux/platform_device.h>
+#include <linux/sizes.h>
 #include <linux/spi/spi.h>
 #include <linux/workqueue.h>
 
@@ -95,11 +99,19 @@
  * It is named Linear Configuration but it controls other modes when not in
  * linear mode also.
  */
+#define ZYNQ_QSPI_LCFG_LQ_MODE_MASK	0x80000000 /* Linear mode Mask */
 #define ZYNQ_QSPI_LCFG_TWO_MEM_MASK	0x40000000 /* LQSPI Two memories Mask */
 #define ZYNQ_QSPI_LCFG_SEP_BUS_MASK	0x20000000 /* LQSPI Separate bus Mask */
 #define ZYNQ_QSPI_LCFG_U_PAGE_MASK	0x10000000 /* LQSPI Upper Page Mask */
 
 #define ZYNQ_QSPI_LCFG_DUMMY_SHIFT	8
+#define ZYNQ_QSPI_LCFG_DUMMY_MAX	7 /* Dummy byte field maximum */
+
+/* The linear window decodes 24 bit flash addresses */
+#define ZYNQ_QSPI_LINEAR_MAX_SIZE	SZ_16M
+
+#define ZYNQ_QSPI_DMA_MIN_LEN		SZ_4K /* Shorter reads use memcpy */
+#define ZYNQ_QSPI_DMA_TIMEOUT		msecs_to_jiffies(1000)
 
 #define ZYNQ_QSPI_FAST_READ_QOUT_CODE	0x6B /* read instruction code */
 #define ZYNQ_QSPI_FIFO_DEPTH		63 /* FIFO depth in words */
@@ -128,6 +140,12 @@
  * @is_dual:		Flag to indicate whether dual flash memories are used
  * @is_instr:		Flag to indicate if transfer contains an instruction
  *			(Used in dual parallel configuration)
+ * @linear:		Virtual address of the linear address window, NULL if
+ *			the window is not described
+ * @linear_size:	Size of the linear address window
+ * @linear_phys:	Physical address of the linear address window
+ * @dma_chan:		Optional DMA channel copying out of the linear window
+ * @dma_done:		Completion of the DMA copy
  */
 struct zynq_qspi {
 	void __iomem *regs;
@@ -140,6 +158,11 @@ struct zynq_qspi {
 	int bytes_to_receive;
 	u32 is_dual;
 	u8 is_instr;
+	void __iomem *linear;
+	resource_size_t linear_size;
+	phys_addr_t linear_phys;
+	struct dma_chan *dma_chan;
+	struct completion dma_done;
 };
 
 /*
@@ -620,6 +643,174 @@ static int zynq_qspi_start_transfer(struct spi_master *master,
 	return transfer->len;
 }
 
+/**
+ * zynq_qspi_linear_read_ok - Check if a flash read fits the linear mode
+ * @xqspi:	Pointer to the zynq_qspi structure
+ * @qspi:	Pointer to the spi_device structure
+ * @msg:	Pointer to the spi_flash_read_message structure
+ *
+ * The linear mode issues the read instruction itself with a 24 bit address
+ * on chip select 0. It decodes the plain, fast and dual/quad output reads,
+ * those have the opcode and address on a single line.
+ *
+ * Return:	true if the read can be done through the linear window
+ */
+static bool zynq_qspi_linear_read_ok(struct zynq_qspi *xqspi,
+				     struct spi_device *qspi,
+				     struct spi_flash_read_message *msg)
+{
+	loff_t offset = msg->from & (ZYNQ_QSPI_LINEAR_MAX_SIZE - 1);
+
+	if (!xqspi->linear || xqspi->is_dual || qspi->chip_select)
+		return false;
+
+	switch (msg->read_opcode) {
+	case 0x03:	/* read */
+	case 0x0B:	/* fast read */
+	case 0x3B:	/* dual output fast read */
+	case ZYNQ_QSPI_FAST_READ_QOUT_CODE:
+		break;
+	default:
+		return false;
+	}
+
+	return msg->addr_width == 3 &&
+	       msg->dummy_bytes <= ZYNQ_QSPI_LCFG_DUMMY_MAX &&
+	       offset + msg->len <= xqspi->linear_size;
+}
+
+static void zynq_qspi_dma_callback(void *param)
+{
+	complete(param);
+}
+
+/**
+ * zynq_qspi_linear_dma - Copy out of the linear window with the DMA engine
+ * @xqspi:	Pointer to the zynq_qspi structure
+ * @buf:	Buffer the data is copied to
+ * @offset:	Offset into the linear window
+ * @len:	Number of bytes to copy
+ *
+ * The QSPI controller has no DMA request lines, but in linear mode the flash
+ * is just memory to the DMA controller, so a memcpy transfer out of the
+ * window takes the load off the CPU.
+ *
+ * Return:	0 on success, error value if the CPU has to do the copy
+ */
+static int zynq_qspi_linear_dma(struct zynq_qspi *xqspi, void *buf,
+				loff_t offset, size_t len)
+{
+	struct dma_chan *chan = xqspi->dma_chan;
+	struct dma_device *dma_dev = chan->device;
+	struct dma_async_tx_descriptor *tx;
+	dma_cookie_t cookie;
+	dma_addr_t dst;
+	int ret;
+
+	/* vmalloc buffers are not physically contiguous */
+	if (!virt_addr_valid(buf) || !virt_addr_valid(buf + len - 1))
+		return -EINVAL;
+
+	dst = dma_map_single(dma_dev->dev, buf, len, DMA_FROM_DEVICE);
+	if (dma_mapping_error(dma_dev->dev, dst))
+		return -ENOMEM;
+
+	tx = dma_dev->device_prep_dma_memcpy(chan, dst,
+					     xqspi->linear_phys + offset, len,
+					     DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!tx) {
+		ret = -EIO;
+		goto unmap;
+	}
+
+	reinit_completion(&xqspi->dma_done);
+	tx->callback = zynq_qspi_dma_callback;
+	tx->callback_param = &xqspi->dma_done;
+
+	cookie = dmaengine_submit(tx);
+	ret = dma_submit_error(cookie);
+	if (ret)
+		goto unmap;
+
+	dma_async_issue_pending(chan);
+
+	if (!wait_for_completion_timeout(&xqspi->dma_done,
+					 ZYNQ_QSPI_DMA_TIMEOUT)) {
+		dmaengine_terminate_all(chan);
+		ret = -ETIMEDOUT;
+	}
+
+unmap:
+	dma_unmap_single(dma_dev->dev, dst, len, DMA_FROM_DEVICE);
+	return ret;
+}
+
+/**
+ * zynq_qspi_flash_read - Read from the flash through the linear window
+ * @qspi:	Pointer to the spi_device structure
+ * @msg:	Pointer to the spi_flash_read_message structure
+ *
+ * In linear mode the controller turns reads of the memory mapped window
+ * into flash read commands, so the data does not have to be moved through
+ * the FIFOs word by word. The controller is switched back to I/O mode once
+ * the data has been copied.
+ *
+ * Return:	0 on success, -EOPNOTSUPP if the read has to go through the
+ *		FIFOs
+ */
+static int zynq_qspi_flash_read(struct spi_device *qspi,
+				struct spi_flash_read_message *msg)
+{
+	struct spi_master *master = qspi->master;
+	struct zynq_qspi *xqspi = spi_master_get_devdata(master);
+	u32 config_reg, lqspi_cfg_reg;
+	loff_t offset;
+
+	if (!zynq_qspi_linear_read_ok(xqspi, qspi, msg))
+		return -EOPNOTSUPP;
+
+	offset = msg->from & (ZYNQ_QSPI_LINEAR_MAX_SIZE - 1);
+
+	zynq_prepare_transfer_hardware(master);
+	zynq_qspi_setup_transfer(qspi, NULL);
+
+	config_reg = zynq_qspi_read(xqspi, ZYNQ_QSPI_CONFIG_OFFSET);
+	lqspi_cfg_reg = zynq_qspi_read(xqspi, ZYNQ_QSPI_LINEAR_CFG_OFFSET);
+
+	/* The linear adapter drives chip select and start by itself */
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ENABLE_OFFSET, 0);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_CONFIG_OFFSET,
+			config_reg & ~(ZYNQ_QSPI_CONFIG_SSFORCE_MASK |
+				       ZYNQ_QSPI_CONFIG_MANSRTEN_MASK |
+				       ZYNQ_QSPI_CONFIG_SSCTRL_MASK));
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_LINEAR_CFG_OFFSET,
+			ZYNQ_QSPI_LCFG_LQ_MODE_MASK |
+			(msg->dummy_bytes << ZYNQ_QSPI_LCFG_DUMMY_SHIFT) |
+			msg->read_opcode);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ENABLE_OFFSET,
+			ZYNQ_QSPI_ENABLE_ENABLE_MASK);
+
+	/*
+	 * Large reads go to the DMA engine if there is one. Otherwise, and
+	 * if DMA fails, the CPU copies: the window is mapped write combined,
+	 * so memcpy can use burst loads, unlike the bytewise memcpy_fromio.
+	 */
+	if (!xqspi->dma_chan || msg->len < ZYNQ_QSPI_DMA_MIN_LEN ||
+	    zynq_qspi_linear_dma(xqspi, msg->buf, offset, msg->len))
+		memcpy(msg->buf, (void __force *)xqspi->linear + offset,
+		       msg->len);
+	msg->retlen = msg->len;
+
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ENABLE_OFFSET, 0);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_LINEAR_CFG_OFFSET, lqspi_cfg_reg);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_CONFIG_OFFSET,
+			config_reg | ZYNQ_QSPI_CONFIG_SSCTRL_MASK);
+
+	zynq_unprepare_transfer_hardware(master);
+
+	return 0;
+}
+
 /**
  * zynq_qspi_suspend - Suspend method for the QSPI driver
  * @_dev:	Address of the platform_device structure
@@ -763,27 +954,62 @@ static int zynq_qspi_probe(struct platform_device *pdev)
 	else
 		master->num_chipselect = num_cs;
 
+	/* The linear address window is optional */
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 1);
+	if (res) {
+		xqspi->linear_size = min_t(resource_size_t, resource_size(res),
+					   ZYNQ_QSPI_LINEAR_MAX_SIZE);
+		xqspi->linear_phys = res->start;
+		xqspi->linear = ioremap_wc(res->start, xqspi->linear_size);
+		if (!xqspi->linear)
+			dev_warn(&pdev->dev,
+				 "can't map linear window, using I/O mode\n");
+	}
+
+	/* Optional memcpy capable channel for large linear reads */
+	init_completion(&xqspi->dma_done);
+	if (xqspi->linear) {
+		xqspi->dma_chan = dma_request_slave_channel(&pdev->dev, "rx");
+		if (xqspi->dma_chan &&
+		    !dma_has_cap(DMA_MEMCPY, xqspi->dma_chan->device->cap_mask)) {
+			dev_warn(&pdev->dev, "rx DMA channel can't do memcpy\n");
+			dma_release_channel(xqspi->dma_chan);
+			xqspi->dma_chan = NULL;
+		}
+	}
+
 	master->setup = zynq_qspi_setup;
 	master->set_cs = zynq_qspi_chipselect;
 	master->transfer_one = zynq_qspi_start_transfer;
 	master->prepare_transfer_hardware = zynq_prepare_transfer_hardware;
 	master->unprepare_transfer_hardware = zynq_unprepare_transfer_hardware;
 	master->flags = SPI_MASTER_QUAD_MODE;
+#ifndef CONFIG_SPI_ZYNQ_QSPI_DUAL_STACKED
+	if (xqspi->linear)
+		master->spi_flash_read = zynq_qspi_flash_read;
+#endif
 
 	master->max_speed_hz = clk_get_rate(xqspi->refclk) / 2;
 	master->bits_per_word_mask = SPI_BPW_MASK(8);
 	master->mode_bits = SPI_CPOL | SPI_CPHA | SPI_RX_DUAL | SPI_RX_QUAD |
 			    SPI_TX_DUAL | SPI_TX_QUAD;
 
+	device_enable_async_suspend(&pdev->dev);
+
 	ret = spi_register_master(master);
 	if (ret) {
 		dev_err(&pdev->dev, "spi_register_master failed\n");
 		goto clk_dis_all;
 	}
+	device_enable_async_suspend(&master->dev);
 
 	return ret;
 
 clk_dis_all:
+	if (xqspi->dma_chan)
+		dma_release_channel(xqspi->dma_chan);
+	if (xqspi->linear)
+		iounmap(xqspi->linear);
 	clk_disable_unprepare(xqspi->refclk);
 clk_dis_pclk:
 	clk_disable_unprepare(xqspi->pclk);
@@ -814,6 +1040,11 @@ static int zynq_qspi_remove(struct platform_device *pdev)
 
 	spi_unregister_master(master);
 
+	if (xqspi->dma_chan)
+		dma_release_channel(xqspi->dma_chan);
+	if (xqspi->linear)
+		iounmap(xqspi->linear);
+
 	return 0;
 }
 
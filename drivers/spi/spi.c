@@ -2169,6 +2169,61 @@ int spi_sync_locked(struct spi_device *spi, struct spi_message *message)
 }
 EXPORT_SYMBOL_GPL(spi_sync_locked);
 
+/**
+ * spi_flash_read - read from a flash through the accelerated interface of
+ *	the master, if it has one
+ * @spi: flash device to read from
+ * @msg: describes the read command and the buffer
+ * Context: can sleep
+ *
+ * The read is serialized against spi_sync() users of the bus. It returns
+ * zero on success, -EOPNOTSUPP if the caller has to fall back to a normal
+ * message, else a negative error code.
+ */
+int spi_flash_read(struct spi_device *spi, struct spi_flash_read_message *msg)
+{
+	struct spi_master *master = spi->master;
+	int ret;
+
+	if (!master->spi_flash_read)
+		return -EOPNOTSUPP;
+
+	if ((msg->opcode_nbits == SPI_NBITS_DUAL ||
+	     msg->addr_nbits == SPI_NBITS_DUAL) &&
+	    !(spi->mode & (SPI_TX_DUAL | SPI_TX_QUAD)))
+		return -EINVAL;
+	if ((msg->opcode_nbits == SPI_NBITS_QUAD ||
+	     msg->addr_nbits == SPI_NBITS_QUAD) &&
+	    !(spi->mode & SPI_TX_QUAD))
+		return -EINVAL;
+	if (msg->data_nbits == SPI_NBITS_DUAL &&
+	    !(spi->mode & (SPI_RX_DUAL | SPI_RX_QUAD)))
+		return -EINVAL;
+	if (msg->data_nbits == SPI_NBITS_QUAD &&
+	    !(spi->mode & SPI_RX_QUAD))
+		return -EINVAL;
+
+	if (master->auto_runtime_pm) {
+		ret = pm_runtime_get_sync(master->dev.parent);
+		if (ret < 0) {
+			pm_runtime_put_noidle(master->dev.parent);
+			dev_err(&master->dev, "Failed to power device: %d\n",
+				ret);
+			return ret;
+		}
+	}
+
+	mutex_lock(&master->bus_lock_mutex);
+	ret = master->spi_flash_read(spi, msg);
+	mutex_unlock(&master->bus_lock_mutex);
+
+	if (master->auto_runtime_pm)
+		pm_runtime_put(master->dev.parent);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(spi_flash_read);
+
 /**
  * spi_bus_lock - obtain a lock for exclusive SPI bus usage
  * @master: SPI bus master that should be locked for exclusive bus access
@@ -35,6 +35,8 @@
 #include <linux/uaccess.h>
 #include <asm/cacheflush.h>
 #include <linux/sched.h>
+#include <linux/dma-buf.h>
+#include <linux/mmu_notifier.h>
 
 #include "xilinx-dma-apf.h"
 
@@ -218,6 +220,10 @@ static void xilinx_chan_desc_cleanup(struct xdma_chan *chan)
 				cmp->done = 1;
 			else
 				complete(cmp);
+
+			if (dmahead->callback)
+				dmahead->callback(dmahead,
+						  dmahead->callback_param);
 		}
 		xdma_clean_bd(desc);
 		chan->bd_used--;
@@ -555,6 +561,112 @@ static unsigned int phy_buf_to_sgl(void *phy_buf, unsigned int phy_buf_len,
 	return sgl_cnt;
 }
 
+/*
+ *  create minimal length scatter gather list for the first size bytes of a
+ *  dma-buf mapped by its exporter
+ */
+static unsigned int dma_buf_to_sgl(struct sg_table *sgt, unsigned int size,
+			struct scatterlist **sgl)
+{
+	unsigned int sgl_cnt = 0;
+	struct scatterlist *sg, *sgl_head = NULL;
+	dma_addr_t dma_addr;
+	unsigned int len, dma_len;
+	int i;
+
+	*sgl = sglist_array;
+
+	for_each_sg(sgt->sgl, sg, sgt->nents, i) {
+		if (!size)
+			break;
+
+		dma_addr = sg_dma_address(sg);
+		len = min(sg_dma_len(sg), size);
+		size -= len;
+
+		while (len > 0) {
+			dma_len = (len > XDMA_MAX_TRANS_LEN) ?
+					XDMA_MAX_TRANS_LEN : len;
+
+			if (sgl_head &&
+			    sg_dma_address(sgl_head) + sg_dma_len(sgl_head) ==
+			    dma_addr &&
+			    sg_dma_len(sgl_head) + dma_len <= XDMA_MAX_TRANS_LEN) {
+				sg_dma_len(sgl_head) += dma_len;
+			} else {
+				if (++sgl_cnt > XDMA_SGL_MAX_LEN)
+					return 0;
+				sgl_head = &sglist_array[sgl_cnt - 1];
+				sg_dma_address(sgl_head) = dma_addr;
+				sg_dma_len(sgl_head) = dma_len;
+			}
+
+			dma_addr += dma_len;
+			len -= dma_len;
+		}
+	}
+
+	/* the dma-buf is smaller than the transfer */
+	if (size)
+		return 0;
+
+	return sgl_cnt;
+}
+
+static int xdma_map_dma_buf(struct xdma_head *dmahead, int fd,
+			struct scatterlist **sgl, unsigned int *sgl_cnt)
+{
+	struct xdma_chan *chan = dmahead->chan;
+	struct dma_buf *dbuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table *sgt;
+	int status;
+
+	dbuf = dma_buf_get(fd);
+	if (IS_ERR(dbuf))
+		return PTR_ERR(dbuf);
+
+	attach = dma_buf_attach(dbuf, chan->dev);
+	if (IS_ERR(attach)) {
+		status = PTR_ERR(attach);
+		goto err_put;
+	}
+
+	sgt = dma_buf_map_attachment(attach, dmahead->dmadir);
+	if (IS_ERR(sgt)) {
+		status = PTR_ERR(sgt);
+		goto err_detach;
+	}
+
+	*sgl_cnt = dma_buf_to_sgl(sgt, dmahead->size, sgl);
+	if (!*sgl_cnt) {
+		status = -EINVAL;
+		goto err_unmap;
+	}
+
+	dmahead->dbuf = dbuf;
+	dmahead->dbuf_attach = attach;
+	dmahead->dbuf_sgt = sgt;
+
+	return 0;
+
+err_unmap:
+	dma_buf_unmap_attachment(attach, sgt, dmahead->dmadir);
+err_detach:
+	dma_buf_detach(dbuf, attach);
+err_put:
+	dma_buf_put(dbuf);
+	return status;
+}
+
+static void xdma_unmap_dma_buf(struct xdma_head *dmahead)
+{
+	dma_buf_unmap_attachment(dmahead->dbuf_attach, dmahead->dbuf_sgt,
+				 dmahead->dmadir);
+	dma_buf_detach(dmahead->dbuf, dmahead->dbuf_attach);
+	dma_buf_put(dmahead->dbuf);
+}
+
 /*  merge sg list, sgl, with length sgl_len, to sgl_merged, to save dma bds */
 static unsigned int sgl_merge(struct scatterlist *sgl, unsigned int sgl_len,
 			struct scatterlist **sgl_merged)
@@ -701,6 +813,291 @@ static int unpin_user_pages(struct scatterlist *sglist, unsigned int cnt)
 	return 0;
 }
 
+/*
+ * Registration cache for user buffers
+ *
+ * Accelerator clients submit the same user buffers over and over. Instead
+ * of pinning and mapping the pages on every xdma_submit, the pinned and
+ * mapped sg list is kept per (channel, mm, address, length) until an MMU
+ * notifier reports that the pages behind it changed, the process exits,
+ * the channel is released or newer mappings push it out.
+ *
+ * The mappings are created with DMA_ATTR_SKIP_CPU_SYNC, cache maintenance
+ * for CF_FLAG_CACHE_FLUSH_INVALIDATE is done per submission with the
+ * dma_sync_sg calls.
+ */
+#define XDMA_UMAP_MAX	64	/* cached mappings per process */
+
+struct xdma_umm {
+	struct mmu_notifier mn;
+	struct mm_struct *mm;
+	struct list_head node;		/* in xdma_umm_list */
+	struct list_head maps;		/* most recently used first */
+	unsigned int nr_maps;
+	unsigned long inval_seq;	/* bumped by every invalidation */
+	bool dead;			/* the mm went away */
+};
+
+struct xdma_umap {
+	struct list_head node;		/* in xdma_umm.maps */
+	struct xdma_chan *chan;
+	unsigned long uaddr;
+	unsigned int ulen;
+	struct scatterlist *sglist;
+	unsigned int sgcnt;
+	unsigned int users;		/* submissions in flight */
+	bool stale;			/* not in the cache anymore */
+};
+
+/*
+ * Protects both lists. Never held across get_user_pages() or notifier
+ * (un)registration, both may end up in the notifier callbacks.
+ */
+static DEFINE_MUTEX(xdma_umap_mutex);
+static LIST_HEAD(xdma_umm_list);
+
+static void xdma_umap_destroy(struct xdma_umap *umap)
+{
+	DEFINE_DMA_ATTRS(attrs);
+
+	dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+	get_dma_ops(umap->chan->dev)->unmap_sg(umap->chan->dev, umap->sglist,
+					       umap->sgcnt,
+					       umap->chan->direction, &attrs);
+	unpin_user_pages(umap->sglist, umap->sgcnt);
+	kfree(umap);
+}
+
+/* Take umap out of the cache, called with xdma_umap_mutex held */
+static void xdma_umap_drop(struct xdma_umm *umm, struct xdma_umap *umap)
+{
+	list_del(&umap->node);
+	umm->nr_maps--;
+
+	if (umap->users)
+		umap->stale = true;
+	else
+		xdma_umap_destroy(umap);
+}
+
+static void xdma_umm_invalidate(struct xdma_umm *umm, unsigned long start,
+				unsigned long end)
+{
+	struct xdma_umap *umap, *tmp;
+
+	mutex_lock(&xdma_umap_mutex);
+	umm->inval_seq++;
+	list_for_each_entry_safe(umap, tmp, &umm->maps, node) {
+		if (umap->uaddr < end && start < umap->uaddr + umap->ulen)
+			xdma_umap_drop(umm, umap);
+	}
+	mutex_unlock(&xdma_umap_mutex);
+}
+
+static void xdma_umm_release(struct mmu_notifier *mn, struct mm_struct *mm)
+{
+	struct xdma_umm *umm = container_of(mn, struct xdma_umm, mn);
+
+	xdma_umm_invalidate(umm, 0, ULONG_MAX);
+
+	mutex_lock(&xdma_umap_mutex);
+	umm->dead = true;
+	mutex_unlock(&xdma_umap_mutex);
+}
+
+static void xdma_umm_invalidate_page(struct mmu_notifier *mn,
+				     struct mm_struct *mm,
+				     unsigned long address)
+{
+	struct xdma_umm *umm = container_of(mn, struct xdma_umm, mn);
+
+	xdma_umm_invalidate(umm, address, address + PAGE_SIZE);
+}
+
+static void xdma_umm_invalidate_range_start(struct mmu_notifier *mn,
+					    struct mm_struct *mm,
+					    unsigned long start,
+					    unsigned long end)
+{
+	struct xdma_umm *umm = container_of(mn, struct xdma_umm, mn);
+
+	xdma_umm_invalidate(umm, start, end);
+}
+
+static const struct mmu_notifier_ops xdma_umm_ops = {
+	.release = xdma_umm_release,
+	.invalidate_page = xdma_umm_invalidate_page,
+	.invalidate_range_start = xdma_umm_invalidate_range_start,
+};
+
+/* Free the trackers of processes that have exited */
+static void xdma_umm_reap(void)
+{
+	struct xdma_umm *umm, *tmp;
+	LIST_HEAD(dead);
+
+	mutex_lock(&xdma_umap_mutex);
+	list_for_each_entry_safe(umm, tmp, &xdma_umm_list, node) {
+		if (umm->dead)
+			list_move(&umm->node, &dead);
+	}
+	mutex_unlock(&xdma_umap_mutex);
+
+	list_for_each_entry_safe(umm, tmp, &dead, node) {
+		mmu_notifier_unregister_no_release(&umm->mn, umm->mm);
+		mmdrop(umm->mm);
+		kfree(umm);
+	}
+}
+
+static struct xdma_umm *xdma_umm_get(struct mm_struct *mm)
+{
+	struct xdma_umm *umm;
+	int status;
+
+	xdma_umm_reap();
+
+	mutex_lock(&xdma_umap_mutex);
+	list_for_each_entry(umm, &xdma_umm_list, node) {
+		if (umm->mm == mm && !umm->dead) {
+			mutex_unlock(&xdma_umap_mutex);
+			return umm;
+		}
+	}
+	mutex_unlock(&xdma_umap_mutex);
+
+	umm = kzalloc(sizeof(*umm), GFP_KERNEL);
+	if (!umm)
+		return ERR_PTR(-ENOMEM);
+
+	umm->mm = mm;
+	umm->mn.ops = &xdma_umm_ops;
+	INIT_LIST_HEAD(&umm->maps);
+
+	status = mmu_notifier_register(&umm->mn, mm);
+	if (status) {
+		kfree(umm);
+		return ERR_PTR(status);
+	}
+
+	/* keep the mm_struct around until the notifier is unregistered */
+	atomic_inc(&mm->mm_count);
+
+	mutex_lock(&xdma_umap_mutex);
+	list_add(&umm->node, &xdma_umm_list);
+	mutex_unlock(&xdma_umap_mutex);
+
+	return umm;
+}
+
+/* Look up or create the pinned and mapped sg list of a user buffer */
+static struct xdma_umap *xdma_umap_get(struct xdma_chan *chan,
+				       unsigned long uaddr,
+				       unsigned int ulen,
+				       unsigned int user_flags)
+{
+	struct xdma_umm *umm;
+	struct xdma_umap *umap, *old, *tmp;
+	unsigned long seq;
+	int status;
+	DEFINE_DMA_ATTRS(attrs);
+
+	umm = xdma_umm_get(current->mm);
+	if (IS_ERR(umm))
+		return ERR_CAST(umm);
+
+	mutex_lock(&xdma_umap_mutex);
+	list_for_each_entry(umap, &umm->maps, node) {
+		if (umap->chan == chan && umap->uaddr == uaddr &&
+		    umap->ulen == ulen) {
+			umap->users++;
+			list_move(&umap->node, &umm->maps);
+			mutex_unlock(&xdma_umap_mutex);
+			return umap;
+		}
+	}
+	seq = umm->inval_seq;
+	mutex_unlock(&xdma_umap_mutex);
+
+	umap = kzalloc(sizeof(*umap), GFP_KERNEL);
+	if (!umap)
+		return ERR_PTR(-ENOMEM);
+
+	umap->chan = chan;
+	umap->uaddr = uaddr;
+	umap->ulen = ulen;
+	umap->users = 1;
+
+	status = pin_user_pages(uaddr, ulen, chan->direction != DMA_TO_DEVICE,
+				&umap->sglist, &umap->sgcnt, user_flags);
+	if (status < 0) {
+		kfree(umap);
+		return ERR_PTR(status);
+	}
+
+	dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+	status = get_dma_ops(chan->dev)->map_sg(chan->dev, umap->sglist,
+						umap->sgcnt, chan->direction,
+						&attrs);
+	if (!status) {
+		pr_err("dma_map_sg failed\n");
+		unpin_user_pages(umap->sglist, umap->sgcnt);
+		kfree(umap);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	mutex_lock(&xdma_umap_mutex);
+	if (umm->dead || umm->inval_seq != seq) {
+		/* raced with an invalidation, use it this once only */
+		umap->stale = true;
+	} else {
+		list_add(&umap->node, &umm->maps);
+		umm->nr_maps++;
+
+		/* push out the least recently used idle mapping */
+		if (umm->nr_maps > XDMA_UMAP_MAX) {
+			list_for_each_entry_safe_reverse(old, tmp, &umm->maps,
+							 node) {
+				if (!old->users) {
+					xdma_umap_drop(umm, old);
+					break;
+				}
+			}
+		}
+	}
+	mutex_unlock(&xdma_umap_mutex);
+
+	return umap;
+}
+
+static void xdma_umap_put(struct xdma_umap *umap)
+{
+	bool destroy;
+
+	mutex_lock(&xdma_umap_mutex);
+	destroy = !--umap->users && umap->stale;
+	mutex_unlock(&xdma_umap_mutex);
+
+	if (destroy)
+		xdma_umap_destroy(umap);
+}
+
+/* Drop the cached mappings of a channel, they are for its device */
+static void xdma_umap_flush_chan(struct xdma_chan *chan)
+{
+	struct xdma_umm *umm;
+	struct xdma_umap *umap, *tmp;
+
+	mutex_lock(&xdma_umap_mutex);
+	list_for_each_entry(umm, &xdma_umm_list, node) {
+		list_for_each_entry_safe(umap, tmp, &umm->maps, node) {
+			if (umap->chan == chan)
+				xdma_umap_drop(umm, umap);
+		}
+	}
+	mutex_unlock(&xdma_umap_mutex);
+}
+
 struct xdma_chan *xdma_request_channel(char *name)
 {
 	int i;
@@ -734,6 +1131,8 @@ void xdma_release_channel(struct xdma_chan *chan)
 	dma_halt(chan);
 	xilinx_chan_desc_reinit(chan);
 	mutex_unlock(&dma_list_mutex);
+
+	xdma_umap_flush_chan(chan);
 }
 EXPORT_SYMBOL(xdma_release_channel);
 
@@ -752,6 +1151,7 @@ void xdma_release_all_channels(void)
 						__func__,
 						device->chan[i]->name);
 			}
+			xdma_umap_flush_chan(device->chan[i]);
 		}
 	}
 }
@@ -761,13 +1161,20 @@ static void xdma_release(struct device *dev)
 {
 }
 
-int xdma_submit(struct xdma_chan *chan,
+/*
+ * Like xdma_submit, callback is additionally called with callback_param once
+ * the transfer has completed. xdma_wait must still be called afterwards to
+ * release the buffer.
+ */
+int xdma_submit_cb(struct xdma_chan *chan,
 			void *userbuf,
 			unsigned int size,
 			unsigned int nappwords_i,
 			u32 *appwords_i,
 			unsigned int nappwords_o,
 			unsigned int user_flags,
+			void (*callback)(struct xdma_head *dmahead, void *param),
+			void *callback_param,
 			struct xdma_head **dmaheadpp)
 {
 	struct xdma_head *dmahead;
@@ -776,7 +1183,7 @@ int xdma_submit(struct xdma_chan *chan,
 	enum dma_data_direction dmadir;
 	int status;
 	void *kaddr;
-	DEFINE_DMA_ATTRS(attrs);
+	struct xdma_umap *umap = NULL;
 
 
 	dmahead = kzalloc(sizeof(struct xdma_head), GFP_KERNEL);
@@ -788,8 +1195,24 @@ int xdma_submit(struct xdma_chan *chan,
 	dmahead->size = size;
 	dmahead->dmadir = chan->direction;
 	dmahead->userflag = user_flags;
+	dmahead->callback = callback;
+	dmahead->callback_param = callback_param;
 	dmadir = chan->direction;
-	if (user_flags & CF_FLAG_PHYSICALLY_CONTIGUOUS) {
+	if (user_flags & CF_FLAG_DMA_BUF) {
+		/*
+		 * userbuf carries a dma-buf fd; the exporter maps it for the
+		 * channel and takes care of the cache maintenance
+		 */
+		status = xdma_map_dma_buf(dmahead, (int)(long)userbuf,
+					  &sglist_dma, &sgcnt_dma);
+		if (status) {
+			kfree(dmahead);
+			return status;
+		}
+
+		sglist = NULL;
+		sgcnt = 0;
+	} else if (user_flags & CF_FLAG_PHYSICALLY_CONTIGUOUS) {
 		/*
 		 * convert physically contiguous buffer into
 		 * minimal length sg list
@@ -800,7 +1223,8 @@ int xdma_submit(struct xdma_chan *chan,
 
 		sglist_dma = sglist;
 		sgcnt_dma = sgcnt;
-		if (user_flags & CF_FLAG_CACHE_FLUSH_INVALIDATE) {
+		if ((user_flags & CF_FLAG_CACHE_FLUSH_INVALIDATE) &&
+		    !chan->coherent) {
 			kaddr = phys_to_virt((phys_addr_t)userbuf);
 			dmac_map_area(kaddr, size, DMA_TO_DEVICE);
 			if (dmadir == DMA_TO_DEVICE) {
@@ -809,31 +1233,26 @@ int xdma_submit(struct xdma_chan *chan,
 			}
 		}
 	} else {
-		/* pin user pages is monitored separately */
-		status = pin_user_pages((unsigned long)userbuf, size,
-					dmadir != DMA_TO_DEVICE,
-					&sglist, &sgcnt, user_flags);
-		if (status < 0) {
+		/* pinned and mapped user pages are cached across submits */
+		umap = xdma_umap_get(chan, (unsigned long)userbuf, size,
+				     user_flags);
+		if (IS_ERR(umap)) {
 			pr_err("pin_user_pages failed\n");
-			return status;
-		}
-		if (!(user_flags & CF_FLAG_CACHE_FLUSH_INVALIDATE))
-			dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
-
-		status = get_dma_ops(chan->dev)->map_sg(chan->dev, sglist,
-							sgcnt, dmadir, &attrs);
-		if (!status) {
-			pr_err("dma_map_sg failed\n");
-			unpin_user_pages(sglist, sgcnt);
-			return -ENOMEM;
+			kfree(dmahead);
+			return PTR_ERR(umap);
 		}
+		dmahead->umap = umap;
+		sglist = umap->sglist;
+		sgcnt = umap->sgcnt;
+
+		if (user_flags & CF_FLAG_CACHE_FLUSH_INVALIDATE)
+			dma_sync_sg_for_device(chan->dev, sglist, sgcnt, dmadir);
 
 		/* merge sg list to save dma bds */
 		sgcnt_dma = sgl_merge(sglist, sgcnt, &sglist_dma);
 		if (!sgcnt_dma) {
-			get_dma_ops(chan->dev)->unmap_sg(chan->dev, sglist,
-							 sgcnt, dmadir, &attrs);
-			unpin_user_pages(sglist, sgcnt);
+			xdma_umap_put(umap);
+			kfree(dmahead);
 			return -ENOMEM;
 		}
 	}
@@ -855,12 +1274,12 @@ int xdma_submit(struct xdma_chan *chan,
 				    dmadir, nappwords_i, appwords_i);
 	if (status) {
 		pr_err("setup hw desc failed\n");
-		if (!(user_flags & CF_FLAG_PHYSICALLY_CONTIGUOUS)) {
-			get_dma_ops(chan->dev)->unmap_sg(chan->dev, sglist,
-							 sgcnt, dmadir, &attrs);
-			unpin_user_pages(sglist, sgcnt);
-		}
+		if (user_flags & CF_FLAG_DMA_BUF)
+			xdma_unmap_dma_buf(dmahead);
+		else if (umap)
+			xdma_umap_put(umap);
 
+		kfree(dmahead);
 		return -ENOMEM;
 	}
 
@@ -868,6 +1287,20 @@ int xdma_submit(struct xdma_chan *chan,
 
 	return 0;
 }
+EXPORT_SYMBOL(xdma_submit_cb);
+
+int xdma_submit(struct xdma_chan *chan,
+			void *userbuf,
+			unsigned int size,
+			unsigned int nappwords_i,
+			u32 *appwords_i,
+			unsigned int nappwords_o,
+			unsigned int user_flags,
+			struct xdma_head **dmaheadpp)
+{
+	return xdma_submit_cb(chan, userbuf, size, nappwords_i, appwords_i,
+			      nappwords_o, user_flags, NULL, NULL, dmaheadpp);
+}
 EXPORT_SYMBOL(xdma_submit);
 
 int xdma_wait(struct xdma_head *dmahead, unsigned int user_flags)
@@ -875,24 +1308,23 @@ int xdma_wait(struct xdma_head *dmahead, unsigned int user_flags)
 	struct xdma_chan *chan = dmahead->chan;
 	void *kaddr, *paddr;
 	int size;
-	DEFINE_DMA_ATTRS(attrs);
 
 	if (chan->poll_mode) {
 		xilinx_chan_desc_cleanup(chan);
 	} else
 		wait_for_completion(&dmahead->cmp);
 
-	if (!(user_flags & CF_FLAG_PHYSICALLY_CONTIGUOUS)) {
-		if (!(user_flags & CF_FLAG_CACHE_FLUSH_INVALIDATE))
-			dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+	if (dmahead->dbuf) {
+		xdma_unmap_dma_buf(dmahead);
+	} else if (!(user_flags & CF_FLAG_PHYSICALLY_CONTIGUOUS)) {
+		if (user_flags & CF_FLAG_CACHE_FLUSH_INVALIDATE)
+			dma_sync_sg_for_cpu(chan->dev, dmahead->sglist,
+					    dmahead->sgcnt, dmahead->dmadir);
 
-		get_dma_ops(chan->dev)->unmap_sg(chan->dev, dmahead->sglist,
-						 dmahead->sgcnt,
-						 dmahead->dmadir, &attrs);
-
-		unpin_user_pages(dmahead->sglist, dmahead->sgcnt);
+		xdma_umap_put(dmahead->umap);
 	} else {
-		if (user_flags & CF_FLAG_CACHE_FLUSH_INVALIDATE) {
+		if ((user_flags & CF_FLAG_CACHE_FLUSH_INVALIDATE) &&
+		    !chan->coherent) {
 			paddr = dmahead->userbuf;
 			size = dmahead->size;
 			kaddr = phys_to_virt((phys_addr_t)paddr);
@@ -1034,6 +1466,7 @@ static int xdma_probe(struct platform_device *pdev)
 		pr_info("  chan%d irq: %d\n", chan->id, chan->irq);
 
 		chan->poll_mode = dma_config->channel_config[i].poll_mode;
+		chan->coherent = dma_config->coherent;
 		pr_info("  chan%d poll mode: %s\n", chan->id,
 				chan->poll_mode ? "on" : "off");
 
@@ -1079,8 +1512,10 @@ static int xdma_remove(struct platform_device *pdev)
 	mutex_unlock(&dma_list_mutex);
 
 	for (i = 0; i < XDMA_MAX_CHANS_PER_DEVICE; i++) {
-		if (xdev->chan[i])
+		if (xdev->chan[i]) {
+			xdma_umap_flush_chan(xdev->chan[i]);
 			xdma_chan_remove(xdev->chan[i]);
+		}
 	}
 
 	return 0;
@@ -107,6 +107,7 @@ struct dma_device_config {
 	unsigned int include_sg;
 	unsigned int sg_include_stscntrl_strm;  /* dma only */
 	unsigned int channel_count;
+	unsigned int coherent;			/* attached to the ACP */
 	struct dma_channel_config *channel_config;
 };
 
@@ -157,6 +158,7 @@ struct xdma_chan {
 	int id;					/* Channel ID */
 	int irq;				/* Channel IRQ */
 	int poll_mode;				/* Poll mode turned on? */
+	int coherent;				/* No cache maintenance */
 	spinlock_t lock;			/* Descriptor operation lock */
 	struct tasklet_struct tasklet;		/* Cleanup work after irq */
 	struct tasklet_struct dma_err_tasklet;	/* Cleanup work after irq */
@@ -186,6 +188,13 @@ struct xdma_head {
 	u32 appwords_o[XDMA_MAX_APPWORDS];
 	unsigned int userflag;
 	u32 last_bd_index;
+	struct dma_buf *dbuf;
+	struct dma_buf_attachment *dbuf_attach;
+	struct sg_table *dbuf_sgt;
+	struct xdma_umap *umap;
+	/* called from the completion path, in atomic context */
+	void (*callback)(struct xdma_head *dmahead, void *param);
+	void *callback_param;
 };
 
 struct xdma_chan *xdma_request_channel(char *name);
@@ -199,6 +208,16 @@ int xdma_submit(struct xdma_chan *chan,
 		unsigned int nappwords_o,
 		unsigned int user_flags,
 		struct xdma_head **dmaheadpp);
+int xdma_submit_cb(struct xdma_chan *chan,
+		void *userbuf,
+		unsigned int size,
+		unsigned int nappwords_i,
+		u32 *appwords_i,
+		unsigned int nappwords_o,
+		unsigned int user_flags,
+		void (*callback)(struct xdma_head *dmahead, void *param),
+		void *callback_param,
+		struct xdma_head **dmaheadpp);
 int xdma_wait(struct xdma_head *dmahead, unsigned int user_flags);
 int xdma_getconfig(struct xdma_chan *chan,
 		   unsigned char *irq_thresh,
@@ -16,18 +16,56 @@
 #include <linux/mutex.h>
 #include <linux/string.h>
 #include <linux/uio_driver.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
 
 
 #include "xlnk-eng.h"
 
 static DEFINE_MUTEX(xlnk_eng_list_mutex);
 static LIST_HEAD(xlnk_eng_list);
+static LIST_HEAD(xlnk_eng_pools);
+static struct dentry *xlnk_eng_debugfs;
+
+/**
+ * struct xlnk_eng_pool - set of identical engines handed out in turn
+ * @node:	node in the list of pools
+ * @name:	pool name chosen by the application
+ * @engines:	engines of the pool
+ * @waiters:	clients waiting for an engine, oldest first
+ * @wq:		wait queue of the waiters
+ * @queued:	number of waiters
+ * @max_queued:	largest number of waiters seen
+ * @dispatched:	number of engines handed out
+ */
+struct xlnk_eng_pool {
+	struct list_head node;
+	char name[32];
+	struct list_head engines;
+	struct list_head waiters;
+	wait_queue_head_t wq;
+	unsigned int queued;
+	unsigned int max_queued;
+	unsigned long dispatched;
+};
+
+/* A client waiting for an engine of a pool, the releasing side fills eng */
+struct xlnk_eng_waiter {
+	struct list_head node;
+	void *owner;
+	struct xlnk_eng_device *eng;
+	int err;
+};
 
 int xlnk_eng_register_device(struct xlnk_eng_device *xlnk_dev)
 {
 	mutex_lock(&xlnk_eng_list_mutex);
 	/* todo: need to add more error checking */
 
+	INIT_LIST_HEAD(&xlnk_dev->pool_node);
+	xlnk_dev->registered = ktime_get();
 	list_add_tail(&xlnk_dev->global_node, &xlnk_eng_list);
 
 	mutex_unlock(&xlnk_eng_list_mutex);
@@ -37,11 +75,14 @@ int xlnk_eng_register_device(struct xlnk_eng_device *xlnk_dev)
 EXPORT_SYMBOL(xlnk_eng_register_device);
 
 
+static void xlnk_eng_pool_leave(struct xlnk_eng_device *xlnk_dev);
+
 void xlnk_eng_unregister_device(struct xlnk_eng_device *xlnk_dev)
 {
 	mutex_lock(&xlnk_eng_list_mutex);
 	/* todo: need to add more error checking */
 
+	xlnk_eng_pool_leave(xlnk_dev);
 	list_del(&xlnk_dev->global_node);
 
 	mutex_unlock(&xlnk_eng_list_mutex);
@@ -72,6 +113,302 @@ struct xlnk_eng_device *xlnk_eng_request_by_name(char *name)
 }
 EXPORT_SYMBOL(xlnk_eng_request_by_name);
 
+/*
+ * Engine pools
+ *
+ * Identical engines are put into a named pool, and a client then asks for
+ * any engine of the pool instead of a given one. It gets the first idle
+ * engine, or waits in turn for one to be released. A released engine goes
+ * straight to the oldest waiter. Idle means that the engine's alloc() hook
+ * accepts it, so engines taken by xlnk_eng_request_by_name() are busy too.
+ *
+ * All of this runs under the engine list mutex.
+ */
+
+static int xlnk_eng_id(struct xlnk_eng_device *xlnk_dev)
+{
+	return to_platform_device(xlnk_dev->dev)->id;
+}
+
+static struct xlnk_eng_pool *xlnk_eng_pool_find(const char *name)
+{
+	struct xlnk_eng_pool *pool;
+
+	list_for_each_entry(pool, &xlnk_eng_pools, node)
+		if (!strncmp(pool->name, name, sizeof(pool->name)))
+			return pool;
+
+	return NULL;
+}
+
+static void xlnk_eng_busy(struct xlnk_eng_device *xlnk_dev, void *owner)
+{
+	xlnk_dev->owner = owner;
+	xlnk_dev->busy_since = ktime_get();
+	xlnk_dev->jobs++;
+	xlnk_dev->pool->dispatched++;
+}
+
+static void xlnk_eng_idle(struct xlnk_eng_device *xlnk_dev)
+{
+	xlnk_dev->busy_ns += ktime_to_ns(ktime_sub(ktime_get(),
+						   xlnk_dev->busy_since));
+	xlnk_dev->owner = NULL;
+}
+
+/* Take the engine out of its pool, waiters are failed if it was the last */
+static void xlnk_eng_pool_leave(struct xlnk_eng_device *xlnk_dev)
+{
+	struct xlnk_eng_pool *pool = xlnk_dev->pool;
+	struct xlnk_eng_waiter *waiter, *next;
+
+	if (!pool)
+		return;
+
+	if (xlnk_dev->owner) {
+		xlnk_eng_idle(xlnk_dev);
+		xlnk_dev->free(xlnk_dev);
+	}
+
+	list_del_init(&xlnk_dev->pool_node);
+	xlnk_dev->pool = NULL;
+
+	if (!list_empty(&pool->engines))
+		return;
+
+	list_for_each_entry_safe(waiter, next, &pool->waiters, node) {
+		list_del_init(&waiter->node);
+		waiter->err = -ENODEV;
+		pool->queued--;
+	}
+	wake_up_all(&pool->wq);
+}
+
+/**
+ * xlnk_eng_pool_add - Put an engine into a pool
+ * @pool:	pool name, the pool is created with its first engine
+ * @name:	device name of the engine
+ *
+ * Return: 0 on success, -ENODEV if there is no such engine, -EBUSY if the
+ * engine is in another pool already and -ENOMEM on allocation failure.
+ */
+int xlnk_eng_pool_add(const char *pool, const char *name)
+{
+	struct xlnk_eng_device *device, *xlnk_dev = NULL;
+	struct xlnk_eng_pool *p;
+	int err = 0;
+
+	mutex_lock(&xlnk_eng_list_mutex);
+
+	list_for_each_entry(device, &xlnk_eng_list, global_node) {
+		if (!strcmp(dev_name(device->dev), name)) {
+			xlnk_dev = device;
+			break;
+		}
+	}
+	if (!xlnk_dev) {
+		err = -ENODEV;
+		goto out_unlock;
+	}
+
+	p = xlnk_eng_pool_find(pool);
+	if (xlnk_dev->pool) {
+		err = xlnk_dev->pool == p ? 0 : -EBUSY;
+		goto out_unlock;
+	}
+
+	if (!p) {
+		p = kzalloc(sizeof(*p), GFP_KERNEL);
+		if (!p) {
+			err = -ENOMEM;
+			goto out_unlock;
+		}
+		strlcpy(p->name, pool, sizeof(p->name));
+		INIT_LIST_HEAD(&p->engines);
+		INIT_LIST_HEAD(&p->waiters);
+		init_waitqueue_head(&p->wq);
+		list_add_tail(&p->node, &xlnk_eng_pools);
+	}
+
+	xlnk_dev->pool = p;
+	list_add_tail(&xlnk_dev->pool_node, &p->engines);
+
+out_unlock:
+	mutex_unlock(&xlnk_eng_list_mutex);
+	return err;
+}
+EXPORT_SYMBOL(xlnk_eng_pool_add);
+
+/**
+ * xlnk_eng_pool_acquire - Get the first idle engine of a pool
+ * @pool:	pool name
+ * @owner:	client the engine is handed to, for xlnk_eng_pool_release()
+ * @nonblock:	fail instead of waiting when all engines are busy
+ *
+ * Return: the id of the engine on success, -ENODEV if the pool has no
+ * engines, -EAGAIN if @nonblock is set and all engines are busy and
+ * -ERESTARTSYS if the wait was interrupted.
+ */
+int xlnk_eng_pool_acquire(const char *pool, void *owner, bool nonblock)
+{
+	struct xlnk_eng_waiter waiter = { .owner = owner };
+	struct xlnk_eng_device *xlnk_dev;
+	struct xlnk_eng_pool *p;
+	int ret;
+
+	mutex_lock(&xlnk_eng_list_mutex);
+
+	p = xlnk_eng_pool_find(pool);
+	if (!p || list_empty(&p->engines)) {
+		ret = -ENODEV;
+		goto out_unlock;
+	}
+
+	/* Don't overtake clients that are waiting already */
+	if (list_empty(&p->waiters)) {
+		list_for_each_entry(xlnk_dev, &p->engines, pool_node) {
+			if (xlnk_dev->alloc(xlnk_dev)) {
+				xlnk_eng_busy(xlnk_dev, owner);
+				ret = xlnk_eng_id(xlnk_dev);
+				goto out_unlock;
+			}
+		}
+	}
+
+	if (nonblock) {
+		ret = -EAGAIN;
+		goto out_unlock;
+	}
+
+	list_add_tail(&waiter.node, &p->waiters);
+	p->queued++;
+	p->max_queued = max(p->max_queued, p->queued);
+	mutex_unlock(&xlnk_eng_list_mutex);
+
+	wait_event_interruptible(p->wq,
+				 ACCESS_ONCE(waiter.eng) ||
+				 ACCESS_ONCE(waiter.err));
+
+	mutex_lock(&xlnk_eng_list_mutex);
+	if (waiter.eng) {
+		ret = xlnk_eng_id(waiter.eng);
+	} else if (waiter.err) {
+		ret = waiter.err;
+	} else {
+		list_del(&waiter.node);
+		p->queued--;
+		ret = -ERESTARTSYS;
+	}
+
+out_unlock:
+	mutex_unlock(&xlnk_eng_list_mutex);
+	return ret;
+}
+EXPORT_SYMBOL(xlnk_eng_pool_acquire);
+
+/* Hand the engine to the oldest waiter, or make it idle */
+static void xlnk_eng_pool_put(struct xlnk_eng_device *xlnk_dev)
+{
+	struct xlnk_eng_pool *p = xlnk_dev->pool;
+	struct xlnk_eng_waiter *waiter;
+
+	xlnk_eng_idle(xlnk_dev);
+
+	if (list_empty(&p->waiters)) {
+		xlnk_dev->free(xlnk_dev);
+		return;
+	}
+
+	waiter = list_first_entry(&p->waiters, struct xlnk_eng_waiter, node);
+	list_del_init(&waiter->node);
+	p->queued--;
+
+	xlnk_eng_busy(xlnk_dev, waiter->owner);
+	waiter->eng = xlnk_dev;
+	wake_up_all(&p->wq);
+}
+
+/**
+ * xlnk_eng_pool_release - Give back engines taken from their pool
+ * @owner:	client the engines were handed to
+ * @id:		engine id, or -1 for all engines of @owner
+ *
+ * Return: 0 on success and -EINVAL if @owner does not hold engine @id.
+ */
+int xlnk_eng_pool_release(void *owner, int id)
+{
+	struct xlnk_eng_device *xlnk_dev;
+	int ret = id < 0 ? 0 : -EINVAL;
+
+	mutex_lock(&xlnk_eng_list_mutex);
+
+	list_for_each_entry(xlnk_dev, &xlnk_eng_list, global_node) {
+		if (!xlnk_dev->pool || xlnk_dev->owner != owner)
+			continue;
+		if (id >= 0 && xlnk_eng_id(xlnk_dev) != id)
+			continue;
+
+		xlnk_eng_pool_put(xlnk_dev);
+		ret = 0;
+	}
+
+	mutex_unlock(&xlnk_eng_list_mutex);
+	return ret;
+}
+EXPORT_SYMBOL(xlnk_eng_pool_release);
+
+/*
+ * Pool statistics in debugfs: waiting clients and engines handed out per
+ * pool, and per engine the share of time it was held since it registered.
+ */
+static int xlnk_eng_stats_show(struct seq_file *s, void *data)
+{
+	struct xlnk_eng_device *xlnk_dev;
+	struct xlnk_eng_pool *p;
+	ktime_t now;
+	u64 busy_ns, up_ns;
+
+	mutex_lock(&xlnk_eng_list_mutex);
+	now = ktime_get();
+
+	list_for_each_entry(p, &xlnk_eng_pools, node) {
+		seq_printf(s, "pool %s: queued %u, max queued %u, dispatched %lu\n",
+			   p->name, p->queued, p->max_queued, p->dispatched);
+
+		list_for_each_entry(xlnk_dev, &p->engines, pool_node) {
+			busy_ns = xlnk_dev->busy_ns;
+			if (xlnk_dev->owner)
+				busy_ns += ktime_to_ns(ktime_sub(now,
+						xlnk_dev->busy_since));
+			up_ns = ktime_to_ns(ktime_sub(now,
+						      xlnk_dev->registered));
+
+			seq_printf(s, "  %s: %s, jobs %lu, busy %llu ms, utilization %llu%%\n",
+				   dev_name(xlnk_dev->dev),
+				   xlnk_dev->owner ? "busy" : "idle",
+				   xlnk_dev->jobs,
+				   div_u64(busy_ns, NSEC_PER_MSEC),
+				   up_ns ? div64_u64(busy_ns * 100, up_ns) : 0);
+		}
+	}
+
+	mutex_unlock(&xlnk_eng_list_mutex);
+	return 0;
+}
+
+static int xlnk_eng_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, xlnk_eng_stats_show, NULL);
+}
+
+static const struct file_operations xlnk_eng_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = xlnk_eng_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 /**
  * struct xilinx_xlnk_eng_device - device structure for xilinx_xlnk_eng
  * @common:	common device info
@@ -236,7 +573,28 @@ static struct platform_driver xlnk_eng_driver = {
 	},
 };
 
-module_platform_driver(xlnk_eng_driver);
+static int __init xlnk_eng_init(void)
+{
+	xlnk_eng_debugfs = debugfs_create_file("xlnk-eng", S_IRUGO, NULL, NULL,
+					       &xlnk_eng_stats_fops);
+
+	return platform_driver_register(&xlnk_eng_driver);
+}
+module_init(xlnk_eng_init);
+
+static void __exit xlnk_eng_exit(void)
+{
+	struct xlnk_eng_pool *p, *next;
+
+	platform_driver_unregister(&xlnk_eng_driver);
+	debugfs_remove(xlnk_eng_debugfs);
+
+	list_for_each_entry_safe(p, next, &xlnk_eng_pools, node) {
+		list_del(&p->node);
+		kfree(p);
+	}
+}
+module_exit(xlnk_eng_exit);
 
 MODULE_DESCRIPTION("Xilinx xlnk engine generic driver");
 MODULE_LICENSE("GPL");
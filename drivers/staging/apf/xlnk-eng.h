@@ -18,16 +18,35 @@
 #include <linux/interrupt.h>
 #include <linux/mutex.h>
 #include <linux/string.h>
+#include <linux/ktime.h>
 
+struct xlnk_eng_pool;
+
+/*
+ * The pool fields are protected by the engine list mutex. owner is the
+ * client holding the engine through its pool, busy_ns and jobs count the
+ * time it was held and the number of times it was handed out.
+ */
 struct xlnk_eng_device {
 	struct list_head global_node;
 	struct xlnk_eng_device * (*alloc)(struct xlnk_eng_device *xdev);
 	void (*free)(struct xlnk_eng_device *xdev);
 	struct device *dev;
+	struct xlnk_eng_pool *pool;
+	struct list_head pool_node;
+	void *owner;
+	ktime_t registered;
+	ktime_t busy_since;
+	u64 busy_ns;
+	unsigned long jobs;
 };
 extern int xlnk_eng_register_device(struct xlnk_eng_device *xlnk_dev);
 extern void xlnk_eng_unregister_device(struct xlnk_eng_device *xlnk_dev);
 extern struct xlnk_eng_device *xlnk_eng_request_by_name(char *name);
+extern int xlnk_eng_pool_add(const char *pool, const char *name);
+extern int xlnk_eng_pool_acquire(const char *pool, void *owner,
+				 bool nonblock);
+extern int xlnk_eng_pool_release(void *owner, int id);
 
 #endif
 
@@ -28,6 +28,13 @@
 #define XLNK_IOCCDMASUBMIT	_IOWR(XLNK_IOC_MAGIC, 20, unsigned long)
 #define XLNK_IOCMCDMAREGISTER	_IOWR(XLNK_IOC_MAGIC, 23, unsigned long)
 #define XLNK_IOCCACHECTRL	_IOWR(XLNK_IOC_MAGIC, 24, unsigned long)
+#define XLNK_IOCEXPORTDMABUF	_IOWR(XLNK_IOC_MAGIC, 25, unsigned long)
+#define XLNK_IOCDMASUBMITV	_IOWR(XLNK_IOC_MAGIC, 26, unsigned long)
+#define XLNK_IOCDMAREAP		_IOWR(XLNK_IOC_MAGIC, 27, unsigned long)
+#define XLNK_IOCDMAEVENTFD	_IOWR(XLNK_IOC_MAGIC, 28, unsigned long)
+#define XLNK_IOCENGPOOLADD	_IOWR(XLNK_IOC_MAGIC, 29, unsigned long)
+#define XLNK_IOCENGACQUIRE	_IOWR(XLNK_IOC_MAGIC, 30, unsigned long)
+#define XLNK_IOCENGRELEASE	_IOWR(XLNK_IOC_MAGIC, 31, unsigned long)
 
 #define XLNK_IOCSHUTDOWN	_IOWR(XLNK_IOC_MAGIC, 100, unsigned long)
 #define XLNK_IOCRECRES		_IOWR(XLNK_IOC_MAGIC, 101, unsigned long)
@@ -44,9 +44,19 @@
 #include <linux/dma-mapping.h>  /* dma */
 #include <linux/clk.h>
 #include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/genalloc.h>
+#include <linux/idr.h>
+#include <linux/mutex.h>
+#include <linux/sizes.h>
+#include <linux/kref.h>
+#include <linux/dma-buf.h>
+#include <linux/poll.h>
+#include <linux/eventfd.h>
 
 #include "xlnk-ioctl.h"
 #include "xlnk.h"
+#include "xlnk-eng.h"
 
 #ifdef CONFIG_XILINX_DMA_APF
 #include "xilinx-dma-apf.h"
@@ -80,12 +90,45 @@ static void *xlnk_dev_buf;
 static ssize_t xlnk_dev_size;
 static int xlnk_dev_vmas;
 
-#define XLNK_BUF_POOL_SIZE	256
-static void **xlnk_bufpool;
-static unsigned int xlnk_bufpool_size = XLNK_BUF_POOL_SIZE;
-static dma_addr_t xlnk_phyaddr[XLNK_BUF_POOL_SIZE];
-static size_t xlnk_buflen[XLNK_BUF_POOL_SIZE];
-static unsigned int  xlnk_bufcacheable[XLNK_BUF_POOL_SIZE];
+/*
+ * Buffers up to XLNK_SUBALLOC_MAX bytes are carved out of XLNK_CHUNK_SIZE
+ * chunks, with page granularity since every buffer is mmapped on its own.
+ * Larger buffers get their own allocation.
+ */
+#define XLNK_CHUNK_SIZE		SZ_1M
+#define XLNK_SUBALLOC_MAX	SZ_64K
+
+struct xlnk_chunk {
+	struct list_head node;
+	void *kaddr;
+	dma_addr_t phys;
+};
+
+struct xlnk_pool {
+	struct gen_pool *pool;
+	struct list_head chunks;
+	unsigned int cacheable;
+};
+
+struct xlnk_buf {
+	void *kaddr;
+	dma_addr_t phys;
+	size_t len;
+	unsigned int cacheable;
+	bool pooled;
+	/* held by the id and by each dma-buf exported from the buffer */
+	struct kref ref;
+};
+
+/* Buffer ids index xlnk_buf_idr, id 0 is xlnk_dev_buf */
+static DEFINE_IDR(xlnk_buf_idr);
+static DEFINE_MUTEX(xlnk_buf_mutex);
+/* Buffers still alive, including freed ones kept by a dma-buf */
+static unsigned int xlnk_nr_bufs;
+static struct xlnk_pool xlnk_pools[2] = {
+	{ .chunks = LIST_HEAD_INIT(xlnk_pools[0].chunks), .cacheable = 0 },
+	{ .chunks = LIST_HEAD_INIT(xlnk_pools[1].chunks), .cacheable = 1 },
+};
 
 
 static int xlnk_open(struct inode *ip, struct file *filp);  /* Open */
@@ -96,6 +139,7 @@ static ssize_t xlnk_read(struct file *filp, char __user *buf,
 			  size_t count, loff_t *offp);
 static ssize_t xlnk_write(struct file *filp, const char __user *buf,
 			  size_t count, loff_t *offp);
+static unsigned int xlnk_poll(struct file *filp, poll_table *wait);
 static int xlnk_mmap(struct file *filp, struct vm_area_struct *vma);
 static void xlnk_vma_open(struct vm_area_struct *vma);
 static void xlnk_vma_close(struct vm_area_struct *vma);
@@ -112,9 +156,30 @@ static const struct file_operations xlnk_fops = {
 	.read = xlnk_read,
 	.write = xlnk_write,
 	.unlocked_ioctl = xlnk_ioctl,
+	.poll = xlnk_poll,
 	.mmap = xlnk_mmap,
 };
 
+/*
+ * Per open file state of the asynchronous DMA interface. Transfers queued
+ * with XLNK_IOCDMASUBMITV land on done once complete, where poll() and the
+ * optional eventfd see them, until XLNK_IOCDMAREAP hands them back.
+ */
+struct xlnk_file {
+	spinlock_t lock;		/* protects done, pending and efd */
+	struct list_head done;
+	unsigned int pending;		/* submitted, not yet complete */
+	wait_queue_head_t wq;
+	struct eventfd_ctx *efd;
+};
+
+struct xlnk_async {
+	struct list_head node;		/* in xlnk_file.done */
+	struct xlnk_file *xf;
+	struct xdma_head *dmahead;
+	u64 user_data;
+};
+
 #define MAX_XLNK_DMAS 16
 
 struct xlnk_device_pack {
@@ -250,7 +315,6 @@ static int xlnk_probe(struct platform_device *pdev)
 	xlnk_dev_buf = NULL;
 	xlnk_dev_size = 0;
 	xlnk_dev_vmas = 0;
-	xlnk_bufpool = NULL;
 
 	/* use 2.6 device model */
 	err = alloc_chrdev_region(&dev, 0, 1, driver_name);
@@ -339,64 +403,200 @@ err1:
 	return err;
 }
 
-static int xlnk_buf_findnull(void)
+/* Write the CPU cache back, so that the device sees what the CPU wrote */
+static void xlnk_cache_flush(void *kaddr, dma_addr_t phys, size_t len)
 {
-	int i;
+	dmac_map_area(kaddr, len, DMA_TO_DEVICE);
+	outer_clean_range(phys, phys + len);
+}
+
+/*
+ * Uncached memory comes from dma_alloc_coherent, i.e. from CMA if it is
+ * configured. Cacheable memory comes from the page allocator and stays in
+ * the cacheable linear mapping, user space keeps it coherent with
+ * XLNK_IOCCACHECTRL.
+ */
+static void *xlnk_alloc_mem(size_t len, unsigned int cacheable,
+			    dma_addr_t *phys)
+{
+	void *kaddr;
+
+	if (!cacheable)
+		return dma_alloc_coherent(xlnk_dev, len, phys,
+					  GFP_KERNEL | GFP_DMA);
+
+	kaddr = alloc_pages_exact(len, GFP_KERNEL | GFP_DMA | __GFP_ZERO |
+				  __GFP_NOWARN);
+	if (!kaddr)
+		return NULL;
+
+	*phys = virt_to_phys(kaddr);
+	xlnk_cache_flush(kaddr, *phys, len);
+
+	return kaddr;
+}
+
+static void xlnk_free_mem(void *kaddr, size_t len, unsigned int cacheable,
+			  dma_addr_t phys)
+{
+	if (!cacheable)
+		dma_free_coherent(xlnk_dev, len, kaddr, phys);
+	else
+		free_pages_exact(kaddr, len);
+}
+
+static int xlnk_pool_grow(struct xlnk_pool *p)
+{
+	struct xlnk_chunk *chunk;
+	int err;
+
+	if (!p->pool) {
+		p->pool = gen_pool_create(PAGE_SHIFT, -1);
+		if (!p->pool)
+			return -ENOMEM;
+	}
+
+	chunk = kzalloc(sizeof(*chunk), GFP_KERNEL);
+	if (!chunk)
+		return -ENOMEM;
+
+	chunk->kaddr = xlnk_alloc_mem(XLNK_CHUNK_SIZE, p->cacheable,
+				      &chunk->phys);
+	if (!chunk->kaddr) {
+		kfree(chunk);
+		return -ENOMEM;
+	}
 
-	for (i = 1; i < xlnk_bufpool_size; i++) {
-		if (!xlnk_bufpool[i])
-			return i;
+	err = gen_pool_add_virt(p->pool, (unsigned long)chunk->kaddr,
+				chunk->phys, XLNK_CHUNK_SIZE, -1);
+	if (err) {
+		xlnk_free_mem(chunk->kaddr, XLNK_CHUNK_SIZE, p->cacheable,
+			      chunk->phys);
+		kfree(chunk);
+		return err;
 	}
 
+	list_add(&chunk->node, &p->chunks);
+
 	return 0;
 }
 
+static void *xlnk_pool_alloc(struct xlnk_pool *p, size_t len,
+			     dma_addr_t *phys)
+{
+	unsigned long kaddr = 0;
+
+	if (p->pool)
+		kaddr = gen_pool_alloc(p->pool, len);
+
+	if (!kaddr) {
+		if (xlnk_pool_grow(p))
+			return NULL;
+
+		kaddr = gen_pool_alloc(p->pool, len);
+		if (!kaddr)
+			return NULL;
+	}
+
+	*phys = gen_pool_virt_to_phys(p->pool, kaddr);
+
+	/* The slot may have been used by an earlier buffer */
+	memset((void *)kaddr, 0, len);
+	if (p->cacheable)
+		xlnk_cache_flush((void *)kaddr, *phys, len);
+
+	return (void *)kaddr;
+}
+
+/* Give the chunks back, all buffers carved out of them must be freed */
+static void xlnk_pool_release(struct xlnk_pool *p)
+{
+	struct xlnk_chunk *chunk, *next;
+
+	if (!p->pool)
+		return;
+
+	gen_pool_destroy(p->pool);
+	p->pool = NULL;
+
+	list_for_each_entry_safe(chunk, next, &p->chunks, node) {
+		list_del(&chunk->node);
+		xlnk_free_mem(chunk->kaddr, XLNK_CHUNK_SIZE, p->cacheable,
+			      chunk->phys);
+		kfree(chunk);
+	}
+}
+
 /**
  * allocate and return an id
  * id must be a positve number
  */
-static int xlnk_allocbuf(unsigned int len, unsigned int cacheable)
+static int xlnk_allocbuf(unsigned int len, unsigned int cacheable,
+			 dma_addr_t *phys)
 {
+	struct xlnk_buf *buf;
 	int id;
 
-	id = xlnk_buf_findnull();
+	if (!len)
+		return -EINVAL;
 
-	if (id <= 0)
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
 		return -ENOMEM;
 
-	xlnk_bufpool[id] = dma_alloc_coherent(xlnk_dev, len,
-					      &xlnk_phyaddr[id],
-					      GFP_KERNEL | GFP_DMA);
-	xlnk_buflen[id] = len;
-	xlnk_bufcacheable[id] = cacheable;
+	buf->len = len;
+	buf->cacheable = !!cacheable;
+	kref_init(&buf->ref);
+
+	mutex_lock(&xlnk_buf_mutex);
+
+	if (len <= XLNK_SUBALLOC_MAX) {
+		buf->kaddr = xlnk_pool_alloc(&xlnk_pools[buf->cacheable], len,
+					     &buf->phys);
+		buf->pooled = true;
+	} else {
+		buf->kaddr = xlnk_alloc_mem(len, buf->cacheable, &buf->phys);
+	}
 
-	if (!xlnk_bufpool[id]) {
-		pr_err("%s: dma_alloc_coherent of %d byte buffer failed\n",
+	if (!buf->kaddr) {
+		pr_err("%s: allocation of %d byte buffer failed\n",
 		       __func__, len);
-		return -ENOMEM;
+		id = -ENOMEM;
+		goto err_free;
 	}
 
+	id = idr_alloc(&xlnk_buf_idr, buf, 1, 0, GFP_KERNEL);
+	if (id < 0)
+		goto err_free_mem;
+
+	xlnk_nr_bufs++;
+	mutex_unlock(&xlnk_buf_mutex);
+
+	*phys = buf->phys;
+
+	return id;
+
+err_free_mem:
+	if (buf->pooled)
+		gen_pool_free(xlnk_pools[buf->cacheable].pool,
+			      (unsigned long)buf->kaddr, len);
+	else
+		xlnk_free_mem(buf->kaddr, len, buf->cacheable, buf->phys);
+err_free:
+	mutex_unlock(&xlnk_buf_mutex);
+	kfree(buf);
 	return id;
 }
 
 static int xlnk_init_bufpool(void)
 {
-	unsigned int i;
-
 	xlnk_dev_buf = kmalloc(8192, GFP_KERNEL | __GFP_DMA);
-	*((char *)xlnk_dev_buf) = '\0';
-
 	if (!xlnk_dev_buf) {
 		pr_err("%s: malloc failed\n", __func__);
 		return -ENOMEM;
 	}
 
-	xlnk_bufpool = kmalloc(sizeof(void *) * xlnk_bufpool_size,
-				   GFP_KERNEL);
-
-	xlnk_bufpool[0] = xlnk_dev_buf;
-	for (i = 1; i < xlnk_bufpool_size; i++)
-		xlnk_bufpool[i] = NULL;
+	*((char *)xlnk_dev_buf) = '\0';
 
 	return 0;
 }
@@ -404,6 +604,8 @@ static int xlnk_init_bufpool(void)
 #define XLNK_SUSPEND NULL
 #define XLNK_RESUME NULL
 
+static void xlnk_free_all_buf(void);
+
 static int xlnk_remove(struct platform_device *pdev)
 {
 	dev_t devno;
@@ -411,8 +613,8 @@ static int xlnk_remove(struct platform_device *pdev)
 	kfree(xlnk_dev_buf);
 	xlnk_dev_buf = NULL;
 
-	kfree(xlnk_bufpool);
-	xlnk_bufpool = NULL;
+	xlnk_free_all_buf();
+	idr_destroy(&xlnk_buf_idr);
 
 	devno = MKDEV(driver_major, 0);
 	cdev_del(&xlnk_cdev);
@@ -453,8 +655,18 @@ static u64 dma_mask = 0xFFFFFFFFUL;
  */
 static int xlnk_open(struct inode *ip, struct file *filp)
 {
+	struct xlnk_file *xf;
 	int status = 0;
 
+	xf = kzalloc(sizeof(*xf), GFP_KERNEL);
+	if (!xf)
+		return -ENOMEM;
+
+	spin_lock_init(&xf->lock);
+	INIT_LIST_HEAD(&xf->done);
+	init_waitqueue_head(&xf->wq);
+	filp->private_data = xf;
+
 	if ((filp->f_flags & O_ACCMODE) == O_WRONLY)
 		xlnk_dev_size = 0;
 	xlnk_clk_control(true);
@@ -511,13 +723,44 @@ static ssize_t xlnk_write(struct file *filp, const char __user *buf,
  * This function is called when an application closes handle to the bridge
  * driver.
  */
+static void xlnk_async_drain(struct xlnk_file *xf);
+
 static int xlnk_release(struct inode *ip, struct file *filp)
 {
+	struct xlnk_file *xf = filp->private_data;
+
+	xlnk_async_drain(xf);
+	xlnk_eng_pool_release(xf, -1);
+	if (xf->efd)
+		eventfd_ctx_put(xf->efd);
+	kfree(xf);
+
 	xlnk_clk_control(false);
 	return 0;
 }
 
 
+/*
+ * Devices registered through xlnk have no device tree node of their own.
+ * Look for the node describing the same registers, so that marking an ACP
+ * attached core "dma-coherent" selects the coherent DMA ops for it.
+ */
+static bool xlnk_of_dma_is_coherent(unsigned long base)
+{
+	struct device_node *np;
+	struct resource res;
+
+	for_each_node_with_property(np, "dma-coherent") {
+		if (!of_address_to_resource(np, 0, &res) &&
+		    res.start == base) {
+			of_node_put(np);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static int xlnk_devregister(char *name, unsigned int id,
 				unsigned long base, unsigned int size,
 				unsigned int *irqs,
@@ -571,6 +814,9 @@ static int xlnk_devregister(char *name, unsigned int id,
 	devpack->pdev.resource = devpack->res;
 	devpack->pdev.num_resources = nres;
 
+	if (xlnk_of_dma_is_coherent(base))
+		set_arch_dma_coherent_ops(&devpack->pdev.dev);
+
 	status = platform_device_register(&devpack->pdev);
 	if (status) {
 		kfree(devpack);
@@ -661,6 +907,11 @@ static int xlnk_dmaregister(char *name, unsigned int id,
 	devpack->pdev.resource = devpack->res;
 	devpack->pdev.num_resources = 1;
 
+	if (xlnk_of_dma_is_coherent(base)) {
+		set_arch_dma_coherent_ops(&devpack->pdev.dev);
+		devpack->dma_dev_cfg.coherent = 1;
+	}
+
 	status = platform_device_register(&devpack->pdev);
 	if (status) {
 		kfree(devpack);
@@ -727,6 +978,9 @@ static int xlnk_mcdmaregister(char *name, unsigned int id,
 	devpack->pdev.resource	  = devpack->res;
 	devpack->pdev.num_resources = 2;
 
+	if (xlnk_of_dma_is_coherent(base))
+		set_arch_dma_coherent_ops(&devpack->pdev.dev);
+
 	status = platform_device_register(&devpack->pdev);
 	if (status) {
 		kfree(devpack);
@@ -747,6 +1001,7 @@ static int xlnk_allocbuf_ioctl(struct file *filp, unsigned int code,
 
 	union xlnk_args temp_args;
 	int status;
+	dma_addr_t phys;
 	int id;
 
 	status = copy_from_user(&temp_args, (void __user *)args,
@@ -756,42 +1011,78 @@ static int xlnk_allocbuf_ioctl(struct file *filp, unsigned int code,
 		return -ENOMEM;
 
 	id = xlnk_allocbuf(temp_args.allocbuf.len,
-			   temp_args.allocbuf.cacheable);
+			   temp_args.allocbuf.cacheable, &phys);
 
 	if (id <= 0)
 		return -ENOMEM;
 
 	put_user(id, temp_args.allocbuf.idptr);
-	put_user((u32)(xlnk_phyaddr[id]), temp_args.allocbuf.phyaddrptr);
+	put_user((u32)phys, temp_args.allocbuf.phyaddrptr);
 
 	return 0;
 }
 
+/* Called with xlnk_buf_mutex held when the last reference is gone */
+static void __xlnk_freebuf(struct kref *ref)
+{
+	struct xlnk_buf *buf = container_of(ref, struct xlnk_buf, ref);
+
+	if (buf->pooled)
+		gen_pool_free(xlnk_pools[buf->cacheable].pool,
+			      (unsigned long)buf->kaddr, buf->len);
+	else
+		xlnk_free_mem(buf->kaddr, buf->len, buf->cacheable,
+			      buf->phys);
+
+	kfree(buf);
+	xlnk_nr_bufs--;
+}
+
 static int xlnk_freebuf(int id)
 {
+	struct xlnk_buf *buf;
 
-	if (id <= 0 || id >= xlnk_bufpool_size)
+	if (id <= 0)
 		return -ENOMEM;
 
-	if (!xlnk_bufpool[id])
+	mutex_lock(&xlnk_buf_mutex);
+
+	buf = idr_find(&xlnk_buf_idr, id);
+	if (!buf) {
+		mutex_unlock(&xlnk_buf_mutex);
 		return -ENOMEM;
+	}
 
-	dma_free_coherent(xlnk_dev, xlnk_buflen[id], xlnk_bufpool[id],
-			  xlnk_phyaddr[id]);
+	idr_remove(&xlnk_buf_idr, id);
+	kref_put(&buf->ref, __xlnk_freebuf);
 
-	xlnk_bufpool[id] = NULL;
-	xlnk_phyaddr[id] = (dma_addr_t)NULL;
-	xlnk_buflen[id] = 0;
+	mutex_unlock(&xlnk_buf_mutex);
 
 	return 0;
 }
 
 static void xlnk_free_all_buf(void)
 {
-	int i;
+	struct xlnk_buf *buf;
+	int id;
+
+	mutex_lock(&xlnk_buf_mutex);
+
+	idr_for_each_entry(&xlnk_buf_idr, buf, id) {
+		idr_remove(&xlnk_buf_idr, id);
+		kref_put(&buf->ref, __xlnk_freebuf);
+	}
+
+	/*
+	 * Buffers exported as dma-buf stay alive until their importers let
+	 * go, keep the chunks around for them.
+	 */
+	if (!xlnk_nr_bufs) {
+		xlnk_pool_release(&xlnk_pools[0]);
+		xlnk_pool_release(&xlnk_pools[1]);
+	}
 
-	for (i = 1; i < xlnk_bufpool_size; i++)
-		xlnk_freebuf(i);
+	mutex_unlock(&xlnk_buf_mutex);
 }
 
 static int xlnk_freebuf_ioctl(struct file *filp, unsigned int code,
@@ -929,6 +1220,242 @@ static int xlnk_dmawait_ioctl(struct file *filp, unsigned int code,
 	return status;
 }
 
+#ifdef CONFIG_XILINX_DMA_APF
+/* Completion path of xdma_submit_cb, called with the channel lock held */
+static void xlnk_async_done(struct xdma_head *dmahead, void *param)
+{
+	struct xlnk_async *async = param;
+	struct xlnk_file *xf = async->xf;
+	unsigned long flags;
+
+	spin_lock_irqsave(&xf->lock, flags);
+	async->dmahead = dmahead;
+	list_add_tail(&async->node, &xf->done);
+	xf->pending--;
+	if (xf->efd)
+		eventfd_signal(xf->efd, 1);
+	/* under the lock, xlnk_release may free xf as soon as it is dropped */
+	wake_up(&xf->wq);
+	spin_unlock_irqrestore(&xf->lock, flags);
+}
+#endif
+
+static int xlnk_async_submit(struct xlnk_file *xf, struct xlnk_dma_req *req)
+{
+#ifdef CONFIG_XILINX_DMA_APF
+	struct xdma_chan *chan = (struct xdma_chan *)req->dmachan;
+	struct xlnk_async *async;
+	struct xdma_head *dmahead;
+	int status;
+
+	if (!chan)
+		return -ENODEV;
+
+	/* nothing would ever complete a polled channel on its own */
+	if (chan->poll_mode)
+		return -EINVAL;
+
+	async = kzalloc(sizeof(*async), GFP_KERNEL);
+	if (!async)
+		return -ENOMEM;
+
+	async->xf = xf;
+	async->user_data = req->user_data;
+
+	spin_lock_irq(&xf->lock);
+	xf->pending++;
+	spin_unlock_irq(&xf->lock);
+
+	status = xdma_submit_cb(chan, req->buf, req->len, req->nappwords_i,
+				req->appwords_i, req->nappwords_o, req->flag,
+				xlnk_async_done, async, &dmahead);
+	if (status) {
+		spin_lock_irq(&xf->lock);
+		xf->pending--;
+		spin_unlock_irq(&xf->lock);
+		kfree(async);
+	}
+
+	return status;
+#else
+	return -ENODEV;
+#endif
+}
+
+/* Release the buffers of a completed transfer */
+static void xlnk_async_finish(struct xlnk_async *async)
+{
+#ifdef CONFIG_XILINX_DMA_APF
+	xdma_wait(async->dmahead, async->dmahead->userflag);
+	kfree(async->dmahead);
+#endif
+	kfree(async);
+}
+
+static struct xlnk_async *xlnk_async_pop(struct xlnk_file *xf)
+{
+	struct xlnk_async *async = NULL;
+
+	spin_lock_irq(&xf->lock);
+	if (!list_empty(&xf->done)) {
+		async = list_first_entry(&xf->done, struct xlnk_async, node);
+		list_del(&async->node);
+	}
+	spin_unlock_irq(&xf->lock);
+
+	return async;
+}
+
+static bool xlnk_async_idle(struct xlnk_file *xf)
+{
+	bool idle;
+
+	spin_lock_irq(&xf->lock);
+	idle = !xf->pending;
+	spin_unlock_irq(&xf->lock);
+
+	return idle;
+}
+
+/* Wait for everything still in flight and drop the completions */
+static void xlnk_async_drain(struct xlnk_file *xf)
+{
+	struct xlnk_async *async;
+
+	wait_event(xf->wq, xlnk_async_idle(xf));
+
+	while ((async = xlnk_async_pop(xf)))
+		xlnk_async_finish(async);
+}
+
+static int xlnk_dmasubmitv_ioctl(struct file *filp, unsigned int code,
+				 unsigned long args)
+{
+	struct xlnk_file *xf = filp->private_data;
+	union xlnk_args temp_args;
+	struct xlnk_dma_req req;
+	unsigned int i;
+	int status = 0;
+
+	if (copy_from_user(&temp_args, (void __user *)args,
+			   sizeof(union xlnk_args)))
+		return -EFAULT;
+
+	for (i = 0; i < temp_args.dmasubmitv.nreqs; i++) {
+		if (copy_from_user(&req, &temp_args.dmasubmitv.reqs[i],
+				   sizeof(req))) {
+			status = -EFAULT;
+			break;
+		}
+
+		status = xlnk_async_submit(xf, &req);
+		if (status)
+			break;
+	}
+
+	/* report partial success, the caller resubmits the rest */
+	if (!i)
+		return status;
+
+	temp_args.dmasubmitv.nreqs = i;
+	if (copy_to_user((void __user *)args, &temp_args,
+			 sizeof(union xlnk_args)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int xlnk_dmareap_ioctl(struct file *filp, unsigned int code,
+			      unsigned long args)
+{
+	struct xlnk_file *xf = filp->private_data;
+	union xlnk_args temp_args;
+	struct xlnk_dma_cmpl cmpl;
+	struct xlnk_async *async;
+	unsigned int i;
+
+	if (copy_from_user(&temp_args, (void __user *)args,
+			   sizeof(union xlnk_args)))
+		return -EFAULT;
+
+	for (i = 0; i < temp_args.dmareap.ncmpls; i++) {
+		async = xlnk_async_pop(xf);
+		if (!async)
+			break;
+
+		memset(&cmpl, 0, sizeof(cmpl));
+		cmpl.user_data = async->user_data;
+#ifdef CONFIG_XILINX_DMA_APF
+		cmpl.nappwords = async->dmahead->nappwords_o;
+		memcpy(cmpl.appwords, async->dmahead->appwords_o,
+		       cmpl.nappwords * sizeof(u32));
+#endif
+
+		if (copy_to_user(&temp_args.dmareap.cmpls[i], &cmpl,
+				 sizeof(cmpl))) {
+			/* keep the completion for the next attempt */
+			spin_lock_irq(&xf->lock);
+			list_add(&async->node, &xf->done);
+			spin_unlock_irq(&xf->lock);
+			if (!i)
+				return -EFAULT;
+			break;
+		}
+
+		xlnk_async_finish(async);
+	}
+
+	temp_args.dmareap.ncmpls = i;
+	if (copy_to_user((void __user *)args, &temp_args,
+			 sizeof(union xlnk_args)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int xlnk_dmaeventfd_ioctl(struct file *filp, unsigned int code,
+				 unsigned long args)
+{
+	struct xlnk_file *xf = filp->private_data;
+	union xlnk_args temp_args;
+	struct eventfd_ctx *efd = NULL, *old;
+
+	if (copy_from_user(&temp_args, (void __user *)args,
+			   sizeof(union xlnk_args)))
+		return -EFAULT;
+
+	if (temp_args.dmaeventfd.fd >= 0) {
+		efd = eventfd_ctx_fdget(temp_args.dmaeventfd.fd);
+		if (IS_ERR(efd))
+			return PTR_ERR(efd);
+	}
+
+	spin_lock_irq(&xf->lock);
+	old = xf->efd;
+	xf->efd = efd;
+	spin_unlock_irq(&xf->lock);
+
+	if (old)
+		eventfd_ctx_put(old);
+
+	return 0;
+}
+
+static unsigned int xlnk_poll(struct file *filp, poll_table *wait)
+{
+	struct xlnk_file *xf = filp->private_data;
+	unsigned int mask = 0;
+
+	poll_wait(filp, &xf->wq, wait);
+
+	spin_lock_irq(&xf->lock);
+	if (!list_empty(&xf->done))
+		mask |= POLLIN | POLLRDNORM;
+	spin_unlock_irq(&xf->lock);
+
+	return mask;
+}
+
 static int xlnk_dmarelease_ioctl(struct file *filp, unsigned int code,
 				 unsigned long args)
 {
@@ -1031,6 +1558,170 @@ static int xlnk_mcdmaregister_ioctl(struct file *filp, unsigned int code,
 
 	return status;
 }
+static struct sg_table *xlnk_dmabuf_map(struct dma_buf_attachment *attach,
+					enum dma_data_direction dir)
+{
+	struct xlnk_buf *buf = attach->dmabuf->priv;
+	struct sg_table *sgt;
+	DEFINE_DMA_ATTRS(attrs);
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	if (sg_alloc_table(sgt, 1, GFP_KERNEL)) {
+		kfree(sgt);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	sg_set_page(sgt->sgl, pfn_to_page(PFN_DOWN(buf->phys)),
+		    PAGE_ALIGN(buf->len), 0);
+
+	/* Uncached buffers need no cache maintenance */
+	if (!buf->cacheable)
+		dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+
+	if (!dma_map_sg_attrs(attach->dev, sgt->sgl, sgt->nents, dir,
+			      &attrs)) {
+		sg_free_table(sgt);
+		kfree(sgt);
+		return ERR_PTR(-EIO);
+	}
+
+	return sgt;
+}
+
+static void xlnk_dmabuf_unmap(struct dma_buf_attachment *attach,
+			      struct sg_table *sgt,
+			      enum dma_data_direction dir)
+{
+	struct xlnk_buf *buf = attach->dmabuf->priv;
+	DEFINE_DMA_ATTRS(attrs);
+
+	if (!buf->cacheable)
+		dma_set_attr(DMA_ATTR_SKIP_CPU_SYNC, &attrs);
+
+	dma_unmap_sg_attrs(attach->dev, sgt->sgl, sgt->nents, dir, &attrs);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void xlnk_dmabuf_release(struct dma_buf *dmabuf)
+{
+	struct xlnk_buf *buf = dmabuf->priv;
+
+	mutex_lock(&xlnk_buf_mutex);
+	kref_put(&buf->ref, __xlnk_freebuf);
+	mutex_unlock(&xlnk_buf_mutex);
+}
+
+static int xlnk_dmabuf_begin_cpu_access(struct dma_buf *dmabuf, size_t start,
+					size_t len,
+					enum dma_data_direction dir)
+{
+	struct xlnk_buf *buf = dmabuf->priv;
+
+	if (buf->cacheable && dir != DMA_TO_DEVICE) {
+		outer_inv_range(buf->phys + start, buf->phys + start + len);
+		dmac_unmap_area(buf->kaddr + start, len, DMA_FROM_DEVICE);
+	}
+
+	return 0;
+}
+
+static void xlnk_dmabuf_end_cpu_access(struct dma_buf *dmabuf, size_t start,
+				       size_t len,
+				       enum dma_data_direction dir)
+{
+	struct xlnk_buf *buf = dmabuf->priv;
+
+	if (buf->cacheable && dir != DMA_FROM_DEVICE)
+		xlnk_cache_flush(buf->kaddr + start, buf->phys + start, len);
+}
+
+static void *xlnk_dmabuf_kmap(struct dma_buf *dmabuf, unsigned long pgnum)
+{
+	struct xlnk_buf *buf = dmabuf->priv;
+
+	return buf->kaddr + pgnum * PAGE_SIZE;
+}
+
+static int xlnk_dmabuf_mmap(struct dma_buf *dmabuf,
+			    struct vm_area_struct *vma)
+{
+	struct xlnk_buf *buf = dmabuf->priv;
+
+	if (!buf->cacheable)
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start,
+			       PFN_DOWN(buf->phys) + vma->vm_pgoff,
+			       vma->vm_end - vma->vm_start,
+			       vma->vm_page_prot);
+}
+
+static const struct dma_buf_ops xlnk_dmabuf_ops = {
+	.map_dma_buf = xlnk_dmabuf_map,
+	.unmap_dma_buf = xlnk_dmabuf_unmap,
+	.release = xlnk_dmabuf_release,
+	.begin_cpu_access = xlnk_dmabuf_begin_cpu_access,
+	.end_cpu_access = xlnk_dmabuf_end_cpu_access,
+	.kmap_atomic = xlnk_dmabuf_kmap,
+	.kmap = xlnk_dmabuf_kmap,
+	.mmap = xlnk_dmabuf_mmap,
+};
+
+/*
+ * Export a buffer as a dma-buf, so that V4L2, DRM or another xlnk user can
+ * attach to it without copies. The buffer stays valid until both the id and
+ * the last dma-buf reference are gone.
+ */
+static int xlnk_exportdmabuf_ioctl(struct file *filp, unsigned int code,
+				   unsigned long args)
+{
+	union xlnk_args temp_args;
+	struct xlnk_buf *buf;
+	struct dma_buf *dbuf;
+	int fd;
+
+	if (copy_from_user(&temp_args, (void __user *)args,
+			   sizeof(union xlnk_args)))
+		return -EFAULT;
+
+	mutex_lock(&xlnk_buf_mutex);
+
+	buf = idr_find(&xlnk_buf_idr, temp_args.exportdmabuf.id);
+	if (!buf) {
+		mutex_unlock(&xlnk_buf_mutex);
+		return -EINVAL;
+	}
+	kref_get(&buf->ref);
+
+	mutex_unlock(&xlnk_buf_mutex);
+
+	dbuf = dma_buf_export(buf, &xlnk_dmabuf_ops, PAGE_ALIGN(buf->len),
+			      O_RDWR, NULL);
+	if (IS_ERR(dbuf)) {
+		mutex_lock(&xlnk_buf_mutex);
+		kref_put(&buf->ref, __xlnk_freebuf);
+		mutex_unlock(&xlnk_buf_mutex);
+		return PTR_ERR(dbuf);
+	}
+
+	/* From here on the buffer reference belongs to the dma-buf */
+	fd = dma_buf_fd(dbuf, temp_args.exportdmabuf.flags & O_CLOEXEC);
+	if (fd < 0) {
+		dma_buf_put(dbuf);
+		return fd;
+	}
+
+	temp_args.exportdmabuf.fd = fd;
+	if (copy_to_user((void __user *)args, &temp_args,
+			 sizeof(union xlnk_args)))
+		return -EFAULT;
+
+	return 0;
+}
 
 static int xlnk_devunregister_ioctl(struct file *filp, unsigned int code,
 					unsigned long args)
@@ -1049,6 +1740,51 @@ static int xlnk_devunregister_ioctl(struct file *filp, unsigned int code,
 	return 0;
 }
 
+/*
+ * Engine pools: XLNK_IOCENGPOOLADD puts an xlnk engine into a named pool,
+ * XLNK_IOCENGACQUIRE returns the id of the first idle engine of a pool,
+ * waiting in turn unless XLNK_ENG_NONBLOCK is set, and XLNK_IOCENGRELEASE
+ * gives it back. Engines still held are given back when the file is closed.
+ */
+static int xlnk_engpool_ioctl(struct file *filp, unsigned int code,
+			      unsigned long args)
+{
+	union xlnk_args temp_args;
+	char name[64];
+	int ret;
+
+	if (copy_from_user(&temp_args, (void __user *)args,
+			   sizeof(union xlnk_args)))
+		return -EFAULT;
+
+	temp_args.engpool.pool[sizeof(temp_args.engpool.pool) - 1] = '\0';
+
+	switch (code) {
+	case XLNK_IOCENGPOOLADD:
+		snprintf(name, sizeof(name), "xilinx-xlnk-eng.%u",
+			 temp_args.engpool.id);
+		return xlnk_eng_pool_add(temp_args.engpool.pool, name);
+	case XLNK_IOCENGRELEASE:
+		return xlnk_eng_pool_release(filp->private_data,
+					     temp_args.engpool.id);
+	}
+
+	ret = xlnk_eng_pool_acquire(temp_args.engpool.pool, filp->private_data,
+				    temp_args.engpool.flags &
+				    XLNK_ENG_NONBLOCK);
+	if (ret < 0)
+		return ret;
+
+	temp_args.engpool.id = ret;
+	if (copy_to_user((void __user *)args, &temp_args,
+			 sizeof(union xlnk_args))) {
+		xlnk_eng_pool_release(filp->private_data, ret);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
 static int xlnk_cachecontrol_ioctl(struct file *filp, unsigned int code,
 				   unsigned long args)
 {
@@ -1134,9 +1870,26 @@ static long xlnk_ioctl(struct file *filp, unsigned int code,
 	case XLNK_IOCDEVUNREGISTER:
 		status = xlnk_devunregister_ioctl(filp, code, args);
 		break;
+	case XLNK_IOCDMASUBMITV:
+		status = xlnk_dmasubmitv_ioctl(filp, code, args);
+		break;
+	case XLNK_IOCDMAREAP:
+		status = xlnk_dmareap_ioctl(filp, code, args);
+		break;
+	case XLNK_IOCDMAEVENTFD:
+		status = xlnk_dmaeventfd_ioctl(filp, code, args);
+		break;
+	case XLNK_IOCEXPORTDMABUF:
+		status = xlnk_exportdmabuf_ioctl(filp, code, args);
+		break;
 	case XLNK_IOCCACHECTRL:
 		status = xlnk_cachecontrol_ioctl(filp, code, args);
 		break;
+	case XLNK_IOCENGPOOLADD:
+	case XLNK_IOCENGACQUIRE:
+	case XLNK_IOCENGRELEASE:
+		status = xlnk_engpool_ioctl(filp, code, args);
+		break;
 	case XLNK_IOCSHUTDOWN:
 		status = xlnk_shutdown(args);
 		break;
@@ -1157,31 +1910,45 @@ static struct vm_operations_struct xlnk_vm_ops = {
 static int xlnk_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 
+	struct xlnk_buf *buf;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	void *kaddr;
 	int bufid;
 	int status;
 
 	bufid = vma->vm_pgoff >> (24 - PAGE_SHIFT);
 
-	if (bufid == 0)
+	if (bufid == 0) {
+		kaddr = xlnk_dev_buf;
 		status = remap_pfn_range(vma, vma->vm_start,
 				virt_to_phys(xlnk_dev_buf) >> PAGE_SHIFT,
-				vma->vm_end - vma->vm_start,
-				vma->vm_page_prot);
-	else {
-		if (xlnk_bufcacheable[bufid] == 0)
+				size, vma->vm_page_prot);
+	} else {
+		mutex_lock(&xlnk_buf_mutex);
+
+		/* Pooled buffers have neighbours, never map beyond one */
+		buf = idr_find(&xlnk_buf_idr, bufid);
+		if (!buf || size > PAGE_ALIGN(buf->len)) {
+			mutex_unlock(&xlnk_buf_mutex);
+			return -EINVAL;
+		}
+
+		if (buf->cacheable == 0)
 			vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
 
+		kaddr = buf->kaddr;
 		status = remap_pfn_range(vma, vma->vm_start,
-					 xlnk_phyaddr[bufid] >> PAGE_SHIFT,
-					 vma->vm_end - vma->vm_start,
-					 vma->vm_page_prot);
+					 buf->phys >> PAGE_SHIFT,
+					 size, vma->vm_page_prot);
+
+		mutex_unlock(&xlnk_buf_mutex);
 	}
 	if (status)
 		return -EAGAIN;
 
 	xlnk_vma_open(vma);
 	vma->vm_ops = &xlnk_vm_ops;
-	vma->vm_private_data = xlnk_bufpool[bufid];
+	vma->vm_private_data = kaddr;
 
 	return 0;
 }
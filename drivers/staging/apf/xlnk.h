@@ -12,6 +12,9 @@
 #define CF_FLAG_CACHE_FLUSH_INVALIDATE	0x00000001
 #define CF_FLAG_PHYSICALLY_CONTIGUOUS	0x00000002
 #define CF_FLAG_DMAPOLLING		0x00000004
+#define CF_FLAG_DMA_BUF			0x00000008 /* buf is a dma-buf fd */
+
+#define XLNK_ENG_NONBLOCK		0x00000001 /* fail if all are busy */
 
 
 enum xlnk_dma_direction {
@@ -108,6 +111,49 @@ union xlnk_args {
 		int size;
 		int action;
 	} cachecontrol;
+	struct {
+		struct xlnk_dma_req __user *reqs;
+		unsigned int nreqs;	/* in: requests, out: submitted */
+	} dmasubmitv;
+	struct {
+		struct xlnk_dma_cmpl __user *cmpls;
+		unsigned int ncmpls;	/* in: room, out: completions */
+	} dmareap;
+	struct {
+		int fd;			/* eventfd to signal, -1 for none */
+	} dmaeventfd;
+	struct {
+		unsigned int id;	/* buffer to export */
+		unsigned int flags;	/* O_CLOEXEC */
+		int fd;			/* return value */
+	} exportdmabuf;
+	struct {
+		char pool[32];		/* pool name */
+		unsigned int id;	/* engine xilinx-xlnk-eng.<id> */
+		unsigned int flags;	/* XLNK_ENG_NONBLOCK */
+	} engpool;
+};
+
+/*
+ * One transfer of XLNK_IOCDMASUBMITV. The fields match dmasubmit, user_data
+ * is handed back with the completion.
+ */
+struct xlnk_dma_req {
+	u32 dmachan;
+	void *buf;
+	unsigned int len;
+	unsigned int flag;
+	unsigned int nappwords_i;
+	unsigned int appwords_i[XLNK_MAX_APPWORDS];
+	unsigned int nappwords_o;
+	u64 user_data;
+};
+
+/* One completion returned by XLNK_IOCDMAREAP */
+struct xlnk_dma_cmpl {
+	u64 user_data;
+	unsigned int nappwords;
+	unsigned int appwords[XLNK_MAX_APPWORDS];
 };
 
 
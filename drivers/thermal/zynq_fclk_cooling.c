@@ -0,0 +1,208 @@
+/*
+ * Zynq PL clock cooling device
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Slows down the fabric clocks (FCLK0-3) feeding the programmable logic
+ * when a thermal zone asks for it: cooling state n runs every clock of
+ * the node at 1/(n + 1) of the rate it had at probe time. The designs
+ * behind these clocks must of course cope with the lower rates.
+ *
+ *	fclk_cooling: fclk-cooling {
+ *		compatible = "xlnx,zynq-fclk-cooling";
+ *		clocks = <&clkc 15>, <&clkc 16>;
+ *		xlnx,max-cooling-state = <3>;
+ *		#cooling-cells = <2>;
+ *	};
+ */
+
+#include <linux/clk.h>
+#include <linux/err.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/thermal.h>
+
+#define FCLK_COOLING_DEFAULT_MAX_STATE	3
+
+struct fclk_cooling {
+	struct device *dev;
+	struct thermal_cooling_device *cdev;
+	struct mutex lock;
+	unsigned long state;
+	unsigned long max_state;
+	unsigned int nr_clks;
+	struct clk **clks;
+	unsigned long *rates;
+};
+
+static int fclk_cooling_get_max_state(struct thermal_cooling_device *cdev,
+				      unsigned long *state)
+{
+	struct fclk_cooling *fc = cdev->devdata;
+
+	*state = fc->max_state;
+	return 0;
+}
+
+static int fclk_cooling_get_cur_state(struct thermal_cooling_device *cdev,
+				      unsigned long *state)
+{
+	struct fclk_cooling *fc = cdev->devdata;
+
+	*state = fc->state;
+	return 0;
+}
+
+static int fclk_cooling_apply(struct fclk_cooling *fc, unsigned long state)
+{
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < fc->nr_clks; i++) {
+		int err = clk_set_rate(fc->clks[i], fc->rates[i] / (state + 1));
+
+		if (err) {
+			dev_warn(fc->dev, "failed to set rate of clock %u: %d\n",
+				 i, err);
+			ret = err;
+		}
+	}
+
+	return ret;
+}
+
+static int fclk_cooling_set_cur_state(struct thermal_cooling_device *cdev,
+				      unsigned long state)
+{
+	struct fclk_cooling *fc = cdev->devdata;
+	int ret = 0;
+
+	if (state > fc->max_state)
+		return -EINVAL;
+
+	mutex_lock(&fc->lock);
+	if (state != fc->state) {
+		ret = fclk_cooling_apply(fc, state);
+		fc->state = state;
+	}
+	mutex_unlock(&fc->lock);
+
+	return ret;
+}
+
+static const struct thermal_cooling_device_ops fclk_cooling_ops = {
+	.get_max_state = fclk_cooling_get_max_state,
+	.get_cur_state = fclk_cooling_get_cur_state,
+	.set_cur_state = fclk_cooling_set_cur_state,
+};
+
+static void fclk_cooling_put_clks(struct fclk_cooling *fc)
+{
+	unsigned int i;
+
+	for (i = 0; i < fc->nr_clks; i++)
+		if (!IS_ERR_OR_NULL(fc->clks[i]))
+			clk_put(fc->clks[i]);
+}
+
+static int fclk_cooling_probe(struct platform_device *pdev)
+{
+	struct device_node *np = pdev->dev.of_node;
+	struct fclk_cooling *fc;
+	unsigned int i;
+	u32 max_state;
+	int ret, nr;
+
+	nr = of_count_phandle_with_args(np, "clocks", "#clock-cells");
+	if (nr <= 0) {
+		dev_err(&pdev->dev, "no clocks to slow down\n");
+		return -EINVAL;
+	}
+
+	fc = devm_kzalloc(&pdev->dev, sizeof(*fc), GFP_KERNEL);
+	if (!fc)
+		return -ENOMEM;
+
+	fc->clks = devm_kcalloc(&pdev->dev, nr, sizeof(*fc->clks), GFP_KERNEL);
+	fc->rates = devm_kcalloc(&pdev->dev, nr, sizeof(*fc->rates),
+				 GFP_KERNEL);
+	if (!fc->clks || !fc->rates)
+		return -ENOMEM;
+
+	fc->dev = &pdev->dev;
+	fc->nr_clks = nr;
+	mutex_init(&fc->lock);
+
+	if (of_property_read_u32(np, "xlnx,max-cooling-state", &max_state))
+		max_state = FCLK_COOLING_DEFAULT_MAX_STATE;
+	fc->max_state = max_state;
+
+	for (i = 0; i < fc->nr_clks; i++) {
+		fc->clks[i] = of_clk_get(np, i);
+		if (IS_ERR(fc->clks[i])) {
+			ret = PTR_ERR(fc->clks[i]);
+			if (ret != -EPROBE_DEFER)
+				dev_err(&pdev->dev, "failed to get clock %u\n",
+					i);
+			goto err_put_clks;
+		}
+		fc->rates[i] = clk_get_rate(fc->clks[i]);
+	}
+
+	fc->cdev = thermal_of_cooling_device_register(np, "fclk", fc,
+						      &fclk_cooling_ops);
+	if (IS_ERR(fc->cdev)) {
+		ret = PTR_ERR(fc->cdev);
+		dev_err(&pdev->dev, "failed to register cooling device: %d\n",
+			ret);
+		goto err_put_clks;
+	}
+
+	platform_set_drvdata(pdev, fc);
+
+	return 0;
+
+err_put_clks:
+	fclk_cooling_put_clks(fc);
+	return ret;
+}
+
+static int fclk_cooling_remove(struct platform_device *pdev)
+{
+	struct fclk_cooling *fc = platform_get_drvdata(pdev);
+
+	thermal_cooling_device_unregister(fc->cdev);
+
+	/* leave the logic running at full speed */
+	fclk_cooling_apply(fc, 0);
+	fclk_cooling_put_clks(fc);
+
+	return 0;
+}
+
+static const struct of_device_id fclk_cooling_of_match[] = {
+	{ .compatible = "xlnx,zynq-fclk-cooling" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, fclk_cooling_of_match);
+
+static struct platform_driver fclk_cooling_driver = {
+	.driver = {
+		.name = "zynq-fclk-cooling",
+		.of_match_table = fclk_cooling_of_match,
+	},
+	.probe = fclk_cooling_probe,
+	.remove = fclk_cooling_remove,
+};
+module_platform_driver(fclk_cooling_driver);
+
+MODULE_AUTHOR("Xilinx, Inc.");
+MODULE_DESCRIPTION("Zynq PL clock cooling device");
+MODULE_LICENSE("GPL v2");
@@ -42,12 +42,15 @@
 #define cdns_uart_readl(offset)		ioread32(port->membase + offset)
 #define cdns_uart_writel(val, offset)	iowrite32(val, port->membase + offset)
 
-/* Rx Trigger level */
+/*
+ * Rx Trigger level, default of all ports. Each port can be tuned through
+ * its rx_trigger_level sysfs attribute.
+ */
 static int rx_trigger_level = 56;
 module_param(rx_trigger_level, uint, S_IRUGO);
 MODULE_PARM_DESC(rx_trigger_level, "Rx trigger level, 1-63 bytes");
 
-/* Rx Timeout */
+/* Rx Timeout, default of all ports, see the rx_timeout sysfs attribute */
 static int rx_timeout = 10;
 module_param(rx_timeout, uint, S_IRUGO);
 MODULE_PARM_DESC(rx_timeout, "Rx timeout, 1-255");
@@ -171,6 +174,9 @@ struct cdns_uart {
 	struct clk		*pclk;
 	unsigned int		baud;
 	struct notifier_block	clk_rate_change_nb;
+	unsigned int		rx_trigger_level;
+	unsigned int		rx_timeout;
+	unsigned int		rxwm;
 };
 #define to_cdns_uart(_nb) container_of(_nb, struct cdns_uart, \
 		clk_rate_change_nb);
@@ -185,8 +191,9 @@ struct cdns_uart {
 static irqreturn_t cdns_uart_isr(int irq, void *dev_id)
 {
 	struct uart_port *port = (struct uart_port *)dev_id;
+	struct cdns_uart *cdns_uart = port->private_data;
 	unsigned long flags;
-	unsigned int isrstatus, numbytes;
+	unsigned int isrstatus, numbytes, avail = 0;
 	unsigned int data;
 	char status = TTY_NORMAL;
 
@@ -223,8 +230,21 @@ static irqreturn_t cdns_uart_isr(int irq, void *dev_id)
 	if ((isrstatus & CDNS_UART_IXR_TOUT) ||
 		(isrstatus & CDNS_UART_IXR_RXTRIG)) {
 		/* Receive Timeout Interrupt */
-		while ((cdns_uart_readl(CDNS_UART_SR_OFFSET) &
-			CDNS_UART_SR_RXEMPTY) != CDNS_UART_SR_RXEMPTY) {
+		for (;;) {
+			/*
+			 * While the FIFO is filled up to the trigger level,
+			 * that many bytes can be read without polling the
+			 * status register for each of them.
+			 */
+			if (!avail) {
+				u32 sr = cdns_uart_readl(CDNS_UART_SR_OFFSET);
+
+				if (sr & CDNS_UART_SR_RXEMPTY)
+					break;
+				avail = sr & CDNS_UART_SR_RXTRIG ?
+					cdns_uart->rxwm : 1;
+			}
+			avail--;
 			data = cdns_uart_readl(CDNS_UART_FIFO_OFFSET);
 
 			/* Non-NULL byte after BREAK is garbage (99%) */
@@ -315,6 +335,23 @@ static irqreturn_t cdns_uart_isr(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+/**
+ * cdns_uart_set_rxwm - Program the RX FIFO trigger level
+ * @port: Handle to the uart port structure
+ * @level: Trigger level, 1-63 bytes
+ *
+ * The ISR relies on the programmed level to drain the FIFO in batches, so
+ * the register must only be written through here. Called with the port
+ * lock held or before the port is in use.
+ */
+static void cdns_uart_set_rxwm(struct uart_port *port, unsigned int level)
+{
+	struct cdns_uart *cdns_uart = port->private_data;
+
+	cdns_uart->rxwm = level;
+	cdns_uart_writel(level, CDNS_UART_RXWM_OFFSET);
+}
+
 /**
  * cdns_uart_calc_baud_divs - Calculate baud rate divisors
  * @clk: UART module input clock
@@ -491,7 +528,8 @@ static int cdns_uart_clk_notifier_cb(struct notifier_block *nb,
 		 * enable bit and RX enable bit to enable the transmitter and
 		 * receiver.
 		 */
-		cdns_uart_writel(rx_timeout, CDNS_UART_RXTOUT_OFFSET);
+		cdns_uart_writel(cdns_uart->rx_timeout,
+				 CDNS_UART_RXTOUT_OFFSET);
 		ctrl_reg = cdns_uart_readl(CDNS_UART_CR_OFFSET);
 		ctrl_reg &= ~(CDNS_UART_CR_TX_DIS | CDNS_UART_CR_RX_DIS);
 		ctrl_reg |= CDNS_UART_CR_TX_EN | CDNS_UART_CR_RX_EN;
@@ -630,6 +668,7 @@ static void cdns_uart_break_ctl(struct uart_port *port, int ctl)
 static void cdns_uart_set_termios(struct uart_port *port,
 				struct ktermios *termios, struct ktermios *old)
 {
+	struct cdns_uart *cdns_uart = port->private_data;
 	unsigned int cval = 0;
 	unsigned int baud, minbaud, maxbaud;
 	unsigned long flags;
@@ -680,7 +719,7 @@ static void cdns_uart_set_termios(struct uart_port *port,
 	ctrl_reg |= CDNS_UART_CR_TX_EN | CDNS_UART_CR_RX_EN;
 	cdns_uart_writel(ctrl_reg, CDNS_UART_CR_OFFSET);
 
-	cdns_uart_writel(rx_timeout, CDNS_UART_RXTOUT_OFFSET);
+	cdns_uart_writel(cdns_uart->rx_timeout, CDNS_UART_RXTOUT_OFFSET);
 
 	port->read_status_mask = CDNS_UART_IXR_TXEMPTY | CDNS_UART_IXR_RXTRIG |
 			CDNS_UART_IXR_OVERRUN | CDNS_UART_IXR_TOUT;
@@ -754,6 +793,7 @@ static void cdns_uart_set_termios(struct uart_port *port,
  */
 static int cdns_uart_startup(struct uart_port *port)
 {
+	struct cdns_uart *cdns_uart = port->private_data;
 	unsigned int retval = 0, status = 0;
 
 	retval = request_irq(port->irq, cdns_uart_isr, 0, CDNS_UART_NAME,
@@ -789,15 +829,15 @@ static int cdns_uart_startup(struct uart_port *port)
 
 	/*
 	 * Set the RX FIFO Trigger level to use most of the FIFO, but it
-	 * can be tuned with a module parameter
+	 * can be tuned with a module parameter or through sysfs
 	 */
-	cdns_uart_writel(rx_trigger_level, CDNS_UART_RXWM_OFFSET);
+	cdns_uart_set_rxwm(port, cdns_uart->rx_trigger_level);
 
 	/*
 	 * Receive Timeout register is enabled but it
-	 * can be tuned with a module parameter
+	 * can be tuned with a module parameter or through sysfs
 	 */
-	cdns_uart_writel(rx_timeout, CDNS_UART_RXTOUT_OFFSET);
+	cdns_uart_writel(cdns_uart->rx_timeout, CDNS_UART_RXTOUT_OFFSET);
 
 	/* Clear out any pending interrupts before enabling them */
 	cdns_uart_writel(cdns_uart_readl(CDNS_UART_ISR_OFFSET),
@@ -1244,7 +1284,7 @@ static int cdns_uart_suspend(struct device *device)
 					CDNS_UART_SR_RXEMPTY))
 			cdns_uart_readl(CDNS_UART_FIFO_OFFSET);
 		/* set RX trigger level to 1 */
-		cdns_uart_writel(1, CDNS_UART_RXWM_OFFSET);
+		cdns_uart_set_rxwm(port, 1);
 		/* disable RX timeout interrups */
 		cdns_uart_writel(CDNS_UART_IXR_TOUT, CDNS_UART_IDR_OFFSET);
 		spin_unlock_irqrestore(&port->lock, flags);
@@ -1293,7 +1333,8 @@ static int cdns_uart_resume(struct device *device)
 			cpu_relax();
 
 		/* restore rx timeout value */
-		cdns_uart_writel(rx_timeout, CDNS_UART_RXTOUT_OFFSET);
+		cdns_uart_writel(cdns_uart->rx_timeout,
+				 CDNS_UART_RXTOUT_OFFSET);
 		/* Enable Tx/Rx */
 		ctrl_reg = cdns_uart_readl(CDNS_UART_CR_OFFSET);
 		ctrl_reg &= ~(CDNS_UART_CR_TX_DIS | CDNS_UART_CR_RX_DIS);
@@ -1302,9 +1343,11 @@ static int cdns_uart_resume(struct device *device)
 
 		spin_unlock_irqrestore(&port->lock, flags);
 	} else {
+		struct cdns_uart *cdns_uart = port->private_data;
+
 		spin_lock_irqsave(&port->lock, flags);
 		/* restore original rx trigger level */
-		cdns_uart_writel(rx_trigger_level, CDNS_UART_RXWM_OFFSET);
+		cdns_uart_set_rxwm(port, cdns_uart->rx_trigger_level);
 		/* enable RX timeout interrupt */
 		cdns_uart_writel(CDNS_UART_IXR_TOUT, CDNS_UART_IER_OFFSET);
 		spin_unlock_irqrestore(&port->lock, flags);
@@ -1317,6 +1360,95 @@ static int cdns_uart_resume(struct device *device)
 static SIMPLE_DEV_PM_OPS(cdns_uart_dev_pm_ops, cdns_uart_suspend,
 		cdns_uart_resume);
 
+static struct uart_port *cdns_uart_tty_port(struct device *dev)
+{
+	struct tty_port *tport = dev_get_drvdata(dev);
+	struct uart_state *state = container_of(tport, struct uart_state, port);
+
+	return state->uart_port;
+}
+
+static ssize_t rx_trigger_level_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct cdns_uart *cdns_uart = cdns_uart_tty_port(dev)->private_data;
+
+	return sprintf(buf, "%u\n", cdns_uart->rx_trigger_level);
+}
+
+/*
+ * A lower level makes the RX interrupt fire earlier, which helps against
+ * overruns at high baud rates when interrupts are delayed.
+ */
+static ssize_t rx_trigger_level_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	struct uart_port *port = cdns_uart_tty_port(dev);
+	struct cdns_uart *cdns_uart = port->private_data;
+	unsigned long flags;
+	unsigned int level;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &level);
+	if (ret)
+		return ret;
+	if (level < 1 || level > 63)
+		return -EINVAL;
+
+	spin_lock_irqsave(&port->lock, flags);
+	cdns_uart->rx_trigger_level = level;
+	cdns_uart_set_rxwm(port, level);
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	return count;
+}
+static DEVICE_ATTR_RW(rx_trigger_level);
+
+static ssize_t rx_timeout_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct cdns_uart *cdns_uart = cdns_uart_tty_port(dev)->private_data;
+
+	return sprintf(buf, "%u\n", cdns_uart->rx_timeout);
+}
+
+/* The timeout is in units of 4 bit periods */
+static ssize_t rx_timeout_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct uart_port *port = cdns_uart_tty_port(dev);
+	struct cdns_uart *cdns_uart = port->private_data;
+	unsigned long flags;
+	unsigned int timeout;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &timeout);
+	if (ret)
+		return ret;
+	if (timeout < 1 || timeout > 255)
+		return -EINVAL;
+
+	spin_lock_irqsave(&port->lock, flags);
+	cdns_uart->rx_timeout = timeout;
+	cdns_uart_writel(timeout, CDNS_UART_RXTOUT_OFFSET);
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	return count;
+}
+static DEVICE_ATTR_RW(rx_timeout);
+
+static struct attribute *cdns_uart_attrs[] = {
+	&dev_attr_rx_trigger_level.attr,
+	&dev_attr_rx_timeout.attr,
+	NULL,
+};
+
+static struct attribute_group cdns_uart_attr_group = {
+	.attrs = cdns_uart_attrs,
+};
+
 /**
  * cdns_uart_probe - Platform driver probe
  * @pdev: Pointer to the platform device structure
@@ -1334,6 +1466,8 @@ static int cdns_uart_probe(struct platform_device *pdev)
 			GFP_KERNEL);
 	if (!cdns_uart_data)
 		return -ENOMEM;
+	cdns_uart_data->rx_trigger_level = clamp(rx_trigger_level, 1, 63);
+	cdns_uart_data->rx_timeout = clamp(rx_timeout, 1, 255);
 
 	cdns_uart_data->pclk = devm_clk_get(&pdev->dev, "pclk");
 	if (IS_ERR(cdns_uart_data->pclk)) {
@@ -1409,6 +1543,7 @@ static int cdns_uart_probe(struct platform_device *pdev)
 		port->dev = &pdev->dev;
 		port->uartclk = clk_get_rate(cdns_uart_data->uartclk);
 		port->private_data = cdns_uart_data;
+		port->attr_group = &cdns_uart_attr_group;
 		cdns_uart_data->port = port;
 		platform_set_drvdata(pdev, port);
 		rc = uart_add_one_port(&cdns_uart_uart_driver, port);
@@ -10,6 +10,11 @@
  * to userspace. Userspace need not clear the interrupt of IP since
  * driver clears the interrupt.
  *
+ * In advanced mode the metric counters are also exported as a perf PMU,
+ * so that AXI traffic can be counted next to CPU events without going
+ * through userspace. The PMU and a userspace UIO client must not be used
+ * at the same time, as both program the counters.
+ *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, version 2 of the License.
@@ -23,14 +28,29 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <linux/bitops.h>
+#include <linux/hrtimer.h>
 #include <linux/io.h>
 #include <linux/module.h>
 #include <linux/of.h>
+#include <linux/perf_event.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/uio_driver.h>
 
 #define XAPM_IS_OFFSET		0x0038  /* Interrupt Status Register */
+#define XAPM_MSR_OFFSET		0x0044  /* Metric Selector Registers */
+#define XAPM_MC_OFFSET		0x0100  /* Metric Counter Registers */
+#define XAPM_CTL_OFFSET		0x0300  /* Control Register */
+
+#define XAPM_CR_MCNTR_ENABLE	BIT(0)	/* Enable metric counters */
+#define XAPM_CR_MCNTR_RESET	BIT(1)	/* Reset metric counters */
+
+#define XAPM_MAX_COUNTERS	10
+#define XAPM_MAX_SLOTS		8
+#define XAPM_METRIC_MASK	0x1f
+#define XAPM_SLOT_SHIFT		5
+#define XAPM_COUNTER_MASK	0xffffffffULL
 #define DRV_NAME		"xilinxapm_uio"
 #define DRV_VERSION		"1.0"
 #define UIO_DUMMY_MEMSIZE	4096
@@ -71,11 +91,23 @@ struct xapm_param {
  * @info: uio_info structure
  * @param: xapm_param structure
  * @regs: IOmapped base address
+ * @pmu: perf PMU of the metric counters
+ * @events: perf events using each metric counter
+ * @used: Metric counters in use
+ * @hrtimer: Timer folding the counters into the events before they wrap
+ * @active: Number of running events
  */
 struct xapm_dev {
 	struct uio_info info;
 	struct xapm_param param;
 	void __iomem *regs;
+#ifdef CONFIG_PERF_EVENTS
+	struct pmu pmu;
+	struct perf_event *events[XAPM_MAX_COUNTERS];
+	DECLARE_BITMAP(used, XAPM_MAX_COUNTERS);
+	struct hrtimer hrtimer;
+	int active;
+#endif
 };
 
 /**
@@ -189,6 +221,311 @@ static int xapm_getprop(struct platform_device *pdev, struct xapm_param *param)
 	return 0;
 }
 
+#ifdef CONFIG_PERF_EVENTS
+/*
+ * The metric counters are 32 bits wide for the event reads, a read byte
+ * count of a busy DDR port wraps in about a second. Fold them into the
+ * perf events well before that.
+ */
+#define XAPM_POLL_NS		(250 * NSEC_PER_MSEC)
+
+#define to_xapm_dev(p)		container_of(p, struct xapm_dev, pmu)
+
+/* The event config holds the metric in bits 0 - 4 and the slot in 8 - 10 */
+#define XAPM_CONFIG_METRIC(c)	((c) & XAPM_METRIC_MASK)
+#define XAPM_CONFIG_SLOT(c)	(((c) >> 8) & (XAPM_MAX_SLOTS - 1))
+#define XAPM_CONFIG_MASK	0x71f
+
+PMU_FORMAT_ATTR(metric, "config:0-4");
+PMU_FORMAT_ATTR(slot, "config:8-10");
+
+static struct attribute *xapm_format_attrs[] = {
+	&format_attr_metric.attr,
+	&format_attr_slot.attr,
+	NULL,
+};
+
+static struct attribute_group xapm_format_group = {
+	.name = "format",
+	.attrs = xapm_format_attrs,
+};
+
+static ssize_t xapm_event_show(struct device *dev,
+			       struct device_attribute *attr, char *page)
+{
+	struct perf_pmu_events_attr *pmu_attr =
+		container_of(attr, struct perf_pmu_events_attr, attr);
+
+	return sprintf(page, "metric=0x%02llx\n", pmu_attr->id);
+}
+
+#define XAPM_EVENT_ATTR(_name, _metric)					\
+	PMU_EVENT_ATTR(_name, xapm_event_attr_##_name, _metric,	\
+		       xapm_event_show)
+
+/* Metric numbers of the advanced mode metric selector */
+XAPM_EVENT_ATTR(write_transactions, 0x00);
+XAPM_EVENT_ATTR(read_transactions, 0x01);
+XAPM_EVENT_ATTR(write_bytes, 0x02);
+XAPM_EVENT_ATTR(read_bytes, 0x03);
+XAPM_EVENT_ATTR(write_beats, 0x04);
+XAPM_EVENT_ATTR(read_latency, 0x05);
+XAPM_EVENT_ATTR(write_latency, 0x06);
+XAPM_EVENT_ATTR(slave_write_idle, 0x07);
+XAPM_EVENT_ATTR(master_read_idle, 0x08);
+XAPM_EVENT_ATTR(bvalids, 0x09);
+XAPM_EVENT_ATTR(wlasts, 0x0a);
+XAPM_EVENT_ATTR(rlasts, 0x0b);
+
+static struct attribute *xapm_event_attrs[] = {
+	&xapm_event_attr_write_transactions.attr.attr,
+	&xapm_event_attr_read_transactions.attr.attr,
+	&xapm_event_attr_write_bytes.attr.attr,
+	&xapm_event_attr_read_bytes.attr.attr,
+	&xapm_event_attr_write_beats.attr.attr,
+	&xapm_event_attr_read_latency.attr.attr,
+	&xapm_event_attr_write_latency.attr.attr,
+	&xapm_event_attr_slave_write_idle.attr.attr,
+	&xapm_event_attr_master_read_idle.attr.attr,
+	&xapm_event_attr_bvalids.attr.attr,
+	&xapm_event_attr_wlasts.attr.attr,
+	&xapm_event_attr_rlasts.attr.attr,
+	NULL,
+};
+
+static struct attribute_group xapm_event_group = {
+	.name = "events",
+	.attrs = xapm_event_attrs,
+};
+
+/* The counters are system wide, perf opens their events on CPU 0 */
+static ssize_t xapm_cpumask_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "0\n");
+}
+
+static DEVICE_ATTR(cpumask, S_IRUGO, xapm_cpumask_show, NULL);
+
+static struct attribute *xapm_cpumask_attrs[] = {
+	&dev_attr_cpumask.attr,
+	NULL,
+};
+
+static struct attribute_group xapm_cpumask_group = {
+	.attrs = xapm_cpumask_attrs,
+};
+
+static const struct attribute_group *xapm_attr_groups[] = {
+	&xapm_format_group,
+	&xapm_event_group,
+	&xapm_cpumask_group,
+	NULL,
+};
+
+/**
+ * xapm_event_update - Fold the counter of an event into its count
+ * @event: Pointer to the perf event
+ */
+static void xapm_event_update(struct perf_event *event)
+{
+	struct xapm_dev *xapm = to_xapm_dev(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	u64 prev, now;
+
+	do {
+		prev = local64_read(&hwc->prev_count);
+		now = readl(xapm->regs + XAPM_MC_OFFSET + hwc->idx * 0x10);
+	} while (local64_cmpxchg(&hwc->prev_count, prev, now) != prev);
+
+	local64_add((now - prev) & XAPM_COUNTER_MASK, &event->count);
+}
+
+static enum hrtimer_restart xapm_hrtimer_handler(struct hrtimer *hrtimer)
+{
+	struct xapm_dev *xapm = container_of(hrtimer, struct xapm_dev,
+					     hrtimer);
+	unsigned long flags;
+	int idx;
+
+	local_irq_save(flags);
+	for_each_set_bit(idx, xapm->used, XAPM_MAX_COUNTERS)
+		if (!(xapm->events[idx]->hw.state & PERF_HES_STOPPED))
+			xapm_event_update(xapm->events[idx]);
+	local_irq_restore(flags);
+
+	hrtimer_forward_now(hrtimer, ns_to_ktime(XAPM_POLL_NS));
+
+	return HRTIMER_RESTART;
+}
+
+static int xapm_event_init(struct perf_event *event)
+{
+	struct xapm_dev *xapm = to_xapm_dev(event->pmu);
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	/* System wide counters, without an overflow interrupt to sample */
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+	if (event->cpu < 0)
+		return -EINVAL;
+
+	if (event->attr.config & ~XAPM_CONFIG_MASK ||
+	    XAPM_CONFIG_SLOT(event->attr.config) >= xapm->param.maxslots)
+		return -EINVAL;
+
+	event->cpu = 0;
+	event->hw.idx = -1;
+
+	return 0;
+}
+
+static void xapm_event_start(struct perf_event *event, int flags)
+{
+	struct xapm_dev *xapm = to_xapm_dev(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+
+	hwc->state = 0;
+	local64_set(&hwc->prev_count,
+		    readl(xapm->regs + XAPM_MC_OFFSET + hwc->idx * 0x10));
+
+	if (!xapm->active++)
+		hrtimer_start(&xapm->hrtimer, ns_to_ktime(XAPM_POLL_NS),
+			      HRTIMER_MODE_REL_PINNED);
+}
+
+static void xapm_event_stop(struct perf_event *event, int flags)
+{
+	struct xapm_dev *xapm = to_xapm_dev(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	xapm_event_update(event);
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	if (!--xapm->active)
+		hrtimer_cancel(&xapm->hrtimer);
+}
+
+static int xapm_event_add(struct perf_event *event, int flags)
+{
+	struct xapm_dev *xapm = to_xapm_dev(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+	u32 msr, shift, sel;
+	int idx;
+
+	idx = find_first_zero_bit(xapm->used, xapm->param.numcounters);
+	if (idx >= xapm->param.numcounters)
+		return -EAGAIN;
+
+	set_bit(idx, xapm->used);
+	xapm->events[idx] = event;
+	hwc->idx = idx;
+
+	/* Each metric selector register holds the selection of 4 counters */
+	sel = XAPM_CONFIG_SLOT(event->attr.config) << XAPM_SLOT_SHIFT |
+	      XAPM_CONFIG_METRIC(event->attr.config);
+	shift = (idx % 4) * 8;
+	msr = readl(xapm->regs + XAPM_MSR_OFFSET + (idx / 4) * 4);
+	msr &= ~(0xff << shift);
+	msr |= sel << shift;
+	writel(msr, xapm->regs + XAPM_MSR_OFFSET + (idx / 4) * 4);
+
+	hwc->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	if (flags & PERF_EF_START)
+		xapm_event_start(event, flags);
+
+	return 0;
+}
+
+static void xapm_event_del(struct perf_event *event, int flags)
+{
+	struct xapm_dev *xapm = to_xapm_dev(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+
+	xapm_event_stop(event, PERF_EF_UPDATE);
+	xapm->events[hwc->idx] = NULL;
+	clear_bit(hwc->idx, xapm->used);
+	hwc->idx = -1;
+}
+
+static void xapm_event_read(struct perf_event *event)
+{
+	xapm_event_update(event);
+}
+
+/**
+ * xapm_pmu_register - Export the metric counters as a perf PMU
+ * @pdev: Pointer to the platform_device structure
+ * @xapm: Pointer to the driver structure
+ *
+ * Returns '0' on success and failure value on error
+ */
+static int xapm_pmu_register(struct platform_device *pdev,
+			     struct xapm_dev *xapm)
+{
+	static atomic_t xapm_pmu_count = ATOMIC_INIT(-1);
+	const char *name;
+	int id;
+
+	/* Only advanced mode has freely selectable metric counters */
+	if (xapm->param.mode != XAPM_MODE_ADVANCED ||
+	    !xapm->param.numcounters)
+		return 0;
+
+	xapm->param.numcounters = min_t(u32, xapm->param.numcounters,
+					XAPM_MAX_COUNTERS);
+
+	id = atomic_inc_return(&xapm_pmu_count);
+	if (id)
+		name = devm_kasprintf(&pdev->dev, GFP_KERNEL, "apm%d", id);
+	else
+		name = "apm";
+	if (!name)
+		return -ENOMEM;
+
+	hrtimer_init(&xapm->hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	xapm->hrtimer.function = xapm_hrtimer_handler;
+
+	/* Start all metric counters from zero, they are never stopped */
+	writel(XAPM_CR_MCNTR_RESET, xapm->regs + XAPM_CTL_OFFSET);
+	writel(XAPM_CR_MCNTR_ENABLE, xapm->regs + XAPM_CTL_OFFSET);
+
+	xapm->pmu = (struct pmu) {
+		.task_ctx_nr	= perf_invalid_context,
+		.attr_groups	= xapm_attr_groups,
+		.event_init	= xapm_event_init,
+		.add		= xapm_event_add,
+		.del		= xapm_event_del,
+		.start		= xapm_event_start,
+		.stop		= xapm_event_stop,
+		.read		= xapm_event_read,
+	};
+
+	return perf_pmu_register(&xapm->pmu, name, -1);
+}
+
+static void xapm_pmu_unregister(struct xapm_dev *xapm)
+{
+	if (xapm->pmu.event_init)
+		perf_pmu_unregister(&xapm->pmu);
+}
+#else
+static inline int xapm_pmu_register(struct platform_device *pdev,
+				    struct xapm_dev *xapm)
+{
+	return 0;
+}
+
+static inline void xapm_pmu_unregister(struct xapm_dev *xapm)
+{
+}
+#endif
+
 /**
  * xapm_probe - Driver probe function
  * @pdev: Pointer to the platform_device structure
@@ -257,6 +594,13 @@ static int xapm_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, xapm);
 
+	ret = xapm_pmu_register(pdev, xapm);
+	if (ret < 0) {
+		dev_err(&pdev->dev, "unable to register perf PMU\n");
+		uio_unregister_device(&xapm->info);
+		return ret;
+	}
+
 	dev_info(&pdev->dev, "Probed Xilinx APM\n");
 
 	return 0;
@@ -272,6 +616,7 @@ static int xapm_remove(struct platform_device *pdev)
 {
 	struct xapm_dev *xapm = platform_get_drvdata(pdev);
 
+	xapm_pmu_unregister(xapm);
 	uio_unregister_device(&xapm->info);
 
 	return 0;
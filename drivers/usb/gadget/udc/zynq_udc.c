@@ -244,6 +244,9 @@ struct ep_td_struct {
 #define  DTD_ADDR_MASK                        0xFFFFFFE0
 #define  DTD_PACKET_SIZE                      0x7FFF0000
 #define  DTD_LENGTH_BIT_POS                   16
+#define  DTD_NR_BUFS                          5
+#define  DTD_PAGE_SIZE                        0x1000
+#define  DTD_PAGE_MASK                        (~(DTD_PAGE_SIZE - 1))
 #define  DTD_ERROR_MASK                       (DTD_STATUS_HALTED | \
 					DTD_STATUS_DATA_BUFF_ERR | \
 					DTD_STATUS_TRANSACTION_ERR)
@@ -422,6 +425,23 @@ static inline void zynq_writel(u32 val32, unsigned __iomem *addr)
 /********************************************************************
  *	Internal Used Function
 ********************************************************************/
+/* Free the dTD chain of a request */
+static void zynq_req_free_dtd(struct zynq_req *req)
+{
+	struct ep_td_struct *curr_td, *next_td;
+	int j;
+
+	next_td = req->head;
+	for (j = 0; j < req->dtd_count; j++) {
+		curr_td = next_td;
+		if (j != req->dtd_count - 1)
+			next_td = curr_td->next_td_virt;
+		dma_pool_free(udc_controller->td_pool, curr_td,
+				curr_td->td_dma);
+	}
+	req->dtd_count = 0;
+}
+
 /*-----------------------------------------------------------------
  * done() - retire a request; caller blocked irqs
  * @status : request status to be set, only works when
@@ -431,8 +451,6 @@ static void done(struct zynq_ep *ep, struct zynq_req *req, int status)
 {
 	struct zynq_udc *udc = NULL;
 	unsigned char stopped = ep->stopped;
-	struct ep_td_struct *curr_td, *next_td;
-	int j;
 
 	udc = (struct zynq_udc *)ep->udc;
 	/* Removed the req from zynq_ep->queue */
@@ -445,13 +463,7 @@ static void done(struct zynq_ep *ep, struct zynq_req *req, int status)
 		status = req->req.status;
 
 	/* Free dtd for the request */
-	next_td = req->head;
-	for (j = 0; j < req->dtd_count; j++) {
-		curr_td = next_td;
-		if (j != req->dtd_count - 1)
-			next_td = curr_td->next_td_virt;
-		dma_pool_free(udc->td_pool, curr_td, curr_td->td_dma);
-	}
+	zynq_req_free_dtd(req);
 
 	if (req->mapped) {
 		usb_gadget_unmap_request(&udc->gadget, &req->req, ep_is_in(ep));
@@ -1022,20 +1034,19 @@ out:
 
 /* Fill in the dTD structure
  * @req: request that the transfer belongs to
- * @length: return actually data length of the dTD
+ * @bufs: dma addresses of the up to five buffer pages of the dTD, the
+ *	first one may start anywhere in its page
+ * @length: data length of the dTD
+ * @is_last: flag if it is the last dTD of the request
  * @dma: return dma address of the dTD
- * @is_last: return flag if it is the last dTD of the request
  * return: pointer to the built dTD */
-static struct ep_td_struct *zynq_build_dtd(struct zynq_req *req, unsigned
-		*length, dma_addr_t *dma, int *is_last)
+static struct ep_td_struct *zynq_build_dtd(struct zynq_req *req,
+		const dma_addr_t *bufs, unsigned length, int is_last,
+		dma_addr_t *dma)
 {
 	u32 swap_temp;
 	struct ep_td_struct *dtd;
 
-	/* how big will this transfer be? */
-	*length = min(req->req.length - req->req.actual,
-			(unsigned)EP_MAX_LENGTH_TRANSFER);
-
 	dtd = dma_pool_alloc(udc_controller->td_pool, GFP_ATOMIC, dma);
 	if (dtd == NULL)
 		return dtd;
@@ -1047,74 +1058,165 @@ static struct ep_td_struct *zynq_build_dtd(struct zynq_req *req, unsigned
 	dtd->size_ioc_sts = cpu_to_le32(swap_temp);
 
 	/* Init all of buffer page pointers */
-	swap_temp = (u32) (req->req.dma + req->req.actual);
-	dtd->buff_ptr0 = cpu_to_le32(swap_temp);
-	dtd->buff_ptr1 = cpu_to_le32(swap_temp + 0x1000);
-	dtd->buff_ptr2 = cpu_to_le32(swap_temp + 0x2000);
-	dtd->buff_ptr3 = cpu_to_le32(swap_temp + 0x3000);
-	dtd->buff_ptr4 = cpu_to_le32(swap_temp + 0x4000);
-
-	req->req.actual += *length;
-
-	/* zlp is needed if req->req.zero is set */
-	if (req->req.zero) {
-		if (*length == 0 || (*length % req->ep->ep.maxpacket) != 0)
-			*is_last = 1;
-		else
-			*is_last = 0;
-	} else if (req->req.length == req->req.actual)
-		*is_last = 1;
-	else
-		*is_last = 0;
+	dtd->buff_ptr0 = cpu_to_le32((u32)bufs[0]);
+	dtd->buff_ptr1 = cpu_to_le32((u32)bufs[1] & DTD_PAGE_MASK);
+	dtd->buff_ptr2 = cpu_to_le32((u32)bufs[2] & DTD_PAGE_MASK);
+	dtd->buff_ptr3 = cpu_to_le32((u32)bufs[3] & DTD_PAGE_MASK);
+	dtd->buff_ptr4 = cpu_to_le32((u32)bufs[4] & DTD_PAGE_MASK);
 
-	if ((*is_last) == 0)
+	if (!is_last)
 		VDBG("multi-dtd request!");
 	/* Fill in the transfer size; set active bit */
-	swap_temp = ((*length << DTD_LENGTH_BIT_POS) | DTD_STATUS_ACTIVE);
+	swap_temp = ((length << DTD_LENGTH_BIT_POS) | DTD_STATUS_ACTIVE);
 
 	/* Enable interrupt for the last dtd of a request */
-	if (*is_last && !req->req.no_interrupt)
+	if (is_last && !req->req.no_interrupt)
 		swap_temp |= DTD_IOC;
 
 	dtd->size_ioc_sts = cpu_to_le32(swap_temp);
 
 	mb();
 
-	VDBG("length = %d address= 0x%x", *length, (int)*dma);
+	VDBG("length = %d address= 0x%x", length, (int)*dma);
 
 	return dtd;
 }
 
-/* Generate dtd chain for a request */
-static int zynq_req_to_dtd(struct zynq_req *req)
+/* Build a dTD and append it to the dTD chain of a request */
+static int zynq_req_add_dtd(struct zynq_req *req, const dma_addr_t *bufs,
+		unsigned length, int is_last)
 {
-	unsigned	count;
-	int		is_last;
-	int		is_first = 1;
-	struct ep_td_struct	*last_dtd = NULL, *dtd;
+	struct ep_td_struct *dtd;
 	dma_addr_t dma;
 
+	/* A packet can not span dTDs, only the last one may be short */
+	if (!is_last && (length % req->ep->ep.maxpacket))
+		return -EINVAL;
+
+	dtd = zynq_build_dtd(req, bufs, length, is_last, &dma);
+	if (dtd == NULL)
+		return -ENOMEM;
+
+	if (!req->dtd_count) {
+		req->head = dtd;
+	} else {
+		req->tail->next_td_ptr = cpu_to_le32(dma);
+		req->tail->next_td_virt = dtd;
+	}
+	req->tail = dtd;
+	req->dtd_count++;
+
+	return 0;
+}
+
+/* Split a contiguous buffer in dTDs of at most EP_MAX_LENGTH_TRANSFER */
+static int zynq_req_buf_to_dtd(struct zynq_req *req, int zlp)
+{
+	unsigned offset = 0, length;
+	dma_addr_t bufs[DTD_NR_BUFS];
+	int i, ret, is_last;
+
 	do {
-		dtd = zynq_build_dtd(req, &count, &dma, &is_last);
-		if (dtd == NULL)
-			return -ENOMEM;
+		length = min(req->req.length - offset,
+				(unsigned)EP_MAX_LENGTH_TRANSFER);
+		is_last = !zlp && offset + length == req->req.length;
 
-		if (is_first) {
-			is_first = 0;
-			req->head = dtd;
-		} else {
-			last_dtd->next_td_ptr = cpu_to_le32(dma);
-			last_dtd->next_td_virt = dtd;
+		for (i = 0; i < DTD_NR_BUFS; i++)
+			bufs[i] = req->req.dma + offset + i * DTD_PAGE_SIZE;
+
+		ret = zynq_req_add_dtd(req, bufs, length, is_last);
+		if (ret)
+			return ret;
+		offset += length;
+	} while (offset < req->req.length);
+
+	return 0;
+}
+
+/*
+ * Describe a scatterlist with as few dTDs as possible. A dTD holds up to
+ * five pages, so page aligned entries, like the page cache pages of a
+ * file, are merged into one dTD without copying them.
+ */
+static int zynq_req_sg_to_dtd(struct zynq_req *req, int zlp)
+{
+	dma_addr_t bufs[DTD_NR_BUFS], addr, end = 0;
+	unsigned length = 0, total = 0, left, piece;
+	struct scatterlist *sg;
+	int i, nbufs = 0, ret;
+	bool same_page;
+
+	for_each_sg(req->req.sg, sg, req->req.num_mapped_sgs, i) {
+		addr = sg_dma_address(sg);
+		left = min(sg_dma_len(sg), req->req.length - total);
+
+		while (left) {
+			/* Never let a piece cross a page boundary */
+			piece = min(left, DTD_PAGE_SIZE -
+					(unsigned)(addr & ~DTD_PAGE_MASK));
+
+			/*
+			 * Continue the current dTD if the piece follows its
+			 * data in the same page, or starts the next page
+			 * right where its data ends at a page boundary.
+			 */
+			same_page = addr == end && (addr & ~DTD_PAGE_MASK);
+			if (length && !same_page &&
+			    ((addr | end) & ~DTD_PAGE_MASK ||
+			     nbufs == DTD_NR_BUFS)) {
+				ret = zynq_req_add_dtd(req, bufs, length, 0);
+				if (ret)
+					return ret;
+				length = 0;
+			}
+
+			if (!length) {
+				memset(bufs, 0, sizeof(bufs));
+				nbufs = 0;
+			}
+			if (!length || !(addr & ~DTD_PAGE_MASK))
+				bufs[nbufs++] = addr;
+
+			length += piece;
+			total += piece;
+			addr += piece;
+			end = addr;
+			left -= piece;
 		}
-		last_dtd = dtd;
+	}
 
-		req->dtd_count++;
-	} while (!is_last);
+	return zynq_req_add_dtd(req, bufs, length, !zlp);
+}
 
-	dtd->next_td_ptr = cpu_to_le32(DTD_NEXT_TERMINATE);
+/* Generate dtd chain for a request */
+static int zynq_req_to_dtd(struct zynq_req *req)
+{
+	dma_addr_t bufs[DTD_NR_BUFS] = { 0 };
+	int zlp, ret;
+
+	/*
+	 * zlp is needed if req->req.zero is set and the data ends with a
+	 * full packet. The controller sends it from a zero length dTD at
+	 * the end of the chain, within the same request. IN only, an OUT
+	 * zero length dTD would wait for a packet that never comes.
+	 */
+	zlp = req->req.zero && ep_is_in(req->ep) && req->req.length &&
+		!(req->req.length % req->ep->ep.maxpacket);
+
+	if (req->req.num_mapped_sgs && req->req.length)
+		ret = zynq_req_sg_to_dtd(req, zlp);
+	else
+		ret = zynq_req_buf_to_dtd(req, zlp);
+	if (!ret && zlp)
+		ret = zynq_req_add_dtd(req, bufs, 0, 1);
+	if (ret) {
+		zynq_req_free_dtd(req);
+		return ret;
+	}
+
+	req->tail->next_td_ptr = cpu_to_le32(DTD_NEXT_TERMINATE);
 
 	mb();
-	req->tail = dtd;
 
 	return 0;
 }
@@ -1127,9 +1229,11 @@ zynq_ep_queue(struct usb_ep *_ep, struct usb_request *_req, gfp_t gfp_flags)
 	struct zynq_req *req = container_of(_req, struct zynq_req, req);
 	struct zynq_udc *udc;
 	unsigned long flags;
+	int ret;
 
 	/* catch various bogus parameters */
-	if (!_req || !req->req.complete || !req->req.buf
+	if (!_req || !req->req.complete
+			|| (!req->req.buf && !req->req.num_sgs)
 			|| !list_empty(&req->queue)) {
 		VDBG("%s, bad params", __func__);
 		return -EINVAL;
@@ -1151,8 +1255,6 @@ zynq_ep_queue(struct usb_ep *_ep, struct usb_request *_req, gfp_t gfp_flags)
 
 	/* map virtual address to hardware */
 	if (req->req.dma == DMA_ADDR_INVALID) {
-		int ret;
-
 		ret = usb_gadget_map_request(&udc->gadget, _req, ep_is_in(ep));
 		if (ret)
 			return ret;
@@ -1173,12 +1275,18 @@ zynq_ep_queue(struct usb_ep *_ep, struct usb_request *_req, gfp_t gfp_flags)
 	spin_lock_irqsave(&udc->lock, flags);
 
 	/* build dtds and push them to device queue */
-	if (!zynq_req_to_dtd(req)) {
-		zynq_queue_td(ep, req);
-	} else {
+	ret = zynq_req_to_dtd(req);
+	if (ret) {
 		spin_unlock_irqrestore(&udc->lock, flags);
-		return -ENOMEM;
+		if (req->mapped) {
+			usb_gadget_unmap_request(&udc->gadget, _req,
+					ep_is_in(ep));
+			req->req.dma = DMA_ADDR_INVALID;
+			req->mapped = 0;
+		}
+		return ret;
 	}
+	zynq_queue_td(ep, req);
 
 	/* Update ep0 state */
 	if ((ep_index(ep) == 0))
@@ -2804,6 +2912,7 @@ static int zynq_udc_probe(struct platform_device *pdev)
 	/* Setup gadget structure */
 	udc_controller->gadget.ops = &zynq_gadget_ops;
 	udc_controller->gadget.max_speed = USB_SPEED_HIGH;
+	udc_controller->gadget.sg_supported = 1;
 	udc_controller->gadget.ep0 = &udc_controller->eps[0].ep;
 	INIT_LIST_HEAD(&udc_controller->gadget.ep_list);
 	udc_controller->gadget.name = driver_name;
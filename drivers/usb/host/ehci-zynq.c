@@ -14,6 +14,7 @@
 
 #include <linux/clk.h>
 #include <linux/kernel.h>
+#include <linux/log2.h>
 #include <linux/types.h>
 #include <linux/delay.h>
 #include <linux/pm.h>
@@ -309,6 +310,81 @@ static void ehci_port_power (struct ehci_hcd *ehci, int is_on)
 	msleep(20);
 }
 
+/*
+ * The controller fetches data in short AHB bursts and starts transmitting
+ * as soon as a little data is in the TX FIFO by default. Longer bursts
+ * and a higher fill threshold cut the bus overhead of bulk transfers.
+ * These registers are reset along with the controller. The FIFO threshold
+ * is raised from 2 to 8 bursts unless the platform asks otherwise.
+ */
+static void ehci_zynq_setup_burst(struct ehci_hcd *ehci)
+{
+	struct usb_hcd *hcd = ehci_to_hcd(ehci);
+	struct zynq_usb2_platform_data *pdata;
+	u32 val, thres;
+
+	pdata = hcd->self.controller->platform_data;
+
+	if (pdata->rx_burst || pdata->tx_burst) {
+		val = ehci_readl(ehci, hcd->regs + ZYNQ_SOC_USB_BURSTSIZE);
+		if (pdata->rx_burst) {
+			val &= ~BURSTSIZE_RX_MSK;
+			val |= pdata->rx_burst & BURSTSIZE_RX_MSK;
+		}
+		if (pdata->tx_burst) {
+			val &= ~BURSTSIZE_TX_MSK;
+			val |= (pdata->tx_burst << BURSTSIZE_TX_SHIFT) &
+				BURSTSIZE_TX_MSK;
+		}
+		ehci_writel(ehci, val, hcd->regs + ZYNQ_SOC_USB_BURSTSIZE);
+	}
+
+	thres = pdata->tx_fifo_thres ? : TXFILLTUNING_FIFOTHRES_DEF;
+	val = ehci_readl(ehci, hcd->regs + ZYNQ_SOC_USB_TXFILLTUNING);
+	val &= ~TXFILLTUNING_FIFOTHRES_MSK;
+	val |= (thres << TXFILLTUNING_FIFOTHRES_SHIFT) &
+		TXFILLTUNING_FIFOTHRES_MSK;
+	ehci_writel(ehci, val, hcd->regs + ZYNQ_SOC_USB_TXFILLTUNING);
+}
+
+/*
+ * Override the generic interrupt threshold and async park settings for
+ * this controller. ehci_run() writes ehci->command to the hardware.
+ */
+static void ehci_zynq_setup_command(struct ehci_hcd *ehci)
+{
+	struct usb_hcd *hcd = ehci_to_hcd(ehci);
+	struct zynq_usb2_platform_data *pdata;
+	u32 hcc_params;
+
+	pdata = hcd->self.controller->platform_data;
+
+	/* 0 interrupts immediately, otherwise 1 - 64 microframes */
+	if (pdata->itc >= 0) {
+		if (pdata->itc <= 64 &&
+		    (!pdata->itc || is_power_of_2(pdata->itc))) {
+			ehci->command &= ~CMD_ITC_MSK;
+			ehci->command |= pdata->itc << CMD_ITC_SHIFT;
+		} else {
+			ehci_warn(ehci, "invalid itc setting %d\n",
+				  pdata->itc);
+		}
+	}
+
+	hcc_params = ehci_readl(ehci, &ehci->caps->hcc_params);
+	if (pdata->async_park >= 0 && HCC_CANPARK(hcc_params)) {
+		ehci->command &= ~(CMD_PARK | CMD_PARK_CNT_MSK);
+		if (pdata->async_park) {
+			ehci->command |= CMD_PARK;
+			ehci->command |= min(pdata->async_park, 3) << 8;
+		}
+	}
+
+	ehci_dbg(ehci, "itc %d park %d\n",
+		 (ehci->command & CMD_ITC_MSK) >> CMD_ITC_SHIFT,
+		 ehci->command & CMD_PARK ? CMD_PARK_CNT(ehci->command) : 0);
+}
+
 /* called after powerup, by probe or system-pm "wakeup" */
 static int ehci_zynq_reinit(struct ehci_hcd *ehci)
 {
@@ -317,6 +393,7 @@ static int ehci_zynq_reinit(struct ehci_hcd *ehci)
 #endif
 
 	ehci_zynq_usb_setup(ehci);
+	ehci_zynq_setup_burst(ehci);
 #ifdef CONFIG_USB_ZYNQ_PHY
 	/* Don't turn off port power in OTG mode */
 	if (!hcd->phy)
@@ -358,6 +435,8 @@ static int ehci_zynq_setup(struct usb_hcd *hcd)
 	if (retval)
 		return retval;
 
+	ehci_zynq_setup_command(ehci);
+
 	retval = ehci_halt(ehci);
 	if (retval)
 		return retval;
@@ -25,5 +25,16 @@
 #define PORT_PTS_SERIAL		(3<<30)
 #define PORT_PTS_PTW		(1<<28)
 #define ZYNQ_SOC_USB_PORTSC2	0x188
+#define ZYNQ_SOC_USB_BURSTSIZE	0x160
+#define BURSTSIZE_RX_MSK	(0xff<<0)
+#define BURSTSIZE_TX_MSK	(0xff<<8)
+#define BURSTSIZE_TX_SHIFT	8
+#define ZYNQ_SOC_USB_TXFILLTUNING	0x164
+#define TXFILLTUNING_FIFOTHRES_MSK	(0x3f<<16)
+#define TXFILLTUNING_FIFOTHRES_SHIFT	16
+#define TXFILLTUNING_FIFOTHRES_DEF	8
+#define CMD_ITC_MSK		(0xff<<16)
+#define CMD_ITC_SHIFT		16
+#define CMD_PARK_CNT_MSK	(3<<8)
 
 #endif /* _EHCI_ZYNQ_H */
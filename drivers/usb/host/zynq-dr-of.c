@@ -154,6 +154,7 @@ static int zynq_dr_of_probe(struct platform_device *ofdev)
 	static unsigned int idx;
 	struct resource *res;
 	int i, phy_init;
+	u32 val;
 	int ret;
 
 	pdata = &data;
@@ -180,6 +181,18 @@ static int zynq_dr_of_probe(struct platform_device *ofdev)
 	prop = of_get_property(np, "phy_type", NULL);
 	pdata->phy_mode = determine_usb_phy(prop);
 
+	/* Optional host throughput tuning */
+	pdata->itc = -1;
+	pdata->async_park = -1;
+	if (!of_property_read_u32(np, "itc-setting", &val))
+		pdata->itc = val;
+	if (!of_property_read_u32(np, "xlnx,async-park-count", &val))
+		pdata->async_park = val;
+	of_property_read_u32(np, "rx-burst-size-dword", &pdata->rx_burst);
+	of_property_read_u32(np, "tx-burst-size-dword", &pdata->tx_burst);
+	of_property_read_u32(np, "xlnx,tx-fifo-threshold",
+			     &pdata->tx_fifo_thres);
+
 	hdata = devm_kzalloc(&ofdev->dev, sizeof(*hdata), GFP_KERNEL);
 	if (!hdata)
 		return -ENOMEM;
@@ -162,6 +162,9 @@ static struct kmem_cache	*kioctx_cachep;
 
 static struct vfsmount *aio_mnt;
 
+/* runs the requests that would otherwise block io_submit() */
+static struct workqueue_struct *aio_wq;
+
 static const struct file_operations aio_ring_fops;
 static const struct address_space_operations aio_ctx_aops;
 
@@ -236,6 +239,10 @@ static int __init aio_setup(void)
 	kiocb_cachep = KMEM_CACHE(kiocb, SLAB_HWCACHE_ALIGN|SLAB_PANIC);
 	kioctx_cachep = KMEM_CACHE(kioctx,SLAB_HWCACHE_ALIGN|SLAB_PANIC);
 
+	aio_wq = alloc_workqueue("aio", WQ_UNBOUND, 0);
+	if (!aio_wq)
+		panic("Failed to create aio workqueue.");
+
 	pr_debug("sizeof(struct page) = %zu\n", sizeof(struct page));
 
 	return 0;
@@ -1360,6 +1367,110 @@ static ssize_t aio_setup_single_vector(struct kiocb *kiocb,
 	return 0;
 }
 
+static ssize_t aio_rw_iovec(struct kiocb *req, int rw, aio_rw_op *rw_op,
+			    rw_iter_op *iter_op, struct iovec *iovec,
+			    unsigned long nr_segs)
+{
+	struct file *file = req->ki_filp;
+	struct iov_iter iter;
+	ssize_t ret;
+
+	if (rw == WRITE)
+		file_start_write(file);
+
+	if (iter_op) {
+		iov_iter_init(&iter, rw, iovec, nr_segs, req->ki_nbytes);
+		ret = iter_op(req, &iter);
+	} else {
+		ret = rw_op(req, iovec, nr_segs, req->ki_pos);
+	}
+
+	if (rw == WRITE)
+		file_end_write(file);
+	return ret;
+}
+
+static void aio_complete_ret(struct kiocb *req, ssize_t ret)
+{
+	if (ret == -EIOCBQUEUED)
+		return;
+
+	/*
+	 * There's no easy way to restart the syscall since other AIO's
+	 * may be already running. Just fail this IO with EINTR.
+	 */
+	if (unlikely(ret == -ERESTARTSYS || ret == -ERESTARTNOINTR ||
+		     ret == -ERESTARTNOHAND ||
+		     ret == -ERESTART_RESTARTBLOCK))
+		ret = -EINTR;
+	aio_complete(req, ret, 0);
+}
+
+/*
+ * Buffered reads and writes, socket and pipe I/O and fsync would run
+ * synchronously inside io_submit(). They are handed to aio_wq instead,
+ * which runs them with the submitter's mm and completes them from there.
+ */
+struct aio_punt {
+	struct work_struct	work;
+	struct kiocb		*req;
+	struct mm_struct	*mm;		/* NULL for fsync */
+	unsigned		opcode;
+	int			rw;
+	aio_rw_op		*rw_op;
+	rw_iter_op		*iter_op;
+	unsigned long		nr_segs;
+	struct iovec		iovec[];
+};
+
+static void aio_punt_work(struct work_struct *work)
+{
+	struct aio_punt *punt = container_of(work, struct aio_punt, work);
+	struct kiocb *req = punt->req;
+	ssize_t ret;
+
+	if (punt->mm) {
+		use_mm(punt->mm);
+		ret = aio_rw_iovec(req, punt->rw, punt->rw_op, punt->iter_op,
+				   punt->iovec, punt->nr_segs);
+		unuse_mm(punt->mm);
+		mmput(punt->mm);
+	} else {
+		ret = vfs_fsync(req->ki_filp, punt->opcode == IOCB_CMD_FDSYNC);
+	}
+
+	kfree(punt);
+	aio_complete_ret(req, ret);
+}
+
+static ssize_t aio_punt_iocb(struct kiocb *req, unsigned opcode, int rw,
+			     aio_rw_op *rw_op, rw_iter_op *iter_op,
+			     struct iovec *iovec, unsigned long nr_segs)
+{
+	struct aio_punt *punt;
+
+	punt = kmalloc(sizeof(*punt) + nr_segs * sizeof(*iovec), GFP_KERNEL);
+	if (!punt)
+		return -ENOMEM;
+
+	INIT_WORK(&punt->work, aio_punt_work);
+	punt->req = req;
+	punt->mm = NULL;
+	punt->opcode = opcode;
+	punt->rw = rw;
+	punt->rw_op = rw_op;
+	punt->iter_op = iter_op;
+	punt->nr_segs = nr_segs;
+	if (rw_op || iter_op) {
+		memcpy(punt->iovec, iovec, nr_segs * sizeof(*iovec));
+		punt->mm = current->mm;
+		atomic_inc(&punt->mm->mm_users);
+	}
+
+	queue_work(aio_wq, &punt->work);
+	return -EIOCBQUEUED;
+}
+
 /*
  * aio_run_iocb:
  *	Performs the initial checks and io submission.
@@ -1375,7 +1486,6 @@ static ssize_t aio_run_iocb(struct kiocb *req, unsigned opcode,
 	aio_rw_op *rw_op;
 	rw_iter_op *iter_op;
 	struct iovec inline_vecs[UIO_FASTIOV], *iovec = inline_vecs;
-	struct iov_iter iter;
 
 	switch (opcode) {
 	case IOCB_CMD_PREAD:
@@ -1423,32 +1533,25 @@ rw_common:
 			break;
 		}
 
-		if (rw == WRITE)
-			file_start_write(file);
-
-		if (iter_op) {
-			iov_iter_init(&iter, rw, iovec, nr_segs, req->ki_nbytes);
-			ret = iter_op(req, &iter);
-		} else {
-			ret = rw_op(req, iovec, nr_segs, req->ki_pos);
-		}
-
-		if (rw == WRITE)
-			file_end_write(file);
+		/* only O_DIRECT I/O is submitted without blocking */
+		if (!(file->f_flags & O_DIRECT))
+			ret = aio_punt_iocb(req, opcode, rw, rw_op, iter_op,
+					    iovec, nr_segs);
+		else
+			ret = aio_rw_iovec(req, rw, rw_op, iter_op, iovec,
+					   nr_segs);
 		break;
 
 	case IOCB_CMD_FDSYNC:
-		if (!file->f_op->aio_fsync)
-			return -EINVAL;
-
-		ret = file->f_op->aio_fsync(req, 1);
-		break;
-
 	case IOCB_CMD_FSYNC:
-		if (!file->f_op->aio_fsync)
+		if (file->f_op->aio_fsync)
+			ret = file->f_op->aio_fsync(req,
+						    opcode == IOCB_CMD_FDSYNC);
+		else if (file->f_op->fsync)
+			ret = aio_punt_iocb(req, opcode, 0, NULL, NULL,
+					    NULL, 0);
+		else
 			return -EINVAL;
-
-		ret = file->f_op->aio_fsync(req, 0);
 		break;
 
 	default:
@@ -1459,18 +1562,7 @@ rw_common:
 	if (iovec != inline_vecs)
 		kfree(iovec);
 
-	if (ret != -EIOCBQUEUED) {
-		/*
-		 * There's no easy way to restart the syscall since other AIO's
-		 * may be already running. Just fail this IO with EINTR.
-		 */
-		if (unlikely(ret == -ERESTARTSYS || ret == -ERESTARTNOINTR ||
-			     ret == -ERESTARTNOHAND ||
-			     ret == -ERESTART_RESTARTBLOCK))
-			ret = -EINTR;
-		aio_complete(req, ret, 0);
-	}
-
+	aio_complete_ret(req, ret);
 	return 0;
 }
 
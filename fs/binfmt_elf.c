@@ -972,6 +972,8 @@ static int load_elf_binary(struct linux_binprm *bprm)
 	ELF_PLAT_INIT(regs, reloc_func_desc);
 #endif
 
+	prefault_exec_text(start_code, end_code);
+
 	start_thread(regs, elf_entry, bprm->p);
 	retval = 0;
 out:
@@ -82,6 +82,34 @@
 int sysctl_vfs_cache_pressure __read_mostly = 100;
 EXPORT_SYMBOL_GPL(sysctl_vfs_cache_pressure);
 
+/*
+ * Unused negative dentries a superblock may keep on its LRU before the
+ * oldest ones are pruned regardless of memory pressure. Zero means no
+ * limit, the default allows about 1% of memory worth of them.
+ */
+unsigned long sysctl_negative_dentry_limit __read_mostly;
+
+static void prune_negative_dentries(struct work_struct *work);
+static DECLARE_WORK(negative_dentry_work, prune_negative_dentries);
+
+/*
+ * Account a negative dentry on the LRU, called with d_lock held when one
+ * is added or a dentry on the LRU loses its inode.
+ */
+static void d_negative_add(struct dentry *dentry)
+{
+	long nr = atomic_long_inc_return(&dentry->d_sb->s_nr_negative_dentry);
+	unsigned long limit = sysctl_negative_dentry_limit;
+
+	if (unlikely(limit && nr > limit))
+		schedule_work(&negative_dentry_work);
+}
+
+static void d_negative_sub(struct dentry *dentry)
+{
+	atomic_long_dec(&dentry->d_sb->s_nr_negative_dentry);
+}
+
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(rename_lock);
 
 EXPORT_SYMBOL(rename_lock);
@@ -311,6 +339,8 @@ static void dentry_iput(struct dentry * dentry)
 	struct inode *inode = dentry->d_inode;
 	if (inode) {
 		dentry->d_inode = NULL;
+		if (dentry->d_flags & DCACHE_LRU_LIST)
+			d_negative_add(dentry);
 		hlist_del_init(&dentry->d_alias);
 		spin_unlock(&dentry->d_lock);
 		spin_unlock(&inode->i_lock);
@@ -336,6 +366,8 @@ static void dentry_unlink_inode(struct dentry * dentry)
 	struct inode *inode = dentry->d_inode;
 	__d_clear_type(dentry);
 	dentry->d_inode = NULL;
+	if (dentry->d_flags & DCACHE_LRU_LIST)
+		d_negative_add(dentry);
 	hlist_del_init(&dentry->d_alias);
 	dentry_rcuwalk_barrier(dentry);
 	spin_unlock(&dentry->d_lock);
@@ -357,7 +389,8 @@ static void dentry_unlink_inode(struct dentry * dentry)
  * on the shrink list (ie not on the superblock LRU list).
  *
  * The per-cpu "nr_dentry_unused" counters are updated with
- * the DCACHE_LRU_LIST bit.
+ * the DCACHE_LRU_LIST bit, and so is the per-superblock count of
+ * negative dentries for the ones without an inode.
  *
  * These helper functions make sure we always follow the
  * rules. d_lock must be held by the caller.
@@ -368,6 +401,8 @@ static void d_lru_add(struct dentry *dentry)
 	D_FLAG_VERIFY(dentry, 0);
 	dentry->d_flags |= DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
+	if (!dentry->d_inode)
+		d_negative_add(dentry);
 	WARN_ON_ONCE(!list_lru_add(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -376,6 +411,8 @@ static void d_lru_del(struct dentry *dentry)
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
+	if (!dentry->d_inode)
+		d_negative_sub(dentry);
 	WARN_ON_ONCE(!list_lru_del(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -385,6 +422,8 @@ static void d_shrink_del(struct dentry *dentry)
 	list_del_init(&dentry->d_lru);
 	dentry->d_flags &= ~(DCACHE_SHRINK_LIST | DCACHE_LRU_LIST);
 	this_cpu_dec(nr_dentry_unused);
+	if (!dentry->d_inode)
+		d_negative_sub(dentry);
 }
 
 static void d_shrink_add(struct dentry *dentry, struct list_head *list)
@@ -393,6 +432,8 @@ static void d_shrink_add(struct dentry *dentry, struct list_head *list)
 	list_add(&dentry->d_lru, list);
 	dentry->d_flags |= DCACHE_SHRINK_LIST | DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
+	if (!dentry->d_inode)
+		d_negative_add(dentry);
 }
 
 /*
@@ -406,6 +447,8 @@ static void d_lru_isolate(struct dentry *dentry)
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
+	if (!dentry->d_inode)
+		d_negative_sub(dentry);
 	list_del_init(&dentry->d_lru);
 }
 
@@ -953,6 +996,70 @@ long prune_dcache_sb(struct super_block *sb, unsigned long nr_to_scan,
 	return freed;
 }
 
+static enum lru_status dentry_negative_isolate(struct list_head *item,
+						spinlock_t *lru_lock, void *arg)
+{
+	struct list_head *freeable = arg;
+	struct dentry	*dentry = container_of(item, struct dentry, d_lru);
+
+	if (!spin_trylock(&dentry->d_lock))
+		return LRU_SKIP;
+
+	if (dentry->d_lockref.count) {
+		d_lru_isolate(dentry);
+		spin_unlock(&dentry->d_lock);
+		return LRU_REMOVED;
+	}
+
+	/*
+	 * Positive and recently used negative dentries go to the tail, so
+	 * that one pass over the LRU sees every candidate once.
+	 */
+	if (dentry->d_inode || (dentry->d_flags & DCACHE_REFERENCED)) {
+		dentry->d_flags &= ~DCACHE_REFERENCED;
+		spin_unlock(&dentry->d_lock);
+		return LRU_ROTATE;
+	}
+
+	d_lru_shrink_move(dentry, freeable);
+	spin_unlock(&dentry->d_lock);
+
+	return LRU_REMOVED;
+}
+
+#define NEGATIVE_PRUNE_BATCH	1024UL
+
+/*
+ * Bring a superblock back below its negative dentry limit, with some
+ * slack so that we don't come back for every dput().
+ */
+static void prune_negative_sb(struct super_block *sb, void *unused)
+{
+	unsigned long limit = sysctl_negative_dentry_limit;
+	unsigned long target = limit - limit / 16;
+	unsigned long scan = list_lru_count(&sb->s_dentry_lru);
+
+	if (!limit)
+		return;
+
+	while (scan &&
+	       atomic_long_read(&sb->s_nr_negative_dentry) > (long)target) {
+		unsigned long nr = min(scan, NEGATIVE_PRUNE_BATCH);
+		LIST_HEAD(dispose);
+
+		scan -= nr;
+		list_lru_walk(&sb->s_dentry_lru, dentry_negative_isolate,
+			      &dispose, nr);
+		shrink_dentry_list(&dispose);
+		cond_resched();
+	}
+}
+
+static void prune_negative_dentries(struct work_struct *work)
+{
+	iterate_supers(prune_negative_sb, NULL);
+}
+
 static enum lru_status dentry_lru_isolate_shrink(struct list_head *item,
 						spinlock_t *lru_lock, void *arg)
 {
@@ -1578,8 +1685,11 @@ static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 
 	spin_lock(&dentry->d_lock);
 	__d_set_type(dentry, add_flags);
-	if (inode)
+	if (inode) {
 		hlist_add_head(&dentry->d_alias, &inode->i_dentry);
+		if (dentry->d_flags & DCACHE_LRU_LIST)
+			d_negative_sub(dentry);
+	}
 	dentry->d_inode = inode;
 	dentry_rcuwalk_barrier(dentry);
 	spin_unlock(&dentry->d_lock);
@@ -3380,6 +3490,9 @@ static void __init dcache_init(void)
 	dentry_cache = KMEM_CACHE(dentry,
 		SLAB_RECLAIM_ACCOUNT|SLAB_PANIC|SLAB_MEM_SPREAD);
 
+	sysctl_negative_dentry_limit = max(totalram_pages / 100 *
+				(PAGE_SIZE / sizeof(struct dentry)), 1024UL);
+
 	/* Hash may have been set up in dcache_init_early */
 	if (!hashdist)
 		return;
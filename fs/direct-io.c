@@ -125,6 +125,7 @@ struct dio {
 	unsigned long refcount;		/* direct_io_worker() and bios */
 	struct bio *bio_list;		/* singly linked via bi_private */
 	struct task_struct *waiter;	/* waiting task (NULL if none) */
+	struct request_queue *poll_q;	/* queue to poll for completion */
 
 	/* AIO related stuff */
 	struct kiocb *iocb;		/* kiocb */
@@ -423,6 +424,7 @@ static inline void dio_cleanup(struct dio *dio, struct dio_submit *sdio)
  */
 static struct bio *dio_await_one(struct dio *dio)
 {
+	struct blk_poll_wait wait = { };
 	unsigned long flags;
 	struct bio *bio = NULL;
 
@@ -438,7 +440,8 @@ static struct bio *dio_await_one(struct dio *dio)
 		__set_current_state(TASK_UNINTERRUPTIBLE);
 		dio->waiter = current;
 		spin_unlock_irqrestore(&dio->bio_lock, flags);
-		io_schedule();
+		if (!dio->poll_q || !blk_poll(dio->poll_q, &wait))
+			io_schedule();
 		/* wake up sets us TASK_RUNNING */
 		spin_lock_irqsave(&dio->bio_lock, flags);
 		dio->waiter = NULL;
@@ -1167,9 +1170,14 @@ do_blockdev_direct_IO(int rw, struct kiocb *iocb, struct inode *inode,
 	 * In that case we need to wait for I/O completion even if asked
 	 * for an asynchronous write.
 	 */
-	if (is_sync_kiocb(iocb))
+	if (is_sync_kiocb(iocb)) {
+		struct request_queue *q = bdev_get_queue(bdev);
+
 		dio->is_async = false;
-	else if (!(dio->flags & DIO_ASYNC_EXTEND) &&
+		/* Synchronous I/O can spin on a queue that polls */
+		if (blk_queue_poll(q))
+			dio->poll_q = q;
+	} else if (!(dio->flags & DIO_ASYNC_EXTEND) &&
             (rw & WRITE) && end > i_size_read(inode))
 		dio->is_async = false;
 	else
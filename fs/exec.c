@@ -816,6 +816,28 @@ ssize_t read_code(struct file *file, unsigned long addr, loff_t pos, size_t len)
 }
 EXPORT_SYMBOL(read_code);
 
+/*
+ * Kilobytes at the start of the text of a new ELF executable that are
+ * faulted in before it starts, /proc/sys/vm/exec_prefault_kb. Helpers
+ * that are executed at a high rate otherwise spend most of their short
+ * lives taking faults on the same cached text pages.
+ */
+unsigned int sysctl_exec_prefault_kb __read_mostly;
+
+void prefault_exec_text(unsigned long start, unsigned long end)
+{
+	unsigned long len = ACCESS_ONCE(sysctl_exec_prefault_kb);
+
+	len <<= 10;
+	if (!len || start >= end)
+		return;
+
+	start &= PAGE_MASK;
+	len = min(PAGE_ALIGN(len), PAGE_ALIGN(end) - start);
+	/* fault-around maps most of it in a few faults */
+	mm_populate(start, len);
+}
+
 static int exec_mmap(struct mm_struct *mm)
 {
 	struct task_struct *tsk;
@@ -271,21 +271,181 @@ int f2fs_reserve_block(struct dnode_of_data *dn, pgoff_t index)
 	return err;
 }
 
+static struct kmem_cache *extent_node_slab;
+
+/* extent nodes of all inodes, the least recently used one first */
+static LIST_HEAD(extent_lru);
+static DEFINE_SPINLOCK(extent_lru_lock);
+static unsigned long extent_node_count;
+
+static struct extent_node *lookup_extent_node(struct f2fs_inode_info *fi,
+							pgoff_t fofs)
+{
+	struct rb_node *node = fi->ext_tree.rb_node;
+
+	while (node) {
+		struct extent_node *en;
+
+		en = rb_entry(node, struct extent_node, rb_node);
+		if (fofs < en->fofs)
+			node = node->rb_left;
+		else if (fofs >= en->fofs + en->len)
+			node = node->rb_right;
+		else
+			return en;
+	}
+	return NULL;
+}
+
+/* Caller should hold ext_lock for writing */
+static struct extent_node *insert_extent_node(struct f2fs_inode_info *fi,
+			pgoff_t fofs, block_t blk_addr, unsigned int len)
+{
+	struct rb_node **p = &fi->ext_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct extent_node *en;
+
+	while (*p) {
+		parent = *p;
+		en = rb_entry(parent, struct extent_node, rb_node);
+		if (fofs < en->fofs)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+
+	/* the cache is only an optimization, don't bother retrying */
+	en = kmem_cache_alloc(extent_node_slab, GFP_ATOMIC);
+	if (!en)
+		return NULL;
+
+	en->fi = fi;
+	en->fofs = fofs;
+	en->blk_addr = blk_addr;
+	en->len = len;
+	rb_link_node(&en->rb_node, parent, p);
+	rb_insert_color(&en->rb_node, &fi->ext_tree);
+
+	spin_lock(&extent_lru_lock);
+	list_add_tail(&en->list, &extent_lru);
+	extent_node_count++;
+	stat_inc_ext_node(fi->vfs_inode.i_sb);
+	spin_unlock(&extent_lru_lock);
+	return en;
+}
+
+/* Caller should hold ext_lock for writing and extent_lru_lock */
+static void __free_extent_node(struct extent_node *en)
+{
+	struct f2fs_inode_info *fi = en->fi;
+
+	rb_erase(&en->rb_node, &fi->ext_tree);
+	list_del(&en->list);
+	extent_node_count--;
+	stat_dec_ext_node(fi->vfs_inode.i_sb);
+	kmem_cache_free(extent_node_slab, en);
+}
+
+static void free_extent_node(struct extent_node *en)
+{
+	spin_lock(&extent_lru_lock);
+	__free_extent_node(en);
+	spin_unlock(&extent_lru_lock);
+}
+
+/*
+ * Maps fofs to blk_addr in the extent tree, splitting the extent that
+ * covered fofs and merging with the neighbouring ones. Returns the extent
+ * now covering fofs, if any.
+ */
+static struct extent_node *update_extent_tree(struct f2fs_inode_info *fi,
+					pgoff_t fofs, block_t blk_addr)
+{
+	struct extent_node *en, *prev = NULL, *next;
+
+	en = lookup_extent_node(fi, fofs);
+	if (en) {
+		unsigned int end_fofs = en->fofs + en->len;
+
+		if (en->blk_addr + fofs - en->fofs == blk_addr)
+			return en;
+
+		if (fofs + 1 < end_fofs)
+			insert_extent_node(fi, fofs + 1,
+					en->blk_addr + fofs + 1 - en->fofs,
+					end_fofs - fofs - 1);
+		en->len = fofs - en->fofs;
+		if (!en->len)
+			free_extent_node(en);
+	}
+
+	if (blk_addr == NULL_ADDR)
+		return NULL;
+
+	/* fofs is not covered anymore, so prev ends right before it */
+	if (fofs)
+		prev = lookup_extent_node(fi, fofs - 1);
+	if (prev && prev->blk_addr + prev->len != blk_addr)
+		prev = NULL;
+	next = lookup_extent_node(fi, fofs + 1);
+	if (next && next->blk_addr != blk_addr + 1)
+		next = NULL;
+
+	if (prev) {
+		prev->len++;
+		if (next) {
+			prev->len += next->len;
+			free_extent_node(next);
+		}
+		return prev;
+	}
+	if (next) {
+		next->fofs--;
+		next->blk_addr--;
+		next->len++;
+		return next;
+	}
+	return insert_extent_node(fi, fofs, blk_addr, 1);
+}
+
+void init_extent_tree(struct inode *inode)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+
+	write_lock(&fi->ext.ext_lock);
+	if (fi->ext.len)
+		insert_extent_node(fi, fi->ext.fofs, fi->ext.blk_addr,
+							fi->ext.len);
+	write_unlock(&fi->ext.ext_lock);
+}
+
+void destroy_extent_tree(struct inode *inode)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct rb_node *node;
+
+	write_lock(&fi->ext.ext_lock);
+	spin_lock(&extent_lru_lock);
+	while ((node = rb_first(&fi->ext_tree)))
+		__free_extent_node(rb_entry(node, struct extent_node, rb_node));
+	spin_unlock(&extent_lru_lock);
+	write_unlock(&fi->ext.ext_lock);
+}
+
 static int check_extent_cache(struct inode *inode, pgoff_t pgofs,
 					struct buffer_head *bh_result)
 {
 	struct f2fs_inode_info *fi = F2FS_I(inode);
+	unsigned int blkbits = inode->i_sb->s_blocksize_bits;
 	pgoff_t start_fofs, end_fofs;
 	block_t start_blkaddr;
+	struct extent_node *en;
+	size_t count;
 
 	if (is_inode_flag_set(fi, FI_NO_EXTENT))
 		return 0;
 
 	read_lock(&fi->ext.ext_lock);
-	if (fi->ext.len == 0) {
-		read_unlock(&fi->ext.ext_lock);
-		return 0;
-	}
 
 	stat_inc_total_hit(inode->i_sb);
 
@@ -293,33 +453,44 @@ static int check_extent_cache(struct inode *inode, pgoff_t pgofs,
 	end_fofs = fi->ext.fofs + fi->ext.len - 1;
 	start_blkaddr = fi->ext.blk_addr;
 
-	if (pgofs >= start_fofs && pgofs <= end_fofs) {
-		unsigned int blkbits = inode->i_sb->s_blocksize_bits;
-		size_t count;
-
-		clear_buffer_new(bh_result);
-		map_bh(bh_result, inode->i_sb,
-				start_blkaddr + pgofs - start_fofs);
-		count = end_fofs - pgofs + 1;
-		if (count < (UINT_MAX >> blkbits))
-			bh_result->b_size = (count << blkbits);
-		else
-			bh_result->b_size = UINT_MAX;
+	if (fi->ext.len && pgofs >= start_fofs && pgofs <= end_fofs)
+		goto found;
 
-		stat_inc_read_hit(inode->i_sb);
+	en = lookup_extent_node(fi, pgofs);
+	if (!en) {
 		read_unlock(&fi->ext.ext_lock);
-		return 1;
+		return 0;
 	}
+
+	start_fofs = en->fofs;
+	end_fofs = en->fofs + en->len - 1;
+	start_blkaddr = en->blk_addr;
+
+	spin_lock(&extent_lru_lock);
+	list_move_tail(&en->list, &extent_lru);
+	spin_unlock(&extent_lru_lock);
+	stat_inc_tree_hit(inode->i_sb);
+found:
+	clear_buffer_new(bh_result);
+	map_bh(bh_result, inode->i_sb, start_blkaddr + pgofs - start_fofs);
+	count = end_fofs - pgofs + 1;
+	if (count < (UINT_MAX >> blkbits))
+		bh_result->b_size = (count << blkbits);
+	else
+		bh_result->b_size = UINT_MAX;
+
+	stat_inc_read_hit(inode->i_sb);
 	read_unlock(&fi->ext.ext_lock);
-	return 0;
+	return 1;
 }
 
 void update_extent_cache(block_t blk_addr, struct dnode_of_data *dn)
 {
 	struct f2fs_inode_info *fi = F2FS_I(dn->inode);
 	pgoff_t fofs, start_fofs, end_fofs;
-	block_t start_blkaddr, end_blkaddr;
-	int need_update = true;
+	block_t start_blkaddr;
+	struct extent_node *en;
+	int need_update = false;
 
 	f2fs_bug_on(F2FS_I_SB(dn->inode), blk_addr == NEW_ADDR);
 	fofs = start_bidx_of_node(ofs_of_node(dn->node_page), fi) +
@@ -333,42 +504,18 @@ void update_extent_cache(block_t blk_addr, struct dnode_of_data *dn)
 
 	write_lock(&fi->ext.ext_lock);
 
+	en = update_extent_tree(fi, fofs, blk_addr);
+
+	/*
+	 * The largest extent is the one kept in the inode block, split it
+	 * if fofs moved away and replace it once the tree has a larger one.
+	 */
 	start_fofs = fi->ext.fofs;
 	end_fofs = fi->ext.fofs + fi->ext.len - 1;
 	start_blkaddr = fi->ext.blk_addr;
-	end_blkaddr = fi->ext.blk_addr + fi->ext.len - 1;
-
-	/* Drop and initialize the matched extent */
-	if (fi->ext.len == 1 && fofs == start_fofs)
-		fi->ext.len = 0;
-
-	/* Initial extent */
-	if (fi->ext.len == 0) {
-		if (blk_addr != NULL_ADDR) {
-			fi->ext.fofs = fofs;
-			fi->ext.blk_addr = blk_addr;
-			fi->ext.len = 1;
-		}
-		goto end_update;
-	}
-
-	/* Front merge */
-	if (fofs == start_fofs - 1 && blk_addr == start_blkaddr - 1) {
-		fi->ext.fofs--;
-		fi->ext.blk_addr--;
-		fi->ext.len++;
-		goto end_update;
-	}
-
-	/* Back merge */
-	if (fofs == end_fofs + 1 && blk_addr == end_blkaddr + 1) {
-		fi->ext.len++;
-		goto end_update;
-	}
 
-	/* Split the existing extent */
-	if (fi->ext.len > 1 &&
-		fofs >= start_fofs && fofs <= end_fofs) {
+	if (fi->ext.len && fofs >= start_fofs && fofs <= end_fofs &&
+			blk_addr != start_blkaddr + fofs - start_fofs) {
 		if ((end_fofs - fofs) < (fi->ext.len >> 1)) {
 			fi->ext.len = fofs - start_fofs;
 		} else {
@@ -377,21 +524,73 @@ void update_extent_cache(block_t blk_addr, struct dnode_of_data *dn)
 					fofs - start_fofs + 1;
 			fi->ext.len -= fofs - start_fofs + 1;
 		}
-	} else {
-		need_update = false;
+		need_update = true;
 	}
 
-	/* Finally, if the extent is very fragmented, let's drop the cache. */
-	if (fi->ext.len < F2FS_MIN_EXTENT_LEN) {
-		fi->ext.len = 0;
-		set_inode_flag(fi, FI_NO_EXTENT);
+	if (en && en->len > fi->ext.len) {
+		fi->ext.fofs = en->fofs;
+		fi->ext.blk_addr = en->blk_addr;
+		fi->ext.len = en->len;
 		need_update = true;
 	}
-end_update:
+
 	write_unlock(&fi->ext.ext_lock);
 	if (need_update)
 		sync_inode_page(dn);
-	return;
+}
+
+static unsigned long f2fs_extent_count(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	return ACCESS_ONCE(extent_node_count);
+}
+
+static unsigned long f2fs_extent_scan(struct shrinker *shrink,
+					struct shrink_control *sc)
+{
+	unsigned long freed = 0, scanned = 0;
+	struct extent_node *en;
+
+	spin_lock(&extent_lru_lock);
+	while (scanned++ < sc->nr_to_scan && !list_empty(&extent_lru)) {
+		struct f2fs_inode_info *fi;
+
+		en = list_first_entry(&extent_lru, struct extent_node, list);
+		fi = en->fi;
+
+		/* ext_lock nests outside extent_lru_lock elsewhere */
+		if (!write_trylock(&fi->ext.ext_lock)) {
+			list_move_tail(&en->list, &extent_lru);
+			continue;
+		}
+		__free_extent_node(en);
+		write_unlock(&fi->ext.ext_lock);
+		freed++;
+	}
+	spin_unlock(&extent_lru_lock);
+	return freed;
+}
+
+static struct shrinker f2fs_extent_shrinker = {
+	.count_objects = f2fs_extent_count,
+	.scan_objects = f2fs_extent_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+int __init create_extent_cache(void)
+{
+	extent_node_slab = f2fs_kmem_cache_create("f2fs_extent_node",
+					sizeof(struct extent_node));
+	if (!extent_node_slab)
+		return -ENOMEM;
+	register_shrinker(&f2fs_extent_shrinker);
+	return 0;
+}
+
+void destroy_extent_cache(void)
+{
+	unregister_shrinker(&f2fs_extent_shrinker);
+	kmem_cache_destroy(extent_node_slab);
 }
 
 struct page *find_data_page(struct inode *inode, pgoff_t index, bool sync)
@@ -241,6 +241,20 @@ struct extent_info {
 	unsigned int len;	/* length of the extent */
 };
 
+/*
+ * Extents other than the largest one are cached in an rb-tree per inode,
+ * protected by the ext_lock of the inode, and on a global lru list that
+ * the extent cache shrinker frees nodes from.
+ */
+struct extent_node {
+	struct rb_node rb_node;		/* node in the extent tree */
+	struct list_head list;		/* node in the global lru list */
+	struct f2fs_inode_info *fi;	/* inode the extent belongs to */
+	unsigned int fofs;		/* start offset in a file */
+	u32 blk_addr;			/* start block address of the extent */
+	unsigned int len;		/* length of the extent */
+};
+
 /*
  * i_advise uses FADVISE_XXX_BIT. We can add additional hints later.
  */
@@ -267,6 +281,7 @@ struct f2fs_inode_info {
 	nid_t i_xattr_nid;		/* node id that contains xattrs */
 	unsigned long long xattr_ver;	/* cp version of xattr modification */
 	struct extent_info ext;		/* in-memory extent cache entry */
+	struct rb_root ext_tree;	/* remaining cached extents */
 	struct dir_inode_entry *dirty_dir;	/* the pointer of dirty dir */
 
 	struct list_head inmem_pages;	/* inmemory pages managed by f2fs */
@@ -557,6 +572,8 @@ struct f2fs_sb_info {
 	unsigned int segment_count[2];		/* # of allocated segments */
 	unsigned int block_count[2];		/* # of allocated blocks */
 	int total_hit_ext, read_hit_ext;	/* extent cache hit ratio */
+	int tree_hit_ext;			/* hits in the extent tree */
+	int ext_node_count;			/* # of cached extent nodes */
 	int inline_inode;			/* # of inline_data inodes */
 	int bg_gc;				/* background gc calls */
 	unsigned int n_dirty_dirs;		/* # of dir inodes */
@@ -1368,12 +1385,16 @@ void f2fs_submit_page_mbio(struct f2fs_sb_info *, struct page *, block_t,
 						struct f2fs_io_info *);
 int reserve_new_block(struct dnode_of_data *);
 int f2fs_reserve_block(struct dnode_of_data *, pgoff_t);
+void init_extent_tree(struct inode *);
+void destroy_extent_tree(struct inode *);
 void update_extent_cache(block_t, struct dnode_of_data *);
 struct page *find_data_page(struct inode *, pgoff_t, bool);
 struct page *get_lock_data_page(struct inode *, pgoff_t);
 struct page *get_new_data_page(struct inode *, struct page *, pgoff_t, bool);
 int do_write_data_page(struct page *, struct f2fs_io_info *);
 int f2fs_fiemap(struct inode *inode, struct fiemap_extent_info *, u64, u64);
+int __init create_extent_cache(void);
+void destroy_extent_cache(void);
 
 /*
  * gc.c
@@ -1401,7 +1422,7 @@ struct f2fs_stat_info {
 	struct f2fs_sb_info *sbi;
 	int all_area_segs, sit_area_segs, nat_area_segs, ssa_area_segs;
 	int main_area_segs, main_area_sections, main_area_zones;
-	int hit_ext, total_ext;
+	int hit_ext, total_ext, tree_hit_ext, ext_node_count;
 	int ndirty_node, ndirty_dent, ndirty_dirs, ndirty_meta;
 	int nats, sits, fnids;
 	int total_count, utilization;
@@ -1435,6 +1456,9 @@ static inline struct f2fs_stat_info *F2FS_STAT(struct f2fs_sb_info *sbi)
 #define stat_dec_dirty_dir(sbi)		((sbi)->n_dirty_dirs--)
 #define stat_inc_total_hit(sb)		((F2FS_SB(sb))->total_hit_ext++)
 #define stat_inc_read_hit(sb)		((F2FS_SB(sb))->read_hit_ext++)
+#define stat_inc_tree_hit(sb)		((F2FS_SB(sb))->tree_hit_ext++)
+#define stat_inc_ext_node(sb)		((F2FS_SB(sb))->ext_node_count++)
+#define stat_dec_ext_node(sb)		((F2FS_SB(sb))->ext_node_count--)
 #define stat_inc_inline_inode(inode)					\
 	do {								\
 		if (f2fs_has_inline_data(inode))			\
@@ -1490,6 +1514,9 @@ void f2fs_destroy_root_stats(void);
 #define stat_dec_dirty_dir(sbi)
 #define stat_inc_total_hit(sb)
 #define stat_inc_read_hit(sb)
+#define stat_inc_tree_hit(sb)
+#define stat_inc_ext_node(sb)
+#define stat_dec_ext_node(sb)
 #define stat_inc_inline_inode(inode)
 #define stat_dec_inline_inode(inode)
 #define stat_inc_seg_type(sbi, curseg)
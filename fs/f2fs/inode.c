@@ -112,6 +112,7 @@ static int do_read_inode(struct inode *inode)
 	fi->i_dir_level = ri->i_dir_level;
 
 	get_extent_info(&fi->ext, ri->i_ext);
+	init_extent_tree(inode);
 	get_inline_info(fi, ri);
 
 	/* get rdev by using inline_info */
@@ -308,6 +309,7 @@ no_delete:
 	if (is_inode_flag_set(F2FS_I(inode), FI_UPDATE_WRITE))
 		add_dirty_inode(sbi, inode->i_ino, UPDATE_INO);
 out_clear:
+	destroy_extent_tree(inode);
 	clear_inode(inode);
 }
 
@@ -2114,6 +2114,11 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 {
 	struct fuse_conn *fc = fuse_get_conn(file);
 	if (fc) {
+		/* clones of the device only drop their reference */
+		if (!atomic_dec_and_test(&fc->dev_count)) {
+			fuse_conn_put(fc);
+			return 0;
+		}
 		spin_lock(&fc->lock);
 		fc->connected = 0;
 		fc->blocked = 0;
@@ -2139,6 +2144,53 @@ static int fuse_dev_fasync(int fd, struct file *file, int on)
 	return fasync_helper(fd, file, on, &fc->fasync);
 }
 
+/*
+ * Attach the connection of another device file to this one, so that a
+ * multithreaded daemon can give each thread its own file to read
+ * requests from and write replies to.
+ */
+static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
+{
+	int err = -EINVAL;
+
+	mutex_lock(&fuse_mutex);
+	if (!new->private_data) {
+		atomic_inc(&fc->dev_count);
+		new->private_data = fuse_conn_get(fc);
+		err = 0;
+	}
+	mutex_unlock(&fuse_mutex);
+
+	return err;
+}
+
+static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	struct file *old;
+	struct fuse_conn *fc;
+	u32 oldfd;
+	int err;
+
+	if (cmd != FUSE_DEV_IOC_CLONE)
+		return -ENOTTY;
+
+	if (get_user(oldfd, (u32 __user *) arg))
+		return -EFAULT;
+
+	old = fget(oldfd);
+	if (!old)
+		return -EINVAL;
+
+	err = -EINVAL;
+	fc = fuse_get_conn(old);
+	if (old->f_op == file->f_op && fc)
+		err = fuse_device_clone(fc, file);
+	fput(old);
+
+	return err;
+}
+
 const struct file_operations fuse_dev_operations = {
 	.owner		= THIS_MODULE,
 	.llseek		= no_llseek,
@@ -2151,6 +2203,8 @@ const struct file_operations fuse_dev_operations = {
 	.poll		= fuse_dev_poll,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
+	.unlocked_ioctl = fuse_dev_ioctl,
+	.compat_ioctl   = fuse_dev_ioctl,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
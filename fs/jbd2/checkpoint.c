@@ -102,6 +102,40 @@ static int __try_to_free_cp_buf(struct journal_head *jh)
 	return ret;
 }
 
+/*
+ * jbd2_checkpoint_work: checkpoint in the background
+ *
+ * Queued by jbd2_log_start_checkpoint() once the log runs low.  Keeps
+ * checkpointing until enough space is free again, so that the commit of
+ * the next transactions overlaps with it and handles rarely have to wait
+ * in __jbd2_log_wait_for_space().
+ */
+void jbd2_checkpoint_work(struct work_struct *work)
+{
+	journal_t *journal = container_of(work, journal_t, j_checkpoint_work);
+	int low;
+
+	mutex_lock(&journal->j_checkpoint_mutex);
+	for (;;) {
+		read_lock(&journal->j_state_lock);
+		low = jbd2_log_space_low(journal) &&
+		      !(journal->j_flags & (JBD2_ABORT |
+					    JBD2_NO_BG_CHECKPOINT));
+		read_unlock(&journal->j_state_lock);
+		if (!low)
+			break;
+
+		spin_lock(&journal->j_list_lock);
+		low = journal->j_checkpoint_transactions != NULL;
+		spin_unlock(&journal->j_list_lock);
+		if (!low || jbd2_log_do_checkpoint(journal) < 0)
+			break;
+		cond_resched();
+	}
+	jbd2_cleanup_journal_tail(journal);
+	mutex_unlock(&journal->j_checkpoint_mutex);
+}
+
 /*
  * __jbd2_log_wait_for_space: wait until there is space in the journal.
  *
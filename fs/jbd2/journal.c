@@ -496,6 +496,22 @@ repeat:
  * journal, so that we can begin checkpointing when appropriate.
  */
 
+static struct workqueue_struct *jbd2_checkpoint_wq;
+
+/*
+ * Queue a background checkpoint if the log is getting full and there is
+ * something to checkpoint.  Called with j_state_lock held, which orders
+ * it against jbd2_journal_destroy() stopping the background checkpoints.
+ */
+void jbd2_log_start_checkpoint(journal_t *journal)
+{
+	if (journal->j_flags & (JBD2_ABORT | JBD2_NO_BG_CHECKPOINT))
+		return;
+	if (!journal->j_checkpoint_transactions || !jbd2_log_space_low(journal))
+		return;
+	queue_work(jbd2_checkpoint_wq, &journal->j_checkpoint_work);
+}
+
 /*
  * Called with j_state_lock locked for writing.
  * Returns true if a transaction commit was started.
@@ -1084,6 +1100,7 @@ static journal_t * journal_init_common (void)
 	init_waitqueue_head(&journal->j_wait_reserved);
 	mutex_init(&journal->j_barrier);
 	mutex_init(&journal->j_checkpoint_mutex);
+	INIT_WORK(&journal->j_checkpoint_work, jbd2_checkpoint_work);
 	spin_lock_init(&journal->j_revoke_lock);
 	spin_lock_init(&journal->j_list_lock);
 	rwlock_init(&journal->j_state_lock);
@@ -1678,6 +1695,12 @@ int jbd2_journal_destroy(journal_t *journal)
 {
 	int err = 0;
 
+	/* Background checkpoints may wait for the commit thread */
+	write_lock(&journal->j_state_lock);
+	journal->j_flags |= JBD2_NO_BG_CHECKPOINT;
+	write_unlock(&journal->j_state_lock);
+	cancel_work_sync(&journal->j_checkpoint_work);
+
 	/* Wait for the commit thread to wake up and die. */
 	journal_kill_thread(journal);
 
@@ -2647,6 +2670,12 @@ static int __init journal_init(void)
 	BUILD_BUG_ON(sizeof(struct journal_superblock_s) != 1024);
 
 	ret = journal_init_caches();
+	if (ret == 0) {
+		jbd2_checkpoint_wq = alloc_workqueue("jbd2-checkpoint",
+					WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+		if (!jbd2_checkpoint_wq)
+			ret = -ENOMEM;
+	}
 	if (ret == 0) {
 		jbd2_create_jbd_stats_proc_entry();
 	} else {
@@ -2663,6 +2692,7 @@ static void __exit journal_exit(void)
 		printk(KERN_ERR "JBD2: leaked %d journal_heads!\n", n);
 #endif
 	jbd2_remove_jbd_stats_proc_entry();
+	destroy_workqueue(jbd2_checkpoint_wq);
 	jbd2_journal_destroy_caches();
 }
 
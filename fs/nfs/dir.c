@@ -77,6 +77,7 @@ static struct nfs_open_dir_context *alloc_nfs_open_dir_context(struct inode *dir
 		ctx->attr_gencount = nfsi->attr_gencount;
 		ctx->dir_cookie = 0;
 		ctx->dup_cookie = 0;
+		ctx->plus = false;
 		ctx->cred = get_rpccred(cred);
 		spin_lock(&dir->i_lock);
 		list_add(&ctx->list, &nfsi->open_files);
@@ -165,6 +166,8 @@ typedef struct {
 	unsigned long	timestamp;
 	unsigned long	gencount;
 	unsigned int	cache_entry_index;
+	unsigned int	plus_entries;
+	unsigned int	plus_cached;
 	unsigned int	plus:1;
 	unsigned int	eof:1;
 } nfs_readdir_descriptor_t;
@@ -421,11 +424,15 @@ different:
 }
 
 static
-bool nfs_use_readdirplus(struct inode *dir, struct dir_context *ctx)
+bool nfs_use_readdirplus(struct inode *dir, struct dir_context *ctx,
+			 struct nfs_open_dir_context *dir_ctx)
 {
 	if (!nfs_server_capable(dir, NFS_CAP_READDIRPLUS))
 		return false;
+	/* Stick to readdirplus for the rest of the listing once asked */
 	if (test_and_clear_bit(NFS_INO_ADVISE_RDPLUS, &NFS_I(dir)->flags))
+		dir_ctx->plus = true;
+	if (dir_ctx->plus)
 		return true;
 	if (ctx->pos == 0)
 		return true;
@@ -449,37 +456,58 @@ void nfs_advise_use_readdirplus(struct inode *dir)
  * If this is an 'ls -l', we want to force use of readdirplus.
  * Do this by checking if there is an active file descriptor
  * and calling nfs_advise_use_readdirplus, then forcing a
- * cache flush.
+ * cache flush. A listing that already switched to readdirplus
+ * fills the pages it still has to read with attributes, so
+ * flushing the pages it has read only makes it start over.
  */
 void nfs_force_use_readdirplus(struct inode *dir)
 {
-	if (!list_empty(&NFS_I(dir)->open_files)) {
+	struct nfs_inode *nfsi = NFS_I(dir);
+	struct nfs_open_dir_context *ctx;
+	bool plus = false;
+
+	spin_lock(&dir->i_lock);
+	list_for_each_entry(ctx, &nfsi->open_files, list) {
+		if (ctx->plus) {
+			plus = true;
+			break;
+		}
+	}
+	spin_unlock(&dir->i_lock);
+
+	if (!plus && !list_empty(&nfsi->open_files)) {
 		nfs_advise_use_readdirplus(dir);
 		nfs_zap_mapping(dir, dir->i_mapping);
 	}
 }
 
+/*
+ * Returns true if the entry was already in the dcache with attributes
+ * that had not timed out yet.
+ */
 static
-void nfs_prime_dcache(struct dentry *parent, struct nfs_entry *entry)
+bool nfs_prime_dcache(struct dentry *parent, struct nfs_entry *entry)
 {
 	struct qstr filename = QSTR_INIT(entry->name, entry->len);
 	struct dentry *dentry;
 	struct dentry *alias;
 	struct inode *dir = parent->d_inode;
 	struct inode *inode;
+	bool cached = false;
 	int status;
 
 	if (filename.name[0] == '.') {
 		if (filename.len == 1)
-			return;
+			return false;
 		if (filename.len == 2 && filename.name[1] == '.')
-			return;
+			return false;
 	}
 	filename.hash = full_name_hash(filename.name, filename.len);
 
 	dentry = d_lookup(parent, &filename);
 	if (dentry != NULL) {
 		if (nfs_same_file(dentry, entry)) {
+			cached = !nfs_attribute_cache_expired(dentry->d_inode);
 			nfs_set_verifier(dentry, nfs_save_change_attribute(dir));
 			status = nfs_refresh_inode(dentry->d_inode, entry->fattr);
 			if (!status)
@@ -493,7 +521,7 @@ void nfs_prime_dcache(struct dentry *parent, struct nfs_entry *entry)
 
 	dentry = d_alloc(parent, &filename);
 	if (dentry == NULL)
-		return;
+		return false;
 
 	inode = nfs_fhget(dentry->d_sb, entry->fh, entry->fattr, entry->label);
 	if (IS_ERR(inode))
@@ -510,6 +538,7 @@ void nfs_prime_dcache(struct dentry *parent, struct nfs_entry *entry)
 
 out:
 	dput(dentry);
+	return cached;
 }
 
 /* Perform conversion from xdr to cache array */
@@ -541,8 +570,11 @@ int nfs_readdir_page_filler(nfs_readdir_descriptor_t *desc, struct nfs_entry *en
 
 		count++;
 
-		if (desc->plus != 0)
-			nfs_prime_dcache(desc->file->f_path.dentry, entry);
+		if (desc->plus != 0) {
+			desc->plus_entries++;
+			if (nfs_prime_dcache(desc->file->f_path.dentry, entry))
+				desc->plus_cached++;
+		}
 
 		status = nfs_readdir_add_to_array(entry, page);
 		if (status != 0)
@@ -600,6 +632,22 @@ out_freepages:
 	return -ENOMEM;
 }
 
+/*
+ * Fetching attributes that are mostly cached already makes the replies
+ * larger for nothing, use plain READDIR for the rest of the listing then.
+ */
+static
+void nfs_readdir_check_plus(nfs_readdir_descriptor_t *desc)
+{
+	struct nfs_open_dir_context *ctx = desc->file->private_data;
+
+	if (desc->plus_cached * 4 < desc->plus_entries * 3)
+		return;
+	desc->plus = 0;
+	ctx->plus = false;
+	nfs_inc_stats(file_inode(desc->file), NFSIOS_READDIRPLUS_FALLBACK);
+}
+
 static
 int nfs_readdir_xdr_to_array(nfs_readdir_descriptor_t *desc, struct page *page, struct inode *inode)
 {
@@ -637,6 +685,8 @@ int nfs_readdir_xdr_to_array(nfs_readdir_descriptor_t *desc, struct page *page,
 	status = nfs_readdir_large_page(pages, array_size);
 	if (status < 0)
 		goto out_release_array;
+	desc->plus_entries = 0;
+	desc->plus_cached = 0;
 	do {
 		unsigned int pglen;
 		status = nfs_readdir_xdr_filler(pages, desc, &entry, file, inode);
@@ -652,6 +702,12 @@ int nfs_readdir_xdr_to_array(nfs_readdir_descriptor_t *desc, struct page *page,
 		}
 	} while (array->eof_index < 0);
 
+	if (desc->plus_cached) {
+		nfs_add_event_stats(inode, NFSIOS_READDIRPLUS_CACHED,
+				    desc->plus_cached);
+		nfs_readdir_check_plus(desc);
+	}
+
 	nfs_readdir_free_large_page(pages_ptr, pages, array_size);
 out_release_array:
 	nfs_readdir_release_array(page);
@@ -876,7 +932,7 @@ static int nfs_readdir(struct file *file, struct dir_context *ctx)
 	desc->ctx = ctx;
 	desc->dir_cookie = &dir_ctx->dir_cookie;
 	desc->decode = NFS_PROTO(inode)->decode_dirent;
-	desc->plus = nfs_use_readdirplus(inode, ctx) ? 1 : 0;
+	desc->plus = nfs_use_readdirplus(inode, ctx, dir_ctx) ? 1 : 0;
 
 	nfs_block_sillyrename(dentry);
 	if (ctx->pos == 0 || nfs_dir_mapping_need_revalidate(inode))
@@ -900,6 +956,7 @@ static int nfs_readdir(struct file *file, struct dir_context *ctx)
 		}
 		if (res == -ETOOSMALL && desc->plus) {
 			clear_bit(NFS_INO_ADVISE_RDPLUS, &NFS_I(inode)->flags);
+			dir_ctx->plus = false;
 			nfs_zap_caches(inode);
 			desc->page_index = 0;
 			desc->plus = 0;
@@ -34,6 +34,13 @@ static inline void nfs_inc_stats(const struct inode *inode,
 	nfs_inc_server_stats(NFS_SERVER(inode), stat);
 }
 
+static inline void nfs_add_event_stats(const struct inode *inode,
+				       enum nfs_stat_eventcounters stat,
+				       long addend)
+{
+	this_cpu_add(NFS_SERVER(inode)->io_stats->events[stat], addend);
+}
+
 static inline void nfs_add_server_stats(const struct nfs_server *server,
 					enum nfs_stat_bytecounters stat,
 					long addend)
@@ -39,6 +39,13 @@ unsigned int pipe_max_size = 1048576;
  */
 unsigned int pipe_min_size = PAGE_SIZE;
 
+/*
+ * Number of released pages a pipe keeps for its next writes, set in
+ * /proc/sys/fs/pipe-reuse-pages. Busy pipes save a trip to the page
+ * allocator per page written; idle ones hold on to that much memory.
+ */
+unsigned int pipe_reuse_pages = 1;
+
 /*
  * We use a start+len construction, which provides full use of the 
  * allocated memory.
@@ -116,18 +123,41 @@ void pipe_wait(struct pipe_inode_info *pipe)
 	pipe_lock(pipe);
 }
 
+/* Keep an unused page for pipe_write(), or free it if enough are kept */
+static void pipe_put_tmp_page(struct pipe_inode_info *pipe, struct page *page)
+{
+	if (pipe->nr_tmp_pages < ACCESS_ONCE(pipe_reuse_pages)) {
+		list_add(&page->lru, &pipe->tmp_pages);
+		pipe->nr_tmp_pages++;
+	} else {
+		__free_page(page);
+	}
+}
+
+static struct page *pipe_get_tmp_page(struct pipe_inode_info *pipe)
+{
+	struct page *page;
+
+	if (list_empty(&pipe->tmp_pages))
+		return alloc_page(GFP_HIGHUSER);
+
+	page = list_first_entry(&pipe->tmp_pages, struct page, lru);
+	list_del(&page->lru);
+	pipe->nr_tmp_pages--;
+	return page;
+}
+
 static void anon_pipe_buf_release(struct pipe_inode_info *pipe,
 				  struct pipe_buffer *buf)
 {
 	struct page *page = buf->page;
 
 	/*
-	 * If nobody else uses this page, and we don't already have a
-	 * temporary page, let's keep track of it as a one-deep
-	 * allocation cache. (Otherwise just release our reference to it)
+	 * If nobody else uses this page, keep it as an allocation cache
+	 * for the next writes. (Otherwise just release our reference to it)
 	 */
-	if (page_count(page) == 1 && !pipe->tmp_page)
-		pipe->tmp_page = page;
+	if (page_count(page) == 1)
+		pipe_put_tmp_page(pipe, page);
 	else
 		page_cache_release(page);
 }
@@ -397,16 +427,13 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 		if (bufs < pipe->buffers) {
 			int newbuf = (pipe->curbuf + bufs) & (pipe->buffers-1);
 			struct pipe_buffer *buf = pipe->bufs + newbuf;
-			struct page *page = pipe->tmp_page;
+			struct page *page;
 			int copied;
 
-			if (!page) {
-				page = alloc_page(GFP_HIGHUSER);
-				if (unlikely(!page)) {
-					ret = ret ? : -ENOMEM;
-					break;
-				}
-				pipe->tmp_page = page;
+			page = pipe_get_tmp_page(pipe);
+			if (unlikely(!page)) {
+				ret = ret ? : -ENOMEM;
+				break;
 			}
 			/* Always wake up, even if the copy fails. Otherwise
 			 * we lock up (O_NONBLOCK-)readers that sleep due to
@@ -416,6 +443,7 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 			do_wakeup = 1;
 			copied = copy_page_from_iter(page, 0, PAGE_SIZE, from);
 			if (unlikely(copied < PAGE_SIZE && iov_iter_count(from))) {
+				pipe_put_tmp_page(pipe, page);
 				if (!ret)
 					ret = -EFAULT;
 				break;
@@ -433,7 +461,6 @@ pipe_write(struct kiocb *iocb, struct iov_iter *from)
 				buf->flags = PIPE_BUF_FLAG_PACKET;
 			}
 			pipe->nrbufs = ++bufs;
-			pipe->tmp_page = NULL;
 
 			if (!iov_iter_count(from))
 				break;
@@ -594,6 +621,7 @@ struct pipe_inode_info *alloc_pipe_info(void)
 		pipe->bufs = kzalloc(sizeof(struct pipe_buffer) * PIPE_DEF_BUFFERS, GFP_KERNEL);
 		if (pipe->bufs) {
 			init_waitqueue_head(&pipe->wait);
+			INIT_LIST_HEAD(&pipe->tmp_pages);
 			pipe->r_counter = pipe->w_counter = 1;
 			pipe->buffers = PIPE_DEF_BUFFERS;
 			mutex_init(&pipe->mutex);
@@ -607,6 +635,7 @@ struct pipe_inode_info *alloc_pipe_info(void)
 
 void free_pipe_info(struct pipe_inode_info *pipe)
 {
+	struct page *page, *next;
 	int i;
 
 	for (i = 0; i < pipe->buffers; i++) {
@@ -614,8 +643,8 @@ void free_pipe_info(struct pipe_inode_info *pipe)
 		if (buf->ops)
 			buf->ops->release(pipe, buf);
 	}
-	if (pipe->tmp_page)
-		__free_page(pipe->tmp_page);
+	list_for_each_entry_safe(page, next, &pipe->tmp_pages, lru)
+		__free_page(page);
 	kfree(pipe->bufs);
 	kfree(pipe);
 }
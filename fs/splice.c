@@ -35,6 +35,9 @@
 #include <linux/aio.h>
 #include "internal.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/splice.h>
+
 /*
  * Attempt to steal a page from a pipe buffer. This should perhaps go into
  * a vm helper function, it's already simplified quite a bit by the
@@ -1120,12 +1123,30 @@ static long do_splice_from(struct pipe_inode_info *pipe, struct file *out,
 	ssize_t (*splice_write)(struct pipe_inode_info *, struct file *,
 				loff_t *, size_t, unsigned int);
 
+	loff_t pos = *ppos;
+	long ret;
+
 	if (out->f_op->splice_write)
 		splice_write = out->f_op->splice_write;
 	else
 		splice_write = default_file_splice_write;
 
-	return splice_write(pipe, out, ppos, len, flags);
+	ret = splice_write(pipe, out, ppos, len, flags);
+
+	/*
+	 * Sockets take the pipe pages by reference and O_DIRECT writes do
+	 * their I/O straight from them, everything else copies the data.
+	 */
+	if (ret > 0) {
+		if (splice_write == generic_splice_sendpage ||
+		    (splice_write == iter_file_splice_write &&
+		     (out->f_flags & O_DIRECT)))
+			trace_splice_from_pipe(out, pos, ret, 0);
+		else
+			trace_splice_from_pipe(out, pos, 0, ret);
+	}
+
+	return ret;
 }
 
 /*
@@ -47,6 +47,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -497,7 +498,87 @@ out:
 	return 0;
 }
 
+#ifdef CONFIG_SQUASHFS_READPAGES
+/*
+ * Readahead decompresses each Squashfs block of the window from its own
+ * work item, so that the blocks of a window are decompressed in parallel
+ * by the multi decompressors.  The first page of a block is added to the
+ * page cache and read with squashfs_readpage(), which fills in the other
+ * pages of the block as it always does.
+ */
+static struct workqueue_struct *squashfs_read_wq;
+
+struct squashfs_read_work {
+	struct work_struct work;
+	struct page *page;
+};
+
+static void squashfs_read_work_fn(struct work_struct *work)
+{
+	struct squashfs_read_work *rw = container_of(work,
+					struct squashfs_read_work, work);
+
+	squashfs_readpage(NULL, rw->page);
+	page_cache_release(rw->page);
+	kfree(rw);
+}
+
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	pgoff_t last_block = ULONG_MAX;
+
+	/* the list is in descending index order */
+	while (!list_empty(pages)) {
+		struct page *page = list_entry(pages->prev, struct page, lru);
+		struct squashfs_read_work *rw;
+
+		list_del(&page->lru);
+
+		/* read together with the first page of its block */
+		if (page->index >> shift == last_block ||
+		    add_to_page_cache_lru(page, mapping, page->index,
+					  GFP_KERNEL)) {
+			page_cache_release(page);
+			continue;
+		}
+		last_block = page->index >> shift;
+
+		rw = kmalloc(sizeof(*rw), GFP_KERNEL);
+		if (!rw) {
+			squashfs_readpage(file, page);
+			page_cache_release(page);
+			continue;
+		}
+
+		INIT_WORK(&rw->work, squashfs_read_work_fn);
+		rw->page = page;
+		queue_work(squashfs_read_wq, &rw->work);
+	}
+
+	return 0;
+}
+
+int __init squashfs_readpages_init(void)
+{
+	squashfs_read_wq = alloc_workqueue("squashfs_read", WQ_UNBOUND,
+					   num_possible_cpus());
+
+	return squashfs_read_wq ? 0 : -ENOMEM;
+}
+
+void squashfs_readpages_destroy(void)
+{
+	destroy_workqueue(squashfs_read_wq);
+}
+#endif
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_READPAGES
+	.readpages = squashfs_readpages,
+#endif
 };
@@ -69,6 +69,18 @@ extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
 /* file.c */
 void squashfs_copy_cache(struct page *, struct squashfs_cache_entry *, int,
 				int);
+#ifdef CONFIG_SQUASHFS_READPAGES
+extern int squashfs_readpages_init(void);
+extern void squashfs_readpages_destroy(void);
+#else
+static inline int squashfs_readpages_init(void)
+{
+	return 0;
+}
+static inline void squashfs_readpages_destroy(void)
+{
+}
+#endif
 
 /* file_xxx.c */
 extern int squashfs_readpage_block(struct page *, u64, int);
@@ -180,7 +180,8 @@ static int timerfd_setup(struct timerfd_ctx *ctx, int flags,
 			   timerfd_alarmproc);
 	} else {
 		hrtimer_init(&ctx->t.tmr, clockid, htmode);
-		hrtimer_set_expires(&ctx->t.tmr, texp);
+		hrtimer_set_expires_range_ns(&ctx->t.tmr, texp,
+					     hrtimer_current_slack_ns());
 		ctx->t.tmr.function = timerfd_tmrproc;
 	}
 
@@ -191,7 +192,7 @@ static int timerfd_setup(struct timerfd_ctx *ctx, int flags,
 			else
 				alarm_start_relative(&ctx->t.alarm, texp);
 		} else {
-			hrtimer_start(&ctx->t.tmr, texp, htmode);
+			hrtimer_start_expires(&ctx->t.tmr, htmode);
 		}
 
 		if (timerfd_canceled(ctx))
@@ -141,6 +141,15 @@ struct inode *ubifs_new_inode(struct ubifs_info *c, const struct inode *dir,
 		ui->compr_type = c->default_compr;
 	else
 		ui->compr_type = UBIFS_COMPR_NONE;
+	/*
+	 * Files and directories inherit the compressor chosen for the parent
+	 * directory with the "trusted.ubifs.compr" extended attribute, unless
+	 * it was overridden with the "compr" mount option.
+	 */
+	if ((S_ISREG(mode) || S_ISDIR(mode)) && S_ISDIR(dir->i_mode) &&
+	    !c->mount_opts.override_compr &&
+	    ubifs_inode(dir)->compr_type != UBIFS_COMPR_NONE)
+		ui->compr_type = ubifs_inode(dir)->compr_type;
 	ui->synced_i_size = 0;
 
 	spin_lock(&c->cnt_lock);
@@ -53,6 +53,12 @@
  * tnc.c).
  *
  * ACL support is not implemented.
+ *
+ * The "trusted.ubifs.compr" extended attribute is not stored on the media, it
+ * reads and sets the compressor used for new data of a regular file
+ * ("none", "lzo", "zlib" or "lz4"). Set on a directory, it selects the
+ * compressor inherited by the files and directories created in it, and "none"
+ * reverts to the default compressor of the file-system.
  */
 
 #include "ubifs.h"
@@ -67,6 +73,9 @@
  */
 #define MAX_XATTRS_PER_INODE 65535
 
+/* Name of the extended attribute selecting the compressor of an inode */
+#define UBIFS_XATTR_COMPR XATTR_TRUSTED_PREFIX "ubifs.compr"
+
 /*
  * Extended attribute type constants.
  *
@@ -276,6 +285,90 @@ static int check_namespace(const struct qstr *nm)
 	return type;
 }
 
+/**
+ * set_compr - change the compressor of an inode.
+ * @c: UBIFS file-system description object
+ * @host: the inode to change
+ * @value: name of the compressor
+ * @size: length of @value
+ *
+ * This function sets the compressor used for data written to @host from now
+ * on, or inherited by new inodes if @host is a directory. Data already on the
+ * media is not recompressed. Returns zero in case of success and a negative
+ * error code in case of failure.
+ */
+static int set_compr(struct ubifs_info *c, struct inode *host,
+		     const char *value, size_t size)
+{
+	struct ubifs_inode *ui = ubifs_inode(host);
+	struct ubifs_budget_req req = { .dirtied_ino = 1,
+					.dirtied_ino_d = ui->data_len };
+	int compr_type, err, release;
+
+	if (!S_ISREG(host->i_mode) && !S_ISDIR(host->i_mode))
+		return -EINVAL;
+
+	if (size && value[size - 1] == '\0')
+		size -= 1;
+
+	for (compr_type = 0; compr_type < UBIFS_COMPR_TYPES_CNT; compr_type++) {
+		const char *name = ubifs_compr_name(compr_type);
+
+		if (strlen(name) == size && !memcmp(name, value, size))
+			break;
+	}
+	if (compr_type == UBIFS_COMPR_TYPES_CNT)
+		return -EINVAL;
+	if (!ubifs_compr_present(compr_type))
+		return -EOPNOTSUPP;
+
+	err = ubifs_budget_space(c, &req);
+	if (err)
+		return err;
+
+	mutex_lock(&ui->ui_mutex);
+	ui->compr_type = compr_type;
+	host->i_ctime = ubifs_current_time(host);
+	release = ui->dirty;
+	mark_inode_dirty_sync(host);
+	mutex_unlock(&ui->ui_mutex);
+
+	if (release)
+		ubifs_release_budget(c, &req);
+	if (IS_SYNC(host))
+		err = write_inode_now(host, 1);
+	return err;
+}
+
+/**
+ * get_compr - get the compressor of an inode.
+ * @host: the inode to get the compressor of
+ * @buf: buffer to store the name of the compressor in, may be %NULL
+ * @size: size of @buf
+ *
+ * This function returns the length of the compressor name in case of success,
+ * %-ENODATA if no compressor was chosen for directory @host, and a negative
+ * error code in case of failure.
+ */
+static ssize_t get_compr(struct inode *host, void *buf, size_t size)
+{
+	int compr_type = ubifs_inode(host)->compr_type;
+	const char *name = ubifs_compr_name(compr_type);
+	size_t len = strlen(name);
+
+	if (!S_ISREG(host->i_mode) && !S_ISDIR(host->i_mode))
+		return -ENODATA;
+	if (S_ISDIR(host->i_mode) && compr_type == UBIFS_COMPR_NONE)
+		return -ENODATA;
+
+	if (buf) {
+		if (len > size)
+			return -ERANGE;
+		memcpy(buf, name, len);
+	}
+	return len;
+}
+
 static struct inode *iget_xattr(struct ubifs_info *c, ino_t inum)
 {
 	struct inode *inode;
@@ -310,6 +403,9 @@ int ubifs_setxattr(struct dentry *dentry, const char *name,
 	if (size > UBIFS_MAX_INO_DATA)
 		return -ERANGE;
 
+	if (!strcmp(name, UBIFS_XATTR_COMPR))
+		return set_compr(c, host, value, size);
+
 	type = check_namespace(&nm);
 	if (type < 0)
 		return type;
@@ -370,6 +466,9 @@ ssize_t ubifs_getxattr(struct dentry *dentry, const char *name, void *buf,
 	dbg_gen("xattr '%s', ino %lu ('%pd'), buf size %zd", name,
 		host->i_ino, dentry, size);
 
+	if (!strcmp(name, UBIFS_XATTR_COMPR))
+		return get_compr(host, buf, size);
+
 	err = check_namespace(&nm);
 	if (err < 0)
 		return err;
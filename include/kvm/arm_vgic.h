@@ -223,6 +223,7 @@ struct vgic_v2_cpu_if {
 	u64		vgic_elrsr;	/* Saved only */
 	u32		vgic_apr;
 	u32		vgic_lr[VGIC_V2_MAX_LRS];
+	u64		vgic_live_lrs;	/* LRs loaded by the 32bit world switch */
 };
 
 struct vgic_v3_cpu_if {
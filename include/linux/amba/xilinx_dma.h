@@ -14,6 +14,7 @@
 
 #include <linux/dma-mapping.h>
 #include <linux/dmaengine.h>
+#include <linux/ktime.h>
 
 /* DMA IP masks */
 #define XILINX_DMA_IP_DMA	0x00100000	/* A DMA IP */
@@ -34,6 +35,8 @@
  * @delay: Delay counter
  * @reset: Reset Channel
  * @ext_fsync: External Frame Sync source
+ * @park_flip: Keep the submitted frames in the frame stores and switch
+ *	       between them with xilinx_vdma_channel_flip()
  */
 struct xilinx_vdma_config {
 	int frm_dly;
@@ -46,6 +49,24 @@ struct xilinx_vdma_config {
 	int delay;
 	int reset;
 	int ext_fsync;
+	int park_flip;
+};
+
+/**
+ * struct xilinx_vdma_frame_info - Frame completion information
+ * @timestamp: Time of the frame count interrupt that completed the frame
+ * @sequence: Number of frame count interrupts of the channel, this one included
+ * @dropped: Number of frame count interrupts without a descriptor to complete
+ *
+ * The counters run from the channel allocation and are reset when the channel
+ * is terminated. A frame count interrupt without an active descriptor means
+ * the hardware transferred a frame to or from the last frame store again,
+ * which a capture channel sees as a dropped frame.
+ */
+struct xilinx_vdma_frame_info {
+	ktime_t timestamp;
+	u32 sequence;
+	u32 dropped;
 };
 
 /* Device configuration structure for DMA */
@@ -68,5 +89,28 @@ struct xilinx_cdma_config {
 
 int xilinx_vdma_channel_set_config(struct dma_chan *dchan,
 					struct xilinx_vdma_config *cfg);
+int xilinx_vdma_channel_flip(struct dma_chan *dchan, int frm);
+int xilinx_vdma_channel_genlock_pair(struct dma_chan *dmaster,
+				     struct dma_chan *dslave);
+void xilinx_vdma_channel_genlock_unpair(struct dma_chan *dmaster);
+int xilinx_vdma_channel_frame_ptr(struct dma_chan *dchan);
+void xilinx_vdma_tx_frame_info(struct dma_async_tx_descriptor *tx,
+			       struct xilinx_vdma_frame_info *info);
+
+#if IS_ENABLED(CONFIG_XILINX_ZDMA)
+ssize_t zdma_memcpy_striped(struct dma_chan *dchan, dma_addr_t dma_dst,
+			    dma_addr_t dma_src, size_t len,
+			    dma_async_tx_callback callback,
+			    void *callback_param);
+#else
+static inline ssize_t zdma_memcpy_striped(struct dma_chan *dchan,
+					  dma_addr_t dma_dst,
+					  dma_addr_t dma_src, size_t len,
+					  dma_async_tx_callback callback,
+					  void *callback_param)
+{
+	return -ENODEV;
+}
+#endif
 
 #endif
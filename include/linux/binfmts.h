@@ -115,5 +115,7 @@ extern int prepare_bprm_creds(struct linux_binprm *bprm);
 extern void install_exec_creds(struct linux_binprm *bprm);
 extern void set_binfmt(struct linux_binfmt *new);
 extern ssize_t read_code(struct file *, unsigned long, loff_t, size_t);
+extern unsigned int sysctl_exec_prefault_kb;
+extern void prefault_exec_text(unsigned long start, unsigned long end);
 
 #endif /* _LINUX_BINFMTS_H */
@@ -18,6 +18,14 @@ struct blk_mq_ctxmap {
 	struct blk_align_bitmap *map;
 };
 
+/* Time from submission to completion of polled requests */
+struct blk_mq_poll_stat {
+	unsigned long		samples;
+	unsigned long		mean_ns;	/* moving average */
+	unsigned long		min_ns;
+	unsigned long		max_ns;
+};
+
 struct blk_mq_hw_ctx {
 	struct {
 		spinlock_t		lock;
@@ -38,6 +46,7 @@ struct blk_mq_hw_ctx {
 	struct blk_flush_queue	*fq;
 
 	void			*driver_data;
+	void			*sched_data;	/* blk-mq I/O scheduler */
 
 	struct blk_mq_ctxmap	ctx_map;
 
@@ -58,6 +67,11 @@ struct blk_mq_hw_ctx {
 
 	atomic_t		nr_active;
 
+	unsigned long		poll_considered;
+	unsigned long		poll_invoked;
+	unsigned long		poll_success;
+	struct blk_mq_poll_stat	poll_stat;
+
 	struct blk_mq_cpu_notifier	cpu_notifier;
 	struct kobject		kobj;
 };
@@ -91,6 +105,7 @@ typedef void (exit_request_fn)(void *, struct request *, unsigned int,
 
 typedef void (busy_iter_fn)(struct blk_mq_hw_ctx *, struct request *, void *,
 		bool);
+typedef int (poll_fn)(struct blk_mq_hw_ctx *);
 
 struct blk_mq_ops {
 	/*
@@ -110,6 +125,12 @@ struct blk_mq_ops {
 
 	softirq_done_fn		*complete;
 
+	/*
+	 * Called to reap completions without waiting for the interrupt,
+	 * returns the number of requests completed.
+	 */
+	poll_fn			*poll;
+
 	/*
 	 * Called when the block layer side of a hardware queue has been
 	 * set up, allowing the driver to allocate/init matching structures.
@@ -37,6 +37,8 @@ struct sg_io_hdr;
 struct bsg_job;
 struct blkcg_gq;
 struct blk_flush_queue;
+struct rq_wb;
+struct blk_lat_hist;
 
 #define BLKDEV_MIN_RQ	4
 #define BLKDEV_MAX_RQ	128	/* Default maximum */
@@ -209,6 +211,15 @@ struct request {
 
 	/* for bidi */
 	struct request *next_rq;
+
+#ifdef CONFIG_BLK_WBT
+	unsigned int wbt_flags;		/* see block/blk-wbt.h */
+	u64 wbt_issue_ns;
+#endif
+#ifdef CONFIG_BLK_LAT_HIST
+	u64 lat_issue_ns;		/* see block/blk-lat.h */
+	unsigned int lat_bytes;
+#endif
 };
 
 static inline unsigned short req_get_ioprio(struct request *req)
@@ -467,6 +478,15 @@ struct request_queue {
 	int			bypass_depth;
 	int			mq_freeze_depth;
 
+	/*
+	 * Sleep before polling for completion: -1 never, 0 half the mean
+	 * completion time, else that many nanoseconds.
+	 */
+	int			poll_nsec;
+
+	struct rq_wb		*rq_wb;
+	struct blk_lat_hist __percpu *lat_hist;
+
 #if defined(CONFIG_BLK_DEV_BSG)
 	bsg_job_fn		*bsg_job_fn;
 	int			bsg_job_size;
@@ -509,6 +529,8 @@ struct request_queue {
 #define QUEUE_FLAG_INIT_DONE   20	/* queue is initialized */
 #define QUEUE_FLAG_NO_SG_MERGE 21	/* don't attempt to merge SG segments*/
 #define QUEUE_FLAG_SG_GAPS     22	/* queue doesn't support SG gaps */
+#define QUEUE_FLAG_POLL	       23	/* IO polling enabled if set */
+#define QUEUE_FLAG_LAT_HIST    24	/* latency histograms enabled */
 
 #define QUEUE_FLAG_DEFAULT	((1 << QUEUE_FLAG_IO_STAT) |		\
 				 (1 << QUEUE_FLAG_STACKABLE)	|	\
@@ -594,6 +616,9 @@ static inline void queue_flag_clear(unsigned int flag, struct request_queue *q)
 #define blk_queue_stackable(q)	\
 	test_bit(QUEUE_FLAG_STACKABLE, &(q)->queue_flags)
 #define blk_queue_discard(q)	test_bit(QUEUE_FLAG_DISCARD, &(q)->queue_flags)
+#define blk_queue_poll(q)	test_bit(QUEUE_FLAG_POLL, &(q)->queue_flags)
+#define blk_queue_lat_hist(q)	\
+	test_bit(QUEUE_FLAG_LAT_HIST, &(q)->queue_flags)
 #define blk_queue_secdiscard(q)	(blk_queue_discard(q) && \
 	test_bit(QUEUE_FLAG_SECDISCARD, &(q)->queue_flags))
 
@@ -818,6 +843,18 @@ extern int sg_scsi_ioctl(struct request_queue *, struct gendisk *, fmode_t,
 
 extern void blk_queue_bio(struct request_queue *q, struct bio *bio);
 
+/*
+ * State of a task polling for the completion of its I/O, zeroed before
+ * each wait.
+ */
+struct blk_poll_wait {
+	struct blk_mq_hw_ctx *hctx;
+	u64 start_ns;
+	bool slept;
+};
+
+extern bool blk_poll(struct request_queue *q, struct blk_poll_wait *wait);
+
 /*
  * A queue has just exitted congestion.  Note this in the global counter of
  * congested queues, and wake up anyone who was waiting for requests to be
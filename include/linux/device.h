@@ -194,6 +194,27 @@ extern int bus_unregister_notifier(struct bus_type *bus,
 extern struct kset *bus_get_kset(struct bus_type *bus);
 extern struct klist *bus_get_device_klist(struct bus_type *bus);
 
+/**
+ * enum probe_type - device driver probe type to try
+ *
+ * @PROBE_DEFAULT_STRATEGY: Drivers "working well" with either probing
+ *	strategy. They are probed synchronously, unless they are listed
+ *	in the "driver_async_probe=" kernel parameter.
+ * @PROBE_PREFER_ASYNCHRONOUS: Drivers with a slow probe that nothing
+ *	else waits for at boot, e.g. flash or PHY detection. Their devices
+ *	are probed from an async thread, while the initcalls go on.
+ * @PROBE_FORCE_SYNCHRONOUS: Drivers whose devices must be bound when
+ *	the registration returns, e.g. because a later initcall uses them.
+ *
+ * Everything still probing asynchronously is waited for before the root
+ * filesystem is mounted, in wait_for_device_probe().
+ */
+enum probe_type {
+	PROBE_DEFAULT_STRATEGY,
+	PROBE_PREFER_ASYNCHRONOUS,
+	PROBE_FORCE_SYNCHRONOUS,
+};
+
 /**
  * struct device_driver - The basic device driver structure
  * @name:	Name of the device driver.
@@ -201,6 +222,8 @@ extern struct klist *bus_get_device_klist(struct bus_type *bus);
  * @owner:	The module owner.
  * @mod_name:	Used for built-in modules.
  * @suppress_bind_attrs: Disables bind/unbind via sysfs.
+ * @probe_type:	Whether the devices of the driver may be probed
+ *		asynchronously when the driver is registered.
  * @of_match_table: The open firmware table.
  * @acpi_match_table: The ACPI match table.
  * @probe:	Called to query the existence of a specific device,
@@ -234,6 +257,7 @@ struct device_driver {
 	const char		*mod_name;	/* used for built-in modules */
 
 	bool suppress_bind_attrs;	/* disables bind/unbind via sysfs */
+	enum probe_type probe_type;
 
 	const struct of_device_id	*of_match_table;
 	const struct acpi_device_id	*acpi_match_table;
@@ -0,0 +1,20 @@
+#ifndef _LINUX_FILE_RA_STATE_H
+#define _LINUX_FILE_RA_STATE_H
+
+#include <linux/types.h>
+
+/*
+ * Track a single file's readahead state
+ */
+struct file_ra_state {
+	pgoff_t start;			/* where readahead started */
+	unsigned int size;		/* # of readahead pages */
+	unsigned int async_size;	/* do asynchronous readahead when
+					   there are only # of pages ahead */
+
+	unsigned int ra_pages;		/* Maximum readahead window */
+	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
+	loff_t prev_pos;		/* Cache last read() position */
+};
+
+#endif /* _LINUX_FILE_RA_STATE_H */
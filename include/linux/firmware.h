@@ -12,6 +12,8 @@ struct firmware {
 	size_t size;
 	const u8 *data;
 	struct page **pages;
+	/* page cache mapping, see request_firmware_pages() */
+	struct sg_table *sgt;
 
 	/* firmware loader private fields */
 	void *priv;
@@ -19,6 +21,7 @@ struct firmware {
 
 struct module;
 struct device;
+struct sg_table;
 
 struct builtin_fw {
 	char *name;
@@ -47,6 +50,8 @@ int request_firmware_nowait(
 	void (*cont)(const struct firmware *fw, void *context));
 int request_firmware_direct(const struct firmware **fw, const char *name,
 			    struct device *device);
+int request_firmware_pages(const struct firmware **fw, const char *name,
+			   struct device *device);
 
 void release_firmware(const struct firmware *fw);
 #else
@@ -75,5 +80,12 @@ static inline int request_firmware_direct(const struct firmware **fw,
 	return -EINVAL;
 }
 
+static inline int request_firmware_pages(const struct firmware **fw,
+					 const char *name,
+					 struct device *device)
+{
+	return -EINVAL;
+}
+
 #endif
 #endif
@@ -5,6 +5,7 @@
 
 struct inode;
 struct mm_struct;
+struct seq_file;
 struct task_struct;
 union ktime;
 
@@ -55,6 +56,9 @@ union futex_key {
 #ifdef CONFIG_FUTEX
 extern void exit_robust_list(struct task_struct *curr);
 extern void exit_pi_state_list(struct task_struct *curr);
+extern void futex_mm_prepare(struct mm_struct *mm);
+extern void futex_mm_free(struct mm_struct *mm);
+extern void futex_hash_show(struct seq_file *m, struct mm_struct *mm);
 #ifdef CONFIG_HAVE_FUTEX_CMPXCHG
 #define futex_cmpxchg_enabled 1
 #else
@@ -67,5 +71,11 @@ static inline void exit_robust_list(struct task_struct *curr)
 static inline void exit_pi_state_list(struct task_struct *curr)
 {
 }
+static inline void futex_mm_prepare(struct mm_struct *mm)
+{
+}
+static inline void futex_mm_free(struct mm_struct *mm)
+{
+}
 #endif
 #endif
@@ -423,6 +423,9 @@ static inline u64 hrtimer_forward_now(struct hrtimer *timer,
 	return hrtimer_forward(timer, timer->base->get_time(), interval);
 }
 
+/* Slack of timers armed on behalf of current: */
+extern unsigned long hrtimer_current_slack_ns(void);
+
 /* Precise sleep: */
 extern long hrtimer_nanosleep(struct timespec *rqtp,
 			      struct timespec __user *rmtp,
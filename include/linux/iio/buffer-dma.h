@@ -0,0 +1,150 @@
+/* The industrial I/O - DMA based buffer support
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+#ifndef __INDUSTRIALIO_DMA_BUFFER_H__
+#define __INDUSTRIALIO_DMA_BUFFER_H__
+
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+#include <linux/iio/buffer.h>
+
+struct iio_dma_buffer_queue;
+struct iio_dma_buffer_ops;
+struct device;
+
+/**
+ * enum iio_block_state - State of a struct iio_dma_buffer_block
+ * @IIO_BLOCK_STATE_DEQUEUED: Block is owned by userspace or not queued yet
+ * @IIO_BLOCK_STATE_QUEUED: Block is waiting in the incoming queue
+ * @IIO_BLOCK_STATE_ACTIVE: Block is being filled by the DMA controller
+ * @IIO_BLOCK_STATE_DONE: Block is waiting in the outgoing queue
+ */
+enum iio_block_state {
+	IIO_BLOCK_STATE_DEQUEUED,
+	IIO_BLOCK_STATE_QUEUED,
+	IIO_BLOCK_STATE_ACTIVE,
+	IIO_BLOCK_STATE_DONE,
+};
+
+/**
+ * struct iio_dma_buffer_block - IIO buffer block
+ * @head: List head, owned by the DMA driver while the block is active and by
+ *	the queue otherwise
+ * @bytes_used: Number of bytes that contain valid data
+ * @vaddr: Virtual address of the blocks memory
+ * @phys_addr: Physical address of the blocks memory
+ * @size: Total size of the block in bytes
+ * @queue: Parent DMA buffer queue
+ * @id: Identifier of the block for userspace
+ * @offset: mmap() offset of the block
+ * @timestamp: Time at which the block was completed
+ * @kref: Reference count, userspace mappings keep the block alive
+ * @state: Current state of the block, protected by the queue list_lock
+ *
+ * Everything but @head, @bytes_used and @timestamp is set at allocation and
+ * constant thereafter.
+ */
+struct iio_dma_buffer_block {
+	struct list_head head;
+	size_t bytes_used;
+
+	void *vaddr;
+	dma_addr_t phys_addr;
+	size_t size;
+	struct iio_dma_buffer_queue *queue;
+	unsigned int id;
+	u32 offset;
+	s64 timestamp;
+
+	struct kref kref;
+	enum iio_block_state state;
+};
+
+/**
+ * struct iio_dma_buffer_queue - DMA buffer base structure
+ * @buffer: IIO buffer base structure
+ * @dev: Parent device, used for the DMA memory allocations
+ * @ops: DMA buffer callbacks
+ * @lock: Protects the blocks array, the file I/O state and @active
+ * @list_lock: Protects the @incoming and @outgoing lists and the block states
+ * @incoming: Blocks waiting to be submitted to the DMA controller
+ * @outgoing: Completed blocks waiting to be dequeued
+ * @active: Whether the buffer is currently enabled
+ * @blocks: Allocated blocks, indexed by their identifier
+ * @num_blocks: Number of allocated blocks
+ * @fileio: Whether the blocks are managed by the queue to implement read()
+ * @fileio_pos: Read position in the first block of @outgoing
+ */
+struct iio_dma_buffer_queue {
+	struct iio_buffer buffer;
+	struct device *dev;
+	const struct iio_dma_buffer_ops *ops;
+
+	struct mutex lock;
+	spinlock_t list_lock;
+	struct list_head incoming;
+	struct list_head outgoing;
+
+	bool active;
+
+	struct iio_dma_buffer_block **blocks;
+	unsigned int num_blocks;
+	bool fileio;
+	size_t fileio_pos;
+};
+
+/**
+ * struct iio_dma_buffer_ops - DMA buffer callback operations
+ * @submit: Called to hand a block over to the DMA controller. Once the
+ *	transfer has completed iio_dma_buffer_block_done() must be called
+ * @abort: Called to stop all pending transfers. Blocks handed over to the DMA
+ *	controller must be returned with iio_dma_buffer_block_list_abort()
+ */
+struct iio_dma_buffer_ops {
+	int (*submit)(struct iio_dma_buffer_queue *queue,
+		struct iio_dma_buffer_block *block);
+	void (*abort)(struct iio_dma_buffer_queue *queue);
+};
+
+void iio_dma_buffer_block_done(struct iio_dma_buffer_block *block);
+void iio_dma_buffer_block_list_abort(struct iio_dma_buffer_queue *queue,
+	struct list_head *list);
+
+int iio_dma_buffer_enable(struct iio_buffer *buffer,
+	struct iio_dev *indio_dev);
+int iio_dma_buffer_disable(struct iio_buffer *buffer,
+	struct iio_dev *indio_dev);
+int iio_dma_buffer_read(struct iio_buffer *buffer, size_t n,
+	char __user *user_buffer);
+bool iio_dma_buffer_data_available(struct iio_buffer *buffer);
+int iio_dma_buffer_get_bytes_per_datum(struct iio_buffer *buffer);
+int iio_dma_buffer_set_bytes_per_datum(struct iio_buffer *buffer, size_t bpd);
+int iio_dma_buffer_get_length(struct iio_buffer *buffer);
+int iio_dma_buffer_set_length(struct iio_buffer *buffer, int length);
+int iio_dma_buffer_request_update(struct iio_buffer *buffer);
+
+int iio_dma_buffer_alloc_blocks(struct iio_buffer *buffer,
+	struct iio_buffer_block_alloc_req *req);
+int iio_dma_buffer_free_blocks(struct iio_buffer *buffer);
+int iio_dma_buffer_query_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block);
+int iio_dma_buffer_enqueue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block);
+int iio_dma_buffer_dequeue_block(struct iio_buffer *buffer,
+	struct iio_buffer_block *block);
+int iio_dma_buffer_mmap(struct iio_buffer *buffer,
+	struct vm_area_struct *vma);
+
+int iio_dma_buffer_init(struct iio_dma_buffer_queue *queue,
+	struct device *dma_dev, const struct iio_dma_buffer_ops *ops);
+void iio_dma_buffer_exit(struct iio_dma_buffer_queue *queue);
+void iio_dma_buffer_release(struct iio_dma_buffer_queue *queue);
+
+#endif
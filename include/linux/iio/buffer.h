@@ -9,13 +9,67 @@
 
 #ifndef _IIO_BUFFER_GENERIC_H_
 #define _IIO_BUFFER_GENERIC_H_
+#include <linux/ioctl.h>
+#include <linux/types.h>
 #include <linux/sysfs.h>
 #include <linux/iio/iio.h>
 #include <linux/kref.h>
 
+/**
+ * struct iio_buffer_block_alloc_req - Request to allocate buffer blocks
+ * @type:	type of the blocks, must be 0
+ * @size:	size of each block in bytes
+ * @count:	number of blocks to allocate, updated with the number of blocks
+ *		that could be allocated
+ * @id:		identifier of the first allocated block, the others follow
+ */
+struct iio_buffer_block_alloc_req {
+	__u32 type;
+	__u32 size;
+	__u32 count;
+	__u32 id;
+};
+
+/* The timestamp of the block is valid */
+#define IIO_BUFFER_BLOCK_FLAG_TIMESTAMP_VALID	(1 << 0)
+
+/**
+ * struct iio_buffer_block - Userspace description of a buffer block
+ * @id:		identifier of the block
+ * @size:	total size of the block in bytes
+ * @bytes_used:	number of bytes of the block that hold sample data
+ * @type:	type of the block, must be 0
+ * @flags:	IIO_BUFFER_BLOCK_FLAG_* flags
+ * @data.offset: mmap() offset of the block data
+ * @timestamp:	time at which the block was completed
+ */
+struct iio_buffer_block {
+	__u32 id;
+	__u32 size;
+	__u32 bytes_used;
+	__u32 type;
+	__u32 flags;
+	union {
+		__u32 offset;
+	} data;
+	__s64 timestamp;
+};
+
+#define IIO_BUFFER_BLOCK_ALLOC_IOCTL \
+	_IOWR('i', 0xa0, struct iio_buffer_block_alloc_req)
+#define IIO_BUFFER_BLOCK_FREE_IOCTL \
+	_IO('i', 0xa1)
+#define IIO_BUFFER_BLOCK_QUERY_IOCTL \
+	_IOWR('i', 0xa2, struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_ENQUEUE_IOCTL \
+	_IOWR('i', 0xa3, struct iio_buffer_block)
+#define IIO_BUFFER_BLOCK_DEQUEUE_IOCTL \
+	_IOWR('i', 0xa4, struct iio_buffer_block)
+
 #ifdef CONFIG_IIO_BUFFER
 
 struct iio_buffer;
+struct vm_area_struct;
 
 /**
  * struct iio_buffer_access_funcs - access functions for buffers.
@@ -31,6 +85,18 @@ struct iio_buffer;
  * @set_length:		set number of datums in buffer
  * @release:		called when the last reference to the buffer is dropped,
  *			should free all resources allocated by the buffer.
+ * @enable:		called when the buffer is enabled, after the scan mode
+ *			has been set up and before the postenable callback.
+ * @disable:		called when the buffer is disabled, after the predisable
+ *			callback.
+ * @alloc_blocks:	allocate blocks that userspace can mmap, replacing the
+ *			current ones. Only called while the buffer is disabled.
+ * @free_blocks:	free the blocks. Only called while the buffer is
+ *			disabled.
+ * @query_block:	fill in the description of the block with the given id.
+ * @enqueue_block:	hand a block over to the buffer to be filled.
+ * @dequeue_block:	take the oldest filled block back, -EAGAIN if none.
+ * @mmap:		map the data of a block to userspace.
  *
  * The purpose of this structure is to make the buffer element
  * modular as event for a given driver, different usecases may require
@@ -55,6 +121,20 @@ struct iio_buffer_access_funcs {
 	int (*set_length)(struct iio_buffer *buffer, int length);
 
 	void (*release)(struct iio_buffer *buffer);
+
+	int (*enable)(struct iio_buffer *buffer, struct iio_dev *indio_dev);
+	int (*disable)(struct iio_buffer *buffer, struct iio_dev *indio_dev);
+
+	int (*alloc_blocks)(struct iio_buffer *buffer,
+			    struct iio_buffer_block_alloc_req *req);
+	int (*free_blocks)(struct iio_buffer *buffer);
+	int (*query_block)(struct iio_buffer *buffer,
+			   struct iio_buffer_block *block);
+	int (*enqueue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*dequeue_block)(struct iio_buffer *buffer,
+			     struct iio_buffer_block *block);
+	int (*mmap)(struct iio_buffer *buffer, struct vm_area_struct *vma);
 };
 
 /**
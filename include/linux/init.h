@@ -153,6 +153,12 @@ void prepare_namespace(void);
 void __init load_default_modules(void);
 int __init init_rootfs(void);
 
+#ifdef CONFIG_BLK_DEV_INITRD
+extern void wait_for_initramfs(void);
+#else
+static inline void wait_for_initramfs(void) { }
+#endif
+
 extern void (*late_time_init)(void);
 
 extern bool initcall_debug;
@@ -101,6 +101,7 @@ typedef irqreturn_t (*irq_handler_t)(int, void *);
  * @thread_flags:	flags related to @thread
  * @thread_mask:	bitmask for keeping track of @thread activity
  * @dir:	pointer to the proc/irq/NN/name entry
+ * @wake_ns:	last wakeup of @thread, for the latency histograms
  */
 struct irqaction {
 	irq_handler_t		handler;
@@ -115,6 +116,9 @@ struct irqaction {
 	unsigned long		thread_mask;
 	const char		*name;
 	struct proc_dir_entry	*dir;
+#ifdef CONFIG_IRQ_LATENCY_HIST
+	u64			wake_ns;
+#endif
 } ____cacheline_internodealigned_in_smp;
 
 extern irqreturn_t no_action(int cpl, void *dev_id);
@@ -189,6 +193,7 @@ extern void disable_percpu_irq(unsigned int irq);
 extern void enable_irq(unsigned int irq);
 extern void enable_percpu_irq(unsigned int irq, unsigned int type);
 extern void irq_wake_thread(unsigned int irq, void *dev_id);
+extern int irq_set_thread_priority(unsigned int irq, unsigned int prio);
 
 /* The following three functions are for the core kernel use only. */
 extern void suspend_device_irqs(void);
@@ -13,6 +13,7 @@ struct proc_dir_entry;
 struct module;
 struct irq_desc;
 struct irq_domain;
+struct irq_latency_hist;
 struct pt_regs;
 
 /**
@@ -31,6 +32,7 @@ struct pt_regs;
  * @irqs_unhandled:	stats field for spurious unhandled interrupts
  * @threads_handled:	stats field for deferred spurious detection of threaded handlers
  * @threads_handled_last: comparator field for deferred spurious detection of theraded handlers
+ * @thread_prio:	SCHED_FIFO priority of the irq threads, 0 for the default
  * @lock:		locking for SMP
  * @affinity_hint:	hint to user space for preferred irq affinity
  * @affinity_notify:	context for notification of affinity changes
@@ -44,6 +46,7 @@ struct pt_regs;
  * @force_resume_depth:	number of irqactions on a irq descriptor with
  *			IRQF_FORCE_RESUME set
  * @dir:		/proc/irq/ procfs entry
+ * @latency_hist:	hardirq and irq thread latency histograms
  * @name:		flow handler name for /proc/interrupts output
  */
 struct irq_desc {
@@ -63,6 +66,7 @@ struct irq_desc {
 	unsigned int		irqs_unhandled;
 	atomic_t		threads_handled;
 	int			threads_handled_last;
+	unsigned int		thread_prio;
 	raw_spinlock_t		lock;
 	struct cpumask		*percpu_enabled;
 #ifdef CONFIG_SMP
@@ -82,6 +86,9 @@ struct irq_desc {
 #endif
 #ifdef CONFIG_PROC_FS
 	struct proc_dir_entry	*dir;
+#endif
+#ifdef CONFIG_IRQ_LATENCY_HIST
+	struct irq_latency_hist	*latency_hist;
 #endif
 	int			parent_irq;
 	struct module		*owner;
@@ -706,6 +706,7 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  * @j_wait_updates: Wait queue to wait for updates to complete
  * @j_wait_reserved: Wait queue to wait for reserved buffer credits to drop
  * @j_checkpoint_mutex: Mutex for locking against concurrent checkpoints
+ * @j_checkpoint_work: Background checkpoint, queued when the log runs low
  * @j_head: Journal head - identifies the first unused block in the journal
  * @j_tail: Journal tail - identifies the oldest still-used block in the
  *  journal.
@@ -830,6 +831,13 @@ struct journal_s
 	 * j_checkpoint_mutex.  [j_checkpoint_mutex]
 	 */
 	struct buffer_head	*j_chkpt_bhs[JBD2_NR_BATCH];
+
+	/*
+	 * Checkpoints old transactions from a workqueue once the free
+	 * log space runs low, ahead of the handles that would otherwise
+	 * have to wait for it.
+	 */
+	struct work_struct	j_checkpoint_work;
 	
 	/*
 	 * Journal head: identifies the first unused block in the journal.
@@ -1007,6 +1015,7 @@ struct journal_s
 #define JBD2_ABORT_ON_SYNCDATA_ERR	0x040	/* Abort the journal on file
 						 * data write error in ordered
 						 * mode */
+#define JBD2_NO_BG_CHECKPOINT	0x080	/* No more background checkpoints */
 
 /*
  * Function declarations for the journaling transaction and buffer
@@ -1245,6 +1254,8 @@ int jbd2_journal_start_commit(journal_t *journal, tid_t *tid);
 int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
 int jbd2_complete_transaction(journal_t *journal, tid_t tid);
 int jbd2_log_do_checkpoint(journal_t *journal);
+void jbd2_log_start_checkpoint(journal_t *journal);
+void jbd2_checkpoint_work(struct work_struct *work);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
 
 void __jbd2_log_wait_for_space(journal_t *journal);
@@ -1350,6 +1361,16 @@ static inline unsigned long jbd2_log_space_left(journal_t *journal)
 	return free;
 }
 
+/*
+ * Return true once less than twice the space needed for a new transaction
+ * is free, when checkpointing starts in the background.  Must be called
+ * under j_state_lock.
+ */
+static inline int jbd2_log_space_low(journal_t *journal)
+{
+	return jbd2_log_space_left(journal) < 2 * jbd2_space_needed(journal);
+}
+
 /*
  * Definitions which augment the buffer_head layer
  */
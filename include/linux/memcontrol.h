@@ -75,6 +75,14 @@ bool task_in_mem_cgroup(struct task_struct *task,
 
 extern struct mem_cgroup *try_get_mem_cgroup_from_page(struct page *page);
 extern struct mem_cgroup *mem_cgroup_from_task(struct task_struct *p);
+extern struct mem_cgroup *mem_cgroup_page_memcg(struct page *page);
+
+/* memcg ids are stored in the page cache shadow entries, see workingset.c */
+#define MEM_CGROUP_ID_SHIFT	16
+extern unsigned short mem_cgroup_id(struct mem_cgroup *memcg);
+extern struct mem_cgroup *mem_cgroup_from_id(unsigned short id);
+void mem_cgroup_count_workingset(struct mem_cgroup *memcg,
+				 enum zone_stat_item idx);
 
 extern struct mem_cgroup *parent_mem_cgroup(struct mem_cgroup *memcg);
 extern struct mem_cgroup *mem_cgroup_from_css(struct cgroup_subsys_state *css);
@@ -226,6 +234,28 @@ static inline struct lruvec *mem_cgroup_page_lruvec(struct page *page,
 	return &zone->lruvec;
 }
 
+#define MEM_CGROUP_ID_SHIFT	0
+
+static inline struct mem_cgroup *mem_cgroup_page_memcg(struct page *page)
+{
+	return NULL;
+}
+
+static inline unsigned short mem_cgroup_id(struct mem_cgroup *memcg)
+{
+	return 0;
+}
+
+static inline struct mem_cgroup *mem_cgroup_from_id(unsigned short id)
+{
+	return NULL;
+}
+
+static inline void mem_cgroup_count_workingset(struct mem_cgroup *memcg,
+					       enum zone_stat_item idx)
+{
+}
+
 static inline struct mem_cgroup *try_get_mem_cgroup_from_page(struct page *page)
 {
 	return NULL;
@@ -347,6 +377,16 @@ void mem_cgroup_count_vm_event(struct mm_struct *mm, enum vm_event_item idx)
 }
 #endif /* CONFIG_MEMCG */
 
+struct memstall;
+#if defined(CONFIG_MEMCG) && defined(CONFIG_MEMSTALL)
+void mem_cgroup_memstall(struct memstall *ms, bool enter, u64 now);
+#else
+static inline void mem_cgroup_memstall(struct memstall *ms, bool enter,
+				       u64 now)
+{
+}
+#endif
+
 #if !defined(CONFIG_MEMCG) || !defined(CONFIG_DEBUG_VM)
 static inline bool
 mem_cgroup_bad_page_check(struct page *page)
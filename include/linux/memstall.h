@@ -0,0 +1,50 @@
+#ifndef _LINUX_MEMSTALL_H
+#define _LINUX_MEMSTALL_H
+
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/types.h>
+
+struct seq_file;
+struct mem_cgroup;
+
+/*
+ * Stall time of the tasks of a group, see mm/memstall.c.
+ * @nr_stalled: tasks currently stalled
+ * @start: when nr_stalled last became non-zero
+ * @total: ns during which at least one task was stalled, up to @start
+ * @avg_total: @total at the last update of @avg
+ * @avg_next: time of the next update of @avg
+ * @avg: percentage of time stalled over 10s, 60s and 300s, fixed point
+ */
+struct memstall_group {
+	spinlock_t lock;
+	unsigned int nr_stalled;
+	u64 start;
+	u64 total;
+	u64 avg_total;
+	u64 avg_next;
+	unsigned long avg[3];
+};
+
+/* state saved by memstall_enter() for memstall_leave() */
+struct memstall {
+	unsigned long flags;
+#ifdef CONFIG_MEMCG
+	struct mem_cgroup *memcg;
+#endif
+};
+
+#ifdef CONFIG_MEMSTALL
+extern void memstall_enter(struct memstall *ms);
+extern void memstall_leave(struct memstall *ms);
+
+extern void memstall_group_init(struct memstall_group *grp);
+extern void memstall_group_change(struct memstall_group *grp, bool enter,
+				  u64 now);
+extern int memstall_show(struct seq_file *m, struct memstall_group *grp);
+#else
+static inline void memstall_enter(struct memstall *ms) {}
+static inline void memstall_leave(struct memstall *ms) {}
+#endif /* CONFIG_MEMSTALL */
+#endif /* _LINUX_MEMSTALL_H */
@@ -189,6 +189,8 @@ extern struct static_key rps_needed;
 struct neighbour;
 struct neigh_parms;
 struct sk_buff;
+struct sock_filter;
+struct bpf_prog;
 
 struct netdev_hw_addr {
 	struct list_head	list;
@@ -1191,6 +1193,7 @@ struct net_device_ops {
  * @IFF_LIVE_ADDR_CHANGE: device supports hardware address
  *	change when it's running
  * @IFF_MACVLAN: Macvlan device
+ * @IFF_RX_EARLY_FILTER: driver runs the early RX filter on received frames
  */
 enum netdev_priv_flags {
 	IFF_802_1Q_VLAN			= 1<<0,
@@ -1216,6 +1219,7 @@ enum netdev_priv_flags {
 	IFF_LIVE_ADDR_CHANGE		= 1<<20,
 	IFF_MACVLAN			= 1<<21,
 	IFF_XMIT_DST_RELEASE_PERM	= 1<<22,
+	IFF_RX_EARLY_FILTER		= 1<<23,
 };
 
 #define IFF_802_1Q_VLAN			IFF_802_1Q_VLAN
@@ -1241,6 +1245,7 @@ enum netdev_priv_flags {
 #define IFF_LIVE_ADDR_CHANGE		IFF_LIVE_ADDR_CHANGE
 #define IFF_MACVLAN			IFF_MACVLAN
 #define IFF_XMIT_DST_RELEASE_PERM	IFF_XMIT_DST_RELEASE_PERM
+#define IFF_RX_EARLY_FILTER		IFF_RX_EARLY_FILTER
 
 /**
  *	struct net_device - The DEVICE structure.
@@ -1371,6 +1376,8 @@ enum netdev_priv_flags {
  *
  *	@rx_handler:		handler for received packets
  *	@rx_handler_data: 	XXX: need comments on this one
+ *	@rx_early_filter:	BPF filter the driver runs on received frames
+ *				before building an skb
  *	@ingress_queue:		XXX: need comments on this one
  *	@broadcast:		hw bcast address
  *
@@ -1592,6 +1599,7 @@ struct net_device {
 
 	rx_handler_func_t __rcu	*rx_handler;
 	void __rcu		*rx_handler_data;
+	struct bpf_prog __rcu	*rx_early_filter;
 
 	struct netdev_queue __rcu *ingress_queue;
 	unsigned char		broadcast[MAX_ADDR_LEN];
@@ -1902,6 +1910,9 @@ struct napi_gro_cb {
 	/* Used in foo-over-udp, set in udp[46]_gro_receive */
 	u8	is_ipv6:1;
 
+	/* Datagrams merged for a socket, set in udp4_gro_receive */
+	u8	udp_gro:1;
+
 	/* used to support CHECKSUM_COMPLETE for tunneling protocols */
 	__wsum	csum;
 
@@ -2848,6 +2859,31 @@ int netdev_rx_handler_register(struct net_device *dev,
 			       void *rx_handler_data);
 void netdev_rx_handler_unregister(struct net_device *dev);
 
+int dev_set_rx_early_filter(struct net_device *dev, struct sock_filter *insns,
+			    unsigned int len);
+bool __netif_rx_early_drop(struct net_device *dev, void *data,
+			   unsigned int len);
+
+/**
+ *	netif_rx_early_drop - run the early RX filter on a received frame
+ *	@dev: device the frame was received on
+ *	@data: start of the Ethernet frame in the receive buffer
+ *	@len: length of the frame
+ *
+ *	Drivers setting %IFF_RX_EARLY_FILTER call this from their NAPI poll
+ *	routine once the frame is visible to the CPU, before allocating an
+ *	skb for it. Frames the filter rejects must be dropped and their
+ *	buffer given back to the hardware. Returns true if the frame has to
+ *	be dropped.
+ */
+static inline bool netif_rx_early_drop(struct net_device *dev, void *data,
+				       unsigned int len)
+{
+	if (likely(!rcu_access_pointer(dev->rx_early_filter)))
+		return false;
+	return __netif_rx_early_drop(dev, data, len);
+}
+
 bool dev_valid_name(const char *name);
 int dev_ioctl(struct net *net, unsigned int cmd, void __user *);
 int dev_ethtool(struct net *net, struct ifreq *);
@@ -3570,6 +3606,7 @@ static inline bool net_gso_ok(netdev_features_t features, int gso_type)
 	BUILD_BUG_ON(SKB_GSO_UDP_TUNNEL != (NETIF_F_GSO_UDP_TUNNEL >> NETIF_F_GSO_SHIFT));
 	BUILD_BUG_ON(SKB_GSO_UDP_TUNNEL_CSUM != (NETIF_F_GSO_UDP_TUNNEL_CSUM >> NETIF_F_GSO_SHIFT));
 	BUILD_BUG_ON(SKB_GSO_MPLS    != (NETIF_F_GSO_MPLS >> NETIF_F_GSO_SHIFT));
+	BUILD_BUG_ON(SKB_GSO_UDP_L4  != (NETIF_F_GSO_UDP_L4 >> NETIF_F_GSO_SHIFT));
 
 	return (features & feature) == feature;
 }
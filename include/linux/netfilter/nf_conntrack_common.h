@@ -20,6 +20,8 @@ struct ip_conntrack_stat {
 	unsigned int expect_create;
 	unsigned int expect_delete;
 	unsigned int search_restart;
+	unsigned int gc_scanned;
+	unsigned int gc_expired;
 };
 
 /* call to create an explicit dependency on nf_conntrack. */
@@ -55,6 +55,8 @@ static inline void netpoll_poll_enable(struct net_device *dev) { return; }
 #endif
 
 void netpoll_send_udp(struct netpoll *np, const char *msg, int len);
+struct sk_buff *netpoll_alloc_udp(struct netpoll *np, const char *msg,
+				  int len, gfp_t gfp);
 void netpoll_print_options(struct netpoll *np);
 int netpoll_parse_options(struct netpoll *np, char *opt);
 int __netpoll_setup(struct netpoll *np, struct net_device *ndev);
@@ -115,6 +115,8 @@ enum nfs_stat_eventcounters {
 	NFSIOS_DELAY,
 	NFSIOS_PNFS_READ,
 	NFSIOS_PNFS_WRITE,
+	NFSIOS_READDIRPLUS_CACHED,
+	NFSIOS_READDIRPLUS_FALLBACK,
 	__NFSIOS_COUNTSMAX,
 };
 
@@ -0,0 +1,23 @@
+/*
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#ifndef __PLATFORM_DATA_CPUIDLE_ZYNQ_H__
+#define __PLATFORM_DATA_CPUIDLE_ZYNQ_H__
+
+/**
+ * struct zynq_cpuidle_platform_data - Zynq cpuidle platform data
+ * @self_refresh:	Wait for interrupt with DDR in self-refresh. Called with
+ *			interrupts disabled by the last CPU going idle, returns
+ *			0 on success or a negative error code if DDR
+ *			self-refresh is not available.
+ */
+struct zynq_cpuidle_platform_data {
+	int (*self_refresh)(void);
+};
+
+#endif /* __PLATFORM_DATA_CPUIDLE_ZYNQ_H__ */
@@ -93,6 +93,20 @@ enum rpmsg_ns_flags {
 	RPMSG_NS_DESTROY	= 1,
 };
 
+/**
+ * struct rpmsg_shm_desc - reference to a buffer in shared memory
+ * @da: address of the buffer as seen by the remote processor
+ * @len: length of the buffer (in bytes)
+ *
+ * Payloads too large for an rpmsg buffer are passed by reference, as a
+ * message carrying one or more of these descriptors.
+ * See rpmsg_alloc_shm() and rpmsg_shm_da_to_va().
+ */
+struct rpmsg_shm_desc {
+	u32 da;
+	u32 len;
+} __packed;
+
 #define RPMSG_ADDR_ANY		0xFFFFFFFF
 
 struct virtproc_info;
@@ -176,6 +190,11 @@ struct rpmsg_endpoint *rpmsg_create_ept(struct rpmsg_channel *,
 				rpmsg_rx_cb_t cb, void *priv, u32 addr);
 int
 rpmsg_send_offchannel_raw(struct rpmsg_channel *, u32, u32, void *, int, bool);
+void *rpmsg_alloc_shm(struct rpmsg_channel *rpdev, size_t size,
+		      dma_addr_t *da);
+void rpmsg_free_shm(struct rpmsg_channel *rpdev, size_t size, void *va,
+		    dma_addr_t da);
+void *rpmsg_shm_da_to_va(struct rpmsg_channel *rpdev, u32 da, u32 len);
 
 /**
  * rpmsg_send() - send a message across to the remote processor
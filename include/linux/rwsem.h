@@ -35,6 +35,11 @@ struct rw_semaphore {
 	 * if the owner is running on the cpu.
 	 */
 	struct task_struct *owner;
+	/*
+	 * Set by a queued writer that waited too long, to stop spinners
+	 * from stealing the lock from it.
+	 */
+	bool handoff;
 #endif
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	struct lockdep_map	dep_map;
@@ -1028,6 +1028,23 @@ extern struct sched_domain_topology_level *sched_domain_topology;
 extern void set_sched_topology(struct sched_domain_topology_level *tl);
 extern void wake_up_if_idle(int cpu);
 
+/*
+ * Energy model of a cpu: the power it draws while busy at each of its
+ * capacity states, ordered by increasing capacity. The capacity of the
+ * last state matches the capacity the cpu reports to the scheduler.
+ */
+struct sched_capacity_state {
+	unsigned long cap;	/* compute capacity */
+	unsigned long power;	/* power consumption at this capacity */
+};
+
+struct sched_energy {
+	int nr_cap_states;
+	struct sched_capacity_state *cap_states;
+};
+
+extern const struct sched_energy *arch_sched_energy(int cpu);
+
 #ifdef CONFIG_SCHED_DEBUG
 # define SD_INIT_NAME(type)		.name = #type
 #else
@@ -1052,6 +1069,23 @@ static inline bool cpus_share_cache(int this_cpu, int that_cpu)
 #endif	/* !CONFIG_SMP */
 
 
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Utilization reports from the scheduler to cpufreq governors, util and
+ * max are in capacity units. A util above max asks for the highest
+ * frequency.
+ */
+struct update_util_data {
+	void (*func)(struct update_util_data *data, u64 time,
+		     unsigned long util, unsigned long max);
+};
+
+void cpufreq_add_update_util_hook(int cpu, struct update_util_data *data,
+			void (*func)(struct update_util_data *data, u64 time,
+				     unsigned long util, unsigned long max));
+void cpufreq_remove_update_util_hook(int cpu);
+#endif /* CONFIG_CPU_FREQ */
+
 struct io_context;			/* See blkdev.h */
 
 
@@ -1206,8 +1240,11 @@ struct sched_dl_entity {
 	 *
 	 * @dl_yielded tells if task gave up the cpu before consuming
 	 * all its available runtime during the last job.
+	 *
+	 * @dl_active tells if our bandwidth is accounted in the running
+	 * bandwidth of our rq, i.e. if we are runnable, throttled or not.
 	 */
-	int dl_throttled, dl_new, dl_boosted, dl_yielded;
+	int dl_throttled, dl_new, dl_boosted, dl_yielded, dl_active;
 
 	/*
 	 * Bandwidth enforcement timer. Each -deadline task has its
@@ -1232,6 +1269,39 @@ enum perf_event_task_context {
 	perf_nr_task_contexts,
 };
 
+/*
+ * Wake queues collect tasks to wake up while a lock is held, so that
+ * the wakeups can be issued after the lock has been dropped:
+ *
+ *	WAKE_Q(wake_q);
+ *
+ *	spin_lock(&lock);
+ *	wake_q_add(&wake_q, task);
+ *	spin_unlock(&lock);
+ *	wake_up_q(&wake_q);
+ *
+ * A task is queued at most once; adding a task that is already on a
+ * wake queue relies on the wakeup of that queue. The queue holds a
+ * reference to each task until it is woken, so the waiter may go away
+ * once it observes the condition it waited for.
+ */
+struct wake_q_node {
+	struct wake_q_node *next;
+};
+
+struct wake_q_head {
+	struct wake_q_node *first;
+	struct wake_q_node **lastp;
+};
+
+#define WAKE_Q_TAIL ((struct wake_q_node *) 0x01)
+
+#define WAKE_Q(name)					\
+	struct wake_q_head name = { WAKE_Q_TAIL, &name.first }
+
+extern void wake_q_add(struct wake_q_head *head, struct task_struct *task);
+extern void wake_up_q(struct wake_q_head *head);
+
 struct task_struct {
 	volatile long state;	/* -1 unrunnable, 0 runnable, >0 stopped */
 	void *stack;
@@ -1448,6 +1518,8 @@ struct task_struct {
 	/* Protection of the PI data structures: */
 	raw_spinlock_t pi_lock;
 
+	struct wake_q_node wake_q;
+
 #ifdef CONFIG_RT_MUTEXES
 	/* PI waiters blocked on a rt_mutex held by this task */
 	struct rb_root pi_waiters;
@@ -1920,6 +1992,7 @@ extern void thread_group_cputime_adjusted(struct task_struct *p, cputime_t *ut,
 #define PF_KTHREAD	0x00200000	/* I am a kernel thread */
 #define PF_RANDOMIZE	0x00400000	/* randomize virtual address space */
 #define PF_SWAPWRITE	0x00800000	/* Allowed to write to swap */
+#define PF_MEMSTALL	0x01000000	/* Stalled due to lack of memory */
 #define PF_NO_SETAFFINITY 0x04000000	/* Userland is not allowed to meddle with cpus_allowed */
 #define PF_MCE_EARLY    0x08000000      /* Early kill for mce process policy */
 #define PF_MUTEX_TESTER	0x20000000	/* Thread belongs to the rt mutex tester */
@@ -708,7 +708,8 @@ static inline void security_free_mnt_opts(struct security_mnt_opts *opts)
  *	the firmware to load. This argument will be NULL if the firmware
  *	was loaded via the uevent-triggered blob-based interface exposed
  *	by CONFIG_FW_LOADER_USER_HELPER.
- *	@buf pointer to buffer containing firmware contents.
+ *	@buf pointer to buffer containing firmware contents, NULL if the
+ *	firmware is handed out from the page cache of @file.
  *	@size length of the firmware contents.
  *	Return 0 if permission is granted.
  * @kernel_module_request:
@@ -34,6 +34,7 @@ struct shmem_sb_info {
 	kuid_t uid;		    /* Mount uid for root directory */
 	kgid_t gid;		    /* Mount gid for root directory */
 	umode_t mode;		    /* Mount mode for root directory */
+	bool huge;		    /* Place mappings for huge pages */
 	struct mempolicy *mpol;     /* default memory policy for mappings */
 };
 
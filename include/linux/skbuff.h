@@ -146,6 +146,7 @@
 			 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
 
 struct net_device;
+struct napi_struct;
 struct scatterlist;
 struct pipe_inode_info;
 
@@ -287,11 +288,32 @@ enum {
  * false on data copy or out of memory error caused by data copy attempt.
  * The ctx field is used to track device context.
  * The desc field is used to track userspace buffer index.
+ *
+ * Buffers of MSG_ZEROCOPY sends use sock_zerocopy_callback() instead and
+ * are reference counted, as TCP can share one between several skbs. The
+ * id and len fields then describe the range of sends the notification on
+ * the socket error queue covers.
  */
 struct ubuf_info {
 	void (*callback)(struct ubuf_info *, bool zerocopy_success);
-	void *ctx;
-	unsigned long desc;
+	union {
+		struct {
+			unsigned long desc;
+			void *ctx;
+		};
+		struct {
+			u32 id;
+			u16 len;
+			u16 zerocopy:1;
+			u32 bytelen;
+		};
+	};
+	atomic_t refcnt;
+
+	struct mmpin {
+		struct user_struct *user;
+		unsigned int num_pg;
+	} mmp;
 };
 
 /* This data is invariant across clones and lives at
@@ -372,12 +394,22 @@ enum {
 
 	SKB_GSO_MPLS = 1 << 12,
 
+	SKB_GSO_UDP_L4 = 1 << 13,
+
 };
 
 #if BITS_PER_LONG > 32
 #define NET_SKBUFF_DATA_USES_OFFSET 1
 #endif
 
+/* receive path stages stamped in skb->rx_stage, as SCM_TSTAMP_STAGE_* */
+enum {
+	SKB_RX_STAGE_DRIVER,
+	SKB_RX_STAGE_STACK,
+	SKB_RX_STAGE_ENQUEUE,
+	SKB_RX_STAGES,
+};
+
 #ifdef NET_SKBUFF_DATA_USES_OFFSET
 typedef unsigned int sk_buff_data_t;
 #else
@@ -434,6 +466,21 @@ static inline u32 skb_mstamp_us_delta(const struct skb_mstamp *t1,
 	return delta_us;
 }
 
+/**
+ * skb_mstamp_after - check whether a skb_mstamp is later than another one
+ * @t1: pointer to the sample checked
+ * @t0: pointer to the sample compared against
+ */
+static inline bool skb_mstamp_after(const struct skb_mstamp *t1,
+				    const struct skb_mstamp *t0)
+{
+	s32 diff = t1->stamp_jiffies - t0->stamp_jiffies;
+
+	if (!diff)
+		diff = t1->stamp_us - t0->stamp_us;
+	return diff > 0;
+}
+
 
 /** 
  *	struct sk_buff - socket buffer
@@ -495,6 +542,7 @@ static inline u32 skb_mstamp_us_delta(const struct skb_mstamp *t1,
  *	@transport_header: Transport layer header
  *	@network_header: Network layer header
  *	@mac_header: Link layer header
+ *	@rx_stage: Receive path stage timestamps, see SOF_TIMESTAMPING_RX_STAGES
  *	@tail: Tail pointer
  *	@end: End pointer
  *	@head: Head of buffer
@@ -644,6 +692,10 @@ struct sk_buff {
 	__u16			network_header;
 	__u16			mac_header;
 
+#ifdef CONFIG_NET_RX_STAGE_TSTAMP
+	ktime_t			rx_stage[SKB_RX_STAGES];
+#endif
+
 	/* private: */
 	__u32			headers_end[0];
 	/* public: */
@@ -763,6 +815,7 @@ void kfree_skb(struct sk_buff *skb);
 void kfree_skb_list(struct sk_buff *segs);
 void skb_tx_error(struct sk_buff *skb);
 void consume_skb(struct sk_buff *skb);
+void napi_consume_skb(struct sk_buff *skb, int budget);
 void  __kfree_skb(struct sk_buff *skb);
 extern struct kmem_cache *skbuff_head_cache;
 
@@ -773,6 +826,7 @@ bool skb_try_coalesce(struct sk_buff *to, struct sk_buff *from,
 struct sk_buff *__alloc_skb(unsigned int size, gfp_t priority, int flags,
 			    int node);
 struct sk_buff *build_skb(void *data, unsigned int frag_size);
+struct sk_buff *napi_build_skb(void *data, unsigned int frag_size);
 static inline struct sk_buff *alloc_skb(unsigned int size,
 					gfp_t priority)
 {
@@ -975,6 +1029,55 @@ static inline unsigned int skb_end_offset(const struct sk_buff *skb)
 
 /* Internal */
 #define skb_shinfo(SKB)	((struct skb_shared_info *)(skb_end_pointer(SKB)))
+#define skb_uarg(SKB)	((struct ubuf_info *)(skb_shinfo(SKB)->destructor_arg))
+
+struct ubuf_info *sock_zerocopy_alloc(struct sock *sk, size_t size);
+struct ubuf_info *sock_zerocopy_realloc(struct sock *sk, size_t size,
+					struct ubuf_info *uarg);
+void sock_zerocopy_callback(struct ubuf_info *uarg, bool success);
+void sock_zerocopy_put(struct ubuf_info *uarg);
+void sock_zerocopy_put_abort(struct ubuf_info *uarg);
+int skb_zerocopy_from_user(struct sock *sk, struct sk_buff *skb,
+			   const void __user *from, int len,
+			   struct ubuf_info *uarg);
+
+static inline void sock_zerocopy_get(struct ubuf_info *uarg)
+{
+	atomic_inc(&uarg->refcnt);
+}
+
+/* Return the zerocopy buffer info of @skb, if its frags are user pages */
+static inline struct ubuf_info *skb_zcopy(struct sk_buff *skb)
+{
+	bool is_zcopy = skb && skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY;
+
+	return is_zcopy ? skb_uarg(skb) : NULL;
+}
+
+static inline void skb_zcopy_set(struct sk_buff *skb, struct ubuf_info *uarg)
+{
+	if (skb && uarg && !skb_zcopy(skb)) {
+		sock_zerocopy_get(uarg);
+		skb_shinfo(skb)->destructor_arg = uarg;
+		skb_shinfo(skb)->tx_flags |= SKBTX_DEV_ZEROCOPY;
+	}
+}
+
+/* Release the reference of @skb on its zerocopy buffer info */
+static inline void skb_zcopy_clear(struct sk_buff *skb, bool zerocopy)
+{
+	struct ubuf_info *uarg = skb_zcopy(skb);
+
+	if (uarg) {
+		if (uarg->callback == sock_zerocopy_callback) {
+			uarg->zerocopy = uarg->zerocopy && zerocopy;
+			sock_zerocopy_put(uarg);
+		} else if (uarg->callback) {
+			uarg->callback(uarg, zerocopy);
+		}
+		skb_shinfo(skb)->tx_flags &= ~SKBTX_DEV_ZEROCOPY;
+	}
+}
 
 static inline struct skb_shared_hwtstamps *skb_hwtstamps(struct sk_buff *skb)
 {
@@ -2094,10 +2197,32 @@ static inline void skb_orphan(struct sk_buff *skb)
  *	For each frag in the SKB which needs a destructor (i.e. has an
  *	owner) create a copy of that frag and release the original
  *	page by calling the destructor.
+ *
+ *	The pages of MSG_ZEROCOPY sends hold their own references and are
+ *	left alone, they only delay the completion notification.
  */
 static inline int skb_orphan_frags(struct sk_buff *skb, gfp_t gfp_mask)
 {
-	if (likely(!(skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY)))
+	struct ubuf_info *uarg = skb_zcopy(skb);
+
+	if (likely(!uarg))
+		return 0;
+	if (uarg->callback == sock_zerocopy_callback)
+		return 0;
+	return skb_copy_ubufs(skb, gfp_mask);
+}
+
+/**
+ *	skb_orphan_frags_rx - orphan the frags of a buffer looping to rx
+ *	@skb: buffer to orphan frags from
+ *	@gfp_mask: allocation mask for replacement pages
+ *
+ *	Like skb_orphan_frags(), but also copies the pages of MSG_ZEROCOPY
+ *	sends, as a local receiver may hold on to them indefinitely.
+ */
+static inline int skb_orphan_frags_rx(struct sk_buff *skb, gfp_t gfp_mask)
+{
+	if (likely(!skb_zcopy(skb)))
 		return 0;
 	return skb_copy_ubufs(skb, gfp_mask);
 }
@@ -2176,6 +2301,25 @@ static inline struct sk_buff *netdev_alloc_skb_ip_align(struct net_device *dev,
 	return __netdev_alloc_skb_ip_align(dev, length, GFP_ATOMIC);
 }
 
+void *napi_alloc_frag(unsigned int fragsz);
+struct sk_buff *__napi_alloc_skb(struct napi_struct *napi,
+				 unsigned int length, gfp_t gfp_mask);
+
+/**
+ *	napi_alloc_skb - allocate an skbuff for rx in a NAPI poll routine
+ *	@napi: NAPI instance the buffer is received on
+ *	@length: length to allocate
+ *
+ *	Like netdev_alloc_skb_ip_align(), but the sk_buff comes from a per
+ *	cpu cache that is refilled and drained in bulk, so it must only be
+ *	called from the poll routine of @napi.
+ */
+static inline struct sk_buff *napi_alloc_skb(struct napi_struct *napi,
+					     unsigned int length)
+{
+	return __napi_alloc_skb(napi, length, GFP_ATOMIC);
+}
+
 /**
  *	__skb_alloc_pages - allocate pages for ps-rx on a skb and preserve pfmemalloc data
  *	@gfp_mask: alloc_pages_node mask. Set __GFP_NOMEMALLOC if not for network packet RX
@@ -2772,6 +2916,22 @@ static inline void __net_timestamp(struct sk_buff *skb)
 	skb->tstamp = ktime_get_real();
 }
 
+/* the first time an skb passes a receive path stage */
+static inline void skb_rx_stage_stamp(struct sk_buff *skb, unsigned int stage)
+{
+#ifdef CONFIG_NET_RX_STAGE_TSTAMP
+	if (!skb->rx_stage[stage].tv64)
+		skb->rx_stage[stage] = ktime_get_real();
+#endif
+}
+
+static inline void skb_rx_stage_clear(struct sk_buff *skb)
+{
+#ifdef CONFIG_NET_RX_STAGE_TSTAMP
+	memset(skb->rx_stage, 0, sizeof(skb->rx_stage));
+#endif
+}
+
 static inline ktime_t net_timedelta(ktime_t t)
 {
 	return ktime_sub(ktime_get_real(), t);
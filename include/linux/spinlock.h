@@ -146,6 +146,20 @@ do {								\
  */
 #define raw_spin_unlock_wait(lock)	arch_spin_unlock_wait(&(lock)->raw_lock)
 
+enum {
+	LOCK_CONTENTION_SPIN,
+	LOCK_CONTENTION_READ,
+	LOCK_CONTENTION_WRITE,
+	LOCK_CONTENTION_NR,
+};
+
+#ifdef CONFIG_LOCK_CONTENTION_STATS
+/* only called when the lock was not free, never on the fast path */
+extern void lock_contention_inc(int type);
+#else
+static inline void lock_contention_inc(int type) { }
+#endif
+
 #ifdef CONFIG_DEBUG_SPINLOCK
  extern void do_raw_spin_lock(raw_spinlock_t *lock) __acquires(lock);
 #define do_raw_spin_lock_flags(lock, flags) do_raw_spin_lock(lock)
@@ -155,6 +169,11 @@ do {								\
 static inline void do_raw_spin_lock(raw_spinlock_t *lock) __acquires(lock)
 {
 	__acquire(lock);
+#ifdef CONFIG_LOCK_CONTENTION_STATS
+	if (arch_spin_trylock(&lock->raw_lock))
+		return;
+	lock_contention_inc(LOCK_CONTENTION_SPIN);
+#endif
 	arch_spin_lock(&lock->raw_lock);
 }
 
@@ -162,6 +181,11 @@ static inline void
 do_raw_spin_lock_flags(raw_spinlock_t *lock, unsigned long *flags) __acquires(lock)
 {
 	__acquire(lock);
+#ifdef CONFIG_LOCK_CONTENTION_STATS
+	if (arch_spin_trylock(&lock->raw_lock))
+		return;
+	lock_contention_inc(LOCK_CONTENTION_SPIN);
+#endif
 	arch_spin_lock_flags(&lock->raw_lock, *flags);
 }
 
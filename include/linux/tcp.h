@@ -196,6 +196,8 @@ struct tcp_sock {
 	u32	mdev_max_us;	/* maximal mdev for the last rtt period	*/
 	u32	rttvar_us;	/* smoothed mdev_max			*/
 	u32	rtt_seq;	/* sequence number to update rttvar	*/
+	u32	rtt_min_us;	/* minimum RTT over TCP_MIN_RTT_WIN	*/
+	u32	rtt_min_stamp;	/* tcp_time_stamp of rtt_min_us		*/
 
 	u32	packets_out;	/* Packets which are "in flight"	*/
 	u32	retrans_out;	/* Retransmitted packets out		*/
@@ -226,6 +228,19 @@ struct tcp_sock {
 	u32	prr_delivered;	/* Number of newly delivered packets to
 				 * receiver in Recovery. */
 	u32	prr_out;	/* Total number of pkts sent during Recovery. */
+	u32	delivered;	/* Total data packets delivered incl. rexmits */
+	u32	first_tx_us;	/* stamp_us of the start of the send phase */
+	u32	delivered_us;	/* stamp_us of the last delivery	*/
+	u32	rate_delivered;	/* delivered of the last rate sample	*/
+	u32	rate_interval_us; /* interval of the last rate sample	*/
+
+	struct tcp_rack {
+		struct skb_mstamp mstamp; /* (re)sent time of the last skb
+					   * delivered */
+		u32	rtt_us;		/* RTT measured for that skb */
+		u8	advanced;	/* mstamp moved since the last scan */
+		u8	reord;		/* reordering seen on the path */
+	} rack;
 
  	u32	rcv_wnd;	/* Current receiver window		*/
 	u32	write_seq;	/* Tail(+1) of data held in tcp send buffer */
@@ -214,6 +214,26 @@ static inline void housekeeping_affine(struct task_struct *t)
 #endif
 }
 
+static inline const struct cpumask *housekeeping_cpumask(void)
+{
+#ifdef CONFIG_NO_HZ_FULL
+	if (tick_nohz_full_enabled())
+		return housekeeping_mask;
+#endif
+	return cpu_all_mask;
+}
+
+/* an online housekeeping cpu, the current one if it is one */
+static inline int housekeeping_any_cpu(void)
+{
+	int cpu = raw_smp_processor_id();
+
+	if (is_housekeeping_cpu(cpu))
+		return cpu;
+
+	return cpumask_any_and(housekeeping_cpumask(), cpu_online_mask);
+}
+
 static inline void tick_nohz_full_check(void)
 {
 	if (tick_nohz_full_enabled())
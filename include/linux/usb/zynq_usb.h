@@ -52,6 +52,12 @@ struct zynq_usb2_platform_data {
 	int		irq;
 	struct clk	*clk;
 	struct regulator *vbus;
+	/* host throughput tuning, negative or zero keeps the default */
+	int		itc;		/* interrupt threshold, microframes */
+	int		async_park;	/* async schedule park count, 1 - 3 */
+	u32		rx_burst;	/* AHB RX burst length, 32-bit words */
+	u32		tx_burst;	/* AHB TX burst length, 32-bit words */
+	u32		tx_fifo_thres;	/* TX FIFO fill threshold, bursts */
 	unsigned	big_endian_mmio:1;
 	unsigned	big_endian_desc:1;
 	unsigned	es:1;		/* need USBMODE:ES */
@@ -103,6 +103,10 @@ struct work_struct {
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map lockdep_map;
 #endif
+#ifdef CONFIG_WQ_STATS
+	u64 queued_ns;		/* when it was last queued */
+	int queued_cpu;		/* and from which CPU */
+#endif
 };
 
 #define WORK_DATA_INIT()	ATOMIC_LONG_INIT(WORK_STRUCT_NO_POOL)
@@ -122,14 +126,16 @@ struct delayed_work {
  * A struct for workqueue attributes.  This can be used to change
  * attributes of an unbound workqueue.
  *
- * Unlike other fields, ->no_numa isn't a property of a worker_pool.  It
- * only modifies how apply_workqueue_attrs() select pools and thus doesn't
- * participate in pool hash calculations or equality comparisons.
+ * Unlike other fields, ->no_numa and ->cache_local aren't properties of a
+ * worker_pool.  They only modify how apply_workqueue_attrs() select pools
+ * and thus don't participate in pool hash calculations or equality
+ * comparisons.
  */
 struct workqueue_attrs {
 	int			nice;		/* nice level */
 	cpumask_var_t		cpumask;	/* allowed CPUs */
 	bool			no_numa;	/* disable NUMA affinity */
+	bool			cache_local;	/* cache domain affinity */
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
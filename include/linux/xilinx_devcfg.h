@@ -0,0 +1,49 @@
+/*
+ * Xilinx Zynq Device Config driver, in-kernel interface
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+#ifndef _LINUX_XILINX_DEVCFG_H
+#define _LINUX_XILINX_DEVCFG_H
+
+#include <linux/err.h>
+
+/*
+ * A preloaded bitstream is read through the firmware loader once, stripped
+ * of its header, byte swapped if needed and kept DMA mapped, so that
+ * programming it later only runs the PCAP DMA. Images must be freed before
+ * the devcfg device goes away.
+ */
+
+/* Do not reset the PL and keep the level shifters up while programming */
+#define XDEVCFG_IMAGE_PARTIAL		0x00000001
+
+struct xdevcfg_image;
+
+#if IS_ENABLED(CONFIG_XILINX_DEVCFG)
+struct xdevcfg_image *xdevcfg_image_load(const char *name,
+					 unsigned int flags);
+int xdevcfg_image_program(struct xdevcfg_image *image);
+void xdevcfg_image_free(struct xdevcfg_image *image);
+#else
+static inline struct xdevcfg_image *xdevcfg_image_load(const char *name,
+						       unsigned int flags)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline int xdevcfg_image_program(struct xdevcfg_image *image)
+{
+	return -ENODEV;
+}
+
+static inline void xdevcfg_image_free(struct xdevcfg_image *image)
+{
+}
+#endif
+
+#endif /* _LINUX_XILINX_DEVCFG_H */
@@ -61,6 +61,7 @@ struct ipcm_cookie {
 	__u8			ttl;
 	__s16			tos;
 	char			priority;
+	__u16			gso_size;	/* only used by ip_make_skb() */
 };
 
 #define IPCB(skb) ((struct inet_skb_parm*)((skb)->cb))
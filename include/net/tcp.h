@@ -138,6 +138,9 @@ void tcp_time_wait(struct sock *sk, int state, int timeo);
 						 * most likely due to retrans in 3WHS.
 						 */
 
+#define TCP_TIMEOUT_MIN	(2U)	/* Min timeout for TCP timers in jiffies */
+#define TCP_MIN_RTT_WIN	((unsigned)(300*HZ))	/* window of tp->rtt_min_us */
+
 #define TCP_RESOURCE_PROBE_INTERVAL ((unsigned)(HZ/2U)) /* Maximal interval between probes
 					                 * for local resources.
 					                 */
@@ -271,6 +274,7 @@ extern int sysctl_tcp_slow_start_after_idle;
 extern int sysctl_tcp_thin_linear_timeouts;
 extern int sysctl_tcp_thin_dupack;
 extern int sysctl_tcp_early_retrans;
+extern int sysctl_tcp_recovery;
 extern int sysctl_tcp_limit_output_bytes;
 extern int sysctl_tcp_challenge_ack_limit;
 extern unsigned int sysctl_tcp_notsent_lowat;
@@ -361,6 +365,8 @@ void tcp_wfree(struct sk_buff *skb);
 void tcp_write_timer_handler(struct sock *sk);
 void tcp_delack_timer_handler(struct sock *sk);
 int tcp_ioctl(struct sock *sk, int cmd, unsigned long arg);
+int tcp_mmap(struct file *file, struct socket *sock,
+	     struct vm_area_struct *vma);
 int tcp_rcv_state_process(struct sock *sk, struct sk_buff *skb,
 			  const struct tcphdr *th, unsigned int len);
 void tcp_rcv_established(struct sock *sk, struct sk_buff *skb,
@@ -537,6 +543,7 @@ bool tcp_schedule_loss_probe(struct sock *sk);
 
 /* tcp_input.c */
 void tcp_resume_early_retransmit(struct sock *sk);
+void tcp_rack_reo_timeout(struct sock *sk);
 void tcp_rearm_rto(struct sock *sk);
 void tcp_reset(struct sock *sk);
 
@@ -720,11 +727,23 @@ struct tcp_skb_cb {
 	/* 1 byte hole */
 	__u32		ack_seq;	/* Sequence number ACK'd	*/
 	union {
-		struct inet_skb_parm	h4;
+		struct {
+			/* tp->delivered when the skb was sent */
+			__u32	delivered;
+			/* stamp_us of the start of the send phase */
+			__u32	first_tx_us;
+			/* stamp_us of the last delivery when sent, 0 once
+			 * the skb has been taken into a rate sample
+			 */
+			__u32	delivered_us;
+		} tx;		/* For outgoing frames		*/
+		union {
+			struct inet_skb_parm	h4;
 #if IS_ENABLED(CONFIG_IPV6)
-		struct inet6_skb_parm	h6;
+			struct inet6_skb_parm	h6;
 #endif
-	} header;	/* For incoming frames		*/
+		} header;	/* For incoming frames		*/
+	};
 };
 
 #define TCP_SKB_CB(__skb)	((struct tcp_skb_cb *)&((__skb)->cb[0]))
@@ -795,6 +814,16 @@ enum tcp_ca_ack_event_flags {
 /* Requires ECN/ECT set on all packets */
 #define TCP_CONG_NEEDS_ECN	0x2
 
+/* A delivery rate sample, generated for every ack by tcp_rate_gen() */
+struct rate_sample {
+	u32	prior_us;	/* stamp_us at the start of the interval */
+	u32	prior_delivered; /* tp->delivered at prior_us */
+	s32	delivered;	/* packets delivered over the interval */
+	s32	interval_us;	/* length of the interval, -1 if invalid */
+	u32	acked_sacked;	/* packets newly (s)acked by this ack */
+	bool	is_retrans;	/* sample taken from a retransmission */
+};
+
 struct tcp_congestion_ops {
 	struct list_head	list;
 	unsigned long flags;
@@ -806,7 +835,7 @@ struct tcp_congestion_ops {
 
 	/* return slow start threshold (required) */
 	u32 (*ssthresh)(struct sock *sk);
-	/* do new cwnd calculation (required) */
+	/* do new cwnd calculation (required unless cong_control is set) */
 	void (*cong_avoid)(struct sock *sk, u32 ack, u32 acked);
 	/* call before changing ca_state (optional) */
 	void (*set_state)(struct sock *sk, u8 new_state);
@@ -820,6 +849,10 @@ struct tcp_congestion_ops {
 	void (*pkts_acked)(struct sock *sk, u32 num_acked, s32 rtt_us);
 	/* get info for inet_diag (optional) */
 	void (*get_info)(struct sock *sk, u32 ext, struct sk_buff *skb);
+	/* set cwnd and pacing rate after each ack, replaces cong_avoid
+	 * and the default pacing rate (optional)
+	 */
+	void (*cong_control)(struct sock *sk, const struct rate_sample *rs);
 
 	char 		name[TCP_CA_NAME_MAX];
 	struct module 	*owner;
@@ -844,6 +877,12 @@ u32 tcp_reno_ssthresh(struct sock *sk);
 void tcp_reno_cong_avoid(struct sock *sk, u32 ack, u32 acked);
 extern struct tcp_congestion_ops tcp_reno;
 
+/* tcp_rate.c */
+void tcp_rate_skb_sent(struct sock *sk, struct sk_buff *skb);
+void tcp_rate_skb_delivered(struct sock *sk, struct sk_buff *skb,
+			    struct rate_sample *rs);
+void tcp_rate_gen(struct sock *sk, u32 delivered, struct rate_sample *rs);
+
 static inline bool tcp_ca_needs_ecn(const struct sock *sk)
 {
 	const struct inet_connection_sock *icsk = inet_csk(sk);
@@ -891,6 +930,20 @@ static inline bool tcp_is_fack(const struct tcp_sock *tp)
 	return tp->rx_opt.sack_ok & TCP_FACK_ENABLED;
 }
 
+/* tcp_is_rack - time based loss detection (RACK) replaces dupack counting */
+#define TCP_RACK_LOSS_DETECTION	0x1
+
+static inline bool tcp_is_rack(const struct tcp_sock *tp)
+{
+	return (sysctl_tcp_recovery & TCP_RACK_LOSS_DETECTION) &&
+	       tcp_is_sack(tp);
+}
+
+static inline u32 tcp_min_rtt(const struct tcp_sock *tp)
+{
+	return tp->rtt_min_us;
+}
+
 static inline void tcp_enable_fack(struct tcp_sock *tp)
 {
 	tp->rx_opt.sack_ok |= TCP_FACK_ENABLED;
@@ -903,7 +956,8 @@ static inline void tcp_enable_early_retrans(struct tcp_sock *tp)
 {
 	tp->do_early_retrans = sysctl_tcp_early_retrans &&
 		sysctl_tcp_early_retrans < 4 && !sysctl_tcp_thin_dupack &&
-		sysctl_tcp_reordering == 3;
+		sysctl_tcp_reordering == 3 &&
+		!(sysctl_tcp_recovery & TCP_RACK_LOSS_DETECTION);
 }
 
 static inline void tcp_disable_early_retrans(struct tcp_sock *tp)
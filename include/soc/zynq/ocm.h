@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2013 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __SOC_ZYNQ_OCM_H__
+#define __SOC_ZYNQ_OCM_H__
+
+#include <linux/types.h>
+
+/*
+ * Allocations from the on-chip memory. The memory is mapped uncached and
+ * is coherent with DMA masters, the returned DMA address is the physical
+ * address of the allocation.
+ */
+#ifdef CONFIG_ARCH_ZYNQ
+void *zynq_ocm_alloc(size_t size, dma_addr_t *dma);
+void zynq_ocm_free(void *vaddr, size_t size);
+#else
+static inline void *zynq_ocm_alloc(size_t size, dma_addr_t *dma)
+{
+	return NULL;
+}
+
+static inline void zynq_ocm_free(void *vaddr, size_t size)
+{
+}
+#endif
+
+#endif /* __SOC_ZYNQ_OCM_H__ */
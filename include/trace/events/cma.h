@@ -0,0 +1,97 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cma
+
+#if !defined(_TRACE_CMA_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CMA_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(cma_alloc,
+
+	TP_PROTO(unsigned long pfn, const struct page *page,
+		 unsigned int count, unsigned int align,
+		 unsigned int tries, u64 elapsed_ns),
+
+	TP_ARGS(pfn, page, count, align, tries, elapsed_ns),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, pfn)
+		__field(const struct page *, page)
+		__field(unsigned int, count)
+		__field(unsigned int, align)
+		__field(unsigned int, tries)
+		__field(u64, elapsed_ns)
+	),
+
+	TP_fast_assign(
+		__entry->pfn = pfn;
+		__entry->page = page;
+		__entry->count = count;
+		__entry->align = align;
+		__entry->tries = tries;
+		__entry->elapsed_ns = elapsed_ns;
+	),
+
+	TP_printk("pfn=%lx page=%p count=%u align=%u tries=%u elapsed_ns=%llu",
+		  __entry->pfn,
+		  __entry->page,
+		  __entry->count,
+		  __entry->align,
+		  __entry->tries,
+		  __entry->elapsed_ns)
+);
+
+TRACE_EVENT(cma_alloc_busy_retry,
+
+	TP_PROTO(unsigned long pfn, unsigned int count, unsigned long busy),
+
+	TP_ARGS(pfn, count, busy),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, pfn)
+		__field(unsigned int, count)
+		__field(unsigned long, busy)
+	),
+
+	TP_fast_assign(
+		__entry->pfn = pfn;
+		__entry->count = count;
+		__entry->busy = busy;
+	),
+
+	TP_printk("pfn=%lx count=%u busy=%lu",
+		  __entry->pfn,
+		  __entry->count,
+		  __entry->busy)
+);
+
+TRACE_EVENT(cma_release,
+
+	TP_PROTO(unsigned long pfn, const struct page *page,
+		 unsigned int count),
+
+	TP_ARGS(pfn, page, count),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, pfn)
+		__field(const struct page *, page)
+		__field(unsigned int, count)
+	),
+
+	TP_fast_assign(
+		__entry->pfn = pfn;
+		__entry->page = page;
+		__entry->count = count;
+	),
+
+	TP_printk("pfn=%lx page=%p count=%u",
+		  __entry->pfn,
+		  __entry->page,
+		  __entry->count)
+);
+
+#endif /* _TRACE_CMA_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
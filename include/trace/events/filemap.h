@@ -52,6 +52,50 @@ DEFINE_EVENT(mm_filemap_op_page_cache, mm_filemap_add_to_page_cache,
 	TP_ARGS(page)
 	);
 
+/*
+ * A readahead decision at offset: a hit of the PG_readahead marker of an
+ * earlier window, or a miss of a page that was not cached. The window
+ * submitted is reported as 0 pages for a random read done without one.
+ */
+TRACE_EVENT(mm_filemap_readahead,
+
+	TP_PROTO(struct address_space *mapping, pgoff_t offset,
+		 struct file_ra_state *ra, bool hit),
+
+	TP_ARGS(mapping, offset, ra, hit),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, i_ino)
+		__field(dev_t, s_dev)
+		__field(pgoff_t, offset)
+		__field(pgoff_t, start)
+		__field(unsigned int, size)
+		__field(unsigned int, async_size)
+		__field(bool, hit)
+	),
+
+	TP_fast_assign(
+		__entry->i_ino = mapping->host->i_ino;
+		if (mapping->host->i_sb)
+			__entry->s_dev = mapping->host->i_sb->s_dev;
+		else
+			__entry->s_dev = mapping->host->i_rdev;
+		__entry->offset = offset;
+		__entry->start = ra ? ra->start : offset;
+		__entry->size = ra ? ra->size : 0;
+		__entry->async_size = ra ? ra->async_size : 0;
+		__entry->hit = hit;
+	),
+
+	TP_printk("dev %d:%d ino %lx %s ofs=%lu start=%lu size=%u async_size=%u",
+		MAJOR(__entry->s_dev), MINOR(__entry->s_dev),
+		__entry->i_ino,
+		__entry->hit ? "hit" : "miss",
+		__entry->offset << PAGE_SHIFT,
+		__entry->start << PAGE_SHIFT,
+		__entry->size, __entry->async_size)
+);
+
 #endif /* _TRACE_FILEMAP_H */
 
 /* This part must be outside protection */
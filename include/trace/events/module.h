@@ -46,6 +46,28 @@ TRACE_EVENT(module_load,
 	TP_printk("%s %s", __get_str(name), show_module_flags(__entry->taints))
 );
 
+TRACE_EVENT(module_load_time,
+
+	TP_PROTO(struct module *mod, u64 load_ns, u64 init_ns),
+
+	TP_ARGS(mod, load_ns, init_ns),
+
+	TP_STRUCT__entry(
+		__field(	u64,		load_ns		)
+		__field(	u64,		init_ns		)
+		__string(	name,		mod->name	)
+	),
+
+	TP_fast_assign(
+		__entry->load_ns = load_ns;
+		__entry->init_ns = init_ns;
+		__assign_str(name, mod->name);
+	),
+
+	TP_printk("%s load=%llu ns init=%llu ns", __get_str(name),
+		  __entry->load_ns, __entry->init_ns)
+);
+
 TRACE_EVENT(module_free,
 
 	TP_PROTO(struct module *mod),
@@ -550,6 +550,59 @@ TRACE_EVENT(sched_wake_idle_without_ipi,
 
 	TP_printk("cpu=%d", __entry->cpu)
 );
+
+/*
+ * Tracepoint for energy aware wakeup placement.
+ */
+TRACE_EVENT(sched_energy_wake_cpu,
+
+	TP_PROTO(struct task_struct *p, int prev_cpu, int cpu,
+		 unsigned long util, long delta),
+
+	TP_ARGS(p, prev_cpu, cpu, util, delta),
+
+	TP_STRUCT__entry(
+		__array(	char,	comm,	TASK_COMM_LEN	)
+		__field(	pid_t,	pid			)
+		__field(	int,	prev_cpu		)
+		__field(	int,	cpu			)
+		__field(	unsigned long,	util		)
+		__field(	long,	delta			)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, p->comm, TASK_COMM_LEN);
+		__entry->pid		= p->pid;
+		__entry->prev_cpu	= prev_cpu;
+		__entry->cpu		= cpu;
+		__entry->util		= util;
+		__entry->delta		= delta;
+	),
+
+	TP_printk("comm=%s pid=%d prev_cpu=%d cpu=%d util=%lu energy_delta=%ld",
+		  __entry->comm, __entry->pid, __entry->prev_cpu,
+		  __entry->cpu, __entry->util, __entry->delta)
+);
+
+/*
+ * Tracepoint for a root domain crossing the utilization tipping point.
+ */
+TRACE_EVENT(sched_overutilized,
+
+	TP_PROTO(bool overutilized),
+
+	TP_ARGS(overutilized),
+
+	TP_STRUCT__entry(
+		__field(	bool,	overutilized	)
+	),
+
+	TP_fast_assign(
+		__entry->overutilized	= overutilized;
+	),
+
+	TP_printk("overutilized=%d", __entry->overutilized)
+);
 #endif /* _TRACE_SCHED_H */
 
 /* This part must be outside protection */
@@ -0,0 +1,48 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM splice
+
+#if !defined(_TRACE_SPLICE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_SPLICE_H
+
+#include <linux/fs.h>
+#include <linux/kdev_t.h>
+#include <linux/tracepoint.h>
+
+/*
+ * A splice from a pipe: the bytes that were handed to the target by page
+ * reference (sockets, O_DIRECT files) and the ones that were copied.
+ */
+TRACE_EVENT(splice_from_pipe,
+
+	TP_PROTO(struct file *out, loff_t pos, size_t moved, size_t copied),
+
+	TP_ARGS(out, pos, moved, copied),
+
+	TP_STRUCT__entry(
+		__field(dev_t, s_dev)
+		__field(unsigned long, i_ino)
+		__field(loff_t, pos)
+		__field(size_t, moved)
+		__field(size_t, copied)
+	),
+
+	TP_fast_assign(
+		struct inode *inode = file_inode(out);
+
+		__entry->s_dev = inode->i_sb->s_dev;
+		__entry->i_ino = inode->i_ino;
+		__entry->pos = pos;
+		__entry->moved = moved;
+		__entry->copied = copied;
+	),
+
+	TP_printk("dev %d:%d ino %lx pos=%lld moved=%zu copied=%zu",
+		MAJOR(__entry->s_dev), MINOR(__entry->s_dev),
+		__entry->i_ino, __entry->pos,
+		__entry->moved, __entry->copied)
+);
+
+#endif /* _TRACE_SPLICE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,57 @@
+/*
+ * Xilinx DRM KMS user space interface
+ *
+ *  Copyright (C) 2015 Xilinx, Inc.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _UAPI_XILINX_DRM_H_
+#define _UAPI_XILINX_DRM_H_
+
+#include <drm/drm.h>
+
+/*
+ * Buffers created with XILINX_DRM_GEM_CACHED are mapped cacheable into the
+ * CPU. The CPU writes reach memory only when the buffer is released with
+ * DRM_IOCTL_XILINX_GEM_CPU_FINI, or when the dirtied rectangles of a
+ * framebuffer backed by it are reported with DRM_IOCTL_MODE_DIRTYFB.
+ */
+#define XILINX_DRM_GEM_CACHED		(1 << 0)
+
+struct drm_xilinx_gem_create {
+	__u64 size;
+	__u32 flags;
+	__u32 handle;
+};
+
+#define XILINX_DRM_GEM_CPU_READ		(1 << 0)
+#define XILINX_DRM_GEM_CPU_WRITE	(1 << 1)
+
+/*
+ * CPU access window of a buffer: offset and size select the byte range to
+ * synchronize, a size of 0 covers the buffer from offset to its end.
+ */
+struct drm_xilinx_gem_cpu_access {
+	__u32 handle;
+	__u32 flags;
+	__u64 offset;
+	__u64 size;
+};
+
+#define DRM_XILINX_GEM_CREATE		0x00
+#define DRM_XILINX_GEM_CPU_PREP		0x01
+#define DRM_XILINX_GEM_CPU_FINI		0x02
+
+#define DRM_IOCTL_XILINX_GEM_CREATE DRM_IOWR(DRM_COMMAND_BASE + DRM_XILINX_GEM_CREATE, struct drm_xilinx_gem_create)
+#define DRM_IOCTL_XILINX_GEM_CPU_PREP DRM_IOW(DRM_COMMAND_BASE + DRM_XILINX_GEM_CPU_PREP, struct drm_xilinx_gem_cpu_access)
+#define DRM_IOCTL_XILINX_GEM_CPU_FINI DRM_IOW(DRM_COMMAND_BASE + DRM_XILINX_GEM_CPU_FINI, struct drm_xilinx_gem_cpu_access)
+
+#endif
@@ -19,6 +19,9 @@ struct sock_extended_err {
 #define SO_EE_ORIGIN_ICMP6	3
 #define SO_EE_ORIGIN_TXSTATUS	4
 #define SO_EE_ORIGIN_TIMESTAMPING SO_EE_ORIGIN_TXSTATUS
+#define SO_EE_ORIGIN_ZEROCOPY	5
+
+#define SO_EE_CODE_ZEROCOPY_COPIED	1
 
 #define SO_EE_OFFENDER(ee)	((struct sockaddr*)((ee)+1))
 
@@ -43,4 +46,25 @@ enum {
 	SCM_TSTAMP_ACK,		/* data acknowledged by peer */
 };
 
+/* The receive path stages in struct scm_timestamping_stages */
+enum {
+	SCM_TSTAMP_STAGE_DRIVER,	/* driver passed skb to the stack */
+	SCM_TSTAMP_STAGE_STACK,		/* protocol demux, after GRO/RPS */
+	SCM_TSTAMP_STAGE_ENQUEUE,	/* queued on the socket */
+	SCM_TSTAMP_STAGE_DEQUEUE,	/* taken off the queue by recvmsg */
+	SCM_TSTAMP_STAGE_MAX,
+};
+
+/**
+ *	struct scm_timestamping_stages - receive path stage timestamps
+ *
+ *	Passed in an SCM_TIMESTAMPING_STAGES cmsg with recvmsg() on sockets
+ *	with SOF_TIMESTAMPING_RX_STAGES set, indexed by SCM_TSTAMP_STAGE_*.
+ *	The times are CLOCK_REALTIME like software timestamps, stages that
+ *	the packet did not pass through are left zero.
+ */
+struct scm_timestamping_stages {
+	struct timespec ts[SCM_TSTAMP_STAGE_MAX];
+};
+
 #endif /* _UAPI_LINUX_ERRQUEUE_H */
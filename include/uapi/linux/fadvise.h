@@ -18,4 +18,7 @@
 #define POSIX_FADV_NOREUSE	5 /* Data will be accessed once.  */
 #endif
 
+/* Linux specific: read ahead len bytes, offset is ignored.  */
+#define POSIX_FADV_RA_WINDOW	8
+
 #endif	/* FADVISE_H_INCLUDED */
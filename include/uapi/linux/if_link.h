@@ -145,6 +145,7 @@ enum {
 	IFLA_CARRIER,
 	IFLA_PHYS_PORT_ID,
 	IFLA_CARRIER_CHANGES,
+	IFLA_RX_EARLY_FILTER,	/* Classic BPF run before skb allocation */
 	__IFLA_MAX
 };
 
@@ -0,0 +1,47 @@
+#ifndef __UAPI_XILINX_EMACPS_H__
+#define __UAPI_XILINX_EMACPS_H__
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * Zero-copy capture interface of the Zynq GEM driver.
+ *
+ * Opening /dev/xemacps_capN switches the RX ring of the interface into
+ * capture mode: every RX buffer descriptor points into one slot of a
+ * coherent buffer that is mapped into the process with mmap(). The mapping
+ * starts with a struct xemacps_cap_ring, followed at data_offset by
+ * nr_slots slots of slot_size bytes each; the frame data of a slot starts
+ * frame_offset bytes into the slot.
+ *
+ * head and tail are free running counters, the slot of a counter value is
+ * the value modulo nr_slots. The kernel fills desc[] up to head, user space
+ * consumes the frames and then advances tail, after which the slots are
+ * handed back to the hardware. poll() waits for head != tail.
+ */
+
+#define XEMACPS_CAP_VERSION		1
+
+struct xemacps_cap_desc {
+	__u32 len;		/* frame length in bytes */
+	__u32 status;		/* word 1 of the RX BD */
+	__u32 ts_sec;		/* software receive timestamp */
+	__u32 ts_nsec;
+};
+
+struct xemacps_cap_ring {
+	__u32 version;		/* XEMACPS_CAP_VERSION */
+	__u32 nr_slots;
+	__u32 slot_size;
+	__u32 data_offset;	/* offset of slot 0 in the mapping */
+	__u32 frame_offset;	/* offset of the frame in a slot */
+	__u32 head;		/* written by the kernel */
+	__u32 tail;		/* written by user space */
+	__u32 reserved;
+	struct xemacps_cap_desc desc[0];
+};
+
+/* Hand consumed slots back to the hardware without waiting in poll() */
+#define XEMACPS_CAP_RELEASE		_IO('x', 0x40)
+
+#endif /* __UAPI_XILINX_EMACPS_H__ */
@@ -9,6 +9,8 @@
 #endif
 
 #include <linux/init.h>
+#include <linux/async.h>
+#include <linux/completion.h>
 #include <linux/fs.h>
 #include <linux/slab.h>
 #include <linux/types.h>
@@ -605,8 +607,37 @@ static void __init clean_rootfs(void)
 }
 #endif
 
-static int __init populate_rootfs(void)
+static bool __initdata initramfs_async = true;
+
+static int __init initramfs_async_setup(char *str)
+{
+	strtobool(str, &initramfs_async);
+	return 1;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
+static bool initramfs_scheduled;
+static DECLARE_COMPLETION(initramfs_done);
+
+/**
+ * wait_for_initramfs - wait until the initramfs has been unpacked
+ *
+ * Called before anything that looks up files in the rootfs: the
+ * usermode helpers, the firmware loader and the search for init.
+ */
+void wait_for_initramfs(void)
+{
+	if (!ACCESS_ONCE(initramfs_scheduled)) {
+		/* the rootfs is still empty, there is nothing to wait for */
+		pr_warn_once("wait_for_initramfs() called before rootfs_initcalls\n");
+		return;
+	}
+	wait_for_completion(&initramfs_done);
+}
+
+static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 {
+	bool had_initrd = initrd_start;
 	char *err = unpack_to_rootfs(__initramfs_start, __initramfs_size);
 	if (err)
 		panic("%s", err); /* Failed to decompress INTERNAL initramfs */
@@ -647,12 +678,29 @@ static int __init populate_rootfs(void)
 			printk(KERN_EMERG "Initramfs unpacking failed: %s\n", err);
 		free_initrd();
 #endif
-		/*
-		 * Try loading default modules from initramfs.  This gives
-		 * us a chance to load before device_initcalls.
-		 */
-		load_default_modules();
 	}
+	complete_all(&initramfs_done);
+
+	/*
+	 * Try loading default modules from initramfs.  This gives
+	 * us a chance to load before device_initcalls.
+	 */
+	if (had_initrd)
+		load_default_modules();
+}
+
+/*
+ * Unpacking a large initramfs takes a while, so unless initramfs_async=0
+ * is given it runs in parallel with the device initcalls. Whatever needs
+ * files from the rootfs calls wait_for_initramfs() first.
+ */
+static int __init populate_rootfs(void)
+{
+	ACCESS_ONCE(initramfs_scheduled) = true;
+	if (initramfs_async)
+		async_schedule(do_populate_rootfs, NULL);
+	else
+		do_populate_rootfs(NULL, 0);
 	return 0;
 }
 rootfs_initcall(populate_rootfs);
@@ -64,6 +64,8 @@
 #include <linux/hugetlb.h>
 #include <linux/freezer.h>
 #include <linux/bootmem.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/futex.h>
 
@@ -247,17 +249,40 @@ static const struct futex_q futex_q_init = {
  * Hash buckets are shared by all the futex_keys that hash to the same
  * location.  Each key may have multiple futex_q structures, one for each task
  * waiting on a futex.
+ *
+ * contended counts the times the lock had to be waited for, it is
+ * protected by the lock itself.
  */
 struct futex_hash_bucket {
 	atomic_t waiters;
 	spinlock_t lock;
 	struct plist_head chain;
+	unsigned int contended;
 } ____cacheline_aligned_in_smp;
 
 static unsigned long __read_mostly futex_hashsize;
 
 static struct futex_hash_bucket *futex_queues;
 
+/*
+ * PROCESS_PRIVATE futexes of a multithreaded process hash to a table of
+ * its own, so that unrelated processes do not contend on the buckets.
+ */
+struct futex_private_hash {
+	unsigned long hashsize;
+	struct futex_hash_bucket queues[];
+};
+
+/* buckets of a private hash, 0 to hash everything globally */
+static unsigned long __read_mostly futex_private_hashsize;
+static int __initdata futex_private_hash_param = -1;
+
+static int __init setup_futex_private_hash(char *str)
+{
+	return kstrtoint(str, 0, &futex_private_hash_param) == 0;
+}
+__setup("futex_private_hash=", setup_futex_private_hash);
+
 static inline void futex_get_mm(union futex_key *key)
 {
 	atomic_inc(&key->private.mm->mm_count);
@@ -311,9 +336,78 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
+
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED)) &&
+	    key->private.mm && key->private.mm->futex_hash) {
+		struct futex_private_hash *fph = key->private.mm->futex_hash;
+
+		return &fph->queues[hash & (fph->hashsize - 1)];
+	}
+
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
+static inline void hb_lock(struct futex_hash_bucket *hb)
+{
+	if (!spin_trylock(&hb->lock)) {
+		spin_lock(&hb->lock);
+		hb->contended++;
+	}
+}
+
+static inline void hb_lock_nested(struct futex_hash_bucket *hb)
+{
+	if (!spin_trylock(&hb->lock)) {
+		spin_lock_nested(&hb->lock, SINGLE_DEPTH_NESTING);
+		hb->contended++;
+	}
+}
+
+static void futex_hash_bucket_init(struct futex_hash_bucket *hb)
+{
+	atomic_set(&hb->waiters, 0);
+	plist_head_init(&hb->chain);
+	spin_lock_init(&hb->lock);
+	hb->contended = 0;
+}
+
+/**
+ * futex_mm_prepare() - give a process its private futex hash
+ * @mm:		the mm getting a new user
+ *
+ * Called by clone() before @mm gets shared. As long as current is the
+ * only user of @mm, no private futex of @mm can be queued, so the
+ * futexes can move from the global hash to the private one. If that is
+ * not the case anymore, or the allocation fails, the process keeps on
+ * using the global hash.
+ */
+void futex_mm_prepare(struct mm_struct *mm)
+{
+	struct futex_private_hash *fph;
+	unsigned long i;
+
+	if (mm->futex_hash || !futex_private_hashsize ||
+	    atomic_read(&mm->mm_users) != 1)
+		return;
+
+	fph = kmalloc(sizeof(*fph) + futex_private_hashsize *
+		      sizeof(fph->queues[0]), GFP_KERNEL | __GFP_NOWARN);
+	if (!fph)
+		return;
+
+	fph->hashsize = futex_private_hashsize;
+	for (i = 0; i < fph->hashsize; i++)
+		futex_hash_bucket_init(&fph->queues[i]);
+
+	mm->futex_hash = fph;
+}
+
+/* Called when @mm itself is freed, no futex_key points to it anymore. */
+void futex_mm_free(struct mm_struct *mm)
+{
+	kfree(mm->futex_hash);
+}
+
 /*
  * Return 1 if two futex_keys are equal, 0 otherwise.
  */
@@ -730,7 +824,7 @@ void exit_pi_state_list(struct task_struct *curr)
 		hb = hash_futex(&key);
 		raw_spin_unlock_irq(&curr->pi_lock);
 
-		spin_lock(&hb->lock);
+		hb_lock(hb);
 
 		raw_spin_lock_irq(&curr->pi_lock);
 		/*
@@ -1190,12 +1284,12 @@ static inline void
 double_lock_hb(struct futex_hash_bucket *hb1, struct futex_hash_bucket *hb2)
 {
 	if (hb1 <= hb2) {
-		spin_lock(&hb1->lock);
+		hb_lock(hb1);
 		if (hb1 < hb2)
-			spin_lock_nested(&hb2->lock, SINGLE_DEPTH_NESTING);
+			hb_lock_nested(hb2);
 	} else { /* hb1 > hb2 */
-		spin_lock(&hb2->lock);
-		spin_lock_nested(&hb1->lock, SINGLE_DEPTH_NESTING);
+		hb_lock(hb2);
+		hb_lock_nested(hb1);
 	}
 }
 
@@ -1231,7 +1325,7 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 	if (!hb_waiters_pending(hb))
 		goto out_put_key;
 
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 
 	plist_for_each_entry_safe(this, next, &hb->chain, list) {
 		if (match_futex (&this->key, &key)) {
@@ -1758,7 +1852,7 @@ static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
 
 	q->lock_ptr = &hb->lock;
 
-	spin_lock(&hb->lock); /* implies MB (A) */
+	hb_lock(hb); /* implies MB (A) */
 	return hb;
 }
 
@@ -2403,7 +2497,7 @@ retry:
 		return ret;
 
 	hb = hash_futex(&key);
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 
 	/*
 	 * Check waiters first. We do not trust user space values at
@@ -2608,7 +2702,7 @@ static int futex_wait_requeue_pi(u32 __user *uaddr, unsigned int flags,
 	/* Queue the futex_q, drop the hb lock, wait for wakeup. */
 	futex_wait_queue_me(hb, &q, to);
 
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 	ret = handle_early_requeue_pi_wakeup(hb, &q, &key2, to);
 	spin_unlock(&hb->lock);
 	if (ret)
@@ -3042,12 +3136,101 @@ static int __init futex_init(void)
 
 	futex_detect_cmpxchg();
 
-	for (i = 0; i < futex_hashsize; i++) {
-		atomic_set(&futex_queues[i].waiters, 0);
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	for (i = 0; i < futex_hashsize; i++)
+		futex_hash_bucket_init(&futex_queues[i]);
+
+	/*
+	 * A few threads per cpu do not need the room of the global hash,
+	 * but unrelated processes should not share buckets.
+	 */
+	if (futex_private_hash_param >= 0)
+		futex_private_hashsize = futex_private_hash_param ?
+			roundup_pow_of_two(futex_private_hash_param) : 0;
+	else
+		futex_private_hashsize = roundup_pow_of_two(max(16U,
+						8 * num_possible_cpus()));
 
 	return 0;
 }
 __initcall(futex_init);
+
+static void futex_queues_show(struct seq_file *m,
+			      struct futex_hash_bucket *queues,
+			      unsigned long hashsize)
+{
+	unsigned long i, used = 0, waiters = 0, contended = 0;
+	unsigned int max_waiters = 0, max_contended = 0;
+
+	for (i = 0; i < hashsize; i++) {
+		struct futex_hash_bucket *hb = &queues[i];
+		struct futex_q *q;
+		unsigned int nr = 0;
+
+		spin_lock(&hb->lock);
+		plist_for_each_entry(q, &hb->chain, list)
+			nr++;
+		contended += hb->contended;
+		max_contended = max(max_contended, hb->contended);
+		spin_unlock(&hb->lock);
+
+		if (nr)
+			used++;
+		waiters += nr;
+		max_waiters = max(max_waiters, nr);
+	}
+
+	seq_printf(m, "buckets %lu\n" "used %lu\n" "waiters %lu\n"
+		   "max_waiters %u\n" "contended %lu\n" "max_contended %u\n",
+		   hashsize, used, waiters, max_waiters, contended,
+		   max_contended);
+}
+
+/**
+ * futex_hash_show() - print the private futex hash usage of a process
+ * @m:		seq_file of /proc/<pid>/futex_hash
+ * @mm:		the mm of the process
+ *
+ * A process that never had more than one thread uses the global hash,
+ * which only shows its size then.
+ */
+void futex_hash_show(struct seq_file *m, struct mm_struct *mm)
+{
+	struct futex_private_hash *fph = mm->futex_hash;
+
+	if (!fph) {
+		seq_printf(m, "global %lu\n", futex_hashsize);
+		return;
+	}
+
+	futex_queues_show(m, fph->queues, fph->hashsize);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int futex_hash_debug_show(struct seq_file *m, void *v)
+{
+	futex_queues_show(m, futex_queues, futex_hashsize);
+	return 0;
+}
+
+static int futex_hash_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, futex_hash_debug_show, NULL);
+}
+
+static const struct file_operations futex_hash_debug_fops = {
+	.open		= futex_hash_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init futex_debugfs_init(void)
+{
+	if (!debugfs_create_file("futex_hash", S_IRUSR, NULL, NULL,
+				 &futex_hash_debug_fops))
+		return -ENOMEM;
+
+	return 0;
+}
+late_initcall(futex_debugfs_init);
+#endif
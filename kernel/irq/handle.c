@@ -127,6 +127,7 @@ void __irq_wake_thread(struct irq_desc *desc, struct irqaction *action)
 	 */
 	atomic_inc(&desc->threads_active);
 
+	irq_latency_wake(action);
 	wake_up_process(action->thread);
 }
 
@@ -135,6 +136,7 @@ handle_irq_event_percpu(struct irq_desc *desc, struct irqaction *action)
 {
 	irqreturn_t retval = IRQ_NONE;
 	unsigned int flags = 0, irq = desc->irq_data.irq;
+	u64 start = irq_latency_start();
 
 	do {
 		irqreturn_t res;
@@ -173,6 +175,8 @@ handle_irq_event_percpu(struct irq_desc *desc, struct irqaction *action)
 		action = action->next;
 	} while (action);
 
+	irq_latency_add(desc, IRQ_LAT_HARDIRQ, start);
+
 	add_interrupt_randomness(irq, flags);
 
 	if (!noirqdebug)
@@ -24,14 +24,19 @@ extern bool noirqdebug;
  * IRQTF_WARNED    - warning "IRQ_WAKE_THREAD w/o thread_fn" has been printed
  * IRQTF_AFFINITY  - irq thread is requested to adjust affinity
  * IRQTF_FORCED_THREAD  - irq action is force threaded
+ * IRQTF_PRIORITY  - irq thread is requested to adjust its priority
  */
 enum {
 	IRQTF_RUNTHREAD,
 	IRQTF_WARNED,
 	IRQTF_AFFINITY,
 	IRQTF_FORCED_THREAD,
+	IRQTF_PRIORITY,
 };
 
+/* default SCHED_FIFO priority of irq threads */
+#define IRQ_THREAD_DEFAULT_PRIO	(MAX_USER_RT_PRIO / 2)
+
 /*
  * Bit masks for desc->core_internal_state__do_not_mess_with_it
  *
@@ -106,6 +111,47 @@ static inline void unregister_handler_proc(unsigned int irq,
 					   struct irqaction *action) { }
 #endif
 
+/* Latency histograms, see latency.c */
+enum {
+	IRQ_LAT_HARDIRQ,	/* duration of the hardirq handlers */
+	IRQ_LAT_WAKEUP,		/* wakeup to run of the irq thread */
+	IRQ_LAT_THREAD,		/* duration of the thread handler */
+	IRQ_LAT_NR,
+};
+
+#ifdef CONFIG_IRQ_LATENCY_HIST
+extern void irq_latency_add(struct irq_desc *desc, int type, u64 start);
+extern void register_irq_latency(unsigned int irq, struct irq_desc *desc);
+extern void unregister_irq_latency(unsigned int irq, struct irq_desc *desc);
+
+static inline u64 irq_latency_start(void)
+{
+	return local_clock();
+}
+
+static inline void irq_latency_wake(struct irqaction *action)
+{
+	action->wake_ns = local_clock();
+}
+
+static inline void irq_latency_woken(struct irq_desc *desc,
+				     struct irqaction *action)
+{
+	irq_latency_add(desc, IRQ_LAT_WAKEUP, action->wake_ns);
+}
+#else
+static inline void irq_latency_add(struct irq_desc *desc, int type,
+				   u64 start) { }
+static inline void register_irq_latency(unsigned int irq,
+					struct irq_desc *desc) { }
+static inline void unregister_irq_latency(unsigned int irq,
+					  struct irq_desc *desc) { }
+static inline u64 irq_latency_start(void) { return 0; }
+static inline void irq_latency_wake(struct irqaction *action) { }
+static inline void irq_latency_woken(struct irq_desc *desc,
+				     struct irqaction *action) { }
+#endif
+
 extern int irq_select_affinity_usr(unsigned int irq, struct cpumask *mask);
 
 extern void irq_set_thread_affinity(struct irq_desc *desc);
@@ -87,6 +87,7 @@ static void desc_set_defaults(unsigned int irq, struct irq_desc *desc, int node,
 	desc->depth = 1;
 	desc->irq_count = 0;
 	desc->irqs_unhandled = 0;
+	desc->thread_prio = 0;
 	desc->name = NULL;
 	desc->owner = owner;
 	for_each_possible_cpu(cpu)
@@ -167,6 +168,7 @@ static void free_desc(unsigned int irq)
 	struct irq_desc *desc = irq_to_desc(irq);
 
 	unregister_irq_proc(irq, desc);
+	unregister_irq_latency(irq, desc);
 
 	mutex_lock(&sparse_irq_lock);
 	delete_irq_desc(irq);
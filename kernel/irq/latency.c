@@ -0,0 +1,179 @@
+/*
+ * linux/kernel/irq/latency.c
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Per interrupt histograms of the time spent in the hardirq handlers,
+ * from the wakeup of an irq thread until it runs, and in the thread
+ * handler, in /sys/kernel/debug/irq_latency/<irq>. Writing to a file
+ * clears its histograms.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "internals.h"
+
+/*
+ * Bucket 0 counts latencies below 1us, bucket n the ones in
+ * [2^(n-1), 2^n) us and the last one everything above.
+ */
+#define IRQ_LAT_BUCKETS		20
+
+static const char * const irq_lat_names[IRQ_LAT_NR] = {
+	[IRQ_LAT_HARDIRQ]	= "hardirq",
+	[IRQ_LAT_WAKEUP]	= "wakeup",
+	[IRQ_LAT_THREAD]	= "thread",
+};
+
+/*
+ * The hardirq handler of an interrupt does not run on two cpus at the
+ * same time, but the threads of shared interrupts can update the thread
+ * histograms concurrently and lose a count now and then. That is fine
+ * for statistics.
+ */
+struct irq_latency_hist {
+	unsigned long		count[IRQ_LAT_NR][IRQ_LAT_BUCKETS];
+	u64			max_ns[IRQ_LAT_NR];
+	struct dentry		*dentry;
+};
+
+static struct dentry *irq_latency_dir;
+
+void irq_latency_add(struct irq_desc *desc, int type, u64 start)
+{
+	struct irq_latency_hist *hist = ACCESS_ONCE(desc->latency_hist);
+	u64 ns = local_clock() - start;
+	u32 us;
+
+	if (!hist)
+		return;
+
+	/* a 32bit division, this runs for every interrupt */
+	us = (u32)min_t(u64, ns, U32_MAX) / NSEC_PER_USEC;
+	hist->count[type][min(fls(us), IRQ_LAT_BUCKETS - 1)]++;
+	if (ns > hist->max_ns[type])
+		hist->max_ns[type] = ns;
+}
+
+static int irq_latency_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+	struct irq_latency_hist *hist = desc->latency_hist;
+	int i, t;
+
+	seq_printf(m, "%16s", "usecs");
+	for (t = 0; t < IRQ_LAT_NR; t++)
+		seq_printf(m, " %12s", irq_lat_names[t]);
+	seq_putc(m, '\n');
+
+	for (i = 0; i < IRQ_LAT_BUCKETS; i++) {
+		if (!i)
+			seq_printf(m, "%7u - %6u", 0, 1);
+		else if (i < IRQ_LAT_BUCKETS - 1)
+			seq_printf(m, "%7u - %6u", 1U << (i - 1), 1U << i);
+		else
+			seq_printf(m, "%7u - %6s", 1U << (i - 1), "inf");
+
+		for (t = 0; t < IRQ_LAT_NR; t++)
+			seq_printf(m, " %12lu", hist->count[t][i]);
+		seq_putc(m, '\n');
+	}
+
+	seq_printf(m, "%16s", "max");
+	for (t = 0; t < IRQ_LAT_NR; t++)
+		seq_printf(m, " %12llu", div_u64(hist->max_ns[t],
+						 NSEC_PER_USEC));
+	seq_putc(m, '\n');
+	return 0;
+}
+
+static int irq_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_latency_show, inode->i_private);
+}
+
+static ssize_t irq_latency_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	struct irq_desc *desc = irq_to_desc((long) file_inode(file)->i_private);
+	struct irq_latency_hist *hist = desc->latency_hist;
+
+	memset(hist->count, 0, sizeof(hist->count));
+	memset(hist->max_ns, 0, sizeof(hist->max_ns));
+	return count;
+}
+
+static const struct file_operations irq_latency_fops = {
+	.open		= irq_latency_open,
+	.read		= seq_read,
+	.write		= irq_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+void register_irq_latency(unsigned int irq, struct irq_desc *desc)
+{
+	struct irq_latency_hist *hist;
+	char name[10];
+
+	if (!irq_latency_dir || desc->latency_hist)
+		return;
+
+	hist = kzalloc(sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return;
+
+	sprintf(name, "%u", irq);
+	hist->dentry = debugfs_create_file(name, 0644, irq_latency_dir,
+					   (void *)(long)irq,
+					   &irq_latency_fops);
+	if (!hist->dentry) {
+		kfree(hist);
+		return;
+	}
+
+	/* the handlers start sampling once they see @hist */
+	smp_wmb();
+	desc->latency_hist = hist;
+}
+
+void unregister_irq_latency(unsigned int irq, struct irq_desc *desc)
+{
+	struct irq_latency_hist *hist = desc->latency_hist;
+
+	if (!hist)
+		return;
+
+	desc->latency_hist = NULL;
+	debugfs_remove(hist->dentry);
+	kfree(hist);
+}
+
+static int __init irq_latency_init(void)
+{
+	struct irq_desc *desc;
+	unsigned int irq;
+
+	irq_latency_dir = debugfs_create_dir("irq_latency", NULL);
+	if (!irq_latency_dir)
+		return -ENOMEM;
+
+	/* interrupts requested before debugfs was up */
+	for_each_irq_desc(irq, desc) {
+		if (desc && desc->action)
+			register_irq_latency(irq, desc);
+	}
+
+	return 0;
+}
+late_initcall(irq_latency_init);
@@ -774,6 +774,24 @@ static inline void
 irq_thread_check_affinity(struct irq_desc *desc, struct irqaction *action) { }
 #endif
 
+/*
+ * Apply a priority change requested by irq_set_thread_priority(). This
+ * can not be done there, as the thread may be created or woken with
+ * desc->lock held.
+ */
+static void
+irq_thread_check_priority(struct irq_desc *desc, struct irqaction *action)
+{
+	struct sched_param param;
+
+	if (!test_and_clear_bit(IRQTF_PRIORITY, &action->thread_flags))
+		return;
+
+	param.sched_priority = ACCESS_ONCE(desc->thread_prio) ?:
+			       IRQ_THREAD_DEFAULT_PRIO;
+	sched_setscheduler_nocheck(current, SCHED_FIFO, &param);
+}
+
 /*
  * Interrupts which are not explicitely requested as threaded
  * interrupts rely on the implicit bh/preempt disable of the hard irq
@@ -861,13 +879,19 @@ static int irq_thread(void *data)
 	task_work_add(current, &on_exit_work, false);
 
 	irq_thread_check_affinity(desc, action);
+	irq_thread_check_priority(desc, action);
 
 	while (!irq_wait_for_interrupt(action)) {
 		irqreturn_t action_ret;
+		u64 start;
 
+		irq_latency_woken(desc, action);
 		irq_thread_check_affinity(desc, action);
+		irq_thread_check_priority(desc, action);
 
+		start = irq_latency_start();
 		action_ret = handler_fn(desc, action);
+		irq_latency_add(desc, IRQ_LAT_THREAD, start);
 		if (action_ret == IRQ_HANDLED)
 			atomic_inc(&desc->threads_handled);
 
@@ -914,6 +938,35 @@ void irq_wake_thread(unsigned int irq, void *dev_id)
 }
 EXPORT_SYMBOL_GPL(irq_wake_thread);
 
+/**
+ *	irq_set_thread_priority - set the priority of the irq threads
+ *	@irq: Interrupt line
+ *	@prio: SCHED_FIFO priority, 0 for the default
+ *
+ *	Sets the priority of the handler threads of @irq, including the
+ *	ones of handlers requested later. Running threads pick the new
+ *	priority up the next time they handle an interrupt.
+ */
+int irq_set_thread_priority(unsigned int irq, unsigned int prio)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+	struct irqaction *action;
+	unsigned long flags;
+
+	if (!desc || prio >= MAX_USER_RT_PRIO)
+		return -EINVAL;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	desc->thread_prio = prio;
+	for (action = desc->action; action; action = action->next) {
+		if (action->thread)
+			set_bit(IRQTF_PRIORITY, &action->thread_flags);
+	}
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(irq_set_thread_priority);
+
 static void irq_setup_forced_threading(struct irqaction *new)
 {
 	if (!force_irqthreads)
@@ -996,7 +1049,7 @@ __setup_irq(unsigned int irq, struct irq_desc *desc, struct irqaction *new)
 	if (new->thread_fn && !nested) {
 		struct task_struct *t;
 		static const struct sched_param param = {
-			.sched_priority = MAX_USER_RT_PRIO/2,
+			.sched_priority = IRQ_THREAD_DEFAULT_PRIO,
 		};
 
 		t = kthread_create(irq_thread, new, "irq/%d-%s", irq,
@@ -1025,6 +1078,11 @@ __setup_irq(unsigned int irq, struct irq_desc *desc, struct irqaction *new)
 		 * on which the requesting code placed the interrupt.
 		 */
 		set_bit(IRQTF_AFFINITY, &new->thread_flags);
+		/*
+		 * Same for the priority, it can change before the action
+		 * is visible to irq_set_thread_priority().
+		 */
+		set_bit(IRQTF_PRIORITY, &new->thread_flags);
 	}
 
 	if (!alloc_cpumask_var(&mask, GFP_KERNEL)) {
@@ -1225,6 +1283,7 @@ __setup_irq(unsigned int irq, struct irq_desc *desc, struct irqaction *new)
 		wake_up_process(new->thread);
 
 	register_irq_proc(irq, desc);
+	register_irq_latency(irq, desc);
 	new->dir = NULL;
 	register_handler_proc(irq, new);
 	free_cpumask_var(mask);
@@ -266,6 +266,42 @@ static const struct file_operations irq_spurious_proc_fops = {
 	.release	= single_release,
 };
 
+static int irq_thread_prio_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+
+	seq_printf(m, "%u\n", desc->thread_prio ?: IRQ_THREAD_DEFAULT_PRIO);
+	return 0;
+}
+
+static ssize_t irq_thread_prio_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int irq = (int)(long)PDE_DATA(file_inode(file));
+	unsigned int prio;
+	int err;
+
+	err = kstrtouint_from_user(buffer, count, 0, &prio);
+	if (err)
+		return err;
+
+	err = irq_set_thread_priority(irq, prio);
+	return err ? err : count;
+}
+
+static int irq_thread_prio_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_thread_prio_proc_show, PDE_DATA(inode));
+}
+
+static const struct file_operations irq_thread_prio_proc_fops = {
+	.open		= irq_thread_prio_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_thread_prio_proc_write,
+};
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -341,6 +377,10 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 
 	proc_create_data("spurious", 0444, desc->dir,
 			 &irq_spurious_proc_fops, (void *)(long)irq);
+
+	/* create /proc/irq/<irq>/thread_priority */
+	proc_create_data("thread_priority", 0644, desc->dir,
+			 &irq_thread_prio_proc_fops, (void *)(long)irq);
 }
 
 void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
@@ -356,6 +396,7 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 	remove_proc_entry("node", desc->dir);
 #endif
 	remove_proc_entry("spurious", desc->dir);
+	remove_proc_entry("thread_priority", desc->dir);
 
 	memset(name, 0, MAX_NAMELEN);
 	sprintf(name, "%u", irq);
@@ -0,0 +1,85 @@
+/*
+ * Lock contention counters
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * /proc/lock_contention shows, per cpu, how many spinlock acquisitions
+ * found the lock taken and how many queued rwlock acquisitions took the
+ * slow path. Writing to the file clears the counts.
+ */
+
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+
+static const char * const lock_contention_names[LOCK_CONTENTION_NR] = {
+	[LOCK_CONTENTION_SPIN]	= "spin",
+	[LOCK_CONTENTION_READ]	= "read",
+	[LOCK_CONTENTION_WRITE]	= "write",
+};
+
+static DEFINE_PER_CPU(unsigned long, lock_contention[LOCK_CONTENTION_NR]);
+
+void lock_contention_inc(int type)
+{
+	this_cpu_inc(lock_contention[type]);
+}
+EXPORT_SYMBOL(lock_contention_inc);
+
+static int lock_contention_show(struct seq_file *m, void *v)
+{
+	int i, cpu;
+
+	seq_puts(m, "      ");
+	for_each_possible_cpu(cpu)
+		seq_printf(m, " CPU%-8d", cpu);
+	seq_putc(m, '\n');
+
+	for (i = 0; i < LOCK_CONTENTION_NR; i++) {
+		seq_printf(m, "%5s:", lock_contention_names[i]);
+		for_each_possible_cpu(cpu)
+			seq_printf(m, " %11lu",
+				   per_cpu(lock_contention[i], cpu));
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+
+static int lock_contention_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lock_contention_show, NULL);
+}
+
+static ssize_t lock_contention_write(struct file *file,
+				     const char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	int i, cpu;
+
+	for_each_possible_cpu(cpu)
+		for (i = 0; i < LOCK_CONTENTION_NR; i++)
+			per_cpu(lock_contention[i], cpu) = 0;
+	return count;
+}
+
+static const struct file_operations proc_lock_contention_operations = {
+	.open		= lock_contention_open,
+	.read		= seq_read,
+	.write		= lock_contention_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init lock_contention_init(void)
+{
+	proc_create("lock_contention", S_IRUSR | S_IWUSR, NULL,
+		    &proc_lock_contention_operations);
+	return 0;
+}
+fs_initcall(lock_contention_init);
@@ -20,6 +20,7 @@
 #include <linux/cpumask.h>
 #include <linux/percpu.h>
 #include <linux/hardirq.h>
+#include <linux/spinlock.h>
 #include <asm/qrwlock.h>
 
 /**
@@ -47,6 +48,8 @@ void queue_read_lock_slowpath(struct qrwlock *lock)
 {
 	u32 cnts;
 
+	lock_contention_inc(LOCK_CONTENTION_READ);
+
 	/*
 	 * Readers come here when they cannot get the lock without waiting
 	 */
@@ -94,6 +97,8 @@ void queue_write_lock_slowpath(struct qrwlock *lock)
 {
 	u32 cnts;
 
+	lock_contention_inc(LOCK_CONTENTION_WRITE);
+
 	/* Put the writer into the wait queue */
 	arch_spin_lock(&lock->lock);
 
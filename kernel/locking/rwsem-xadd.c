@@ -17,6 +17,12 @@
 
 #include "mcs_spinlock.h"
 
+/*
+ * A queued writer that is still waiting after this long asks the
+ * spinners to stop stealing the lock, see rwsem_down_write_failed().
+ */
+#define RWSEM_WAIT_TIMEOUT	DIV_ROUND_UP(HZ, 250)
+
 /*
  * Guide to the rw_semaphore's count field for common values.
  * (32-bit case illustrated, similar for 64-bit)
@@ -84,6 +90,7 @@ void __init_rwsem(struct rw_semaphore *sem, const char *name,
 	INIT_LIST_HEAD(&sem->wait_list);
 #ifdef CONFIG_RWSEM_SPIN_ON_OWNER
 	sem->owner = NULL;
+	sem->handoff = false;
 	osq_lock_init(&sem->osq);
 #endif
 }
@@ -199,6 +206,8 @@ __rwsem_do_wake(struct rw_semaphore *sem, enum rwsem_wake_type wake_type)
 	return sem;
 }
 
+static bool rwsem_optimistic_spin_read(struct rw_semaphore *sem);
+
 /*
  * Wait for the read lock to be granted
  */
@@ -209,6 +218,10 @@ struct rw_semaphore __sched *rwsem_down_read_failed(struct rw_semaphore *sem)
 	struct rwsem_waiter waiter;
 	struct task_struct *tsk = current;
 
+	/* a running writer owns the lock, it may well be done soon */
+	if (rwsem_optimistic_spin_read(sem))
+		return sem;
+
 	/* set up my own style of waitqueue */
 	waiter.task = tsk;
 	waiter.type = RWSEM_WAITING_FOR_READ;
@@ -248,6 +261,19 @@ struct rw_semaphore __sched *rwsem_down_read_failed(struct rw_semaphore *sem)
 }
 EXPORT_SYMBOL(rwsem_down_read_failed);
 
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+/* called with wait_lock held */
+static inline void rwsem_set_handoff(struct rw_semaphore *sem, bool handoff)
+{
+	if (sem->handoff != handoff)
+		ACCESS_ONCE(sem->handoff) = handoff;
+}
+#else
+static inline void rwsem_set_handoff(struct rw_semaphore *sem, bool handoff)
+{
+}
+#endif
+
 static inline bool rwsem_try_write_lock(long count, struct rw_semaphore *sem)
 {
 	/*
@@ -290,7 +316,7 @@ static inline bool rwsem_can_spin_on_owner(struct rw_semaphore *sem)
 	struct task_struct *owner;
 	bool on_cpu = false;
 
-	if (need_resched())
+	if (need_resched() || ACCESS_ONCE(sem->handoff))
 		return false;
 
 	rcu_read_lock();
@@ -329,7 +355,7 @@ bool rwsem_spin_on_owner(struct rw_semaphore *sem, struct task_struct *owner)
 {
 	rcu_read_lock();
 	while (owner_running(sem, owner)) {
-		if (need_resched())
+		if (need_resched() || ACCESS_ONCE(sem->handoff))
 			break;
 
 		cpu_relax_lowlatency();
@@ -378,6 +404,10 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 		if (!owner && (need_resched() || rt_task(current)))
 			break;
 
+		/* a queued writer has waited long enough */
+		if (ACCESS_ONCE(sem->handoff))
+			break;
+
 		/*
 		 * The cpu_relax() call is a compiler barrier which forces
 		 * everything in this loop to be re-loaded. We don't need
@@ -392,11 +422,61 @@ done:
 	return taken;
 }
 
+/*
+ * Spin while a writer that is running owns the lock, instead of going
+ * to sleep right away. The reader bias added by down_read() is kept: it
+ * makes us an active locker, so once the writer is gone and nobody is
+ * queued, the count turns positive and the read lock is ours.
+ *
+ * Anything else, queued waiters, another writer without its owner set
+ * yet or a writer with handoff, sends us to the wait queue as before.
+ */
+static bool rwsem_optimistic_spin_read(struct rw_semaphore *sem)
+{
+	struct task_struct *owner;
+	bool taken = false;
+
+	preempt_disable();
+
+	if (!rwsem_can_spin_on_owner(sem))
+		goto done;
+
+	if (!osq_lock(&sem->osq))
+		goto done;
+
+	while (true) {
+		owner = ACCESS_ONCE(sem->owner);
+		if (owner && !rwsem_spin_on_owner(sem, owner))
+			break;
+
+		if (ACCESS_ONCE(sem->count) > 0) {
+			/* pairs with the release in up_write() */
+			smp_mb();
+			taken = true;
+			break;
+		}
+
+		if (!owner)
+			break;
+
+		cpu_relax_lowlatency();
+	}
+	osq_unlock(&sem->osq);
+done:
+	preempt_enable();
+	return taken;
+}
+
 #else
 static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 {
 	return false;
 }
+
+static bool rwsem_optimistic_spin_read(struct rw_semaphore *sem)
+{
+	return false;
+}
 #endif
 
 /*
@@ -408,6 +488,7 @@ struct rw_semaphore __sched *rwsem_down_write_failed(struct rw_semaphore *sem)
 	long count;
 	bool waiting = true; /* any queued threads before us */
 	struct rwsem_waiter waiter;
+	unsigned long timeout;
 
 	/* undo write bias from down_write operation, stop active locking */
 	count = rwsem_atomic_update(-RWSEM_ACTIVE_WRITE_BIAS, sem);
@@ -447,6 +528,7 @@ struct rw_semaphore __sched *rwsem_down_write_failed(struct rw_semaphore *sem)
 		count = rwsem_atomic_update(RWSEM_WAITING_BIAS, sem);
 
 	/* wait until we successfully acquire the lock */
+	timeout = jiffies + RWSEM_WAIT_TIMEOUT;
 	set_current_state(TASK_UNINTERRUPTIBLE);
 	while (true) {
 		if (rwsem_try_write_lock(count, sem))
@@ -460,9 +542,17 @@ struct rw_semaphore __sched *rwsem_down_write_failed(struct rw_semaphore *sem)
 		} while ((count = sem->count) & RWSEM_ACTIVE_MASK);
 
 		raw_spin_lock_irq(&sem->wait_lock);
+
+		/*
+		 * Woken up and the lock is gone again: once we waited long
+		 * enough, keep the spinners from stealing it from us.
+		 */
+		if (time_after(jiffies, timeout))
+			rwsem_set_handoff(sem, true);
 	}
 	__set_current_state(TASK_RUNNING);
 
+	rwsem_set_handoff(sem, false);
 	list_del(&waiter.list);
 	raw_spin_unlock_irq(&sem->wait_lock);
 
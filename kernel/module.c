@@ -60,6 +60,7 @@
 #include <linux/jump_label.h>
 #include <linux/pfn.h>
 #include <linux/bsearch.h>
+#include <linux/xz.h>
 #include <uapi/linux/module.h>
 #include "module-internal.h"
 
@@ -179,6 +180,7 @@ struct load_info {
 	struct _ddebug *debug;
 	unsigned int num_debug;
 	bool sig_ok;
+	u64 start_ns;
 	struct {
 		unsigned int sym, str, mod, vers, info, pcpu;
 	} index;
@@ -2570,6 +2572,106 @@ static void free_copy(struct load_info *info)
 	vfree(info->hdr);
 }
 
+#ifdef CONFIG_MODULE_DECOMPRESS
+/*
+ * Replace the xz compressed copy of the module in @info by the
+ * decompressed one. The output buffer starts at four times the input
+ * and doubles until the whole image fits. The copy is freed on error.
+ */
+static int module_decompress(struct load_info *info)
+{
+	struct xz_dec *xz;
+	struct xz_buf b;
+	enum xz_ret xz_ret;
+	size_t size = (size_t)info->len * 4;
+	u8 *out, *new;
+	int err = 0;
+
+	xz = xz_dec_init(XZ_DYNALLOC, (u32)-1);
+	out = vmalloc(size);
+	if (!xz || !out) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	b.in = (const u8 *)info->hdr;
+	b.in_pos = 0;
+	b.in_size = info->len;
+	b.out = out;
+	b.out_pos = 0;
+	b.out_size = size;
+
+	for (;;) {
+		xz_ret = xz_dec_run(xz, &b);
+		if (xz_ret != XZ_OK)
+			break;
+
+		if (b.out_pos < b.out_size) {
+			/* input exhausted, the stream is truncated */
+			if (b.in_pos == b.in_size)
+				break;
+			continue;
+		}
+
+		if (size > INT_MAX / 2) {
+			err = -EFBIG;
+			goto out;
+		}
+		new = vmalloc(size * 2);
+		if (!new) {
+			err = -ENOMEM;
+			goto out;
+		}
+		memcpy(new, out, b.out_pos);
+		vfree(out);
+		out = new;
+		size *= 2;
+		b.out = out;
+		b.out_size = size;
+	}
+
+	if (xz_ret != XZ_STREAM_END) {
+		pr_debug("xz decompression failed: %d\n", xz_ret);
+		err = xz_ret == XZ_MEM_ERROR ? -ENOMEM : -ENOEXEC;
+		goto out;
+	}
+
+	free_copy(info);
+	info->hdr = (Elf_Ehdr *)out;
+	info->len = b.out_pos;
+	out = NULL;
+out:
+	vfree(out);
+	xz_dec_end(xz);
+	if (err)
+		free_copy(info);
+	return err;
+}
+
+#ifdef CONFIG_SYSFS
+static ssize_t compression_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "xz\n");
+}
+
+static struct kobj_attribute module_compression_attr = __ATTR_RO(compression);
+
+static int __init module_decompress_sysfs_init(void)
+{
+	return sysfs_create_file(&module_kset->kobj,
+				 &module_compression_attr.attr);
+}
+late_initcall(module_decompress_sysfs_init);
+#endif
+#else
+static int module_decompress(struct load_info *info)
+{
+	free_copy(info);
+	return -EOPNOTSUPP;
+}
+#endif
+
 static int rewrite_section_headers(struct load_info *info, int flags)
 {
 	unsigned int i;
@@ -3008,8 +3110,9 @@ static void do_mod_ctors(struct module *mod)
 }
 
 /* This is where the real work happens */
-static int do_init_module(struct module *mod)
+static int do_init_module(struct module *mod, u64 start_ns)
 {
+	u64 init_ns = ktime_get_ns();
 	int ret = 0;
 
 	/*
@@ -3043,6 +3146,8 @@ static int do_init_module(struct module *mod)
 	}
 
 	/* Now it's a first class citizen! */
+	trace_module_load_time(mod, init_ns - start_ns,
+			       ktime_get_ns() - init_ns);
 	mod->state = MODULE_STATE_LIVE;
 	blocking_notifier_call_chain(&module_notify_list,
 				     MODULE_STATE_LIVE, mod);
@@ -3299,7 +3404,7 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	/* Done! */
 	trace_module_load(mod);
 
-	return do_init_module(mod);
+	return do_init_module(mod, info->start_ns);
 
  bug_cleanup:
 	/* module_bug_cleanup needs module_mutex protection */
@@ -3347,6 +3452,7 @@ SYSCALL_DEFINE3(init_module, void __user *, umod,
 	pr_debug("init_module: umod=%p, len=%lu, uargs=%p\n",
 	       umod, len, uargs);
 
+	info.start_ns = ktime_get_ns();
 	err = copy_module_from_user(umod, len, &info);
 	if (err)
 		return err;
@@ -3366,13 +3472,21 @@ SYSCALL_DEFINE3(finit_module, int, fd, const char __user *, uargs, int, flags)
 	pr_debug("finit_module: fd=%d, uargs=%p, flags=%i\n", fd, uargs, flags);
 
 	if (flags & ~(MODULE_INIT_IGNORE_MODVERSIONS
-		      |MODULE_INIT_IGNORE_VERMAGIC))
+		      |MODULE_INIT_IGNORE_VERMAGIC
+		      |MODULE_INIT_COMPRESSED_FILE))
 		return -EINVAL;
 
+	info.start_ns = ktime_get_ns();
 	err = copy_module_from_fd(fd, &info);
 	if (err)
 		return err;
 
+	if (flags & MODULE_INIT_COMPRESSED_FILE) {
+		err = module_decompress(&info);
+		if (err)
+			return err;
+	}
+
 	return load_module(&info, uargs, flags);
 }
 
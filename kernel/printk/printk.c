@@ -44,6 +44,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/utsname.h>
 #include <linux/ctype.h>
 
@@ -1613,6 +1614,77 @@ static size_t cont_print_text(char *text, size_t size)
 	return textlen;
 }
 
+/*
+ * Once the system is up, console output is written by the printk kthread
+ * instead of by whoever happens to call printk() while the console is
+ * free, so that a slow serial console does not add its latency to that
+ * caller. Oopses and early or late boot messages are still printed
+ * synchronously, the kthread may never get to run then.
+ */
+static bool printk_offload = true;
+module_param_named(offload, printk_offload, bool, S_IRUGO | S_IWUSR);
+
+static struct task_struct *printk_kthread;
+
+static bool printk_offloading(void)
+{
+	return printk_offload && printk_kthread && !oops_in_progress &&
+	       system_state == SYSTEM_RUNNING;
+}
+
+static void printk_kthread_wake_func(struct irq_work *irq_work)
+{
+	wake_up_process(printk_kthread);
+}
+
+static DEFINE_PER_CPU(struct irq_work, printk_kthread_work) = {
+	.func = printk_kthread_wake_func,
+};
+
+/* printk() may be called with scheduler locks held, wake up from irq_work */
+static void printk_kthread_wake(void)
+{
+	preempt_disable();
+	irq_work_queue(this_cpu_ptr(&printk_kthread_work));
+	preempt_enable();
+}
+
+static int printk_kthread_func(void *data)
+{
+	while (!kthread_should_stop()) {
+		u64 seq, next_seq;
+		unsigned long flags;
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		raw_spin_lock_irqsave(&logbuf_lock, flags);
+		seq = console_seq;
+		next_seq = log_next_seq;
+		raw_spin_unlock_irqrestore(&logbuf_lock, flags);
+		if (seq == next_seq)
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *thread;
+
+	thread = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(thread)) {
+		pr_err("printk: failed to start kthread, printing synchronously\n");
+		return PTR_ERR(thread);
+	}
+	printk_kthread = thread;
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
@@ -1762,7 +1834,9 @@ asmlinkage int vprintk_emit(int facility, int level,
 	local_irq_restore(flags);
 
 	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	if (!in_sched && printk_offloading()) {
+		printk_kthread_wake();
+	} else if (!in_sched) {
 		lockdep_off();
 		/*
 		 * Disable preemption to avoid being preempted while holding
@@ -2604,7 +2678,9 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
 		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
+		if (printk_offloading())
+			wake_up_process(printk_kthread);
+		else if (console_trylock())
 			console_unlock();
 	}
 
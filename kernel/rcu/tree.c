@@ -305,6 +305,10 @@ module_param(blimit, long, 0444);
 module_param(qhimark, long, 0444);
 module_param(qlowmark, long, 0444);
 
+/* Maximum time spent invoking callbacks from one softirq, 0 for no limit. */
+static ulong rcu_resched_ns = 2 * NSEC_PER_MSEC;
+module_param(rcu_resched_ns, ulong, 0644);
+
 static ulong jiffies_till_first_fqs = ULONG_MAX;
 static ulong jiffies_till_next_fqs = ULONG_MAX;
 
@@ -2295,6 +2299,7 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 	unsigned long flags;
 	struct rcu_head *next, *list, **tail;
 	long bl, count, count_lazy;
+	u64 tlimit = 0;
 	int i;
 
 	/* If no callbacks are ready, just return. */
@@ -2323,6 +2328,15 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 			rdp->nxttail[i] = &rdp->nxtlist;
 	local_irq_restore(flags);
 
+	/*
+	 * From softirq, the time spent is bounded even once ->blimit is
+	 * lifted because of a callback flood, the rest is left for the
+	 * next softirq or ksoftirqd.  How many callbacks that is depends
+	 * on how long they take.
+	 */
+	if (rcu_resched_ns && in_serving_softirq())
+		tlimit = local_clock() + ACCESS_ONCE(rcu_resched_ns);
+
 	/* Invoke callbacks. */
 	count = count_lazy = 0;
 	while (list) {
@@ -2337,6 +2351,9 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 		    (need_resched() ||
 		     (!is_idle_task(current) && !rcu_is_callbacks_kthread())))
 			break;
+		/* Read the clock only every 32 callbacks. */
+		if (tlimit && !(count & 31) && local_clock() >= tlimit)
+			break;
 	}
 
 	local_irq_save(flags);
@@ -2963,6 +2980,9 @@ static int synchronize_sched_expedited_cpu_stop(void *data)
  */
 void synchronize_sched_expedited(void)
 {
+	cpumask_var_t cm;
+	bool cma = false;
+	int cpu;
 	long firstsnap, s, snap;
 	int trycount = 0;
 	struct rcu_state *rsp = &rcu_sched_state;
@@ -2997,11 +3017,32 @@ void synchronize_sched_expedited(void)
 	}
 	WARN_ON_ONCE(cpu_is_offline(raw_smp_processor_id()));
 
+	/*
+	 * CPUs in an extended quiescent state (idle, or running user code
+	 * on an adaptive-ticks CPU) already passed through a quiescent
+	 * state, no need to stop them.  The atomic_add_return() provides
+	 * the full memory barrier against their exit from it.
+	 */
+	cma = zalloc_cpumask_var(&cm, GFP_KERNEL);
+	if (cma) {
+		cpumask_copy(cm, cpu_online_mask);
+		for_each_cpu(cpu, cm) {
+			struct rcu_dynticks *rdtp = &per_cpu(rcu_dynticks, cpu);
+
+			if (!(atomic_add_return(0, &rdtp->dynticks) & 0x1))
+				cpumask_clear_cpu(cpu, cm);
+		}
+		if (cpumask_empty(cm)) {
+			atomic_long_inc(&rsp->expedited_idle);
+			goto all_cpus_idle;
+		}
+	}
+
 	/*
 	 * Each pass through the following loop attempts to force a
 	 * context switch on each CPU.
 	 */
-	while (try_stop_cpus(cpu_online_mask,
+	while (try_stop_cpus(cma ? cm : cpu_online_mask,
 			     synchronize_sched_expedited_cpu_stop,
 			     NULL) == -EAGAIN) {
 		put_online_cpus();
@@ -3013,6 +3054,7 @@ void synchronize_sched_expedited(void)
 			/* ensure test happens before caller kfree */
 			smp_mb__before_atomic(); /* ^^^ */
 			atomic_long_inc(&rsp->expedited_workdone1);
+			free_cpumask_var(cm);
 			return;
 		}
 
@@ -3022,6 +3064,7 @@ void synchronize_sched_expedited(void)
 		} else {
 			wait_rcu_gp(call_rcu_sched);
 			atomic_long_inc(&rsp->expedited_normal);
+			free_cpumask_var(cm);
 			return;
 		}
 
@@ -3031,6 +3074,7 @@ void synchronize_sched_expedited(void)
 			/* ensure test happens before caller kfree */
 			smp_mb__before_atomic(); /* ^^^ */
 			atomic_long_inc(&rsp->expedited_workdone2);
+			free_cpumask_var(cm);
 			return;
 		}
 
@@ -3045,13 +3089,19 @@ void synchronize_sched_expedited(void)
 			/* CPU hotplug operation in flight, use normal GP. */
 			wait_rcu_gp(call_rcu_sched);
 			atomic_long_inc(&rsp->expedited_normal);
+			free_cpumask_var(cm);
 			return;
 		}
 		snap = atomic_long_read(&rsp->expedited_start);
 		smp_mb(); /* ensure read is before try_stop_cpus(). */
+		if (cma)
+			cpumask_and(cm, cm, cpu_online_mask);
 	}
 	atomic_long_inc(&rsp->expedited_stoppedcpus);
 
+all_cpus_idle:
+	free_cpumask_var(cm);
+
 	/*
 	 * Everyone up to our most recent fetch is covered by our grace
 	 * period.  Update the counter, but only if our work is still
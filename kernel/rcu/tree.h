@@ -474,6 +474,7 @@ struct rcu_state {
 	atomic_long_t expedited_workdone2;	/* # done by others #2. */
 	atomic_long_t expedited_normal;		/* # fallbacks to normal. */
 	atomic_long_t expedited_stoppedcpus;	/* # successful stop_cpus. */
+	atomic_long_t expedited_idle;		/* # all CPUs were idle. */
 	atomic_long_t expedited_done_tries;	/* # tries to update _done. */
 	atomic_long_t expedited_done_lost;	/* # times beaten to _done. */
 	atomic_long_t expedited_done_exit;	/* # times exited _done loop. */
@@ -0,0 +1,52 @@
+/*
+ * Scheduler hooks for cpufreq governors
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/export.h>
+
+#include "sched.h"
+
+DEFINE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/**
+ * cpufreq_add_update_util_hook - have the scheduler report utilization
+ * @cpu: cpu to report the utilization of
+ * @data: hook data, embedded in the governor's per-cpu data
+ * @func: callback
+ *
+ * @func is called with the runqueue of @cpu locked, and from the cpu
+ * itself, whenever the utilization of @cpu changes. It must not sleep.
+ * Only one hook can be installed per cpu.
+ */
+void cpufreq_add_update_util_hook(int cpu, struct update_util_data *data,
+			void (*func)(struct update_util_data *data, u64 time,
+				     unsigned long util, unsigned long max))
+{
+	if (WARN_ON(!data || !func))
+		return;
+
+	if (WARN_ON(per_cpu(cpufreq_update_util_data, cpu)))
+		return;
+
+	data->func = func;
+	rcu_assign_pointer(per_cpu(cpufreq_update_util_data, cpu), data);
+}
+EXPORT_SYMBOL_GPL(cpufreq_add_update_util_hook);
+
+/**
+ * cpufreq_remove_update_util_hook - stop utilization reports for a cpu
+ * @cpu: cpu to stop reporting for
+ *
+ * The callback may still be running on return, callers have to wait for
+ * it with synchronize_sched() before freeing the hook data.
+ */
+void cpufreq_remove_update_util_hook(int cpu)
+{
+	rcu_assign_pointer(per_cpu(cpufreq_update_util_data, cpu), NULL);
+}
+EXPORT_SYMBOL_GPL(cpufreq_remove_update_util_hook);
@@ -72,6 +72,7 @@ void init_dl_bw(struct dl_bw *dl_b)
 void init_dl_rq(struct dl_rq *dl_rq, struct rq *rq)
 {
 	dl_rq->rb_root = RB_ROOT;
+	dl_rq->running_bw = 0;
 
 #ifdef CONFIG_SMP
 	/* zero means no -deadline tasks */
@@ -601,6 +602,43 @@ extern bool sched_rt_bandwidth_account(struct rt_rq *rt_rq);
  * Update the current task's runtime statistics (provided it is still
  * a -deadline task and has not been removed from the dl_rq).
  */
+static void add_running_bw(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
+{
+	if (dl_se->dl_active)
+		return;
+
+	dl_se->dl_active = 1;
+	dl_rq->running_bw += dl_se->dl_bw;
+}
+
+static void sub_running_bw(struct sched_dl_entity *dl_se, struct dl_rq *dl_rq)
+{
+	if (!dl_se->dl_active)
+		return;
+
+	dl_se->dl_active = 0;
+	WARN_ON_ONCE(dl_rq->running_bw < dl_se->dl_bw);
+	dl_rq->running_bw -= min(dl_rq->running_bw, dl_se->dl_bw);
+}
+
+/*
+ * GRUB reclaiming: a task with SCHED_FLAG_RECLAIM depletes its runtime
+ * at the rate of the bandwidth of the runnable -deadline tasks of the rq,
+ * relative to the bandwidth -deadline tasks may use on a cpu. Bandwidth
+ * reserved by tasks that are not runnable thus lets it run past its own
+ * runtime, but no further than the global limit.
+ */
+static u64 grub_reclaim(u64 delta, struct rq *rq)
+{
+	u64 max_bw = min_t(u64, dl_bw_of(cpu_of(rq))->bw, BW_UNIT);
+	u64 running_bw = min(rq->dl.running_bw, max_bw);
+
+	if (!max_bw)
+		return delta;
+
+	return div64_u64(delta * running_bw, max_bw);
+}
+
 static void update_curr_dl(struct rq *rq)
 {
 	struct task_struct *curr = rq->curr;
@@ -632,6 +670,10 @@ static void update_curr_dl(struct rq *rq)
 	cpuacct_charge(curr, delta_exec);
 
 	sched_rt_avg_update(rq, delta_exec);
+	rq->dl.exec_clock += delta_exec;
+
+	if (unlikely(dl_se->flags & SCHED_FLAG_RECLAIM))
+		delta_exec = grub_reclaim(delta_exec, rq);
 
 	dl_se->runtime -= delta_exec;
 	if (dl_runtime_exceeded(rq, dl_se)) {
@@ -869,6 +911,9 @@ static void enqueue_task_dl(struct rq *rq, struct task_struct *p, int flags)
 		return;
 	}
 
+	/* runnable, even if throttled */
+	add_running_bw(&p->dl, &rq->dl);
+
 	/*
 	 * If p is throttled, we do nothing. In fact, if it exhausted
 	 * its budget it needs a replenishment and, since it now is on
@@ -894,6 +939,13 @@ static void dequeue_task_dl(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_curr_dl(rq);
 	__dequeue_task_dl(rq, p, flags);
+
+	/*
+	 * The bandwidth is released right away rather than at the 0-lag
+	 * time of the task, so a task that blocks and wakes up again soon
+	 * may briefly let reclaiming tasks overrun.
+	 */
+	sub_running_bw(&p->dl, &rq->dl);
 }
 
 /*
@@ -1704,3 +1756,12 @@ const struct sched_class dl_sched_class = {
 
 	.update_curr		= update_curr_dl,
 };
+
+#ifdef CONFIG_SCHED_DEBUG
+extern void print_dl_rq(struct seq_file *m, int cpu, struct dl_rq *dl_rq);
+
+void print_dl_stats(struct seq_file *m, int cpu)
+{
+	print_dl_rq(m, cpu, &cpu_rq(cpu)->dl);
+}
+#endif /* CONFIG_SCHED_DEBUG */
@@ -261,6 +261,55 @@ void print_rt_rq(struct seq_file *m, int cpu, struct rt_rq *rt_rq)
 #undef P
 }
 
+/* bandwidth as a fraction of a cpu, with six decimals */
+#define SPLIT_BW(x) (long long)((x) >> BW_SHIFT), \
+	(long)((((x) & (BW_UNIT - 1)) * 1000000) >> BW_SHIFT)
+
+void print_dl_rq(struct seq_file *m, int cpu, struct dl_rq *dl_rq)
+{
+	struct dl_bw *dl_b;
+	int cpus = 1;
+#ifdef CONFIG_SMP
+	int i;
+#endif
+
+	SEQ_printf(m, "\ndl_rq[%d]:\n", cpu);
+
+#define P(x) \
+	SEQ_printf(m, "  .%-30s: %Ld\n", #x, (long long)(dl_rq->x))
+#define PN(x) \
+	SEQ_printf(m, "  .%-30s: %Ld.%06ld\n", #x, SPLIT_NS(dl_rq->x))
+#define PB(name, x) \
+	SEQ_printf(m, "  .%-30s: %Ld.%06ld\n", name, SPLIT_BW(x))
+
+	P(dl_nr_running);
+	PB("running_bw", dl_rq->running_bw);
+	PN(exec_clock);
+
+	/*
+	 * Admission control is per root domain: total_bw is what has been
+	 * admitted on its cpus, out of bw per cpu.
+	 */
+	rcu_read_lock_sched();
+	dl_b = dl_bw_of(cpu);
+#ifdef CONFIG_SMP
+	cpus = 0;
+	for_each_cpu_and(i, cpu_rq(cpu)->rd->span, cpu_active_mask)
+		cpus++;
+#endif
+	SEQ_printf(m, "  .%-30s: %d\n", "dl_bw->cpus", cpus);
+	if (dl_b->bw == -1)
+		SEQ_printf(m, "  .%-30s: %s\n", "dl_bw->bw", "unlimited");
+	else
+		PB("dl_bw->bw", dl_b->bw);
+	PB("dl_bw->total_bw", dl_b->total_bw);
+	rcu_read_unlock_sched();
+
+#undef PB
+#undef PN
+#undef P
+}
+
 extern __read_mostly int sched_clock_running;
 
 static void print_cpu(struct seq_file *m, int cpu)
@@ -329,6 +378,7 @@ do {									\
 	spin_lock_irqsave(&sched_debug_lock, flags);
 	print_cfs_stats(m, cpu);
 	print_rt_stats(m, cpu);
+	print_dl_stats(m, cpu);
 
 	print_rq(m, rq, cpu);
 	spin_unlock_irqrestore(&sched_debug_lock, flags);
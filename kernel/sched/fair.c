@@ -2482,20 +2482,27 @@ static inline void __update_group_entity_contrib(struct sched_entity *se)
 	}
 }
 
-static inline void update_rq_runnable_avg(struct rq *rq, int runnable)
-{
-	__update_entity_runnable_avg(rq_clock_task(rq), &rq->avg, runnable);
-	__update_tg_runnable_avg(&rq->avg, &rq->cfs);
-}
 #else /* CONFIG_FAIR_GROUP_SCHED */
 static inline void __update_cfs_rq_tg_load_contrib(struct cfs_rq *cfs_rq,
 						 int force_update) {}
 static inline void __update_tg_runnable_avg(struct sched_avg *sa,
 						  struct cfs_rq *cfs_rq) {}
 static inline void __update_group_entity_contrib(struct sched_entity *se) {}
-static inline void update_rq_runnable_avg(struct rq *rq, int runnable) {}
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
+static unsigned long capacity_orig_of(int cpu);
+static unsigned long cpu_util(int cpu);
+
+static inline void update_rq_runnable_avg(struct rq *rq, int runnable)
+{
+	int cpu = cpu_of(rq);
+
+	__update_entity_runnable_avg(rq_clock_task(rq), &rq->avg, runnable);
+	__update_tg_runnable_avg(&rq->avg, &rq->cfs);
+
+	cpufreq_update_util(rq, cpu_util(cpu), capacity_orig_of(cpu));
+}
+
 static inline void __update_task_entity_contrib(struct sched_entity *se)
 {
 	u32 contrib;
@@ -4112,6 +4119,59 @@ static unsigned long capacity_of(int cpu)
 	return cpu_rq(cpu)->cpu_capacity;
 }
 
+/* capacity of the cpu at its highest frequency, not reduced by rt work */
+static unsigned long capacity_orig_of(int cpu)
+{
+	return cpu_rq(cpu)->cpu_capacity_orig;
+}
+
+/*
+ * Utilization of a cpu or a task in capacity units: the part of the time
+ * it was runnable, scaled by the capacity of the cpu it was runnable on.
+ */
+static unsigned long cpu_util(int cpu)
+{
+	struct sched_avg *sa = &cpu_rq(cpu)->avg;
+
+	return div_u64((u64)sa->runnable_avg_sum * capacity_orig_of(cpu),
+		       sa->runnable_avg_period + 1);
+}
+
+static unsigned long task_util(struct task_struct *p)
+{
+	struct sched_avg *sa = &p->se.avg;
+	unsigned long capacity = capacity_orig_of(task_cpu(p));
+
+	return div_u64((u64)sa->runnable_avg_sum * capacity,
+		       sa->runnable_avg_period + 1);
+}
+
+/*
+ * A cpu is over the tipping point when less than ~20% of its capacity is
+ * left, from there on tasks are spread by load again.
+ */
+static unsigned int capacity_margin = 1280;	/* ~20% */
+
+static bool cpu_overutilized(int cpu)
+{
+	return cpu_util(cpu) * capacity_margin >
+		capacity_orig_of(cpu) * SCHED_CAPACITY_SCALE;
+}
+
+static bool energy_aware(void)
+{
+	return sched_feat(ENERGY_AWARE);
+}
+
+static void set_overutilized(struct root_domain *rd, bool overutilized)
+{
+	if (rd->overutilized == overutilized)
+		return;
+
+	rd->overutilized = overutilized;
+	trace_sched_overutilized(overutilized);
+}
+
 static unsigned long cpu_avg_load_per_task(int cpu)
 {
 	struct rq *rq = cpu_rq(cpu);
@@ -4526,6 +4586,83 @@ done:
 	return target;
 }
 
+const struct sched_energy * __weak arch_sched_energy(int cpu)
+{
+	return NULL;
+}
+
+/*
+ * Busy energy of a cpu running at @util: the power of the lowest capacity
+ * state that fits the utilization, for the fraction of time it is busy.
+ */
+static unsigned long cpu_energy(const struct sched_energy *se, int cpu,
+				unsigned long util)
+{
+	const struct sched_capacity_state *cs;
+	unsigned long max_cap = se->cap_states[se->nr_cap_states - 1].cap;
+	int i;
+
+	/* the model may use other units than the scheduler */
+	util = util * max_cap / max(capacity_orig_of(cpu), 1UL);
+	util = min(util, max_cap);
+
+	for (i = 0; i < se->nr_cap_states - 1; i++) {
+		if (se->cap_states[i].cap >= util)
+			break;
+	}
+	cs = &se->cap_states[i];
+
+	return cs->power * util / cs->cap;
+}
+
+/*
+ * Returns the cpu of the root domain where @p adds the least energy, or
+ * -1 if not every candidate has an energy model or @p fits nowhere.
+ */
+static int energy_aware_wake_cpu(struct task_struct *p, int prev_cpu)
+{
+	struct root_domain *rd = cpu_rq(smp_processor_id())->rd;
+	unsigned long util = task_util(p);
+	long best_delta = LONG_MAX;
+	int cpu, best_cpu = -1;
+
+	for_each_cpu_and(cpu, rd->span, tsk_cpus_allowed(p)) {
+		const struct sched_energy *se = arch_sched_energy(cpu);
+		unsigned long cur = cpu_util(cpu);
+		long delta;
+
+		if (!se)
+			return -1;
+
+		if (!cpu_online(cpu))
+			continue;
+
+		/* the task is already accounted on its previous cpu */
+		if (cpu == prev_cpu)
+			cur -= min(cur, util);
+
+		if ((cur + util) * capacity_margin >
+		    capacity_orig_of(cpu) * SCHED_CAPACITY_SCALE)
+			continue;
+
+		delta = cpu_energy(se, cpu, cur + util) -
+			cpu_energy(se, cpu, cur);
+
+		/* ties go to the previous cpu, its caches are still warm */
+		if (delta < best_delta ||
+		    (delta == best_delta && cpu == prev_cpu)) {
+			best_delta = delta;
+			best_cpu = cpu;
+		}
+	}
+
+	if (best_cpu >= 0)
+		trace_sched_energy_wake_cpu(p, prev_cpu, best_cpu, util,
+					    best_delta);
+
+	return best_cpu;
+}
+
 /*
  * select_task_rq_fair: Select target runqueue for the waking task in domains
  * that have the 'sd_flag' flag set. In practice, this is SD_BALANCE_WAKE,
@@ -4554,6 +4691,14 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int sd_flag, int wake_f
 		want_affine = cpumask_test_cpu(cpu, tsk_cpus_allowed(p));
 
 	rcu_read_lock();
+	if ((sd_flag & SD_BALANCE_WAKE) && energy_aware() &&
+	    !cpu_rq(cpu)->rd->overutilized) {
+		new_cpu = energy_aware_wake_cpu(p, prev_cpu);
+		if (new_cpu >= 0)
+			goto unlock;
+		new_cpu = cpu;
+	}
+
 	for_each_domain(cpu, tmp) {
 		if (!(tmp->flags & SD_LOAD_BALANCE))
 			continue;
@@ -5799,6 +5944,7 @@ static void update_cpu_capacity(struct sched_domain *sd, int cpu)
 
 	capacity >>= SCHED_CAPACITY_SHIFT;
 
+	cpu_rq(cpu)->cpu_capacity_orig = capacity;
 	sdg->sgc->capacity_orig = capacity;
 
 	if (sched_feat(ARCH_CAPACITY))
@@ -5994,11 +6140,12 @@ group_classify(struct sched_group *group, struct sg_lb_stats *sgs)
  * @local_group: Does group contain this_cpu.
  * @sgs: variable to hold the statistics for this group.
  * @overload: Indicate more than one runnable task for any CPU.
+ * @overutilized: Indicate a CPU over its utilization tipping point.
  */
 static inline void update_sg_lb_stats(struct lb_env *env,
 			struct sched_group *group, int load_idx,
 			int local_group, struct sg_lb_stats *sgs,
-			bool *overload)
+			bool *overload, bool *overutilized)
 {
 	unsigned long load;
 	int i;
@@ -6020,6 +6167,9 @@ static inline void update_sg_lb_stats(struct lb_env *env,
 		if (rq->nr_running > 1)
 			*overload = true;
 
+		if (cpu_overutilized(i))
+			*overutilized = true;
+
 #ifdef CONFIG_NUMA_BALANCING
 		sgs->nr_numa_running += rq->nr_numa_running;
 		sgs->nr_preferred_running += rq->nr_preferred_running;
@@ -6134,7 +6284,7 @@ static inline void update_sd_lb_stats(struct lb_env *env, struct sd_lb_stats *sd
 	struct sched_group *sg = env->sd->groups;
 	struct sg_lb_stats tmp_sgs;
 	int load_idx, prefer_sibling = 0;
-	bool overload = false;
+	bool overload = false, overutilized = false;
 
 	if (child && child->flags & SD_PREFER_SIBLING)
 		prefer_sibling = 1;
@@ -6156,7 +6306,7 @@ static inline void update_sd_lb_stats(struct lb_env *env, struct sd_lb_stats *sd
 		}
 
 		update_sg_lb_stats(env, sg, load_idx, local_group, sgs,
-						&overload);
+						&overload, &overutilized);
 
 		if (local_group)
 			goto next_group;
@@ -6195,6 +6345,8 @@ next_group:
 		/* update overload indicator if we are at root domain */
 		if (env->dst_rq->rd->overload != overload)
 			env->dst_rq->rd->overload = overload;
+
+		set_overutilized(env->dst_rq->rd, overutilized);
 	}
 
 }
@@ -6419,6 +6571,13 @@ static struct sched_group *find_busiest_group(struct lb_env *env)
 	local = &sds.local_stat;
 	busiest = &sds.busiest_stat;
 
+	/*
+	 * While there is spare capacity everywhere, wakeup placement keeps
+	 * tasks where they cost the least energy, don't undo that.
+	 */
+	if (energy_aware() && !env->dst_rq->rd->overutilized)
+		goto out_balanced;
+
 	if ((env->idle == CPU_IDLE || env->idle == CPU_NEWLY_IDLE) &&
 	    check_asym_packing(env, &sds))
 		return sds.busiest;
@@ -6491,6 +6650,17 @@ out_balanced:
 /*
  * find_busiest_queue - find the busiest runqueue among the cpus in group.
  */
+/*
+ * A cpu running a single task that needs more capacity than it has, while
+ * the destination has more.
+ */
+static bool cpu_misfit(struct lb_env *env, int cpu)
+{
+	return energy_aware() && cpu_rq(cpu)->nr_running == 1 &&
+		cpu_overutilized(cpu) &&
+		capacity_orig_of(env->dst_cpu) > capacity_orig_of(cpu);
+}
+
 static struct rq *find_busiest_queue(struct lb_env *env,
 				     struct sched_group *group)
 {
@@ -6538,7 +6708,8 @@ static struct rq *find_busiest_queue(struct lb_env *env,
 		 * When comparing with imbalance, use weighted_cpuload()
 		 * which is not scaled with the cpu capacity.
 		 */
-		if (capacity_factor && rq->nr_running == 1 && wl > env->imbalance)
+		if (capacity_factor && rq->nr_running == 1 &&
+		    wl > env->imbalance && !cpu_misfit(env, i))
 			continue;
 
 		/*
@@ -6575,6 +6746,10 @@ static int need_active_balance(struct lb_env *env)
 {
 	struct sched_domain *sd = env->sd;
 
+	/* move a task that outgrew its cpu to a bigger idle one */
+	if (env->idle != CPU_NOT_IDLE && cpu_misfit(env, env->src_cpu))
+		return 1;
+
 	if (env->idle == CPU_NEWLY_IDLE) {
 
 		/*
@@ -7532,6 +7707,11 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 		task_tick_numa(rq, curr);
 
 	update_rq_runnable_avg(rq, 1);
+
+#ifdef CONFIG_SMP
+	if (!rq->rd->overutilized && cpu_overutilized(cpu_of(rq)))
+		set_overutilized(rq->rd, true);
+#endif
 }
 
 /*
@@ -60,6 +60,13 @@ SCHED_FEAT(FORCE_SD_OVERLAP, false)
 SCHED_FEAT(RT_RUNTIME_SHARE, true)
 SCHED_FEAT(LB_MIN, false)
 
+/*
+ * Place waking tasks on the cpu where they add the least energy according
+ * to the energy model of the platform, and leave load balancing alone
+ * while no cpu is over its utilization tipping point.
+ */
+SCHED_FEAT(ENERGY_AWARE, false)
+
 /*
  * Apply the automatic NUMA scheduling policy. Enabled automatically
  * at runtime if running on a NUMA machine. Can be controlled via
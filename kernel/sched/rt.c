@@ -1246,6 +1246,8 @@ enqueue_task_rt(struct rq *rq, struct task_struct *p, int flags)
 
 	if (!task_current(rq, p) && p->nr_cpus_allowed > 1)
 		enqueue_pushable_task(rq, p);
+
+	cpufreq_update_util(rq, ULONG_MAX, 0);
 }
 
 static void dequeue_task_rt(struct rq *rq, struct task_struct *p, int flags)
@@ -2051,6 +2053,9 @@ static void task_tick_rt(struct rq *rq, struct task_struct *p, int queued)
 
 	update_curr_rt(rq);
 
+	/* rt tasks run at the highest frequency */
+	cpufreq_update_util(rq, ULONG_MAX, 0);
+
 	watchdog(rq, p);
 
 	/*
@@ -171,6 +171,10 @@ static inline int dl_bandwidth_enabled(void)
 
 extern struct dl_bw *dl_bw_of(int i);
 
+/* bandwidths are fixed point fractions of a cpu */
+#define BW_SHIFT	20
+#define BW_UNIT		(1ULL << BW_SHIFT)
+
 struct dl_bw {
 	raw_spinlock_t lock;
 	u64 bw, total_bw;
@@ -441,6 +445,16 @@ struct dl_rq {
 
 	unsigned long dl_nr_running;
 
+	/*
+	 * Sum of the bandwidths of the runnable -deadline tasks, the share
+	 * of the cpu the others leave free is reclaimed by tasks that ask
+	 * for it with SCHED_FLAG_RECLAIM.
+	 */
+	u64 running_bw;
+
+	/* time spent running -deadline tasks */
+	u64 exec_clock;
+
 #ifdef CONFIG_SMP
 	/*
 	 * Deadline values of the currently executing and the
@@ -488,6 +502,9 @@ struct root_domain {
 	/* Indicate more than one runnable task for any CPU */
 	bool overload;
 
+	/* Indicate one or more cpus over the utilization tipping point */
+	bool overutilized;
+
 	/*
 	 * The bit corresponding to a CPU gets set here if such CPU has more
 	 * than one runnable -deadline task (as it is below for RT tasks).
@@ -553,9 +570,12 @@ struct rq {
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this cpu: */
 	struct list_head leaf_cfs_rq_list;
+#endif /* CONFIG_FAIR_GROUP_SCHED */
 
+#ifdef CONFIG_SMP
+	/* how much of the time this cpu had runnable tasks */
 	struct sched_avg avg;
-#endif /* CONFIG_FAIR_GROUP_SCHED */
+#endif
 
 	/*
 	 * This is part of a global counter where only the total sum
@@ -579,6 +599,7 @@ struct rq {
 	struct sched_domain *sd;
 
 	unsigned long cpu_capacity;
+	unsigned long cpu_capacity_orig;
 
 	unsigned char idle_balance;
 	/* For active balancing */
@@ -1504,6 +1525,7 @@ extern struct sched_entity *__pick_first_entity(struct cfs_rq *cfs_rq);
 extern struct sched_entity *__pick_last_entity(struct cfs_rq *cfs_rq);
 extern void print_cfs_stats(struct seq_file *m, int cpu);
 extern void print_rt_stats(struct seq_file *m, int cpu);
+extern void print_dl_stats(struct seq_file *m, int cpu);
 
 extern void init_cfs_rq(struct cfs_rq *cfs_rq);
 extern void init_rt_rq(struct rt_rq *rt_rq, struct rq *rq);
@@ -1569,3 +1591,33 @@ static inline u64 irq_time_read(int cpu)
 }
 #endif /* CONFIG_64BIT */
 #endif /* CONFIG_IRQ_TIME_ACCOUNTING */
+
+#ifdef CONFIG_CPU_FREQ
+DECLARE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/**
+ * cpufreq_update_util - report the utilization of a cpu to cpufreq
+ * @rq: runqueue of the cpu, locked
+ * @util: current utilization
+ * @max: capacity @util is relative to
+ *
+ * Only the local cpu reports, so that the governor never has to deal with
+ * a callback for another cpu; remote updates are picked up at the next
+ * scheduler event on that cpu.
+ */
+static inline void cpufreq_update_util(struct rq *rq, unsigned long util,
+				       unsigned long max)
+{
+	struct update_util_data *data;
+
+	if (cpu_of(rq) != smp_processor_id())
+		return;
+
+	data = rcu_dereference_sched(*this_cpu_ptr(&cpufreq_update_util_data));
+	if (data)
+		data->func(data, rq_clock(rq), util, max);
+}
+#else
+static inline void cpufreq_update_util(struct rq *rq, unsigned long util,
+				       unsigned long max) {}
+#endif /* CONFIG_CPU_FREQ */
@@ -786,13 +786,16 @@ void unlock_hrtimer_base(const struct hrtimer *timer, unsigned long *flags)
  *
  * Forward the timer expiry so it will expire in the future.
  * Returns the number of overruns.
+ *
+ * A timer with slack may run before its hard expiry, so the soft
+ * expiry is used to count the overruns. Both move by the same amount.
  */
 u64 hrtimer_forward(struct hrtimer *timer, ktime_t now, ktime_t interval)
 {
 	u64 orun = 1;
 	ktime_t delta;
 
-	delta = ktime_sub(now, hrtimer_get_expires(timer));
+	delta = ktime_sub(now, hrtimer_get_softexpires(timer));
 
 	if (delta.tv64 < 0)
 		return 0;
@@ -805,7 +808,7 @@ u64 hrtimer_forward(struct hrtimer *timer, ktime_t now, ktime_t interval)
 
 		orun = ktime_divns(delta, incr);
 		hrtimer_add_expires_ns(timer, incr * orun);
-		if (hrtimer_get_expires_tv64(timer) > now.tv64)
+		if (hrtimer_get_softexpires_tv64(timer) > now.tv64)
 			return orun;
 		/*
 		 * This (and the ktime_add() below) is the
@@ -1562,17 +1565,28 @@ out:
 	return ret;
 }
 
+/**
+ * hrtimer_current_slack_ns - timer slack for a timer armed by current
+ *
+ * Timers of non realtime tasks may expire up to the task's timer slack
+ * late, so that they can be handled from the same interrupt as a
+ * neighbouring timer. Realtime and deadline tasks get no slack.
+ */
+unsigned long hrtimer_current_slack_ns(void)
+{
+	if (dl_task(current) || rt_task(current))
+		return 0;
+
+	return current->timer_slack_ns;
+}
+
 long hrtimer_nanosleep(struct timespec *rqtp, struct timespec __user *rmtp,
 		       const enum hrtimer_mode mode, const clockid_t clockid)
 {
 	struct restart_block *restart;
 	struct hrtimer_sleeper t;
 	int ret = 0;
-	unsigned long slack;
-
-	slack = current->timer_slack_ns;
-	if (dl_task(current) || rt_task(current))
-		slack = 0;
+	unsigned long slack = hrtimer_current_slack_ns();
 
 	hrtimer_init_on_stack(&t.timer, clockid, mode);
 	hrtimer_set_expires_range_ns(&t.timer, timespec_to_ktime(*rqtp), slack);
@@ -620,6 +620,20 @@ void update_max_tr_single(struct trace_array *tr,
 			  struct task_struct *tsk, int cpu);
 #endif /* CONFIG_TRACER_MAX_TRACE */
 
+enum {
+	LAT_HIST_IRQSOFF,
+	LAT_HIST_PREEMPTOFF,
+	LAT_HIST_PREEMPTIRQSOFF,
+	LAT_HIST_WAKEUP,
+	LAT_HIST_NR,
+};
+
+#ifdef CONFIG_LATENCY_HIST
+void latency_hist_add(int type, int cpu, cycle_t delta);
+#else
+static inline void latency_hist_add(int type, int cpu, cycle_t delta) { }
+#endif
+
 #ifdef CONFIG_STACKTRACE
 void ftrace_trace_stack(struct ring_buffer *buffer, unsigned long flags,
 			int skip, int pc);
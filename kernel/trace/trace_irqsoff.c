@@ -31,6 +31,7 @@ enum {
 };
 
 static int trace_type __read_mostly;
+static int hist_type __read_mostly;
 
 static int save_flags;
 static bool function_enabled;
@@ -60,12 +61,15 @@ irq_trace(void)
 #endif
 
 #define TRACE_DISPLAY_GRAPH	1
+#define TRACE_PERCPU_MAX	2
 
 static struct tracer_opt trace_opts[] = {
 #ifdef CONFIG_FUNCTION_GRAPH_TRACER
 	/* display latency trace as call graph */
 	{ TRACER_OPT(display-graph, TRACE_DISPLAY_GRAPH) },
 #endif
+	/* keep the worst trace of each cpu instead of the global one */
+	{ TRACER_OPT(percpu-max, TRACE_PERCPU_MAX) },
 	{ } /* Empty entry */
 };
 
@@ -75,6 +79,14 @@ static struct tracer_flags tracer_flags = {
 };
 
 #define is_graph() (tracer_flags.val & TRACE_DISPLAY_GRAPH)
+#define is_percpu_max() (tracer_flags.val & TRACE_PERCPU_MAX)
+
+/*
+ * Maximum of each cpu with percpu-max. It never exceeds the global
+ * maximum, so writing tracing_max_latency restarts the search on all
+ * cpus.
+ */
+static DEFINE_PER_CPU(cycle_t, cpu_max_latency);
 
 /*
  * Sequence count - we record it when starting a measurement and
@@ -159,6 +171,9 @@ irqsoff_set_flag(struct trace_array *tr, u32 old_flags, u32 bit, int set)
 {
 	int cpu;
 
+	if (bit == TRACE_PERCPU_MAX)
+		return 0;
+
 	if (!(bit & TRACE_DISPLAY_GRAPH))
 		return -EINVAL;
 
@@ -264,7 +279,7 @@ __trace_function(struct trace_array *tr,
 static int
 irqsoff_set_flag(struct trace_array *tr, u32 old_flags, u32 bit, int set)
 {
-	return -EINVAL;
+	return bit == TRACE_PERCPU_MAX ? 0 : -EINVAL;
 }
 
 static int irqsoff_graph_entry(struct ftrace_graph_ent *trace)
@@ -297,13 +312,18 @@ static void irqsoff_print_header(struct seq_file *s)
 /*
  * Should this new latency be reported/recorded?
  */
-static int report_latency(struct trace_array *tr, cycle_t delta)
+static int report_latency(struct trace_array *tr, cycle_t delta, int cpu)
 {
+	cycle_t max = tr->max_latency;
+
+	if (is_percpu_max())
+		max = min_t(cycle_t, max, per_cpu(cpu_max_latency, cpu));
+
 	if (tracing_thresh) {
 		if (delta < tracing_thresh)
 			return 0;
 	} else {
-		if (delta <= tr->max_latency)
+		if (delta <= max)
 			return 0;
 	}
 	return 1;
@@ -327,13 +347,15 @@ check_critical_timing(struct trace_array *tr,
 
 	pc = preempt_count();
 
-	if (!report_latency(tr, delta))
+	latency_hist_add(hist_type, cpu, delta);
+
+	if (!report_latency(tr, delta, cpu))
 		goto out;
 
 	raw_spin_lock_irqsave(&max_trace_lock, flags);
 
 	/* check if we are still the max latency */
-	if (!report_latency(tr, delta))
+	if (!report_latency(tr, delta, cpu))
 		goto out_unlock;
 
 	__trace_function(tr, CALLER_ADDR0, parent_ip, flags, pc);
@@ -346,7 +368,8 @@ check_critical_timing(struct trace_array *tr,
 	data->critical_end = parent_ip;
 
 	if (likely(!is_tracing_stopped())) {
-		tr->max_latency = delta;
+		per_cpu(cpu_max_latency, cpu) = delta;
+		tr->max_latency = max_t(cycle_t, tr->max_latency, delta);
 		update_max_tr_single(tr, current, cpu);
 	}
 
@@ -601,6 +624,8 @@ static bool irqsoff_busy;
 
 static int __irqsoff_tracer_init(struct trace_array *tr)
 {
+	int cpu;
+
 	if (irqsoff_busy)
 		return -EBUSY;
 
@@ -611,6 +636,8 @@ static int __irqsoff_tracer_init(struct trace_array *tr)
 	set_tracer_flag(tr, TRACE_ITER_LATENCY_FMT, 1);
 
 	tr->max_latency = 0;
+	for_each_possible_cpu(cpu)
+		per_cpu(cpu_max_latency, cpu) = 0;
 	irqsoff_trace = tr;
 	/* make sure that the tracer is visible */
 	smp_wmb();
@@ -655,6 +682,7 @@ static void irqsoff_tracer_stop(struct trace_array *tr)
 static int irqsoff_tracer_init(struct trace_array *tr)
 {
 	trace_type = TRACER_IRQS_OFF;
+	hist_type = LAT_HIST_IRQSOFF;
 
 	return __irqsoff_tracer_init(tr);
 }
@@ -688,6 +716,7 @@ static struct tracer irqsoff_tracer __read_mostly =
 static int preemptoff_tracer_init(struct trace_array *tr)
 {
 	trace_type = TRACER_PREEMPT_OFF;
+	hist_type = LAT_HIST_PREEMPTOFF;
 
 	return __irqsoff_tracer_init(tr);
 }
@@ -724,6 +753,7 @@ static struct tracer preemptoff_tracer __read_mostly =
 static int preemptirqsoff_tracer_init(struct trace_array *tr)
 {
 	trace_type = TRACER_IRQS_OFF | TRACER_PREEMPT_OFF;
+	hist_type = LAT_HIST_PREEMPTIRQSOFF;
 
 	return __irqsoff_tracer_init(tr);
 }
@@ -0,0 +1,140 @@
+/*
+ * Latency histograms of the latency tracers
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Every latency measured by the irqsoff, preemptoff, preemptirqsoff and
+ * wakeup tracers is counted in a per cpu histogram, whether or not it is
+ * a new maximum, in /sys/kernel/debug/tracing/latency_hist/cpu<n>.
+ * Writing to a file clears its histograms.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+
+#include "trace.h"
+
+/*
+ * Bucket 0 counts latencies below 1us, bucket n the ones in
+ * [2^(n-1), 2^n) us and the last one everything above.
+ */
+#define LAT_HIST_BUCKETS	20
+
+static const char * const lat_hist_names[LAT_HIST_NR] = {
+	[LAT_HIST_IRQSOFF]		= "irqsoff",
+	[LAT_HIST_PREEMPTOFF]		= "preemptoff",
+	[LAT_HIST_PREEMPTIRQSOFF]	= "preemptirqsoff",
+	[LAT_HIST_WAKEUP]		= "wakeup",
+};
+
+/*
+ * Only the cpu a histogram belongs to updates it, with interrupts or
+ * preemption disabled. A preemptoff section ended from an interrupt
+ * can race with the one it interrupted and lose a count; that is fine
+ * for statistics.
+ */
+struct lat_hist {
+	unsigned long		count[LAT_HIST_NR][LAT_HIST_BUCKETS];
+	u64			max_ns[LAT_HIST_NR];
+};
+
+static DEFINE_PER_CPU(struct lat_hist, lat_hist);
+
+void latency_hist_add(int type, int cpu, cycle_t delta)
+{
+	struct lat_hist *hist = &per_cpu(lat_hist, cpu);
+	u32 us;
+
+	/* a 32bit division, this runs for every critical section */
+	us = (u32)min_t(u64, delta, U32_MAX) / NSEC_PER_USEC;
+	hist->count[type][min(fls(us), LAT_HIST_BUCKETS - 1)]++;
+	if (delta > hist->max_ns[type])
+		hist->max_ns[type] = delta;
+}
+
+static int lat_hist_show(struct seq_file *m, void *v)
+{
+	struct lat_hist *hist = &per_cpu(lat_hist, (long)m->private);
+	int i, t;
+
+	seq_printf(m, "%16s", "usecs");
+	for (t = 0; t < LAT_HIST_NR; t++)
+		seq_printf(m, " %14s", lat_hist_names[t]);
+	seq_putc(m, '\n');
+
+	for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+		if (!i)
+			seq_printf(m, "%7u - %6u", 0, 1);
+		else if (i < LAT_HIST_BUCKETS - 1)
+			seq_printf(m, "%7u - %6u", 1U << (i - 1), 1U << i);
+		else
+			seq_printf(m, "%7u - %6s", 1U << (i - 1), "inf");
+
+		for (t = 0; t < LAT_HIST_NR; t++)
+			seq_printf(m, " %14lu", hist->count[t][i]);
+		seq_putc(m, '\n');
+	}
+
+	seq_printf(m, "%16s", "max");
+	for (t = 0; t < LAT_HIST_NR; t++)
+		seq_printf(m, " %14llu", div_u64(hist->max_ns[t],
+						 NSEC_PER_USEC));
+	seq_putc(m, '\n');
+	return 0;
+}
+
+static int lat_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lat_hist_show, inode->i_private);
+}
+
+static ssize_t lat_hist_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	long cpu = (long)file_inode(file)->i_private;
+	struct lat_hist *hist = &per_cpu(lat_hist, cpu);
+
+	memset(hist, 0, sizeof(*hist));
+	return count;
+}
+
+static const struct file_operations lat_hist_fops = {
+	.open		= lat_hist_open,
+	.read		= seq_read,
+	.write		= lat_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static __init int latency_hist_init(void)
+{
+	struct dentry *d_tracer, *dir;
+	char name[16];
+	long cpu;
+
+	d_tracer = tracing_init_dentry();
+	if (!d_tracer)
+		return 0;
+
+	dir = debugfs_create_dir("latency_hist", d_tracer);
+	if (!dir) {
+		pr_warning("Could not create debugfs 'latency_hist' entry\n");
+		return 0;
+	}
+
+	for_each_possible_cpu(cpu) {
+		snprintf(name, sizeof(name), "cpu%ld", cpu);
+		trace_create_file(name, 0644, dir, (void *)cpu,
+				  &lat_hist_fops);
+	}
+
+	return 0;
+}
+fs_initcall(latency_hist_init);
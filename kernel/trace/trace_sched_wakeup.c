@@ -418,6 +418,8 @@ probe_wakeup_sched_switch(void *ignore,
 	T1 = ftrace_now(cpu);
 	delta = T1-T0;
 
+	latency_hist_add(LAT_HIST_WAKEUP, cpu, delta);
+
 	if (!report_latency(wakeup_trace, delta))
 		goto out_unlock;
 
@@ -48,6 +48,8 @@
 #include <linux/nodemask.h>
 #include <linux/moduleparam.h>
 #include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/topology.h>
 
 #include "workqueue_internal.h"
 
@@ -224,6 +226,23 @@ struct wq_flusher {
 
 struct wq_device;
 
+#ifdef CONFIG_WQ_STATS
+/*
+ * Per-cpu execution statistics of a workqueue, accounted on the CPU a
+ * work item was executed on.  Latency is measured from the last queueing
+ * of the work item, remote counts the work items executed outside the
+ * cache domain of the CPU they were queued on.
+ */
+struct wq_stats {
+	u64			executed;
+	u64			remote;
+	u64			exec_ns;
+	u64			exec_max_ns;
+	u64			latency_ns;
+	u64			latency_max_ns;
+};
+#endif
+
 /*
  * The externally visible workqueue.  It relays the issued work items to
  * the appropriate worker_pool through its pool_workqueues.
@@ -248,7 +267,11 @@ struct workqueue_struct {
 
 	struct workqueue_attrs	*unbound_attrs;	/* WQ: only for unbound wqs */
 	struct pool_workqueue	*dfl_pwq;	/* WQ: only for unbound wqs */
+	struct pool_workqueue __rcu **cache_pwq_tbl; /* FR: unbound pwqs indexed by cpu */
 
+#ifdef CONFIG_WQ_STATS
+	struct wq_stats __percpu *stats;	/* execution statistics */
+#endif
 #ifdef CONFIG_SYSFS
 	struct wq_device	*wq_dev;	/* I: for sysfs interface */
 #endif
@@ -555,6 +578,27 @@ static struct pool_workqueue *unbound_pwq_by_node(struct workqueue_struct *wq,
 	return rcu_dereference_raw(wq->numa_pwq_tbl[node]);
 }
 
+/**
+ * unbound_pwq_by_cpu - return the unbound pool_workqueue for the given cpu
+ * @wq: the target workqueue
+ * @cpu: the cpu
+ *
+ * This is the cache-local pwq of @cpu if @wq has cache_local set and one
+ * could be created, the pwq of the NUMA node of @cpu otherwise.  The same
+ * locking rules as for unbound_pwq_by_node() apply.
+ *
+ * Return: The unbound pool_workqueue for @cpu.
+ */
+static struct pool_workqueue *unbound_pwq_by_cpu(struct workqueue_struct *wq,
+						 int cpu)
+{
+	struct pool_workqueue *pwq;
+
+	assert_rcu_or_wq_mutex(wq);
+	pwq = rcu_dereference_raw(wq->cache_pwq_tbl[cpu]);
+	return pwq ?: unbound_pwq_by_node(wq, cpu_to_node(cpu));
+}
+
 static unsigned int work_color_to_flags(int color)
 {
 	return color << WORK_STRUCT_COLOR_SHIFT;
@@ -1228,6 +1272,78 @@ fail:
 	return -EAGAIN;
 }
 
+/* what process_one_work() samples of a work item for the wq statistics */
+struct wq_exec_sample {
+#ifdef CONFIG_WQ_STATS
+	u64			queued_ns;
+	u64			start_ns;
+	int			queued_cpu;
+	int			cpu;
+#endif
+};
+
+#ifdef CONFIG_WQ_STATS
+static int wq_alloc_stats(struct workqueue_struct *wq)
+{
+	wq->stats = alloc_percpu(struct wq_stats);
+	return wq->stats ? 0 : -ENOMEM;
+}
+
+static void wq_free_stats(struct workqueue_struct *wq)
+{
+	free_percpu(wq->stats);
+}
+
+static void wq_stats_queue(struct work_struct *work)
+{
+	work->queued_ns = ktime_get_ns();
+	work->queued_cpu = raw_smp_processor_id();
+}
+
+/* called with pool->lock held when @work is claimed for execution */
+static void wq_stats_start(struct wq_exec_sample *sample,
+			   struct work_struct *work)
+{
+	sample->queued_ns = work->queued_ns;
+	sample->queued_cpu = work->queued_cpu;
+	sample->start_ns = ktime_get_ns();
+	sample->cpu = raw_smp_processor_id();
+}
+
+/* called with pool->lock held after the work function returned */
+static void wq_stats_end(struct workqueue_struct *wq,
+			 struct wq_exec_sample *sample)
+{
+	struct wq_stats *stats = this_cpu_ptr(wq->stats);
+	u64 exec = ktime_get_ns() - sample->start_ns;
+	u64 latency = sample->start_ns - sample->queued_ns;
+
+	stats->executed++;
+	if (!cpumask_test_cpu(sample->cpu,
+			      topology_core_cpumask(sample->queued_cpu)))
+		stats->remote++;
+
+	stats->exec_ns += exec;
+	if (exec > stats->exec_max_ns)
+		stats->exec_max_ns = exec;
+
+	stats->latency_ns += latency;
+	if (latency > stats->latency_max_ns)
+		stats->latency_max_ns = latency;
+}
+#else
+static inline int wq_alloc_stats(struct workqueue_struct *wq)
+{
+	return 0;
+}
+static inline void wq_free_stats(struct workqueue_struct *wq) { }
+static inline void wq_stats_queue(struct work_struct *work) { }
+static inline void wq_stats_start(struct wq_exec_sample *sample,
+				  struct work_struct *work) { }
+static inline void wq_stats_end(struct workqueue_struct *wq,
+				struct wq_exec_sample *sample) { }
+#endif
+
 /**
  * insert_work - insert a work into a pool
  * @pwq: pwq @work belongs to
@@ -1249,6 +1365,7 @@ static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 	/* we own @work, set data and link */
 	set_work_pwq(work, pwq, extra_flags);
 	list_add_tail(&work->entry, head);
+	wq_stats_queue(work);
 	get_pwq(pwq);
 
 	/*
@@ -1309,7 +1426,7 @@ retry:
 	if (!(wq->flags & WQ_UNBOUND))
 		pwq = per_cpu_ptr(wq->cpu_pwqs, cpu);
 	else
-		pwq = unbound_pwq_by_node(wq, cpu_to_node(cpu));
+		pwq = unbound_pwq_by_cpu(wq, cpu);
 
 	/*
 	 * If @work was previously on a different pool, it might still be
@@ -1950,6 +2067,7 @@ __acquires(&pool->lock)
 	bool cpu_intensive = pwq->wq->flags & WQ_CPU_INTENSIVE;
 	int work_color;
 	struct worker *collision;
+	struct wq_exec_sample sample;
 #ifdef CONFIG_LOCKDEP
 	/*
 	 * It is permissible to free the struct work_struct from
@@ -2015,6 +2133,8 @@ __acquires(&pool->lock)
 	 */
 	set_work_pool_and_clear_pending(work, pool->id);
 
+	wq_stats_start(&sample, work);
+
 	spin_unlock_irq(&pool->lock);
 
 	lock_map_acquire_read(&pwq->wq->lockdep_map);
@@ -2050,6 +2170,8 @@ __acquires(&pool->lock)
 
 	spin_lock_irq(&pool->lock);
 
+	wq_stats_end(pwq->wq, &sample);
+
 	/* clear cpu intensive status */
 	if (unlikely(cpu_intensive))
 		worker_clr_flags(worker, WORKER_CPU_INTENSIVE);
@@ -2991,9 +3113,42 @@ static ssize_t max_active_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(max_active);
 
+#ifdef CONFIG_WQ_STATS
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct wq_stats sum = { };
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct wq_stats *stats = per_cpu_ptr(wq->stats, cpu);
+
+		sum.executed += stats->executed;
+		sum.remote += stats->remote;
+		sum.exec_ns += stats->exec_ns;
+		sum.exec_max_ns = max(sum.exec_max_ns, stats->exec_max_ns);
+		sum.latency_ns += stats->latency_ns;
+		sum.latency_max_ns = max(sum.latency_max_ns,
+					 stats->latency_max_ns);
+	}
+
+	return scnprintf(buf, PAGE_SIZE,
+			 "executed %llu\nremote %llu\n"
+			 "exec_ns %llu\nexec_max_ns %llu\n"
+			 "latency_ns %llu\nlatency_max_ns %llu\n",
+			 sum.executed, sum.remote, sum.exec_ns,
+			 sum.exec_max_ns, sum.latency_ns, sum.latency_max_ns);
+}
+static DEVICE_ATTR_RO(stats);
+#endif
+
 static struct attribute *wq_sysfs_attrs[] = {
 	&dev_attr_per_cpu.attr,
 	&dev_attr_max_active.attr,
+#ifdef CONFIG_WQ_STATS
+	&dev_attr_stats.attr,
+#endif
 	NULL,
 };
 ATTRIBUTE_GROUPS(wq_sysfs);
@@ -3136,11 +3291,48 @@ static ssize_t wq_numa_store(struct device *dev, struct device_attribute *attr,
 	return ret ?: count;
 }
 
+static ssize_t wq_cache_local_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	int written;
+
+	mutex_lock(&wq->mutex);
+	written = scnprintf(buf, PAGE_SIZE, "%d\n",
+			    wq->unbound_attrs->cache_local);
+	mutex_unlock(&wq->mutex);
+
+	return written;
+}
+
+static ssize_t wq_cache_local_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct workqueue_struct *wq = dev_to_wq(dev);
+	struct workqueue_attrs *attrs;
+	int v, ret;
+
+	attrs = wq_sysfs_prep_attrs(wq);
+	if (!attrs)
+		return -ENOMEM;
+
+	ret = -EINVAL;
+	if (sscanf(buf, "%d", &v) == 1) {
+		attrs->cache_local = !!v;
+		ret = apply_workqueue_attrs(wq, attrs);
+	}
+
+	free_workqueue_attrs(attrs);
+	return ret ?: count;
+}
+
 static struct device_attribute wq_sysfs_unbound_attrs[] = {
 	__ATTR(pool_ids, 0444, wq_pool_ids_show, NULL),
 	__ATTR(nice, 0644, wq_nice_show, wq_nice_store),
 	__ATTR(cpumask, 0644, wq_cpumask_show, wq_cpumask_store),
 	__ATTR(numa, 0644, wq_numa_show, wq_numa_store),
+	__ATTR(cache_local, 0644, wq_cache_local_show, wq_cache_local_store),
 	__ATTR_NULL,
 };
 
@@ -3297,10 +3489,12 @@ static void copy_workqueue_attrs(struct workqueue_attrs *to,
 	cpumask_copy(to->cpumask, from->cpumask);
 	/*
 	 * Unlike hash and equality test, this function doesn't ignore
-	 * ->no_numa as it is used for both pool and wq attrs.  Instead,
-	 * get_unbound_pool() explicitly clears ->no_numa after copying.
+	 * ->no_numa and ->cache_local as they are used for both pool and wq
+	 * attrs.  Instead, get_unbound_pool() explicitly clears them after
+	 * copying.
 	 */
 	to->no_numa = from->no_numa;
+	to->cache_local = from->cache_local;
 }
 
 /* hash value of the content of @attr */
@@ -3478,10 +3672,11 @@ static struct worker_pool *get_unbound_pool(const struct workqueue_attrs *attrs)
 	copy_workqueue_attrs(pool->attrs, attrs);
 
 	/*
-	 * no_numa isn't a worker_pool attribute, always clear it.  See
-	 * 'struct workqueue_attrs' comments for detail.
+	 * no_numa and cache_local aren't worker_pool attributes, always
+	 * clear them.  See 'struct workqueue_attrs' comments for detail.
 	 */
 	pool->attrs->no_numa = false;
+	pool->attrs->cache_local = false;
 
 	/* if cpumask is contained inside a NUMA node, we belong to that node */
 	if (wq_numa_enabled) {
@@ -3549,6 +3744,8 @@ static void pwq_unbound_release_workfn(struct work_struct *work)
 	 */
 	if (is_last) {
 		free_workqueue_attrs(wq->unbound_attrs);
+		kfree(wq->cache_pwq_tbl);
+		wq_free_stats(wq);
 		kfree(wq);
 	}
 }
@@ -3734,6 +3931,81 @@ static struct pool_workqueue *numa_pwq_tbl_install(struct workqueue_struct *wq,
 	return old_pwq;
 }
 
+/**
+ * wq_calc_cache_cpumask - calculate a wq_attrs' cpumask for a cache domain
+ * @attrs: the wq_attrs of interest
+ * @cpu: a CPU of the cache domain of interest
+ * @cpu_going_down: if >= 0, the CPU to consider as offline
+ * @cpumask: outarg, the resulting cpumask
+ *
+ * The cache domain of @cpu is the set of CPUs sharing its last level of
+ * cache, topology_core_cpumask() - a cluster on ARM.  Calculate the
+ * cpumask a cache-local pwq of @cpu should use: the CPUs of the domain
+ * @attrs->cpumask allows.
+ *
+ * Return: %true if the domain has online CPUs @attrs->cpumask allows and
+ * the resulting @cpumask is different from @attrs->cpumask, %false if @cpu
+ * should fall back to its NUMA pwq.
+ */
+static bool wq_calc_cache_cpumask(const struct workqueue_attrs *attrs,
+				  int cpu, int cpu_going_down,
+				  cpumask_t *cpumask)
+{
+	/* does the cache domain have any online CPUs @attrs wants? */
+	cpumask_and(cpumask, topology_core_cpumask(cpu), attrs->cpumask);
+	cpumask_and(cpumask, cpumask, cpu_online_mask);
+	if (cpu_going_down >= 0)
+		cpumask_clear_cpu(cpu_going_down, cpumask);
+
+	if (cpumask_empty(cpumask))
+		return false;
+
+	cpumask_and(cpumask, topology_core_cpumask(cpu), attrs->cpumask);
+	return !cpumask_equal(cpumask, attrs->cpumask);
+}
+
+/* install @pwq into @wq's cache_pwq_tbl[] for @cpu and return the old pwq */
+static struct pool_workqueue *cache_pwq_tbl_install(struct workqueue_struct *wq,
+						    int cpu,
+						    struct pool_workqueue *pwq)
+{
+	struct pool_workqueue *old_pwq;
+
+	lockdep_assert_held(&wq->mutex);
+
+	if (pwq)
+		link_pwq(pwq);
+
+	old_pwq = rcu_access_pointer(wq->cache_pwq_tbl[cpu]);
+	rcu_assign_pointer(wq->cache_pwq_tbl[cpu], pwq);
+	return old_pwq;
+}
+
+/* the number of base refs @pwq has from @wq's cache_pwq_tbl[] */
+static int cache_pwq_refs(struct workqueue_struct *wq,
+			  struct pool_workqueue *pwq)
+{
+	int cpu, refs = 0;
+
+	if (!wq->cache_pwq_tbl)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		if (rcu_access_pointer(wq->cache_pwq_tbl[cpu]) == pwq)
+			refs++;
+	return refs;
+}
+
+/* drop the unlinked pwqs of a cache_pwq_tbl[], CPUs may share them */
+static void free_cache_pwq_tbl(struct pool_workqueue **tbl)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		if (tbl[cpu] && !--tbl[cpu]->refcnt)
+			free_unbound_pwq(tbl[cpu]);
+}
+
 /**
  * apply_workqueue_attrs - apply new workqueue_attrs to an unbound workqueue
  * @wq: the target workqueue
@@ -3742,9 +4014,11 @@ static struct pool_workqueue *numa_pwq_tbl_install(struct workqueue_struct *wq,
  * Apply @attrs to an unbound workqueue @wq.  Unless disabled, on NUMA
  * machines, this function maps a separate pwq to each NUMA node with
  * possibles CPUs in @attrs->cpumask so that work items are affine to the
- * NUMA node it was issued on.  Older pwqs are released as in-flight work
- * items finish.  Note that a work item which repeatedly requeues itself
- * back-to-back will stay on its current pwq.
+ * NUMA node it was issued on.  If @attrs->cache_local is set, a pwq is
+ * also mapped to each cache domain so that work items run on the cluster
+ * they were issued on, sharing its caches.  Older pwqs are released as
+ * in-flight work items finish.  Note that a work item which repeatedly
+ * requeues itself back-to-back will stay on its current pwq.
  *
  * Performs GFP_KERNEL allocations.
  *
@@ -3754,8 +4028,8 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 			  const struct workqueue_attrs *attrs)
 {
 	struct workqueue_attrs *new_attrs, *tmp_attrs;
-	struct pool_workqueue **pwq_tbl, *dfl_pwq;
-	int node, ret;
+	struct pool_workqueue **pwq_tbl, **cache_tbl, *dfl_pwq;
+	int node, cpu, ret;
 
 	/* only unbound workqueues can change attributes */
 	if (WARN_ON(!(wq->flags & WQ_UNBOUND)))
@@ -3766,15 +4040,20 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 		return -EINVAL;
 
 	pwq_tbl = kzalloc(nr_node_ids * sizeof(pwq_tbl[0]), GFP_KERNEL);
+	cache_tbl = kcalloc(nr_cpu_ids, sizeof(cache_tbl[0]), GFP_KERNEL);
 	new_attrs = alloc_workqueue_attrs(GFP_KERNEL);
 	tmp_attrs = alloc_workqueue_attrs(GFP_KERNEL);
-	if (!pwq_tbl || !new_attrs || !tmp_attrs)
+	if (!pwq_tbl || !cache_tbl || !new_attrs || !tmp_attrs)
 		goto enomem;
 
 	/* make a copy of @attrs and sanitize it */
 	copy_workqueue_attrs(new_attrs, attrs);
 	cpumask_and(new_attrs->cpumask, new_attrs->cpumask, cpu_possible_mask);
 
+	/* an ordered workqueue must stay on a single pwq */
+	if (wq->flags & __WQ_ORDERED)
+		new_attrs->cache_local = false;
+
 	/*
 	 * We may create multiple pwqs with differing cpumasks.  Make a
 	 * copy of @new_attrs which will be modified and used to obtain
@@ -3811,6 +4090,37 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 		}
 	}
 
+	/* the CPUs of a cache domain share its pwq */
+	for_each_possible_cpu(cpu) {
+		struct pool_workqueue *pwq = NULL;
+		int sibling;
+
+		if (!new_attrs->cache_local ||
+		    !wq_calc_cache_cpumask(new_attrs, cpu, -1,
+					   tmp_attrs->cpumask))
+			continue;
+
+		for_each_cpu(sibling, topology_core_cpumask(cpu)) {
+			struct pool_workqueue *spwq = cache_tbl[sibling];
+
+			if (sibling >= cpu)
+				break;
+			if (spwq && cpumask_equal(spwq->pool->attrs->cpumask,
+						  tmp_attrs->cpumask)) {
+				pwq = spwq;
+				pwq->refcnt++;
+				break;
+			}
+		}
+
+		if (!pwq) {
+			pwq = alloc_unbound_pwq(wq, tmp_attrs);
+			if (!pwq)
+				goto enomem_pwq;
+		}
+		cache_tbl[cpu] = pwq;
+	}
+
 	mutex_unlock(&wq_pool_mutex);
 
 	/* all pwqs have been created successfully, let's install'em */
@@ -3821,6 +4131,8 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 	/* save the previous pwq and install the new one */
 	for_each_node(node)
 		pwq_tbl[node] = numa_pwq_tbl_install(wq, node, pwq_tbl[node]);
+	for_each_possible_cpu(cpu)
+		cache_tbl[cpu] = cache_pwq_tbl_install(wq, cpu, cache_tbl[cpu]);
 
 	/* @dfl_pwq might not have been used, ensure it's linked */
 	link_pwq(dfl_pwq);
@@ -3831,6 +4143,8 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 	/* put the old pwqs */
 	for_each_node(node)
 		put_pwq_unlocked(pwq_tbl[node]);
+	for_each_possible_cpu(cpu)
+		put_pwq_unlocked(cache_tbl[cpu]);
 	put_pwq_unlocked(dfl_pwq);
 
 	put_online_cpus();
@@ -3839,6 +4153,7 @@ int apply_workqueue_attrs(struct workqueue_struct *wq,
 out_free:
 	free_workqueue_attrs(tmp_attrs);
 	free_workqueue_attrs(new_attrs);
+	kfree(cache_tbl);
 	kfree(pwq_tbl);
 	return ret;
 
@@ -3847,6 +4162,7 @@ enomem_pwq:
 	for_each_node(node)
 		if (pwq_tbl && pwq_tbl[node] != dfl_pwq)
 			free_unbound_pwq(pwq_tbl[node]);
+	free_cache_pwq_tbl(cache_tbl);
 	mutex_unlock(&wq_pool_mutex);
 	put_online_cpus();
 enomem:
@@ -3949,6 +4265,65 @@ out_unlock:
 	put_pwq_unlocked(old_pwq);
 }
 
+/**
+ * wq_update_unbound_cache - update cache affinity of a wq for CPU hot[un]plug
+ * @wq: the target workqueue
+ * @cpu: the CPU coming up or going down
+ * @online: whether @cpu is coming up or going down
+ *
+ * This function is to be called from the same places as
+ * wq_update_unbound_numa().  The cache domain of @cpu gets a new pwq for
+ * the CPUs which remain online; if it has none left, or the allocation
+ * fails, the domain falls back to the NUMA pwqs.
+ */
+static void wq_update_unbound_cache(struct workqueue_struct *wq, int cpu,
+				    bool online)
+{
+	int cpu_off = online ? -1 : cpu;
+	struct pool_workqueue *old_pwq, *pwq = NULL;
+	struct workqueue_attrs *target_attrs;
+	int sibling;
+
+	lockdep_assert_held(&wq_pool_mutex);
+
+	if (!(wq->flags & WQ_UNBOUND))
+		return;
+
+	/* protected by CPU hotplug exclusion, see wq_update_unbound_numa() */
+	target_attrs = wq_update_unbound_numa_attrs_buf;
+
+	mutex_lock(&wq->mutex);
+	if (!wq->unbound_attrs->cache_local)
+		goto out_unlock;
+
+	copy_workqueue_attrs(target_attrs, wq->unbound_attrs);
+	if (wq_calc_cache_cpumask(wq->unbound_attrs, cpu, cpu_off,
+				  target_attrs->cpumask)) {
+		pwq = rcu_access_pointer(wq->cache_pwq_tbl[cpu]);
+		if (pwq && cpumask_equal(target_attrs->cpumask,
+					 pwq->pool->attrs->cpumask))
+			goto out_unlock;
+
+		mutex_unlock(&wq->mutex);
+		pwq = alloc_unbound_pwq(wq, target_attrs);
+		mutex_lock(&wq->mutex);
+		if (!pwq)
+			pr_warn("workqueue: allocation failed while updating cache affinity of \"%s\"\n",
+				wq->name);
+	}
+
+	/* @pwq isn't visible yet, take a ref for each additional CPU */
+	if (pwq)
+		pwq->refcnt += cpumask_weight(topology_core_cpumask(cpu)) - 1;
+
+	for_each_cpu(sibling, topology_core_cpumask(cpu)) {
+		old_pwq = cache_pwq_tbl_install(wq, sibling, pwq);
+		put_pwq_unlocked(old_pwq);
+	}
+out_unlock:
+	mutex_unlock(&wq->mutex);
+}
+
 static int alloc_and_link_pwqs(struct workqueue_struct *wq)
 {
 	bool highpri = wq->flags & WQ_HIGHPRI;
@@ -4021,10 +4396,16 @@ struct workqueue_struct *__alloc_workqueue_key(const char *fmt,
 
 	if (flags & WQ_UNBOUND) {
 		wq->unbound_attrs = alloc_workqueue_attrs(GFP_KERNEL);
-		if (!wq->unbound_attrs)
+		wq->cache_pwq_tbl = kcalloc(nr_cpu_ids,
+					    sizeof(wq->cache_pwq_tbl[0]),
+					    GFP_KERNEL);
+		if (!wq->unbound_attrs || !wq->cache_pwq_tbl)
 			goto err_free_wq;
 	}
 
+	if (wq_alloc_stats(wq))
+		goto err_free_wq;
+
 	va_start(args, lock_name);
 	vsnprintf(wq->name, sizeof(wq->name), fmt, args);
 	va_end(args);
@@ -4095,6 +4476,8 @@ struct workqueue_struct *__alloc_workqueue_key(const char *fmt,
 
 err_free_wq:
 	free_workqueue_attrs(wq->unbound_attrs);
+	kfree(wq->cache_pwq_tbl);
+	wq_free_stats(wq);
 	kfree(wq);
 	return NULL;
 err_destroy:
@@ -4112,7 +4495,7 @@ EXPORT_SYMBOL_GPL(__alloc_workqueue_key);
 void destroy_workqueue(struct workqueue_struct *wq)
 {
 	struct pool_workqueue *pwq;
-	int node;
+	int node, cpu;
 
 	/* drain it before proceeding with destruction */
 	drain_workqueue(wq);
@@ -4129,7 +4512,8 @@ void destroy_workqueue(struct workqueue_struct *wq)
 			}
 		}
 
-		if (WARN_ON((pwq != wq->dfl_pwq) && (pwq->refcnt > 1)) ||
+		if (WARN_ON((pwq != wq->dfl_pwq) &&
+			    (pwq->refcnt > max(cache_pwq_refs(wq, pwq), 1))) ||
 		    WARN_ON(pwq->nr_active) ||
 		    WARN_ON(!list_empty(&pwq->delayed_works))) {
 			mutex_unlock(&wq->mutex);
@@ -4160,13 +4544,21 @@ void destroy_workqueue(struct workqueue_struct *wq)
 		 * free the pwqs and wq.
 		 */
 		free_percpu(wq->cpu_pwqs);
+		wq_free_stats(wq);
 		kfree(wq);
 	} else {
 		/*
 		 * We're the sole accessor of @wq at this point.  Directly
-		 * access numa_pwq_tbl[] and dfl_pwq to put the base refs.
-		 * @wq will be freed when the last pwq is released.
+		 * access numa_pwq_tbl[], cache_pwq_tbl[] and dfl_pwq to put
+		 * the base refs.  @wq will be freed when the last pwq is
+		 * released.
 		 */
+		for_each_possible_cpu(cpu) {
+			pwq = rcu_access_pointer(wq->cache_pwq_tbl[cpu]);
+			RCU_INIT_POINTER(wq->cache_pwq_tbl[cpu], NULL);
+			put_pwq_unlocked(pwq);
+		}
+
 		for_each_node(node) {
 			pwq = rcu_access_pointer(wq->numa_pwq_tbl[node]);
 			RCU_INIT_POINTER(wq->numa_pwq_tbl[node], NULL);
@@ -4261,7 +4653,7 @@ bool workqueue_congested(int cpu, struct workqueue_struct *wq)
 	if (!(wq->flags & WQ_UNBOUND))
 		pwq = per_cpu_ptr(wq->cpu_pwqs, cpu);
 	else
-		pwq = unbound_pwq_by_node(wq, cpu_to_node(cpu));
+		pwq = unbound_pwq_by_cpu(wq, cpu);
 
 	ret = !list_empty(&pwq->delayed_works);
 	rcu_read_unlock_sched();
@@ -4584,9 +4976,11 @@ static int workqueue_cpu_up_callback(struct notifier_block *nfb,
 			mutex_unlock(&pool->attach_mutex);
 		}
 
-		/* update NUMA affinity of unbound workqueues */
-		list_for_each_entry(wq, &workqueues, list)
+		/* update NUMA and cache affinity of unbound workqueues */
+		list_for_each_entry(wq, &workqueues, list) {
 			wq_update_unbound_numa(wq, cpu, true);
+			wq_update_unbound_cache(wq, cpu, true);
+		}
 
 		mutex_unlock(&wq_pool_mutex);
 		break;
@@ -4612,10 +5006,12 @@ static int workqueue_cpu_down_callback(struct notifier_block *nfb,
 		INIT_WORK_ONSTACK(&unbind_work, wq_unbind_fn);
 		queue_work_on(cpu, system_highpri_wq, &unbind_work);
 
-		/* update NUMA affinity of unbound workqueues */
+		/* update NUMA and cache affinity of unbound workqueues */
 		mutex_lock(&wq_pool_mutex);
-		list_for_each_entry(wq, &workqueues, list)
+		list_for_each_entry(wq, &workqueues, list) {
 			wq_update_unbound_numa(wq, cpu, false);
+			wq_update_unbound_cache(wq, cpu, false);
+		}
 		mutex_unlock(&wq_pool_mutex);
 
 		/* wait for per-cpu unbinding to finish */
@@ -26,15 +26,24 @@
 
 #define HASH_DEFAULT_SIZE	64UL
 #define HASH_MIN_SIZE		4UL
+#define BUCKET_LOCKS_PER_CPU	32UL
 
 #define ASSERT_RHT_MUTEX(HT) BUG_ON(!lockdep_rht_mutex_is_held(HT))
 
 #ifdef CONFIG_PROVE_LOCKING
-int lockdep_rht_mutex_is_held(const struct rhashtable *ht)
+int lockdep_rht_mutex_is_held(struct rhashtable *ht)
 {
-	return ht->p.mutex_is_held();
+	return (debug_locks) ? lockdep_is_held(&ht->mutex) : 1;
 }
 EXPORT_SYMBOL_GPL(lockdep_rht_mutex_is_held);
+
+int lockdep_rht_bucket_is_held(const struct bucket_table *tbl, u32 hash)
+{
+	spinlock_t *lock = &tbl->locks[hash & tbl->locks_mask];
+
+	return (debug_locks) ? lockdep_is_held(lock) : 1;
+}
+EXPORT_SYMBOL_GPL(lockdep_rht_bucket_is_held);
 #endif
 
 static void *rht_obj(const struct rhashtable *ht, const struct rhash_head *he)
@@ -42,78 +51,87 @@ static void *rht_obj(const struct rhashtable *ht, const struct rhash_head *he)
 	return (void *) he - ht->p.head_offset;
 }
 
-static u32 __hashfn(const struct rhashtable *ht, const void *key,
-		      u32 len, u32 hsize)
+static u32 rht_bucket_index(const struct bucket_table *tbl, u32 hash)
 {
-	u32 h;
+	return hash & (tbl->size - 1);
+}
 
-	h = ht->p.hashfn(key, len, ht->p.hash_rnd);
+static u32 key_hashfn(const struct rhashtable *ht,
+		      const struct bucket_table *tbl, const void *key)
+{
+	return rht_bucket_index(tbl, ht->p.hashfn(key, ht->p.key_len,
+						  ht->p.hash_rnd));
+}
 
-	return h & (hsize - 1);
+static u32 obj_hashfn(const struct rhashtable *ht,
+		      const struct bucket_table *tbl, const void *ptr)
+{
+	if (unlikely(!ht->p.key_len))
+		return rht_bucket_index(tbl, ht->p.obj_hashfn(ptr,
+							      ht->p.hash_rnd));
+
+	return key_hashfn(ht, tbl, ptr + ht->p.key_offset);
 }
 
-/**
- * rhashtable_hashfn - compute hash for key of given length
- * @ht:		hash table to compute for
- * @key:	pointer to key
- * @len:	length of key
- *
- * Computes the hash value using the hash function provided in the 'hashfn'
- * of struct rhashtable_params. The returned value is guaranteed to be
- * smaller than the number of buckets in the hash table.
- */
-u32 rhashtable_hashfn(const struct rhashtable *ht, const void *key, u32 len)
+static u32 head_hashfn(const struct rhashtable *ht,
+		       const struct bucket_table *tbl,
+		       const struct rhash_head *he)
 {
-	struct bucket_table *tbl = rht_dereference_rcu(ht->tbl, ht);
+	return obj_hashfn(ht, tbl, rht_obj(ht, he));
+}
 
-	return __hashfn(ht, key, len, tbl->size);
+static spinlock_t *bucket_lock(const struct bucket_table *tbl, u32 hash)
+{
+	return &tbl->locks[hash & tbl->locks_mask];
 }
-EXPORT_SYMBOL_GPL(rhashtable_hashfn);
 
-static u32 obj_hashfn(const struct rhashtable *ht, const void *ptr, u32 hsize)
+static int alloc_bucket_locks(struct rhashtable *ht, struct bucket_table *tbl)
 {
-	if (unlikely(!ht->p.key_len)) {
-		u32 h;
+	unsigned int i, size;
+#if defined(CONFIG_PROVE_LOCKING)
+	unsigned int nr_pcpus = 2;
+#else
+	unsigned int nr_pcpus = num_possible_cpus();
+#endif
 
-		h = ht->p.obj_hashfn(ptr, ht->p.hash_rnd);
+	nr_pcpus = min_t(unsigned int, nr_pcpus, 32UL);
+	size = roundup_pow_of_two(nr_pcpus * ht->p.locks_mul);
 
-		return h & (hsize - 1);
-	}
+	/* Never allocate more than one lock per bucket */
+	size = min_t(unsigned int, size, tbl->size);
 
-	return __hashfn(ht, ptr + ht->p.key_offset, ht->p.key_len, hsize);
-}
+	if (sizeof(spinlock_t) != 0) {
+		size_t sz = size * sizeof(spinlock_t);
 
-/**
- * rhashtable_obj_hashfn - compute hash for hashed object
- * @ht:		hash table to compute for
- * @ptr:	pointer to hashed object
- *
- * Computes the hash value using the hash function `hashfn` respectively
- * 'obj_hashfn' depending on whether the hash table is set up to work with
- * a fixed length key. The returned value is guaranteed to be smaller than
- * the number of buckets in the hash table.
- */
-u32 rhashtable_obj_hashfn(const struct rhashtable *ht, void *ptr)
-{
-	struct bucket_table *tbl = rht_dereference_rcu(ht->tbl, ht);
+		tbl->locks = kmalloc(sz, GFP_KERNEL | __GFP_NOWARN);
+		if (!tbl->locks)
+			tbl->locks = vmalloc(sz);
+		if (!tbl->locks)
+			return -ENOMEM;
+		for (i = 0; i < size; i++)
+			spin_lock_init(&tbl->locks[i]);
+	}
+	tbl->locks_mask = size - 1;
 
-	return obj_hashfn(ht, ptr, tbl->size);
+	return 0;
 }
-EXPORT_SYMBOL_GPL(rhashtable_obj_hashfn);
 
-static u32 head_hashfn(const struct rhashtable *ht,
-		       const struct rhash_head *he, u32 hsize)
+static void bucket_table_free(const struct bucket_table *tbl)
 {
-	return obj_hashfn(ht, rht_obj(ht, he), hsize);
+	if (tbl)
+		kvfree(tbl->locks);
+
+	kvfree(tbl);
 }
 
-static struct bucket_table *bucket_table_alloc(size_t nbuckets, gfp_t flags)
+static struct bucket_table *bucket_table_alloc(struct rhashtable *ht,
+					       size_t nbuckets)
 {
 	struct bucket_table *tbl;
 	size_t size;
 
 	size = sizeof(*tbl) + nbuckets * sizeof(tbl->buckets[0]);
-	tbl = kzalloc(size, flags);
+	tbl = kzalloc(size, GFP_KERNEL | __GFP_NOWARN);
 	if (tbl == NULL)
 		tbl = vzalloc(size);
 
@@ -122,12 +140,12 @@ static struct bucket_table *bucket_table_alloc(size_t nbuckets, gfp_t flags)
 
 	tbl->size = nbuckets;
 
-	return tbl;
-}
+	if (alloc_bucket_locks(ht, tbl) < 0) {
+		bucket_table_free(tbl);
+		return NULL;
+	}
 
-static void bucket_table_free(const struct bucket_table *tbl)
-{
-	kvfree(tbl);
+	return tbl;
 }
 
 /**
@@ -138,7 +156,7 @@ static void bucket_table_free(const struct bucket_table *tbl)
 bool rht_grow_above_75(const struct rhashtable *ht, size_t new_size)
 {
 	/* Expand table when exceeding 75% load */
-	return ht->nelems > (new_size / 4 * 3);
+	return atomic_read(&ht->nelems) > (new_size / 4 * 3);
 }
 EXPORT_SYMBOL_GPL(rht_grow_above_75);
 
@@ -150,293 +168,317 @@ EXPORT_SYMBOL_GPL(rht_grow_above_75);
 bool rht_shrink_below_30(const struct rhashtable *ht, size_t new_size)
 {
 	/* Shrink table beneath 30% load */
-	return ht->nelems < (new_size * 3 / 10);
+	return atomic_read(&ht->nelems) < (new_size * 3 / 10);
 }
 EXPORT_SYMBOL_GPL(rht_shrink_below_30);
 
-static void hashtable_chain_unzip(const struct rhashtable *ht,
-				  const struct bucket_table *new_tbl,
-				  struct bucket_table *old_tbl, size_t n)
+/*
+ * Move the last entry of an old bucket to the new table. Taking the
+ * entries from the tail means a reader walking the old chain never
+ * loses the rest of it: at worst it wanders into the new bucket, which
+ * only costs it a few extra compares, and it looks there anyway if it
+ * misses in the old one. Called with the old bucket lock held.
+ */
+static bool rhashtable_rehash_one(struct rhashtable *ht,
+				  struct bucket_table *old_tbl,
+				  struct bucket_table *new_tbl, u32 old_hash)
 {
-	struct rhash_head *he, *p, *next;
-	unsigned int h;
+	struct rhash_head __rcu **pprev = &old_tbl->buckets[old_hash];
+	struct rhash_head *entry, *next;
+	spinlock_t *new_lock;
+	u32 new_hash;
+
+	entry = rht_dereference_bucket(*pprev, old_tbl, old_hash);
+	if (!entry)
+		return false;
+
+	while ((next = rht_dereference_bucket(entry->next, old_tbl,
+					      old_hash))) {
+		pprev = &entry->next;
+		entry = next;
+	}
 
-	/* Old bucket empty, no work needed. */
-	p = rht_dereference(old_tbl->buckets[n], ht);
-	if (!p)
-		return;
+	new_hash = head_hashfn(ht, new_tbl, entry);
+	new_lock = bucket_lock(new_tbl, new_hash);
 
-	/* Advance the old bucket pointer one or more times until it
-	 * reaches a node that doesn't hash to the same bucket as the
-	 * previous node p. Call the previous node p;
-	 */
-	h = head_hashfn(ht, p, new_tbl->size);
-	rht_for_each(he, p->next, ht) {
-		if (head_hashfn(ht, he, new_tbl->size) != h)
-			break;
-		p = he;
-	}
-	RCU_INIT_POINTER(old_tbl->buckets[n], p->next);
+	spin_lock_nested(new_lock, SINGLE_DEPTH_NESTING);
+	RCU_INIT_POINTER(entry->next,
+			 rht_dereference_bucket(new_tbl->buckets[new_hash],
+						new_tbl, new_hash));
+	rcu_assign_pointer(new_tbl->buckets[new_hash], entry);
+	spin_unlock(new_lock);
 
-	/* Find the subsequent node which does hash to the same
-	 * bucket as node P, or NULL if no such node exists.
-	 */
-	next = NULL;
-	if (he) {
-		rht_for_each(he, he->next, ht) {
-			if (head_hashfn(ht, he, new_tbl->size) == h) {
-				next = he;
-				break;
-			}
-		}
+	/* readers that no longer find it in the old bucket must see it */
+	smp_wmb();
+	RCU_INIT_POINTER(*pprev, NULL);
+
+	return true;
+}
+
+static void rhashtable_rehash_chain(struct rhashtable *ht,
+				    struct bucket_table *old_tbl,
+				    struct bucket_table *new_tbl, u32 old_hash)
+{
+	spinlock_t *old_lock = bucket_lock(old_tbl, old_hash);
+
+	spin_lock_bh(old_lock);
+	while (rhashtable_rehash_one(ht, old_tbl, new_tbl, old_hash))
+		;
+	spin_unlock_bh(old_lock);
+}
+
+/*
+ * Resize by moving every entry to a new table while the old one stays
+ * live. Once the new table hangs off old_tbl->future_tbl, inserts go
+ * straight to it, and lookups and removals that miss in the old table
+ * retry in it. Each old bucket is emptied under its lock only, so the
+ * rest of the table keeps taking updates meanwhile.
+ */
+static int rhashtable_rehash(struct rhashtable *ht, size_t size)
+{
+	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
+	struct bucket_table *new_tbl;
+	u32 old_hash;
+
+	new_tbl = bucket_table_alloc(ht, size);
+	if (new_tbl == NULL)
+		return -ENOMEM;
+
+	rcu_assign_pointer(old_tbl->future_tbl, new_tbl);
+
+	for (old_hash = 0; old_hash < old_tbl->size; old_hash++) {
+		rhashtable_rehash_chain(ht, old_tbl, new_tbl, old_hash);
+		cond_resched();
 	}
 
-	/* Set p's next pointer to that subsequent node pointer,
-	 * bypassing the nodes which do not hash to p's bucket
+	/* Publish the new table pointer. */
+	rcu_assign_pointer(ht->tbl, new_tbl);
+	ht->shift = ilog2(new_tbl->size);
+
+	/* Wait for readers and for the updaters that still started from
+	 * the old table. None of them can be left once this returns, so
+	 * the next resize only ever deals with two tables.
 	 */
-	RCU_INIT_POINTER(p->next, next);
+	synchronize_rcu();
+
+	bucket_table_free(old_tbl);
+	return 0;
 }
 
 /**
  * rhashtable_expand - Expand hash table while allowing concurrent lookups
  * @ht:		the hash table to expand
- * @flags:	allocation flags
  *
  * A secondary bucket array is allocated and the hash entries are migrated
- * while keeping them on both lists until the end of the RCU grace period.
+ * bucket by bucket under the bucket locks.
  *
  * This function may only be called in a context where it is safe to call
  * synchronize_rcu(), e.g. not within a rcu_read_lock() section.
  *
- * The caller must ensure that no concurrent table mutations take place.
- * It is however valid to have concurrent lookups if they are RCU protected.
+ * The caller must hold ht->mutex. Lookups, insertions and removals may
+ * run concurrently.
  */
-int rhashtable_expand(struct rhashtable *ht, gfp_t flags)
+int rhashtable_expand(struct rhashtable *ht)
 {
-	struct bucket_table *new_tbl, *old_tbl = rht_dereference(ht->tbl, ht);
-	struct rhash_head *he;
-	unsigned int i, h;
-	bool complete;
+	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 
 	ASSERT_RHT_MUTEX(ht);
 
 	if (ht->p.max_shift && ht->shift >= ht->p.max_shift)
 		return 0;
 
-	new_tbl = bucket_table_alloc(old_tbl->size * 2, flags);
-	if (new_tbl == NULL)
-		return -ENOMEM;
-
-	ht->shift++;
-
-	/* For each new bucket, search the corresponding old bucket
-	 * for the first entry that hashes to the new bucket, and
-	 * link the new bucket to that entry. Since all the entries
-	 * which will end up in the new bucket appear in the same
-	 * old bucket, this constructs an entirely valid new hash
-	 * table, but with multiple buckets "zipped" together into a
-	 * single imprecise chain.
-	 */
-	for (i = 0; i < new_tbl->size; i++) {
-		h = i & (old_tbl->size - 1);
-		rht_for_each(he, old_tbl->buckets[h], ht) {
-			if (head_hashfn(ht, he, new_tbl->size) == i) {
-				RCU_INIT_POINTER(new_tbl->buckets[i], he);
-				break;
-			}
-		}
-	}
-
-	/* Publish the new table pointer. Lookups may now traverse
-	 * the new table, but they will not benefit from any
-	 * additional efficiency until later steps unzip the buckets.
-	 */
-	rcu_assign_pointer(ht->tbl, new_tbl);
-
-	/* Unzip interleaved hash chains */
-	do {
-		/* Wait for readers. All new readers will see the new
-		 * table, and thus no references to the old table will
-		 * remain.
-		 */
-		synchronize_rcu();
-
-		/* For each bucket in the old table (each of which
-		 * contains items from multiple buckets of the new
-		 * table): ...
-		 */
-		complete = true;
-		for (i = 0; i < old_tbl->size; i++) {
-			hashtable_chain_unzip(ht, new_tbl, old_tbl, i);
-			if (old_tbl->buckets[i] != NULL)
-				complete = false;
-		}
-	} while (!complete);
-
-	bucket_table_free(old_tbl);
-	return 0;
+	return rhashtable_rehash(ht, old_tbl->size * 2);
 }
 EXPORT_SYMBOL_GPL(rhashtable_expand);
 
 /**
  * rhashtable_shrink - Shrink hash table while allowing concurrent lookups
  * @ht:		the hash table to shrink
- * @flags:	allocation flags
  *
  * This function may only be called in a context where it is safe to call
  * synchronize_rcu(), e.g. not within a rcu_read_lock() section.
  *
- * The caller must ensure that no concurrent table mutations take place.
- * It is however valid to have concurrent lookups if they are RCU protected.
+ * The caller must hold ht->mutex. Lookups, insertions and removals may
+ * run concurrently.
  */
-int rhashtable_shrink(struct rhashtable *ht, gfp_t flags)
+int rhashtable_shrink(struct rhashtable *ht)
 {
-	struct bucket_table *ntbl, *tbl = rht_dereference(ht->tbl, ht);
-	struct rhash_head __rcu **pprev;
-	unsigned int i;
+	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 
 	ASSERT_RHT_MUTEX(ht);
 
 	if (ht->shift <= ht->p.min_shift)
 		return 0;
 
-	ntbl = bucket_table_alloc(tbl->size / 2, flags);
-	if (ntbl == NULL)
-		return -ENOMEM;
-
-	ht->shift--;
-
-	/* Link each bucket in the new table to the first bucket
-	 * in the old table that contains entries which will hash
-	 * to the new bucket.
-	 */
-	for (i = 0; i < ntbl->size; i++) {
-		ntbl->buckets[i] = tbl->buckets[i];
-
-		/* Link each bucket in the new table to the first bucket
-		 * in the old table that contains entries which will hash
-		 * to the new bucket.
-		 */
-		for (pprev = &ntbl->buckets[i]; *pprev != NULL;
-		     pprev = &rht_dereference(*pprev, ht)->next)
-			;
-		RCU_INIT_POINTER(*pprev, tbl->buckets[i + ntbl->size]);
-	}
+	return rhashtable_rehash(ht, old_tbl->size / 2);
+}
+EXPORT_SYMBOL_GPL(rhashtable_shrink);
 
-	/* Publish the new, valid hash table */
-	rcu_assign_pointer(ht->tbl, ntbl);
+static void rht_deferred_worker(struct work_struct *work)
+{
+	struct rhashtable *ht;
+	struct bucket_table *tbl;
 
-	/* Wait for readers. No new readers will have references to the
-	 * old hash table.
-	 */
-	synchronize_rcu();
+	ht = container_of(work, struct rhashtable, run_work);
+	mutex_lock(&ht->mutex);
+	if (ht->being_destroyed)
+		goto unlock;
 
-	bucket_table_free(tbl);
+	tbl = rht_dereference(ht->tbl, ht);
 
-	return 0;
+	if (ht->p.grow_decision && ht->p.grow_decision(ht, tbl->size))
+		rhashtable_expand(ht);
+	else if (ht->p.shrink_decision && ht->p.shrink_decision(ht, tbl->size))
+		rhashtable_shrink(ht);
+unlock:
+	mutex_unlock(&ht->mutex);
 }
-EXPORT_SYMBOL_GPL(rhashtable_shrink);
 
 /**
- * rhashtable_insert - insert object into hash hash table
+ * rhashtable_insert - insert object into hash table
  * @ht:		hash table
  * @obj:	pointer to hash head inside object
- * @flags:	allocation flags (table expansion)
  *
- * Will automatically grow the table via rhashtable_expand() if the the
- * grow_decision function specified at rhashtable_init() returns true.
+ * Takes only the lock of the bucket the object goes to, insertions may
+ * run concurrently with each other and with lookups, removals and
+ * resizing.
  *
- * The caller must ensure that no concurrent table mutations occur. It is
- * however valid to have concurrent lookups if they are RCU protected.
+ * Will schedule a deferred expansion of the table if the grow_decision
+ * function specified at rhashtable_init() returns true.
  */
-void rhashtable_insert(struct rhashtable *ht, struct rhash_head *obj,
-		       gfp_t flags)
+void rhashtable_insert(struct rhashtable *ht, struct rhash_head *obj)
 {
-	struct bucket_table *tbl = rht_dereference(ht->tbl, ht);
+	struct bucket_table *tbl, *new_tbl;
+	spinlock_t *lock, *new_lock = NULL;
 	u32 hash;
 
-	ASSERT_RHT_MUTEX(ht);
+	rcu_read_lock();
+
+	tbl = rht_dereference_rcu(ht->tbl, ht);
+	hash = head_hashfn(ht, tbl, obj);
+	lock = bucket_lock(tbl, hash);
+	spin_lock_bh(lock);
 
-	hash = head_hashfn(ht, obj, tbl->size);
-	RCU_INIT_POINTER(obj->next, tbl->buckets[hash]);
+	/* The old bucket lock keeps its entries from being moved while a
+	 * resize is in progress, new entries go to the new table.
+	 */
+	new_tbl = rht_dereference_rcu(tbl->future_tbl, ht);
+	if (unlikely(new_tbl)) {
+		tbl = new_tbl;
+		hash = head_hashfn(ht, tbl, obj);
+		new_lock = bucket_lock(tbl, hash);
+		spin_lock_nested(new_lock, SINGLE_DEPTH_NESTING);
+	}
+
+	RCU_INIT_POINTER(obj->next, rht_dereference_bucket(tbl->buckets[hash],
+							   tbl, hash));
 	rcu_assign_pointer(tbl->buckets[hash], obj);
-	ht->nelems++;
+
+	if (new_lock)
+		spin_unlock(new_lock);
+	spin_unlock_bh(lock);
+
+	atomic_inc(&ht->nelems);
 
 	if (ht->p.grow_decision && ht->p.grow_decision(ht, tbl->size))
-		rhashtable_expand(ht, flags);
+		schedule_work(&ht->run_work);
+
+	rcu_read_unlock();
 }
 EXPORT_SYMBOL_GPL(rhashtable_insert);
 
-/**
- * rhashtable_remove_pprev - remove object from hash table given previous element
- * @ht:		hash table
- * @obj:	pointer to hash head inside object
- * @pprev:	pointer to previous element
- * @flags:	allocation flags (table expansion)
- *
- * Identical to rhashtable_remove() but caller is alreayd aware of the element
- * in front of the element to be deleted. This is in particular useful for
- * deletion when combined with walking or lookup.
- */
-void rhashtable_remove_pprev(struct rhashtable *ht, struct rhash_head *obj,
-			     struct rhash_head __rcu **pprev, gfp_t flags)
+/* Called with the bucket lock held */
+static bool __rhashtable_remove(struct bucket_table *tbl, u32 hash,
+				struct rhash_head *obj)
 {
-	struct bucket_table *tbl = rht_dereference(ht->tbl, ht);
+	struct rhash_head __rcu **pprev = &tbl->buckets[hash];
+	struct rhash_head *he;
 
-	ASSERT_RHT_MUTEX(ht);
+	for (he = rht_dereference_bucket(*pprev, tbl, hash); he;
+	     he = rht_dereference_bucket(he->next, tbl, hash)) {
+		if (he != obj) {
+			pprev = &he->next;
+			continue;
+		}
 
-	RCU_INIT_POINTER(*pprev, obj->next);
-	ht->nelems--;
+		RCU_INIT_POINTER(*pprev, he->next);
+		return true;
+	}
 
-	if (ht->p.shrink_decision &&
-	    ht->p.shrink_decision(ht, tbl->size))
-		rhashtable_shrink(ht, flags);
+	return false;
 }
-EXPORT_SYMBOL_GPL(rhashtable_remove_pprev);
 
 /**
  * rhashtable_remove - remove object from hash table
  * @ht:		hash table
  * @obj:	pointer to hash head inside object
- * @flags:	allocation flags (table expansion)
  *
  * Since the hash chain is single linked, the removal operation needs to
  * walk the bucket chain upon removal. The removal operation is thus
  * considerable slow if the hash table is not correctly sized.
  *
- * Will automatically shrink the table via rhashtable_expand() if the the
- * shrink_decision function specified at rhashtable_init() returns true.
+ * Will schedule a deferred shrink of the table if the shrink_decision
+ * function specified at rhashtable_init() returns true.
  *
- * The caller must ensure that no concurrent table mutations occur. It is
- * however valid to have concurrent lookups if they are RCU protected.
+ * Removals may run concurrently with other lookups and updates, the
+ * caller must make sure that an object is not removed twice at the
+ * same time.
  */
-bool rhashtable_remove(struct rhashtable *ht, struct rhash_head *obj,
-		       gfp_t flags)
+bool rhashtable_remove(struct rhashtable *ht, struct rhash_head *obj)
 {
-	struct bucket_table *tbl = rht_dereference(ht->tbl, ht);
-	struct rhash_head __rcu **pprev;
-	struct rhash_head *he;
-	u32 h;
+	struct bucket_table *tbl, *new_tbl;
+	spinlock_t *lock, *new_lock;
+	bool ret;
+	u32 hash;
 
-	ASSERT_RHT_MUTEX(ht);
+	rcu_read_lock();
 
-	h = head_hashfn(ht, obj, tbl->size);
+	tbl = rht_dereference_rcu(ht->tbl, ht);
+	hash = head_hashfn(ht, tbl, obj);
+	lock = bucket_lock(tbl, hash);
+	spin_lock_bh(lock);
+
+	ret = __rhashtable_remove(tbl, hash, obj);
+
+	/* Moved or inserted into the table of a resize in progress */
+	new_tbl = rht_dereference_rcu(tbl->future_tbl, ht);
+	if (!ret && new_tbl) {
+		tbl = new_tbl;
+		hash = head_hashfn(ht, tbl, obj);
+		new_lock = bucket_lock(tbl, hash);
+		spin_lock_nested(new_lock, SINGLE_DEPTH_NESTING);
+		ret = __rhashtable_remove(tbl, hash, obj);
+		spin_unlock(new_lock);
+	}
 
-	pprev = &tbl->buckets[h];
-	rht_for_each(he, tbl->buckets[h], ht) {
-		if (he != obj) {
-			pprev = &he->next;
-			continue;
-		}
+	spin_unlock_bh(lock);
 
-		rhashtable_remove_pprev(ht, he, pprev, flags);
-		return true;
+	if (ret) {
+		atomic_dec(&ht->nelems);
+		if (ht->p.shrink_decision &&
+		    ht->p.shrink_decision(ht, tbl->size))
+			schedule_work(&ht->run_work);
 	}
 
-	return false;
+	rcu_read_unlock();
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(rhashtable_remove);
 
+struct rhashtable_compare_arg {
+	struct rhashtable *ht;
+	const void *key;
+};
+
+static bool rhashtable_compare(void *ptr, void *arg)
+{
+	struct rhashtable_compare_arg *x = arg;
+	struct rhashtable *ht = x->ht;
+
+	return !memcmp(ptr + ht->p.key_offset, x->key, ht->p.key_len);
+}
+
 /**
  * rhashtable_lookup - lookup key in hash table
  * @ht:		hash table
@@ -448,59 +490,68 @@ EXPORT_SYMBOL_GPL(rhashtable_remove);
  * This lookup function may only be used for fixed key hash table (key_len
  * paramter set). It will BUG() if used inappropriately.
  *
- * Lookups may occur in parallel with hash mutations as long as the lookup is
- * guarded by rcu_read_lock(). The caller must take care of this.
+ * Lookups may occur in parallel with hash mutations and resizing. The
+ * returned object is only guaranteed to stay around while the caller
+ * holds rcu_read_lock() or a lock of its own against removals.
  */
-void *rhashtable_lookup(const struct rhashtable *ht, const void *key)
+void *rhashtable_lookup(struct rhashtable *ht, const void *key)
 {
-	const struct bucket_table *tbl = rht_dereference_rcu(ht->tbl, ht);
-	struct rhash_head *he;
-	u32 h;
+	struct rhashtable_compare_arg arg = {
+		.ht = ht,
+		.key = key,
+	};
 
 	BUG_ON(!ht->p.key_len);
 
-	h = __hashfn(ht, key, ht->p.key_len, tbl->size);
-	rht_for_each_rcu(he, tbl->buckets[h], ht) {
-		if (memcmp(rht_obj(ht, he) + ht->p.key_offset, key,
-			   ht->p.key_len))
-			continue;
-		return (void *) he - ht->p.head_offset;
-	}
-
-	return NULL;
+	return rhashtable_lookup_compare(ht, key, &rhashtable_compare, &arg);
 }
 EXPORT_SYMBOL_GPL(rhashtable_lookup);
 
 /**
  * rhashtable_lookup_compare - search hash table with compare function
  * @ht:		hash table
- * @hash:	hash value of desired entry
+ * @key:	the pointer to the key
  * @compare:	compare function, must return true on match
  * @arg:	argument passed on to compare function
  *
- * Traverses the bucket chain behind the provided hash value and calls the
- * specified compare function for each entry.
+ * Traverses the bucket chain behind the hash of the key and calls the
+ * specified compare function for each entry. During a resize the table
+ * under construction is searched as well.
  *
- * Lookups may occur in parallel with hash mutations as long as the lookup is
- * guarded by rcu_read_lock(). The caller must take care of this.
+ * Lookups may occur in parallel with hash mutations and resizing. The
+ * returned object is only guaranteed to stay around while the caller
+ * holds rcu_read_lock() or a lock of its own against removals.
  *
  * Returns the first entry on which the compare function returned true.
  */
-void *rhashtable_lookup_compare(const struct rhashtable *ht, u32 hash,
+void *rhashtable_lookup_compare(struct rhashtable *ht, const void *key,
 				bool (*compare)(void *, void *), void *arg)
 {
-	const struct bucket_table *tbl = rht_dereference_rcu(ht->tbl, ht);
+	const struct bucket_table *tbl;
 	struct rhash_head *he;
+	u32 hash;
 
-	if (unlikely(hash >= tbl->size))
-		return NULL;
+	rcu_read_lock();
 
+	tbl = rht_dereference_rcu(ht->tbl, ht);
+restart:
+	hash = key_hashfn(ht, tbl, key);
 	rht_for_each_rcu(he, tbl->buckets[hash], ht) {
 		if (!compare(rht_obj(ht, he), arg))
 			continue;
-		return (void *) he - ht->p.head_offset;
+		rcu_read_unlock();
+		return rht_obj(ht, he);
 	}
 
+	/* Pairs with the barrier in rhashtable_rehash_one() */
+	smp_rmb();
+
+	tbl = rht_dereference_rcu(tbl->future_tbl, ht);
+	if (unlikely(tbl))
+		goto restart;
+
+	rcu_read_unlock();
+
 	return NULL;
 }
 EXPORT_SYMBOL_GPL(rhashtable_lookup_compare);
@@ -532,7 +583,6 @@ static size_t rounded_hashtable_size(struct rhashtable_params *params)
  *	.key_offset = offsetof(struct test_obj, key),
  *	.key_len = sizeof(int),
  *	.hashfn = arch_fast_hash,
- *	.mutex_is_held = &my_mutex_is_held,
  * };
  *
  * Configuration Example 2: Variable length keys
@@ -552,7 +602,6 @@ static size_t rounded_hashtable_size(struct rhashtable_params *params)
  *	.head_offset = offsetof(struct test_obj, node),
  *	.hashfn = arch_fast_hash,
  *	.obj_hashfn = my_hash_fn,
- *	.mutex_is_held = &my_mutex_is_held,
  * };
  */
 int rhashtable_init(struct rhashtable *ht, struct rhashtable_params *params)
@@ -572,33 +621,82 @@ int rhashtable_init(struct rhashtable *ht, struct rhashtable_params *params)
 	if (params->nelem_hint)
 		size = rounded_hashtable_size(params);
 
-	tbl = bucket_table_alloc(size, GFP_KERNEL);
+	memset(ht, 0, sizeof(*ht));
+	mutex_init(&ht->mutex);
+	memcpy(&ht->p, params, sizeof(*params));
+
+	if (params->locks_mul)
+		ht->p.locks_mul = roundup_pow_of_two(params->locks_mul);
+	else
+		ht->p.locks_mul = BUCKET_LOCKS_PER_CPU;
+
+	tbl = bucket_table_alloc(ht, size);
 	if (tbl == NULL)
 		return -ENOMEM;
 
-	memset(ht, 0, sizeof(*ht));
+	atomic_set(&ht->nelems, 0);
 	ht->shift = ilog2(tbl->size);
-	memcpy(&ht->p, params, sizeof(*params));
 	RCU_INIT_POINTER(ht->tbl, tbl);
 
 	if (!ht->p.hash_rnd)
 		get_random_bytes(&ht->p.hash_rnd, sizeof(ht->p.hash_rnd));
 
+	INIT_WORK(&ht->run_work, rht_deferred_worker);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(rhashtable_init);
 
+/**
+ * rhashtable_free_and_destroy - free elements and destroy hash table
+ * @ht:		the hash table to destroy
+ * @free_fn:	callback to release the objects, may be NULL
+ * @arg:	pointer passed to free_fn
+ *
+ * Stops an eventual deferred resize, calls free_fn for every object
+ * left in the table and frees the bucket array. This function is not
+ * rcu safe, therefore the caller has to make sure that no lookups or
+ * updates can happen anymore by unpublishing the hashtable and waiting
+ * for the quiescent cycle first.
+ */
+void rhashtable_free_and_destroy(struct rhashtable *ht,
+				 void (*free_fn)(void *ptr, void *arg),
+				 void *arg)
+{
+	struct bucket_table *tbl;
+	unsigned int i;
+
+	ht->being_destroyed = true;
+	cancel_work_sync(&ht->run_work);
+
+	mutex_lock(&ht->mutex);
+	tbl = rht_dereference(ht->tbl, ht);
+	if (free_fn) {
+		for (i = 0; i < tbl->size; i++) {
+			struct rhash_head *pos, *next;
+
+			for (pos = rht_dereference(tbl->buckets[i], ht);
+			     pos; pos = next) {
+				next = rht_dereference(pos->next, ht);
+				free_fn(rht_obj(ht, pos), arg);
+			}
+		}
+	}
+	bucket_table_free(tbl);
+	mutex_unlock(&ht->mutex);
+}
+EXPORT_SYMBOL_GPL(rhashtable_free_and_destroy);
+
 /**
  * rhashtable_destroy - destroy hash table
  * @ht:		the hash table to destroy
  *
- * Frees the bucket array. This function is not rcu safe, therefore the caller
- * has to make sure that no resizing may happen by unpublishing the hashtable
- * and waiting for the quiescent cycle before releasing the bucket array.
+ * Same as rhashtable_free_and_destroy() for a table that is empty or
+ * whose objects the caller releases on its own.
  */
-void rhashtable_destroy(const struct rhashtable *ht)
+void rhashtable_destroy(struct rhashtable *ht)
 {
-	bucket_table_free(ht->tbl);
+	rhashtable_free_and_destroy(ht, NULL, NULL);
 }
 EXPORT_SYMBOL_GPL(rhashtable_destroy);
 
@@ -613,11 +711,6 @@ EXPORT_SYMBOL_GPL(rhashtable_destroy);
 #define TEST_PTR	((void *) 0xdeadbeef)
 #define TEST_NEXPANDS	4
 
-static int test_mutex_is_held(void)
-{
-	return 1;
-}
-
 struct test_obj {
 	void			*ptr;
 	int			value;
@@ -679,15 +772,14 @@ static void test_bucket_stats(struct rhashtable *ht,
 				i, tbl->buckets[i], cnt);
 	}
 
-	pr_info("  Traversal complete: counted=%u, nelems=%zu, entries=%d\n",
-		total, ht->nelems, TEST_ENTRIES);
+	pr_info("  Traversal complete: counted=%u, nelems=%d, entries=%d\n",
+		total, atomic_read(&ht->nelems), TEST_ENTRIES);
 }
 
 static int __init test_rhashtable(struct rhashtable *ht)
 {
 	struct bucket_table *tbl;
-	struct test_obj *obj, *next;
-	int err;
+	struct test_obj *obj;
 	unsigned int i;
 
 	/*
@@ -699,15 +791,13 @@ static int __init test_rhashtable(struct rhashtable *ht)
 		struct test_obj *obj;
 
 		obj = kzalloc(sizeof(*obj), GFP_KERNEL);
-		if (!obj) {
-			err = -ENOMEM;
-			goto error;
-		}
+		if (!obj)
+			return -ENOMEM;
 
 		obj->ptr = TEST_PTR;
 		obj->value = i * 2;
 
-		rhashtable_insert(ht, &obj->node, GFP_KERNEL);
+		rhashtable_insert(ht, &obj->node);
 	}
 
 	rcu_read_lock();
@@ -718,7 +808,9 @@ static int __init test_rhashtable(struct rhashtable *ht)
 
 	for (i = 0; i < TEST_NEXPANDS; i++) {
 		pr_info("  Table expansion iteration %u...\n", i);
-		rhashtable_expand(ht, GFP_KERNEL);
+		mutex_lock(&ht->mutex);
+		rhashtable_expand(ht);
+		mutex_unlock(&ht->mutex);
 
 		rcu_read_lock();
 		pr_info("  Verifying lookups...\n");
@@ -728,7 +820,9 @@ static int __init test_rhashtable(struct rhashtable *ht)
 
 	for (i = 0; i < TEST_NEXPANDS; i++) {
 		pr_info("  Table shrinkage iteration %u...\n", i);
-		rhashtable_shrink(ht, GFP_KERNEL);
+		mutex_lock(&ht->mutex);
+		rhashtable_shrink(ht);
+		mutex_unlock(&ht->mutex);
 
 		rcu_read_lock();
 		pr_info("  Verifying lookups...\n");
@@ -743,19 +837,16 @@ static int __init test_rhashtable(struct rhashtable *ht)
 		obj = rhashtable_lookup(ht, &key);
 		BUG_ON(!obj);
 
-		rhashtable_remove(ht, &obj->node, GFP_KERNEL);
+		rhashtable_remove(ht, &obj->node);
 		kfree(obj);
 	}
 
 	return 0;
+}
 
-error:
-	tbl = rht_dereference_rcu(ht->tbl, ht);
-	for (i = 0; i < tbl->size; i++)
-		rht_for_each_entry_safe(obj, next, tbl->buckets[i], ht, node)
-			kfree(obj);
-
-	return err;
+static void test_free_obj(void *ptr, void *arg)
+{
+	kfree(ptr);
 }
 
 static int __init test_rht_init(void)
@@ -767,7 +858,6 @@ static int __init test_rht_init(void)
 		.key_offset = offsetof(struct test_obj, value),
 		.key_len = sizeof(int),
 		.hashfn = arch_fast_hash,
-		.mutex_is_held = &test_mutex_is_held,
 		.grow_decision = rht_grow_above_75,
 		.shrink_decision = rht_shrink_below_30,
 	};
@@ -784,7 +874,7 @@ static int __init test_rht_init(void)
 
 	err = test_rhashtable(&ht);
 
-	rhashtable_destroy(&ht);
+	rhashtable_free_and_destroy(&ht, test_free_obj, NULL);
 
 	return err;
 }
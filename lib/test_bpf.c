@@ -1409,6 +1409,296 @@ static struct bpf_test tests[] = {
 		{ 10, 20, 30, 40, 50 },
 		{ { 3, 0 }, { 4, 0 } }
 	},
+	{	/* Mainly checking JITs that split registers in two words. */
+		"INT: ALU64 carry and borrow",
+		.u.insns_int = {
+			BPF_MOV64_IMM(R0, 0),
+			BPF_LD_IMM64(R1, 0xffffffffULL),
+			BPF_ALU64_IMM(BPF_ADD, R1, 1),
+			BPF_LD_IMM64(R2, 0x100000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R1, R2, 1),
+			BPF_EXIT_INSN(),
+			BPF_ALU64_IMM(BPF_SUB, R1, 1),
+			BPF_LD_IMM64(R2, 0xffffffffULL),
+			BPF_JMP_REG(BPF_JEQ, R1, R2, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_IMM(R1, 0),
+			BPF_ALU64_IMM(BPF_SUB, R1, 1),
+			BPF_JMP_IMM(BPF_JEQ, R1, -1, 1),
+			BPF_EXIT_INSN(),
+			BPF_ALU64_IMM(BPF_NEG, R1, 0),
+			BPF_JMP_IMM(BPF_JEQ, R1, 1, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_IMM(R1, -1),
+			BPF_ALU32_IMM(BPF_ADD, R1, 1),
+			BPF_JMP_IMM(BPF_JEQ, R1, 0, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV32_IMM(R1, -1),
+			BPF_JMP_REG(BPF_JEQ, R1, R2, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_IMM(R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 1 } }
+	},
+	{
+		"INT: ALU64 MUL across words",
+		.u.insns_int = {
+			BPF_MOV64_IMM(R0, 0),
+			BPF_LD_IMM64(R1, 0x123456789ULL),
+			BPF_LD_IMM64(R2, 0xabcdef01ULL),
+			BPF_MOV64_REG(R3, R1),
+			BPF_ALU64_REG(BPF_MUL, R3, R2),
+			BPF_LD_IMM64(R4, 0xc379aaab5aa34e89ULL),
+			BPF_JMP_REG(BPF_JEQ, R3, R4, 1),
+			BPF_EXIT_INSN(),
+			BPF_ALU64_IMM(BPF_MUL, R1, -3),
+			BPF_LD_IMM64(R4, 0xfffffffc962fc965ULL),
+			BPF_JMP_REG(BPF_JEQ, R1, R4, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_IMM(R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 1 } }
+	},
+	{
+		"INT: ALU64 shifts across words",
+		.u.insns_int = {
+			BPF_MOV64_IMM(R0, 0),
+			BPF_LD_IMM64(R1, 0x8000000180000001ULL),
+			BPF_MOV64_REG(R2, R1),
+			BPF_ALU64_IMM(BPF_LSH, R2, 31),
+			BPF_LD_IMM64(R3, 0xc000000080000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_ALU64_IMM(BPF_LSH, R2, 32),
+			BPF_LD_IMM64(R3, 0x8000000100000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_ALU64_IMM(BPF_LSH, R2, 33),
+			BPF_LD_IMM64(R3, 0x200000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_ALU64_IMM(BPF_RSH, R2, 31),
+			BPF_LD_IMM64(R3, 0x100000003ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_ALU64_IMM(BPF_RSH, R2, 32),
+			BPF_LD_IMM64(R3, 0x80000001ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_ALU64_IMM(BPF_RSH, R2, 33),
+			BPF_LD_IMM64(R3, 0x40000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_ALU64_IMM(BPF_ARSH, R2, 31),
+			BPF_LD_IMM64(R3, 0xffffffff00000003ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_ALU64_IMM(BPF_ARSH, R2, 32),
+			BPF_LD_IMM64(R3, 0xffffffff80000001ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_ALU64_IMM(BPF_ARSH, R2, 33),
+			BPF_LD_IMM64(R3, 0xffffffffc0000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_MOV64_IMM(R4, 31),
+			BPF_ALU64_REG(BPF_LSH, R2, R4),
+			BPF_LD_IMM64(R3, 0xc000000080000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_MOV64_IMM(R4, 32),
+			BPF_ALU64_REG(BPF_LSH, R2, R4),
+			BPF_LD_IMM64(R3, 0x8000000100000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_MOV64_IMM(R4, 33),
+			BPF_ALU64_REG(BPF_LSH, R2, R4),
+			BPF_LD_IMM64(R3, 0x200000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_MOV64_IMM(R4, 31),
+			BPF_ALU64_REG(BPF_RSH, R2, R4),
+			BPF_LD_IMM64(R3, 0x100000003ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_MOV64_IMM(R4, 32),
+			BPF_ALU64_REG(BPF_RSH, R2, R4),
+			BPF_LD_IMM64(R3, 0x80000001ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_MOV64_IMM(R4, 33),
+			BPF_ALU64_REG(BPF_RSH, R2, R4),
+			BPF_LD_IMM64(R3, 0x40000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_MOV64_IMM(R4, 31),
+			BPF_ALU64_REG(BPF_ARSH, R2, R4),
+			BPF_LD_IMM64(R3, 0xffffffff00000003ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_MOV64_IMM(R4, 32),
+			BPF_ALU64_REG(BPF_ARSH, R2, R4),
+			BPF_LD_IMM64(R3, 0xffffffff80000001ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_REG(R2, R1),
+			BPF_MOV64_IMM(R4, 33),
+			BPF_ALU64_REG(BPF_ARSH, R2, R4),
+			BPF_LD_IMM64(R3, 0xffffffffc0000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R2, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_IMM(R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 1 } }
+	},
+	{
+		"INT: JMP compares across words",
+		.u.insns_int = {
+			BPF_MOV64_IMM(R0, 0),
+			BPF_LD_IMM64(R1, 0x100000000ULL),
+			BPF_LD_IMM64(R2, 0xffffffffULL),
+			BPF_MOV64_IMM(R3, -1),
+			BPF_MOV64_IMM(R4, 1),
+			/* taken */
+			BPF_JMP_REG(BPF_JGT, R1, R2, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_REG(BPF_JGE, R1, R2, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_REG(BPF_JNE, R1, R2, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_REG(BPF_JSGT, R4, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_REG(BPF_JSGE, R3, R3, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_REG(BPF_JGT, R3, R4, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_IMM(BPF_JSGT, R1, -1, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_REG(BPF_JSET, R1, R3, 1),
+			BPF_EXIT_INSN(),
+			/* not taken */
+			BPF_JMP_REG(BPF_JGT, R2, R1, 1),
+			BPF_JMP_IMM(BPF_JA, 0, 0, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_REG(BPF_JSGT, R3, R4, 1),
+			BPF_JMP_IMM(BPF_JA, 0, 0, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_REG(BPF_JSGE, R3, R4, 1),
+			BPF_JMP_IMM(BPF_JA, 0, 0, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_REG(BPF_JSET, R1, R2, 1),
+			BPF_JMP_IMM(BPF_JA, 0, 0, 1),
+			BPF_EXIT_INSN(),
+			BPF_JMP_IMM(BPF_JEQ, R2, -1, 1),
+			BPF_JMP_IMM(BPF_JA, 0, 0, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_IMM(R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 1 } }
+	},
+	{
+		"INT: ALU64 DIV and MOD",
+		.u.insns_int = {
+			BPF_MOV64_IMM(R0, 0),
+			BPF_LD_IMM64(R1, 0x100000000ULL),
+			BPF_MOV64_IMM(R2, 3),
+			BPF_MOV64_REG(R3, R1),
+			BPF_ALU64_REG(BPF_DIV, R3, R2),
+			BPF_JMP_IMM(BPF_JEQ, R3, 0x55555555, 1),
+			BPF_EXIT_INSN(),
+			BPF_ALU64_REG(BPF_MOD, R1, R2),
+			BPF_JMP_IMM(BPF_JEQ, R1, 1, 1),
+			BPF_EXIT_INSN(),
+			BPF_LD_IMM64(R1, 0x123456789abcdefULL),
+			BPF_MOV64_REG(R3, R1),
+			BPF_ALU64_IMM(BPF_DIV, R3, 7),
+			BPF_LD_IMM64(R4, 0x299c335ccf668fULL),
+			BPF_JMP_REG(BPF_JEQ, R3, R4, 1),
+			BPF_EXIT_INSN(),
+			BPF_ALU64_IMM(BPF_MOD, R1, 7),
+			BPF_JMP_IMM(BPF_JEQ, R1, 6, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV32_IMM(R1, -1),
+			BPF_ALU32_IMM(BPF_MOD, R1, 10),
+			BPF_JMP_IMM(BPF_JEQ, R1, 5, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_IMM(R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 1 } }
+	},
+	{
+		"INT: stack DW and XADD",
+		.u.insns_int = {
+			BPF_MOV64_IMM(R0, 0),
+			BPF_LD_IMM64(R1, 0xffffffffULL),
+			BPF_STX_MEM(BPF_DW, R10, R1, -8),
+			BPF_MOV64_IMM(R2, 1),
+			BPF_RAW_INSN(BPF_STX | BPF_XADD | BPF_DW,
+				     R10, R2, -8, 0),
+			BPF_LDX_MEM(BPF_DW, R3, R10, -8),
+			BPF_LD_IMM64(R4, 0x100000000ULL),
+			BPF_JMP_REG(BPF_JEQ, R3, R4, 1),
+			BPF_EXIT_INSN(),
+			BPF_ST_MEM(BPF_W, R10, -16, -1),
+			BPF_ST_MEM(BPF_W, R10, -12, 5),
+			BPF_RAW_INSN(BPF_STX | BPF_XADD | BPF_W,
+				     R10, R2, -16, 0),
+			BPF_LDX_MEM(BPF_W, R3, R10, -16),
+			BPF_JMP_IMM(BPF_JEQ, R3, 0, 1),
+			BPF_EXIT_INSN(),
+			BPF_LDX_MEM(BPF_W, R3, R10, -12),
+			BPF_JMP_IMM(BPF_JEQ, R3, 5, 1),
+			BPF_EXIT_INSN(),
+			BPF_ST_MEM(BPF_DW, R10, -24, -2),
+			BPF_LDX_MEM(BPF_DW, R3, R10, -24),
+			BPF_JMP_IMM(BPF_JEQ, R3, -2, 1),
+			BPF_EXIT_INSN(),
+			BPF_STX_MEM(BPF_B, R10, R1, -25),
+			BPF_LDX_MEM(BPF_B, R3, R10, -25),
+			BPF_JMP_IMM(BPF_JEQ, R3, 0xff, 1),
+			BPF_EXIT_INSN(),
+			BPF_STX_MEM(BPF_H, R10, R1, -28),
+			BPF_LDX_MEM(BPF_H, R3, R10, -28),
+			BPF_JMP_IMM(BPF_JEQ, R3, 0xffff, 1),
+			BPF_EXIT_INSN(),
+			BPF_MOV64_IMM(R0, 1),
+			BPF_EXIT_INSN(),
+		},
+		INTERNAL,
+		{ },
+		{ { 0, 1 } }
+	},
 	{
 		"check: missing ret",
 		.u.insns = {
@@ -1957,6 +2247,8 @@ static __init int test_bpf(void)
 
 			return err;
 		}
+		pr_cont("jited:%u ", fp->jited);
+
 		err = run_one(fp, &tests[i]);
 		release_filter(fp, i);
 
@@ -0,0 +1,151 @@
+/*
+ * Kernel module comparing bulk and single slab object allocation.
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Loading the module prints the cost per object of allocating and
+ * freeing arrays of objects one by one and with kmem_cache_alloc_bulk()
+ * and kmem_cache_free_bulk(), for a range of array sizes. The bulk calls
+ * are checked first with objects freed in an order that spreads them
+ * over many slab pages, the module fails to load on an error.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#define TEST_MAX_BULK	256
+
+static unsigned int loops = 100000;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "Rounds of allocating and freeing per array size");
+
+static unsigned int object_size = 256;
+module_param(object_size, uint, 0444);
+MODULE_PARM_DESC(object_size, "Size of the test cache objects");
+
+static const unsigned int test_bulk[] = {
+	1, 2, 4, 8, 16, 32, 64, 128, TEST_MAX_BULK,
+};
+
+static void *objs[TEST_MAX_BULK];
+
+/* Returns the nanoseconds per allocated and freed object */
+static unsigned long test_single(struct kmem_cache *s, unsigned int bulk)
+{
+	unsigned int i, j;
+	ktime_t start;
+	s64 ns;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		for (j = 0; j < bulk; j++)
+			objs[j] = kmem_cache_alloc(s, GFP_KERNEL);
+		for (j = 0; j < bulk; j++)
+			kmem_cache_free(s, objs[j]);
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return div64_u64(ns, (u64)loops * bulk);
+}
+
+static unsigned long test_bulk_rate(struct kmem_cache *s, unsigned int bulk)
+{
+	unsigned int i;
+	ktime_t start;
+	s64 ns;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		if (!kmem_cache_alloc_bulk(s, GFP_KERNEL, bulk, objs))
+			return 0;
+		kmem_cache_free_bulk(s, bulk, objs);
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return div64_u64(ns, (u64)loops * bulk);
+}
+
+/*
+ * Allocates several slabs worth of objects and frees them interleaved,
+ * so that kmem_cache_free_bulk() has to sort them back to their pages.
+ */
+static int test_bulk_free_order(struct kmem_cache *s)
+{
+	unsigned int i, n = TEST_MAX_BULK;
+	void **tmp;
+	int ret = 0;
+
+	tmp = kcalloc(n, sizeof(*tmp), GFP_KERNEL);
+	if (!tmp)
+		return -ENOMEM;
+
+	if (kmem_cache_alloc_bulk(s, GFP_KERNEL | __GFP_ZERO, n, objs) != n) {
+		pr_err("bulk allocation of %u objects failed\n", n);
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (!objs[i] || memchr_inv(objs[i], 0, object_size)) {
+			pr_err("object %u is not zeroed\n", i);
+			ret = -EINVAL;
+		}
+		memset(objs[i], 0x5a, object_size);
+	}
+
+	/* even ones from the front, then odd ones from the back */
+	for (i = 0; i < n / 2; i++) {
+		tmp[i] = objs[2 * i];
+		tmp[n - 1 - i] = objs[2 * i + 1];
+	}
+	kmem_cache_free_bulk(s, n, tmp);
+out:
+	kfree(tmp);
+	return ret;
+}
+
+static int __init test_slab_bulk_init(void)
+{
+	struct kmem_cache *s;
+	unsigned int i;
+	int ret;
+
+	if (!loops || !object_size)
+		return -EINVAL;
+
+	s = kmem_cache_create("test_slab_bulk", object_size, 0, 0, NULL);
+	if (!s)
+		return -ENOMEM;
+
+	ret = test_bulk_free_order(s);
+	if (ret)
+		goto out;
+
+	pr_info("objects  single    bulk (ns per object)\n");
+	for (i = 0; i < ARRAY_SIZE(test_bulk); i++) {
+		unsigned int bulk = test_bulk[i];
+
+		pr_info("%7u %7lu %7lu\n", bulk, test_single(s, bulk),
+			test_bulk_rate(s, bulk));
+	}
+out:
+	kmem_cache_destroy(s);
+	return ret;
+}
+module_init(test_slab_bulk_init);
+
+static void __exit test_slab_bulk_exit(void)
+{
+}
+module_exit(test_slab_bulk_exit);
+
+MODULE_LICENSE("GPL");
@@ -33,6 +33,18 @@
 #include <linux/log2.h>
 #include <linux/cma.h>
 #include <linux/highmem.h>
+#include <linux/ktime.h>
+
+#include "internal.h"
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/cma.h>
+
+/*
+ * Number of free bitmap areas cma_alloc() compares before it picks the one
+ * that looks cheapest to migrate.
+ */
+#define CMA_ALLOC_CANDIDATES	4
 
 struct cma {
 	unsigned long	base_pfn;
@@ -86,6 +98,77 @@ static void cma_clear_bitmap(struct cma *cma, unsigned long pfn, int count)
 	mutex_unlock(&cma->lock);
 }
 
+/*
+ * Returns an estimate of the pages in [pfn, pfn + count) that would make
+ * alloc_contig_range() fail or retry: pages that are not free and not on
+ * the LRU, and LRU pages holding more references than their mappings and
+ * the page cache account for (pinned, or under I/O). This is racy and
+ * only used to rank candidate ranges.
+ */
+static unsigned long cma_range_busy(unsigned long pfn, unsigned long count)
+{
+	unsigned long end = pfn + count, busy = 0;
+
+	while (pfn < end) {
+		struct page *page = pfn_to_page(pfn);
+
+		if (PageBuddy(page)) {
+			unsigned long order = page_order_unsafe(page);
+
+			if (order < MAX_ORDER) {
+				pfn += 1UL << order;
+				continue;
+			}
+		} else if (!PageLRU(page) ||
+			   page_count(page) > page_mapcount(page) + 2) {
+			busy++;
+		}
+		pfn++;
+	}
+
+	return busy;
+}
+
+/*
+ * Finds up to CMA_ALLOC_CANDIDATES free areas of the bitmap from @start on
+ * and returns the one with the fewest busy pages, or a value past
+ * @bitmap_maxno if there is no free area. Called with cma->lock held.
+ */
+static unsigned long cma_find_area(struct cma *cma, int count,
+				   unsigned long start,
+				   unsigned long bitmap_maxno,
+				   unsigned long bitmap_count,
+				   unsigned long mask, unsigned long *busy)
+{
+	unsigned long best = bitmap_maxno, best_busy = ULONG_MAX;
+	unsigned long bitmap_no = start;
+	int i;
+
+	for (i = 0; i < CMA_ALLOC_CANDIDATES; i++) {
+		unsigned long nr;
+
+		bitmap_no = bitmap_find_next_zero_area(cma->bitmap,
+				bitmap_maxno, bitmap_no, bitmap_count, mask);
+		if (bitmap_no >= bitmap_maxno)
+			break;
+
+		nr = cma_range_busy(cma->base_pfn +
+				    (bitmap_no << cma->order_per_bit), count);
+		if (nr < best_busy) {
+			best = bitmap_no;
+			best_busy = nr;
+			if (!nr)
+				break;
+		}
+
+		/* the next candidate does not overlap this one */
+		bitmap_no += bitmap_count;
+	}
+
+	*busy = best_busy;
+	return best;
+}
+
 static int __init cma_activate_area(struct cma *cma)
 {
 	int bitmap_size = BITS_TO_LONGS(cma_bitmap_maxno(cma)) * sizeof(long);
@@ -324,13 +407,16 @@ err:
  * @align: Requested alignment of pages (in PAGE_SIZE order).
  *
  * This function allocates part of contiguous memory on specific
- * contiguous memory area.
+ * contiguous memory area. Of the free ranges in the area, the ones with
+ * the fewest pages that can not be migrated right away are tried first.
  */
 struct page *cma_alloc(struct cma *cma, int count, unsigned int align)
 {
 	unsigned long mask, pfn, start = 0;
-	unsigned long bitmap_maxno, bitmap_no, bitmap_count;
+	unsigned long bitmap_maxno, bitmap_no, bitmap_count, busy;
 	struct page *page = NULL;
+	unsigned int tries = 0;
+	ktime_t begin = ktime_get();
 	int ret;
 
 	if (!cma || !cma->count)
@@ -348,8 +434,8 @@ struct page *cma_alloc(struct cma *cma, int count, unsigned int align)
 
 	for (;;) {
 		mutex_lock(&cma->lock);
-		bitmap_no = bitmap_find_next_zero_area(cma->bitmap,
-				bitmap_maxno, start, bitmap_count, mask);
+		bitmap_no = cma_find_area(cma, count, start, bitmap_maxno,
+					  bitmap_count, mask, &busy);
 		if (bitmap_no >= bitmap_maxno) {
 			mutex_unlock(&cma->lock);
 			break;
@@ -363,6 +449,7 @@ struct page *cma_alloc(struct cma *cma, int count, unsigned int align)
 		mutex_unlock(&cma->lock);
 
 		pfn = cma->base_pfn + (bitmap_no << cma->order_per_bit);
+		tries++;
 		mutex_lock(&cma_mutex);
 		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA);
 		mutex_unlock(&cma_mutex);
@@ -377,10 +464,13 @@ struct page *cma_alloc(struct cma *cma, int count, unsigned int align)
 
 		pr_debug("%s(): memory range at %p is busy, retrying\n",
 			 __func__, pfn_to_page(pfn));
+		trace_cma_alloc_busy_retry(pfn, count, busy);
 		/* try again with a bit different memory target */
 		start = bitmap_no + mask + 1;
 	}
 
+	trace_cma_alloc(page ? pfn : 0, page, count, align, tries,
+			ktime_to_ns(ktime_sub(ktime_get(), begin)));
 	pr_debug("%s(): returned %p\n", __func__, page);
 	return page;
 }
@@ -413,6 +503,7 @@ bool cma_release(struct cma *cma, struct page *pages, int count)
 
 	free_contig_range(pfn, count);
 	cma_clear_bitmap(cma, pfn, count);
+	trace_cma_release(pfn, pages, count);
 
 	return true;
 }
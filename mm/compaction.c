@@ -16,6 +16,8 @@
 #include <linux/sysfs.h>
 #include <linux/balloon_compaction.h>
 #include <linux/page-isolation.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #ifdef CONFIG_COMPACTION
@@ -1519,4 +1521,254 @@ void compaction_unregister_node(struct node *node)
 }
 #endif /* CONFIG_SYSFS && CONFIG_NUMA */
 
+/*
+ * Order kcompactd keeps free blocks of in every zone while the system is
+ * otherwise idle, 0 leaves kcompactd to the requests made by kswapd.
+ */
+int sysctl_compaction_proactive_order;
+
+/* How often kcompactd checks the zones when proactive compaction is on */
+#define KCOMPACTD_PROACTIVE_JIFFIES	msecs_to_jiffies(500)
+
+static int kcompactd_order(pg_data_t *pgdat)
+{
+	return max(pgdat->kcompactd_max_order,
+		   ACCESS_ONCE(sysctl_compaction_proactive_order));
+}
+
+static int kcompactd_classzone_idx(pg_data_t *pgdat)
+{
+	/* proactive compaction covers every zone of the node */
+	if (ACCESS_ONCE(sysctl_compaction_proactive_order))
+		return pgdat->nr_zones - 1;
+
+	return pgdat->kcompactd_classzone_idx;
+}
+
+/*
+ * Returns true if a zone up to the classzone is fragmented enough for the
+ * order kcompactd works on, and has the free pages compaction needs.
+ */
+static bool kcompactd_node_suitable(pg_data_t *pgdat)
+{
+	int order = kcompactd_order(pgdat);
+	int zoneid, classzone_idx = kcompactd_classzone_idx(pgdat);
+	struct zone *zone;
+
+	if (!order)
+		return false;
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		if (compaction_suitable(zone, order) == COMPACT_CONTINUE)
+			return true;
+	}
+
+	return false;
+}
+
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	int zoneid, classzone_idx;
+	struct zone *zone;
+	struct compact_control cc = {
+		.order = kcompactd_order(pgdat),
+		.gfp_mask = GFP_KERNEL,
+		.mode = MIGRATE_SYNC_LIGHT,
+		.ignore_skip_hint = true,
+	};
+
+	if (!cc.order)
+		return;
+
+	classzone_idx = kcompactd_classzone_idx(pgdat);
+	if (!kcompactd_node_suitable(pgdat))
+		goto out;
+
+	count_vm_event(KCOMPACTD_WAKE);
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		int status;
+
+		zone = &pgdat->node_zones[zoneid];
+		if (!populated_zone(zone))
+			continue;
+
+		if (compaction_deferred(zone, cc.order))
+			continue;
+
+		if (compaction_suitable(zone, cc.order) != COMPACT_CONTINUE)
+			continue;
+
+		cc.nr_freepages = 0;
+		cc.nr_migratepages = 0;
+		cc.zone = zone;
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		if (kthread_should_stop())
+			return;
+
+		status = compact_zone(zone, &cc);
+
+		if (zone_watermark_ok(zone, cc.order, low_wmark_pages(zone),
+				      0, 0))
+			compaction_defer_reset(zone, cc.order, false);
+		else if (status == COMPACT_COMPLETE)
+			/*
+			 * The scanners met without freeing a block, so don't
+			 * spin on this zone until it had time to change.
+			 */
+			defer_compaction(zone, cc.order);
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+
+out:
+	/*
+	 * Regardless of success, drop the request unless a higher one came
+	 * in while kcompactd was busy with this one.
+	 */
+	if (pgdat->kcompactd_max_order <= cc.order)
+		pgdat->kcompactd_max_order = 0;
+	if (pgdat->kcompactd_classzone_idx <= classzone_idx)
+		pgdat->kcompactd_classzone_idx = 0;
+}
+
+/**
+ * wakeup_kcompactd - ask kcompactd to compact a node in the background
+ * @pgdat: node to compact
+ * @order: order of the free blocks wanted
+ * @classzone_idx: highest zone of the node to compact
+ *
+ * Called by kswapd once it has reclaimed enough for a high-order request,
+ * so the compaction left to do does not stall the next allocation.
+ */
+void wakeup_kcompactd(pg_data_t *pgdat, int order, int classzone_idx)
+{
+	if (!order)
+		return;
+
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+
+	if (pgdat->kcompactd_classzone_idx < classzone_idx)
+		pgdat->kcompactd_classzone_idx = classzone_idx;
+
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+
+	if (!kcompactd_node_suitable(pgdat))
+		return;
+
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/*
+ * The background compaction daemon, one per node. It compacts for the
+ * requests kswapd hands over and, when sysctl_compaction_proactive_order
+ * is set, wakes up periodically to keep free blocks of that order around.
+ */
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = (pg_data_t *)p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+
+	set_freezable();
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = 0;
+
+	while (!kthread_should_stop()) {
+		int proactive = ACCESS_ONCE(sysctl_compaction_proactive_order);
+		long timeout = MAX_SCHEDULE_TIMEOUT;
+
+		if (proactive)
+			timeout = KCOMPACTD_PROACTIVE_JIFFIES;
+
+		/* a timeout is the periodic proactive check */
+		wait_event_freezable_timeout(pgdat->kcompactd_wait,
+			pgdat->kcompactd_max_order || kthread_should_stop() ||
+			ACCESS_ONCE(sysctl_compaction_proactive_order) !=
+			proactive, timeout);
+
+		if (kthread_should_stop())
+			break;
+
+		kcompactd_do_work(pgdat);
+	}
+
+	return 0;
+}
+
+/*
+ * This kcompactd start function will be called by init and node-hot-add.
+ * On node-hot-add, kcompactd will moved to proper cpus if cpus are
+ * hot-added.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int ret = 0;
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		pr_err("Failed to start kcompactd on node %d\n", nid);
+		ret = PTR_ERR(pgdat->kcompactd);
+		pgdat->kcompactd = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined. Caller
+ * must hold mem_hotplug_begin/end().
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+int sysctl_compaction_proactive_handler(struct ctl_table *table, int write,
+			void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int nid, ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write)
+		return ret;
+
+	/* let the daemons pick up the new order and timeout */
+	for_each_node_state(nid, N_MEMORY)
+		wake_up_interruptible(&NODE_DATA(nid)->kcompactd_wait);
+
+	return 0;
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+subsys_initcall(kcompactd_init)
+
 #endif /* CONFIG_COMPACTION */
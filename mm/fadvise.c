@@ -58,6 +58,7 @@ SYSCALL_DEFINE4(fadvise64_64, int, fd, loff_t, offset, loff_t, len, int, advice)
 		case POSIX_FADV_WILLNEED:
 		case POSIX_FADV_NOREUSE:
 		case POSIX_FADV_DONTNEED:
+		case POSIX_FADV_RA_WINDOW:
 			/* no bad return value, but ignore advice */
 			break;
 		default:
@@ -93,6 +94,14 @@ SYSCALL_DEFINE4(fadvise64_64, int, fd, loff_t, offset, loff_t, len, int, advice)
 		f.file->f_mode &= ~FMODE_RANDOM;
 		spin_unlock(&f.file->f_lock);
 		break;
+	case POSIX_FADV_RA_WINDOW:
+		/* Bounded like every readahead, 0 turns it off */
+		nrpages = min_t(loff_t, len >> PAGE_CACHE_SHIFT, ULONG_MAX);
+		f.file->f_ra.ra_pages = max_sane_readahead(nrpages);
+		spin_lock(&f.file->f_lock);
+		f.file->f_mode &= ~FMODE_RANDOM;
+		spin_unlock(&f.file->f_lock);
+		break;
 	case POSIX_FADV_WILLNEED:
 		/* First and last PARTIAL page! */
 		start_index = offset >> PAGE_CACHE_SHIFT;
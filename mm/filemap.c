@@ -1818,6 +1818,7 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 	ra->start = max_t(long, 0, offset - ra_pages / 2);
 	ra->size = ra_pages;
 	ra->async_size = ra_pages / 4;
+	trace_mm_filemap_readahead(mapping, offset, ra, false);
 	ra_submit(ra, mapping, file);
 }
 
@@ -1872,7 +1873,7 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	int error;
 	struct file *file = vma->vm_file;
 	struct address_space *mapping = file->f_mapping;
-	struct file_ra_state *ra = &file->f_ra;
+	struct file_ra_state *ra = &vma->vm_ra;
 	struct inode *inode = mapping->host;
 	pgoff_t offset = vmf->pgoff;
 	struct page *page;
@@ -1883,6 +1884,9 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	if (offset >= size >> PAGE_CACHE_SHIFT)
 		return VM_FAULT_SIGBUS;
 
+	/* the window follows fadvise() on the file */
+	ra->ra_pages = file->f_ra.ra_pages;
+
 	/*
 	 * Do we have something in the page cache already?
 	 */
@@ -2042,8 +2046,8 @@ repeat:
 		if (!pte_none(*pte))
 			goto unlock;
 
-		if (file->f_ra.mmap_miss > 0)
-			file->f_ra.mmap_miss--;
+		if (vma->vm_ra.mmap_miss > 0)
+			vma->vm_ra.mmap_miss--;
 		addr = address + (page->index - vmf->pgoff) * PAGE_SIZE;
 		do_set_pte(vma, addr, page, pte, false, false);
 		unlock_page(page);
@@ -271,6 +271,14 @@ extern pmd_t maybe_pmd_mkwrite(pmd_t pmd, struct vm_area_struct *vma);
 extern unsigned long vma_address(struct page *page,
 				 struct vm_area_struct *vma);
 #endif
+
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+#include <linux/srcu.h>
+
+extern struct srcu_struct vma_srcu;
+extern struct vm_area_struct *find_vma_speculative(struct mm_struct *mm,
+				unsigned long addr, unsigned int *seq);
+#endif
 #else /* !CONFIG_MMU */
 static inline void clear_page_mlock(struct page *page) { }
 static inline void mlock_vma_page(struct page *page) { }
@@ -50,6 +50,7 @@
 #include <linux/fs.h>
 #include <linux/seq_file.h>
 #include <linux/vmpressure.h>
+#include <linux/memstall.h>
 #include <linux/mm_inline.h>
 #include <linux/page_cgroup.h>
 #include <linux/cpu.h>
@@ -102,6 +103,8 @@ enum mem_cgroup_events_index {
 	MEM_CGROUP_EVENTS_PGPGOUT,	/* # of pages paged out */
 	MEM_CGROUP_EVENTS_PGFAULT,	/* # of page-faults */
 	MEM_CGROUP_EVENTS_PGMAJFAULT,	/* # of major page-faults */
+	MEM_CGROUP_EVENTS_REFAULT,	/* # of refaults of evicted pages */
+	MEM_CGROUP_EVENTS_ACTIVATE,	/* # of refaults activated */
 	MEM_CGROUP_EVENTS_NSTATS,
 };
 
@@ -110,6 +113,8 @@ static const char * const mem_cgroup_events_names[] = {
 	"pgpgout",
 	"pgfault",
 	"pgmajfault",
+	"workingset_refault",
+	"workingset_activate",
 };
 
 static const char * const mem_cgroup_lru_names[] = {
@@ -292,6 +297,11 @@ struct mem_cgroup {
 	/* vmpressure notifications */
 	struct vmpressure vmpressure;
 
+#ifdef CONFIG_MEMSTALL
+	/* time the tasks spent stalled on memory, see mm/memstall.c */
+	struct memstall_group memstall;
+#endif
+
 	/* css_online() has been completed */
 	int initialized;
 
@@ -346,9 +356,14 @@ struct mem_cgroup {
 	 */
 	struct mem_cgroup_stat_cpu __percpu *stat;
 	/*
-	 * used when a cpu is offlined or other synchronizations
+	 * the counts folded from the percpu ones.
 	 * See mem_cgroup_read_stat().
 	 */
+	atomic_long_t stat_count[MEM_CGROUP_STAT_NSTATS];
+	/*
+	 * used when a cpu is offlined or other synchronizations
+	 * See mem_cgroup_read_events().
+	 */
 	struct mem_cgroup_stat_cpu nocpu_base;
 	spinlock_t pcp_counter_lock;
 
@@ -516,12 +531,13 @@ static inline bool mem_cgroup_is_root(struct mem_cgroup *memcg)
  */
 #define MEM_CGROUP_ID_MAX	USHRT_MAX
 
-static inline unsigned short mem_cgroup_id(struct mem_cgroup *memcg)
+unsigned short mem_cgroup_id(struct mem_cgroup *memcg)
 {
 	return memcg->css.id;
 }
 
-static inline struct mem_cgroup *mem_cgroup_from_id(unsigned short id)
+/* must be called under rcu_read_lock() */
+struct mem_cgroup *mem_cgroup_from_id(unsigned short id)
 {
 	struct cgroup_subsys_state *css;
 
@@ -846,38 +862,44 @@ mem_cgroup_largest_soft_limit_node(struct mem_cgroup_tree_per_zone *mctz)
 /*
  * Implementation Note: reading percpu statistics for memcg.
  *
- * Both of vmstat[] and percpu_counter has threshold and do periodic
- * synchronization to implement "quick" read. There are trade-off between
- * reading cost and precision of value. Then, we may have a chance to implement
- * a periodic synchronizion of counter in memcg's counter.
+ * Like vmstat[], the percpu page counts only hold a delta of up to
+ * MEMCG_STAT_BATCH pages, larger deltas are folded into the atomic
+ * memcg->stat_count[]. Reading a count is a single atomic read instead
+ * of a walk over all cpus, at the price of being off by up to
+ * MEMCG_STAT_BATCH pages per online cpu. The charged memory itself is
+ * accounted exactly in the res_counters, these counts are statistics.
  *
- * But this _read() function is used for user interface now. The user accounts
- * memory usage by memory cgroup and he _always_ requires exact value because
- * he accounts memory. Even if we provide quick-and-fuzzy read, we always
- * have to visit all online cpus and make sum. So, for now, unnecessary
- * synchronization is not implemented. (just implemented for cpu hotplug)
- *
- * If there are kernel internal actions which can make use of some not-exact
- * value, and reading all cpu value can be performance bottleneck in some
- * common workload, threashold and synchonization as vmstat[] should be
- * implemented.
+ * The events are read rarely and still summed over all cpus.
  */
+#define MEMCG_STAT_BATCH	32
+
+/* must be called with interrupts disabled */
+static void __mem_cgroup_mod_stat(struct mem_cgroup *memcg,
+				  enum mem_cgroup_stat_index idx, long val)
+{
+	long x = __this_cpu_read(memcg->stat->count[idx]) + val;
+
+	if (unlikely(abs(x) > MEMCG_STAT_BATCH)) {
+		atomic_long_add(x, &memcg->stat_count[idx]);
+		x = 0;
+	}
+	__this_cpu_write(memcg->stat->count[idx], x);
+}
+
+static void mem_cgroup_mod_stat(struct mem_cgroup *memcg,
+				enum mem_cgroup_stat_index idx, long val)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__mem_cgroup_mod_stat(memcg, idx, val);
+	local_irq_restore(flags);
+}
+
 static long mem_cgroup_read_stat(struct mem_cgroup *memcg,
 				 enum mem_cgroup_stat_index idx)
 {
-	long val = 0;
-	int cpu;
-
-	get_online_cpus();
-	for_each_online_cpu(cpu)
-		val += per_cpu(memcg->stat->count[idx], cpu);
-#ifdef CONFIG_HOTPLUG_CPU
-	spin_lock(&memcg->pcp_counter_lock);
-	val += memcg->nocpu_base.count[idx];
-	spin_unlock(&memcg->pcp_counter_lock);
-#endif
-	put_online_cpus();
-	return val;
+	return atomic_long_read(&memcg->stat_count[idx]);
 }
 
 static unsigned long mem_cgroup_read_events(struct mem_cgroup *memcg,
@@ -907,15 +929,13 @@ static void mem_cgroup_charge_statistics(struct mem_cgroup *memcg,
 	 * counted as CACHE even if it's on ANON LRU.
 	 */
 	if (PageAnon(page))
-		__this_cpu_add(memcg->stat->count[MEM_CGROUP_STAT_RSS],
-				nr_pages);
+		__mem_cgroup_mod_stat(memcg, MEM_CGROUP_STAT_RSS, nr_pages);
 	else
-		__this_cpu_add(memcg->stat->count[MEM_CGROUP_STAT_CACHE],
-				nr_pages);
+		__mem_cgroup_mod_stat(memcg, MEM_CGROUP_STAT_CACHE, nr_pages);
 
 	if (PageTransHuge(page))
-		__this_cpu_add(memcg->stat->count[MEM_CGROUP_STAT_RSS_HUGE],
-				nr_pages);
+		__mem_cgroup_mod_stat(memcg, MEM_CGROUP_STAT_RSS_HUGE,
+				      nr_pages);
 
 	/* pagein of a big page is an event. So, ignore page size */
 	if (nr_pages > 0)
@@ -1312,6 +1332,29 @@ out:
 }
 EXPORT_SYMBOL(__mem_cgroup_count_vm_event);
 
+/**
+ * mem_cgroup_count_workingset - account a refault to a memcg
+ * @memcg: memcg the refaulting page was evicted from
+ * @idx: WORKINGSET_REFAULT or WORKINGSET_ACTIVATE
+ */
+void mem_cgroup_count_workingset(struct mem_cgroup *memcg,
+				 enum zone_stat_item idx)
+{
+	if (!memcg)
+		return;
+
+	switch (idx) {
+	case WORKINGSET_REFAULT:
+		this_cpu_inc(memcg->stat->events[MEM_CGROUP_EVENTS_REFAULT]);
+		break;
+	case WORKINGSET_ACTIVATE:
+		this_cpu_inc(memcg->stat->events[MEM_CGROUP_EVENTS_ACTIVATE]);
+		break;
+	default:
+		BUG();
+	}
+}
+
 /**
  * mem_cgroup_zone_lruvec - get the lru list vector for a zone and memcg
  * @zone: zone of the wanted lruvec
@@ -1345,6 +1388,27 @@ out:
 	return lruvec;
 }
 
+/**
+ * mem_cgroup_page_memcg - return the memcg a page is charged to
+ * @page: the page
+ *
+ * Returns the root memcg for uncharged pages, %NULL if the memory
+ * controller is disabled. The caller holds the page lock or
+ * rcu_read_lock() to keep the memcg around.
+ */
+struct mem_cgroup *mem_cgroup_page_memcg(struct page *page)
+{
+	struct page_cgroup *pc;
+
+	if (mem_cgroup_disabled())
+		return NULL;
+
+	pc = lookup_page_cgroup(page);
+	if (!PageCgroupUsed(pc))
+		return root_mem_cgroup;
+	return pc->mem_cgroup;
+}
+
 /**
  * mem_cgroup_page_lruvec - return lruvec for adding an lru page
  * @page: the page
@@ -2284,17 +2348,21 @@ void mem_cgroup_update_page_stat(struct mem_cgroup *memcg,
 	VM_BUG_ON(!rcu_read_lock_held());
 
 	if (memcg)
-		this_cpu_add(memcg->stat->count[idx], val);
+		mem_cgroup_mod_stat(memcg, idx, val);
 }
 
 /*
  * size of first charge trial. "32" comes from vmscan.c's magic value.
- * TODO: maybe necessary to use big numbers in big irons.
+ * A cpu that keeps charging to the same memcg doubles its batch on every
+ * refill, up to CHARGE_BATCH_MAX, and falls back to CHARGE_BATCH when a
+ * charge hits the limit.
  */
-#define CHARGE_BATCH	32U
+#define CHARGE_BATCH		32U
+#define CHARGE_BATCH_MAX	(CHARGE_BATCH * 16)
 struct memcg_stock_pcp {
 	struct mem_cgroup *cached; /* this never be root cgroup */
 	unsigned int nr_pages;
+	unsigned int batch; /* next refill for cached */
 	struct work_struct work;
 	unsigned long flags;
 #define FLUSHING_CACHED_CHARGE	0
@@ -2318,7 +2386,7 @@ static bool consume_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	struct memcg_stock_pcp *stock;
 	bool ret = true;
 
-	if (nr_pages > CHARGE_BATCH)
+	if (nr_pages > CHARGE_BATCH_MAX)
 		return false;
 
 	stock = &get_cpu_var(memcg_stock);
@@ -2381,11 +2449,33 @@ static void refill_stock(struct mem_cgroup *memcg, unsigned int nr_pages)
 	if (stock->cached != memcg) { /* reset if necessary */
 		drain_stock(stock);
 		stock->cached = memcg;
+		stock->batch = CHARGE_BATCH;
+	} else if (stock->batch < CHARGE_BATCH_MAX) {
+		stock->batch *= 2;
 	}
 	stock->nr_pages += nr_pages;
 	put_cpu_var(memcg_stock);
 }
 
+/*
+ * Number of pages to charge to refill this cpu's stock for @memcg. When
+ * @shrink is set the memcg is close to its limit and the batch starts
+ * over from CHARGE_BATCH.
+ */
+static unsigned int stock_batch(struct mem_cgroup *memcg, bool shrink)
+{
+	struct memcg_stock_pcp *stock = &get_cpu_var(memcg_stock);
+	unsigned int batch = CHARGE_BATCH;
+
+	if (stock->cached == memcg) {
+		if (shrink)
+			stock->batch = CHARGE_BATCH;
+		batch = stock->batch;
+	}
+	put_cpu_var(memcg_stock);
+	return batch;
+}
+
 /*
  * Drains all per-CPU charge caches for given root_memcg resp. subtree
  * of the hierarchy under it. sync flag says whether we should block
@@ -2467,7 +2557,7 @@ static void mem_cgroup_drain_pcp_counter(struct mem_cgroup *memcg, int cpu)
 		long x = per_cpu(memcg->stat->count[i], cpu);
 
 		per_cpu(memcg->stat->count[i], cpu) = 0;
-		memcg->nocpu_base.count[i] += x;
+		atomic_long_add(x, &memcg->stat_count[i]);
 	}
 	for (i = 0; i < MEM_CGROUP_EVENTS_NSTATS; i++) {
 		unsigned long x = per_cpu(memcg->stat->events[i], cpu);
@@ -2503,18 +2593,21 @@ static int memcg_cpu_hotplug_callback(struct notifier_block *nb,
 static int try_charge(struct mem_cgroup *memcg, gfp_t gfp_mask,
 		      unsigned int nr_pages)
 {
-	unsigned int batch = max(CHARGE_BATCH, nr_pages);
+	unsigned int batch;
 	int nr_retries = MEM_CGROUP_RECLAIM_RETRIES;
 	struct mem_cgroup *mem_over_limit;
 	struct res_counter *fail_res;
 	unsigned long nr_reclaimed;
 	unsigned long long size;
+	struct memstall ms;
 	bool may_swap = true;
 	bool drained = false;
 	int ret = 0;
 
 	if (mem_cgroup_is_root(memcg))
 		goto done;
+
+	batch = max(stock_batch(memcg, false), nr_pages);
 retry:
 	if (consume_stock(memcg, nr_pages))
 		goto done;
@@ -2533,6 +2626,7 @@ retry:
 	}
 
 	if (batch > nr_pages) {
+		stock_batch(memcg, true);
 		batch = nr_pages;
 		goto retry;
 	}
@@ -2554,8 +2648,10 @@ retry:
 	if (!(gfp_mask & __GFP_WAIT))
 		goto nomem;
 
+	memstall_enter(&ms);
 	nr_reclaimed = try_to_free_mem_cgroup_pages(mem_over_limit, nr_pages,
 						    gfp_mask, may_swap);
+	memstall_leave(&ms);
 
 	if (mem_cgroup_margin(mem_over_limit) >= nr_pages)
 		goto retry;
@@ -3339,8 +3435,7 @@ void mem_cgroup_split_huge_fixup(struct page *head)
 		pc->mem_cgroup = memcg;
 		pc->flags = head_pc->flags;
 	}
-	__this_cpu_sub(memcg->stat->count[MEM_CGROUP_STAT_RSS_HUGE],
-		       HPAGE_PMD_NR);
+	__mem_cgroup_mod_stat(memcg, MEM_CGROUP_STAT_RSS_HUGE, -HPAGE_PMD_NR);
 }
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 
@@ -3395,17 +3490,17 @@ static int mem_cgroup_move_account(struct page *page,
 	move_lock_mem_cgroup(from, &flags);
 
 	if (!PageAnon(page) && page_mapped(page)) {
-		__this_cpu_sub(from->stat->count[MEM_CGROUP_STAT_FILE_MAPPED],
-			       nr_pages);
-		__this_cpu_add(to->stat->count[MEM_CGROUP_STAT_FILE_MAPPED],
-			       nr_pages);
+		__mem_cgroup_mod_stat(from, MEM_CGROUP_STAT_FILE_MAPPED,
+				      -(long)nr_pages);
+		__mem_cgroup_mod_stat(to, MEM_CGROUP_STAT_FILE_MAPPED,
+				      nr_pages);
 	}
 
 	if (PageWriteback(page)) {
-		__this_cpu_sub(from->stat->count[MEM_CGROUP_STAT_WRITEBACK],
-			       nr_pages);
-		__this_cpu_add(to->stat->count[MEM_CGROUP_STAT_WRITEBACK],
-			       nr_pages);
+		__mem_cgroup_mod_stat(from, MEM_CGROUP_STAT_WRITEBACK,
+				      -(long)nr_pages);
+		__mem_cgroup_mod_stat(to, MEM_CGROUP_STAT_WRITEBACK,
+				      nr_pages);
 	}
 
 	/*
@@ -3502,7 +3597,7 @@ static void mem_cgroup_swap_statistics(struct mem_cgroup *memcg,
 					 bool charge)
 {
 	int val = (charge) ? 1 : -1;
-	this_cpu_add(memcg->stat->count[MEM_CGROUP_STAT_SWAP], val);
+	mem_cgroup_mod_stat(memcg, MEM_CGROUP_STAT_SWAP, val);
 }
 
 /**
@@ -4328,6 +4423,48 @@ static int mem_cgroup_move_charge_write(struct cgroup_subsys_state *css,
 }
 #endif
 
+#ifdef CONFIG_MEMSTALL
+/*
+ * Account a stall of the current task starting or ending at @now to its
+ * memcg and the ancestors, the root being accounted system-wide. The
+ * memcg is pinned in @ms for the duration of the stall, the task can
+ * move to another one meanwhile.
+ */
+void mem_cgroup_memstall(struct memstall *ms, bool enter, u64 now)
+{
+	struct mem_cgroup *memcg, *iter;
+
+	if (enter) {
+		if (mem_cgroup_disabled()) {
+			ms->memcg = NULL;
+			return;
+		}
+		memcg = get_mem_cgroup_from_mm(current->mm);
+		if (mem_cgroup_is_root(memcg)) {
+			css_put(&memcg->css);
+			memcg = NULL;
+		}
+		ms->memcg = memcg;
+	} else {
+		memcg = ms->memcg;
+	}
+	if (!memcg)
+		return;
+
+	for (iter = memcg; iter && !mem_cgroup_is_root(iter);
+	     iter = parent_mem_cgroup(iter))
+		memstall_group_change(&iter->memstall, enter, now);
+
+	if (!enter)
+		css_put(&memcg->css);
+}
+
+static int memcg_pressure_show(struct seq_file *m, void *v)
+{
+	return memstall_show(m, &mem_cgroup_from_css(seq_css(m))->memstall);
+}
+#endif
+
 #ifdef CONFIG_NUMA
 static int memcg_numa_stat_show(struct seq_file *m, void *v)
 {
@@ -5195,6 +5332,12 @@ static struct cftype mem_cgroup_files[] = {
 	{
 		.name = "pressure_level",
 	},
+#ifdef CONFIG_MEMSTALL
+	{
+		.name = "pressure",
+		.seq_show = memcg_pressure_show,
+	},
+#endif
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
@@ -5421,6 +5564,9 @@ mem_cgroup_css_alloc(struct cgroup_subsys_state *parent_css)
 	mutex_init(&memcg->thresholds_lock);
 	spin_lock_init(&memcg->move_lock);
 	vmpressure_init(&memcg->vmpressure);
+#ifdef CONFIG_MEMSTALL
+	memstall_group_init(&memcg->memstall);
+#endif
 	INIT_LIST_HEAD(&memcg->event_list);
 	spin_lock_init(&memcg->event_list_lock);
 
@@ -6469,9 +6615,9 @@ static void uncharge_batch(struct mem_cgroup *memcg, unsigned long pgpgout,
 	}
 
 	local_irq_save(flags);
-	__this_cpu_sub(memcg->stat->count[MEM_CGROUP_STAT_RSS], nr_anon);
-	__this_cpu_sub(memcg->stat->count[MEM_CGROUP_STAT_CACHE], nr_file);
-	__this_cpu_sub(memcg->stat->count[MEM_CGROUP_STAT_RSS_HUGE], nr_huge);
+	__mem_cgroup_mod_stat(memcg, MEM_CGROUP_STAT_RSS, -nr_anon);
+	__mem_cgroup_mod_stat(memcg, MEM_CGROUP_STAT_CACHE, -nr_file);
+	__mem_cgroup_mod_stat(memcg, MEM_CGROUP_STAT_RSS_HUGE, -nr_huge);
 	__this_cpu_add(memcg->stat->events[MEM_CGROUP_EVENTS_PGPGOUT], pgpgout);
 	__this_cpu_add(memcg->stat->nr_page_events, nr_anon + nr_file);
 	memcg_check_events(memcg, dummy_page);
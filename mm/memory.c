@@ -52,6 +52,7 @@
 #include <linux/init.h>
 #include <linux/writeback.h>
 #include <linux/memcontrol.h>
+#include <linux/memstall.h>
 #include <linux/mmu_notifier.h>
 #include <linux/kallsyms.h>
 #include <linux/swapops.h>
@@ -2415,6 +2416,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	spinlock_t *ptl;
 	struct page *page, *swapcache;
 	struct mem_cgroup *memcg;
+	struct memstall ms;
 	swp_entry_t entry;
 	pte_t pte;
 	int locked;
@@ -2437,6 +2439,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		goto out;
 	}
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
+	memstall_enter(&ms);
 	page = lookup_swap_cache(entry);
 	if (!page) {
 		page = swapin_readahead(entry,
@@ -2450,6 +2453,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 			if (likely(pte_same(*page_table, orig_pte)))
 				ret = VM_FAULT_OOM;
 			delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
+			memstall_leave(&ms);
 			goto unlock;
 		}
 
@@ -2464,6 +2468,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		 */
 		ret = VM_FAULT_HWPOISON;
 		delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
+		memstall_leave(&ms);
 		swapcache = page;
 		goto out_release;
 	}
@@ -2472,6 +2477,7 @@ static int do_swap_page(struct mm_struct *mm, struct vm_area_struct *vma,
 	locked = lock_page_or_retry(page, mm, flags);
 
 	delayacct_clear_flag(DELAYACCT_PF_SWAPIN);
+	memstall_leave(&ms);
 	if (!locked) {
 		ret |= VM_FAULT_RETRY;
 		goto out_release;
@@ -2827,23 +2833,23 @@ late_initcall(fault_around_debugfs);
  * This function doesn't cross the VMA boundaries, in order to call map_pages()
  * only once.
  *
- * fault_around_pages() defines how many pages we'll try to map.
+ * vma_fault_around_pages() defines how many pages we'll try to map.
  * do_fault_around() expects it to return a power of two less than or equal to
  * PTRS_PER_PTE.
  *
  * The virtual address of the area that we map is naturally aligned to the
- * fault_around_pages() value (and therefore to page order).  This way it's
- * easier to guarantee that we don't cross page table boundaries.
+ * vma_fault_around_pages() value (and therefore to page order).  This way
+ * it's easier to guarantee that we don't cross page table boundaries.
  */
 static void do_fault_around(struct vm_area_struct *vma, unsigned long address,
-		pte_t *pte, pgoff_t pgoff, unsigned int flags)
+		pte_t *pte, pgoff_t pgoff, unsigned int flags,
+		unsigned long nr_pages)
 {
-	unsigned long start_addr, nr_pages, mask;
+	unsigned long start_addr, mask;
 	pgoff_t max_pgoff;
 	struct vm_fault vmf;
 	int off;
 
-	nr_pages = ACCESS_ONCE(fault_around_bytes) >> PAGE_SHIFT;
 	mask = ~(nr_pages * PAGE_SIZE - 1) & PAGE_MASK;
 
 	start_addr = max(address & mask, vma->vm_start);
@@ -2878,10 +2884,24 @@ static void do_fault_around(struct vm_area_struct *vma, unsigned long address,
 	vma->vm_ops->map_pages(vma, &vmf);
 }
 
+/*
+ * The madvise() hints of a mapping adjust the window: MADV_RANDOM turns
+ * fault-around off, MADV_SEQUENTIAL extends it to the whole page table.
+ */
+static unsigned long vma_fault_around_pages(struct vm_area_struct *vma)
+{
+	if (vma->vm_flags & VM_RAND_READ)
+		return 1;
+	if (vma->vm_flags & VM_SEQ_READ)
+		return PTRS_PER_PTE;
+	return ACCESS_ONCE(fault_around_bytes) >> PAGE_SHIFT;
+}
+
 static int do_read_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 		unsigned long address, pmd_t *pmd,
 		pgoff_t pgoff, unsigned int flags, pte_t orig_pte)
 {
+	unsigned long nr_pages = vma_fault_around_pages(vma);
 	struct page *fault_page;
 	spinlock_t *ptl;
 	pte_t *pte;
@@ -2893,9 +2913,9 @@ static int do_read_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 	 * something).
 	 */
 	if (vma->vm_ops->map_pages && !(flags & FAULT_FLAG_NONLINEAR) &&
-	    fault_around_bytes >> PAGE_SHIFT > 1) {
+	    nr_pages > 1) {
 		pte = pte_offset_map_lock(mm, pmd, address, &ptl);
-		do_fault_around(vma, address, pte, pgoff, flags);
+		do_fault_around(vma, address, pte, pgoff, flags, nr_pages);
 		if (!pte_same(*pte, orig_pte))
 			goto unlock_out;
 		pte_unmap_unlock(pte, ptl);
@@ -3380,6 +3400,181 @@ int handle_mm_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 	return ret;
 }
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+/*
+ * Walks down to the pte table of @address, with interrupts disabled: that
+ * holds off the RCU-sched grace period page tables are freed after (see
+ * tlb_remove_table()), as well as the IPI fallback. Returns the mapped pte
+ * and a copy of the pmd it was found through, or NULL if there is no pte
+ * table yet.
+ */
+static pte_t *speculative_pte_map(struct mm_struct *mm, unsigned long address,
+				  pmd_t **pmdp, pmd_t *pmdval)
+{
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	pgd = pgd_offset(mm, address);
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		return NULL;
+
+	pud = pud_offset(pgd, address);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		return NULL;
+
+	pmd = pmd_offset(pud, address);
+	*pmdval = *pmd;
+	barrier();
+	if (pmd_none(*pmdval) || pmd_trans_huge(*pmdval) ||
+	    unlikely(pmd_bad(*pmdval)))
+		return NULL;
+
+	*pmdp = pmd;
+	return pte_offset_map(pmdval, address);
+}
+
+/**
+ * handle_speculative_fault - handle a page fault without mmap_sem
+ * @mm: mm of the faulting task
+ * @address: faulting address
+ * @flags: FAULT_FLAG_xxx flags
+ *
+ * Only the first touch of anonymous private memory whose pte table already
+ * exists is handled: the vma is looked up under vma_srcu, and everything
+ * read from it is validated against its vm_sequence with the pte lock
+ * held. A concurrent munmap() bumps vm_sequence before it zaps the ptes,
+ * so once the check passed under the pte lock the vma, its anon_vma and
+ * the pte table stay around until the lock is dropped.
+ *
+ * Returns VM_FAULT_RETRY when the fault has to be handled by
+ * handle_mm_fault() with mmap_sem held, 0 when it has been handled.
+ */
+int handle_speculative_fault(struct mm_struct *mm, unsigned long address,
+			     unsigned int flags)
+{
+	struct vm_area_struct *vma;
+	struct mem_cgroup *memcg;
+	struct page *page = NULL;
+	pmd_t *pmd, orig_pmd;
+	pte_t *pte, entry;
+	spinlock_t *ptl;
+	unsigned int seq;
+	int idx;
+
+	idx = srcu_read_lock(&vma_srcu);
+	vma = find_vma_speculative(mm, address, &seq);
+	if (!vma)
+		goto out_unlock;
+
+	/* no ->fault, no stack to expand, no huge pages to collapse */
+	if (vma->vm_ops ||
+	    (vma->vm_flags & (VM_SHARED | VM_GROWSDOWN | VM_GROWSUP)) ||
+	    transparent_hugepage_enabled(vma))
+		goto out_unlock;
+
+	/* the first write fault of a vma sets its anon_vma up */
+	if ((flags & FAULT_FLAG_WRITE) && !vma->anon_vma)
+		goto out_unlock;
+
+	/* leave access errors to the slow path */
+	if (flags & FAULT_FLAG_WRITE) {
+		if (!(vma->vm_flags & VM_WRITE))
+			goto out_unlock;
+	} else if (!(vma->vm_flags & (VM_READ | VM_WRITE | VM_EXEC))) {
+		goto out_unlock;
+	}
+
+	local_irq_disable();
+	pte = speculative_pte_map(mm, address, &pmd, &orig_pmd);
+	if (pte) {
+		entry = *pte;
+		pte_unmap(pte);
+	}
+	local_irq_enable();
+	if (!pte || !pte_none(entry))
+		goto out_unlock;
+
+	__set_current_state(TASK_RUNNING);
+	check_sync_rss_stat(current);
+
+	if (flags & FAULT_FLAG_WRITE) {
+		page = alloc_zeroed_user_highpage_movable(vma, address);
+		if (!page)
+			goto out_unlock;
+		__SetPageUptodate(page);
+
+		if (mem_cgroup_try_charge(page, mm, GFP_KERNEL, &memcg)) {
+			page_cache_release(page);
+			goto out_unlock;
+		}
+
+		entry = mk_pte(page, vma->vm_page_prot);
+		if (vma->vm_flags & VM_WRITE)
+			entry = pte_mkwrite(pte_mkdirty(entry));
+	} else {
+		entry = pte_mkspecial(pfn_pte(my_zero_pfn(address),
+					      vma->vm_page_prot));
+	}
+
+	/*
+	 * The pte lock is only tried: whoever holds it may be waiting for
+	 * this CPU to take an IPI while we have interrupts disabled.
+	 */
+	local_irq_disable();
+	pte = speculative_pte_map(mm, address, &pmd, &orig_pmd);
+	if (!pte) {
+		local_irq_enable();
+		goto out_release;
+	}
+	ptl = pte_lockptr(mm, &orig_pmd);
+	if (!spin_trylock(ptl)) {
+		pte_unmap(pte);
+		local_irq_enable();
+		goto out_release;
+	}
+	if (pmd_val(*pmd) != pmd_val(orig_pmd) ||
+	    read_seqcount_retry(&vma->vm_sequence, seq)) {
+		pte_unmap_unlock(pte, ptl);
+		local_irq_enable();
+		goto out_release;
+	}
+	local_irq_enable();
+
+	if (!pte_none(*pte)) {
+		pte_unmap_unlock(pte, ptl);
+		goto out_release;
+	}
+
+	if (page) {
+		inc_mm_counter_fast(mm, MM_ANONPAGES);
+		page_add_new_anon_rmap(page, vma, address);
+		mem_cgroup_commit_charge(page, memcg, false);
+		lru_cache_add_active_or_unevictable(page, vma);
+	}
+	set_pte_at(mm, address, pte, entry);
+
+	/* No need to invalidate - it was non-present before */
+	update_mmu_cache(vma, address, pte);
+	pte_unmap_unlock(pte, ptl);
+	srcu_read_unlock(&vma_srcu, idx);
+
+	count_vm_event(PGFAULT);
+	count_vm_event(SPECULATIVE_PGFAULT);
+	mem_cgroup_count_vm_event(mm, PGFAULT);
+	return 0;
+
+out_release:
+	if (page) {
+		mem_cgroup_cancel_charge(page, memcg);
+		page_cache_release(page);
+	}
+out_unlock:
+	srcu_read_unlock(&vma_srcu, idx);
+	return VM_FAULT_RETRY;
+}
+#endif /* CONFIG_SPECULATIVE_PAGE_FAULT */
+
 #ifndef __PAGETABLE_PUD_FOLDED
 /*
  * Allocate page upper directory.
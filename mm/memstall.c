@@ -0,0 +1,343 @@
+/*
+ * Memory stall accounting
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Tasks stall on memory in direct reclaim, in direct compaction and
+ * while they wait for swapped out pages to be read back. A group of
+ * tasks is stalled while at least one of them is, and the share of wall
+ * time it spent stalled over the last 10s, 60s and 300s is reported with
+ * the total stall time in microseconds, for the whole system in
+ * /proc/pressure/memory and for memory cgroups in memory.pressure:
+ *
+ *	some avg10=1.52 avg60=0.37 avg300=0.08 total=318204
+ *
+ * Writing "some <stall us> <window us>" to an open /proc/pressure/memory
+ * sets a trigger on that file: poll() returns POLLPRI once the system
+ * stalled for the given time within a window, at most once per window.
+ */
+
+#include <linux/init.h>
+#include <linux/memcontrol.h>
+#include <linux/memstall.h>
+#include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+#define MEMSTALL_PERIOD		(2ULL * NSEC_PER_SEC)
+
+/* exp(-2s/10s), exp(-2s/60s) and exp(-2s/300s) in fixed point */
+static const unsigned long memstall_exp[3] = { 1677, 1981, 2034 };
+
+/* 100% in fixed point, and the ns of stall in a period worth 1/FIXED_1% */
+#define MEMSTALL_FULL		(100 * FIXED_1)
+#define MEMSTALL_NS_UNIT	(MEMSTALL_PERIOD / MEMSTALL_FULL)
+
+/* more missed periods than that leave nothing of the averages */
+#define MEMSTALL_MAX_PERIODS	1000
+
+#define LOAD_INT(x) ((x) >> FSHIFT)
+#define LOAD_FRAC(x) LOAD_INT(((x) & (FIXED_1-1)) * 100)
+
+#define MEMSTALL_TRIGGER_INTERVAL	(HZ / 10)
+#define MEMSTALL_WINDOW_MIN	(500 * NSEC_PER_MSEC)
+#define MEMSTALL_WINDOW_MAX	(10ULL * NSEC_PER_SEC)
+
+struct memstall_trigger {
+	struct list_head list;
+	u64 threshold;
+	u64 window;
+	u64 win_start;		/* start of the current window */
+	u64 win_total;		/* system total at win_start */
+	bool fired;		/* in the current window */
+	int event;		/* not seen by poll() yet */
+};
+
+static struct memstall_group memstall_system = {
+	.lock = __SPIN_LOCK_UNLOCKED(memstall_system.lock),
+};
+
+static LIST_HEAD(memstall_triggers);
+static DEFINE_MUTEX(memstall_trigger_lock);
+static DECLARE_WAIT_QUEUE_HEAD(memstall_wait);
+
+static void memstall_trigger_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(memstall_trigger_work, memstall_trigger_fn);
+
+void memstall_group_init(struct memstall_group *grp)
+{
+	memset(grp, 0, sizeof(*grp));
+	spin_lock_init(&grp->lock);
+}
+
+void memstall_group_change(struct memstall_group *grp, bool enter, u64 now)
+{
+	spin_lock(&grp->lock);
+	if (enter) {
+		if (!grp->nr_stalled++)
+			grp->start = now;
+	} else if (!--grp->nr_stalled) {
+		grp->total += now - grp->start;
+	}
+	spin_unlock(&grp->lock);
+}
+
+/* called with grp->lock held */
+static u64 memstall_total(struct memstall_group *grp, u64 now)
+{
+	u64 total = grp->total;
+
+	if (grp->nr_stalled)
+		total += now - grp->start;
+	return total;
+}
+
+static unsigned long memstall_calc(unsigned long avg, unsigned long exp,
+				   unsigned long pct)
+{
+	return (avg * exp + pct * (FIXED_1 - exp)) >> FSHIFT;
+}
+
+/*
+ * Fold the periods that passed since the last update into the averages.
+ * Nobody looks at the averages of most groups most of the time, so they
+ * are brought up to date when read, with the stall spread evenly over
+ * the periods that were missed. Called with grp->lock held.
+ */
+static void memstall_update_avgs(struct memstall_group *grp, u64 now)
+{
+	u64 total, stall, periods;
+	unsigned long pct;
+	int i;
+
+	total = memstall_total(grp, now);
+	if (!grp->avg_next) {
+		grp->avg_next = now + MEMSTALL_PERIOD;
+		grp->avg_total = total;
+		return;
+	}
+	if (now < grp->avg_next)
+		return;
+
+	periods = div64_u64(now - grp->avg_next, MEMSTALL_PERIOD) + 1;
+	stall = total - grp->avg_total;
+	grp->avg_total = total;
+	grp->avg_next += periods * MEMSTALL_PERIOD;
+
+	pct = min_t(u64, div64_u64(stall, periods * MEMSTALL_NS_UNIT),
+		    MEMSTALL_FULL);
+	periods = min_t(u64, periods, MEMSTALL_MAX_PERIODS);
+	while (periods--)
+		for (i = 0; i < ARRAY_SIZE(grp->avg); i++)
+			grp->avg[i] = memstall_calc(grp->avg[i],
+						    memstall_exp[i], pct);
+}
+
+int memstall_show(struct seq_file *m, struct memstall_group *grp)
+{
+	unsigned long avg[ARRAY_SIZE(grp->avg)];
+	u64 now = ktime_get_ns();
+	u64 total;
+
+	spin_lock(&grp->lock);
+	memstall_update_avgs(grp, now);
+	total = memstall_total(grp, now);
+	memcpy(avg, grp->avg, sizeof(avg));
+	spin_unlock(&grp->lock);
+
+	seq_printf(m, "some avg10=%lu.%02lu avg60=%lu.%02lu avg300=%lu.%02lu total=%llu\n",
+		   LOAD_INT(avg[0]), LOAD_FRAC(avg[0]),
+		   LOAD_INT(avg[1]), LOAD_FRAC(avg[1]),
+		   LOAD_INT(avg[2]), LOAD_FRAC(avg[2]),
+		   div_u64(total, NSEC_PER_USEC));
+	return 0;
+}
+
+/**
+ * memstall_enter - mark the current task as stalled on memory
+ * @ms: saved state for memstall_leave()
+ *
+ * Stalls nest, only the outermost pair is accounted.
+ */
+void memstall_enter(struct memstall *ms)
+{
+	u64 now;
+
+	ms->flags = current->flags & PF_MEMSTALL;
+	if (ms->flags)
+		return;
+
+	current->flags |= PF_MEMSTALL;
+	now = ktime_get_ns();
+	memstall_group_change(&memstall_system, true, now);
+	mem_cgroup_memstall(ms, true, now);
+
+	/* the triggers are checked while the system stalls */
+	if (!list_empty(&memstall_triggers))
+		schedule_delayed_work(&memstall_trigger_work,
+				      MEMSTALL_TRIGGER_INTERVAL);
+}
+
+/**
+ * memstall_leave - the current task is done stalling on memory
+ * @ms: state saved by memstall_enter()
+ */
+void memstall_leave(struct memstall *ms)
+{
+	u64 now;
+
+	if (ms->flags)
+		return;
+
+	now = ktime_get_ns();
+	memstall_group_change(&memstall_system, false, now);
+	mem_cgroup_memstall(ms, false, now);
+	current->flags &= ~PF_MEMSTALL;
+}
+
+static void memstall_trigger_fn(struct work_struct *work)
+{
+	struct memstall_trigger *t;
+	u64 now = ktime_get_ns();
+	bool stalled, wake = false;
+	u64 total;
+
+	spin_lock(&memstall_system.lock);
+	total = memstall_total(&memstall_system, now);
+	stalled = memstall_system.nr_stalled;
+	spin_unlock(&memstall_system.lock);
+
+	mutex_lock(&memstall_trigger_lock);
+	list_for_each_entry(t, &memstall_triggers, list) {
+		if (now - t->win_start >= t->window) {
+			t->win_start = now;
+			t->win_total = total;
+			t->fired = false;
+		}
+		if (!t->fired && total - t->win_total >= t->threshold) {
+			t->fired = true;
+			t->event = 1;
+			wake = true;
+		}
+	}
+	if (stalled && !list_empty(&memstall_triggers))
+		schedule_delayed_work(&memstall_trigger_work,
+				      MEMSTALL_TRIGGER_INTERVAL);
+	mutex_unlock(&memstall_trigger_lock);
+
+	if (wake)
+		wake_up_interruptible(&memstall_wait);
+}
+
+static int memstall_proc_show(struct seq_file *m, void *v)
+{
+	return memstall_show(m, &memstall_system);
+}
+
+static int memstall_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, memstall_proc_show, NULL);
+}
+
+static ssize_t memstall_proc_write(struct file *file, const char __user *ubuf,
+				   size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+	unsigned long long threshold, window;
+	struct memstall_trigger *t;
+	char buf[64];
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "some %llu %llu", &threshold, &window) != 2)
+		return -EINVAL;
+	threshold *= NSEC_PER_USEC;
+	window *= NSEC_PER_USEC;
+	if (window < MEMSTALL_WINDOW_MIN || window > MEMSTALL_WINDOW_MAX ||
+	    !threshold || threshold > window)
+		return -EINVAL;
+
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+	t->threshold = threshold;
+	t->window = window;
+	t->win_start = ktime_get_ns();
+
+	spin_lock(&memstall_system.lock);
+	t->win_total = memstall_total(&memstall_system, t->win_start);
+	spin_unlock(&memstall_system.lock);
+
+	mutex_lock(&memstall_trigger_lock);
+	if (m->private) {
+		mutex_unlock(&memstall_trigger_lock);
+		kfree(t);
+		return -EBUSY;
+	}
+	m->private = t;
+	list_add(&t->list, &memstall_triggers);
+	mutex_unlock(&memstall_trigger_lock);
+
+	return count;
+}
+
+static unsigned int memstall_proc_poll(struct file *file, poll_table *wait)
+{
+	struct seq_file *m = file->private_data;
+	struct memstall_trigger *t = m->private;
+
+	if (!t)
+		return DEFAULT_POLLMASK;
+
+	poll_wait(file, &memstall_wait, wait);
+	if (xchg(&t->event, 0))
+		return DEFAULT_POLLMASK | POLLPRI;
+	return DEFAULT_POLLMASK;
+}
+
+static int memstall_proc_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+	struct memstall_trigger *t = m->private;
+
+	if (t) {
+		mutex_lock(&memstall_trigger_lock);
+		list_del(&t->list);
+		mutex_unlock(&memstall_trigger_lock);
+		kfree(t);
+	}
+	return single_release(inode, file);
+}
+
+static const struct file_operations memstall_proc_fops = {
+	.open		= memstall_proc_open,
+	.read		= seq_read,
+	.write		= memstall_proc_write,
+	.poll		= memstall_proc_poll,
+	.llseek		= seq_lseek,
+	.release	= memstall_proc_release,
+};
+
+static int __init memstall_init(void)
+{
+	if (!proc_mkdir("pressure", NULL))
+		return -ENOMEM;
+	if (!proc_create("pressure/memory", 0644, NULL, &memstall_proc_fops))
+		return -ENOMEM;
+	return 0;
+}
+module_init(memstall_init);
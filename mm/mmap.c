@@ -266,6 +266,89 @@ void unlink_file_vma(struct vm_area_struct *vma)
 	}
 }
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+DEFINE_SRCU(vma_srcu);
+
+static void __free_vma(struct rcu_head *head)
+{
+	struct vm_area_struct *vma;
+
+	vma = container_of(head, struct vm_area_struct, vm_rcu);
+	kmem_cache_free(vm_area_cachep, vma);
+}
+
+/*
+ * A vma that has been in the mm's rbtree may still be looked at by
+ * find_vma_speculative(), so it is only freed after an SRCU grace period.
+ */
+static void free_vma(struct vm_area_struct *vma)
+{
+	call_srcu(&vma_srcu, &vma->vm_rcu, __free_vma);
+}
+
+/* Bounds the walk, a tree being rebalanced under it may not be sane */
+#define SPECULATIVE_WALK_MAX	(2 * BITS_PER_LONG)
+
+/**
+ * find_vma_speculative - look up the vma containing an address locklessly
+ * @mm: mm to search
+ * @addr: address the vma has to contain
+ * @seq: returns the vm_sequence of the vma
+ *
+ * Must be called within a vma_srcu read side section. Returns NULL if no
+ * vma contains @addr or if the rbtree or the vma was being changed; the
+ * caller has to check @seq with read_seqcount_retry() before it relies on
+ * anything it read from the vma.
+ */
+struct vm_area_struct *find_vma_speculative(struct mm_struct *mm,
+					    unsigned long addr,
+					    unsigned int *seq)
+{
+	struct vm_area_struct *vma = NULL;
+	struct rb_node *rb_node;
+	unsigned int mm_seq;
+	int depth = 0;
+
+	mm_seq = raw_read_seqcount(&mm->mm_rb_seq);
+	if (mm_seq & 1)
+		return NULL;
+
+	rb_node = ACCESS_ONCE(mm->mm_rb.rb_node);
+	while (rb_node) {
+		struct vm_area_struct *tmp;
+
+		if (++depth > SPECULATIVE_WALK_MAX)
+			return NULL;
+
+		tmp = rb_entry(rb_node, struct vm_area_struct, vm_rb);
+		if (tmp->vm_end > addr) {
+			vma = tmp;
+			if (tmp->vm_start <= addr)
+				break;
+			rb_node = ACCESS_ONCE(rb_node->rb_left);
+		} else
+			rb_node = ACCESS_ONCE(rb_node->rb_right);
+	}
+	if (!vma)
+		return NULL;
+
+	*seq = raw_read_seqcount(&vma->vm_sequence);
+	if (*seq & 1)
+		return NULL;
+	if (vma->vm_start > addr || vma->vm_end <= addr)
+		return NULL;
+	if (read_seqcount_retry(&mm->mm_rb_seq, mm_seq))
+		return NULL;
+
+	return vma;
+}
+#else
+static inline void free_vma(struct vm_area_struct *vma)
+{
+	kmem_cache_free(vm_area_cachep, vma);
+}
+#endif /* CONFIG_SPECULATIVE_PAGE_FAULT */
+
 /*
  * Close a vm structure and free it, returning the next.
  */
@@ -279,7 +362,7 @@ static struct vm_area_struct *remove_vma(struct vm_area_struct *vma)
 	if (vma->vm_file)
 		fput(vma->vm_file);
 	mpol_put(vma_policy(vma));
-	kmem_cache_free(vm_area_cachep, vma);
+	free_vma(vma);
 	return next;
 }
 
@@ -629,10 +712,12 @@ void __vma_link_rb(struct mm_struct *mm, struct vm_area_struct *vma,
 	 * immediately update the gap to the correct value. Finally we
 	 * rebalance the rbtree after all augmented values have been set.
 	 */
+	mm_rb_write_begin(mm);
 	rb_link_node(&vma->vm_rb, rb_parent, rb_link);
 	vma->rb_subtree_gap = 0;
 	vma_gap_update(vma);
 	vma_rb_insert(vma, &mm->mm_rb);
+	mm_rb_write_end(mm);
 }
 
 static void __vma_link_file(struct vm_area_struct *vma)
@@ -709,7 +794,9 @@ __vma_unlink(struct mm_struct *mm, struct vm_area_struct *vma,
 {
 	struct vm_area_struct *next;
 
+	mm_rb_write_begin(mm);
 	vma_rb_erase(vma, &mm->mm_rb);
+	mm_rb_write_end(mm);
 	prev->vm_next = next = vma->vm_next;
 	if (next)
 		next->vm_prev = prev;
@@ -829,6 +916,10 @@ again:			remove_next = 1 + (end > next->vm_end);
 			vma_interval_tree_remove(next, root);
 	}
 
+	vm_write_begin(vma);
+	if (adjust_next || remove_next)
+		vm_write_begin(next);
+
 	if (start != vma->vm_start) {
 		vma->vm_start = start;
 		start_changed = true;
@@ -876,6 +967,10 @@ again:			remove_next = 1 + (end > next->vm_end);
 		}
 	}
 
+	if (adjust_next || remove_next)
+		vm_write_end(next);
+	vm_write_end(vma);
+
 	if (anon_vma) {
 		anon_vma_interval_tree_post_update_vma(vma);
 		if (adjust_next)
@@ -901,7 +996,7 @@ again:			remove_next = 1 + (end > next->vm_end);
 			anon_vma_merge(vma, next);
 		mm->map_count--;
 		mpol_put(vma_policy(next));
-		kmem_cache_free(vm_area_cachep, next);
+		free_vma(next);
 		/*
 		 * In mprotect's case 6 (see comments on vma_merge),
 		 * we must remove another next too. It would clutter
@@ -2421,7 +2516,12 @@ detach_vmas_to_be_unmapped(struct mm_struct *mm, struct vm_area_struct *vma,
 	insertion_point = (prev ? &prev->vm_next : &mm->mmap);
 	vma->vm_prev = NULL;
 	do {
+		/* a speculative fault must not map anything in it any more */
+		vm_write_begin(vma);
+		mm_rb_write_begin(mm);
 		vma_rb_erase(vma, &mm->mm_rb);
+		mm_rb_write_end(mm);
+		vm_write_end(vma);
 		mm->map_count--;
 		tail_vma = vma;
 		vma = vma->vm_next;
@@ -18,6 +18,8 @@
 #include <linux/syscalls.h>
 #include <linux/file.h>
 
+#include <trace/events/filemap.h>
+
 #include "internal.h"
 
 /*
@@ -451,6 +453,7 @@ ondemand_readahead(struct address_space *mapping,
 	 * standalone, small random read
 	 * Read as is, and do not pollute the readahead state.
 	 */
+	trace_mm_filemap_readahead(mapping, offset, NULL, false);
 	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
 
 initial_readahead:
@@ -469,6 +472,7 @@ readit:
 		ra->size += ra->async_size;
 	}
 
+	trace_mm_filemap_readahead(mapping, offset, ra, hit_readahead_marker);
 	return ra_submit(ra, mapping, filp);
 }
 
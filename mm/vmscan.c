@@ -3256,6 +3256,13 @@ static void kswapd_try_to_sleep(pg_data_t *pgdat, int order, int classzone_idx)
 		 */
 		reset_isolation_suitable(pgdat);
 
+		/*
+		 * Reclaim is done, hand whatever compaction the high-order
+		 * request still needs to kcompactd instead of leaving it to
+		 * the next direct compactor.
+		 */
+		wakeup_kcompactd(pgdat, order, classzone_idx);
+
 		if (!kthread_should_stop())
 			schedule();
 
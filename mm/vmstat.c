@@ -19,6 +19,7 @@
 #include <linux/vmstat.h>
 #include <linux/sched.h>
 #include <linux/math64.h>
+#include <linux/tick.h>
 #include <linux/writeback.h>
 #include <linux/compaction.h>
 #include <linux/mm_inline.h>
@@ -814,6 +815,9 @@ const char * const vmstat_text[] = {
 
 	"pgfault",
 	"pgmajfault",
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	"speculative_pgfault",
+#endif
 
 	TEXTS_FOR_ZONES("pgrefill")
 	TEXTS_FOR_ZONES("pgsteal_kswapd")
@@ -856,6 +860,7 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_daemon_wake",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -1259,7 +1264,12 @@ static cpumask_var_t cpu_stat_off;
 
 static void vmstat_update(struct work_struct *w)
 {
-	if (refresh_cpu_vm_stats())
+	/*
+	 * A full dynticks cpu folds its diffs and leaves it to the shepherd
+	 * to notice new ones, rather than waking up every interval.
+	 */
+	if (refresh_cpu_vm_stats() &&
+	    !tick_nohz_full_cpu(smp_processor_id()))
 		/*
 		 * Counters were updated so we expect more updates
 		 * to occur in the future. Keep on running the
@@ -1338,7 +1348,7 @@ static void vmstat_shepherd(struct work_struct *w)
 
 	put_online_cpus();
 
-	schedule_delayed_work(&shepherd,
+	schedule_delayed_work_on(housekeeping_any_cpu(), &shepherd,
 		round_jiffies_relative(sysctl_stat_interval));
 
 }
@@ -1355,7 +1365,7 @@ static void __init start_shepherd_timer(void)
 		BUG();
 	cpumask_copy(cpu_stat_off, cpu_online_mask);
 
-	schedule_delayed_work(&shepherd,
+	schedule_delayed_work_on(housekeeping_any_cpu(), &shepherd,
 		round_jiffies_relative(sysctl_stat_interval));
 }
 
@@ -256,8 +256,12 @@ static void zs_zpool_destroy(void *pool)
 static int zs_zpool_malloc(void *pool, size_t size, gfp_t gfp,
 			unsigned long *handle)
 {
+	/* like zbud, tell the user the object can never be stored */
+	if (!size || size > ZS_MAX_ALLOC_SIZE)
+		return -ENOSPC;
+
 	*handle = zs_malloc(pool, size);
-	return *handle ? 0 : -1;
+	return *handle ? 0 : -ENOMEM;
 }
 static void zs_zpool_free(void *pool, unsigned long handle)
 {
@@ -522,6 +522,18 @@ bad:
 
 }
 
+/* Nothing can look at a bridged packet in the inet hooks of @pf when none
+ * of the ones it would traverse has a hook registered, so the detour and
+ * the nf_bridge_info allocation are skipped. Constant @pf makes these
+ * static key tests with jump labels.
+ */
+static __always_inline bool br_nf_inet_hooks_active(u_int8_t pf)
+{
+	return nf_hooks_active(pf, NF_INET_PRE_ROUTING) ||
+	       nf_hooks_active(pf, NF_INET_FORWARD) ||
+	       nf_hooks_active(pf, NF_INET_POST_ROUTING);
+}
+
 /* Replicate the checks that IPv6 does on packet reception and pass the packet
  * to ip6tables, which doesn't support NAT, so things are fairly simple. */
 static unsigned int br_nf_pre_routing_ipv6(const struct nf_hook_ops *ops,
@@ -595,6 +607,8 @@ static unsigned int br_nf_pre_routing(const struct nf_hook_ops *ops,
 	if (IS_IPV6(skb) || IS_VLAN_IPV6(skb) || IS_PPPOE_IPV6(skb)) {
 		if (!brnf_call_ip6tables && !br->nf_call_ip6tables)
 			return NF_ACCEPT;
+		if (!br_nf_inet_hooks_active(NFPROTO_IPV6))
+			return NF_ACCEPT;
 
 		nf_bridge_pull_encap_header_rcsum(skb);
 		return br_nf_pre_routing_ipv6(ops, skb, in, out, okfn);
@@ -606,6 +620,9 @@ static unsigned int br_nf_pre_routing(const struct nf_hook_ops *ops,
 	if (!IS_IP(skb) && !IS_VLAN_IP(skb) && !IS_PPPOE_IP(skb))
 		return NF_ACCEPT;
 
+	if (!br_nf_inet_hooks_active(NFPROTO_IPV4))
+		return NF_ACCEPT;
+
 	nf_bridge_pull_encap_header_rcsum(skb);
 
 	if (br_parse_ip_options(skb))
@@ -133,6 +133,7 @@
 #include <linux/vmalloc.h>
 #include <linux/if_macvlan.h>
 #include <linux/errqueue.h>
+#include <linux/filter.h>
 
 #include "net-sysfs.h"
 
@@ -1658,6 +1659,15 @@ static inline void net_timestamp_set(struct sk_buff *skb)
 			__net_timestamp(SKB);		\
 	}						\
 
+/* the stages are stamped for as long as any socket wants RX timestamps */
+static inline void net_rx_stage_check(struct sk_buff *skb, unsigned int stage)
+{
+#ifdef CONFIG_NET_RX_STAGE_TSTAMP
+	if (static_key_false(&netstamp_needed))
+		skb_rx_stage_stamp(skb, stage);
+#endif
+}
+
 bool is_skb_forwardable(struct net_device *dev, struct sk_buff *skb)
 {
 	unsigned int len;
@@ -1730,7 +1740,7 @@ static inline int deliver_skb(struct sk_buff *skb,
 			      struct packet_type *pt_prev,
 			      struct net_device *orig_dev)
 {
-	if (unlikely(skb_orphan_frags(skb, GFP_ATOMIC)))
+	if (unlikely(skb_orphan_frags_rx(skb, GFP_ATOMIC)))
 		return -ENOMEM;
 	atomic_inc(&skb->users);
 	return pt_prev->func(skb, skb->dev, pt_prev, orig_dev);
@@ -3338,6 +3348,7 @@ static int netif_rx_internal(struct sk_buff *skb)
 	int ret;
 
 	net_timestamp_check(netdev_tstamp_prequeue, skb);
+	net_rx_stage_check(skb, SKB_RX_STAGE_DRIVER);
 
 	trace_netif_rx(skb);
 #ifdef CONFIG_RPS
@@ -3590,6 +3601,78 @@ void netdev_rx_handler_unregister(struct net_device *dev)
 }
 EXPORT_SYMBOL_GPL(netdev_rx_handler_unregister);
 
+/**
+ *	dev_set_rx_early_filter - attach an early RX filter to a device
+ *	@dev: device to attach the filter to
+ *	@insns: classic BPF program, or %NULL
+ *	@len: number of instructions in @insns, 0 detaches the filter
+ *
+ *	The filter is run by the driver on each received frame before an skb
+ *	is allocated for it, and sees the frame from its Ethernet header like
+ *	a packet socket filter does. Frames for which it returns zero are
+ *	dropped. Only devices setting %IFF_RX_EARLY_FILTER support it.
+ *
+ *	The caller must hold the rtnl_mutex.
+ */
+int dev_set_rx_early_filter(struct net_device *dev, struct sock_filter *insns,
+			    unsigned int len)
+{
+	struct sock_fprog_kern fprog = { .len = len, .filter = insns };
+	struct bpf_prog *prog = NULL, *old;
+	int err;
+
+	ASSERT_RTNL();
+
+	if (!(dev->priv_flags & IFF_RX_EARLY_FILTER))
+		return -EOPNOTSUPP;
+
+	if (len) {
+		err = bpf_prog_create(&prog, &fprog);
+		if (err)
+			return err;
+	}
+
+	old = rtnl_dereference(dev->rx_early_filter);
+	rcu_assign_pointer(dev->rx_early_filter, prog);
+	if (old) {
+		synchronize_net();
+		bpf_prog_destroy(old);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dev_set_rx_early_filter);
+
+/* Minimal skb describing the frame an early RX filter runs on */
+static DEFINE_PER_CPU(struct sk_buff, rx_early_filter_skb);
+
+bool __netif_rx_early_drop(struct net_device *dev, void *data,
+			   unsigned int len)
+{
+	struct sk_buff *skb = this_cpu_ptr(&rx_early_filter_skb);
+	struct bpf_prog *prog;
+	bool drop = false;
+
+	rcu_read_lock();
+	prog = rcu_dereference(dev->rx_early_filter);
+	if (prog && len >= ETH_HLEN) {
+		skb->head = data;
+		skb->data = data;
+		skb->len = len;
+		skb_set_tail_pointer(skb, len);
+		skb_reset_mac_header(skb);
+		skb_set_network_header(skb, ETH_HLEN);
+		skb->protocol = eth_hdr(skb)->h_proto;
+		skb->dev = dev;
+
+		drop = !BPF_PROG_RUN(prog, skb);
+	}
+	rcu_read_unlock();
+
+	return drop;
+}
+EXPORT_SYMBOL(__netif_rx_early_drop);
+
 /*
  * Limit the use of PFMEMALLOC reserves to those protocols that implement
  * the special handling of PFMEMALLOC skbs.
@@ -3619,6 +3702,7 @@ static int __netif_receive_skb_core(struct sk_buff *skb, bool pfmemalloc)
 	__be16 type;
 
 	net_timestamp_check(!netdev_tstamp_prequeue, skb);
+	net_rx_stage_check(skb, SKB_RX_STAGE_STACK);
 
 	trace_netif_receive_skb(skb);
 
@@ -3732,7 +3816,7 @@ ncls:
 	}
 
 	if (pt_prev) {
-		if (unlikely(skb_orphan_frags(skb, GFP_ATOMIC)))
+		if (unlikely(skb_orphan_frags_rx(skb, GFP_ATOMIC)))
 			goto drop;
 		else
 			ret = pt_prev->func(skb, skb->dev, pt_prev, orig_dev);
@@ -3779,6 +3863,7 @@ static int __netif_receive_skb(struct sk_buff *skb)
 static int netif_receive_skb_internal(struct sk_buff *skb)
 {
 	net_timestamp_check(netdev_tstamp_prequeue, skb);
+	net_rx_stage_check(skb, SKB_RX_STAGE_DRIVER);
 
 	if (skb_defer_rx_timestamp(skb))
 		return NET_RX_SUCCESS;
@@ -4013,6 +4098,7 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 		NAPI_GRO_CB(skb)->flush = 0;
 		NAPI_GRO_CB(skb)->free = 0;
 		NAPI_GRO_CB(skb)->udp_mark = 0;
+		NAPI_GRO_CB(skb)->udp_gro = 0;
 
 		/* Setup for GRO checksum validation */
 		switch (skb->ip_summed) {
@@ -4148,6 +4234,7 @@ static gro_result_t napi_skb_finish(gro_result_t ret, struct sk_buff *skb)
 gro_result_t napi_gro_receive(struct napi_struct *napi, struct sk_buff *skb)
 {
 	trace_napi_gro_receive_entry(skb);
+	net_rx_stage_check(skb, SKB_RX_STAGE_DRIVER);
 
 	skb_gro_reset_offset(skb);
 
@@ -4170,6 +4257,7 @@ static void napi_reuse_skb(struct napi_struct *napi, struct sk_buff *skb)
 	skb->encapsulation = 0;
 	skb_shinfo(skb)->gso_type = 0;
 	skb->truesize = SKB_TRUESIZE(skb_end_offset(skb));
+	skb_rx_stage_clear(skb);
 
 	napi->skb = skb;
 }
@@ -4258,6 +4346,7 @@ gro_result_t napi_gro_frags(struct napi_struct *napi)
 		return GRO_DROP;
 
 	trace_napi_gro_frags_entry(skb);
+	net_rx_stage_check(skb, SKB_RX_STAGE_DRIVER);
 
 	return napi_frags_finish(napi, skb, dev_gro_receive(napi, skb));
 }
@@ -6712,6 +6801,7 @@ EXPORT_SYMBOL(alloc_netdev_mqs);
 void free_netdev(struct net_device *dev)
 {
 	struct napi_struct *p, *n;
+	struct bpf_prog *prog;
 
 	release_net(dev_net(dev));
 
@@ -6722,6 +6812,10 @@ void free_netdev(struct net_device *dev)
 
 	kfree(rcu_dereference_protected(dev->ingress_queue, 1));
 
+	prog = rcu_dereference_protected(dev->rx_early_filter, 1);
+	if (prog)
+		bpf_prog_destroy(prog);
+
 	/* Flush device addresses */
 	dev_addr_flush(dev);
 
@@ -372,10 +372,23 @@ void netpoll_send_skb_on_dev(struct netpoll *np, struct sk_buff *skb,
 }
 EXPORT_SYMBOL(netpoll_send_skb_on_dev);
 
-void netpoll_send_udp(struct netpoll *np, const char *msg, int len)
+static int netpoll_udp_total_len(struct netpoll *np, int len)
 {
-	int total_len, ip_len, udp_len;
-	struct sk_buff *skb;
+	int ip_len = len + sizeof(struct udphdr);
+
+	if (np->ipv6)
+		ip_len += sizeof(struct ipv6hdr);
+	else
+		ip_len += sizeof(struct iphdr);
+
+	return ip_len + LL_RESERVED_SPACE(np->dev);
+}
+
+/* Fill in a UDP frame to the remote end, headroom already reserved */
+static void netpoll_build_udp(struct netpoll *np, struct sk_buff *skb,
+			      const char *msg, int len)
+{
+	int ip_len, udp_len;
 	struct udphdr *udph;
 	struct iphdr *iph;
 	struct ethhdr *eth;
@@ -388,13 +401,6 @@ void netpoll_send_udp(struct netpoll *np, const char *msg, int len)
 	else
 		ip_len = udp_len + sizeof(*iph);
 
-	total_len = ip_len + LL_RESERVED_SPACE(np->dev);
-
-	skb = find_skb(np, total_len + np->dev->needed_tailroom,
-		       total_len - len);
-	if (!skb)
-		return;
-
 	skb_copy_to_linear_data(skb, msg, len);
 	skb_put(skb, len);
 
@@ -468,11 +474,50 @@ void netpoll_send_udp(struct netpoll *np, const char *msg, int len)
 	ether_addr_copy(eth->h_dest, np->remote_mac);
 
 	skb->dev = np->dev;
+}
+
+void netpoll_send_udp(struct netpoll *np, const char *msg, int len)
+{
+	int total_len = netpoll_udp_total_len(np, len);
+	struct sk_buff *skb;
 
+	skb = find_skb(np, total_len + np->dev->needed_tailroom,
+		       total_len - len);
+	if (!skb)
+		return;
+
+	netpoll_build_udp(np, skb, msg, len);
 	netpoll_send_skb(np, skb);
 }
 EXPORT_SYMBOL(netpoll_send_udp);
 
+/**
+ * netpoll_alloc_udp - build a UDP frame to the remote end
+ * @np: netpoll instance
+ * @msg: payload
+ * @len: payload length
+ * @gfp: allocation flags
+ *
+ * Unlike netpoll_send_udp() this neither polls the device nor sends
+ * the frame: callers that may sleep or run with interrupts enabled can
+ * queue it with dev_queue_xmit() instead.
+ */
+struct sk_buff *netpoll_alloc_udp(struct netpoll *np, const char *msg,
+				  int len, gfp_t gfp)
+{
+	int total_len = netpoll_udp_total_len(np, len);
+	struct sk_buff *skb;
+
+	skb = alloc_skb(total_len + np->dev->needed_tailroom, gfp);
+	if (!skb)
+		return NULL;
+
+	skb_reserve(skb, total_len - len);
+	netpoll_build_udp(np, skb, msg, len);
+	return skb;
+}
+EXPORT_SYMBOL(netpoll_alloc_udp);
+
 void netpoll_print_options(struct netpoll *np)
 {
 	np_info(np, "local port %d\n", np->local_port);
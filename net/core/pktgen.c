@@ -181,6 +181,8 @@
 #define IP_NAME_SZ 32
 #define MAX_MPLS_LABELS 16 /* This is the max label stack depth */
 #define MPLS_STACK_BOTTOM htonl(0x00000100)
+#define MAX_IMIX_ENTRIES 20
+#define IMIX_PRECISION 100 /* Slots of the IMIX size distribution table */
 
 #define func_enter() pr_debug("entering %s\n", __func__);
 
@@ -210,6 +212,13 @@
 #define T_REMDEVALL   (1<<2)	/* Remove all devs */
 #define T_REMDEV      (1<<3)	/* Remove one dev */
 
+/* One packet size of an IMIX and its share of the traffic */
+struct imix_pkt {
+	u64 size;
+	u64 weight;
+	u64 count_so_far;
+};
+
 /* If lock -- protects updating of if_list */
 #define   if_lock(t)           spin_lock(&(t->if_lock));
 #define   if_unlock(t)           spin_unlock(&(t->if_lock));
@@ -257,6 +266,12 @@ struct pktgen_dev {
 	int min_pkt_size;
 	int max_pkt_size;
 	int pkt_overhead;	/* overhead for MPLS, VLANs, IPSEC etc */
+
+	/* When set, the packet sizes are picked from an IMIX instead */
+	unsigned int n_imix_entries;
+	struct imix_pkt imix_entries[MAX_IMIX_ENTRIES];
+	/* Entry index for each slot, by the weights of the entries */
+	__u8 imix_distribution[IMIX_PRECISION];
 	int nfrags;
 	struct page *page;
 	u64 delay;		/* nano-seconds */
@@ -354,6 +369,7 @@ struct pktgen_dev {
 	__u16 cur_queue_map;
 	__u32 cur_pkt_size;
 	__u32 last_pkt_size;
+	__u8 cur_imix_entry;
 
 	__u8 hh[14];
 	/* = {
@@ -537,6 +553,17 @@ static int pktgen_if_show(struct seq_file *seq, void *v)
 		   (unsigned long long)pkt_dev->count, pkt_dev->min_pkt_size,
 		   pkt_dev->max_pkt_size);
 
+	if (pkt_dev->n_imix_entries > 0) {
+		unsigned int i;
+
+		seq_puts(seq, "     imix_weights: ");
+		for (i = 0; i < pkt_dev->n_imix_entries; i++)
+			seq_printf(seq, "%llu,%llu ",
+				   pkt_dev->imix_entries[i].size,
+				   pkt_dev->imix_entries[i].weight);
+		seq_puts(seq, "\n");
+	}
+
 	seq_printf(seq,
 		   "     frags: %d  delay: %llu  clone_skb: %d  ifname: %s\n",
 		   pkt_dev->nfrags, (unsigned long long) pkt_dev->delay,
@@ -697,6 +724,17 @@ static int pktgen_if_show(struct seq_file *seq, void *v)
 		   (unsigned long long)pkt_dev->sofar,
 		   (unsigned long long)pkt_dev->errors);
 
+	if (pkt_dev->n_imix_entries > 0) {
+		unsigned int i;
+
+		seq_puts(seq, "     imix_size_counts: ");
+		for (i = 0; i < pkt_dev->n_imix_entries; i++)
+			seq_printf(seq, "%llu,%llu ",
+				   pkt_dev->imix_entries[i].size,
+				   pkt_dev->imix_entries[i].count_so_far);
+		seq_puts(seq, "\n");
+	}
+
 	seq_printf(seq,
 		   "     started: %lluus  stopped: %lluus idle: %lluus\n",
 		   (unsigned long long) ktime_to_us(pkt_dev->started_at),
@@ -849,6 +887,70 @@ static ssize_t get_labels(const char __user *buffer, struct pktgen_dev *pkt_dev)
 	return i;
 }
 
+/* Parses "size_1,weight_1 size_2,weight_2 ...", no entries turns IMIX off */
+static ssize_t get_imix_entries(const char __user *buffer, size_t maxlen,
+				struct pktgen_dev *pkt_dev)
+{
+	unsigned long size, weight;
+	unsigned int n = 0;
+	ssize_t i = 0;
+	int len;
+	char c;
+
+	pkt_dev->n_imix_entries = 0;
+	while (i < maxlen) {
+		if (n >= MAX_IMIX_ENTRIES)
+			return -E2BIG;
+
+		len = num_arg(&buffer[i], 10, &size);
+		if (len <= 0)
+			return len ? len : -EINVAL;
+		i += len;
+		if (get_user(c, &buffer[i]))
+			return -EFAULT;
+		if (c != ',')
+			return -EINVAL;
+		i++;
+
+		len = num_arg(&buffer[i], 10, &weight);
+		if (len <= 0)
+			return len ? len : -EINVAL;
+		i += len;
+		if (!weight)
+			return -EINVAL;
+
+		pkt_dev->imix_entries[n].size = max_t(unsigned long, size,
+						      14 + 20 + 8);
+		pkt_dev->imix_entries[n].weight = weight;
+		pkt_dev->imix_entries[n].count_so_far = 0;
+		n++;
+
+		len = count_trail_chars(&buffer[i], maxlen - i);
+		if (len < 0)
+			return len;
+		i += len;
+	}
+
+	pkt_dev->n_imix_entries = n;
+	return i;
+}
+
+static void fill_imix_distribution(struct pktgen_dev *pkt_dev)
+{
+	u64 total = 0, sum = 0;
+	unsigned int i, slot = 0, end;
+
+	for (i = 0; i < pkt_dev->n_imix_entries; i++)
+		total += pkt_dev->imix_entries[i].weight;
+
+	for (i = 0; i < pkt_dev->n_imix_entries; i++) {
+		sum += pkt_dev->imix_entries[i].weight;
+		end = div64_u64(sum * IMIX_PRECISION, total);
+		for (; slot < end; slot++)
+			pkt_dev->imix_distribution[slot] = i;
+	}
+}
+
 static ssize_t pktgen_if_write(struct file *file,
 			       const char __user * user_buffer, size_t count,
 			       loff_t * offset)
@@ -958,6 +1060,17 @@ static ssize_t pktgen_if_write(struct file *file,
 		return count;
 	}
 
+	if (!strcmp(name, "imix_weights")) {
+		len = get_imix_entries(&user_buffer[i], count - i, pkt_dev);
+		if (len < 0)
+			return len;
+
+		fill_imix_distribution(pkt_dev);
+		sprintf(pg_result, "OK: imix_weights, %u entries",
+			pkt_dev->n_imix_entries);
+		return count;
+	}
+
 	if (!strcmp(name, "debug")) {
 		len = num_arg(&user_buffer[i], 10, &value);
 		if (len < 0)
@@ -2504,7 +2617,13 @@ static void mod_cur_headers(struct pktgen_dev *pkt_dev)
 		}
 	}
 
-	if (pkt_dev->min_pkt_size < pkt_dev->max_pkt_size) {
+	if (pkt_dev->n_imix_entries > 0) {
+		__u8 entry = pkt_dev->imix_distribution[prandom_u32() %
+							IMIX_PRECISION];
+
+		pkt_dev->cur_imix_entry = entry;
+		pkt_dev->cur_pkt_size = pkt_dev->imix_entries[entry].size;
+	} else if (pkt_dev->min_pkt_size < pkt_dev->max_pkt_size) {
 		__u32 t;
 		if (pkt_dev->flags & F_TXSIZE_RND) {
 			t = prandom_u32() %
@@ -3009,11 +3128,15 @@ static struct sk_buff *fill_packet(struct net_device *odev,
 
 static void pktgen_clear_counters(struct pktgen_dev *pkt_dev)
 {
+	unsigned int i;
+
 	pkt_dev->seq_num = 1;
 	pkt_dev->idle_acc = 0;
 	pkt_dev->sofar = 0;
 	pkt_dev->tx_bytes = 0;
 	pkt_dev->errors = 0;
+	for (i = 0; i < pkt_dev->n_imix_entries; i++)
+		pkt_dev->imix_entries[i].count_so_far = 0;
 }
 
 /* Set up structure for sending pkts, clear counters */
@@ -3373,6 +3496,9 @@ xmit_more:
 		pkt_dev->sofar++;
 		pkt_dev->seq_num++;
 		pkt_dev->tx_bytes += pkt_dev->last_pkt_size;
+		if (pkt_dev->n_imix_entries > 0)
+			pkt_dev->imix_entries[pkt_dev->cur_imix_entry]
+				.count_so_far++;
 		if (burst > 0 && !netif_xmit_frozen_or_drv_stopped(txq))
 			goto xmit_more;
 		break;
@@ -1198,6 +1198,8 @@ static const struct nla_policy ifla_policy[IFLA_MAX+1] = {
 	[IFLA_NUM_RX_QUEUES]	= { .type = NLA_U32 },
 	[IFLA_PHYS_PORT_ID]	= { .type = NLA_BINARY, .len = MAX_PHYS_PORT_ID_LEN },
 	[IFLA_CARRIER_CHANGES]	= { .type = NLA_U32 },  /* ignored */
+	[IFLA_RX_EARLY_FILTER]	= { .type = NLA_BINARY, .len = BPF_MAXINSNS *
+				    sizeof(struct sock_filter) },
 };
 
 static const struct nla_policy ifla_info_policy[IFLA_INFO_MAX+1] = {
@@ -1615,6 +1617,20 @@ static int do_setlink(const struct sk_buff *skb,
 		status |= DO_SETLINK_MODIFIED;
 	}
 
+	if (tb[IFLA_RX_EARLY_FILTER]) {
+		struct nlattr *filter = tb[IFLA_RX_EARLY_FILTER];
+
+		err = -EINVAL;
+		if (nla_len(filter) % sizeof(struct sock_filter))
+			goto errout;
+
+		err = dev_set_rx_early_filter(dev, nla_data(filter),
+				nla_len(filter) / sizeof(struct sock_filter));
+		if (err)
+			goto errout;
+		status |= DO_SETLINK_MODIFIED;
+	}
+
 	if (tb[IFLA_TXQLEN]) {
 		unsigned long value = nla_get_u32(tb[IFLA_TXQLEN]);
 
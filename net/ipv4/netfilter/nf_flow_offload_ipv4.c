@@ -0,0 +1,484 @@
+/*
+ * Software fast path for established IPv4 conntrack flows
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Once a forwarded TCP or UDP connection is established, the first
+ * packet of each direction that leaves through POST_ROUTING records its
+ * ingress tuple, its header after NAT and its route in a flow entry.
+ * Later packets matching an entry are rewritten and handed to the
+ * neighbour layer from PRE_ROUTING, they skip conntrack, the iptables
+ * chains and the forwarding path. TCP FIN and RST packets are left to
+ * the slow path so that conntrack sees the connection close.
+ *
+ * A flow expires after it has been idle for NF_FLOW_OFFLOAD_TIMEOUT;
+ * until then the timeout of its conntrack entry is kept ahead of it.
+ */
+
+#include <linux/init.h>
+#include <linux/ip.h>
+#include <linux/jhash.h>
+#include <linux/module.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter_ipv4.h>
+#include <linux/random.h>
+#include <linux/rculist.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/workqueue.h>
+#include <net/arp.h>
+#include <net/ip.h>
+#include <net/route.h>
+#include <net/netfilter/nf_conntrack.h>
+#include <net/netfilter/nf_conntrack_helper.h>
+
+#define NF_FLOW_OFFLOAD_HSIZE		1024
+#define NF_FLOW_OFFLOAD_TIMEOUT		(30 * HZ)
+#define NF_FLOW_OFFLOAD_GC_INTERVAL	HZ
+
+static unsigned int max_flows __read_mostly = 8192;
+module_param(max_flows, uint, 0644);
+MODULE_PARM_DESC(max_flows, "Maximum number of offloaded flows");
+
+struct flow_offload_tuple {
+	__be32			saddr;
+	__be32			daddr;
+	__be16			sport;
+	__be16			dport;
+	u8			proto;
+	int			iifindex;
+};
+
+struct flow_offload {
+	struct hlist_node	node;
+	struct flow_offload_tuple tuple;
+
+	/* header after NAT */
+	__be32			nat_saddr;
+	__be32			nat_daddr;
+	__be16			nat_sport;
+	__be16			nat_dport;
+
+	struct dst_entry	*dst;
+	struct nf_conn		*ct;
+	unsigned long		timeout;	/* jiffies */
+	bool			dead;
+	struct rcu_head		rcu;
+};
+
+static struct hlist_head nf_flow_offload_hash[NF_FLOW_OFFLOAD_HSIZE];
+static DEFINE_SPINLOCK(nf_flow_offload_lock);	/* protects the hash writers */
+static unsigned int nf_flow_offload_count;
+static u32 nf_flow_offload_rnd __read_mostly;
+static struct delayed_work nf_flow_offload_gc_work;
+
+static u32 nf_flow_offload_hashfn(const struct flow_offload_tuple *t)
+{
+	return jhash_3words((__force u32)t->saddr, (__force u32)t->daddr,
+			    ((__force u32)t->sport << 16) | (__force u32)t->dport,
+			    nf_flow_offload_rnd ^ t->proto) &
+	       (NF_FLOW_OFFLOAD_HSIZE - 1);
+}
+
+static bool nf_flow_offload_tuple_equal(const struct flow_offload_tuple *a,
+					const struct flow_offload_tuple *b)
+{
+	return a->saddr == b->saddr && a->daddr == b->daddr &&
+	       a->sport == b->sport && a->dport == b->dport &&
+	       a->proto == b->proto && a->iifindex == b->iifindex;
+}
+
+/* called under rcu_read_lock() or with nf_flow_offload_lock held */
+static struct flow_offload *
+nf_flow_offload_lookup(const struct flow_offload_tuple *tuple)
+{
+	struct flow_offload *flow;
+
+	hlist_for_each_entry_rcu(flow,
+			&nf_flow_offload_hash[nf_flow_offload_hashfn(tuple)],
+			node) {
+		if (!flow->dead &&
+		    nf_flow_offload_tuple_equal(&flow->tuple, tuple))
+			return flow;
+	}
+
+	return NULL;
+}
+
+static void nf_flow_offload_free_rcu(struct rcu_head *head)
+{
+	struct flow_offload *flow = container_of(head, struct flow_offload,
+						 rcu);
+
+	dst_release(flow->dst);
+	nf_ct_put(flow->ct);
+	kfree(flow);
+}
+
+/* called with nf_flow_offload_lock held */
+static void nf_flow_offload_del(struct flow_offload *flow)
+{
+	hlist_del_rcu(&flow->node);
+	nf_flow_offload_count--;
+	call_rcu(&flow->rcu, nf_flow_offload_free_rcu);
+}
+
+static bool nf_flow_offload_ct_ok(const struct nf_conn *ct)
+{
+	if (test_bit(IPS_DYING_BIT, &ct->status))
+		return false;
+
+	return nf_ct_protonum(ct) != IPPROTO_TCP ||
+	       ct->proto.tcp.state == TCP_CONNTRACK_ESTABLISHED;
+}
+
+static int nf_flow_offload_ports(struct sk_buff *skb, unsigned int thoff,
+				 __be16 *ports)
+{
+	__be16 _ports[2], *p;
+
+	p = skb_header_pointer(skb, thoff, sizeof(_ports), _ports);
+	if (!p)
+		return -1;
+
+	ports[0] = p[0];
+	ports[1] = p[1];
+	return 0;
+}
+
+static void nf_flow_offload_nat(struct sk_buff *skb,
+				struct flow_offload *flow, unsigned int thoff)
+{
+	struct iphdr *iph = ip_hdr(skb);
+	__be16 *ports = (__be16 *)(skb_network_header(skb) + thoff);
+	__sum16 *check;
+
+	if (iph->protocol == IPPROTO_TCP) {
+		check = &((struct tcphdr *)ports)->check;
+	} else {
+		check = &((struct udphdr *)ports)->check;
+		if (!*check && skb->ip_summed != CHECKSUM_PARTIAL)
+			check = NULL;
+	}
+
+	if (iph->saddr != flow->nat_saddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->saddr,
+						 flow->nat_saddr, 1);
+		csum_replace4(&iph->check, iph->saddr, flow->nat_saddr);
+		iph->saddr = flow->nat_saddr;
+	}
+	if (iph->daddr != flow->nat_daddr) {
+		if (check)
+			inet_proto_csum_replace4(check, skb, iph->daddr,
+						 flow->nat_daddr, 1);
+		csum_replace4(&iph->check, iph->daddr, flow->nat_daddr);
+		iph->daddr = flow->nat_daddr;
+	}
+	if (ports[0] != flow->nat_sport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[0],
+						 flow->nat_sport, 0);
+		ports[0] = flow->nat_sport;
+	}
+	if (ports[1] != flow->nat_dport) {
+		if (check)
+			inet_proto_csum_replace2(check, skb, ports[1],
+						 flow->nat_dport, 0);
+		ports[1] = flow->nat_dport;
+	}
+	if (check && iph->protocol == IPPROTO_UDP && !*check)
+		*check = CSUM_MANGLED_0;
+}
+
+static unsigned int nf_flow_offload_ingress(const struct nf_hook_ops *ops,
+					    struct sk_buff *skb,
+					    const struct net_device *in,
+					    const struct net_device *out,
+					    int (*okfn)(struct sk_buff *))
+{
+	struct flow_offload_tuple tuple;
+	struct flow_offload *flow;
+	struct net_device *dev;
+	struct neighbour *neigh;
+	struct dst_entry *dst;
+	unsigned int thoff;
+	struct iphdr *iph;
+	__be16 ports[2];
+	u32 nexthop;
+
+	if (skb->pkt_type != PACKET_HOST || !net_eq(dev_net(in), &init_net))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || ip_is_fragment(iph) || iph->ttl <= 1 ||
+	    (iph->protocol != IPPROTO_TCP && iph->protocol != IPPROTO_UDP))
+		return NF_ACCEPT;
+
+	thoff = iph->ihl * 4;
+	if (nf_flow_offload_ports(skb, thoff, ports))
+		return NF_ACCEPT;
+
+	tuple.saddr = iph->saddr;
+	tuple.daddr = iph->daddr;
+	tuple.sport = ports[0];
+	tuple.dport = ports[1];
+	tuple.proto = iph->protocol;
+	tuple.iifindex = in->ifindex;
+
+	flow = nf_flow_offload_lookup(&tuple);
+	if (!flow)
+		return NF_ACCEPT;
+
+	if (!nf_flow_offload_ct_ok(flow->ct) || !dst_check(flow->dst, 0)) {
+		flow->dead = true;
+		return NF_ACCEPT;
+	}
+
+	if (iph->protocol == IPPROTO_TCP) {
+		struct tcphdr _tcph;
+		const struct tcphdr *tcph;
+
+		tcph = skb_header_pointer(skb, thoff, sizeof(_tcph), &_tcph);
+		if (!tcph)
+			return NF_ACCEPT;
+		/* conntrack has to see the connection being closed */
+		if (tcph->fin || tcph->rst) {
+			flow->dead = true;
+			return NF_ACCEPT;
+		}
+	}
+
+	dst = flow->dst;
+	dev = dst->dev;
+	if (skb->len > dst_mtu(dst) ||
+	    (skb_headroom(skb) < LL_RESERVED_SPACE(dev) && dev->header_ops))
+		return NF_ACCEPT;
+
+	if (!skb_make_writable(skb, thoff + (iph->protocol == IPPROTO_TCP ?
+					     sizeof(struct tcphdr) :
+					     sizeof(struct udphdr))))
+		return NF_DROP;
+
+	flow->timeout = jiffies + NF_FLOW_OFFLOAD_TIMEOUT;
+
+	nf_flow_offload_nat(skb, flow, thoff);
+	ip_decrease_ttl(ip_hdr(skb));
+	skb_forward_csum(skb);
+	skb->priority = rt_tos2priority(ip_hdr(skb)->tos);
+	skb->dev = dev;
+	skb_dst_set(skb, dst_clone(dst));
+
+	IP_INC_STATS_BH(dev_net(dev), IPSTATS_MIB_OUTFORWDATAGRAMS);
+	IP_ADD_STATS_BH(dev_net(dev), IPSTATS_MIB_OUTOCTETS, skb->len);
+
+	rcu_read_lock_bh();
+	nexthop = (__force u32)rt_nexthop((struct rtable *)dst,
+					  ip_hdr(skb)->daddr);
+	neigh = __ipv4_neigh_lookup_noref(dev, nexthop);
+	if (unlikely(!neigh))
+		neigh = __neigh_create(&arp_tbl, &nexthop, dev, false);
+	if (IS_ERR(neigh)) {
+		rcu_read_unlock_bh();
+		kfree_skb(skb);
+		return NF_STOLEN;
+	}
+	dst_neigh_output(dst, neigh, skb);
+	rcu_read_unlock_bh();
+
+	return NF_STOLEN;
+}
+
+static void nf_flow_offload_add(struct sk_buff *skb, struct nf_conn *ct,
+				enum ip_conntrack_info ctinfo)
+{
+	const struct nf_conntrack_tuple *ct_tuple;
+	struct dst_entry *dst = skb_dst(skb);
+	const struct iphdr *iph = ip_hdr(skb);
+	struct flow_offload *flow;
+	__be16 ports[2];
+
+	if (nf_flow_offload_ports(skb, iph->ihl * 4, ports))
+		return;
+
+	flow = kzalloc(sizeof(*flow), GFP_ATOMIC);
+	if (!flow)
+		return;
+
+	ct_tuple = &ct->tuplehash[CTINFO2DIR(ctinfo)].tuple;
+	flow->tuple.saddr = ct_tuple->src.u3.ip;
+	flow->tuple.daddr = ct_tuple->dst.u3.ip;
+	flow->tuple.sport = ct_tuple->src.u.all;
+	flow->tuple.dport = ct_tuple->dst.u.all;
+	flow->tuple.proto = ct_tuple->dst.protonum;
+	flow->tuple.iifindex = skb->skb_iif;
+
+	flow->nat_saddr = iph->saddr;
+	flow->nat_daddr = iph->daddr;
+	flow->nat_sport = ports[0];
+	flow->nat_dport = ports[1];
+	flow->timeout = jiffies + NF_FLOW_OFFLOAD_TIMEOUT;
+
+	spin_lock_bh(&nf_flow_offload_lock);
+	if (nf_flow_offload_count >= max_flows ||
+	    nf_flow_offload_lookup(&flow->tuple)) {
+		spin_unlock_bh(&nf_flow_offload_lock);
+		kfree(flow);
+		return;
+	}
+
+	flow->dst = dst_clone(dst);
+	nf_conntrack_get(&ct->ct_general);
+	flow->ct = ct;
+
+	/* the window tracking does not see the offloaded packets */
+	if (nf_ct_protonum(ct) == IPPROTO_TCP) {
+		spin_lock(&ct->lock);
+		ct->proto.tcp.seen[0].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		ct->proto.tcp.seen[1].flags |= IP_CT_TCP_FLAG_BE_LIBERAL;
+		spin_unlock(&ct->lock);
+	}
+
+	hlist_add_head_rcu(&flow->node,
+		&nf_flow_offload_hash[nf_flow_offload_hashfn(&flow->tuple)]);
+	nf_flow_offload_count++;
+	spin_unlock_bh(&nf_flow_offload_lock);
+}
+
+static unsigned int nf_flow_offload_egress(const struct nf_hook_ops *ops,
+					   struct sk_buff *skb,
+					   const struct net_device *in,
+					   const struct net_device *out,
+					   int (*okfn)(struct sk_buff *))
+{
+	enum ip_conntrack_info ctinfo;
+	const struct iphdr *iph;
+	struct nf_conn *ct;
+
+	if (!(IPCB(skb)->flags & IPSKB_FORWARDED) ||
+	    !net_eq(dev_net(out), &init_net))
+		return NF_ACCEPT;
+
+	ct = nf_ct_get(skb, &ctinfo);
+	if (!ct || nf_ct_is_untracked(ct) ||
+	    (ctinfo != IP_CT_ESTABLISHED && ctinfo != IP_CT_ESTABLISHED_REPLY))
+		return NF_ACCEPT;
+
+	iph = ip_hdr(skb);
+	if (iph->ihl != 5 || ip_is_fragment(iph) ||
+	    (iph->protocol != IPPROTO_TCP && iph->protocol != IPPROTO_UDP))
+		return NF_ACCEPT;
+
+	/* helpers and sequence adjustment need to see every packet */
+	if (nfct_help(ct) || test_bit(IPS_SEQ_ADJUST_BIT, &ct->status) ||
+	    !nf_flow_offload_ct_ok(ct))
+		return NF_ACCEPT;
+
+	if (!skb_dst(skb) || dst_xfrm(skb_dst(skb)))
+		return NF_ACCEPT;
+
+	nf_flow_offload_add(skb, ct, ctinfo);
+	return NF_ACCEPT;
+}
+
+static void nf_flow_offload_gc(struct work_struct *work)
+{
+	struct flow_offload *flow;
+	struct hlist_node *n;
+	unsigned int i;
+
+	spin_lock_bh(&nf_flow_offload_lock);
+	for (i = 0; i < NF_FLOW_OFFLOAD_HSIZE; i++) {
+		hlist_for_each_entry_safe(flow, n, &nf_flow_offload_hash[i],
+					  node) {
+			struct nf_conn *ct = flow->ct;
+			unsigned long timeout = ACCESS_ONCE(flow->timeout);
+
+			if (flow->dead || time_after(jiffies, timeout) ||
+			    !nf_flow_offload_ct_ok(ct) ||
+			    !dst_check(flow->dst, 0)) {
+				nf_flow_offload_del(flow);
+				continue;
+			}
+
+			/*
+			 * Keep conntrack from expiring the connection while
+			 * it is offloaded, it only ever sees the timeout
+			 * extended.
+			 */
+			if (!test_bit(IPS_FIXED_TIMEOUT_BIT, &ct->status) &&
+			    (s32)(ct->timeout - (u32)timeout) < 0)
+				ct->timeout = timeout;
+		}
+	}
+	spin_unlock_bh(&nf_flow_offload_lock);
+
+	schedule_delayed_work(&nf_flow_offload_gc_work,
+			      NF_FLOW_OFFLOAD_GC_INTERVAL);
+}
+
+static struct nf_hook_ops nf_flow_offload_ops[] __read_mostly = {
+	{
+		.hook		= nf_flow_offload_ingress,
+		.owner		= THIS_MODULE,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_PRE_ROUTING,
+		.priority	= NF_IP_PRI_CONNTRACK_DEFRAG + 1,
+	},
+	{
+		.hook		= nf_flow_offload_egress,
+		.owner		= THIS_MODULE,
+		.pf		= NFPROTO_IPV4,
+		.hooknum	= NF_INET_POST_ROUTING,
+		.priority	= NF_IP_PRI_LAST,
+	},
+};
+
+static int __init nf_flow_offload_init(void)
+{
+	int ret;
+
+	get_random_bytes(&nf_flow_offload_rnd, sizeof(nf_flow_offload_rnd));
+	INIT_DEFERRABLE_WORK(&nf_flow_offload_gc_work, nf_flow_offload_gc);
+
+	ret = nf_register_hooks(nf_flow_offload_ops,
+				ARRAY_SIZE(nf_flow_offload_ops));
+	if (ret < 0)
+		return ret;
+
+	schedule_delayed_work(&nf_flow_offload_gc_work,
+			      NF_FLOW_OFFLOAD_GC_INTERVAL);
+	return 0;
+}
+
+static void __exit nf_flow_offload_fini(void)
+{
+	struct flow_offload *flow;
+	struct hlist_node *n;
+	unsigned int i;
+
+	nf_unregister_hooks(nf_flow_offload_ops,
+			    ARRAY_SIZE(nf_flow_offload_ops));
+	cancel_delayed_work_sync(&nf_flow_offload_gc_work);
+
+	spin_lock_bh(&nf_flow_offload_lock);
+	for (i = 0; i < NF_FLOW_OFFLOAD_HSIZE; i++)
+		hlist_for_each_entry_safe(flow, n, &nf_flow_offload_hash[i],
+					  node)
+			nf_flow_offload_del(flow);
+	spin_unlock_bh(&nf_flow_offload_lock);
+
+	rcu_barrier();
+}
+
+module_init(nf_flow_offload_init);
+module_exit(nf_flow_offload_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Software fast path for established IPv4 conntrack flows");
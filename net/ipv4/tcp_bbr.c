@@ -0,0 +1,375 @@
+/*
+ * TCP BBR: model based congestion control
+ *
+ * Instead of reacting to loss, the sender keeps an estimate of the
+ * bottleneck bandwidth (the windowed maximum of the delivery rate measured
+ * over the last rounds) and of the round trip propagation time (the
+ * windowed minimum RTT). It paces at a gain cycled around the estimated
+ * bandwidth and bounds cwnd to a small multiple of the estimated
+ * bandwidth-delay product, so random loss on the path does not make it
+ * back off. Pacing relies on the FQ packet scheduler honouring
+ * sk_pacing_rate.
+ *
+ * STARTUP grows the sending rate like slow start until the bandwidth
+ * estimate stops growing, DRAIN then empties the queue built up meanwhile,
+ * PROBE_BW cruises at the estimated bandwidth apart from one probing and
+ * one draining phase per cycle, and PROBE_RTT briefly shrinks cwnd when
+ * the RTT estimate has not been refreshed for a while.
+ *
+ * The bandwidth samples are the per-ack delivery rate samples of
+ * tcp_rate.c, a round ends when a skb sent after its start is delivered.
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/random.h>
+#include <net/tcp.h>
+
+/* Bandwidth in packets per usec, scaled by 2^BW_SCALE */
+#define BW_SCALE		24
+#define BW_UNIT			(1 << BW_SCALE)
+
+/* Gains in units of 1/BBR_UNIT */
+#define BBR_SCALE		8
+#define BBR_UNIT		(1 << BBR_SCALE)
+
+#define BBR_BW_RTTS		10	/* bandwidth filter window in rounds */
+#define BBR_CYCLE_LEN		8	/* phases of a PROBE_BW gain cycle */
+#define BBR_CWND_MIN		4
+#define BBR_MIN_RTT_WIN_SEC	10
+#define BBR_PROBE_RTT_MS	200
+#define BBR_FULL_BW_CNT		3	/* flat rounds to leave STARTUP */
+
+enum bbr_mode {
+	BBR_STARTUP,
+	BBR_DRAIN,
+	BBR_PROBE_BW,
+	BBR_PROBE_RTT,
+};
+
+/* 2/ln(2), the smallest gain that doubles the delivery rate every round */
+static const int bbr_high_gain = BBR_UNIT * 2885 / 1000 + 1;
+static const int bbr_drain_gain = BBR_UNIT * 1000 / 2885;
+static const int bbr_cwnd_gain = BBR_UNIT * 2;
+static const int bbr_pacing_gain[BBR_CYCLE_LEN] = {
+	BBR_UNIT * 5 / 4, BBR_UNIT * 3 / 4,
+	BBR_UNIT, BBR_UNIT, BBR_UNIT, BBR_UNIT, BBR_UNIT, BBR_UNIT,
+};
+
+struct bbr {
+	u32 bw[BBR_BW_RTTS];		/* max delivery rate per round */
+	struct skb_mstamp cycle_mstamp;	/* start of the current gain phase */
+	u32 next_rtt_delivered;		/* tp->delivered ending the round */
+	u32 min_rtt_us;
+	u32 min_rtt_stamp;		/* tcp_time_stamp of min_rtt_us */
+	u32 probe_rtt_done_stamp;	/* when to leave PROBE_RTT, or 0 */
+	u32 full_bw;			/* bandwidth at the last growth check */
+	u32 prior_cwnd;			/* cwnd before PROBE_RTT */
+	s32 rtt_us;			/* RTT sample of the current ack */
+	u8 mode;
+	u8 cycle_idx;
+	u8 round_idx;
+	u8 full_bw_cnt:7,
+	   full_pipe:1;			/* bandwidth estimate stopped growing */
+};
+
+static u32 bbr_max_bw(const struct bbr *bbr)
+{
+	u32 bw = 0;
+	int i;
+
+	for (i = 0; i < BBR_BW_RTTS; i++)
+		bw = max(bw, bbr->bw[i]);
+	return bw;
+}
+
+static int bbr_pacing_gain_now(const struct bbr *bbr)
+{
+	switch (bbr->mode) {
+	case BBR_STARTUP:
+		return bbr_high_gain;
+	case BBR_DRAIN:
+		return bbr_drain_gain;
+	case BBR_PROBE_BW:
+		return bbr_pacing_gain[bbr->cycle_idx];
+	default:
+		return BBR_UNIT;
+	}
+}
+
+/* Bandwidth-delay product in packets, scaled by @gain */
+static u32 bbr_bdp(const struct bbr *bbr, u32 bw, int gain)
+{
+	u64 bdp;
+
+	if (bbr->min_rtt_us == ~0U)
+		return TCP_INIT_CWND;
+
+	bdp = (u64)bw * bbr->min_rtt_us;
+	return (((bdp * gain) >> BBR_SCALE) + BW_UNIT - 1) >> BW_SCALE;
+}
+
+static void bbr_set_pacing_rate(struct sock *sk, u32 bw, int gain)
+{
+	const struct tcp_sock *tp = tcp_sk(sk);
+	u64 rate;
+
+	if (bw) {
+		rate = (u64)bw * tp->mss_cache * USEC_PER_SEC;
+		rate = (rate * gain) >> (BBR_SCALE + BW_SCALE);
+	} else if (tp->srtt_us) {
+		/* No sample yet, pace the initial window over one srtt */
+		rate = (u64)tp->snd_cwnd * tp->mss_cache * (USEC_PER_SEC << 3);
+		do_div(rate, tp->srtt_us);
+		rate = (rate * gain) >> BBR_SCALE;
+	} else {
+		return;
+	}
+
+	/* sch_fq fetches sk_pacing_rate without any lock */
+	ACCESS_ONCE(sk->sk_pacing_rate) = min_t(u64, rate,
+						sk->sk_max_pacing_rate);
+}
+
+static void bbr_reset_probe_bw(struct sock *sk)
+{
+	struct bbr *bbr = inet_csk_ca(sk);
+
+	bbr->mode = BBR_PROBE_BW;
+	/* Start in one of the cruising phases */
+	bbr->cycle_idx = 2 + prandom_u32_max(BBR_CYCLE_LEN - 2);
+	skb_mstamp_get(&bbr->cycle_mstamp);
+}
+
+static void bbr_init(struct sock *sk)
+{
+	struct bbr *bbr = inet_csk_ca(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	memset(bbr, 0, sizeof(*bbr));
+	bbr->mode = BBR_STARTUP;
+	bbr->min_rtt_us = ~0U;
+	bbr->min_rtt_stamp = tcp_time_stamp;
+	bbr->rtt_us = -1;
+	bbr->next_rtt_delivered = tp->delivered;
+}
+
+/* Feed the delivery rate sample of the ack into the bandwidth filter,
+ * returns true if a new round started.
+ */
+static bool bbr_update_bw(struct sock *sk, const struct rate_sample *rs)
+{
+	struct bbr *bbr = inet_csk_ca(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+	bool round_start = false;
+	u64 bw;
+
+	if (rs->delivered < 0 || rs->interval_us <= 0)
+		return false;
+
+	if (!before(rs->prior_delivered, bbr->next_rtt_delivered)) {
+		bbr->next_rtt_delivered = tp->delivered;
+		bbr->round_idx = (bbr->round_idx + 1) % BBR_BW_RTTS;
+		bbr->bw[bbr->round_idx] = 0;
+		round_start = true;
+	}
+
+	bw = (u64)rs->delivered * BW_UNIT;
+	do_div(bw, rs->interval_us);
+	bw = min_t(u64, bw, U32_MAX);
+	bbr->bw[bbr->round_idx] = max_t(u32, bbr->bw[bbr->round_idx], bw);
+
+	return round_start;
+}
+
+/* STARTUP is over once the bandwidth estimate grew by less than 25 % for
+ * BBR_FULL_BW_CNT rounds in a row.
+ */
+static void bbr_check_full_pipe(struct bbr *bbr, u32 bw)
+{
+	if (bbr->full_pipe)
+		return;
+
+	if (bw >= bbr->full_bw + (bbr->full_bw >> 2)) {
+		bbr->full_bw = bw;
+		bbr->full_bw_cnt = 0;
+		return;
+	}
+
+	if (++bbr->full_bw_cnt >= BBR_FULL_BW_CNT)
+		bbr->full_pipe = 1;
+}
+
+static void bbr_update_cycle(struct sock *sk, const struct skb_mstamp *now,
+			     u32 bw)
+{
+	struct bbr *bbr = inet_csk_ca(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+	u32 inflight = tcp_packets_in_flight(tp);
+	int gain = bbr_pacing_gain[bbr->cycle_idx];
+	bool done;
+
+	done = skb_mstamp_us_delta(now, &bbr->cycle_mstamp) > bbr->min_rtt_us;
+
+	/* Probing ends only once the extra packets are in flight, draining
+	 * ends early when the queue is gone.
+	 */
+	if (gain > BBR_UNIT)
+		done = done && inflight >= bbr_bdp(bbr, bw, gain);
+	else if (gain < BBR_UNIT)
+		done = done || inflight <= bbr_bdp(bbr, bw, BBR_UNIT);
+
+	if (done) {
+		bbr->cycle_idx = (bbr->cycle_idx + 1) % BBR_CYCLE_LEN;
+		bbr->cycle_mstamp = *now;
+	}
+}
+
+static void bbr_update_min_rtt(struct sock *sk)
+{
+	struct bbr *bbr = inet_csk_ca(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+	bool expired;
+
+	expired = (s32)(tcp_time_stamp - bbr->min_rtt_stamp) >
+		  BBR_MIN_RTT_WIN_SEC * HZ;
+	if (bbr->rtt_us >= 0 &&
+	    ((u32)bbr->rtt_us <= bbr->min_rtt_us || expired)) {
+		bbr->min_rtt_us = max(bbr->rtt_us, 1);
+		bbr->min_rtt_stamp = tcp_time_stamp;
+	}
+	bbr->rtt_us = -1;
+
+	if (expired && bbr->mode != BBR_PROBE_RTT) {
+		bbr->mode = BBR_PROBE_RTT;
+		bbr->prior_cwnd = tp->snd_cwnd;
+		bbr->probe_rtt_done_stamp = 0;
+	}
+
+	if (bbr->mode != BBR_PROBE_RTT)
+		return;
+
+	/* Hold cwnd at its minimum for BBR_PROBE_RTT_MS once the queue
+	 * drained, then go back to where we were.
+	 */
+	if (!bbr->probe_rtt_done_stamp &&
+	    tcp_packets_in_flight(tp) <= BBR_CWND_MIN) {
+		bbr->probe_rtt_done_stamp = tcp_time_stamp +
+			msecs_to_jiffies(BBR_PROBE_RTT_MS) ? : 1;
+	} else if (bbr->probe_rtt_done_stamp &&
+		   (s32)(tcp_time_stamp - bbr->probe_rtt_done_stamp) > 0) {
+		bbr->min_rtt_stamp = tcp_time_stamp;
+		tp->snd_cwnd = max(tp->snd_cwnd, bbr->prior_cwnd);
+		if (bbr->full_pipe)
+			bbr_reset_probe_bw(sk);
+		else
+			bbr->mode = BBR_STARTUP;
+	}
+}
+
+static void bbr_set_cwnd(struct sock *sk, u32 bw, u32 acked)
+{
+	struct bbr *bbr = inet_csk_ca(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+	u32 cwnd = tp->snd_cwnd, target;
+
+	if (bbr->mode == BBR_PROBE_RTT) {
+		cwnd = min_t(u32, cwnd, BBR_CWND_MIN);
+	} else {
+		target = bbr_bdp(bbr, bw, bbr->full_pipe ? bbr_cwnd_gain :
+							    bbr_high_gain);
+		/* Leave room for delayed and stretched acks */
+		target += 3;
+		cwnd += acked;
+		if (bbr->full_pipe)
+			cwnd = min(cwnd, target);
+	}
+
+	tp->snd_cwnd = min(max_t(u32, cwnd, BBR_CWND_MIN), tp->snd_cwnd_clamp);
+}
+
+static void bbr_main(struct sock *sk, const struct rate_sample *rs)
+{
+	struct bbr *bbr = inet_csk_ca(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct skb_mstamp now;
+	bool round;
+	u32 bw;
+
+	skb_mstamp_get(&now);
+	round = bbr_update_bw(sk, rs);
+	bw = bbr_max_bw(bbr);
+	if (round)
+		bbr_check_full_pipe(bbr, bw);
+
+	if (bbr->mode == BBR_STARTUP && bbr->full_pipe)
+		bbr->mode = BBR_DRAIN;
+	if (bbr->mode == BBR_DRAIN &&
+	    tcp_packets_in_flight(tp) <= bbr_bdp(bbr, bw, BBR_UNIT))
+		bbr_reset_probe_bw(sk);
+	if (bbr->mode == BBR_PROBE_BW)
+		bbr_update_cycle(sk, &now, bw);
+
+	bbr_update_min_rtt(sk);
+
+	bbr_set_pacing_rate(sk, bw, bbr_pacing_gain_now(bbr));
+	bbr_set_cwnd(sk, bw, rs->acked_sacked);
+}
+
+static void bbr_cong_avoid(struct sock *sk, u32 ack, u32 acked)
+{
+	/* cwnd is set by bbr_main() */
+}
+
+static void bbr_pkts_acked(struct sock *sk, u32 num_acked, s32 rtt_us)
+{
+	struct bbr *bbr = inet_csk_ca(sk);
+
+	if (rtt_us > 0)
+		bbr->rtt_us = rtt_us;
+}
+
+/* Loss is not a congestion signal for the model, keep the window */
+static u32 bbr_ssthresh(struct sock *sk)
+{
+	return tcp_sk(sk)->snd_cwnd;
+}
+
+static u32 bbr_undo_cwnd(struct sock *sk)
+{
+	return tcp_sk(sk)->snd_cwnd;
+}
+
+static struct tcp_congestion_ops tcp_bbr_cong_ops __read_mostly = {
+	.init		= bbr_init,
+	.ssthresh	= bbr_ssthresh,
+	.cong_avoid	= bbr_cong_avoid,
+	.cong_control	= bbr_main,
+	.undo_cwnd	= bbr_undo_cwnd,
+	.pkts_acked	= bbr_pkts_acked,
+
+	.owner		= THIS_MODULE,
+	.name		= "bbr",
+};
+
+static int __init bbr_register(void)
+{
+	BUILD_BUG_ON(sizeof(struct bbr) > ICSK_CA_PRIV_SIZE);
+	return tcp_register_congestion_control(&tcp_bbr_cong_ops);
+}
+
+static void __exit bbr_unregister(void)
+{
+	tcp_unregister_congestion_control(&tcp_bbr_cong_ops);
+}
+
+module_init(bbr_register);
+module_exit(bbr_unregister);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("TCP BBR (Bottleneck Bandwidth and RTT)");
@@ -99,6 +99,7 @@ int sysctl_tcp_thin_dupack __read_mostly;
 
 int sysctl_tcp_moderate_rcvbuf __read_mostly = 1;
 int sysctl_tcp_early_retrans __read_mostly = 3;
+int sysctl_tcp_recovery __read_mostly = TCP_RACK_LOSS_DETECTION;
 
 #define FLAG_DATA		0x01 /* Incoming frame contained data.		*/
 #define FLAG_WIN_UPDATE		0x02 /* Incoming ACK was a window update.	*/
@@ -857,8 +858,38 @@ static void tcp_update_reordering(struct sock *sk, const int metric,
 		tcp_disable_fack(tp);
 	}
 
-	if (metric > 0)
+	if (metric > 0) {
 		tcp_disable_early_retrans(tp);
+		tp->rack.reord = 1;
+	}
+}
+
+/* RACK: record the most recent (re)send time among the (s)acked skbs.
+ * Anything sent before that and not delivered yet is lost once the
+ * reordering window has passed, see tcp_rack_detect_loss().
+ */
+static void tcp_rack_advance(struct tcp_sock *tp,
+			     const struct skb_mstamp *xmit_time, u8 sacked)
+{
+	struct skb_mstamp now;
+	u32 rtt_us;
+
+	if (tp->rack.mstamp.v64 &&
+	    !skb_mstamp_after(xmit_time, &tp->rack.mstamp))
+		return;
+
+	skb_mstamp_get(&now);
+	rtt_us = skb_mstamp_us_delta(&now, xmit_time);
+
+	/* A retransmitted skb acked faster than the minimum RTT was most
+	 * likely delivered by an earlier transmission.
+	 */
+	if ((sacked & TCPCB_RETRANS) && rtt_us < tcp_min_rtt(tp))
+		return;
+
+	tp->rack.mstamp = *xmit_time;
+	tp->rack.rtt_us = rtt_us;
+	tp->rack.advanced = 1;
 }
 
 /* This must be called before lost_out is incremented */
@@ -1130,6 +1161,7 @@ struct tcp_sacktag_state {
 	int	fack_count;
 	long	rtt_us; /* RTT measured by SACKing never-retransmitted data */
 	int	flag;
+	struct rate_sample *rate;
 };
 
 /* Check if skb is fully within the SACK block. In presence of GSO skbs,
@@ -1247,9 +1279,11 @@ static u8 tcp_sacktag_one(struct sock *sk,
 			}
 		}
 
+		tcp_rack_advance(tp, xmit_time, sacked);
 		sacked |= TCPCB_SACKED_ACKED;
 		state->flag |= FLAG_DATA_SACKED;
 		tp->sacked_out += pcount;
+		tp->delivered += pcount;
 
 		fack_count += pcount;
 
@@ -1289,6 +1323,8 @@ static bool tcp_shifted_skb(struct sock *sk, struct sk_buff *skb,
 
 	BUG_ON(!pcount);
 
+	tcp_rate_skb_delivered(sk, skb, state->rate);
+
 	/* Adjust counters and hints for the newly sacked sequence
 	 * range but discard the return value since prev is already
 	 * marked. We must tag the range first because the seq
@@ -1576,6 +1612,7 @@ static struct sk_buff *tcp_sacktag_walk(struct sk_buff *skb, struct sock *sk,
 						dup_sack,
 						tcp_skb_pcount(skb),
 						&skb->skb_mstamp);
+			tcp_rate_skb_delivered(sk, skb, state->rate);
 
 			if (!before(TCP_SKB_CB(skb)->seq,
 				    tcp_highest_sack_seq(tp)))
@@ -1632,7 +1669,8 @@ static int tcp_sack_cache_ok(const struct tcp_sock *tp, const struct tcp_sack_bl
 
 static int
 tcp_sacktag_write_queue(struct sock *sk, const struct sk_buff *ack_skb,
-			u32 prior_snd_una, long *sack_rtt_us)
+			u32 prior_snd_una, long *sack_rtt_us,
+			struct rate_sample *rs)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 	const unsigned char *ptr = (skb_transport_header(ack_skb) +
@@ -1651,6 +1689,7 @@ tcp_sacktag_write_queue(struct sock *sk, const struct sk_buff *ack_skb,
 	state.flag = 0;
 	state.reord = tp->packets_out;
 	state.rtt_us = -1L;
+	state.rate = rs;
 
 	if (!tp->sacked_out) {
 		if (WARN_ON(tp->fackets_out))
@@ -1872,6 +1911,7 @@ static void tcp_add_reno_sack(struct sock *sk)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 	tp->sacked_out++;
+	tp->delivered++;
 	tcp_check_reno_reordering(sk, 0);
 	tcp_verify_left_out(tp);
 }
@@ -1884,6 +1924,7 @@ static void tcp_remove_reno_sacks(struct sock *sk, int acked)
 
 	if (acked > 0) {
 		/* One ACK acked hole. The rest eat duplicate ACKs. */
+		tp->delivered += max_t(int, acked - tp->sacked_out, 1);
 		if (acked - 1 >= tp->sacked_out)
 			tp->sacked_out = 0;
 		else
@@ -2165,8 +2206,10 @@ static bool tcp_time_to_recover(struct sock *sk, int flag)
 	if (tp->lost_out)
 		return true;
 
-	/* Not-A-Trick#2 : Classic rule... */
-	if (tcp_dupack_heuristics(tp) > tp->reordering)
+	/* Not-A-Trick#2 : Classic rule... RACK marks the losses itself,
+	 * which copes with reordering much better.
+	 */
+	if (!tcp_is_rack(tp) && tcp_dupack_heuristics(tp) > tp->reordering)
 		return true;
 
 	/* Trick#4: It is still not OK... But will it be useful to delay
@@ -2771,6 +2814,84 @@ static bool tcp_try_undo_partial(struct sock *sk, const int acked,
 	return false;
 }
 
+/* RACK: mark lost every skb sent before the most recently delivered one,
+ * by more than its RTT plus a reordering window. The window is 1ms, or a
+ * quarter of the minimum RTT once reordering has been seen on the path.
+ * @reo_timeout is set to the time in usecs after which the remaining
+ * candidates can be checked again, 0 if there are none.
+ */
+static void tcp_rack_detect_loss(struct sock *sk, u32 *reo_timeout)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct skb_mstamp now;
+	struct sk_buff *skb;
+	u32 reo_wnd = 1000;
+
+	*reo_timeout = 0;
+	if (tp->rack.reord && tcp_min_rtt(tp) != ~0U)
+		reo_wnd = max(tcp_min_rtt(tp) >> 2, reo_wnd);
+
+	skb_mstamp_get(&now);
+	tcp_for_write_queue(skb, sk) {
+		struct tcp_skb_cb *scb = TCP_SKB_CB(skb);
+		s32 remaining;
+
+		if (skb == tcp_send_head(sk))
+			break;
+
+		/* Skip the ones already (s)acked, or marked lost and not
+		 * retransmitted yet.
+		 */
+		if (!after(scb->end_seq, tp->snd_una) ||
+		    scb->sacked & TCPCB_SACKED_ACKED ||
+		    (scb->sacked & (TCPCB_LOST | TCPCB_SACKED_RETRANS)) ==
+		    TCPCB_LOST)
+			continue;
+
+		if (!skb_mstamp_after(&tp->rack.mstamp, &skb->skb_mstamp)) {
+			/* Original data is sent in sequence, everything
+			 * after it was sent later too.
+			 */
+			if (!(scb->sacked & TCPCB_RETRANS))
+				break;
+			continue;
+		}
+
+		remaining = tp->rack.rtt_us + reo_wnd -
+			    skb_mstamp_us_delta(&now, &skb->skb_mstamp);
+		if (remaining > 0) {
+			*reo_timeout = max_t(u32, *reo_timeout, remaining);
+			continue;
+		}
+
+		tcp_skb_mark_lost_uncond_verify(tp, skb);
+		if (scb->sacked & TCPCB_SACKED_RETRANS) {
+			scb->sacked &= ~TCPCB_SACKED_RETRANS;
+			tp->retrans_out -= tcp_skb_pcount(skb);
+			NET_INC_STATS_BH(sock_net(sk),
+					 LINUX_MIB_TCPLOSTRETRANSMIT);
+		}
+	}
+}
+
+static void tcp_rack_mark_lost(struct sock *sk)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	u32 timeout;
+
+	if (!tp->rack.advanced)
+		return;
+
+	/* Reset the advanced flag to avoid unnecessary queue scanning */
+	tp->rack.advanced = 0;
+	tcp_rack_detect_loss(sk, &timeout);
+	if (timeout) {
+		timeout = usecs_to_jiffies(timeout) + TCP_TIMEOUT_MIN;
+		inet_csk_reset_xmit_timer(sk, ICSK_TIME_EARLY_RETRANS,
+					  timeout, inet_csk(sk)->icsk_rto);
+	}
+}
+
 /* Process an event, which can update packets-in-flight not trivially.
  * Main goal of this function is to calculate new estimate for left_out,
  * taking into account both packets sitting in receiver's buffer and
@@ -2835,6 +2956,9 @@ static void tcp_fastretrans_alert(struct sock *sk, const int acked,
 		}
 	}
 
+	if (tcp_is_rack(tp))
+		tcp_rack_mark_lost(sk);
+
 	/* E. Process state. */
 	switch (icsk->icsk_ca_state) {
 	case TCP_CA_Recovery:
@@ -2890,12 +3014,30 @@ static void tcp_fastretrans_alert(struct sock *sk, const int acked,
 		fast_rexmit = 1;
 	}
 
-	if (do_lost)
+	if (tcp_is_rack(tp)) {
+		/* Recovery entered by one of the other heuristics still has
+		 * to retransmit the head.
+		 */
+		if (fast_rexmit && !tp->lost_out)
+			tcp_update_scoreboard(sk, fast_rexmit);
+	} else if (do_lost) {
 		tcp_update_scoreboard(sk, fast_rexmit);
+	}
 	tcp_cwnd_reduction(sk, prior_unsacked, fast_rexmit);
 	tcp_xmit_retransmit_queue(sk);
 }
 
+static void tcp_update_rtt_min(struct sock *sk, u32 rtt_us)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+
+	if (rtt_us <= tp->rtt_min_us ||
+	    (s32)(tcp_time_stamp - tp->rtt_min_stamp) > TCP_MIN_RTT_WIN) {
+		tp->rtt_min_us = max_t(u32, rtt_us, 1);
+		tp->rtt_min_stamp = tcp_time_stamp;
+	}
+}
+
 static inline bool tcp_ack_update_rtt(struct sock *sk, const int flag,
 				      long seq_rtt_us, long sack_rtt_us)
 {
@@ -2925,6 +3067,7 @@ static inline bool tcp_ack_update_rtt(struct sock *sk, const int flag,
 	if (seq_rtt_us < 0)
 		return false;
 
+	tcp_update_rtt_min(sk, seq_rtt_us);
 	tcp_rtt_estimator(sk, seq_rtt_us);
 	tcp_set_rto(sk);
 
@@ -3000,6 +3143,12 @@ void tcp_resume_early_retransmit(struct sock *sk)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 
+	/* RACK uses the same timer for its reordering window */
+	if (tcp_is_rack(tp)) {
+		tcp_rack_reo_timeout(sk);
+		return;
+	}
+
 	tcp_rearm_rto(sk);
 
 	/* Stop if ER is disabled after the delayed ER timer is scheduled */
@@ -3011,6 +3160,26 @@ void tcp_resume_early_retransmit(struct sock *sk)
 	tcp_xmit_retransmit_queue(sk);
 }
 
+/* The RACK reordering window of the skbs left by the last ack expired,
+ * whatever is still missing now is lost.
+ */
+void tcp_rack_reo_timeout(struct sock *sk)
+{
+	struct inet_connection_sock *icsk = inet_csk(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+	u32 timeout, prior_inflight;
+
+	prior_inflight = tcp_packets_in_flight(tp);
+	tcp_rack_detect_loss(sk, &timeout);
+	if (prior_inflight != tcp_packets_in_flight(tp)) {
+		if (icsk->icsk_ca_state < TCP_CA_Recovery)
+			tcp_enter_recovery(sk, false);
+		tcp_xmit_retransmit_queue(sk);
+	}
+	if (icsk->icsk_pending != ICSK_TIME_RETRANS)
+		tcp_rearm_rto(sk);
+}
+
 /* If we get here, the whole TSO packet has not been acked. */
 static u32 tcp_tso_acked(struct sock *sk, struct sk_buff *skb)
 {
@@ -3052,7 +3221,8 @@ static void tcp_ack_tstamp(struct sock *sk, struct sk_buff *skb,
  * arrived at the other end.
  */
 static int tcp_clean_rtx_queue(struct sock *sk, int prior_fackets,
-			       u32 prior_snd_una, long sack_rtt_us)
+			       u32 prior_snd_una, long sack_rtt_us,
+			       struct rate_sample *rs)
 {
 	const struct inet_connection_sock *icsk = inet_csk(sk);
 	struct skb_mstamp first_ackt, last_ackt, now;
@@ -3111,9 +3281,14 @@ static int tcp_clean_rtx_queue(struct sock *sk, int prior_fackets,
 
 		if (sacked & TCPCB_SACKED_ACKED)
 			tp->sacked_out -= acked_pcount;
+		else if (tcp_is_sack(tp))
+			tp->delivered += acked_pcount;
 		if (sacked & TCPCB_LOST)
 			tp->lost_out -= acked_pcount;
 
+		tcp_rack_advance(tp, &skb->skb_mstamp, sacked);
+		tcp_rate_skb_delivered(sk, skb, rs);
+
 		tp->packets_out -= acked_pcount;
 		pkts_acked += acked_pcount;
 
@@ -3410,6 +3585,8 @@ static int tcp_ack(struct sock *sk, const struct sk_buff *skb, int flag)
 	const int prior_unsacked = tp->packets_out - tp->sacked_out;
 	int acked = 0; /* Number of packets newly acked */
 	long sack_rtt_us = -1L;
+	struct rate_sample rs = { .prior_delivered = 0 };
+	u32 delivered = tp->delivered;
 
 	/* We very likely will need to access write queue head. */
 	prefetchw(sk->sk_write_queue.next);
@@ -3433,8 +3610,12 @@ static int tcp_ack(struct sock *sk, const struct sk_buff *skb, int flag)
 		goto invalid_ack;
 
 	if (icsk->icsk_pending == ICSK_TIME_EARLY_RETRANS ||
-	    icsk->icsk_pending == ICSK_TIME_LOSS_PROBE)
+	    icsk->icsk_pending == ICSK_TIME_LOSS_PROBE) {
+		/* Have the RACK reordering timer re-armed if still needed */
+		if (icsk->icsk_pending == ICSK_TIME_EARLY_RETRANS)
+			tp->rack.advanced = 1;
 		tcp_rearm_rto(sk);
+	}
 
 	if (after(ack, prior_snd_una)) {
 		flag |= FLAG_SND_UNA_ADVANCED;
@@ -3473,7 +3654,7 @@ static int tcp_ack(struct sock *sk, const struct sk_buff *skb, int flag)
 
 		if (TCP_SKB_CB(skb)->sacked)
 			flag |= tcp_sacktag_write_queue(sk, skb, prior_snd_una,
-							&sack_rtt_us);
+							&sack_rtt_us, &rs);
 
 		if (tcp_ecn_rcv_ecn_echo(tp, tcp_hdr(skb))) {
 			flag |= FLAG_ECE;
@@ -3498,11 +3679,11 @@ static int tcp_ack(struct sock *sk, const struct sk_buff *skb, int flag)
 	/* See if we can take anything off of the retransmit queue. */
 	acked = tp->packets_out;
 	flag |= tcp_clean_rtx_queue(sk, prior_fackets, prior_snd_una,
-				    sack_rtt_us);
+				    sack_rtt_us, &rs);
 	acked -= tp->packets_out;
 
 	/* Advance cwnd if state allows */
-	if (tcp_may_raise_cwnd(sk, flag))
+	if (!icsk->icsk_ca_ops->cong_control && tcp_may_raise_cwnd(sk, flag))
 		tcp_cong_avoid(sk, ack, acked);
 
 	if (tcp_ack_is_dubious(sk, flag)) {
@@ -3521,7 +3702,13 @@ static int tcp_ack(struct sock *sk, const struct sk_buff *skb, int flag)
 
 	if (icsk->icsk_pending == ICSK_TIME_RETRANS)
 		tcp_schedule_loss_probe(sk);
-	tcp_update_pacing_rate(sk);
+	tcp_rate_gen(sk, tp->delivered - delivered, &rs);
+	if (icsk->icsk_ca_ops->cong_control) {
+		icsk->icsk_ca_ops->cong_control(sk, &rs);
+		tp->snd_cwnd_stamp = tcp_time_stamp;
+	} else {
+		tcp_update_pacing_rate(sk);
+	}
 	return 1;
 
 no_queue:
@@ -3550,7 +3737,7 @@ old_ack:
 	 */
 	if (TCP_SKB_CB(skb)->sacked) {
 		flag |= tcp_sacktag_write_queue(sk, skb, prior_snd_una,
-						&sack_rtt_us);
+						&sack_rtt_us, &rs);
 		tcp_fastretrans_alert(sk, acked, prior_unsacked,
 				      is_dupack, flag);
 	}
@@ -0,0 +1,104 @@
+#include <linux/tcp.h>
+#include <net/tcp.h>
+
+/* Delivery rate sampling.
+ *
+ * Every ack yields a sample of the rate at which data was delivered to the
+ * receiver: the number of packets delivered between the send of the most
+ * recently (s)acked skb and this ack, divided by the time that took. Each
+ * skb remembers tp->delivered and the time of the last delivery when it
+ * was sent, so the interval can be recovered when it is (s)acked.
+ *
+ * The acks can be compressed or stretched on the way back, so the ack
+ * interval alone may make the rate look higher than it was. The length
+ * of the send phase bounds the rate the data could have been sent at, and
+ * the sample uses the longer of both intervals.
+ */
+
+/* Snapshot the delivery state into a skb that is about to be sent */
+void tcp_rate_skb_sent(struct sock *sk, struct sk_buff *skb)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct tcp_skb_cb *scb = TCP_SKB_CB(skb);
+
+	/* A new flight restarts both intervals, an idle period is not
+	 * part of the delivery rate.
+	 */
+	if (!tp->packets_out) {
+		tp->first_tx_us = skb->skb_mstamp.stamp_us;
+		tp->delivered_us = skb->skb_mstamp.stamp_us;
+	}
+
+	scb->tx.first_tx_us = tp->first_tx_us;
+	scb->tx.delivered_us = tp->delivered_us;
+	scb->tx.delivered = tp->delivered;
+}
+
+/* Called for each skb newly (s)acked by an ack, the sample is taken from
+ * the most recently sent one of them.
+ */
+void tcp_rate_skb_delivered(struct sock *sk, struct sk_buff *skb,
+			    struct rate_sample *rs)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct tcp_skb_cb *scb = TCP_SKB_CB(skb);
+
+	if (!scb->tx.delivered_us)
+		return;
+
+	if (!rs->prior_delivered ||
+	    after(scb->tx.delivered, rs->prior_delivered)) {
+		rs->prior_delivered = scb->tx.delivered;
+		rs->prior_us = scb->tx.delivered_us;
+		rs->is_retrans = scb->sacked & TCPCB_RETRANS;
+
+		/* Length of the send phase of this interval */
+		rs->interval_us = skb->skb_mstamp.stamp_us -
+				  scb->tx.first_tx_us;
+
+		/* The next send phase starts at this skb */
+		tp->first_tx_us = skb->skb_mstamp.stamp_us;
+	}
+
+	/* A sacked skb must not be used again once it is cumulatively
+	 * acked.
+	 */
+	if (scb->sacked & TCPCB_SACKED_ACKED)
+		scb->tx.delivered_us = 0;
+}
+
+/* Complete the sample of the current ack, @delivered packets got (s)acked */
+void tcp_rate_gen(struct sock *sk, u32 delivered, struct rate_sample *rs)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct skb_mstamp now;
+	s32 snd_us, ack_us;
+
+	skb_mstamp_get(&now);
+	if (delivered)
+		tp->delivered_us = now.stamp_us;
+
+	rs->acked_sacked = delivered;
+
+	if (!rs->prior_us) {
+		rs->delivered = -1;
+		rs->interval_us = -1;
+		return;
+	}
+
+	rs->delivered = tp->delivered - rs->prior_delivered;
+	snd_us = rs->interval_us;
+	ack_us = now.stamp_us - rs->prior_us;
+	rs->interval_us = max(snd_us, ack_us);
+
+	/* An interval shorter than the minimum RTT means the acks were
+	 * compressed, the sample would overestimate the rate.
+	 */
+	if (rs->interval_us <= 0 || (u32)rs->interval_us < tcp_min_rtt(tp)) {
+		rs->interval_us = -1;
+		return;
+	}
+
+	tp->rate_delivered = rs->delivered;
+	tp->rate_interval_us = rs->interval_us;
+}
@@ -14,6 +14,8 @@
 #include <net/udp.h>
 #include <net/protocol.h>
 
+#define UDP_GRO_CNT_MAX 64
+
 static DEFINE_SPINLOCK(udp_offload_lock);
 static struct udp_offload_priv __rcu *udp_offload_base __read_mostly;
 
@@ -142,6 +144,65 @@ out_unlock:
 	return segs;
 }
 
+/* Split a datagram queued with the UDP_SEGMENT socket option into
+ * datagrams of gso_size bytes of payload, the last one may be shorter.
+ * IP headers of the segments are updated in inet_gso_segment().
+ */
+static struct sk_buff *udp4_gso_segment(struct sk_buff *gso_skb,
+					netdev_features_t features)
+{
+	struct sk_buff *segs = ERR_PTR(-EINVAL);
+	unsigned int mss, oldlen, len;
+	struct sk_buff *skb;
+	struct udphdr *uh;
+	__be32 delta;
+
+	if (!pskb_may_pull(gso_skb, sizeof(*uh)))
+		goto out;
+
+	mss = skb_shinfo(gso_skb)->gso_size;
+	if (unlikely(gso_skb->len <= sizeof(*uh) + mss))
+		goto out;
+
+	if (skb_gso_ok(gso_skb, features | NETIF_F_GSO_ROBUST)) {
+		/* Packet is from an untrusted source, reset gso_segs. */
+		skb_shinfo(gso_skb)->gso_segs =
+			DIV_ROUND_UP(gso_skb->len - sizeof(*uh), mss);
+
+		segs = NULL;
+		goto out;
+	}
+
+	oldlen = (u16)~gso_skb->len;
+	__skb_pull(gso_skb, sizeof(*uh));
+
+	segs = skb_segment(gso_skb, features);
+	if (IS_ERR_OR_NULL(segs))
+		goto out;
+
+	/* Every segment starts with a copy of the original header, fix up
+	 * its length and the length in the pseudo header checksum.
+	 */
+	skb = segs;
+	do {
+		len = skb->len - skb_transport_offset(skb);
+		delta = htonl(oldlen + len);
+
+		uh = udp_hdr(skb);
+		uh->len = htons(len);
+		uh->check = ~csum_fold((__force __wsum)((__force u32)uh->check +
+							(__force u32)delta));
+
+		if (skb->ip_summed != CHECKSUM_PARTIAL) {
+			uh->check = gso_make_checksum(skb, ~uh->check);
+			if (uh->check == 0)
+				uh->check = CSUM_MANGLED_0;
+		}
+	} while ((skb = skb->next));
+out:
+	return segs;
+}
+
 static struct sk_buff *udp4_ufo_fragment(struct sk_buff *skb,
 					 netdev_features_t features)
 {
@@ -158,6 +219,9 @@ static struct sk_buff *udp4_ufo_fragment(struct sk_buff *skb,
 		goto out;
 	}
 
+	if (skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4)
+		return udp4_gso_segment(skb, features);
+
 	if (!pskb_may_pull(skb, sizeof(struct udphdr)))
 		goto out;
 
@@ -315,6 +379,78 @@ out:
 	return pp;
 }
 
+/* Does the receiving socket want its datagrams merged by GRO? */
+static bool udp4_gro_wanted(struct sk_buff *skb, struct udphdr *uh)
+{
+	const struct iphdr *iph = skb_gro_network_header(skb);
+	struct sock *sk;
+	bool wanted;
+
+	sk = __udp4_lib_lookup(dev_net(skb->dev), iph->saddr, uh->source,
+			       iph->daddr, uh->dest, skb->dev->ifindex,
+			       &udp_table);
+	if (!sk)
+		return false;
+
+	wanted = sk->sk_family == AF_INET && udp_sk(sk)->gro_enabled;
+	sock_put(sk);
+	return wanted;
+}
+
+/* Merge datagrams of one flow into a single skb, which is handed to the
+ * socket as is or split again by udp4_gso_segment().
+ */
+static struct sk_buff **udp_gro_receive_segment(struct sk_buff **head,
+						struct sk_buff *skb,
+						struct udphdr *uh)
+{
+	unsigned int off = skb_gro_offset(skb);
+	unsigned int ulen = ntohs(uh->len);
+	struct sk_buff **pp = NULL;
+	struct sk_buff *p;
+	struct udphdr *uh2;
+
+	/* Segmentation needs a checksum to fix up, and padded datagrams
+	 * can't be merged.
+	 */
+	if (!uh->check || ulen <= sizeof(*uh) || ulen != skb_gro_len(skb)) {
+		NAPI_GRO_CB(skb)->flush = 1;
+		return NULL;
+	}
+
+	NAPI_GRO_CB(skb)->udp_gro = 1;
+	skb_gro_pull(skb, sizeof(struct udphdr));
+	skb_gro_postpull_rcsum(skb, uh, sizeof(struct udphdr));
+
+	for (; (p = *head); head = &p->next) {
+		if (!NAPI_GRO_CB(p)->same_flow)
+			continue;
+
+		uh2 = (struct udphdr *)(p->data + off);
+
+		/* Match ports only, both checksums are nonzero */
+		if (*(u32 *)&uh->source != *(u32 *)&uh2->source) {
+			NAPI_GRO_CB(p)->same_flow = 0;
+			continue;
+		}
+
+		/* Datagrams as long as the first one are merged, a shorter
+		 * one is merged as the last one. A longer one, or one that
+		 * differs at the IP level, starts a new skb.
+		 */
+		if (NAPI_GRO_CB(p)->flush || NAPI_GRO_CB(skb)->flush ||
+		    !NAPI_GRO_CB(p)->udp_gro ||
+		    ulen > ntohs(uh2->len) || skb_gro_receive(head, skb) ||
+		    ulen != ntohs(uh2->len) ||
+		    NAPI_GRO_CB(*head)->count >= UDP_GRO_CNT_MAX)
+			pp = head;
+
+		return pp;
+	}
+
+	return NULL;
+}
+
 static struct sk_buff **udp4_gro_receive(struct sk_buff **head,
 					 struct sk_buff *skb)
 {
@@ -335,6 +471,9 @@ static struct sk_buff **udp4_gro_receive(struct sk_buff **head,
 					     inet_gro_compute_pseudo);
 skip:
 	NAPI_GRO_CB(skb)->is_ipv6 = 0;
+	if (static_key_false(&udp_gro_needed) &&
+	    !NAPI_GRO_CB(skb)->udp_mark && udp4_gro_wanted(skb, uh))
+		return udp_gro_receive_segment(head, skb, uh);
 	return udp_gro_receive(head, skb, uh);
 
 flush:
@@ -369,6 +508,21 @@ int udp_gro_complete(struct sk_buff *skb, int nhoff)
 	return err;
 }
 
+static int udp_gro_complete_segment(struct sk_buff *skb, int nhoff)
+{
+	struct udphdr *uh = (struct udphdr *)(skb->data + nhoff);
+
+	uh->len = htons(skb->len - nhoff);
+
+	skb->csum_start = (unsigned char *)uh - skb->head;
+	skb->csum_offset = offsetof(struct udphdr, check);
+	skb->ip_summed = CHECKSUM_PARTIAL;
+
+	skb_shinfo(skb)->gso_segs = NAPI_GRO_CB(skb)->count;
+	skb_shinfo(skb)->gso_type |= SKB_GSO_UDP_L4;
+	return 0;
+}
+
 static int udp4_gro_complete(struct sk_buff *skb, int nhoff)
 {
 	const struct iphdr *iph = ip_hdr(skb);
@@ -378,6 +532,8 @@ static int udp4_gro_complete(struct sk_buff *skb, int nhoff)
 		uh->check = ~udp_v4_check(skb->len - nhoff, iph->saddr,
 					  iph->daddr, 0);
 
+	if (NAPI_GRO_CB(skb)->udp_gro)
+		return udp_gro_complete_segment(skb, nhoff);
 	return udp_gro_complete(skb, nhoff);
 }
 
@@ -53,6 +53,10 @@ struct esp_skb_cb {
 
 static u32 esp6_get_mtu(struct xfrm_state *x, int mtu);
 
+static bool pcrypt;
+module_param(pcrypt, bool, 0644);
+MODULE_PARM_DESC(pcrypt, "Run the crypto of new SAs through pcrypt");
+
 /*
  * Allocate an AEAD request structure with extra space for SG and IV.
  *
@@ -457,12 +461,31 @@ static void esp6_destroy(struct xfrm_state *x)
 	crypto_free_aead(aead);
 }
 
+/*
+ * pcrypt runs the requests of a transform on all cpus and completes them
+ * in the order they were submitted, so the packets of an SA stay in order.
+ */
+static struct crypto_aead *esp_alloc_aead(const char *name)
+{
+	char pcrypt_name[CRYPTO_MAX_ALG_NAME];
+	struct crypto_aead *aead;
+
+	if (pcrypt && snprintf(pcrypt_name, CRYPTO_MAX_ALG_NAME, "pcrypt(%s)",
+			       name) < CRYPTO_MAX_ALG_NAME) {
+		aead = crypto_alloc_aead(pcrypt_name, 0, 0);
+		if (!IS_ERR(aead))
+			return aead;
+	}
+
+	return crypto_alloc_aead(name, 0, 0);
+}
+
 static int esp_init_aead(struct xfrm_state *x)
 {
 	struct crypto_aead *aead;
 	int err;
 
-	aead = crypto_alloc_aead(x->aead->alg_name, 0, 0);
+	aead = esp_alloc_aead(x->aead->alg_name);
 	err = PTR_ERR(aead);
 	if (IS_ERR(aead))
 		goto error;
@@ -513,7 +536,7 @@ static int esp_init_authenc(struct xfrm_state *x)
 			goto error;
 	}
 
-	aead = crypto_alloc_aead(authenc_name, 0, 0);
+	aead = esp_alloc_aead(authenc_name);
 	err = PTR_ERR(aead);
 	if (IS_ERR(aead))
 		goto error;
@@ -33,6 +33,7 @@
 #include <linux/mm.h>
 #include <linux/nsproxy.h>
 #include <linux/rculist_nulls.h>
+#include <linux/workqueue.h>
 
 #include <net/netfilter/nf_conntrack.h>
 #include <net/netfilter/nf_conntrack_l3proto.h>
@@ -120,6 +121,37 @@ EXPORT_SYMBOL_GPL(nf_conntrack_htable_size);
 unsigned int nf_conntrack_max __read_mostly;
 EXPORT_SYMBOL_GPL(nf_conntrack_max);
 
+/* The hash of init_net follows the number of conntracks, doubling
+ * above two entries per bucket and halving below one per eight buckets,
+ * unless its size was given with the hashsize parameter.
+ */
+static bool nf_conntrack_hash_auto __read_mostly;
+static DEFINE_MUTEX(nf_conntrack_hash_mutex);
+
+#define NF_CT_HASH_MIN	(PAGE_SIZE / sizeof(struct hlist_nulls_head))
+
+static void nf_conntrack_hash_work_fn(struct work_struct *work);
+static DECLARE_WORK(nf_conntrack_hash_work, nf_conntrack_hash_work_fn);
+
+static unsigned int nf_conntrack_hash_wanted(struct net *net)
+{
+	unsigned int count = atomic_read(&net->ct.count);
+	unsigned int size = net->ct.htable_size;
+
+	if (count > 2 * size)
+		return 2 * size;
+	if (count < size / 8 && size > NF_CT_HASH_MIN)
+		return size / 2;
+	return size;
+}
+
+static inline void nf_conntrack_hash_check(struct net *net)
+{
+	if (nf_conntrack_hash_auto && net_eq(net, &init_net) &&
+	    nf_conntrack_hash_wanted(net) != net->ct.htable_size)
+		schedule_work(&nf_conntrack_hash_work);
+}
+
 DEFINE_PER_CPU(struct nf_conn, nf_conntrack_untracked);
 EXPORT_PER_CPU_SYMBOL(nf_conntrack_untracked);
 
@@ -296,7 +328,6 @@ destroy_conntrack(struct nf_conntrack *nfct)
 
 	pr_debug("destroy_conntrack(%p)\n", ct);
 	NF_CT_ASSERT(atomic_read(&nfct->use) == 0);
-	NF_CT_ASSERT(!timer_pending(&ct->timeout));
 
 	rcu_read_lock();
 	l4proto = __nf_ct_l4proto_find(nf_ct_l3num(ct), nf_ct_protonum(ct));
@@ -356,33 +387,40 @@ bool nf_ct_delete(struct nf_conn *ct, u32 portid, int report)
 {
 	struct nf_conn_tstamp *tstamp;
 
+	/* whoever sets the bit owns the hash table reference */
+	if (test_and_set_bit(IPS_DYING_BIT, &ct->status))
+		return false;
+
 	tstamp = nf_conn_tstamp_find(ct);
 	if (tstamp && tstamp->stop == 0)
 		tstamp->stop = ktime_get_real_ns();
 
-	if (nf_ct_is_dying(ct))
-		goto delete;
-
 	if (nf_conntrack_event_report(IPCT_DESTROY, ct,
 				    portid, report) < 0) {
-		/* destroy event was not delivered */
+		/* destroy event was not delivered, the event cache
+		 * worker drops the reference once it is.
+		 */
 		nf_ct_delete_from_lists(ct);
 		nf_conntrack_ecache_delayed_work(nf_ct_net(ct));
 		return false;
 	}
 
 	nf_conntrack_ecache_work(nf_ct_net(ct));
-	set_bit(IPS_DYING_BIT, &ct->status);
- delete:
 	nf_ct_delete_from_lists(ct);
 	nf_ct_put(ct);
 	return true;
 }
 EXPORT_SYMBOL_GPL(nf_ct_delete);
 
-static void death_by_timeout(unsigned long ul_conntrack)
+static void nf_ct_gc_expired(struct nf_conn *ct)
 {
-	nf_ct_delete((struct nf_conn *)ul_conntrack, 0, 0);
+	if (!atomic_inc_not_zero(&ct->ct_general.use))
+		return;
+
+	if (nf_ct_should_gc(ct))
+		nf_ct_kill(ct);
+
+	nf_ct_put(ct);
 }
 
 static inline bool
@@ -419,6 +457,13 @@ ____nf_conntrack_find(struct net *net, u16 zone,
 	local_bh_disable();
 begin:
 	hlist_nulls_for_each_entry_rcu(h, n, &net->ct.hash[bucket], hnnode) {
+		struct nf_conn *ct = nf_ct_tuplehash_to_ctrack(h);
+
+		if (nf_ct_is_expired(ct)) {
+			nf_ct_gc_expired(ct);
+			continue;
+		}
+
 		if (nf_ct_key_equal(h, tuple, zone)) {
 			NF_CT_STAT_INC(net, found);
 			local_bh_enable();
@@ -522,7 +567,7 @@ nf_conntrack_hash_check_insert(struct nf_conn *ct)
 		    zone == nf_ct_zone(nf_ct_tuplehash_to_ctrack(h)))
 			goto out;
 
-	add_timer(&ct->timeout);
+	ct->timeout += nfct_time_stamp;
 	smp_wmb();
 	/* The caller holds a reference to this object */
 	atomic_set(&ct->ct_general.use, 2);
@@ -638,11 +683,10 @@ __nf_conntrack_confirm(struct sk_buff *skb)
 
 	nf_ct_del_from_dying_or_unconfirmed_list(ct);
 
-	/* Timer relative to confirmation time, not original
+	/* Timeout relative to confirmation time, not original
 	   setting time, otherwise we'd get timer wrap in
 	   weird delay cases. */
-	ct->timeout.expires += jiffies;
-	add_timer(&ct->timeout);
+	ct->timeout += nfct_time_stamp;
 	atomic_inc(&ct->ct_general.use);
 	ct->status |= IPS_CONFIRMED;
 
@@ -655,7 +699,7 @@ __nf_conntrack_confirm(struct sk_buff *skb)
 		tstamp->start = ktime_to_ns(skb->tstamp);
 	}
 	/* Since the lookup is lockless, hash insertion must be done after
-	 * starting the timer and setting the CONFIRMED bit. The RCU barriers
+	 * setting the timeout and the CONFIRMED bit. The RCU barriers
 	 * guarantee that no other CPU can find the conntrack before the above
 	 * stores are visible.
 	 */
@@ -699,6 +743,12 @@ nf_conntrack_tuple_taken(const struct nf_conntrack_tuple *tuple,
 	rcu_read_lock_bh();
 	hlist_nulls_for_each_entry_rcu(h, n, &net->ct.hash[hash], hnnode) {
 		ct = nf_ct_tuplehash_to_ctrack(h);
+
+		if (nf_ct_is_expired(ct)) {
+			nf_ct_gc_expired(ct);
+			continue;
+		}
+
 		if (ct != ignored_conntrack &&
 		    nf_ct_tuple_equal(tuple, &h->tuple) &&
 		    nf_ct_zone(ct) == zone) {
@@ -764,16 +814,110 @@ restart:
 	if (!ct)
 		return dropped;
 
-	if (del_timer(&ct->timeout)) {
-		if (nf_ct_delete(ct, 0, 0)) {
-			dropped = 1;
-			NF_CT_STAT_INC_ATOMIC(net, early_drop);
-		}
+	if (nf_ct_delete(ct, 0, 0)) {
+		dropped = 1;
+		NF_CT_STAT_INC_ATOMIC(net, early_drop);
 	}
 	nf_ct_put(ct);
 	return dropped;
 }
 
+/*
+ * Lookups reap the expired entries they walk over, the gc worker takes
+ * care of the ones nobody looks up anymore. Each run scans a slice of
+ * the table, and the next one starts right away while most of the
+ * entries it sees are expired.
+ */
+#define GC_MAX_BUCKETS_DIV	16u
+#define GC_MAX_BUCKETS		8192u
+#define GC_MAX_EVICTS		256u
+#define GC_INTERVAL		HZ
+#define GC_BATCH		16
+
+static void gc_worker(struct work_struct *work)
+{
+	struct netns_ct *ctnet = container_of(to_delayed_work(work),
+					      struct netns_ct, gc_work);
+	struct net *net = container_of(ctnet, struct net, ct);
+	unsigned int i, goal, buckets = 0, expired = 0, scanned = 0;
+	unsigned long next_run = GC_INTERVAL;
+	struct nf_conn *evict[GC_BATCH];
+
+	goal = clamp(ctnet->htable_size / GC_MAX_BUCKETS_DIV, 1u,
+		     GC_MAX_BUCKETS);
+	i = ctnet->gc_next_bucket;
+
+	do {
+		struct nf_conntrack_tuple_hash *h;
+		struct hlist_nulls_node *n;
+		unsigned int nr = 0, killed = 0, sequence;
+		spinlock_t *lockp;
+		bool full;
+
+		local_bh_disable();
+		sequence = read_seqcount_begin(&ctnet->generation);
+		if (i >= ctnet->htable_size)
+			i = 0;
+		lockp = &nf_conntrack_locks[i % CONNTRACK_LOCKS];
+		spin_lock(lockp);
+		if (read_seqcount_retry(&ctnet->generation, sequence)) {
+			spin_unlock(lockp);
+			local_bh_enable();
+			continue;
+		}
+
+		hlist_nulls_for_each_entry(h, n, &ctnet->hash[i], hnnode) {
+			struct nf_conn *tmp = nf_ct_tuplehash_to_ctrack(h);
+
+			/* each entry is looked at from its original tuple */
+			if (NF_CT_DIRECTION(h) != IP_CT_DIR_ORIGINAL)
+				continue;
+
+			scanned++;
+			if (nf_ct_is_expired(tmp) &&
+			    atomic_inc_not_zero(&tmp->ct_general.use)) {
+				evict[nr++] = tmp;
+				if (nr == ARRAY_SIZE(evict))
+					break;
+			}
+		}
+		spin_unlock(lockp);
+		local_bh_enable();
+
+		/* can't kill while holding the bucket lock */
+		full = nr == ARRAY_SIZE(evict);
+		while (nr) {
+			struct nf_conn *tmp = evict[--nr];
+
+			if (nf_ct_should_gc(tmp)) {
+				nf_ct_kill(tmp);
+				killed++;
+			}
+			nf_ct_put(tmp);
+		}
+		expired += killed;
+
+		/* the batch was full, have another look at this bucket */
+		if (full && killed)
+			continue;
+
+		i++;
+		buckets++;
+		cond_resched();
+	} while (buckets < goal && expired < GC_MAX_EVICTS);
+
+	NF_CT_STAT_ADD_ATOMIC(net, gc_scanned, scanned);
+	NF_CT_STAT_ADD_ATOMIC(net, gc_expired, expired);
+
+	/* 90% or more of the entries were expired */
+	if (expired >= GC_MAX_EVICTS ||
+	    (scanned && expired * 10 >= scanned * 9))
+		next_run = 0;
+
+	ctnet->gc_next_bucket = i;
+	schedule_delayed_work(&ctnet->gc_work, next_run);
+}
+
 void init_nf_conntrack_hash_rnd(void)
 {
 	unsigned int rand;
@@ -814,6 +958,7 @@ __nf_conntrack_alloc(struct net *net, u16 zone,
 			return ERR_PTR(-ENOMEM);
 		}
 	}
+	nf_conntrack_hash_check(net);
 
 	/*
 	 * Do not use kmem_cache_zalloc(), as this cache uses
@@ -837,8 +982,6 @@ __nf_conntrack_alloc(struct net *net, u16 zone,
 	ct->tuplehash[IP_CT_DIR_REPLY].tuple = *repl;
 	/* save hash for reusing when confirming */
 	*(unsigned long *)(&ct->tuplehash[IP_CT_DIR_REPLY].hnnode.pprev) = hash;
-	/* Don't set timer yet: wait for confirmation */
-	setup_timer(&ct->timeout, death_by_timeout, (unsigned long)ct);
 	write_pnet(&ct->ct_net, net);
 #ifdef CONFIG_NF_CONNTRACK_ZONES
 	if (zone) {
@@ -887,6 +1030,7 @@ void nf_conntrack_free(struct nf_conn *ct)
 	kmem_cache_free(net->ct.nf_conntrack_cachep, ct);
 	smp_mb__before_atomic();
 	atomic_dec(&net->ct.count);
+	nf_conntrack_hash_check(net);
 }
 EXPORT_SYMBOL_GPL(nf_conntrack_free);
 
@@ -1212,25 +1356,22 @@ void __nf_ct_refresh_acct(struct nf_conn *ct,
 			  unsigned long extra_jiffies,
 			  int do_acct)
 {
-	NF_CT_ASSERT(ct->timeout.data == (unsigned long)ct);
+	u32 timeout;
+
 	NF_CT_ASSERT(skb);
 
 	/* Only update if this is not a fixed timeout */
 	if (test_bit(IPS_FIXED_TIMEOUT_BIT, &ct->status))
 		goto acct;
 
-	/* If not in hash table, timer will not be active yet */
-	if (!nf_ct_is_confirmed(ct)) {
-		ct->timeout.expires = extra_jiffies;
-	} else {
-		unsigned long newtime = jiffies + extra_jiffies;
+	/* If not in hash table, the timeout is made absolute on confirm */
+	timeout = extra_jiffies;
+	if (nf_ct_is_confirmed(ct))
+		timeout += nfct_time_stamp;
 
-		/* Only update the timeout if the new timeout is at least
-		   HZ jiffies from the old timeout. Need del_timer for race
-		   avoidance (may already be dying). */
-		if (newtime - ct->timeout.expires >= HZ)
-			mod_timer_pending(&ct->timeout, newtime);
-	}
+	/* don't dirty the cacheline for every packet of a jiffy */
+	if (ct->timeout != timeout)
+		ct->timeout = timeout;
 
 acct:
 	if (do_acct) {
@@ -1265,11 +1406,7 @@ bool __nf_ct_kill_acct(struct nf_conn *ct,
 		}
 	}
 
-	if (del_timer(&ct->timeout)) {
-		ct->timeout.function((unsigned long)ct);
-		return true;
-	}
-	return false;
+	return nf_ct_delete(ct, 0, 0);
 }
 EXPORT_SYMBOL_GPL(__nf_ct_kill_acct);
 
@@ -1404,11 +1541,7 @@ void nf_ct_iterate_cleanup(struct net *net,
 
 	while ((ct = get_next_corpse(net, iter, data, &bucket)) != NULL) {
 		/* Time to push up daises... */
-		if (del_timer(&ct->timeout))
-			nf_ct_delete(ct, portid, report);
-
-		/* ... else the timer will get him soon. */
-
+		nf_ct_delete(ct, portid, report);
 		nf_ct_put(ct);
 	}
 }
@@ -1449,6 +1582,7 @@ static int untrack_refs(void)
 
 void nf_conntrack_cleanup_start(void)
 {
+	nf_conntrack_hash_auto = false;
 	RCU_INIT_POINTER(ip_ct_attach, NULL);
 }
 
@@ -1458,6 +1592,8 @@ void nf_conntrack_cleanup_end(void)
 	while (untrack_refs() > 0)
 		schedule();
 
+	cancel_work_sync(&nf_conntrack_hash_work);
+
 #ifdef CONFIG_NF_CONNTRACK_ZONES
 	nf_ct_extend_unregister(&nf_ct_zone_extend);
 #endif
@@ -1489,6 +1625,9 @@ void nf_conntrack_cleanup_net_list(struct list_head *net_exit_list)
 	int busy;
 	struct net *net;
 
+	list_for_each_entry(net, net_exit_list, exit_list)
+		cancel_delayed_work_sync(&net->ct.gc_work);
+
 	/*
 	 * This makes sure all current packets have passed through
 	 *  netfilter framework.  Roll on, two-stage module
@@ -1546,27 +1685,15 @@ void *nf_ct_alloc_hashtable(unsigned int *sizep, int nulls)
 }
 EXPORT_SYMBOL_GPL(nf_ct_alloc_hashtable);
 
-int nf_conntrack_set_hashsize(const char *val, struct kernel_param *kp)
+/* Called with nf_conntrack_hash_mutex held */
+static int nf_conntrack_hash_resize(unsigned int hashsize)
 {
-	int i, bucket, rc;
-	unsigned int hashsize, old_size;
+	int i, bucket;
+	unsigned int old_size;
 	struct hlist_nulls_head *hash, *old_hash;
 	struct nf_conntrack_tuple_hash *h;
 	struct nf_conn *ct;
 
-	if (current->nsproxy->net_ns != &init_net)
-		return -EOPNOTSUPP;
-
-	/* On boot, we can set this without any fancy locking. */
-	if (!nf_conntrack_htable_size)
-		return param_set_uint(val, kp);
-
-	rc = kstrtouint(val, 0, &hashsize);
-	if (rc)
-		return rc;
-	if (!hashsize)
-		return -EINVAL;
-
 	hash = nf_ct_alloc_hashtable(&hashsize, 1);
 	if (!hash)
 		return -ENOMEM;
@@ -1595,7 +1722,7 @@ int nf_conntrack_set_hashsize(const char *val, struct kernel_param *kp)
 	old_size = init_net.ct.htable_size;
 	old_hash = init_net.ct.hash;
 
-	init_net.ct.htable_size = nf_conntrack_htable_size = hashsize;
+	init_net.ct.htable_size = hashsize;
 	init_net.ct.hash = hash;
 
 	write_seqcount_end(&init_net.ct.generation);
@@ -1605,6 +1732,46 @@ int nf_conntrack_set_hashsize(const char *val, struct kernel_param *kp)
 	nf_ct_free_hashtable(old_hash, old_size);
 	return 0;
 }
+
+static void nf_conntrack_hash_work_fn(struct work_struct *work)
+{
+	unsigned int hashsize;
+
+	mutex_lock(&nf_conntrack_hash_mutex);
+	hashsize = nf_conntrack_hash_wanted(&init_net);
+	if (nf_conntrack_hash_auto && hashsize != init_net.ct.htable_size)
+		nf_conntrack_hash_resize(hashsize);
+	mutex_unlock(&nf_conntrack_hash_mutex);
+}
+
+int nf_conntrack_set_hashsize(const char *val, struct kernel_param *kp)
+{
+	unsigned int hashsize;
+	int rc;
+
+	if (current->nsproxy->net_ns != &init_net)
+		return -EOPNOTSUPP;
+
+	/* On boot, we can set this without any fancy locking. */
+	if (!nf_conntrack_htable_size)
+		return param_set_uint(val, kp);
+
+	rc = kstrtouint(val, 0, &hashsize);
+	if (rc)
+		return rc;
+	if (!hashsize)
+		return -EINVAL;
+
+	/* the size is the administrator's choice from now on */
+	mutex_lock(&nf_conntrack_hash_mutex);
+	nf_conntrack_hash_auto = false;
+	rc = nf_conntrack_hash_resize(hashsize);
+	if (!rc)
+		nf_conntrack_htable_size = init_net.ct.htable_size;
+	mutex_unlock(&nf_conntrack_hash_mutex);
+
+	return rc;
+}
 EXPORT_SYMBOL_GPL(nf_conntrack_set_hashsize);
 
 module_param_call(hashsize, nf_conntrack_set_hashsize, param_get_uint,
@@ -1643,6 +1810,7 @@ int nf_conntrack_init_start(void)
 		 * we use the old value of 8 to avoid reducing the max.
 		 * entries. */
 		max_factor = 4;
+		nf_conntrack_hash_auto = true;
 	}
 	nf_conntrack_max = max_factor * nf_conntrack_htable_size;
 
@@ -1800,6 +1968,10 @@ int nf_conntrack_init_net(struct net *net)
 	ret = nf_conntrack_proto_pernet_init(net);
 	if (ret < 0)
 		goto err_proto;
+
+	INIT_DEFERRABLE_WORK(&net->ct.gc_work, gc_worker);
+	net->ct.gc_next_bucket = 0;
+	schedule_delayed_work(&net->ct.gc_work, GC_INTERVAL);
 	return 0;
 
 err_proto:
@@ -79,9 +79,7 @@ static void nft_ct_get_eval(const struct nft_expr *expr,
 		return;
 #endif
 	case NFT_CT_EXPIRATION:
-		diff = (long)jiffies - (long)ct->timeout.expires;
-		if (diff < 0)
-			diff = 0;
+		diff = nf_ct_expires(ct);
 		dest->data[0] = jiffies_to_msecs(diff);
 		return;
 	case NFT_CT_HELPER:
@@ -741,6 +741,23 @@ void __sock_recv_timestamp(struct msghdr *msg, struct sock *sk,
 	if (!empty)
 		put_cmsg(msg, SOL_SOCKET,
 			 SCM_TIMESTAMPING, sizeof(tss), &tss);
+
+#ifdef CONFIG_NET_RX_STAGE_TSTAMP
+	if (sk->sk_tsflags & SOF_TIMESTAMPING_RX_STAGES) {
+		struct scm_timestamping_stages stages;
+		int i;
+
+		BUILD_BUG_ON((int)SKB_RX_STAGES != (int)SCM_TSTAMP_STAGE_DEQUEUE);
+
+		memset(&stages, 0, sizeof(stages));
+		for (i = 0; i < SKB_RX_STAGES; i++)
+			ktime_to_timespec_cond(skb->rx_stage[i],
+					       stages.ts + i);
+		getnstimeofday(&stages.ts[SCM_TSTAMP_STAGE_DEQUEUE]);
+		put_cmsg(msg, SOL_SOCKET, SCM_TIMESTAMPING_STAGES,
+			 sizeof(stages), &stages);
+	}
+#endif
 }
 EXPORT_SYMBOL_GPL(__sock_recv_timestamp);
 
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * mq_latency_tests.c
+ *   Measures the message passing latency between two processes. The
+ *   parent sends a message and waits for the child to send it back on a
+ *   second queue, so every message finds its receiver already blocked,
+ *   the single-sender/single-receiver handoff the kernel short-cuts.
+ *   The child can run at a real-time priority to mimic a control loop
+ *   talking to a non real-time process.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <mqueue.h>
+
+static char *usage =
+"Usage:\n"
+"  %s [-n iterations] [-s size] [-r prio] [-a cpu] [-b cpu] [-S]\n"
+"\n"
+"	-n #	Number of round trips to time (default 100000)\n"
+"	-s #	Message size in bytes (default 64)\n"
+"	-r #	Run the echoing child at SCHED_FIFO priority #\n"
+"	-a #	Pin the parent to CPU #\n"
+"	-b #	Pin the child to CPU #\n"
+"	-S	Use System V message queues instead of POSIX ones\n"
+"\n"
+"	Prints the round trip latency distribution in nanoseconds.\n"
+"\n";
+
+#define PING_NAME	"/mq_latency_ping"
+#define PONG_NAME	"/mq_latency_pong"
+
+static int iterations = 100000;
+static int msg_size = 64;
+static int rt_prio;
+static int parent_cpu = -1, child_cpu = -1;
+static int sysv;
+
+static mqd_t ping_mq, pong_mq;
+static int ping_id, pong_id;
+static volatile sig_atomic_t finished;
+
+struct sysv_msg {
+	long mtype;
+	char mtext[];
+};
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static void pin(int cpu)
+{
+	cpu_set_t set;
+
+	if (cpu < 0)
+		return;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set))
+		die("sched_setaffinity");
+}
+
+static void open_queues(void)
+{
+	struct mq_attr attr = { .mq_maxmsg = 1, .mq_msgsize = msg_size };
+
+	if (sysv) {
+		ping_id = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+		pong_id = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+		if (ping_id < 0 || pong_id < 0)
+			die("msgget");
+		return;
+	}
+
+	mq_unlink(PING_NAME);
+	mq_unlink(PONG_NAME);
+	ping_mq = mq_open(PING_NAME, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+	pong_mq = mq_open(PONG_NAME, O_RDWR | O_CREAT | O_EXCL, 0600, &attr);
+	if (ping_mq == (mqd_t)-1 || pong_mq == (mqd_t)-1)
+		die("mq_open");
+}
+
+static void close_queues(void)
+{
+	if (sysv) {
+		msgctl(ping_id, IPC_RMID, NULL);
+		msgctl(pong_id, IPC_RMID, NULL);
+		return;
+	}
+
+	mq_close(ping_mq);
+	mq_close(pong_mq);
+	mq_unlink(PING_NAME);
+	mq_unlink(PONG_NAME);
+}
+
+static void send_msg(int to_pong, struct sysv_msg *msg)
+{
+	int ret;
+
+	if (sysv)
+		ret = msgsnd(to_pong ? pong_id : ping_id, msg, msg_size, 0);
+	else
+		ret = mq_send(to_pong ? pong_mq : ping_mq, msg->mtext,
+			      msg_size, 0);
+	if (ret)
+		die("send");
+}
+
+static void recv_msg(int from_pong, struct sysv_msg *msg)
+{
+	ssize_t ret;
+
+	if (sysv)
+		ret = msgrcv(from_pong ? pong_id : ping_id, msg, msg_size,
+			     0, 0);
+	else
+		ret = mq_receive(from_pong ? pong_mq : ping_mq, msg->mtext,
+				 msg_size, NULL);
+	if (ret != msg_size)
+		die("receive");
+}
+
+static void echo(struct sysv_msg *msg)
+{
+	struct sched_param param = { .sched_priority = rt_prio };
+	int i;
+
+	pin(child_cpu);
+	if (rt_prio && sched_setscheduler(0, SCHED_FIFO, &param))
+		die("sched_setscheduler");
+
+	/* one more to let the parent warm up */
+	for (i = 0; i <= iterations; i++) {
+		recv_msg(0, msg);
+		send_msg(1, msg);
+	}
+	/* and do not exit before the parent expects it */
+	recv_msg(0, msg);
+	exit(0);
+}
+
+/* do not wait forever for a child that died */
+static void child_exited(int sig)
+{
+	if (finished)
+		return;
+	close_queues();
+	_exit(1);
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sysv_msg *msg;
+	long long *lat, sum = 0;
+	int opt, i, status;
+	pid_t child;
+
+	while ((opt = getopt(argc, argv, "n:s:r:a:b:S")) != -1) {
+		switch (opt) {
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 's':
+			msg_size = atoi(optarg);
+			break;
+		case 'r':
+			rt_prio = atoi(optarg);
+			break;
+		case 'a':
+			parent_cpu = atoi(optarg);
+			break;
+		case 'b':
+			child_cpu = atoi(optarg);
+			break;
+		case 'S':
+			sysv = 1;
+			break;
+		default:
+			fprintf(stderr, usage, argv[0]);
+			return 1;
+		}
+	}
+	if (iterations <= 0 || msg_size <= 0) {
+		fprintf(stderr, usage, argv[0]);
+		return 1;
+	}
+
+	msg = calloc(1, sizeof(*msg) + msg_size);
+	lat = calloc(iterations, sizeof(*lat));
+	if (!msg || !lat)
+		die("calloc");
+	msg->mtype = 1;
+
+	open_queues();
+	signal(SIGCHLD, child_exited);
+
+	child = fork();
+	if (child < 0)
+		die("fork");
+	if (child == 0)
+		echo(msg);
+
+	pin(parent_cpu);
+
+	send_msg(0, msg);
+	recv_msg(1, msg);
+	for (i = 0; i < iterations; i++) {
+		long long start = now_ns();
+
+		send_msg(0, msg);
+		recv_msg(1, msg);
+		lat[i] = now_ns() - start;
+		sum += lat[i];
+	}
+	finished = 1;
+	send_msg(0, msg);
+
+	if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status)) {
+		fprintf(stderr, "echo process failed\n");
+		close_queues();
+		return 1;
+	}
+	close_queues();
+
+	qsort(lat, iterations, sizeof(*lat), cmp_ll);
+	printf("%s queues, %d byte messages, %d round trips%s\n",
+	       sysv ? "System V" : "POSIX", msg_size, iterations,
+	       rt_prio ? ", SCHED_FIFO echo" : "");
+	printf("min %lld avg %lld p50 %lld p99 %lld p99.9 %lld max %lld\n",
+	       lat[0], sum / iterations, lat[iterations / 2],
+	       lat[(long long)iterations * 99 / 100],
+	       lat[(long long)iterations * 999 / 1000],
+	       lat[iterations - 1]);
+
+	return 0;
+}
@@ -0,0 +1,506 @@
+/*
+ * TCP_STREAM, TCP_RR and UDP_RR style network benchmark.
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Without -c the test runs against a server forked on the loopback
+ * address. For a real link start "netbench -s" on the peer and point
+ * the client at it with -c:
+ *
+ *	peer$ ./netbench -s
+ *	dut$  ./netbench -c 192.168.1.2 -t tcp_stream -l 10
+ *
+ * tcp_stream reports the throughput seen by the receiver, tcp_rr and
+ * udp_rr the transactions per second and the latency percentiles of a
+ * single request/response in flight. With -T the run fails when the
+ * throughput in Mbit/s, respectively the transaction rate, is below the
+ * given value, which is meant for gating kernel or driver updates.
+ */
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <endian.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define NSEC_PER_SEC	1000000000LL
+#define NSEC_PER_USEC	1000LL
+
+#define DEFAULT_PORT	5301
+#define MAX_MSG		(1 << 20)
+#define MAX_SAMPLES	(1 << 20)
+
+enum {
+	TEST_TCP_STREAM,
+	TEST_TCP_RR,
+	TEST_UDP_RR,
+};
+
+static const char * const test_names[] = {
+	[TEST_TCP_STREAM]	= "tcp_stream",
+	[TEST_TCP_RR]		= "tcp_rr",
+	[TEST_UDP_RR]		= "udp_rr",
+};
+
+/* sent by the client at the start of a tcp test */
+struct bench_hdr {
+	uint32_t test;
+	uint32_t msg_size;
+};
+
+static const char *host;
+static int port = DEFAULT_PORT;
+static int test = TEST_TCP_STREAM;
+static int msg_size;
+static int duration = 5;
+static double threshold;
+
+static char buf[MAX_MSG];
+static uint32_t *samples;
+static long nr_samples;
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int read_full(int fd, void *p, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		ssize_t n = read(fd, (char *)p + done, len - done);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		done += n;
+	}
+	return 0;
+}
+
+static int write_full(int fd, const void *p, size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		ssize_t n = write(fd, (const char *)p + done, len - done);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		done += n;
+	}
+	return 0;
+}
+
+static int bound_socket(int type)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_ANY),
+	};
+	int one = 1;
+	int fd;
+
+	fd = socket(AF_INET, type, 0);
+	if (fd < 0)
+		die("socket");
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)))
+		die("SO_REUSEADDR");
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)))
+		die("bind");
+	return fd;
+}
+
+/* Echo datagrams back for udp_rr, forever */
+static void udp_server(int fd)
+{
+	for (;;) {
+		struct sockaddr_storage peer;
+		socklen_t len = sizeof(peer);
+		ssize_t n;
+
+		n = recvfrom(fd, buf, sizeof(buf), 0,
+			     (struct sockaddr *)&peer, &len);
+		if (n < 0)
+			continue;
+		sendto(fd, buf, n, 0, (struct sockaddr *)&peer, len);
+	}
+}
+
+static void tcp_serve_one(int fd)
+{
+	struct bench_hdr hdr;
+	uint64_t total = 0;
+	ssize_t n;
+
+	if (read_full(fd, &hdr, sizeof(hdr)))
+		return;
+	hdr.test = ntohl(hdr.test);
+	hdr.msg_size = ntohl(hdr.msg_size);
+	if (!hdr.msg_size || hdr.msg_size > MAX_MSG)
+		return;
+
+	switch (hdr.test) {
+	case TEST_TCP_STREAM:
+		/* count until the client shuts down, then report */
+		while ((n = read(fd, buf, sizeof(buf))) != 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0)
+				return;
+			total += n;
+		}
+		total = htobe64(total);
+		write_full(fd, &total, sizeof(total));
+		break;
+	case TEST_TCP_RR:
+		while (!read_full(fd, buf, hdr.msg_size))
+			if (write_full(fd, buf, hdr.msg_size))
+				break;
+		break;
+	}
+}
+
+static void tcp_server(int fd)
+{
+	for (;;) {
+		int one = 1;
+		int c;
+
+		c = accept(fd, NULL, NULL);
+		if (c < 0)
+			continue;
+		setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		tcp_serve_one(c);
+		close(c);
+	}
+}
+
+/* The servers go away with the process that started them */
+static pid_t fork_server(void (*fn)(int), int fd)
+{
+	pid_t pid;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0)
+		die("fork");
+	if (!pid) {
+		prctl(PR_SET_PDEATHSIG, SIGKILL);
+		fn(fd);
+	}
+	close(fd);
+	return pid;
+}
+
+/*
+ * The sockets are bound before forking, so that the client can go ahead
+ * right away.
+ */
+static void start_servers(pid_t *pids)
+{
+	int tfd = bound_socket(SOCK_STREAM);
+	int ufd = bound_socket(SOCK_DGRAM);
+
+	if (listen(tfd, 16))
+		die("listen");
+
+	pids[0] = fork_server(tcp_server, tfd);
+	pids[1] = fork_server(udp_server, ufd);
+}
+
+static void stop_servers(pid_t *pids)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		kill(pids[i], SIGTERM);
+		waitpid(pids[i], NULL, 0);
+	}
+}
+
+static int client_socket(int type)
+{
+	struct addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = type,
+	};
+	struct addrinfo *res;
+	char service[16];
+	int fd, err;
+
+	snprintf(service, sizeof(service), "%d", port);
+	err = getaddrinfo(host, service, &hints, &res);
+	if (err) {
+		fprintf(stderr, "%s: %s\n", host, gai_strerror(err));
+		exit(1);
+	}
+
+	fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+	if (fd < 0)
+		die("socket");
+
+	if (connect(fd, res->ai_addr, res->ai_addrlen))
+		die("connect");
+	freeaddrinfo(res);
+	return fd;
+}
+
+static void add_sample(long long ns)
+{
+	if (nr_samples < MAX_SAMPLES)
+		samples[nr_samples++] = ns > UINT32_MAX ? UINT32_MAX : ns;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile_us(double p)
+{
+	long i = (long)(p / 100 * (nr_samples - 1));
+
+	return samples[i] / (double)NSEC_PER_USEC;
+}
+
+static double run_tcp_stream(void)
+{
+	struct bench_hdr hdr = { htonl(TEST_TCP_STREAM), htonl(msg_size) };
+	long long start, end;
+	uint64_t total;
+	double mbps;
+	int fd;
+
+	fd = client_socket(SOCK_STREAM);
+	if (write_full(fd, &hdr, sizeof(hdr)))
+		die("write");
+
+	start = now_ns();
+	end = start + duration * NSEC_PER_SEC;
+	while (now_ns() < end)
+		if (write_full(fd, buf, msg_size))
+			die("write");
+
+	shutdown(fd, SHUT_WR);
+	if (read_full(fd, &total, sizeof(total)))
+		die("read");
+	end = now_ns();
+	close(fd);
+
+	total = be64toh(total);
+	mbps = total * 8.0 / ((end - start) / (double)NSEC_PER_SEC) / 1e6;
+	printf("%s: %d byte writes, %.2f MB in %.2f s, %.2f Mbit/s\n",
+	       test_names[test], msg_size, total / 1e6,
+	       (end - start) / (double)NSEC_PER_SEC, mbps);
+	return mbps;
+}
+
+static double report_rr(long trans, long lost, long long elapsed)
+{
+	double rate = trans / (elapsed / (double)NSEC_PER_SEC);
+
+	printf("%s: %d byte messages, %ld transactions in %.2f s, %.0f trans/s",
+	       test_names[test], msg_size, trans,
+	       elapsed / (double)NSEC_PER_SEC, rate);
+	if (lost)
+		printf(", %ld lost", lost);
+	printf("\n");
+
+	if (nr_samples) {
+		qsort(samples, nr_samples, sizeof(*samples), cmp_u32);
+		printf("%s: latency us p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f\n",
+		       test_names[test], percentile_us(50), percentile_us(90),
+		       percentile_us(99), percentile_us(99.9),
+		       percentile_us(100));
+	}
+	return rate;
+}
+
+static double run_tcp_rr(void)
+{
+	struct bench_hdr hdr = { htonl(TEST_TCP_RR), htonl(msg_size) };
+	long long start, end, t0, t1;
+	long trans = 0;
+	int one = 1;
+	int fd;
+
+	fd = client_socket(SOCK_STREAM);
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	if (write_full(fd, &hdr, sizeof(hdr)))
+		die("write");
+
+	start = t0 = now_ns();
+	end = start + duration * NSEC_PER_SEC;
+	while (t0 < end) {
+		if (write_full(fd, buf, msg_size) ||
+		    read_full(fd, buf, msg_size))
+			die("tcp_rr");
+		t1 = now_ns();
+		add_sample(t1 - t0);
+		trans++;
+		t0 = t1;
+	}
+	close(fd);
+
+	return report_rr(trans, 0, t0 - start);
+}
+
+static double run_udp_rr(void)
+{
+	struct timeval tv = { .tv_sec = 1 };
+	long long start, end, t0, t1;
+	long trans = 0, lost = 0;
+	int fd;
+
+	fd = client_socket(SOCK_DGRAM);
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)))
+		die("SO_RCVTIMEO");
+
+	start = t0 = now_ns();
+	end = start + duration * NSEC_PER_SEC;
+	while (t0 < end) {
+		ssize_t n;
+
+		if (send(fd, buf, msg_size, 0) != msg_size)
+			die("send");
+		n = recv(fd, buf, msg_size, 0);
+		t1 = now_ns();
+		if (n == msg_size) {
+			add_sample(t1 - t0);
+			trans++;
+		} else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+			die("recv");
+		} else {
+			lost++;
+		}
+		t0 = t1;
+	}
+	close(fd);
+
+	return report_rr(trans, lost, t0 - start);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-s] [-c host] [-p port] [-t tcp_stream|tcp_rr|udp_rr] [-m msg_size] [-l seconds] [-T threshold]\n",
+		name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int server = 0;
+	pid_t pids[2] = { 0 };
+	double result;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "sc:p:t:m:l:T:")) != -1) {
+		switch (opt) {
+		case 's':
+			server = 1;
+			break;
+		case 'c':
+			host = optarg;
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 't':
+			for (i = 0; i < 3; i++)
+				if (!strcmp(optarg, test_names[i]))
+					break;
+			if (i == 3)
+				usage(argv[0]);
+			test = i;
+			break;
+		case 'm':
+			msg_size = atoi(optarg);
+			break;
+		case 'l':
+			duration = atoi(optarg);
+			break;
+		case 'T':
+			threshold = atof(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!msg_size)
+		msg_size = test == TEST_TCP_STREAM ? 16384 : 1;
+	if (msg_size < 0 || msg_size > MAX_MSG || duration <= 0)
+		usage(argv[0]);
+
+	if (server) {
+		start_servers(pids);
+		pause();
+		return 0;
+	}
+
+	samples = malloc(MAX_SAMPLES * sizeof(*samples));
+	if (!samples)
+		die("malloc");
+
+	if (!host) {
+		host = "127.0.0.1";
+		start_servers(pids);
+	}
+
+	switch (test) {
+	case TEST_TCP_STREAM:
+		result = run_tcp_stream();
+		break;
+	case TEST_TCP_RR:
+		result = run_tcp_rr();
+		break;
+	default:
+		result = run_udp_rr();
+		break;
+	}
+
+	if (pids[0])
+		stop_servers(pids);
+
+	if (threshold && result < threshold) {
+		printf("%s: below %.0f: [FAIL]\n", test_names[test], threshold);
+		return 1;
+	}
+	printf("[PASS]\n");
+	return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * Throughput of a pipe between two processes for a range of write sizes.
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * For each write size the parent pushes the given amount of data to a
+ * child that reads it in 64 KB chunks. Compare the numbers for several
+ * /proc/sys/fs/pipe-reuse-pages settings.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/wait.h>
+
+#define READ_SIZE	65536
+
+static const size_t sizes[] = { 64, 512, 4096, 16384, 65536, 262144 };
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void reader(int fd, size_t total)
+{
+	static char buf[READ_SIZE];
+	ssize_t n;
+
+	while (total) {
+		n = read(fd, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			perror("read");
+			exit(1);
+		}
+		total -= n;
+	}
+	exit(0);
+}
+
+static int run(size_t size, size_t total, double *mbps)
+{
+	char *buf = malloc(size);
+	double start, elapsed;
+	size_t left = total;
+	int fds[2], status;
+	pid_t pid;
+
+	if (!buf || pipe(fds)) {
+		perror("setup");
+		return -1;
+	}
+	memset(buf, 0x5a, size);
+
+	/* the child exits through exit(), keep it from repeating our output */
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return -1;
+	}
+	if (!pid) {
+		close(fds[1]);
+		reader(fds[0], total);
+	}
+	close(fds[0]);
+
+	start = now();
+	while (left) {
+		ssize_t n = write(fds[1], buf, left < size ? left : size);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			perror("write");
+			return -1;
+		}
+		left -= n;
+	}
+	close(fds[1]);
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status))
+		return -1;
+	elapsed = now() - start;
+
+	*mbps = total / elapsed / (1 << 20);
+	free(buf);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	size_t total = 1024UL << 20;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:")) != -1) {
+		switch (opt) {
+		case 'm':
+			total = strtoul(optarg, NULL, 0) << 20;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-m megabytes]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (!total) {
+		fprintf(stderr, "nothing to transfer\n");
+		return 1;
+	}
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		double mbps;
+
+		if (run(sizes[i], total, &mbps)) {
+			printf("write size %7zu: [FAIL]\n", sizes[i]);
+			return 1;
+		}
+		printf("write size %7zu: %8.1f MB/s\n", sizes[i], mbps);
+	}
+
+	printf("[PASS]\n");
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Jitter seen by a task pinned to a cpu, in the style of cyclictest.
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Two measurements are made on the given cpu:
+ *  - the wakeup latency of a periodic absolute clock_nanosleep(),
+ *  - the interruptions of a busy loop that only reads the clock, which
+ *    on a nohz_full cpu should not see a tick.
+ *
+ * The test fails if a threshold is given and the worst wakeup latency
+ * or busy loop interruption exceeds it.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+#define NSEC_PER_SEC	1000000000LL
+#define NSEC_PER_USEC	1000LL
+
+/* a gap in the busy loop longer than this is an interruption */
+#define GAP_NSEC	(5 * NSEC_PER_USEC)
+
+static int cpu = 1;
+static long interval_us = 1000;
+static long loops = 10000;
+static long busy_sec = 10;
+static long threshold_us;
+
+static long long ts_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts_ns(&ts);
+}
+
+static void ts_add(struct timespec *ts, long long ns)
+{
+	ns += ts->tv_nsec;
+	ts->tv_sec += ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+static long long test_timer(void)
+{
+	long long lat, min = -1, max = 0, sum = 0;
+	struct timespec next;
+	long i;
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	for (i = 0; i < loops; i++) {
+		int ret;
+
+		ts_add(&next, interval_us * NSEC_PER_USEC);
+		do {
+			ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					      &next, NULL);
+		} while (ret == EINTR);
+		if (ret) {
+			fprintf(stderr, "clock_nanosleep: %s\n", strerror(ret));
+			exit(1);
+		}
+
+		lat = now_ns() - ts_ns(&next);
+		if (min < 0 || lat < min)
+			min = lat;
+		if (lat > max)
+			max = lat;
+		sum += lat;
+	}
+
+	printf("timer: %ld loops of %ld us, latency min %lld avg %lld max %lld us\n",
+	       loops, interval_us, min / NSEC_PER_USEC,
+	       sum / loops / NSEC_PER_USEC, max / NSEC_PER_USEC);
+
+	return max;
+}
+
+static long long test_busy(void)
+{
+	long long start, end, prev, now, gap, max = 0, total = 0;
+	long nr = 0;
+
+	start = prev = now_ns();
+	end = start + busy_sec * NSEC_PER_SEC;
+	while (prev < end) {
+		now = now_ns();
+		gap = now - prev;
+		if (gap > GAP_NSEC) {
+			nr++;
+			total += gap;
+			if (gap > max)
+				max = gap;
+		}
+		prev = now;
+	}
+
+	printf("busy: %ld s, %ld interruptions (%.1f/s), %lld us lost, max %lld us\n",
+	       busy_sec, nr, (double)nr / busy_sec, total / NSEC_PER_USEC,
+	       max / NSEC_PER_USEC);
+
+	return max;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-c cpu] [-i interval_us] [-l loops] [-b busy_sec] [-t threshold_us]\n",
+		name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct sched_param param = { .sched_priority = 80 };
+	long long timer_max, busy_max;
+	cpu_set_t set;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:i:l:b:t:")) != -1) {
+		switch (opt) {
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'i':
+			interval_us = atol(optarg);
+			break;
+		case 'l':
+			loops = atol(optarg);
+			break;
+		case 'b':
+			busy_sec = atol(optarg);
+			break;
+		case 't':
+			threshold_us = atol(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (interval_us <= 0 || loops <= 0 || busy_sec <= 0)
+		usage(argv[0]);
+
+	if (cpu >= sysconf(_SC_NPROCESSORS_ONLN)) {
+		printf("cpu %d is not online, skipping\n", cpu);
+		return 0;
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set)) {
+		perror("sched_setaffinity");
+		return 1;
+	}
+
+	/* without privileges the numbers include scheduling delays */
+	if (mlockall(MCL_CURRENT | MCL_FUTURE))
+		perror("mlockall");
+	if (sched_setscheduler(0, SCHED_FIFO, &param))
+		perror("sched_setscheduler");
+
+	timer_max = test_timer();
+	busy_max = test_busy();
+
+	if (threshold_us &&
+	    (timer_max > threshold_us * NSEC_PER_USEC ||
+	     busy_max > threshold_us * NSEC_PER_USEC)) {
+		printf("jitter above %ld us: [FAIL]\n", threshold_us);
+		return 1;
+	}
+
+	printf("[PASS]\n");
+	return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Rate of fork + exec + exit of a short-lived helper.
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * The helper is the given program, or this binary re-executed with
+ * --child, which exits right away. Compare the rates with different
+ * /proc/sys/vm/exec_prefault_kb and fault_around_bytes settings; minor
+ * faults per exec are printed as well.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-s seconds] [program [args...]]\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	char *self[] = { "/proc/self/exe", "--child", NULL };
+	char **child_argv = self;
+	double start, elapsed;
+	struct rusage ru;
+	long seconds = 5, n = 0;
+	int opt;
+
+	if (argc == 2 && !strcmp(argv[1], "--child"))
+		return 0;
+
+	while ((opt = getopt(argc, argv, "+s:")) != -1) {
+		switch (opt) {
+		case 's':
+			seconds = atol(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (seconds <= 0)
+		usage(argv[0]);
+	if (optind < argc)
+		child_argv = argv + optind;
+
+	start = now();
+	do {
+		int status;
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (!pid) {
+			execv(child_argv[0], child_argv);
+			_exit(127);
+		}
+		if (waitpid(pid, &status, 0) < 0) {
+			perror("waitpid");
+			return 1;
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+			fprintf(stderr, "%s: exec failed\n", child_argv[0]);
+			return 1;
+		}
+		n++;
+		elapsed = now() - start;
+	} while (elapsed < seconds);
+
+	getrusage(RUSAGE_CHILDREN, &ru);
+	printf("%ld execs in %.2f s: %.0f/s, %.1f us each, %.1f minor faults each\n",
+	       n, elapsed, n / elapsed, elapsed * 1e6 / n,
+	       (double)ru.ru_minflt / n);
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Anonymous page fault throughput inside and outside of a memory cgroup.
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A buffer is mapped, every page of it touched and the buffer unmapped
+ * again, first in the cgroup the program was started in and then in a
+ * new child of the memory controller mount. The difference between the
+ * two rates is the cost of charging and uncharging the pages.
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char *memcg_root = "/sys/fs/cgroup/memory";
+static size_t size = 64UL << 20;
+static long seconds = 5;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double fault_rate(void)
+{
+	long page_size = sysconf(_SC_PAGESIZE);
+	double start, elapsed;
+	long faults = 0;
+	size_t off;
+	char *p;
+
+	start = now();
+	do {
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			perror("mmap");
+			exit(1);
+		}
+		for (off = 0; off < size; off += page_size)
+			p[off] = 1;
+		munmap(p, size);
+		faults += size / page_size;
+		elapsed = now() - start;
+	} while (elapsed < seconds);
+
+	return faults / elapsed;
+}
+
+static int write_pid(const char *dir)
+{
+	char path[256];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/tasks", dir);
+	f = fopen(path, "w");
+	if (!f)
+		return -1;
+	fprintf(f, "%d\n", getpid());
+	return fclose(f);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-m megabytes] [-s seconds] [-c memcg mount]\n",
+		name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	double outside, inside;
+	char dir[256];
+	int opt;
+
+	while ((opt = getopt(argc, argv, "m:s:c:")) != -1) {
+		switch (opt) {
+		case 'm':
+			size = strtoul(optarg, NULL, 0) << 20;
+			break;
+		case 's':
+			seconds = atol(optarg);
+			break;
+		case 'c':
+			memcg_root = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!size || seconds <= 0)
+		usage(argv[0]);
+
+	outside = fault_rate();
+	printf("outside: %.0f faults/s\n", outside);
+
+	snprintf(dir, sizeof(dir), "%s/memcg-fault-rate.%d", memcg_root,
+		 getpid());
+	if (mkdir(dir, 0755)) {
+		printf("cannot create %s (%s), skipping\n", dir,
+		       strerror(errno));
+		return 0;
+	}
+	if (write_pid(dir)) {
+		perror("moving into the memcg");
+		rmdir(dir);
+		return 1;
+	}
+
+	inside = fault_rate();
+	printf("inside:  %.0f faults/s (%.1f%%)\n", inside,
+	       100.0 * (inside - outside) / outside);
+
+	/* back to the root group, the new one can only go once it's empty */
+	if (write_pid(memcg_root) || rmdir(dir))
+		perror("cleaning up the memcg");
+
+	printf("[PASS]\n");
+	return 0;
+}
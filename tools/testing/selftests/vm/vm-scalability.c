@@ -0,0 +1,515 @@
+/*
+ * Page fault, mmap, THP collapse and reclaim scalability.
+ *
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Each test runs for a while with 1, 2, 4, ... threads up to the number
+ * of online CPUs (or only with -n threads) in one address space, so the
+ * rates show how well mmap_sem, the page allocator, memcg charging and
+ * reclaim scale:
+ *
+ *   fault	   every thread faults in and unmaps its own anonymous buffer
+ *   mmap	   every thread maps, touches and unmaps one page at a time
+ *   thp-fault	   like fault, with MADV_HUGEPAGE buffers
+ *   thp-collapse  khugepaged collapsing a buffer faulted with small pages
+ *   reclaim	   every thread reads its part of a file through a memory
+ *		   cgroup limited to a quarter of the file
+ *
+ * One line of key=value pairs is printed per result, for example
+ *
+ *   test=fault threads=4 ops=5242880 seconds=5.00 rate=1048576 unit=faults/s
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define THP_SYSFS	"/sys/kernel/mm/transparent_hugepage"
+
+static const char *memcg_root = "/sys/fs/cgroup/memory";
+static const char *file_dir = ".";
+static size_t size = 64UL << 20;
+static long seconds = 5;
+static long page_size;
+static size_t hpage_size;
+
+struct worker {
+	pthread_t thread;
+	int id;
+	int nr;
+	char *buf;		/* reclaim: the shared file mapping */
+	unsigned long ops;
+};
+
+static pthread_barrier_t start_barrier;
+static volatile int stop;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *map_buffer(size_t len, size_t align)
+{
+	char *p;
+
+	p = mmap(NULL, len + align, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	if (align) {
+		char *start = (char *)(((unsigned long)p + align - 1) &
+				       ~(align - 1));
+
+		if (start > p)
+			munmap(p, start - p);
+		munmap(start + len, p + align - start);
+		p = start;
+	}
+	return p;
+}
+
+static void *fault_worker(void *arg)
+{
+	struct worker *w = arg;
+	size_t len = size / w->nr, off;
+	char *p;
+
+	pthread_barrier_wait(&start_barrier);
+	while (!stop) {
+		p = map_buffer(len, 0);
+		for (off = 0; off < len; off += page_size)
+			p[off] = 1;
+		munmap(p, len);
+		w->ops += len / page_size;
+	}
+	return NULL;
+}
+
+static void *mmap_worker(void *arg)
+{
+	struct worker *w = arg;
+	char *p;
+
+	pthread_barrier_wait(&start_barrier);
+	while (!stop) {
+		p = map_buffer(page_size, 0);
+		*p = 1;
+		munmap(p, page_size);
+		w->ops++;
+	}
+	return NULL;
+}
+
+static void *thp_fault_worker(void *arg)
+{
+	struct worker *w = arg;
+	size_t len = size / w->nr & ~(hpage_size - 1), off;
+	char *p;
+
+	if (!len)
+		len = hpage_size;
+
+	pthread_barrier_wait(&start_barrier);
+	while (!stop) {
+		p = map_buffer(len, hpage_size);
+		if (madvise(p, len, MADV_HUGEPAGE)) {
+			perror("MADV_HUGEPAGE");
+			exit(1);
+		}
+		for (off = 0; off < len; off += page_size)
+			p[off] = 1;
+		munmap(p, len);
+		w->ops += len / page_size;
+	}
+	return NULL;
+}
+
+static void *reclaim_worker(void *arg)
+{
+	struct worker *w = arg;
+	size_t len = size / w->nr, off;
+	const volatile char *p = w->buf + w->id * len;
+
+	pthread_barrier_wait(&start_barrier);
+	while (!stop) {
+		for (off = 0; off < len && !stop; off += page_size) {
+			(void)p[off];
+			w->ops++;
+		}
+	}
+	return NULL;
+}
+
+static void report(const char *test, int nr, unsigned long ops,
+		   double elapsed, const char *unit)
+{
+	printf("test=%s threads=%d ops=%lu seconds=%.2f rate=%.0f unit=%s\n",
+	       test, nr, ops, elapsed, ops / elapsed, unit);
+	fflush(stdout);
+}
+
+static unsigned long run_workers(void *(*fn)(void *), int nr, char *buf,
+				 double *elapsed)
+{
+	struct worker *w = calloc(nr, sizeof(*w));
+	unsigned long ops = 0;
+	double start;
+	int i;
+
+	if (!w) {
+		perror("calloc");
+		exit(1);
+	}
+
+	stop = 0;
+	pthread_barrier_init(&start_barrier, NULL, nr + 1);
+	for (i = 0; i < nr; i++) {
+		w[i].id = i;
+		w[i].nr = nr;
+		w[i].buf = buf;
+		if (pthread_create(&w[i].thread, NULL, fn, &w[i])) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	start = now();
+	sleep(seconds);
+	stop = 1;
+
+	for (i = 0; i < nr; i++) {
+		pthread_join(w[i].thread, NULL);
+		ops += w[i].ops;
+	}
+	*elapsed = now() - start;
+
+	pthread_barrier_destroy(&start_barrier);
+	free(w);
+	return ops;
+}
+
+static int read_file(const char *path, char *buf, size_t len)
+{
+	ssize_t n;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	n = read(fd, buf, len - 1);
+	close(fd);
+	if (n < 0)
+		return -1;
+	buf[n] = '\0';
+	return 0;
+}
+
+static int write_file(const char *path, const char *fmt, unsigned long val)
+{
+	FILE *f;
+
+	f = fopen(path, "w");
+	if (!f)
+		return -1;
+	fprintf(f, fmt, val);
+	return fclose(f);
+}
+
+static long read_counter(const char *path)
+{
+	char buf[32];
+
+	if (read_file(path, buf, sizeof(buf)))
+		return -1;
+	return atol(buf);
+}
+
+/* sum of the /proc/vmstat counters starting with prefix */
+static unsigned long vmstat_sum(const char *prefix)
+{
+	unsigned long sum = 0, val;
+	char name[64];
+	FILE *f;
+
+	f = fopen("/proc/vmstat", "r");
+	if (!f)
+		return 0;
+	while (fscanf(f, "%63s %lu", name, &val) == 2)
+		if (!strncmp(name, prefix, strlen(prefix)))
+			sum += val;
+	fclose(f);
+	return sum;
+}
+
+static int thp_available(void)
+{
+	char buf[128];
+	FILE *f;
+
+	if (read_file(THP_SYSFS "/enabled", buf, sizeof(buf)) ||
+	    strstr(buf, "[never]"))
+		return 0;
+
+	f = fopen("/proc/meminfo", "r");
+	if (!f)
+		return 0;
+	while (fgets(buf, sizeof(buf), f))
+		if (sscanf(buf, "Hugepagesize: %zu kB", &hpage_size) == 1)
+			break;
+	fclose(f);
+
+	hpage_size <<= 10;
+	return hpage_size > (size_t)page_size;
+}
+
+static void thp_collapse(void)
+{
+	const char *counter = THP_SYSFS "/khugepaged/pages_collapsed";
+	size_t len = size & ~(hpage_size - 1), off;
+	long before, after;
+	double start, elapsed;
+	char *p;
+
+	if (!len)
+		len = hpage_size;
+
+	before = read_counter(counter);
+	if (before < 0) {
+		printf("test=thp-collapse skipped=\"no khugepaged\"\n");
+		return;
+	}
+
+	p = map_buffer(len, hpage_size);
+	if (madvise(p, len, MADV_NOHUGEPAGE)) {
+		perror("MADV_NOHUGEPAGE");
+		exit(1);
+	}
+	for (off = 0; off < len; off += page_size)
+		p[off] = 1;
+	if (madvise(p, len, MADV_HUGEPAGE)) {
+		perror("MADV_HUGEPAGE");
+		exit(1);
+	}
+
+	/* khugepaged wakes up every scan_sleep_millisecs, wait for it */
+	start = now();
+	do {
+		usleep(100000);
+		after = read_counter(counter);
+		elapsed = now() - start;
+	} while (after - before < (long)(len / hpage_size) &&
+		 elapsed < seconds);
+
+	munmap(p, len);
+	report("thp-collapse", 1, after - before, elapsed, "hugepages/s");
+}
+
+/* a file of the given size that is not in the page cache */
+static int create_file(void)
+{
+	char path[256];
+	size_t off;
+	char *buf;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/vm-scalability.%d", file_dir,
+		 getpid());
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	unlink(path);
+
+	buf = malloc(page_size);
+	if (!buf) {
+		perror("malloc");
+		close(fd);
+		return -1;
+	}
+	memset(buf, 1, page_size);
+	for (off = 0; off < size; off += page_size)
+		if (write(fd, buf, page_size) != page_size) {
+			perror("write");
+			break;
+		}
+	free(buf);
+
+	if (off < size || fsync(fd)) {
+		close(fd);
+		return -1;
+	}
+	posix_fadvise(fd, 0, size, POSIX_FADV_DONTNEED);
+	return fd;
+}
+
+static void reclaim(int nr)
+{
+	unsigned long ops, stolen;
+	char dir[256], path[512];
+	double elapsed;
+	int fd;
+	char *p;
+
+	fd = create_file();
+	if (fd < 0)
+		return;
+
+	snprintf(dir, sizeof(dir), "%s/vm-scalability.%d", memcg_root,
+		 getpid());
+	if (mkdir(dir, 0755)) {
+		printf("test=reclaim skipped=\"cannot create %s: %s\"\n", dir,
+		       strerror(errno));
+		goto out_close;
+	}
+	snprintf(path, sizeof(path), "%s/memory.limit_in_bytes", dir);
+	if (write_file(path, "%lu\n", size / 4)) {
+		perror("setting the memcg limit");
+		goto out_rmdir;
+	}
+	/* the page cache read from now on is charged to the group */
+	snprintf(path, sizeof(path), "%s/cgroup.procs", dir);
+	if (write_file(path, "%lu\n", getpid())) {
+		perror("moving into the memcg");
+		goto out_rmdir;
+	}
+
+	p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		goto out_leave;
+	}
+
+	stolen = vmstat_sum("pgsteal_");
+	ops = run_workers(reclaim_worker, nr, p, &elapsed);
+	stolen = vmstat_sum("pgsteal_") - stolen;
+
+	printf("test=reclaim threads=%d ops=%lu seconds=%.2f rate=%.0f unit=pages/s reclaimed=%lu reclaim_rate=%.0f\n",
+	       nr, ops, elapsed, ops / elapsed, stolen, stolen / elapsed);
+	fflush(stdout);
+
+	munmap(p, size);
+out_leave:
+	/* back to the root group, the new one can only go once it's empty */
+	snprintf(path, sizeof(path), "%s/cgroup.procs", memcg_root);
+	if (write_file(path, "%lu\n", getpid()))
+		perror("leaving the memcg");
+out_rmdir:
+	if (rmdir(dir))
+		perror("removing the memcg");
+out_close:
+	close(fd);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-t test] [-n threads] [-m megabytes] [-s seconds]\n"
+		"          [-c memcg mount] [-d file directory]\n"
+		"tests: fault, mmap, thp-fault, thp-collapse, reclaim\n",
+		name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *test = NULL;
+	double elapsed;
+	unsigned long ops;
+	int nr = 0, n, thp;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:n:m:s:c:d:")) != -1) {
+		switch (opt) {
+		case 't':
+			test = optarg;
+			break;
+		case 'n':
+			nr = atoi(optarg);
+			break;
+		case 'm':
+			size = strtoul(optarg, NULL, 0) << 20;
+			break;
+		case 's':
+			seconds = atol(optarg);
+			break;
+		case 'c':
+			memcg_root = optarg;
+			break;
+		case 'd':
+			file_dir = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!size || seconds <= 0 || nr < 0)
+		usage(argv[0]);
+	if (ncpus < 1)
+		ncpus = 1;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	thp = thp_available();
+
+#define want(name) (!test || !strcmp(test, name))
+#define for_each_nr(n) \
+	for (n = nr ? nr : 1; n <= (nr ? nr : ncpus); \
+	     n = (n * 2 > ncpus && n < ncpus) ? ncpus : n * 2)
+
+	if (test && !want("fault") && !want("mmap") && !want("thp-fault") &&
+	    !want("thp-collapse") && !want("reclaim"))
+		usage(argv[0]);
+
+	if (want("fault"))
+		for_each_nr(n) {
+			ops = run_workers(fault_worker, n, NULL, &elapsed);
+			report("fault", n, ops, elapsed, "faults/s");
+		}
+
+	if (want("mmap"))
+		for_each_nr(n) {
+			ops = run_workers(mmap_worker, n, NULL, &elapsed);
+			report("mmap", n, ops, elapsed, "maps/s");
+		}
+
+	if (want("thp-fault") || want("thp-collapse")) {
+		if (!thp)
+			printf("test=thp skipped=\"transparent hugepages disabled\"\n");
+	}
+
+	if (thp && want("thp-fault"))
+		for_each_nr(n) {
+			ops = run_workers(thp_fault_worker, n, NULL, &elapsed);
+			report("thp-fault", n, ops, elapsed, "faults/s");
+		}
+
+	if (thp && want("thp-collapse"))
+		thp_collapse();
+
+	if (want("reclaim"))
+		for_each_nr(n)
+			reclaim(n);
+
+	printf("[PASS]\n");
+	return 0;
+}
@@ -0,0 +1,130 @@
+/* $(CROSS_COMPILE)cc -Wall -Wextra -g -o usbmon-rate usbmon-rate.c */
+
+/*
+ * Copyright (C) 2015 Xilinx
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+/*
+ * This program measures the bulk and isochronous throughput of a USB bus
+ * from the completions reported by the usbmon text interface, so that host
+ * controller tuning can be compared without instrumenting the device side:
+ *
+ *	mount -t debugfs none /sys/kernel/debug
+ *	modprobe usbmon
+ *	./usbmon-rate -b 1 -d 2 &
+ *	dd if=/dev/sda of=/dev/null bs=1M count=512 iflag=direct
+ *
+ * Besides the throughput it prints the number of completed URBs, which
+ * shows how many transfers each interrupt had to cover.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define USBMON_PATH	"/sys/kernel/debug/usb/usbmon"
+
+struct rate {
+	unsigned long long bytes;
+	unsigned long urbs;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(struct rate *in, struct rate *out, double elapsed)
+{
+	printf("IN %8.2f MB/s %6lu URBs  OUT %8.2f MB/s %6lu URBs\n",
+	       in->bytes / elapsed / 1e6, in->urbs,
+	       out->bytes / elapsed / 1e6, out->urbs);
+	fflush(stdout);
+	memset(in, 0, sizeof(*in));
+	memset(out, 0, sizeof(*out));
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-b bus] [-d device] [-e endpoint] [-i seconds]\n",
+		name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int bus = 0, dev = -1, ep = -1, opt;
+	double interval = 1.0, start, t;
+	struct rate in = { 0 }, out = { 0 };
+	char path[64], line[512];
+	FILE *mon;
+
+	while ((opt = getopt(argc, argv, "b:d:e:i:")) != -1) {
+		switch (opt) {
+		case 'b':
+			bus = atoi(optarg);
+			break;
+		case 'd':
+			dev = atoi(optarg);
+			break;
+		case 'e':
+			ep = atoi(optarg);
+			break;
+		case 'i':
+			interval = atof(optarg);
+			if (interval <= 0)
+				usage(argv[0]);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	snprintf(path, sizeof(path), USBMON_PATH "/%du", bus);
+	mon = fopen(path, "r");
+	if (!mon) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	start = now();
+	while (fgets(line, sizeof(line), mon)) {
+		unsigned int ubus, udev, uep, len;
+		char event, type, dir;
+
+		/* tag timestamp event type+dir:bus:dev:ep status length */
+		if (sscanf(line, "%*s %*u %c %c%c:%u:%u:%u %*s %u",
+			   &event, &type, &dir, &ubus, &udev, &uep,
+			   &len) != 7)
+			continue;
+
+		if (event == 'C' && (type == 'B' || type == 'Z') &&
+		    (dev < 0 || (int)udev == dev) &&
+		    (ep < 0 || (int)uep == ep)) {
+			struct rate *r = dir == 'i' ? &in : &out;
+
+			r->bytes += len;
+			r->urbs++;
+		}
+
+		t = now();
+		if (t - start >= interval) {
+			report(&in, &out, t - start);
+			start = t;
+		}
+	}
+
+	fclose(mon);
+	return 0;
+}